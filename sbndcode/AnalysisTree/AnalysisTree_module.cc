@@ -13,7 +13,7 @@
 // [x] use variable size array buffers for each tracker datum instead of [kMaxTrack]
 // [x] turn the truth/GEANT information into vectors
 // [ ] move hit_trkid into the track information, remove kMaxTrackers
-// [ ] turn the hit information into vectors (~1 MB worth), remove kMaxHits
+// [x] turn the hit information into vectors (~1 MB worth), remove kMaxHits
 // [ ] fill the tree branch by branch
 // 
 // Current implementation:
@@ -133,6 +133,9 @@
 #include "larreco/RecoAlg/PMAlg/PmaTrack3D.h"
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 #include "sbndcode/RecoUtils/RecoUtils.h"
+#include "sbndcode/Utilities/AsyncTreeWriter.h"
+
+#include "tbb/parallel_for.h"
 
 #include <cstring> // std::memcpy()
 #include <vector>
@@ -147,12 +150,12 @@
 #include <functional> // std::mem_fn()
 #include <typeinfo>
 #include <cmath>
+#include <optional>
 
 #include "TTree.h"
 #include "TTimeStamp.h"
 
 constexpr int kNplanes       = 3;     //number of wire planes
-constexpr int kMaxHits       = 25000; //maximum number of hits;
 constexpr int kMaxTrackHits  = 2000;  //maximum number of hits on a track
 constexpr int kMaxPFPs	     = 1000;  //maximum number of PFPs associated w/neutrino slice
 constexpr int kMaxTrackers   = 15;    //number of trackers passed into fTrackModuleLabel
@@ -455,24 +458,25 @@ namespace sbnd {
     Float_t   taulife;              //electron lifetime
     Char_t     isdata;               //flag, 0=MC 1=data
 
-    // hit information (non-resizeable, 45x kMaxHits = 900k bytes worth)
+    // hit information (resized to the number of hits in the event)
+    size_t MaxHits = 0; ///! how many hits there is currently room for
     Int_t    no_hits;                  //number of hits
-    Short_t  hit_tpc[kMaxHits];        //tpc number
-    Short_t  hit_plane[kMaxHits];      //plane number
-    Short_t  hit_wire[kMaxHits];       //wire number
-    Short_t  hit_channel[kMaxHits];    //channel ID
-    Float_t  hit_peakT[kMaxHits];      //peak time (tick)
-    Float_t  hit_ph[kMaxHits];         //amplitude
-    Float_t  hit_charge[kMaxHits];     //charge (area) in ADC units
-    Float_t  hit_startT[kMaxHits];     //hit start time
-    Float_t  hit_endT[kMaxHits];       //hit end time
-    Float_t  hit_width[kMaxHits];      //shape RMS
-    Short_t  hit_trkid[kMaxHits];      //is this hit associated with a reco track?
-    Int_t    hit_mcid[kMaxHits];       //TrackID of leading MCParticle that created the hit
-    Float_t  hit_frac[kMaxHits];       //fraction of hit energy from leading MCParticle
-    Float_t  hit_energy[kMaxHits];     //true energy
-    Float_t  hit_nelec[kMaxHits];      //true number of electrons (drift attenuated)
-    Float_t  hit_reconelec[kMaxHits];  //reco number of electrons (area * CalConstant)
+    std::vector<Short_t> hit_tpc;           //tpc number
+    std::vector<Short_t> hit_plane;         //plane number
+    std::vector<Short_t> hit_wire;          //wire number
+    std::vector<Short_t> hit_channel;       //channel ID
+    std::vector<Float_t> hit_peakT;         //peak time (tick)
+    std::vector<Float_t> hit_ph;            //amplitude
+    std::vector<Float_t> hit_charge;        //charge (area) in ADC units
+    std::vector<Float_t> hit_startT;        //hit start time
+    std::vector<Float_t> hit_endT;          //hit end time
+    std::vector<Float_t> hit_width;         //shape RMS
+    std::vector<Short_t> hit_trkid;         //is this hit associated with a reco track?
+    std::vector<Int_t>   hit_mcid;          //TrackID of leading MCParticle that created the hit
+    std::vector<Float_t> hit_frac;          //fraction of hit energy from leading MCParticle
+    std::vector<Float_t> hit_energy;        //true energy
+    std::vector<Float_t> hit_nelec;         //true number of electrons (drift attenuated)
+    std::vector<Float_t> hit_reconelec;     //reco number of electrons (area * CalConstant)
 
     // track information
     Char_t kNTracker;
@@ -697,6 +701,9 @@ namespace sbnd {
     /// Resize the data structure for MCNeutrino particles
     void ResizeMCNeutrino(int nNeutrinos);
     
+    /// Resize the data structure for reconstructed hits
+    void ResizeHits(int nHits);
+    
     /// Resize the data strutcure for GEANT particles
     void ResizeGEANT(int nParticles);
     
@@ -716,7 +723,7 @@ namespace sbnd {
     size_t GetNTrackers() const { return TrackData.size(); }
     
     /// Returns the number of hits for which memory is allocated
-    size_t GetMaxHits() const { return kMaxHits; }
+    size_t GetMaxHits() const { return MaxHits; }
     
     /// Returns the number of trackers for which memory is allocated
     size_t GetMaxTrackers() const { return TrackData.capacity(); }
@@ -813,8 +820,22 @@ namespace sbnd {
    * - <b>UseBuffers</b> (default: false): if enabled, memory is allocated for
    *   tree data for all the run; otherwise, it's allocated on each event, used
    *   and freed; use "true" for speed, "false" to save memory
+   * - <b>KeepTrackerBuffers</b> (default: false): without UseBuffers, the
+   *   track and vertex data of each tracker, the largest part of the data, is
+   *   still kept from one event to the next, so that its memory is reused
+   *   instead of being allocated again for each event
    * - <b>SaveAuxDetInfo</b> (default: false): if enabled, auxiliary detector
    *   data will be extracted and included in the tree
+   * - <b>AsyncFill</b> (default: false): if enabled, the tree is filled on a
+   *   background thread from a second data structure, while the next event
+   *   is processed; no other module may write into the TFileService file
+   *   during the event loop
+   * - <b>CompressionThreads</b> (default: 0): with AsyncFill, threads of the
+   *   ROOT implicit multithreading compressing the tree (0: ROOT default)
+   * - <b>ParallelTrackers</b> (default: false): if enabled, the track data of
+   *   the trackers are filled by concurrent tasks, one per tracker, before
+   *   the tree is filled; the truth matching of the tracks, which uses the
+   *   back tracker, is still done one tracker after the other
    */
   class AnalysisTree : public art::EDAnalyzer {
 
@@ -827,6 +848,7 @@ namespace sbnd {
     void analyze(const art::Event& evt);
   //  void beginJob() {}
     void beginSubRun(const art::SubRun& sr);
+    void endJob();
 
   private:
 
@@ -847,6 +869,14 @@ namespace sbnd {
     // run information is much smaller and we still store it statically
     // in the event
     AnalysisTreeDataStruct* fData;
+    /// With AsyncFill, the data of the previous event, which the writer
+    /// thread may still be filling the tree from
+    AnalysisTreeDataStruct* fWriteData = nullptr;
+    /// With KeepTrackerBuffers, the tracker data of the last destroyed data
+    /// structure, for the next one
+    std::vector<AnalysisTreeDataStruct::TrackDataStruct> fSpareTrackData;
+    std::vector<AnalysisTreeDataStruct::VertexDataStruct> fSpareVertexData;
+    sbnd::AsyncTreeWriter fTreeWriter;
 //    AnalysisTreeDataStruct::RunData_t RunData;
     AnalysisTreeDataStruct::SubRunData_t SubRunData;
 
@@ -867,6 +897,10 @@ namespace sbnd {
     std::vector<std::string> fParticleIDModuleLabel;
     std::string fPOTModuleLabel;
     bool fUseBuffer; ///< whether to use a permanent buffer (faster, huge memory)    
+    bool fKeepTrackerBuffers; ///< whether to reuse the tracker data across events without fUseBuffer
+    bool fAsyncFill; ///< whether to fill the tree on a background thread
+    unsigned int fCompressionThreads; ///< ROOT implicit MT threads compressing the tree with fAsyncFill
+    bool fParallelTrackers; ///< whether to fill the track data of the trackers concurrently
     bool fSaveAuxDetInfo; ///< whether to extract and save auxiliary detector data
     bool fSaveCryInfo; ///whether to extract and save CRY particle data
     bool fSaveGenieInfo; ///whether to extract and save Genie information
@@ -902,6 +936,14 @@ namespace sbnd {
       {
         if (!fData) {
           fData = new AnalysisTreeDataStruct(GetNTrackers());
+          if (fSpareTrackData.size() == GetNTrackers()) {
+            // the tracker data keeps its capacity; it is resized and cleared
+            // before it is filled
+            fData->TrackData = std::move(fSpareTrackData);
+            fData->VertexData = std::move(fSpareVertexData);
+          }
+          fSpareTrackData.clear();
+          fSpareVertexData.clear();
           fData->SetBits(AnalysisTreeDataStruct::tdAuxDet, !fSaveAuxDetInfo);
           fData->SetBits(AnalysisTreeDataStruct::tdCry, !fSaveCryInfo);	  
           fData->SetBits(AnalysisTreeDataStruct::tdGenie, !fSaveGenieInfo);
@@ -923,6 +965,7 @@ namespace sbnd {
     void SetAddresses()
       {
         CheckData("SetAddress()"); CheckTree("SetAddress()");
+        if (fTreeWriter.Async()) return; // set by FillTree()
         fData->SetAddresses(fTree, fTrackModuleLabel, fShowerModuleLabel, fVertexModuleLabel, isCosmics, fSaveHierarchyInfo, fSaveShowerHierarchyInfo);
       } // SetAddresses()
     
@@ -931,6 +974,7 @@ namespace sbnd {
     void SetTrackerAddresses(size_t iTracker)
       {
         CheckData("SetTrackerAddresses()"); CheckTree("SetTrackerAddresses()");
+        if (fTreeWriter.Async()) return; // set by FillTree()
         if (iTracker >= fData->GetNTrackers()) {
           throw art::Exception(art::errors::LogicError)
             << "AnalysisTree::SetTrackerAddresses(): no tracker #" << iTracker
@@ -943,6 +987,7 @@ namespace sbnd {
     void SetVerticesAddresses(size_t iTracker)
       {
         CheckData("SetVerticesAddresses()"); CheckTree("SetVerticesAddresses()");
+        if (fTreeWriter.Async()) return; // set by FillTree()
         if (iTracker >= fData->GetNTrackers()) {
           throw art::Exception(art::errors::LogicError)
             << "AnalysisTree::SetVerticesAddresses(): no tracker #" << iTracker
@@ -956,14 +1001,28 @@ namespace sbnd {
     void SetShowerAddresses()
       {
         CheckData("SetShowerAddress()"); CheckTree("SetShowerAddress()");
+        if (fTreeWriter.Async()) return; // set by FillTree()
         fData->ShowerData.SetShowerAddresses(fTree, fShowerModuleLabel, fSaveShowerHierarchyInfo);
       } // SetShowerAddresses()
     
     /// Create the output tree and the data structures, if needed
     void CreateTree(bool bClearData = false);
     
+    /// Fills the tree with the data of this event; with AsyncFill, hands
+    /// the data structure to the writer thread and takes the other one
+    void FillTree();
+    
     /// Destroy the local buffers (existing branches will point to invalid address!)
-    void DestroyData() { if (fData) { delete fData; fData = nullptr; } }
+    void DestroyData()
+      {
+        if (!fData) return;
+        if (fKeepTrackerBuffers) {
+          fSpareTrackData = std::move(fData->TrackData);
+          fSpareVertexData = std::move(fData->VertexData);
+        }
+        delete fData;
+        fData = nullptr;
+      } // DestroyData()
     
     /// Helper function: throws if no data structure is available
     void CheckData(std::string caller) const
@@ -1558,22 +1617,22 @@ void sbnd::AnalysisTreeDataStruct::ClearLocalData() {
 
   // Clear hit info
   no_hits = 0;
-  std::fill(hit_tpc, hit_tpc + sizeof(hit_tpc)/sizeof(hit_tpc[0]), -9999);
-  std::fill(hit_plane, hit_plane + sizeof(hit_plane)/sizeof(hit_plane[0]), -9999);
-  std::fill(hit_wire, hit_wire + sizeof(hit_wire)/sizeof(hit_wire[0]), -9999);
-  std::fill(hit_channel, hit_channel + sizeof(hit_channel)/sizeof(hit_channel[0]), -9999);
-  std::fill(hit_peakT, hit_peakT + sizeof(hit_peakT)/sizeof(hit_peakT[0]), -99999.);
-  std::fill(hit_charge, hit_charge + sizeof(hit_charge)/sizeof(hit_charge[0]), -99999.);
-  std::fill(hit_ph, hit_ph + sizeof(hit_ph)/sizeof(hit_ph[0]), -99999.);
-  std::fill(hit_startT, hit_startT + sizeof(hit_startT)/sizeof(hit_startT[0]), -99999.);
-  std::fill(hit_endT, hit_endT + sizeof(hit_endT)/sizeof(hit_endT[0]), -99999.);
-  std::fill(hit_width, hit_width + sizeof(hit_width)/sizeof(hit_width[0]), -99999.);
-  std::fill(hit_trkid, hit_trkid + sizeof(hit_trkid)/sizeof(hit_trkid[0]), -9999);
-  std::fill(hit_mcid, hit_mcid + sizeof(hit_mcid)/sizeof(hit_mcid[0]), -9);
-  std::fill(hit_frac, hit_frac + sizeof(hit_frac)/sizeof(hit_frac[0]), -9);
-  std::fill(hit_nelec, hit_nelec + sizeof(hit_nelec)/sizeof(hit_nelec[0]), -9999);
-  std::fill(hit_energy, hit_energy + sizeof(hit_energy)/sizeof(hit_energy[0]), -9999);
-  std::fill(hit_reconelec, hit_reconelec + sizeof(hit_reconelec)/sizeof(hit_reconelec[0]), -9999);
+  FillWith(hit_tpc, -9999);
+  FillWith(hit_plane, -9999);
+  FillWith(hit_wire, -9999);
+  FillWith(hit_channel, -9999);
+  FillWith(hit_peakT, -99999.);
+  FillWith(hit_charge, -99999.);
+  FillWith(hit_ph, -99999.);
+  FillWith(hit_startT, -99999.);
+  FillWith(hit_endT, -99999.);
+  FillWith(hit_width, -99999.);
+  FillWith(hit_trkid, -9999);
+  FillWith(hit_mcid, -9);
+  FillWith(hit_frac, -9);
+  FillWith(hit_nelec, -9999);
+  FillWith(hit_energy, -9999);
+  FillWith(hit_reconelec, -9999);
 
   // Clear MCTruth info
   mcevts_truth = 0;
@@ -1757,6 +1816,30 @@ void sbnd::AnalysisTreeDataStruct::ResizeMCNeutrino(int nNeutrinos){
   return;
 } // sbnd::AnalysisTreeDataStruct::ResizeMCNeutrino()
 
+void sbnd::AnalysisTreeDataStruct::ResizeHits(int nHits) {
+
+  // minimum size is 1, so that we always have an address
+  MaxHits = (size_t) std::max(nHits, 1);
+
+  hit_tpc.resize(MaxHits);
+  hit_plane.resize(MaxHits);
+  hit_wire.resize(MaxHits);
+  hit_channel.resize(MaxHits);
+  hit_peakT.resize(MaxHits);
+  hit_ph.resize(MaxHits);
+  hit_charge.resize(MaxHits);
+  hit_startT.resize(MaxHits);
+  hit_endT.resize(MaxHits);
+  hit_width.resize(MaxHits);
+  hit_trkid.resize(MaxHits);
+  hit_mcid.resize(MaxHits);
+  hit_frac.resize(MaxHits);
+  hit_energy.resize(MaxHits);
+  hit_nelec.resize(MaxHits);
+  hit_reconelec.resize(MaxHits);
+
+} // sbnd::AnalysisTreeDataStruct::ResizeHits()
+
 void sbnd::AnalysisTreeDataStruct::ResizeGEANT(int nParticles) {
 
   // minimum size is 1, so that we always have an address
@@ -2117,6 +2200,10 @@ sbnd::AnalysisTree::AnalysisTree(fhicl::ParameterSet const& pset) :
   fPOTModuleLabel           (pset.get< std::string >("POTModuleLabel")                     ),
 
   fUseBuffer                (pset.get< bool >("UseBuffers", false)),
+  fKeepTrackerBuffers       (pset.get< bool >("KeepTrackerBuffers", false)),
+  fAsyncFill                (pset.get< bool >("AsyncFill", false)),
+  fCompressionThreads       (pset.get< unsigned int >("CompressionThreads", 0)),
+  fParallelTrackers         (pset.get< bool >("ParallelTrackers", false)),
   fSaveAuxDetInfo           (pset.get< bool >("SaveAuxDetInfo", false)),
   fSaveCryInfo              (pset.get< bool >("SaveCryInfo", false)),  
   fSaveGenieInfo            (pset.get< bool >("SaveGenieInfo", false)),
@@ -2138,6 +2225,9 @@ sbnd::AnalysisTree::AnalysisTree(fhicl::ParameterSet const& pset) :
   if (fSaveAuxDetInfo == true) fSaveGeantInfo = true;
   mf::LogInfo("AnalysisTree") << "Configuration:"
     << "\n  UseBuffers: " << std::boolalpha << fUseBuffer
+    << "\n  KeepTrackerBuffers: " << std::boolalpha << fKeepTrackerBuffers
+    << "\n  AsyncFill: " << std::boolalpha << fAsyncFill
+    << "\n  ParallelTrackers: " << std::boolalpha << fParallelTrackers
     ;
   if (GetNTrackers() > kMaxTrackers) {
     throw art::Exception(art::errors::Configuration)
@@ -2171,19 +2261,49 @@ sbnd::AnalysisTree::AnalysisTree(fhicl::ParameterSet const& pset) :
 //-------------------------------------------------
 sbnd::AnalysisTree::~AnalysisTree()
 {
+  try { fTreeWriter.Finish(); } catch (...) {}
   DestroyData();
+  delete fWriteData;
 }
 
 void sbnd::AnalysisTree::CreateTree(bool bClearData /* = false */) {
   if (!fTree) {
     art::ServiceHandle<art::TFileService> tfs;
     fTree = tfs->make<TTree>("anatree","analysis tree");
+    fTreeWriter.Setup(fTree, fAsyncFill);
+    if (fAsyncFill) fTreeWriter.EnableImplicitMT(fCompressionThreads);
   }
   CreateData(bClearData);
   SetAddresses();
 } // sbnd::AnalysisTree::CreateTree()
 
 
+void sbnd::AnalysisTree::FillTree() {
+  if (!fTreeWriter.Async()) {
+    fTree->Fill();
+    return;
+  }
+  
+  // the writer is done with the previous event before its data is reused;
+  // the branches are pointed to this event's data right before the fill,
+  // as the data of each event may have been resized
+  fTreeWriter.Wait();
+  std::swap(fData, fWriteData);
+  AnalysisTreeDataStruct* data = fWriteData;
+  bool const cosmics = isCosmics;
+  fTreeWriter.Submit([this, data, cosmics]() {
+    data->SetAddresses(fTree, fTrackModuleLabel, fShowerModuleLabel, fVertexModuleLabel, cosmics, fSaveHierarchyInfo, fSaveShowerHierarchyInfo);
+    fTree->Fill();
+  });
+} // sbnd::AnalysisTree::FillTree()
+
+
+void sbnd::AnalysisTree::endJob()
+{
+  fTreeWriter.Finish();
+}
+
+
 void sbnd::AnalysisTree::beginSubRun(const art::SubRun& sr)
 {
   art::Handle< sumdata::POTSummary > potListHandle;
@@ -2211,7 +2331,7 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
   // * MCFlux information
   art::Handle< std::vector<simb::MCFlux> > mcfluxListHandle;
   std::vector<art::Ptr<simb::MCFlux> > fluxlist;
-  if (evt.getByLabel(fGenieGenModuleLabel,mcfluxListHandle))
+  if (isMC && fSaveGenieInfo && evt.getByLabel(fGenieGenModuleLabel,mcfluxListHandle))
     art::fill_ptr_vector(fluxlist, mcfluxListHandle);
 
   // * TPC SimChannels
@@ -2224,16 +2344,21 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
   if (fSaveAuxDetInfo && fSaveGeantInfo)
     evt.getView(fLArG4ModuleLabel, fAuxDetSimChannels);
 
-  // * hits
+  // * hits (their number is always saved; the pointers are needed for the
+  //   hit and slice information, and for the cosmic check on simulation)
   art::Handle< std::vector<recob::Hit> > hitListHandle;
   std::vector<art::Ptr<recob::Hit> > hitlist;
-  if (evt.getByLabel(fHitsModuleLabel,hitListHandle))
-    art::fill_ptr_vector(hitlist, hitListHandle);
+  size_t NHits = 0; // number of hits
+  if (evt.getByLabel(fHitsModuleLabel,hitListHandle)) {
+    NHits = hitListHandle->size();
+    if (fSaveHitInfo || fSaveSliceInfo || isMC)
+      art::fill_ptr_vector(hitlist, hitListHandle);
+  }
 
   // * MC truth information
   art::Handle< std::vector<simb::MCTruth> > mctruthListHandle;
   std::vector<art::Ptr<simb::MCTruth> > mclist;
-  if (evt.getByLabel(fGenieGenModuleLabel,mctruthListHandle))
+  if (isMC && evt.getByLabel(fGenieGenModuleLabel,mctruthListHandle))
     art::fill_ptr_vector(mclist, mctruthListHandle);
     
   // *MC truth cosmic generator information
@@ -2311,11 +2436,11 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     fData->ResizeCry(nCryPrimaries);
   if (fSaveGeantInfo)    
     fData->ResizeGEANT(nGEANTparticles);
+  fData->ResizeHits(fSaveHitInfo ? NHits : 0);
   fData->ClearLocalData(); // don't bother clearing tracker data yet
   
 //  const size_t Nplanes       = 3; // number of wire planes; pretty much constant...
   const size_t NTrackers = GetNTrackers(); // number of trackers passed into fTrackModuleLabel
-  const size_t NHits     = hitlist.size(); // number of hits
   // make sure there is the data, the tree and everything;
   CreateTree();
 
@@ -2363,9 +2488,17 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
   std::vector< trkPfpMap > trackerPFParticleMaps;
   std::vector< vtxPfpMap > verticesPFParticleMaps;
 
+  // The products are read only for the information which is saved: the
+  // PFParticles for the slices and the hierarchies, the vertices also for
+  // the track information
+  bool const saveTrackHierarchy = (fSaveTrackInfo || fSaveVertexInfo)
+    && std::find(fSaveHierarchyInfo.begin(), fSaveHierarchyInfo.end(), true) != fSaveHierarchyInfo.end();
+  bool const saveShowerHierarchy = fSaveShowerInfo && fSaveShowerHierarchyInfo;
+
   // Create the PFParticle handle and fill it
   art::Handle< std::vector<recob::PFParticle> > pfpHandle;
-  if(evt.getByLabel(fPFParticleModuleLabel,pfpHandle)){
+  if((fSaveSliceInfo || saveTrackHierarchy || saveShowerHierarchy)
+    && evt.getByLabel(fPFParticleModuleLabel,pfpHandle)){
     if(pfpHandle->size()){
       art::fill_ptr_vector(pfplist, pfpHandle);
       lar_pandora::LArPandoraHelper::BuildPFParticleMap(pfplist, pfpmap);
@@ -2379,7 +2512,7 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     verticesPFParticleMaps.push_back(vertexPFParticleMap);
     trackerPFParticleMaps.push_back(trackPFParticleMap);
   
-    if(!fSaveHierarchyInfo[iTracker]) continue;
+    if(!saveTrackHierarchy || !fSaveHierarchyInfo[iTracker]) continue;
 
     // Get and check that the pfparticle handle is valid and exists
     //if(pfpHandle->empty())
@@ -2415,7 +2548,7 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     }
   }// end loop over trackers
 
-  if(fSaveShowerHierarchyInfo){
+  if(saveShowerHierarchy){
     if(pfpHandle->size()) {
       art::FindManyP<recob::Shower> fshw(pfpHandle, evt, fShowerModuleLabel);
       for(unsigned int i = 0; i < pfpHandle->size(); ++i) {
@@ -2436,14 +2569,14 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     }
   } // save maps for SaveShowerHierarchyInfo
 
-  if (evt.getByLabel(fShowerModuleLabel,showerHandle))
+  if (fSaveShowerInfo && evt.getByLabel(fShowerModuleLabel,showerHandle))
     art::fill_ptr_vector(shwlist, showerHandle);
   const size_t NShowers = shwlist.size();
   
   for (unsigned int it = 0; it < NTrackers; ++it){
-    if (evt.getByLabel(fTrackModuleLabel[it],trackListHandle[it]))
+    if (fSaveTrackInfo && evt.getByLabel(fTrackModuleLabel[it],trackListHandle[it]))
       art::fill_ptr_vector(tracklist[it], trackListHandle[it]);
-    if (evt.getByLabel(fVertexModuleLabel[it],vtxListHandle[it]))
+    if ((fSaveVertexInfo || fSaveTrackInfo) && evt.getByLabel(fVertexModuleLabel[it],vtxListHandle[it]))
       art::fill_ptr_vector(vtxlist[it], vtxListHandle[it]);
   }
 
@@ -2471,13 +2604,7 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
   //hit information
   fData->no_hits = (int) NHits; // save this # even if we aren't saving info for *every* hit
   if (fSaveHitInfo){
-    if (NHits > kMaxHits) {
-      // got this error? consider increasing kMaxHits
-      // (or ask for a redesign using vectors)
-      mf::LogError("AnalysisTree:limits") << "event has " << NHits
-        << " hits, only kMaxHits=" << kMaxHits << " stored in tree";
-    }
-    for (size_t i = 0; i < NHits && i < kMaxHits ; ++i){//loop over hits
+    for (size_t i = 0; i < NHits; ++i){//loop over hits
       fData->hit_channel[i] = hitlist[i]->Channel();
       fData->hit_tpc[i]     = hitlist[i]->WireID().TPC;
       fData->hit_plane[i]   = hitlist[i]->WireID().Plane;
@@ -2514,7 +2641,7 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     if (evt.getByLabel(fHitsModuleLabel,hitListHandle)){
       //Find tracks associated with hits
       art::FindManyP<recob::Track> fmtk(hitListHandle,evt,fTrackModuleLabel[0]);
-      for (size_t i = 0; i < NHits && i < kMaxHits ; ++i){//loop over hits
+      for (size_t i = 0; i < NHits; ++i){//loop over hits
         if (fmtk.isValid()){
           if (fmtk.at(i).size()!=0) fData->hit_trkid[i] = fmtk.at(i)[0]->ID();
           else fData->hit_trkid[i] = -1;
@@ -2621,6 +2748,8 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
 
   //track information for multiple trackers
   if (fSaveTrackInfo){
+    // allocate the data of all the trackers and set the tree addresses first;
+    // this creates the tree branches, which is not done concurrently
     for (unsigned int iTracker=0; iTracker < NTrackers; ++iTracker){
       AnalysisTreeDataStruct::TrackDataStruct& TrackerData = fData->GetTrackerData(iTracker);
     
@@ -2655,38 +2784,94 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
           << " " << fVertexModuleLabel[iTracker] << " vertices, only "
           << VertexData.GetMaxVertices() << " stored in tree";
       }
-    
+    }//end loop over track module labels
+
+    // truth information of the track iTrk; the back tracker and the particle
+    // inventory fill their caches on demand and must not be used concurrently
+    auto fillTrackTruth = [&](size_t iTracker, size_t iTrk, art::FindManyP<recob::Hit> const& fmht){
+      AnalysisTreeDataStruct::TrackDataStruct& TrackerData = fData->GetTrackerData(iTracker);
+      //get the hits on each plane
+      std::vector< art::Ptr<recob::Hit> > allHits = fmht.at(iTrk);
+      std::vector< art::Ptr<recob::Hit> > hits[kNplanes];
+
+      for(size_t ah = 0; ah < allHits.size(); ++ah){
+        if (/* allHits[ah]->WireID().Plane >= 0 && */ // always true
+          allHits[ah]->WireID().Plane <  3){
+          hits[allHits[ah]->WireID().Plane].push_back(allHits[ah]);
+        }
+      }
+          
+      for (size_t ipl = 0; ipl < 3; ++ipl){
+        TrackerData.trkidtruth_recoutils_totaltrueenergy[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalTrueEnergy(clockData, hits[ipl]);
+        TrackerData.trkidtruth_recoutils_totalrecocharge[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalRecoCharge(clockData, hits[ipl]);
+        TrackerData.trkidtruth_recoutils_totalrecohits[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, hits[ipl]);
+        double maxe = 0;
+        HitsPurity(clockData, hits[ipl],TrackerData.trkidtruth[iTrk][ipl],TrackerData.trkpurtruth[iTrk][ipl],maxe);
+      //std::cout<<"\n"<<iTracker<<"\t"<<iTrk<<"\t"<<ipl<<"\t"<<trkidtruth[iTracker][iTrk][ipl]<<"\t"<<trkpurtruth[iTracker][iTrk][ipl]<<"\t"<<maxe;
+        if (TrackerData.trkidtruth[iTrk][ipl]>0){
+          const art::Ptr<simb::MCTruth> mc = pi_serv->TrackIdToMCTruth_P(TrackerData.trkidtruth[iTrk][ipl]);
+          TrackerData.trkorigin[iTrk][ipl] = mc->Origin();
+          const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackerData.trkidtruth[iTrk][ipl]);
+          double tote = 0;
+          const std::vector<const sim::IDE*> vide(bt_serv->TrackIdToSimIDEs_Ps(TrackerData.trkidtruth[iTrk][ipl]));
+          for (auto ide: vide) {
+             tote += ide->energy;
+             TrackerData.trksimIDEenergytruth[iTrk][ipl] = ide->energy;
+             TrackerData.trksimIDExtruth[iTrk][ipl] = ide->x;
+             TrackerData.trksimIDEytruth[iTrk][ipl] = ide->y;
+             TrackerData.trksimIDEztruth[iTrk][ipl] = ide->z;
+          }
+          TrackerData.trkpdgtruth[iTrk][ipl] = particle->PdgCode();
+          TrackerData.trkefftruth[iTrk][ipl] = maxe/(tote/kNplanes); //tote include both induction and collection energies
+        //std::cout<<"\n"<<trkpdgtruth[iTracker][iTrk][ipl]<<"\t"<<trkefftruth[iTracker][iTrk][ipl];
+        }
+      }
+    }; // fillTrackTruth
+
+    // fills the track data of one tracker, writing only into its TrackDataStruct;
+    // the truth information is added only withTruth
+    auto fillTracker = [&](size_t iTracker, bool withTruth){
+      AnalysisTreeDataStruct::TrackDataStruct& TrackerData = fData->GetTrackerData(iTracker);
+      AnalysisTreeDataStruct::VertexDataStruct const& VertexData = fData->GetVertexData(iTracker);
+      size_t NTracks = tracklist[iTracker].size();
+      if (NTracks == 0) return;
+
+      // the associations are looked up once for all the tracks of the tracker
+      std::optional<art::FindManyP<anab::CosmicTag>> fmct, fmbfm;
+      if (fCosmicTaggerAssocLabel.size() > iTracker)
+        fmct.emplace(trackListHandle[iTracker],evt,fCosmicTaggerAssocLabel[iTracker]);
+      //Unlike CosmicTagger, Flash match doesn't assign a cosmic tag for every track. For those tracks, AnalysisTree initializes them with -9999 or -99999
+      if (fFlashMatchAssocLabel.size() > iTracker)
+        fmbfm.emplace(trackListHandle[iTracker],evt,fFlashMatchAssocLabel[iTracker]);
+      art::FindMany<anab::ParticleID> fmpid(trackListHandle[iTracker], evt, fParticleIDModuleLabel[iTracker]);
+      art::FindMany<anab::Calorimetry> fmcal(trackListHandle[iTracker], evt, fCalorimetryModuleLabel[iTracker]);
+      std::optional<art::FindManyP<recob::Hit>> fmht;
+      if (withTruth) fmht.emplace(trackListHandle[iTracker], evt, fTrackModuleLabel[iTracker]);
+      trkPfpMap const& trackPFParticleMap = trackerPFParticleMaps[iTracker];
+
       //call the track momentum algorithm that gives you momentum based on track range
       trkf::TrackMomentumCalculator trkm;
 
       for(size_t iTrk=0; iTrk < NTracks; ++iTrk){//loop over tracks
         //Cosmic Tagger information
-        if (fCosmicTaggerAssocLabel.size() > iTracker) {
-          art::FindManyP<anab::CosmicTag> fmct(trackListHandle[iTracker],evt,fCosmicTaggerAssocLabel[iTracker]);
-          if (fmct.isValid()){          
-            TrackerData.trkncosmictags_tagger[iTrk]     = fmct.at(iTrk).size();
-            if (fmct.at(iTrk).size()>0){
-              if(fmct.at(iTrk).size()>1)
-                std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fCosmicTaggerAssocLabel[iTracker];
-              TrackerData.trkcosmicscore_tagger[iTrk] = fmct.at(iTrk).at(0)->CosmicScore();
-              TrackerData.trkcosmictype_tagger[iTrk] = fmct.at(iTrk).at(0)->CosmicType();
-            }
+        if (fmct && fmct->isValid()){
+          TrackerData.trkncosmictags_tagger[iTrk]     = fmct->at(iTrk).size();
+          if (fmct->at(iTrk).size()>0){
+            if(fmct->at(iTrk).size()>1)
+              std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fCosmicTaggerAssocLabel[iTracker];
+            TrackerData.trkcosmicscore_tagger[iTrk] = fmct->at(iTrk).at(0)->CosmicScore();
+            TrackerData.trkcosmictype_tagger[iTrk] = fmct->at(iTrk).at(0)->CosmicType();
           }
         } // if we have matching fCosmicTaggerAssocLabel
 
         //Flash match compatibility information
-        if (fFlashMatchAssocLabel.size() > iTracker) {
-          //Unlike CosmicTagger, Flash match doesn't assign a cosmic tag for every track. For those tracks, AnalysisTree initializes them with -9999 or -99999
-          art::FindManyP<anab::CosmicTag> fmbfm(trackListHandle[iTracker],evt,fFlashMatchAssocLabel[iTracker]);
-          if (fmbfm.isValid()){  
-            TrackerData.trkncosmictags_flashmatch[iTrk] = fmbfm.at(iTrk).size();
-            if (fmbfm.at(iTrk).size()>0){
-              if(fmbfm.at(iTrk).size()>1) 
-                std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fFlashMatchAssocLabel[iTracker];
-            TrackerData.trkcosmicscore_flashmatch[iTrk] = fmbfm.at(iTrk).at(0)->CosmicScore();
-                TrackerData.trkcosmictype_flashmatch[iTrk] = fmbfm.at(iTrk).at(0)->CosmicType();
-        //std::cout<<"\n"<<evt.event()<<"\t"<<iTrk<<"\t"<<fmbfm.at(iTrk).at(0)->CosmicScore()<<"\t"<<fmbfm.at(iTrk).at(0)->CosmicType();
-            }
+        if (fmbfm && fmbfm->isValid()){
+          TrackerData.trkncosmictags_flashmatch[iTrk] = fmbfm->at(iTrk).size();
+          if (fmbfm->at(iTrk).size()>0){
+            if(fmbfm->at(iTrk).size()>1)
+              std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fFlashMatchAssocLabel[iTracker];
+            TrackerData.trkcosmicscore_flashmatch[iTrk] = fmbfm->at(iTrk).at(0)->CosmicScore();
+            TrackerData.trkcosmictype_flashmatch[iTrk] = fmbfm->at(iTrk).at(0)->CosmicType();
           }
         } // if we have matching fFlashMatchAssocLabel
         
@@ -2787,7 +2972,6 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
         }
         
         // find particle ID info
-        art::FindMany<anab::ParticleID> fmpid(trackListHandle[iTracker], evt, fParticleIDModuleLabel[iTracker]);
         if(fmpid.isValid()) {
 	  std::vector<const anab::ParticleID*> pids = fmpid.at(iTrk);
 	  if (pids.size() == 0){
@@ -2872,7 +3056,6 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
 	  }
         } // fmpid.isValid()
       
-        art::FindMany<anab::Calorimetry> fmcal(trackListHandle[iTracker], evt, fCalorimetryModuleLabel[iTracker]);
         if (fmcal.isValid()){
           std::vector<const anab::Calorimetry*> calos = fmcal.at(iTrk);
           if (calos.size() > TrackerData.GetMaxPlanesPerTrack(iTrk)) {
@@ -2927,48 +3110,10 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
         } // if has calorimetry info
 
         //track truth information
-        if (isMC){
-          //get the hits on each plane
-          art::FindManyP<recob::Hit>      fmht(trackListHandle[iTracker], evt, fTrackModuleLabel[iTracker]);
-          std::vector< art::Ptr<recob::Hit> > allHits = fmht.at(iTrk);
-          std::vector< art::Ptr<recob::Hit> > hits[kNplanes];
-
-          for(size_t ah = 0; ah < allHits.size(); ++ah){
-            if (/* allHits[ah]->WireID().Plane >= 0 && */ // always true
-              allHits[ah]->WireID().Plane <  3){
-              hits[allHits[ah]->WireID().Plane].push_back(allHits[ah]);
-            }
-          }
-          
-          for (size_t ipl = 0; ipl < 3; ++ipl){
-            TrackerData.trkidtruth_recoutils_totaltrueenergy[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalTrueEnergy(clockData, hits[ipl]);
-            TrackerData.trkidtruth_recoutils_totalrecocharge[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalRecoCharge(clockData, hits[ipl]);
-            TrackerData.trkidtruth_recoutils_totalrecohits[iTrk][ipl] = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, hits[ipl]);
-            double maxe = 0;
-            HitsPurity(clockData, hits[ipl],TrackerData.trkidtruth[iTrk][ipl],TrackerData.trkpurtruth[iTrk][ipl],maxe);
-          //std::cout<<"\n"<<iTracker<<"\t"<<iTrk<<"\t"<<ipl<<"\t"<<trkidtruth[iTracker][iTrk][ipl]<<"\t"<<trkpurtruth[iTracker][iTrk][ipl]<<"\t"<<maxe;
-            if (TrackerData.trkidtruth[iTrk][ipl]>0){
-              const art::Ptr<simb::MCTruth> mc = pi_serv->TrackIdToMCTruth_P(TrackerData.trkidtruth[iTrk][ipl]);
-              TrackerData.trkorigin[iTrk][ipl] = mc->Origin();
-              const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackerData.trkidtruth[iTrk][ipl]);
-              double tote = 0;
-              const std::vector<const sim::IDE*> vide(bt_serv->TrackIdToSimIDEs_Ps(TrackerData.trkidtruth[iTrk][ipl]));
-              for (auto ide: vide) {
-                 tote += ide->energy;
-                 TrackerData.trksimIDEenergytruth[iTrk][ipl] = ide->energy;
-                 TrackerData.trksimIDExtruth[iTrk][ipl] = ide->x;
-                 TrackerData.trksimIDEytruth[iTrk][ipl] = ide->y;
-                 TrackerData.trksimIDEztruth[iTrk][ipl] = ide->z;
-              }
-              TrackerData.trkpdgtruth[iTrk][ipl] = particle->PdgCode();
-              TrackerData.trkefftruth[iTrk][ipl] = maxe/(tote/kNplanes); //tote include both induction and collection energies
-            //std::cout<<"\n"<<trkpdgtruth[iTracker][iTrk][ipl]<<"\t"<<trkefftruth[iTracker][iTrk][ipl];
-            }
-          }
-        }//end if (isMC)
+        if (fmht) fillTrackTruth(iTracker, iTrk, *fmht);
+
         // If saving the hierarchy info
         if(fSaveHierarchyInfo[iTracker]){
-          trkPfpMap trackPFParticleMap = trackerPFParticleMaps[iTracker];
           trkPfpMapIt it;
           // Check there is a map entry for this vertex
           it = trackPFParticleMap.find(ptrack);
@@ -2983,7 +3128,22 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
           TrackerData.trkparentpfpid[iTrk] = tempParticle->Parent();
         } // end save hierarchy info
       }//end loop over track
-    }//end loop over track module labels
+    }; // fillTracker
+
+    if (fParallelTrackers){
+      // each tracker in its own task, then the truth of all of them here
+      tbb::parallel_for(size_t(0), size_t(NTrackers), [&](size_t iTracker){ fillTracker(iTracker, false); });
+      if (isMC){
+        for (unsigned int iTracker=0; iTracker < NTrackers; ++iTracker){
+          if (tracklist[iTracker].empty()) continue;
+          art::FindManyP<recob::Hit> fmht(trackListHandle[iTracker], evt, fTrackModuleLabel[iTracker]);
+          for (size_t iTrk=0; iTrk < tracklist[iTracker].size(); ++iTrk) fillTrackTruth(iTracker, iTrk, fmht);
+        }
+      }
+    }
+    else {
+      for (unsigned int iTracker=0; iTracker < NTrackers; ++iTracker) fillTracker(iTracker, isMC);
+    }
   }// end (fSaveTrackInfo) 
 
 
@@ -3519,7 +3679,6 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
   }//if (isMC)
 
   fData->taulife = detprop.ElectronLifetime();
-  fTree->Fill();
   
   if (mf::isDebugEnabled()) {
     // use mf::LogDebug instead of MF_LOG_DEBUG because we reuse it in many lines;
@@ -3555,8 +3714,11 @@ void sbnd::AnalysisTree::analyze(const art::Event& evt)
     } // for trackers
   } // if logging enabled
   
+  FillTree();
+  
   // if we don't use a permanent buffer (which can be huge),
   // delete the current buffer, and we'll create a new one on the next event
+  // (with AsyncFill, this is the buffer of the previous event, already written)
   if (!fUseBuffer) {
     MF_LOG_DEBUG("AnalysisTreeStructure") << "Freeing the tree data structure";
     DestroyData();
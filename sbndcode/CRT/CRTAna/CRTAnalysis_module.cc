@@ -38,6 +38,8 @@
 #include "sbndcode/CRT/CRTBackTracker/CRTBackTrackerAlg.h"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
 
+#include <unordered_map>
+
 namespace sbnd::crt {
   class CRTAnalysis;
 }
@@ -74,19 +76,29 @@ public:
   void AnalyseCRTTracks(const art::Event &e, const std::vector<art::Ptr<CRTTrack>> &CRTTrackVec);
 
   void AnalyseTPCMatching(const art::Event &e, const art::Handle<std::vector<recob::Track>> &TPCTrackHandle,
-                          const art::Handle<std::vector<CRTSpacePoint>> &CRTSpacePointModuleLabel, const art::Handle<std::vector<recob::PFParticle>> &PFPHandle,
-                          const std::map<CRTBackTrackerAlg::Category, bool> &spacePointRecoStatusMap, const std::map<int, std::pair<bool, bool>> &trackRecoStatusMap);
+                          const art::Handle<std::vector<CRTSpacePoint>> &CRTSpacePointModuleLabel, const art::Handle<std::vector<recob::PFParticle>> &PFPHandle);
+
+  CRTBackTrackerAlg::TruthMatchMetrics TruthMatching(const art::Event &e, const art::Ptr<CRTStripHit> &hit);
+
+  const CRTBackTrackerAlg::TruthMatchMetrics& TruthMatching(const art::Event &e, const art::Ptr<CRTCluster> &cluster);
+
+  const CRTBackTrackerAlg::TruthMatchMetrics& TruthMatching(const art::Event &e, const art::Ptr<CRTTrack> &track);
 
 private:
 
-  CRTGeoAlg fCRTGeoAlg;
+  std::shared_ptr<const CRTGeoAlg> fCRTGeoAlg;
   TPCGeoAlg fTPCGeoAlg;
   CRTBackTrackerAlg fCRTBackTrackerAlg;
 
   std::string fMCParticleModuleLabel, fSimDepositModuleLabel, fFEBDataModuleLabel, fCRTStripHitModuleLabel,
     fCRTClusterModuleLabel, fCRTSpacePointModuleLabel, fCRTTrackModuleLabel, fTPCTrackModuleLabel,
     fCRTSpacePointMatchingModuleLabel, fCRTTrackMatchingModuleLabel, fPFPModuleLabel;
-  bool fDebug;
+  bool fDebug, fTruthMatch;
+
+  // Per event truth matching results, keyed by product index, so that each
+  // cluster and track is only backtracked once however many blocks use it
+  std::unordered_map<size_t, CRTBackTrackerAlg::TruthMatchMetrics> fClusterTruthCache, fTrackTruthCache;
+  const CRTBackTrackerAlg::TruthMatchMetrics fNoTruthMatch{-999999, -999999., -999999., -999999., -999999., CRTBackTrackerAlg::TrueDeposit()};
 
   TTree* fTree;
 
@@ -274,7 +286,7 @@ private:
 
 sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
   : EDAnalyzer{p}
-  , fCRTGeoAlg(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet()))
+  , fCRTGeoAlg(CRTGeoAlg::Shared(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet())))
   , fCRTBackTrackerAlg(p.get<fhicl::ParameterSet>("CRTBackTrackerAlg", fhicl::ParameterSet()))
   {
     fMCParticleModuleLabel            = p.get<std::string>("MCParticleModuleLabel", "largeant");
@@ -289,6 +301,7 @@ sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
     fCRTTrackMatchingModuleLabel      = p.get<std::string>("CRTTrackMatchingModuleLabel", "crttrackmatchingSCE");
     fPFPModuleLabel                   = p.get<std::string>("PFPModuleLabel", "pandora");
     fDebug                            = p.get<bool>("Debug", false);
+    fTruthMatch                       = p.get<bool>("TruthMatch", true);
 
     art::ServiceHandle<art::TFileService> fs;
 
@@ -474,7 +487,7 @@ sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
 
     if(fDebug)
       {
-        for(auto const &[name, tagger] : fCRTGeoAlg.GetTaggers())
+        for(auto const &[name, tagger] : fCRTGeoAlg->GetTaggers())
           {
             std::cout << "Tagger:  " << tagger.name << '\n'
                       << "X - Min: " << tagger.minX << " Max: " << tagger.maxX << '\n'
@@ -484,7 +497,7 @@ sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
 
         std::cout << std::endl;
 
-        for(auto const &[name, module] : fCRTGeoAlg.GetModules())
+        for(auto const &[name, module] : fCRTGeoAlg->GetModules())
           {
             std::cout << "Module:  " << module.name << " (" << module.taggerName << ")" << '\n';
             if(module.minos)
@@ -497,7 +510,7 @@ sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
 
         std::cout << std::endl;
 
-        for(auto const &[name, sipm] : fCRTGeoAlg.GetSiPMs())
+        for(auto const &[name, sipm] : fCRTGeoAlg->GetSiPMs())
           {
             std::cout << "SiPM:  " << sipm.channel << " (" << sipm.channel/32 << " - " << sipm.channel%32 << ")" << '\n'
                       << "x: " << sipm.x << " y: " << sipm.y << " z: " << sipm.z << std::endl;
@@ -507,9 +520,15 @@ sbnd::crt::CRTAnalysis::CRTAnalysis(fhicl::ParameterSet const& p)
 
 void sbnd::crt::CRTAnalysis::analyze(art::Event const& e)
 {
-  fCRTBackTrackerAlg.SetupMaps(e);
-  fCRTBackTrackerAlg.RunSpacePointRecoStatusChecks(e);
-  fCRTBackTrackerAlg.RunTrackRecoStatusChecks(e);
+  fClusterTruthCache.clear();
+  fTrackTruthCache.clear();
+
+  if(fTruthMatch)
+    {
+      fCRTBackTrackerAlg.SetupMaps(e);
+      fCRTBackTrackerAlg.RunSpacePointRecoStatusChecks(e);
+      fCRTBackTrackerAlg.RunTrackRecoStatusChecks(e);
+    }
 
   _run = e.id().run();
   _subrun = e.id().subRun();
@@ -518,27 +537,33 @@ void sbnd::crt::CRTAnalysis::analyze(art::Event const& e)
   if(fDebug) std::cout << "This is event " << _run << "-" << _subrun << "-" << _event << std::endl;
 
   // Get MCParticles
-  art::Handle<std::vector<simb::MCParticle>> MCParticleHandle;
-  e.getByLabel(fMCParticleModuleLabel, MCParticleHandle);
-  if(!MCParticleHandle.isValid()){
-    std::cout << "MCParticle product " << fMCParticleModuleLabel << " not found..." << std::endl;
-    throw std::exception();
-  }
   std::vector<art::Ptr<simb::MCParticle>> MCParticleVec;
-  art::fill_ptr_vector(MCParticleVec, MCParticleHandle);
+  if(fTruthMatch)
+    {
+      art::Handle<std::vector<simb::MCParticle>> MCParticleHandle;
+      e.getByLabel(fMCParticleModuleLabel, MCParticleHandle);
+      if(!MCParticleHandle.isValid()){
+        std::cout << "MCParticle product " << fMCParticleModuleLabel << " not found..." << std::endl;
+        throw std::exception();
+      }
+      art::fill_ptr_vector(MCParticleVec, MCParticleHandle);
+    }
 
   // Fill MCParticle variables
   AnalyseMCParticles(MCParticleVec);
 
   // Get SimDeposits
-  art::Handle<std::vector<sim::AuxDetSimChannel>> SimDepositHandle;
-  e.getByLabel(fSimDepositModuleLabel, SimDepositHandle);
-  if(!SimDepositHandle.isValid()){
-    std::cout << "SimDeposit product " << fSimDepositModuleLabel << " not found..." << std::endl;
-    throw std::exception();
-  }
   std::vector<art::Ptr<sim::AuxDetSimChannel>> SimDepositVec;
-  art::fill_ptr_vector(SimDepositVec, SimDepositHandle);
+  if(fTruthMatch)
+    {
+      art::Handle<std::vector<sim::AuxDetSimChannel>> SimDepositHandle;
+      e.getByLabel(fSimDepositModuleLabel, SimDepositHandle);
+      if(!SimDepositHandle.isValid()){
+        std::cout << "SimDeposit product " << fSimDepositModuleLabel << " not found..." << std::endl;
+        throw std::exception();
+      }
+      art::fill_ptr_vector(SimDepositVec, SimDepositHandle);
+    }
 
   // Fill SimDeposit variables
   AnalyseSimDeposits(SimDepositVec);
@@ -586,7 +611,9 @@ void sbnd::crt::CRTAnalysis::analyze(art::Event const& e)
   AnalyseCRTClusters(e, CRTClusterVec, clustersToSpacePoints);
 
   // Get Map of TrueDeposits per tagger from BackTracker
-  std::map<CRTBackTrackerAlg::Category, bool> spacePointRecoStatusMap = fCRTBackTrackerAlg.GetSpacePointRecoStatusMap();
+  const std::map<CRTBackTrackerAlg::Category, bool> noSpacePointRecoStatus;
+  const std::map<CRTBackTrackerAlg::Category, bool> &spacePointRecoStatusMap = fTruthMatch ?
+    fCRTBackTrackerAlg.GetSpacePointRecoStatusMap() : noSpacePointRecoStatus;
 
   // Fill TrueDeposit variables
   AnalyseTrueDepositsPerTagger(spacePointRecoStatusMap);
@@ -605,7 +632,9 @@ void sbnd::crt::CRTAnalysis::analyze(art::Event const& e)
   AnalyseCRTTracks(e, CRTTrackVec);
 
   // Get Map of TrueDeposits from BackTracker
-  std::map<int, std::pair<bool, bool>> trackRecoStatusMap = fCRTBackTrackerAlg.GetTrackRecoStatusMap();
+  const std::map<int, std::pair<bool, bool>> noTrackRecoStatus;
+  const std::map<int, std::pair<bool, bool>> &trackRecoStatusMap = fTruthMatch ?
+    fCRTBackTrackerAlg.GetTrackRecoStatusMap() : noTrackRecoStatus;
 
   // Fill TrueDeposit variables
   AnalyseTrueDeposits(trackRecoStatusMap);
@@ -635,7 +664,7 @@ void sbnd::crt::CRTAnalysis::analyze(art::Event const& e)
   }
 
   // Fill TPC matching variables
-  AnalyseTPCMatching(e, TPCTrackHandle, CRTSpacePointHandle, PFPHandle, spacePointRecoStatusMap, trackRecoStatusMap);
+  AnalyseTPCMatching(e, TPCTrackHandle, CRTSpacePointHandle, PFPHandle);
 
   // Fill the Tree
   fTree->Fill();
@@ -812,9 +841,9 @@ void sbnd::crt::CRTAnalysis::AnalyseCRTStripHits(const art::Event &e, const std:
       _sh_saturated1[i] = hit->Saturated1();
       _sh_saturated2[i] = hit->Saturated2();
 
-      const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(e, hit);
-      const std::vector<double> localpos = fCRTGeoAlg.StripWorldToLocalPos(hit->Channel(), truthMatch.deposit.x, truthMatch.deposit.y, truthMatch.deposit.z);
-      const double width = fCRTGeoAlg.GetStrip(hit->Channel()).width;
+      const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = TruthMatching(e, hit);
+      const std::vector<double> localpos = fCRTGeoAlg->StripWorldToLocalPos(hit->Channel(), truthMatch.deposit.x, truthMatch.deposit.y, truthMatch.deposit.z);
+      const double width = fCRTGeoAlg->GetStrip(hit->Channel()).width;
 
       _sh_truth_trackid[i]      = truthMatch.trackid;
       _sh_truth_completeness[i] = truthMatch.completeness;
@@ -874,7 +903,7 @@ void sbnd::crt::CRTAnalysis::AnalyseCRTClusters(const art::Event &e, const std::
       _cl_tagger[i]      = cluster->Tagger();
       _cl_composition[i] = cluster->Composition();
 
-      const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(e, cluster);
+      const CRTBackTrackerAlg::TruthMatchMetrics &truthMatch = TruthMatching(e, cluster);
       _cl_truth_trackid[i]          = truthMatch.trackid;
       _cl_truth_completeness[i]     = truthMatch.completeness;
       _cl_truth_purity[i]           = truthMatch.purity;
@@ -1060,7 +1089,7 @@ void sbnd::crt::CRTAnalysis::AnalyseCRTTracks(const art::Event &e, const std::ve
       _tr_triple[i]  = track->Triple();
       _tr_taggers[i] = track->Taggers();
 
-      const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(e, track);
+      const CRTBackTrackerAlg::TruthMatchMetrics &truthMatch = TruthMatching(e, track);
       _tr_truth_trackid[i]          = truthMatch.trackid;
       _tr_truth_completeness[i]     = truthMatch.completeness;
       _tr_truth_purity[i]           = truthMatch.purity;
@@ -1094,8 +1123,7 @@ void sbnd::crt::CRTAnalysis::AnalyseCRTTracks(const art::Event &e, const std::ve
 }
 
 void sbnd::crt::CRTAnalysis::AnalyseTPCMatching(const art::Event &e, const art::Handle<std::vector<recob::Track>> &TPCTrackHandle,
-                                                const art::Handle<std::vector<CRTSpacePoint>> &CRTSpacePointHandle, const art::Handle<std::vector<recob::PFParticle>> &PFPHandle,
-                                                const std::map<CRTBackTrackerAlg::Category, bool> &spacePointRecoStatusMap, const std::map<int, std::pair<bool, bool>> &trackRecoStatusMap)
+                                                const art::Handle<std::vector<CRTSpacePoint>> &CRTSpacePointHandle, const art::Handle<std::vector<recob::PFParticle>> &PFPHandle)
 {
   std::vector<art::Ptr<recob::Track>> TPCTrackVec;
   art::fill_ptr_vector(TPCTrackVec, TPCTrackHandle);
@@ -1171,26 +1199,24 @@ void sbnd::crt::CRTAnalysis::AnalyseTPCMatching(const art::Event &e, const art::
       else
         _tpc_track_score[nActualTracks] = -std::numeric_limits<double>::max();
 
-      const std::vector<art::Ptr<recob::Hit>> trackHits = tracksToHits.at(track.key());
-      const int trackid = fCRTBackTrackerAlg.RollUpID(TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData,trackHits,true));
+      int trackid = -999999, pdg = -999999;
+      double energy = -999999., time = -999999.;
 
-      _tpc_truth_trackid[nActualTracks] = trackid;
+      if(fTruthMatch)
+        {
+          const std::vector<art::Ptr<recob::Hit>> trackHits = tracksToHits.at(track.key());
+          trackid = fCRTBackTrackerAlg.RollUpID(TruthMatchUtils::TrueParticleIDFromTotalRecoHits(clockData,trackHits,true));
+          fCRTBackTrackerAlg.TrueParticlePDGEnergyTime(trackid, pdg, energy, time);
+        }
 
-      int pdg;
-      double energy, time;
-      fCRTBackTrackerAlg.TrueParticlePDGEnergyTime(trackid, pdg, energy, time);
+      _tpc_truth_trackid[nActualTracks] = trackid;
 
       _tpc_truth_pdg[nActualTracks]    = pdg;
       _tpc_truth_energy[nActualTracks] = energy;
       _tpc_truth_time[nActualTracks]   = time;
 
-      bool sp_matchable = false, tr_matchable = false;
-
-      for(auto const& [ category, status ] : spacePointRecoStatusMap)
-        sp_matchable |= (category.trackid == trackid && status);
-
-      tr_matchable |= trackRecoStatusMap.count(trackid) != 0;
-      if(tr_matchable) tr_matchable = trackRecoStatusMap.at(trackid).first;
+      const bool sp_matchable = fTruthMatch && fCRTBackTrackerAlg.SpacePointReconstructed(trackid);
+      const bool tr_matchable = fTruthMatch && fCRTBackTrackerAlg.TrackReconstructed(trackid);
 
       _tpc_sp_matchable[nActualTracks] = sp_matchable;
       _tpc_tr_matchable[nActualTracks] = tr_matchable;
@@ -1201,7 +1227,7 @@ void sbnd::crt::CRTAnalysis::AnalyseTPCMatching(const art::Event &e, const art::
         {
           const anab::T0 spMatch                                = tracksToSPMatches.data(track.key()).ref();
           const art::Ptr<CRTCluster> cluster                    = spsToClusters.at(spacepoint.key());
-          const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(e, cluster);
+          const CRTBackTrackerAlg::TruthMatchMetrics &truthMatch = TruthMatching(e, cluster);
 
           _tpc_sp_matched[nActualTracks]    = true;
           _tpc_sp_good_match[nActualTracks] = truthMatch.trackid == trackid;
@@ -1221,7 +1247,7 @@ void sbnd::crt::CRTAnalysis::AnalyseTPCMatching(const art::Event &e, const art::
       if(crttrack.isNonnull())
         {
           const anab::T0 trackMatch                             = tracksToTrackMatches.data(track.key()).ref();
-          const CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(e, crttrack);
+          const CRTBackTrackerAlg::TruthMatchMetrics &truthMatch = TruthMatching(e, crttrack);
 
           _tpc_tr_matched[nActualTracks]    = true;
           _tpc_tr_good_match[nActualTracks] = truthMatch.trackid == trackid;
@@ -1266,4 +1292,38 @@ void sbnd::crt::CRTAnalysis::AnalyseTPCMatching(const art::Event &e, const art::
   _tpc_tr_score.resize(nActualTracks);
 }
 
+sbnd::crt::CRTBackTrackerAlg::TruthMatchMetrics sbnd::crt::CRTAnalysis::TruthMatching(const art::Event &e, const art::Ptr<CRTStripHit> &hit)
+{
+  if(!fTruthMatch)
+    return fNoTruthMatch;
+
+  return fCRTBackTrackerAlg.TruthMatching(e, hit);
+}
+
+const sbnd::crt::CRTBackTrackerAlg::TruthMatchMetrics& sbnd::crt::CRTAnalysis::TruthMatching(const art::Event &e, const art::Ptr<CRTCluster> &cluster)
+{
+  if(!fTruthMatch)
+    return fNoTruthMatch;
+
+  auto it = fClusterTruthCache.find(cluster.key());
+
+  if(it == fClusterTruthCache.end())
+    it = fClusterTruthCache.emplace(cluster.key(), fCRTBackTrackerAlg.TruthMatching(e, cluster)).first;
+
+  return it->second;
+}
+
+const sbnd::crt::CRTBackTrackerAlg::TruthMatchMetrics& sbnd::crt::CRTAnalysis::TruthMatching(const art::Event &e, const art::Ptr<CRTTrack> &track)
+{
+  if(!fTruthMatch)
+    return fNoTruthMatch;
+
+  auto it = fTrackTruthCache.find(track.key());
+
+  if(it == fTrackTruthCache.end())
+    it = fTrackTruthCache.emplace(track.key(), fCRTBackTrackerAlg.TruthMatching(e, track)).first;
+
+  return it->second;
+}
+
 DEFINE_ART_MODULE(sbnd::crt::CRTAnalysis)
@@ -26,17 +26,48 @@ namespace sbnd::crt {
 
   void CRTBackTrackerAlg::SetupMaps(const art::Event &event)
   {
-    fTrueDepositsPerTaggerMap.clear();
+    fEventID = art::EventID();
+
+    PrepareEvent(event);
+    SetupStripHits(event);
+  }
+
+  void CRTBackTrackerAlg::PrepareEvent(const art::Event &event)
+  {
+    if(fBuiltStages != 0 && event.id() == fEventID)
+      return;
+
+    fEventID     = event.id();
+    fBuiltStages = 0;
+
+    fTrueDepositsPerTagger.clear();
     fTrueDepositsMap.clear();
     fTrueTrackInfosMap.clear();
     fTrackIDSpacePointRecoMap.clear();
     fTrackIDTrackRecoMap.clear();
-    fMCPIDEsEnergyPerTaggerMap.clear();
-    fMCPIDEsEnergyMap.clear();
+    fCategorySums.clear();
+    fCoreCategorySums.clear();
+    fTrackIDSums.clear();
+    fDepositCategories.clear();
     fMCPStripHitsMap.clear();
     fTrackIDMotherMap.clear();
+    fRecoStatus.clear();
     fStripHitMCPMap.clear();
 
+    fFEBDataToIDEs.reset();
+    fStripHitToFEBData.reset();
+    fClusterToStripHits.reset();
+    fSpacePointToCluster.reset();
+    fTrackToSpacePoints.reset();
+  }
+
+  void CRTBackTrackerAlg::SetupAncestry(const art::Event &event)
+  {
+    if(fBuiltStages & kAncestryStage)
+      return;
+
+    fBuiltStages |= kAncestryStage;
+
     art::Handle<std::vector<sim::ParticleAncestryMap>> droppedTrackIDMapVecHandle;
     event.getByLabel(fSimModuleLabel, droppedTrackIDMapVecHandle);
 
@@ -65,131 +96,96 @@ namespace sbnd::crt {
 	      fTrackIDMotherMap[id] = mother;
 	  }
       }
+  }
 
-    art::Handle<std::vector<sim::AuxDetIDE>> ideHandle;
-    event.getByLabel(fFEBDataModuleLabel, ideHandle);
-    std::vector<art::Ptr<sim::AuxDetIDE>> ideVec;
-    art::fill_ptr_vector(ideVec, ideHandle);
-
-    std::set<Category> depositCategories;
-    std::set<int>      depositTrackIDs;
+  void CRTBackTrackerAlg::SetupDeposits(const art::Event &event)
+  {
+    if(fBuiltStages & kDepositsStage)
+      return;
 
-    std::map<Category, double> categoryToEnergyMap, categoryToXMap, categoryToYMap,
-      categoryToZMap, categoryToTimeMap;
-    std::map<Category, uint> categoryToNIDEsMap;
+    SetupAncestry(event);
 
-    std::map<int, double> idToEnergyMap, idToXMap, idToYMap,
-      idToZMap, idToTimeMap;
-    std::map<int, uint> idToNIDEsMap;
+    fBuiltStages |= kDepositsStage;
 
-    std::map<Category, double> coreCategoryToEnergyMap, coreCategoryToXMap, coreCategoryToYMap,
-      coreCategoryToZMap, coreCategoryToTimeMap;
-    std::map<Category, uint> coreCategoryToNIDEsMap;
+    art::Handle<std::vector<sim::AuxDetIDE>> ideHandle;
+    event.getByLabel(fFEBDataModuleLabel, ideHandle);
 
-    for(auto const ide : ideVec)
+    for(auto const& ide : *ideHandle)
       {
-        const double x = (ide->entryX + ide->exitX) / 2.;
-        const double y = (ide->entryY + ide->exitY) / 2.;
-        const double z = (ide->entryZ + ide->exitZ) / 2.;
-        const CRTTagger tagger = fCRTGeoAlg.WhichTagger(x, y, z);
-
-        const int rollUpID = RollUpID(ide->trackID);
-
-        Category category(rollUpID, tagger);
-        depositCategories.insert(category);
-        depositTrackIDs.insert(rollUpID);
-
-        fTrackIDSpacePointRecoMap[category] = false;
-        fTrackIDTrackRecoMap[rollUpID]      = { false, false };
-
-        categoryToEnergyMap[category] += ide->energyDeposited;
-        categoryToXMap[category]      += x;
-        categoryToYMap[category]      += y;
-        categoryToZMap[category]      += z;
-        categoryToTimeMap[category]   += (ide->entryT + ide->exitT) / 2.;
-
-        idToEnergyMap[rollUpID] += ide->energyDeposited;
-        idToXMap[rollUpID]      += x;
-        idToYMap[rollUpID]      += y;
-        idToZMap[rollUpID]      += z;
-        idToTimeMap[rollUpID]   += (ide->entryT + ide->exitT) / 2.;
+        const double x = (ide.entryX + ide.exitX) / 2.;
+        const double y = (ide.entryY + ide.exitY) / 2.;
+        const double z = (ide.entryZ + ide.exitZ) / 2.;
+        const double t = (ide.entryT + ide.exitT) / 2.;
+        const CRTTagger tagger = fCRTGeoAlg->WhichTagger(x, y, z);
+
+        const int rollUpID = RollUpID(ide.trackID);
+
+        const Category category(rollUpID, tagger);
+        fCategorySums[category].Add(ide.energyDeposited, x, y, z, t);
+        fTrackIDSums[rollUpID].Add(ide.energyDeposited, x, y, z, t);
+        fCoreCategorySums[Category(ide.trackID, tagger)].Add(ide.energyDeposited, x, y, z, t);
+      }
 
-        Category coreCategory(ide->trackID, tagger);
-        coreCategoryToEnergyMap[coreCategory] += ide->energyDeposited;
-        coreCategoryToXMap[coreCategory]      += x;
-        coreCategoryToYMap[coreCategory]      += y;
-        coreCategoryToZMap[coreCategory]      += z;
-        coreCategoryToTimeMap[coreCategory]   += (ide->entryT + ide->exitT) / 2.;
+    // Ordered by track ID then tagger, so each particle's taggers come out together
+    fDepositCategories.reserve(fCategorySums.size());
 
-        if(categoryToNIDEsMap.find(category) == categoryToNIDEsMap.end())
-          categoryToNIDEsMap[category] = 0;
+    for(auto const& [category, sums] : fCategorySums)
+      fDepositCategories.push_back(category);
 
-        ++categoryToNIDEsMap[category];
+    std::sort(fDepositCategories.begin(), fDepositCategories.end());
 
-        if(idToNIDEsMap.find(rollUpID) == idToNIDEsMap.end())
-          idToNIDEsMap[rollUpID] = 0;
+    const DepositSums noSums;
 
-        ++idToNIDEsMap[rollUpID];
+    fTrueDepositsPerTagger.reserve(fDepositCategories.size());
 
-        if(coreCategoryToNIDEsMap.find(coreCategory) == coreCategoryToNIDEsMap.end())
-          coreCategoryToNIDEsMap[coreCategory] = 0;
+    for(auto const& category : fDepositCategories)
+      {
+        fTrackIDSpacePointRecoMap[category] = false;
 
-        ++coreCategoryToNIDEsMap[coreCategory];
-      }
+        const DepositSums &sums = fCategorySums.at(category);
 
-    for(auto const category : depositCategories)
-      {
-        fMCPIDEsEnergyPerTaggerMap[category] = 0.;
-        
-        const double x      = categoryToXMap[category] / categoryToNIDEsMap[category];
-        const double y      = categoryToYMap[category] / categoryToNIDEsMap[category];
-        const double z      = categoryToZMap[category] / categoryToNIDEsMap[category];
-        const double time   = categoryToTimeMap[category] / categoryToNIDEsMap[category];
-        const double energy = categoryToEnergyMap[category];
-
-        const double coreX      = coreCategoryToXMap[category] / coreCategoryToNIDEsMap[category];
-        const double coreY      = coreCategoryToYMap[category] / coreCategoryToNIDEsMap[category];
-        const double coreZ      = coreCategoryToZMap[category] / coreCategoryToNIDEsMap[category];
-        const double coreTime   = coreCategoryToTimeMap[category] / coreCategoryToNIDEsMap[category];
-        const double coreEnergy = coreCategoryToEnergyMap[category];
+        auto const coreIter     = fCoreCategorySums.find(category);
+        const DepositSums &core = coreIter == fCoreCategorySums.end() ? noSums : coreIter->second;
 
         int pdg;
         double particle_energy, particle_time;
         TrueParticlePDGEnergyTime(category.trackid, pdg, particle_energy, particle_time);
 
-        fTrueDepositsPerTaggerMap[category] = TrueDeposit(category.trackid, pdg, category.tagger,
-                                                          energy, time, x, y, z, true,
-                                                          coreEnergy, coreTime, coreX, coreY, coreZ);
+        fTrueDepositsPerTagger.emplace_back(category.trackid, pdg, category.tagger,
+                                            sums.energy, sums.time / sums.nides,
+                                            sums.x / sums.nides, sums.y / sums.nides, sums.z / sums.nides, true,
+                                            core.energy, core.time / core.nides,
+                                            core.x / core.nides, core.y / core.nides, core.z / core.nides);
       }
 
-    for(auto const trackID : depositTrackIDs)
-      {
-        fMCPIDEsEnergyMap[trackID] = 0.;
-        
-        const double x      = idToXMap[trackID] / idToNIDEsMap[trackID];
-        const double y      = idToYMap[trackID] / idToNIDEsMap[trackID];
-        const double z      = idToZMap[trackID] / idToNIDEsMap[trackID];
-        const double time   = idToTimeMap[trackID] / idToNIDEsMap[trackID];
-        const double energy = idToEnergyMap[trackID];
+    struct SortTagger {
+      double    time;
+      double    energy;
+      CRTTagger tagger;
+    };
 
-        int pdg;
-        double particle_energy, particle_time;
-        TrueParticlePDGEnergyTime(trackID, pdg, particle_energy, particle_time);
+    std::vector<SortTagger> taggers;
 
-        struct SortTagger {
-          double    time;
-          double    energy;
-          CRTTagger tagger;
-        };
+    for(auto categoryIter = fDepositCategories.begin(); categoryIter != fDepositCategories.end();)
+      {
+        const int trackID = categoryIter->trackid;
 
-        std::vector<SortTagger> taggers;
+        fTrackIDTrackRecoMap[trackID] = { false, false };
 
-        for(auto const& [category, deposit] : fTrueDepositsPerTaggerMap)
+        taggers.clear();
+
+        for(; categoryIter != fDepositCategories.end() && categoryIter->trackid == trackID; ++categoryIter)
           {
-            if(category.trackid == trackID)
-              taggers.push_back({deposit.time, deposit.energy, category.tagger});
+            const TrueDeposit &deposit = fTrueDepositsPerTagger[categoryIter - fDepositCategories.begin()];
+            taggers.push_back({deposit.time, deposit.energy, categoryIter->tagger});
           }
 
+        const DepositSums &sums = fTrackIDSums.at(trackID);
+
+        int pdg;
+        double particle_energy, particle_time;
+        TrueParticlePDGEnergyTime(trackID, pdg, particle_energy, particle_time);
+
         std::sort(taggers.begin(), taggers.end(),
                   [](const SortTagger &a, const SortTagger &b)
                   { return a.time < b.time; });
@@ -232,76 +228,199 @@ namespace sbnd::crt {
           }
 
         fTrueTrackInfosMap[trackID] = TrueTrackInfo(trackID, pdg, particle_energy,
-                                                    fTrueDepositsPerTaggerMap[category1],
-                                                    fTrueDepositsPerTaggerMap[category2]);
+                                                    FindTrueDeposit(category1),
+                                                    FindTrueDeposit(category2));
 
         fTrueDepositsMap[trackID] = TrueDeposit(trackID, pdg, kUndefinedTagger,
-                                                energy, time, x, y, z, taggers.size() > 1);
+                                                sums.energy, sums.time / sums.nides,
+                                                sums.x / sums.nides, sums.y / sums.nides, sums.z / sums.nides,
+                                                taggers.size() > 1);
       }
+  }
 
-    for(auto const ide : ideVec)
-      {
-        const double x = (ide->entryX + ide->exitX) / 2.;
-        const double y = (ide->entryY + ide->exitY) / 2.;
-        const double z = (ide->entryZ + ide->exitZ) / 2.;
-        const CRTTagger tagger = fCRTGeoAlg.WhichTagger(x, y, z);
+  void CRTBackTrackerAlg::SetupStripHits(const art::Event &event)
+  {
+    if(fBuiltStages & kStripHitsStage)
+      return;
 
-        const int rollUpID = RollUpID(ide->trackID);
-        Category category(rollUpID, tagger);
+    SetupDeposits(event);
 
-        fMCPIDEsEnergyPerTaggerMap[category] += ide->energyDeposited;
-        fMCPIDEsEnergyMap[rollUpID]          += ide->energyDeposited;
-      }
+    fBuiltStages |= kStripHitsStage;
 
     art::Handle<std::vector<CRTStripHit>> stripHitHandle;
     event.getByLabel(fStripHitModuleLabel, stripHitHandle);
     std::vector<art::Ptr<CRTStripHit>> stripHitVec;
     art::fill_ptr_vector(stripHitVec, stripHitHandle);
 
-    for(auto const stripHit : stripHitVec)
+    fStripHitMCPMap.assign(stripHitVec.size(), 0);
+
+    for(auto const& stripHit : stripHitVec)
       {
-        const CRTTagger tagger = fCRTGeoAlg.ChannelToTaggerEnum(stripHit->Channel());
+        const CRTTagger tagger = fCRTGeoAlg->ChannelToTaggerEnum(stripHit->Channel());
         TruthMatchMetrics truthMatch = TruthMatching(event, stripHit);
 
         fStripHitMCPMap[stripHit.key()] = truthMatch.trackid;
 
-        Category category(truthMatch.trackid, tagger);
-        if(fMCPStripHitsMap.find(category) == fMCPStripHitsMap.end())
-          fMCPStripHitsMap[category] = 0;
-
         ++fMCPStripHitsMap[{truthMatch.trackid, tagger}];
       }
   }
 
+  const art::FindManyP<sim::AuxDetIDE, FEBTruthInfo>& CRTBackTrackerAlg::FEBDataToIDEs(const art::Event &event)
+  {
+    if(!fFEBDataToIDEs)
+      {
+        art::Handle<std::vector<FEBData>> febDataHandle;
+        event.getByLabel(fFEBDataModuleLabel, febDataHandle);
+        fFEBDataToIDEs.emplace(febDataHandle, event, fFEBDataModuleLabel);
+      }
+
+    return *fFEBDataToIDEs;
+  }
+
+  const art::FindOneP<FEBData>& CRTBackTrackerAlg::StripHitToFEBData(const art::Event &event)
+  {
+    if(!fStripHitToFEBData)
+      {
+        art::Handle<std::vector<CRTStripHit>> stripHitHandle;
+        event.getByLabel(fStripHitModuleLabel, stripHitHandle);
+        fStripHitToFEBData.emplace(stripHitHandle, event, fStripHitModuleLabel);
+      }
+
+    return *fStripHitToFEBData;
+  }
+
+  const art::FindManyP<CRTStripHit>& CRTBackTrackerAlg::ClusterToStripHits(const art::Event &event)
+  {
+    if(!fClusterToStripHits)
+      {
+        art::Handle<std::vector<CRTCluster>> clusterHandle;
+        event.getByLabel(fClusterModuleLabel, clusterHandle);
+        fClusterToStripHits.emplace(clusterHandle, event, fClusterModuleLabel);
+      }
+
+    return *fClusterToStripHits;
+  }
+
+  const art::FindOneP<CRTCluster>& CRTBackTrackerAlg::SpacePointToCluster(const art::Event &event)
+  {
+    if(!fSpacePointToCluster)
+      {
+        art::Handle<std::vector<CRTSpacePoint>> spacePointHandle;
+        event.getByLabel(fSpacePointModuleLabel, spacePointHandle);
+        fSpacePointToCluster.emplace(spacePointHandle, event, fSpacePointModuleLabel);
+      }
+
+    return *fSpacePointToCluster;
+  }
+
+  const art::FindManyP<CRTSpacePoint>& CRTBackTrackerAlg::TrackToSpacePoints(const art::Event &event)
+  {
+    if(!fTrackToSpacePoints)
+      {
+        art::Handle<std::vector<CRTTrack>> trackHandle;
+        event.getByLabel(fTrackModuleLabel, trackHandle);
+        fTrackToSpacePoints.emplace(trackHandle, event, fTrackModuleLabel);
+      }
+
+    return *fTrackToSpacePoints;
+  }
+
+  double CRTBackTrackerAlg::IDEsEnergy(const Category &category) const
+  {
+    auto const iter = fCategorySums.find(category);
+
+    return iter == fCategorySums.end() ? 0. : iter->second.energy;
+  }
+
+  double CRTBackTrackerAlg::IDEsEnergy(const int trackid) const
+  {
+    auto const iter = fTrackIDSums.find(trackid);
+
+    return iter == fTrackIDSums.end() ? 0. : iter->second.energy;
+  }
+
+  int CRTBackTrackerAlg::StripHitMCP(const size_t key) const
+  {
+    return key < fStripHitMCPMap.size() ? fStripHitMCPMap[key] : 0;
+  }
+
+  const CRTBackTrackerAlg::TrueDeposit& CRTBackTrackerAlg::FindTrueDeposit(const Category &category) const
+  {
+    static const TrueDeposit noDeposit;
+
+    auto const iter = std::lower_bound(fDepositCategories.begin(), fDepositCategories.end(), category);
+
+    if(iter == fDepositCategories.end() || !(*iter == category))
+      return noDeposit;
+
+    return fTrueDepositsPerTagger[iter - fDepositCategories.begin()];
+  }
+
+  void CRTBackTrackerAlg::SetRecoStatus(const int trackid, const unsigned clear, const unsigned set)
+  {
+    unsigned &status = fRecoStatus[trackid];
+    status = (status & ~clear) | set;
+  }
+
+  unsigned CRTBackTrackerAlg::GetRecoStatus(const int trackid) const
+  {
+    auto const iter = fRecoStatus.find(trackid);
+
+    return iter == fRecoStatus.end() ? 0 : iter->second;
+  }
+
+  bool CRTBackTrackerAlg::SpacePointReconstructed(const Category &category) const
+  {
+    if(category.tagger < 0 || category.tagger >= kNTaggerBits)
+      {
+        auto const iter = fTrackIDSpacePointRecoMap.find(category);
+
+        return iter != fTrackIDSpacePointRecoMap.end() && iter->second;
+      }
+
+    return GetRecoStatus(category.trackid) & (kTaggerSpacePointReco << category.tagger);
+  }
+
   int CRTBackTrackerAlg::RollUpID(const int &id)
   {
-    if(fTrackIDMotherMap.find(id) != fTrackIDMotherMap.end())
-      return fTrackIDMotherMap[id];
+    auto const iter = fTrackIDMotherMap.find(id);
+
+    if(iter != fTrackIDMotherMap.end())
+      return iter->second;
 
     return id;
   }
 
   void CRTBackTrackerAlg::RunSpacePointRecoStatusChecks(const art::Event &event)
   {
+    PrepareEvent(event);
+    SetupStripHits(event);
+
     art::Handle<std::vector<CRTSpacePoint>> spacePointHandle;
     event.getByLabel(fSpacePointModuleLabel, spacePointHandle);
 
-    art::FindManyP<CRTCluster> spacePointsToClusters(spacePointHandle, event, fSpacePointModuleLabel);
+    const art::FindOneP<CRTCluster> &spacePointsToClusters = SpacePointToCluster(event);
 
     for(unsigned i = 0; i < spacePointHandle->size(); ++i)
       {
         const art::Ptr<CRTSpacePoint> spacePoint(spacePointHandle, i);
-        const art::Ptr<CRTCluster> cluster = spacePointsToClusters.at(spacePoint.key())[0];
+        const art::Ptr<CRTCluster> cluster = spacePointsToClusters.at(spacePoint.key());
 
         TruthMatchMetrics truthMatch = TruthMatching(event, cluster);
 
         Category category(truthMatch.trackid, cluster->Tagger());
         fTrackIDSpacePointRecoMap[category] = true;
+
+        const unsigned taggerBit = category.tagger >= 0 && category.tagger < kNTaggerBits ? kTaggerSpacePointReco << category.tagger : 0;
+        SetRecoStatus(truthMatch.trackid, 0, kSpacePointReco | taggerBit);
       }
   }
 
   void CRTBackTrackerAlg::RunTrackRecoStatusChecks(const art::Event &event)
   {
+    PrepareEvent(event);
+    SetupDeposits(event);
+
     art::Handle<std::vector<CRTTrack>> trackHandle;
     event.getByLabel(fTrackModuleLabel, trackHandle);
 
@@ -312,22 +431,25 @@ namespace sbnd::crt {
         TruthMatchMetrics truthMatch = TruthMatching(event, track);
 
         fTrackIDTrackRecoMap[truthMatch.trackid] = { true, track->Triple()};
+
+        // As in the map, the triple flag is the one of the last track
+        SetRecoStatus(truthMatch.trackid, kTrackRecoTriple, kTrackReco | (track->Triple() ? kTrackRecoTriple : 0));
       }
   }
 
-  std::map<CRTBackTrackerAlg::Category, bool> CRTBackTrackerAlg::GetSpacePointRecoStatusMap()
+  const std::map<CRTBackTrackerAlg::Category, bool>& CRTBackTrackerAlg::GetSpacePointRecoStatusMap() const
   {
     return fTrackIDSpacePointRecoMap;
   }
 
-  std::map<int, std::pair<bool, bool>> CRTBackTrackerAlg::GetTrackRecoStatusMap()
+  const std::map<int, std::pair<bool, bool>>& CRTBackTrackerAlg::GetTrackRecoStatusMap() const
   {
     return fTrackIDTrackRecoMap;
   }
 
   CRTBackTrackerAlg::TrueDeposit CRTBackTrackerAlg::GetTrueDeposit(Category category)
   {
-    return fTrueDepositsPerTaggerMap[category];
+    return FindTrueDeposit(category);
   }
 
   CRTBackTrackerAlg::TrueDeposit CRTBackTrackerAlg::GetTrueDeposit(int trackid)
@@ -337,18 +459,15 @@ namespace sbnd::crt {
 
   CRTBackTrackerAlg::TruthMatchMetrics CRTBackTrackerAlg::TruthMatching(const art::Event &event, const art::Ptr<CRTStripHit> &stripHit)
   {  
-    art::Handle<std::vector<FEBData>> febDataHandle;
-    event.getByLabel(fFEBDataModuleLabel, febDataHandle);
+    PrepareEvent(event);
+    SetupDeposits(event);
 
-    art::Handle<std::vector<CRTStripHit>> stripHitHandle;
-    event.getByLabel(fStripHitModuleLabel, stripHitHandle);
+    const art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> &febDataToIDEs = FEBDataToIDEs(event);
+    const CRTTagger tagger = fCRTGeoAlg->ChannelToTaggerEnum(stripHit->Channel());
 
-    art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> febDataToIDEs(febDataHandle, event, fFEBDataModuleLabel);
-    art::FindOneP<FEBData> stripHitToFEBData(stripHitHandle, event, fStripHitModuleLabel);
-    const CRTTagger tagger = fCRTGeoAlg.ChannelToTaggerEnum(stripHit->Channel());
-
-    auto const febData = stripHitToFEBData.at(stripHit.key());
-    auto const assnIDEVec = febDataToIDEs.at(febData.key());
+    auto const febData = StripHitToFEBData(event).at(stripHit.key());
+    auto const &assnIDEVec = febDataToIDEs.at(febData.key());
+    auto const &febTruthInfos = febDataToIDEs.data(febData.key());
 
     std::map<int, double> idToEnergyMap;
     double totalEnergy = 0., x = 0., y = 0., z = 0., t = 0.;
@@ -356,8 +475,8 @@ namespace sbnd::crt {
 
     for(unsigned i = 0; i < assnIDEVec.size(); ++i)
       {
-        const art::Ptr<sim::AuxDetIDE> ide = assnIDEVec[i];
-        const FEBTruthInfo *febTruthInfo = febDataToIDEs.data(febData.key())[i];
+        const art::Ptr<sim::AuxDetIDE> &ide = assnIDEVec[i];
+        const FEBTruthInfo *febTruthInfo = febTruthInfos[i];
         if((uint) febTruthInfo->GetChannel() == (stripHit->Channel() % 32))
           {
             idToEnergyMap[RollUpID(ide->trackID)] += ide->energyDeposited;
@@ -389,7 +508,7 @@ namespace sbnd::crt {
 
             trackid = id;
             bestPur = pur;
-            comp    = en / fMCPIDEsEnergyPerTaggerMap[category];
+            comp    = en / IDEsEnergy(category);
           }
       }
 
@@ -400,34 +519,27 @@ namespace sbnd::crt {
 
   CRTBackTrackerAlg::TruthMatchMetrics CRTBackTrackerAlg::TruthMatching(const art::Event &event, const art::Ptr<CRTCluster> &cluster)
   {
-    art::Handle<std::vector<FEBData>> febDataHandle;
-    event.getByLabel(fFEBDataModuleLabel, febDataHandle);
-
-    art::Handle<std::vector<CRTStripHit>> stripHitHandle;
-    event.getByLabel(fStripHitModuleLabel, stripHitHandle);
+    PrepareEvent(event);
+    SetupStripHits(event);
 
-    art::Handle<std::vector<CRTCluster>> clusterHandle;
-    event.getByLabel(fClusterModuleLabel, clusterHandle);
-
-    art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> febDataToIDEs(febDataHandle, event, fFEBDataModuleLabel);
-    art::FindManyP<FEBData> stripHitToFEBData(stripHitHandle, event, fStripHitModuleLabel);
-    art::FindManyP<CRTStripHit> clusterToStripHits(clusterHandle, event, fClusterModuleLabel);
+    const art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> &febDataToIDEs = FEBDataToIDEs(event);
+    const art::FindOneP<FEBData> &stripHitToFEBData                   = StripHitToFEBData(event);
 
     std::map<int, double> idToEnergyMap;
     double totalEnergy = 0.;
     std::map<int, uint> idToNHitsMap;
 
-    auto const assnStripHitVec = clusterToStripHits.at(cluster.key());
+    auto const &assnStripHitVec = ClusterToStripHits(event).at(cluster.key());
 
-    for(auto const stripHit : assnStripHitVec)
+    for(auto const& stripHit : assnStripHitVec)
       {
         auto const febData = stripHitToFEBData.at(stripHit.key());
-        assert(febData.size() == 1);
-        auto const assnIDEVec = febDataToIDEs.at(febData.at(0).key());
+        auto const &assnIDEVec = febDataToIDEs.at(febData.key());
+        auto const &febTruthInfos = febDataToIDEs.data(febData.key());
         for(unsigned i = 0; i < assnIDEVec.size(); ++i)
           {
-            const art::Ptr<sim::AuxDetIDE> ide = assnIDEVec[i];
-            const FEBTruthInfo *febTruthInfo = febDataToIDEs.data(febData.at(0).key())[i];
+            const art::Ptr<sim::AuxDetIDE> &ide = assnIDEVec[i];
+            const FEBTruthInfo *febTruthInfo = febTruthInfos[i];
             if((uint) febTruthInfo->GetChannel() == (stripHit->Channel() % 32))
               {
                 idToEnergyMap[RollUpID(ide->trackID)] += ide->energyDeposited;
@@ -435,10 +547,7 @@ namespace sbnd::crt {
               }
           }
 
-        if(idToNHitsMap.find(fStripHitMCPMap[stripHit.key()]) == idToNHitsMap.end())
-          idToNHitsMap[fStripHitMCPMap[stripHit.key()]] = 0;
-        
-        ++idToNHitsMap[fStripHitMCPMap[stripHit.key()]];
+        ++idToNHitsMap[StripHitMCP(stripHit.key())];
       }
 
     double bestPur = 0., comp = 0.;
@@ -453,7 +562,7 @@ namespace sbnd::crt {
 
             trackid = id;
             bestPur = pur;
-            comp    = en / fMCPIDEsEnergyPerTaggerMap[category];
+            comp    = en / IDEsEnergy(category);
           }
       }
 
@@ -463,52 +572,39 @@ namespace sbnd::crt {
     double hitPur  = idToNHitsMap[trackid] / (double) assnStripHitVec.size();
 
     return TruthMatchMetrics(trackid, comp, bestPur, hitComp, hitPur, 
-                             fTrueDepositsPerTaggerMap[category]);
+                             FindTrueDeposit(category));
   }
 
   CRTBackTrackerAlg::TruthMatchMetrics CRTBackTrackerAlg::TruthMatching(const art::Event &event, const art::Ptr<CRTTrack> &track)
   {
-    art::Handle<std::vector<FEBData>> febDataHandle;
-    event.getByLabel(fFEBDataModuleLabel, febDataHandle);
-
-    art::Handle<std::vector<CRTStripHit>> stripHitHandle;
-    event.getByLabel(fStripHitModuleLabel, stripHitHandle);
-
-    art::Handle<std::vector<CRTCluster>> clusterHandle;
-    event.getByLabel(fClusterModuleLabel, clusterHandle);
-
-    art::Handle<std::vector<CRTSpacePoint>> spacePointHandle;
-    event.getByLabel(fSpacePointModuleLabel, spacePointHandle);
-
-    art::Handle<std::vector<CRTTrack>> trackHandle;
-    event.getByLabel(fTrackModuleLabel, trackHandle);
+    PrepareEvent(event);
+    SetupDeposits(event);
 
-    art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> febDataToIDEs(febDataHandle, event, fFEBDataModuleLabel);
-    art::FindManyP<FEBData> stripHitToFEBData(stripHitHandle, event, fStripHitModuleLabel);
-    art::FindManyP<CRTStripHit> clusterToStripHits(clusterHandle, event, fClusterModuleLabel);
-    art::FindOneP<CRTCluster> spacePointToCluster(spacePointHandle, event, fSpacePointModuleLabel);
-    art::FindManyP<CRTSpacePoint> trackToSpacePoints(trackHandle, event, fTrackModuleLabel);
+    const art::FindManyP<sim::AuxDetIDE, FEBTruthInfo> &febDataToIDEs = FEBDataToIDEs(event);
+    const art::FindOneP<FEBData> &stripHitToFEBData                   = StripHitToFEBData(event);
+    const art::FindManyP<CRTStripHit> &clusterToStripHits             = ClusterToStripHits(event);
+    const art::FindOneP<CRTCluster> &spacePointToCluster              = SpacePointToCluster(event);
 
     std::map<int, double> idToEnergyMap;
     double totalEnergy = 0.;
 
-    auto const spacePointVec = trackToSpacePoints.at(track.key());
+    auto const &spacePointVec = TrackToSpacePoints(event).at(track.key());
 
-    for(auto const spacePoint : spacePointVec)
+    for(auto const& spacePoint : spacePointVec)
       {
-        auto const cluster     = spacePointToCluster.at(spacePoint.key());
-        auto const stripHitVec = clusterToStripHits.at(cluster.key());
+        auto const cluster      = spacePointToCluster.at(spacePoint.key());
+        auto const &stripHitVec = clusterToStripHits.at(cluster.key());
         
-        for(auto const stripHit : stripHitVec)
+        for(auto const& stripHit : stripHitVec)
           {
             auto const febData = stripHitToFEBData.at(stripHit.key());
-            assert(febData.size() == 1);
-            auto const assnIDEVec = febDataToIDEs.at(febData.at(0).key());
+            auto const &assnIDEVec = febDataToIDEs.at(febData.key());
+            auto const &febTruthInfos = febDataToIDEs.data(febData.key());
 
             for(unsigned i = 0; i < assnIDEVec.size(); ++i)
               {
-                const art::Ptr<sim::AuxDetIDE> ide = assnIDEVec[i];
-                const FEBTruthInfo *febTruthInfo = febDataToIDEs.data(febData.at(0).key())[i];
+                const art::Ptr<sim::AuxDetIDE> &ide = assnIDEVec[i];
+                const FEBTruthInfo *febTruthInfo = febTruthInfos[i];
                 if((uint) febTruthInfo->GetChannel() == (stripHit->Channel() % 32))
                   {
                     idToEnergyMap[RollUpID(ide->trackID)] += ide->energyDeposited;
@@ -528,7 +624,7 @@ namespace sbnd::crt {
           {
             trackid = id;
             bestPur = pur;
-            comp    = en / fMCPIDEsEnergyMap[id];
+            comp    = en / IDEsEnergy(id);
           }
       }
 
@@ -541,7 +637,7 @@ namespace sbnd::crt {
                                                                                  const CRTTagger &tagger)
   {
     const CoordSet constrainedPlane = CRTCommonUtils::GetTaggerDefinedCoordinate(tagger);
-    const CRTTaggerGeo taggerGeo    = fCRTGeoAlg.GetTagger(CRTCommonUtils::GetTaggerName(tagger));
+    const CRTTaggerGeo &taggerGeo   = fCRTGeoAlg->GetTagger(tagger);
     double k;
 
     switch(constrainedPlane)
@@ -570,7 +666,7 @@ namespace sbnd::crt {
         break;
       }
     
-    if(!fCRTGeoAlg.IsPointInsideCRTLimits(start + k * dir))
+    if(!fCRTGeoAlg->IsPointInsideCRTLimits(start + k * dir))
       return {999999., {999999., 999999., 999999.}};
     
     return {k, start + k * dir};
@@ -44,6 +44,11 @@
 // lardataobj
 #include "lardataobj/Simulation/ParticleAncestryMap.h"
 
+// c++
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
 namespace sbnd::crt {
   
   class CRTBackTrackerAlg {
@@ -94,6 +99,18 @@ namespace sbnd::crt {
 
         return trackid < other.trackid;
       }
+
+      bool operator==(const Category &other) const
+      {
+        return trackid == other.trackid && tagger == other.tagger;
+      }
+    };
+
+    struct CategoryHash {
+      size_t operator()(const Category &category) const
+      {
+        return std::hash<long long>()((static_cast<long long>(category.trackid) << 8) ^ category.tagger);
+      }
     };
 
 
@@ -187,6 +204,17 @@ namespace sbnd::crt {
       }
     };
 
+    // Reconstruction status of a particle, as a set of bits
+    enum RecoStatus : unsigned {
+      kSpacePointReco      = 1 << 0, // truth matched by a space point, on any tagger
+      kTrackReco           = 1 << 1, // truth matched by a track
+      kTrackRecoTriple     = 1 << 2, // ... and the last such track has three space points
+      kTaggerSpacePointReco = 1 << 3  // shifted left by the tagger: by a space point on that tagger
+    };
+
+    // Taggers with a kTaggerSpacePointReco bit of their own
+    static constexpr int kNTaggerBits = 29;
+
     CRTBackTrackerAlg(const Config& config);
     
     CRTBackTrackerAlg(const fhicl::ParameterSet& pset) :
@@ -206,9 +234,22 @@ namespace sbnd::crt {
 
     void RunTrackRecoStatusChecks(const art::Event &event);
     
-    std::map<Category, bool> GetSpacePointRecoStatusMap();
+    const std::map<Category, bool>& GetSpacePointRecoStatusMap() const;
+
+    const std::map<int, std::pair<bool, bool>>& GetTrackRecoStatusMap() const;
+
+    // RecoStatus bits of a particle (rolled up track ID) from the checks run
+    // on this event, 0 if none matched it
+    unsigned GetRecoStatus(const int trackid) const;
+
+    bool SpacePointReconstructed(const int trackid) const { return GetRecoStatus(trackid) & kSpacePointReco; }
+
+    bool SpacePointReconstructed(const Category &category) const;
 
-    std::map<int, std::pair<bool, bool>> GetTrackRecoStatusMap();
+    bool TrackReconstructed(const int trackid) const { return GetRecoStatus(trackid) & kTrackReco; }
+
+    // The true deposits of each particle on each tagger, ordered by track ID then tagger
+    const std::vector<TrueDeposit>& GetTrueDepositsPerTagger() const { return fTrueDepositsPerTagger; }
 
     TrueDeposit GetTrueDeposit(Category category);
 
@@ -227,8 +268,66 @@ namespace sbnd::crt {
     void TrueParticlePDGEnergyTime(const int trackID, int &pdg, double &energy, double &time);
 
   private:
-    
-    CRTGeoAlg fCRTGeoAlg;
+
+    // Running sums over the AuxDetIDEs of one particle, per tagger or in total
+    struct DepositSums {
+      double energy = 0.;
+      double x      = 0.;
+      double y      = 0.;
+      double z      = 0.;
+      double time   = 0.;
+      uint   nides  = 0;
+
+      void Add(const double _energy, const double _x, const double _y, const double _z, const double _time)
+      {
+        energy += _energy;
+        x      += _x;
+        y      += _y;
+        z      += _z;
+        time   += _time;
+        ++nides;
+      }
+    };
+
+    // The truth information is built in stages, each one the first time something
+    // asks for it in a given event. SetupMaps builds all of them straight away.
+    enum SetupStage : unsigned {
+      kAncestryStage  = 1 << 0,
+      kDepositsStage  = 1 << 1,
+      kStripHitsStage = 1 << 2
+    };
+
+    void PrepareEvent(const art::Event &event);
+
+    void SetupAncestry(const art::Event &event);
+
+    void SetupDeposits(const art::Event &event);
+
+    void SetupStripHits(const art::Event &event);
+
+    const art::FindManyP<sim::AuxDetIDE, FEBTruthInfo>& FEBDataToIDEs(const art::Event &event);
+
+    const art::FindOneP<FEBData>& StripHitToFEBData(const art::Event &event);
+
+    const art::FindManyP<CRTStripHit>& ClusterToStripHits(const art::Event &event);
+
+    const art::FindOneP<CRTCluster>& SpacePointToCluster(const art::Event &event);
+
+    const art::FindManyP<CRTSpacePoint>& TrackToSpacePoints(const art::Event &event);
+
+    double IDEsEnergy(const Category &category) const;
+
+    double IDEsEnergy(const int trackid) const;
+
+    int StripHitMCP(const size_t key) const;
+
+    // Deposit of the category, by binary search of fDepositCategories; a
+    // default one if the particle left nothing on that tagger
+    const TrueDeposit& FindTrueDeposit(const Category &category) const;
+
+    void SetRecoStatus(const int trackid, const unsigned clear, const unsigned set);
+
+    std::shared_ptr<const CRTGeoAlg> fCRTGeoAlg = CRTGeoAlg::Shared();
     art::ServiceHandle<cheat::ParticleInventoryService> particleInv;
 
     art::InputTag fSimModuleLabel;
@@ -239,16 +338,29 @@ namespace sbnd::crt {
     art::InputTag fSpacePointModuleLabel;
     art::InputTag fTrackModuleLabel;
 
-    std::map<Category, TrueDeposit>      fTrueDepositsPerTaggerMap;
-    std::map<int, TrueDeposit>           fTrueDepositsMap;
-    std::map<int, TrueTrackInfo>         fTrueTrackInfosMap;
-    std::map<Category, bool>             fTrackIDSpacePointRecoMap;
-    std::map<int, std::pair<bool, bool>> fTrackIDTrackRecoMap;
-    std::map<Category, double>           fMCPIDEsEnergyPerTaggerMap;
-    std::map<int, double>                fMCPIDEsEnergyMap;
-    std::map<Category, int>              fMCPStripHitsMap;
-    std::map<int, int>                   fTrackIDMotherMap;
-    std::map<int, int>                   fStripHitMCPMap;
+    art::EventID fEventID;
+    unsigned     fBuiltStages = 0;
+
+    // Cleared rather than rebuilt each event so their buckets and capacity are reused
+    std::vector<TrueDeposit>                                fTrueDepositsPerTagger; // parallel to fDepositCategories
+    std::unordered_map<int, TrueDeposit>                    fTrueDepositsMap;
+    std::unordered_map<int, TrueTrackInfo>                  fTrueTrackInfosMap;
+    std::map<Category, bool>                                fTrackIDSpacePointRecoMap;
+    std::map<int, std::pair<bool, bool>>                    fTrackIDTrackRecoMap;
+    std::unordered_map<Category, DepositSums, CategoryHash> fCategorySums;
+    std::unordered_map<Category, DepositSums, CategoryHash> fCoreCategorySums;
+    std::unordered_map<int, DepositSums>                    fTrackIDSums;
+    std::vector<Category>                                   fDepositCategories;
+    std::unordered_map<Category, int, CategoryHash>         fMCPStripHitsMap;
+    std::unordered_map<int, int>                            fTrackIDMotherMap;
+    std::unordered_map<int, unsigned>                       fRecoStatus;
+    std::vector<int>                                        fStripHitMCPMap;
+
+    std::optional<art::FindManyP<sim::AuxDetIDE, FEBTruthInfo>> fFEBDataToIDEs;
+    std::optional<art::FindOneP<FEBData>>                       fStripHitToFEBData;
+    std::optional<art::FindManyP<CRTStripHit>>                  fClusterToStripHits;
+    std::optional<art::FindOneP<CRTCluster>>                    fSpacePointToCluster;
+    std::optional<art::FindManyP<CRTSpacePoint>>                fTrackToSpacePoints;
     
   };
 }
@@ -49,6 +49,8 @@ namespace geo {
 
     fADGeoToName.clear();
     fADGeoToChannelAndSV.clear();
+    fChannelPositions.assign(adgeo.size(), {});
+    fPositionsOf = adgeo.data();
 
     for (size_t a=0; a<adgeo.size(); a++){
       std::string volName(adgeo[a].TotalVolume()->GetName());
@@ -75,14 +77,59 @@ namespace geo {
           for (size_t ich=0; ich<2; ich++) {
             size_t chID = 2 * svID + ich;
             fADGeoToChannelAndSV[a].push_back(std::make_pair(chID, svID));
+            fChannelPositions[a].push_back(adgeo[a].SensitiveVolume(svID).GetCenter());
           }
         }
       }
     }
+
+    // Index the AuxDets and their strips for the position lookups
+    fAuxDetIndex.Build(adgeo);
+  }
+
+  //----------------------------------------------------------------------------
+  void CRTChannelMapAlg::Uninitialize() {
+    fAuxDetIndex.Clear();
+    fChannelPositions.clear();
+    fPositionsOf = nullptr;
+  }
+
+  //----------------------------------------------------------------------------
+  size_t CRTChannelMapAlg::NearestAuxDet(
+      Point_t const& point,
+      std::vector<geo::AuxDetGeo> const& auxDets,
+      double tolerance) const {
+
+    size_t const ad = fAuxDetIndex.FindAuxDet(point, auxDets, tolerance);
+
+    if (ad == UINT_MAX) {
+      throw cet::exception("AuxDetChannelMapAlg")
+      << "Can't find AuxDet for position ("
+      << point.X() << "," << point.Y() << "," << point.Z() << ")\n";
+    }
+
+    return ad;
   }
 
   //----------------------------------------------------------------------------
-  void CRTChannelMapAlg::Uninitialize() {}
+  size_t CRTChannelMapAlg::NearestSensitiveAuxDet(
+      Point_t const& point,
+      std::vector<geo::AuxDetGeo> const& auxDets,
+      size_t& ad,
+      double tolerance) const {
+
+    ad = this->NearestAuxDet(point, auxDets, tolerance);
+
+    size_t const sv = fAuxDetIndex.FindSensitiveVolume(point, auxDets, ad, tolerance);
+
+    if (sv == UINT_MAX) {
+      throw cet::exception("AuxDetChannelMapAlg")
+      << "Can't find AuxDetSensitive for position ("
+      << point.X() << "," << point.Y() << "," << point.Z() << ")\n";
+    }
+
+    return sv;
+  }
 
   //----------------------------------------------------------------------------
   uint32_t CRTChannelMapAlg::PositionToAuxDetChannel(
@@ -131,12 +178,13 @@ namespace geo {
       std::string const& auxDetName,
       std::vector<geo::AuxDetGeo> const& auxDets) const {
 
-    std::cout << "CRTChannelMapAlg::AuxDetChannelToPosition" << std::endl;
+    mf::LogDebug("CRTChannelMapAlg") << "CRTChannelMapAlg::AuxDetChannelToPosition";
 
     // Figure out which detector we are in
     size_t ad = UINT_MAX;
-    if (fNameToADGeo.count(auxDetName) > 0) {
-      ad = fNameToADGeo.find(auxDetName)->second;
+    auto const adItr = fNameToADGeo.find(auxDetName);
+    if (adItr != fNameToADGeo.end()) {
+      ad = adItr->second;
     }
     else {
       throw cet::exception("CRTChannelMapAlg")
@@ -152,6 +200,13 @@ namespace geo {
       << " map for AuxDet index " << ad << " bail";
     }
 
+    // The channel IDs of an AuxDet run from 0, so the center of its
+    // sensitive volume was stored at Initialize at the channel index.
+    if (auxDets.data() == fPositionsOf && auxDets.size() == fChannelPositions.size()) {
+      std::vector<Point_t> const& positions = fChannelPositions[ad];
+      return (channel < positions.size())? positions[channel]: Point_t{};
+    }
+
     // Loop over the vector of channel and sensitive volumes to determine the
     // sensitive volume for this channel. Then get the origin of the sensitive
     // volume in the world coordinate system.
@@ -13,6 +13,7 @@
 
 #include "larcorealg/Geometry/AuxDetChannelMapAlg.h"
 #include "sbndcode/CRT/CRTGeoObjectSorter.h"
+#include "sbndcode/Geometry/AuxDetSpatialIndex.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "TVector3.h"
 #include <vector>
@@ -27,6 +28,17 @@ namespace geo {
 
     void Uninitialize() override;
 
+    size_t NearestAuxDet(
+        Point_t const& point,
+        std::vector<geo::AuxDetGeo> const& auxDets,
+        double tolerance = 0) const override;
+
+    size_t NearestSensitiveAuxDet(
+        Point_t const& point,
+        std::vector<geo::AuxDetGeo> const& auxDets,
+        size_t& ad,
+        double tolerance = 0) const override;
+
     uint32_t PositionToAuxDetChannel(
         Point_t const& worldLoc,
         std::vector<geo::AuxDetGeo> const& auxDets,
@@ -40,6 +52,11 @@ namespace geo {
 
   private:
     geo::CRTGeoObjectSorter fSorter; ///< Class to sort geo objects
+    geo::AuxDetSpatialIndex fAuxDetIndex; ///< Finds the AuxDet and strip holding a point
+
+    /// World position of each channel of each AuxDet, filled at Initialize
+    std::vector<std::vector<Point_t>> fChannelPositions;
+    geo::AuxDetGeo const* fPositionsOf = nullptr; ///< AuxDets the positions were taken from
   };
 
 }  // namespace geo
@@ -1,15 +1,21 @@
 #include "CRTEventDisplayAlg.h"
 
+#include "TROOT.h"
+
 namespace sbnd::crt {
   
   CRTEventDisplayAlg::CRTEventDisplayAlg(const Config& config)
-    : fCRTGeoAlg(config.GeoAlgConfig())
+    : fCRTGeoAlg(CRTGeoAlg::Shared(config.GeoAlgConfig()))
     , fCRTBackTrackerAlg(config.BackTrackerAlgConfig())
   {
+    fDetectorLayer.SetOwner(true);
     this->reconfigure(config);
   }
   
-  CRTEventDisplayAlg::CRTEventDisplayAlg(){}
+  CRTEventDisplayAlg::CRTEventDisplayAlg()
+  {
+    fDetectorLayer.SetOwner(true);
+  }
   
   CRTEventDisplayAlg::~CRTEventDisplayAlg(){}
 
@@ -57,17 +63,31 @@ namespace sbnd::crt {
 
     fLineWidth = config.LineWidth();
 
+    fBatchMode       = config.BatchMode();
+    fOutputFormat    = config.OutputFormat();
+    fOutputDirectory = config.OutputDirectory();
+
+    if(fBatchMode)
+      gROOT->SetBatch(kTRUE);
+
+    fDetectorLayer.Delete();
+    fDetectorLayerBuilt = false;
+
     return;
   }
  
   void CRTEventDisplayAlg::SetDrawTaggers(bool tf)
   {
     fDrawTaggers = tf;
+    fDetectorLayer.Delete();
+    fDetectorLayerBuilt = false;
   }
 
   void CRTEventDisplayAlg::SetDrawTpc(bool tf)
   {
     fDrawTpc = tf;
+    fDetectorLayer.Delete();
+    fDetectorLayerBuilt = false;
   }
 
   void CRTEventDisplayAlg::SetDrawTrueTracks(bool tf)
@@ -119,26 +139,37 @@ namespace sbnd::crt {
     p4->Draw();
   }
 
-  void CRTEventDisplayAlg::Draw(detinfo::DetectorClocksData const& clockData,
-                                const art::Event& event)
+  void CRTEventDisplayAlg::AddCube(TList &list, double *rmin, double *rmax, int colour)
   {
-    fCRTBackTrackerAlg.SetupMaps(event);
-
-    double G4RefTime(clockData.G4ToElecTime(0) * 1e3);
-    if(fPrint) std::cout << "G4RefTime: " << G4RefTime << std::endl;
-
-    // Create a canvas 
-    TCanvas *c1 = new TCanvas("c1","",700,700);
-    
-    std::vector<double> crtLims = fCRTGeoAlg.CRTLimits();
-    crtLims[0] -= 100; crtLims[1] -= 100; crtLims[2] -= 100;
-    crtLims[3] += 100; crtLims[4] += 100; crtLims[5] += 100;
+    TList outline;
+    TPolyLine3D *p1 = new TPolyLine3D(4);
+    TPolyLine3D *p2 = new TPolyLine3D(4);
+    TPolyLine3D *p3 = new TPolyLine3D(4);
+    TPolyLine3D *p4 = new TPolyLine3D(4);
+    p1->SetLineColor(colour);
+    p1->SetLineWidth(fLineWidth);
+    p1->Copy(*p2);
+    p1->Copy(*p3);
+    p1->Copy(*p4);
+    outline.Add(p1);
+    outline.Add(p2);
+    outline.Add(p3);
+    outline.Add(p4);
+    TPolyLine3D::DrawOutlineCube(&outline, rmin, rmax);
+    list.Add(p1);
+    list.Add(p2);
+    list.Add(p3);
+    list.Add(p4);
+  }
 
+  void CRTEventDisplayAlg::BuildDetectorLayer()
+  {
+    fDetectorLayer.Delete();
 
     // Draw the CRT taggers
     if(fDrawTaggers)
       {
-        for(auto const &[name, tagger] : fCRTGeoAlg.GetTaggers())
+        for(auto const &[name, tagger] : fCRTGeoAlg->GetTaggers())
           {
             if(fChoseTaggers && std::find(fChosenTaggers.begin(), fChosenTaggers.end(), CRTCommonUtils::GetTaggerEnum(name)) == fChosenTaggers.end())
               continue;
@@ -149,14 +180,14 @@ namespace sbnd::crt {
             double rmax[3] = {tagger.maxX, 
                               tagger.maxY, 
                               tagger.maxZ};
-            DrawCube(c1, rmin, rmax, fTaggerColour);
+            AddCube(fDetectorLayer, rmin, rmax, fTaggerColour);
           }
       }
     
     // Draw individual CRT modules
     if(fDrawModules)
       {
-        for(auto const &[name, module] : fCRTGeoAlg.GetModules())
+        for(auto const &[name, module] : fCRTGeoAlg->GetModules())
           {
             if(fChoseTaggers && std::find(fChosenTaggers.begin(), fChosenTaggers.end(), CRTCommonUtils::GetTaggerEnum(module.taggerName)) == fChosenTaggers.end())
               continue;
@@ -167,11 +198,11 @@ namespace sbnd::crt {
             double rmax[3] = {module.maxX, 
                               module.maxY, 
                               module.maxZ};
-            DrawCube(c1, rmin, rmax, fTaggerColour);
+            AddCube(fDetectorLayer, rmin, rmax, fTaggerColour);
 
             if(fDrawFEBs)
               {
-                const std::array<double, 6> febPos = fCRTGeoAlg.FEBWorldPos(module);
+                const std::array<double, 6> febPos = fCRTGeoAlg->FEBWorldPos(module);
                 
                 double rmin[3] = {febPos[0],
                                   febPos[2],
@@ -181,11 +212,11 @@ namespace sbnd::crt {
                                   febPos[3],
                                   febPos[5]};
 
-                DrawCube(c1, rmin, rmax, fFEBColour);
+                AddCube(fDetectorLayer, rmin, rmax, fFEBColour);
 
                 if(fDrawFEBEnds)
                   {
-                    const std::array<double, 6> febCh0Pos = fCRTGeoAlg.FEBChannel0WorldPos(module);
+                    const std::array<double, 6> febCh0Pos = fCRTGeoAlg->FEBChannel0WorldPos(module);
 
                     double rminCh0[3] = {febCh0Pos[0],
                                          febCh0Pos[2],
@@ -195,7 +226,7 @@ namespace sbnd::crt {
                                          febCh0Pos[3],
                                          febCh0Pos[5]};
 
-                    DrawCube(c1, rminCh0, rmaxCh0, fFEBEndColour);
+                    AddCube(fDetectorLayer, rminCh0, rmaxCh0, fFEBEndColour);
                   }
               }
           }
@@ -204,9 +235,9 @@ namespace sbnd::crt {
     // Draw individual CRT strips
     if(fDrawStrips)
       {
-        for(auto const &[name, strip] : fCRTGeoAlg.GetStrips())
+        for(auto const &[name, strip] : fCRTGeoAlg->GetStrips())
           {
-            if(fChoseTaggers && std::find(fChosenTaggers.begin(), fChosenTaggers.end(), fCRTGeoAlg.ChannelToTaggerEnum(strip.channel0)) == fChosenTaggers.end())
+            if(fChoseTaggers && std::find(fChosenTaggers.begin(), fChosenTaggers.end(), fCRTGeoAlg->ChannelToTaggerEnum(strip.channel0)) == fChosenTaggers.end())
               continue;
 
             double rmin[3] = {strip.minX, 
@@ -215,7 +246,7 @@ namespace sbnd::crt {
             double rmax[3] = {strip.maxX, 
                               strip.maxY, 
                               strip.maxZ};
-            DrawCube(c1, rmin, rmax, fTaggerColour);
+            AddCube(fDetectorLayer, rmin, rmax, fTaggerColour);
           }
       }
     
@@ -228,16 +259,38 @@ namespace sbnd::crt {
         double rmax[3] = {-fTPCGeoAlg.CpaWidth(), 
                           fTPCGeoAlg.MaxY(), 
                           fTPCGeoAlg.MaxZ()};
-        DrawCube(c1, rmin, rmax, fTpcColour);
+        AddCube(fDetectorLayer, rmin, rmax, fTpcColour);
         double rmin2[3] = {fTPCGeoAlg.CpaWidth(), 
                            fTPCGeoAlg.MinY(), 
                            fTPCGeoAlg.MinZ()};
         double rmax2[3] = {fTPCGeoAlg.MaxX(), 
                            fTPCGeoAlg.MaxY(), 
                            fTPCGeoAlg.MaxZ()};
-        DrawCube(c1, rmin2, rmax2, fTpcColour);
+        AddCube(fDetectorLayer, rmin2, rmax2, fTpcColour);
       }
+
+    fDetectorLayerBuilt = true;
+  }
+
+  void CRTEventDisplayAlg::Draw(detinfo::DetectorClocksData const& clockData,
+                                const art::Event& event)
+  {
+    fCRTBackTrackerAlg.SetupMaps(event);
+
+    double G4RefTime(clockData.G4ToElecTime(0) * 1e3);
+    if(fPrint) std::cout << "G4RefTime: " << G4RefTime << std::endl;
+
+    if(!fDetectorLayerBuilt)
+      BuildDetectorLayer();
+
+    // Products of this event, drawn on top of the detector layer
+    TList eventLayer;
+    eventLayer.SetOwner(true);
     
+    std::vector<double> crtLims = fCRTGeoAlg->CRTLimits();
+    crtLims[0] -= 100; crtLims[1] -= 100; crtLims[2] -= 100;
+    crtLims[3] += 100; crtLims[4] += 100; crtLims[5] += 100;
+
     // Draw true track trajectories for visible particles that cross the CRT
     if(fDrawTrueTracks)
       { 
@@ -275,7 +328,7 @@ namespace sbnd::crt {
             line->SetLineColor(fTrueTrackColour);
             line->SetLineWidth(fLineWidth+4);
             line->SetLineStyle(9);
-            line->Draw();
+            eventLayer.Add(line);
           
             if(fPrint) std::cout<<"MCParticle, Track ID: " << part.TrackId() << " PDG: " << part.PdgCode() << ", traj points: "<<npts<<", start = ("<<start.X()<<", "<<start.Y()<<", "
                                 <<start.Z()<<"), end = ("<<end.X()<<", "<<end.Y()<<", "<<end.Z()<<")\n";
@@ -314,7 +367,7 @@ namespace sbnd::crt {
                             << ")  +/- (" << ex << ", " << ey << ", " << ez << ") by trackID: " 
                             << ide.trackID << " at t = " << t << std::endl;
 
-                DrawCube(c1, rmin, rmax, fSimDepositColour);
+                AddCube(eventLayer, rmin, rmax, fSimDepositColour);
               }
           }     
       }
@@ -330,7 +383,7 @@ namespace sbnd::crt {
             if(stripHit->Ts1() - G4RefTime < fMinTime || stripHit->Ts1() - G4RefTime > fMaxTime)
               continue;
 
-            CRTStripGeo strip = fCRTGeoAlg.GetStrip(stripHit->Channel());
+            CRTStripGeo strip = fCRTGeoAlg->GetStrip(stripHit->Channel());
 
             double rmin[3] = {strip.minX, strip.minY, strip.minZ};
             double rmax[3] = {strip.maxX, strip.maxY, strip.maxZ};
@@ -346,7 +399,7 @@ namespace sbnd::crt {
                         << " with completeness: " << truthMatch.completeness 
                         << " and purity: " << truthMatch.purity << std::endl;
 
-            DrawCube(c1, rmin, rmax, fStripHitColour);
+            AddCube(eventLayer, rmin, rmax, fStripHitColour);
           }
       }
 
@@ -372,12 +425,12 @@ namespace sbnd::crt {
               {
                 for(auto stripHit : stripHitVec)
                   {
-                    CRTStripGeo strip = fCRTGeoAlg.GetStrip(stripHit->Channel());
+                    CRTStripGeo strip = fCRTGeoAlg->GetStrip(stripHit->Channel());
                     
                     double rmin[3] = {strip.minX, strip.minY, strip.minZ};
                     double rmax[3] = {strip.maxX, strip.maxY, strip.maxZ};
                     
-                    DrawCube(c1, rmin, rmax, colour);
+                    AddCube(eventLayer, rmin, rmax, colour);
                   }
 
                 CRTBackTrackerAlg::TruthMatchMetrics truthMatch = fCRTBackTrackerAlg.TruthMatching(event, cluster);
@@ -403,7 +456,7 @@ namespace sbnd::crt {
                     double rmin[3] = {pos.X() - err.X(), pos.Y() - err.Y(), pos.Z() - err.Z()};
                     double rmax[3] = {pos.X() + err.X(), pos.Y() + err.Y(), pos.Z() + err.Z()};
 
-                    DrawCube(c1, rmin, rmax, fSpacePointColour);
+                    AddCube(eventLayer, rmin, rmax, fSpacePointColour);
 
                     if(fPrint)
                       std::cout << "Space Point: (" 
@@ -458,7 +511,7 @@ namespace sbnd::crt {
 
             line->SetLineColor(fTrackColour);
             line->SetLineWidth(fLineWidth);
-            line->Draw();
+            eventLayer.Add(line);
 
             if(fPrint)
               std::cout << "Track at (" << start.X() << ", " << start.Y() << ", " << start.Z() << ")\n"
@@ -471,7 +524,15 @@ namespace sbnd::crt {
           }
       }
 
-    c1->SaveAs(Form("crtEventDisplayEvent%d.root", event.event()));
+    TCanvas *c1 = new TCanvas("c1","",700,700);
+    c1->cd();
+
+    for(TObject *obj : fDetectorLayer)
+      obj->Draw();
+    for(TObject *obj : eventLayer)
+      obj->Draw();
+
+    c1->SaveAs(Form("%s/crtEventDisplayEvent%d.%s", fOutputDirectory.c_str(), event.event(), fOutputFormat.c_str()));
     delete c1;
   }
 
@@ -41,6 +41,7 @@
 // ROOT
 #include "TPolyLine3D.h"
 #include "TCanvas.h"
+#include "TList.h"
 
 namespace detinfo { class DetectorClocksData; }
 
@@ -179,6 +180,22 @@ namespace sbnd::crt {
       fhicl::Atom<double> LineWidth {
         Name("LineWidth")
           };
+
+      fhicl::Atom<bool> BatchMode {
+        Name("BatchMode"),
+        Comment("Render in ROOT batch mode, without opening any window"),
+        false
+      };
+      fhicl::Atom<std::string> OutputFormat {
+        Name("OutputFormat"),
+        Comment("Extension of the file each event is saved to (root, png, pdf...)"),
+        "root"
+      };
+      fhicl::Atom<std::string> OutputDirectory {
+        Name("OutputDirectory"),
+        Comment("Directory the event files are written to"),
+        "."
+      };
     };
     
     CRTEventDisplayAlg(const Config& config);
@@ -208,9 +225,16 @@ namespace sbnd::crt {
     bool IsPointInsideBox(const std::vector<double> &lims, const geo::Point_t &p);
 
   private:
+
+    // Adds the outline of a box to the list, which owns the lines
+    void AddCube(TList &list, double *rmin, double *rmax, int colour);
+
+    // Fills fDetectorLayer with the taggers, modules, FEBs, strips and TPC
+    // selected in the configuration
+    void BuildDetectorLayer();
     
     TPCGeoAlg         fTPCGeoAlg;
-    CRTGeoAlg         fCRTGeoAlg;
+    std::shared_ptr<const CRTGeoAlg>         fCRTGeoAlg;
     CRTBackTrackerAlg fCRTBackTrackerAlg;
 
     art::ServiceHandle<cheat::ParticleInventoryService> particleInv;
@@ -256,6 +280,15 @@ namespace sbnd::crt {
     bool fPrint;
 
     double fLineWidth;
+
+    bool        fBatchMode;
+    std::string fOutputFormat;
+    std::string fOutputDirectory;
+
+    // Outlines of the detector, drawn under the products of every event;
+    // built at the first event and rebuilt after a change of what to draw
+    TList fDetectorLayer;
+    bool  fDetectorLayerBuilt = false;
   };
 }
 
@@ -9,6 +9,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "sbndcode/CRT/CRTGeoObjectSorter.h"
+#include "sbndcode/Geometry/SortByKey.h"
 #include "larcorealg/Geometry/AuxDetGeo.h"
 #include "larcorealg/Geometry/AuxDetSensitiveGeo.h"
 
@@ -16,11 +17,9 @@ namespace geo {
 
   //----------------------------------------------------------------------------
   // Define sort order for AuxDets in standard configuration
-  static bool sortAuxDetSBND(const AuxDetGeo& ad1, const AuxDetGeo& ad2) {
+  static bool sortAuxDetSBND(const Point_t& c1, const Point_t& c2) {
     // Sort using the center of the detector - primary ordering by z,
     // then y, and x
-    auto const c1 = ad1.GetCenter();
-    auto const c2 = ad2.GetCenter();
 
     if (c1.Z() != c2.Z()) {
       return c1.Z() < c2.Z();
@@ -33,13 +32,11 @@ namespace geo {
 
   //----------------------------------------------------------------------------
   // Define sort order for AuxDetSensitives in standard configuration
-  static bool sortAuxDetSensitiveSBND(const AuxDetSensitiveGeo& ad1,
-                                      const AuxDetSensitiveGeo& ad2)
+  static bool sortAuxDetSensitiveSBND(const Point_t& c1,
+                                      const Point_t& c2)
   {
     // Sort using the center of the detector - primary ordering by z,
     // then y, and x
-    auto const c1 = ad1.GetCenter();
-    auto const c2 = ad2.GetCenter();
 
     if (c1.Z() != c2.Z()) {
       return c1.Z() < c2.Z();
@@ -57,13 +54,18 @@ namespace geo {
   //----------------------------------------------------------------------------
   void CRTGeoObjectSorter::SortAuxDets(
       std::vector<geo::AuxDetGeo> & adgeo) const {
-    std::sort(adgeo.begin(), adgeo.end(), sortAuxDetSBND);
+    // the centers are computed once per detector (see SortByKey.h)
+    details::SortByKey(adgeo,
+      [](const AuxDetGeo& ad){ return Point_t(ad.GetCenter()); },
+      sortAuxDetSBND);
   }
 
   //----------------------------------------------------------------------------
   void CRTGeoObjectSorter::SortAuxDetSensitive(
       std::vector<geo::AuxDetSensitiveGeo> & adsgeo) const {
-    std::sort(adsgeo.begin(), adsgeo.end(), sortAuxDetSensitiveSBND);
+    details::SortByKey(adsgeo,
+      [](const AuxDetSensitiveGeo& ads){ return Point_t(ads.GetCenter()); },
+      sortAuxDetSensitiveSBND);
   }
 
 }  // namespace geo
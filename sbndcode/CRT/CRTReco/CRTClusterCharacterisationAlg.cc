@@ -1,9 +1,34 @@
 #include "CRTClusterCharacterisationAlg.h"
 
+namespace {
+
+  // Box common to two strip hits
+  std::array<double, 6> Intersection(const std::array<double, 6> &pos0, const std::array<double, 6> &pos1)
+  {
+    return std::array<double, 6>({std::max(pos0[0], pos1[0]),
+                                  std::min(pos0[1], pos1[1]),
+                                  std::max(pos0[2], pos1[2]),
+                                  std::min(pos0[3], pos1[3]),
+                                  std::max(pos0[4], pos1[4]),
+                                  std::min(pos0[5], pos1[5])});
+  }
+
+  // Box enclosing two strip hits
+  std::array<double, 6> Envelope(const std::array<double, 6> &pos0, const std::array<double, 6> &pos1)
+  {
+    return std::array<double, 6>({std::min(pos0[0], pos1[0]),
+                                  std::max(pos0[1], pos1[1]),
+                                  std::min(pos0[2], pos1[2]),
+                                  std::max(pos0[3], pos1[3]),
+                                  std::min(pos0[4], pos1[4]),
+                                  std::max(pos0[5], pos1[5])});
+  }
+}
+
 namespace sbnd::crt {
   
   CRTClusterCharacterisationAlg::CRTClusterCharacterisationAlg(const fhicl::ParameterSet& pset)
-    : fCRTGeoAlg(pset.get<fhicl::ParameterSet>("GeoAlg", fhicl::ParameterSet()))
+    : fCRTGeoAlg(CRTGeoAlg::Shared(pset.get<fhicl::ParameterSet>("GeoAlg", fhicl::ParameterSet())))
     , fUseT1(pset.get<bool>("UseT1"))
     , fTimeOffset(pset.get<double>("TimeOffset"))
     , fOverlapBuffer(pset.get<double>("OverlapBuffer"))
@@ -22,7 +47,7 @@ namespace sbnd::crt {
 
   CRTSpacePoint CRTClusterCharacterisationAlg::CharacteriseSingleHitCluster(const art::Ptr<CRTCluster> &cluster, const art::Ptr<CRTStripHit> &stripHit)
   {
-    const std::array<double, 6> hitPos = fCRTGeoAlg.StripHit3DPos(stripHit->Channel(), stripHit->Pos(), stripHit->Error());
+    const std::array<double, 6> hitPos = fCRTGeoAlg->StripHit3DPos(stripHit->Channel(), stripHit->Pos(), stripHit->Error());
 
     const double pe = ADCToPE(stripHit->Channel(), stripHit->ADC1(), stripHit->ADC2());
     
@@ -42,38 +67,81 @@ namespace sbnd::crt {
 
   bool CRTClusterCharacterisationAlg::TwoHitSpacePoint(const art::Ptr<CRTStripHit> hit0, const art::Ptr<CRTStripHit> hit1, CRTSpacePoint &spacepoint)
   {
-    const bool threeD = fCRTGeoAlg.ChannelToOrientation(hit0->Channel()) != fCRTGeoAlg.ChannelToOrientation(hit1->Channel());
+    return TwoHitSpacePoint(MakeStripHitGeometry(hit0), MakeStripHitGeometry(hit1), spacepoint);
+  }
+
+  CRTClusterCharacterisationAlg::StripHitGeometry CRTClusterCharacterisationAlg::MakeStripHitGeometry(const art::Ptr<CRTStripHit> &hit)
+  {
+    StripHitGeometry hitGeo;
+    hitGeo.hit         = hit;
+    hitGeo.strip       = &fCRTGeoAlg->GetStrip(hit->Channel());
+    hitGeo.orientation = fCRTGeoAlg->ChannelToOrientation(hit->Channel());
+    hitGeo.pos         = fCRTGeoAlg->StripHit3DPos(hit->Channel(), hit->Pos(), hit->Error());
+    hitGeo.pe          = ADCToPE(hit->Channel(), hit->ADC1(), hit->ADC2());
+
+    // Same choice of axis as CRTGeoAlg::DistanceDownStrip
+    const CRTStripGeo &strip = *hitGeo.strip;
+    const geo::Point_t sipm  = fCRTGeoAlg->ChannelToSipmPosition(strip.channel0);
+
+    const double xdiff = std::abs(strip.maxX-strip.minX);
+    const double ydiff = std::abs(strip.maxY-strip.minY);
+    const double zdiff = std::abs(strip.maxZ-strip.minZ);
+
+    hitGeo.axis      = -1;
+    hitGeo.sipmCoord = 0.;
+
+    if(xdiff > ydiff && xdiff > zdiff)      { hitGeo.axis = 0; hitGeo.sipmCoord = sipm.X(); }
+    else if(ydiff > xdiff && ydiff > zdiff) { hitGeo.axis = 1; hitGeo.sipmCoord = sipm.Y(); }
+    else if(zdiff > xdiff && zdiff > ydiff) { hitGeo.axis = 2; hitGeo.sipmCoord = sipm.Z(); }
+
+    return hitGeo;
+  }
+
+  bool CRTClusterCharacterisationAlg::TwoHitSpacePoint(const StripHitGeometry &hit0, const StripHitGeometry &hit1, CRTSpacePoint &spacepoint)
+  {
+    const bool threeD = hit0.orientation != hit1.orientation;
 
     if(threeD)
       {
-        if(fCRTGeoAlg.CheckOverlap(hit0->Channel(), hit1->Channel(), fOverlapBuffer))
+        if(fCRTGeoAlg->CheckOverlap(*hit0.strip, *hit1.strip, fOverlapBuffer))
           {
-            std::array<double, 6> overlap = FindOverlap(hit0, hit1);
-            
+            const std::array<double, 6> overlap = Intersection(hit0.pos, hit1.pos);
+
             geo::Point_t pos, err;
             CentralPosition(overlap, pos, err);
 
-            const double pe   = ReconstructPE(hit0, hit1, pos);
-            double time, etime;
-            CorrectTime(hit0, hit1, pos, time, etime);
+            const double dist0 = DistanceDownStrip(hit0, pos);
+            const double dist1 = DistanceDownStrip(hit1, pos);
 
-            spacepoint = CRTSpacePoint(pos, err, pe, time + fTimeOffset, etime, true);
+            const double pe0 = ReconstructPE(hit0, dist0);
+            const double pe1 = ReconstructPE(hit1, dist1);
+
+            const double corr0 = TimingCorrectionOffset(dist0, pe0);
+            const double corr1 = TimingCorrectionOffset(dist1, pe1);
+
+            const double ts0 = fUseT1 ? (double)hit0.hit->Ts1() : (double)hit0.hit->Ts0();
+            const double ts1 = fUseT1 ? (double)hit1.hit->Ts1() : (double)hit1.hit->Ts0();
+
+            const double time  = (ts0 - corr0 + ts1 - corr1) / 2.;
+            const double etime = std::abs((ts0 - corr0) - (ts1 - corr1)) / 2.;
+
+            spacepoint = CRTSpacePoint(pos, err, pe0 + pe1, time + fTimeOffset, etime, true);
             return true;
           }
         return false;
       }
     else
       {
-        if(fCRTGeoAlg.AdjacentStrips(hit0->Channel(), hit1->Channel(), fOverlapBuffer))
+        if(fCRTGeoAlg->AdjacentStrips(*hit0.strip, *hit1.strip, fOverlapBuffer))
           {
-            std::array<double, 6> overlap = FindAdjacentPosition(hit0, hit1);
+            const std::array<double, 6> overlap = Envelope(hit0.pos, hit1.pos);
 
             geo::Point_t pos, err;
             CentralPosition(overlap, pos, err);
 
-            const double pe   = ADCToPE(hit0->Channel(), hit0->ADC1(), hit0->ADC2()) + ADCToPE(hit1->Channel(), hit1->ADC1(), hit1->ADC2());
-            const double time  = (hit0->Ts1() + hit1->Ts1()) / 2.;
-            const double etime = std::abs((double)hit0->Ts1() - (double)hit1->Ts1()) / 2.;
+            const double pe    = hit0.pe + hit1.pe;
+            const double time  = (hit0.hit->Ts1() + hit1.hit->Ts1()) / 2.;
+            const double etime = std::abs((double)hit0.hit->Ts1() - (double)hit1.hit->Ts1()) / 2.;
 
             spacepoint = CRTSpacePoint(pos, err, pe, time + fTimeOffset, etime, false);
             return true;
@@ -82,26 +150,50 @@ namespace sbnd::crt {
       }
   }
 
+  double CRTClusterCharacterisationAlg::DistanceDownStrip(const StripHitGeometry &hit, const geo::Point_t &pos) const
+  {
+    switch(hit.axis)
+      {
+      case 0:
+        return std::abs(pos.X() - hit.sipmCoord);
+      case 1:
+        return std::abs(pos.Y() - hit.sipmCoord);
+      case 2:
+        return std::abs(pos.Z() - hit.sipmCoord);
+      default:
+        return std::numeric_limits<double>::max();
+      }
+  }
+
+  double CRTClusterCharacterisationAlg::ReconstructPE(const StripHitGeometry &hit, const double dist) const
+  {
+    const double correction = std::pow(dist - fPEAttenuation, 2) / std::pow(fPEAttenuation, 2);
+
+    return hit.pe * correction;
+  }
+
   bool CRTClusterCharacterisationAlg::CharacteriseMultiHitCluster(const art::Ptr<CRTCluster> &cluster, const std::vector<art::Ptr<CRTStripHit>> &stripHits, CRTSpacePoint &spacepoint)
   {
-    std::vector<CRTSpacePoint> spacepoints, complete_spacepoints;
+    std::vector<CRTSpacePoint> complete_spacepoints;
 
-    for(unsigned i = 0; i < stripHits.size(); ++i)
-      {
-        const art::Ptr<CRTStripHit> hit0 = stripHits[i];
+    std::vector<StripHitGeometry> hitGeos;
+    hitGeos.reserve(stripHits.size());
 
-        for(unsigned ii = i + 1; ii < stripHits.size(); ++ii)
+    for(auto const &hit : stripHits)
+      hitGeos.push_back(MakeStripHitGeometry(hit));
+
+    // Only pairs from the two layers of a tagger make complete space points,
+    // so the pairs within a layer are not evaluated at all.
+    for(unsigned i = 0; i < hitGeos.size(); ++i)
+      {
+        for(unsigned ii = i + 1; ii < hitGeos.size(); ++ii)
           {
-            const art::Ptr<CRTStripHit> hit1 = stripHits[ii];
+            if(hitGeos[i].orientation == hitGeos[ii].orientation)
+              continue;
 
             CRTSpacePoint sp;
-            if(TwoHitSpacePoint(hit0, hit1, sp))
-              {
-                spacepoints.push_back(sp);
-        
-                if(sp.Complete()) 
-                  complete_spacepoints.push_back(sp);
-              }
+            if(TwoHitSpacePoint(hitGeos[i], hitGeos[ii], sp) && sp.Complete())
+              complete_spacepoints.push_back(sp);
           }
       }
 
@@ -134,37 +226,23 @@ namespace sbnd::crt {
 
   double CRTClusterCharacterisationAlg::ADCToPE(const uint16_t channel, const uint16_t adc)
   {
-    return fCRTGeoAlg.GetSiPM(channel).gain * adc;
+    return fCRTGeoAlg->SiPMGain(channel) * adc;
   }
 
   std::array<double, 6> CRTClusterCharacterisationAlg::FindOverlap(const art::Ptr<CRTStripHit> &hit0, const art::Ptr<CRTStripHit> &hit1)
   {
-    const std::array<double, 6> hit0pos = fCRTGeoAlg.StripHit3DPos(hit0->Channel(), hit0->Pos(), hit0->Error());
-    const std::array<double, 6> hit1pos = fCRTGeoAlg.StripHit3DPos(hit1->Channel(), hit1->Pos(), hit1->Error());
+    const std::array<double, 6> hit0pos = fCRTGeoAlg->StripHit3DPos(hit0->Channel(), hit0->Pos(), hit0->Error());
+    const std::array<double, 6> hit1pos = fCRTGeoAlg->StripHit3DPos(hit1->Channel(), hit1->Pos(), hit1->Error());
 
-    std::array<double, 6> overlap({std::max(hit0pos[0], hit1pos[0]),
-                                   std::min(hit0pos[1], hit1pos[1]),
-                                   std::max(hit0pos[2], hit1pos[2]),
-                                   std::min(hit0pos[3], hit1pos[3]),
-                                   std::max(hit0pos[4], hit1pos[4]),
-                                   std::min(hit0pos[5], hit1pos[5])});
-
-    return overlap;
+    return Intersection(hit0pos, hit1pos);
   }
 
   std::array<double, 6> CRTClusterCharacterisationAlg::FindAdjacentPosition(const art::Ptr<CRTStripHit> &hit0, const art::Ptr<CRTStripHit> &hit1)
   {
-    const std::array<double, 6> hit0pos = fCRTGeoAlg.StripHit3DPos(hit0->Channel(), hit0->Pos(), hit0->Error());
-    const std::array<double, 6> hit1pos = fCRTGeoAlg.StripHit3DPos(hit1->Channel(), hit1->Pos(), hit1->Error());
-
-    std::array<double, 6> overlap({std::min(hit0pos[0], hit1pos[0]),
-                                   std::max(hit0pos[1], hit1pos[1]),
-                                   std::min(hit0pos[2], hit1pos[2]),
-                                   std::max(hit0pos[3], hit1pos[3]),
-                                   std::min(hit0pos[4], hit1pos[4]),
-                                   std::max(hit0pos[5], hit1pos[5])});
+    const std::array<double, 6> hit0pos = fCRTGeoAlg->StripHit3DPos(hit0->Channel(), hit0->Pos(), hit0->Error());
+    const std::array<double, 6> hit1pos = fCRTGeoAlg->StripHit3DPos(hit1->Channel(), hit1->Pos(), hit1->Error());
 
-    return overlap;
+    return Envelope(hit0pos, hit1pos);
   }
 
   void CRTClusterCharacterisationAlg::CentralPosition(const std::array<double, 6> overlap, 
@@ -181,8 +259,8 @@ namespace sbnd::crt {
 
   double CRTClusterCharacterisationAlg::ReconstructPE(const art::Ptr<CRTStripHit> &hit0, const art::Ptr<CRTStripHit> &hit1, const geo::Point_t &pos)
   {
-    const double dist0 = fCRTGeoAlg.DistanceDownStrip(pos, hit0->Channel());
-    const double dist1 = fCRTGeoAlg.DistanceDownStrip(pos, hit1->Channel());
+    const double dist0 = fCRTGeoAlg->DistanceDownStrip(pos, hit0->Channel());
+    const double dist1 = fCRTGeoAlg->DistanceDownStrip(pos, hit1->Channel());
 
     return ReconstructPE(hit0, dist0) + ReconstructPE(hit1, dist1);
   }
@@ -198,8 +276,8 @@ namespace sbnd::crt {
   void CRTClusterCharacterisationAlg::CorrectTime(const art::Ptr<CRTStripHit> &hit0, const art::Ptr<CRTStripHit> &hit1, const geo::Point_t &pos,
                                                   double &time, double &etime)
   {
-    const double dist0 = fCRTGeoAlg.DistanceDownStrip(pos, hit0->Channel());
-    const double dist1 = fCRTGeoAlg.DistanceDownStrip(pos, hit1->Channel());
+    const double dist0 = fCRTGeoAlg->DistanceDownStrip(pos, hit0->Channel());
+    const double dist1 = fCRTGeoAlg->DistanceDownStrip(pos, hit1->Channel());
 
     const double pe0 = ReconstructPE(hit0, dist0);
     const double pe1 = ReconstructPE(hit1, dist1);
@@ -75,7 +75,27 @@ namespace sbnd::crt {
 
   private:
 
-    CRTGeoAlg fCRTGeoAlg;
+    // Geometry of a strip hit, looked up once per cluster so that the pair
+    // loops of the multi-hit clusters do not go back to the geometry.
+    struct StripHitGeometry {
+      art::Ptr<CRTStripHit>  hit;
+      const CRTStripGeo     *strip;
+      size_t                 orientation;
+      std::array<double, 6>  pos;       // StripHit3DPos of the hit
+      double                 pe;        // uncorrected PE of the two SiPMs
+      int                    axis;      // world axis along the strip, -1 if ill-defined
+      double                 sipmCoord; // SiPM coordinate along that axis
+    };
+
+    StripHitGeometry MakeStripHitGeometry(const art::Ptr<CRTStripHit> &hit);
+
+    bool TwoHitSpacePoint(const StripHitGeometry &hit0, const StripHitGeometry &hit1, CRTSpacePoint &spacepoint);
+
+    double DistanceDownStrip(const StripHitGeometry &hit, const geo::Point_t &pos) const;
+
+    double ReconstructPE(const StripHitGeometry &hit, const double dist) const;
+
+    std::shared_ptr<const CRTGeoAlg> fCRTGeoAlg;
 
     bool   fUseT1;
     double fTimeOffset;
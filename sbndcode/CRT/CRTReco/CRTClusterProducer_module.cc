@@ -6,7 +6,7 @@
 // Author:      Henry Lay (h.lay@lancaster.ac.uk)
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -17,14 +17,16 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
-#include "lardata/Utilities/AssociationUtil.h"
-
 #include "sbnobj/SBND/CRT/CRTStripHit.hh"
 #include "sbnobj/SBND/CRT/CRTCluster.hh"
 
 #include "sbndcode/Geometry/GeometryWrappers/CRTGeoAlg.h"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
+#include "sbndcode/CRT/CRTUtils/CRTAssnsCollector.h"
+
+#include "tbb/parallel_for.h"
 
+#include <array>
 #include <memory>
 
 namespace sbnd::crt {
@@ -32,18 +34,25 @@ namespace sbnd::crt {
 }
 
 
-class sbnd::crt::CRTClusterProducer : public art::EDProducer {
+class sbnd::crt::CRTClusterProducer : public art::SharedProducer {
 public:
-  explicit CRTClusterProducer(fhicl::ParameterSet const& p);
+  // One slot per tagger, kBottomTagger to kTopHighTagger, after a first slot for hits on an undefined tagger
+  static constexpr size_t kNTaggerSlots = kTopHighTagger + 2;
+
+  using TaggerStripHits_t = std::array<std::vector<art::Ptr<CRTStripHit>>, kNTaggerSlots>;
+
+  explicit CRTClusterProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   CRTClusterProducer(CRTClusterProducer const&) = delete;
   CRTClusterProducer(CRTClusterProducer&&) = delete;
   CRTClusterProducer& operator=(CRTClusterProducer const&) = delete;
   CRTClusterProducer& operator=(CRTClusterProducer&&) = delete;
 
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
+
+  size_t TaggerSlot(const CRTTagger tagger) const;
 
-  std::map<CRTTagger, std::vector<art::Ptr<CRTStripHit>>> GroupStripHits(const std::vector<art::Ptr<CRTStripHit>> &CRTStripHitVec);
+  TaggerStripHits_t GroupStripHits(const std::vector<art::Ptr<CRTStripHit>> &CRTStripHitVec);
 
   std::vector<std::pair<CRTCluster, std::vector<art::Ptr<CRTStripHit>>>> CreateClusters(const std::vector<art::Ptr<CRTStripHit>> &stripHits);
 
@@ -53,25 +62,28 @@ public:
 
 private:
 
-  CRTGeoAlg   fCRTGeoAlg;
+  std::shared_ptr<const CRTGeoAlg>   fCRTGeoAlg;
   std::string fCRTStripHitModuleLabel;
   uint32_t    fCoincidenceTimeRequirement;
   double      fOverlapBuffer;
+  bool        fUseTaggerWorkers;
 };
 
 
-sbnd::crt::CRTClusterProducer::CRTClusterProducer(fhicl::ParameterSet const& p)
-  : EDProducer{p}
-  , fCRTGeoAlg(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet()))
+sbnd::crt::CRTClusterProducer::CRTClusterProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p}
+  , fCRTGeoAlg(CRTGeoAlg::Shared(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet())))
   , fCRTStripHitModuleLabel(p.get<std::string>("CRTStripHitModuleLabel"))
   , fCoincidenceTimeRequirement(p.get<uint32_t>("CoincidenceTimeRequirement"))
   , fOverlapBuffer(p.get<double>("OverlapBuffer"))
+  , fUseTaggerWorkers(p.get<bool>("UseTaggerWorkers", false))
   {
     produces<std::vector<CRTCluster>>();
     produces<art::Assns<CRTCluster, CRTStripHit>>();
+    async<art::InEvent>();
   }
 
-void sbnd::crt::CRTClusterProducer::produce(art::Event& e)
+void sbnd::crt::CRTClusterProducer::produce(art::Event& e, art::ProcessingFrame const&)
 {
   auto clusterVec          = std::make_unique<std::vector<CRTCluster>>();
   auto clusterStripHitAssn = std::make_unique<art::Assns<CRTCluster, CRTStripHit>>();
@@ -82,44 +94,70 @@ void sbnd::crt::CRTClusterProducer::produce(art::Event& e)
   std::vector<art::Ptr<CRTStripHit>> CRTStripHitVec;
   art::fill_ptr_vector(CRTStripHitVec, CRTStripHitHandle);
 
-  std::map<CRTTagger, std::vector<art::Ptr<CRTStripHit>>> taggerStripHitsMap = GroupStripHits(CRTStripHitVec);
+  TaggerStripHits_t taggerStripHits = GroupStripHits(CRTStripHitVec);
+
+  // The taggers are clustered independently, each into its own buffer
+  std::array<std::vector<std::pair<CRTCluster, std::vector<art::Ptr<CRTStripHit>>>>, kNTaggerSlots> taggerClusters;
+
+  auto clusterTagger = [&](const size_t slot) {
+    std::vector<art::Ptr<CRTStripHit>> &stripHits = taggerStripHits[slot];
+
+    if(stripHits.empty())
+      return;
+
+    std::sort(stripHits.begin(), stripHits.end(), [](art::Ptr<CRTStripHit> &a, art::Ptr<CRTStripHit> &b)->bool{
+        return a->Ts1() < b->Ts1();});
+
+    taggerClusters[slot] = CreateClusters(stripHits);
+  };
 
-  for(auto& [tagger, stripHits] : taggerStripHitsMap)
+  if(fUseTaggerWorkers)
+    tbb::parallel_for(size_t(0), kNTaggerSlots, clusterTagger);
+  else
     {
-      std::sort(stripHits.begin(), stripHits.end(), [](art::Ptr<CRTStripHit> &a, art::Ptr<CRTStripHit> &b)->bool{
-          return a->Ts1() < b->Ts1();});
+      for(size_t slot = 0; slot < kNTaggerSlots; ++slot)
+        clusterTagger(slot);
+    }
 
-      std::vector<std::pair<CRTCluster, std::vector<art::Ptr<CRTStripHit>>>> clustersAndHits = CreateClusters(stripHits);
+  // Concatenated in tagger order whichever way they were made
+  CRTAssnsCollector<CRTCluster, CRTStripHit> clusterStripHits;
+  clusterStripHits.Reserve(CRTStripHitVec.size());
 
+  for(auto const& clustersAndHits : taggerClusters)
+    {
       for(auto const& [cluster, clusteredHits] : clustersAndHits)
         {
           clusterVec->push_back(cluster);
-          util::CreateAssn(*this, e, *clusterVec, clusteredHits, *clusterStripHitAssn);
+          clusterStripHits.Add(clusterVec->size() - 1, clusteredHits);
         }
     }
 
+  clusterStripHits.Fill(e, *clusterStripHitAssn);
+
   e.put(std::move(clusterVec));
   e.put(std::move(clusterStripHitAssn));
 }
 
-std::map<sbnd::crt::CRTTagger, std::vector<art::Ptr<sbnd::crt::CRTStripHit>>> sbnd::crt::CRTClusterProducer::GroupStripHits(const std::vector<art::Ptr<CRTStripHit>> &CRTStripHitVec)
+size_t sbnd::crt::CRTClusterProducer::TaggerSlot(const CRTTagger tagger) const
 {
-  std::map<CRTTagger, std::vector<art::Ptr<CRTStripHit>>> taggerStripHitsMap;
+  if(tagger < kBottomTagger || tagger > kTopHighTagger)
+    return 0;
+
+  return tagger - kBottomTagger + 1;
+}
+
+sbnd::crt::CRTClusterProducer::TaggerStripHits_t sbnd::crt::CRTClusterProducer::GroupStripHits(const std::vector<art::Ptr<CRTStripHit>> &CRTStripHitVec)
+{
+  TaggerStripHits_t taggerStripHits;
 
   for(const art::Ptr<CRTStripHit> &stripHit : CRTStripHitVec)
     {
-      CRTTagger tagger = fCRTGeoAlg.ChannelToTaggerEnum(stripHit->Channel());
+      const CRTTagger tagger = fCRTGeoAlg->ChannelToTaggerEnum(stripHit->Channel());
 
-      if(taggerStripHitsMap.find(tagger) != taggerStripHitsMap.end())
-        taggerStripHitsMap[tagger].push_back(stripHit);
-      else
-        {
-          taggerStripHitsMap[tagger] = std::vector<art::Ptr<CRTStripHit>>();
-          taggerStripHitsMap[tagger].push_back(stripHit);
-        }
+      taggerStripHits[TaggerSlot(tagger)].push_back(stripHit);
     }
 
-  return taggerStripHitsMap;
+  return taggerStripHits;
 }
 
 std::vector<std::pair<sbnd::crt::CRTCluster, std::vector<art::Ptr<sbnd::crt::CRTStripHit>>>> sbnd::crt::CRTClusterProducer::CreateClusters(const std::vector<art::Ptr<CRTStripHit>> &stripHits)
@@ -178,7 +216,7 @@ std::vector<std::pair<sbnd::crt::CRTCluster, std::vector<art::Ptr<sbnd::crt::CRT
           for(uint16_t jj = 0; jj < hits.size(); ++jj)
             {
               const art::Ptr<CRTStripHit> &hit2 = hits[jj];
-              if(fCRTGeoAlg.CheckOverlap(hit1->Channel(), hit2->Channel(), 10.))
+              if(fCRTGeoAlg->CheckOverlap(hit1->Channel(), hit2->Channel(), 10.))
                 overlaps[j].insert(jj);
             }
         }
@@ -234,8 +272,8 @@ sbnd::crt::CRTCluster sbnd::crt::CRTClusterProducer::CharacteriseCluster(const s
 {
   const uint16_t nHits = clusteredHits.size();
 
-  const CRTStripGeo strip0 = fCRTGeoAlg.GetStrip(clusteredHits.at(0)->Channel());
-  const CRTTagger tagger = fCRTGeoAlg.ChannelToTaggerEnum(clusteredHits.at(0)->Channel());
+  const CRTStripGeo strip0 = fCRTGeoAlg->GetStrip(clusteredHits.at(0)->Channel());
+  const CRTTagger tagger = fCRTGeoAlg->ChannelToTaggerEnum(clusteredHits.at(0)->Channel());
 
   uint32_t ts0 = 0, ts1 = 0, s = 0;
   CoordSet composition = kUndefinedSet;
@@ -248,13 +286,13 @@ sbnd::crt::CRTCluster sbnd::crt::CRTClusterProducer::CharacteriseCluster(const s
       ts1 += hit->Ts1();
       s   += hit->UnixS();
 
-      const CRTStripGeo strip = fCRTGeoAlg.GetStrip(hit->Channel());
-      if(fCRTGeoAlg.DifferentOrientations(strip0, strip))
+      const CRTStripGeo strip = fCRTGeoAlg->GetStrip(hit->Channel());
+      if(fCRTGeoAlg->DifferentOrientations(strip0, strip))
         composition = kXYZ;
     }
 
   if(composition == kUndefinedSet)
-    composition = fCRTGeoAlg.GlobalConstrainedCoordinates(strip0.channel0);
+    composition = fCRTGeoAlg->GlobalConstrainedCoordinates(strip0.channel0);
 
   s   /= nHits;
   ts0 /= nHits;
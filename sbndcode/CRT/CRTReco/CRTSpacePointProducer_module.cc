@@ -6,7 +6,7 @@
 // Author:      Henry Lay (h.lay@lancaster.ac.uk)
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -17,24 +17,24 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
-#include "lardata/Utilities/AssociationUtil.h"
-
 #include "sbndcode/CRT/CRTReco/CRTClusterCharacterisationAlg.h"
+#include "sbndcode/CRT/CRTUtils/CRTAssnsCollector.h"
+#include "sbndcode/Utilities/EventPerformance.h"
 
 namespace sbnd::crt {
   class CRTSpacePointProducer;
 }
 
-class sbnd::crt::CRTSpacePointProducer : public art::EDProducer {
+class sbnd::crt::CRTSpacePointProducer : public art::SharedProducer {
 public:
-  explicit CRTSpacePointProducer(fhicl::ParameterSet const& p);
+  explicit CRTSpacePointProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   CRTSpacePointProducer(CRTSpacePointProducer const&) = delete;
   CRTSpacePointProducer(CRTSpacePointProducer&&) = delete;
   CRTSpacePointProducer& operator=(CRTSpacePointProducer const&) = delete;
   CRTSpacePointProducer& operator=(CRTSpacePointProducer&&) = delete;
 
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
 
 private:
 
@@ -43,16 +43,17 @@ private:
 };
 
 
-sbnd::crt::CRTSpacePointProducer::CRTSpacePointProducer(fhicl::ParameterSet const& p)
-  : EDProducer{p}
+sbnd::crt::CRTSpacePointProducer::CRTSpacePointProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p}
   , fClusterCharacAlg(p.get<fhicl::ParameterSet>("ClusterCharacterisationAlg", fhicl::ParameterSet()))
   , fClusterModuleLabel(p.get<std::string>("ClusterModuleLabel"))
   {
     produces<std::vector<CRTSpacePoint>>();
     produces<art::Assns<CRTCluster, CRTSpacePoint>>();
+    async<art::InEvent>();
   }
 
-void sbnd::crt::CRTSpacePointProducer::produce(art::Event& e)
+void sbnd::crt::CRTSpacePointProducer::produce(art::Event& e, art::ProcessingFrame const&)
 {
   auto spacePointVec         = std::make_unique<std::vector<CRTSpacePoint>>();
   auto spacePointClusterAssn = std::make_unique<art::Assns<CRTCluster, CRTSpacePoint>>();
@@ -65,6 +66,9 @@ void sbnd::crt::CRTSpacePointProducer::produce(art::Event& e)
 
   art::FindManyP<CRTStripHit> clusterToStripHits(clusterHandle, e, fClusterModuleLabel);
 
+  CRTAssnsCollector<CRTSpacePoint, CRTCluster> spacePointClusters;
+  spacePointClusters.Reserve(clusterVec.size());
+
   for(const art::Ptr<CRTCluster> &cluster : clusterVec)
     {
       const uint nhits = cluster->NHits();
@@ -75,7 +79,7 @@ void sbnd::crt::CRTSpacePointProducer::produce(art::Event& e)
           CRTSpacePoint spacepoint = fClusterCharacAlg.CharacteriseSingleHitCluster(cluster, stripHits[0]);
             {
               spacePointVec->push_back(spacepoint);
-              util::CreateAssn(*this, e, *spacePointVec, cluster, *spacePointClusterAssn);
+              spacePointClusters.Add(spacePointVec->size() - 1, cluster);
             }
         }
       else if(nhits > 1)
@@ -84,11 +88,15 @@ void sbnd::crt::CRTSpacePointProducer::produce(art::Event& e)
           if(fClusterCharacAlg.CharacteriseMultiHitCluster(cluster, stripHits, spacepoint))
             {
               spacePointVec->push_back(spacepoint);
-              util::CreateAssn(*this, e, *spacePointVec, cluster, *spacePointClusterAssn);
+              spacePointClusters.Add(spacePointVec->size() - 1, cluster);
             }
         }
     }
 
+  spacePointClusters.Fill(e, *spacePointClusterAssn);
+
+  sbnd::perf::Count("SpacePoints", spacePointVec->size());
+
   e.put(std::move(spacePointVec));
   e.put(std::move(spacePointClusterAssn));
 }
@@ -6,7 +6,7 @@
 // Author:      Henry Lay (h.lay@lancaster.ac.uk)
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -17,12 +17,15 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
-#include "lardata/Utilities/AssociationUtil.h"
-
 #include "sbnobj/SBND/CRT/FEBData.hh"
 #include "sbnobj/SBND/CRT/CRTStripHit.hh"
 
 #include "sbndcode/Geometry/GeometryWrappers/CRTGeoAlg.h"
+#include "sbndcode/CRT/CompactFEBData/CompactFEBData.h"
+#include "sbndcode/CRT/CRTUtils/CRTAssnsCollector.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
 
 #include <memory>
 
@@ -31,97 +34,133 @@ namespace sbnd::crt {
 }
 
 
-class sbnd::crt::CRTStripHitProducer : public art::EDProducer {
+class sbnd::crt::CRTStripHitProducer : public art::SharedProducer {
 public:
-  explicit CRTStripHitProducer(fhicl::ParameterSet const& p);
+  explicit CRTStripHitProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   CRTStripHitProducer(CRTStripHitProducer const&) = delete;
   CRTStripHitProducer(CRTStripHitProducer&&) = delete;
   CRTStripHitProducer& operator=(CRTStripHitProducer const&) = delete;
   CRTStripHitProducer& operator=(CRTStripHitProducer&&) = delete;
 
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
 
-  std::vector<CRTStripHit> CreateStripHits(art::Ptr<FEBData> &data);
+  std::vector<CRTStripHit> CreateStripHits(const FEBData &data) const;
 
 private:
 
-  CRTGeoAlg           fCRTGeoAlg;
+  std::shared_ptr<const CRTGeoAlg>           fCRTGeoAlg;
   std::string         fFEBDataModuleLabel;
+  std::string         fCompactFEBDataModuleLabel;
   uint16_t            fADCThreshold;
   std::vector<double> fErrorCoeff;
+  bool                fUseFEBWorkers;
 };
 
 
-sbnd::crt::CRTStripHitProducer::CRTStripHitProducer(fhicl::ParameterSet const& p)
-  : EDProducer{p}
-  , fCRTGeoAlg(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet()))
+sbnd::crt::CRTStripHitProducer::CRTStripHitProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p}
+  , fCRTGeoAlg(CRTGeoAlg::Shared(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet())))
   , fFEBDataModuleLabel(p.get<std::string>("FEBDataModuleLabel"))
+  , fCompactFEBDataModuleLabel(p.get<std::string>("CompactFEBDataModuleLabel", ""))
   , fADCThreshold(p.get<uint16_t>("ADCThreshold"))
   , fErrorCoeff(p.get<std::vector<double>>("ErrorCoeff"))
+  , fUseFEBWorkers(p.get<bool>("UseFEBWorkers", false))
   {
     produces<std::vector<CRTStripHit>>();
     produces<art::Assns<FEBData, CRTStripHit>>();
+    async<art::InEvent>();
   }
 
-void sbnd::crt::CRTStripHitProducer::produce(art::Event& e)
+void sbnd::crt::CRTStripHitProducer::produce(art::Event& e, art::ProcessingFrame const&)
 {
   auto stripHitVec      = std::make_unique<std::vector<CRTStripHit>>();
   auto stripHitDataAssn = std::make_unique<art::Assns<FEBData, CRTStripHit>>();
   
-  art::Handle<std::vector<FEBData>> FEBDataHandle;
-  e.getByLabel(fFEBDataModuleLabel, FEBDataHandle);
-  
+  // Compact readouts are expanded one at a time; there is no FEBData
+  // to associate the strip hits to
+  CompactFEBData const* compact = nullptr;
   std::vector<art::Ptr<FEBData>> FEBDataVec;
-  art::fill_ptr_vector(FEBDataVec, FEBDataHandle);
+  if(!fCompactFEBDataModuleLabel.empty())
+    compact = &e.getProduct<CompactFEBData>(fCompactFEBDataModuleLabel);
+  else
+    {
+      art::Handle<std::vector<FEBData>> FEBDataHandle;
+      e.getByLabel(fFEBDataModuleLabel, FEBDataHandle);
+      art::fill_ptr_vector(FEBDataVec, FEBDataHandle);
+    }
+
+  const size_t nFEBData = compact ? compact->size() : FEBDataVec.size();
+
+  // Each readout is converted into its own buffer
+  std::vector<std::vector<CRTStripHit>> febStripHits(nFEBData);
 
-  for(auto data : FEBDataVec)
+  auto convertFEBs = [&](const tbb::blocked_range<size_t> &range) {
+    for(size_t i = range.begin(); i != range.end(); ++i)
+      febStripHits[i] = compact ? CreateStripHits(compact->MakeFEBData(i)) : CreateStripHits(*FEBDataVec[i]);
+  };
+
+  if(fUseFEBWorkers)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nFEBData), convertFEBs);
+  else
+    convertFEBs(tbb::blocked_range<size_t>(0, nFEBData));
+
+  // Concatenated in FEBData order whichever way they were made
+  size_t nStripHits = 0;
+  for(auto const& stripHits : febStripHits)
+    nStripHits += stripHits.size();
+
+  stripHitVec->reserve(nStripHits);
+
+  CRTAssnsCollector<CRTStripHit, FEBData> stripHitData;
+  stripHitData.Reserve(nStripHits);
+
+  for(size_t i = 0; i < nFEBData; ++i)
     {
-      std::vector<CRTStripHit> newStripHits = CreateStripHits(data);
-      
-      for(auto hit : newStripHits)
+      for(auto const& hit : febStripHits[i])
 	{
 	  stripHitVec->push_back(hit);
-	  util::CreateAssn(*this, e, *stripHitVec, data, *stripHitDataAssn);
+	  if(!compact)
+	    stripHitData.Add(stripHitVec->size() - 1, FEBDataVec[i]);
 	}
     }
 
+  stripHitData.Fill(e, *stripHitDataAssn);
+
   e.put(std::move(stripHitVec));
   e.put(std::move(stripHitDataAssn));
 }
 
-std::vector<sbnd::crt::CRTStripHit> sbnd::crt::CRTStripHitProducer::CreateStripHits(art::Ptr<FEBData> &data)
+std::vector<sbnd::crt::CRTStripHit> sbnd::crt::CRTStripHitProducer::CreateStripHits(const FEBData &data) const
 {
   std::vector<CRTStripHit> stripHits;
 
-  const uint32_t mac5  = data->Mac5();
-  const uint32_t unixs = data->UnixS();
+  const uint32_t mac5  = data.Mac5();
+  const uint32_t unixs = data.UnixS();
 
   // Only consider "real data" readouts, not clock resets etc
-  if(data->Flags() != 3)
+  if(data.Flags() != 3)
     return stripHits;
   
-  const CRTModuleGeo module = fCRTGeoAlg.GetModule(mac5 * 32);
-
   // Correct for FEB readout cable length
   // (time is FEB-by-FEB not channel-by-channel)
-  const uint32_t t0 = data->Ts0() + module.t0CableDelayCorrection;
-  const uint32_t t1 = data->Ts1() + module.t1CableDelayCorrection;
+  const uint32_t t0 = data.Ts0() + fCRTGeoAlg->T0CableDelayCorrection(mac5 * 32);
+  const uint32_t t1 = data.Ts1() + fCRTGeoAlg->T1CableDelayCorrection(mac5 * 32);
 
   // Iterate via strip (2 SiPMs per strip)
-  const auto &sipm_adcs = data->ADC();
+  const auto &sipm_adcs = data.ADC();
   for(unsigned adc_i = 0; adc_i < 32; adc_i+=2)
     {
       // Calculate SiPM channel number
       const uint16_t channel = mac5 * 32 + adc_i;
 
-      const CRTStripGeo strip = fCRTGeoAlg.GetStrip(channel);
-      const CRTSiPMGeo sipm1  = fCRTGeoAlg.GetSiPM(channel);
-      const CRTSiPMGeo sipm2  = fCRTGeoAlg.GetSiPM(channel+1);
+      const CRTStripGeo &strip = fCRTGeoAlg->GetStrip(channel);
+      const uint32_t pedestal1 = fCRTGeoAlg->SiPMPedestal(channel);
+      const uint32_t pedestal2 = fCRTGeoAlg->SiPMPedestal(channel+1);
 
       // Subtract channel pedestals
-      const uint16_t adc1 = sipm1.pedestal < sipm_adcs[adc_i]   ? sipm_adcs[adc_i] - sipm1.pedestal   : 0;
-      const uint16_t adc2 = sipm2.pedestal < sipm_adcs[adc_i+1] ? sipm_adcs[adc_i+1] - sipm2.pedestal : 0;
+      const uint16_t adc1 = pedestal1 < sipm_adcs[adc_i]   ? sipm_adcs[adc_i] - pedestal1   : 0;
+      const uint16_t adc2 = pedestal2 < sipm_adcs[adc_i+1] ? sipm_adcs[adc_i+1] - pedestal2 : 0;
 
       // Keep hit if both SiPMs above threshold
       if(adc1 > fADCThreshold && adc2 > fADCThreshold)
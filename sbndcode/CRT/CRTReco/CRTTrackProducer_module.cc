@@ -6,7 +6,7 @@
 // Author:      Henry Lay (h.lay@lancaster.ac.uk)
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -20,20 +20,24 @@
 #include "Math/GenVector/PositionVector2D.h"
 #include "Math/GenVector/DisplacementVector2D.h"
 
-#include "lardata/Utilities/AssociationUtil.h"
-
 #include "sbnobj/SBND/CRT/CRTCluster.hh"
 #include "sbnobj/SBND/CRT/CRTSpacePoint.hh"
 #include "sbnobj/SBND/CRT/CRTTrack.hh"
 
 #include "sbndcode/Geometry/GeometryWrappers/CRTGeoAlg.h"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
+#include "sbndcode/CRT/CRTUtils/CRTAssnsCollector.h"
+#include "sbndcode/Utilities/EventPerformance.h"
+#include "sbndcode/Utilities/EventScratch.h"
 
 #include "Eigen/Dense"
 
 #include "TMath.h"
 
 #include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <queue>
 
 
 namespace geo {
@@ -49,27 +53,29 @@ namespace sbnd::crt {
 }
 
 
-class sbnd::crt::CRTTrackProducer : public art::EDProducer {
+class sbnd::crt::CRTTrackProducer : public art::SharedProducer {
 public:
-  explicit CRTTrackProducer(fhicl::ParameterSet const& p);
+  // Candidates live only during produce(), in the scratch memory of the event
+  using TrackCandidate_t  = std::pair<CRTTrack, std::pmr::set<unsigned>>;
+  using TrackCandidates_t = std::pmr::vector<TrackCandidate_t>;
+
+  explicit CRTTrackProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   CRTTrackProducer(CRTTrackProducer const&) = delete;
   CRTTrackProducer(CRTTrackProducer&&) = delete;
   CRTTrackProducer& operator=(CRTTrackProducer const&) = delete;
   CRTTrackProducer& operator=(CRTTrackProducer&&) = delete;
 
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
 
   void OrderSpacePoints(std::vector<art::Ptr<CRTSpacePoint>> &spacePointVec);
 
-  std::vector<std::pair<CRTTrack, std::set<unsigned>>> CreateTrackCandidates(const std::vector<art::Ptr<CRTSpacePoint>> &spacePointVec,
-                                                                             const art::FindOneP<CRTCluster> &spacePointsToCluster);
+  TrackCandidates_t CreateTrackCandidates(const std::vector<art::Ptr<CRTSpacePoint>> &spacePointVec,
+                                          const art::FindOneP<CRTCluster> &spacePointsToCluster);
 
   void TimeErrorCalculator(const std::vector<double> &times, double &mean, double &err);
 
-  void OrderTrackCandidates(std::vector<std::pair<CRTTrack, std::set<unsigned>>> &trackCandidates);
-
-  std::vector<std::pair<CRTTrack, std::set<unsigned>>> ChoseTracks(std::vector<std::pair<CRTTrack, std::set<unsigned>>> &trackCandidates);
+  TrackCandidates_t ChoseTracks(const TrackCandidates_t &trackCandidates, const unsigned nSpacePoints);
 
   double DistanceOfClosestApproach(const CRTTagger tagger, const art::Ptr<CRTSpacePoint> &spacePoint,
                                    const geo::Point_t &start, const geo::Vector_t &dir);
@@ -93,26 +99,29 @@ public:
 
 private:
 
-  CRTGeoAlg   fCRTGeoAlg;
+  std::shared_ptr<const CRTGeoAlg>   fCRTGeoAlg;
   std::string fCRTSpacePointModuleLabel;
   double      fCoincidenceTimeRequirement;
   double      fThirdSpacePointMaximumDCA;
 };
 
 
-sbnd::crt::CRTTrackProducer::CRTTrackProducer(fhicl::ParameterSet const& p)
-  : EDProducer{p}
-  , fCRTGeoAlg(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet()))
+sbnd::crt::CRTTrackProducer::CRTTrackProducer(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p}
+  , fCRTGeoAlg(CRTGeoAlg::Shared(p.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet())))
   , fCRTSpacePointModuleLabel(p.get<std::string>("CRTSpacePointModuleLabel"))
   , fCoincidenceTimeRequirement(p.get<double>("CoincidenceTimeRequirement"))
   , fThirdSpacePointMaximumDCA(p.get<double>("ThirdSpacePointMaximumDCA"))
   {
     produces<std::vector<CRTTrack>>();
     produces<art::Assns<CRTSpacePoint, CRTTrack>>();
+    async<art::InEvent>();
   }
 
-void sbnd::crt::CRTTrackProducer::produce(art::Event& e)
+void sbnd::crt::CRTTrackProducer::produce(art::Event& e, art::ProcessingFrame const&)
 {
+  sbnd::mem::EventScope scratch;
+
   auto trackVec            = std::make_unique<std::vector<CRTTrack>>();
   auto trackSpacePointAssn = std::make_unique<art::Assns<CRTSpacePoint, CRTTrack>>();
   
@@ -126,20 +135,26 @@ void sbnd::crt::CRTTrackProducer::produce(art::Event& e)
 
   OrderSpacePoints(CRTSpacePointVec);
 
-  std::vector<std::pair<CRTTrack, std::set<unsigned>>> trackCandidates = CreateTrackCandidates(CRTSpacePointVec, spacePointsToCluster);
+  TrackCandidates_t trackCandidates = CreateTrackCandidates(CRTSpacePointVec, spacePointsToCluster);
 
-  OrderTrackCandidates(trackCandidates);
+  TrackCandidates_t chosenTracks = ChoseTracks(trackCandidates, CRTSpacePointVec.size());
 
-  std::vector<std::pair<CRTTrack, std::set<unsigned>>> chosenTracks = ChoseTracks(trackCandidates);
+  CRTAssnsCollector<CRTTrack, CRTSpacePoint> trackSpacePoints;
+  trackSpacePoints.Reserve(CRTSpacePointVec.size());
 
   for(auto const& [track, spIDs] : chosenTracks)
     {
       trackVec->push_back(track);
 
       for(auto const& spID : spIDs)
-        util::CreateAssn(*this, e, *trackVec, CRTSpacePointVec[spID], *trackSpacePointAssn);
+        trackSpacePoints.Add(trackVec->size() - 1, CRTSpacePointVec[spID]);
     }
 
+  trackSpacePoints.Fill(e, *trackSpacePointAssn);
+
+  sbnd::perf::Count("TrackCandidates", trackCandidates.size());
+  sbnd::perf::Count("Tracks", trackVec->size());
+
   e.put(std::move(trackVec));
   e.put(std::move(trackSpacePointAssn));
 }
@@ -152,88 +167,99 @@ void sbnd::crt::CRTTrackProducer::OrderSpacePoints(std::vector<art::Ptr<CRTSpace
             });
 }
 
-std::vector<std::pair<sbnd::crt::CRTTrack, std::set<unsigned>>> sbnd::crt::CRTTrackProducer::CreateTrackCandidates(const std::vector<art::Ptr<CRTSpacePoint>> &spacePointVec,
-                                                                                                                   const art::FindOneP<CRTCluster> &spacePointsToCluster)
+sbnd::crt::CRTTrackProducer::TrackCandidates_t sbnd::crt::CRTTrackProducer::CreateTrackCandidates(const std::vector<art::Ptr<CRTSpacePoint>> &spacePointVec,
+                                                                                                    const art::FindOneP<CRTCluster> &spacePointsToCluster)
 {
-  std::vector<std::pair<CRTTrack, std::set<unsigned>>> candidates;
+  TrackCandidates_t candidates(sbnd::mem::EventResource());
+
+  // Space points are time ordered, so every inner loop can stop at the end of the
+  // coincidence window. The taggers are looked up once rather than for every pair.
+  const unsigned nSpacePoints = spacePointVec.size();
+
+  std::vector<CRTTagger> taggers(nSpacePoints);
+  std::vector<double> times(nSpacePoints);
 
-  for(unsigned i = 0; i < spacePointVec.size(); ++i)
+  for(unsigned i = 0; i < nSpacePoints; ++i)
     {
-      const art::Ptr<CRTSpacePoint> primarySpacePoint = spacePointVec[i];
-      const art::Ptr<CRTCluster> primaryCluster       = spacePointsToCluster.at(primarySpacePoint.key());
+      taggers[i] = spacePointsToCluster.at(spacePointVec[i].key())->Tagger();
+      times[i]   = spacePointVec[i]->Time();
+    }
+
+  for(unsigned i = 0; i < nSpacePoints; ++i)
+    {
+      const art::Ptr<CRTSpacePoint> &primarySpacePoint = spacePointVec[i];
+      const CRTTagger primaryTagger                    = taggers[i];
 
-      for(unsigned ii = i+1; ii < spacePointVec.size(); ++ii)
+      for(unsigned ii = i+1; ii < nSpacePoints; ++ii)
         {
-          const art::Ptr<CRTSpacePoint> secondarySpacePoint = spacePointVec[ii];
-          const art::Ptr<CRTCluster> secondaryCluster       = spacePointsToCluster.at(secondarySpacePoint.key());
+          if(times[ii] - times[i] > fCoincidenceTimeRequirement)
+            break;
+
+          const CRTTagger secondaryTagger = taggers[ii];
 
-          if(secondarySpacePoint->Time() - primarySpacePoint->Time() > fCoincidenceTimeRequirement ||
-             secondaryCluster->Tagger() == primaryCluster->Tagger())
+          if(secondaryTagger == primaryTagger)
             continue;
 
+          const art::Ptr<CRTSpacePoint> &secondarySpacePoint = spacePointVec[ii];
+
           const geo::Point_t &start = primarySpacePoint->Pos();
           const geo::Point_t &end   = secondarySpacePoint->Pos();
           const geo::Vector_t &dir  = (end - start).Unit();
 
-          if(CRTCommonUtils::IsTopTagger(primaryCluster->Tagger()) || CRTCommonUtils::IsTopTagger(secondaryCluster->Tagger()))
+          if(CRTCommonUtils::IsTopTagger(primaryTagger) || CRTCommonUtils::IsTopTagger(secondaryTagger))
             {
-              for(unsigned iii = ii + 1; iii < spacePointVec.size(); ++iii)
+              // The third space point is later than the second, so it is within the window
+              // of the second whenever it is within the window of the first
+              for(unsigned iii = ii + 1; iii < nSpacePoints; ++iii)
                 {
-                  const art::Ptr<CRTSpacePoint> tertiarySpacePoint = spacePointVec[iii];
-                  const art::Ptr<CRTCluster> tertiaryCluster       = spacePointsToCluster.at(tertiarySpacePoint.key());
+                  if(times[iii] - times[i] > fCoincidenceTimeRequirement)
+                    break;
 
-                  if(!CRTCommonUtils::CoverTopTaggers(primaryCluster->Tagger(), secondaryCluster->Tagger(), tertiaryCluster->Tagger()))
-                    continue;
+                  const CRTTagger tertiaryTagger = taggers[iii];
 
-                  if(tertiarySpacePoint->Time() - primarySpacePoint->Time() > fCoincidenceTimeRequirement ||
-                     tertiaryCluster->Tagger() == primaryCluster->Tagger())
+                  if(!CRTCommonUtils::CoverTopTaggers(primaryTagger, secondaryTagger, tertiaryTagger))
                     continue;
 
-                  if(tertiarySpacePoint->Time() - secondarySpacePoint->Time() > fCoincidenceTimeRequirement ||
-                     tertiaryCluster->Tagger() == secondaryCluster->Tagger())
+                  if(tertiaryTagger == primaryTagger || tertiaryTagger == secondaryTagger)
                     continue;
 
-                  const CRTTagger &tertiaryTagger = tertiaryCluster->Tagger();
+                  const art::Ptr<CRTSpacePoint> &tertiarySpacePoint = spacePointVec[iii];
 
                   const double dca = DistanceOfClosestApproach(tertiaryTagger, tertiarySpacePoint, start, dir);
 
                   if(dca < fThirdSpacePointMaximumDCA)
                     {
                       double time, etime;
-                      const std::vector<double> times = {primarySpacePoint->Time(), secondarySpacePoint->Time(), tertiarySpacePoint->Time()};
-                      TimeErrorCalculator(times, time, etime);
-                      const double tof = TripleTrackToF(times);
+                      const std::vector<double> tripleTimes = {times[i], times[ii], times[iii]};
+                      TimeErrorCalculator(tripleTimes, time, etime);
+                      const double tof = TripleTrackToF(tripleTimes);
 
                       const double pe = primarySpacePoint->PE() + secondarySpacePoint->PE() + tertiarySpacePoint->PE();
 
-                      const std::set<CRTTagger> used_taggers = {primaryCluster->Tagger(), secondaryCluster->Tagger(), tertiaryCluster->Tagger()};
- 
+                      const std::set<CRTTagger> used_taggers = {primaryTagger, secondaryTagger, tertiaryTagger};
+
                       geo::Point_t fitStart, fitMid, fitEnd;
                       double gof;
-                      
-                      BestFitLine(primarySpacePoint->Pos(), secondarySpacePoint->Pos(), tertiarySpacePoint->Pos(), primaryCluster->Tagger(), 
-                                  secondaryCluster->Tagger(), tertiaryCluster->Tagger(), fitStart, fitMid, fitEnd, gof);
 
-                      const CRTTrack track({fitStart, fitMid, fitEnd}, time, etime, pe, tof, used_taggers);
-                      const std::set<unsigned> used_spacepoints = {i, ii, iii};
+                      BestFitLine(primarySpacePoint->Pos(), secondarySpacePoint->Pos(), tertiarySpacePoint->Pos(), primaryTagger,
+                                  secondaryTagger, tertiaryTagger, fitStart, fitMid, fitEnd, gof);
 
-                      candidates.emplace_back(track, used_spacepoints);
+                      const CRTTrack track({fitStart, fitMid, fitEnd}, time, etime, pe, tof, used_taggers);
+                      candidates.emplace_back(track, std::pmr::set<unsigned>({i, ii, iii}, candidates.get_allocator()));
                     }
                 }
             }
 
           double time, etime;
-          TimeErrorCalculator({primarySpacePoint->Time(), secondarySpacePoint->Time()}, time, etime);
-          const double tof = secondarySpacePoint->Time() - primarySpacePoint->Time();
+          TimeErrorCalculator({times[i], times[ii]}, time, etime);
+          const double tof = times[ii] - times[i];
 
           const double pe = primarySpacePoint->PE() + secondarySpacePoint->PE();
 
-          const std::set<CRTTagger> used_taggers = {primaryCluster->Tagger(), secondaryCluster->Tagger()};
+          const std::set<CRTTagger> used_taggers = {primaryTagger, secondaryTagger};
 
           const CRTTrack track(start, end, time, etime, pe, tof, used_taggers);
-          const std::set<unsigned> used_spacepoints = {i, ii};
-
-          candidates.emplace_back(track, used_spacepoints);
+          candidates.emplace_back(track, std::pmr::set<unsigned>({i, ii}, candidates.get_allocator()));
         }
     }
   return candidates;
@@ -254,38 +280,57 @@ void sbnd::crt::CRTTrackProducer::TimeErrorCalculator(const std::vector<double>
   err = std::sqrt(summed_var / times.size());
 }
 
-void sbnd::crt::CRTTrackProducer::OrderTrackCandidates(std::vector<std::pair<CRTTrack, std::set<unsigned>>> &trackCandidates)
+sbnd::crt::CRTTrackProducer::TrackCandidates_t sbnd::crt::CRTTrackProducer::ChoseTracks(const TrackCandidates_t &trackCandidates,
+                                                                                          const unsigned nSpacePoints)
 {
-  std::sort(trackCandidates.begin(), trackCandidates.end(),
-            [](const std::pair<CRTTrack, std::set<unsigned>> &a, const std::pair<CRTTrack, std::set<unsigned>> &b) -> bool {
-              if(a.second.size() != b.second.size())
-                return a.second.size() > b.second.size();
-              else
-                return a.first.TimeErr() < b.first.TimeErr();
-            });
-}
+  TrackCandidates_t chosenTracks(sbnd::mem::EventResource());
+
+  // Greedy selection, candidates with more space points first then those with the
+  // smaller time spread. Equal candidates are taken in the order they were made.
+  auto worse = [&trackCandidates](const unsigned a, const unsigned b) -> bool {
+    const TrackCandidate_t &candA = trackCandidates[a];
+    const TrackCandidate_t &candB = trackCandidates[b];
+
+    if(candA.second.size() != candB.second.size())
+      return candA.second.size() < candB.second.size();
+    else if(candA.first.TimeErr() != candB.first.TimeErr())
+      return candA.first.TimeErr() > candB.first.TimeErr();
+    else
+      return a > b;
+  };
 
-std::vector<std::pair<sbnd::crt::CRTTrack, std::set<unsigned>>> sbnd::crt::CRTTrackProducer::ChoseTracks(std::vector<std::pair<CRTTrack, std::set<unsigned>>> &trackCandidates)
-{
-  std::vector<std::pair<sbnd::crt::CRTTrack, std::set<unsigned>>> chosenTracks;
+  std::vector<unsigned> order(trackCandidates.size());
+  std::iota(order.begin(), order.end(), 0);
 
-  std::set<unsigned> used;
+  std::priority_queue<unsigned, std::vector<unsigned>, decltype(worse)> queue(worse, std::move(order));
 
-  for(auto const& [track, spIDs] : trackCandidates)
+  std::vector<bool> used(nSpacePoints, false);
+  unsigned nUnused = nSpacePoints;
+
+  // No track can be made once fewer than two space points are left
+  while(!queue.empty() && nUnused > 1)
     {
+      const TrackCandidate_t &candidate = trackCandidates[queue.top()];
+      queue.pop();
+
       bool keep = true;
-      for(auto const& spID : spIDs)
+      for(auto const& spID : candidate.second)
         {
-          if(used.count(spID) != 0)
-            keep = false;
+          if(used[spID])
+            {
+              keep = false;
+              break;
+            }
         }
-      
+
       if(keep)
         {
-          chosenTracks.emplace_back(track, spIDs);
+          chosenTracks.push_back(candidate);
+
+          for(auto const& spID : candidate.second)
+            used[spID] = true;
 
-          for(auto const& spID : spIDs)
-            used.insert(spID);
+          nUnused -= candidate.second.size();
         }
     }
 
@@ -439,7 +484,7 @@ void sbnd::crt::CRTTrackProducer::BestFitLine(const geo::Point_t &a, const geo::
 geo::Point_t sbnd::crt::CRTTrackProducer::LineTaggerIntersectionPoint(const geo::Point_t &start, const geo::Vector_t &dir, const CRTTagger &tagger)
 {
   const CoordSet constrainedPlane = CRTCommonUtils::GetTaggerDefinedCoordinate(tagger);
-  const CRTTaggerGeo taggerGeo    = fCRTGeoAlg.GetTagger(CRTCommonUtils::GetTaggerName(tagger));
+  const CRTTaggerGeo &taggerGeo   = fCRTGeoAlg->GetTagger(tagger);
   double k;
 
   switch(constrainedPlane)
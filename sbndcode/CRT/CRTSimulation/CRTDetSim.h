@@ -15,7 +15,8 @@
 /// Author: mastbaum@uchicago.edu
 ///////////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ReplicatedProducer.h"
+#include "art/Framework/Core/ProcessingFrame.h"
 #include "art/Framework/Principal/Event.h"
 #include "fhiclcpp/ParameterSet.h"
 
@@ -28,9 +29,12 @@
 namespace sbnd {
 namespace crt {
 
-class CRTDetSim : public art::EDProducer {
+// art makes one replica for each schedule, each with its own engine and
+// algorithm, so that the CRT simulation of an event runs while the other
+// schedules digitize the TPC and the photon detectors of theirs.
+class CRTDetSim : public art::ReplicatedProducer {
 public:
-  explicit CRTDetSim(fhicl::ParameterSet const & p);
+  CRTDetSim(fhicl::ParameterSet const & p, art::ProcessingFrame const& frame);
 
   CRTDetSim(CRTDetSim const &) = delete;
   CRTDetSim(CRTDetSim &&) = delete;
@@ -38,11 +42,13 @@ public:
   CRTDetSim& operator = (CRTDetSim &&) = delete;
   void reconfigure(fhicl::ParameterSet const & p) ;
 
-  void produce(art::Event & e) override;
+  void produce(art::Event & e, art::ProcessingFrame const&) override;
   std::string fG4ModuleLabel;
+  bool fDropInputProducts; //!< Remove the AuxDetSimChannels from the event once the taggers are filled
 
 private:
 
+  unsigned int fSchedule; //!< Schedule of this replica
   CLHEP::HepRandomEngine& fEngine; //!< Reference to art-managed random-number engine
   double fG4RefTime; //!< Stores the G4 reference time
   CRTDetSimAlg fDetAlg; //!< Instance of the CRT detector simulation algorithm
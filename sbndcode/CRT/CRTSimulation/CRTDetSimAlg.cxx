@@ -14,7 +14,7 @@ namespace crt {
         ConfigureWaveform();
         ConfigureTimeOffset();
 
-        fTaggers.clear();
+        fTaggers.assign(fCRTGeoAlg->NumTaggers(), Tagger());
         fData.clear();
         fAuxData.clear();
     }
@@ -33,11 +33,18 @@ namespace crt {
         // estimate its effect on time delays.
         std::reverse(wvf_y.begin(),wvf_y.end());
 
-        fInterpolator = std::make_unique<ROOT::Math::Interpolator>
-            (wvf_y.size(), ROOT::Math::Interpolation::kLINEAR);
+        ROOT::Math::Interpolator interpolator(wvf_y.size(), ROOT::Math::Interpolation::kLINEAR);
+        interpolator.SetData(wvf_x, wvf_y);
 
-        fInterpolator->SetData(wvf_x, wvf_y);
+        // Time delays are integer ticks, so the waveform is only ever
+        // evaluated at the ticks up to the end of the waveform
+        fWaveformTable.clear();
+        if (wvf_x.empty() || wvf_x.back() < 0) return;
 
+        const uint32_t n_ticks = static_cast<uint32_t>(std::floor(wvf_x.back())) + 1;
+        fWaveformTable.reserve(n_ticks);
+        for (uint32_t t = 0; t < n_ticks; t++)
+            fWaveformTable.push_back(interpolator.Eval(t));
     }
 
     void CRTDetSimAlg::ConfigureTimeOffset()
@@ -56,12 +63,12 @@ namespace crt {
         }
     }
 
-    std::vector<std::pair<FEBData, std::vector<AuxDetIDE>>> CRTDetSimAlg::GetData()
+    const std::vector<std::pair<FEBData, std::vector<AuxDetIDE>>> & CRTDetSimAlg::GetData() const
     {
         return fData;
     }
 
-    std::vector<std::vector<int>> CRTDetSimAlg::GetAuxData()
+    const std::vector<std::vector<int>> & CRTDetSimAlg::GetAuxData() const
     {
         return fAuxData;
     }
@@ -82,7 +89,7 @@ namespace crt {
                 << "Time delay cannot be negative for waveform emulation to happen." << std::endl;
         }
 
-        if (time_delay > fParams.WaveformX().back())
+        if (time_delay >= fWaveformTable.size())
         {
             // If the time delay is more than the waveform rise time, we
             // will never be able to see this signal. So return a 0 ADC value.
@@ -90,8 +97,7 @@ namespace crt {
         }
 
         // Evaluate the waveform
-        double wf = fInterpolator->Eval(time_delay);
-        wf *= adc;
+        const double wf = fWaveformTable[time_delay] * adc;
 
         if (fParams.DebugTrigger()) std::cout << "WaveformEmulation, time_delay " << time_delay
                                               << ", adc " << adc
@@ -125,75 +131,70 @@ namespace crt {
 
 
 
-    void CRTDetSimAlg::ProcessStrips(const std::vector<StripData> & strips)
+    void CRTDetSimAlg::ProcessStrips(std::vector<StripData> & strips)
     {
-        std::map<uint16_t, FEBData> mac_to_febdata;
-        std::map<uint16_t, std::vector<AuxDetIDE>> mac_to_ides;
-        std::map<uint16_t, std::vector<int>> mac_to_sipmids;
-
         // TODO Add pedestal fluctuations
         std::array<uint16_t, 32> adc_pedestal = {static_cast<uint16_t>(fParams.QPed())};
 
-        for (auto & strip : strips)
+        // Group the strips by FEB, in increasing FEB number, keeping the
+        // order of the strips within each FEB
+        std::stable_sort(strips.begin(), strips.end(),
+                         [](const StripData & strip1, const StripData & strip2) {
+                             return strip1.mac5 < strip2.mac5;
+                         });
+
+        size_t n_febs = 0;
+
+        for (auto feb_begin = strips.begin(); feb_begin != strips.end(); n_febs++)
         {
+            const uint16_t mac5 = feb_begin->mac5;
+            const auto feb_end = std::find_if(feb_begin, strips.end(),
+                                              [mac5](const StripData & strip) { return strip.mac5 != mac5; });
 
-            // First time we encounter this FEB...
-            if (!mac_to_febdata.count(strip.mac5))
+            // We want to save the earliest t1 and t0 for each FEB.
+            auto earliest = feb_begin;
+            for (auto it = feb_begin; it != feb_end; ++it)
             {
-                // Construct a new FEBData object with only pedestal values (will be filled later)
-                mac_to_febdata[strip.mac5] = FEBData(strip.mac5,          // FEB ID
-                                                     strip.flags,         // Flags
-                                                     strip.sipm0.t0,      // Ts0
-                                                     strip.sipm0.t1,      // Ts1
-                                                     strip.unixs,         // UnixS
-                                                     adc_pedestal,        // ADCs
-                                                     strip.sipm0.sipmID); // Coinc
-
-                mac_to_ides[strip.mac5] = std::vector<AuxDetIDE>();
-                mac_to_sipmids[strip.mac5] = std::vector<int>();
-            }
-            // ... all the other times we encounter this FEB
-            else
-            {
-                // We want to save the earliest t1 and t0 for each FEB.
-                if (strip.sipm0.t1 < mac_to_febdata[strip.mac5].Ts1())
-                {
-                    mac_to_febdata[strip.mac5].SetFlags(strip.flags);
-                    mac_to_febdata[strip.mac5].SetTs1(strip.sipm0.t1);
-                    mac_to_febdata[strip.mac5].SetTs0(strip.sipm0.t0);
-                    mac_to_febdata[strip.mac5].SetUnixS(strip.unixs);
-                    mac_to_febdata[strip.mac5].SetCoinc(strip.sipm0.sipmID);
-                }
+                if (it->sipm0.t1 < earliest->sipm0.t1) earliest = it;
             }
-        }
 
+            // Construct a new FEBData object with only pedestal values (will be filled later)
+            FEBData feb_data(mac5,                       // FEB ID
+                             earliest->flags,            // Flags
+                             earliest->sipm0.t0,         // Ts0
+                             earliest->sipm0.t1,         // Ts1
+                             earliest->unixs,            // UnixS
+                             adc_pedestal,               // ADCs
+                             earliest->sipm0.sipmID);    // Coinc
 
-        for (auto & strip : strips)
-        {
+            const uint32_t trigger_time = feb_data.Ts1();
 
-            auto &feb_data = mac_to_febdata[strip.mac5];
-            uint32_t trigger_time = feb_data.Ts1();
+            std::vector<AuxDetIDE> ides;
+            std::vector<int> sipmids;
+            ides.reserve(feb_end - feb_begin);
+            sipmids.reserve(feb_end - feb_begin);
 
-            uint16_t adc_sipm0 = WaveformEmulation(strip.sipm0.t1 - trigger_time, strip.sipm0.adc);
-            uint16_t adc_sipm1 = WaveformEmulation(strip.sipm1.t1 - trigger_time, strip.sipm1.adc);
+            for (auto it = feb_begin; it != feb_end; ++it)
+            {
+                const StripData & strip = *it;
 
-            AddADC(feb_data, strip.sipm0.sipmID, adc_sipm0);
-            AddADC(feb_data, strip.sipm1.sipmID, adc_sipm1);
+                uint16_t adc_sipm0 = WaveformEmulation(strip.sipm0.t1 - trigger_time, strip.sipm0.adc);
+                uint16_t adc_sipm1 = WaveformEmulation(strip.sipm1.t1 - trigger_time, strip.sipm1.adc);
 
-            auto &ides = mac_to_ides[strip.mac5];
-            ides.push_back(strip.ide);
+                AddADC(feb_data, strip.sipm0.sipmID, adc_sipm0);
+                AddADC(feb_data, strip.sipm1.sipmID, adc_sipm1);
 
-            auto &sipmids = mac_to_sipmids[strip.mac5];
-            sipmids.push_back(std::min(strip.sipm0.sipmID, strip.sipm1.sipmID));
-        }
+                ides.push_back(strip.ide);
+                sipmids.push_back(std::min(strip.sipm0.sipmID, strip.sipm1.sipmID));
+            }
 
-        for (auto const& [mac, feb_data] : mac_to_febdata)
-        {
-            fData.push_back(std::make_pair(feb_data, mac_to_ides[mac]));
-            fAuxData.push_back(mac_to_sipmids[mac]);
+            fData.emplace_back(std::move(feb_data), std::move(ides));
+            fAuxData.push_back(std::move(sipmids));
+
+            feb_begin = feb_end;
         }
 
-        if (fParams.DebugTrigger()) std::cout << "Constructed " << mac_to_febdata.size()
+        if (fParams.DebugTrigger()) std::cout << "Constructed " << n_febs
                                               << " FEBData object(s)." << std::endl << std::endl;
     }
 
@@ -232,7 +233,7 @@ namespace crt {
             }
 
             /** \brief Add a strip belonging to a particular trigger */
-            void add_strip(StripData strip) {
+            void add_strip(const StripData & strip) {
                 _strips.push_back(strip);
                 _mac5s.insert(strip.mac5);
 
@@ -260,14 +261,14 @@ namespace crt {
                 return (time <= _dead_time);
             }
 
-            void print_no_coinc(StripData strip) {
+            void print_no_coinc(const StripData & strip) {
                 if (_debug) std::cout << "\tStrip with mac " << strip.mac5
                                      << " on plane " << strip.orientation
                                      << ", with time " << strip.sipm0.t1
                                      << " -> didn't have SiPMs coincidence" << std::endl;
             }
 
-            void print_dead_time(StripData strip) {
+            void print_dead_time(const StripData & strip) {
                 if (_debug) std::cout << "\tStrip with mac " << strip.mac5
                                      << " on plane " << strip.orientation
                                      << ", with time " << strip.sipm0.t1
@@ -277,12 +278,15 @@ namespace crt {
 
 
         // Loop over all the CRT Taggers and simulate triggering, dead time, ...
-        for (auto iter : fTaggers)
+        for (size_t tagger_i = 0; tagger_i < fTaggers.size(); tagger_i++)
         {
-            auto & name = iter.first;
-            auto & tagger = iter.second;
+            auto & tagger = fTaggers[tagger_i];
+
+            if (tagger.data.empty()) continue;
 
-           mf::LogInfo("CRTDetSimAlg") << "Simulating trigger for tagger " << name << std::endl;
+            const std::string & name = fCRTGeoAlg->GetTaggerByIndex(tagger_i).name;
+
+            mf::LogInfo("CRTDetSimAlg") << "Simulating trigger for tagger " << name << std::endl;
 
             bool is_bottom = name.find("Bottom") != std::string::npos;
             Trigger trigger(is_bottom, fParams.DeadTime(), fParams.DebugTrigger());
@@ -363,29 +367,36 @@ namespace crt {
 
 
     void CRTDetSimAlg::FillTaggers(const uint32_t adid, const uint32_t adsid,
-                                   vector<sim::AuxDetIDE> ides) {
+                                   const vector<sim::AuxDetIDE> & sim_ides) {
 
-        // Return the vector of IDEs
+        // Time order the IDEs, in a scratch copy reused from channel to channel
+        std::vector<sim::AuxDetIDE> & ides = fIDEs;
+        ides.assign(sim_ides.begin(), sim_ides.end());
         std::sort(ides.begin(), ides.end(),
                   [](const sim::AuxDetIDE & a, const sim::AuxDetIDE & b) -> bool{
                     return ((a.entryT + a.exitT)/2) < ((b.entryT + b.exitT)/2);
                   });
 
-        const CRTStripGeo strip   = fCRTGeoAlg.GetStripByAuxDetIndices(adid, adsid);
-        const CRTModuleGeo module = fCRTGeoAlg.GetModule(strip.moduleName);
-	
+        const CRTStripGeo &strip   = fCRTGeoAlg->GetStripByAuxDetIndices(adid, adsid);
+        const CRTModuleGeo &module = fCRTGeoAlg->GetModule(strip.moduleName);
+
 	if(module.minos)
 	  return;
-        
+
         // Retrive the ID of this CRT module
         const uint16_t mac5 = adid;
         const uint16_t orientation = module.orientation;
 
         // Simulate the CRT response for each hit
         mf::LogInfo("CRTDetSimAlg") << "We have " << ides.size() << " IDE for this SimChannel." << std::endl;
+
+        // First the geometry of every deposit, the random part of the
+        // response is then simulated for all of them together
+        fResponses.resize(ides.size());
+
         for (size_t ide_i = 0; ide_i < ides.size(); ide_i++) {
 
-            sim::AuxDetIDE ide = ides[ide_i];
+            const sim::AuxDetIDE & ide = ides[ide_i];
 
             // Finally, what is the distance from the hit (centroid of the entry
             // and exit points) to the readout end?
@@ -406,36 +417,55 @@ namespace crt {
                     << "TimeOffset: " << fTimeOffset << std::endl;
             }
 
-            const std::vector<double> localpos = fCRTGeoAlg.StripWorldToLocalPos(strip, x, y, z);
+            const std::vector<double> localpos = fCRTGeoAlg->StripWorldToLocalPos(strip, x, y, z);
+
+            DepositResponse & response = fResponses[ide_i];
+            response.tTrue = tTrue;
+            response.eDep = eDep;
 
             // Calculate distance to the readout
             const geo::Point_t worldpos(x, y, z);
-            const double distToReadout = fCRTGeoAlg.DistanceDownStrip(worldpos, strip.channel0);
+            response.distToReadout = fCRTGeoAlg->DistanceDownStrip(worldpos, strip.channel0);
 
             // Calculate distance to fibers
-            const double d0 = std::abs(-strip.width - localpos[1]);
-            const double d1 = std::abs( strip.width - localpos[1]);
-
-            // Simulate time response
-            // Waveform emulation is added later, because
-            // it depends on trigger time
-            long npe0, npe1;
-            double q0, q1;
-            ChargeResponse(eDep, d0, d1, distToReadout,
-                           npe0, npe1, q0, q1);
-
-            // Time relative to trigger, accounting for propagation delay and 'walk'
-            // for the fixed-threshold discriminator
-            uint32_t ts1_ch0 = getChannelTriggerTicks(tTrue, npe0, distToReadout);
-            uint32_t ts1_ch1 = getChannelTriggerTicks(tTrue, npe1, distToReadout);
-
-            if (fParams.EqualizeSiPMTimes()) {
-                mf::LogWarning("CRTDetSimAlg") << "EqualizeSiPMTimes is on." << std::endl;
-                ts1_ch1 = ts1_ch0;
-            }
+            response.d0 = std::abs(-strip.width - localpos[1]);
+            response.d1 = std::abs( strip.width - localpos[1]);
+        }
+
+        // Simulate time response
+        // Waveform emulation is added later, because
+        // it depends on trigger time
+        ChargeResponse(fResponses);
+
+        // Time relative to trigger, accounting for propagation delay and 'walk'
+        // for the fixed-threshold discriminator, and time relative to PPS
+        TriggerTicks(fResponses);
+
+        if (fParams.EqualizeSiPMTimes() && !ides.empty()) {
+            mf::LogWarning("CRTDetSimAlg") << "EqualizeSiPMTimes is on." << std::endl;
+        }
+
+        // Apply ADC threshold and strip-level coincidence (both fibers fire)
+        const double threshold = static_cast<double>(fParams.QThreshold());
+
+        // Give the flags parameter values 3 as all should be "data events"
+        const uint16_t flags = 3;
+
+        // Use the current server time to give us a unix timestamp
+        const uint32_t unixs = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        // Retrive the Tagger object
+        Tagger& tagger = fTaggers[fCRTGeoAlg->GetChannelIndex(strip.channel0).tagger];
+
+        for (size_t ide_i = 0; ide_i < ides.size(); ide_i++) {
 
-            // Time relative to PPS: Random for now! (FIXME)
-            uint32_t ppsTicks = CLHEP::RandFlat::shootInt(&fEngine, fParams.ClockSpeedCRT() * 1e6);
+            const sim::AuxDetIDE & ide = ides[ide_i];
+            const DepositResponse & response = fResponses[ide_i];
+
+            uint32_t ts1_ch0 = response.ts1_ch0;
+            uint32_t ts1_ch1 = fParams.EqualizeSiPMTimes() ? response.ts1_ch0 : response.ts1_ch1;
+            double q0 = response.q0;
+            double q1 = response.q1;
 
             // Adjacent channels on a strip are numbered sequentially.
             //
@@ -450,16 +480,8 @@ namespace crt {
             uint32_t sipm0ID = stripID * 2 + 0;
             uint32_t sipm1ID = stripID * 2 + 1;
 
-            // Apply ADC threshold and strip-level coincidence (both fibers fire)
-            double threshold = static_cast<double>(fParams.QThreshold());
             bool sipm_coinc = false;
 
-            // Give the flags parameter values 3 as all should be "data events"
-            const uint16_t flags = 3;
-
-            // Use the current server time to give us a unix timestamp
-            const uint32_t unixs = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-
             if (q0 > threshold &&
                 q1 > threshold &&
                 lar::util::absDiff(ts1_ch0, ts1_ch1) < fParams.StripCoincidenceWindow())
@@ -478,86 +500,115 @@ namespace crt {
 
             SiPMData sipm0 = SiPMData(sipm0ID,
                                       channel0ID,
-                                      ppsTicks,
+                                      response.ppsTicks,
                                       ts1_ch0,
                                       q0);
             SiPMData sipm1 = SiPMData(sipm1ID,
                                       channel1ID,
-                                      ppsTicks,
+                                      response.ppsTicks,
                                       ts1_ch1,
                                       q1);
 
-            StripData strip_data = StripData(mac5,
-                                             flags,
-                                             orientation,
-                                             sipm0,
-                                             sipm1,
-                                             unixs,
-                                             sipm_coinc,
-                                             ide);
-
-            // Retrive the Tagger object
-            Tagger& tagger = fTaggers[module.taggerName];
-            tagger.data.push_back(strip_data);
+            tagger.data.emplace_back(mac5,
+                                     flags,
+                                     orientation,
+                                     sipm0,
+                                     sipm1,
+                                     unixs,
+                                     sipm_coinc,
+                                     ide);
 
             mf::LogInfo("CRTDetSimAlg")
                 << "CRT HIT in adid/adsid " << adid << "/" << adsid << "\n"
                 << "MAC5 " << mac5 << "\n"
-                << "TRUE TIME  " << tTrue << "\n"
+                << "TRUE TIME  " << response.tTrue << "\n"
                 << "TRACK ID  " << ide.trackID << "\n"
-                << "CRT HIT POS " << x << " " << y << " " << z << "\n"
+                << "CRT HIT POS " << (ide.entryX + ide.exitX) / 2 << " " << (ide.entryY + ide.exitY) / 2 << " " << (ide.entryZ + ide.exitZ) / 2 << "\n"
                 << "CRT STRIP POS " << (strip.minX + strip.maxX) / 2. << " " << (strip.minY + strip.maxY) / 2. << " " << (strip.minZ + strip.maxZ) / 2. << "\n"
                 << "CRT MODULE POS " << (module.minX + module.maxX) / 2. << " " << (module.minY + module.maxY) / 2. << " " << (module.minZ + module.maxZ) / 2. << "\n"
                 << "CRT PLANE ID: " << orientation << "\n"
-                << "CRT distToReadout: " << distToReadout << " " << (module.top ? "top" : "bot") << "\n"
+                << "CRT distToReadout: " << response.distToReadout << " " << (module.top ? "top" : "bot") << "\n"
                 << "CRT Q SiPM 0: " << q0 << ", SiPM 1: " << q1 << '\n'
-                << "CRT Ts1 SiPM 0: " << ts1_ch0 << " SiPM 1: " << ts1_ch1 << "\n";         
+                << "CRT Ts1 SiPM 0: " << ts1_ch0 << " SiPM 1: " << ts1_ch1 << "\n";
         }
     } //end FillTaggers
-  
-  
-    void CRTDetSimAlg::ChargeResponse(double eDep, double d0, double d1, double distToReadout, // input
-                                      long & npe0, long & npe1, double & q0, double &q1) // output
+
+
+    void CRTDetSimAlg::ChargeResponse(std::vector<DepositResponse> & responses)
     {
-        // The expected number of PE, using a quadratic model for the distance
-        // dependence, and scaling linearly with deposited energy.
-        double qr = fParams.UseEdep() ? 1.0 * eDep / fParams.Q0() : 1.0;
+        for (auto & response : responses)
+        {
+            // The expected number of PE, using a quadratic model for the distance
+            // dependence, and scaling linearly with deposited energy.
+            double qr = fParams.UseEdep() ? 1.0 * response.eDep / fParams.Q0() : 1.0;
 
-        double npeExpected =
-            fParams.NpeScaleNorm() / pow(distToReadout - fParams.NpeScaleShift(), 2) * qr;
+            double npeExpected =
+                fParams.NpeScaleNorm() / pow(response.distToReadout - fParams.NpeScaleShift(), 2) * qr;
 
-        // Put PE on channels weighted by transverse distance across the strip,
-        // using an exponential model
+            // Put PE on channels weighted by transverse distance across the strip,
+            // using an exponential model
 
-        double abs0 = exp(-d0 / fParams.AbsLenEff());
-        double abs1 = exp(-d1 / fParams.AbsLenEff());
-        double npeExp0 = npeExpected * abs0 / (abs0 + abs1);
-        double npeExp1 = npeExpected * abs1 / (abs0 + abs1);
+            double abs0 = exp(-response.d0 / fParams.AbsLenEff());
+            double abs1 = exp(-response.d1 / fParams.AbsLenEff());
+            double npeExp0 = npeExpected * abs0 / (abs0 + abs1);
+            double npeExp1 = npeExpected * abs1 / (abs0 + abs1);
 
-        // Observed PE (Poisson-fluctuated)
-        npe0 = CLHEP::RandPoisson::shoot(&fEngine, npeExp0);
-        npe1 = CLHEP::RandPoisson::shoot(&fEngine, npeExp1);
+            // Observed PE (Poisson-fluctuated)
+            response.npe0 = CLHEP::RandPoisson::shoot(&fEngine, npeExp0);
+            response.npe1 = CLHEP::RandPoisson::shoot(&fEngine, npeExp1);
+        }
 
         // SiPM and ADC response: Npe to ADC counts, pedestal is added later
-        q0 = CLHEP::RandGauss::shoot(&fEngine, /*fQPed + */fParams.QSlope() * npe0,
-                                     fParams.QRMS() * sqrt(npe0));
-        q1 = CLHEP::RandGauss::shoot(&fEngine, /*fQPed + */fParams.QSlope() * npe1,
-                                     fParams.QRMS() * sqrt(npe1));
+        fNormals.resize(2 * responses.size());
+        CLHEP::RandGauss::shootArray(&fEngine, fNormals.size(), fNormals.data());
 
-        // Catch rare negative values from random sample
-        // Do not apply ADC threshold here, this is done after trigger simulation effects
-        if (q0 < 0.) q0 = 0.;
-        if (q1 < 0.) q1 = 0.;
+        for (size_t i = 0; i < responses.size(); i++)
+        {
+            auto & response = responses[i];
+
+            response.q0 = /*fQPed + */fParams.QSlope() * response.npe0
+                + fParams.QRMS() * sqrt(response.npe0) * fNormals[2 * i];
+            response.q1 = /*fQPed + */fParams.QSlope() * response.npe1
+                + fParams.QRMS() * sqrt(response.npe1) * fNormals[2 * i + 1];
+
+            // Catch rare negative values from random sample
+            // Do not apply ADC threshold here, this is done after trigger simulation effects
+            if (response.q0 < 0.) response.q0 = 0.;
+            if (response.q1 < 0.) response.q1 = 0.;
+
+            mf::LogInfo("CRTSetSimAlg")
+                << "CRT CHARGE RESPONSE: eDep = " << response.eDep
+                << ", npe0 = " << response.npe0 << " -> q0 = " << response.q0
+                << ", npe1 = " << response.npe1 << " -> q1 = " << response.q1 << std::endl;
+        }
+    }
 
-        mf::LogInfo("CRTSetSimAlg")
-            << "CRT CHARGE RESPONSE: eDep = " << eDep
-            << ", npeExpected = " << npeExpected
-            << ", npe0 = " << npe0 << " -> q0 = " << q0
-            << ", npe1 = " << npe1 << " -> q1 = " << q1 << std::endl;
+    void CRTDetSimAlg::TriggerTicks(std::vector<DepositResponse> & responses)
+    {
+        // Three Gaussian variates per SiPM and one flat variate per deposit
+        fNormals.resize(6 * responses.size());
+        CLHEP::RandGauss::shootArray(&fEngine, fNormals.size(), fNormals.data());
+
+        fFlats.resize(responses.size());
+        fEngine.flatArray(fFlats.size(), fFlats.data());
+
+        // Time relative to PPS: Random for now! (FIXME)
+        const long ppsRange = fParams.ClockSpeedCRT() * 1e6;
+
+        for (size_t i = 0; i < responses.size(); i++)
+        {
+            auto & response = responses[i];
+
+            response.ts1_ch0 = getChannelTriggerTicks(response.tTrue, response.npe0, response.distToReadout,
+                                                      &fNormals[6 * i]);
+            response.ts1_ch1 = getChannelTriggerTicks(response.tTrue, response.npe1, response.distToReadout,
+                                                      &fNormals[6 * i + 3]);
+
+            response.ppsTicks = static_cast<long>(fFlats[i] * static_cast<double>(ppsRange));
+        }
     }
 
-    uint32_t CRTDetSimAlg::getChannelTriggerTicks(/*detinfo::ElecClock& clock,*/
-                                             float t0, float npeMean, float r)
+    uint32_t CRTDetSimAlg::getChannelTriggerTicks(float t0, float npeMean, float r, const double * normals)
     {
         // Hit timing, with smearing and NPE dependence
         double tDelayMean =
@@ -571,13 +622,13 @@ namespace crt {
           fParams.TDelayRMSExpNorm() *
             exp(-(npeMean - fParams.TDelayRMSExpShift()) / fParams.TDelayRMSExpScale());
 
-        double tDelay = CLHEP::RandGauss::shoot(&fEngine, tDelayMean, tDelayRMS);
+        double tDelay = tDelayMean + tDelayRMS * normals[0];
 
         // Time resolution of the interpolator
-        tDelay += CLHEP::RandGauss::shoot(&fEngine, 0, fParams.TResInterpolator());
+        tDelay += fParams.TResInterpolator() * normals[1];
 
         // Propagation time
-        double tProp = CLHEP::RandGauss::shoot(fParams.PropDelay(), fParams.PropDelayError()) * r;
+        double tProp = (fParams.PropDelay() + fParams.PropDelayError() * normals[2]) * r;
 
         double t = t0 + tProp + tDelay;
 
@@ -609,7 +660,7 @@ namespace crt {
     void CRTDetSimAlg::ClearTaggers()
     {
 
-        fTaggers.clear();
+        for (auto & tagger : fTaggers) tagger.data.clear();
         fData.clear();
         fAuxData.clear();
     }
@@ -63,6 +63,7 @@ using sim::AuxDetIDE;
 namespace sbnd {
     namespace crt {
         class CRTDetSimAlg;
+        struct DepositResponse;
         struct SiPMData;
         struct StripData;
         struct Tagger;
@@ -70,6 +71,23 @@ namespace sbnd {
     }
 }
 
+/** A struct to temporarily store the simulated response to a single AuxDetIDE.
+ */
+struct sbnd::crt::DepositResponse {
+    double tTrue; ///< The true time of the deposit, including the time offset [ns]
+    double eDep; ///< The deposited energy
+    double distToReadout; ///< The distance between the deposit and the strip readout end
+    double d0; ///< The distance to the optical fiber connected to SiPM 0
+    double d1; ///< The distance to the optical fiber connected to SiPM 1
+    long npe0; ///< The number of PEs for SiPM 0
+    long npe1; ///< The number of PEs for SiPM 1
+    double q0; ///< The ADC simulated value (double) for SiPM 0
+    double q1; ///< The ADC simulated value (double) for SiPM 1
+    uint32_t ts1_ch0; ///< The trigger ticks of SiPM 0
+    uint32_t ts1_ch1; ///< The trigger ticks of SiPM 1
+    uint32_t ppsTicks; ///< The time relative to PPS
+};
+
 /** A struct to temporarily store information on a single SiPM.
  */
 struct sbnd::crt::SiPMData {
@@ -149,7 +167,7 @@ public:
      * @param adsid The AuxDetSensitiveChannelID
      * @param ides The vector of AuxDetIDE
      */
-    void FillTaggers(const uint32_t adid, const uint32_t adsid, std::vector<AuxDetIDE> ides);
+    void FillTaggers(const uint32_t adid, const uint32_t adsid, const std::vector<AuxDetIDE> & ides);
 
     /**
      * Returns FEBData objects.
@@ -169,43 +187,36 @@ public:
      *
      * @return Vector of pairs (FEBData, vector of AuxDetIDE)
      */
-    std::vector<std::pair<FEBData, std::vector<AuxDetIDE>>> GetData();
+    const std::vector<std::pair<FEBData, std::vector<AuxDetIDE>>> & GetData() const;
 
     /**
      * Returns the indeces of SiPMs associated to the AuxDetIDEs
      *
      * @return Vector of vector (1: FEBs, 2: SiPMs indeces per AuxDetIDE)
      */
-    std::vector<std::vector<int>> GetAuxData();
+    const std::vector<std::vector<int>> & GetAuxData() const;
 
 
     /**
-     * Get the channel trigger time relative to the start of the MC event.
+     * Get the channel trigger times, relative to the start of the MC event, and
+     * the PPS times for a set of deposits. The Gaussian and flat variates are
+     * drawn from the module engine in blocks.
      *
-     * @param clock The clock to count ticks on
-     * @param t0 The starting time (which delay is added to)
-     * @param npe Number of observed photoelectrons
-     * @param r Distance between the energy deposit and strip readout end [mm]
-     * @return Trigger clock ticks at this true hit time
+     * @param responses The deposits, with tTrue, distToReadout and the PEs filled,
+     *                  on output ts1_ch0, ts1_ch1 and ppsTicks are filled too
      */
-    uint32_t getChannelTriggerTicks(/*detinfo::ElecClock& clock,*/
-                                    float t0, float npeMean, float r);
+    void TriggerTicks(std::vector<DepositResponse> & responses);
 
 
     /**
-     * Simulated the CRT charge response. Does not include waveform emulation.
+     * Simulated the CRT charge response for a set of deposits. Does not include
+     * waveform emulation. The Gaussian variates are drawn from the module engine
+     * in one block.
      *
-     * @param eDep The simulated energy deposited on the strip from G4
-     * @param d0 The distance to the optical fiber connected to SiPM 0
-     * @param d1 The distance to the optical fiber connected to SiPM 1
-     * @param distToReadout The distance to the readout
-     * @param npe0 The output number of PEs for SiPM 0
-     * @param npe1 The output number of PEs for SiPM 1
-     * @param q0 The output ADC simulated value (double) for SiPM 0
-     * @param q1 The output ADC simulated value (double) for SiPM 1
+     * @param responses The deposits, with eDep, distToReadout, d0 and d1 filled,
+     *                  on output npe0, npe1, q0 and q1 are filled too
      */
-    void ChargeResponse(double eDep, double d0, double d1, double distToReadout,
-                        long & npe0, long & npe1, double & q0, double & q1);
+    void ChargeResponse(std::vector<DepositResponse> & responses);
 
 
     /**
@@ -239,19 +250,24 @@ private:
     double fG4RefTime; //!< The G4 reference time that can be used as a time offset
     double fTimeOffset; //!< The time that will be used in the simulation
 
-    std::unique_ptr<ROOT::Math::Interpolator> fInterpolator; //!< The interpolator used to estimate the CRT waveform
+    std::vector<double> fWaveformTable; //!< The normalised CRT waveform at each tick of time delay, up to the end of the waveform
 
-    std::map<std::string, Tagger> fTaggers; //!< A list of hit taggers, before any coincidence requirement (name -> tagger)
+    std::vector<Tagger> fTaggers; //!< The hit taggers, before any coincidence requirement (indexed as the CRTGeoAlg tagger table)
 
     std::vector<std::pair<FEBData, std::vector<AuxDetIDE>>> fData; //!< This member stores the final FEBData for the CRT simulation
 
     std::vector<std::vector<int>> fAuxData; //!< This member stores the indeces of SiPM per AuxDetIDE
 
-    CRTGeoAlg fCRTGeoAlg;
+    std::shared_ptr<const CRTGeoAlg> fCRTGeoAlg = CRTGeoAlg::Shared();
+
+    std::vector<AuxDetIDE> fIDEs; //!< Scratch space for the time ordered IDEs of one strip
+    std::vector<DepositResponse> fResponses; //!< Scratch space for the deposits of one strip
+    std::vector<double> fNormals; //!< Scratch space for the block of Gaussian variates
+    std::vector<double> fFlats; //!< Scratch space for the block of flat variates
 
     /**
      * Configures the waveform by reading waveform points from configuration and
-     * setting up the interpolator.
+     * tabulating their linear interpolation at every tick of time delay.
      */
     void ConfigureWaveform();
 
@@ -261,14 +277,26 @@ private:
      */
     void ConfigureTimeOffset();
 
+    /**
+     * Get the channel trigger time relative to the start of the MC event.
+     *
+     * @param t0 The starting time (which delay is added to)
+     * @param npeMean Number of observed photoelectrons
+     * @param r Distance between the energy deposit and strip readout end [mm]
+     * @param normals Three standard Gaussian variates, for the delay, the interpolator
+     *                resolution and the propagation time
+     * @return Trigger clock ticks at this true hit time
+     */
+    uint32_t getChannelTriggerTicks(float t0, float npeMean, float r, const double * normals);
+
     /**
      * Proccesses a set of CRT strips that belong to the same trigger. This method
      * takes as input all the strips that belong to a single CRT tagger-level trigger
-     * and constructs FEBData objects from them.
+     * and constructs FEBData objects from them, one per FEB in increasing FEB number.
      *
-     * @param strips The set of strips that belong to the same trigger
+     * @param strips The set of strips that belong to the same trigger, reordered by FEB on output
      */
-    void ProcessStrips(const std::vector<StripData> & strips);
+    void ProcessStrips(std::vector<StripData> & strips);
 
     /**
      * Adds ADCs to a certain SiPM in a FEBData object
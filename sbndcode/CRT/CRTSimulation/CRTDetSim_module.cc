@@ -4,7 +4,7 @@
 /// \author mastbaum@uchicago.edu
 ////////////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ReplicatedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -47,13 +47,17 @@ namespace crt {
 
 void CRTDetSim::reconfigure(fhicl::ParameterSet const & p) {
   fG4ModuleLabel = p.get<std::string>("G4ModuleLabel");
+  fDropInputProducts = p.get<bool>("DropInputProducts", false);
 }
 
 
-CRTDetSim::CRTDetSim(fhicl::ParameterSet const & p)
-  : EDProducer{p}
+CRTDetSim::CRTDetSim(fhicl::ParameterSet const & p, art::ProcessingFrame const& frame)
+  : ReplicatedProducer{p, frame}
+  , fSchedule(frame.scheduleID().id())
+  // the first replica keeps the single-schedule engine name
   , fEngine(art::ServiceHandle<rndm::NuRandomService>{}->registerAndSeedEngine(
-              createEngine(0, "HepJamesRandom", "crt"), "HepJamesRandom", "crt", p, "Seed"))
+              createEngine(0, "HepJamesRandom", "crt"), "HepJamesRandom",
+              fSchedule ? "crt" + std::to_string(fSchedule) : std::string("crt"), p, "Seed"))
   , fG4RefTime(art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob().G4ToElecTime(0) * 1e3) // ns
   , fDetAlg(p.get<fhicl::ParameterSet>("DetSimParams"), fEngine, fG4RefTime)
 {
@@ -68,7 +72,7 @@ CRTDetSim::CRTDetSim(fhicl::ParameterSet const & p)
 
 
 
-void CRTDetSim::produce(art::Event & e) {
+void CRTDetSim::produce(art::Event & e, art::ProcessingFrame const&) {
 
   std::unique_ptr<std::vector<FEBData> > FEBDataOut(new std::vector<FEBData>);
   art::PtrMaker<FEBData> makeDataPtr(e);
@@ -109,14 +113,17 @@ void CRTDetSim::produce(art::Event & e) {
 
   } // loop over AuxDetSimChannels
 
+  // the taggers keep their own copies of the IDEs
+  if (fDropInputProducts && channels.isValid()) channels.removeProduct();
+
 
   //
   // Step 2: Apply Coincidence, deadtime, etc.
   //
 
   fDetAlg.CreateData();
-  std::vector<std::pair<FEBData, std::vector<sim::AuxDetIDE>>> data = fDetAlg.GetData();
-  std::vector<std::vector<int>> auxdata = fDetAlg.GetAuxData();
+  const std::vector<std::pair<FEBData, std::vector<sim::AuxDetIDE>>> & data = fDetAlg.GetData();
+  const std::vector<std::vector<int>> & auxdata = fDetAlg.GetAuxData();
 
   //
   // Step 3: Save output
@@ -125,10 +132,10 @@ void CRTDetSim::produce(art::Event & e) {
   // for(auto const& dataPair : data){
   for (size_t i = 0; i < data.size(); i++) {
 
-    auto & dataPair = data[i];
-    auto & feb = dataPair.first;
-    auto & ides = dataPair.second;
-    auto & idxs = auxdata.at(i);
+    auto const& dataPair = data[i];
+    auto const& feb = dataPair.first;
+    auto const& ides = dataPair.second;
+    auto const& idxs = auxdata.at(i);
 
     FEBDataOut->push_back(feb);
     art::Ptr<FEBData> dataPtr = makeDataPtr(FEBDataOut->size()-1);
@@ -33,8 +33,41 @@ namespace sbnd::crt {
     return;
   }
 
+  SPTimeIndex CRTSpacePointMatchAlg::IndexCRTSpacePoints(const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const art::Event &e)
+  {
+    if(!fDCAuseBox || crtSPs.empty())
+      return CRTTimeIndex::IndexSpacePoints(crtSPs, fTimeCorrection, fPECut, fMaxUncert);
+
+    art::Handle<std::vector<CRTSpacePoint>> spacePointHandle;
+    e.getByLabel(fCRTSpacePointLabel, spacePointHandle);
+
+    const art::FindOneP<CRTCluster> spacePointsToClusters(spacePointHandle, e, fCRTSpacePointLabel);
+
+    return CRTTimeIndex::IndexSpacePoints(crtSPs, fTimeCorrection, fPECut, fMaxUncert, &spacePointsToClusters);
+  }
+
   SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
                                                                   const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const art::Event &e)
+  {
+    return GetClosestCRTSpacePoint(detProp, track, IndexCRTSpacePoints(crtSPs, e), e);
+  }
+
+  SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                                                  const std::vector<art::Ptr<recob::Hit>> &hits, const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs,
+                                                                  const art::Event &e)
+  {
+    return GetClosestCRTSpacePoint(detProp, track, hits, IndexCRTSpacePoints(crtSPs, e));
+  }
+
+  SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                                                  const std::pair<double, double> t0MinMax, const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const int driftDirection,
+                                                                  const art::Event &e)
+  {
+    return GetClosestCRTSpacePoint(detProp, track, t0MinMax, IndexCRTSpacePoints(crtSPs, e), driftDirection);
+  }
+
+  SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                                                  const SPTimeIndex &spIndex, const art::Event &e)
   {
     art::Handle<std::vector<recob::Track>> trackHandle;
     e.getByLabel(fTPCTrackLabel, trackHandle);
@@ -42,12 +75,11 @@ namespace sbnd::crt {
     const art::FindManyP<recob::Hit> tracksToHits(trackHandle, e, fTPCTrackLabel);
     const std::vector<art::Ptr<recob::Hit>> hits = tracksToHits.at(track.key());
 
-    return GetClosestCRTSpacePoint(detProp, track, hits, crtSPs, e);
+    return GetClosestCRTSpacePoint(detProp, track, hits, spIndex);
   }
 
   SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
-                                                                  const std::vector<art::Ptr<recob::Hit>> &hits, const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs,
-                                                                  const art::Event &e)
+                                                                  const std::vector<art::Ptr<recob::Hit>> &hits, const SPTimeIndex &spIndex)
   {
     const geo::Point_t start = track->Vertex();
     const geo::Point_t end   = track->End();
@@ -57,12 +89,11 @@ namespace sbnd::crt {
 
     const std::pair<double, double> t0MinMax = TrackT0Range(detProp, start.X(), end.X(), driftDirection, xLimits);
 
-    return GetClosestCRTSpacePoint(detProp, track, t0MinMax, crtSPs, driftDirection, e);
+    return GetClosestCRTSpacePoint(detProp, track, t0MinMax, spIndex, driftDirection);
   }
 
   SPMatchCandidate CRTSpacePointMatchAlg::GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
-                                                                  const std::pair<double, double> t0MinMax, const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const int driftDirection,
-                                                                  const art::Event &e)
+                                                                  const std::pair<double, double> t0MinMax, const SPTimeIndex &spIndex, const int driftDirection)
   {
     if(track->Length() < fMinTPCTrackLength)
       return SPMatchCandidate();
@@ -70,70 +101,102 @@ namespace sbnd::crt {
     const geo::Point_t start = track->Vertex();
     const geo::Point_t end   = track->End();
 
-    std::vector<SPMatchCandidate> candidates;
+    // Only space points with t0min - 10 < time < t0max + 10 can match
+    const auto [iFirst, iLast] = spIndex.Window(t0MinMax.first - 10., t0MinMax.second + 10.);
+
+    if(iFirst == iLast)
+      return SPMatchCandidate();
+
+    auto const first = spIndex.times.begin() + iFirst;
+    auto const last  = spIndex.times.begin() + iLast;
 
-    for(auto &crtSP : crtSPs){
+    // The CRT time only shifts the whole track in x, which cancels in the
+    // endpoint directions, so both methods only need the track
+    const std::pair<geo::Vector_t, geo::Vector_t> startEndDir = fDirMethod==2
+      ? AverageTrackDirections(track, fTrackDirectionFrac)
+      : TrackDirections(detProp, track, fTrackDirectionFrac, 0., driftDirection);
 
-      const double crtTime = crtSP->Time() * 1e-3 + fTimeCorrection;
+    const geo::Vector_t startDir = startEndDir.first;
+    const geo::Vector_t endDir   = startEndDir.second;
+
+    // Positive scores are preferred to negative ones, then the lowest score wins
+    auto better = [](const double a, const double b)
+      {
+        if(a < 0 && b > 0)
+          return false;
+        else if(a > 0 && b < 0)
+          return true;
+        else
+          return a < b;
+      };
 
-      if(!(crtTime > t0MinMax.first - 10. && crtTime < t0MinMax.second + 10.))
-        continue;
+    // The simple DCAs of all the space points in the window are computed in one
+    // batch per track end, the box DCAs one space point at a time
+    const size_t nWindow = iLast - iFirst;
 
-      if(crtSP->PE() < fPECut || crtSP->XErr() > fMaxUncert || crtSP->YErr() > fMaxUncert || crtSP->ZErr() > fMaxUncert)
-        continue;
+    std::vector<double> startDCAs, endDCAs;
 
-      const geo::Point_t crtPoint = crtSP->Pos();
-  
-      std::pair<geo::Vector_t, geo::Vector_t> startEndDir;
+    if(!fDCAuseBox)
+      {
+        std::vector<double> xShifts(nWindow);
+        for(size_t j = 0; j < nWindow; ++j)
+          xShifts[j] = driftDirection * spIndex.times[iFirst + j] * detProp.DriftVelocity();
 
-      if(fDirMethod==2)
-        startEndDir = AverageTrackDirections(track, fTrackDirectionFrac);
-      else
-        startEndDir = TrackDirections(detProp, track, fTrackDirectionFrac, crtTime, driftDirection);
+        startDCAs.resize(nWindow);
+        endDCAs.resize(nWindow);
 
-      const geo::Vector_t startDir = startEndDir.first;
-      const geo::Vector_t endDir   = startEndDir.second;
-    
-      const double startDCA = DistOfClosestApproach(detProp, start, startDir, crtSP, driftDirection, crtTime, e);
-      const double endDCA   = DistOfClosestApproach(detProp, end, endDir, crtSP, driftDirection, crtTime, e);
+        CRTCommonUtils::SimpleDCA(start, startDir, xShifts.data(), &spIndex.x[iFirst], &spIndex.y[iFirst], &spIndex.z[iFirst],
+                                  nWindow, startDCAs.data());
+        CRTCommonUtils::SimpleDCA(end, endDir, xShifts.data(), &spIndex.x[iFirst], &spIndex.y[iFirst], &spIndex.z[iFirst],
+                                  nWindow, endDCAs.data());
+      }
 
-      const double xshift = driftDirection * crtTime * detProp.DriftVelocity();
+    SPMatchCandidate best;
 
-      geo::Point_t thisstart = start;
-      thisstart.SetX(start.X()+xshift);
-      geo::Point_t thisend = end;
-      thisend.SetX(end.X()+xshift);
+    for(auto it = first; it != last; ++it)
+      {
+        const size_t i                       = it - spIndex.times.begin();
+        const double crtTime                 = *it;
+        const art::Ptr<CRTSpacePoint> &crtSP = spIndex.spacePoints[i];
+        const CRTTagger tagger               = fDCAuseBox ? spIndex.taggers[i] : kUndefinedTagger;
 
-      if(startDCA < fDCALimit || endDCA < fDCALimit)
-        {
-          const double distS = (crtPoint - thisstart).R();
-          const double distE = (crtPoint - thisend).R();
+        const geo::Point_t crtPoint = crtSP->Pos();
 
-          const double scoreS = fDCAoverLength ? startDCA / distS : startDCA;
-          const double scoreE = fDCAoverLength ? endDCA / distE : endDCA;
+        const double startDCA = fDCAuseBox ? DistOfClosestApproach(detProp, start, startDir, crtSP, tagger, driftDirection, crtTime)
+                                           : startDCAs[i - iFirst];
+        const double endDCA   = fDCAuseBox ? DistOfClosestApproach(detProp, end, endDir, crtSP, tagger, driftDirection, crtTime)
+                                           : endDCAs[i - iFirst];
 
-          if(distS < distE && startDCA < fDCALimit)
-            candidates.emplace_back(crtSP, track, crtTime, scoreS, true);
-          else if(endDCA < fDCALimit)
-            candidates.emplace_back(crtSP, track, crtTime, scoreE, true);
-        }
-    }
+        if(!(startDCA < fDCALimit || endDCA < fDCALimit))
+          continue;
 
-    if(candidates.size() == 0)
-      return SPMatchCandidate();
+        const double xshift = driftDirection * crtTime * detProp.DriftVelocity();
+
+        geo::Point_t thisstart = start;
+        thisstart.SetX(start.X()+xshift);
+        geo::Point_t thisend = end;
+        thisend.SetX(end.X()+xshift);
+
+        const double distS = (crtPoint - thisstart).R();
+        const double distE = (crtPoint - thisend).R();
+
+        const double scoreS = fDCAoverLength ? startDCA / distS : startDCA;
+        const double scoreE = fDCAoverLength ? endDCA / distE : endDCA;
+
+        double score;
+
+        if(distS < distE && startDCA < fDCALimit)
+          score = scoreS;
+        else if(endDCA < fDCALimit)
+          score = scoreE;
+        else
+          continue;
+
+        if(!best.valid || better(score, best.score))
+          best = SPMatchCandidate(crtSP, track, crtTime, score, true);
+      }
 
-    std::sort(candidates.begin(), candidates.end(),
-              [](const SPMatchCandidate &a, const SPMatchCandidate &b)
-              {
-                if(a.score < 0 && b.score > 0)
-                  return false;
-                else if(a.score > 0 && b.score < 0)
-                  return true;
-                else
-                  return a.score < b.score;
-              });
-
-    return candidates[0];
+    return best;
   }
 
   std::pair<double, double> CRTSpacePointMatchAlg::TrackT0Range(detinfo::DetectorPropertiesData const &detProp, const double startX,
@@ -162,19 +225,26 @@ namespace sbnd::crt {
                                                       const geo::Vector_t &trackDir, const art::Ptr<CRTSpacePoint> &crtSP,
                                                       const int driftDirection, const double t0, const art::Event &e)
   {
-    const double xshift = driftDirection* t0 * detProp.DriftVelocity();
-    trackStart.SetX(trackStart.X() + xshift);
-
-    const geo::Point_t end = trackStart + trackDir;
-
     art::Handle<std::vector<CRTSpacePoint>> spacePointHandle;
     e.getByLabel(fCRTSpacePointLabel, spacePointHandle);
 
     const art::FindOneP<CRTCluster> spacePointsToClusters(spacePointHandle, e, fCRTSpacePointLabel);
     const art::Ptr<CRTCluster> cluster = spacePointsToClusters.at(crtSP.key());
 
+    return DistOfClosestApproach(detProp, trackStart, trackDir, crtSP, cluster->Tagger(), driftDirection, t0);
+  }
+
+  double CRTSpacePointMatchAlg::DistOfClosestApproach(detinfo::DetectorPropertiesData const &detProp, geo::Point_t trackStart,
+                                                      const geo::Vector_t &trackDir, const art::Ptr<CRTSpacePoint> &crtSP,
+                                                      const CRTTagger tagger, const int driftDirection, const double t0)
+  {
+    const double xshift = driftDirection* t0 * detProp.DriftVelocity();
+    trackStart.SetX(trackStart.X() + xshift);
+
+    const geo::Point_t end = trackStart + trackDir;
+
     if(fDCAuseBox)
-      return CRTCommonUtils::DistToCRTSpacePoint(crtSP, trackStart, end, cluster->Tagger());
+      return CRTCommonUtils::DistToCRTSpacePoint(crtSP, trackStart, end, tagger);
     else
       return CRTCommonUtils::SimpleDCA(crtSP, trackStart, trackDir);
   }
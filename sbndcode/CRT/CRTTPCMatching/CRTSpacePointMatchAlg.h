@@ -30,6 +30,7 @@
 #include "sbnobj/SBND/CRT/CRTSpacePoint.hh"
 #include "sbnobj/SBND/CRT/CRTCluster.hh"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
+#include "sbndcode/CRT/CRTUtils/CRTTimeIndex.h"
 #include "sbndcode/CRT/CRTUtils/TPCGeoUtil.h"
 
 namespace sbnd::crt {
@@ -54,6 +55,11 @@ namespace sbnd::crt {
     }
   };
 
+  // CRT space points passing the quality cuts, ordered by their corrected time (us)
+  // so that each track only has to look at those inside its allowed t0 window;
+  // the taggers are only filled when using the box DCA
+  using SPTimeIndex = CRTSpacePointTimeIndex;
+
 
   class CRTSpacePointMatchAlg {
   public:
@@ -143,6 +149,8 @@ namespace sbnd::crt {
 
     void reconfigure(const Config& config);
 
+    SPTimeIndex IndexCRTSpacePoints(const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const art::Event &e);
+
     SPMatchCandidate GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
                                              const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const art::Event &e);
 
@@ -154,6 +162,15 @@ namespace sbnd::crt {
                                              const std::pair<double, double> t0MinMax, const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const int driftDirection,
                                              const art::Event &e);
 
+    SPMatchCandidate GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                             const SPTimeIndex &spIndex, const art::Event &e);
+
+    SPMatchCandidate GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                             const std::vector<art::Ptr<recob::Hit>> &hits, const SPTimeIndex &spIndex);
+
+    SPMatchCandidate GetClosestCRTSpacePoint(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
+                                             const std::pair<double, double> t0MinMax, const SPTimeIndex &spIndex, const int driftDirection);
+
     std::pair<double, double> TrackT0Range(detinfo::DetectorPropertiesData const &detProp, const double startX,
                                            const double endX, const int driftDirection, const std::pair<double, double> xLimits);
 
@@ -161,6 +178,10 @@ namespace sbnd::crt {
                                  const geo::Vector_t &trackDir, const art::Ptr<CRTSpacePoint> &crtSP,
                                  const int driftDirection, const double t0, const art::Event &e);
 
+    double DistOfClosestApproach(detinfo::DetectorPropertiesData const &detProp, geo::Point_t trackStart,
+                                 const geo::Vector_t &trackDir, const art::Ptr<CRTSpacePoint> &crtSP,
+                                 const CRTTagger tagger, const int driftDirection, const double t0);
+
     std::pair<geo::Vector_t, geo::Vector_t> AverageTrackDirections(const art::Ptr<recob::Track> &track, const double frac);
     std::pair<geo::Vector_t, geo::Vector_t> TrackDirections(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &track,
                                                             const double frac, const double CRTtime, const int driftDirection);
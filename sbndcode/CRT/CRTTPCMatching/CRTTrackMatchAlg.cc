@@ -43,39 +43,179 @@ namespace sbnd::crt {
   TrackMatchCandidate CRTTrackMatchAlg::GetBestMatchedCRTTrack(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &tpcTrack,
                                                                const std::vector<art::Ptr<recob::Hit>> &hits, const std::vector<art::Ptr<CRTTrack>> &crtTracks)
   {
-    if(tpcTrack->Length() < fMinTPCTrackLength)
-      return TrackMatchCandidate();
+    const CRTTrackIndex crtIndex = IndexCRTTracks(detProp, crtTracks);
+
+    return GetBestMatchedCRTTrack(SummariseTPCTrack(tpcTrack, hits), crtIndex);
+  }
+
+  CRTTrackIndex CRTTrackMatchAlg::IndexCRTTracks(detinfo::DetectorPropertiesData const &detProp, const std::vector<art::Ptr<CRTTrack>> &crtTracks) const
+  {
+    CRTTrackIndex crtIndex;
+    static_cast<CRTTrackTimeIndex&>(crtIndex) = CRTTimeIndex::IndexTracks(crtTracks);
 
-    if(fSelectionMetric == "angle")
+    const unsigned nTracks     = crtIndex.size();
+    const double driftVelocity = detProp.DriftVelocity();
+
+    crtIndex.shifts.reserve(nTracks);
+
+    crtIndex.driftVelocity = driftVelocity;
+
+    for(const double crtTime : crtIndex.times)
+      crtIndex.shifts.push_back(crtTime * driftVelocity);
+
+    for(auto const &tpcGeo : fGeometryService->Iterate<geo::TPCGeo>())
       {
-        TrackMatchCandidate candidate = ClosestCRTTrackByAngle(detProp, tpcTrack, hits, crtTracks, fMaxDCA);
+        std::vector<bool> &crosses = crtIndex.crossesTPC[tpcGeo.ID()];
+        crosses.reserve(nTracks);
+
+        for(auto const &crtTrack : crtIndex.crtTracks)
+          {
+            geo::Point_t entry, exit;
+            crosses.push_back(TPCIntersection(tpcGeo, crtTrack, entry, exit));
+          }
+      }
+
+    return crtIndex;
+  }
+
+  TPCTrackSummary CRTTrackMatchAlg::SummariseTPCTrack(const art::Ptr<recob::Track> &tpcTrack, const std::vector<art::Ptr<recob::Hit>> &hits) const
+  {
+    TPCTrackSummary summary;
+    summary.tpcTrack = tpcTrack;
+
+    if(tpcTrack->Length() < fMinTPCTrackLength || hits.empty())
+      return summary;
+
+    summary.driftDirection = TPCGeoUtil::DriftDirectionFromHits(fGeometryService, hits);
+    summary.tpcGeo         = &fGeometryService->GetElement(hits[0]->WireID().asTPCID());
+    summary.vertex         = tpcTrack->Vertex();
+    summary.end            = tpcTrack->End();
+
+    geo::Point_t tpcStart = summary.vertex;
+    geo::Point_t tpcEnd   = summary.end;
+    if(tpcStart.Y() < tpcEnd.Y())
+      std::swap(tpcStart, tpcEnd);
+
+    summary.dir = tpcStart - tpcEnd;
 
-        if(candidate.score > fMaxAngleDiff)
-          return TrackMatchCandidate();
-        else
-          return candidate;
+    const unsigned N = tpcTrack->NumberTrajectoryPoints();
+    summary.points.reserve(N);
+
+    for(unsigned i = 0; i < N; ++i)
+      {
+        if(tpcTrack->HasValidPoint(i))
+          summary.points.push_back(tpcTrack->LocationAtPoint(i));
       }
-    else if(fSelectionMetric == "dca")
+
+    summary.valid = !summary.points.empty();
+
+    return summary;
+  }
+
+  TrackMatchCandidate CRTTrackMatchAlg::GetBestMatchedCRTTrack(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex) const
+  {
+    if(!summary.valid)
+      return TrackMatchCandidate();
+
+    const bool byAngle = fSelectionMetric == "angle";
+    const bool byDCA   = fSelectionMetric == "dca";
+
+    if((byAngle && fMaxDCA == -1.) || (byDCA && fMaxAngleDiff == -1.))
+      return TrackMatchCandidate();
+
+    const double maxScore = byAngle ? fMaxAngleDiff : (byDCA ? fMaxDCA : fMaxScore);
+
+    const std::vector<bool> &crosses = crtIndex.crossesTPC.at(summary.tpcGeo->ID());
+
+    TrackMatchCandidate best;
+    size_t bestOrder = 0;
+
+    // The candidates are visited in time order; among equal scores the first CRT
+    // track of the input wins, as in a scan of the input
+    auto consider = [&](const size_t i)
       {
-        TrackMatchCandidate candidate = ClosestCRTTrackByDCA(detProp, tpcTrack, hits, crtTracks, fMaxAngleDiff);
+        if(!crosses[i])
+          return;
+
+        const double shift = summary.driftDirection * crtIndex.shifts[i];
+
+        if(shift != 0)
+          {
+            geo::Point_t start = summary.vertex;
+            geo::Point_t end   = summary.end;
+            start.SetX(start.X() + shift);
+            end.SetX(end.X() + shift);
+
+            if(!TPCGeoUtil::InsideTPC(start, *summary.tpcGeo, 2.) || !TPCGeoUtil::InsideTPC(end, *summary.tpcGeo, 2.))
+              return;
+          }
 
-        if(candidate.score > fMaxDCA)
-          return TrackMatchCandidate();
-        else
-          return candidate;
+        const double angle = AngleBetweenTracks(summary, crtIndex, i);
+
+        // The DCA is never negative, so a candidate whose angle term alone can not beat
+        // the current best or pass the final cut can be dropped before the DCA is worked out
+        if(byDCA && angle > fMaxAngleDiff)
+          return;
+
+        const double angleTerm = byDCA ? 0. : (byAngle ? angle : 4 * 180 / TMath::Pi() * angle);
+
+        if(angleTerm > maxScore || (best.valid && (angleTerm > best.score || (angleTerm == best.score && crtIndex.order[i] > bestOrder))))
+          return;
+
+        const double DCA = AveDCABetweenTracks(summary, crtIndex, i);
+
+        if(byAngle && DCA > fMaxDCA)
+          return;
+
+        const double score = byAngle ? angle : (byDCA ? DCA : DCA + angleTerm);
+
+        if(!best.valid || score < best.score || (score == best.score && crtIndex.order[i] < bestOrder))
+          {
+            best      = TrackMatchCandidate(crtIndex.crtTracks[i], summary.tpcTrack, crtIndex.times[i], score, true);
+            bestOrder = crtIndex.order[i];
+          }
+      };
+
+    // A non zero shift must keep both ends within 2 cm of the TPC in x, which bounds the
+    // CRT track time; the tracks at time zero do not shift the TPC track at all
+    const double velocity = summary.driftDirection * crtIndex.driftVelocity;
+
+    if(velocity == 0)
+      {
+        for(size_t i = 0; i < crtIndex.size(); ++i)
+          consider(i);
       }
     else
       {
-        TrackMatchCandidate candidate = ClosestCRTTrackByScore(detProp, tpcTrack, hits, crtTracks);
+        const double minShift = summary.tpcGeo->MinX() - 2. - std::min(summary.vertex.X(), summary.end.X());
+        const double maxShift = summary.tpcGeo->MaxX() + 2. - std::max(summary.vertex.X(), summary.end.X());
 
-        if(candidate.score > fMaxScore)
-          return TrackMatchCandidate();
-        else
-          return candidate;
+        // Widened for rounding, the exact check being made for each candidate
+        const double tmin   = (velocity > 0 ? minShift : maxShift) / velocity;
+        const double tmax   = (velocity > 0 ? maxShift : minShift) / velocity;
+        const double margin = 1e-9 * (std::abs(tmin) + std::abs(tmax)) + 1e-6;
+
+        const auto [first, last] = crtIndex.Window(tmin - margin, tmax + margin);
+
+        for(size_t i = first; i < last; ++i)
+          consider(i);
+
+        if(!(tmin - margin <= 0. && 0. <= tmax + margin))
+          {
+            const auto [zeroFirst, zeroLast] = crtIndex.Window(0., 0.);
+
+            for(size_t i = zeroFirst; i < zeroLast; ++i)
+              consider(i);
+          }
       }
+
+    if(best.valid && best.score > maxScore)
+      return TrackMatchCandidate();
+
+    return best;
   }
 
-  bool CRTTrackMatchAlg::TPCIntersection(const geo::TPCGeo &tpcGeo, const art::Ptr<CRTTrack> &track, geo::Point_t &entry, geo::Point_t &exit)
+  bool CRTTrackMatchAlg::TPCIntersection(const geo::TPCGeo &tpcGeo, const art::Ptr<CRTTrack> &track, geo::Point_t &entry, geo::Point_t &exit) const
   {
     const geo::Point_t start = track->Start();
     const geo::Point_t end   = track->End();
@@ -318,4 +458,35 @@ namespace sbnd::crt {
 
     return aveDCA / usedPts;
   }
+
+  double CRTTrackMatchAlg::AngleBetweenTracks(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex, const unsigned i) const
+  {
+    const geo::Vector_t crtDir = crtIndex.starts[i] - crtIndex.ends[i];
+
+    double angle = TMath::ACos(summary.dir.Dot(crtDir) / (summary.dir.R() * crtDir.R()));
+
+    if(angle > TMath::Pi()/2. && angle < TMath::Pi())
+      angle = TMath::Pi() - angle;
+
+    return angle;
+  }
+
+  double CRTTrackMatchAlg::AveDCABetweenTracks(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex, const unsigned i) const
+  {
+    const geo::Point_t &crtStart = crtIndex.starts[i];
+    const geo::Point_t &crtEnd   = crtIndex.ends[i];
+
+    const double shift       = summary.driftDirection * crtIndex.shifts[i];
+    const double denominator = (crtEnd - crtStart).R();
+
+    double aveDCA = 0;
+
+    for(geo::Point_t point : summary.points)
+      {
+        point.SetX(point.X() + shift);
+        aveDCA += (point - crtStart).Cross(point - crtEnd).R() / denominator;
+      }
+
+    return aveDCA / summary.points.size();
+  }
 }
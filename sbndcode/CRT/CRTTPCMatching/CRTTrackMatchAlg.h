@@ -27,8 +27,11 @@
 
 #include "sbnobj/SBND/CRT/CRTTrack.hh"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
+#include "sbndcode/CRT/CRTUtils/CRTTimeIndex.h"
 #include "sbndcode/CRT/CRTUtils/TPCGeoUtil.h"
 
+#include <map>
+
 namespace sbnd::crt {
 
   struct TrackMatchCandidate {
@@ -50,6 +53,29 @@ namespace sbnd::crt {
     }
   };
 
+  // The CRT tracks of an event ordered by time (us) with everything about them that
+  // does not depend on the TPC track being matched: endpoints ordered top to bottom,
+  // drift shift per unit drift direction and whether they cross each TPC
+  struct CRTTrackIndex : public CRTTrackTimeIndex
+  {
+    double                                  driftVelocity = 0.;
+    std::vector<double>                     shifts;
+    std::map<geo::TPCID, std::vector<bool>> crossesTPC;
+  };
+
+  // A TPC track reduced to what the matching needs, worked out once per track
+  struct TPCTrackSummary
+  {
+    art::Ptr<recob::Track>    tpcTrack;
+    bool                      valid = false;
+    int                       driftDirection = 0;
+    const geo::TPCGeo*        tpcGeo = nullptr;
+    geo::Point_t              vertex;
+    geo::Point_t              end;
+    geo::Vector_t             dir;     // top to bottom
+    std::vector<geo::Point_t> points;  // valid trajectory points only
+  };
+
   class CRTTrackMatchAlg {
   public:
 
@@ -106,7 +132,17 @@ namespace sbnd::crt {
 
     void reconfigure(const Config& config);
 
-    bool TPCIntersection(const geo::TPCGeo &tpcGeo, const art::Ptr<CRTTrack> &track, geo::Point_t &entry, geo::Point_t &exit);
+    CRTTrackIndex IndexCRTTracks(detinfo::DetectorPropertiesData const &detProp, const std::vector<art::Ptr<CRTTrack>> &crtTracks) const;
+
+    TPCTrackSummary SummariseTPCTrack(const art::Ptr<recob::Track> &tpcTrack, const std::vector<art::Ptr<recob::Hit>> &hits) const;
+
+    TrackMatchCandidate GetBestMatchedCRTTrack(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex) const;
+
+    double AngleBetweenTracks(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex, const unsigned i) const;
+
+    double AveDCABetweenTracks(const TPCTrackSummary &summary, const CRTTrackIndex &crtIndex, const unsigned i) const;
+
+    bool TPCIntersection(const geo::TPCGeo &tpcGeo, const art::Ptr<CRTTrack> &track, geo::Point_t &entry, geo::Point_t &exit) const;
 
     TrackMatchCandidate GetBestMatchedCRTTrack(detinfo::DetectorPropertiesData const &detProp, const art::Ptr<recob::Track> &tpcTrack,
                                                const std::vector<art::Ptr<CRTTrack>> &crtTracks, const art::Event &e);
@@ -7,7 +7,7 @@
 /// E-mail address: tbrooks@fnal.gov
 /////////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h" 
 #include "art/Framework/Principal/Handle.h"
@@ -25,42 +25,47 @@
 
 #include "sbndcode/CRT/CRTTPCMatching/CRTTrackMatchAlg.h"
 
+#include "tbb/parallel_for.h"
+
 #include <memory>
 
 namespace sbnd::crt {
   class CRTTrackMatching;
 }
 
-class sbnd::crt::CRTTrackMatching : public art::EDProducer {
+class sbnd::crt::CRTTrackMatching : public art::SharedProducer {
 public:
 
-  explicit CRTTrackMatching(fhicl::ParameterSet const& p);
+  explicit CRTTrackMatching(fhicl::ParameterSet const& p, art::ProcessingFrame const&);
 
   CRTTrackMatching(CRTTrackMatching const&) = delete;
   CRTTrackMatching(CRTTrackMatching&&) = delete;
   CRTTrackMatching& operator=(CRTTrackMatching const&) = delete;
   CRTTrackMatching& operator=(CRTTrackMatching&&) = delete;
 
-  void produce(art::Event& e) override;
+  void produce(art::Event& e, art::ProcessingFrame const&) override;
 
 private:
 
     CRTTrackMatchAlg fMatchingAlg;
     art::InputTag    fTPCTrackModuleLabel;
     art::InputTag    fCRTTrackModuleLabel;
+    bool             fUseTrackWorkers;
 };
 
 
-sbnd::crt::CRTTrackMatching::CRTTrackMatching(fhicl::ParameterSet const& p)
-  : EDProducer{p}
+sbnd::crt::CRTTrackMatching::CRTTrackMatching(fhicl::ParameterSet const& p, art::ProcessingFrame const&)
+  : SharedProducer{p}
   , fMatchingAlg(p.get<fhicl::ParameterSet>("MatchingAlg"))
   , fTPCTrackModuleLabel(p.get<art::InputTag>("TPCTrackModuleLabel"))
   , fCRTTrackModuleLabel(p.get<art::InputTag>("CRTTrackModuleLabel"))
+  , fUseTrackWorkers(p.get<bool>("UseTrackWorkers", false))
   {
     produces<art::Assns<CRTTrack, recob::Track, anab::T0>>();
+    async<art::InEvent>();
   }
 
-void sbnd::crt::CRTTrackMatching::produce(art::Event& e)
+void sbnd::crt::CRTTrackMatching::produce(art::Event& e, art::ProcessingFrame const&)
 {
   auto crtTrackTPCTrackAssn = std::make_unique<art::Assns<CRTTrack, recob::Track, anab::T0>>();
 
@@ -77,20 +82,44 @@ void sbnd::crt::CRTTrackMatching::produce(art::Event& e)
   art::fill_ptr_vector(tpcTrackVec, tpcTrackHandle);
 
   art::FindOneP<recob::PFParticle> tracksToPFPs(tpcTrackHandle, e, fTPCTrackModuleLabel);
+  art::FindManyP<recob::Hit> tracksToHits(tpcTrackHandle, e, fTPCTrackModuleLabel);
 
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e);
 
-  std::vector<TrackMatchCandidate> candidates;
+  const CRTTrackIndex crtTrackIndex = fMatchingAlg.IndexCRTTracks(detProp, crtTrackVec);
+
+  std::vector<art::Ptr<recob::Track>> muonTrackVec;
 
   for(auto const &tpcTrack : tpcTrackVec)
     {
       const art::Ptr<recob::PFParticle> pfp = tracksToPFPs.at(tpcTrack.key());
 
-      if(pfp->PdgCode() != 13)
-        continue;
+      if(pfp->PdgCode() == 13)
+        muonTrackVec.push_back(tpcTrack);
+    }
+
+  // Each TPC track is matched independently into its own slot
+  std::vector<TrackMatchCandidate> bestMatches(muonTrackVec.size());
+
+  auto matchTrack = [&](const size_t i) {
+    const art::Ptr<recob::Track> &tpcTrack = muonTrackVec[i];
+    const TPCTrackSummary summary = fMatchingAlg.SummariseTPCTrack(tpcTrack, tracksToHits.at(tpcTrack.key()));
 
-      TrackMatchCandidate best = fMatchingAlg.GetBestMatchedCRTTrack(detProp, tpcTrack, crtTrackVec, e);
+    bestMatches[i] = fMatchingAlg.GetBestMatchedCRTTrack(summary, crtTrackIndex);
+  };
 
+  if(fUseTrackWorkers)
+    tbb::parallel_for(size_t(0), muonTrackVec.size(), matchTrack);
+  else
+    {
+      for(size_t i = 0; i < muonTrackVec.size(); ++i)
+        matchTrack(i);
+    }
+
+  std::vector<TrackMatchCandidate> candidates;
+
+  for(auto const &best : bestMatches)
+    {
       if(best.valid)
         candidates.push_back(best);
     }
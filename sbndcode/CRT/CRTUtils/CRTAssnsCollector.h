@@ -0,0 +1,66 @@
+#ifndef CRTASSNSCOLLECTOR_H_SEEN
+#define CRTASSNSCOLLECTOR_H_SEEN
+
+///////////////////////////////////////////////
+// CRTAssnsCollector.h
+//
+// Records which inputs each output object of a
+// CRT producer was made from, and fills the
+// art::Assns in one pass at the end of produce
+///////////////////////////////////////////////
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Persistency/Common/PtrMaker.h"
+#include "canvas/Persistency/Common/Assns.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sbnd::crt {
+
+  template <typename Output, typename Input>
+  class CRTAssnsCollector {
+  public:
+
+    void Reserve(const size_t n) { fPairs.reserve(n); }
+
+    // outputIndex is the position of the output object in the collection being produced
+    void Add(const size_t outputIndex, const art::Ptr<Input> &input)
+    {
+      fPairs.emplace_back(outputIndex, input);
+    }
+
+    void Add(const size_t outputIndex, const std::vector<art::Ptr<Input>> &inputs)
+    {
+      for(auto const& input : inputs)
+        fPairs.emplace_back(outputIndex, input);
+    }
+
+    // Works for either ordering of the association, art::Assns<Input, Output> or art::Assns<Output, Input>
+    template <typename Assns_t>
+    void Fill(const art::Event &e, Assns_t &assns, const std::string &instance = "") const
+    {
+      static_assert(std::is_same_v<Assns_t, art::Assns<Input, Output>> || std::is_same_v<Assns_t, art::Assns<Output, Input>>,
+                    "CRTAssnsCollector can only fill associations between its input and output types");
+
+      const art::PtrMaker<Output> makePtr(e, instance);
+
+      for(auto const& [outputIndex, input] : fPairs)
+        {
+          if constexpr(std::is_same_v<Assns_t, art::Assns<Input, Output>>)
+            assns.addSingle(input, makePtr(outputIndex));
+          else
+            assns.addSingle(makePtr(outputIndex), input);
+        }
+    }
+
+  private:
+
+    std::vector<std::pair<size_t, art::Ptr<Input>>> fPairs;
+  };
+}
+
+#endif
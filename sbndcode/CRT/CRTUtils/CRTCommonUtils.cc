@@ -1,6 +1,7 @@
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
 
 #include "messagefacility/MessageLogger/MessageLogger.h"
+#include <cmath>
 #include <iostream>
 
 namespace sbnd::crt {
@@ -155,13 +156,39 @@ namespace sbnd::crt {
 
   double CRTCommonUtils::SimpleDCA(const art::Ptr<CRTSpacePoint> &sp, const geo::Point_t &start, const geo::Vector_t &direction)
   {
-    const geo::Point_t pos = sp->Pos();
-    const geo::Point_t end = start + direction;
+    const double x = sp->X(), y = sp->Y(), z = sp->Z();
 
+    double dca;
+    SimpleDCA(start, direction, nullptr, &x, &y, &z, 1, &dca);
+
+    return dca;
+  }
+
+  void CRTCommonUtils::SimpleDCA(const geo::Point_t &start, const geo::Vector_t &direction, const double *xShift,
+                                 const double *x, const double *y, const double *z, const size_t n, double *dca)
+  {
+    // |(pos - start) x (pos - end)| / |direction|, written out over plain arrays
+    // so that the loop has no data dependent branches and the compiler can vectorise it
     const double denominator = direction.R();
-    const double numerator   = (pos - start).Cross(pos - end).R();
 
-    return numerator / denominator;
+    const double sy = start.Y(), sz = start.Z();
+    const double ey = sy + direction.Y(), ez = sz + direction.Z();
+    const double dx = direction.X();
+
+    for(size_t i = 0; i < n; ++i)
+      {
+        const double sx = xShift ? start.X() + xShift[i] : start.X();
+        const double ex = sx + dx;
+
+        const double ax = x[i] - sx, ay = y[i] - sy, az = z[i] - sz;
+        const double bx = x[i] - ex, by = y[i] - ey, bz = z[i] - ez;
+
+        const double cx = ay * bz - az * by;
+        const double cy = az * bx - ax * bz;
+        const double cz = ax * by - ay * bx;
+
+        dca[i] = std::sqrt(cx * cx + cy * cy + cz * cz) / denominator;
+      }
   }
 
   double CRTCommonUtils::DistToCRTSpacePoint(const art::Ptr<CRTSpacePoint> &sp, const geo::Point_t &start, const geo::Point_t &end, const CRTTagger tagger)
@@ -51,6 +51,11 @@ namespace sbnd::crt {
     // Returns a simple distance of closest approach between an infinite track and CRTSpacePoint
     double SimpleDCA(const art::Ptr<CRTSpacePoint> &sp, const geo::Point_t &start, const geo::Vector_t &direction);
 
+    // Fills dca[i] with the simple distance of closest approach between an infinite track and the point (x[i], y[i], z[i]),
+    // the track start being shifted in x by xShift[i] for point i (no shift if xShift is null)
+    void SimpleDCA(const geo::Point_t &start, const geo::Vector_t &direction, const double *xShift,
+                   const double *x, const double *y, const double *z, const size_t n, double *dca);
+
     // Returns the minimum distance from an infinite tracks to a CRTSpacePoint assuming its a 2D rectangle
     double DistToCRTSpacePoint(const art::Ptr<CRTSpacePoint> &sp, const geo::Point_t &start, const geo::Point_t &end, const CRTTagger tagger);
 
@@ -0,0 +1,129 @@
+#include "CRTModuleBoxes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace sbnd::crt {
+
+  // Padding added to every box so that rounding in the frame transformation
+  // can never discard a module the exact check would accept
+  constexpr double kBoxPadding = 0.01; // cm
+
+  void CRTModuleBoxes::AddAuxDet(const geo::AuxDetGeo &auxDet, const unsigned int auxDetID, const double scale)
+  {
+    // AuxDets give half widths and half heights but FULL lengths.
+    // The widest end of the (possibly trapezoidal) module is used.
+    const double hx = scale * std::max(auxDet.HalfWidth1(), auxDet.HalfWidth2());
+    const double hy = scale * auxDet.HalfHeight();
+    const double hz = scale * auxDet.Length() / 2.;
+
+    const geo::Point_t  center = auxDet.GetCenter();
+    const geo::Vector_t ex     = auxDet.toWorldCoords(geo::AuxDetGeo::LocalVector_t{1., 0., 0.});
+    const geo::Vector_t ey     = auxDet.toWorldCoords(geo::AuxDetGeo::LocalVector_t{0., 1., 0.});
+    const geo::Vector_t ez     = auxDet.toWorldCoords(geo::AuxDetGeo::LocalVector_t{0., 0., 1.});
+
+    const geo::Vector_t half(std::abs(ex.X()) * hx + std::abs(ey.X()) * hy + std::abs(ez.X()) * hz + kBoxPadding,
+                             std::abs(ex.Y()) * hx + std::abs(ey.Y()) * hy + std::abs(ez.Y()) * hz + kBoxPadding,
+                             std::abs(ex.Z()) * hx + std::abs(ey.Z()) * hy + std::abs(ez.Z()) * hz + kBoxPadding);
+
+    const Box box = { center - half, center + half, auxDetID };
+
+    if(fBoxes.empty())
+      {
+        fHullMin = box.min;
+        fHullMax = box.max;
+      }
+    else
+      {
+        fHullMin.SetXYZ(std::min(fHullMin.X(), box.min.X()), std::min(fHullMin.Y(), box.min.Y()), std::min(fHullMin.Z(), box.min.Z()));
+        fHullMax.SetXYZ(std::max(fHullMax.X(), box.max.X()), std::max(fHullMax.Y(), box.max.Y()), std::max(fHullMax.Z(), box.max.Z()));
+      }
+
+    fBoxes.push_back(box);
+    fSortedIDs.insert(std::upper_bound(fSortedIDs.begin(), fSortedIDs.end(), auxDetID), auxDetID);
+  }
+
+  std::vector<unsigned int> CRTModuleBoxes::RayCandidates(const geo::Point_t &origin, const geo::Vector_t &dir) const
+  {
+    std::vector<unsigned int> candidates;
+
+    if(!RayMayCross(origin, dir))
+      return candidates;
+
+    for(auto const& box : fBoxes)
+      {
+        if(RayIntersectsBox(origin, dir, box.min, box.max))
+          candidates.push_back(box.auxDetID);
+      }
+
+    return candidates;
+  }
+
+  bool CRTModuleBoxes::RayMayCross(const geo::Point_t &origin, const geo::Vector_t &dir) const
+  {
+    return !fBoxes.empty() && RayIntersectsBox(origin, dir, fHullMin, fHullMax);
+  }
+
+  bool CRTModuleBoxes::MayContain(const geo::Point_t &point) const
+  {
+    if(fBoxes.empty() || !IsInsideBox(point, fHullMin, fHullMax))
+      return false;
+
+    for(auto const& box : fBoxes)
+      {
+        if(IsInsideBox(point, box.min, box.max))
+          return true;
+      }
+
+    return false;
+  }
+
+  bool CRTModuleBoxes::HasAuxDet(const unsigned int auxDetID) const
+  {
+    return std::binary_search(fSortedIDs.begin(), fSortedIDs.end(), auxDetID);
+  }
+
+  bool CRTModuleBoxes::RayIntersectsBox(const geo::Point_t &origin, const geo::Vector_t &dir,
+                                        const geo::Point_t &min, const geo::Point_t &max)
+  {
+    const double o[3]    = { origin.X(), origin.Y(), origin.Z() };
+    const double d[3]    = { dir.X(), dir.Y(), dir.Z() };
+    const double bmin[3] = { min.X(), min.Y(), min.Z() };
+    const double bmax[3] = { max.X(), max.Y(), max.Z() };
+
+    double tmin = 0., tmax = std::numeric_limits<double>::max();
+
+    for(unsigned i = 0; i < 3; ++i)
+      {
+        // A ray parallel to a pair of faces only crosses the box if it starts between them
+        if(d[i] == 0.)
+          {
+            if(o[i] < bmin[i] || o[i] > bmax[i])
+              return false;
+            continue;
+          }
+
+        double t1 = (bmin[i] - o[i]) / d[i];
+        double t2 = (bmax[i] - o[i]) / d[i];
+
+        if(t1 > t2)
+          std::swap(t1, t2);
+
+        tmin = std::max(tmin, t1);
+        tmax = std::min(tmax, t2);
+
+        if(tmin > tmax)
+          return false;
+      }
+
+    return true;
+  }
+
+  bool CRTModuleBoxes::IsInsideBox(const geo::Point_t &point, const geo::Point_t &min, const geo::Point_t &max)
+  {
+    return point.X() >= min.X() && point.X() <= max.X()
+      && point.Y() >= min.Y() && point.Y() <= max.Y()
+      && point.Z() >= min.Z() && point.Z() <= max.Z();
+  }
+}
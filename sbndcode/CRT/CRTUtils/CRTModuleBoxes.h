@@ -0,0 +1,69 @@
+#ifndef CRTMODULEBOXES_H_SEEN
+#define CRTMODULEBOXES_H_SEEN
+
+///////////////////////////////////////////////
+// CRTModuleBoxes.h
+//
+// World frame bounding boxes of a group of CRT
+// modules (AuxDets), used to cheaply discard
+// the modules a point or ray cannot reach
+// before running the exact geometry checks.
+//
+// The structure is a two level hierarchy: one
+// box enclosing the whole group and one box
+// per module. The boxes are conservative, so
+// using them never changes the exact answer.
+///////////////////////////////////////////////
+
+#include "larcorealg/Geometry/AuxDetGeo.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+#include <vector>
+
+namespace sbnd::crt {
+
+  class CRTModuleBoxes {
+
+  public:
+
+    struct Box {
+      geo::Point_t min;
+      geo::Point_t max;
+      unsigned int auxDetID;
+    };
+
+    // Adds the world frame box enclosing the module, with its dimensions multiplied by scale
+    void AddAuxDet(const geo::AuxDetGeo &auxDet, const unsigned int auxDetID, const double scale = 1.);
+
+    // Returns the IDs of the modules whose boxes are crossed by the forward ray from origin along dir
+    std::vector<unsigned int> RayCandidates(const geo::Point_t &origin, const geo::Vector_t &dir) const;
+
+    // Returns whether the forward ray from origin along dir crosses the box enclosing the whole group;
+    // when it does not, RayCandidates() is empty
+    bool RayMayCross(const geo::Point_t &origin, const geo::Vector_t &dir) const;
+
+    // Returns whether the point lies inside the box of any of the modules
+    bool MayContain(const geo::Point_t &point) const;
+
+    // Returns whether the module has been added to this group
+    bool HasAuxDet(const unsigned int auxDetID) const;
+
+    // Returns whether the forward ray from origin along dir crosses the box
+    static bool RayIntersectsBox(const geo::Point_t &origin, const geo::Vector_t &dir,
+                                 const geo::Point_t &min, const geo::Point_t &max);
+
+    // Returns whether the point lies inside the box
+    static bool IsInsideBox(const geo::Point_t &point, const geo::Point_t &min, const geo::Point_t &max);
+
+    size_t NBoxes() const { return fBoxes.size(); }
+
+  private:
+
+    std::vector<Box>          fBoxes;
+    std::vector<unsigned int> fSortedIDs;
+    geo::Point_t              fHullMin;
+    geo::Point_t              fHullMax;
+  };
+}
+
+#endif
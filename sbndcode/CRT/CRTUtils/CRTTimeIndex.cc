@@ -0,0 +1,114 @@
+#include "sbndcode/CRT/CRTUtils/CRTTimeIndex.h"
+
+#include <algorithm>
+
+namespace sbnd::crt {
+
+  namespace {
+
+    // Input positions sorted by time, equal times in input order
+    void SortByTime(std::vector<std::pair<double, size_t>> &order)
+    {
+      std::stable_sort(order.begin(), order.end(),
+                       [](const std::pair<double, size_t> &a, const std::pair<double, size_t> &b)
+                       { return a.first < b.first; });
+    }
+  }
+
+  std::pair<size_t, size_t> CRTSpacePointTimeIndex::Window(const double tmin, const double tmax) const
+  {
+    auto const first = std::upper_bound(times.begin(), times.end(), tmin);
+    auto const last  = std::lower_bound(first, times.end(), tmax);
+
+    return {size_t(first - times.begin()), size_t(last - times.begin())};
+  }
+
+  std::pair<size_t, size_t> CRTTrackTimeIndex::Window(const double tmin, const double tmax) const
+  {
+    auto const first = std::lower_bound(times.begin(), times.end(), tmin);
+    auto const last  = std::upper_bound(first, times.end(), tmax);
+
+    return {size_t(first - times.begin()), size_t(last - times.begin())};
+  }
+
+  namespace CRTTimeIndex {
+
+    CRTSpacePointTimeIndex IndexSpacePoints(const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const double timeCorrection,
+                                            const double peCut, const double maxUncert,
+                                            const art::FindOneP<CRTCluster> *spacePointsToClusters)
+    {
+      std::vector<std::pair<double, size_t>> order;
+      order.reserve(crtSPs.size());
+
+      for(size_t i = 0; i < crtSPs.size(); ++i)
+        {
+          const art::Ptr<CRTSpacePoint> &crtSP = crtSPs[i];
+
+          if(crtSP->PE() < peCut || crtSP->XErr() > maxUncert || crtSP->YErr() > maxUncert || crtSP->ZErr() > maxUncert)
+            continue;
+
+          order.emplace_back(crtSP->Time() * 1e-3 + timeCorrection, i);
+        }
+
+      SortByTime(order);
+
+      CRTSpacePointTimeIndex spIndex;
+      spIndex.times.reserve(order.size());
+      spIndex.spacePoints.reserve(order.size());
+      spIndex.x.reserve(order.size());
+      spIndex.y.reserve(order.size());
+      spIndex.z.reserve(order.size());
+      if(spacePointsToClusters)
+        spIndex.taggers.reserve(order.size());
+
+      for(auto const& [time, i] : order)
+        {
+          const art::Ptr<CRTSpacePoint> &crtSP = crtSPs[i];
+
+          spIndex.times.push_back(time);
+          spIndex.spacePoints.push_back(crtSP);
+          spIndex.x.push_back(crtSP->X());
+          spIndex.y.push_back(crtSP->Y());
+          spIndex.z.push_back(crtSP->Z());
+          if(spacePointsToClusters)
+            spIndex.taggers.push_back(spacePointsToClusters->at(crtSP.key())->Tagger());
+        }
+
+      return spIndex;
+    }
+
+    CRTTrackTimeIndex IndexTracks(const std::vector<art::Ptr<CRTTrack>> &crtTracks, const double timeCorrection)
+    {
+      std::vector<std::pair<double, size_t>> order;
+      order.reserve(crtTracks.size());
+
+      for(size_t i = 0; i < crtTracks.size(); ++i)
+        order.emplace_back(crtTracks[i]->Time() * 1e-3 + timeCorrection, i);
+
+      SortByTime(order);
+
+      CRTTrackTimeIndex trackIndex;
+      trackIndex.times.reserve(order.size());
+      trackIndex.crtTracks.reserve(order.size());
+      trackIndex.order.reserve(order.size());
+      trackIndex.starts.reserve(order.size());
+      trackIndex.ends.reserve(order.size());
+
+      for(auto const& [time, i] : order)
+        {
+          geo::Point_t start = crtTracks[i]->Start();
+          geo::Point_t end   = crtTracks[i]->End();
+          if(start.Y() < end.Y())
+            std::swap(start, end);
+
+          trackIndex.times.push_back(time);
+          trackIndex.crtTracks.push_back(crtTracks[i]);
+          trackIndex.order.push_back(i);
+          trackIndex.starts.push_back(start);
+          trackIndex.ends.push_back(end);
+        }
+
+      return trackIndex;
+    }
+  }
+}
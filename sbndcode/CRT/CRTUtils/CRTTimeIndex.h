@@ -0,0 +1,78 @@
+#ifndef CRTTIMEINDEX_H_SEEN
+#define CRTTIMEINDEX_H_SEEN
+
+///////////////////////////////////////////////
+// CRTTimeIndex.h
+//
+// The CRT space points and tracks of an event
+// sorted once by their corrected time, with
+// what the matching to TPC objects needs kept
+// in parallel arrays. The matching algorithms
+// build them once per event and look up the
+// candidates of each TPC object in its time
+// window with a binary search, instead of
+// scanning the whole collection every time.
+///////////////////////////////////////////////
+
+#include "canvas/Persistency/Common/FindOneP.h"
+#include "canvas/Persistency/Common/Ptr.h"
+
+#include "larcoreobj/SimpleTypesAndConstants/geo_vectors.h"
+
+#include "sbnobj/SBND/CRT/CRTEnums.hh"
+#include "sbnobj/SBND/CRT/CRTSpacePoint.hh"
+#include "sbnobj/SBND/CRT/CRTCluster.hh"
+#include "sbnobj/SBND/CRT/CRTTrack.hh"
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace sbnd::crt {
+
+  // CRT space points ordered by time; equal times keep the input order
+  struct CRTSpacePointTimeIndex
+  {
+    std::vector<double>                  times;       // corrected time (us)
+    std::vector<art::Ptr<CRTSpacePoint>> spacePoints;
+    std::vector<CRTTagger>               taggers;     // only filled when the clusters are given
+    std::vector<double>                  x, y, z;     // positions, for the batch DCAs
+
+    size_t size() const { return times.size(); }
+    bool empty() const { return times.empty(); }
+
+    // Positions [first, last) of the space points with tmin < time < tmax
+    std::pair<size_t, size_t> Window(const double tmin, const double tmax) const;
+  };
+
+  // CRT tracks ordered by time; equal times keep the input order
+  struct CRTTrackTimeIndex
+  {
+    std::vector<double>             times;     // corrected time (us)
+    std::vector<art::Ptr<CRTTrack>> crtTracks;
+    std::vector<size_t>             order;     // position in the input, to resolve ties as a plain scan would
+    std::vector<geo::Point_t>       starts;    // endpoints ordered top to bottom
+    std::vector<geo::Point_t>       ends;
+
+    size_t size() const { return times.size(); }
+    bool empty() const { return times.empty(); }
+
+    // Positions [first, last) of the tracks with tmin <= time <= tmax
+    std::pair<size_t, size_t> Window(const double tmin, const double tmax) const;
+  };
+
+  namespace CRTTimeIndex {
+
+    // Indexes the space points with PE of at least peCut and position uncertainties up to maxUncert, at
+    // time * 1e-3 + timeCorrection (us); the taggers are filled from spacePointsToClusters if not null
+    CRTSpacePointTimeIndex IndexSpacePoints(const std::vector<art::Ptr<CRTSpacePoint>> &crtSPs, const double timeCorrection = 0.,
+                                            const double peCut = 0., const double maxUncert = std::numeric_limits<double>::max(),
+                                            const art::FindOneP<CRTCluster> *spacePointsToClusters = nullptr);
+
+    // Indexes the tracks at time * 1e-3 + timeCorrection (us)
+    CRTTrackTimeIndex IndexTracks(const std::vector<art::Ptr<CRTTrack>> &crtTracks, const double timeCorrection = 0.);
+  }
+}
+
+#endif
@@ -2,7 +2,7 @@
 
 namespace sbnd {
   namespace TPCGeoUtil {
-    int DetectedInTPC(std::vector<art::Ptr<recob::Hit>> hits){
+    int DetectedInTPC(const std::vector<art::Ptr<recob::Hit>>& hits){
       // Return tpc of hit collection or -1 if in multiple
       if(hits.size() == 0) return -1;
       int tpc = hits[0]->WireID().TPC;
@@ -12,7 +12,7 @@ namespace sbnd {
       return tpc;
     }
     // Work out the drift limits for a collection of hits
-    std::pair<double, double> XLimitsFromHits(const geo::GeometryCore *GeometryService, std::vector<art::Ptr<recob::Hit>> hits){
+    std::pair<double, double> XLimitsFromHits(const geo::GeometryCore *GeometryService, const std::vector<art::Ptr<recob::Hit>>& hits){
       // If there are no hits then return 0
       if(hits.size() == 0) return std::make_pair(0, 0);
   
@@ -25,7 +25,7 @@ namespace sbnd {
       return std::make_pair(tpcGeo.MinX(), tpcGeo.MaxX());
     }
 
-    int DriftDirectionFromHits(const geo::GeometryCore *GeometryService, std::vector<art::Ptr<recob::Hit>> hits){
+    int DriftDirectionFromHits(const geo::GeometryCore *GeometryService, const std::vector<art::Ptr<recob::Hit>>& hits){
       // If there are no hits then return 0
       if(hits.size() == 0) return 0;
   
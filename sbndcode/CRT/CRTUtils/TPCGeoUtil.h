@@ -15,15 +15,15 @@
 namespace sbnd {
   namespace TPCGeoUtil {
 
-    int DetectedInTPC(std::vector<art::Ptr<recob::Hit>> hits);
+    int DetectedInTPC(const std::vector<art::Ptr<recob::Hit>>& hits);
 
     // Work out the drift limits for a collection of hits
-    std::pair<double, double> XLimitsFromHits(const geo::GeometryCore *GeometryService, std::vector<art::Ptr<recob::Hit>> hits);
+    std::pair<double, double> XLimitsFromHits(const geo::GeometryCore *GeometryService, const std::vector<art::Ptr<recob::Hit>>& hits);
 
     // Is point inside given TPC
     bool InsideTPC(geo::Point_t point, const geo::TPCGeo& tpc, double buffer);
 
-    int DriftDirectionFromHits(const geo::GeometryCore *GeometryService, std::vector<art::Ptr<recob::Hit>> hits);
+    int DriftDirectionFromHits(const geo::GeometryCore *GeometryService, const std::vector<art::Ptr<recob::Hit>>& hits);
   }
 }
 #endif
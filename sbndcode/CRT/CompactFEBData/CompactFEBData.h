@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   CompactFEBData.h
+///
+/// \brief  All the CRT FEB readouts of an event in one product, with
+///         only the ADC values that differ from the baseline of their
+///         readout.
+///
+/// A sbnd::crt::FEBData keeps the 32 ADC values of its FEB, although in a
+/// readout only the few SiPMs of the strips that were hit are above their
+/// pedestal. This product keeps the same readouts in flat arrays: the
+/// mac5, flags, time stamps and coincidence of each readout, its baseline
+/// (its most frequent ADC value), a mask of the channels whose ADC value
+/// differs from the baseline, and those values only, readout after
+/// readout in a single pool. The readouts come back exact, whatever their
+/// ADC values.
+///
+/// The readouts are written one after the other and read by index:
+///
+///   sbnd::crt::CompactFEBData compact;
+///   compact.Add(feb);
+///
+///   for (std::size_t i = 0; i < compact.size(); ++i) {
+///     sbnd::crt::FEBData const feb = compact.MakeFEBData(i);
+///     ...
+///   }
+///
+/// DecodeADC() expands the ADC values of a readout alone.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_CRT_COMPACTFEBDATA_COMPACTFEBDATA_H
+#define SBNDCODE_CRT_COMPACTFEBDATA_COMPACTFEBDATA_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sbnobj/SBND/CRT/FEBData.hh"
+
+namespace sbnd::crt {
+
+  class CompactFEBData {
+  public:
+
+    static constexpr std::size_t kNChannels = 32;
+
+    using ADCArray_t = std::array<std::uint16_t, kNChannels>;
+
+    /// Number of readouts.
+    std::size_t size() const { return fMac5.size(); }
+    bool empty() const { return fMac5.empty(); }
+
+    /// Number of ADC values stored, for all the readouts.
+    std::size_t NADCs() const { return fADCs.size(); }
+
+    std::uint16_t Mac5(std::size_t i) const { return fMac5[i]; }
+    std::uint16_t Flags(std::size_t i) const { return fFlags[i]; }
+    std::uint32_t Ts0(std::size_t i) const { return fTs0[i]; }
+    std::uint32_t Ts1(std::size_t i) const { return fTs1[i]; }
+    std::uint32_t UnixS(std::size_t i) const { return fUnixS[i]; }
+    std::uint32_t Coinc(std::size_t i) const { return fCoinc[i]; }
+
+    /// ADC value of the channels of readout i not in its mask.
+    std::uint16_t Baseline(std::size_t i) const { return fBaseline[i]; }
+
+    /// Bit c is set if the ADC value of channel c of readout i is stored.
+    std::uint32_t ChannelMask(std::size_t i) const { return fChannelMask[i]; }
+
+    /// Makes room for nReadouts readouts with nADCs stored ADC values in all.
+    void reserve(std::size_t nReadouts, std::size_t nADCs)
+    {
+      fMac5.reserve(nReadouts);
+      fFlags.reserve(nReadouts);
+      fTs0.reserve(nReadouts);
+      fTs1.reserve(nReadouts);
+      fUnixS.reserve(nReadouts);
+      fCoinc.reserve(nReadouts);
+      fBaseline.reserve(nReadouts);
+      fChannelMask.reserve(nReadouts);
+      fOffsets.reserve(nReadouts);
+      fADCs.reserve(nADCs);
+    }
+
+    /// Appends a readout.
+    void Add(std::uint16_t mac5, std::uint16_t flags, std::uint32_t ts0, std::uint32_t ts1,
+             std::uint32_t unixs, ADCArray_t const& adcs, std::uint32_t coinc)
+    {
+      fMac5.push_back(mac5);
+      fFlags.push_back(flags);
+      fTs0.push_back(ts0);
+      fTs1.push_back(ts1);
+      fUnixS.push_back(unixs);
+      fCoinc.push_back(coinc);
+      fOffsets.push_back(fADCs.size());
+
+      std::uint16_t const baseline = MostFrequent(adcs);
+      std::uint32_t mask = 0;
+      for (std::size_t c = 0; c < kNChannels; ++c) {
+        if (adcs[c] == baseline) continue;
+        mask |= std::uint32_t(1) << c;
+        fADCs.push_back(adcs[c]);
+      }
+      fBaseline.push_back(baseline);
+      fChannelMask.push_back(mask);
+    }
+
+    void Add(FEBData const& feb)
+    {
+      ADCArray_t adcs;
+      for (std::size_t c = 0; c < kNChannels; ++c) adcs[c] = feb.ADC(c);
+      Add(feb.Mac5(), feb.Flags(), feb.Ts0(), feb.Ts1(), feb.UnixS(), adcs, feb.Coinc());
+    }
+
+    /// Writes the 32 ADC values of readout i into adcs.
+    void DecodeADC(std::size_t i, ADCArray_t& adcs) const
+    {
+      std::uint32_t const mask = fChannelMask[i];
+      std::uint16_t const* stored = fADCs.data() + fOffsets[i];
+      for (std::size_t c = 0; c < kNChannels; ++c)
+        adcs[c] = (mask >> c) & 1 ? *stored++ : fBaseline[i];
+    }
+
+    /// Readout i as a FEBData.
+    FEBData MakeFEBData(std::size_t i) const
+    {
+      ADCArray_t adcs;
+      DecodeADC(i, adcs);
+      return FEBData(fMac5[i], fFlags[i], fTs0[i], fTs1[i], fUnixS[i], adcs, fCoinc[i]);
+    }
+
+    void clear()
+    {
+      fMac5.clear();
+      fFlags.clear();
+      fTs0.clear();
+      fTs1.clear();
+      fUnixS.clear();
+      fCoinc.clear();
+      fBaseline.clear();
+      fChannelMask.clear();
+      fOffsets.clear();
+      fADCs.clear();
+    }
+
+  private:
+
+    /// Most frequent of the values, the lowest one on a tie.
+    static std::uint16_t MostFrequent(ADCArray_t adcs)
+    {
+      std::sort(adcs.begin(), adcs.end());
+      std::uint16_t best = adcs[0];
+      std::size_t bestCount = 0;
+      for (std::size_t c = 0; c < kNChannels; ) {
+        std::size_t run = c + 1;
+        while (run < kNChannels && adcs[run] == adcs[c]) ++run;
+        if (run - c > bestCount) {
+          best = adcs[c];
+          bestCount = run - c;
+        }
+        c = run;
+      }
+      return best;
+    }
+
+    std::vector<std::uint16_t> fMac5;        ///< FEB of each readout
+    std::vector<std::uint16_t> fFlags;
+    std::vector<std::uint32_t> fTs0;
+    std::vector<std::uint32_t> fTs1;
+    std::vector<std::uint32_t> fUnixS;
+    std::vector<std::uint32_t> fCoinc;
+    std::vector<std::uint16_t> fBaseline;    ///< ADC value of the channels not stored
+    std::vector<std::uint32_t> fChannelMask; ///< channels stored, bit c for channel c
+    std::vector<std::uint32_t> fOffsets;     ///< first stored ADC value of each readout
+    std::vector<std::uint16_t> fADCs;        ///< stored ADC values, readout after readout
+  };
+
+} // namespace sbnd::crt
+
+#endif // SBNDCODE_CRT_COMPACTFEBDATA_COMPACTFEBDATA_H
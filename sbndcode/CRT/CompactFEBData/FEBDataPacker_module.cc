@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       FEBDataPacker
+// Plugin Type: producer
+// File:        FEBDataPacker_module.cc
+//
+// Packs collections of sbnd::crt::FEBData into one
+// sbnd::crt::CompactFEBData, to be stored in place of them.
+// FEBDataUnpacker turns it back into the original collection; the
+// associations to the FEBData (e.g. the truth of CRTDetSim) are not
+// carried over.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <memory>
+#include <vector>
+
+#include "sbnobj/SBND/CRT/FEBData.hh"
+
+#include "sbndcode/CRT/CompactFEBData/CompactFEBData.h"
+
+namespace sbnd::crt {
+  class FEBDataPacker;
+}
+
+
+class sbnd::crt::FEBDataPacker : public art::EDProducer {
+public:
+  explicit FEBDataPacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  FEBDataPacker(FEBDataPacker const&) = delete;
+  FEBDataPacker(FEBDataPacker&&) = delete;
+  FEBDataPacker& operator=(FEBDataPacker const&) = delete;
+  FEBDataPacker& operator=(FEBDataPacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  std::vector<art::InputTag> fInputTags; ///< readouts to pack, in this order
+};
+
+
+sbnd::crt::FEBDataPacker::FEBDataPacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTags = p.get< std::vector<art::InputTag> >("InputTags");
+  for (art::InputTag const& tag : fInputTags)
+    consumes< std::vector< FEBData > >(tag);
+
+  produces< CompactFEBData >();
+}
+
+void sbnd::crt::FEBDataPacker::produce(art::Event& e)
+{
+  std::vector< std::vector< FEBData > const* > inputs;
+  std::size_t nReadouts = 0;
+  for (art::InputTag const& tag : fInputTags) {
+    auto const& febs = e.getProduct< std::vector< FEBData > >(tag);
+    inputs.push_back(&febs);
+    nReadouts += febs.size();
+  }
+
+  // a few SiPMs per readout differ from the baseline
+  auto compact = std::make_unique< CompactFEBData >();
+  compact->reserve(nReadouts, 4 * nReadouts);
+  for (auto const* febs : inputs)
+    for (FEBData const& feb : *febs) compact->Add(feb);
+
+  e.put(std::move(compact));
+}
+
+DEFINE_ART_MODULE(sbnd::crt::FEBDataPacker)
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       FEBDataUnpacker
+// Plugin Type: producer
+// File:        FEBDataUnpacker_module.cc
+//
+// Turns a sbnd::crt::CompactFEBData back into a collection of
+// sbnd::crt::FEBData, for the modules that only read the latter.
+// The readouts are the same, and in the same order, as those packed.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <memory>
+#include <vector>
+
+#include "sbnobj/SBND/CRT/FEBData.hh"
+
+#include "sbndcode/CRT/CompactFEBData/CompactFEBData.h"
+
+namespace sbnd::crt {
+  class FEBDataUnpacker;
+}
+
+
+class sbnd::crt::FEBDataUnpacker : public art::EDProducer {
+public:
+  explicit FEBDataUnpacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  FEBDataUnpacker(FEBDataUnpacker const&) = delete;
+  FEBDataUnpacker(FEBDataUnpacker&&) = delete;
+  FEBDataUnpacker& operator=(FEBDataUnpacker const&) = delete;
+  FEBDataUnpacker& operator=(FEBDataUnpacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  art::InputTag fInputTag; ///< packed readouts
+};
+
+
+sbnd::crt::FEBDataUnpacker::FEBDataUnpacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTag = p.get< art::InputTag >("InputTag");
+  consumes< CompactFEBData >(fInputTag);
+
+  produces< std::vector< FEBData > >();
+}
+
+void sbnd::crt::FEBDataUnpacker::produce(art::Event& e)
+{
+  auto const& compact = e.getProduct< CompactFEBData >(fInputTag);
+
+  auto febs = std::make_unique< std::vector< FEBData > >();
+  febs->reserve(compact.size());
+  for (std::size_t i = 0; i < compact.size(); ++i)
+    febs->push_back(compact.MakeFEBData(i));
+
+  e.put(std::move(febs));
+}
+
+DEFINE_ART_MODULE(sbnd::crt::FEBDataUnpacker)
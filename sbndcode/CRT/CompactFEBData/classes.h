@@ -0,0 +1,8 @@
+//File: classes.h
+//Brief: Include directives needed to generate the dictionary of sbnd::crt::CompactFEBData.
+
+//ART includes
+#include "canvas/Persistency/Common/Wrapper.h"
+
+//local includes
+#include "sbndcode/CRT/CompactFEBData/CompactFEBData.h"
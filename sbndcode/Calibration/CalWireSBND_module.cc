@@ -11,14 +11,23 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include <stdint.h>
+#include <cmath>
+
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
 
 #include "art/Framework/Core/ModuleMacros.h" 
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Principal/Event.h" 
 #include "art/Framework/Principal/Handle.h" 
+#include "art/Framework/Principal/Run.h"
 #include "canvas/Persistency/Common/Ptr.h" 
 #include "canvas/Persistency/Common/PtrVector.h" 
+#include "art/Persistency/Common/PtrMaker.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h" 
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
@@ -30,9 +39,16 @@
 #include "lardata/ArtDataHelper/WireCreator.h"
 
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+#include "sbndcode/Utilities/SBNDBatchFFT.h"
+#include "sbndcode/Utilities/BlockBaseline.h"
+#include "sbndcode/Utilities/Instrumentation.h"
+#include "sbndcode/Utilities/ChannelDescriptorTable.h"
+#include "sbndcode/Utilities/ThreadPool.h"
 #include "sbndcode/Calibration/IROIFinder.h"
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
 #include "larcore/Geometry/Geometry.h"
-//#include "Filters/ChannelFilter.h"
+#include "larevt/CalibrationDBI/Interface/ChannelStatusService.h"
 
 #include "lardataobj/RawData/RawDigit.h"
 #include "lardataobj/RawData/raw.h"
@@ -44,7 +60,6 @@
 
 #include "TComplex.h"
 #include "TFile.h"
-#include "TH1F.h"
 
 ///creation of calibrated signals on wires
 namespace caldata {
@@ -62,6 +77,7 @@ namespace caldata {
     
     void produce(art::Event& evt); 
     void beginJob(); 
+    void beginRun(art::Run& run);
     void endJob();                 
     void reconfigure(fhicl::ParameterSet const& p);
 
@@ -91,8 +107,66 @@ namespace caldata {
                               ///< it is set by the DigitModuleLabel
                               ///< ex.:  "daq:preSpill" for prespill data
     
-    void          SubtractBaseline(std::vector<float>& holder);
-    void          SubtractBaselineAdv(std::vector<float>& holder);
+    bool          fDigitBlock;        ///< the digits are a sbnd::RawDigitBlock
+    bool          fSkipBadChannels;   ///< make no wire for the digits of bad channels
+    sbnd::ChannelDescriptorTable fChannelTable; ///< channel status, for the current run
+
+    bool          fUseChannelWorkers; ///< deconvolve the channels in parallel
+    unsigned int  fNThreads;          ///< threads of the channel workers (0: all available to the job)
+    bool          fBatchDeconvolution; ///< channel workers deconvolve their channels by view in batches
+    bool          fFusedPostDeconvolution; ///< DeconNorm in the kernel, baseline range taken with the copy out
+
+    /// Per-thread FFT plans and waveform buffers of the channel workers.
+    struct ChannelBuffers {
+      ChannelBuffers(int transformSize, std::string const& option)
+        : fft(transformSize, option), holder(transformSize), rawadc(transformSize) {}
+      util::SBNDFFTWorker fft;
+      std::vector<float>  holder;
+      std::vector<short>  rawadc;
+      std::unique_ptr<util::SBNDBatchFFT> batch; ///< made on the first batch
+    };
+    tbb::enumerable_thread_specific<std::unique_ptr<ChannelBuffers>> fChannelBuffers;
+
+    /// The digits of one channel: a raw::RawDigit, or a row of a
+    /// sbnd::RawDigitBlock (no digit, and the uncompressed samples).
+    struct DigitRef {
+      raw::RawDigit const* digit = nullptr;
+      raw::ChannelID_t     channel = raw::InvalidChannelID;
+      float                pedestal = 0.;
+      short const*         adcs = nullptr;
+    };
+
+    /// Uncompressed, pedestal subtracted waveform of digit, zero padded
+    /// to the size of holder (at least dataSize).
+    void          FillHolder(DigitRef const& digit, unsigned int dataSize,
+                             std::vector<short>& rawadc, std::vector<float>& holder) const;
+    /// Baseline subtraction and ROI finding on the deconvolved waveform;
+    /// holder is truncated to dataSize.
+    recob::Wire   MakeWire(DigitRef const& digit, unsigned int dataSize,
+                           std::vector<float>& holder) const;
+    /// Same, from the first dataSize samples of a waveform deconvolved with
+    /// DeconNorm in the kernel (deconvolved may be holder.data()): they are
+    /// copied to holder in the same pass that finds their range for the
+    /// baseline subtraction.
+    recob::Wire   MakeWireNormalized(DigitRef const& digit, float const* deconvolved,
+                                     unsigned int dataSize, std::vector<float>& holder) const;
+    /// Baseline subtraction and ROI finding shared by the two above.
+    recob::Wire   FinishWire(DigitRef const& digit, std::vector<float>& holder,
+                             float min, float max) const;
+
+    /// Deconvolution of the wires [firstWire, lastWire) in one single
+    /// precision batch per view, then as MakeWire.
+    void          DeconvoluteBatch(detinfo::DetectorClocksData const& clockData,
+                                   util::SignalShapingServiceSBND const& sss,
+                                   std::vector<DigitRef> const& digits,
+                                   size_t firstWire, size_t lastWire,
+                                   unsigned int dataSize, double deconNorm,
+                                   ChannelBuffers& buffers,
+                                   std::vector<recob::Wire>& wirecol) const;
+
+    /// min and max: range of the samples of holder, widened to include 0
+    void          SubtractBaseline(std::vector<float>& holder, float min, float max) const;
+    void          SubtractBaselineAdv(std::vector<float>& holder) const;
     
 
   protected: 
@@ -132,6 +206,12 @@ namespace caldata {
     fFFTSize          = p.get< int >        ("FFTSize");
     fFFTOption        = p.get< std::string >("FFTOption");
     fFFTFitBins       = p.get< int >        ("FFTFitBins");
+    fDigitBlock       = p.get< bool >       ("DigitBlock", false);
+    fSkipBadChannels  = p.get< bool >       ("SkipBadChannels", true);
+    fUseChannelWorkers = p.get< bool >      ("UseChannelWorkers", false);
+    fNThreads         = p.get< unsigned int >("NThreads", 0);
+    fBatchDeconvolution = p.get< bool >     ("BatchDeconvolution", false);
+    fFusedPostDeconvolution = p.get< bool > ("FusedPostDeconvolution", false);
     
     fSpillName="";
     
@@ -148,6 +228,15 @@ namespace caldata {
   {  
   }
 
+  //-------------------------------------------------
+  void CalWireSBND::beginRun(art::Run&)
+  {
+    // channel status may change from run to run
+    art::ServiceHandle<geo::Geometry> geom;
+    lariov::ChannelStatusProvider const& channelStatus(art::ServiceHandle<lariov::ChannelStatusService const>()->GetProvider());
+    fChannelTable.Build(*geom, channelStatus);
+  }
+
   //////////////////////////////////////////////////////
   void CalWireSBND::endJob()
   {  
@@ -156,8 +245,7 @@ namespace caldata {
   //////////////////////////////////////////////////////
   void CalWireSBND::produce(art::Event& evt)
   {      
-    // get the geometry
-    art::ServiceHandle<geo::Geometry> geom;
+    SBND_INSTR_SCOPE("CalWireSBND::produce");
 
     // get the FFT service to have access to the FFT size
     art::ServiceHandle<util::LArFFT> fFFT;
@@ -178,18 +266,46 @@ namespace caldata {
     std::unique_ptr<art::Assns<raw::RawDigit,recob::Wire> > WireDigitAssn
       (new art::Assns<raw::RawDigit,recob::Wire>);
     
-    // Read in the digit List object(s). 
+    // Read in the digit List object(s), or the digit block;
+    // one wire per digit of a good channel, in the digit order
     art::Handle< std::vector<raw::RawDigit> > digitVecHandle;
-    if(fSpillName.size()>0) evt.getByLabel(fDigitModuleLabel, fSpillName, digitVecHandle);
-    else evt.getByLabel(fDigitModuleLabel, digitVecHandle);
-
-    if (!digitVecHandle->size())  return;
-    mf::LogInfo("CalWireSBND") << "CalWireSBND:: digitVecHandle size is " << digitVecHandle->size();
-
-    // Use the handle to get a particular (0th) element of collection.
-    art::Ptr<raw::RawDigit> digitVec0(digitVecHandle, 0);
-        
-    unsigned int dataSize = digitVec0->Samples(); //size of raw data vectors
+    art::Handle< sbnd::RawDigitBlock > digitBlockHandle;
+    std::vector<DigitRef> digits;
+    std::vector<size_t> digitIndices;
+    unsigned int dataSize = 0; //size of raw data vectors
+
+    if ( fDigitBlock ) {
+      if(fSpillName.size()>0) evt.getByLabel(fDigitModuleLabel, fSpillName, digitBlockHandle);
+      else evt.getByLabel(fDigitModuleLabel, digitBlockHandle);
+
+      sbnd::RawDigitBlock const& block = *digitBlockHandle;
+      if (block.empty())  return;
+      mf::LogInfo("CalWireSBND") << "CalWireSBND:: digit block has " << block.NChannels() << " channels";
+
+      dataSize = block.NTicks();
+      digits.reserve(block.NChannels());
+      for(size_t row = 0; row < block.NChannels(); ++row){
+        if( fSkipBadChannels && !fChannelTable.IsGood(block.Channel(row)) ) continue;
+        digits.push_back({ nullptr, block.Channel(row), block.Pedestal(row), block.ADCs(row).data() });
+      }
+    }
+    else {
+      if(fSpillName.size()>0) evt.getByLabel(fDigitModuleLabel, fSpillName, digitVecHandle);
+      else evt.getByLabel(fDigitModuleLabel, digitVecHandle);
+
+      if (!digitVecHandle->size())  return;
+      mf::LogInfo("CalWireSBND") << "CalWireSBND:: digitVecHandle size is " << digitVecHandle->size();
+
+      dataSize = digitVecHandle->front().Samples();
+      digits.reserve(digitVecHandle->size());
+      digitIndices.reserve(digitVecHandle->size());
+      for(size_t rdIter = 0; rdIter < digitVecHandle->size(); ++rdIter){
+        raw::RawDigit const& digit = (*digitVecHandle)[rdIter];
+        if( fSkipBadChannels && !fChannelTable.IsGood(digit.Channel()) ) continue;
+        digits.push_back({ &digit, digit.Channel(), digit.GetPedestal(), nullptr });
+        digitIndices.push_back(rdIter);
+      }
+    }
 
 
     if( (unsigned int)transformSize < dataSize){
@@ -208,93 +324,111 @@ namespace caldata {
       mf::LogError("CalWireSBND")<<"Set BaseSampleBins modulo dataSize= "<<dataSize;
     }
 
-    uint32_t     channel(0); // channel number
-    unsigned int bin(0);     // time bin loop variable
-    
-///    filter::ChannelFilter *chanFilt = new filter::ChannelFilter();  
-
-    std::vector<float> holder;                // holds signal data
-    std::vector<short> rawadc(transformSize);  // vector holding uncompressed adc values
-    std::vector<TComplex> freqHolder(transformSize+1); // temporary frequency data
-    
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
 
-    // loop over all wires    
-    wirecol->reserve(digitVecHandle->size());
-    for(size_t rdIter = 0; rdIter < digitVecHandle->size(); ++rdIter){ // ++ move
-      holder.clear();
-      
-      // get the reference to the current raw::RawDigit
-      art::Ptr<raw::RawDigit> digitVec(digitVecHandle, rdIter);
-      channel = digitVec->Channel();
+    size_t const nWires = digits.size();
+    wirecol->resize(nWires);
+
+    if ( fUseChannelWorkers ) {
+
+      // kernels and channel tables are made before the worker threads use them
+      sss->InitKernels();
+
+      std::string const fftOption = fFFT->FFTOptions();
+
+      sbnd::ThreadPool pool(fNThreads);
+      pool.Execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nWires), [&](tbb::blocked_range<size_t> const& range) {
+          auto& buffers = fChannelBuffers.local();
+          if ( !buffers || buffers->fft.FFTSize() != transformSize )
+            buffers = std::make_unique<ChannelBuffers>(transformSize, fftOption);
+
+          if ( fBatchDeconvolution ) {
+            DeconvoluteBatch(clockData, *sss, digits, range.begin(), range.end(),
+                             dataSize, DeconNorm, *buffers, *wirecol);
+            return;
+          }
+
+          for (size_t iWire = range.begin(); iWire != range.end(); ++iWire) {
+            DigitRef const& digit = digits[iWire];
+            std::vector<float>& holder = buffers->holder;
 
-      // skip bad channels
-      //  if(!chanFilt->BadChannel(channel)) {
-      if(true) {
+            holder.resize(transformSize);
+            FillHolder(digit, dataSize, buffers->rawadc, holder);
+            if ( fFusedPostDeconvolution ) {
+              {
+                SBND_INSTR_SCOPE("CalWireSBND::Deconvolute");
+                sss->DeconvoluteNormalized(clockData, digit.channel, holder, buffers->fft);
+              }
+              (*wirecol)[iWire] = MakeWireNormalized(digit, holder.data(), dataSize, holder);
+              continue;
+            }
+            {
+              SBND_INSTR_SCOPE("CalWireSBND::Deconvolute");
+              sss->Deconvolute(clockData, digit.channel, holder, buffers->fft);
+            }
+            for (float& value : holder) value /= DeconNorm;
+
+            (*wirecol)[iWire] = MakeWire(digit, dataSize, holder);
+          }
+        });
+      });
+
+    }
+    else if ( fFusedPostDeconvolution ) {
+
+      // the normalized kernels are applied with the FFT plans of this thread
+      sss->InitKernels();
+      auto& buffers = fChannelBuffers.local();
+      if ( !buffers || buffers->fft.FFTSize() != transformSize )
+        buffers = std::make_unique<ChannelBuffers>(transformSize, fFFT->FFTOptions());
+      std::vector<float>& holder = buffers->holder;
+
+      for(size_t iWire = 0; iWire < nWires; ++iWire){
+        DigitRef const& digit = digits[iWire];
+        holder.resize(transformSize);
+        FillHolder(digit, dataSize, buffers->rawadc, holder);
+        {
+          SBND_INSTR_SCOPE("CalWireSBND::Deconvolute");
+          sss->DeconvoluteNormalized(clockData, digit.channel, holder, buffers->fft);
+        }
+        (*wirecol)[iWire] = MakeWireNormalized(digit, holder.data(), dataSize, holder);
+      }
+
+    }
+    else {
+
+      std::vector<float> holder;                // holds signal data
+      std::vector<short> rawadc(transformSize);  // vector holding uncompressed adc values
+
+      // loop over all wires; the bad channels are already out of digits
+      for(size_t iWire = 0; iWire < nWires; ++iWire){
+
+        // get the reference to the current digit
+        DigitRef const& digit = digits[iWire];
 
         // resize and pad with zeros
-        holder.resize(transformSize, 0.);
-        
-        // uncompress the data
-        raw::Uncompress(digitVec->ADCs(), rawadc, digitVec->Compression());
-        
-        // loop over all adc values and subtract the pedestal
-        float pdstl = digitVec->GetPedestal();
-        
-        for(bin = 0; bin < dataSize; ++bin) 
-          holder[bin]=(rawadc[bin]-pdstl);
-
-	//fill the remaining bin with data
-	for(bin = dataSize; bin < holder.size(); bin++){
-	  //  philosophy change - don't repeat data but instead fill extra space with zeros.
-          //    not sure that one is better than the other.
-	  //	  holder[bin] = (rawadc[bin-dataSize]-pdstl);
-	  holder[bin] = 0.0;
-	}
+        holder.resize(transformSize);
+        FillHolder(digit, dataSize, rawadc, holder);
 
         // Do deconvolution.
-        sss->Deconvolute(clockData, channel, holder);
-	  for(bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
-      } // end if not a bad channel 
-      
-      holder.resize(dataSize,1e-5);
-
-      // restore DC component through baseline subtraction
-      if( fDoBaselineSub ) SubtractBaseline(holder);
-      // more advanced, interpolation-based subtraction alg 
-      // that uses the BaseSampleBins and BaseVarCut params
-      if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
-
-      // Make a single ROI that spans the entire data size
-      //RegionsOfInterest_t sparse_holder;
-      //sparse_holder.add_range(0,holder.begin(),holder.end());
-      CandidateROIVec candROIVec;
-      fROITool->FindROIs( holder, channel, candROIVec);//calculates ROI and returns it to roiVec.
-      //auto view = geom->View(channel);
-      recob::Wire::RegionsOfInterest_t roiVec;
-
-      //looping over roiVec to make a RegionOfInterest_t object.
-      for(auto const& CandidateROI: candROIVec){
-	size_t roiStart = CandidateROI.first;
-	size_t roiStop = CandidateROI.second;
-	std::vector<float> roiHolder;
-	for(size_t i_holder=roiStart; i_holder<=roiStop; i_holder++){
-	  roiHolder.push_back(holder[i_holder]);
-	}
-	roiVec.add_range(roiStart, std::move(roiHolder));
-      }
-      wirecol->push_back(recob::WireCreator(std::move(roiVec),*digitVec).move());
+        {
+          SBND_INSTR_SCOPE("CalWireSBND::Deconvolute");
+          sss->Deconvolute(clockData, digit.channel, holder);
+        }
+        for(unsigned int bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
 
+        (*wirecol)[iWire] = MakeWire(digit, dataSize, holder);
+      }
 
-      // add an association between the last object in wirecol--Hec
-      // (that we just inserted) and digitVec
-      if (!util::CreateAssn(*this, evt, *wirecol, digitVec, *WireDigitAssn, fSpillName)) {
-        throw cet::exception("CalWireSBND")
-          << "Can't associate wire #" << (wirecol->size() - 1)
-          << " with raw digit #" << digitVec.key() << "\n";
-      } // if failed to add association
     }
 
+    // associate each wire with the digit it was made from--Hec
+    // (a digit block has no raw::RawDigit to point to: the association is empty)
+    art::PtrMaker<recob::Wire> makeWirePtr(evt, fSpillName);
+    for(size_t iWire = 0; iWire < digitIndices.size(); ++iWire)
+      WireDigitAssn->addSingle(art::Ptr<raw::RawDigit>(digitVecHandle, digitIndices[iWire]), makeWirePtr(iWire));
+
 
     if(wirecol->size() == 0)
       mf::LogWarning("CalWireSBND") << "No wires made for this event.";
@@ -306,12 +440,148 @@ namespace caldata {
     evt.put(std::move(wirecol), fSpillName);        //--Hec
     evt.put(std::move(WireDigitAssn), fSpillName);  //--Hec
     
-   // delete chanFilt;
     return;
   }
  
   
-  void CalWireSBND::SubtractBaseline(std::vector<float>& holder)
+  //////////////////////////////////////////////////////
+  void CalWireSBND::FillHolder(DigitRef const& digit, unsigned int dataSize,
+                               std::vector<short>& rawadc, std::vector<float>& holder) const
+  {
+    SBND_INSTR_SCOPE("CalWireSBND::FillHolder");
+
+    // loop over all adc values and subtract the pedestal
+    float pdstl = digit.pedestal;
+
+    // the samples of a block row are read in place
+    short const* adcs = digit.adcs;
+    if ( digit.digit ) {
+      SBND_INSTR_COUNT("CalWireSBND::DigitBytes", digit.digit->ADCs().size() * sizeof(short));
+      // uncompress the data; zero-suppressed samples are set to the pedestal
+      raw::Uncompress(digit.digit->ADCs(), rawadc, std::lround(pdstl), digit.digit->Compression());
+      adcs = rawadc.data();
+    }
+    else SBND_INSTR_COUNT("CalWireSBND::DigitBytes", dataSize * sizeof(short));
+
+    for(unsigned int bin = 0; bin < dataSize; ++bin)
+      holder[bin]=(adcs[bin]-pdstl);
+
+    //fill the remaining bin with data
+    //  philosophy change - don't repeat data but instead fill extra space with zeros.
+    //    not sure that one is better than the other.
+    std::fill(holder.begin() + dataSize, holder.end(), 0.);
+  }
+
+  //////////////////////////////////////////////////////
+  recob::Wire CalWireSBND::MakeWire(DigitRef const& digit, unsigned int dataSize,
+                                    std::vector<float>& holder) const
+  {
+    SBND_INSTR_SCOPE("CalWireSBND::MakeWire");
+
+    holder.resize(dataSize,1e-5);
+
+    float min = 0, max = 0;
+    if( fDoBaselineSub ) {
+      for(float value : holder) {
+        if (value > max) max = value;
+        if (value < min) min = value;
+      }
+    }
+    return FinishWire(digit, holder, min, max);
+  }
+
+  //////////////////////////////////////////////////////
+  recob::Wire CalWireSBND::MakeWireNormalized(DigitRef const& digit, float const* deconvolved,
+                                              unsigned int dataSize, std::vector<float>& holder) const
+  {
+    SBND_INSTR_SCOPE("CalWireSBND::MakeWire");
+
+    // when deconvolved is holder's own data, holder has the transform size,
+    // never below dataSize, so it only shrinks and deconvolved stays valid
+    holder.resize(dataSize);
+    float min = 0, max = 0;
+    for(unsigned int bin = 0; bin < dataSize; ++bin) {
+      float const value = deconvolved[bin];
+      holder[bin] = value;
+      if (value > max) max = value;
+      if (value < min) min = value;
+    }
+    return FinishWire(digit, holder, min, max);
+  }
+
+  //////////////////////////////////////////////////////
+  recob::Wire CalWireSBND::FinishWire(DigitRef const& digit, std::vector<float>& holder,
+                                      float min, float max) const
+  {
+    // restore DC component through baseline subtraction
+    if( fDoBaselineSub ) SubtractBaseline(holder, min, max);
+    // more advanced, interpolation-based subtraction alg 
+    // that uses the BaseSampleBins and BaseVarCut params
+    if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
+
+    CandidateROIVec candROIVec;
+    fROITool->FindROIs( holder, digit.channel, fChannelTable[digit.channel].plane, candROIVec);//calculates ROI and returns it to roiVec.
+    recob::Wire::RegionsOfInterest_t roiVec;
+
+    // each ROI is copied straight from the waveform, [first, second] inclusive
+    for(auto const& CandidateROI: candROIVec)
+      roiVec.add_range(CandidateROI.first, holder.begin() + CandidateROI.first,
+                       holder.begin() + CandidateROI.second + 1);
+
+    if ( digit.digit ) return recob::WireCreator(std::move(roiVec), *digit.digit).move();
+    return recob::WireCreator(std::move(roiVec), digit.channel, fChannelTable[digit.channel].view).move();
+  }
+
+  //////////////////////////////////////////////////////
+  void CalWireSBND::DeconvoluteBatch(detinfo::DetectorClocksData const& clockData,
+                                     util::SignalShapingServiceSBND const& sss,
+                                     std::vector<DigitRef> const& digits,
+                                     size_t firstWire, size_t lastWire,
+                                     unsigned int dataSize, double deconNorm,
+                                     ChannelBuffers& buffers,
+                                     std::vector<recob::Wire>& wirecol) const
+  {
+    SBND_INSTR_SCOPE("CalWireSBND::DeconvoluteBatch");
+
+    int const transformSize = buffers.fft.FFTSize();
+    if ( !buffers.batch || buffers.batch->FFTSize() != transformSize )
+      buffers.batch = std::make_unique<util::SBNDBatchFFT>(transformSize);
+    util::SBNDBatchFFT& fft = *buffers.batch;
+    std::vector<float>& holder = buffers.holder;
+
+    // the channels of a view share the kernel, so each view is one
+    // matrix of rows for the batch FFT
+    std::vector<size_t> rows;
+    for (geo::View_t view : { geo::kU, geo::kV, geo::kZ }) {
+      rows.clear();
+      for (size_t iWire = firstWire; iWire < lastWire; ++iWire)
+        if ( sss.ChannelView(digits[iWire].channel) == view ) rows.push_back(iWire);
+      if ( rows.empty() ) continue;
+
+      float* data = fft.Rows(rows.size());
+      for (size_t r = 0; r < rows.size(); ++r) {
+        holder.resize(transformSize);
+        FillHolder(digits[rows[r]], dataSize, buffers.rawadc, holder);
+        std::copy(holder.begin(), holder.end(), data + r*transformSize);
+      }
+      if ( fFusedPostDeconvolution ) {
+        sss.DeconvoluteNormalized(clockData, view, data, rows.size(), fft);
+        for (size_t r = 0; r < rows.size(); ++r)
+          wirecol[rows[r]] = MakeWireNormalized(digits[rows[r]], data + r*transformSize, dataSize, holder);
+        continue;
+      }
+      sss.Deconvolute(clockData, view, data, rows.size(), fft);
+      for (size_t r = 0; r < rows.size(); ++r) {
+        float const* row = data + r*transformSize;
+        holder.assign(row, row + transformSize);
+        for (float& value : holder) value /= deconNorm;
+        wirecol[rows[r]] = MakeWire(digits[rows[r]], dataSize, holder);
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////
+  void CalWireSBND::SubtractBaseline(std::vector<float>& holder, float min, float max) const
   {
     // Robust baseline calculation that effectively ignores outlier 
     // samples from large pulses:
@@ -320,16 +590,19 @@ namespace caldata {
     //   (3) calculate the mean along the entire waveform using
     //       only samples with values close to this mode.
     unsigned int bin(0);  
-    float min = 0, max = 0;
-    for(bin = 0; bin < holder.size(); bin++){
-      if (holder[bin] > max) max = holder[bin];
-      if (holder[bin] < min) min = holder[bin];
-    }
     int nbin = max - min;
     if (nbin > 0) {
-      TH1F h("h","h",nbin,min,max);
-      for(bin = 0; bin < holder.size(); bin++) h.Fill(holder[bin]);
-      float x_max = h.GetXaxis()->GetBinCenter(h.GetMaximumBin());
+      // histogram with the binning of a TH1F(nbin, min, max): the mode
+      // search needs no ROOT object, and is safe in the channel workers
+      double const range = double(max) - double(min);
+      std::vector<unsigned int> h(nbin, 0);
+      for(bin = 0; bin < holder.size(); bin++) {
+        if (holder[bin] >= max) continue; // overflow
+        int const hbin = int(nbin*(holder[bin] - double(min))/range);
+        if (hbin < nbin) ++h[hbin];
+      }
+      int const maxBin = std::max_element(h.begin(), h.end()) - h.begin();
+      float x_max = min + (maxBin + 0.5)*(range/nbin);
       float ped   = x_max;
       float sum   = 0;
       int ncount  = 0;
@@ -344,122 +617,14 @@ namespace caldata {
     }
   }
  
-  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder)
+  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder) const
   {
-      // Subtract baseline using linear interpolation between regions defined
-      // by the datasize and fBaseSampleBins
-
-      // number of points to characterize the baseline
-      unsigned short nBasePts = holder.size() / fBaseSampleBins;
-
-      // the baseline offset vector
-      std::vector<float> base;
-      for(unsigned short ii = 0; ii < nBasePts; ++ii) base.push_back(0.);
-      // find the average value in each region, using values that are
-      // similar
-      float fbins = fBaseSampleBins;
-      unsigned short nfilld = 0;
-      for(unsigned short ii = 0; ii < nBasePts; ++ii) {
-        unsigned short loBin = ii * fBaseSampleBins;
-        unsigned short hiBin = loBin + fBaseSampleBins;
-        float ave = 0.;
-        float sum = 0.;
-        for(unsigned short bin = loBin; bin < hiBin; ++bin) {
-          ave += holder[bin];
-          sum += holder[bin] * holder[bin];
-        } // jj
-        ave = ave / fbins;
-        float var = (sum - fbins * ave * ave) / (fbins - 1.);
-        // Set the baseline for this region if the variance is small
-        if(var < fBaseVarCut) {
-          base[ii] = ave;
-          ++nfilld;
-        }
-      } // ii
-      // fill in any missing points if there aren't too many missing
-      if(nfilld < nBasePts && nfilld > nBasePts / 2) {
-        bool baseOK = true;
-        // check the first region
-        if(base[0] == 0) {
-          unsigned short ii1 = 0;
-          for(unsigned short ii = 1; ii < nBasePts; ++ii) {
-            if(base[ii] != 0) {
-              ii1 = ii;
-              break;
-            }
-          } // ii
-          unsigned short ii2 = 0;
-          for(unsigned short ii = ii1 + 1; ii < nBasePts; ++ii) {
-            if(base[ii] != 0) {
-              ii2 = ii;
-              break;
-            }
-          } // ii
-          // failure
-          if(ii2 > 0) {
-            float slp = (base[ii2] - base[ii1]) / (float)(ii2 - ii1);
-            base[0] = base[ii1] - slp * ii1;
-          } else {
-            baseOK = false;
-          }
-        } // base[0] == 0
-        // check the last region
-        if(baseOK && base[nBasePts] == 0) {
-          unsigned short ii2 = 0;
-          for(unsigned short ii = nBasePts - 1; ii > 0; --ii) {
-            if(base[ii] != 0) {
-              ii2 = ii;
-              break;
-            }
-          } // ii
-          baseOK = false; // assume the worst, hope for better
-          unsigned short ii1 = 0;
-          if (ii2 >= 1) {
-            for(unsigned short ii = ii2 - 1; ii > 0; --ii) {
-              if(base[ii] != 0) {
-                ii1 = ii;
-                baseOK = true;
-                break;
-              } // if base[ii]
-            } // ii
-          } // if ii2
-          if (baseOK) {
-            float slp = (base[ii2] - base[ii1]) / (float)(ii2 - ii1);
-            base[nBasePts] = base[ii2] + slp * (nBasePts - ii2);
-          }
-        } // baseOK && base[nBasePts] == 0
-        // now fill in any intermediate points
-        for(unsigned short ii = 1; ii < nBasePts - 1; ++ii) {
-          if(base[ii] == 0) {
-            // find the next non-zero region
-            for(unsigned short jj = ii + 1; jj < nBasePts; ++jj) {
-              if(base[jj] != 0) {
-                float slp = (base[jj] - base[ii - 1]) / (jj - ii + 1);
-                base[ii] = base[ii - 1] + slp;
-                break;
-              }
-            } // jj
-          } // base[ii] == 0
-        } // ii
-      } // nfilld < nBasePts
-
-      // interpolate and subtract
-      float slp = (base[1] - base[0]) / (float)fBaseSampleBins;
-      // bin offset to the origin (the center of the region)
-      unsigned short bof = fBaseSampleBins / 2;
-      unsigned short lastRegion = 0;
-      for(unsigned short bin = 0; bin < holder.size(); ++bin) {
-        // in a new region?
-        unsigned short region = bin / fBaseSampleBins;
-        if(region > lastRegion) {
-          // update the slope and offset
-          slp = (base[region] - base[lastRegion]) / (float)fBaseSampleBins;
-          bof += fBaseSampleBins;
-          lastRegion = region;
-        }
-        holder[bin] -= base[region] + (bin - bof) * slp;
-      }
-    }
+    // Subtract baseline using linear interpolation between regions defined
+    // by the datasize and fBaseSampleBins
+    if ( fBaseSampleBins <= 0 ) return;
+    util::BlockBaseline baseline(fBaseSampleBins, fBaseVarCut);
+    baseline.Subtract(holder);
+  }
   
 
 } // end namespace caldata
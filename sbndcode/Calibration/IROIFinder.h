@@ -37,6 +37,20 @@ namespace sbnd_tool
         
       // Find the ROI's
       virtual void FindROIs(const Waveform&, size_t, CandidateROIVec&) const = 0;
+
+      // Find the ROI's of a channel whose plane (0, 1, 2 for U, V, Z) the
+      // caller already knows; by default the plane is looked up again
+      virtual void FindROIs(const Waveform& waveform, size_t channel, size_t /* plane */, CandidateROIVec& roiVec) const
+        { FindROIs(waveform, channel, roiVec); }
+
+      // Whether the ROI thresholds of the plane depend on the noise RMS of
+      // the waveform; if not, callers need not compute it
+      virtual bool UsesWaveformRMS(size_t /* plane */) const { return true; }
+
+      // Find the ROI's with the noise RMS of the waveform computed by the
+      // caller; by default it is ignored and computed again
+      virtual void FindROIs(const Waveform& waveform, size_t channel, size_t plane, double /* rmsNoise */, CandidateROIVec& roiVec) const
+        { FindROIs(waveform, channel, plane, roiVec); }
     };
 }
 #endif
@@ -14,6 +14,7 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcore/CoreUtils/ServiceUtil.h" // lar::providerFrom()
 #include "TH1D.h"
+#include <array>
 #include <fstream>
 #include <algorithm>
 #include <numeric> // std::accumulate
@@ -31,15 +32,23 @@ namespace sbnd_tool
     void   initializeHistograms(art::TFileDirectory&)                  const override;
     size_t plane()                                                   const override {return fPlane;}
     void   FindROIs(const Waveform&, size_t, CandidateROIVec&) const override;
+    void   FindROIs(const Waveform&, size_t, size_t, CandidateROIVec&) const override;
+    void   FindROIs(const Waveform&, size_t, size_t, double, CandidateROIVec&) const override;
+    bool   UsesWaveformRMS(size_t plane) const override {return fPlaneSettings[plane].numSigma != 0;}
     double calculateLocalRMS(const Waveform& waveform) const;
   private:
+    // Thresholds and padding of one plane
+    struct PlaneSettings {
+      float threshold;                                 ///< abs(threshold) ADC counts for ROI
+      int   numSigma;                                  ///< "# sigma" rms noise for ROI threshold
+      float preROIPad;                                 ///< ROI padding before the candidate
+      float postROIPad;                                ///< ROI padding after the candidate
+    };
+
     // Member variables from the fhicl file
     size_t                        fPlane;
     float                fNumBinsHalf;                ///< Determines # bins in ROI running sum
-    std::vector<float>   fThreshold;                  ///< abs(threshold) ADC counts for ROI
-    std::vector<int>              fNumSigma;                   ///< "# sigma" rms noise for ROI threshold
-    std::vector<float>   fPreROIPad;                  ///< ROI padding
-    std::vector<float>   fPostROIPad;                 ///< ROI padding
+    std::array<PlaneSettings, 3>  fPlaneSettings;     ///< settings of the U, V and Z planes
     
     // Services
     const geo::GeometryCore*                             fGeometry = lar::providerFrom<geo::Geometry>();
@@ -65,8 +74,8 @@ namespace sbnd_tool
     std::vector<float> zin;
     
     fNumBinsHalf = pset.get<float>             ("NumBinsHalf", 3);
-    fThreshold   = pset.get< std::vector<float> >("Threshold"     );
-    fNumSigma    = pset.get< std::vector<int> >           ("NumSigma"      );
+    std::vector<float> threshold = pset.get< std::vector<float> >("Threshold"     );
+    std::vector<int>   numSigma  = pset.get< std::vector<int> >  ("NumSigma"      );
     uin          = pset.get< std::vector<float> >("uPlaneROIPad"  );
     vin          = pset.get< std::vector<float> >("vPlaneROIPad"  );
     zin          = pset.get< std::vector<float> >("zPlaneROIPad"  );
@@ -75,17 +84,16 @@ namespace sbnd_tool
       throw art::Exception(art::errors::Configuration)
         << "u/v/z plane ROI pad size != 2";
     }
+    if(threshold.size() < 3 || numSigma.size() < 3) {
+      throw art::Exception(art::errors::Configuration)
+        << "Threshold and NumSigma need a value for each of the 3 planes";
+    }
     
-    fPreROIPad.resize(3);
-    fPostROIPad.resize(3);
-    
-    // put the ROI pad sizes into more convenient vectors
-    fPreROIPad[0]  = uin[0];
-    fPostROIPad[0] = uin[1];
-    fPreROIPad[1]  = vin[0];
-    fPostROIPad[1] = vin[1];
-    fPreROIPad[2]  = zin[0];
-    fPostROIPad[2] = zin[1];
+    // put the settings of each plane together, read once per channel
+    std::vector<float> const* pads[3] = {&uin, &vin, &zin};
+    for(size_t plane = 0; plane < 3; ++plane) {
+      fPlaneSettings[plane] = {threshold[plane], numSigma[plane], (*pads[plane])[0], (*pads[plane])[1]};
+    }
     
     // Get signal shaping service.
     sss = art::ServiceHandle<util::SignalShapingServiceSBND>();
@@ -93,126 +101,120 @@ namespace sbnd_tool
     return;
   }
     
-  //void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, size_t cnt, double rmsNoise, CandidateROIVec& roiVec) const
   void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, CandidateROIVec& roiVec) const
   {
     // First up, translate the channel to plane
     std::vector<geo::WireID> wids    = fGeometry->ChannelToWire(channel);
     const geo::PlaneID&      planeID = wids[0].planeID();
+
+    FindROIs(waveform, channel, planeID.Plane, roiVec);
+  }
+
+  void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, size_t plane, CandidateROIVec& roiVec) const
+  {
+    // with NumSigma 0 the thresholds do not depend on the noise
+    double rmsNoise = UsesWaveformRMS(plane) ? this->calculateLocalRMS(waveform) : 0.; // added from ICARUS calculation.
+
+    FindROIs(waveform, channel, plane, rmsNoise, roiVec);
+  }
+
+  void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, size_t plane, double rmsNoise, CandidateROIVec& roiVec) const
+  {
+    PlaneSettings const& settings = fPlaneSettings[plane];
     
     size_t numBins(2 * fNumBinsHalf + 1);
     size_t startBin(0);
     size_t stopBin(numBins);
     float  elecNoise = sss->GetRawNoise(channel);
 
-    double rmsNoise = this->calculateLocalRMS(waveform); // added from ICARUS calculation.
-
     float  rawNoise  = std::max(rmsNoise, double(elecNoise));
     
-    float startThreshold = sqrt(float(numBins)) * (fNumSigma[planeID.Plane] * rawNoise + fThreshold[planeID.Plane]);
+    float startThreshold = sqrt(float(numBins)) * (settings.numSigma * rawNoise + settings.threshold);
     float stopThreshold  = startThreshold;
     
     // Setup
     float runningSum = std::accumulate(waveform.begin(),waveform.begin()+numBins, 0.);
     
-    size_t roiStartBin(0);
-    bool   roiCandStart(false);
-    
+    // ROI padding of this plane; candidates are padded and merged with the
+    // previous ROI as soon as they close, so the ROIs are built in one pass
+    float const preROIPad  = settings.preROIPad;
+    float const postROIPad = settings.postROIPad;
+    auto addROI = [&](size_t start, size_t stop)
+      {
+        // low ROI end
+        size_t const first  = std::max(int(start - preROIPad),0);
+        // high ROI end
+        size_t const second = std::min(stop + postROIPad, float(waveform.size()) - 1);
+
+        // merge overlapping (or touching) ROI's; the padded ends never
+        // decrease, so the new ROI only extends the last one
+        if (!roiVec.empty() && first <= roiVec.back().second) roiVec.back().second = second;
+        else roiVec.push_back(CandidateROI(first, second));
+      };
+
     // search for ROIs - follow prescription from Bruce B using a running sum to make faster
     // Note that we start in the middle of the running sum... if we find an ROI padding will extend
     // past this to take care of ends of the waveform
-    for(size_t bin = fNumBinsHalf + 1; bin < waveform.size() - fNumBinsHalf; bin++)
+    // The search alternates between two tight loops, one looking for the start
+    // of a candidate and one for its end, instead of testing the state at each bin
+    float const endBin = waveform.size() - fNumBinsHalf;
+    size_t bin = fNumBinsHalf + 1;
+    while (bin < endBin)
       {
-        // handle the running sum
-        // Case, we are at start of waveform
-        runningSum -= waveform[startBin++];
-        
-        // Case, we are at end of waveform
-        runningSum += waveform[stopBin++];
-        
-        // We have already started a candidate ROI
-        if (roiCandStart)
-	  {
-            if (fabs(runningSum) < stopThreshold)
-	      {
-                if (bin - roiStartBin > 2) roiVec.push_back(CandidateROI(roiStartBin, bin));
-                
-                roiCandStart = false;
-	      }
-	  }
         // Not yet started a candidate ROI
-        else
-	  {
-            if (fabs(runningSum) > startThreshold)
-	      {
-                roiStartBin  = bin;
-                roiCandStart = true;
-	      }
-	  }
+        for (; bin < endBin; bin++)
+          {
+            runningSum -= waveform[startBin++];
+            runningSum += waveform[stopBin++];
+            if (fabs(runningSum) > startThreshold) break;
+          }
+        if (bin >= endBin) break;
+        size_t const roiStartBin = bin++;
+
+        // We have already started a candidate ROI
+        for (; bin < endBin; bin++)
+          {
+            runningSum -= waveform[startBin++];
+            runningSum += waveform[stopBin++];
+            if (fabs(runningSum) < stopThreshold) break;
+          }
+        // add the last ROI if existed
+        if (bin >= endBin)
+          {
+            addROI(roiStartBin, waveform.size() - 1);
+            break;
+          }
+        if (bin - roiStartBin > 2) addROI(roiStartBin, bin);
+        bin++;
       } // bin
     
-    // add the last ROI if existed
-    if (roiCandStart) roiVec.push_back(CandidateROI(roiStartBin, waveform.size() - 1));
-    
-    // pad the ROIs
-    for(auto& roi : roiVec)
-      {
-        // low ROI end
-        roi.first  = std::max(int(roi.first - fPreROIPad[planeID.Plane]),0);
-        // high ROI end
-        roi.second = std::min(roi.second + fPostROIPad[planeID.Plane], float(waveform.size()) - 1);
-      }
-    
-    // merge overlapping (or touching) ROI's
-    if(roiVec.size() > 1)
-      {
-        // temporary vector for merged ROIs
-        CandidateROIVec tempRoiVec;
-        
-        // Loop through candidate roi's
-        size_t startRoi = roiVec.front().first;
-        size_t stopRoi  = startRoi;
-        
-        for(auto& roi : roiVec)
-	  {
-            if (roi.first <= stopRoi) stopRoi = roi.second;
-            else
-	      {
-                tempRoiVec.push_back(CandidateROI(startRoi,stopRoi));
-                
-                startRoi = roi.first;
-                stopRoi  = roi.second;
-	      }
-	  }
-        
-        // Make sure to get the last one
-        tempRoiVec.push_back(CandidateROI(startRoi,stopRoi));
-        
-        roiVec = tempRoiVec;
-      }
-    
     return;
   }
 
 
   double ROIFinderStandardSBND::calculateLocalRMS(const Waveform& waveform) const
   {
-    // do rms calculation - the old fashioned way and over all adc values                                                                                            
-    std::vector<float> locWaveform = waveform;
+    // rms of the half of the samples closest to zero; only which samples
+    // are in that half matters, so a partial selection into a per-thread
+    // scratch buffer replaces the full sort
+    static thread_local std::vector<float> locWaveform;
+    locWaveform.assign(waveform.begin(), waveform.end());
 
-    // sort in ascending order so we can truncate the sume                                                                                                           
-    std::sort(locWaveform.begin(), locWaveform.end(),[](const auto& left, const auto& right){return std::fabs(left) < std::fabs(right);});
+    size_t const halfSize = locWaveform.size()/2;
+    std::nth_element(locWaveform.begin(), locWaveform.begin() + halfSize, locWaveform.end(),
+                     [](const auto& left, const auto& right){return std::fabs(left) < std::fabs(right);});
 
-    // Get the mean of the waveform we're checking...                                                                                                                
-    float sumWaveform  = std::accumulate(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2, 0.);
-    float meanWaveform = sumWaveform / float(locWaveform.size()/2);
+    // Get the mean of the waveform we're checking...
+    float sumWaveform  = std::accumulate(locWaveform.begin(),locWaveform.begin() + halfSize, 0.);
+    float meanWaveform = sumWaveform / float(halfSize);
 
-    std::vector<float> locWaveformDiff(locWaveform.size()/2);
-    std::transform(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2,locWaveformDiff.begin(), std::bind(std::minus<float>(),std::placeholders::_1,meanWaveform));
-
-    double localRMS = std::inner_product(locWaveformDiff.begin(), locWaveformDiff.end(), locWaveformDiff.begin(), 0.);
+    double localRMS = 0.;
+    for(size_t i = 0; i < halfSize; ++i) {
+      float const diff = locWaveform[i] - meanWaveform;
+      localRMS += diff * diff;
+    }
 
-    localRMS = std::sqrt(std::max(float(0.),float(localRMS) / float(locWaveformDiff.size())));
+    localRMS = std::sqrt(std::max(float(0.),float(localRMS) / float(halfSize)));
     
     return(localRMS);
 
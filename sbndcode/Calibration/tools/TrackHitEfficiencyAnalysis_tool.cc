@@ -20,6 +20,9 @@
 #include "lardataobj/Simulation/SimChannel.h"
 #include "nusimdata/SimulationBase/MCParticle.h"
 
+#include "sbndcode/Utilities/DiagnosticHist.h"
+#include "sbndcode/Utilities/HistAccumulator.h"
+
 // Eigen
 #include <Eigen/Dense>
 
@@ -56,6 +59,28 @@ using HitPtrVec       = std::vector<art::Ptr<recob::Hit>>;
 using ViewHitMap      = std::map<size_t,HitPtrVec>;
 using TrackViewHitMap = std::map<int,ViewHitMap>;
 
+// One dimensional histogram of unit weight fills, accumulated into flat
+// per-thread bins and added to its TH1F at the end of the job
+class BankedHist
+{
+public:
+    void Book(TH1F* hist)
+    {
+        fHist = hist;
+        fFills.Reset(hist->GetNbinsX(), hist->GetXaxis()->GetXmin(), hist->GetXaxis()->GetXmax());
+    }
+
+    void Fill(double x) { fFills.Fill(x); }
+
+    void Merge() { if (fHist) fFills.MergeInto(*fHist); }
+
+    TH1F* Hist() const { return fHist; }
+
+private:
+    TH1F*                      fHist = nullptr;
+    sbnd::diag::DiagnosticHist fFills;
+};
+
 class TrackHitEfficiencyAnalysis : virtual public IHitEfficiencyHistogramTool
 {
 public:
@@ -118,20 +143,22 @@ private:
     std::vector<int>            fOffsetVec;              ///< Allow offsets for each plane
     std::vector<float>          fSigmaVec;               ///< Window size for matching to SimChannels
     int                         fMinAllowedChanStatus;   ///< Don't consider channels with lower status
+    std::string                 fAccumulatorFile;        ///< Histogram accumulator file written at end of job, none if empty
+    std::string                 fHistDirName;            ///< Directory of the histograms, for the accumulator file
 
     // Pointers to the histograms we'll create.
-    std::vector<TH1F*>          fTotalElectronsHistVec;
-    std::vector<TH1F*>          fMaxElectronsHistVec;
-    std::vector<TH1F*>          fHitElectronsVec;
-    std::vector<TH1F*>          fHitSumADCVec;
-    std::vector<TH1F*>          fHitIntegralHistVec;
-    std::vector<TH1F*>          fHitPulseHeightVec;
-    std::vector<TH1F*>          fHitPulseWidthVec;
-    std::vector<TH1F*>          fSimNumTDCVec;
-    std::vector<TH1F*>          fHitNumTDCVec;
-    std::vector<TH1F*>          fSnippetLenVec;
-    std::vector<TH1F*>          fNMatchedHitVec;
-    std::vector<TH1F*>          fDeltaMidTDCVec;
+    mutable std::vector<BankedHist> fTotalElectronsHistVec;
+    mutable std::vector<BankedHist> fMaxElectronsHistVec;
+    mutable std::vector<BankedHist> fHitElectronsVec;
+    mutable std::vector<BankedHist> fHitSumADCVec;
+    mutable std::vector<BankedHist> fHitIntegralHistVec;
+    mutable std::vector<BankedHist> fHitPulseHeightVec;
+    mutable std::vector<BankedHist> fHitPulseWidthVec;
+    mutable std::vector<BankedHist> fSimNumTDCVec;
+    mutable std::vector<BankedHist> fHitNumTDCVec;
+    mutable std::vector<BankedHist> fSnippetLenVec;
+    mutable std::vector<BankedHist> fNMatchedHitVec;
+    mutable std::vector<BankedHist> fDeltaMidTDCVec;
     std::vector<TProfile*>      fWireEfficVec;
     std::vector<TProfile*>      fWireEfficPHVec;
     std::vector<TProfile*>      fHitEfficVec;
@@ -140,18 +167,18 @@ private:
     std::vector<TProfile*>      fHitEfficRMSVec;
     std::vector<TProfile*>      fCosXZvRMSVec;
     std::vector<TProfile2D*>    fHitENEvXZVec;
-    std::vector<TH1F*>          fSimDivHitChgVec;
-    std::vector<TH1F*>          fSimDivHitChg1Vec;
+    mutable std::vector<BankedHist> fSimDivHitChgVec;
+    mutable std::vector<BankedHist> fSimDivHitChg1Vec;
     std::vector<TH2F*>          fHitVsSimChgVec;
     std::vector<TH2F*>          fHitVsSimIntVec;
     std::vector<TH2F*>          fToteVHitEIntVec;
 
-    std::vector<TH1F*>          fNSimChannelHitsVec;
-    std::vector<TH1F*>          fNRecobHitVec;
+    mutable std::vector<BankedHist> fNSimChannelHitsVec;
+    mutable std::vector<BankedHist> fNRecobHitVec;
  //std::vector<TH1F*>          fNRejectedHitVec;
-    std::vector<TH1F*>          fHitEfficiencyVec;
+    mutable std::vector<BankedHist> fHitEfficiencyVec;
     
- std::vector<TH1F*>          fNFakeHitVec;
+ mutable std::vector<BankedHist> fNFakeHitVec;
 
     // TTree variables
     mutable TTree*             fTree;
@@ -232,6 +259,7 @@ void TrackHitEfficiencyAnalysis::configure(fhicl::ParameterSet const & pset)
     fOffsetVec                = pset.get<std::vector<int>           >("OffsetVec",          std::vector<int>()={0,0,0});
     fSigmaVec                 = pset.get<std::vector<float>         >("SigmaVec",           std::vector<float>()={1.,1.,1.});
     fMinAllowedChanStatus     = pset.get< int                       >("MinAllowedChannelStatus");
+    fAccumulatorFile          = pset.get< std::string               >("AccumulatorFile",    "");
 }
 
 //----------------------------------------------------------------------------
@@ -240,6 +268,7 @@ void TrackHitEfficiencyAnalysis::initializeHists(art::ServiceHandle<art::TFileSe
 {
     // Make a directory for these histograms
     art::TFileDirectory dir = tfs->mkdir(dirName.c_str());
+    fHistDirName = dirName;
     
     fTotalElectronsHistVec.resize(fGeometry->Nplanes());
     fMaxElectronsHistVec.resize(fGeometry->Nplanes());
@@ -275,24 +304,24 @@ void TrackHitEfficiencyAnalysis::initializeHists(art::ServiceHandle<art::TFileSe
 
     for(size_t plane = 0; plane < fGeometry->Nplanes(); plane++)
     {
-        fTotalElectronsHistVec.at(plane) = dir.make<TH1F>(("TotalElecs"  + std::to_string(plane)).c_str(), ";Total # electrons",     250,    0.,  100000.);
-        fMaxElectronsHistVec.at(plane)   = dir.make<TH1F>(("MaxElecs"    + std::to_string(plane)).c_str(), ";Max # electrons",       250,    0.,  20000.);
-        fHitElectronsVec.at(plane)       = dir.make<TH1F>(("HitElecs"    + std::to_string(plane)).c_str(), ";# e- in Hit Range",     250,    0.,  100000.);
-        fHitSumADCVec.at(plane)          = dir.make<TH1F>(("SumADC"      + std::to_string(plane)).c_str(), "Hit Sum ADC",            200,    0.,  1000.);
-        fHitIntegralHistVec.at(plane)    = dir.make<TH1F>(("Integral"    + std::to_string(plane)).c_str(), "Hit Integral",           200,    0.,  1000.);
-        fHitPulseHeightVec.at(plane)     = dir.make<TH1F>(("PulseHeight" + std::to_string(plane)).c_str(), "Hit PH (ADC)",           200,    0.,  150.);
-        fHitPulseWidthVec.at(plane)      = dir.make<TH1F>(("PulseWidth"  + std::to_string(plane)).c_str(), "Hit PulseWidth;Hit RMS", 100,    0.,  20.);
-        fSimNumTDCVec.at(plane)          = dir.make<TH1F>(("SimNumTDC"   + std::to_string(plane)).c_str(), ";TDC ticks",             100,    0.,  100.);
-        fHitNumTDCVec.at(plane)          = dir.make<TH1F>(("HitNumTDC"   + std::to_string(plane)).c_str(), ";ticks",                 100,    0.,  100.);
-        fSnippetLenVec.at(plane)         = dir.make<TH1F>(("SnippetLen"  + std::to_string(plane)).c_str(), ";ticks",                 100,    0.,  100.);
-        fNMatchedHitVec.at(plane)        = dir.make<TH1F>(("NMatched"    + std::to_string(plane)).c_str(), ";# hits",                 20,    0.,  20.);
-        fDeltaMidTDCVec.at(plane)        = dir.make<TH1F>(("DeltaMid"    + std::to_string(plane)).c_str(), ";# hits",                 50,  -25.,  25.);
-        fNSimChannelHitsVec.at(plane)    = dir.make<TH1F>(("NSimChan"    + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  1200.);
-        fNRecobHitVec.at(plane)          = dir.make<TH1F>(("NRecobHit"   + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  1200.);
-        fNFakeHitVec.at(plane)           = dir.make<TH1F>(("NFakeHit"    + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  50.);
-        fHitEfficiencyVec.at(plane)      = dir.make<TH1F>(("PlnEffic"    + std::to_string(plane)).c_str(), ";# hits",                101,    0.,  1.01);
-        fSimDivHitChgVec.at(plane)       = dir.make<TH1F>(("SimDivHit"   + std::to_string(plane)).c_str(), ";# e / SummedADC",       200,    0.,  200.);
-        fSimDivHitChg1Vec.at(plane)      = dir.make<TH1F>(("SimDivHit1"  + std::to_string(plane)).c_str(), ";# e / Integral",        200,    0.,  200.);
+        fTotalElectronsHistVec.at(plane).Book(dir.make<TH1F>(("TotalElecs"  + std::to_string(plane)).c_str(), ";Total # electrons",     250,    0.,  100000.));
+        fMaxElectronsHistVec.at(plane).Book(  dir.make<TH1F>(("MaxElecs"    + std::to_string(plane)).c_str(), ";Max # electrons",       250,    0.,  20000.));
+        fHitElectronsVec.at(plane).Book(      dir.make<TH1F>(("HitElecs"    + std::to_string(plane)).c_str(), ";# e- in Hit Range",     250,    0.,  100000.));
+        fHitSumADCVec.at(plane).Book(         dir.make<TH1F>(("SumADC"      + std::to_string(plane)).c_str(), "Hit Sum ADC",            200,    0.,  1000.));
+        fHitIntegralHistVec.at(plane).Book(   dir.make<TH1F>(("Integral"    + std::to_string(plane)).c_str(), "Hit Integral",           200,    0.,  1000.));
+        fHitPulseHeightVec.at(plane).Book(    dir.make<TH1F>(("PulseHeight" + std::to_string(plane)).c_str(), "Hit PH (ADC)",           200,    0.,  150.));
+        fHitPulseWidthVec.at(plane).Book(     dir.make<TH1F>(("PulseWidth"  + std::to_string(plane)).c_str(), "Hit PulseWidth;Hit RMS", 100,    0.,  20.));
+        fSimNumTDCVec.at(plane).Book(         dir.make<TH1F>(("SimNumTDC"   + std::to_string(plane)).c_str(), ";TDC ticks",             100,    0.,  100.));
+        fHitNumTDCVec.at(plane).Book(         dir.make<TH1F>(("HitNumTDC"   + std::to_string(plane)).c_str(), ";ticks",                 100,    0.,  100.));
+        fSnippetLenVec.at(plane).Book(        dir.make<TH1F>(("SnippetLen"  + std::to_string(plane)).c_str(), ";ticks",                 100,    0.,  100.));
+        fNMatchedHitVec.at(plane).Book(       dir.make<TH1F>(("NMatched"    + std::to_string(plane)).c_str(), ";# hits",                 20,    0.,  20.));
+        fDeltaMidTDCVec.at(plane).Book(       dir.make<TH1F>(("DeltaMid"    + std::to_string(plane)).c_str(), ";# hits",                 50,  -25.,  25.));
+        fNSimChannelHitsVec.at(plane).Book(   dir.make<TH1F>(("NSimChan"    + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  1200.));
+        fNRecobHitVec.at(plane).Book(         dir.make<TH1F>(("NRecobHit"   + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  1200.));
+        fNFakeHitVec.at(plane).Book(          dir.make<TH1F>(("NFakeHit"    + std::to_string(plane)).c_str(), ";# hits",                100,    0.,  50.));
+        fHitEfficiencyVec.at(plane).Book(     dir.make<TH1F>(("PlnEffic"    + std::to_string(plane)).c_str(), ";# hits",                101,    0.,  1.01));
+        fSimDivHitChgVec.at(plane).Book(      dir.make<TH1F>(("SimDivHit"   + std::to_string(plane)).c_str(), ";# e / SummedADC",       200,    0.,  200.));
+        fSimDivHitChg1Vec.at(plane).Book(     dir.make<TH1F>(("SimDivHit1"  + std::to_string(plane)).c_str(), ";# e / Integral",        200,    0.,  200.));
 
         fHitVsSimChgVec.at(plane)        = dir.make<TH2F>(("HitVSimQ"  + std::to_string(plane)).c_str(), "# e vs Hit SumADC;SumADC;# e",     50, 0.,   1000., 50, 0., 100000.);
         fHitVsSimIntVec.at(plane)        = dir.make<TH2F>(("HitVSimI"  + std::to_string(plane)).c_str(), "# e vs Hit Integral;Integral;# e", 50, 0.,   1000., 50, 0., 100000.);
@@ -447,6 +476,11 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
     art::Handle< std::vector<int>> badChannelHandle;
     event.getByLabel(fBadChannelProducerLabel, badChannelHandle);
 
+    // Sorted once, it is searched for every channel
+    std::vector<int> badChannels;
+    if (badChannelHandle.isValid()) badChannels = *badChannelHandle;
+    std::sort(badChannels.begin(), badChannels.end());
+
     //    std::cout<<"Pre TPC loop (L455ish)"<<std::endl;
 
     // Now start a loop over the individual TPCs to build out the structures for RawDigits and Wires
@@ -552,9 +586,7 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
             if (badChannelHandle.isValid())
             {
                 // Here we query the input list from the wirecell processing
-                std::vector<int>::const_iterator badItr = std::find(badChannelHandle->begin(),badChannelHandle->end(),chanToTDCToIDEMap.first);
-    
-                if (badItr != badChannelHandle->end()) continue;
+                if (std::binary_search(badChannels.begin(),badChannels.end(),int(chanToTDCToIDEMap.first))) continue;
                 //            {
                 //                ChanToRawDigitMap::const_iterator rawDigitItr = chanToRawDigitMap.find(chanToTDCToIDEMap.first);
                 //
@@ -575,7 +607,7 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
                 //            }
             }
         
-            TDCToIDEMap    tdcToIDEMap = chanToTDCToIDEMap.second;
+            const TDCToIDEMap& tdcToIDEMap = chanToTDCToIDEMap.second;
             float          totalElectrons(0.);
             float          maxElectrons(0.);
             unsigned short maxElectronsTDC(0);
@@ -627,8 +659,8 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
     
             totalElectrons = std::min(totalElectrons, float(99900.));
         
-            fTotalElectronsHistVec[plane]->Fill(totalElectrons, 1.);
-            fMaxElectronsHistVec[plane]->Fill(maxElectrons, 1.);
+            fTotalElectronsHistVec[plane].Fill(totalElectrons);
+            fMaxElectronsHistVec[plane].Fill(maxElectrons);
         
             nSimChannelHitVec[plane]++;
     
@@ -640,7 +672,7 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
             unsigned short stopTick  = clockData.TPCTDC2Tick(stopTDC)         + fOffsetVec[plane];
             unsigned short maxETick  = clockData.TPCTDC2Tick(maxElectronsTDC) + fOffsetVec[plane];
     
-            fSimNumTDCVec[plane]->Fill(stopTick - startTick, 1.);
+            fSimNumTDCVec[plane].Fill(stopTick - startTick);
         
             // Set up to extract the "best" parameters in the event of more than one hit for this pulse train
             float          nElectronsTotalBest(0.);
@@ -751,7 +783,7 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
                             {
                                 unsigned short hitTDC = clockData.TPCTick2TDC(tick - fOffsetVec[plane]);
                     
-                                TDCToIDEMap::iterator ideIterator = tdcToIDEMap.find(hitTDC);
+                                TDCToIDEMap::const_iterator ideIterator = tdcToIDEMap.find(hitTDC);
                     
                                 if (ideIterator != tdcToIDEMap.end()) nElectronsTotalBest += ideIterator->second.numElectrons;
                             }
@@ -762,19 +794,19 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
                             float chgRatioADC = hitSummedADCBest > 0. ? totalElectrons / hitSummedADCBest : 0.;
                             float chgRatioInt = hitIntegralBest  > 0. ? totalElectrons / hitIntegralBest  : 0.;
         
-                            fHitSumADCVec[plane]->Fill(hitSummedADCBest, 1.);
-                            fHitIntegralHistVec[plane]->Fill(hitIntegralBest, 1.);
-                            fSimDivHitChgVec[plane]->Fill(chgRatioADC, 1.);
-                            fSimDivHitChg1Vec[plane]->Fill(chgRatioInt, 1.);
+                            fHitSumADCVec[plane].Fill(hitSummedADCBest);
+                            fHitIntegralHistVec[plane].Fill(hitIntegralBest);
+                            fSimDivHitChgVec[plane].Fill(chgRatioADC);
+                            fSimDivHitChg1Vec[plane].Fill(chgRatioInt);
                             fHitVsSimChgVec[plane]->Fill(std::min(hitSummedADCBest,float(999.)), totalElectrons, 1.);
                             fHitVsSimIntVec[plane]->Fill(std::min(hitIntegralBest,float(999.)), totalElectrons, 1.);
                             fToteVHitEIntVec[plane]->Fill(std::min(totalElectrons,float(99999.)),std::min(nElectronsTotalBest,float(99999.)),1.);
-                            fHitPulseHeightVec[plane]->Fill(std::min(hitPeakAmpBest,float(149.5)), 1.);
-                            fHitPulseWidthVec[plane]->Fill(std::min(hitRMSBest,float(19.8)), 1.);
-                            fHitElectronsVec[plane]->Fill(nElectronsTotalBest, 1.);
-                            fHitNumTDCVec[plane]->Fill(std::min(float(hitStopTickBest - hitStartTickBest),float(99.5)), 1.);
-                            fSnippetLenVec[plane]->Fill(std::min(hitSnippetLenBest, float(99.5)), 1.);
-                            fDeltaMidTDCVec[plane]->Fill(hitPeakTimeBest - maxETick, 1.);
+                            fHitPulseHeightVec[plane].Fill(std::min(hitPeakAmpBest,float(149.5)));
+                            fHitPulseWidthVec[plane].Fill(std::min(hitRMSBest,float(19.8)));
+                            fHitElectronsVec[plane].Fill(nElectronsTotalBest);
+                            fHitNumTDCVec[plane].Fill(std::min(float(hitStopTickBest - hitStartTickBest),float(99.5)));
+                            fSnippetLenVec[plane].Fill(std::min(hitSnippetLenBest, float(99.5)));
+                            fDeltaMidTDCVec[plane].Fill(hitPeakTimeBest - maxETick);
                     
                             nRecobHitVec[plane]++;
 
@@ -801,7 +833,7 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
             float matchHit   = std::min(nMatchedHits,1);
             float snippetLen = std::min(float(stopTick - startTick),float(99.5));
             
-            fNMatchedHitVec[plane]->Fill(nMatchedHits, 1.);
+            fNMatchedHitVec[plane].Fill(nMatchedHits);
             fHitEfficVec[plane]->Fill(totalElectrons,   matchHit,   1.);
             fHitEfficPHVec[plane]->Fill(maxElectrons,   matchHit,   1.);
             fHitEfficXZVec[plane]->Fill(cosThetaXZ,     matchHit,   1.);
@@ -849,10 +881,10 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
         {
             float hitEfficiency = float(nRecobHitVec[idx]) / float(nSimChannelHitVec[idx]);
         
-            fNSimChannelHitsVec[idx]->Fill(std::min(nSimChannelHitVec[idx],1999),1.);
-            fNRecobHitVec[idx]->Fill(std::min(nRecobHitVec[idx],1999), 1.);
-            fNFakeHitVec[idx]->Fill(nFakeHitVec[idx]/(float)nSimulatedWiresVec[idx],1.);
-            fHitEfficiencyVec[idx]->Fill(hitEfficiency, 1.);
+            fNSimChannelHitsVec[idx].Fill(std::min(nSimChannelHitVec[idx],1999));
+            fNRecobHitVec[idx].Fill(std::min(nRecobHitVec[idx],1999));
+            fNFakeHitVec[idx].Fill(nFakeHitVec[idx]/(float)nSimulatedWiresVec[idx]);
+            fHitEfficiencyVec[idx].Fill(hitEfficiency);
         }
     }
 
@@ -862,6 +894,47 @@ void TrackHitEfficiencyAnalysis::fillHistograms(const art::Event& event) const
 // Useful for normalizing histograms
 void TrackHitEfficiencyAnalysis::endJob(int numEvents)
 {
+    for(auto* histVec : {&fTotalElectronsHistVec, &fMaxElectronsHistVec, &fHitElectronsVec, &fHitSumADCVec,
+                         &fHitIntegralHistVec, &fHitPulseHeightVec, &fHitPulseWidthVec, &fSimNumTDCVec,
+                         &fHitNumTDCVec, &fSnippetLenVec, &fNMatchedHitVec, &fDeltaMidTDCVec,
+                         &fSimDivHitChgVec, &fSimDivHitChg1Vec, &fNSimChannelHitsVec, &fNRecobHitVec,
+                         &fHitEfficiencyVec, &fNFakeHitVec})
+    {
+        for(auto& hist : *histVec) hist.Merge();
+    }
+
+    // The same histograms as sums which add up across jobs, for
+    // merge_hist_accumulators
+    if (!fAccumulatorFile.empty())
+    {
+        sbnd::diag::HistAccumulator accumulator;
+        auto capture = [this, &accumulator](TH1 const* hist)
+            { if (hist) accumulator.Capture(*hist, fHistDirName + "/" + hist->GetName()); };
+
+        for(auto* histVec : {&fTotalElectronsHistVec, &fMaxElectronsHistVec, &fHitElectronsVec, &fHitSumADCVec,
+                             &fHitIntegralHistVec, &fHitPulseHeightVec, &fHitPulseWidthVec, &fSimNumTDCVec,
+                             &fHitNumTDCVec, &fSnippetLenVec, &fNMatchedHitVec, &fDeltaMidTDCVec,
+                             &fSimDivHitChgVec, &fSimDivHitChg1Vec, &fNSimChannelHitsVec, &fNRecobHitVec,
+                             &fHitEfficiencyVec, &fNFakeHitVec})
+        {
+            for(auto const& hist : *histVec) capture(hist.Hist());
+        }
+        for(auto* histVec : {&fWireEfficVec, &fWireEfficPHVec, &fHitEfficVec, &fHitEfficPHVec,
+                             &fHitEfficXZVec, &fHitEfficRMSVec, &fCosXZvRMSVec})
+        {
+            for(TProfile const* hist : *histVec) capture(hist);
+        }
+        for(TProfile2D const* hist : fHitENEvXZVec) capture(hist);
+        for(auto* histVec : {&fHitVsSimChgVec, &fHitVsSimIntVec, &fToteVHitEIntVec})
+        {
+            for(TH2F const* hist : *histVec) capture(hist);
+        }
+
+        if (!accumulator.Write(fAccumulatorFile))
+            throw cet::exception("TrackHitEfficiencyAnalysis") << "Cannot write the histogram accumulator file '"
+                                                               << fAccumulatorFile << "'\n";
+    }
+
     return;
 }
     
@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// File:        TPCChannelMapCache.h
+//
+// Binary cache of the SBND TPC channel map entries.
+//
+// The cache holds the entries of a channel map together with a checksum
+// of the source the map was read from (the text file, or the result of a
+// hardware database query), so a changed source invalidates it. It is
+// memory-mapped when read, and every record is checked against a
+// checksum of the payload: a missing, stale or damaged cache is reported
+// as not read, and the caller falls back to the source.
+//
+// Layout (native byte order):
+//   "SBNDTPCM", uint32 version, uint32 number of entries,
+//   uint64 source checksum, uint64 payload checksum, payload.
+// Each payload record has the numeric fields of ChanInfo_t as uint32,
+// then its strings, each as a uint16 length and the characters.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDTPCChannelMapCache_H
+#define SBNDTPCChannelMapCache_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TPCChannelMapService.h"
+
+namespace SBND {
+
+  namespace TPCChannelMapCache {
+
+    using ChanInfo_t = SBND::TPCChannelMapService::ChanInfo_t;
+
+    constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'T', 'P', 'C', 'M' };
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::size_t kHeaderSize = sizeof(kMagic) + 2*sizeof(std::uint32_t) + 2*sizeof(std::uint64_t);
+
+    // 64-bit FNV-1a hash, used both for the source and for the payload.
+    inline std::uint64_t Checksum(char const* data, std::size_t size) {
+      std::uint64_t hash = 0xcbf29ce484222325ULL;
+      for (std::size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    namespace details {
+
+      inline void putUInt(std::string& out, std::uint32_t value) {
+        out.append(reinterpret_cast<char const*>(&value), sizeof(value));
+      }
+
+      inline void putString(std::string& out, std::string const& value) {
+        std::uint16_t const size = value.size();
+        out.append(reinterpret_cast<char const*>(&size), sizeof(size));
+        out.append(value, 0, size);
+      }
+
+      // Reads from [pos, end); any read past end makes the reader fail.
+      struct Reader {
+        char const* pos;
+        char const* end;
+        bool ok = true;
+
+        std::uint32_t getUInt() {
+          std::uint32_t value = 0;
+          if (end - pos < (std::ptrdiff_t) sizeof(value)) { ok = false; return value; }
+          std::memcpy(&value, pos, sizeof(value));
+          pos += sizeof(value);
+          return value;
+        }
+
+        std::string getString() {
+          std::uint16_t size = 0;
+          if (end - pos < (std::ptrdiff_t) sizeof(size)) { ok = false; return {}; }
+          std::memcpy(&size, pos, sizeof(size));
+          pos += sizeof(size);
+          if (end - pos < size) { ok = false; return {}; }
+          std::string value(pos, size);
+          pos += size;
+          return value;
+        }
+      };
+
+    } // namespace details
+
+    // Fill entries from the cache at path; false if it is not there, not
+    // readable, made from another source or damaged.
+    inline bool Read(std::string const& path, std::uint64_t sourceChecksum, std::vector<ChanInfo_t>& entries) {
+
+      int const fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0) return false;
+
+      struct stat st;
+      if (::fstat(fd, &st) != 0 || (std::size_t) st.st_size < kHeaderSize) {
+        ::close(fd);
+        return false;
+      }
+      std::size_t const size = st.st_size;
+      void* const mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (mapped == MAP_FAILED) return false;
+
+      char const* const data = static_cast<char const*>(mapped);
+      std::uint32_t version = 0, nEntries = 0;
+      std::uint64_t cachedSourceChecksum = 0, payloadChecksum = 0;
+      char const* pos = data + sizeof(kMagic);
+      std::memcpy(&version, pos, sizeof(version));                            pos += sizeof(version);
+      std::memcpy(&nEntries, pos, sizeof(nEntries));                          pos += sizeof(nEntries);
+      std::memcpy(&cachedSourceChecksum, pos, sizeof(cachedSourceChecksum));  pos += sizeof(cachedSourceChecksum);
+      std::memcpy(&payloadChecksum, pos, sizeof(payloadChecksum));            pos += sizeof(payloadChecksum);
+
+      bool ok = std::memcmp(data, kMagic, sizeof(kMagic)) == 0
+        && version == kVersion
+        && cachedSourceChecksum == sourceChecksum
+        && Checksum(pos, data + size - pos) == payloadChecksum;
+
+      std::vector<ChanInfo_t> cached;
+      if (ok) {
+        cached.reserve(nEntries);
+        details::Reader in{ pos, data + size };
+        for (std::uint32_t i = 0; i < nEntries && in.ok; ++i) {
+          ChanInfo_t c{};
+          c.wireno    = in.getUInt();
+          c.plane     = in.getUInt();
+          c.FEMBOnWIB = in.getUInt();
+          c.FEMBCh    = in.getUInt();
+          c.asic      = in.getUInt();
+          c.asicchan  = in.getUInt();
+          c.WIBCrate  = in.getUInt();
+          c.WIB       = in.getUInt();
+          c.WIBCh     = in.getUInt();
+          c.WIBQFSP   = in.getUInt();
+          c.QFSPFiber = in.getUInt();
+          c.FEMCrate  = in.getUInt();
+          c.FEM       = in.getUInt();
+          c.FEMCh     = in.getUInt();
+          c.offlchan  = in.getUInt();
+          c.valid     = in.getUInt() != 0;
+          c.EastWest      = in.getString();
+          c.NorthSouth    = in.getString();
+          c.SideTop       = in.getString();
+          c.FEMBPosition  = in.getString();
+          c.FEMBSerialNum = in.getString();
+          cached.push_back(std::move(c));
+        }
+        ok = in.ok && in.pos == in.end;
+      }
+
+      ::munmap(mapped, size);
+      if (ok) entries = std::move(cached);
+      return ok;
+    }
+
+    // Write entries to the cache at path (through a temporary file, so a
+    // concurrent reader never sees a partial cache); false on failure.
+    inline bool Write(std::string const& path, std::uint64_t sourceChecksum, std::vector<ChanInfo_t> const& entries) {
+
+      std::string payload;
+      for (auto const& c: entries) {
+        for (std::uint32_t value: { c.wireno, c.plane, c.FEMBOnWIB, c.FEMBCh, c.asic, c.asicchan,
+                                    c.WIBCrate, c.WIB, c.WIBCh, c.WIBQFSP, c.QFSPFiber,
+                                    c.FEMCrate, c.FEM, c.FEMCh, c.offlchan, (std::uint32_t) c.valid }) {
+          details::putUInt(payload, value);
+        }
+        for (std::string const* value: { &c.EastWest, &c.NorthSouth, &c.SideTop, &c.FEMBPosition, &c.FEMBSerialNum }) {
+          details::putString(payload, *value);
+        }
+      }
+
+      std::uint32_t const nEntries = entries.size();
+      std::uint64_t const payloadChecksum = Checksum(payload.data(), payload.size());
+
+      std::string const tmpPath = path + ".tmp" + std::to_string(::getpid());
+      {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(kMagic, sizeof(kMagic));
+        out.write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+        out.write(reinterpret_cast<char const*>(&nEntries), sizeof(nEntries));
+        out.write(reinterpret_cast<char const*>(&sourceChecksum), sizeof(sourceChecksum));
+        out.write(reinterpret_cast<char const*>(&payloadChecksum), sizeof(payloadChecksum));
+        out.write(payload.data(), payload.size());
+        if (!out) {
+          out.close();
+          std::remove(tmpPath.c_str());
+          return false;
+        }
+      }
+      if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+      }
+      return true;
+    }
+
+  } // namespace TPCChannelMapCache
+
+} // namespace SBND
+
+#endif
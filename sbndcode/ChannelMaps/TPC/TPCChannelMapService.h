@@ -62,8 +62,32 @@ public:
 
   ChanInfo_t GetChanInfoFromOfflChan(unsigned int offlchan) const;
 
+  // Same lookup as GetChanInfoFromFEMElements, from the dense FEM index:
+  // pointer to the channel info, nullptr if femchan is not in the map.
+
+  ChanInfo_t const* FindChanInfoFromFEMElements(unsigned int femcrate,
+						unsigned int fem,
+						unsigned int femchan) const;
+
+  // Channel info of all the channels of one FEM: NFEMChannels() entries
+  // indexed by FEM channel (nullptr where not in the map), or nullptr if
+  // the FEM is not in the map.
+
+  ChanInfo_t const* const* GetFEMChanInfo(unsigned int femcrate, unsigned int fem) const;
+
+  unsigned int NFEMChannels() const { return fNFEMChannels; }
+
 private:
 
+  // channel map entries from the text file format, one per line
+  static std::vector<ChanInfo_t> ParseMapText(std::string const& text);
+
+  // fill the lookup maps (and the FEM index) from the map entries
+  void FillMaps(std::vector<ChanInfo_t> const& entries);
+
+  // fill fFEMIndex from fChanInfoFromFEMInfo
+  void BuildFEMIndex();
+
   // look up channel info by offline channel number
   
   std::unordered_map<unsigned int, ChanInfo_t> fChanInfoFromOfflChan;
@@ -74,9 +98,18 @@ private:
 		     std::unordered_map<unsigned int,
 					std::unordered_map< unsigned int, ChanInfo_t > > > fChanInfoFromFEMInfo;
 
+  // dense FEMCrate x FEM x FEMCh index of fChanInfoFromFEMInfo entries, with
+  // fNFEMCrates + 1 crate rows; crates not in the map (including all past the
+  // last one, which share the extra row) point to crate 1, as in the nested map lookup
+
+  unsigned int fNFEMCrates = 0;
+  unsigned int fNFEMs = 0;
+  unsigned int fNFEMChannels = 0;
+  std::vector<ChanInfo_t const*> fFEMIndex;
+
 };
 
 
-DECLARE_ART_SERVICE(SBND::TPCChannelMapService, LEGACY)
+DECLARE_ART_SERVICE(SBND::TPCChannelMapService, SHARED)
 
 #endif
@@ -11,8 +11,12 @@
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#include <algorithm>
+#include <iterator>
 
 #include "TPCChannelMapService.h"
+#include "TPCChannelMapCache.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
   
@@ -27,6 +31,7 @@ SBND::TPCChannelMapService::TPCChannelMapService(fhicl::ParameterSet const& pset
     throw cet::exception("SBND::TPCChannelMapService: UseHWDB and ReadMapFromFile are both false");
   }
   if (useFile) {
+    sbnd::startup::Span span("TPCChannelMapService::ReadMapFile");
     std::string channelMapFile = pset.get<std::string>("FileName");
 
     std::string fullname;
@@ -37,49 +42,27 @@ SBND::TPCChannelMapService::TPCChannelMapService(fhicl::ParameterSet const& pset
       std::cout << "SBND::TPCChannelMapService Input file " << channelMapFile << " not found" << std::endl;
       throw cet::exception("File not found");
     }
-    std::cout << "SBND TPC Channel Map: Building TPC wiremap from file " << channelMapFile << std::endl;
-    std::ifstream inFile(fullname, std::ios::in);
-    std::string line;
-
-    while (std::getline(inFile,line)) {
-      std::stringstream linestream(line);
-      std::string planestr;
-      std::string qfspstr;
-    
-      SBND::TPCChannelMapService::ChanInfo_t c;
-      linestream 
-	>> c.wireno
-	>> planestr
-	>> c.EastWest
-	>> c.NorthSouth
-	>> c.SideTop
-	>> c.FEMBPosition
-	>> c.FEMBSerialNum
-	>> c.FEMBOnWIB
-	>> c.FEMBCh
-	>> c.asic
-	>> c.WIBCrate
-	>> c.WIB
-	>> c.WIBCh 
-	>> qfspstr 
-	>> c.QFSPFiber 
-	>> c.FEMCrate
-	>> c.FEM
-	>> c.FEMCh
-	>> c.offlchan;
-
-      c.valid = true;
-      c.plane = 10;
-      if (planestr == "U") c.plane = 0;
-      if (planestr == "V") c.plane = 1;
-      if (planestr == "Y") c.plane = 2;
-      if (c.plane == 10) c.valid = false;
-      c.WIBQFSP = atoi(qfspstr.substr(3,1).c_str());
-
-      fChanInfoFromFEMInfo[c.FEMCrate][c.FEM][c.FEMCh] = c;
-      fChanInfoFromOfflChan[c.offlchan] = c;
-    }
+    std::ifstream inFile(fullname, std::ios::in | std::ios::binary);
+    std::string const text{ std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>() };
     inFile.close();
+
+    // a binary cache made from this same file skips the parsing
+    std::string const cacheFile = pset.get<std::string>("CacheFileName", "");
+    std::uint64_t const textChecksum = TPCChannelMapCache::Checksum(text.data(), text.size());
+    std::vector<ChanInfo_t> entries;
+    if (!cacheFile.empty() && TPCChannelMapCache::Read(cacheFile, textChecksum, entries)) {
+      std::cout << "SBND TPC Channel Map: Reading TPC wiremap for " << channelMapFile
+                << " from cache " << cacheFile << std::endl;
+    }
+    else {
+      std::cout << "SBND TPC Channel Map: Building TPC wiremap from file " << channelMapFile << std::endl;
+      entries = ParseMapText(text);
+      if (!cacheFile.empty() && !TPCChannelMapCache::Write(cacheFile, textChecksum, entries)) {
+        mf::LogWarning("TPCChannelMapService") << "Could not write the channel map cache " << cacheFile;
+      }
+    }
+
+    FillMaps(entries);
   }
   else
     {
@@ -87,10 +70,107 @@ SBND::TPCChannelMapService::TPCChannelMapService(fhicl::ParameterSet const& pset
     }
 }
 
+std::vector<SBND::TPCChannelMapService::ChanInfo_t> SBND::TPCChannelMapService::ParseMapText(std::string const& text) {
+
+  std::vector<ChanInfo_t> entries;
+  std::istringstream inText(text);
+  std::string line;
+
+  while (std::getline(inText,line)) {
+    std::stringstream linestream(line);
+    std::string planestr;
+    std::string qfspstr;
+  
+    SBND::TPCChannelMapService::ChanInfo_t c{};
+    linestream 
+      >> c.wireno
+      >> planestr
+      >> c.EastWest
+      >> c.NorthSouth
+      >> c.SideTop
+      >> c.FEMBPosition
+      >> c.FEMBSerialNum
+      >> c.FEMBOnWIB
+      >> c.FEMBCh
+      >> c.asic
+      >> c.WIBCrate
+      >> c.WIB
+      >> c.WIBCh 
+      >> qfspstr 
+      >> c.QFSPFiber 
+      >> c.FEMCrate
+      >> c.FEM
+      >> c.FEMCh
+      >> c.offlchan;
+
+    c.valid = true;
+    c.plane = 10;
+    if (planestr == "U") c.plane = 0;
+    if (planestr == "V") c.plane = 1;
+    if (planestr == "Y") c.plane = 2;
+    if (c.plane == 10) c.valid = false;
+    c.WIBQFSP = atoi(qfspstr.substr(3,1).c_str());
+
+    entries.push_back(std::move(c));
+  }
+  return entries;
+}
+
+void SBND::TPCChannelMapService::FillMaps(std::vector<ChanInfo_t> const& entries) {
+  for (auto const& c: entries) {
+    fChanInfoFromFEMInfo[c.FEMCrate][c.FEM][c.FEMCh] = c;
+    fChanInfoFromOfflChan[c.offlchan] = c;
+  }
+  BuildFEMIndex();
+}
+
 SBND::TPCChannelMapService::TPCChannelMapService(fhicl::ParameterSet const& pset, art::ActivityRegistry&) : SBND::TPCChannelMapService
 													    (pset) {
 }
 
+void SBND::TPCChannelMapService::BuildFEMIndex() {
+
+  // the map values are never moved once the map is filled, so the index can point to them
+  fNFEMCrates = fNFEMs = fNFEMChannels = 0;
+  for (auto const& crate: fChanInfoFromFEMInfo) {
+    fNFEMCrates = std::max(fNFEMCrates, crate.first + 1);
+    for (auto const& fem: crate.second) {
+      fNFEMs = std::max(fNFEMs, fem.first + 1);
+      for (auto const& chan: fem.second) fNFEMChannels = std::max(fNFEMChannels, chan.first + 1);
+    }
+  }
+
+  // one more crate row, for the crates past the last one in the map
+  unsigned int const substituteCrate = 1;  // a hack -- ununderstood crates get mapped to crate 1
+  fFEMIndex.assign((fNFEMCrates + 1) * fNFEMs * fNFEMChannels, nullptr);
+  for (unsigned int crate = 0; crate <= fNFEMCrates; ++crate) {
+    auto fm1 = fChanInfoFromFEMInfo.find(crate);
+    if (fm1 == fChanInfoFromFEMInfo.end()) fm1 = fChanInfoFromFEMInfo.find(substituteCrate);
+    if (fm1 == fChanInfoFromFEMInfo.end()) continue;
+    for (auto const& fem: fm1->second) {
+      for (auto const& chan: fem.second) {
+        fFEMIndex[(crate * fNFEMs + fem.first) * fNFEMChannels + chan.first] = &chan.second;
+      }
+    }
+  }
+}
+
+SBND::TPCChannelMapService::ChanInfo_t const* const* SBND::TPCChannelMapService::GetFEMChanInfo(unsigned int femcrate,
+													unsigned int fem) const {
+  // crates past the last one in the map use the extra row, which holds the substitute crate
+  if (femcrate > fNFEMCrates) femcrate = fNFEMCrates;
+  if (fem >= fNFEMs) return nullptr;
+  return fFEMIndex.data() + (femcrate * fNFEMs + fem) * fNFEMChannels;
+}
+
+SBND::TPCChannelMapService::ChanInfo_t const* SBND::TPCChannelMapService::FindChanInfoFromFEMElements(unsigned int femcrate,
+												     unsigned int fem,
+												     unsigned int femchan) const {
+  if (femchan >= fNFEMChannels) return nullptr;
+  ChanInfo_t const* const* femChans = GetFEMChanInfo(femcrate, fem);
+  return femChans ? femChans[femchan] : nullptr;
+}
+
 SBND::TPCChannelMapService::ChanInfo_t SBND::TPCChannelMapService::GetChanInfoFromFEMElements(unsigned int femcrate,
 											      unsigned int fem,
 											      unsigned int femchan) const {
@@ -98,24 +178,8 @@ SBND::TPCChannelMapService::ChanInfo_t SBND::TPCChannelMapService::GetChanInfoFr
   SBND::TPCChannelMapService::ChanInfo_t badinfo{};
   badinfo.valid = false;
 
-  // look up one map at a time in order to handle cases where the item is not found
-  // without throwing and catching exception which can make debugging hard
-  
-  auto fm1 = fChanInfoFromFEMInfo.find(femcrate);
-  if (fm1 == fChanInfoFromFEMInfo.end()) {
-    unsigned int substituteCrate = 1;  // a hack -- ununderstood crates get mapped to crate 1
-    fm1 = fChanInfoFromFEMInfo.find(substituteCrate);
-    if (fm1 == fChanInfoFromFEMInfo.end()) {
-      return badinfo;
-    }
-  }
-  auto& m1 = fm1->second;
-  auto fm2 = m1.find(fem);
-  if (fm2 == m1.end()) return badinfo;
-  auto& m2 = fm2->second;
-  auto fm3 = m2.find(femchan);
-  if (fm3 == m2.end()) return badinfo;    
-  return fm3->second;
+  ChanInfo_t const* info = FindChanInfoFromFEMElements(femcrate, fem, femchan);
+  return info ? *info : badinfo;
 }
 
 
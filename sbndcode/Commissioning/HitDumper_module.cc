@@ -53,6 +53,7 @@
 #include "sbnobj/SBND/Trigger/pmtTrigger.hh"
 #include "sbnobj/SBND/Trigger/pmtSoftwareTrigger.hh"
 #include "sbnobj/SBND/Trigger/CRTmetric.hh"
+#include "sbndcode/Utilities/AsyncTreeWriter.h"
 
 // Truth includes
 //#include "larsim/MCCheater/BackTrackerService.h"
@@ -125,6 +126,9 @@ public:
 
   // Called at the beginning of every subrun
   virtual void beginSubRun(art::SubRun const& sr) override;
+
+  // Writes the last event to the tree.
+  void endJob() override;
 private:
 
   /// Resets the variables that are saved to the TTree
@@ -165,6 +169,7 @@ private:
   opdet::sbndPDMapAlg _pd_map;
 
   TTree* fTree;
+  sbnd::AsyncTreeWriter fTreeWriter; ///< fills fTree, on a background thread with fAsyncFill
   //run information
   int _run;        ///< The run number
   int _subrun;     ///< The subrun number
@@ -407,6 +412,7 @@ private:
 
   // double fSelectedPDG;
 
+  bool fkeepHits;          ///< Keep the reco wire hits (to be set via fcl)
   bool fkeepCRThits;       ///< Keep the CRT hits (to be set via fcl)
   bool fkeepCRTstrips;     ///< Keep the CRT strips (to be set via fcl)
   bool fmakeCRTtracks;     ///< Make the CRT tracks (to be set via fcl)
@@ -424,11 +430,13 @@ private:
   bool fUncompressWithPed; ///< Uncompresses the waveforms if true (to be set via fcl)
   int fWindow;
   bool fSkipInd;           ///< If true, induction planes are not saved (to be set via fcl)
+  bool fAsyncFill;         ///< Fill the tree on a background thread (to be set via fcl)
+  unsigned int fCompressionThreads; ///< ROOT implicit MT threads compressing the tree with fAsyncFill; 0: ROOT default (to be set via fcl)
   // double fSelectedPDG;
 
   std::vector<int> fKeepTaggerTypes = {0, 1, 2, 3, 4, 5, 6}; ///< Taggers to keep (to be set via fcl)
 
-  sbnd::crt::CRTGeoAlg fCRTGeoAlg;
+  std::shared_ptr<const sbnd::crt::CRTGeoAlg> fCRTGeoAlg;
 
   geo::GeometryCore const* fGeometryService;
   // detinfo::ElecClock fTrigClock;
@@ -440,7 +448,7 @@ private:
 
 Hitdumper::Hitdumper(fhicl::ParameterSet const& pset)
   : EDAnalyzer(pset)
-  , fCRTGeoAlg(pset.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet()))
+  , fCRTGeoAlg(sbnd::crt::CRTGeoAlg::Shared(pset.get<fhicl::ParameterSet>("CRTGeoAlg", fhicl::ParameterSet())))
 {
 
   fGeometryService = lar::providerFrom<geo::Geometry>();
@@ -479,6 +487,7 @@ void Hitdumper::reconfigure(fhicl::ParameterSet const& p)
   fMCTrackModuleLabel    = p.get<std::string>("MCTrackModuleLabel ", "mcreco");
   fMCShowerModuleLabel    = p.get<std::string>("MCShowerModuleLabel ", "mcreco");
 
+  fkeepHits          = p.get<bool>("keepHits",true);
   fkeepCRThits       = p.get<bool>("keepCRThits",true);
   fkeepCRTstrips     = p.get<bool>("keepCRTstrips",false);
   fmakeCRTtracks     = p.get<bool>("makeCRTtracks",true);
@@ -499,6 +508,9 @@ void Hitdumper::reconfigure(fhicl::ParameterSet const& p)
   fKeepTaggerTypes   = p.get<std::vector<int>>("KeepTaggerTypes");
 
   fSkipInd           = p.get<bool>("SkipInduction",false);
+
+  fAsyncFill          = p.get<bool>("AsyncFill",false);
+  fCompressionThreads = p.get<unsigned int>("CompressionThreads",0);
 }
 
 
@@ -525,7 +537,8 @@ void Hitdumper::analyze(const art::Event& evt)
   //
   art::Handle<std::vector<recob::Hit>> hitListHandle;
   std::vector<art::Ptr<recob::Hit>> hitlist;
-  if (evt.getByLabel(fHitsModuleLabel,hitListHandle)) {
+  _nhits = 0;
+  if (fkeepHits && evt.getByLabel(fHitsModuleLabel,hitListHandle)) {
     art::fill_ptr_vector(hitlist, hitListHandle);
     _nhits = hitlist.size();
 
@@ -539,9 +552,8 @@ void Hitdumper::analyze(const art::Event& evt)
       }
     }
   }
-  else {
+  else if (fkeepHits) {
     std::cout << "Failed to get recob::Hit data product." << std::endl;
-    _nhits = 0;
   }
 
   if (_nhits > _max_hits) {
@@ -581,10 +593,12 @@ void Hitdumper::analyze(const art::Event& evt)
   std::vector<art::Ptr<sbnd::crt::CRTData> > striplist;
   // art::Handle< std::vector<sbnd::crt::CRTData> > crtStripListHandle;
   // std::vector< art::Ptr<sbnd::crt::CRTData> > striplist;
-  if (evt.getByLabel(fCRTStripModuleLabel, crtStripListHandle))  {
+  // Strips are only needed if they are saved or used to make the custom tracks
+  const bool needCRTstrips = fkeepCRTstrips || fmakeCRTtracks;
+  if (needCRTstrips && evt.getByLabel(fCRTStripModuleLabel, crtStripListHandle))  {
     art::fill_ptr_vector(striplist, crtStripListHandle);
     _nstr = striplist.size();
-  } else {
+  } else if (needCRTstrips) {
     std::cout << "Failed to get sbnd::crt::CRTData data product." << std::endl;
   }
 
@@ -597,8 +611,8 @@ void Hitdumper::analyze(const art::Event& evt)
   for (int i = 0; i < _nstr; i += 2){
     uint32_t chan = striplist[i]->Channel();
 
-    std::string taggerName  = fCRTGeoAlg.ChannelToTaggerName(chan);
-    sbnd::crt::CRTTagger ip = fCRTGeoAlg.ChannelToTaggerEnum(chan);
+    std::string taggerName  = fCRTGeoAlg->ChannelToTaggerName(chan);
+    sbnd::crt::CRTTagger ip = fCRTGeoAlg->ChannelToTaggerEnum(chan);
 
     bool keep_tagger = false;
     for (auto t : fKeepTaggerTypes) {
@@ -626,7 +640,7 @@ void Hitdumper::analyze(const art::Event& evt)
         //
         std::string name = fGeometryService->AuxDet(module).TotalVolume()->GetName();
         auto const center = fAuxDetGeoCore->AuxDetChannelToPosition(name, 2*strip);
-	size_t orien = fCRTGeoAlg.ChannelToOrientation(chan);
+	size_t orien = fCRTGeoAlg->ChannelToOrientation(chan);
 
         _crt_plane.push_back(ip);
         _crt_module.push_back(module);
@@ -1339,7 +1353,7 @@ void Hitdumper::analyze(const art::Event& evt)
 
 
 
-  fTree->Fill();
+  fTreeWriter.Fill();
 
 }
 
@@ -1348,217 +1362,223 @@ void Hitdumper::analyze(const art::Event& evt)
   // Implementation of optional member function here.
   art::ServiceHandle<art::TFileService> tfs;
   fTree = tfs->make<TTree>("hitdumpertree","analysis tree");
-  fTree->Branch("run",&_run,"run/I");
-  fTree->Branch("subrun",&_subrun,"subrun/I");
-  fTree->Branch("event",&_event,"event/I");
-  fTree->Branch("evttime",&_evttime,"evttime/D");
-  fTree->Branch("t0",&_t0,"t0/I");
-
-  fTree->Branch("nhits", &_nhits, "nhits/I");
-  fTree->Branch("hit_cryostat", &_hit_cryostat);
-  fTree->Branch("hit_tpc", &_hit_tpc);
-  fTree->Branch("hit_plane", &_hit_plane);
-  fTree->Branch("hit_wire", &_hit_wire);
-  fTree->Branch("hit_channel", &_hit_channel);
-  fTree->Branch("hit_peakT", &_hit_peakT);
-  fTree->Branch("hit_charge", &_hit_charge);
-  fTree->Branch("hit_ph", &_hit_ph);
-  fTree->Branch("hit_width", &_hit_width);
-  fTree->Branch("hit_full_integral", &_hit_full_integral);
+  // with fAsyncFill the branches are on copies of the variables, which are
+  // written while the next event is processed
+  fTreeWriter.Setup(fTree, fAsyncFill);
+  if (fAsyncFill) fTreeWriter.EnableImplicitMT(fCompressionThreads);
+  fTreeWriter.Branch("run",&_run,"run/I");
+  fTreeWriter.Branch("subrun",&_subrun,"subrun/I");
+  fTreeWriter.Branch("event",&_event,"event/I");
+  fTreeWriter.Branch("evttime",&_evttime,"evttime/D");
+  fTreeWriter.Branch("t0",&_t0,"t0/I");
+
+  if (fkeepHits) {
+    fTreeWriter.Branch("nhits", &_nhits, "nhits/I");
+    fTreeWriter.Branch("hit_cryostat", &_hit_cryostat);
+    fTreeWriter.Branch("hit_tpc", &_hit_tpc);
+    fTreeWriter.Branch("hit_plane", &_hit_plane);
+    fTreeWriter.Branch("hit_wire", &_hit_wire);
+    fTreeWriter.Branch("hit_channel", &_hit_channel);
+    fTreeWriter.Branch("hit_peakT", &_hit_peakT);
+    fTreeWriter.Branch("hit_charge", &_hit_charge);
+    fTreeWriter.Branch("hit_ph", &_hit_ph);
+    fTreeWriter.Branch("hit_width", &_hit_width);
+    fTreeWriter.Branch("hit_full_integral", &_hit_full_integral);
+  }
 
   if (fcheckTransparency) {
-    fTree->Branch("adc_count", &_adc_count,"adc_count/I");
-    fTree->Branch("waveform_number", &_waveform_number);
-    fTree->Branch("time_for_waveform",&_time_for_waveform);
-    fTree->Branch("adc_on_wire", &_adc_on_wire);
-    fTree->Branch("waveform_integral", &_waveform_integral);
-    fTree->Branch("adc_count_in_waveform", &_adc_count_in_waveform);
+    fTreeWriter.Branch("adc_count", &_adc_count,"adc_count/I");
+    fTreeWriter.Branch("waveform_number", &_waveform_number);
+    fTreeWriter.Branch("time_for_waveform",&_time_for_waveform);
+    fTreeWriter.Branch("adc_on_wire", &_adc_on_wire);
+    fTreeWriter.Branch("waveform_integral", &_waveform_integral);
+    fTreeWriter.Branch("adc_count_in_waveform", &_adc_count_in_waveform);
   }
 
   if (fkeepCRTstrips) {
-    fTree->Branch("nstrips", &_nstrips, "nstrips/I");
-    fTree->Branch("crt_plane", &_crt_plane);
-    fTree->Branch("crt_module", &_crt_module);
-    fTree->Branch("crt_strip", &_crt_strip);
-    fTree->Branch("crt_orient", &_crt_orient);
-    fTree->Branch("crt_time", &_crt_time);
-    fTree->Branch("crt_adc", &_crt_adc);
-    fTree->Branch("crt_pos_x", &_crt_pos_x);
-    fTree->Branch("crt_pos_y", &_crt_pos_y);
-    fTree->Branch("crt_pos_z", &_crt_pos_z);
+    fTreeWriter.Branch("nstrips", &_nstrips, "nstrips/I");
+    fTreeWriter.Branch("crt_plane", &_crt_plane);
+    fTreeWriter.Branch("crt_module", &_crt_module);
+    fTreeWriter.Branch("crt_strip", &_crt_strip);
+    fTreeWriter.Branch("crt_orient", &_crt_orient);
+    fTreeWriter.Branch("crt_time", &_crt_time);
+    fTreeWriter.Branch("crt_adc", &_crt_adc);
+    fTreeWriter.Branch("crt_pos_x", &_crt_pos_x);
+    fTreeWriter.Branch("crt_pos_y", &_crt_pos_y);
+    fTreeWriter.Branch("crt_pos_z", &_crt_pos_z);
   }
 
   if (fmakeCRTtracks) {
-    fTree->Branch("nctrks", &_nctrks, "nctrks/I");
-    fTree->Branch("ctrk_x1", &_ctrk_x1);
-    fTree->Branch("ctrk_y1", &_ctrk_y1);
-    fTree->Branch("ctrk_z1", &_ctrk_z1);
-    fTree->Branch("ctrk_t1", &_ctrk_t1);
-    fTree->Branch("ctrk_adc1", &_ctrk_adc1);
-    fTree->Branch("ctrk_mod1x", &_ctrk_mod1x);
-    fTree->Branch("ctrk_x2", &_ctrk_x2);
-    fTree->Branch("ctrk_y2", &_ctrk_y2);
-    fTree->Branch("ctrk_z2", &_ctrk_z2);
-    fTree->Branch("ctrk_t2", &_ctrk_t2);
-    fTree->Branch("ctrk_adc2", &_ctrk_adc2);
-    fTree->Branch("ctrk_mod2x", &_ctrk_mod2x);
+    fTreeWriter.Branch("nctrks", &_nctrks, "nctrks/I");
+    fTreeWriter.Branch("ctrk_x1", &_ctrk_x1);
+    fTreeWriter.Branch("ctrk_y1", &_ctrk_y1);
+    fTreeWriter.Branch("ctrk_z1", &_ctrk_z1);
+    fTreeWriter.Branch("ctrk_t1", &_ctrk_t1);
+    fTreeWriter.Branch("ctrk_adc1", &_ctrk_adc1);
+    fTreeWriter.Branch("ctrk_mod1x", &_ctrk_mod1x);
+    fTreeWriter.Branch("ctrk_x2", &_ctrk_x2);
+    fTreeWriter.Branch("ctrk_y2", &_ctrk_y2);
+    fTreeWriter.Branch("ctrk_z2", &_ctrk_z2);
+    fTreeWriter.Branch("ctrk_t2", &_ctrk_t2);
+    fTreeWriter.Branch("ctrk_adc2", &_ctrk_adc2);
+    fTreeWriter.Branch("ctrk_mod2x", &_ctrk_mod2x);
   }
   if (fkeepCRThits) {
-    fTree->Branch("nchits", &_nchits, "nchits/I");
-    fTree->Branch("chit_x", &_chit_x);
-    fTree->Branch("chit_y", &_chit_y);
-    fTree->Branch("chit_z", &_chit_z);
-    fTree->Branch("chit_time", &_chit_time);
-    fTree->Branch("chit_plane", &_chit_plane);
+    fTreeWriter.Branch("nchits", &_nchits, "nchits/I");
+    fTreeWriter.Branch("chit_x", &_chit_x);
+    fTreeWriter.Branch("chit_y", &_chit_y);
+    fTreeWriter.Branch("chit_z", &_chit_z);
+    fTreeWriter.Branch("chit_time", &_chit_time);
+    fTreeWriter.Branch("chit_plane", &_chit_plane);
   }
   if (freadCRTtracks) {
-    fTree->Branch("ncts", &_ncts, "ncts/I");
-    fTree->Branch("ct_x1", &_ct_x1);
-    fTree->Branch("ct_y1", &_ct_y1);
-    fTree->Branch("ct_z1", &_ct_z1);
-    fTree->Branch("ct_x2", &_ct_x2);
-    fTree->Branch("ct_y2", &_ct_y2);
-    fTree->Branch("ct_z2", &_ct_z2);
-    fTree->Branch("ct_time", &_ct_time);
-    fTree->Branch("ct_pes", &_ct_pes);
+    fTreeWriter.Branch("ncts", &_ncts, "ncts/I");
+    fTreeWriter.Branch("ct_x1", &_ct_x1);
+    fTreeWriter.Branch("ct_y1", &_ct_y1);
+    fTreeWriter.Branch("ct_z1", &_ct_z1);
+    fTreeWriter.Branch("ct_x2", &_ct_x2);
+    fTreeWriter.Branch("ct_y2", &_ct_y2);
+    fTreeWriter.Branch("ct_z2", &_ct_z2);
+    fTreeWriter.Branch("ct_time", &_ct_time);
+    fTreeWriter.Branch("ct_pes", &_ct_pes);
   }
 
   if (freadOpHits) {
-    fTree->Branch("nophits", &_nophits, "nophits/I");
-    fTree->Branch("ophit_opch", &_ophit_opch);
-    fTree->Branch("ophit_opdet", &_ophit_opdet);
-    fTree->Branch("ophit_peakT", &_ophit_peakT);
-    fTree->Branch("ophit_startT", &_ophit_startT);
-    fTree->Branch("ophit_riseT", &_ophit_riseT);
-    fTree->Branch("ophit_width", &_ophit_width);
-    fTree->Branch("ophit_area", &_ophit_area);
-    fTree->Branch("ophit_amplitude", &_ophit_amplitude);
-    fTree->Branch("ophit_pe", &_ophit_pe);
-    fTree->Branch("ophit_opdet_x", &_ophit_opdet_x);
-    fTree->Branch("ophit_opdet_y", &_ophit_opdet_y);
-    fTree->Branch("ophit_opdet_z", &_ophit_opdet_z);
-    fTree->Branch("ophit_opdet_type", &_ophit_opdet_type);
+    fTreeWriter.Branch("nophits", &_nophits, "nophits/I");
+    fTreeWriter.Branch("ophit_opch", &_ophit_opch);
+    fTreeWriter.Branch("ophit_opdet", &_ophit_opdet);
+    fTreeWriter.Branch("ophit_peakT", &_ophit_peakT);
+    fTreeWriter.Branch("ophit_startT", &_ophit_startT);
+    fTreeWriter.Branch("ophit_riseT", &_ophit_riseT);
+    fTreeWriter.Branch("ophit_width", &_ophit_width);
+    fTreeWriter.Branch("ophit_area", &_ophit_area);
+    fTreeWriter.Branch("ophit_amplitude", &_ophit_amplitude);
+    fTreeWriter.Branch("ophit_pe", &_ophit_pe);
+    fTreeWriter.Branch("ophit_opdet_x", &_ophit_opdet_x);
+    fTreeWriter.Branch("ophit_opdet_y", &_ophit_opdet_y);
+    fTreeWriter.Branch("ophit_opdet_z", &_ophit_opdet_z);
+    fTreeWriter.Branch("ophit_opdet_type", &_ophit_opdet_type);
   }
 
   if (freadpmtTrigger){
-    fTree->Branch("pmtTrigger_npmtshigh", &_pmtTrigger_npmtshigh);
-    fTree->Branch("pmtTrigger_maxpassed", &_pmtTrigger_maxpassed, "pmtTrigger_maxpassed/I");
+    fTreeWriter.Branch("pmtTrigger_npmtshigh", &_pmtTrigger_npmtshigh);
+    fTreeWriter.Branch("pmtTrigger_maxpassed", &_pmtTrigger_maxpassed, "pmtTrigger_maxpassed/I");
   }
 
   if (freadpmtSoftTrigger){
-    fTree->Branch("pmtSoftTrigger_foundBeamTrigger", &_pmtSoftTrigger_foundBeamTrigger);
-    fTree->Branch("pmtSoftTrigger_tts", &_pmtSoftTrigger_tts);
-    fTree->Branch("pmtSoftTrigger_promptPE", &_pmtSoftTrigger_promptPE);
-    fTree->Branch("pmtSoftTrigger_prelimPE", &_pmtSoftTrigger_prelimPE);
-    fTree->Branch("pmtSoftTrigger_nAboveThreshold", &_pmtSoftTrigger_nAboveThreshold);
-    // fTree->Branch("pmtSoftTrigger_", &_pmtSoftTigger_)
+    fTreeWriter.Branch("pmtSoftTrigger_foundBeamTrigger", &_pmtSoftTrigger_foundBeamTrigger);
+    fTreeWriter.Branch("pmtSoftTrigger_tts", &_pmtSoftTrigger_tts);
+    fTreeWriter.Branch("pmtSoftTrigger_promptPE", &_pmtSoftTrigger_promptPE);
+    fTreeWriter.Branch("pmtSoftTrigger_prelimPE", &_pmtSoftTrigger_prelimPE);
+    fTreeWriter.Branch("pmtSoftTrigger_nAboveThreshold", &_pmtSoftTrigger_nAboveThreshold);
+    // fTreeWriter.Branch("pmtSoftTrigger_", &_pmtSoftTigger_)
   }
 
   if (freadcrtSoftTrigger){
-    fTree->Branch("crtSoftTrigger_hitsperplane", &_crtSoftTrigger_hitsperplane,"crtSoftTrigger_hitsperplane[7]/I");
+    fTreeWriter.Branch("crtSoftTrigger_hitsperplane", &_crtSoftTrigger_hitsperplane,"crtSoftTrigger_hitsperplane[7]/I");
   }
 
   if (freadMuonTracks) {
-    fTree->Branch("nmuontrks", &_nmuontrks, "nmuontrks/I");
-    fTree->Branch("muontrk_t0", &_muontrk_t0);
-    fTree->Branch("muontrk_x1", &_muontrk_x1);
-    fTree->Branch("muontrk_y1", &_muontrk_y1);
-    fTree->Branch("muontrk_z1", &_muontrk_z1);
-    fTree->Branch("muontrk_x2", &_muontrk_x2);
-    fTree->Branch("muontrk_y2", &_muontrk_y2);
-    fTree->Branch("muontrk_z2", &_muontrk_z2);
-    fTree->Branch("muontrk_theta_xz", &_muontrk_theta_xz);
-    fTree->Branch("muontrk_theta_yz", &_muontrk_theta_yz);
-    fTree->Branch("muontrk_tpc", &_muontrk_tpc); 
-    fTree->Branch("muontrk_type", &_muontrk_type); 
+    fTreeWriter.Branch("nmuontrks", &_nmuontrks, "nmuontrks/I");
+    fTreeWriter.Branch("muontrk_t0", &_muontrk_t0);
+    fTreeWriter.Branch("muontrk_x1", &_muontrk_x1);
+    fTreeWriter.Branch("muontrk_y1", &_muontrk_y1);
+    fTreeWriter.Branch("muontrk_z1", &_muontrk_z1);
+    fTreeWriter.Branch("muontrk_x2", &_muontrk_x2);
+    fTreeWriter.Branch("muontrk_y2", &_muontrk_y2);
+    fTreeWriter.Branch("muontrk_z2", &_muontrk_z2);
+    fTreeWriter.Branch("muontrk_theta_xz", &_muontrk_theta_xz);
+    fTreeWriter.Branch("muontrk_theta_yz", &_muontrk_theta_yz);
+    fTreeWriter.Branch("muontrk_tpc", &_muontrk_tpc); 
+    fTreeWriter.Branch("muontrk_type", &_muontrk_type); 
   }
 
     if (freadMuonHits) {
-    fTree->Branch("nmhits", &_nmhits, "nmhits/I");
-    fTree->Branch("mhit_trk", &_mhit_trk);
-    fTree->Branch("mhit_tpc", &_mhit_tpc);
-    fTree->Branch("mhit_wire", &_mhit_wire); 
-    fTree->Branch("mhit_channel", &_mhit_channel);
-    fTree->Branch("mhit_peakT", &_mhit_peakT);
-    fTree->Branch("mhit_charge", &_mhit_charge); 
+    fTreeWriter.Branch("nmhits", &_nmhits, "nmhits/I");
+    fTreeWriter.Branch("mhit_trk", &_mhit_trk);
+    fTreeWriter.Branch("mhit_tpc", &_mhit_tpc);
+    fTreeWriter.Branch("mhit_wire", &_mhit_wire); 
+    fTreeWriter.Branch("mhit_channel", &_mhit_channel);
+    fTreeWriter.Branch("mhit_peakT", &_mhit_peakT);
+    fTreeWriter.Branch("mhit_charge", &_mhit_charge); 
   }
 
   if (freadTruth) {
-    fTree->Branch("mcevts_truth",&mcevts_truth,"mcevts_truth/I");
-    fTree->Branch("nuScatterCode_truth",&nuScatterCode_truth);
-    fTree->Branch("nuID_truth",&nuID_truth);
-    fTree->Branch("nuPDG_truth",&nuPDG_truth);
-    fTree->Branch("ccnc_truth",&ccnc_truth);
-    fTree->Branch("mode_truth",&mode_truth);
-    fTree->Branch("enu_truth",&enu_truth);
-    fTree->Branch("Q2_truth",&Q2_truth);
-    fTree->Branch("W_truth",&W_truth);
-    fTree->Branch("hitnuc_truth",&hitnuc_truth);
-    fTree->Branch("nuvtxx_truth",&nuvtxx_truth);
-    fTree->Branch("nuvtxy_truth",&nuvtxy_truth);
-    fTree->Branch("nuvtxz_truth",&nuvtxz_truth);
-    fTree->Branch("nu_dcosx_truth",&nu_dcosx_truth);
-    fTree->Branch("nu_dcosy_truth",&nu_dcosy_truth);
-    fTree->Branch("nu_dcosz_truth",&nu_dcosz_truth);
-    fTree->Branch("lep_mom_truth",&lep_mom_truth);
-    fTree->Branch("lep_dcosx_truth",&lep_dcosx_truth);
-    fTree->Branch("lep_dcosy_truth",&lep_dcosy_truth);
-    fTree->Branch("lep_dcosz_truth",&lep_dcosz_truth);
-
-    fTree->Branch("tpx_flux",&tpx_flux);
-    fTree->Branch("tpy_flux",&tpy_flux);
-    fTree->Branch("tpz_flux",&tpz_flux);
-    fTree->Branch("tptype_flux",&tptype_flux);
-
-    fTree->Branch("genie_no_primaries",&genie_no_primaries);
-    fTree->Branch("genie_primaries_pdg",&genie_primaries_pdg);
-    fTree->Branch("genie_Eng",&genie_Eng);
-    fTree->Branch("genie_Px",&genie_Px);
-    fTree->Branch("genie_Py",&genie_Py);
-    fTree->Branch("genie_Pz",&genie_Pz);
-    fTree->Branch("genie_P",&genie_P);
-    fTree->Branch("genie_status_code",&genie_status_code);
-    fTree->Branch("genie_mass",&genie_mass);
-    fTree->Branch("genie_trackID",&genie_trackID);
-    fTree->Branch("genie_ND",&genie_ND);
-    fTree->Branch("genie_mother",&genie_mother);
+    fTreeWriter.Branch("mcevts_truth",&mcevts_truth,"mcevts_truth/I");
+    fTreeWriter.Branch("nuScatterCode_truth",&nuScatterCode_truth);
+    fTreeWriter.Branch("nuID_truth",&nuID_truth);
+    fTreeWriter.Branch("nuPDG_truth",&nuPDG_truth);
+    fTreeWriter.Branch("ccnc_truth",&ccnc_truth);
+    fTreeWriter.Branch("mode_truth",&mode_truth);
+    fTreeWriter.Branch("enu_truth",&enu_truth);
+    fTreeWriter.Branch("Q2_truth",&Q2_truth);
+    fTreeWriter.Branch("W_truth",&W_truth);
+    fTreeWriter.Branch("hitnuc_truth",&hitnuc_truth);
+    fTreeWriter.Branch("nuvtxx_truth",&nuvtxx_truth);
+    fTreeWriter.Branch("nuvtxy_truth",&nuvtxy_truth);
+    fTreeWriter.Branch("nuvtxz_truth",&nuvtxz_truth);
+    fTreeWriter.Branch("nu_dcosx_truth",&nu_dcosx_truth);
+    fTreeWriter.Branch("nu_dcosy_truth",&nu_dcosy_truth);
+    fTreeWriter.Branch("nu_dcosz_truth",&nu_dcosz_truth);
+    fTreeWriter.Branch("lep_mom_truth",&lep_mom_truth);
+    fTreeWriter.Branch("lep_dcosx_truth",&lep_dcosx_truth);
+    fTreeWriter.Branch("lep_dcosy_truth",&lep_dcosy_truth);
+    fTreeWriter.Branch("lep_dcosz_truth",&lep_dcosz_truth);
+
+    fTreeWriter.Branch("tpx_flux",&tpx_flux);
+    fTreeWriter.Branch("tpy_flux",&tpy_flux);
+    fTreeWriter.Branch("tpz_flux",&tpz_flux);
+    fTreeWriter.Branch("tptype_flux",&tptype_flux);
+
+    fTreeWriter.Branch("genie_no_primaries",&genie_no_primaries);
+    fTreeWriter.Branch("genie_primaries_pdg",&genie_primaries_pdg);
+    fTreeWriter.Branch("genie_Eng",&genie_Eng);
+    fTreeWriter.Branch("genie_Px",&genie_Px);
+    fTreeWriter.Branch("genie_Py",&genie_Py);
+    fTreeWriter.Branch("genie_Pz",&genie_Pz);
+    fTreeWriter.Branch("genie_P",&genie_P);
+    fTreeWriter.Branch("genie_status_code",&genie_status_code);
+    fTreeWriter.Branch("genie_mass",&genie_mass);
+    fTreeWriter.Branch("genie_trackID",&genie_trackID);
+    fTreeWriter.Branch("genie_ND",&genie_ND);
+    fTreeWriter.Branch("genie_mother",&genie_mother);
   }
   if (freadMCParticle){
     //MCParticle
-    fTree->Branch("mcpart_pdg",&mcpart_pdg);
-    fTree->Branch("mcpart_status",&mcpart_status);    
-    fTree->Branch("mcpart_process",&mcpart_process);  
-    fTree->Branch("mcpart_endprocess",&mcpart_endprocess);  
-    fTree->Branch("mcpart_Eng",&mcpart_Eng);
-    fTree->Branch("mcpart_EndE",&mcpart_EndE);
-    fTree->Branch("mcpart_Mass",&mcpart_Mass);
-    fTree->Branch("mcpart_Px",&mcpart_Px);
-    fTree->Branch("mcpart_Py",&mcpart_Py);
-    fTree->Branch("mcpart_Pz",&mcpart_Pz);
-    fTree->Branch("mcpart_P",&mcpart_P);
-    fTree->Branch("mcpart_StartPointx",&mcpart_StartPointx);
-    fTree->Branch("mcpart_StartPointy",&mcpart_StartPointy);
-    fTree->Branch("mcpart_StartPointz",&mcpart_StartPointz);
-    fTree->Branch("mcpart_StartT",&mcpart_StartT);
-    fTree->Branch("mcpart_EndT",&mcpart_EndT);
-    fTree->Branch("mcpart_EndPointx",&mcpart_EndPointx);
-    fTree->Branch("mcpart_EndPointy",&mcpart_EndPointy);
-    fTree->Branch("mcpart_EndPointz",&mcpart_EndPointz);         
-    fTree->Branch("mcpart_theta_xz",&mcpart_theta_xz);
-    fTree->Branch("mcpart_theta_yz",&mcpart_theta_yz);   
-    fTree->Branch("mcpart_NumberDaughters",&mcpart_NumberDaughters);
-    fTree->Branch("mcpart_TrackId",&mcpart_TrackId);
-    fTree->Branch("mcpart_Mother",&mcpart_Mother);
+    fTreeWriter.Branch("mcpart_pdg",&mcpart_pdg);
+    fTreeWriter.Branch("mcpart_status",&mcpart_status);    
+    fTreeWriter.Branch("mcpart_process",&mcpart_process);  
+    fTreeWriter.Branch("mcpart_endprocess",&mcpart_endprocess);  
+    fTreeWriter.Branch("mcpart_Eng",&mcpart_Eng);
+    fTreeWriter.Branch("mcpart_EndE",&mcpart_EndE);
+    fTreeWriter.Branch("mcpart_Mass",&mcpart_Mass);
+    fTreeWriter.Branch("mcpart_Px",&mcpart_Px);
+    fTreeWriter.Branch("mcpart_Py",&mcpart_Py);
+    fTreeWriter.Branch("mcpart_Pz",&mcpart_Pz);
+    fTreeWriter.Branch("mcpart_P",&mcpart_P);
+    fTreeWriter.Branch("mcpart_StartPointx",&mcpart_StartPointx);
+    fTreeWriter.Branch("mcpart_StartPointy",&mcpart_StartPointy);
+    fTreeWriter.Branch("mcpart_StartPointz",&mcpart_StartPointz);
+    fTreeWriter.Branch("mcpart_StartT",&mcpart_StartT);
+    fTreeWriter.Branch("mcpart_EndT",&mcpart_EndT);
+    fTreeWriter.Branch("mcpart_EndPointx",&mcpart_EndPointx);
+    fTreeWriter.Branch("mcpart_EndPointy",&mcpart_EndPointy);
+    fTreeWriter.Branch("mcpart_EndPointz",&mcpart_EndPointz);         
+    fTreeWriter.Branch("mcpart_theta_xz",&mcpart_theta_xz);
+    fTreeWriter.Branch("mcpart_theta_yz",&mcpart_theta_yz);   
+    fTreeWriter.Branch("mcpart_NumberDaughters",&mcpart_NumberDaughters);
+    fTreeWriter.Branch("mcpart_TrackId",&mcpart_TrackId);
+    fTreeWriter.Branch("mcpart_Mother",&mcpart_Mother);
 
     //MCTrack info
-    fTree->Branch("mctrack_no_primaries",&mctrack_no_primaries);
-    fTree->Branch("mctrack_pdg",&mctrack_pdg);                        
-    fTree->Branch("mctrack_TrackId",&mctrack_TrackId);
+    fTreeWriter.Branch("mctrack_no_primaries",&mctrack_no_primaries);
+    fTreeWriter.Branch("mctrack_pdg",&mctrack_pdg);                        
+    fTreeWriter.Branch("mctrack_TrackId",&mctrack_TrackId);
 
     //MCShower info
-    fTree->Branch("mcshower_no_primaries",&mcshower_no_primaries);
-    fTree->Branch("mcshower_pdg",&mcshower_pdg);                        
-    fTree->Branch("mcshower_TrackId",&mcshower_TrackId);
+    fTreeWriter.Branch("mcshower_no_primaries",&mcshower_no_primaries);
+    fTreeWriter.Branch("mcshower_pdg",&mcshower_pdg);                        
+    fTreeWriter.Branch("mcshower_TrackId",&mcshower_TrackId);
   }
 
   if (fsavePOTInfo) {
@@ -1855,10 +1875,17 @@ void Hitdumper::beginSubRun(art::SubRun const& sr) {
     _sr_pot = 0.;
   }
 
+  // the event tree may be being written into the same file
+  fTreeWriter.Wait();
   _sr_tree->Fill();
 
 }
 
+void Hitdumper::endJob()
+{
+  fTreeWriter.Finish();
+}
+
 DEFINE_ART_MODULE(Hitdumper)
 
 #endif // Hitdumper_Module
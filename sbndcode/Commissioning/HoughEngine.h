@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////
+// File:        HoughEngine.h
+//
+// Probabilistic Hough transform used by the MuonTrackProducer to find
+// straight muon tracks among the (wire, peak time) hits of one plane.
+//
+// An engine owns its accumulator and its sin/cos tables, so it can be
+// reused from event to event without reallocating the 5501x180 bins.
+// Every vote is withdrawn before Transform returns, which leaves the
+// accumulator empty for the next call. Engines share no state, so
+// several planes can be transformed concurrently, one engine each.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_COMMISSIONING_HOUGHENGINE_H
+#define SBND_COMMISSIONING_HOUGHENGINE_H
+
+// ROOT includes
+#include "TRandom3.h"
+
+// C++ includes
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace sbnd {
+namespace comm {
+
+struct HoughHit {
+   int wire;   // hit wire
+   int peakT;  // hit peak time
+   int idx;    // index of the hit in the event hit list
+};
+
+struct HoughParam {
+   int threshold;   // threshold to pass in Hough accumulator
+   int max_gap;     // maximum gap between last identified point on line and data point
+   int range;       // range between expected value for point on line and actual
+   int min_length;  // minimum length of track, only used if muon_length == 0
+   int muon_length; // minimum change in peak time
+};
+
+class HoughEngine {
+public:
+   HoughEngine()
+      : fAccu(kAccuH*kAccuW, 0)
+   {
+      for (int j=0; j<kAccuW; j++){
+         fCos[j] = std::cos(j*M_PI/kAccuW);
+         fSin[j] = std::sin(j*M_PI/kAccuW);
+      }
+   }
+
+   // Finds the lines among the hits and appends them to lines as
+   // {x0, y0, x1, y1, hit0, hit1, idx0, idx1, rho, theta}; when save_hits
+   // is set, the indices of the hits on each line are appended to hit_idx
+   void Transform(const std::vector<HoughHit>& hits, const HoughParam& param, bool save_hits,
+                  std::vector<std::vector<int>>& lines, std::vector<std::vector<int>>& hit_idx);
+
+private:
+   static constexpr int kH = 3500, kW = 2000; // range of hit_wire
+   static constexpr int kAccuH = kH + kW + 1, kAccuW = 180;
+   static constexpr int kXc = kW/2, kYc = kH/2;
+   static constexpr int kAccuOffset = (kAccuH-1)/2; // lets rho be negative
+
+   // with 180 angle bins, an angle in degrees is also its bin index
+   int Rho(int x, int y, int j) const { return int(std::round((x-kXc)*fCos[j] + (y-kYc)*fSin[j])); }
+   int YOnLine(int x, int rho, int theta) const { return int(std::round((rho - (x - kXc)*fCos[theta])/fSin[theta] + kYc)); }
+   int& Bin(int r, int j) { return fAccu[(r + kAccuOffset)*kAccuW + j]; }
+
+   // withdraws all the votes of a point
+   void Unvote(int x, int y) { for (int m=0; m<kAccuW; m++) Bin(Rho(x, y, m), m)--; }
+
+   std::vector<int> fAccu;
+   std::array<double, kAccuW> fCos, fSin;
+
+   // per-call scratch, kept to avoid reallocation
+   std::vector<char> fVoteRemoved; // point no longer eligible to vote (the "coords" set)
+   std::vector<char> fLineRemoved; // point already assigned to a line (the "data" set)
+   std::vector<std::array<int, 2>> fDeaccu; // points whose votes are in the accumulator
+   std::vector<std::vector<int>> fOutlines, fOuthitIdx;
+};
+
+inline void HoughEngine::Transform(const std::vector<HoughHit>& hits, const HoughParam& param, bool save_hits,
+                                   std::vector<std::vector<int>>& lines, std::vector<std::vector<int>>& hit_idx){
+   const int threshold = param.threshold;
+   const int max_gap = param.max_gap;
+   const int range = param.range;
+   const int min_length = param.min_length;
+   const int muon_length = param.muon_length;
+
+   TRandom3 rndgen;
+
+   const int nhits = hits.size();
+   fVoteRemoved.assign(nhits, 0);
+   fLineRemoved.assign(nhits, 0);
+   fDeaccu.clear();
+   fOutlines.clear();
+   fOuthitIdx.clear();
+
+   // loop over points and perform transform
+   int count = nhits;
+   for ( ; count>0; count--){
+      int idx = rndgen.Uniform(count);
+      int max_val = threshold-1;
+      if (fVoteRemoved[idx])
+         continue;
+      int x = hits[idx].wire, y = hits[idx].peakT, rho = 0, theta = 0;
+      fDeaccu.push_back({x, y});
+      //loop over all angles and fill the accumulator
+      for (int j=0; j<kAccuW; j++){
+         int r = Rho(x, y, j);
+         int val = ++Bin(r, j);
+         if (max_val < val){
+            max_val = val;
+            rho = r;
+            theta = j*180/kAccuW;
+         }
+      }
+      if (max_val < threshold){
+         fVoteRemoved[idx] = 1;
+         continue;
+      }
+      //start at point and walk the corridor on both sides
+      std::array<std::array<int, 4>, 2> endpoint = {{{0, 0, 0, 0}, {0, 0, 0, 0}}};
+      std::vector<int> lines_idx;
+      for (int k=0; k<2;k++){
+         int i=0, gap=0;
+         while (gap < max_gap){
+            (k==0)? i++ : i--;
+            if ( (idx+i) == nhits || (idx+i) <0) // if we reach the edges of the data set
+               break;
+            if (fLineRemoved[idx+i]) // if the point has already been removed
+               continue;
+            int x1 = hits[idx+i].wire, y1 = hits[idx+i].peakT, wire_idx = hits[idx+i].idx;
+            if (endpoint[k][0]!= 0){ // ensure we don't jump large x-values
+               if (std::abs(endpoint[k][0] - x1) > 30){
+                  break;
+               }
+            }
+            int y_val = YOnLine(x1, rho, theta);
+            if (std::abs(y_val-y1) <= range){
+               gap = 0;
+               endpoint[k] = {x1, y1, wire_idx, idx+i};
+               fVoteRemoved[idx+i] = 1;
+               fLineRemoved[idx+i] = 1;
+               if (save_hits){
+                  lines_idx.push_back(wire_idx);
+               }
+            }
+            else
+               gap++;
+         } // end of while loop
+      } // end of k loop
+
+      // unvote the points in the corridor; the remaining ones keep their order
+      size_t kept = 0;
+      for (size_t n = 0; n < fDeaccu.size(); n++){
+         int x1 = fDeaccu[n][0], y1 = fDeaccu[n][1];
+         int y_val = YOnLine(x1, rho, theta);
+         if (y1 >= (y_val-range) && y1 <= (y_val+range))
+            Unvote(x1, y1);
+         else
+            fDeaccu[kept++] = fDeaccu[n];
+      }
+      fDeaccu.resize(kept);
+
+      int x0_end = endpoint[0][0], y0_end = endpoint[0][1], x1_end = endpoint[1][0], y1_end = endpoint[1][1];
+      int wire0_end = endpoint[0][2], wire1_end = endpoint[1][2];
+      int idx0_end = endpoint[0][3], idx1_end = endpoint[1][3];
+      if ((x0_end==0 && y0_end==0) || (x1_end==0 && y1_end==0)) // don't add the (0,0) points
+         continue;
+      fOutlines.push_back({x0_end, y0_end, x1_end, y1_end, wire0_end, wire1_end, idx0_end, idx1_end, rho, theta});
+      if (save_hits){
+         fOuthitIdx.push_back(std::move(lines_idx));
+      }
+   } // end of point loop
+
+   // leave the accumulator empty for the next call
+   for (auto const& point : fDeaccu)
+      Unvote(point[0], point[1]);
+   fDeaccu.clear();
+
+   // combine lines that are split
+   auto& outlines = fOutlines;
+   for (size_t i=0; i<outlines.size(); i++){
+      bool same = false;
+      for (size_t j=i+1; j<outlines.size() && same == false; j++){
+         int xi_coords[2] = {outlines[i][0], outlines[i][2]}; int xj_coords[2] = {outlines[j][0], outlines[j][2]};
+         int yi_coords[2] = {outlines[i][1], outlines[i][3]}; int yj_coords[2] = {outlines[j][1], outlines[j][3]};
+         int rhoi = outlines[i][8], rhoj = outlines[j][8];
+         int thetai = outlines[i][9], thetaj = outlines[j][9];
+
+         int var = 100;
+         int rho_var = 30;
+         int theta_var = 20;
+         for (int k=0; k<2 && same == false; k++){
+            for (int l=0; l<2 && same == false; l++){
+               int counter = 0;
+               if ((xi_coords[k] < (xj_coords[l] + var)) && (xi_coords[k] > (xj_coords[l] - var)))
+                  counter++;
+               if ((yi_coords[k] < (yj_coords[l] + var)) && (yi_coords[k] > (yj_coords[l] - var)))
+                  counter++ ;
+               if ((rhoi < (rhoj + rho_var)) && (rhoi > (rhoj - rho_var)))
+                  counter++;
+               if ((thetai < (thetaj + theta_var)) && (thetai > (thetaj - theta_var)))
+                  counter++;
+               if (counter >= 3){ // if at least three of the conditions are fulfilled
+                  int from = (k==0)? 0 : 2; // endpoint of line i that replaces one of line j
+                  int to   = (l==0)? 2 : 0;
+                  outlines[j][to]   = outlines[i][from];
+                  outlines[j][to+1] = outlines[i][from+1];
+                  same = true;
+                  // remove the extra segment
+                  (outlines.at(i)).clear();
+                  if (save_hits){
+                     (fOuthitIdx.at(j)).insert( (fOuthitIdx.at(j)).end(),  (fOuthitIdx.at(i)).begin(),  (fOuthitIdx.at(i)).end());
+                     (fOuthitIdx.at(i)).clear();
+                  }
+               }
+            }
+         }
+      } // end of j loop
+   } // end of i loop
+
+   for (size_t i=0; i < outlines.size(); i++){
+      if ((outlines.at(i)).empty())
+         continue;
+      int x0_end = outlines[i][0], y0_end = outlines[i][1], x1_end = outlines[i][2], y1_end = outlines[i][3];
+      bool keep = false;
+      if (muon_length!=0)
+         keep = std::abs(y0_end-y1_end) > muon_length;
+      else
+         keep = float(std::sqrt(std::pow(x1_end - x0_end, 2) + std::pow(y1_end - y0_end, 2) * 1.0)) > min_length;
+      if (keep){
+         lines.push_back(outlines.at(i));
+         if (save_hits)
+            hit_idx.push_back(fOuthitIdx.at(i));
+      }
+   }
+} // end of Transform
+
+} // namespace comm
+} // namespace sbnd
+
+#endif
@@ -27,9 +27,10 @@
 
 // SBN/SBND includes
 #include "sbnobj/SBND/Commissioning/MuonTrack.hh"
+#include "sbndcode/Commissioning/HoughEngine.h"
 
-// ROOT includes 
-#include "TRandom3.h"
+// TBB includes
+#include "tbb/parallel_for.h"
 
 // C++ includes
 #include <vector>
@@ -41,6 +42,7 @@
 #include <cmath>
 #include <bitset>
 #include <memory>
+#include <array>
 
 using std::vector;
 
@@ -70,12 +72,12 @@ private:
    void ResetMuonVariables(int n); 
    // Finds distance between two points 
    float Distance(int x1, int y1, int x2, int y2);
-   // Performs Hough Transform for collection planes
-   void Hough(vector<vector<int>> coords, vector<int> param, bool save_hits, int nentry, 
-              vector<vector<int>>& lines, vector<vector<int>>& hit_idx);
+   // Performs the Hough Transforms of several planes, one engine each, concurrently if fUseHoughWorkers
+   void Hough(size_t nplanes, const vector<sbnd::comm::HoughHit>* coords[], bool save_hits,
+              vector<vector<int>>* lines[], vector<vector<int>>* hit_idx[]);
    // Finds t0, stores them in a vector<vector<double>>     
    void FindEndpoints(vector<vector<int>>& lines_col, vector<vector<int>>& lines_ind, vector<vector<int>>& hit_idx, 
-                      int range, vector<art::Ptr<recob::Hit>> hitlist, 
+                      int range, const vector<art::Ptr<recob::Hit>>& hitlist, 
                       vector<vector<geo::Point_t>>& muon_endpoints, vector<vector<int>>& muon_hitpeakT, vector<vector<int>>& muon_hit_idx); 
    // Fixes endpoints, returns true if conditions are fulfilled 
    bool FixEndpoints(geo::WireID wire_col, geo::WireID wire_ind, geo::Point_t& point); 
@@ -92,12 +94,13 @@ private:
    // Define variables 
    int nhits;
 
-   vector<vector<int>> hit_02, hit_12;
+   vector<sbnd::comm::HoughHit> hit_02, hit_12;
    vector<vector<int>> lines_02, lines_12;
    vector<vector<int>> hit_idx_02, hit_idx_12; 
 
-   vector<vector<int>> hit_00, hit_01, hit_10, hit_11;
+   vector<sbnd::comm::HoughHit> hit_00, hit_01, hit_10, hit_11;
    vector<vector<int>> lines_00, lines_01, lines_10, lines_11;
+   vector<vector<int>> ind_empty_0, ind_empty_1, ind_empty_2, ind_empty_3; // placeholders, induction hits are not saved
 
    vector<int> muon_tpc, muon_type; 
    vector<double> muon_t0;
@@ -117,6 +120,11 @@ private:
    // [ac crossing, anode, cathode, top-bottom, up-downstream, other], define in fcl
 
    int fLineCount;       // number of estimated hit lines/muon tracks 
+   bool fUseHoughWorkers; // transform the planes concurrently; output does not depend on it
+
+   sbnd::comm::HoughParam fHoughParam;
+   static constexpr size_t kNHoughEngines = 4; // at most 4 planes are transformed together
+   std::array<sbnd::comm::HoughEngine, kNHoughEngines> fHoughEngines;
 
    // services 
    art::ServiceHandle<art::TFileService> tfs;
@@ -154,6 +162,10 @@ void MuonTrackProducer::reconfigure(fhicl::ParameterSet const & p)
    // Reset function parameters 
    fLineCount            = p.get<int>("LineCount",20);
 
+   fUseHoughWorkers      = p.get<bool>("UseHoughWorkers",false);
+
+   fHoughParam = {fHoughThreshold, fHoughMaxGap, fHoughRange, fHoughMinLength, fHoughMuonLength};
+
 } // MuonTrackProducer()
 
 void MuonTrackProducer::produce(art::Event & evt)
@@ -182,20 +194,20 @@ void MuonTrackProducer::produce(art::Event & evt)
       geo::WireID wireid = hitlist[i]->WireID();
       int hit_wire = int(wireid.Wire), hit_peakT = int(hitlist[i]->PeakTime()), hit_plane = wireid.Plane, hit_tpc = wireid.TPC;
       if (hit_plane==2 && hit_peakT>0){ // if collection plane and only positive peakT 
-         vector<int> v{hit_wire,hit_peakT,i};
+         sbnd::comm::HoughHit v{hit_wire,hit_peakT,i};
          if (hit_tpc==0)
             hit_02.push_back(v);  
          else
             hit_12.push_back(v); 
       }
    } // end of nhit loop
-   hit_02.shrink_to_fit(); hit_12.shrink_to_fit(); 
 
    // perform hough transform
    bool save_col_hits = true;
-   vector<int> HoughParam{fHoughThreshold, fHoughMaxGap, fHoughRange, fHoughMinLength, fHoughMuonLength};
-   Hough(hit_02, HoughParam, save_col_hits, event, lines_02, hit_idx_02);
-   Hough(hit_12, HoughParam, save_col_hits, event, lines_12, hit_idx_12);
+   const vector<sbnd::comm::HoughHit>* col_hits[] = {&hit_02, &hit_12};
+   vector<vector<int>>* col_lines[] = {&lines_02, &lines_12};
+   vector<vector<int>>* col_hit_idx[] = {&hit_idx_02, &hit_idx_12};
+   Hough(2, col_hits, save_col_hits, col_lines, col_hit_idx);
 
    bool muon_in_tpc0 = !(lines_02.empty()); // will be true if a muon was detected in tpc0 
    bool muon_in_tpc1 = !(lines_12.empty()); // will be true if a muon was detected in tpc1
@@ -208,7 +220,7 @@ void MuonTrackProducer::produce(art::Event & evt)
       for (int i = 0; i < nhits; ++i) {
          geo::WireID wireid = hitlist[i]->WireID();
          int hit_wire = int(wireid.Wire), hit_peakT = int(hitlist[i]->PeakTime()), hit_tpc = wireid.TPC, hit_plane = wireid.Plane;
-         vector<int> v{hit_wire,hit_peakT,i};
+         sbnd::comm::HoughHit v{hit_wire,hit_peakT,i};
          if (muon_in_tpc0 == true){ //if ac muon was found in tpc0 
             if (hit_plane==0 && hit_tpc==0 && hit_peakT>0) 
                hit_00.push_back(v);
@@ -223,18 +235,26 @@ void MuonTrackProducer::produce(art::Event & evt)
          } 
       }
       bool save_ind_hits = false;
-      vector<vector<int>> ind_empty; // placeholder empty vector 
+      // the induction transforms do not depend on the endpoint matching, so they are all run first
+      const vector<sbnd::comm::HoughHit>* ind_hits[kNHoughEngines];
+      vector<vector<int>>* ind_lines[kNHoughEngines];
+      vector<vector<int>>* ind_hit_idx[kNHoughEngines] = {&ind_empty_0, &ind_empty_1, &ind_empty_2, &ind_empty_3};
+      size_t n_ind = 0;
       if (muon_in_tpc0){
-         Hough(hit_00, HoughParam, save_ind_hits, event, lines_00, ind_empty);
-         Hough(hit_01, HoughParam, save_ind_hits, event, lines_01, ind_empty);
+         ind_hits[n_ind] = &hit_00; ind_lines[n_ind++] = &lines_00;
+         ind_hits[n_ind] = &hit_01; ind_lines[n_ind++] = &lines_01;
+      }
+      if (muon_in_tpc1){
+         ind_hits[n_ind] = &hit_10; ind_lines[n_ind++] = &lines_10;
+         ind_hits[n_ind] = &hit_11; ind_lines[n_ind++] = &lines_11;
+      }
+      Hough(n_ind, ind_hits, save_ind_hits, ind_lines, ind_hit_idx);
 
+      if (muon_in_tpc0){
          FindEndpoints(lines_02, lines_00, hit_idx_02, fEndpointRange, hitlist, muon_endpoints, muon_hitpeakT, muon_hit_idx);
          FindEndpoints(lines_02, lines_01, hit_idx_02, fEndpointRange, hitlist, muon_endpoints, muon_hitpeakT, muon_hit_idx);
       }
       if (muon_in_tpc1){
-         Hough(hit_10, HoughParam, save_ind_hits, event, lines_10, ind_empty);
-         Hough(hit_11, HoughParam, save_ind_hits, event, lines_11, ind_empty);
-
          FindEndpoints(lines_12, lines_10, hit_idx_12, fEndpointRange, hitlist, muon_endpoints, muon_hitpeakT, muon_hit_idx);
          FindEndpoints(lines_12, lines_11, hit_idx_12, fEndpointRange, hitlist, muon_endpoints, muon_hitpeakT, muon_hit_idx);
       }
@@ -287,198 +307,18 @@ float MuonTrackProducer::Distance(int x1, int y1, int x2, int y2){
    return sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2) * 1.0);
 }
 
-void MuonTrackProducer::Hough(vector<vector<int>> coords, vector<int> param,  bool save_hits, int nentry,
-                              vector<vector<int>>& lines, vector<vector<int>>& hit_idx){
-   // set parameters 
-   int threshold = param.at(0);
-   int max_gap = param.at(1);
-   int range = param.at(2);
-   int min_length = param.at(3);
-   int muon_length = param.at(4);
-
-   // set global variables 
-   TRandom3 rndgen;
-   const int h = 3500; const int w = 2000; //range of hit_wire
-   constexpr int accu_h = h + w + 1 ; const int accu_w = 180; 
-   const int x_c = (w/2); const int y_c = (h/2);
-
-   // create accumulator/pointer to accumulator 
-   int accu[accu_h][accu_w] = {{0}};
-   int (*adata)[accu_w];
-   adata = &accu[(accu_h-1)/2]; // have pointer point to the middle of the accumulator array (then we can use negative indices)
-
-   // declare necessary vectors 
-   vector<vector<int>> data = coords; // points will not be removed 
-   vector<vector<int>> deaccu; // deaccumulator
-   vector<vector<int>> outlines; 
-   vector<vector<int>> outhit_idx; 
-
-   // loop over points and perform transform 
-   int count = coords.size(); 
-   for ( ; count>0; count--){ 
-      int idx = rndgen.Uniform(count);
-      int max_val = threshold-1;
-      if ((coords.at(idx)).empty())
-         continue; 
-      int x = coords[idx][0], y = coords[idx][1], rho = 0, theta = 0;
-      vector<int> v{x,y}; 
-      deaccu.push_back(v);
-      //loop over all angles and fill the accumulator 
-      for (int j=0; j<accu_w; j++){ 
-         int r = int(round((x-x_c)*cos(j*M_PI/accu_w) + (y-y_c)*sin(j*M_PI/accu_w)));
-         int val = ++(adata[r][j]);       
-         if (max_val < val){
-            max_val = val;
-            rho = r;
-            theta = j*180/accu_w;
-         }
-      }
-      if (max_val < threshold){
-         (coords.at(idx)).clear(); 
-         continue;
-      }
-      //start at point and walk the corridor on both sides 
-      vector<vector<int>> endpoint(2, vector<int>(4)); 
-      vector<int> lines_idx;
-      lines_idx.clear(); 
-      for (int k=0; k<2;k++){
-         int i=0, gap=0;
-         while (gap < max_gap){ 
-            (k==0)? i++ : i--; 
-            if ( (idx+i) == int(data.size()) || (idx+i) <0) // if we reach the edges of the data set 
-               break;
-            if ((data.at(idx+i)).empty()) // if the point has already been removed 
-               continue;
-            int x1 = data[idx+i][0], y1 = int(data[idx+i][1]), wire_idx = data[idx+i][2]; 
-            int last_x, diffx; 
-            if (endpoint[k][0]!= 0){ // ensure we don't jump large x-values 
-               last_x = endpoint[k][0];
-               diffx = abs(last_x - x1);
-               if (diffx > 30){
-                  break;
-               }
-            }
-            int y_val = int(round((rho - (x1 - x_c)*cos(theta*M_PI/180.0))/sin(theta*M_PI/180.0) + y_c));
-            if (abs(y_val-y1) <= range){
-               gap = 0;
-               endpoint[k] = {x1, y1, wire_idx, idx+i};
-               (coords.at(idx+i)).clear();
-               (data.at(idx+i)).clear();
-               if (save_hits){
-                  lines_idx.push_back(wire_idx);
-               }
-            }
-            else
-               gap++;
-         } // end of while loop 
-      } // end of k loop 
-
-      // unvote from the accumulator 
-      for (int n = (deaccu.size()-1); n>=0; n--){ 
-         int x1 = deaccu[n][0], y1 = int(deaccu[n][1]);
-         int y_val = int(round((rho - (x1 - x_c)*cos(theta*M_PI/180.0))/sin(theta*M_PI/180.0) + y_c));
-         if (y1 >= (y_val-range) && y1 <= (y_val+range)){
-            for (int m=0; m<accu_w; m++){
-               int r = int(round((x1-x_c)*cos(m*M_PI/accu_w) + (y1-y_c)*sin(m*M_PI/accu_w)));
-               (adata[r][m])--;
-            }
-            deaccu.erase(deaccu.begin() + n);
-         }
-      } // end of deaccumulator loop
-
-      int x0_end = endpoint[0][0], y0_end = endpoint[0][1], x1_end = endpoint[1][0], y1_end = endpoint[1][1];
-      int wire0_end = endpoint[0][2], wire1_end = endpoint[1][2]; 
-      int idx0_end = endpoint[0][3], idx1_end = endpoint[1][3];
-      if ((x0_end==0 && y0_end==0) || (x1_end==0 && y1_end==0)) // don't add the (0,0) points 
-         continue;
-      vector<int> outline = {x0_end, y0_end, x1_end, y1_end, wire0_end, wire1_end, idx0_end, idx1_end, rho, theta};
-
-      outlines.push_back(outline);
-      if (save_hits){
-         outhit_idx.push_back(lines_idx);
-      }
-
-   } // end of point loop 
-   // combine lines that are split 
-   for (size_t i=0; i<outlines.size(); i++){
-      bool same = false;
-      for (size_t j=i+1; j<outlines.size() && same == false; j++){ 
-         int xi_coords[2] = {outlines[i][0], outlines[i][2]}; int xj_coords[2] = {outlines[j][0], outlines[j][2]};
-         int yi_coords[2] = {outlines[i][1], outlines[i][3]}; int yj_coords[2] = {outlines[j][1], outlines[j][3]};
-         int rhoi = outlines[i][8], rhoj = outlines[j][8];
-         int thetai = outlines[i][9], thetaj = outlines[j][9]; 
-
-         int var = 100;
-         int rho_var = 30;
-         int theta_var = 20; 
-         for (int k=0; k<2 && same == false; k++){
-            for (int l=0; l<2 && same == false; l++){
-               int counter = 0; 
-               if ((xi_coords[k] < (xj_coords[l] + var)) && (xi_coords[k] > (xj_coords[l] - var)))
-                  counter++;
-               if ((yi_coords[k] < (yj_coords[l] + var)) && (yi_coords[k] > (yj_coords[l] - var)))
-                  counter++ ;
-               if ((rhoi < (rhoj + rho_var)) && (rhoi > (rhoj - rho_var)))
-                  counter++; 
-               if ((thetai < (thetaj + theta_var)) && (thetai > (thetaj - theta_var)))
-                  counter++;
-               if (counter >= 3){ // if at least three of the conditions are fulfilled 
-                  if(k==0){
-                     if(l==0){
-                        outlines[j][2] = outlines[i][0];
-                        outlines[j][3] = outlines[i][1];
-                     }
-                     else{
-                        outlines[j][0] = outlines[i][0];
-                        outlines[j][1] = outlines[i][1];
-                     }
-                  }
-                  else{
-                     if(l==0){
-                        outlines[j][2] = outlines[i][2]; 
-                        outlines[j][3] = outlines[i][3];                        
-                     }
-                     else{
-                        outlines[j][0] = outlines[i][2];
-                        outlines[j][1] = outlines[i][3]; 
-                     }  
-                  }
-                  same = true;
-                  // remove the extra segment 
-                  (outlines.at(i)).clear();
-                  if (save_hits){
-                     (outhit_idx.at(j)).insert( (outhit_idx.at(j)).end(),  (outhit_idx.at(i)).begin(),  (outhit_idx.at(i)).end()); 
-                     (outhit_idx.at(i)).clear();
-                  }
-               } 
-            }
-         }
-      } // end of j loop 
-   } // end of i loop 
-
-   for (size_t i=0; i < outlines.size(); i++){
-      if ((outlines.at(i)).empty())
-         continue;
-      int x0_end = outlines[i][0], y0_end = outlines[i][1], x1_end = outlines[i][2], y1_end = outlines[i][3];
-      if (muon_length!=0){
-         int y_diff = abs(y0_end-y1_end);
-         if (y_diff > muon_length){
-            lines.push_back(outlines.at(i));
-            if (save_hits)
-               hit_idx.push_back(outhit_idx.at(i)); 
-         }
-      }
-      else{
-         float length = Distance(x0_end,y0_end,x1_end,y1_end);
-         if (length > min_length){
-            lines.push_back(outlines.at(i));
-            if (save_hits)
-               hit_idx.push_back(outhit_idx.at(i)); 
-         }
-      }
+void MuonTrackProducer::Hough(size_t nplanes, const vector<sbnd::comm::HoughHit>* coords[], bool save_hits,
+                              vector<vector<int>>* lines[], vector<vector<int>>* hit_idx[]){
+   auto transformPlane = [&](size_t i_plane) {
+      fHoughEngines[i_plane].Transform(*coords[i_plane], fHoughParam, save_hits, *lines[i_plane], *hit_idx[i_plane]);
+   };
+
+   if (fUseHoughWorkers)
+      tbb::parallel_for(size_t(0), nplanes, transformPlane);
+   else{
+      for (size_t i_plane = 0; i_plane < nplanes; i_plane++)
+         transformPlane(i_plane);
    }
-   //free memory 
-   data.clear(); deaccu.clear(); outlines.clear(); outhit_idx.clear();
 } // end of hough 
 
 void MuonTrackProducer::ResetCollectionHitVectors(int n) {
@@ -538,7 +378,7 @@ void MuonTrackProducer::ResetMuonVariables(int n){
 }
 
 void MuonTrackProducer::FindEndpoints(vector<vector<int>>& lines_col, vector<vector<int>>& lines_ind, vector<vector<int>>& hit_idx, 
-                                      int range, vector<art::Ptr<recob::Hit>> hitlist, 
+                                      int range, const vector<art::Ptr<recob::Hit>>& hitlist, 
                                       vector<vector<geo::Point_t>>& muon_endpoints, vector<vector<int>>& muon_hitpeakT, vector<vector<int>>& muon_hit_idx){
    if (lines_ind.empty() == false){
       for (size_t i=0; i<lines_col.size(); i++){
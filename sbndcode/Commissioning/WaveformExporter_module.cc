@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       WaveformExporter
+// Module Type: analyzer
+// File:        WaveformExporter_module.cc
+//
+// Writes the recob::Wire regions of interest, the raw::OpDetWaveforms
+// and the true track labels of the wire samples as typed columns in
+// compressed chunks (sbnd::ColumnarWriter), for the training sets of the
+// machine learning studies: unlike the per-hit trees of HitDumper, the
+// columns can be read into numpy arrays directly.
+//
+// Columns (one value per row of their table):
+//   event.run, event.subrun, event.event             (int32, one per event)
+//   roi.event, roi.tpc, roi.plane, roi.wire,
+//   roi.channel, roi.start, roi.length               (int32, one per ROI)
+//   sample.charge                                    (float32, one per ROI sample)
+//   sample.track                                     (int32, with SimChannelLabel)
+//   opdet.event, opdet.channel, opdet.length         (int32, one per waveform)
+//   opdet.time                                       (float64, one per waveform)
+//   opdet.adc                                        (int16, one per waveform sample)
+// The samples of the ROIs follow each other in the order of the ROIs, as
+// the ADC counts of the waveforms; roi.length and opdet.length split them.
+// With WireDownsampling n, the samples are the means of the ticks of each
+// group of n ticks (tick / n), roi.start and roi.length count groups;
+// sample.track is the track ID depositing the most electrons in the group
+// (0 for none). OpDetWaveforms are downsampled the same way from their
+// first sample. A chunk always holds whole events.
+////////////////////////////////////////////////////////////////////////
+
+// Framework includes
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+// LArSoft includes
+#include "larcore/Geometry/Geometry.h"
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardataobj/RawData/OpDetWaveform.h"
+#include "lardataobj/RecoBase/Wire.h"
+#include "lardataobj/Simulation/SimChannel.h"
+
+#include "sbndcode/Utilities/ColumnarWriter.h"
+
+// C++ Includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sbnd {
+  class WaveformExporter;
+}
+
+class sbnd::WaveformExporter : public art::EDAnalyzer {
+public:
+  explicit WaveformExporter(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  WaveformExporter(WaveformExporter const&) = delete;
+  WaveformExporter(WaveformExporter&&) = delete;
+  WaveformExporter& operator=(WaveformExporter const&) = delete;
+  WaveformExporter& operator=(WaveformExporter&&) = delete;
+
+  void beginJob() override;
+  void analyze(art::Event const& e) override;
+  void endJob() override;
+
+private:
+
+  /// Fills labels with the track ID of each group of the ROI starting at
+  /// group first; electrons are the deposits of the channel by group and
+  /// track ID.
+  void Labels(std::map<std::pair<int, int>, double> const& electrons,
+              int first, int nGroups, std::vector<std::int32_t>& labels) const;
+
+  art::InputTag              fWireLabel;              ///< recob::Wires, none if empty
+  std::vector<art::InputTag> fOpDetWaveformLabels;    ///< raw::OpDetWaveforms
+  art::InputTag              fSimChannelLabel;        ///< SimChannels for the sample labels, none if empty
+  std::string                fOutputFile;
+  int                        fWireDownsampling;       ///< ticks averaged into one sample
+  int                        fWaveformDownsampling;   ///< OpDetWaveform samples averaged into one
+  std::size_t                fChunkBytes;             ///< uncompressed size of a chunk
+  int                        fCompressionLevel;       ///< zlib level, 0 to store uncompressed
+  bool                       fAsyncWrite;             ///< compresses and writes on a background thread
+
+  sbnd::ColumnarWriter fWriter;
+  std::size_t fEventRun, fEventSubRun, fEventEvent;
+  std::size_t fROIEvent, fROITPC, fROIPlane, fROIWire, fROIChannel, fROIStart, fROILength;
+  std::size_t fSampleCharge, fSampleTrack;
+  std::size_t fOpDetEvent, fOpDetChannel, fOpDetLength, fOpDetTime, fOpDetADC;
+
+  // buffers reused across events
+  std::vector<float>                     fSamples;
+  std::vector<std::int32_t>              fLabels;
+  std::vector<std::int16_t>              fADCs;
+  std::vector<sim::SimChannel const*>    fSimChannels;  ///< by channel
+  std::map<std::pair<int, int>, double>  fElectrons;    ///< by (group, track ID)
+};
+
+
+sbnd::WaveformExporter::WaveformExporter(fhicl::ParameterSet const& p)
+  : EDAnalyzer{p}
+{
+  fWireLabel            = p.get< art::InputTag >("WireLabel", "caldata");
+  fOpDetWaveformLabels  = p.get< std::vector<art::InputTag> >("OpDetWaveformLabels", {});
+  fSimChannelLabel      = p.get< art::InputTag >("SimChannelLabel", "");
+  fOutputFile           = p.get< std::string >("OutputFile", "waveforms.cols");
+  fWireDownsampling     = std::max(1, p.get< int >("WireDownsampling", 1));
+  fWaveformDownsampling = std::max(1, p.get< int >("WaveformDownsampling", 1));
+  fChunkBytes           = p.get< std::size_t >("ChunkMBytes", 64) << 20;
+  fCompressionLevel     = p.get< int >("CompressionLevel", 1);
+  fAsyncWrite           = p.get< bool >("AsyncWrite", true);
+
+  if (!fWireLabel.empty()) consumes< std::vector<recob::Wire> >(fWireLabel);
+  for (art::InputTag const& label : fOpDetWaveformLabels) consumes< std::vector<raw::OpDetWaveform> >(label);
+  if (!fSimChannelLabel.empty()) consumes< std::vector<sim::SimChannel> >(fSimChannelLabel);
+}
+
+void sbnd::WaveformExporter::beginJob()
+{
+  using Col = sbnd::ColumnarWriter;
+  fEventRun     = fWriter.AddColumn("event.run",     Col::kInt32);
+  fEventSubRun  = fWriter.AddColumn("event.subrun",  Col::kInt32);
+  fEventEvent   = fWriter.AddColumn("event.event",   Col::kInt32);
+  fROIEvent     = fWriter.AddColumn("roi.event",     Col::kInt32);
+  fROITPC       = fWriter.AddColumn("roi.tpc",       Col::kInt32);
+  fROIPlane     = fWriter.AddColumn("roi.plane",     Col::kInt32);
+  fROIWire      = fWriter.AddColumn("roi.wire",      Col::kInt32);
+  fROIChannel   = fWriter.AddColumn("roi.channel",   Col::kInt32);
+  fROIStart     = fWriter.AddColumn("roi.start",     Col::kInt32);
+  fROILength    = fWriter.AddColumn("roi.length",    Col::kInt32);
+  fSampleCharge = fWriter.AddColumn("sample.charge", Col::kFloat32);
+  fSampleTrack  = fWriter.AddColumn("sample.track",  Col::kInt32);
+  fOpDetEvent   = fWriter.AddColumn("opdet.event",   Col::kInt32);
+  fOpDetChannel = fWriter.AddColumn("opdet.channel", Col::kInt32);
+  fOpDetLength  = fWriter.AddColumn("opdet.length",  Col::kInt32);
+  fOpDetTime    = fWriter.AddColumn("opdet.time",    Col::kFloat64);
+  fOpDetADC     = fWriter.AddColumn("opdet.adc",     Col::kInt16);
+  fWriter.Open(fOutputFile, fCompressionLevel, fAsyncWrite);
+}
+
+void sbnd::WaveformExporter::analyze(art::Event const& e)
+{
+  std::int32_t const event = e.event();
+  fWriter.Append< std::int32_t >(fEventRun, e.run());
+  fWriter.Append< std::int32_t >(fEventSubRun, e.subRun());
+  fWriter.Append(fEventEvent, event);
+
+  if (!fWireLabel.empty()) {
+    geo::GeometryCore const& geom = *art::ServiceHandle<geo::Geometry const>();
+
+    // true deposits by channel
+    bool const truth = !fSimChannelLabel.empty();
+    if (truth) {
+      fSimChannels.assign(geom.Nchannels(), nullptr);
+      for (sim::SimChannel const& sc : e.getProduct< std::vector<sim::SimChannel> >(fSimChannelLabel)) {
+        if (sc.Channel() < fSimChannels.size()) fSimChannels[sc.Channel()] = &sc;
+      }
+    }
+    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
+
+    for (recob::Wire const& wire : e.getProduct< std::vector<recob::Wire> >(fWireLabel)) {
+      raw::ChannelID_t const channel = wire.Channel();
+      std::vector<geo::WireID> const wireIDs = geom.ChannelToWire(channel);
+      if (wireIDs.empty()) continue;
+      geo::WireID const& wireID = wireIDs.front();
+
+      if (truth) {
+        fElectrons.clear();
+        if (sim::SimChannel const* sc = fSimChannels[channel]) {
+          for (auto const& tdcide : sc->TDCIDEMap()) {
+            int const group = int(clockData.TPCTDC2Tick(tdcide.first)) / fWireDownsampling;
+            for (sim::IDE const& ide : tdcide.second)
+              fElectrons[{ group, std::abs(ide.trackID) }] += ide.numElectrons;
+          }
+        }
+      }
+
+      for (auto const& range : wire.SignalROI().get_ranges()) {
+        int const startTick = range.begin_index();
+        std::vector<float> const& values = range.data();
+        int const nTicks = values.size();
+        int const first = startTick / fWireDownsampling;
+        int const nGroups = (startTick + nTicks - 1) / fWireDownsampling - first + 1;
+
+        // mean of the ticks of the ROI in each group
+        fSamples.assign(nGroups, 0.f);
+        for (int t = 0; t < nTicks; ++t) fSamples[(startTick + t) / fWireDownsampling - first] += values[t];
+        if (fWireDownsampling > 1) {
+          for (int g = 0; g < nGroups; ++g) {
+            int const lo = std::max(startTick, (first + g) * fWireDownsampling);
+            int const hi = std::min(startTick + nTicks, (first + g + 1) * fWireDownsampling);
+            fSamples[g] /= hi - lo;
+          }
+        }
+
+        fWriter.Append(fROIEvent, event);
+        fWriter.Append< std::int32_t >(fROITPC, wireID.TPC);
+        fWriter.Append< std::int32_t >(fROIPlane, wireID.Plane);
+        fWriter.Append< std::int32_t >(fROIWire, wireID.Wire);
+        fWriter.Append< std::int32_t >(fROIChannel, channel);
+        fWriter.Append< std::int32_t >(fROIStart, first);
+        fWriter.Append< std::int32_t >(fROILength, nGroups);
+        fWriter.Append(fSampleCharge, fSamples.data(), fSamples.size());
+        if (truth) {
+          Labels(fElectrons, first, nGroups, fLabels);
+          fWriter.Append(fSampleTrack, fLabels.data(), fLabels.size());
+        }
+      }
+    }
+  }
+
+  for (art::InputTag const& label : fOpDetWaveformLabels) {
+    for (raw::OpDetWaveform const& wf : e.getProduct< std::vector<raw::OpDetWaveform> >(label)) {
+      int const nGroups = (int(wf.size()) + fWaveformDownsampling - 1) / fWaveformDownsampling;
+      fADCs.resize(nGroups);
+      for (int g = 0; g < nGroups; ++g) {
+        int const lo = g * fWaveformDownsampling;
+        int const hi = std::min(int(wf.size()), lo + fWaveformDownsampling);
+        int sum = 0;
+        for (int i = lo; i < hi; ++i) sum += wf[i];
+        fADCs[g] = std::int16_t(std::lround(double(sum) / (hi - lo)));
+      }
+      fWriter.Append(fOpDetEvent, event);
+      fWriter.Append< std::int32_t >(fOpDetChannel, wf.ChannelNumber());
+      fWriter.Append< std::int32_t >(fOpDetLength, nGroups);
+      fWriter.Append< double >(fOpDetTime, wf.TimeStamp());
+      fWriter.Append(fOpDetADC, fADCs.data(), fADCs.size());
+    }
+  }
+
+  if (fWriter.BufferedBytes() >= fChunkBytes) fWriter.Flush();
+}
+
+void sbnd::WaveformExporter::Labels(std::map<std::pair<int, int>, double> const& electrons,
+                                    int first, int nGroups, std::vector<std::int32_t>& labels) const
+{
+  labels.assign(nGroups, 0);
+  std::vector<double> most(nGroups, 0.);
+  for (auto it = electrons.lower_bound({ first, 0 });
+       it != electrons.end() && it->first.first < first + nGroups; ++it)
+  {
+    int const g = it->first.first - first;
+    if (it->second > most[g]) {
+      most[g] = it->second;
+      labels[g] = it->first.second;
+    }
+  }
+}
+
+void sbnd::WaveformExporter::endJob()
+{
+  fWriter.Close();
+}
+
+DEFINE_ART_MODULE(sbnd::WaveformExporter)
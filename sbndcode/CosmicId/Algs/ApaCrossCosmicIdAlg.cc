@@ -2,6 +2,9 @@
 
 #include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace sbnd{
 
 ApaCrossCosmicIdAlg::ApaCrossCosmicIdAlg(const Config& config){
@@ -34,7 +37,7 @@ void ApaCrossCosmicIdAlg::reconfigure(const Config& config){
 
 // Get the minimum distance from track to APA for different times
   std::pair<double, double> ApaCrossCosmicIdAlg::MinApaDistance(detinfo::DetectorPropertiesData const& detProp,
-                                                                recob::Track track, std::vector<double> t0List, int tpc){
+                                                                const recob::Track& track, const FlashTimeIndex& t0List, int tpc){
 
   double crossTime = -99999;
   double xmax = fTpcGeo.MaxX();
@@ -57,25 +60,46 @@ void ApaCrossCosmicIdAlg::reconfigure(const Config& config){
   // If in both TPCs (stitched) return null values
   if(tpc == -1) return std::make_pair(minDist, crossTime);
 
-  // Shift track by all t0's
-  for(auto const& t0 : t0List){
+  // Shift track by a t0
+  double driftVelocity = detProp.DriftVelocity();
+  auto tryT0 = [&](double t0){
     // If particle crosses the APA before t = 0 the crossing point won't be reconstructed
-    if(t0 < 0) continue;
+    if(t0 < 0) return;
     double shiftedX = point.X();
-    double shift = t0 * detProp.DriftVelocity();
+    double shift = t0 * driftVelocity;
     if(tpc == 0) shiftedX = point.X() - shift;
     if(tpc == 1) shiftedX = point.X() + shift;
 
     //Check track still in TPC
-    if(std::abs(shiftedX) > (xmax + fDistanceLimit)) continue;
+    if(std::abs(shiftedX) > (xmax + fDistanceLimit)) return;
     //Calculate distance between start/end and APA
     double dist = std::abs(std::abs(shiftedX) - xmax);
     if(dist < minDist) {
       minDist = dist;
       crossTime = t0;
     }
+  };
+
+  if(driftVelocity <= 0){
+    for(auto const& t0 : t0List) tryT0(t0);
+    return std::make_pair(minDist, crossTime);
   }
 
+  // The shift moves the point towards the APA of its TPC, and the distance
+  // is piecewise linear in t0 >= 0: it grows until the point crosses the
+  // cathode (only if it starts past it), shrinks until the point reaches the
+  // APA at t0 = tApa and grows after. The closest time is then the first
+  // t0 >= 0 or one of the two around tApa; they are tried in time order, so
+  // ties resolve as in a loop over all the sorted times
+  double u = (tpc == 0) ? point.X() : -point.X();
+  double tApa = (u + xmax) / driftVelocity;
+  auto const first = t0List.LowerBound(0.);
+  if(first == t0List.end()) return std::make_pair(minDist, crossTime);
+  auto const after = std::max(first, t0List.LowerBound(tApa));
+  tryT0(*first);
+  if(after > first && std::prev(after) > first) tryT0(*std::prev(after));
+  if(after > first && after != t0List.end()) tryT0(*after);
+
   return std::make_pair(minDist, crossTime);
 
 }
@@ -83,7 +107,7 @@ void ApaCrossCosmicIdAlg::reconfigure(const Config& config){
 
 // Get time by matching tracks which cross the APA
 double ApaCrossCosmicIdAlg::T0FromApaCross(detinfo::DetectorPropertiesData const& detProp,
-                                           recob::Track track, std::vector<double> t0List, int tpc){
+                                           const recob::Track& track, const FlashTimeIndex& t0List, int tpc){
 
   // Get the minimum distance to the APA and corresponding time
   std::pair<double, double> min = MinApaDistance(detProp, track, t0List, tpc);
@@ -96,9 +120,9 @@ double ApaCrossCosmicIdAlg::T0FromApaCross(detinfo::DetectorPropertiesData const
 
 // Get the distance from track to APA at fixed time
 double ApaCrossCosmicIdAlg::ApaDistance(detinfo::DetectorPropertiesData const& detProp,
-                                        recob::Track track, double t0, std::vector<art::Ptr<recob::Hit>> hits){
+                                        const recob::Track& track, double t0, const std::vector<art::Ptr<recob::Hit>>& hits){
 
-  std::vector<double> t0List {t0};
+  FlashTimeIndex t0List({t0});
   // Determine the TPC from hit collection
   int tpc = fTpcGeo.DetectedInTPC(hits);
   // Get the distance to the APA at the given time
@@ -109,7 +133,7 @@ double ApaCrossCosmicIdAlg::ApaDistance(detinfo::DetectorPropertiesData const& d
 
 // Work out what TPC track is in and get the minimum distance from track to APA for different times
 std::pair<double, double> ApaCrossCosmicIdAlg::MinApaDistance(detinfo::DetectorPropertiesData const& detProp,
-                                                              recob::Track track, std::vector<art::Ptr<recob::Hit>> hits, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1){
+                                                              const recob::Track& track, const std::vector<art::Ptr<recob::Hit>>& hits, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1){
 
   // Determine the TPC from hit collection
   int tpc = fTpcGeo.DetectedInTPC(hits);
@@ -126,7 +150,7 @@ std::pair<double, double> ApaCrossCosmicIdAlg::MinApaDistance(detinfo::DetectorP
 
 // Tag tracks with times outside the beam
 bool ApaCrossCosmicIdAlg::ApaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
-                                           recob::Track track, std::vector<art::Ptr<recob::Hit>> hits, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1){
+                                           const recob::Track& track, const std::vector<art::Ptr<recob::Hit>>& hits, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1){
 
   // Determine the TPC from hit collection
   int tpc = fTpcGeo.DetectedInTPC(hits);
@@ -99,15 +99,59 @@ void CosmicIdAlg::ResetCuts(){
 
 }
 
+// Fill the cache the first time an event is seen
+void CosmicIdAlg::PrepareEvent(const art::Event& event){
+
+  if(fEventCache.findManyCalo && fEventCache.eventId == event.id()) return;
+
+  fEventCache.tpcTrackHandle.reset();
+  fEventCache.findManyHits.reset();
+  fEventCache.findManyCalo.reset();
+  fEventCache.pfPartToTrackAssoc.reset();
+  fEventCache.cpaStitchIndex.reset();
+
+  // Get associations between tracks and hits/calorimetry collections
+  fEventCache.tpcTrackHandle.emplace(event.getValidHandle<std::vector<recob::Track>>(fTpcTrackModuleLabel));
+  fEventCache.findManyHits.emplace(*fEventCache.tpcTrackHandle, event, fTpcTrackModuleLabel);
+  fEventCache.findManyCalo.emplace(*fEventCache.tpcTrackHandle, event, fCaloModuleLabel);
+  fEventCache.eventId = event.id();
+
+}
+
+// Get the PFParticle to track associations, read once per event
+const art::FindManyP<recob::Track>& CosmicIdAlg::PFParticleTracks(const art::Event& event){
+
+  PrepareEvent(event);
+
+  if(!fEventCache.pfPartToTrackAssoc){
+    art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
+    event.getByLabel(fPandoraLabel, pfParticleHandle);
+    fEventCache.pfPartToTrackAssoc.emplace(pfParticleHandle, event, fTpcTrackModuleLabel);
+  }
+
+  return *fEventCache.pfPartToTrackAssoc;
+
+}
+
+// Get the tracks indexed for CPA stitching, made once per event
+const CpaCrossCosmicIdAlg::StitchIndex& CosmicIdAlg::CpaStitchIndex(){
+
+  if(!fEventCache.cpaStitchIndex){
+    fEventCache.cpaStitchIndex.emplace(ccTag.MakeStitchIndex(**fEventCache.tpcTrackHandle, *fEventCache.findManyHits));
+  }
+
+  return *fEventCache.cpaStitchIndex;
+
+}
+
 // Run cuts to decide if track looks like a cosmic
-bool CosmicIdAlg::CosmicId(recob::Track track, const art::Event& event, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1){
+bool CosmicIdAlg::CosmicId(const recob::Track& track, const art::Event& event, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1){
 
-  // Get associations between tracks and hit collections
-  auto tpcTrackHandle = event.getValidHandle<std::vector<recob::Track>>(fTpcTrackModuleLabel);
-  art::FindManyP<recob::Hit> findManyHits(tpcTrackHandle, event, fTpcTrackModuleLabel);
-  std::vector<art::Ptr<recob::Hit>> hits = findManyHits.at(track.ID());
-  // Get associations between track and calorimetry collections
-  art::FindManyP<anab::Calorimetry> findManyCalo(tpcTrackHandle, event, fCaloModuleLabel);
+  // Get associations between tracks and hit/calorimetry collections, shared by the whole event
+  PrepareEvent(event);
+  const art::FindManyP<recob::Hit>& findManyHits = *fEventCache.findManyHits;
+  const art::FindManyP<anab::Calorimetry>& findManyCalo = *fEventCache.findManyCalo;
+  const std::vector<art::Ptr<recob::Hit>>& hits = findManyHits.at(track.ID());
 
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event);
 
@@ -128,8 +172,7 @@ bool CosmicIdAlg::CosmicId(recob::Track track, const art::Event& event, std::vec
 
   // Tag cosmics which enter the TPC and stop
   if(fApplyStoppingCut){
-    std::vector<art::Ptr<anab::Calorimetry>> calos = findManyCalo.at(track.ID());
-    if(spTag.StoppingParticleCosmicId(track, calos)) return true;
+    if(spTag.StoppingParticleCosmicId(track, findManyCalo.at(track.ID()))) return true;
   }
 
   // Tag cosmics in other TPC to beam activity
@@ -141,12 +184,7 @@ bool CosmicIdAlg::CosmicId(recob::Track track, const art::Event& event, std::vec
 
   // Tag cosmics which cross the CPA
   if(fApplyCpaCrossCut){
-    std::vector<recob::Track> tracks;
-    for(auto const& tpcTrack : (*tpcTrackHandle)){
-      tracks.push_back(tpcTrack);
-    }
-
-    if(ccTag.CpaCrossCosmicId(detProp, track, tracks, findManyHits)) return true;
+    if(ccTag.CpaCrossCosmicId(detProp, track, CpaStitchIndex(), findManyHits)) return true;
   }
 
   // Tag cosmics which cross the APA
@@ -157,17 +195,15 @@ bool CosmicIdAlg::CosmicId(recob::Track track, const art::Event& event, std::vec
   // Tag cosmics which match CRT tracks
   if(fApplyCrtTrackCut){
     auto crtTrackHandle = event.getValidHandle<std::vector<sbn::crt::CRTTrack>>(fCrtTrackModuleLabel);
-    std::vector<sbn::crt::CRTTrack> crtTracks = (*crtTrackHandle);
 
-    if(ctTag.CrtTrackCosmicId(detProp, track, crtTracks, event)) return true;
+    if(ctTag.CrtTrackCosmicId(detProp, track, *crtTrackHandle, event)) return true;
   }
 
   // Tag cosmics which match CRT hits
   if(fApplyCrtHitCut){
     auto crtHitHandle = event.getValidHandle<std::vector<sbn::crt::CRTHit>>(fCrtHitModuleLabel);
-    std::vector<sbn::crt::CRTHit> crtHits = (*crtHitHandle);
 
-    if(chTag.CrtHitCosmicId(detProp, track, crtHits, event)) return true;
+    if(chTag.CrtHitCosmicId(detProp, track, *crtHitHandle, event)) return true;
   }
 
   return false;
@@ -176,29 +212,25 @@ bool CosmicIdAlg::CosmicId(recob::Track track, const art::Event& event, std::vec
 
 // Run cuts to decide if PFParticle looks like a cosmic
 bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
-                           recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> > pfParticleMap, const art::Event& event, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1){
+                           const recob::PFParticle& pfparticle, const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap, const art::Event& event, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1){
 
   // Get associations between pfparticles and tracks
-  art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
-  event.getByLabel(fPandoraLabel, pfParticleHandle);
-  art::FindManyP< recob::Track > pfPartToTrackAssoc(pfParticleHandle, event, fTpcTrackModuleLabel);
+  const art::FindManyP< recob::Track >& pfPartToTrackAssoc = PFParticleTracks(event);
 
-  // Get associations between tracks and hits/calorimetry collections
-  auto tpcTrackHandle = event.getValidHandle<std::vector<recob::Track>>(fTpcTrackModuleLabel);
-  art::FindManyP<recob::Hit> findManyHits(tpcTrackHandle, event, fTpcTrackModuleLabel);
-  art::FindManyP<anab::Calorimetry> findManyCalo(tpcTrackHandle, event, fCaloModuleLabel);
+  // Get associations between tracks and hits/calorimetry collections, shared by the whole event
+  const art::FindManyP<recob::Hit>& findManyHits = *fEventCache.findManyHits;
+  const art::FindManyP<anab::Calorimetry>& findManyCalo = *fEventCache.findManyCalo;
 
   // Loop over all the daughters of the PFParticles and get associated tracks
-  std::vector<recob::Track> nuTracks;
+  std::vector<art::Ptr<recob::Track>> nuTracks;
   for (const size_t daughterId : pfparticle.Daughters()){
   
     // Get tracks associated with daughter
     art::Ptr<recob::PFParticle> pParticle = pfParticleMap.at(daughterId);
-    const std::vector< art::Ptr<recob::Track> > associatedTracks(pfPartToTrackAssoc.at(pParticle.key()));
+    const std::vector< art::Ptr<recob::Track> >& associatedTracks = pfPartToTrackAssoc.at(pParticle.key());
     if(associatedTracks.size() != 1) continue;
 
-    recob::Track track = *associatedTracks.front();
-    nuTracks.push_back(track);
+    nuTracks.push_back(associatedTracks.front());
     
     
   }
@@ -218,11 +250,11 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
 
   // Sort all daughter tracks by length
   std::sort(nuTracks.begin(), nuTracks.end(), [](auto& left, auto& right){
-              return left.Length() > right.Length();});
+              return left->Length() > right->Length();});
 
   // Select longest track as the cosmic candidate
-  recob::Track track = nuTracks[0];
-  std::vector<art::Ptr<recob::Hit>> hits = findManyHits.at(track.ID());
+  const recob::Track& track = *nuTracks[0];
+  const std::vector<art::Ptr<recob::Hit>>& hits = findManyHits.at(track.ID());
 
   // Tag cosmics which enter and exit the TPC
   if(fApplyFiducialCut){
@@ -239,23 +271,17 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
   // Tag cosmics which match CRT tracks
   if(fApplyCrtTrackCut){
     auto crtTrackHandle = event.getValidHandle<std::vector<sbn::crt::CRTTrack>>(fCrtTrackModuleLabel);
-    std::vector<sbn::crt::CRTTrack> crtTracks = (*crtTrackHandle);
 
-    if(ctTag.CrtTrackCosmicId(detProp, track, crtTracks, event)) return true;
+    if(ctTag.CrtTrackCosmicId(detProp, track, *crtTrackHandle, event)) return true;
   }
 
   // Tag cosmics which cross the CPA
   if(fApplyCpaCrossCut){
-    std::vector<recob::Track> tracks;
-    for(auto const& tpcTrack : (*tpcTrackHandle)){
-      tracks.push_back(tpcTrack);
-    }
-
-    if(ccTag.CpaCrossCosmicId(detProp, track, tracks, findManyHits)) return true;
+    if(ccTag.CpaCrossCosmicId(detProp, track, CpaStitchIndex(), findManyHits)) return true;
   }
 
   // Find second longest particle if trying to merge tracks
-  std::vector<std::pair<recob::Track, double>> secondaryTracks;
+  std::vector<std::pair<art::Ptr<recob::Track>, double>> secondaryTracks;
   if(fUseTrackAngleVeto && nuTracks.size() > 1){
     TVector3 start = track.Vertex<TVector3>();
     TVector3 end = track.End<TVector3>();
@@ -263,7 +289,7 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
     // Loop over the secondary tracks
     // Find smallest angle between primary track and any secondary tracks above a certain length
     for(size_t i = 1; i < nuTracks.size(); i++){
-      recob::Track track2 = nuTracks[i];
+      const recob::Track& track2 = *nuTracks[i];
       // Only consider secondary tracks longer than some limit (try to exclude michel electrons)
       if(track2.Length() < fMinSecondTrackLength) continue;
       TVector3 start2 = track2.Vertex<TVector3>();
@@ -271,7 +297,7 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
       // Do they share the same vertex? (no delta rays)
       if((start-start2).Mag() < fMinVertexDistance){ 
         double angle = (end - start).Angle(end2 - start2);
-        secondaryTracks.push_back(std::make_pair(track2, angle));
+        secondaryTracks.push_back(std::make_pair(nuTracks[i], angle));
       }
     }
   }
@@ -283,7 +309,7 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
               return left.second < right.second;});
     // If secondary track angle is compatible with split track (near 180) then try to merge
     if(secondaryTracks[0].second > fMinMergeAngle){
-      recob::Track track2 = secondaryTracks[0].first;
+      const recob::Track& track2 = *secondaryTracks[0].first;
 
       // Check fiducial volume containment assuming merged track
       if(fApplyFiducialCut){
@@ -293,10 +319,10 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
       // Check if stopping applies to merged track
       if(fApplyStoppingCut){
         // Apply stopping cut to the longest track
-        std::vector<art::Ptr<anab::Calorimetry>> calos = findManyCalo.at(track.ID());
+        const std::vector<art::Ptr<anab::Calorimetry>>& calos = findManyCalo.at(track.ID());
         if(spTag.StoppingParticleCosmicId(track, calos)) return true;
         // Apply stopping cut assuming the tracks are split
-        std::vector<art::Ptr<anab::Calorimetry>> calos2 = findManyCalo.at(track2.ID());
+        const std::vector<art::Ptr<anab::Calorimetry>>& calos2 = findManyCalo.at(track2.ID());
         if(spTag.StoppingParticleCosmicId(track, track2, calos, calos2)) return true;
       }
 
@@ -305,7 +331,7 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
         // Apply apa crossing cut to the longest track
         if(acTag.ApaCrossCosmicId(detProp, track, hits, t0Tpc0, t0Tpc1)) return true;
         // Also apply to secondary track FIXME need to check primary track doesn't go out of bounds
-        std::vector<art::Ptr<recob::Hit>> hits2 = findManyHits.at(track2.ID());
+        const std::vector<art::Ptr<recob::Hit>>& hits2 = findManyHits.at(track2.ID());
         if(acTag.ApaCrossCosmicId(detProp, track2, hits2, t0Tpc0, t0Tpc1)) return true;
       }
 
@@ -313,9 +339,8 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
       if(fApplyCrtHitCut){
         // Apply crt hit match cut to both tracks
 	auto crtHitHandle = event.getValidHandle<std::vector<sbn::crt::CRTHit>>(fCrtHitModuleLabel);
-        std::vector<sbn::crt::CRTHit> crtHits = (*crtHitHandle);
-        if(chTag.CrtHitCosmicId(detProp, track, crtHits, event)) return true;
-        if(chTag.CrtHitCosmicId(detProp, track2, crtHits, event)) return true;
+        if(chTag.CrtHitCosmicId(detProp, track, *crtHitHandle, event)) return true;
+        if(chTag.CrtHitCosmicId(detProp, track2, *crtHitHandle, event)) return true;
       }
     }
     // Don't apply other cuts if angle between tracks is consistent with neutrino interaction
@@ -326,8 +351,7 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
 
     // Tag cosmics which enter the TPC and stop
     if(fApplyStoppingCut){
-      std::vector<art::Ptr<anab::Calorimetry>> calos = findManyCalo.at(track.ID());
-      if(spTag.StoppingParticleCosmicId(track, calos)) return true;
+      if(spTag.StoppingParticleCosmicId(track, findManyCalo.at(track.ID()))) return true;
     }
 
     // Tag cosmics which cross the APA
@@ -338,9 +362,8 @@ bool CosmicIdAlg::CosmicId(detinfo::DetectorPropertiesData const& detProp,
     // Tag cosmics which match CRT hits
     if(fApplyCrtHitCut){
       auto crtHitHandle = event.getValidHandle<std::vector<sbn::crt::CRTHit>>(fCrtHitModuleLabel);
-      std::vector<sbn::crt::CRTHit> crtHits = (*crtHitHandle);
 
-      if(chTag.CrtHitCosmicId(detProp, track, crtHits, event)) return true;
+      if(chTag.CrtHitCosmicId(detProp, track, *crtHitHandle, event)) return true;
     }
   }
 
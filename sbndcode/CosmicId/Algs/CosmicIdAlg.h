@@ -27,6 +27,8 @@
 #include "fhiclcpp/types/Atom.h"
 #include "art/Framework/Principal/Handle.h" 
 #include "canvas/Persistency/Common/Ptr.h" 
+#include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Provenance/EventID.h"
 
 // LArSoft
 #include "lardataobj/RecoBase/Track.h"
@@ -38,6 +40,7 @@
 // c++
 #include <vector>
 #include <utility>
+#include <optional>
 
 
 namespace sbnd{
@@ -212,11 +215,11 @@ namespace sbnd{
     void ResetCuts();
 
     // Run cuts to decide if track looks like a cosmic
-    bool CosmicId(recob::Track track, const art::Event& event, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1);
+    bool CosmicId(const recob::Track& track, const art::Event& event, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1);
 
     // Run cuts to decide if PFParticle looks like a cosmic
     bool CosmicId(detinfo::DetectorPropertiesData const& detProp,
-                  recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> > pfParticleMap, const art::Event& event, std::vector<double> t0Tpc0, std::vector<double> t0Tpc1);
+                  const recob::PFParticle& pfparticle, const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap, const art::Event& event, const FlashTimeIndex& t0Tpc0, const FlashTimeIndex& t0Tpc1);
 
     // Getters for the underlying algorithms
     StoppingParticleCosmicIdAlg StoppingAlg() const {return spTag;}
@@ -227,9 +230,30 @@ namespace sbnd{
 
   private:
 
+    // Products and associations shared by all the CosmicId calls of one event
+    struct EventCache {
+      art::EventID eventId;
+      std::optional<art::ValidHandle<std::vector<recob::Track>>> tpcTrackHandle;
+      std::optional<art::FindManyP<recob::Hit>> findManyHits;
+      std::optional<art::FindManyP<anab::Calorimetry>> findManyCalo;
+      std::optional<art::FindManyP<recob::Track>> pfPartToTrackAssoc;
+      std::optional<CpaCrossCosmicIdAlg::StitchIndex> cpaStitchIndex;
+    };
+
+    // Fill the cache the first time an event is seen
+    void PrepareEvent(const art::Event& event);
+
+    // Get the PFParticle to track associations, read once per event
+    const art::FindManyP<recob::Track>& PFParticleTracks(const art::Event& event);
+
+    // Get the tracks indexed for CPA stitching, made once per event
+    const CpaCrossCosmicIdAlg::StitchIndex& CpaStitchIndex();
+
     double fBeamTimeMin;
     double fBeamTimeMax;
 
+    EventCache fEventCache;
+
     art::InputTag fTpcTrackModuleLabel;
     art::InputTag fPandoraLabel;
     art::InputTag fCrtHitModuleLabel;
@@ -2,6 +2,10 @@
 
 #include "lardataalg/DetectorInfo/DetectorPropertiesData.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 namespace sbnd{
 
 CpaCrossCosmicIdAlg::CpaCrossCosmicIdAlg(const Config& config){
@@ -38,110 +42,181 @@ void CpaCrossCosmicIdAlg::reconfigure(const Config& config){
   return;
 }
 
-// Calculate the time by stitching tracks across the CPA
-  std::pair<double, bool> CpaCrossCosmicIdAlg::T0FromCpaStitching(detinfo::DetectorPropertiesData const& detProp,
-                                                                  recob::Track t1, std::vector<recob::Track> tracks){
-  
-  std::vector<std::pair<double, std::pair<double, bool>>> matchCandidates;
-  double matchedTime = -99999;
-  std::pair<double, bool> returnVal = std::make_pair(matchedTime, false);
+// Index of a (|x|, y, z) cell, shifted by (dx, dy, dz) cells
+long long CpaCrossCosmicIdAlg::StitchIndex::CellKey(double x, double y, double z, int dx, int dy, int dz) const{
 
-  TVector3 trk1Front = t1.Vertex<TVector3>();
-  TVector3 trk1Back = t1.End<TVector3>();
-  double closestX1 = std::min(std::abs(trk1Front.X()), std::abs(trk1Back.X()));
+  // 2^20 cells along each axis are plenty for any cell size that makes sense
+  constexpr long long kCells = 1 << 20;
+  auto cell = [kCells](double v, double size, int shift){
+    long long c = static_cast<long long>(std::floor(v / size)) + shift + kCells / 2;
+    return std::clamp(c, 0LL, kCells - 1);
+  };
+  return (cell(x, fCellX, dx) * kCells + cell(y, fCellYZ, dy)) * kCells + cell(z, fCellYZ, dz);
 
-  // Loop over all tracks in other TPC
-  for(auto & track : tracks){
-
-    TVector3 trk2Front = track.Vertex<TVector3>();
-    TVector3 trk2Back = track.End<TVector3>();
-    double closestX2 = std::min(std::abs(trk2Front.X()), std::abs(trk2Back.X()));
-
-    // Try to match if their ends have similar x positions
-    if(std::abs(closestX1-closestX2) > fCpaXDifference) continue;
-
-    // Find which point is closest to CPA
-    TVector3 t1Pos = trk1Front;
-    TVector3 t1PosEnd = trk1Back;
-    TVector3 t1Dir = t1.VertexDirection<TVector3>();
-    if(std::abs(trk1Back.X()) == closestX1){ 
-      t1Pos = trk1Back;
-      t1PosEnd = trk1Front;
-      t1Dir = t1.EndDirection<TVector3>();
-    }
+}
 
-    TVector3 t2Pos = trk2Front;
-    TVector3 t2PosEnd = trk2Back;
-    TVector3 t2Dir = track.VertexDirection<TVector3>();
-    if(std::abs(trk2Back.X()) == closestX2){ 
-      t2Pos = trk2Back;
-      t2PosEnd = trk2Front;
-      t2Dir = track.EndDirection<TVector3>();
+// Positions in Ends(tpc) of the ends in the cells around end, in increasing order
+void CpaCrossCosmicIdAlg::StitchIndex::Neighbours(int tpc, const StitchEnd& end, std::vector<size_t>& out) const{
+
+  out.clear();
+  const std::vector<std::pair<long long, size_t>>& cells = fCells[tpc];
+  for(int dx = -1; dx <= 1; dx++){
+    for(int dy = -1; dy <= 1; dy++){
+      for(int dz = -1; dz <= 1; dz++){
+        long long key = CellKey(end.closestX, end.pos.Y(), end.pos.Z(), dx, dy, dz);
+        auto range = std::equal_range(cells.begin(), cells.end(), std::make_pair(key, size_t(0)),
+                                      [](auto const& a, auto const& b){ return a.first < b.first; });
+        for(auto it = range.first; it != range.second; ++it) out.push_back(it->second);
+      }
     }
+  }
+  // Clamped keys at the edges can repeat a cell
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+
+}
 
-    // Calculate the angle between the tracks
-    double trkCos = std::abs(t1Dir.Dot(t2Dir));
-    // Calculate the distance between the tracks at the middle of the CPA
-    t1Pos[0] = 0.;
-    t2Pos[0] = 0.;
-    double dist = (t1Pos-t2Pos).Mag();
+// End of a track closest to the CPA
+CpaCrossCosmicIdAlg::StitchEnd CpaCrossCosmicIdAlg::MakeStitchEnd(const recob::Track& track, size_t index) const{
+
+  TVector3 trkFront = track.Vertex<TVector3>();
+  TVector3 trkBack = track.End<TVector3>();
+  double closestX = std::min(std::abs(trkFront.X()), std::abs(trkBack.X()));
+
+  // Find which point is closest to CPA
+  StitchEnd end {index, trkFront, trkBack, track.VertexDirection<TVector3>(), closestX};
+  if(std::abs(trkBack.X()) == closestX){ 
+    end.pos = trkBack;
+    end.posEnd = trkFront;
+    end.dir = track.EndDirection<TVector3>();
+  }
+  return end;
+
+}
+
+// Whether the two ends can be stitched, with the cosine of their angle
+bool CpaCrossCosmicIdAlg::StitchMatch(const StitchEnd& end1, const StitchEnd& end2, double& trkCos) const{
+
+  // Try to match if their ends have similar x positions
+  if(std::abs(end1.closestX-end2.closestX) > fCpaXDifference) return false;
+
+  // Calculate the angle between the tracks
+  trkCos = std::abs(end1.dir.Dot(end2.dir));
+  // Calculate the distance between the tracks at the middle of the CPA
+  TVector3 t1Pos = end1.pos;
+  TVector3 t2Pos = end2.pos;
+  t1Pos[0] = 0.;
+  t2Pos[0] = 0.;
+  double dist = (t1Pos-t2Pos).Mag();
+
+  // If the distance and angle are within the acceptable limits then record candidate
+  return dist < fCpaStitchDistance && trkCos > cos(TMath::Pi() * fCpaStitchAngle / 180.);
+
+}
+
+// Stitching time of end1 and whether the merged track exits, with the best candidate
+std::pair<double, bool> CpaCrossCosmicIdAlg::T0FromCandidates(detinfo::DetectorPropertiesData const& detProp, const StitchEnd& end1,
+                                                              const std::vector<StitchEnd>& ends, const std::vector<size_t>& candidates) const{
+
+  double matchedTime = -99999;
+  std::pair<double, bool> returnVal = std::make_pair(matchedTime, false);
+
+  // Choose the candidate with the smallest cosine, the first one on a tie
+  const StitchEnd* best = nullptr;
+  double bestCos = 0.;
+  for(size_t i : candidates){
+    double trkCos = 0.;
+    if(!StitchMatch(end1, ends[i], trkCos)) continue;
+    if(!best || trkCos < bestCos){
+      best = &ends[i];
+      bestCos = trkCos;
+    }
+  }
 
+  if(best){
     // Does the track enter and exit the fiducial volume when merged?
-    geo::Point_t mergeStart {t1PosEnd.X(), t1PosEnd.Y(), t1PosEnd.Z()};
-    geo::Point_t mergeEnd {t2PosEnd.X(), t2PosEnd.Y(), t2PosEnd.Z()};
+    geo::Point_t mergeStart {end1.posEnd.X(), end1.posEnd.Y(), end1.posEnd.Z()};
+    geo::Point_t mergeEnd {best->posEnd.X(), best->posEnd.Y(), best->posEnd.Z()};
     bool exits = false;
     if(!fTpcGeo.InFiducial(mergeStart, fMinX, fMinY, fMinZ, fMaxX, fMaxY, fMaxZ) 
        && !fTpcGeo.InFiducial(mergeEnd, fMinX, fMinY, fMinZ, fMaxX, fMaxY, fMaxZ)) exits = true;
 
-    // If the distance and angle are within the acceptable limits then record candidate
-    if(dist < fCpaStitchDistance && trkCos > cos(TMath::Pi() * fCpaStitchAngle / 180.)){ 
-      matchCandidates.push_back(std::make_pair(trkCos, std::make_pair(closestX1, exits)));
-    }
-  }
-
-  // Choose the candidate with the smallest angle
-  if(matchCandidates.size() > 0){
-    std::sort(matchCandidates.begin(), matchCandidates.end(), [](auto& left, auto& right){
-              return left.first < right.first;});
-    double shiftX = matchCandidates[0].second.first;
+    double shiftX = end1.closestX;
     matchedTime = -((shiftX - fTpcGeo.CpaWidth())/detProp.DriftVelocity()); //subtract CPA width
-    returnVal = std::make_pair(matchedTime, matchCandidates[0].second.second);
+    returnVal = std::make_pair(matchedTime, exits);
   }
 
   return returnVal;
 }
 
-// Tag tracks as cosmics from CPA stitching t0
-bool CpaCrossCosmicIdAlg::CpaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
-                                           recob::Track track, std::vector<recob::Track> tracks, art::FindManyP<recob::Hit> hitAssoc){
+// Calculate the time by stitching tracks across the CPA
+  std::pair<double, bool> CpaCrossCosmicIdAlg::T0FromCpaStitching(detinfo::DetectorPropertiesData const& detProp,
+                                                                  const recob::Track& t1, const std::vector<recob::Track>& tracks){
+
+  // Loop over all tracks in other TPC
+  std::vector<StitchEnd> ends;
+  ends.reserve(tracks.size());
+  for(size_t i = 0; i < tracks.size(); i++) ends.push_back(MakeStitchEnd(tracks[i], i));
+  std::vector<size_t> candidates(ends.size());
+  std::iota(candidates.begin(), candidates.end(), 0);
+
+  return T0FromCandidates(detProp, MakeStitchEnd(t1, 0), ends, candidates);
+}
+
+// Index the tracks which can be stitched across the CPA, once per event
+CpaCrossCosmicIdAlg::StitchIndex CpaCrossCosmicIdAlg::MakeStitchIndex(const std::vector<recob::Track>& tracks, const art::FindManyP<recob::Hit>& hitAssoc){
+
+  StitchIndex index;
+  // Cells as large as the matching limits, so that matches are in neighbouring cells
+  if(fCpaXDifference > 0) index.fCellX = fCpaXDifference;
+  if(fCpaStitchDistance > 0) index.fCellYZ = fCpaStitchDistance;
 
   // Sort tracks by tpc
-  std::vector<recob::Track> tpcTracksTPC0;
-  std::vector<recob::Track> tpcTracksTPC1;
-  // Loop over the tpc tracks
-  for(auto const& tpcTrack : tracks){
+  for(size_t i = 0; i < tracks.size(); i++){
+    const recob::Track& tpcTrack = tracks[i];
     // Work out where the associated wire hits were detected
-    std::vector<art::Ptr<recob::Hit>> hits = hitAssoc.at(tpcTrack.ID());
-    int tpc = fTpcGeo.DetectedInTPC(hits);
+    int tpc = fTpcGeo.DetectedInTPC(hitAssoc.at(tpcTrack.ID()));
     double startX = tpcTrack.Start().X();
     double endX = tpcTrack.End().X();
-    if(tpc == 0 && !(startX>0 || endX>0)) tpcTracksTPC0.push_back(tpcTrack);
-    else if(tpc == 1 && !(startX<0 || endX<0)) tpcTracksTPC1.push_back(tpcTrack);
+    if(tpc == 0 && !(startX>0 || endX>0)) index.fEnds[0].push_back(MakeStitchEnd(tpcTrack, i));
+    else if(tpc == 1 && !(startX<0 || endX<0)) index.fEnds[1].push_back(MakeStitchEnd(tpcTrack, i));
   }
 
-  std::vector<art::Ptr<recob::Hit>> hits = hitAssoc.at(track.ID());
-  int tpc = fTpcGeo.DetectedInTPC(hits);
+  for(int tpc = 0; tpc < 2; tpc++){
+    auto& cells = index.fCells[tpc];
+    const auto& ends = index.fEnds[tpc];
+    cells.reserve(ends.size());
+    for(size_t i = 0; i < ends.size(); i++)
+      cells.emplace_back(index.CellKey(ends[i].closestX, ends[i].pos.Y(), ends[i].pos.Z(), 0, 0, 0), i);
+    std::sort(cells.begin(), cells.end());
+  }
+
+  return index;
+}
+
+// Tag tracks as cosmics from CPA stitching t0
+bool CpaCrossCosmicIdAlg::CpaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
+                                           const recob::Track& track, const std::vector<recob::Track>& tracks, const art::FindManyP<recob::Hit>& hitAssoc){
+
+  return CpaCrossCosmicId(detProp, track, MakeStitchIndex(tracks, hitAssoc), hitAssoc);
+
+}
+
+// Tag tracks as cosmics from CPA stitching t0, with the tracks indexed once per event
+bool CpaCrossCosmicIdAlg::CpaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
+                                           const recob::Track& track, const StitchIndex& index, const art::FindManyP<recob::Hit>& hitAssoc){
+
+  int tpc = fTpcGeo.DetectedInTPC(hitAssoc.at(track.ID()));
 
   double stitchTime = -99999;
   bool stitchExit = false;
-  // Try to match tracks from CPA crossers
-  if(tpc == 0){
-    std::pair<double, bool> stitchResults = T0FromCpaStitching(detProp, track, tpcTracksTPC1);
-    stitchTime = stitchResults.first;
-    stitchExit = stitchResults.second;
-  }
-  else if(tpc == 1){
-    std::pair<double, bool> stitchResults = T0FromCpaStitching(detProp, track, tpcTracksTPC0);
+  // Try to match tracks from CPA crossers in the other TPC
+  if(tpc == 0 || tpc == 1){
+    int other = 1 - tpc;
+    StitchEnd end = MakeStitchEnd(track, 0);
+    std::vector<size_t> candidates;
+    index.Neighbours(other, end, candidates);
+    std::pair<double, bool> stitchResults = T0FromCandidates(detProp, end, index.Ends(other), candidates);
     stitchTime = stitchResults.first;
     stitchExit = stitchResults.second;
   }
@@ -28,6 +28,9 @@ namespace detinfo {
   class DetectorPropertiesData;
 }
 
+// ROOT
+#include "TVector3.h"
+
 // c++
 #include <vector>
 #include <utility>
@@ -97,6 +100,32 @@ namespace sbnd{
 
     };
 
+    // End of a track closest to the CPA, as used for stitching
+    struct StitchEnd {
+      size_t   track;    // index of the track in its collection
+      TVector3 pos;      // end closest to the CPA
+      TVector3 posEnd;   // the other end
+      TVector3 dir;      // direction at pos
+      double   closestX; // |x| of pos
+    };
+
+    // The tracks of each TPC that can be stitched across the CPA, with their
+    // ends bucketed in (|x|, y, z) so that a track is only compared with the
+    // tracks ending nearby on the other side. Made once per event.
+    class StitchIndex {
+    public:
+      const std::vector<StitchEnd>& Ends(int tpc) const { return fEnds[tpc]; }
+      // Positions in Ends(tpc) of the ends in the cells around end, in increasing order
+      void Neighbours(int tpc, const StitchEnd& end, std::vector<size_t>& out) const;
+    private:
+      friend class CpaCrossCosmicIdAlg;
+      long long CellKey(double x, double y, double z, int dx, int dy, int dz) const;
+      double fCellX = 1.;
+      double fCellYZ = 1.;
+      std::vector<StitchEnd> fEnds[2];
+      std::vector<std::pair<long long, size_t>> fCells[2]; // (cell, position in fEnds), sorted
+    };
+
     CpaCrossCosmicIdAlg(const Config& config);
 
     CpaCrossCosmicIdAlg(const fhicl::ParameterSet& pset) :
@@ -110,14 +139,31 @@ namespace sbnd{
 
     // Calculate the time by stitching tracks across the CPA
     std::pair<double, bool> T0FromCpaStitching(detinfo::DetectorPropertiesData const& detProp,
-                                               recob::Track t1, std::vector<recob::Track> tracks);
+                                               const recob::Track& t1, const std::vector<recob::Track>& tracks);
+
+    // Index the tracks which can be stitched across the CPA, once per event
+    StitchIndex MakeStitchIndex(const std::vector<recob::Track>& tracks, const art::FindManyP<recob::Hit>& hitAssoc);
 
     // Tag tracks as cosmics from CPA stitching t0
     bool CpaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
-                          recob::Track track, std::vector<recob::Track> tracks, art::FindManyP<recob::Hit> hitAssoc);
+                          const recob::Track& track, const std::vector<recob::Track>& tracks, const art::FindManyP<recob::Hit>& hitAssoc);
+
+    // Same, with the tracks indexed by MakeStitchIndex
+    bool CpaCrossCosmicId(detinfo::DetectorPropertiesData const& detProp,
+                          const recob::Track& track, const StitchIndex& index, const art::FindManyP<recob::Hit>& hitAssoc);
 
   private:
 
+    StitchEnd MakeStitchEnd(const recob::Track& track, size_t index) const;
+
+    // Whether the two ends can be stitched, with the cosine of their angle
+    bool StitchMatch(const StitchEnd& end1, const StitchEnd& end2, double& trkCos) const;
+
+    // Stitching time of end1 and whether the merged track exits, with the
+    // best of the candidate ends (in increasing order of their tracks)
+    std::pair<double, bool> T0FromCandidates(detinfo::DetectorPropertiesData const& detProp, const StitchEnd& end1,
+                                             const std::vector<StitchEnd>& ends, const std::vector<size_t>& candidates) const;
+
     double fCpaStitchDistance;
     double fCpaStitchAngle;
     double fCpaXDifference;
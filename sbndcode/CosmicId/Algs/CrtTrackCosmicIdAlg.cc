@@ -31,7 +31,7 @@ void CrtTrackCosmicIdAlg::reconfigure(const Config& config){
 
 // Tags track as cosmic if it matches a CRTTrack
 bool CrtTrackCosmicIdAlg::CrtTrackCosmicId(detinfo::DetectorPropertiesData const& detProp,
-                                           recob::Track track, std::vector<sbn::crt::CRTTrack> crtTracks, const art::Event& event){
+                                           const recob::Track& track, const std::vector<sbn::crt::CRTTrack>& crtTracks, const art::Event& event){
 
   // Get the closest matching CRT track ID
   int crtID = trackMatchAlg.GetMatchedCRTTrackId(detProp, track, crtTracks, event);
@@ -76,7 +76,7 @@ namespace sbnd{
 
     // Tags track as cosmic if it matches a CRTTrack
     bool CrtTrackCosmicId(detinfo::DetectorPropertiesData const& detProp,
-                          recob::Track track, std::vector<sbn::crt::CRTTrack> crtTracks, const art::Event& event);
+                          const recob::Track& track, const std::vector<sbn::crt::CRTTrack>& crtTracks, const art::Event& event);
 
     // Getter for matching algorithm
     CRTTrackMatchAlg TrackAlg() const {return trackMatchAlg;}
@@ -39,7 +39,7 @@ bool FiducialVolumeCosmicIdAlg::InFiducial(geo::Point_t point){
 }
 
 // Check both start and end points of track are in fiducial volume
-bool FiducialVolumeCosmicIdAlg::FiducialVolumeCosmicId(recob::Track track){
+bool FiducialVolumeCosmicIdAlg::FiducialVolumeCosmicId(const recob::Track& track){
   
   bool startInFiducial = InFiducial(track.Vertex());
 
@@ -66,7 +66,7 @@ namespace sbnd{
     bool InFiducial(geo::Point_t point);
 
     // Check both start and end points of track are in fiducial volume
-    bool FiducialVolumeCosmicId(recob::Track track);
+    bool FiducialVolumeCosmicId(const recob::Track& track);
 
   private:
 
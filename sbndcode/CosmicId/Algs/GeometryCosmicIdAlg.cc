@@ -25,7 +25,7 @@ void GeometryCosmicIdAlg::reconfigure(const Config& config){
 }
 
 // Remove any tracks in different TPC to beam activity
-bool GeometryCosmicIdAlg::GeometryCosmicId(recob::Track track, std::vector<art::Ptr<recob::Hit>> hits, bool tpc0Flash, bool tpc1Flash){
+bool GeometryCosmicIdAlg::GeometryCosmicId(const recob::Track& track, const std::vector<art::Ptr<recob::Hit>>& hits, bool tpc0Flash, bool tpc1Flash){
 
   // Remove any tracks that are detected in one TPC and reconstructed in another
   int tpc = fTpcGeo.DetectedInTPC(hits);
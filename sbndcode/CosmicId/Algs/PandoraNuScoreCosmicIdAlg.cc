@@ -28,58 +28,66 @@ namespace sbnd{
     return;
   }
 
-  // Finds any t0s associated with track by pandora, tags if outside beam
-  bool PandoraNuScoreCosmicIdAlg::PandoraNuScoreCosmicId(recob::Track track, const art::Event& event){
+  // Index of the PFParticles of the event, with their metadata and tracks, made once per event
+  const PFParticleIndex& PandoraNuScoreCosmicIdAlg::EventIndex(const art::Event& event){
+
+    if(fEventCache.pfpIndex && fEventCache.eventId == event.id()) return *fEventCache.pfpIndex;
+
+    fEventCache.pfpIndex.reset();
+    fEventCache.PFPMetaDataAssoc.reset();
+    fEventCache.pfPartToTrackAssoc.reset();
 
     // Get the pfps and associations
-    art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
-    event.getByLabel(fPandoraLabel, pfParticleHandle);
-    art::FindManyP<recob::Track> pfPartToTrackAssoc(pfParticleHandle, event, fTpcTrackModuleLabel);
-    art::FindManyP<larpandoraobj::PFParticleMetadata> PFPMetaDataAssoc(pfParticleHandle, event, fPandoraLabel);
-
-    // Loop over all the pfps
-    for(auto const &pfp : (*pfParticleHandle)){
-      // Get the associated track if there is one
-      const std::vector< art::Ptr<recob::Track> > associatedTracks(pfPartToTrackAssoc.at(pfp.Self()));
-      if(associatedTracks.size() != 1) continue;
-      recob::Track trk = *associatedTracks.front();
-      if(trk.ID() != track.ID()) continue;
-
-      recob::PFParticle PFPNeutrino = GetPFPNeutrino(pfp, (*pfParticleHandle));
-
-      float pfpNuScore = GetPandoraNuScore(PFPNeutrino, PFPMetaDataAssoc);
-      if (pfpNuScore < fNuScoreCut){
-        return true;
-      } else {
-        return false;
-      }
-    }
-    return false;
+    event.getByLabel(fPandoraLabel, fEventCache.pfParticleHandle);
+    fEventCache.pfPartToTrackAssoc.emplace(fEventCache.pfParticleHandle, event, fTpcTrackModuleLabel);
+    fEventCache.PFPMetaDataAssoc.emplace(fEventCache.pfParticleHandle, event, fPandoraLabel);
+    fEventCache.pfpIndex.emplace(*fEventCache.pfParticleHandle, *fEventCache.PFPMetaDataAssoc, &*fEventCache.pfPartToTrackAssoc);
+    fEventCache.eventId = event.id();
+
+    return *fEventCache.pfpIndex;
 
   }
 
-  // Finds any t0s associated with pfparticle by pandora, tags if outside beam
-  bool PandoraNuScoreCosmicIdAlg::PandoraNuScoreCosmicId(recob::PFParticle pfparticle,
-      std::map< size_t, art::Ptr<recob::PFParticle> > pfParticleMap, const art::Event& event){
+  // Tags the PFParticle at position in the index if the nu score of its slice is below the cut
+  bool PandoraNuScoreCosmicIdAlg::PandoraNuScoreCosmicId(const PFParticleIndex& pfpIndex, size_t position) const{
+
+    float pfpNuScore = pfpIndex.SliceNuScore(position);
+    return pfpNuScore < fNuScoreCut;
+
+  }
+
+  // Finds any t0s associated with track by pandora, tags if outside beam
+  bool PandoraNuScoreCosmicIdAlg::PandoraNuScoreCosmicId(const recob::Track& track, const art::Event& event){
 
-    // Get pfp associations to t0s
-    art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
-    event.getByLabel(fPandoraLabel, pfParticleHandle);
+    // Get the pfp the track belongs to
+    const PFParticleIndex& pfpIndex = EventIndex(event);
+    size_t position = pfpIndex.TrackPosition(track.ID());
+    if(position == PFParticleIndex::kNotFound) return false;
 
-    art::FindManyP<larpandoraobj::PFParticleMetadata> PFPMetaDataAssoc(pfParticleHandle, event, fPandoraLabel);
+    return PandoraNuScoreCosmicId(pfpIndex, position);
+
+  }
 
-    recob::PFParticle PFPNeutrino = GetPFPNeutrino(pfparticle, pfParticleMap);
+  // Finds any t0s associated with pfparticle by pandora, tags if outside beam
+  bool PandoraNuScoreCosmicIdAlg::PandoraNuScoreCosmicId(const recob::PFParticle& pfparticle,
+      const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap, const art::Event& event){
 
-    float pfpNuScore = GetPandoraNuScore(PFPNeutrino, PFPMetaDataAssoc);
+    const PFParticleIndex& pfpIndex = EventIndex(event);
+    size_t position = pfpIndex.Position(pfparticle.Self());
 
-    if (pfpNuScore < fNuScoreCut){
-      return true;
+    // A pfparticle from another collection is looked up in the map given
+    if(position == PFParticleIndex::kNotFound){
+      recob::PFParticle PFPNeutrino = GetPFPNeutrino(pfparticle, pfParticleMap);
+      float pfpNuScore = GetPandoraNuScore(PFPNeutrino, *fEventCache.PFPMetaDataAssoc);
+      return pfpNuScore < fNuScoreCut;
     }
-    return false;
+
+    return PandoraNuScoreCosmicId(pfpIndex, position);
   }
 
 
-  recob::PFParticle PandoraNuScoreCosmicIdAlg::GetPFPNeutrino(recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap){
+  recob::PFParticle PandoraNuScoreCosmicIdAlg::GetPFPNeutrino(const recob::PFParticle& pfparticle,
+      const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap){
 
     if ((pfparticle.PdgCode()==12) ||(pfparticle.PdgCode()==14)){
       return pfparticle;
@@ -89,7 +97,7 @@ namespace sbnd{
     }
   }
 
-  recob::PFParticle PandoraNuScoreCosmicIdAlg::GetPFPNeutrino(recob::PFParticle pfparticle,
+  recob::PFParticle PandoraNuScoreCosmicIdAlg::GetPFPNeutrino(const recob::PFParticle& pfparticle,
       const std::vector<recob::PFParticle>& pfpVec){
 
     if ((pfparticle.PdgCode()==12) ||(pfparticle.PdgCode()==14)){
@@ -107,10 +115,18 @@ namespace sbnd{
     }
   }
 
-  float PandoraNuScoreCosmicIdAlg::GetPandoraNuScore(recob::PFParticle pfparticle,
-      art::FindManyP<larpandoraobj::PFParticleMetadata> PFPMetaDataAssoc){
+  recob::PFParticle PandoraNuScoreCosmicIdAlg::GetPFPNeutrino(const recob::PFParticle& pfparticle,
+      const PFParticleIndex& pfpIndex){
+
+    size_t position = pfpIndex.Position(pfparticle.Self());
+    if(position == PFParticleIndex::kNotFound) return pfparticle;
+    return pfpIndex.at(pfpIndex.NeutrinoPosition(position));
+  }
+
+  float PandoraNuScoreCosmicIdAlg::GetPandoraNuScore(const recob::PFParticle& pfparticle,
+      const art::FindManyP<larpandoraobj::PFParticleMetadata>& PFPMetaDataAssoc){
 
-    const std::vector<art::Ptr<larpandoraobj::PFParticleMetadata> > pfpMetaVec =
+    const std::vector<art::Ptr<larpandoraobj::PFParticleMetadata> >& pfpMetaVec =
       PFPMetaDataAssoc.at(pfparticle.Self());
 
     if (pfpMetaVec.size() !=1){
@@ -120,7 +136,7 @@ namespace sbnd{
 
     art::Ptr<larpandoraobj::PFParticleMetadata> pfpMeta = pfpMetaVec.front();
 
-    larpandoraobj::PFParticleMetadata::PropertiesMap propertiesMap = pfpMeta->GetPropertiesMap();
+    const larpandoraobj::PFParticleMetadata::PropertiesMap& propertiesMap = pfpMeta->GetPropertiesMap();
     auto propertiesMapIter = propertiesMap.find("NuScore");
     if (propertiesMapIter == propertiesMap.end()){
       std::cout<<"Cannot get PFP Nu Score in Metadata"<<std::endl;
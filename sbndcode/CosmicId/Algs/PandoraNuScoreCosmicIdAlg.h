@@ -18,6 +18,7 @@
 #include "art/Framework/Principal/Handle.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "canvas/Persistency/Common/FindManyP.h"
+#include "canvas/Persistency/Provenance/EventID.h"
 
 // LArSoft
 #include "lardataobj/RecoBase/Track.h"
@@ -25,9 +26,13 @@
 #include "lardataobj/RecoBase/PFParticle.h"
 #include "lardataobj/AnalysisBase/T0.h"
 #include "lardataobj/RecoBase/PFParticleMetadata.h"
+
+#include "sbndcode/CosmicId/Utils/PFParticleIndex.h"
+
 // c++
 #include <vector>
 #include <iostream>
+#include <optional>
 
 namespace sbnd{
 
@@ -67,20 +72,39 @@ namespace sbnd{
       void reconfigure(const Config& config);
 
       // Finds any t0s associated with track by pandora, tags if outside beam
-      bool PandoraNuScoreCosmicId(recob::Track track, const art::Event& event);
+      bool PandoraNuScoreCosmicId(const recob::Track& track, const art::Event& event);
 
       // Finds any t0s associated with pfparticle by pandora, tags if outside beam
-      bool PandoraNuScoreCosmicId(recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> > pfParticleMap, const art::Event& event);
+      bool PandoraNuScoreCosmicId(const recob::PFParticle& pfparticle, const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap, const art::Event& event);
+
+      // Tags the PFParticle at position in the index if the nu score of its slice is below the cut
+      bool PandoraNuScoreCosmicId(const PFParticleIndex& pfpIndex, size_t position) const;
+
+      // Index of the PFParticles of the event, with their metadata and tracks, made once per event
+      const PFParticleIndex& EventIndex(const art::Event& event);
 
-      recob::PFParticle GetPFPNeutrino(recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap);
+      recob::PFParticle GetPFPNeutrino(const recob::PFParticle& pfparticle, const std::map< size_t, art::Ptr<recob::PFParticle> >& pfParticleMap);
 
-      recob::PFParticle GetPFPNeutrino(recob::PFParticle pfp, const std::vector<recob::PFParticle>& pfpVec);
+      recob::PFParticle GetPFPNeutrino(const recob::PFParticle& pfp, const std::vector<recob::PFParticle>& pfpVec);
 
-      float GetPandoraNuScore(recob::PFParticle pfparticle,
-          art::FindManyP<larpandoraobj::PFParticleMetadata> PFPMetaDataAssoc);
+      recob::PFParticle GetPFPNeutrino(const recob::PFParticle& pfp, const PFParticleIndex& pfpIndex);
+
+      float GetPandoraNuScore(const recob::PFParticle& pfparticle,
+          const art::FindManyP<larpandoraobj::PFParticleMetadata>& PFPMetaDataAssoc);
 
     private:
 
+      // Products the index of an event points into
+      struct EventCache {
+        art::EventID eventId;
+        art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
+        std::optional<art::FindManyP<recob::Track>> pfPartToTrackAssoc;
+        std::optional<art::FindManyP<larpandoraobj::PFParticleMetadata>> PFPMetaDataAssoc;
+        std::optional<PFParticleIndex> pfpIndex;
+      };
+
+      EventCache fEventCache;
+
       art::InputTag fPandoraLabel;
       art::InputTag fTpcTrackModuleLabel;
       float fNuScoreCut;
@@ -30,7 +30,7 @@ void PandoraT0CosmicIdAlg::reconfigure(const Config& config){
 }
 
 // Finds any t0s associated with track by pandora, tags if outside beam
-bool PandoraT0CosmicIdAlg::PandoraT0CosmicId(recob::Track track, const art::Event& event){
+bool PandoraT0CosmicIdAlg::PandoraT0CosmicId(const recob::Track& track, const art::Event& event){
 
   // Get the pfps and associations
   art::Handle< std::vector<recob::PFParticle> > pfParticleHandle;
@@ -83,7 +83,7 @@ namespace sbnd{
     void reconfigure(const Config& config);
 
     // Finds any t0s associated with track by pandora, tags if outside beam
-    bool PandoraT0CosmicId(recob::Track track, const art::Event& event);
+    bool PandoraT0CosmicId(const recob::Track& track, const art::Event& event);
 
     // Finds any t0s associated with pfparticle by pandora, tags if outside beam
     bool PandoraT0CosmicId(recob::PFParticle pfparticle, std::map< size_t, art::Ptr<recob::PFParticle> > pfParticleMap, const art::Event& event);
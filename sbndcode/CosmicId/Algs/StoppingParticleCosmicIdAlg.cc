@@ -1,5 +1,9 @@
 #include "StoppingParticleCosmicIdAlg.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 namespace sbnd{
 
 StoppingParticleCosmicIdAlg::StoppingParticleCosmicIdAlg(const Config& config){
@@ -31,12 +35,13 @@ void StoppingParticleCosmicIdAlg::reconfigure(const Config& config){
   fResRangeMax = config.ResRangeMax();
   fDEdxMax = config.DEdxMax();
   fStoppingChi2Limit = config.StoppingChi2Limit();
+  fAnalyticFits = config.AnalyticFits();
 
   return;
 }
 
 // Calculate the chi2 ratio of pol0 and exp fit to dE/dx vs residual range
-double StoppingParticleCosmicIdAlg::StoppingChiSq(geo::Point_t end, std::vector<art::Ptr<anab::Calorimetry>> calos){
+double StoppingParticleCosmicIdAlg::StoppingChiSq(geo::Point_t end, const std::vector<art::Ptr<anab::Calorimetry>>& calos){
 
   // If calorimetry object is null then return 0
   if(calos.size()==0) return -99999;
@@ -98,15 +103,22 @@ double StoppingParticleCosmicIdAlg::StoppingChiSq(geo::Point_t end, std::vector<
   // Return null value if not enough points to do fits
   if(v_dedx.size() < 10) return -99999;
 
+  if(fAnalyticFits){
+    double polchi2 = Pol0ChiSq(v_dedx);
+    double expchi2 = ExpoChiSq(v_resrg, v_dedx);
+    if(expchi2 < 0) return -99999;
+    return polchi2/expchi2;
+  }
+
   // Try to do a pol0 fit
-  TGraph *gdedx = new TGraph(v_dedx.size(), &v_resrg[0], &v_dedx[0]);
-  try{ gdedx->Fit("pol0", "Q"); } catch(...){ return -99999; }
-  TF1* polfit = gdedx->GetFunction("pol0");
+  TGraph gdedx(v_dedx.size(), &v_resrg[0], &v_dedx[0]);
+  try{ gdedx.Fit("pol0", "Q"); } catch(...){ return -99999; }
+  TF1* polfit = gdedx.GetFunction("pol0");
   double polchi2 = polfit->GetChisquare();
 
   // Try to do and exp fit
-  try{ gdedx->Fit("expo", "Q"); } catch(...){ return -99999; }
-  TF1* expfit = gdedx->GetFunction("expo");
+  try{ gdedx.Fit("expo", "Q"); } catch(...){ return -99999; }
+  TF1* expfit = gdedx.GetFunction("expo");
   double expchi2 = expfit->GetChisquare();
 
   // Return the chi2 ratio
@@ -116,7 +128,7 @@ double StoppingParticleCosmicIdAlg::StoppingChiSq(geo::Point_t end, std::vector<
 
 
 // Determine if the track end looks like it stops
-bool StoppingParticleCosmicIdAlg::StoppingEnd(geo::Point_t end, std::vector<art::Ptr<anab::Calorimetry>> calos){
+bool StoppingParticleCosmicIdAlg::StoppingEnd(geo::Point_t end, const std::vector<art::Ptr<anab::Calorimetry>>& calos){
   
   // Get the chi2 ratio
   double chiSqRatio = StoppingChiSq(end, calos);
@@ -128,7 +140,7 @@ bool StoppingParticleCosmicIdAlg::StoppingEnd(geo::Point_t end, std::vector<art:
 }
 
 // Determine if a track looks like a stopping cosmic
-bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(recob::Track track, std::vector<art::Ptr<anab::Calorimetry>> calos){
+bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(const recob::Track& track, const std::vector<art::Ptr<anab::Calorimetry>>& calos){
 
   // Check if start and end of track is inside the fiducial volume
   bool startInFiducial = fTpcGeo.InFiducial(track.Vertex(), fMinX, fMinY, fMinZ, fMaxX, fMaxY, fMaxZ);
@@ -149,7 +161,7 @@ bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(recob::Track track, s
 }
 
 // Determine if two tracks look like a stopping cosmic if they are merged
-bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(recob::Track track, recob::Track track2, std::vector<art::Ptr<anab::Calorimetry>> calos, std::vector<art::Ptr<anab::Calorimetry>> calos2){
+bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(const recob::Track& track, const recob::Track& track2, const std::vector<art::Ptr<anab::Calorimetry>>& calos, const std::vector<art::Ptr<anab::Calorimetry>>& calos2){
 
   // Assume both tracks start from the same vertex so take end points as new start/end
   bool startInFiducial = fTpcGeo.InFiducial(track.End(), fMinX, fMinY, fMinZ, fMaxX, fMaxY, fMaxZ);
@@ -168,4 +180,79 @@ bool StoppingParticleCosmicIdAlg::StoppingParticleCosmicId(recob::Track track, r
 }
 
 
+// Chi2 of a least squares fit of a constant (pol0)
+double StoppingParticleCosmicIdAlg::Pol0ChiSq(const std::vector<double>& y){
+
+  // The best constant is the mean, all points have unit weight as in TGraph::Fit
+  double mean = std::accumulate(y.begin(), y.end(), 0.)/y.size();
+
+  double chi2 = 0;
+  for(auto const& yi : y) chi2 += (yi - mean)*(yi - mean);
+
+  return chi2;
+}
+
+// Chi2 of a least squares fit of exp(p0 + p1*x) (expo), started from the log-linear fit
+double StoppingParticleCosmicIdAlg::ExpoChiSq(const std::vector<double>& x, const std::vector<double>& y){
+
+  // Start from the straight line fit of log(y), as ROOT does, using the positive points
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for(size_t i = 0; i < x.size(); i++){
+    if(y[i] <= 0) continue;
+    double ly = std::log(y[i]);
+    n += 1; sx += x[i]; sy += ly; sxx += x[i]*x[i]; sxy += x[i]*ly;
+  }
+  if(n < 2) return -1;
+  double det = n*sxx - sx*sx;
+  double p1 = (det != 0) ? (n*sxy - sx*sy)/det : 0;
+  double p0 = (sy - p1*sx)/n;
+
+  auto chiSq = [&](double a, double b){
+    double chi2 = 0;
+    for(size_t i = 0; i < x.size(); i++){
+      double r = y[i] - std::exp(a + b*x[i]);
+      chi2 += r*r;
+    }
+    return chi2;
+  };
+
+  // The log-linear fit weights the points differently, so refine it to the least squares
+  // minimum in y with damped Gauss-Newton (Levenberg-Marquardt) steps
+  double chi2 = chiSq(p0, p1);
+  double lambda = 1e-3;
+  for(int iter = 0; iter < 100 && std::isfinite(chi2); iter++){
+    double a00 = 0, a01 = 0, a11 = 0, g0 = 0, g1 = 0;
+    for(size_t i = 0; i < x.size(); i++){
+      double f = std::exp(p0 + p1*x[i]);
+      double r = y[i] - f;
+      a00 += f*f; a01 += f*f*x[i]; a11 += f*f*x[i]*x[i];
+      g0 += f*r; g1 += f*r*x[i];
+    }
+
+    bool improved = false;
+    while(!improved && lambda < 1e10){
+      double b00 = a00*(1 + lambda), b11 = a11*(1 + lambda);
+      double d = b00*b11 - a01*a01;
+      if(d == 0) break;
+      double dp0 = (g0*b11 - g1*a01)/d;
+      double dp1 = (g1*b00 - g0*a01)/d;
+      double newChi2 = chiSq(p0 + dp0, p1 + dp1);
+      if(std::isfinite(newChi2) && newChi2 <= chi2){
+        improved = true;
+        p0 += dp0; p1 += dp1;
+        double change = chi2 - newChi2;
+        chi2 = newChi2;
+        lambda = std::max(lambda/10, 1e-12);
+        if(change <= 1e-12*chi2) return chi2;
+      }
+      else lambda *= 10;
+    }
+    if(!improved) break;
+  }
+
+  if(!std::isfinite(chi2)) return -1;
+
+  return chi2;
+}
+
 }
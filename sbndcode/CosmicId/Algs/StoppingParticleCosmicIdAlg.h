@@ -74,6 +74,12 @@ namespace sbnd{
         Comment("Limit of pol/exp chi2 ratio to cut on to determine if stopping")
       };
 
+      fhicl::Atom<bool> AnalyticFits {
+        Name("AnalyticFits"),
+        Comment("Fit pol0 and expo by least squares directly instead of with TGraph::Fit"),
+        true
+      };
+
     };
 
     StoppingParticleCosmicIdAlg(const Config& config);
@@ -88,19 +94,26 @@ namespace sbnd{
     void reconfigure(const Config& config);
 
     // Calculate the chi2 ratio of pol0 and exp fit to dE/dx vs residual range
-    double StoppingChiSq(geo::Point_t end, std::vector<art::Ptr<anab::Calorimetry>> calos);
+    double StoppingChiSq(geo::Point_t end, const std::vector<art::Ptr<anab::Calorimetry>>& calos);
 
     // Determine if the track end looks like it stops
-    bool StoppingEnd(geo::Point_t end, std::vector<art::Ptr<anab::Calorimetry>> calos);
+    bool StoppingEnd(geo::Point_t end, const std::vector<art::Ptr<anab::Calorimetry>>& calos);
 
     // Determine if a track looks like a stopping cosmic
-    bool StoppingParticleCosmicId(recob::Track track, std::vector<art::Ptr<anab::Calorimetry>> calos);
+    bool StoppingParticleCosmicId(const recob::Track& track, const std::vector<art::Ptr<anab::Calorimetry>>& calos);
 
     // Determine if two tracks look like a stopping cosmic if they are merged
-    bool StoppingParticleCosmicId(recob::Track track, recob::Track track2, std::vector<art::Ptr<anab::Calorimetry>> calos, std::vector<art::Ptr<anab::Calorimetry>> calos2);
+    bool StoppingParticleCosmicId(const recob::Track& track, const recob::Track& track2, const std::vector<art::Ptr<anab::Calorimetry>>& calos, const std::vector<art::Ptr<anab::Calorimetry>>& calos2);
 
   private:
 
+    // Chi2 of a least squares fit of a constant (pol0)
+    static double Pol0ChiSq(const std::vector<double>& y);
+
+    // Chi2 of a least squares fit of exp(p0 + p1*x) (expo), started from the log-linear fit.
+    // Returns a negative value if the fit fails.
+    static double ExpoChiSq(const std::vector<double>& x, const std::vector<double>& y);
+
     double fMinX;
     double fMinY;
     double fMinZ;
@@ -111,6 +124,7 @@ namespace sbnd{
     double fResRangeMax;
     double fDEdxMax;
     double fStoppingChi2Limit;
+    bool fAnalyticFits;
 
     TPCGeoAlg fTpcGeo;
 
@@ -314,9 +314,9 @@ namespace sbnd {
     //----------------------------------------------------------------------------------------------------------
 
     // Create fake flashes in each tpc
-    std::pair<std::vector<double>, std::vector<double>> fakeFlashes = CosmicIdUtils::FakeTpcFlashes(parts);
-    std::vector<double> fakeTpc0Flashes = fakeFlashes.first;
-    std::vector<double> fakeTpc1Flashes = fakeFlashes.second;
+    std::pair<FlashTimeIndex, FlashTimeIndex> fakeFlashes = CosmicIdUtils::FakeTpcFlashes(parts);
+    const FlashTimeIndex& fakeTpc0Flashes = fakeFlashes.first;
+    const FlashTimeIndex& fakeTpc1Flashes = fakeFlashes.second;
     bool tpc0BeamFlash = CosmicIdUtils::BeamFlash(fakeTpc0Flashes, fBeamTimeMin, fBeamTimeMax);
     bool tpc1BeamFlash = CosmicIdUtils::BeamFlash(fakeTpc1Flashes, fBeamTimeMin, fBeamTimeMax);
 
@@ -12,6 +12,7 @@
 #include "sbnobj/Common/CRT/CRTTrack.hh"
 #include "sbndcode/CRT/CRTUtils/CRTBackTracker.h"
 #include "sbndcode/CosmicId/Utils/CosmicIdUtils.h"
+#include "sbndcode/CosmicId/Utils/PFParticleIndex.h"
 #include "sbndcode/CosmicId/Algs/CosmicIdAlg.h"
 #include "sbndcode/Geometry/GeometryWrappers/TPCGeoAlg.h"
 
@@ -42,6 +43,8 @@
 // <https://root.cern.ch/doc/master/annotated.html>
 #include "TVector3.h"
 
+#include "tbb/parallel_for.h"
+
 // C++ includes
 #include <map>
 #include <vector>
@@ -109,6 +112,18 @@ namespace sbnd {
         Comment("Print information about what's going on")
       };
 
+      fhicl::Atom<bool> UseHitWorkers {
+        Name("UseHitWorkers"),
+        Comment("Backtrack the track hits concurrently when filling the truth cache"),
+        false
+      };
+
+      fhicl::Atom<bool> UsePfpWorkers {
+        Name("UsePfpWorkers"),
+        Comment("Compute the PFParticle tree rows concurrently, the tree is still filled in order"),
+        false
+      };
+
       fhicl::Table<CRTBackTracker::Config> CrtBackTrack {
         Name("CrtBackTrack"),
       };
@@ -140,14 +155,60 @@ namespace sbnd {
 
     // Reset variables in each loop
     void ResetTrackVars();
-    void ResetPfpVars();
+
+    // Branches of the PFParticle tree
+    struct PfpVars {
+      std::string pfp_type;
+      bool pfp_nu;
+      int pfp_nu_tpc;
+      int pfp_n_tracks;
+      int pfp_pdg;
+      double pfp_time;
+      double pfp_length;
+      double pfp_momentum;
+      double pfp_theta;
+      double pfp_phi;
+      double pfp_tracks_angle;
+      double pfp_second_length;
+      bool pfp_crt_hit_true_match;
+      double pfp_crt_hit_dca;
+      double pfp_sec_crt_hit_dca;
+      bool pfp_crt_track_true_match;
+      double pfp_crt_track_dca;
+      double pfp_crt_track_angle;
+      bool pfp_stops;
+      double pfp_stop_ratio_start;
+      double pfp_stop_ratio_end;
+      double pfp_sec_stop_ratio_start;
+      double pfp_sec_stop_ratio_end;
+      double pfp_fiducial_dist_start;
+      double pfp_fiducial_dist_end;
+      double pfp_sec_fiducial_dist_start;
+      double pfp_sec_fiducial_dist_end;
+      int pfp_tpc;
+      bool pfp_apa_cross;
+      double pfp_apa_dist;
+      double pfp_apa_min_dist;
+      double pfp_sec_apa_min_dist;
+      double pfp_pandora_nu_score;
+    };
+
+    // PFParticle tree values of one primary PFParticle, computed before the tree is filled
+    struct PfpRow {
+      bool fill = false;      ///< the PFParticle has associated tracks
+      bool trueMatch = false; ///< pfp_time was set, it is not reset between PFParticles
+      PfpVars vars{};
+      std::vector<std::pair<int, bool>> isPfpNu; ///< (track ID, neutrino PFParticle) of the daughter tracks
+    };
+
+    void ResetPfpVars(PfpVars &pfp) const;
 
     typedef art::Handle< std::vector<recob::PFParticle> > PFParticleHandle;
     typedef std::map< size_t, art::Ptr<recob::PFParticle> > PFParticleIdMap;
 
   private:
 
-    void GetPFParticleIdMap(const PFParticleHandle &pfParticleHandle, PFParticleIdMap &pfParticleMap);
+    void GetPFParticleIdMap(const PFParticleHandle &pfParticleHandle, const PFParticleIndex &pfpIndex, PFParticleIdMap &pfParticleMap);
     
     // fcl file parameters
     art::InputTag fSimModuleLabel;      ///< name of detsim producer
@@ -157,6 +218,8 @@ namespace sbnd {
     art::InputTag fCaloModuleLabel; ///< name of CRT producer
     art::InputTag fPandoraLabel;
     bool          fVerbose;             ///< print information about what's going on
+    bool          fUseHitWorkers;       ///< backtrack hits concurrently
+    bool          fUsePfpWorkers;       ///< compute the PFParticle rows concurrently
     double fBeamTimeMin;
     double fBeamTimeMax;
 
@@ -166,6 +229,9 @@ namespace sbnd {
 
     CosmicIdAlg fCosId;
 
+    // True energy deposits of the track hits, shared by every truth match of the event
+    RecoUtils::HitTruthCache fHitTruth;
+
     // Trees
     TTree *fTrackTree;
     TTree *fPfpTree;
@@ -197,39 +263,7 @@ namespace sbnd {
     double track_pandora_nu_score;
 
     // PFParticle tree parameters
-    std::string pfp_type;
-    bool pfp_nu;
-    int pfp_nu_tpc;
-    int pfp_n_tracks;
-    int pfp_pdg;
-    double pfp_time;
-    double pfp_length;
-    double pfp_momentum;
-    double pfp_theta;
-    double pfp_phi;
-    double pfp_tracks_angle;
-    double pfp_second_length;
-    bool pfp_crt_hit_true_match;
-    double pfp_crt_hit_dca;
-    double pfp_sec_crt_hit_dca;
-    bool pfp_crt_track_true_match;
-    double pfp_crt_track_dca;
-    double pfp_crt_track_angle;
-    bool pfp_stops;
-    double pfp_stop_ratio_start;
-    double pfp_stop_ratio_end;
-    double pfp_sec_stop_ratio_start;
-    double pfp_sec_stop_ratio_end;
-    double pfp_fiducial_dist_start;
-    double pfp_fiducial_dist_end;
-    double pfp_sec_fiducial_dist_start;
-    double pfp_sec_fiducial_dist_end;
-    int pfp_tpc;
-    bool pfp_apa_cross;
-    double pfp_apa_dist;
-    double pfp_apa_min_dist;
-    double pfp_sec_apa_min_dist;
-    double pfp_pandora_nu_score;
+    PfpVars fPfp{};
 
   }; // class CosmicIdTree
 
@@ -244,6 +278,8 @@ namespace sbnd {
     , fCaloModuleLabel     (config().CaloModuleLabel())
     , fPandoraLabel        (config().PandoraLabel())
     , fVerbose             (config().Verbose())
+    , fUseHitWorkers       (config().UseHitWorkers())
+    , fUsePfpWorkers       (config().UsePfpWorkers())
     , fBeamTimeMin         (config().BeamTimeLimits().BeamTimeMin())
     , fBeamTimeMax         (config().BeamTimeLimits().BeamTimeMax())
     , fCrtBackTrack        (config().CrtBackTrack())
@@ -290,39 +326,39 @@ namespace sbnd {
     // PFParticle tree
     fPfpTree = tfs->make<TTree>("pfps", "pfps");
 
-    fPfpTree->Branch("pfp_type",                 &pfp_type);
-    fPfpTree->Branch("pfp_nu",                   &pfp_nu, "pfp_nu/O");
-    fPfpTree->Branch("pfp_nu_tpc",               &pfp_nu_tpc, "pfp_nu_tpc/I");
-    fPfpTree->Branch("pfp_n_tracks",             &pfp_n_tracks, "pfp_n_tracks/I");
-    fPfpTree->Branch("pfp_pdg",                  &pfp_pdg, "pfp_pdg/I");
-    fPfpTree->Branch("pfp_time",                 &pfp_time, "pfp_time/D");
-    fPfpTree->Branch("pfp_length",               &pfp_length, "pfp_length/D");
-    fPfpTree->Branch("pfp_momentum",             &pfp_momentum, "pfp_momentum/D");
-    fPfpTree->Branch("pfp_theta",                &pfp_theta, "pfp_theta/D");
-    fPfpTree->Branch("pfp_phi",                  &pfp_phi, "pfp_phi/D");
-    fPfpTree->Branch("pfp_tracks_angle",         &pfp_tracks_angle, "pfp_tracks_angle/D");
-    fPfpTree->Branch("pfp_second_length",        &pfp_second_length, "pfp_second_length/D");
-    fPfpTree->Branch("pfp_crt_hit_true_match",   &pfp_crt_hit_true_match, "pfp_crt_hit_true_match/O");
-    fPfpTree->Branch("pfp_crt_hit_dca",          &pfp_crt_hit_dca, "pfp_crt_hit_dca/D");
-    fPfpTree->Branch("pfp_sec_crt_hit_dca",      &pfp_sec_crt_hit_dca, "pfp_sec_crt_hit_dca/D");
-    fPfpTree->Branch("pfp_crt_track_true_match", &pfp_crt_track_true_match, "pfp_crt_track_true_match/O");
-    fPfpTree->Branch("pfp_crt_track_dca",        &pfp_crt_track_dca, "pfp_crt_track_dca/D");
-    fPfpTree->Branch("pfp_crt_track_angle",      &pfp_crt_track_angle, "pfp_crt_track_angle/D");
-    fPfpTree->Branch("pfp_stops",                &pfp_stops, "pfp_stops/O");
-    fPfpTree->Branch("pfp_stop_ratio_start",     &pfp_stop_ratio_start, "pfp_stop_ratio_start/D");
-    fPfpTree->Branch("pfp_stop_ratio_end",       &pfp_stop_ratio_end, "pfp_stop_ratio_end/D");
-    fPfpTree->Branch("pfp_sec_stop_ratio_start", &pfp_sec_stop_ratio_start, "pfp_sec_stop_ratio_start/D");
-    fPfpTree->Branch("pfp_sec_stop_ratio_end",   &pfp_sec_stop_ratio_end, "pfp_sec_stop_ratio_end/D");
-    fPfpTree->Branch("pfp_fiducial_dist_start",  &pfp_fiducial_dist_start, "pfp_fiducial_dist_start/D");
-    fPfpTree->Branch("pfp_fiducial_dist_end",    &pfp_fiducial_dist_end, "pfp_fiducial_dist_end/D");
-    fPfpTree->Branch("pfp_sec_fiducial_dist_start", &pfp_sec_fiducial_dist_start, "pfp_sec_fiducial_dist_start/D");
-    fPfpTree->Branch("pfp_sec_fiducial_dist_end",  &pfp_sec_fiducial_dist_end, "pfp_sec_fiducial_dist_end/D");
-    fPfpTree->Branch("pfp_tpc",                  &pfp_tpc, "pfp_tpc/I");
-    fPfpTree->Branch("pfp_apa_cross",            &pfp_apa_cross, "pfp_apa_cross/O");
-    fPfpTree->Branch("pfp_apa_dist",             &pfp_apa_dist, "pfp_apa_dist/D");
-    fPfpTree->Branch("pfp_apa_min_dist",         &pfp_apa_min_dist, "pfp_apa_min_dist/D");
-    fPfpTree->Branch("pfp_sec_apa_min_dist",     &pfp_sec_apa_min_dist, "pfp_sec_apa_min_dist/D");
-    fPfpTree->Branch("pfp_pandora_nu_score",     &pfp_pandora_nu_score, "pfp_pandora_nu_score/D");
+    fPfpTree->Branch("pfp_type",                 &fPfp.pfp_type);
+    fPfpTree->Branch("pfp_nu",                   &fPfp.pfp_nu, "pfp_nu/O");
+    fPfpTree->Branch("pfp_nu_tpc",               &fPfp.pfp_nu_tpc, "pfp_nu_tpc/I");
+    fPfpTree->Branch("pfp_n_tracks",             &fPfp.pfp_n_tracks, "pfp_n_tracks/I");
+    fPfpTree->Branch("pfp_pdg",                  &fPfp.pfp_pdg, "pfp_pdg/I");
+    fPfpTree->Branch("pfp_time",                 &fPfp.pfp_time, "pfp_time/D");
+    fPfpTree->Branch("pfp_length",               &fPfp.pfp_length, "pfp_length/D");
+    fPfpTree->Branch("pfp_momentum",             &fPfp.pfp_momentum, "pfp_momentum/D");
+    fPfpTree->Branch("pfp_theta",                &fPfp.pfp_theta, "pfp_theta/D");
+    fPfpTree->Branch("pfp_phi",                  &fPfp.pfp_phi, "pfp_phi/D");
+    fPfpTree->Branch("pfp_tracks_angle",         &fPfp.pfp_tracks_angle, "pfp_tracks_angle/D");
+    fPfpTree->Branch("pfp_second_length",        &fPfp.pfp_second_length, "pfp_second_length/D");
+    fPfpTree->Branch("pfp_crt_hit_true_match",   &fPfp.pfp_crt_hit_true_match, "pfp_crt_hit_true_match/O");
+    fPfpTree->Branch("pfp_crt_hit_dca",          &fPfp.pfp_crt_hit_dca, "pfp_crt_hit_dca/D");
+    fPfpTree->Branch("pfp_sec_crt_hit_dca",      &fPfp.pfp_sec_crt_hit_dca, "pfp_sec_crt_hit_dca/D");
+    fPfpTree->Branch("pfp_crt_track_true_match", &fPfp.pfp_crt_track_true_match, "pfp_crt_track_true_match/O");
+    fPfpTree->Branch("pfp_crt_track_dca",        &fPfp.pfp_crt_track_dca, "pfp_crt_track_dca/D");
+    fPfpTree->Branch("pfp_crt_track_angle",      &fPfp.pfp_crt_track_angle, "pfp_crt_track_angle/D");
+    fPfpTree->Branch("pfp_stops",                &fPfp.pfp_stops, "pfp_stops/O");
+    fPfpTree->Branch("pfp_stop_ratio_start",     &fPfp.pfp_stop_ratio_start, "pfp_stop_ratio_start/D");
+    fPfpTree->Branch("pfp_stop_ratio_end",       &fPfp.pfp_stop_ratio_end, "pfp_stop_ratio_end/D");
+    fPfpTree->Branch("pfp_sec_stop_ratio_start", &fPfp.pfp_sec_stop_ratio_start, "pfp_sec_stop_ratio_start/D");
+    fPfpTree->Branch("pfp_sec_stop_ratio_end",   &fPfp.pfp_sec_stop_ratio_end, "pfp_sec_stop_ratio_end/D");
+    fPfpTree->Branch("pfp_fiducial_dist_start",  &fPfp.pfp_fiducial_dist_start, "pfp_fiducial_dist_start/D");
+    fPfpTree->Branch("pfp_fiducial_dist_end",    &fPfp.pfp_fiducial_dist_end, "pfp_fiducial_dist_end/D");
+    fPfpTree->Branch("pfp_sec_fiducial_dist_start", &fPfp.pfp_sec_fiducial_dist_start, "pfp_sec_fiducial_dist_start/D");
+    fPfpTree->Branch("pfp_sec_fiducial_dist_end",  &fPfp.pfp_sec_fiducial_dist_end, "pfp_sec_fiducial_dist_end/D");
+    fPfpTree->Branch("pfp_tpc",                  &fPfp.pfp_tpc, "pfp_tpc/I");
+    fPfpTree->Branch("pfp_apa_cross",            &fPfp.pfp_apa_cross, "pfp_apa_cross/O");
+    fPfpTree->Branch("pfp_apa_dist",             &fPfp.pfp_apa_dist, "pfp_apa_dist/D");
+    fPfpTree->Branch("pfp_apa_min_dist",         &fPfp.pfp_apa_min_dist, "pfp_apa_min_dist/D");
+    fPfpTree->Branch("pfp_sec_apa_min_dist",     &fPfp.pfp_sec_apa_min_dist, "pfp_sec_apa_min_dist/D");
+    fPfpTree->Branch("pfp_pandora_nu_score",     &fPfp.pfp_pandora_nu_score, "pfp_pandora_nu_score/D");
 
     // Initial output
     if(fVerbose) std::cout<<"----------------- Cosmic ID Tree Module -------------------"<<std::endl;
@@ -402,12 +438,14 @@ namespace sbnd {
       if(fVerbose) std::cout<<"Failed to find the PFParticles."<<std::endl;
       return;
     }
-    PFParticleIdMap pfParticleMap;
-    this->GetPFParticleIdMap(pfParticleHandle, pfParticleMap);
     // Get PFParticle to track associations
     art::FindManyP< recob::Track > pfPartToTrackAssoc(pfParticleHandle, event, fTPCTrackLabel);
     art::FindManyP<larpandoraobj::PFParticleMetadata> findManyPFPMetadata(pfParticleHandle,
         event, fPandoraLabel);
+    // Index the PFParticles by ID and track, with their neutrinos and nu scores, once for the event
+    PFParticleIndex pfpIndex(*pfParticleHandle, findManyPFPMetadata, &pfPartToTrackAssoc);
+    PFParticleIdMap pfParticleMap;
+    this->GetPFParticleIdMap(pfParticleHandle, pfpIndex, pfParticleMap);
 
     //----------------------------------------------------------------------------------------------------------
     //                                          TRUTH MATCHING
@@ -478,9 +516,9 @@ namespace sbnd {
     //----------------------------------------------------------------------------------------------------------
 
     // Create fake flashes in each tpc
-    std::pair<std::vector<double>, std::vector<double>> fakeFlashes = CosmicIdUtils::FakeTpcFlashes(parts);
-    std::vector<double> fakeTpc0Flashes = fakeFlashes.first;
-    std::vector<double> fakeTpc1Flashes = fakeFlashes.second;
+    std::pair<FlashTimeIndex, FlashTimeIndex> fakeFlashes = CosmicIdUtils::FakeTpcFlashes(parts);
+    const FlashTimeIndex& fakeTpc0Flashes = fakeFlashes.first;
+    const FlashTimeIndex& fakeTpc1Flashes = fakeFlashes.second;
     bool tpc0BeamFlash = CosmicIdUtils::BeamFlash(fakeTpc0Flashes, fBeamTimeMin, fBeamTimeMax);
     bool tpc1BeamFlash = CosmicIdUtils::BeamFlash(fakeTpc1Flashes, fBeamTimeMin, fBeamTimeMax);
 
@@ -494,23 +532,35 @@ namespace sbnd {
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event, clockData);
 
-    //Loop over the pfparticle map
-    std::map<int, bool> isPfpNu;
-    for (PFParticleIdMap::const_iterator it = pfParticleMap.begin(); it != pfParticleMap.end(); ++it){
+    // Backtrack the hits of all the tracks once, each track is truth matched several times
+    fHitTruth.Clear();
+    std::vector<art::Ptr<recob::Hit>> trackHits;
+    for (size_t track_i = 0; track_i < tpcTrackHandle->size(); track_i++){
+      const std::vector<art::Ptr<recob::Hit>>& hits = findManyHits.at(track_i);
+      trackHits.insert(trackHits.end(), hits.begin(), hits.end());
+    }
+    fHitTruth.Add(clockData, trackHits, fUseHitWorkers);
 
-      const art::Ptr<recob::PFParticle> pParticle(it->second);
+    // Compute the tree values of each primary PFParticle, concurrently if requested, then
+    // fill the tree and record the neutrino tracks in the order of the pfparticle map
+    std::vector<art::Ptr<recob::PFParticle>> primaries;
+    for (PFParticleIdMap::const_iterator it = pfParticleMap.begin(); it != pfParticleMap.end(); ++it){
       // Only look for primary particles
-      if (!pParticle->IsPrimary()) continue;
+      if (it->second->IsPrimary()) primaries.push_back(it->second);
+    }
+
+    auto computePfpRow = [&](const art::Ptr<recob::PFParticle>& pParticle, PfpRow& row){
 
-      ResetPfpVars();
-      pfp_nu_tpc = nuTpc;
+      PfpVars &pfp = row.vars;
+      ResetPfpVars(pfp);
+      pfp.pfp_nu_tpc = nuTpc;
 
       // Check if this particle is identified as the neutrino
       const int pdg(pParticle->PdgCode());
       const bool isNeutrino(std::abs(pdg) == pandora::NU_E || std::abs(pdg) == pandora::NU_MU || std::abs(pdg) == pandora::NU_TAU);
 
       // FIXME Won't ever look at cosmic pfps as they don't have daughters
-      pfp_nu = isNeutrino;
+      pfp.pfp_nu = isNeutrino;
 
       std::vector<recob::Track> nuTracks;
       // Loop over daughters of pfparticle
@@ -525,35 +575,35 @@ namespace sbnd {
         recob::Track tpcTrack = *associatedTracks.front();
         nuTracks.push_back(tpcTrack);
 
-        isPfpNu[tpcTrack.ID()] = isNeutrino;
+        row.isPfpNu.emplace_back(tpcTrack.ID(), isNeutrino);
 
         // Truth match muon tracks and pfps
         std::vector<art::Ptr<recob::Hit>> hits = findManyHits.at(tpcTrack.ID());
-        int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, hits, false);
+        int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, fHitTruth, hits, false);
         if(std::find(lepParticleIds.begin(), lepParticleIds.end(), trueId) != lepParticleIds.end()){ 
-          pfp_type = "NuMu";
+          pfp.pfp_type = "NuMu";
         }
         else if(std::find(nuParticleIds.begin(), nuParticleIds.end(), trueId) != nuParticleIds.end()){ 
-          if(pfp_type != "NuMu") pfp_type = "Nu";
+          if(pfp.pfp_type != "NuMu") pfp.pfp_type = "Nu";
         }
         else if(std::find(dirtParticleIds.begin(), dirtParticleIds.end(), trueId) != dirtParticleIds.end()){ 
-          if(pfp_type != "NuMu" && pfp_type != "Nu") pfp_type = "Dirt";
+          if(pfp.pfp_type != "NuMu" && pfp.pfp_type != "Nu") pfp.pfp_type = "Dirt";
         }
         else if(std::find(crParticleIds.begin(), crParticleIds.end(), trueId) != crParticleIds.end()){
-          if(pfp_type != "NuMu" && pfp_type != "Nu" && pfp_type != "Dirt") pfp_type = "Cr";
+          if(pfp.pfp_type != "NuMu" && pfp.pfp_type != "Nu" && pfp.pfp_type != "Dirt") pfp.pfp_type = "Cr";
         }
 
         // Get the TPC the pfp was detected in
         std::vector<art::Ptr<recob::Hit>> tpcHits = findManyHits.at(tpcTrack.ID());
         int tpc = fTpcGeo.DetectedInTPC(tpcHits);
-        if(tpc == pfp_tpc || pfp_tpc == -99999) pfp_tpc = tpc;
-        else if(pfp_tpc != tpc) pfp_tpc = -1;
+        if(tpc == pfp.pfp_tpc || pfp.pfp_tpc == -99999) pfp.pfp_tpc = tpc;
+        else if(pfp.pfp_tpc != tpc) pfp.pfp_tpc = -1;
       }
 
       // Don't consider PFParticles with no associated tracks
-      if(nuTracks.size() == 0) continue;
+      if(nuTracks.size() == 0) return;
 
-      pfp_n_tracks = nuTracks.size();
+      pfp.pfp_n_tracks = nuTracks.size();
 
       // Sort tracks by length
       std::sort(nuTracks.begin(), nuTracks.end(), [](auto& left, auto& right){
@@ -562,34 +612,35 @@ namespace sbnd {
       // Choose longest track as cosmic muon candidate
       recob::Track tpcTrack = nuTracks[0];
       std::vector<art::Ptr<recob::Hit>> hits = findManyHits.at(tpcTrack.ID());
-      int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, hits, false);
+      int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, fHitTruth, hits, false);
 
       std::vector<art::Ptr<anab::Calorimetry>> calos = findManyCalo.at(tpcTrack.ID());
 
       // Get truth variables
       if(particles.find(trueId) != particles.end()){
-        pfp_pdg = particles[trueId].PdgCode();
-        pfp_momentum = particles[trueId].P();
-        pfp_time = particles[trueId].T();
+        pfp.pfp_pdg = particles.at(trueId).PdgCode();
+        pfp.pfp_momentum = particles.at(trueId).P();
+        pfp.pfp_time = particles.at(trueId).T();
+        row.trueMatch = true;
         // Does the true particle match any CRT hits or tracks?
         if(numHitMap.find(trueId) != numHitMap.end()){
-          if(numHitMap[trueId] > 0) pfp_crt_hit_true_match = true;
+          if(numHitMap.at(trueId) > 0) pfp.pfp_crt_hit_true_match = true;
         }
         if(numTrackMap.find(trueId) != numTrackMap.end()){
-          if(numTrackMap[trueId] > 0) pfp_crt_track_true_match = true;
+          if(numTrackMap.at(trueId) > 0) pfp.pfp_crt_track_true_match = true;
         }
         // Does particle stop in the TPC?
-        geo::Point_t end {particles[trueId].EndX(), particles[trueId].EndY(), particles[trueId].EndZ()};
-        if(fTpcGeo.InFiducial(end, 0.)) pfp_stops = true;
+        geo::Point_t end {particles.at(trueId).EndX(), particles.at(trueId).EndY(), particles.at(trueId).EndZ()};
+        if(fTpcGeo.InFiducial(end, 0.)) pfp.pfp_stops = true;
         // Does the true particle cross the APA?
-        pfp_apa_cross = fTpcGeo.CrossesApa(particles[trueId]);
+        pfp.pfp_apa_cross = fTpcGeo.CrossesApa(particles.at(trueId));
         // Distance from the APA of the reco track at the true time
-        pfp_apa_dist = fCosId.ApaAlg().ApaDistance(detProp, tpcTrack, pfp_time/1e3, hits);
+        pfp.pfp_apa_dist = fCosId.ApaAlg().ApaDistance(detProp, tpcTrack, pfp.pfp_time/1e3, hits);
       }
 
-      pfp_length = tpcTrack.Length();
-      pfp_theta = tpcTrack.Theta();
-      pfp_phi = tpcTrack.Phi();
+      pfp.pfp_length = tpcTrack.Length();
+      pfp.pfp_theta = tpcTrack.Theta();
+      pfp.pfp_phi = tpcTrack.Phi();
 
       // Get the second longest track originating from the same vertex
       recob::Track secTrack = tpcTrack;
@@ -605,8 +656,8 @@ namespace sbnd {
           // Do they share the same vertex? (no delta rays)
           if((start-start2).Mag() > 5.) continue;
           // Get the angle between the two longest tracks
-          pfp_tracks_angle = (end - start).Angle(end2 - start2);
-          pfp_second_length = track2.Length();
+          pfp.pfp_tracks_angle = (end - start).Angle(end2 - start2);
+          pfp.pfp_second_length = track2.Length();
           useSecTrack = true;
           secTrack = track2;
           break;
@@ -616,50 +667,68 @@ namespace sbnd {
 
       // CRT hit cut - get the distance of closest approach for the nearest CRT hit
       std::pair<sbn::crt::CRTHit, double> closestHit = fCosId.CrtHitAlg().T0Alg().ClosestCRTHit(detProp, tpcTrack, crtHits, event);
-      pfp_crt_hit_dca = closestHit.second;
+      pfp.pfp_crt_hit_dca = closestHit.second;
       if(useSecTrack){
         std::pair<sbn::crt::CRTHit, double> closestSecHit = fCosId.CrtHitAlg().T0Alg().ClosestCRTHit(detProp, secTrack, crtHits, event);
-        pfp_sec_crt_hit_dca = closestHit.second;
+        pfp.pfp_sec_crt_hit_dca = closestHit.second;
       }
 
       // CRT track cut - get the average distance of closest approach and angle between tracks for the nearest CRT track
       std::pair<sbn::crt::CRTTrack, double> closestTrackDca = fCosId.CrtTrackAlg().TrackAlg().ClosestCRTTrackByDCA(detProp, tpcTrack, crtTracks, event);
-      pfp_crt_track_dca = closestTrackDca.second;
+      pfp.pfp_crt_track_dca = closestTrackDca.second;
       std::pair<sbn::crt::CRTTrack, double> closestTrackAngle = fCosId.CrtTrackAlg().TrackAlg().ClosestCRTTrackByAngle(detProp, tpcTrack, crtTracks, event);
-      pfp_crt_track_angle = closestTrackAngle.second;
+      pfp.pfp_crt_track_angle = closestTrackAngle.second;
 
       // Stopping cut - get the chi2 ratio of the start and end of the track
-      pfp_stop_ratio_start = fCosId.StoppingAlg().StoppingChiSq(tpcTrack.Vertex(), calos);
-      pfp_stop_ratio_end = fCosId.StoppingAlg().StoppingChiSq(tpcTrack.End(), calos);
+      pfp.pfp_stop_ratio_start = fCosId.StoppingAlg().StoppingChiSq(tpcTrack.Vertex(), calos);
+      pfp.pfp_stop_ratio_end = fCosId.StoppingAlg().StoppingChiSq(tpcTrack.End(), calos);
       if(useSecTrack){
         std::vector<art::Ptr<anab::Calorimetry>> secCalos = findManyCalo.at(secTrack.ID());
-        pfp_sec_stop_ratio_start = fCosId.StoppingAlg().StoppingChiSq(secTrack.Vertex(), secCalos);
-        pfp_sec_stop_ratio_end = fCosId.StoppingAlg().StoppingChiSq(secTrack.End(), secCalos);
+        pfp.pfp_sec_stop_ratio_start = fCosId.StoppingAlg().StoppingChiSq(secTrack.Vertex(), secCalos);
+        pfp.pfp_sec_stop_ratio_end = fCosId.StoppingAlg().StoppingChiSq(secTrack.End(), secCalos);
       }
 
       // Fiducial cut - Get the fiducial volume the start and end points are contained in
-      pfp_fiducial_dist_start = fTpcGeo.MinDistToWall(tpcTrack.Vertex());
-      pfp_fiducial_dist_end = fTpcGeo.MinDistToWall(tpcTrack.End());
+      pfp.pfp_fiducial_dist_start = fTpcGeo.MinDistToWall(tpcTrack.Vertex());
+      pfp.pfp_fiducial_dist_end = fTpcGeo.MinDistToWall(tpcTrack.End());
       if(useSecTrack){
-        pfp_sec_fiducial_dist_start = fTpcGeo.MinDistToWall(secTrack.Vertex());
-        pfp_sec_fiducial_dist_end = fTpcGeo.MinDistToWall(secTrack.End());
+        pfp.pfp_sec_fiducial_dist_start = fTpcGeo.MinDistToWall(secTrack.Vertex());
+        pfp.pfp_sec_fiducial_dist_end = fTpcGeo.MinDistToWall(secTrack.End());
       }
 
       // APA cut - get the minimum distance to the APA at all PDS times
       std::pair<double, double> ApaMin = fCosId.ApaAlg().MinApaDistance(detProp, tpcTrack, hits, fakeTpc0Flashes, fakeTpc1Flashes);
-      pfp_apa_min_dist = ApaMin.first;
+      pfp.pfp_apa_min_dist = ApaMin.first;
       if(useSecTrack){
         std::vector<art::Ptr<recob::Hit>> secHits = findManyHits.at(secTrack.ID());
         std::pair<double, double> ApaMin = fCosId.ApaAlg().MinApaDistance(detProp, secTrack, hits, fakeTpc0Flashes, fakeTpc1Flashes);
-        pfp_sec_apa_min_dist = ApaMin.first;
+        pfp.pfp_sec_apa_min_dist = ApaMin.first;
       }
 
       // Get the PFParticle Nu Score for the PFP Neutrino
-      pfp_pandora_nu_score = fCosId.PandoraNuScoreAlg().GetPandoraNuScore(*pParticle, findManyPFPMetadata);
+      pfp.pfp_pandora_nu_score = pfpIndex.NuScore(pParticle.key());
+
+      row.fill = true;
+    };
+
+    std::vector<PfpRow> pfpRows(primaries.size());
+    auto computeRow = [&](size_t i){ computePfpRow(primaries[i], pfpRows[i]); };
+    if (fUsePfpWorkers) tbb::parallel_for(size_t(0), primaries.size(), computeRow);
+    else {
+      for (size_t i = 0; i < primaries.size(); i++) computeRow(i);
+    }
+
+    std::map<int, bool> isPfpNu;
+    for (auto const& row : pfpRows){
+      for (auto const& trackNu : row.isPfpNu) isPfpNu[trackNu.first] = trackNu.second;
+      if (!row.fill) continue;
+
+      const double lastTime = fPfp.pfp_time;
+      fPfp = row.vars;
+      if (!row.trueMatch) fPfp.pfp_time = lastTime;
 
       // Fill the PFParticle tree
       fPfpTree->Fill();
-
     }
 
     //----------------------------------------------------------------------------------------------------------
@@ -674,7 +743,7 @@ namespace sbnd {
 
       // Get the associated hits
       std::vector<art::Ptr<recob::Hit>> hits = findManyHits.at(tpcTrack.ID());
-      int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, hits, false);
+      int trueId = RecoUtils::TrueParticleIDFromTotalRecoHits(clockData, fHitTruth, hits, false);
 
       std::vector<art::Ptr<anab::Calorimetry>> calos = findManyCalo.at(tpcTrack.ID());
 
@@ -741,16 +810,10 @@ namespace sbnd {
 
       // The PFP Nu Score only exists for PFP Neutrinos
       if (track_pfp_nu){
-        for(auto const &pfp : (*pfParticleHandle)){
-          // Get the associated track if there is one
-          const std::vector< art::Ptr<recob::Track> > associatedTracks(pfPartToTrackAssoc.at(pfp.Self()));
-          if(associatedTracks.size() != 1) continue;
-          recob::Track trk = *associatedTracks.front();
-          if(trk.ID() != tpcTrack.ID()) continue;
-
-          recob::PFParticle PFPNeutrino = fCosId.PandoraNuScoreAlg().GetPFPNeutrino(pfp, (*pfParticleHandle));
-          track_pandora_nu_score = fCosId.PandoraNuScoreAlg().GetPandoraNuScore(PFPNeutrino, findManyPFPMetadata);
-          break;
+        // Get the PFParticle the track is associated to
+        size_t pfpPosition = pfpIndex.TrackPosition(tpcTrack.ID());
+        if(pfpPosition != PFParticleIndex::kNotFound){
+          track_pandora_nu_score = pfpIndex.SliceNuScore(pfpPosition);
         }
       }
       // Fill the Track tree
@@ -765,12 +828,15 @@ namespace sbnd {
     
   } // CosmicIdTree::endJob()
 
-  void CosmicIdTree::GetPFParticleIdMap(const PFParticleHandle &pfParticleHandle, PFParticleIdMap &pfParticleMap){
+  void CosmicIdTree::GetPFParticleIdMap(const PFParticleHandle &pfParticleHandle, const PFParticleIndex &pfpIndex, PFParticleIdMap &pfParticleMap){
       for (unsigned int i = 0; i < pfParticleHandle->size(); ++i){
           const art::Ptr<recob::PFParticle> pParticle(pfParticleHandle, i);
-          if (!pfParticleMap.insert(PFParticleIdMap::value_type(pParticle->Self(), pParticle)).second){
+          // The index keeps the first PFParticle of each ID, as the map does
+          if (pfpIndex.Position(pParticle->Self()) != i){
               std::cout << "  Unable to get PFParticle ID map, the input PFParticle collection has repeat IDs!" <<"\n";
+              continue;
           }
+          pfParticleMap.emplace(pParticle->Self(), pParticle);
       }
   }
 
@@ -800,39 +866,39 @@ namespace sbnd {
     track_pandora_nu_score = -99999;
   }
 
-  void CosmicIdTree::ResetPfpVars(){
-    pfp_type = "none";
-    pfp_nu = false;
-    pfp_nu_tpc = -99999;
-    pfp_n_tracks = 0;
-    pfp_pdg = -99999;
-    pfp_length = -99999;
-    pfp_momentum = -99999;
-    pfp_theta = -99999;
-    pfp_phi = -99999;
-    pfp_tracks_angle = -99999;
-    pfp_second_length = -99999;
-    pfp_crt_hit_true_match = false;
-    pfp_crt_hit_dca = -99999;
-    pfp_sec_crt_hit_dca = -99999;
-    pfp_crt_track_true_match = false;
-    pfp_crt_track_dca = -99999;
-    pfp_crt_track_angle = -99999;
-    pfp_stops = false;
-    pfp_stop_ratio_start = -99999;
-    pfp_stop_ratio_end = -99999;
-    pfp_sec_stop_ratio_start = -99999;
-    pfp_sec_stop_ratio_end = -99999;
-    pfp_fiducial_dist_start = -99999;
-    pfp_fiducial_dist_end = -99999;
-    pfp_sec_fiducial_dist_start = -99999;
-    pfp_sec_fiducial_dist_end = -99999;
-    pfp_tpc = -99999;
-    pfp_apa_cross = false;
-    pfp_apa_dist = -99999;
-    pfp_apa_min_dist = -99999;
-    pfp_sec_apa_min_dist = -99999;
-    pfp_pandora_nu_score = -99999;
+  void CosmicIdTree::ResetPfpVars(PfpVars &pfp) const {
+    pfp.pfp_type = "none";
+    pfp.pfp_nu = false;
+    pfp.pfp_nu_tpc = -99999;
+    pfp.pfp_n_tracks = 0;
+    pfp.pfp_pdg = -99999;
+    pfp.pfp_length = -99999;
+    pfp.pfp_momentum = -99999;
+    pfp.pfp_theta = -99999;
+    pfp.pfp_phi = -99999;
+    pfp.pfp_tracks_angle = -99999;
+    pfp.pfp_second_length = -99999;
+    pfp.pfp_crt_hit_true_match = false;
+    pfp.pfp_crt_hit_dca = -99999;
+    pfp.pfp_sec_crt_hit_dca = -99999;
+    pfp.pfp_crt_track_true_match = false;
+    pfp.pfp_crt_track_dca = -99999;
+    pfp.pfp_crt_track_angle = -99999;
+    pfp.pfp_stops = false;
+    pfp.pfp_stop_ratio_start = -99999;
+    pfp.pfp_stop_ratio_end = -99999;
+    pfp.pfp_sec_stop_ratio_start = -99999;
+    pfp.pfp_sec_stop_ratio_end = -99999;
+    pfp.pfp_fiducial_dist_start = -99999;
+    pfp.pfp_fiducial_dist_end = -99999;
+    pfp.pfp_sec_fiducial_dist_start = -99999;
+    pfp.pfp_sec_fiducial_dist_end = -99999;
+    pfp.pfp_tpc = -99999;
+    pfp.pfp_apa_cross = false;
+    pfp.pfp_apa_dist = -99999;
+    pfp.pfp_apa_min_dist = -99999;
+    pfp.pfp_sec_apa_min_dist = -99999;
+    pfp.pfp_pandora_nu_score = -99999;
   }
   
   DEFINE_ART_MODULE(CosmicIdTree)
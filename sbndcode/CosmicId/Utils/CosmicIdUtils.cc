@@ -1,11 +1,13 @@
 #include "CosmicIdUtils.h"
 
+#include <algorithm>
+
 namespace sbnd{
 
 // =============================== UTILITY FUNCTIONS ==============================
 
   // Create fake PDS optical flashes from true particle energy deposits
-  std::pair<std::vector<double>, std::vector<double>> CosmicIdUtils::FakeTpcFlashes(std::vector<simb::MCParticle> particles){
+  std::pair<FlashTimeIndex, FlashTimeIndex> CosmicIdUtils::FakeTpcFlashes(const std::vector<simb::MCParticle>& particles){
     //
     TPCGeoAlg fTpcGeo;
 
@@ -70,21 +72,17 @@ namespace sbnd{
       else previousTime = time;
     }
 
-    return std::make_pair(fakeTpc0Flashes, fakeTpc1Flashes);
+    return std::make_pair(FlashTimeIndex(std::move(fakeTpc0Flashes)), FlashTimeIndex(std::move(fakeTpc1Flashes)));
   }
 
   // Determine if there is a PDS flash in time with the neutrino beam
-  bool CosmicIdUtils::BeamFlash(std::vector<double> flashes, double beamTimeMin, double beamTimeMax){
-    //
-    bool beamFlash = false;
-    std::sort(flashes.begin(), flashes.end());
-    // Loop over flashes in tpc 0
-    for(size_t i = 0; i < flashes.size(); i++){
-      double time = flashes[i];
-      if(time > beamTimeMin && time < beamTimeMax) beamFlash = true;
-    }
+  bool CosmicIdUtils::BeamFlash(const FlashTimeIndex& flashes, double beamTimeMin, double beamTimeMax){
+    return flashes.AnyBetween(beamTimeMin, beamTimeMax);
+  }
 
-    return beamFlash;
+  bool CosmicIdUtils::BeamFlash(const std::vector<double>& flashes, double beamTimeMin, double beamTimeMax){
+    return std::any_of(flashes.begin(), flashes.end(),
+                       [&](double time){ return time > beamTimeMin && time < beamTimeMax; });
   }
 
 }
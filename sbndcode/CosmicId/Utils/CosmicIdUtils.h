@@ -11,6 +11,7 @@
 
 // sbndcode
 #include "sbndcode/Geometry/GeometryWrappers/TPCGeoAlg.h"
+#include "sbndcode/CosmicId/Utils/FlashTimeIndex.h"
 
 // LArSoft
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
@@ -24,11 +25,12 @@
 namespace sbnd{
 namespace CosmicIdUtils{
 
-  // Create fake PDS optical flashes from true particle energy deposits
-  std::pair<std::vector<double>, std::vector<double>> FakeTpcFlashes(std::vector<simb::MCParticle> particles);
+  // Create fake PDS optical flashes from true particle energy deposits, indexed once per event
+  std::pair<FlashTimeIndex, FlashTimeIndex> FakeTpcFlashes(const std::vector<simb::MCParticle>& particles);
 
   // Determine if there is a PDS flash in time with the neutrino beam
-  bool BeamFlash(std::vector<double> flashes, double beamTimeMin, double beamTimeMax);
+  bool BeamFlash(const FlashTimeIndex& flashes, double beamTimeMin, double beamTimeMax);
+  bool BeamFlash(const std::vector<double>& flashes, double beamTimeMin, double beamTimeMax);
   
 }
 }
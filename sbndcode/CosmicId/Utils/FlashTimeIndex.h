@@ -0,0 +1,73 @@
+#ifndef FLASHTIMEINDEX_H_SEEN
+#define FLASHTIMEINDEX_H_SEEN
+
+
+///////////////////////////////////////////////
+// FlashTimeIndex.h
+//
+// Times of the (fake or reconstructed) optical
+// flashes of one TPC in an event, sorted once
+// when the index is made so that the cosmic ID
+// algorithms can query time windows with a
+// binary search for each track or PFParticle.
+///////////////////////////////////////////////
+
+// c++
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sbnd{
+
+  class FlashTimeIndex {
+
+  public:
+
+    using const_iterator = std::vector<double>::const_iterator;
+
+    FlashTimeIndex() = default;
+
+    // Takes the flash times [us] in any order
+    explicit FlashTimeIndex(std::vector<double> times)
+      : fTimes(std::move(times))
+    {
+      std::sort(fTimes.begin(), fTimes.end());
+    }
+
+    // Sorted flash times
+    const std::vector<double>& Times() const { return fTimes; }
+    const_iterator begin() const { return fTimes.begin(); }
+    const_iterator end() const { return fTimes.end(); }
+    size_t size() const { return fTimes.size(); }
+    bool empty() const { return fTimes.empty(); }
+
+    // First flash at or after time
+    const_iterator LowerBound(double time) const
+    {
+      return std::lower_bound(fTimes.begin(), fTimes.end(), time);
+    }
+
+    // Whether there is a flash strictly between tmin and tmax
+    bool AnyBetween(double tmin, double tmax) const
+    {
+      auto const it = std::upper_bound(fTimes.begin(), fTimes.end(), tmin);
+      return it != fTimes.end() && *it < tmax;
+    }
+
+    // Number of flashes strictly between tmin and tmax
+    size_t CountBetween(double tmin, double tmax) const
+    {
+      if(!(tmin < tmax)) return 0;
+      return std::lower_bound(fTimes.begin(), fTimes.end(), tmax)
+        - std::upper_bound(fTimes.begin(), fTimes.end(), tmin);
+    }
+
+  private:
+
+    std::vector<double> fTimes;
+  };
+
+}
+
+#endif
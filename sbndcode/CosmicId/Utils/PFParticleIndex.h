@@ -0,0 +1,170 @@
+#ifndef PFPARTICLEINDEX_H_SEEN
+#define PFPARTICLEINDEX_H_SEEN
+
+
+///////////////////////////////////////////////
+// PFParticleIndex.h
+//
+// Lookup tables over the PFParticles of one
+// event, made in a single pass so that the
+// cosmic ID algorithms and analysers can find
+// a PFParticle by ID, its neutrino ancestor,
+// the pandora nu score of its slice and the
+// PFParticle of a track without searching the
+// collection for each query.
+///////////////////////////////////////////////
+
+// framework
+#include "canvas/Persistency/Common/FindManyP.h"
+
+// LArSoft
+#include "lardataobj/RecoBase/PFParticle.h"
+#include "lardataobj/RecoBase/PFParticleMetadata.h"
+#include "lardataobj/RecoBase/Track.h"
+
+// c++
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace sbnd{
+
+  class PFParticleIndex {
+
+  public:
+
+    static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+    static constexpr float kNoNuScore = 99999;
+
+    PFParticleIndex() = default;
+
+    // Takes the PFParticle collection with its metadata associations and,
+    // optionally, its track associations
+    PFParticleIndex(const std::vector<recob::PFParticle>& pfps,
+                    const art::FindManyP<larpandoraobj::PFParticleMetadata>& metadataAssoc,
+                    const art::FindManyP<recob::Track>* trackAssoc = nullptr)
+      : fPfps(&pfps)
+      , fNeutrino(pfps.size(), kNotFound)
+      , fNuScore(pfps.size(), kNoNuScore)
+      , fNuScoreStatus(pfps.size(), kNoMetadata)
+    {
+      fPosition.reserve(pfps.size());
+      for(size_t i = 0; i < pfps.size(); i++){
+        // Keep the first of repeated IDs
+        if(!fPosition.emplace(pfps[i].Self(), i).second) fRepeatIds = true;
+      }
+
+      for(size_t i = 0; i < pfps.size(); i++){
+        ResolveNeutrino(i);
+        ReadNuScore(i, metadataAssoc.at(i));
+        if(!trackAssoc) continue;
+        // The first PFParticle with a single track is the one of the track
+        const std::vector<art::Ptr<recob::Track>>& tracks = trackAssoc->at(i);
+        if(tracks.size() == 1) fTrackPosition.emplace(tracks.front()->ID(), i);
+      }
+    }
+
+    size_t size() const { return fNeutrino.size(); }
+    bool empty() const { return fNeutrino.empty(); }
+    const recob::PFParticle& at(size_t position) const { return fPfps->at(position); }
+
+    // Whether several PFParticles share an ID
+    bool HasRepeatIds() const { return fRepeatIds; }
+
+    // Position in the collection of the PFParticle with an ID, or kNotFound
+    size_t Position(size_t self) const
+    {
+      auto const it = fPosition.find(self);
+      return it == fPosition.end() ? kNotFound : it->second;
+    }
+
+    // Position of the PFParticle with a single track of this ID, or kNotFound
+    size_t TrackPosition(int trackId) const
+    {
+      auto const it = fTrackPosition.find(trackId);
+      return it == fTrackPosition.end() ? kNotFound : it->second;
+    }
+
+    // Position of the first neutrino (nu_e or nu_mu) up the parent chain,
+    // the PFParticle itself included, or of the top of the chain if none
+    size_t NeutrinoPosition(size_t position) const { return fNeutrino.at(position); }
+
+    // Pandora nu score from the metadata of a PFParticle, kNoNuScore if it has none
+    float NuScore(size_t position) const
+    {
+      switch(fNuScoreStatus.at(position)){
+        case kNoMetadata:
+          std::cout<<"Cannot get PFPMetadata"<<std::endl;
+          break;
+        case kNoScore:
+          std::cout<<"Cannot get PFP Nu Score in Metadata"<<std::endl;
+          std::cout<<"PFP pdg: "<<at(position).PdgCode()<<std::endl;
+          break;
+        case kFound:
+          break;
+      }
+      return fNuScore[position];
+    }
+
+    // Nu score of the slice (neutrino ancestor) of a PFParticle
+    float SliceNuScore(size_t position) const { return NuScore(NeutrinoPosition(position)); }
+
+  private:
+
+    enum NuScoreStatus : unsigned char { kNoMetadata, kNoScore, kFound };
+
+    static bool IsNeutrino(const recob::PFParticle& pfp)
+    {
+      return pfp.PdgCode() == 12 || pfp.PdgCode() == 14;
+    }
+
+    // Walk up from a PFParticle until a neutrino, the top of the chain or a
+    // PFParticle already resolved, then resolve the whole walk at once
+    void ResolveNeutrino(size_t position)
+    {
+      if(fNeutrino[position] != kNotFound) return;
+
+      std::vector<size_t> chain;
+      size_t current = position;
+      size_t neutrino = kNotFound;
+      while(neutrino == kNotFound){
+        chain.push_back(current);
+        const recob::PFParticle& pfp = (*fPfps)[current];
+        size_t const parent = IsNeutrino(pfp) ? kNotFound : Position(pfp.Parent());
+        // Stop on a loop in the parents as on the top of the chain
+        bool const looped = parent != kNotFound && std::find(chain.begin(), chain.end(), parent) != chain.end();
+        if(parent == kNotFound || looped) neutrino = current;
+        else if(fNeutrino[parent] != kNotFound) neutrino = fNeutrino[parent];
+        else current = parent;
+      }
+      for(size_t const i : chain) fNeutrino[i] = neutrino;
+    }
+
+    void ReadNuScore(size_t position, const std::vector<art::Ptr<larpandoraobj::PFParticleMetadata>>& metadata)
+    {
+      if(metadata.size() != 1) return;
+      const larpandoraobj::PFParticleMetadata::PropertiesMap& properties = metadata.front()->GetPropertiesMap();
+      auto const it = properties.find("NuScore");
+      if(it == properties.end()){
+        fNuScoreStatus[position] = kNoScore;
+        return;
+      }
+      fNuScore[position] = it->second;
+      fNuScoreStatus[position] = kFound;
+    }
+
+    const std::vector<recob::PFParticle>* fPfps = nullptr;
+    std::unordered_map<size_t, size_t> fPosition;
+    std::unordered_map<int, size_t> fTrackPosition;
+    std::vector<size_t> fNeutrino;
+    std::vector<float> fNuScore;
+    std::vector<NuScoreStatus> fNuScoreStatus;
+    bool fRepeatIds = false;
+  };
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////
+// PTBTriggerIndex.h
+//
+// Per input file summary of the PTB triggers of each event: the OR of the
+// high and low level trigger words and the first timestamps, written by
+// SBNDPTBDecoder (WriteTriggerIndex) next to the job's output as a small
+// sidecar file. A later job selecting events by trigger type reads it
+// with PTBTriggerIndexFilter, which decides from the index alone, so the
+// fragments of the rejected events are never read or decoded.
+//
+// The index of an input file is found by its base name: pathFor() gives
+// <dir>/<input base name>.ptbidx. The file is written through a temporary
+// file, so a concurrent reader never sees a partial one, and a missing or
+// damaged file is reported as not read.
+//
+// Layout (native byte order):
+//   "SBNDPTBI", uint32 version, uint32 number of entries, uint64 checksum
+//   of the entries, then the entries, sorted by event ID, each uint32 run,
+//   subrun, event, number of HLTs, uint64 OR of the HLT words, OR of the
+//   LLT words, first HLT timestamp, first timestamp of any trigger.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_DECODERS_PTB_PTBTRIGGERINDEX_H
+#define SBNDCODE_DECODERS_PTB_PTBTRIGGERINDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "sbndcode/Decoders/PTB/sbndptb.h"
+
+namespace raw {
+  namespace ptb {
+
+    class PTBTriggerIndex {
+
+    public:
+
+      static constexpr std::uint64_t kNoTimestamp = std::numeric_limits<std::uint64_t>::max();
+
+      struct Entry {
+        std::uint32_t run = 0;
+        std::uint32_t subrun = 0;
+        std::uint32_t event = 0;
+        std::uint32_t nHLTs = 0;
+        std::uint64_t hltWord = 0;          ///< OR of the HLT trigger words
+        std::uint64_t lltWord = 0;          ///< OR of the LLT trigger words
+        std::uint64_t hltTimestamp = kNoTimestamp;  ///< earliest HLT
+        std::uint64_t firstTimestamp = kNoTimestamp; ///< earliest HLT or LLT
+
+        bool operator<(Entry const& other) const
+          { return std::tie(run, subrun, event) < std::tie(other.run, other.subrun, other.event); }
+      };
+
+      // Summary of the PTB words of one event
+      static Entry summarize(std::uint32_t run, std::uint32_t subrun, std::uint32_t event,
+                             std::vector<raw::ptb::sbndptb> const& ptbs) {
+        Entry entry;
+        entry.run = run;
+        entry.subrun = subrun;
+        entry.event = event;
+        for (raw::ptb::sbndptb const& ptb: ptbs) {
+          for (raw::ptb::Trigger const& trigger: ptb.GetHLTriggers()) {
+            ++entry.nHLTs;
+            entry.hltWord |= trigger.trigger_word;
+            entry.hltTimestamp = std::min<std::uint64_t>(entry.hltTimestamp, trigger.timestamp);
+          }
+          for (raw::ptb::Trigger const& trigger: ptb.GetLLTriggers()) {
+            entry.lltWord |= trigger.trigger_word;
+            entry.firstTimestamp = std::min<std::uint64_t>(entry.firstTimestamp, trigger.timestamp);
+          }
+        }
+        entry.firstTimestamp = std::min(entry.firstTimestamp, entry.hltTimestamp);
+        return entry;
+      }
+
+      // Index file of an input file: <dir>/<base name of the input>.ptbidx
+      static std::string pathFor(std::string const& dir, std::string const& inputFile) {
+        std::string const base = inputFile.substr(inputFile.find_last_of('/') + 1);
+        return (dir.empty() ? std::string(".") : dir) + "/" + base + ".ptbidx";
+      }
+
+      bool empty() const { return fEntries.empty(); }
+      std::size_t size() const { return fEntries.size(); }
+      void clear() { fEntries.clear(); fSorted = true; }
+
+      void add(Entry const& entry) {
+        fSorted = fSorted && (fEntries.empty() || fEntries.back() < entry);
+        fEntries.push_back(entry);
+      }
+
+      // The entry of an event, or nullptr if it is not in the index
+      Entry const* find(std::uint32_t run, std::uint32_t subrun, std::uint32_t event) {
+        sort();
+        Entry key;
+        key.run = run;
+        key.subrun = subrun;
+        key.event = event;
+        auto const iter = std::lower_bound(fEntries.begin(), fEntries.end(), key);
+        if (iter == fEntries.end() || key < *iter) return nullptr;
+        return &*iter;
+      }
+
+      // Reads the index at path; false if it is not there or damaged.
+      bool read(std::string const& path);
+
+      // Writes the index to path; false on failure.
+      bool write(std::string const& path);
+
+    private:
+
+      static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'P', 'T', 'B', 'I' };
+      static constexpr std::uint32_t kVersion = 1;
+
+      static_assert(sizeof(Entry) == 48, "the index entries are written as they are in memory");
+
+      // 64-bit FNV-1a hash
+      static std::uint64_t fnv1a(char const* data, std::size_t size) {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (std::size_t i = 0; i < size; ++i) {
+          hash ^= (unsigned char) data[i];
+          hash *= 0x100000001b3ULL;
+        }
+        return hash;
+      }
+
+      void sort() {
+        if (!fSorted) std::sort(fEntries.begin(), fEntries.end());
+        fSorted = true;
+      }
+
+      std::vector<Entry> fEntries;
+      bool               fSorted = true;
+
+    };
+
+  } // namespace ptb
+} // namespace raw
+
+//----------------------------------------------------------------------
+
+inline bool raw::ptb::PTBTriggerIndex::read(std::string const& path) {
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+
+  char magic[sizeof(kMagic)];
+  std::uint32_t version = 0, nEntries = 0;
+  std::uint64_t checksum = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&nEntries), sizeof(nEntries));
+  in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+  if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) return false;
+
+  std::vector<Entry> entries(nEntries);
+  std::size_t const bytes = nEntries*sizeof(Entry);
+  in.read(reinterpret_cast<char*>(entries.data()), bytes);
+  if (!in || in.peek() != std::ifstream::traits_type::eof()) return false;
+  if (fnv1a(reinterpret_cast<char const*>(entries.data()), bytes) != checksum) return false;
+
+  fEntries = std::move(entries);
+  fSorted = std::is_sorted(fEntries.begin(), fEntries.end());
+  return true;
+}
+
+inline bool raw::ptb::PTBTriggerIndex::write(std::string const& path) {
+
+  sort();
+  std::uint32_t const nEntries = fEntries.size();
+  std::size_t const bytes = nEntries*sizeof(Entry);
+  std::uint64_t const checksum = fnv1a(reinterpret_cast<char const*>(fEntries.data()), bytes);
+
+  std::string const tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<char const*>(&nEntries), sizeof(nEntries));
+    out.write(reinterpret_cast<char const*>(&checksum), sizeof(checksum));
+    out.write(reinterpret_cast<char const*>(fEntries.data()), bytes);
+    out.close();
+    if (!out) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+#endif // SBNDCODE_DECODERS_PTB_PTBTRIGGERINDEX_H
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       PTBTriggerIndexFilter
+// Plugin Type: filter
+// File:        PTBTriggerIndexFilter_module.cc
+//
+// Selects events by PTB trigger type from the trigger index SBNDPTBDecoder
+// writes for each input file (WriteTriggerIndex), without reading the PTB
+// fragments. An event passes if its HLT trigger word has any of HLTBits
+// set, or its LLT trigger word any of LLTBits. Put it first in the trigger
+// path: the rejected events are not decoded, and since art reads products
+// only when asked for them, their fragments are never read from the file.
+//
+// Events missing from the index are rejected. An input file without an
+// index is an error with RequireIndex, otherwise all of its events pass.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDFilter.h"
+#include "art/Framework/Core/FileBlock.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sbndcode/Decoders/PTB/PTBTriggerIndex.h"
+
+class PTBTriggerIndexFilter : public art::EDFilter {
+public:
+  explicit PTBTriggerIndexFilter(fhicl::ParameterSet const & p);
+
+  // Plugins should not be copied or assigned.
+  PTBTriggerIndexFilter(PTBTriggerIndexFilter const &) = delete;
+  PTBTriggerIndexFilter(PTBTriggerIndexFilter &&) = delete;
+  PTBTriggerIndexFilter & operator = (PTBTriggerIndexFilter const &) = delete;
+  PTBTriggerIndexFilter & operator = (PTBTriggerIndexFilter &&) = delete;
+
+  bool filter(art::Event & e) override;
+
+  void respondToOpenInputFile(art::FileBlock const& fb) override;
+  void endJob() override;
+
+private:
+
+  static uint64_t BitMask(std::vector<unsigned> const& bits, std::string const& name);
+
+  std::string fTriggerIndexDir;
+  uint64_t fHLTMask;
+  uint64_t fLLTMask;
+  bool fRequireIndex;
+
+  raw::ptb::PTBTriggerIndex fTriggerIndex;
+  bool fHaveIndex = false;  // an index was read for the current input file
+
+  unsigned long fNEvents = 0;
+  unsigned long fNPassed = 0;
+  unsigned long fNNotIndexed = 0;
+};
+
+
+PTBTriggerIndexFilter::PTBTriggerIndexFilter(fhicl::ParameterSet const & p)
+  : EDFilter{p}
+  , fTriggerIndexDir(p.get<std::string>("TriggerIndexDir","."))
+  , fHLTMask(BitMask(p.get<std::vector<unsigned>>("HLTBits",{}), "HLTBits"))
+  , fLLTMask(BitMask(p.get<std::vector<unsigned>>("LLTBits",{}), "LLTBits"))
+  , fRequireIndex(p.get<bool>("RequireIndex",true))
+{
+  if (fHLTMask == 0 && fLLTMask == 0)
+    {
+      throw cet::exception("PTBTriggerIndexFilter") << "no trigger bit selected: set HLTBits and/or LLTBits\n";
+    }
+}
+
+uint64_t PTBTriggerIndexFilter::BitMask(std::vector<unsigned> const& bits, std::string const& name)
+{
+  uint64_t mask = 0;
+  for (unsigned bit: bits)
+    {
+      if (bit >= 64)
+        {
+          throw cet::exception("PTBTriggerIndexFilter") << name << ": bit " << bit << " is not in a 64-bit trigger word\n";
+        }
+      mask |= uint64_t(1) << bit;
+    }
+  return mask;
+}
+
+void PTBTriggerIndexFilter::respondToOpenInputFile(art::FileBlock const& fb)
+{
+  std::string const path = raw::ptb::PTBTriggerIndex::pathFor(fTriggerIndexDir, fb.fileName());
+  fHaveIndex = fTriggerIndex.read(path);
+  if (fHaveIndex) return;
+
+  fTriggerIndex.clear();
+  if (fRequireIndex)
+    {
+      throw cet::exception("PTBTriggerIndexFilter") << "no readable trigger index " << path
+                                                    << " for the input file " << fb.fileName() << "\n";
+    }
+  mf::LogWarning("PTBTriggerIndexFilter") << "No readable trigger index " << path
+                                          << ": all the events of " << fb.fileName() << " pass";
+}
+
+bool PTBTriggerIndexFilter::filter(art::Event & evt)
+{
+  ++fNEvents;
+  if (!fHaveIndex)
+    {
+      ++fNPassed;
+      return true;
+    }
+
+  raw::ptb::PTBTriggerIndex::Entry const* entry = fTriggerIndex.find(evt.run(), evt.subRun(), evt.event());
+  if (!entry)
+    {
+      ++fNNotIndexed;
+      return false;
+    }
+
+  bool const pass = (entry->hltWord & fHLTMask) || (entry->lltWord & fLLTMask);
+  if (pass) ++fNPassed;
+  return pass;
+}
+
+void PTBTriggerIndexFilter::endJob()
+{
+  mf::LogInfo("PTBTriggerIndexFilter") << fNPassed << " of " << fNEvents << " events passed"
+                                       << " (" << fNNotIndexed << " not in the index)";
+}
+
+
+DEFINE_ART_MODULE(PTBTriggerIndexFilter)
@@ -6,6 +6,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/FileBlock.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -18,8 +19,10 @@
 #include <memory>
 
 #include "sbndaq-artdaq-core/Overlays/SBND/PTBFragment.hh"
+#include "sbndaq-artdaq-core/Overlays/SBND/PTB_content.h"
 #include "artdaq-core/Data/ContainerFragment.hh"
 #include "sbndcode/Decoders/PTB/sbndptb.h"
+#include "sbndcode/Decoders/PTB/PTBTriggerIndex.h"
 
 class SBNDPTBDecoder;
 
@@ -39,6 +42,10 @@ public:
   // Required functions.
   void produce(art::Event & e) override;
 
+  // the trigger index covers one input file
+  void respondToOpenInputFile(art::FileBlock const& fb) override;
+  void respondToCloseInputFile(art::FileBlock const& fb) override;
+
 private:
 
   // Declare member data here.
@@ -48,6 +55,11 @@ private:
   std::string fInputNonContainerInstance;
   std::string fOutputInstance;
   int fDebugLevel;
+  bool fDecodeFeedbacks;  // feedback and misc words are still listed in the word index when not decoded
+  bool fDecodeMiscs;
+  bool fWriteTriggerIndex;  // trigger summary of each event of an input file, for PTBTriggerIndexFilter
+  std::string fTriggerIndexDir;
+  raw::ptb::PTBTriggerIndex fTriggerIndex;
   
   typedef struct ptbsv
   {
@@ -72,6 +84,10 @@ SBNDPTBDecoder::SBNDPTBDecoder(fhicl::ParameterSet const & p)
   fInputNonContainerInstance = p.get<std::string>("InputNonContainerInstance");
   fOutputInstance = p.get<std::string>("OutputInstance");
   fDebugLevel = p.get<int>("DebugLevel",0);
+  fDecodeFeedbacks = p.get<bool>("DecodeFeedbacks",true);
+  fDecodeMiscs = p.get<bool>("DecodeMiscs",true);
+  fWriteTriggerIndex = p.get<bool>("WriteTriggerIndex",false);
+  fTriggerIndexDir = p.get<std::string>("TriggerIndexDir",".");
   
   produces<std::vector<raw::ptb::sbndptb> >(fOutputInstance);
 }
@@ -95,8 +111,8 @@ void SBNDPTBDecoder::produce(art::Event & evt)
 	    {
               ptbsv_t sout;  // output structures
 	      _process_PTB_AUX(*cont_frag[ii], sout);
-              raw::ptb::sbndptb ptbdp(sout.HLTrigs,sout.LLTrigs,sout.ChStats,sout.Feedbacks,sout.Miscs,sout.WordIndexes);
-              sbndptbs.push_back(ptbdp);
+              sbndptbs.emplace_back(std::move(sout.HLTrigs),std::move(sout.LLTrigs),std::move(sout.ChStats),
+                                    std::move(sout.Feedbacks),std::move(sout.Miscs),std::move(sout.WordIndexes));
 	    }
 	}
     }
@@ -109,14 +125,41 @@ void SBNDPTBDecoder::produce(art::Event & evt)
 	{
           ptbsv_t sout;  // output structures
 	  _process_PTB_AUX(frag, sout);
-          raw::ptb::sbndptb ptbdp(sout.HLTrigs,sout.LLTrigs,sout.ChStats,sout.Feedbacks,sout.Miscs,sout.WordIndexes);
-          sbndptbs.push_back(ptbdp);
+          sbndptbs.emplace_back(std::move(sout.HLTrigs),std::move(sout.LLTrigs),std::move(sout.ChStats),
+                                std::move(sout.Feedbacks),std::move(sout.Miscs),std::move(sout.WordIndexes));
 	}
     }
 
+  if (fWriteTriggerIndex)
+    {
+      fTriggerIndex.add(raw::ptb::PTBTriggerIndex::summarize(evt.run(), evt.subRun(), evt.event(), sbndptbs));
+    }
+
   evt.put(std::make_unique<std::vector<raw::ptb::sbndptb>>(std::move(sbndptbs)),fOutputInstance);
 }
 
+void SBNDPTBDecoder::respondToOpenInputFile(art::FileBlock const&)
+{
+  fTriggerIndex.clear();
+}
+
+void SBNDPTBDecoder::respondToCloseInputFile(art::FileBlock const& fb)
+{
+  if (!fWriteTriggerIndex) return;
+
+  // an index that cannot be written only costs the skims a full decoding
+  std::string const path = raw::ptb::PTBTriggerIndex::pathFor(fTriggerIndexDir, fb.fileName());
+  if (!fTriggerIndex.write(path))
+    {
+      mf::LogWarning("SBNDPTBDecoder") << "Cannot write the trigger index " << path;
+    }
+  else if (fDebugLevel > 0)
+    {
+      std::cout << "SBNDPTBDecoder_module: wrote " << fTriggerIndex.size() << " events to " << path << std::endl;
+    }
+  fTriggerIndex.clear();
+}
+
 void SBNDPTBDecoder::_process_PTB_AUX(const artdaq::Fragment& frag, ptbsv_t &sout)
 {
   sbndaq::CTBFragment ctbfrag(frag);   // somehow the name CTBFragment stuck
@@ -128,94 +171,106 @@ void SBNDPTBDecoder::_process_PTB_AUX(const artdaq::Fragment& frag, ptbsv_t &sou
       std::cout << "SBNDPTBDecoder_module: got into aux" << std::endl;
     }
   
-  for (size_t iword = 0; iword < ctbfrag.NWords(); ++iword)
+  // one pass over the words: each is classified once by its word type and
+  // decoded straight into the output vectors
+  const size_t nwords = ctbfrag.NWords();
+  sout.WordIndexes.reserve(nwords);
+  size_t nfeedbacks = 0;  // words seen, decoded or not, so the indexes do not depend on what is decoded
+  size_t nmiscs = 0;
+
+  for (size_t iword = 0; iword < nwords; ++iword)
     {
       if (fDebugLevel > 0)
         {
           std::cout << "SBNDPTBDecoder_module: start processing word: " << iword << std::endl;
 	}
       size_t ix=0;
-      uint32_t wt = 0;
-      if (ctbfrag.Trigger(iword))
-	{
-	  raw::ptb::Trigger tstruct;
-	  tstruct.word_type = ctbfrag.Trigger(iword)->word_type;
-	  wt = tstruct.word_type;
-	  tstruct.trigger_word = ctbfrag.Trigger(iword)->trigger_word;
-	  tstruct.timestamp = ctbfrag.Trigger(iword)->timestamp;
-	  if (ctbfrag.Trigger(iword)->IsHLT()) 
-	    {
-	      ix = sout.HLTrigs.size();
-	      sout.HLTrigs.push_back(tstruct);
-	      if (fDebugLevel > 0)
-		{
-		  std::cout << "SBNDPTBDecoder_module: found HLT: " << wt << " " << ix << std::endl;
-		}
-	    }
-	  else if (ctbfrag.Trigger(iword)->IsLLT())
-	    {
-	      ix = sout.LLTrigs.size();
-	      sout.LLTrigs.push_back(tstruct);
-	      if (fDebugLevel > 0)
-		{
-		  std::cout << "SBNDPTBDecoder_module: found LLT: " << wt << " " << ix << std::endl;
-		}
-	    }
-	}
-      else if (ctbfrag.ChStatus(iword))
-	{
-	  raw::ptb::ChStatus cstruct;
-	  cstruct.timestamp = ctbfrag.ChStatus(iword)->timestamp;
-	  cstruct.beam = ctbfrag.ChStatus(iword)->beam;
-	  cstruct.crt = ctbfrag.ChStatus(iword)->crt;
-	  cstruct.pds = ctbfrag.ChStatus(iword)->pds;
-	  cstruct.mtca = ctbfrag.ChStatus(iword)->mtca;
-	  cstruct.nim = ctbfrag.ChStatus(iword)->nim;
-	  cstruct.auxpds = ctbfrag.ChStatus(iword)->auxpds;
-	  cstruct.word_type = ctbfrag.ChStatus(iword)->word_type;
-	  wt = cstruct.word_type;
-	  ix = sout.ChStats.size();
-	  sout.ChStats.push_back(cstruct);
-	  if (fDebugLevel > 0)
-	    {
-	      std::cout << "SBNDPTBDecoder_module: found CHStat: " << wt << " " << ix << std::endl;
-	    }
-	}
-      else if (ctbfrag.Feedback(iword))
-	{
-	  raw::ptb::Feedback fstruct;
-	  fstruct.timestamp = ctbfrag.Feedback(iword)->timestamp;
-	  fstruct.code = ctbfrag.Feedback(iword)->code;
-	  fstruct.source = ctbfrag.Feedback(iword)->source;
-	  fstruct.payload = ctbfrag.Feedback(iword)->payload;  // broken in two in Tereza's version
-	  fstruct.word_type = ctbfrag.Feedback(iword)->word_type;
-	  wt = fstruct.word_type;
-	  ix = sout.Feedbacks.size();
-	  sout.Feedbacks.push_back(fstruct);
-	  if (fDebugLevel > 0)
-	    {
-	      std::cout << "SBNDPTBDecoder_module: found Feedback: " << wt << " " << ix << std::endl;
-	    }
-	}
-      else
+      const uint32_t wt = ctbfrag.Word(iword)->word_type;
+
+      switch (wt)
 	{
-	  raw::ptb::Misc mstruct;
-	  mstruct.timestamp = ctbfrag.Word(iword)->timestamp;
-	  mstruct.payload = ctbfrag.Word(iword)->payload;
-	  mstruct.word_type = ctbfrag.Word(iword)->word_type;
-	  wt = mstruct.word_type;
-	  ix = sout.Miscs.size();
-	  sout.Miscs.push_back(mstruct);
-	  if (fDebugLevel > 0)
-	    {
-	      std::cout << "SBNDPTBDecoder_module: found Misc: " << wt << " " << ix << std::endl;
-	    }
+	case ::ptb::content::word::t_gt:
+	case ::ptb::content::word::t_lt:
+	  {
+	    auto trig = ctbfrag.Trigger(iword);
+	    const bool hlt = (wt == ::ptb::content::word::t_gt);
+	    auto &trigs = hlt ? sout.HLTrigs : sout.LLTrigs;
+	    ix = trigs.size();
+	    trigs.emplace_back();
+	    raw::ptb::Trigger &tstruct = trigs.back();
+	    tstruct.word_type = trig->word_type;
+	    tstruct.trigger_word = trig->trigger_word;
+	    tstruct.timestamp = trig->timestamp;
+	    if (fDebugLevel > 0)
+	      {
+		std::cout << "SBNDPTBDecoder_module: found " << (hlt ? "HLT: " : "LLT: ") << wt << " " << ix << std::endl;
+	      }
+	    break;
+	  }
+	case ::ptb::content::word::t_ch:
+	  {
+	    auto chstat = ctbfrag.ChStatus(iword);
+	    ix = sout.ChStats.size();
+	    sout.ChStats.emplace_back();
+	    raw::ptb::ChStatus &cstruct = sout.ChStats.back();
+	    cstruct.timestamp = chstat->timestamp;
+	    cstruct.beam = chstat->beam;
+	    cstruct.crt = chstat->crt;
+	    cstruct.pds = chstat->pds;
+	    cstruct.mtca = chstat->mtca;
+	    cstruct.nim = chstat->nim;
+	    cstruct.auxpds = chstat->auxpds;
+	    cstruct.word_type = chstat->word_type;
+	    if (fDebugLevel > 0)
+	      {
+		std::cout << "SBNDPTBDecoder_module: found CHStat: " << wt << " " << ix << std::endl;
+	      }
+	    break;
+	  }
+	case ::ptb::content::word::t_fback:
+	  {
+	    ix = nfeedbacks++;
+	    if (fDecodeFeedbacks)
+	      {
+		auto fback = ctbfrag.Feedback(iword);
+		sout.Feedbacks.emplace_back();
+		raw::ptb::Feedback &fstruct = sout.Feedbacks.back();
+		fstruct.timestamp = fback->timestamp;
+		fstruct.code = fback->code;
+		fstruct.source = fback->source;
+		fstruct.payload = fback->payload;  // broken in two in Tereza's version
+		fstruct.word_type = fback->word_type;
+	      }
+	    if (fDebugLevel > 0)
+	      {
+		std::cout << "SBNDPTBDecoder_module: found Feedback: " << wt << " " << ix << std::endl;
+	      }
+	    break;
+	  }
+	default:
+	  {
+	    ix = nmiscs++;
+	    if (fDecodeMiscs)
+	      {
+		auto word = ctbfrag.Word(iword);
+		sout.Miscs.emplace_back();
+		raw::ptb::Misc &mstruct = sout.Miscs.back();
+		mstruct.timestamp = word->timestamp;
+		mstruct.payload = word->payload;
+		mstruct.word_type = word->word_type;
+	      }
+	    if (fDebugLevel > 0)
+	      {
+		std::cout << "SBNDPTBDecoder_module: found Misc: " << wt << " " << ix << std::endl;
+	      }
+	    break;
+	  }
 	}
 
-      raw::ptb::WordIndex wstruct;
+      sout.WordIndexes.emplace_back();
+      raw::ptb::WordIndex &wstruct = sout.WordIndexes.back();
       wstruct.word_type = wt;
       wstruct.index = ix;
-      sout.WordIndexes.push_back(wstruct);
       if (fDebugLevel > 0)
 	{
 	  std::cout << "SBNDPTBDecoder_module: index calc: " << wt << " " << ix << std::endl;
@@ -20,45 +20,26 @@ namespace raw {
       emptychstat.auxpds = 0;
       emptychstat.word_type = 0;
 
-      // Find the last CHStatus before each HLT
+      // Find the last CHStatus before each HLT, in one pass over the word index:
+      // the HLTs are listed there in the order they were stored
 
       const auto &hlts = pdata.GetHLTriggers();
       const auto &idxs = pdata.GetIndexes();
       const auto &chst = pdata.GetChStatuses();
+      chs.reserve(hlts.size());
       
-      for (size_t i=0; i<hlts.size(); ++i)
+      for (size_t j=0; j<idxs.size(); ++j)
 	{
-	  for (size_t j=0; j<idxs.size(); ++j)
+	  if (idxs[j].word_type != (uint32_t) ::ptb::content::word::t_gt || idxs[j].index >= hlts.size()) continue;
+
+	  // it's the word before the HLT that has the chstat
+	  if (j > 0 && idxs[j-1].word_type == (uint32_t) ::ptb::content::word::t_ch && idxs[j-1].index < chst.size())
+	    {
+	      chs.push_back(chst[idxs[j-1].index]);
+	    }
+	  else
 	    {
-	      if (idxs.at(j).word_type == (uint32_t) ::ptb::content::word::t_gt && idxs.at(j).index == i)
-		{
-		  size_t kstatindex = j;
-		  if (kstatindex > 0)
-		    {
-		      kstatindex --;  // it's the word before the HLT that has the chstat
-		      if (idxs.at(kstatindex).word_type == (uint32_t) ::ptb::content::word::t_ch)
-			{
-			  size_t kstat = idxs.at(kstatindex).index;
-		      
-			  if (kstat < chst.size())
-			    {
-			      chs.push_back(chst.at(kstat));
-			    }
-			  else
-			    {
-			      chs.push_back(emptychstat);
-			    }
-			}
-		      else
-			{
-			  chs.push_back(emptychstat);
-			}
-		    }
-		  else
-		    {
-		      chs.push_back(emptychstat);
-		    }
-		}
+	      chs.push_back(emptychstat);
 	    }
 	}  
       return chs;
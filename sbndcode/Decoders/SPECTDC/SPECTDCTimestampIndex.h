@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////
+// File:        SPECTDCTimestampIndex.h
+//
+// Index of the DAQTimestamps made by the SPECTDCDecoder, for the timing
+// consumers (ToF, CRT-PMT matching, trigger studies) that look up
+// signals of a given TDC channel close to a given time.
+//
+// The timestamps are split by TDC channel and sorted once when the
+// index is built, after which every query is a binary search over the
+// timestamps of one channel instead of a scan of the whole product.
+//
+// Usage:
+//   auto const& tdcVec = e.getProduct<std::vector<sbnd::timing::DAQTimestamp>>(tdcLabel);
+//   sbnd::timing::SPECTDCTimestampIndex const tdcIndex(tdcVec);
+//   sbnd::timing::DAQTimestamp const* rwm = tdcIndex.Nearest(sbnd::timing::kRWM, t);
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_DECODERS_SPECTDC_SPECTDCTIMESTAMPINDEX_H
+#define SBND_DECODERS_SPECTDC_SPECTDCTIMESTAMPINDEX_H
+
+#include "sbnobj/SBND/Timing/DAQTimestamp.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace sbnd {
+  namespace timing {
+
+    // SPEC-TDC input channels
+    enum SPECTDCChannel : uint32_t {
+      kCRTT1Reset = 0,
+      kBES        = 1,
+      kRWM        = 2,
+      kFTRIG      = 3,
+      kETRIG      = 4
+    };
+
+    class SPECTDCTimestampIndex {
+    public:
+
+      SPECTDCTimestampIndex() = default;
+
+      // The timestamps must outlive the index
+      explicit SPECTDCTimestampIndex(std::vector<DAQTimestamp> const& timestamps)
+      {
+        for(DAQTimestamp const& ts : timestamps)
+          {
+            uint32_t const ch = ts.Channel();
+            if(ch >= fChannels.size())
+              fChannels.resize(ch + 1);
+            fChannels[ch].push_back(&ts);
+          }
+
+        for(auto &channel : fChannels)
+          std::stable_sort(channel.begin(), channel.end(), EarlierThan);
+      }
+
+      // Timestamps of the channel, in increasing time order
+      std::vector<DAQTimestamp const*> const& Channel(uint32_t ch) const
+      {
+        return ch < fChannels.size() ? fChannels[ch] : fEmpty;
+      }
+
+      // First timestamp of the channel at or after time t, nullptr if none
+      DAQTimestamp const* FirstAfter(uint32_t ch, uint64_t t) const
+      {
+        auto const& channel = Channel(ch);
+        auto it = LowerBound(channel, t);
+        return it == channel.end() ? nullptr : *it;
+      }
+
+      // Last timestamp of the channel before time t, nullptr if none
+      DAQTimestamp const* LastBefore(uint32_t ch, uint64_t t) const
+      {
+        auto const& channel = Channel(ch);
+        auto it = LowerBound(channel, t);
+        return it == channel.begin() ? nullptr : *(it - 1);
+      }
+
+      // Timestamp of the channel closest to time t (the earlier one on a tie), nullptr if none
+      DAQTimestamp const* Nearest(uint32_t ch, uint64_t t) const
+      {
+        DAQTimestamp const* after  = FirstAfter(ch, t);
+        DAQTimestamp const* before = LastBefore(ch, t);
+
+        if(!before) return after;
+        if(!after) return before;
+
+        return (after->Timestamp() - t) < (t - before->Timestamp()) ? after : before;
+      }
+
+      // Timestamps of the channel in [start, end)
+      std::vector<DAQTimestamp const*> InWindow(uint32_t ch, uint64_t start, uint64_t end) const
+      {
+        auto const& channel = Channel(ch);
+        return std::vector<DAQTimestamp const*>(LowerBound(channel, start), LowerBound(channel, end));
+      }
+
+    private:
+
+      using ChannelTimestamps = std::vector<DAQTimestamp const*>;
+
+      static bool EarlierThan(DAQTimestamp const* a, DAQTimestamp const* b)
+      {
+        return a->Timestamp() < b->Timestamp();
+      }
+
+      static ChannelTimestamps::const_iterator LowerBound(ChannelTimestamps const& channel, uint64_t t)
+      {
+        return std::lower_bound(channel.begin(), channel.end(), t,
+                                [](DAQTimestamp const* ts, uint64_t time) { return ts->Timestamp() < time; });
+      }
+
+      std::vector<ChannelTimestamps> fChannels;
+      ChannelTimestamps              fEmpty;
+    };
+  }
+}
+
+#endif
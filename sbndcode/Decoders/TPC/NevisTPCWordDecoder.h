@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   NevisTPCWordDecoder.h
+///
+/// \brief  Table-driven decoding of the ADC words of a Nevis TPC fragment,
+///         compressed (Huffman) or not, into one flat sample buffer.
+///
+/// The words are the ones sbndaq::NevisTPCFragment::decode_data() reads:
+///   0100 xxxx xxcc cccc  channel header, channel number in the low 6 bits
+///   0101 xxxx xxxx xxxx  channel ending
+///   0000 aaaa aaaa aaaa  one uncompressed 12-bit sample
+///   1hhh hhhh hhhh hhhh  Huffman word: 15 bits of codes of the differences
+///                        between consecutive samples, read from bit 0 up
+/// A code is a run of zeros closed by a one; the number of zeros gives the
+/// difference (0, -1, +1, -2, +2, -3, +3). The zeros above the last one
+/// of a word are padding. The first sample of a channel is uncompressed.
+///
+/// Instead of walking the 15 bits one at a time, a word is decoded a byte
+/// at a time from a table indexed by (zeros pending from the previous
+/// byte, byte): each entry holds the number of codes closed in the byte
+/// and their running sums, so all the samples of a byte are written with
+/// one lookup and a fixed-length loop without branches. The table takes
+/// 8 x 256 x 11 bytes and stays in the first level cache.
+///
+/// The samples of all the channels go to one buffer, sized once for the
+/// worst case, and Channel records where each waveform is; the caller
+/// copies each range into the vector a raw::RawDigit takes over. decode()
+/// returns false on anything outside of the format above (a code of more
+/// than six zeros, a Huffman word first in a channel, an unknown word or
+/// a second header inside a channel, a channel read twice); the caller
+/// then falls back on decode_data(). Words outside of channels that are not
+/// channel headers are skipped.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_DECODERS_TPC_NEVISTPCWORDDECODER_H
+#define SBNDCODE_DECODERS_TPC_NEVISTPCWORDDECODER_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace daq {
+
+  class NevisTPCWordDecoder {
+  public:
+
+    /// Samples [begin, end) of the buffer belong to channel.
+    struct Channel {
+      uint16_t channel;
+      size_t begin;
+      size_t end;
+    };
+
+    static constexpr unsigned kMaxZeros = 6; ///< longest code, +3
+
+    /// Decodes n_words words into samples (resized to fit them) and channels
+    /// (in the order of the data); false if the data is not in the format.
+    static bool decode(uint16_t const *words, size_t n_words,
+                       std::vector<int16_t> &samples, std::vector<Channel> &channels);
+
+  private:
+
+    struct Entry {
+      uint8_t n_codes;    // codes closed in this byte
+      uint8_t pending;    // zeros left open at the top of the byte, at most kMaxZeros + 1
+      bool bad;           // a code longer than kMaxZeros
+      int8_t sums[8];     // running sum of the differences of the codes
+    };
+
+    // indexed by pending zeros (kMaxZeros + 1: too many already) and byte
+    typedef std::array<Entry, (kMaxZeros + 2)*256> Table;
+
+    static Table const &table();
+    static Table make_table();
+  };
+
+} // namespace daq
+
+//----------------------------------------------------------------------
+
+inline daq::NevisTPCWordDecoder::Table daq::NevisTPCWordDecoder::make_table() {
+  // difference coded by a code of n zeros
+  constexpr int8_t diffs[kMaxZeros + 1] = { 0, -1, 1, -2, 2, -3, 3 };
+
+  Table table{};
+  for (unsigned pending = 0; pending <= kMaxZeros + 1; ++pending) {
+    for (unsigned byte = 0; byte < 256; ++byte) {
+      Entry &entry = table[pending*256 + byte];
+      unsigned zeros = pending;
+      int sum = 0;
+      for (unsigned bit = 0; bit < 8; ++bit) {
+        if (!((byte >> bit) & 1)) {
+          // a longer run is fine as padding, but not closed by a one
+          if (zeros <= kMaxZeros) ++zeros;
+          continue;
+        }
+        if (zeros > kMaxZeros) {
+          entry.bad = true;
+          break;
+        }
+        sum += diffs[zeros];
+        entry.sums[entry.n_codes++] = sum;
+        zeros = 0;
+      }
+      // the slots past the last code repeat its sum, which keeps the
+      // writes of the decoding loop harmless
+      for (unsigned i = entry.n_codes; i < 8; ++i) entry.sums[i] = sum;
+      entry.pending = zeros;
+    }
+  }
+  return table;
+}
+
+inline daq::NevisTPCWordDecoder::Table const &daq::NevisTPCWordDecoder::table() {
+  static Table const table = make_table();
+  return table;
+}
+
+//----------------------------------------------------------------------
+
+inline bool daq::NevisTPCWordDecoder::decode(uint16_t const *words, size_t n_words,
+                                             std::vector<int16_t> &samples, std::vector<Channel> &channels) {
+  Table const &codes = table();
+
+  // a word gives at most 15 samples; 8 more for the fixed-length writes
+  samples.resize(n_words*15 + 8);
+  channels.clear();
+  int16_t *const first = samples.data();
+  int16_t *out = first;
+
+  std::bitset<64> seen;
+  bool in_channel = false;
+  bool has_sample = false;
+  int16_t last = 0;
+
+  for (size_t i_word = 0; i_word < n_words; ++i_word) {
+    uint16_t const word = words[i_word];
+
+    if (word & 0x8000) {
+      if (!in_channel) continue;
+      if (!has_sample) return false;
+      Entry const &low = codes[word & 0xFF];
+      Entry const &high = codes[low.pending*256 + ((word >> 8) & 0x7F)];
+      if (low.bad || high.bad) return false;
+      for (unsigned i = 0; i < 8; ++i) out[i] = last + low.sums[i];
+      out += low.n_codes;
+      last += low.sums[7];
+      for (unsigned i = 0; i < 8; ++i) out[i] = last + high.sums[i];
+      out += high.n_codes;
+      last += high.sums[7];
+      continue;
+    }
+
+    switch (word & 0xF000) {
+      case 0x0000: // uncompressed sample
+        if (!in_channel) continue;
+        last = word & 0xFFF;
+        *out++ = last;
+        has_sample = true;
+        break;
+      case 0x4000: { // channel header
+        if (in_channel) return false;
+        uint16_t const channel = word & 0x3F;
+        if (seen.test(channel)) return false;
+        seen.set(channel);
+        size_t const begin = out - first;
+        channels.push_back({ channel, begin, begin });
+        in_channel = true;
+        has_sample = false;
+        break;
+      }
+      case 0x5000: // channel ending
+        if (!in_channel) continue;
+        channels.back().end = out - first;
+        in_channel = false;
+        break;
+      default:
+        if (in_channel) return false;
+    }
+  }
+
+  // a channel without ending keeps the samples read
+  if (in_channel) channels.back().end = out - first;
+  samples.resize(out - first);
+  return true;
+}
+
+#endif // SBNDCODE_DECODERS_TPC_NEVISTPCWORDDECODER_H
@@ -10,11 +10,12 @@
 // adapted from sbndqm for sbndcode use
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "canvas/Persistency/Common/Assns.h"
 #include "art/Persistency/Common/PtrMaker.h"
 #include "lardataobj/RawData/RawDigit.h"
 #include "lardataobj/RawData/RDTimeStamp.h"
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
 
 #include "artdaq-core/Data/Fragment.hh"
 #include "canvas/Utilities/InputTag.h"
@@ -22,6 +23,15 @@
 #include "sbndaq-artdaq-core/Overlays/SBND/NevisTPCFragment.hh"
 
 #include "TPCDecodeAna.h"
+#include "TPCDecodeSelection.h"
+
+#include <bitset>
+#include <utility>
+#include <vector>
+
+namespace SBND {
+  class TPCChannelMapService;
+}
 
 /*
   * The Decoder module takes as input "NevisTPCFragments" and
@@ -34,9 +44,9 @@ namespace daq {
 }
 
 
-class daq::SBNDTPCDecoder : public art::EDProducer {
+class daq::SBNDTPCDecoder : public art::SharedProducer {
 public:
-  explicit SBNDTPCDecoder(fhicl::ParameterSet const & p);
+  explicit SBNDTPCDecoder(fhicl::ParameterSet const & p, art::ProcessingFrame const &);
   // The compiler-generated destructor is fine for non-base
   // classes without bare pointers or other resource use.
 
@@ -46,30 +56,89 @@ public:
   SBNDTPCDecoder & operator = (SBNDTPCDecoder const &) = delete;
   SBNDTPCDecoder & operator = (SBNDTPCDecoder &&) = delete;
 
-  // Required functions.
-  void produce(art::Event & e) override;
+  // Required functions; only the configuration is kept between events,
+  // so several events can be decoded at the same time.
+  void produce(art::Event & e, art::ProcessingFrame const &) override;
 
   // get checksum from a Nevis fragment
   static uint32_t compute_checksum(sbndaq::NevisTPCFragment &fragment);
 
+  // 24-bit sum of n_words data words, as in the Nevis header; written
+  // with independent accumulators so that the compiler vectorizes it
+  static uint32_t checksum_words(const sbndaq::NevisTPC_ADC_t *data, size_t n_words);
+
 private:
   class Config {
     public:
     bool produce_header;
     bool baseline_calc;
+    bool baseline_hist;
+    unsigned baseline_blocks;
+    double baseline_block_var_cut;
     unsigned n_mode_skip;
     bool subtract_pedestal;
 
     unsigned channel_per_slot;
     unsigned min_slot_no;
 
+    // decode the fragments in parallel
+    bool parallel_decode;
+    unsigned n_threads;
+
+    // decode the fragments crate by crate (one task per crate with
+    // parallel_decode) and write the digits in offline channel order
+    bool channel_order;
+
+    // products: the RawDigits (with their RDTimeStamps), and/or one
+    // sbnd::RawDigitBlock with the same digits in offline channel order
+    bool produce_digits;
+    bool produce_block;
+
+    // compare the checksum of the data with the one in the header, for
+    // this fraction of the fragments (uncompressed data only)
+    bool check_checksum;
+    double checksum_fraction;
+
+    // decode the ADC words with NevisTPCWordDecoder (decode_data if they
+    // are not in its format), comparing with decode_data for this
+    // fraction of the fragments
+    bool fast_decode;
+    double fast_decode_check_fraction;
+
     // for converting nevis frame time into timestamp
     unsigned timesize;
     double frame_to_dt;
 
+    // partial decoding: only the fragments of these crates, with a header
+    // timestamp in this window, and accepted by the selections of the event
+    // (if a selection label is given); the others are not decompressed
+    std::vector<uint8_t> selected_crates;
+    std::vector<double> selected_window;
+    art::InputTag selection_label;
+
     Config(fhicl::ParameterSet const & p);
   };
 
+  // fragments to decode, by crate and header timestamp
+  struct Selection {
+    std::bitset<16> crates; // fragment IDs have 4 bits of crate
+    double start;
+    double end;
+
+    bool accepts(unsigned crate, double timestamp) const
+    { return crates.test(crate & 0xF) && timestamp >= start && timestamp <= end; }
+  };
+
+  static Selection make_selection(tpcAnalysis::TPCDecodeSelection const &selection);
+
+  // selections of this event, of which a fragment must pass any; one accepting
+  // everything when there is no selection product
+  std::vector<Selection> event_selections(art::Event const &event) const;
+
+  // whether the fragment is decoded, from its header only
+  bool select_fragment(art::Event &event, const artdaq::Fragment &frag,
+                       std::vector<Selection> const &selections) const;
+
   typedef std::vector<raw::RawDigit> RawDigits;
   typedef std::vector<raw::RDTimeStamp> RDTimeStamps;
   typedef art::Assns<raw::RawDigit,raw::RDTimeStamp> RDTsAssocs;
@@ -79,6 +148,7 @@ private:
   // process an individual fragment inside an art event
   void process_fragment(art::Event &event,
 			const artdaq::Fragment &frag,
+			SBND::TPCChannelMapService const &channelMap,
                         std::unique_ptr<RawDigits> &rd_collection,
                         std::unique_ptr<std::vector<tpcAnalysis::TPCDecodeAna>> &header_collection,
 			RDPmkr &rdpm,
@@ -87,13 +157,73 @@ private:
 			std::unique_ptr<RDTsAssocs> &rdtsassoc_collection);
 
 
+  // decode the digits of one fragment, appending them to digits;
+  // only reads the configuration, so fragments can be decoded concurrently
+  void decode_fragment(const artdaq::Fragment &frag,
+                       SBND::TPCChannelMapService const &channelMap,
+                       RawDigits &digits);
+
+  // samples of one nevis channel
+  typedef std::pair<uint16_t, raw::RawDigit::ADCvector_t> NevisWaveform;
+
+  // the waveforms of the fragment from decode_data, in nevis channel order
+  static void decode_map(sbndaq::NevisTPCFragment &fragment,
+                         std::vector<NevisWaveform> &waveforms);
+
+  // same with NevisTPCWordDecoder; false if the words are not in its
+  // format, leaving decode_map to do it
+  bool decode_words(const artdaq::Fragment &frag,
+                    sbndaq::NevisTPCFragment &fragment,
+                    std::vector<NevisWaveform> &waveforms) const;
+
+  // parallel version of the fragment loop in produce(): each fragment is
+  // decoded on its own, then moved into its slot of the output collection;
+  // the output is the same as the one of the sequential loop
+  void process_fragments_parallel(art::Event &event,
+                                  const std::vector<const artdaq::Fragment*> &frags,
+                                  SBND::TPCChannelMapService const &channelMap,
+                                  RawDigits &rd_collection,
+                                  std::vector<tpcAnalysis::TPCDecodeAna> &header_collection,
+                                  RDPmkr &rdpm,
+                                  TSPmkr &tspm,
+                                  RDTimeStamps &rdts_collection,
+                                  RDTsAssocs &rdtsassoc_collection);
+
+  // decodes the fragments of each crate on its own, sorts the digits of each
+  // crate by channel, then merges the crates into rd_collection in offline
+  // channel order (the digits of one channel keep the fragment order), with
+  // the timestamp of the fragment of each digit in timestamps; the headers
+  // stay in the fragment order
+  void decode_crates(art::Event &event,
+                     const std::vector<const artdaq::Fragment*> &frags,
+                     SBND::TPCChannelMapService const &channelMap,
+                     RawDigits &rd_collection,
+                     std::vector<double> &timestamps,
+                     std::vector<tpcAnalysis::TPCDecodeAna> &header_collection);
+
+  // copies the digits into the rows of block, with their pedestals; with
+  // release, the samples of each digit are freed once copied
+  static void fill_block(RawDigits &digits, bool release, sbnd::RawDigitBlock &block);
+
   // build a TPCDecodeAna object from the Nevis Header
-  tpcAnalysis::TPCDecodeAna Fragment2TPCDecodeAna(art::Event &event, const artdaq::Fragment &frag);
+  tpcAnalysis::TPCDecodeAna Fragment2TPCDecodeAna(art::Event &event, const artdaq::Fragment &frag) const;
 
   art::InputTag _tag;
   Config _config;
+  Selection _static_selection; // from the configuration
+
+  // whether the checksum of this fragment is checked, a pseudo-random pick
+  // from the event number and fragment ID (so reproducible, and the same
+  // in the sequential and parallel loops)
+  bool sample_checksum(const artdaq::Fragment &frag, uint32_t event_number) const;
+  // same pick for a given fraction of the fragments
+  static bool sample_fragment(const artdaq::Fragment &frag, uint32_t event_number, double fraction);
+
+  static void getMedianSigma(const std::vector<int16_t> &v_adc, float &median, float &sigma);
 
-  void getMedianSigma(const std::vector<int16_t> &v_adc, float &median, float &sigma);
+  // same median as getMedianSigma, from a 12-bit ADC histogram filled in one pass
+  // (no sorting, no allocation); sigma is half the 16%-84% quantile width.
+  static void getMedianSigmaHist(const std::vector<int16_t> &v_adc, float &median, float &sigma);
 
 };
 
@@ -9,7 +9,10 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "SBNDTPCDecoder.h"
+#include "NevisTPCWordDecoder.h"
 #include "sbndcode/ChannelMaps/TPC/TPCChannelMapService.h"
+#include "sbndcode/Utilities/BlockBaseline.h"
+#include "sbndcode/Utilities/ThreadPool.h"
 
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -19,12 +22,18 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <numeric>
 #include <iostream>
 #include <stdlib.h>
 #include <chrono>
 #include <thread>
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 #include "TMath.h"
 
 #include "art/Framework/Core/ModuleMacros.h"
@@ -40,7 +49,7 @@ DEFINE_ART_MODULE(daq::SBNDTPCDecoder)
 
 // constructs a header data object from a nevis header
 // construct from a nevis header
-tpcAnalysis::TPCDecodeAna daq::SBNDTPCDecoder::Fragment2TPCDecodeAna(art::Event &event, const artdaq::Fragment &frag) {
+tpcAnalysis::TPCDecodeAna daq::SBNDTPCDecoder::Fragment2TPCDecodeAna(art::Event &event, const artdaq::Fragment &frag) const {
   sbndaq::NevisTPCFragment fragment(frag);
 
   const sbndaq::NevisTPCHeader *raw_header = fragment.header();
@@ -64,24 +73,52 @@ tpcAnalysis::TPCDecodeAna daq::SBNDTPCDecoder::Fragment2TPCDecodeAna(art::Event
   return ret;
 }
 
-daq::SBNDTPCDecoder::SBNDTPCDecoder(fhicl::ParameterSet const & param): 
-  art::EDProducer{param},
+daq::SBNDTPCDecoder::SBNDTPCDecoder(fhicl::ParameterSet const & param, art::ProcessingFrame const &): 
+  art::SharedProducer{param},
   _tag(param.get<std::string>("raw_data_label", "daq"),param.get<std::string>("fragment_type_label", "NEVISTPC")),
   _config(param)
 {
   consumes<artdaq::Fragments>(_tag);
-  produces<RawDigits>();
-  produces<RDTimeStamps>();
-  produces<RDTsAssocs>();
+  tpcAnalysis::TPCDecodeSelection static_selection;
+  static_selection.crates = _config.selected_crates;
+  if (_config.selected_window.size() == 2) {
+    static_selection.start = _config.selected_window[0];
+    static_selection.end = _config.selected_window[1];
+  }
+  else if (!_config.selected_window.empty()) {
+    throw cet::exception("SBNDTPCDecoder_module") << "selected_window must be empty or [start, end]";
+  }
+  _static_selection = make_selection(static_selection);
+  if (!_config.selection_label.empty()) {
+    consumes<std::vector<tpcAnalysis::TPCDecodeSelection>>(_config.selection_label);
+  }
+  if (_config.produce_digits) {
+    produces<RawDigits>();
+    produces<RDTimeStamps>();
+    produces<RDTsAssocs>();
+  }
+  if (_config.produce_block) {
+    produces<sbnd::RawDigitBlock>();
+  }
+  if (!_config.produce_digits && !_config.produce_block) {
+    throw cet::exception("SBNDTPCDecoder_module") << "produce_digits or produce_block must be true";
+  }
   if (_config.produce_header) {
     produces<std::vector<tpcAnalysis::TPCDecodeAna>>();
   }
+  async<art::InEvent>();
 }
 
 daq::SBNDTPCDecoder::Config::Config(fhicl::ParameterSet const & param) {
 
   // whether to calcualte the pedestal (and set it in SetPedestal())
   baseline_calc = param.get<bool>("baseline_calc", true);
+  // whether to use the histogram median/sigma estimator in the pedestal calculation
+  baseline_hist = param.get<bool>("baseline_hist", false);
+  // block size [ticks] of the quiet-block pedestal estimator (0: median/sigma instead)
+  baseline_blocks = param.get<unsigned>("baseline_blocks", 0);
+  // variance cut [ADC^2] of the blocks in the pedestal
+  baseline_block_var_cut = param.get<double>("baseline_block_var_cut", 25.);
   // whether to put headerinfo in the art root file
   produce_header = param.get<bool>("produce_header", false);
 
@@ -96,31 +133,127 @@ daq::SBNDTPCDecoder::Config::Config(fhicl::ParameterSet const & param) {
   channel_per_slot = param.get<unsigned>("channel_per_slot", 0);
   // index of 0th slot
   min_slot_no = param.get<unsigned>("min_slot_no", 0);
+
+  // decode the fragments in parallel, with n_threads threads (0: all available)
+  parallel_decode = param.get<bool>("parallel_decode", false);
+  n_threads = param.get<unsigned>("n_threads", 0);
+  // split the fragments by crate and write the digits in offline channel order
+  channel_order = param.get<bool>("channel_order", false);
+  // the RawDigit collection, and/or a single RawDigitBlock in channel order
+  produce_digits = param.get<bool>("produce_digits", true);
+  produce_block = param.get<bool>("produce_block", false);
+
+  // checksum verification of a random sample of the fragments
+  check_checksum = param.get<bool>("check_checksum", false);
+  checksum_fraction = param.get<double>("checksum_fraction", 1.);
+
+  // table-driven decoding of the ADC words instead of decode_data, and the
+  // fraction of the fragments also decoded with decode_data to compare
+  fast_decode = param.get<bool>("fast_decode", false);
+  fast_decode_check_fraction = param.get<double>("fast_decode_check_fraction", 0.);
+
+  // partial decoding, by crate and by time window of the header timestamp
+  for (unsigned crate: param.get<std::vector<unsigned>>("selected_crates", {})) selected_crates.push_back(crate);
+  selected_window = param.get<std::vector<double>>("selected_window", {});
+  selection_label = param.get<std::string>("selection_label", "");
 }
 
-void daq::SBNDTPCDecoder::produce(art::Event & event)
+daq::SBNDTPCDecoder::Selection daq::SBNDTPCDecoder::make_selection(tpcAnalysis::TPCDecodeSelection const &selection) {
+  Selection ret;
+  if (selection.crates.empty()) ret.crates.set();
+  for (uint8_t crate: selection.crates) ret.crates.set(crate & 0xF);
+  ret.start = selection.start;
+  ret.end = selection.end;
+  return ret;
+}
+
+std::vector<daq::SBNDTPCDecoder::Selection> daq::SBNDTPCDecoder::event_selections(art::Event const &event) const {
+  std::vector<Selection> ret;
+  if (_config.selection_label.empty()) {
+    ret.push_back(make_selection(tpcAnalysis::TPCDecodeSelection()));
+    return ret;
+  }
+  // no selection in the event: nothing to decode
+  auto const &selections = event.getProduct<std::vector<tpcAnalysis::TPCDecodeSelection>>(_config.selection_label);
+  for (auto const &selection: selections) ret.push_back(make_selection(selection));
+  return ret;
+}
+
+bool daq::SBNDTPCDecoder::select_fragment(art::Event &event, const artdaq::Fragment &frag,
+                                          std::vector<Selection> const &selections) const {
+  // only the header is read here
+  tpcAnalysis::TPCDecodeAna const header = Fragment2TPCDecodeAna(event, frag);
+  if (!_static_selection.accepts(header.crate, header.timestamp)) return false;
+  return std::any_of(selections.begin(), selections.end(),
+                     [&header](Selection const &selection) { return selection.accepts(header.crate, header.timestamp); });
+}
+
+void daq::SBNDTPCDecoder::produce(art::Event & event, art::ProcessingFrame const &)
 {
   auto daq_handle = event.getHandle<artdaq::Fragments>(_tag);
   if ( !daq_handle.isValid() ) {
     throw cet::exception("SBNDTPCDecoder_module ") << " invalid fragment handle";
   }
   
-  RDPmkr rdpm(event);
-  TSPmkr tspm(event);
-
   // output collections
   std::unique_ptr<RawDigits> rawdigit_collection(new RawDigits);
   std::unique_ptr<RDTimeStamps> rdts_collection(new RDTimeStamps);
   std::unique_ptr<RDTsAssocs> rdtsassoc_collection(new RDTsAssocs);
   std::unique_ptr<std::vector<tpcAnalysis::TPCDecodeAna>> header_collection(new std::vector<tpcAnalysis::TPCDecodeAna>);
 
+  // one channel map handle for all the fragments of the event
+  art::ServiceHandle<SBND::TPCChannelMapService const> channelMap;
+
+  // the fragments to decode; the others are skipped without being decompressed
+  std::vector<Selection> const selections = event_selections(event);
+  std::vector<const artdaq::Fragment*> frags;
+  frags.reserve(daq_handle->size());
   for (auto const &rawfrag: *daq_handle) {
-    process_fragment(event, rawfrag, rawdigit_collection, header_collection, rdpm, tspm, rdts_collection, rdtsassoc_collection);
+    if (select_fragment(event, rawfrag, selections)) frags.push_back(&rawfrag);
+  }
+  if (frags.size() < daq_handle->size()) {
+    mf::LogDebug("SBNDTPCDecoder") << "Decoding " << frags.size() << " of " << daq_handle->size() << " fragments";
   }
 
-  event.put(std::move(rawdigit_collection));
-  event.put(std::move(rdts_collection));
-  event.put(std::move(rdtsassoc_collection));
+  if (_config.channel_order || !_config.produce_digits) {
+    // crate by crate, in channel order; the block only is filled straight
+    // from the merged digits, releasing them as it goes
+    std::vector<double> timestamps;
+    decode_crates(event, frags, *channelMap, *rawdigit_collection, timestamps, *header_collection);
+    if (_config.produce_digits) {
+      RDPmkr rdpm(event);
+      TSPmkr tspm(event);
+      rdts_collection->reserve(timestamps.size());
+      for (size_t i_digit = 0; i_digit < timestamps.size(); ++i_digit) {
+        rdts_collection->emplace_back(timestamps[i_digit],0);
+        rdtsassoc_collection->addSingle(rdpm(i_digit), tspm(i_digit));
+      }
+    }
+  }
+  else {
+    RDPmkr rdpm(event);
+    TSPmkr tspm(event);
+    if (_config.parallel_decode) {
+      process_fragments_parallel(event, frags, *channelMap, *rawdigit_collection, *header_collection, rdpm, tspm, *rdts_collection, *rdtsassoc_collection);
+    }
+    else {
+      for (const artdaq::Fragment *rawfrag: frags) {
+        process_fragment(event, *rawfrag, *channelMap, rawdigit_collection, header_collection, rdpm, tspm, rdts_collection, rdtsassoc_collection);
+      }
+    }
+  }
+
+  if (_config.produce_block) {
+    std::unique_ptr<sbnd::RawDigitBlock> block(new sbnd::RawDigitBlock);
+    fill_block(*rawdigit_collection, !_config.produce_digits, *block);
+    event.put(std::move(block));
+  }
+
+  if (_config.produce_digits) {
+    event.put(std::move(rawdigit_collection));
+    event.put(std::move(rdts_collection));
+    event.put(std::move(rdtsassoc_collection));
+  }
 
   if (_config.produce_header) {
     event.put(std::move(header_collection));
@@ -135,6 +268,7 @@ void daq::SBNDTPCDecoder::produce(art::Event & event)
 
 
 void daq::SBNDTPCDecoder::process_fragment(art::Event &event, const artdaq::Fragment &frag, 
+					   SBND::TPCChannelMapService const &channelMap,
 					   std::unique_ptr<RawDigits> &rd_collection,
 					   std::unique_ptr<std::vector<tpcAnalysis::TPCDecodeAna>> &header_collection,
 					   RDPmkr &rdpm,
@@ -142,15 +276,6 @@ void daq::SBNDTPCDecoder::process_fragment(art::Event &event, const artdaq::Frag
 					   std::unique_ptr<RDTimeStamps> &rdts_collection,
 					   std::unique_ptr<RDTsAssocs> &rdtsassoc_collection) {
 
-  art::ServiceHandle<SBND::TPCChannelMapService> channelMap;
-  
-  // convert fragment to Nevis fragment
-  sbndaq::NevisTPCFragment fragment(frag);
-
-  std::unordered_map<uint16_t,sbndaq::NevisTPC_Data_t> waveform_map;
-  size_t n_waveforms = fragment.decode_data(waveform_map);
-  (void)n_waveforms;
-
   // need to retrieve the timestamp from the Nevis header and save it in the art event only on request
   
   auto header_data = Fragment2TPCDecodeAna(event, frag);
@@ -158,57 +283,343 @@ void daq::SBNDTPCDecoder::process_fragment(art::Event &event, const artdaq::Frag
     header_collection->push_back(header_data);
   }
 
+  size_t const first_digit = rd_collection->size();
+  decode_fragment(frag, channelMap, *rd_collection);
+
+  for (size_t i_digit = first_digit; i_digit < rd_collection->size(); ++i_digit) {
+    // construct the RDTimeStamp object and make the association
+    rdts_collection->emplace_back(header_data.timestamp,0);
+    auto const rawdigitptr = rdpm(i_digit);
+    auto const rdtimestampptr = tspm(rdts_collection->size()-1);
+    rdtsassoc_collection->addSingle(rawdigitptr,rdtimestampptr);       
+  }
+}
+
+void daq::SBNDTPCDecoder::decode_fragment(const artdaq::Fragment &frag,
+                                          SBND::TPCChannelMapService const &channelMap,
+                                          RawDigits &digits) {
+
+  // convert fragment to Nevis fragment
+  sbndaq::NevisTPCFragment fragment(frag);
+
+  if (_config.check_checksum && sample_checksum(frag, fragment.header()->getEventNum())) {
+    uint32_t const expected = fragment.header()->getChecksum() & 0xFFFFFF;
+    uint32_t const computed = compute_checksum(fragment);
+    if (computed != expected) {
+      mf::LogWarning("SBNDTPCDecoder") << "Checksum mismatch in fragment " << frag.fragmentID()
+                                       << " of event " << fragment.header()->getEventNum()
+                                       << ": header " << std::hex << expected << ", data " << computed;
+    }
+  }
+
   unsigned int FEMCrate = (frag.fragmentID() >> 8) & 0xF;
   unsigned int FEMSlot = fragment.header()->getSlot()-_config.min_slot_no + 1;
-  
-  for (auto waveform: waveform_map) {
-    auto chanInfo = channelMap->GetChanInfoFromFEMElements(FEMCrate,
-							   FEMSlot,
-							   waveform.first); // nevis_channel_id    
-    if (!chanInfo.valid) continue;
 
-    std::vector<int16_t> raw_digits_waveform;
-    raw::ChannelID_t wire_id = chanInfo.offlchan;
+  // channel map entries of this FEM, indexed by nevis channel id
+  auto const femChanInfo = channelMap.GetFEMChanInfo(FEMCrate, FEMSlot);
+  if (!femChanInfo) return;
 
-    for (auto digit: waveform.second) {
-      raw_digits_waveform.push_back( (int16_t) digit);
-    }
+  // the digits follow the FEM channel order of the channel map, not the
+  // order of the data (or the hash order of decode_data), so the output
+  // does not depend on the decoder or the standard library in use
+  std::vector<NevisWaveform> waveforms;
+  if (!_config.fast_decode || !decode_words(frag, fragment, waveforms)) {
+    decode_map(fragment, waveforms);
+  }
+  digits.reserve(digits.size() + waveforms.size());
+
+  util::BlockBaseline const baseline(_config.baseline_blocks, _config.baseline_block_var_cut);
+  
+  for (NevisWaveform &waveform: waveforms) {
+    uint16_t const nevis_channel = waveform.first;
+    if (nevis_channel >= channelMap.NFEMChannels()) continue;
+    auto const chanInfo = femChanInfo[nevis_channel];
+    if (!chanInfo || !chanInfo->valid) continue;
+
+    raw::ChannelID_t wire_id = chanInfo->offlchan;
+    raw::RawDigit::ADCvector_t raw_digits_waveform = std::move(waveform.second);
 
     float median = 0;
     float sigma = 0; 
     if (_config.baseline_calc) {
-      getMedianSigma(raw_digits_waveform, median, sigma);
+      // mean and RMS of the blocks without signal, or the median if
+      // the waveform has none
+      bool const from_blocks = baseline.BlockSize() > 0
+        && baseline.Pedestal(raw_digits_waveform, median, sigma) > 0;
+      if (!from_blocks && _config.baseline_hist) getMedianSigmaHist(raw_digits_waveform, median, sigma);
+      else if (!from_blocks) getMedianSigma(raw_digits_waveform, median, sigma);
     }
 
     // construct the next RawDigit object
-    rd_collection->emplace_back(wire_id, raw_digits_waveform.size(), raw_digits_waveform);
-    (*rd_collection)[rd_collection->size() - 1].SetPedestal( median, sigma );
+    size_t const n_samples = raw_digits_waveform.size();
+    digits.emplace_back(wire_id, n_samples, std::move(raw_digits_waveform));
+    digits.back().SetPedestal( median, sigma );
+  }
+}
 
-    // construct the RDTimeStamp object and make the association
-    rdts_collection->emplace_back(header_data.timestamp,0);
-    auto const rawdigitptr = rdpm(rd_collection->size()-1);
-    auto const rdtimestampptr = tspm(rdts_collection->size()-1);
-    rdtsassoc_collection->addSingle(rawdigitptr,rdtimestampptr);       
+void daq::SBNDTPCDecoder::decode_map(sbndaq::NevisTPCFragment &fragment,
+                                     std::vector<NevisWaveform> &waveforms) {
+  std::unordered_map<uint16_t,sbndaq::NevisTPC_Data_t> waveform_map;
+  fragment.decode_data(waveform_map);
+
+  waveforms.clear();
+  waveforms.reserve(waveform_map.size());
+  for (auto const &waveform: waveform_map) {
+    // the samples are converted once, straight into the vector the RawDigit takes over
+    waveforms.emplace_back(waveform.first, raw::RawDigit::ADCvector_t(waveform.second.size()));
+    std::transform(waveform.second.begin(), waveform.second.end(), waveforms.back().second.begin(),
+                   [](auto digit) { return (int16_t) digit; });
+  }
+  std::sort(waveforms.begin(), waveforms.end(),
+            [](NevisWaveform const &a, NevisWaveform const &b) { return a.first < b.first; });
+}
+
+bool daq::SBNDTPCDecoder::decode_words(const artdaq::Fragment &frag,
+                                       sbndaq::NevisTPCFragment &fragment,
+                                       std::vector<NevisWaveform> &waveforms) const {
+  // RETURN VALUE OF getADCWordCount IS OFF BY 1 (as in compute_checksum)
+  size_t const n_words = fragment.header()->getADCWordCount() + 1;
+  std::vector<int16_t> samples;
+  std::vector<NevisTPCWordDecoder::Channel> channels;
+  if (!NevisTPCWordDecoder::decode(fragment.data(), n_words, samples, channels)) {
+    mf::LogWarning("SBNDTPCDecoder") << "Fragment " << frag.fragmentID() << " of event "
+                                     << fragment.header()->getEventNum()
+                                     << " is not in the expected word format; decoded with decode_data";
+    return false;
+  }
+  std::sort(channels.begin(), channels.end(),
+            [](NevisTPCWordDecoder::Channel const &a, NevisTPCWordDecoder::Channel const &b) { return a.channel < b.channel; });
+
+  waveforms.clear();
+  waveforms.reserve(channels.size());
+  for (NevisTPCWordDecoder::Channel const &channel: channels) {
+    waveforms.emplace_back(channel.channel, raw::RawDigit::ADCvector_t(samples.begin() + channel.begin,
+                                                                       samples.begin() + channel.end));
+  }
+
+  if (!sample_fragment(frag, fragment.header()->getEventNum(), _config.fast_decode_check_fraction)) return true;
+
+  // the reference decoding of the same fragment; on a difference, its
+  // output is the one kept
+  std::vector<NevisWaveform> reference;
+  decode_map(fragment, reference);
+  if (reference != waveforms) {
+    size_t i = 0;
+    while (i < std::min(reference.size(), waveforms.size()) && reference[i] == waveforms[i]) ++i;
+    mf::LogWarning log("SBNDTPCDecoder");
+    log << "Fast decoding of fragment " << frag.fragmentID() << " of event "
+        << fragment.header()->getEventNum() << " differs from decode_data: "
+        << waveforms.size() << " channels instead of " << reference.size();
+    if (i < std::min(reference.size(), waveforms.size())) {
+      log << ", first at nevis channel " << reference[i].first << " (" << waveforms[i].first << ")";
+    }
+    waveforms = std::move(reference);
+  }
+  return true;
+}
+
+void daq::SBNDTPCDecoder::process_fragments_parallel(art::Event &event,
+                                                     const std::vector<const artdaq::Fragment*> &frags,
+                                                     SBND::TPCChannelMapService const &channelMap,
+                                                     RawDigits &rd_collection,
+                                                     std::vector<tpcAnalysis::TPCDecodeAna> &header_collection,
+                                                     RDPmkr &rdpm,
+                                                     TSPmkr &tspm,
+                                                     RDTimeStamps &rdts_collection,
+                                                     RDTsAssocs &rdtsassoc_collection) {
+
+  std::vector<tpcAnalysis::TPCDecodeAna> headers(frags.size());
+  std::vector<RawDigits> frag_digits(frags.size());
+
+  sbnd::ThreadPool pool(_config.n_threads);
+  pool.Execute([&] {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, frags.size()), [&](tbb::blocked_range<size_t> const &range) {
+      for (size_t i_frag = range.begin(); i_frag != range.end(); ++i_frag) {
+        headers[i_frag] = Fragment2TPCDecodeAna(event, *frags[i_frag]);
+        decode_fragment(*frags[i_frag], channelMap, frag_digits[i_frag]);
+      }
+    });
+  });
+
+  // first slot of each fragment in the output collection
+  std::vector<size_t> first_digit(frags.size() + 1, rd_collection.size());
+  for (size_t i_frag = 0; i_frag < frags.size(); ++i_frag) {
+    first_digit[i_frag + 1] = first_digit[i_frag] + frag_digits[i_frag].size();
+  }
+
+  rd_collection.resize(first_digit.back());
+  pool.Execute([&] {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, frags.size()), [&](tbb::blocked_range<size_t> const &range) {
+      for (size_t i_frag = range.begin(); i_frag != range.end(); ++i_frag) {
+        std::move(frag_digits[i_frag].begin(), frag_digits[i_frag].end(), rd_collection.begin() + first_digit[i_frag]);
+      }
+    });
+  });
+
+  // timestamps and associations, in the digit order
+  rdts_collection.reserve(rdts_collection.size() + rd_collection.size() - first_digit.front());
+  for (size_t i_frag = 0; i_frag < frags.size(); ++i_frag) {
+    if (_config.produce_header) {
+      header_collection.push_back(headers[i_frag]);
+    }
+    for (size_t i_digit = first_digit[i_frag]; i_digit < first_digit[i_frag + 1]; ++i_digit) {
+      rdts_collection.emplace_back(headers[i_frag].timestamp,0);
+      rdtsassoc_collection.addSingle(rdpm(i_digit), tspm(rdts_collection.size()-1));
+    }
+  }
+}
+
+void daq::SBNDTPCDecoder::decode_crates(art::Event &event,
+                                        const std::vector<const artdaq::Fragment*> &frags,
+                                        SBND::TPCChannelMapService const &channelMap,
+                                        RawDigits &rd_collection,
+                                        std::vector<double> &timestamps,
+                                        std::vector<tpcAnalysis::TPCDecodeAna> &header_collection) {
+
+  // the digits of one crate, with the timestamp of the fragment of each
+  // digit and the digit indices in channel order
+  struct CrateDigits {
+    std::vector<size_t> frags;
+    RawDigits digits;
+    std::vector<double> timestamps;
+    std::vector<size_t> order;
+  };
+
+  // the fragments of each crate, in increasing crate number
+  std::vector<tpcAnalysis::TPCDecodeAna> headers(frags.size());
+  std::array<int, 16> crate_index;
+  crate_index.fill(-1);
+  std::vector<unsigned> crate_numbers;
+  for (size_t i_frag = 0; i_frag < frags.size(); ++i_frag) {
+    headers[i_frag] = Fragment2TPCDecodeAna(event, *frags[i_frag]);
+    unsigned const crate = headers[i_frag].crate & 0xF;
+    if (crate_index[crate] < 0) {
+      crate_index[crate] = 0;
+      crate_numbers.push_back(crate);
+    }
+  }
+  std::sort(crate_numbers.begin(), crate_numbers.end());
+  for (size_t i_crate = 0; i_crate < crate_numbers.size(); ++i_crate) crate_index[crate_numbers[i_crate]] = i_crate;
+
+  std::vector<CrateDigits> crates(crate_numbers.size());
+  for (size_t i_frag = 0; i_frag < frags.size(); ++i_frag) {
+    crates[crate_index[headers[i_frag].crate & 0xF]].frags.push_back(i_frag);
+  }
+
+  auto decode_crate = [&](CrateDigits &crate) {
+    for (size_t i_frag: crate.frags) {
+      decode_fragment(*frags[i_frag], channelMap, crate.digits);
+      crate.timestamps.resize(crate.digits.size(), headers[i_frag].timestamp);
+    }
+    crate.order.resize(crate.digits.size());
+    std::iota(crate.order.begin(), crate.order.end(), 0);
+    std::stable_sort(crate.order.begin(), crate.order.end(), [&crate](size_t a, size_t b)
+                     { return crate.digits[a].Channel() < crate.digits[b].Channel(); });
+  };
+
+  if (_config.parallel_decode) {
+    sbnd::ThreadPool pool(_config.n_threads);
+    pool.Execute([&] {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, crates.size(), 1), [&](tbb::blocked_range<size_t> const &range) {
+        for (size_t i_crate = range.begin(); i_crate != range.end(); ++i_crate) decode_crate(crates[i_crate]);
+      });
+    });
+  }
+  else {
+    for (CrateDigits &crate: crates) decode_crate(crate);
+  }
+
+  if (_config.produce_header) {
+    header_collection.insert(header_collection.end(), headers.begin(), headers.end());
+  }
+
+  // merge the crates into the preallocated collection, taking the lowest
+  // channel at the head of the crates (the lowest crate on a tie)
+  size_t n_digits = 0;
+  for (CrateDigits const &crate: crates) n_digits += crate.digits.size();
+  size_t const first_digit = rd_collection.size();
+  rd_collection.resize(first_digit + n_digits);
+  timestamps.resize(first_digit + n_digits);
+
+  std::vector<size_t> heads(crates.size(), 0);
+  for (size_t i_digit = first_digit; i_digit < first_digit + n_digits; ++i_digit) {
+    int next = -1;
+    raw::ChannelID_t next_channel = 0;
+    for (size_t i_crate = 0; i_crate < crates.size(); ++i_crate) {
+      CrateDigits const &crate = crates[i_crate];
+      if (heads[i_crate] == crate.order.size()) continue;
+      raw::ChannelID_t const channel = crate.digits[crate.order[heads[i_crate]]].Channel();
+      if (next < 0 || channel < next_channel) {
+        next = i_crate;
+        next_channel = channel;
+      }
+    }
+    CrateDigits &crate = crates[next];
+    size_t const i_crate_digit = crate.order[heads[next]++];
+    rd_collection[i_digit] = std::move(crate.digits[i_crate_digit]);
+    timestamps[i_digit] = crate.timestamps[i_crate_digit];
   }
 }
 
+void daq::SBNDTPCDecoder::fill_block(RawDigits &digits, bool release, sbnd::RawDigitBlock &block) {
+  // rows as long as the longest waveform; shorter ones are zero padded
+  size_t n_ticks = 0;
+  for (raw::RawDigit const &digit: digits) n_ticks = std::max(n_ticks, digit.ADCs().size());
+  block.resize(digits.size(), n_ticks, true);
+
+  for (size_t row = 0; row < digits.size(); ++row) {
+    raw::RawDigit &digit = digits[row];
+    block.SetChannel(row, digit.Channel());
+    std::copy(digit.ADCs().begin(), digit.ADCs().end(), block.MutableADCs(row));
+    block.SetPedestal(row, digit.GetPedestal(), digit.GetSigma());
+    if (release) digit = raw::RawDigit();
+  }
+  if (release) RawDigits().swap(digits);
+}
+
 // Computes the checksum, given a nevis tpc header
 //
 // Also note that this only works for uncompressed data
 uint32_t daq::SBNDTPCDecoder::compute_checksum(sbndaq::NevisTPCFragment &fragment) {
-  uint32_t checksum = 0;
-
   const sbndaq::NevisTPC_ADC_t* data_ptr = fragment.data();
   // RETURN VALUE OF getADCWordCount IS OFF BY 1
   size_t n_words = fragment.header()->getADCWordCount() + 1;
 
-  for (size_t word_ind = 0; word_ind < n_words; word_ind++) {
-    const sbndaq::NevisTPC_ADC_t* word_ptr = data_ptr + word_ind;
-    checksum += *word_ptr;
+  return checksum_words(data_ptr, n_words);
+}
+
+uint32_t daq::SBNDTPCDecoder::checksum_words(const sbndaq::NevisTPC_ADC_t *data, size_t n_words) {
+  // the sum is modulo 2^32, so splitting it over lanes gives the same result
+  constexpr size_t n_lanes = 16;
+  std::array<uint32_t, n_lanes> lanes{};
+  size_t const n_blocks = n_words / n_lanes;
+  for (size_t block = 0; block < n_blocks; ++block) {
+    const sbndaq::NevisTPC_ADC_t* words = data + block*n_lanes;
+    for (size_t lane = 0; lane < n_lanes; ++lane) lanes[lane] += words[lane];
   }
+
+  uint32_t checksum = 0;
+  for (uint32_t lane: lanes) checksum += lane;
+  for (size_t word_ind = n_blocks*n_lanes; word_ind < n_words; ++word_ind) checksum += data[word_ind];
+
   // only first 6 bytes of checksum are used
   return checksum & 0xFFFFFF;
+}
 
+bool daq::SBNDTPCDecoder::sample_checksum(const artdaq::Fragment &frag, uint32_t event_number) const {
+  return sample_fragment(frag, event_number, _config.checksum_fraction);
+}
+
+bool daq::SBNDTPCDecoder::sample_fragment(const artdaq::Fragment &frag, uint32_t event_number, double fraction) {
+  if (fraction >= 1.) return true;
+  if (fraction <= 0.) return false;
+  // splitmix64 finaliser of (event, fragment ID), mapped to [0, 1)
+  uint64_t z = (uint64_t(event_number) << 16) ^ frag.fragmentID();
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return (z >> 11) * 0x1.0p-53 < fraction;
 }
 
 
@@ -246,3 +657,58 @@ void daq::SBNDTPCDecoder::getMedianSigma(const std::vector<int16_t> &v_adc, floa
     }
   }
 }
+
+
+void daq::SBNDTPCDecoder::getMedianSigmaHist(const std::vector<int16_t> &v_adc, float &median,
+					     float &sigma) {
+  size_t asiz = v_adc.size();
+  if (asiz == 0) {
+    median = 0;
+    sigma = 0;
+    return;
+  }
+
+  // 12-bit ADC; out of range samples are put in the end bins.
+  // The histogram is emptied again after use, by walking the samples.
+  constexpr int n_bins = 4096;
+  static thread_local std::array<unsigned int, n_bins> hist{};
+  auto adc_bin = [](int16_t adc) { return std::min(std::max(int(adc), 0), n_bins - 1); };
+
+  for (int16_t adc: v_adc) ++hist[adc_bin(adc)];
+
+  // integer median as TMath::Median: the middle sample, or the average of the
+  // middle two for an even number of samples, then the same correction
+  // for the samples at the median value as in getMedianSigma
+  size_t const rank_lo = (asiz - 1)/2;
+  size_t const rank_hi = asiz/2;
+  double const n_16 = 0.158655*asiz;
+  double const n_84 = 0.841345*asiz;
+
+  int lo = -1, hi = -1;
+  size_t below_lo = 0;
+  double q_16 = 0, q_84 = 0;
+  bool have_16 = false;
+  size_t below = 0;
+  for (int bin = 0; bin < n_bins; ++bin) {
+    unsigned int const count = hist[bin];
+    if (count == 0) continue;
+    size_t const above = below + count;
+    if (lo < 0 && above > rank_lo) { lo = bin; below_lo = below; }
+    if (hi < 0 && above > rank_hi) hi = bin;
+    // quantiles interpolated within the bin, as the median correction
+    if (!have_16 && above > n_16) { q_16 = bin - 0.5 + (n_16 - below)/count; have_16 = true; }
+    if (above > n_84) { q_84 = bin - 0.5 + (n_84 - below)/count; break; }
+    below = above;
+  }
+
+  int imed = 0.5*(lo + hi) + 0.01;  // add an offset to make sure the floor gets the right integer
+  size_t s1 = below_lo;
+  for (int bin = lo; bin < imed; ++bin) s1 += hist[bin];
+  size_t sm = hist[imed];
+
+  median = imed;
+  if (sm > 0) median += (-0.5 + (0.5*(float) asiz - (float) s1)/ ((float) sm) );
+  sigma = 0.5*(q_84 - q_16);
+
+  for (int16_t adc: v_adc) hist[adc_bin(adc)] = 0;
+}
@@ -0,0 +1,27 @@
+#ifndef _sbnddaq_analysis_TPCDecodeSelection
+#define _sbnddaq_analysis_TPCDecodeSelection
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tpcAnalysis {
+
+// TPCDecodeSelection: part of the TPC readout to be decoded in an event,
+// e.g. the crates crossed by a tagged track. SBNDTPCDecoder decodes the
+// fragments accepted by any of the selections in its input collection
+class TPCDecodeSelection {
+  public:
+  std::vector<uint8_t> crates; //!< Readout crates to decode; all of them if empty
+  double start; //!< Earliest fragment timestamp to decode, in the units of TPCDecodeAna::timestamp
+  double end; //!< Latest fragment timestamp to decode
+
+  TPCDecodeSelection():
+    start(std::numeric_limits<double>::lowest()),
+    end(std::numeric_limits<double>::max())
+  {}
+
+};
+}
+
+#endif
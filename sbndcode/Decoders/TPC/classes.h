@@ -1,6 +1,7 @@
 #include "canvas/Persistency/Common/Wrapper.h"
 #include <vector>
 #include "sbndcode/Decoders/TPC/TPCDecodeAna.h"
+#include "sbndcode/Decoders/TPC/TPCDecodeSelection.h"
 
 
 namespace {
@@ -9,6 +10,9 @@ namespace {
     std::vector<tpcAnalysis::TPCDecodeAna> h_v;
     art::Wrapper<tpcAnalysis::TPCDecodeAna> h_w;
     art::Wrapper<std::vector<tpcAnalysis::TPCDecodeAna>> h_v_w;
+    tpcAnalysis::TPCDecodeSelection s;
+    std::vector<tpcAnalysis::TPCDecodeSelection> s_v;
+    art::Wrapper<std::vector<tpcAnalysis::TPCDecodeSelection>> s_v_w;
   };
 }
 
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   RawDigitBlock.h
+///
+/// \brief  The uncompressed TPC digits of all the channels of an event,
+///         as one channel by tick matrix.
+///
+/// A collection of raw::RawDigit gives each channel a vector of its own,
+/// some ten thousand allocations per event to write and as many to read
+/// back, and each reader uncompresses the channels one at a time. This
+/// product keeps the same samples in a single array, row after row, with
+/// the channel of each row and, optionally, its pedestal and sigma. All
+/// the rows have the same number of ticks, and are never compressed.
+///
+/// A writer sizes the block once and fills the rows in place, in any
+/// order and from any thread:
+///
+///   sbnd::RawDigitBlock block(channels.size(), nTicks, true);
+///   block.SetChannel(i, channels[i]);
+///   short* adc = block.MutableADCs(i);    // nTicks samples
+///   block.SetPedestal(i, pedestal);
+///
+/// and a reader walks the rows as views into the matrix, without copying:
+///
+///   for (std::size_t i = 0; i < block.NChannels(); ++i)
+///     for (short adc: block.ADCs(i)) ...
+///
+/// Index() finds the row of a channel. SimWireSBND writes the rows in
+/// increasing channel order, RawDigitPacker in the order of the digits.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_DETECTORSIM_RAWDIGITBLOCK_RAWDIGITBLOCK_H
+#define SBNDCODE_DETECTORSIM_RAWDIGITBLOCK_RAWDIGITBLOCK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h"
+
+namespace sbnd {
+
+  class RawDigitBlock {
+  public:
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// The samples of one row.
+    struct Row {
+      short const* b;
+      std::size_t  n;
+      short const* begin() const { return b; }
+      short const* end() const { return b + n; }
+      short const* data() const { return b; }
+      std::size_t  size() const { return n; }
+      short operator[](std::size_t tick) const { return b[tick]; }
+    };
+
+    RawDigitBlock() = default;
+    RawDigitBlock(std::size_t nChannels, std::size_t nTicks, bool withPedestals = false)
+      { resize(nChannels, nTicks, withPedestals); }
+
+    /// Makes room for nChannels rows of nTicks samples, all zero.
+    void resize(std::size_t nChannels, std::size_t nTicks, bool withPedestals = false)
+    {
+      fNTicks = nTicks;
+      fChannels.assign(nChannels, raw::InvalidChannelID);
+      fADCs.assign(nChannels * nTicks, 0);
+      fPedestals.assign(withPedestals ? nChannels : 0, 0.f);
+      fSigmas.assign(withPedestals ? nChannels : 0, 0.f);
+    }
+
+    std::size_t NChannels() const { return fChannels.size(); }
+    std::size_t NTicks() const { return fNTicks; }
+    bool empty() const { return fChannels.empty(); }
+    bool HasPedestals() const { return !fPedestals.empty(); }
+
+    raw::ChannelID_t Channel(std::size_t i) const { return fChannels[i]; }
+    void SetChannel(std::size_t i, raw::ChannelID_t channel) { fChannels[i] = channel; }
+
+    Row ADCs(std::size_t i) const { return { fADCs.data() + i*fNTicks, fNTicks }; }
+    short* MutableADCs(std::size_t i) { return fADCs.data() + i*fNTicks; }
+
+    /// Pedestal and sigma of row i; zero when the block has none.
+    float Pedestal(std::size_t i) const { return HasPedestals() ? fPedestals[i] : 0.f; }
+    float Sigma(std::size_t i) const { return HasPedestals() ? fSigmas[i] : 0.f; }
+    void SetPedestal(std::size_t i, float pedestal, float sigma = 0.f)
+    {
+      fPedestals[i] = pedestal;
+      fSigmas[i] = sigma;
+    }
+
+    /// Row of channel, or npos if the block has none.
+    std::size_t Index(raw::ChannelID_t channel) const
+    {
+      auto const it = std::find(fChannels.begin(), fChannels.end(), channel);
+      return it == fChannels.end() ? npos : std::size_t(it - fChannels.begin());
+    }
+
+  private:
+
+    std::size_t                   fNTicks = 0; ///< samples in each row
+    std::vector<raw::ChannelID_t> fChannels;   ///< channel of each row
+    std::vector<short>            fADCs;       ///< samples, row after row
+    std::vector<float>            fPedestals;  ///< pedestal of each row, or empty
+    std::vector<float>            fSigmas;     ///< pedestal sigma of each row, or empty
+  };
+
+} // namespace sbnd
+
+#endif // SBNDCODE_DETECTORSIM_RAWDIGITBLOCK_RAWDIGITBLOCK_H
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       RawDigitPacker
+// Plugin Type: producer
+// File:        RawDigitPacker_module.cc
+//
+// Copies a collection of raw::RawDigit, uncompressed, into one
+// sbnd::RawDigitBlock, one row per digit in the order of the digits.
+// Digits shorter than the longest one are padded with their pedestal.
+// RawDigitUnpacker makes the collection back from the block.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
+
+namespace detsim {
+  class RawDigitPacker;
+}
+
+
+class detsim::RawDigitPacker : public art::EDProducer {
+public:
+  explicit RawDigitPacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  RawDigitPacker(RawDigitPacker const&) = delete;
+  RawDigitPacker(RawDigitPacker&&) = delete;
+  RawDigitPacker& operator=(RawDigitPacker const&) = delete;
+  RawDigitPacker& operator=(RawDigitPacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  art::InputTag fInputTag; ///< digits to pack
+  std::vector<short> fUncompressed; ///< samples of one digit, kept across events
+};
+
+
+detsim::RawDigitPacker::RawDigitPacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTag = p.get< art::InputTag >("InputTag");
+  consumes< std::vector< raw::RawDigit > >(fInputTag);
+
+  produces< sbnd::RawDigitBlock >();
+}
+
+void detsim::RawDigitPacker::produce(art::Event& e)
+{
+  auto const& digits = e.getProduct< std::vector< raw::RawDigit > >(fInputTag);
+
+  std::size_t nTicks = 0;
+  for (raw::RawDigit const& digit : digits) nTicks = std::max<std::size_t>(nTicks, digit.Samples());
+
+  auto block = std::make_unique< sbnd::RawDigitBlock >(digits.size(), nTicks, true);
+  for (std::size_t i = 0; i < digits.size(); ++i) {
+    raw::RawDigit const& digit = digits[i];
+    short const pedestal = std::lround(digit.GetPedestal());
+
+    // zero-suppressed samples come back as the pedestal
+    fUncompressed.resize(digit.Samples());
+    raw::Uncompress(digit.ADCs(), fUncompressed, pedestal, digit.Compression());
+
+    short* adc = block->MutableADCs(i);
+    std::copy(fUncompressed.begin(), fUncompressed.end(), adc);
+    std::fill(adc + fUncompressed.size(), adc + nTicks, pedestal);
+    block->SetChannel(i, digit.Channel());
+    block->SetPedestal(i, digit.GetPedestal(), digit.GetSigma());
+  }
+
+  e.put(std::move(block));
+}
+
+DEFINE_ART_MODULE(detsim::RawDigitPacker)
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       RawDigitUnpacker
+// Plugin Type: producer
+// File:        RawDigitUnpacker_module.cc
+//
+// Makes a collection of uncompressed raw::RawDigit from a
+// sbnd::RawDigitBlock, one digit per row in the order of the rows, for
+// the modules that only read the former.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <memory>
+#include <vector>
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
+
+namespace detsim {
+  class RawDigitUnpacker;
+}
+
+
+class detsim::RawDigitUnpacker : public art::EDProducer {
+public:
+  explicit RawDigitUnpacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  RawDigitUnpacker(RawDigitUnpacker const&) = delete;
+  RawDigitUnpacker(RawDigitUnpacker&&) = delete;
+  RawDigitUnpacker& operator=(RawDigitUnpacker const&) = delete;
+  RawDigitUnpacker& operator=(RawDigitUnpacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  art::InputTag fInputTag; ///< block to unpack
+};
+
+
+detsim::RawDigitUnpacker::RawDigitUnpacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTag = p.get< art::InputTag >("InputTag");
+  consumes< sbnd::RawDigitBlock >(fInputTag);
+
+  produces< std::vector< raw::RawDigit > >();
+}
+
+void detsim::RawDigitUnpacker::produce(art::Event& e)
+{
+  auto const& block = e.getProduct< sbnd::RawDigitBlock >(fInputTag);
+
+  auto digits = std::make_unique< std::vector< raw::RawDigit > >();
+  digits->reserve(block.NChannels());
+  for (std::size_t i = 0; i < block.NChannels(); ++i) {
+    sbnd::RawDigitBlock::Row const adcs = block.ADCs(i);
+    raw::RawDigit::ADCvector_t samples(adcs.begin(), adcs.end());
+    digits->emplace_back(block.Channel(i), block.NTicks(), std::move(samples), raw::kNone);
+    if (block.HasPedestals()) digits->back().SetPedestal(block.Pedestal(i), block.Sigma(i));
+  }
+
+  e.put(std::move(digits));
+}
+
+DEFINE_ART_MODULE(detsim::RawDigitUnpacker)
@@ -0,0 +1,8 @@
+//File: classes.h
+//Brief: Include directives needed to generate the dictionary of sbnd::RawDigitBlock.
+
+//ART includes
+#include "canvas/Persistency/Common/Wrapper.h"
+
+//local includes
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
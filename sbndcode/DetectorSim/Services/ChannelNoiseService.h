@@ -8,6 +8,7 @@
 #ifndef ChannelNoiseService_H
 #define ChannelNoiseService_H
 
+#include <cstdint>
 #include <functional>
 #include <vector>
 #include <iostream>
@@ -16,6 +17,7 @@
 
 namespace CLHEP { class HepRandomEngine; }
 namespace detinfo { class DetectorClocksData; }
+namespace util { class SBNDFFTWorker; }
 
 class ChannelNoiseService {
 
@@ -33,6 +35,34 @@ public:
     return;
   }
 
+  // Per-channel random streams.
+  // A service with channel streams draws the random numbers for a channel
+  // from a counter-based generator keyed by (event, channel), so the noise
+  // on a channel does not depend on which channels were simulated before it.
+  // setEventStream is called once per event, before any addNoise call.
+  virtual bool hasChannelStreams() const { return false; }
+  virtual void setEventStream(std::uint64_t /* eventKey */) { return; }
+
+  // Same as addNoise, using the caller's FFT plans instead of the LArFFT
+  // service. Safe to call concurrently for different channels when
+  // hasChannelStreams() is true.
+  virtual int addChannelNoise(detinfo::DetectorClocksData const& clockData, Channel chan,
+                              AdcSignalVector& sigs, util::SBNDFFTWorker& /* fft */) const {
+    return addNoise(clockData, chan, sigs);
+  }
+
+  // Channel streams of an explicit event, for producers simulating several
+  // events at the same time: streamKey(eventKey) is the key setEventStream
+  // would store, and the keyed addChannelNoise reads no other per-event
+  // state unless hasEventNoise() is true.
+  virtual std::uint64_t streamKey(std::uint64_t eventKey) const { return eventKey; }
+  virtual int addChannelNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t /* streamKey */,
+                              Channel chan, AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const {
+    return addChannelNoise(clockData, chan, sigs, fft);
+  }
+  // True if generateNoise() keeps noise of the current event in the service.
+  virtual bool hasEventNoise() const { return false; }
+
   // Print parameters.
   virtual std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const =0;
   
@@ -44,9 +74,12 @@ public:
 
 };
 
+// The services are SHARED so that replicated producers can use them; only
+// the keyed channel streams may be called from several events at a time,
+// the rest is serialised by the caller.
 #ifndef __CLING__
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
-DECLARE_ART_SERVICE_INTERFACE(ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE(ChannelNoiseService, SHARED)
 #endif
 
 #endif
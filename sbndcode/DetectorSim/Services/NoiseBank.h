@@ -0,0 +1,277 @@
+// NoiseBank.h
+//
+// Bank of long noise waveforms for the TPC noise services (UseNoiseBank).
+//
+// Instead of drawing a spectrum and running an inverse FFT for every
+// channel of every event, a service fills the bank once, with one inverse
+// FFT of NoiseBankSize samples per waveform, and the noise of a channel is
+// a window of the bank at a random offset, with a random sign, scaled by
+// the channel noise factor. The bank bins are NoiseBankSize/nTicks times
+// narrower than the bins of a readout window, and their amplitudes are
+// scaled by sqrt(nTicks/NoiseBankSize), so a window has on average the
+// spectrum and the RMS of the per-channel noise.
+//
+// All the waveforms of a bank share their random amplitudes and phases:
+// a noise that is a linear combination of spectral terms (like the
+// MicroBooNE model, base + wire length * wire) is the same combination of
+// windows of the terms at one offset.
+//
+// A bank can be kept in a file, memory-mapped when read so that the jobs
+// on a node share its pages. The file holds a checksum of the
+// configuration the bank was made with; a missing, stale or damaged file
+// is reported as not read, and the service generates the bank instead.
+//
+// Layout (native byte order):
+//   "SBNDNBNK", uint32 version, uint32 number of waveforms,
+//   uint64 waveform size, uint64 configuration checksum,
+//   uint64 payload checksum, payload (float samples, waveform after waveform).
+
+#ifndef SBNDNoiseBank_H
+#define SBNDNoiseBank_H
+
+#include "sbndcode/DetectorSim/Services/PhiloxRandom.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+
+#include "cetlib_except/exception.h"
+
+#include "TComplex.h"
+#include "TMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sbnd {
+
+  class NoiseBank {
+
+  public:
+
+    // Start and sign of the window of a channel, common to all the waveforms.
+    struct Window {
+      std::size_t offset = 0;
+      float       sign = 1.f;
+    };
+
+    NoiseBank() = default;
+    NoiseBank(NoiseBank const&) = delete;
+    NoiseBank& operator=(NoiseBank const&) = delete;
+    ~NoiseBank() { clear(); }
+
+    bool          empty() const { return fSize == 0; }
+    std::size_t   size() const { return fSize; }
+    std::uint32_t nWaveforms() const { return fNWaveforms; }
+
+    // Samples of waveform w from the start of the window.
+    float const* samples(std::uint32_t w, Window const& win) const { return fData + w*fSize + win.offset; }
+
+    // Random window of nTicks samples; rng is a sbnd::PhiloxStream or a CLHEP::RandFlat.
+    template <class RNG>
+    Window drawWindow(std::size_t nTicks, RNG& rng) const {
+      if ( nTicks > fSize )
+        throw cet::exception("NoiseBank") << "Window of " << nTicks << " samples in a bank of " << fSize << "\n";
+      std::size_t const nOffsets = fSize - nTicks + 1;
+      Window win;
+      win.offset = std::min(std::size_t(rng.fire()*nOffsets), nOffsets - 1);
+      win.sign = (rng.fire() < 0.5) ? -1.f : 1.f;
+      return win;
+    }
+
+    // Fills nWaveforms waveforms of size samples. The bin k of the bank,
+    // at frequency k*binWidth [kHz], holds spectrum(k*binWidth, amp) for
+    // each waveform (amp has nWaveforms entries), times randomizer(u) for a
+    // uniform u and a random phase, both common to the waveforms.
+    // timeScale is the factor between the plain sum of the bins and the
+    // noise in the per-channel generation over nTicks samples.
+    template <class Spectrum, class Randomizer>
+    void generate(std::uint32_t nWaveforms, std::size_t size, std::size_t nTicks, double binWidth,
+                  double timeScale, std::uint64_t seed, Spectrum spectrum, Randomizer randomizer);
+
+    // Checksum of the parameters a bank is made from.
+    static std::uint64_t checksum(std::initializer_list<double> values) {
+      std::uint64_t key = 0;
+      for (double v : values) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        key = mixStreamKey(key, bits);
+      }
+      return key;
+    }
+
+    // Maps the bank at path; false if it is not there, not readable, made
+    // with another configuration or damaged.
+    bool read(std::string const& path, std::uint64_t configChecksum);
+
+    // Writes the bank to path (through a temporary file, so a concurrent
+    // reader never sees a partial bank); false on failure.
+    bool write(std::string const& path, std::uint64_t configChecksum) const;
+
+  private:
+
+    static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'N', 'B', 'N', 'K' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kHeaderSize = sizeof(kMagic) + 2*sizeof(std::uint32_t) + 3*sizeof(std::uint64_t);
+
+    // 64-bit FNV-1a hash of the payload.
+    static std::uint64_t payloadChecksum(char const* data, std::size_t size) {
+      std::uint64_t hash = 0xcbf29ce484222325ULL;
+      for (std::size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    void clear() {
+      if ( fMapped ) ::munmap(fMapped, fMappedSize);
+      fMapped = nullptr;
+      fMappedSize = 0;
+      fOwned.clear();
+      fData = nullptr;
+      fSize = 0;
+      fNWaveforms = 0;
+    }
+
+    float const*       fData = nullptr;     ///< fNWaveforms waveforms of fSize samples
+    std::size_t        fSize = 0;
+    std::uint32_t      fNWaveforms = 0;
+    std::vector<float> fOwned;              ///< storage of a generated bank
+    void*              fMapped = nullptr;   ///< mapping of a bank read from file
+    std::size_t        fMappedSize = 0;
+
+  };
+
+} // namespace sbnd
+
+//----------------------------------------------------------------------
+
+template <class Spectrum, class Randomizer>
+void sbnd::NoiseBank::generate(std::uint32_t nWaveforms, std::size_t size, std::size_t nTicks, double binWidth,
+                               double timeScale, std::uint64_t seed, Spectrum spectrum, Randomizer randomizer) {
+  if ( size < 2*nTicks )
+    throw cet::exception("NoiseBank") << "Bank of " << size << " samples too short for windows of "
+                                      << nTicks << " samples\n";
+  clear();
+
+  std::size_t const nbin = size/2 + 1;
+  std::vector<std::vector<TComplex>> spectra(nWaveforms, std::vector<TComplex>(nbin));
+  std::vector<double> amp(nWaveforms, 0.);
+
+  PhiloxStream rng(seed, 0);
+  for ( std::size_t k = 0; k < nbin; ++k ) {
+    spectrum(k*binWidth, amp.data());
+    double const r = randomizer(rng.fire());
+    double const phase = rng.fire()*2.*TMath::Pi();
+    for ( std::uint32_t w = 0; w < nWaveforms; ++w )
+      spectra[w][k] = TComplex(amp[w]*r*cos(phase), amp[w]*r*sin(phase));
+  }
+
+  // the inverse transform divides by size; the bins are size/nTicks times
+  // more than in a readout window, each adding its variance
+  double const factor = timeScale*size*std::sqrt(double(nTicks)/size);
+
+  util::SBNDFFTWorker fft(size);
+  std::vector<double> waveform;
+  fOwned.resize(nWaveforms*size);
+  for ( std::uint32_t w = 0; w < nWaveforms; ++w ) {
+    fft.DoInvFFT(spectra[w], waveform);
+    for ( std::size_t t = 0; t < size; ++t ) fOwned[w*size + t] = factor*waveform[t];
+  }
+
+  fData = fOwned.data();
+  fSize = size;
+  fNWaveforms = nWaveforms;
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::NoiseBank::read(std::string const& path, std::uint64_t configChecksum) {
+
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if ( fd < 0 ) return false;
+
+  struct stat st;
+  if ( ::fstat(fd, &st) != 0 || (std::size_t) st.st_size < kHeaderSize ) {
+    ::close(fd);
+    return false;
+  }
+  std::size_t const fileSize = st.st_size;
+  void* const mapped = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if ( mapped == MAP_FAILED ) return false;
+
+  char const* const data = static_cast<char const*>(mapped);
+  std::uint32_t version = 0, nWaveforms = 0;
+  std::uint64_t size = 0, cachedConfig = 0, cachedPayload = 0;
+  char const* pos = data + sizeof(kMagic);
+  std::memcpy(&version, pos, sizeof(version));             pos += sizeof(version);
+  std::memcpy(&nWaveforms, pos, sizeof(nWaveforms));       pos += sizeof(nWaveforms);
+  std::memcpy(&size, pos, sizeof(size));                   pos += sizeof(size);
+  std::memcpy(&cachedConfig, pos, sizeof(cachedConfig));   pos += sizeof(cachedConfig);
+  std::memcpy(&cachedPayload, pos, sizeof(cachedPayload)); pos += sizeof(cachedPayload);
+
+  std::size_t const payloadSize = fileSize - kHeaderSize;
+  bool const ok = std::memcmp(data, kMagic, sizeof(kMagic)) == 0
+    && version == kVersion
+    && cachedConfig == configChecksum
+    && size > 0 && payloadSize == nWaveforms*size*sizeof(float)
+    && payloadChecksum(pos, payloadSize) == cachedPayload;
+
+  if ( !ok ) {
+    ::munmap(mapped, fileSize);
+    return false;
+  }
+
+  clear();
+  fMapped = mapped;
+  fMappedSize = fileSize;
+  fData = reinterpret_cast<float const*>(pos);
+  fSize = size;
+  fNWaveforms = nWaveforms;
+  return true;
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::NoiseBank::write(std::string const& path, std::uint64_t configChecksum) const {
+
+  char const* const payload = reinterpret_cast<char const*>(fData);
+  std::size_t const payloadSize = fNWaveforms*fSize*sizeof(float);
+  std::uint64_t const size = fSize;
+  std::uint64_t const checksum = payloadChecksum(payload, payloadSize);
+
+  std::string const tmpPath = path + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<char const*>(&fNWaveforms), sizeof(fNWaveforms));
+    out.write(reinterpret_cast<char const*>(&size), sizeof(size));
+    out.write(reinterpret_cast<char const*>(&configChecksum), sizeof(configChecksum));
+    out.write(reinterpret_cast<char const*>(&checksum), sizeof(checksum));
+    out.write(payload, payloadSize);
+    if ( !out ) {
+      out.close();
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if ( std::rename(tmpPath.c_str(), path.c_str()) != 0 ) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+#endif
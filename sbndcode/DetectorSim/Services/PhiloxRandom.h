@@ -0,0 +1,120 @@
+// PhiloxRandom.h
+//
+// Counter-based random numbers for the TPC noise services.
+//
+// Philox4x32-10 (Salmon, Moraes, Dror, Shaw, "Parallel random numbers:
+// as easy as 1, 2, 3", SC11) maps a 128-bit counter and a 64-bit key to
+// 128 random bits, with no state shared between calls. A PhiloxStream
+// keys the generator by (service seed, event) and puts the channel in
+// the counter, so the numbers drawn for a channel depend only on the
+// event and the channel number: channels can be simulated concurrently
+// and in any order.
+
+#ifndef SBNDCODE_DETECTORSIM_SERVICES_PHILOXRANDOM_H
+#define SBNDCODE_DETECTORSIM_SERVICES_PHILOXRANDOM_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace sbnd {
+
+  class Philox4x32 {
+  public:
+    using Counter = std::array<std::uint32_t, 4>;
+    using Key     = std::array<std::uint32_t, 2>;
+
+    static Counter generate(Counter ctr, Key key) {
+      for ( int round=0; round<10; ++round ) {
+        if ( round > 0 ) {
+          key[0] += kWeyl0;
+          key[1] += kWeyl1;
+        }
+        std::uint64_t const p0 = std::uint64_t(kMult0)*ctr[0];
+        std::uint64_t const p1 = std::uint64_t(kMult1)*ctr[2];
+        ctr = { std::uint32_t(p1 >> 32) ^ ctr[1] ^ key[0], std::uint32_t(p1),
+                std::uint32_t(p0 >> 32) ^ ctr[3] ^ key[1], std::uint32_t(p0) };
+      }
+      return ctr;
+    }
+
+  private:
+    static constexpr std::uint32_t kMult0 = 0xD2511F53;
+    static constexpr std::uint32_t kMult1 = 0xCD9E8D57;
+    static constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+    static constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+  };
+
+  // 64-bit finaliser of splitmix64, used to fold seeds and event numbers into a key.
+  inline std::uint64_t mixStreamKey(std::uint64_t a, std::uint64_t b) {
+    std::uint64_t z = a + 0x9E3779B97F4A7C15ULL*(b + 1);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // Key identifying one event of one job configuration.
+  inline std::uint64_t eventStreamKey(std::uint32_t run, std::uint32_t subRun, std::uint32_t event) {
+    return mixStreamKey(mixStreamKey(run, subRun), event);
+  }
+
+  // Sequence of deviates for one stream (e.g. one channel) under one key.
+  class PhiloxStream {
+  public:
+
+    PhiloxStream(std::uint64_t key, std::uint64_t stream)
+      : fKey{ { std::uint32_t(key), std::uint32_t(key >> 32) } },
+        fStream(stream), fBlock(0), fNext(4), fHaveGauss(false), fGauss(0.) { }
+
+    std::uint32_t fireUInt() {
+      if ( fNext == 4 ) {
+        fBuffer = Philox4x32::generate({ std::uint32_t(fBlock), std::uint32_t(fBlock >> 32),
+                                         std::uint32_t(fStream), std::uint32_t(fStream >> 32) }, fKey);
+        ++fBlock;
+        fNext = 0;
+      }
+      return fBuffer[fNext++];
+    }
+
+    // Uniform in (0,1), 53 bits of resolution; never returns 0 or 1.
+    double fire() {
+      std::uint64_t const hi = fireUInt() >> 5;
+      std::uint64_t const lo = fireUInt() >> 6;
+      return ( double(hi*67108864 + lo) + 0.5 )/9007199254740992.0;
+    }
+
+    double fire(double a, double b) { return a + (b - a)*fire(); }
+
+    void fireArray(std::size_t n, double* vect, double a, double b) {
+      for ( std::size_t i=0; i<n; ++i ) vect[i] = fire(a, b);
+    }
+
+    // Standard normal deviate (Box-Muller, second value kept for the next call).
+    double gauss() {
+      if ( fHaveGauss ) {
+        fHaveGauss = false;
+        return fGauss;
+      }
+      double const r = std::sqrt(-2.*std::log(fire()));
+      double const phi = 6.283185307179586*fire();
+      fGauss = r*std::sin(phi);
+      fHaveGauss = true;
+      return r*std::cos(phi);
+    }
+
+    double gauss(double mean, double sigma) { return mean + sigma*gauss(); }
+
+  private:
+    Philox4x32::Key     fKey;
+    std::uint64_t       fStream;
+    std::uint64_t       fBlock;
+    Philox4x32::Counter fBuffer;
+    unsigned int        fNext;
+    bool                fHaveGauss;
+    double              fGauss;
+  };
+
+}
+
+#endif
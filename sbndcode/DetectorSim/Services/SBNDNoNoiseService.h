@@ -47,6 +47,6 @@ private:
 
 };
 
-DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDNoNoiseService, ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDNoNoiseService, ChannelNoiseService, SHARED)
 
 #endif
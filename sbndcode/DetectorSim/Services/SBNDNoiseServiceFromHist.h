@@ -79,6 +79,6 @@ private:
 
 };
 
-DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDNoiseServiceFromHist, ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDNoiseServiceFromHist, ChannelNoiseService, SHARED)
 
 #endif
@@ -5,6 +5,7 @@
 
 #include "sbndcode/DetectorSim/Services/SBNDNoiseServiceFromHist.h"
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
 
 using std::cout;
 using std::ostream;
@@ -20,6 +21,7 @@ SBNDNoiseServiceFromHist::
 SBNDNoiseServiceFromHist(fhicl::ParameterSet const& pset)
   : fRandomSeed(0), fLogLevel(1),  m_pran(nullptr), fNoiseEngine(nullptr)
 {
+  sbnd::startup::Span span("SBNDNoiseServiceFromHist");
   const string myname = "SBNDNoiseServiceFromHist::ctor: ";
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints");
   bool haveSeed      = pset.get_if_present<int>("RandomSeed", fRandomSeed);
@@ -12,6 +12,8 @@
 #define SBNDThermalNoiseServiceInFreq_H
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/Services/PhiloxRandom.h"
+#include "sbndcode/DetectorSim/Services/NoiseBank.h"
 
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
@@ -28,12 +30,14 @@
 #include "larcore/Geometry/Geometry.h"
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
 
 #include "TH1F.h"
 #include "TRandom3.h"
 #include "TF1.h"
 #include "TMath.h"
 
+#include <cstdint>
 #include <sstream>
 #include <vector>
 #include <iostream>
@@ -61,10 +65,34 @@ public:
   int addNoise(detinfo::DetectorClocksData const& clockData,
                Channel chan, AdcSignalVector& sigs) const override;
 
+  // Per-channel random streams (UseChannelStreams).
+  bool hasChannelStreams() const override { return fUseChannelStreams; }
+  void setEventStream(std::uint64_t eventKey) override;
+  int addChannelNoise(detinfo::DetectorClocksData const& clockData, Channel chan,
+                      AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const override;
+  std::uint64_t streamKey(std::uint64_t eventKey) const override;
+  int addChannelNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                      Channel chan, AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const override;
+
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const override;
 
 private:
+
+  // Noise amplitude of a channel, from the SignalShapingServiceSBND noise factors.
+  double noiseFactor(Channel chan) const;
+
+  // addNoise drawing from the (event, channel) stream; FFT is util::LArFFT or util::SBNDFFTWorker.
+  template <class FFT>
+  int addStreamNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                     Channel chan, AdcSignalVector& sigs, FFT& fft) const;
+
+  // Fill the noise bank (UseNoiseBank), from NoiseBankFile when it holds it.
+  void makeNoiseBank(detinfo::DetectorClocksData const& clockData);
+
+  // addNoise from a window of the noise bank; rng is a sbnd::PhiloxStream or a CLHEP::RandFlat.
+  template <class RNG>
+  int addBankNoise(Channel chan, AdcSignalVector& sigs, RNG& rng) const;
  
   // General parameters
   unsigned int            fNoiseArrayPoints; ///< number of points in randomly generated noise array
@@ -75,6 +103,15 @@ private:
   double                  fNoiseWidth;       ///< exponential noise width (kHz)
   double                  fNoiseRand;        ///< fraction of random "wiggle" in noise in freq. spectrum
   double                  fLowCutoff;        ///< low frequency filter cutoff (kHz)
+  bool                    fUseChannelStreams;///< draw from (event, channel) streams instead of fNoiseEngine
+  std::uint64_t           fStreamKey;        ///< key of the current event, set by setEventStream
+
+  // Noise bank.
+  bool                    fUseNoiseBank;     ///< copy noise windows from a bank instead of an FFT per channel
+  std::size_t             fNoiseBankSize;    ///< samples in the bank
+  std::string             fNoiseBankFile;    ///< file the bank is read from, or written to (empty: none)
+  unsigned int            fNoiseBankSeed;    ///< seed of the bank random numbers
+  sbnd::NoiseBank         fNoiseBank;
   
   //Declare noise engines.
   CLHEP::HepRandomEngine* m_pran;
@@ -91,6 +128,6 @@ private:
 
 };
 
-DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDThermalNoiseServiceInFreq, ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDThermalNoiseServiceInFreq, ChannelNoiseService, SHARED)
 
 #endif
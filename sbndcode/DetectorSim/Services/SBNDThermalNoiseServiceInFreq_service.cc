@@ -19,7 +19,7 @@ using CLHEP::HepJamesRandom;
 
 SBNDThermalNoiseServiceInFreq::
 SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
-  : fRandomSeed(0), fLogLevel(1),  m_pran(nullptr), fNoiseEngine(nullptr)
+  : fRandomSeed(0), fLogLevel(1), fStreamKey(0), m_pran(nullptr), fNoiseEngine(nullptr)
 {
   const string myname = "SBNDThermalNoiseServiceInFreq::ctor: ";
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints");
@@ -30,6 +30,11 @@ SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
   fNoiseWidth        = pset.get< double              >("NoiseWidth");
   fNoiseRand         = pset.get< double              >("NoiseRand");
   fLowCutoff         = pset.get< double              >("LowCutoff");
+  fUseChannelStreams = pset.get< bool                >("UseChannelStreams", false);
+  fUseNoiseBank      = pset.get< bool                >("UseNoiseBank", false);
+  fNoiseBankSize     = pset.get< std::size_t         >("NoiseBankSize", 1 << 20);
+  fNoiseBankFile     = pset.get< std::string         >("NoiseBankFile", "");
+  fNoiseBankSeed     = pset.get< unsigned int        >("NoiseBankSeed", 1);
 
 
   if ( fRandomSeed == 0 ) haveSeed = false;
@@ -50,6 +55,7 @@ SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
   if ( fLogLevel > 0 ) cout << myname << "  Registered seed: " << m_pran->getSeed() << endl;
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
   generateNoise(clockData);
+  if ( fUseNoiseBank ) makeNoiseBank(clockData);
   if ( fLogLevel > 1 ) print() << endl;
 }
 
@@ -71,40 +77,22 @@ SBNDThermalNoiseServiceInFreq::~SBNDThermalNoiseServiceInFreq() {
 
 //**********************************************************************
 
-int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
+int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const& clockData,
                                             Channel chan, AdcSignalVector& sigs) const {
 
   //Get services.
-  art::ServiceHandle<geo::Geometry> geo;
-  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
   art::ServiceHandle<util::LArFFT> fFFT;
-  
-  //Generate Noise:
-  size_t view = (size_t)geo->View(chan);
-  
-  double noise_factor;
-  auto tempNoiseVec = sss->GetNoiseFactVec();
-  double shapingTime = 2.0; //sss->GetShapingTime(chan);
-  double asicGain = sss->GetASICGain(chan);
 
-  size_t fNTicks = fFFT->FFTSize();
+  if ( fUseChannelStreams ) return addStreamNoise(clockData, fStreamKey, chan, sigs, *fFFT);
 
-  
-  if (fShapingTimeOrder.find( shapingTime ) != fShapingTimeOrder.end() ) {
-    noise_factor = tempNoiseVec[view].at( fShapingTimeOrder.find( shapingTime )->second );
-    noise_factor *= asicGain/4.7;
-  }
-  else {
-    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
-      << "\033[93m"
-      << "Shaping Time recieved from signalshapingservices_sbnd.fcl is not one of the allowed values"
-      << std::endl
-      << "Allowed values: 0.5, 1.0, 2.0, 3.0 us"
-      << "\033[00m"
-      << std::endl;
+  if ( fUseNoiseBank ) {
+    CLHEP::RandFlat flat(*fNoiseEngine);
+    return addBankNoise(chan, sigs, flat);
   }
 
-  
+  size_t fNTicks = fFFT->FFTSize();
+  double noise_factor = noiseFactor(chan);
+
   CLHEP::RandFlat flat(*fNoiseEngine, -1, 1);
 
 
@@ -181,6 +169,153 @@ int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
 }
 
 
+//**********************************************************************
+
+double SBNDThermalNoiseServiceInFreq::noiseFactor(Channel chan) const {
+  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
+  
+  double noise_factor;
+  double shapingTime = 2.0; //sss->GetShapingTime(chan);
+
+  if (fShapingTimeOrder.find( shapingTime ) != fShapingTimeOrder.end() ) {
+    noise_factor = sss->GetNoiseFactor(chan, fShapingTimeOrder.find( shapingTime )->second);
+  }
+  else {
+    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+      << "\033[93m"
+      << "Shaping Time recieved from signalshapingservices_sbnd.fcl is not one of the allowed values"
+      << std::endl
+      << "Allowed values: 0.5, 1.0, 2.0, 3.0 us"
+      << "\033[00m"
+      << std::endl;
+  }
+  return noise_factor;
+}
+
+//**********************************************************************
+
+void SBNDThermalNoiseServiceInFreq::setEventStream(std::uint64_t eventKey) {
+  fStreamKey = streamKey(eventKey);
+}
+
+//**********************************************************************
+
+std::uint64_t SBNDThermalNoiseServiceInFreq::streamKey(std::uint64_t eventKey) const {
+  CLHEP::HepRandomEngine const* engine = fNoiseEngine ? fNoiseEngine : m_pran;
+  return sbnd::mixStreamKey(engine->getSeed(), eventKey);
+}
+
+//**********************************************************************
+
+int SBNDThermalNoiseServiceInFreq::addChannelNoise(detinfo::DetectorClocksData const& clockData, Channel chan,
+                                                   AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const {
+  if ( !fUseChannelStreams ) return addNoise(clockData, chan, sigs);
+  return addStreamNoise(clockData, fStreamKey, chan, sigs, fft);
+}
+
+//**********************************************************************
+
+int SBNDThermalNoiseServiceInFreq::addChannelNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                                                   Channel chan, AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const {
+  if ( !fUseChannelStreams ) return addNoise(clockData, chan, sigs);
+  return addStreamNoise(clockData, streamKey, chan, sigs, fft);
+}
+
+//**********************************************************************
+
+template <class FFT>
+int SBNDThermalNoiseServiceInFreq::addStreamNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                                                  Channel chan, AdcSignalVector& sigs, FFT& fft) const {
+  if ( fUseNoiseBank ) {
+    sbnd::PhiloxStream rng(streamKey, chan);
+    return addBankNoise(chan, sigs, rng);
+  }
+
+  double noise_factor = noiseFactor(chan);
+  size_t fNTicks = fft.FFTSize();
+
+  if (sigs.size() != fNTicks)
+    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+        << "Frequency noise vector length must match fNTicks (FFT size)"
+        << " ... " << sigs.size() << " != " << fNTicks
+        << std::endl;
+
+  // All the random numbers of this channel come from its own stream.
+  sbnd::PhiloxStream rng(streamKey, chan);
+
+  std::vector<TComplex> noiseFrequency(fNTicks / 2 + 1, 0.);
+
+  // width of frequencyBin in kHz
+  double binWidth = 1.0 / (fNTicks * sampling_rate(clockData) * 1.0e-6);
+
+  for (size_t i = 0; i < fNTicks / 2 + 1; ++i) {
+    // exponential noise spectrum with low frequency cutoff, randomized by fNoiseRand
+    double pval = noise_factor * exp(-(double)i * binWidth / fNoiseWidth);
+    double lofilter = 1.0 / (1.0 + exp(-(i - fLowCutoff / binWidth) / 0.5));
+    pval *= lofilter * ((1 - fNoiseRand) + 2 * fNoiseRand * rng.fire());
+
+    double phase = rng.fire() * 2.*TMath::Pi();
+    noiseFrequency[i] = TComplex(pval * cos(phase), pval * sin(phase));
+  }
+
+  fft.DoInvFFT(noiseFrequency, sigs);
+
+  // undo the 1/fNTicks of the inverse FFT, as in addNoise
+  for (unsigned int i = 0; i < sigs.size(); ++i) {
+    sigs[i] *= 1.*fNTicks;
+  }
+
+  return 0;
+}
+
+//**********************************************************************
+
+void SBNDThermalNoiseServiceInFreq::makeNoiseBank(detinfo::DetectorClocksData const& clockData) {
+  const string myname = "SBNDThermalNoiseServiceInFreq::makeNoiseBank: ";
+  art::ServiceHandle<util::LArFFT> fFFT;
+  size_t const nTicks = fFFT->FFTSize();
+  double const sampleRate = sampling_rate(clockData);
+
+  std::uint64_t const config = sbnd::NoiseBank::checksum({
+    1. /* thermal noise in frequency */, double(nTicks), sampleRate,
+    fNoiseWidth, fNoiseRand, fLowCutoff, double(fNoiseBankSize), double(fNoiseBankSeed) });
+
+  if ( !fNoiseBankFile.empty() && fNoiseBank.read(fNoiseBankFile, config) ) {
+    if ( fLogLevel > 0 ) cout << myname << "Noise bank read from " << fNoiseBankFile << endl;
+    return;
+  }
+
+  // width of frequencyBin of a readout window and of the bank, in kHz
+  double const binWidth = 1.0 / (nTicks * sampleRate * 1.0e-6);
+  double const bankBinWidth = 1.0 / (fNoiseBankSize * sampleRate * 1.0e-6);
+
+  // the addNoise spectrum for a noise factor of 1, at frequency f
+  auto spectrum = [&](double f, double* amp) {
+    double const lofilter = 1.0 / (1.0 + exp(-(f / binWidth - fLowCutoff / binWidth) / 0.5));
+    amp[0] = exp(-f / fNoiseWidth) * lofilter;
+  };
+  auto randomizer = [&](double u) { return (1 - fNoiseRand) + 2 * fNoiseRand * u; };
+
+  // addNoise scales the inverse FFT by fNTicks: the noise is the plain sum of the bins
+  fNoiseBank.generate(1, fNoiseBankSize, nTicks, bankBinWidth, 1.0, fNoiseBankSeed, spectrum, randomizer);
+  if ( fLogLevel > 0 ) cout << myname << "Noise bank of " << fNoiseBankSize << " samples generated" << endl;
+
+  if ( !fNoiseBankFile.empty() && !fNoiseBank.write(fNoiseBankFile, config) ) {
+    cout << myname << "WARNING: Could not write the noise bank to " << fNoiseBankFile << endl;
+  }
+}
+
+//**********************************************************************
+
+template <class RNG>
+int SBNDThermalNoiseServiceInFreq::addBankNoise(Channel chan, AdcSignalVector& sigs, RNG& rng) const {
+  sbnd::NoiseBank::Window const win = fNoiseBank.drawWindow(sigs.size(), rng);
+  float const scale = win.sign * noiseFactor(chan);
+  float const* bank = fNoiseBank.samples(0, win);
+  for ( size_t i = 0; i < sigs.size(); ++i ) sigs[i] = scale * bank[i];
+  return 0;
+}
+
 //**********************************************************************
 
 ostream& SBNDThermalNoiseServiceInFreq::print(ostream& out, string prefix) const {
@@ -189,6 +324,11 @@ ostream& SBNDThermalNoiseServiceInFreq::print(ostream& out, string prefix) const
   out << prefix << "          LogLevel: " <<  fLogLevel << endl;
   out << prefix << "        RandomSeed: " <<  fRandomSeed << endl;
   out << prefix << "  NoiseArrayPoints: " << fNoiseArrayPoints << endl;
+  out << prefix << "      UseNoiseBank: " << fUseNoiseBank << endl;
+  if ( fUseNoiseBank ) {
+    out << prefix << "     NoiseBankSize: " << fNoiseBankSize << endl;
+    out << prefix << "     NoiseBankFile: " << fNoiseBankFile << endl;
+  }
   
   return out;
 }
@@ -69,6 +69,7 @@ private:
   unsigned int fNoiseArrayPoints;  ///< number of points in randomly generated noise array
   int          fRandomSeed;        ///< Seed for random number service. If absent or zero, use SeedSvc.
   int          fLogLevel;          ///< Log message level: 0=quiet, 1=init only, 2+=every event
+  bool         fUseBlockGaussian;  ///< fill the signal in blocks (sbnd::fillGaussian) instead of a RandGaussQ call per sample
   std::map< double, int > fShapingTimeOrder;
   
   // Declare noise engines.
@@ -86,6 +87,6 @@ private:
 
 };
 
-DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDThermalNoiseServiceInTime, ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDThermalNoiseServiceInTime, ChannelNoiseService, SHARED)
 
 #endif
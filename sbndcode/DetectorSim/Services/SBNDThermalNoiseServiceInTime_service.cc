@@ -4,6 +4,7 @@
 // Based upon SPhaseChannelNoiseService.cxx developed by Jingbo Wang for ProtoDUNE.
 
 #include "sbndcode/DetectorSim/Services/SBNDThermalNoiseServiceInTime.h"
+#include "sbndcode/DetectorSim/Services/GaussianBlock.h"
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
 
 using std::cout;
@@ -24,6 +25,7 @@ SBNDThermalNoiseServiceInTime(fhicl::ParameterSet const& pset): fRandomSeed(0),
    
   const string myname = "SBNDThermalNoiseServiceInTime::ctor: ";
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints",1);
+  fUseBlockGaussian  = pset.get<bool>("UseBlockGaussian", false);
   bool haveSeed      = pset.get_if_present<int>("RandomSeed", fRandomSeed);
 
   fShapingTimeOrder = { {0.5, 0 }, {1.0, 1}, {2.0, 2}, {3.0, 3} };
@@ -69,20 +71,13 @@ int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
                                             Channel chan, AdcSignalVector& sigs) const {
 
   //Get services.
-  art::ServiceHandle<geo::Geometry> geo;
   art::ServiceHandle<util::SignalShapingServiceSBND> sss;
   
-  //Generate Noise:
-  size_t view = (size_t)geo->View(chan);
-  
   double noise_factor;
-  auto tempNoiseVec = sss->GetNoiseFactVec();
   double shapingTime = 2.0; //sss->GetShapingTime(chan);
-  double asicGain = sss->GetASICGain(chan);
   
   if (fShapingTimeOrder.find( shapingTime ) != fShapingTimeOrder.end() ) {
-    noise_factor = tempNoiseVec[view].at( fShapingTimeOrder.find( shapingTime )->second );
-    noise_factor *= asicGain/4.7;
+    noise_factor = sss->GetNoiseFactor(chan, fShapingTimeOrder.find( shapingTime )->second);
   }
   else {
     throw cet::exception("SBNDThermalNoiseServiceInTime_service")
@@ -94,11 +89,15 @@ int SBNDThermalNoiseServiceInTime::addNoise(detinfo::DetectorClocksData const&,
       << std::endl;
   }
 
-  CLHEP::RandGaussQ rGauss(*fNoiseEngine, 0.0, noise_factor);
-    
-
   //In this case fNoiseFact is a value in ADC counts
   //It is going to be the Noise RMS
+  if (fUseBlockGaussian) {
+    sbnd::fillGaussian(*fNoiseEngine, noise_factor, sigs.data(), sigs.size());
+    return 0;
+  }
+
+  CLHEP::RandGaussQ rGauss(*fNoiseEngine, 0.0, noise_factor);
+
   //loop over all bins in "noise" vector
   //and insert random noise value
   
@@ -118,6 +117,7 @@ ostream& SBNDThermalNoiseServiceInTime::print(ostream& out, string prefix) const
   out << prefix << "          LogLevel: " <<  fLogLevel << endl;
   out << prefix << "        RandomSeed: " <<  fRandomSeed << endl;
   out << prefix << "  NoiseArrayPoints: " << fNoiseArrayPoints << endl;
+  out << prefix << "  UseBlockGaussian: " << fUseBlockGaussian << endl;
   
   return out;
 }
@@ -21,6 +21,10 @@
 #define SBNDuBooNEDataDrivenNoiseService_H
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/Services/PhiloxRandom.h"
+#include "sbndcode/DetectorSim/Services/NoiseBank.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+#include "sbndcode/Utilities/DiagnosticHist.h"
 
 #include "art_root_io/TFileService.h"
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
@@ -38,6 +42,7 @@
 #include "TF1.h"
 #include "TMath.h"
 
+#include <cstdint>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -64,6 +69,16 @@ public:
   int addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const override;
 
   void generateNoise(detinfo::DetectorClocksData const& clockData) override;
+
+  // Per-channel random streams (UseChannelStreams).
+  bool hasChannelStreams() const override { return fUseChannelStreams; }
+  void setEventStream(std::uint64_t eventKey) override;
+  std::uint64_t streamKey(std::uint64_t eventKey) const override;
+  bool hasEventNoise() const override { return fEnableGaussianNoise || fEnableCoherentNoise; }
+  int addChannelNoise(detinfo::DetectorClocksData const& clockData, Channel chan,
+                      AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const override;
+  int addChannelNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                      Channel chan, AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const override;
  
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const override;
@@ -82,18 +97,40 @@ private:
                              AdcSignalVector& noise, std::vector<float> gausNorm,
 	                    std::vector<float> gausMean, std::vector<float> gausSigma,
 	                    TH1* aNoiseHist) const;
-  void generateCoherentNoise(detinfo::DetectorClocksData const& clockData,
-                             AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    float cohExpNorm, float cohExpWidth, float cohExpOffset, 
-	                    TH1* aNoiseHist) const;
+  // Coherent noise waveform of one group, from the tabulated coherent spectrum.
+  void generateCoherentNoise(AdcSignalVector& noise, TH1* aNoiseHist) const;
   
-  // Make coherent groups
-  void makeCoherentGroupsByOfflineChannel(unsigned int nchpergroup);
+  // Add the per-thread fills of the noise channel histograms to them.
+  void mergeDiagnostics();
+
+  // Make coherent groups: NChannelsPerCoherentGroup consecutive offline
+  // channels of the same view share one coherent waveform.
+  void makeCoherentGroups();
   std::vector<unsigned int> fChannelGroupMap;   ///< assign each channel a group number
-  std::vector<int> fGroupCoherentNoiseMap; ///< assign each group a noise 
+  unsigned int fNCohGroups;                     ///< number of coherent groups
   unsigned int getGroupNumberFromOfflineChannel(unsigned int offlinechan) const;
-  unsigned int getCohNoiseChanFromGroup(unsigned int cohgroup) const;
+
+  // Wire length in cm, including the jumper equivalent length if enabled.
+  double effectiveWireLength(geo::WireID const& wireID) const;
+
+  // Add the noise of one channel, drawing from rng (sbnd::PhiloxStream or
+  // the service engine); FFT is util::LArFFT or util::SBNDFFTWorker.
+  template <class RNG, class FFT>
+  int addNoiseFrom(detinfo::DetectorClocksData const& clockData, Channel chan,
+                   AdcSignalVector& sigs, RNG& rng, FFT& fft) const;
+
+  // Tabulate the MicroBooNE noise spectrum for the job FFT size and sampling rate.
+  void makeSpectrumTables(detinfo::DetectorClocksData const& clockData);
+  // Terms of the MicroBooNE spectrum (the former _pfn_f1 formula) at frequency f [kHz]:
+  // spectrum = base + [6]*wire.
+  static void microBooSpectrumTerms(double f, double const* par, double& base, double& wire);
+
+  // Inverse CDF of the amplitude randomizer density, tabulated at construction.
+  void makePoissonTable();
+  // Fill the MicroBooNE noise bank (UseNoiseBank), from NoiseBankFile when it holds it:
+  // waveform 0 is the base term, waveform 1 the wire term of the spectrum.
+  void makeNoiseBank(detinfo::DetectorClocksData const& clockData);
+  double samplePoisson(double u) const;
   
   // General parameters
   unsigned int fNoiseArrayPoints;  ///< number of points in randomly generated noise array
@@ -128,12 +165,16 @@ private:
   float        fVFirstJumper;         ///< Wire number of first wire on V layer to include a jumper cable. Defaults to 0 if not included.
   float        fVLastJumper;          ///< Wire number of last wire on V layer to include a jumper cable. Defaults to 0 if not included.
   std::vector<float>  fNoiseFunctionParameters;  ///< Parameters in the MicroBooNE noise model
+  bool         fUseNoiseBank;         ///< MicroBooNE noise from windows of a bank instead of an FFT per channel
+  std::size_t  fNoiseBankSize;        ///< samples in each bank waveform
+  std::string  fNoiseBankFile;        ///< file the bank is read from, or written to (empty: none)
+  unsigned int fNoiseBankSeed;        ///< seed of the bank random numbers
+  sbnd::NoiseBank fNoiseBank;
   
   // Coherent Noise parameters
   bool         fEnableCoherentNoise;
   std::vector<unsigned int> fNChannelsPerCoherentGroup;
   unsigned int fExpNoiseArrayPoints;  ///< number of points in randomly generated noise array
-  unsigned int fCohNoiseArrayPoints;  ///< number of points in randomly generated noise array
   float        fCohExpNorm;           ///< noise scale factor for the exponential component component in coherent noise
   float        fCohExpWidth;          ///< width of the exponential component in coherent noise
   float        fCohExpOffset;         ///< Amplitude offset of the exponential background component in coherent noise
@@ -153,9 +194,7 @@ private:
   AdcSignalVectorVector fMicroBooNoiseV;
   
   // Coherent Noise array.
-  AdcSignalVectorVector fCohNoiseZ;  ///< noise on each channel for each time for all planes  
-  AdcSignalVectorVector fCohNoiseU;  ///< noise on each channel for each time for all planes
-  AdcSignalVectorVector fCohNoiseV;  ///< noise on each channel for each time for all planes
+  AdcSignalVectorVector fCohNoise;   ///< noise of each coherent group for each time, made per event
 
 
   // Histograms.
@@ -171,24 +210,38 @@ private:
   TH1* fMicroBooNoiseChanHist;  ///< distribution of accessed noise samples
   
   TH1* fCohNoiseHist;      ///< distribution of noise counts
-  TH1* fCohNoiseChanHist;  ///< distribution of accessed noise samples
+  TH1* fCohNoiseChanHist;  ///< distribution of accessed coherent groups
 
-  TF1* _wld_f;
-  double wldparams[2];
+  // Fills of the channel histograms from addNoise, merged at the end of the job.
+  bool fDiagnosticHists;    ///< make and fill the histograms above
+  mutable sbnd::diag::DiagnosticHist fGausNoiseChanFills;
+  mutable sbnd::diag::DiagnosticHist fMicroBooNoiseChanFills;
+  mutable sbnd::diag::DiagnosticHist fCohNoiseChanFills;
 
-  TF1* _poisson;
+  double wldparams[2];
 
+  // Noise spectrum tables.
+  unsigned int        fSpectrumTicks;       ///< FFT size the tables were made for
+  double              fSpectrumSampleRate;  ///< sampling rate [ns] the tables were made for
+  std::vector<double> fSpectrumBase;        ///< wire-length independent term per frequency bin
+  std::vector<double> fSpectrumWire;        ///< term scaling with the wire length parameter
+  std::vector<double> fChannelWLD;          ///< wire length parameter of each channel
+  std::vector<double> fCohSpectrum;         ///< coherent noise spectrum per frequency bin
 
   // Randomisation.
   bool haveSeed;
   CLHEP::HepRandomEngine* m_pran;
   CLHEP::HepRandomEngine* ConstructRandomEngine(const bool haveSeed);
-  double GetRandomTF1(TF1* func) const;
-  TRandom3* fTRandom3;
+
+  // Per-channel random streams.
+  bool          fUseChannelStreams;   ///< draw from (event, channel) streams instead of m_pran
+  std::uint64_t fStreamKey;           ///< key of the current event, set by setEventStream
+  std::vector<double> fPoissonCDF;    ///< randomizer CDF on a uniform grid over [0, fPoissonMax]
+  double        fPoissonMax;
 
 
 };
 
-DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDuBooNEDataDrivenNoiseService, ChannelNoiseService, LEGACY)
+DECLARE_ART_SERVICE_INTERFACE_IMPL(SBNDuBooNEDataDrivenNoiseService, ChannelNoiseService, SHARED)
 
 #endif
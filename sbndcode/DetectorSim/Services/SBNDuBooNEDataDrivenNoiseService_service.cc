@@ -7,6 +7,11 @@
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
 using std::cout;
 using std::ostream;
 using std::endl;
@@ -17,6 +22,18 @@ using CLHEP::HepJamesRandom;
 
 namespace{
   constexpr double kPoissonMean = 3.30762;
+  constexpr unsigned int kPoissonTablePoints = 3000;
+
+  // The service engine, with the sbnd::PhiloxStream interface used by addNoise.
+  class EngineStream {
+  public:
+    explicit EngineStream(CLHEP::HepRandomEngine& engine) : fFlat(engine), fGaus(engine) { }
+    double fire() { return fFlat.fire(); }
+    double gauss() { return fGaus.fire(); }
+  private:
+    CLHEP::RandFlat fFlat;
+    CLHEP::RandGaussQ fGaus;
+  };
 }
 
 //**********************************************************************
@@ -29,9 +46,11 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fMicroBooNoiseHistZ(nullptr), fMicroBooNoiseHistU(nullptr), fMicroBooNoiseHistV(nullptr),
   fMicroBooNoiseChanHist(nullptr),
   fCohNoiseHist(nullptr), fCohNoiseChanHist(nullptr),
+  fDiagnosticHists(pset.get<bool>("DiagnosticHists", true)),
   haveSeed(pset.get_if_present<int>("RandomSeed", fRandomSeed)),
   m_pran(ConstructRandomEngine(haveSeed)),
-  fTRandom3(new TRandom3(m_pran->getSeed()))
+  fUseChannelStreams(pset.get<bool>("UseChannelStreams", false)),
+  fStreamKey(0), fPoissonMax(30.)
 {
 
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints");
@@ -61,9 +80,12 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fVFirstJumper        = pset.get<double>("VFirstJumper");
   fVLastJumper         = pset.get<double>("VLastJumper");
   fNoiseFunctionParameters   = pset.get<std::vector<float>>("NoiseFunctionParameters");
+  fUseNoiseBank        = pset.get<bool>("UseNoiseBank", false);
+  fNoiseBankSize       = pset.get<std::size_t>("NoiseBankSize", 1 << 20);
+  fNoiseBankFile       = pset.get<std::string>("NoiseBankFile", "");
+  fNoiseBankSeed       = pset.get<unsigned int>("NoiseBankSeed", 1);
   
   fEnableCoherentNoise = pset.get<bool>("EnableCoherentNoise");
-  fCohNoiseArrayPoints = pset.get<unsigned int>("CohNoiseArrayPoints");
   fCohExpNorm          = pset.get<float>("CohExpNorm");
   fCohExpWidth         = pset.get<float>("CohExpWidth");
   fCohExpOffset        = pset.get<float>("CohExpOffset");
@@ -71,29 +93,40 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fCohGausMean         = pset.get<std::vector<float>>("CohGausMean");
   fCohGausSigma        = pset.get<std::vector<float>>("CohGausSigma");
   fNChannelsPerCoherentGroup      = pset.get<std::vector<unsigned int>>("NChannelsPerCoherentGroup");
+
+  fNCohGroups = 0;
+  if ( fEnableCoherentNoise ) makeCoherentGroups();
   
-  art::ServiceHandle<art::TFileService> tfs;
-  fMicroBooNoiseHistZ = tfs->make<TH1F>("MicroBoo znoise", ";Z Noise [ADC counts];", 1000,   -10., 10.);
-  fMicroBooNoiseHistU = tfs->make<TH1F>("MicroBoo unoise", ";U Noise [ADC counts];", 1000,   -10., 10.);
-  fMicroBooNoiseHistV = tfs->make<TH1F>("MicroBoo vnoise", ";V Noise [ADC counts];", 1000,   -10., 10.);
-  fMicroBooNoiseChanHist = tfs->make<TH1F>("MicroBoo NoiseChan", ";MicroBoo Noise channel;", fNoiseArrayPoints, 0, fNoiseArrayPoints);
-  fGausNoiseHistZ = tfs->make<TH1F>("Gaussian znoise", ";Z Noise [ADC counts];", 1000,   -10., 10.);
-  fGausNoiseHistU = tfs->make<TH1F>("Gaussian unoise", ";U Noise [ADC counts];", 1000,   -10., 10.);
-  fGausNoiseHistV = tfs->make<TH1F>("Gaussian vnoise", ";V Noise [ADC counts];", 1000,   -10., 10.);
-  fGausNoiseChanHist = tfs->make<TH1F>("Gaussian NoiseChan", ";Gaussian Noise channel;", fNoiseArrayPoints, 0, fNoiseArrayPoints);
-  fCohNoiseHist = tfs->make<TH1F>("Cohnoise", ";Coherent Noise [ADC counts];", 1000,   -10., 10.);                           
-  fCohNoiseChanHist = tfs->make<TH1F>("CohNoiseChan", ";CohNoise channel;", fCohNoiseArrayPoints, 0, fCohNoiseArrayPoints);// III = for each instance of this class.
+  if ( fDiagnosticHists ) {
+    art::ServiceHandle<art::TFileService> tfs;
+    fMicroBooNoiseHistZ = tfs->make<TH1F>("MicroBoo znoise", ";Z Noise [ADC counts];", 1000,   -10., 10.);
+    fMicroBooNoiseHistU = tfs->make<TH1F>("MicroBoo unoise", ";U Noise [ADC counts];", 1000,   -10., 10.);
+    fMicroBooNoiseHistV = tfs->make<TH1F>("MicroBoo vnoise", ";V Noise [ADC counts];", 1000,   -10., 10.);
+    fMicroBooNoiseChanHist = tfs->make<TH1F>("MicroBoo NoiseChan", ";MicroBoo Noise channel;", fNoiseArrayPoints, 0, fNoiseArrayPoints);
+    fGausNoiseHistZ = tfs->make<TH1F>("Gaussian znoise", ";Z Noise [ADC counts];", 1000,   -10., 10.);
+    fGausNoiseHistU = tfs->make<TH1F>("Gaussian unoise", ";U Noise [ADC counts];", 1000,   -10., 10.);
+    fGausNoiseHistV = tfs->make<TH1F>("Gaussian vnoise", ";V Noise [ADC counts];", 1000,   -10., 10.);
+    fGausNoiseChanHist = tfs->make<TH1F>("Gaussian NoiseChan", ";Gaussian Noise channel;", fNoiseArrayPoints, 0, fNoiseArrayPoints);
+    fCohNoiseHist = tfs->make<TH1F>("Cohnoise", ";Coherent Noise [ADC counts];", 1000,   -10., 10.);                           
+    unsigned int const nCohBins = std::max(fNCohGroups, 1u);
+    fCohNoiseChanHist = tfs->make<TH1F>("CohNoiseChan", ";CohNoise group;", nCohBins, 0, nCohBins);// III = for each instance of this class.
+    fMicroBooNoiseChanFills.Reset(fNoiseArrayPoints, 0, fNoiseArrayPoints);
+    fGausNoiseChanFills.Reset(fNoiseArrayPoints, 0, fNoiseArrayPoints);
+    fCohNoiseChanFills.Reset(nCohBins, 0, nCohBins);
+  }
   
   //generateNoise(); //This has been replaced by the same function in SimWireSBND. This is so the noise arrays are recalculated for each event.
 
-  // Wirelength dependance function
-  _wld_f = new TF1("_wld_f", "[0] + [1]*x", 0.0, 1000);
+  // Wirelength dependance function: [0] + [1]*wirelength
   wldparams[0] = 0.395;
   wldparams[1] = 0.001304;
-  _wld_f->SetParameters(wldparams);
 
-  _poisson = new TF1("_poisson", "[0]**(x) * exp(-[0]) / ROOT::Math::tgamma(x+1.)", 0, 30);
-  _poisson->SetParameter(0, kPoissonMean); 
+  // Tabulate the noise spectrum and the amplitude randomizer once,
+  // addNoise only looks them up.
+  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
+  makeSpectrumTables(clockData);
+  makePoissonTable();
+  if ( fUseNoiseBank ) makeNoiseBank(clockData);
 
   if ( fLogLevel > 1 ) print() << endl;
 
@@ -102,8 +135,19 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
 //**********************************************************************
 
 SBNDuBooNEDataDrivenNoiseService::
-SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset, art::ActivityRegistry&)
-: SBNDuBooNEDataDrivenNoiseService(pset) { }
+SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset, art::ActivityRegistry& reg)
+: SBNDuBooNEDataDrivenNoiseService(pset) {
+  reg.sPostEndJob.watch(this, &SBNDuBooNEDataDrivenNoiseService::mergeDiagnostics);
+}
+
+//**********************************************************************
+
+void SBNDuBooNEDataDrivenNoiseService::mergeDiagnostics() {
+  if ( !fDiagnosticHists ) return;
+  fMicroBooNoiseChanFills.MergeInto(*fMicroBooNoiseChanHist);
+  fGausNoiseChanFills.MergeInto(*fGausNoiseChanHist);
+  fCohNoiseChanFills.MergeInto(*fCohNoiseChanHist);
+}
 
 //**********************************************************************
 
@@ -136,145 +180,246 @@ CLHEP::HepRandomEngine* SBNDuBooNEDataDrivenNoiseService::ConstructRandomEngine(
   return m_pran;
 }
 
-double SBNDuBooNEDataDrivenNoiseService::GetRandomTF1(TF1* func) const{
-  TRandom* gRandomTemp = gRandom;
-  gRandom = fTRandom3;
-  double randomVal(func->GetRandom());
-  gRandom = gRandomTemp;
-  return randomVal;
-}
-  
 //**********************************************************************
 
-int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const {
-  CLHEP::RandFlat flat(*m_pran);
-  CLHEP::RandGaussQ gaus(*m_pran);
+void SBNDuBooNEDataDrivenNoiseService::makeSpectrumTables(detinfo::DetectorClocksData const& clockData) {
+  // The MicroBooNE spectrum is linear in the wire length parameter
+  // ([6] in the _pfn_f1 formula), so two terms per frequency bin describe
+  // every channel exactly: spectrum = base + wld(wire length)*wire.
+  art::ServiceHandle<util::LArFFT> pfft;
+  fSpectrumTicks = pfft->FFTSize();
+  fSpectrumSampleRate = sampling_rate(clockData);
+  double binWidth = 1.0/(fSpectrumTicks*fSpectrumSampleRate*1.0e-6);
 
-  unsigned int microbooNoiseChan = flat.fire()*fNoiseArrayPoints;
-  if ( microbooNoiseChan == fNoiseArrayPoints ) --microbooNoiseChan;
-  fMicroBooNoiseChanHist->Fill(microbooNoiseChan);
-  
-  unsigned int gausNoiseChan = flat.fire()*fNoiseArrayPoints;
-  if ( gausNoiseChan == fNoiseArrayPoints ) --gausNoiseChan;
-  fGausNoiseChanHist->Fill(gausNoiseChan);
-  
-  unsigned int cohNoisechan = -999;
-  unsigned int groupNum = -999;
+  double fitpar[9] = {0.};
+  for ( unsigned int ipar=0; ipar<8; ++ipar ) fitpar[ipar] = fNoiseFunctionParameters.at(ipar);
+  fitpar[8] = 9596; //uBooNE nticks. Using SBND (or ProtoDUNE) nticks changes the model significantly, so we stick with the uBooNE nticks. 
+
+  unsigned nbin = fSpectrumTicks/2 + 1;
+  fSpectrumBase.resize(nbin);
+  fSpectrumWire.resize(nbin);
+  for ( unsigned int i=0; i<nbin; ++i ) {
+    microBooSpectrumTerms((i+0.5)*binWidth, fitpar, fSpectrumBase[i], fSpectrumWire[i]);
+  }
+
+  // Coherent noise spectrum: Gaussian peaks over an exponential background.
   if ( fEnableCoherentNoise ) {
-    groupNum = getGroupNumberFromOfflineChannel(chan);
-    cohNoisechan = getCohNoiseChanFromGroup(groupNum);
-    if ( cohNoisechan == fCohNoiseArrayPoints ) cohNoisechan = fCohNoiseArrayPoints-1;
-    fCohNoiseChanHist->Fill(cohNoisechan);
+    std::size_t const nGaus = std::min({ fCohGausNorm.size(), fCohGausMean.size(), fCohGausSigma.size() });
+    fCohSpectrum.resize(nbin);
+    for ( unsigned int i=0; i<nbin; ++i ) {
+      double const x = i*binWidth;
+      double pval = fCohExpNorm*exp(-x/fCohExpWidth) + fCohExpOffset;
+      for ( std::size_t ig=0; ig<nGaus; ++ig ) {
+        pval += fCohGausNorm[ig]*exp(-0.5*pow((x-fCohGausMean[ig])/fCohGausSigma[ig], 2));
+      }
+      fCohSpectrum[i] = pval;
+    }
   }
 
+  // Wire length parameter of each channel.
   art::ServiceHandle<geo::Geometry> geo;
-  std::vector<geo::WireID> wireIDs = geo->ChannelToWire(chan);
-  unsigned int wireID = wireIDs.front().Wire;
-  unsigned int planeID = wireIDs.front().Plane;
+  fChannelWLD.assign(geo->Nchannels(), 0.);
+  for ( unsigned int chan=0; chan<geo->Nchannels(); ++chan ) {
+    std::vector<geo::WireID> wireIDs = geo->ChannelToWire(chan);
+    if ( wireIDs.empty() ) continue;
+    fChannelWLD[chan] = wldparams[0] + wldparams[1]*effectiveWireLength(wireIDs.front());
+  }
+}
 
-  geo::WireGeo const& wire = geo->Wire(wireIDs.front());
-  double wirelength = wire.Length(); //wirelength in cm.
+//**********************************************************************
 
-  if(fIncludeJumpers){
-    if( (planeID==0 && wireID >= fUFirstJumper && wireID <= fULastJumper) || (planeID==1 && wireID >= fVFirstJumper && wireID <= fVLastJumper) ){ //Add jumper term only for appropriate wires on U and V planes.
-      double jumperLength = (fJumperCapacitance/16.75)*100; //Using wire value of 16.75 pF/m to convert jumper capacitance to equivalent wire length. x100 to convert to cm.
-      wirelength = wirelength + jumperLength;
-    }
-  }
-  //include for 0 wirelength tests.
-  //wirelength = 0;
+void SBNDuBooNEDataDrivenNoiseService::makeNoiseBank(detinfo::DetectorClocksData const& clockData) {
+  const string myname = "SBNDuBooNEDataDrivenNoiseService::makeNoiseBank: ";
 
+  double fitpar[9] = {0.};
+  for ( unsigned int ipar=0; ipar<8; ++ipar ) fitpar[ipar] = fNoiseFunctionParameters.at(ipar);
+  fitpar[8] = 9596; // as in makeSpectrumTables
 
-  ///This part below has been moved from the generateMicroBooNoise section as it needs to be done differently for SBND due to different wirelengths.
+  std::uint64_t const config = sbnd::NoiseBank::checksum({
+    2. /* MicroBooNE noise */, double(fSpectrumTicks), fSpectrumSampleRate,
+    fitpar[0], fitpar[1], fitpar[2], fitpar[3], fitpar[4], fitpar[5], fitpar[6], fitpar[7], fitpar[8],
+    kPoissonMean, fPoissonMax, double(fNoiseBankSize), double(fNoiseBankSeed) });
 
-  ////////////////////////////// MicroBooNE noise model/////////////////////////////////
-  // vars
+  if ( !fNoiseBankFile.empty() && fNoiseBank.read(fNoiseBankFile, config) ) {
+    if ( fLogLevel > 0 ) cout << myname << "Noise bank read from " << fNoiseBankFile << endl;
+    return;
+  }
 
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
-  // Fetch FFT service and # ticks.
-  art::ServiceHandle<util::LArFFT> pfft;
-  unsigned int ntick = pfft->FFTSize(); //waveform_size
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
+  // the tables evaluate the bin i of a readout window at (i+0.5)*binWidth
+  double const binWidth = 1.0/(fSpectrumTicks*fSpectrumSampleRate*1.0e-6);
+  double const bankBinWidth = 1.0/(fNoiseBankSize*fSpectrumSampleRate*1.0e-6);
+  auto spectrum = [&](double f, double* amp) {
+    microBooSpectrumTerms(f + 0.5*binWidth, fitpar, amp[0], amp[1]);
+  };
+  auto randomizer = [this](double u) { return samplePoisson(u)/kPoissonMean; };
+
+  // addNoise scales the inverse FFT by sqrt(ntick): the noise is the sum of the bins over sqrt(ntick)
+  fNoiseBank.generate(2, fNoiseBankSize, fSpectrumTicks, bankBinWidth, 1./sqrt(fSpectrumTicks),
+                      fNoiseBankSeed, spectrum, randomizer);
+  if ( fLogLevel > 0 ) cout << myname << "Noise bank of " << fNoiseBankSize << " samples generated" << endl;
+
+  if ( !fNoiseBankFile.empty() && !fNoiseBank.write(fNoiseBankFile, config) ) {
+    cout << myname << "WARNING: Could not write the noise bank to " << fNoiseBankFile << endl;
+  }
+}
 
-  // Create noise spectrum in frequency.
-  unsigned nbin = ntick/2 + 1;
-  std::vector<TComplex> noiseFrequency(nbin, 0.);
-  double pval = 0.;
-  double phase = 0.;
-  double rnd[3] = {0.};
+//**********************************************************************
 
-  std::vector<double> noisevector(ntick,0.0);
-  double fitpar[9] = {0.};
-  
-  // gain function in kHz
-  TF1* _pfn_f1 = new TF1("_pfn_f1", "([0]*1/(x/1000*[8]/2) + ([1]*exp(-0.5*(((x/1000*[8]/2)-[2])/[3])**2)*exp(-0.5*pow(x/1000*[8]/(2*[4]),[5])))*[6]) + [7]", 0.0, 0.5*ntick*binWidth);
-  // set data-driven parameters
- 
-  double wldValue = _wld_f->Eval(wirelength);
-
-  fitpar[0] = fNoiseFunctionParameters.at(0);
-  fitpar[1] = fNoiseFunctionParameters.at(1);
-  fitpar[2] = fNoiseFunctionParameters.at(2);
-  fitpar[3] = fNoiseFunctionParameters.at(3);
-  fitpar[4] = fNoiseFunctionParameters.at(4);
-  fitpar[5] = fNoiseFunctionParameters.at(5);
-  fitpar[6] = wldValue; //wire length parameter
-  fitpar[7] = fNoiseFunctionParameters.at(7); //baseline_noise
-  fitpar[8] = 9596; //uBooNE nticks. Using SBND (or ProtoDUNE) nticks changes the model significantly, so we stick with the uBooNE nticks. 
+void SBNDuBooNEDataDrivenNoiseService::microBooSpectrumTerms(double f, double const* par, double& base, double& wire) {
+  double const x = f/1000*par[8]/2;
+  base = par[0]/x + par[7];
+  wire = par[1]*exp(-0.5*pow((x-par[2])/par[3], 2))*exp(-0.5*pow(x/par[4], par[5]));
+}
 
-  _pfn_f1->SetParameters(fitpar);
-  _pfn_f1->SetNpx(1000);
+//**********************************************************************
 
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    //MicroBooNE noise model
-    double pfnf1val = _pfn_f1->Eval((i+0.5)*binWidth);
-    // define FFT parameters
-    double randPoisson = GetRandomTF1(_poisson);
-    double randomizer = randPoisson/kPoissonMean;
-    pval = pfnf1val * randomizer;
-    // random phase angle
-    flat.fireArray(2, rnd, 0, 1);
-    phase = rnd[1]*2.*TMath::Pi();
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
+void SBNDuBooNEDataDrivenNoiseService::makePoissonTable() {
+  // Density of the randomizer: mean^x exp(-mean) / Gamma(x+1) on [0, fPoissonMax].
+  double const dx = fPoissonMax/kPoissonTablePoints;
+  fPoissonCDF.assign(kPoissonTablePoints+1, 0.);
+  double prev = exp(-kPoissonMean);
+  for ( unsigned int k=1; k<=kPoissonTablePoints; ++k ) {
+    double const x = k*dx;
+    double const pdf = exp(x*log(kPoissonMean) - kPoissonMean - std::lgamma(x+1.));
+    fPoissonCDF[k] = fPoissonCDF[k-1] + 0.5*(pdf + prev)*dx;
+    prev = pdf;
   }
+  double const norm = fPoissonCDF.back();
+  for ( double& c : fPoissonCDF ) c /= norm;
+}
+
+//**********************************************************************
 
+double SBNDuBooNEDataDrivenNoiseService::samplePoisson(double u) const {
+  auto const it = std::upper_bound(fPoissonCDF.begin(), fPoissonCDF.end(), u);
+  if ( it == fPoissonCDF.begin() ) return 0.;
+  if ( it == fPoissonCDF.end() ) return fPoissonMax;
+  size_t const k = it - fPoissonCDF.begin();
+  double const c0 = fPoissonCDF[k-1];
+  double const c1 = fPoissonCDF[k];
+  double const frac = c1 > c0 ? (u - c0)/(c1 - c0) : 0.;
+  return (k - 1 + frac)*fPoissonMax/kPoissonTablePoints;
+}
+  
+//**********************************************************************
 
-  // Obtain time spectrum from frequency spectrum.
-  std::vector<double> tmpnoise(noisevector.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
-  for ( unsigned int itck=0; itck<noisevector.size(); ++itck ) {
-    noisevector[itck] = sqrt(ntick)*tmpnoise[itck];
+int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const& clockData, Channel chan, AdcSignalVector& sigs) const {
+  art::ServiceHandle<util::LArFFT> pfft;
+  if ( fUseChannelStreams ) {
+    sbnd::PhiloxStream rng(fStreamKey, chan);
+    return addNoiseFrom(clockData, chan, sigs, rng, *pfft);
   }
-  // end of moved section.
+  EngineStream rng(*m_pran);
+  return addNoiseFrom(clockData, chan, sigs, rng, *pfft);
+}
+
+//**********************************************************************
+
+void SBNDuBooNEDataDrivenNoiseService::setEventStream(std::uint64_t eventKey) {
+  fStreamKey = streamKey(eventKey);
+}
+
+//**********************************************************************
+
+std::uint64_t SBNDuBooNEDataDrivenNoiseService::streamKey(std::uint64_t eventKey) const {
+  return sbnd::mixStreamKey(m_pran->getSeed(), eventKey);
+}
+
+//**********************************************************************
+
+int SBNDuBooNEDataDrivenNoiseService::addChannelNoise(detinfo::DetectorClocksData const& clockData, Channel chan,
+                                                      AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const {
+  return addChannelNoise(clockData, fStreamKey, chan, sigs, fft);
+}
+
+//**********************************************************************
 
-  _pfn_f1->Delete();
+int SBNDuBooNEDataDrivenNoiseService::addChannelNoise(detinfo::DetectorClocksData const& clockData, std::uint64_t streamKey,
+                                                      Channel chan, AdcSignalVector& sigs, util::SBNDFFTWorker& fft) const {
+  if ( !fUseChannelStreams ) return addNoise(clockData, chan, sigs);
+  // All the random numbers of this channel come from its own stream.
+  sbnd::PhiloxStream rng(streamKey, chan);
+  return addNoiseFrom(clockData, chan, sigs, rng, fft);
+}
+
+//**********************************************************************
+
+template <class RNG, class FFT>
+int SBNDuBooNEDataDrivenNoiseService::addNoiseFrom(detinfo::DetectorClocksData const& clockData, Channel chan,
+                                                   AdcSignalVector& sigs, RNG& rng, FFT& fft) const {
+  unsigned int microbooNoiseChan = rng.fire()*fNoiseArrayPoints;
+  if ( microbooNoiseChan == fNoiseArrayPoints ) --microbooNoiseChan;
   
+  unsigned int gausNoiseChan = rng.fire()*fNoiseArrayPoints;
+  if ( gausNoiseChan == fNoiseArrayPoints ) --gausNoiseChan;
+  
+  unsigned int cohGroup = -999;
+  if ( fEnableCoherentNoise ) cohGroup = getGroupNumberFromOfflineChannel(chan);
 
+  // per-thread fills, merged into the histograms at the end of the job
+  fMicroBooNoiseChanFills.Fill(microbooNoiseChan);
+  fGausNoiseChanFills.Fill(gausNoiseChan);
+  if ( fEnableCoherentNoise ) fCohNoiseChanFills.Fill(cohGroup);
 
+  ////////////////////////////// MicroBooNE noise model/////////////////////////////////
+  unsigned int ntick = fft.FFTSize(); //waveform_size
+  if ( ntick != fSpectrumTicks || sampling_rate(clockData) != fSpectrumSampleRate ) {
+    throw cet::exception("SBNDuBooNEDataDrivenNoiseService")
+      << "Noise spectrum tabulated for " << fSpectrumTicks << " ticks at " << fSpectrumSampleRate
+      << " ns, requested " << ntick << " ticks at " << sampling_rate(clockData) << " ns\n";
+  }
+
+  double const wldValue = fChannelWLD.at(chan);
+  std::vector<double> noisevector(ntick, 0.0);
+
+  if ( fUseNoiseBank ) {
+    // the spectrum is linear in the wire length parameter, and so is the
+    // noise: the same window of the base and wire term waveforms
+    sbnd::NoiseBank::Window const win = fNoiseBank.drawWindow(ntick, rng);
+    float const* base = fNoiseBank.samples(0, win);
+    float const* wire = fNoiseBank.samples(1, win);
+    for ( unsigned int itck=0; itck<ntick; ++itck ) {
+      noisevector[itck] = win.sign*(base[itck] + wldValue*wire[itck]);
+    }
+  }
+  else {
+    // Noise spectrum in frequency: tabulated envelope times a random amplitude and phase.
+    unsigned nbin = ntick/2 + 1;
+    std::vector<TComplex> noiseFrequency(nbin, 0.);
+    for ( unsigned int i=0; i<nbin; ++i ) {
+      double pval = (fSpectrumBase[i] + wldValue*fSpectrumWire[i]) * samplePoisson(rng.fire())/kPoissonMean;
+      double phase = rng.fire()*2.*TMath::Pi();
+      noiseFrequency[i] = TComplex(pval*cos(phase), pval*sin(phase));
+    }
+
+    // Obtain time spectrum from frequency spectrum.
+    fft.DoInvFFT(noiseFrequency, noisevector);
+    for ( unsigned int itck=0; itck<noisevector.size(); ++itck ) {
+      noisevector[itck] *= sqrt(ntick);
+    }
+  }
+
+  art::ServiceHandle<geo::Geometry> geo;
   const geo::View_t view = geo->View(chan);
   for ( unsigned int itck=0; itck<sigs.size(); ++itck ) {
     double tnoise = 0;
     if ( view==geo::kU ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseU*gaus.fire();
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseU*rng.gauss();
       if(fEnableMicroBooNoise) tnoise += noisevector[itck];
       if(fEnableGaussianNoise) tnoise += fGausNoiseU[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseU[cohNoisechan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohNoise[cohGroup][itck];
     } 
     else if ( view==geo::kV ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseV*gaus.fire();
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseV*rng.gauss();
       if(fEnableMicroBooNoise) tnoise += noisevector[itck];
       if(fEnableGaussianNoise) tnoise += fGausNoiseV[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseV[cohNoisechan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohNoise[cohGroup][itck];
     } 
     else {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseZ*gaus.fire();
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseZ*rng.gauss();
       if(fEnableMicroBooNoise) tnoise += noisevector[itck];
       if(fEnableGaussianNoise) tnoise += fGausNoiseZ[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseZ[cohNoisechan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohNoise[cohGroup][itck];
     }      
     sigs[itck] += tnoise;
   }
@@ -283,6 +428,26 @@ int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const
 
 //**********************************************************************
 
+double SBNDuBooNEDataDrivenNoiseService::effectiveWireLength(geo::WireID const& wid) const {
+  art::ServiceHandle<geo::Geometry> geo;
+  unsigned int wireID = wid.Wire;
+  unsigned int planeID = wid.Plane;
+
+  double wirelength = geo->Wire(wid).Length(); //wirelength in cm.
+
+  if(fIncludeJumpers){
+    if( (planeID==0 && wireID >= fUFirstJumper && wireID <= fULastJumper) || (planeID==1 && wireID >= fVFirstJumper && wireID <= fVLastJumper) ){ //Add jumper term only for appropriate wires on U and V planes.
+      double jumperLength = (fJumperCapacitance/16.75)*100; //Using wire value of 16.75 pF/m to convert jumper capacitance to equivalent wire length. x100 to convert to cm.
+      wirelength = wirelength + jumperLength;
+    }
+  }
+  //include for 0 wirelength tests.
+  //wirelength = 0;
+  return wirelength;
+}
+
+//**********************************************************************
+
 ostream& SBNDuBooNEDataDrivenNoiseService::print(ostream& out, string prefix) const {
   out << prefix << "SBNDuBooNEDataDrivenNoiseService: " << endl;
   
@@ -338,7 +503,7 @@ ostream& SBNDuBooNEDataDrivenNoiseService::print(ostream& out, string prefix) co
     
   out << prefix << "EnableCoherentNoise: " << fEnableCoherentNoise   << endl;
   out << prefix << "ExpNoiseArrayPoints: " << fExpNoiseArrayPoints << endl;
-  out << prefix << "CohNoiseArrayPoints: " << fCohNoiseArrayPoints << endl;
+  out << prefix << "         NCohGroups: " << fNCohGroups << endl;
   
   out << prefix << "     CohGausNorm: [ ";  
   for(int i=0; i<(int)fCohGausNorm.size(); i++) { out <<  fCohGausNorm.at(i) << " ";}
@@ -421,8 +586,10 @@ generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
   for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
     noise[itck] = sqrt(ntick)*tmpnoise[itck];
   }
-  for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
-    aNoiseHist->Fill(noise[itck]);
+  if ( aNoiseHist ) {
+    for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
+      aNoiseHist->Fill(noise[itck]);
+    }
   }
   
   //free memory
@@ -430,75 +597,35 @@ generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
 }
 ////**********************************************************************
 
-void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorClocksData const& clockData,
-                      AdcSignalVector& noise, std::vector<float> gausNorm,
-	                    std::vector<float> gausMean, std::vector<float> gausSigma,
-	                    float cohExpNorm, float cohExpWidth, float cohExpOffset, 
-	                    TH1* aNoiseHist) const {
-  const string myname = "SBNDuBooNEDataDrivenNoiseService::generateCoherentGaussianNoise: ";
+void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(AdcSignalVector& noise, TH1* aNoiseHist) const {
+  const string myname = "SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise: ";
   if ( fLogLevel > 1 ) {
-    cout << myname << "Generating Coherent Gaussian noise." << endl;  
-  }
-  //--- get number of gaussians ---  
-  int a = gausNorm.size();
-  int b = gausMean.size();
-  int c = gausSigma.size();
-  int NGausians = a<b?a:b;
-  NGausians = NGausians<c?NGausians:c;
-  //--- set function formula ---
-  std::stringstream  name;
-  name.str("");
-  for(int i=0;i<NGausians;i++) {
-  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
+    cout << myname << "Generating Coherent noise." << endl;  
   }
-  name<<"["<<3*NGausians<<"]*exp(-x/["<<3*NGausians+1<<"]) + ["<<3*NGausians+2<<"]";
-  TF1 *funcCohNoise = new TF1("funcGausCohsNoise",name.str().c_str(), 0, 1200);
-  funcCohNoise->SetNpx(12000);
-  for(int i=0;i<NGausians;i++) {
-    funcCohNoise->SetParameter(3*i, gausNorm.at(i));	
-    funcCohNoise->SetParameter(3*i+1, gausMean.at(i));	
-    funcCohNoise->SetParameter(3*i+2, gausSigma.at(i));	
-  }
-  funcCohNoise->SetParameter(3*NGausians, cohExpNorm);
-  funcCohNoise->SetParameter(3*NGausians+1, cohExpWidth);
-  funcCohNoise->SetParameter(3*NGausians+2, cohExpOffset);
-  
-  // custom poisson  
-  TF1* _poisson = new TF1("_poisson", "[0]**(x) * exp(-[0]) / ROOT::Math::tgamma(x+1.)", 0, 30);
-  // poisson mean
-  double params[1] = {0.};
-  params[0] = 4; // hard-coded for now. To be updated with data
-  _poisson->SetParameters(params);
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
   // Fetch FFT service and # ticks.
   art::ServiceHandle<util::LArFFT> pfft;
   unsigned int ntick = pfft->FFTSize();
+  if ( ntick != fSpectrumTicks ) {
+    throw cet::exception("SBNDuBooNEDataDrivenNoiseService")
+      << "Coherent noise spectrum tabulated for " << fSpectrumTicks << " ticks, requested " << ntick << "\n";
+  }
   CLHEP::RandFlat flat(*m_pran);
   // Create noise spectrum in frequency.
   unsigned nbin = ntick/2 + 1;
   std::vector<TComplex> noiseFrequency(nbin, 0.);
-  double pval = 0.;
-  double phase = 0.;
   double rnd[2] = {0.};
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    // coherent noise spectrum 
-    pval = funcCohNoise->Eval((double)i*binWidth);
+  for ( unsigned int i=0; i<nbin; ++i ) {
     // randomize amplitude within 10%
     flat.fireArray(2, rnd, 0, 1);
-    pval *= 0.9 + 0.2*rnd[0];
-    phase = rnd[1]*2.*TMath::Pi(); 
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
+    double pval = fCohSpectrum[i]*(0.9 + 0.2*rnd[0]);
+    double phase = rnd[1]*2.*TMath::Pi(); 
+    noiseFrequency[i] = TComplex(pval*cos(phase), pval*sin(phase));
   }
   // Obtain time spectrum from frequency spectrum.
   noise.clear();
   noise.resize(ntick,0.0);
   std::vector<double> tmpnoise(noise.size());
   pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
   
   // Note: Assume that the frequency function is obtained from a fit 
   // of the foward FFT spectrum. In LArSoft, the forward
@@ -512,35 +639,32 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
   for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
     noise[itck] = sqrt(ntick)*tmpnoise[itck];
   }
-  for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
-    aNoiseHist->Fill(noise[itck]);
+  if ( aNoiseHist ) {
+    for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
+      aNoiseHist->Fill(noise[itck]);
+    }
   }
-  
-  //free memory
-  delete funcCohNoise; funcCohNoise = 0;
 }
 
 //**********************************************************************
 
-void SBNDuBooNEDataDrivenNoiseService::makeCoherentGroupsByOfflineChannel(unsigned int nchpergroup) {
-	CLHEP::RandFlat flat(*m_pran);
-	CLHEP::RandGauss gaus(*m_pran);
-	art::ServiceHandle<geo::Geometry> geo;
-	const unsigned int nchan = geo->Nchannels();
-	fChannelGroupMap.resize(nchan);
-	unsigned int numberofgroups = 0;
-	if(nchan%nchpergroup == 0) numberofgroups = nchan/nchpergroup;
-	else numberofgroups = nchan/nchpergroup +1;
-	unsigned int cohGroupNo = 0;
-	for(unsigned int chan=0; chan<nchan; chan++) {
-	  cohGroupNo = chan/nchpergroup; //group number
-	  fChannelGroupMap[chan] = cohGroupNo; 
-	}
-	fGroupCoherentNoiseMap.resize(numberofgroups);
-	for(unsigned int ng=0; ng<numberofgroups; ng++) {
-	  unsigned int cohNoiseChan = flat.fire()*fCohNoiseArrayPoints;
-	  fGroupCoherentNoiseMap[ng] = cohNoiseChan;
-	}
+void SBNDuBooNEDataDrivenNoiseService::makeCoherentGroups() {
+  if ( fNChannelsPerCoherentGroup.size() < 3 ) {
+    throw cet::exception("SBNDuBooNEDataDrivenNoiseService")
+      << "NChannelsPerCoherentGroup needs one entry per view (U, V, Z)\n";
+  }
+  art::ServiceHandle<geo::Geometry> geo;
+  const unsigned int nchan = geo->Nchannels();
+  fChannelGroupMap.resize(nchan);
+  // groups are numbered in order of first appearance, (view, chan/nchpergroup) being a group
+  std::map<std::pair<int, unsigned int>, unsigned int> groupNumbers;
+  for(unsigned int chan=0; chan<nchan; chan++) {
+    const geo::View_t view = geo->View(chan);
+    unsigned int const iview = (view==geo::kU) ? 0 : (view==geo::kV) ? 1 : 2;
+    auto const key = std::make_pair(int(iview), chan/fNChannelsPerCoherentGroup[iview]);
+    fChannelGroupMap[chan] = groupNumbers.emplace(key, groupNumbers.size()).first->second;
+  }
+  fNCohGroups = groupNumbers.size();
 }
 
 //**********************************************************************
@@ -548,11 +672,6 @@ unsigned int SBNDuBooNEDataDrivenNoiseService::getGroupNumberFromOfflineChannel(
   return fChannelGroupMap[offlinechan];
 }
 
-//**********************************************************************
-unsigned int SBNDuBooNEDataDrivenNoiseService::getCohNoiseChanFromGroup(unsigned int cohgroup) const {
-  return fGroupCoherentNoiseMap[cohgroup];
-}
-
 //**********************************************************************
 
 void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData const& clockData){
@@ -569,32 +688,10 @@ void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData
   }
   
   if(fEnableCoherentNoise) {
-    // U plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[0]);
-    fCohNoiseU.resize(fCohNoiseArrayPoints); 
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseU[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
-    }
-    
-    // V plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[1]);
-    fCohNoiseV.resize(fCohNoiseArrayPoints);
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseV[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
-    }
-
-    // Z plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[2]);
-    fCohNoiseZ.resize(fCohNoiseArrayPoints);
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-
-      generateCoherentNoise(clockData, fCohNoiseZ[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
+    // one waveform per coherent group, shared by all its channels in addNoise
+    fCohNoise.resize(fNCohGroups);
+    for ( unsigned int i=0; i<fNCohGroups; ++i ) {
+      generateCoherentNoise(fCohNoise[i], fCohNoiseHist);
     }
   }
 }
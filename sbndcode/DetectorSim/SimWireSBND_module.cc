@@ -15,6 +15,13 @@
 #include <sstream>
 #include <fstream>
 #include <bitset>
+#include <memory>
+#include <mutex>
+#include <cmath>
+
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
 
 extern "C" {
 #include <sys/types.h>
@@ -23,9 +30,10 @@ extern "C" {
 
 #include "canvas/Utilities/Exception.h"
 #include "art/Framework/Core/ModuleMacros.h"
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ReplicatedProducer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
@@ -42,6 +50,15 @@ extern "C" {
 #include "lardataobj/RawData/TriggerData.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+#include "sbndcode/Utilities/SBNDBatchFFT.h"
+#include "sbndcode/Utilities/Instrumentation.h"
+#include "sbndcode/Utilities/EventPerformance.h"
+#include "sbndcode/Utilities/DiagnosticHist.h"
+#include "sbndcode/Utilities/ChannelDescriptorTable.h"
+#include "sbndcode/Utilities/ReplicaSharedState.h"
+#include "sbndcode/Utilities/ThreadPool.h"
+#include "sbndcode/DetectorSim/RawDigitBlock/RawDigitBlock.h"
 #include "larcore/Geometry/Geometry.h"
 #include "lardataobj/Simulation/sim.h"
 #include "lardataobj/Simulation/SimChannel.h"
@@ -61,28 +78,117 @@ extern "C" {
 #include "CLHEP/Random/RandGaussQ.h"
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/Services/PhiloxRandom.h"
+#include "sbndcode/DetectorSim/ZeroSuppressionSBND.h"
 
 ///Detector simulation of raw signals on wires
 namespace detsim {
 
 // Base class for creation of raw signals on wires.
-class SimWireSBND : public art::EDProducer {
+// art makes one replica of the module for each schedule; the per-event
+// buffers and the pedestal engine belong to the replica, the noise
+// histogram and the access to the noise service are shared (SharedState).
+class SimWireSBND : public art::ReplicatedProducer {
 
 public:
 
-  explicit SimWireSBND(fhicl::ParameterSet const& pset);
+  SimWireSBND(fhicl::ParameterSet const& pset, art::ProcessingFrame const& frame);
   virtual ~SimWireSBND();
 
   // read/write access to event
-  void produce (art::Event& evt);
-  void beginJob();
-  void endJob();
+  void produce (art::Event& evt, art::ProcessingFrame const&) override;
+  void beginJob(art::ProcessingFrame const&) override;
+  void beginRun(art::Run& run, art::ProcessingFrame const&) override;
+  void endJob(art::ProcessingFrame const&) override;
   void reconfigure(fhicl::ParameterSet const& p);
 
 private:
 
-  std::string            fDriftEModuleLabel;///< module making the ionization electrons
+  /// What the replicas of one module label have in common.
+  struct SharedState {
+    TH1D*                      noiseDist = nullptr; ///< distribution of noise counts
+    sbnd::diag::DiagnosticHist noiseDistFills;      ///< per-thread fills of noiseDist, merged at endJob
+    /// The noise services keep the state of the event being simulated
+    /// (random engines, generateNoise() arrays, event stream); events
+    /// needing it take turns
+    std::mutex                 noiseMutex;
+  };
+
+  /// The SimChannel of each channel (nullptr if none), for each input source.
+  using SourceChannels = std::vector<std::vector<const sim::SimChannel*>>;
+
+  /// Digitization settings of one output. The first is the main output,
+  /// from the module parameters; the others come from Variants and share
+  /// with it the reading, projection and convolution of the charge.
+  struct Variant {
+    std::string instance;            ///< instance name of the output ("" for the main one)
+    bool        genNoise = true;     ///< whether noise is added
+    double      chargeScale = 1.;    ///< factor applied to the convoluted charge (gain)
+    float       baselineRMS = 0.;    ///< ADC value of baseline RMS within each channel
+    float       collectionPed = 0.;  ///< ADC value of baseline for collection plane
+    float       inductionPed = 0.;   ///< ADC value of baseline for induction plane
+    float       collectionSat = 0.;  ///< ADC value of pre-amp saturation for collection plane
+    float       inductionSat = 0.;   ///< ADC value of pre-amp saturation for induction plane
+  };
+
+  /// Output of one variant for the event being simulated: digits or block.
+  struct VariantOutput {
+    std::unique_ptr<std::vector<raw::RawDigit>> digcol;
+    std::unique_ptr<sbnd::RawDigitBlock>        block;
+  };
+
+  /// Buffers of one channel travelling through the parallel pipeline.
+  struct ChannelSlot {
+    raw::ChannelID_t       chan = 0;
+    std::vector<double>    chargeWork;
+    std::vector<float>     noisetmp;
+    float                  ped_mean = 0.;
+    float                  preamp_sat = 0.;
+  };
+
+  /// Parallel version of the channel loop in produce().
+  /// Charge projection, convolution and digitization are spread over
+  /// fNThreads threads, each with its own FFT plans. Noise is generated
+  /// in the parallel stage too if the noise service has per-channel
+  /// streams; otherwise it is drawn in channel order, one block of
+  /// channels at a time. Either way the digits do not depend on the
+  /// number of threads. The charge is convoluted once; noise, pedestal and
+  /// digitization are done for each variant, into the digits or block of
+  /// its output.
+  /// streamKey is the key of the channel noise streams of this event when
+  /// the noise service does not need to be locked (see produce()).
+  void ProcessChannelsParallel(detinfo::DetectorClocksData const& clockData,
+                               SourceChannels const& channels,
+                               std::uint64_t streamKey,
+                               std::vector<VariantOutput>& outputs);
+
+  /// Convolutes the charge of the slots with one batched FFT per view,
+  /// in single precision (see BatchConvolution).
+  void ConvoluteBatch(detinfo::DetectorClocksData const& clockData,
+                      util::SignalShapingServiceSBND const& sss,
+                      std::vector<ChannelSlot*> const& slots,
+                      util::SBNDBatchFFT& fft) const;
+
+  void FillTickTDC(detinfo::DetectorClocksData const& clockData);
+  void FillChargeWork(const sim::SimChannel* sc, std::vector<double>& chargeWork) const;
+  /// Adds the charge of the channel in all the sources; false if it has none.
+  bool FillChargeWork(raw::ChannelID_t chan, SourceChannels const& channels,
+                      std::vector<double>& chargeWork) const;
+  void SetPedestal(Variant const& variant, raw::ChannelID_t chan, float& ped_mean, float& preamp_sat);
+  /// Writes the fNTimeSamples ADC counts of the channel into adc, with the
+  /// charge scaled by chargeScale.
+  void Digitize(std::vector<double> const& chargeWork, std::vector<float> const& noisetmp,
+                double chargeScale, float ped_mean, float preamp_sat, short* adc) const;
+  void FillNoiseDist(std::vector<float> const& noisetmp);
+  void CompressDigit(raw::ChannelID_t chan, float ped_mean, std::vector<short>& adcvec) const;
+
+  std::vector<std::string> fDriftEModuleLabels;///< modules making the ionization electrons, summed per channel
+  bool                   fDropInputProducts;///< remove the SimChannels from the event once digitized
   raw::Compress_t        fCompression;      ///< compression type to use
+  bool                   fOutputBlock;      ///< write one sbnd::RawDigitBlock instead of a RawDigit per channel
+  std::vector<unsigned int> fZSThreshold;   ///< zero suppression threshold above/below pedestal, per plane [ADC]
+  std::vector<unsigned int> fZSPrePad;      ///< samples kept before a sample over threshold, per plane
+  std::vector<unsigned int> fZSPostPad;     ///< samples kept after a sample over threshold, per plane
 
   size_t                 fNTicks;           ///< number of ticks of the clock
   unsigned int           fNTimeSamples;     ///< number of ADC readout samples in all readout frames (per event)
@@ -91,11 +197,27 @@ private:
   float                  fCollectionSat;    ///< ADC value of pre-amp saturation for collection plane
   float                  fInductionSat;     ///< ADC value of pre-amp saturation for induction plane
   float                  fBaselineRMS;      ///< ADC value of baseline RMS within each channel
-  TH1D*                  fNoiseDist;        ///< distribution of noise counts
+  std::shared_ptr<SharedState> fShared;     ///< state common to all the replicas
+  unsigned int           fSchedule;         ///< schedule of this replica
+  unsigned int           fNoiseDistSampling;///< fill the noise histogram every this many ticks (0: no histogram)
   bool                   fGenNoise;         ///< if True -> Gen Noise. if False -> Skip noise generation entierly
+  std::vector<Variant>   fVariants;         ///< the main output, then the variants
+  bool                   fAnyGenNoise;      ///< whether any variant adds noise
   
   art::ServiceHandle<ChannelNoiseService> noiseserv;
 
+  bool                   fUseChannelWorkers;///< Run the channel loop through ProcessChannelsParallel
+  unsigned int           fNThreads;         ///< Threads of the channel workers (0: all available to the job)
+  size_t                 fChannelBlockSize; ///< Channels handled per block by the channel workers
+  bool                   fBatchConvolution; ///< Channel workers convolute their channels by view in batches
+
+  std::vector<int>       fTickTDC;          ///< TDC of each tick of chargeWork, for the current event
+  sbnd::ChannelDescriptorTable fChannelTable;///< status, plane and levels of each channel, for the current run
+
+  std::vector<ChannelSlot> fSlots;          ///< Per-block channel buffers, reused across events
+  tbb::enumerable_thread_specific<std::unique_ptr<util::SBNDFFTWorker>> fFFTWorkers; ///< FFT plans, one per thread
+  tbb::enumerable_thread_specific<std::unique_ptr<util::SBNDBatchFFT>> fBatchFFTs;   ///< batch FFT arenas, one per thread
+
   std::string fTrigModName;                 ///< Trigger data product producer name
   //define max ADC value - if one wishes this can
   //be made a fcl parameter but not likely to ever change
@@ -109,21 +231,45 @@ private:
 DEFINE_ART_MODULE(SimWireSBND)
 
 //-------------------------------------------------
-SimWireSBND::SimWireSBND(fhicl::ParameterSet const& pset)
-  : EDProducer{pset}
+SimWireSBND::SimWireSBND(fhicl::ParameterSet const& pset, art::ProcessingFrame const& frame)
+  : ReplicatedProducer{pset, frame}
+  , fShared(sbnd::ReplicaSharedState<SharedState>(pset.get<std::string>("module_label"),
+                                                  [] { return std::make_shared<SharedState>(); }))
+  , fSchedule(frame.scheduleID().id())
   // create a default random engine; obtain the random seed from NuRandomService,
-  // unless overridden in configuration with key "Seed" and "SeedPedestal"
+  // unless overridden in configuration with key "Seed" and "SeedPedestal".
+  // Each replica has its own engine; the first keeps the single-schedule name.
   //  , fNoiseEngine(art::ServiceHandle<rndm::NuRandomService>{}->createEngine(*this, "HepJamesRandom", "noise", pset, "Seed"))
   , fPedestalEngine(art::ServiceHandle<rndm::NuRandomService>{}->registerAndSeedEngine(
-                      createEngine(0, "HepJamesRandom", "pedestal"), "HepJamesRandom", "pedestal", pset, "SeedPedestal"))
+                      createEngine(0, "HepJamesRandom", "pedestal"), "HepJamesRandom",
+                      fSchedule ? "pedestal" + std::to_string(fSchedule) : std::string("pedestal"),
+                      pset, "SeedPedestal"))
 {
   this->reconfigure(pset);
 
-  produces< std::vector<raw::RawDigit>   >();
+  for (Variant const& variant : fVariants) {
+    if ( fOutputBlock ) produces< sbnd::RawDigitBlock >(variant.instance);
+    else produces< std::vector<raw::RawDigit>   >(variant.instance);
+  }
 
   fCompression = raw::kNone;
   TString compression(pset.get< std::string >("CompressionType"));
-  if (compression.Contains("Huffman", TString::kIgnoreCase)) fCompression = raw::kHuffman;
+  if (compression.Contains("ZeroHuffman", TString::kIgnoreCase)) fCompression = raw::kZeroHuffman;
+  else if (compression.Contains("ZeroSuppression", TString::kIgnoreCase)) fCompression = raw::kZeroSuppression;
+  else if (compression.Contains("Huffman", TString::kIgnoreCase)) fCompression = raw::kHuffman;
+
+  if (fOutputBlock && fCompression != raw::kNone)
+    throw cet::exception("SimWireSBND")
+      << "OutputBlock writes uncompressed digits: CompressionType must be \"none\"\n";
+
+  if (fCompression == raw::kZeroSuppression || fCompression == raw::kZeroHuffman) {
+    fZSThreshold = pset.get< std::vector<unsigned int> >("ZSThreshold");
+    fZSPrePad    = pset.get< std::vector<unsigned int> >("ZSPrePad");
+    fZSPostPad   = pset.get< std::vector<unsigned int> >("ZSPostPad");
+    if (fZSThreshold.size() != 3 || fZSPrePad.size() != 3 || fZSPostPad.size() != 3)
+      throw cet::exception("SimWireSBND")
+        << "ZSThreshold, ZSPrePad and ZSPostPad need one entry per plane (U, V, Z)\n";
+  }
 }
 
 //-------------------------------------------------
@@ -134,7 +280,17 @@ SimWireSBND::~SimWireSBND()
 //-------------------------------------------------
 void SimWireSBND::reconfigure(fhicl::ParameterSet const& p)
 {
-  fDriftEModuleLabel = p.get< std::string         >("DriftEModuleLabel");
+  fDriftEModuleLabels = p.get< std::vector<std::string> >("DriftEModuleLabels", {});
+  if (fDriftEModuleLabels.empty())
+    fDriftEModuleLabels.push_back(p.get< std::string >("DriftEModuleLabel"));
+  // a source listed twice would have its charge counted twice
+  for (auto it = fDriftEModuleLabels.begin(); it != fDriftEModuleLabels.end(); ) {
+    if (std::find(fDriftEModuleLabels.begin(), it, *it) == it) { ++it; continue; }
+    mf::LogWarning("SimWireSBND") << "SimChannel source '" << *it << "' listed more than once, read once";
+    it = fDriftEModuleLabels.erase(it);
+  }
+  fDropInputProducts = p.get< bool                >("DropInputProducts", false);
+  fOutputBlock       = p.get< bool                >("OutputBlock", false);
   fGenNoise          = p.get< bool                >("GenNoise");
   fCollectionPed     = p.get< float               >("CollectionPed",690.);
   fInductionPed      = p.get< float               >("InductionPed",2100.);
@@ -142,6 +298,42 @@ void SimWireSBND::reconfigure(fhicl::ParameterSet const& p)
   fInductionSat      = p.get< float               >("InductionSat",1247.);
   fBaselineRMS       = p.get< float               >("BaselineRMS");
   fTrigModName       = p.get< std::string         >("TrigModName");
+  fUseChannelWorkers = p.get< bool                >("UseChannelWorkers", false);
+  fNThreads          = p.get< unsigned int        >("NThreads", 0);
+  fChannelBlockSize  = p.get< size_t              >("ChannelBlockSize", 256);
+  if (fChannelBlockSize == 0) fChannelBlockSize = 1;
+  fBatchConvolution  = p.get< bool                >("BatchConvolution", false);
+  fNoiseDistSampling = p.get< unsigned int        >("NoiseDistSampling", 100);
+
+  // the main output, then one for each variant; a variant takes the main
+  // settings it does not change
+  fVariants.clear();
+  Variant main;
+  main.genNoise      = fGenNoise;
+  main.baselineRMS   = fBaselineRMS;
+  main.collectionPed = fCollectionPed;
+  main.inductionPed  = fInductionPed;
+  main.collectionSat = fCollectionSat;
+  main.inductionSat  = fInductionSat;
+  fVariants.push_back(main);
+  for (fhicl::ParameterSet const& vp : p.get< std::vector<fhicl::ParameterSet> >("Variants", {})) {
+    Variant variant;
+    variant.instance      = vp.get< std::string >("InstanceName");
+    variant.genNoise      = vp.get< bool        >("GenNoise", main.genNoise);
+    variant.chargeScale   = vp.get< double      >("ChargeScale", main.chargeScale);
+    variant.baselineRMS   = vp.get< float       >("BaselineRMS", main.baselineRMS);
+    variant.collectionPed = vp.get< float       >("CollectionPed", main.collectionPed);
+    variant.inductionPed  = vp.get< float       >("InductionPed", main.inductionPed);
+    variant.collectionSat = vp.get< float       >("CollectionSat", main.collectionSat);
+    variant.inductionSat  = vp.get< float       >("InductionSat", main.inductionSat);
+    for (Variant const& other : fVariants) {
+      if (other.instance == variant.instance)
+        throw cet::exception("SimWireSBND")
+          << "Variant instance name '" << variant.instance << "' is used twice (\"\" is the main output)\n";
+    }
+    fVariants.push_back(variant);
+  }
+  fAnyGenNoise = std::any_of(fVariants.begin(), fVariants.end(), [](Variant const& v) { return v.genNoise; });
 
   //Map the Shaping times to the entry position for the noise ADC
   //level in fNoiseFactInd and fNoiseFactColl
@@ -176,22 +368,33 @@ void SimWireSBND::reconfigure(fhicl::ParameterSet const& p)
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob();
   fNTimeSamples  = detProp.NumberTimeSamples();
 
-  noiseserv->InitialiseProducerDeps([this](std::string const& type, std::string const& instance) -> auto& {
-                                      return createEngine(0, type, instance);
-                                    },
-                                    p);
+  // the noise service is shared by the replicas, and so is its engine
+  if ( fSchedule == 0 ) {
+    noiseserv->InitialiseProducerDeps([this](std::string const& type, std::string const& instance) -> auto& {
+                                        return createEngine(0, type, instance);
+                                      },
+                                      p);
+  }
 
   return;
 }
 
 //-------------------------------------------------
-void SimWireSBND::beginJob()
+void SimWireSBND::beginJob(art::ProcessingFrame const&)
 {
 
   // get access to the TFile service
   art::ServiceHandle<art::TFileService> tfs;
 
-  fNoiseDist  = tfs->make<TH1D>("Noise", ";Noise  (ADC);", 1000,   -10., 10.);
+  // one histogram for all the replicas, made by the first one
+  if ( fSchedule == 0 ) {
+    fShared->noiseDist = nullptr;
+    fShared->noiseDistFills.Reset(0, 0., 0.);
+    if ( fNoiseDistSampling ) {
+      fShared->noiseDist  = tfs->make<TH1D>("Noise", ";Noise  (ADC);", 1000,   -10., 10.);
+      fShared->noiseDistFills.Reset(1000, -10., 10.);
+    }
+  }
 
   art::ServiceHandle<util::LArFFT> fFFT;
   fNTicks = fFFT->FFTSize();
@@ -200,151 +403,460 @@ void SimWireSBND::beginJob()
     MF_LOG_DEBUG("SimWireSBND") << "Warning: FFTSize not a power of 2. "
                               << "May cause issues in (de)convolution.\n";
 
+  // the digitization kernel reads fNTimeSamples ticks of the fNTicks long buffers
   if ( fNTimeSamples > fNTicks )
-    mf::LogError("SimWireSBND") << "Cannot have number of readout samples "
-                                 << "greater than FFTSize!";
+    throw cet::exception("SimWireSBND") << "Cannot have number of readout samples ("
+                                        << fNTimeSamples << ") greater than FFTSize ("
+                                        << fNTicks << ")!\n";
 
   return;
 
 }
 
 //-------------------------------------------------
-void SimWireSBND::endJob()
-{}
+void SimWireSBND::beginRun(art::Run&, art::ProcessingFrame const&)
+{
+  // channel status may change from run to run
+  art::ServiceHandle<geo::Geometry> geo;
+  lariov::ChannelStatusProvider const& channelStatus(art::ServiceHandle<lariov::ChannelStatusService const>()->GetProvider());
+  fChannelTable.Build(*geo, channelStatus);
+  fChannelTable.SetLevels(fCollectionPed, fCollectionSat, fInductionPed, fInductionSat);
+}
+
+//-------------------------------------------------
+void SimWireSBND::endJob(art::ProcessingFrame const&)
+{
+  // the fills of all the replicas are in fShared; the first replica to
+  // get here merges them, and the others find them empty
+  std::lock_guard<std::mutex> lock(fShared->noiseMutex);
+  if ( fShared->noiseDist ) fShared->noiseDistFills.MergeInto(*fShared->noiseDist);
+}
 
-void SimWireSBND::produce(art::Event& evt)
+void SimWireSBND::produce(art::Event& evt, art::ProcessingFrame const&)
 {
-  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+  SBND_INSTR_SCOPE("SimWireSBND::produce");
 
-  //Generate gaussian and coherent noise if doing uBooNE noise model. For other models it does nothing.
-  noiseserv->generateNoise(clockData);
+  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
+  std::uint64_t const eventKey = sbnd::eventStreamKey(evt.run(), evt.subRun(), evt.event());
+
+  // Only keyed channel streams can be drawn for several events at a time;
+  // any other noise generation holds the service for the whole event.
+  bool const lockFreeNoise = fUseChannelWorkers && noiseserv->hasChannelStreams() && !noiseserv->hasEventNoise();
+  std::unique_lock<std::mutex> noiseLock(fShared->noiseMutex, std::defer_lock);
+  if ( fAnyGenNoise && !lockFreeNoise ) {
+    noiseLock.lock();
+    //Generate gaussian and coherent noise if doing uBooNE noise model. For other models it does nothing.
+    noiseserv->generateNoise(clockData);
+    noiseserv->setEventStream(eventKey);
+  }
+  std::uint64_t const streamKey = noiseserv->streamKey(eventKey);
 
-  // get the geometry to be able to figure out signal types and chan -> plane mappings
-  art::ServiceHandle<geo::Geometry> geo;
   //unsigned int signalSize = fNTicks;
   //
-  //Get the channels status
-  lariov::ChannelStatusProvider const& channelStatus(art::ServiceHandle<lariov::ChannelStatusService const>()->GetProvider());
-
-  std::vector<const sim::SimChannel*> chanHandle;
-  evt.getView(fDriftEModuleLabel, chanHandle);
+  // channel status, signal types and planes come from fChannelTable, made in beginRun
+
+  // with DropInputProducts the SimChannels are read through a handle, to
+  // take them out of the event as soon as the digits are made
+  std::vector<art::Handle<std::vector<sim::SimChannel>>> simChannelHandles(fDriftEModuleLabels.size());
+
+  // make, for each source, a vector of const sim::SimChannel* that has same
+  // number of entries as the number of channels in the detector
+  // and set the entries for the channels that have signal on them;
+  // the charge of all the sources is summed channel by channel, so that
+  // beam and cosmic SimChannels need not be merged into a new collection
+  SourceChannels channels(fDriftEModuleLabels.size());
+  size_t nSimChannels = 0;
+  for (size_t iSource = 0; iSource < fDriftEModuleLabels.size(); ++iSource) {
+    std::string const& label = fDriftEModuleLabels[iSource];
+    std::vector<const sim::SimChannel*> chanHandle;
+    if ( fDropInputProducts ) {
+      simChannelHandles[iSource] = evt.getHandle<std::vector<sim::SimChannel>>(label);
+      if ( !simChannelHandles[iSource].isValid() ) {
+        throw cet::exception("SimWireSBND")
+          << "No sim::SimChannel collection from '" << label << "'\n";
+      }
+      for (const sim::SimChannel& sc : *simChannelHandles[iSource]) chanHandle.push_back(&sc);
+    }
+    else {
+      evt.getView(label, chanHandle);
+    }
+    channels[iSource].assign(fChannelTable.size(), nullptr);
+    for (const sim::SimChannel* sc : chanHandle) {
+      channels[iSource].at(sc->Channel()) = sc;
+    }
+    nSimChannels += chanHandle.size();
+  }
+  sbnd::perf::Count("ChannelsWithSignal", nSimChannels);
 
   //Get fIndShape and fColShape from SignalShapingService, on the fly
   art::ServiceHandle<util::SignalShapingServiceSBND> sss;
 
-  // make a vector of const sim::SimChannel* that has same number
-  // of entries as the number of channels in the detector
-  // and set the entries for the channels that have signal on them
-  // using the chanHandle
-  std::vector<const sim::SimChannel*> channels(geo->Nchannels(), nullptr);
-  for (size_t c = 0; c < chanHandle.size(); ++c) {
-    channels.at(chanHandle.at(c)->Channel()) = chanHandle.at(c);
-  }
+  std::vector<raw::ChannelID_t> const& goodChannels = fChannelTable.GoodChannels();
 
-  const auto NChannels = geo->Nchannels();
+  FillTickTDC(clockData);
 
   // vectors for working
   std::vector<short>    adcvec(fNTimeSamples, 0);
   std::vector<double>   chargeWork(fNTicks, 0.);
+  std::vector<float>    noisetmp(fNTicks, 0.);
 
 
 
-  // make a unique_ptr of sim::SimDigits that allows ownership of the produced
-  // digits to be transferred to the art::Event after the put statement below
-  std::unique_ptr< std::vector<raw::RawDigit>> digcol(new std::vector<raw::RawDigit>);
-  digcol->reserve(NChannels);
+  // make unique_ptrs of sim::SimDigits that allow ownership of the produced
+  // digits to be transferred to the art::Event after the put statement below,
+  // one collection for each variant
+  // ... or, with OutputBlock, a single matrix with a row for each good channel
+  std::vector<VariantOutput> outputs(fVariants.size());
+  for (VariantOutput& output : outputs) {
+    if ( fOutputBlock ) {
+      output.block = std::make_unique<sbnd::RawDigitBlock>(goodChannels.size(), fNTimeSamples, true);
+    }
+    else {
+      output.digcol = std::make_unique<std::vector<raw::RawDigit>>();
+      output.digcol->reserve(goodChannels.size());
+    }
+  }
+
+  // the inputs leave the event and the outputs enter it
+  auto const putOutputs = [&]() {
+    if ( fDropInputProducts ) for (auto& handle : simChannelHandles) handle.removeProduct();
+    for (size_t iVariant = 0; iVariant < fVariants.size(); ++iVariant) {
+      VariantOutput& output = outputs[iVariant];
+      if ( output.block ) evt.put(std::move(output.block), fVariants[iVariant].instance);
+      else evt.put(std::move(output.digcol), fVariants[iVariant].instance);
+    }
+  };
 
-  unsigned int chan = 0;
-  art::ServiceHandle<util::LArFFT> fFFT;
-     
-  //LOOP OVER ALL CHANNELS
-  std::map<int, double>::iterator mapIter;
-  for (chan = 0; chan < geo->Nchannels(); chan++) {
+  if ( fUseChannelWorkers ) {
+    ProcessChannelsParallel(clockData, channels, streamKey, outputs);
+    putOutputs();
+    return;
+  }
 
-    if (channelStatus.IsBad(chan)) continue;
+  //LOOP OVER ALL GOOD CHANNELS
+  for (size_t iChan = 0; iChan < goodChannels.size(); ++iChan) {
+    raw::ChannelID_t const chan = goodChannels[iChan];
 
-    // get the sim::SimChannel for this channel
-    const sim::SimChannel* sc = channels.at(chan);
+    // get the charge of the sim::SimChannels for this channel
     std::fill(chargeWork.begin(), chargeWork.end(), 0.);
-    if ( sc ) {
+    if ( FillChargeWork(chan, channels, chargeWork) ) {
 
-      // loop over the tdcs and grab the number of electrons for each
-      for (int t = 0; t < (int)(chargeWork.size()); ++t) {
+      // Convolve charge with appropriate response function
+      sss->Convolute(clockData, chan, chargeWork);
 
-        int tdc = clockData.TPCTick2TDC(t);
+    }
 
-        // continue if tdc < 0
-        if ( tdc < 0 ) continue;
+    // the convoluted charge is digitized with the settings of each variant
+    for (size_t iVariant = 0; iVariant < fVariants.size(); ++iVariant) {
+      Variant const& variant = fVariants[iVariant];
+      VariantOutput& output = outputs[iVariant];
 
-        chargeWork.at(t) = sc->Charge(tdc);
+      std::fill(noisetmp.begin(), noisetmp.end(), 0.);
 
+      // Add noise to channel.
+      if( variant.genNoise ) noiseserv->addNoise(clockData, chan,noisetmp);
+
+      //Pedestal determination
+      float ped_mean, preamp_sat;
+      SetPedestal(variant, chan, ped_mean, preamp_sat);
+
+      if ( iVariant == 0 ) FillNoiseDist(noisetmp);
+
+      // straight into the row of the channel; the sigma is the RawDigit default
+      if ( output.block ) {
+        output.block->SetChannel(iChan, chan);
+        Digitize(chargeWork, noisetmp, variant.chargeScale, ped_mean, preamp_sat, output.block->MutableADCs(iChan));
+        output.block->SetPedestal(iChan, ped_mean, 1.);
+        continue;
       }
 
-      // Convolve charge with appropriate response function
-      sss->Convolute(clockData, chan, chargeWork);
+      adcvec.resize(fNTimeSamples);
+      Digitize(chargeWork, noisetmp, variant.chargeScale, ped_mean, preamp_sat, adcvec.data());
 
-    }
-    std::vector<float> noisetmp(fNTicks, 0.);
-
-    // Add noise to channel.
-    if( fGenNoise ) noiseserv->addNoise(clockData, chan,noisetmp);
-
-    //Pedestal determination
-    float ped_mean = fCollectionPed;
-    float preamp_sat=fCollectionSat;
-    geo::SigType_t sigtype = geo->SignalType(chan);
-    if (sigtype == geo::kInduction) {
-      ped_mean = fInductionPed;
-      preamp_sat = fInductionSat;
-    }
-    //slight variation on ped on order of RMS of baseline variation
-    // (skip this if BaselineRMS = 0 in fhicl)
-    if( fBaselineRMS ) {
-      CLHEP::RandGaussQ rGaussPed(fPedestalEngine, 0.0, fBaselineRMS);
-      ped_mean += rGaussPed.fire();
-    }
+      // resize the adcvec to be the correct number of time samples,
+      // just drop the extra samples
+      //adcvec.resize(fNTimeSamples);
 
-    for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+      // compress the adc vector using the desired compression scheme,
+      // if raw::kNone is selected nothing happens to adcvec
+      // This shrinks adcvec, if fCompression is not kNone.
+      CompressDigit(chan, ped_mean, adcvec);
+      SBND_INSTR_COUNT("SimWireSBND::DigitBytes", adcvec.size() * sizeof(short));
 
-      float chargecontrib = chargeWork.at(i);
-      if (chargecontrib>preamp_sat) chargecontrib=preamp_sat;
+      // add this digit to the collection
+      raw::RawDigit rd(chan, fNTimeSamples, adcvec, fCompression);
+      rd.SetPedestal(ped_mean);
+      output.digcol->push_back(rd);
+    }// end loop over variants
 
-      float adcval = noisetmp.at(i) + chargecontrib + ped_mean;
+  }// end loop over channels
 
-      //Add Noise to NoiseDist Histogram
-      if (i % 100 == 0)
-        fNoiseDist->Fill(noisetmp.at(i));
+  putOutputs();
 
-      //allow for ADC saturation
-      if ( adcval > adcsaturation )
-        adcval = adcsaturation;
-      //don't allow for "negative" saturation
-      if ( adcval < 0 )
-        adcval = 0;
+}//produce()
 
-      adcvec.at(i) = (unsigned short)(adcval+0.5);
+//-------------------------------------------------
+void SimWireSBND::ProcessChannelsParallel(detinfo::DetectorClocksData const& clockData,
+                                          SourceChannels const& channels,
+                                          std::uint64_t streamKey,
+                                          std::vector<VariantOutput>& outputs)
+{
+  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
 
-    }// end loop over signal size
+  // the kernels are built lazily; do it before any worker needs them
+  sss->InitKernels();
+
+  std::vector<raw::ChannelID_t> const& goodChannels = fChannelTable.GoodChannels();
+  for (VariantOutput& output : outputs)
+    if ( !output.block ) output.digcol->resize(goodChannels.size());
+
+  bool const channelStreams = noiseserv->hasChannelStreams();
+
+  fSlots.resize(std::min(fChannelBlockSize, goodChannels.size()));
+
+  sbnd::ThreadPool pool(fNThreads);
+
+  for (size_t first = 0; first < goodChannels.size(); first += fChannelBlockSize) {
+    size_t const nInBlock = std::min(fChannelBlockSize, goodChannels.size() - first);
+
+    // charge projection and convolution, shared by all the variants
+    pool.Execute([&] {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, nInBlock), [&](tbb::blocked_range<size_t> const& range) {
+        auto& fft = fFFTWorkers.local();
+        if (!fft) fft = std::make_unique<util::SBNDFFTWorker>(fNTicks);
+
+        std::vector<ChannelSlot*> withCharge;
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+          ChannelSlot& slot = fSlots[i];
+          slot.chan = goodChannels[first + i];
+          slot.chargeWork.assign(fNTicks, 0.);
+          if ( !FillChargeWork(slot.chan, channels, slot.chargeWork) ) continue;
+          if ( fBatchConvolution ) withCharge.push_back(&slot);
+          else sss->Convolute(clockData, slot.chan, slot.chargeWork, *fft);
+        }
+        if ( !withCharge.empty() ) {
+          auto& batch = fBatchFFTs.local();
+          if (!batch) batch = std::make_unique<util::SBNDBatchFFT>(fNTicks);
+          ConvoluteBatch(clockData, *sss, withCharge, *batch);
+        }
+      });
+    });
+
+    for (size_t iVariant = 0; iVariant < fVariants.size(); ++iVariant) {
+      Variant const& variant = fVariants[iVariant];
+      VariantOutput& output = outputs[iVariant];
+      bool const parallelNoise = variant.genNoise && channelStreams;
+
+      // noise from the channel streams
+      if ( parallelNoise ) {
+        pool.Execute([&] {
+          tbb::parallel_for(tbb::blocked_range<size_t>(0, nInBlock), [&](tbb::blocked_range<size_t> const& range) {
+            auto& fft = fFFTWorkers.local();
+            if (!fft) fft = std::make_unique<util::SBNDFFTWorker>(fNTicks);
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+              ChannelSlot& slot = fSlots[i];
+              slot.noisetmp.assign(fNTicks, 0.);
+              noiseserv->addChannelNoise(clockData, streamKey, slot.chan, slot.noisetmp, *fft);
+            }
+          });
+        });
+      }
 
-    // resize the adcvec to be the correct number of time samples,
-    // just drop the extra samples
-    //adcvec.resize(fNTimeSamples);
+      // pedestal fluctuations, and noise without channel streams, use shared engines: keep the channel order
+      for (size_t i = 0; i < nInBlock; ++i) {
+        ChannelSlot& slot = fSlots[i];
+        if ( !parallelNoise ) {
+          slot.noisetmp.assign(fNTicks, 0.);
+          if( variant.genNoise ) noiseserv->addNoise(clockData, slot.chan, slot.noisetmp);
+        }
+        SetPedestal(variant, slot.chan, slot.ped_mean, slot.preamp_sat);
+      }
 
-    // compress the adc vector using the desired compression scheme,
-    // if raw::kNone is selected nothing happens to adcvec
-    // This shrinks adcvec, if fCompression is not kNone.
-    raw::Compress(adcvec, fCompression);
+      // digitization, straight into the output slots
+      pool.Execute([&] {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nInBlock), [&](tbb::blocked_range<size_t> const& range) {
+          for (size_t i = range.begin(); i != range.end(); ++i) {
+            ChannelSlot const& slot = fSlots[i];
+            if ( iVariant == 0 ) FillNoiseDist(slot.noisetmp);
+            if ( output.block ) {
+              output.block->SetChannel(first + i, slot.chan);
+              Digitize(slot.chargeWork, slot.noisetmp, variant.chargeScale, slot.ped_mean, slot.preamp_sat,
+                       output.block->MutableADCs(first + i));
+              output.block->SetPedestal(first + i, slot.ped_mean, 1.);
+              continue;
+            }
+            std::vector<short> adcvec(fNTimeSamples, 0);
+            Digitize(slot.chargeWork, slot.noisetmp, variant.chargeScale, slot.ped_mean, slot.preamp_sat, adcvec.data());
+            CompressDigit(slot.chan, slot.ped_mean, adcvec);
+            SBND_INSTR_COUNT("SimWireSBND::DigitBytes", adcvec.size() * sizeof(short));
+
+            raw::RawDigit& rd = (*output.digcol)[first + i];
+            rd = raw::RawDigit(slot.chan, fNTimeSamples, std::move(adcvec), fCompression);
+            rd.SetPedestal(slot.ped_mean);
+          }
+        });
+      });
+    } // for variants
+  }
+}
 
-    // add this digit to the collection
-    raw::RawDigit rd(chan, fNTimeSamples, adcvec, fCompression);
-    rd.SetPedestal(ped_mean);
-    digcol->push_back(rd);
+//-------------------------------------------------
+void SimWireSBND::ConvoluteBatch(detinfo::DetectorClocksData const& clockData,
+                                 util::SignalShapingServiceSBND const& sss,
+                                 std::vector<ChannelSlot*> const& slots,
+                                 util::SBNDBatchFFT& fft) const
+{
+  SBND_INSTR_SCOPE("SimWireSBND::ConvoluteBatch");
+
+  // the channels of a view share the response, so each view is one
+  // matrix of rows for the batch FFT; channels with little charge are
+  // convoluted directly instead, when the service is configured for it
+  std::vector<ChannelSlot*> rows;
+  std::vector<ChannelSlot*> dense;
+  dense.reserve(slots.size());
+  for (ChannelSlot* slot : slots)
+    if ( !sss.ConvoluteDirect(clockData, slot->chan, slot->chargeWork) ) dense.push_back(slot);
+  for (geo::View_t view : { geo::kU, geo::kV, geo::kZ }) {
+    rows.clear();
+    for (ChannelSlot* slot : dense)
+      if ( sss.ChannelView(slot->chan) == view ) rows.push_back(slot);
+    if ( rows.empty() ) continue;
+
+    float* data = fft.Rows(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r)
+      std::copy(rows[r]->chargeWork.begin(), rows[r]->chargeWork.end(), data + r*fNTicks);
+    sss.Convolute(clockData, view, data, rows.size(), fft);
+    for (size_t r = 0; r < rows.size(); ++r)
+      std::copy(data + r*fNTicks, data + (r + 1)*fNTicks, rows[r]->chargeWork.begin());
+  }
+}
 
-  }// end loop over channels
+//-------------------------------------------------
+void SimWireSBND::FillTickTDC(detinfo::DetectorClocksData const& clockData)
+{
+  // TPCTick2TDC grows with the tick, so the table is sorted
+  fTickTDC.resize(fNTicks);
+  for (size_t t = 0; t < fNTicks; ++t)
+    fTickTDC[t] = clockData.TPCTick2TDC(t);
+}
 
-  evt.put(std::move(digcol));
+//-------------------------------------------------
+void SimWireSBND::FillChargeWork(const sim::SimChannel* sc, std::vector<double>& chargeWork) const
+{
+  SBND_INSTR_SCOPE("SimWireSBND::FillChargeWork");
 
-}//produce()
+  // walk the TDCs with deposits and add their charge to the ticks
+  // reading them out; the TDCs are sorted, so the search through the tick
+  // table resumes where the previous one stopped. Ticks with a negative
+  // TDC never match and are left empty.
+  auto tick = fTickTDC.cbegin();
+  for (auto const& tdcide : sc->TDCIDEMap()) {
+
+    int const tdc = tdcide.first;
+    tick = std::lower_bound(tick, fTickTDC.cend(), tdc);
+    if ( tick == fTickTDC.cend() ) break;
+    if ( *tick != tdc ) continue;
+
+    double charge = 0.;
+    for (auto const& ide : tdcide.second) charge += ide.numElectrons;
+
+    for (auto t = tick; t != fTickTDC.cend() && *t == tdc; ++t)
+      chargeWork[t - fTickTDC.cbegin()] += charge;
+
+  }
+}
+
+//-------------------------------------------------
+bool SimWireSBND::FillChargeWork(raw::ChannelID_t chan, SourceChannels const& channels,
+                                 std::vector<double>& chargeWork) const
+{
+  bool hasCharge = false;
+  for (auto const& sourceChannels : channels) {
+    const sim::SimChannel* sc = sourceChannels[chan];
+    if ( !sc ) continue;
+    FillChargeWork(sc, chargeWork);
+    hasCharge = true;
+  }
+  return hasCharge;
+}
+
+//-------------------------------------------------
+void SimWireSBND::SetPedestal(Variant const& variant, raw::ChannelID_t chan, float& ped_mean, float& preamp_sat)
+{
+  // the levels of the signal type of the channel, as in fChannelTable for
+  // the main output
+  bool const induction = (fChannelTable[chan].sigType == geo::kInduction);
+  ped_mean = induction ? variant.inductionPed : variant.collectionPed;
+  preamp_sat = induction ? variant.inductionSat : variant.collectionSat;
+  //slight variation on ped on order of RMS of baseline variation
+  // (skip this if BaselineRMS = 0 in fhicl)
+  if( variant.baselineRMS ) {
+    CLHEP::RandGaussQ rGaussPed(fPedestalEngine, 0.0, variant.baselineRMS);
+    ped_mean += rGaussPed.fire();
+  }
+}
+
+//-------------------------------------------------
+void SimWireSBND::Digitize(std::vector<double> const& chargeWork, std::vector<float> const& noisetmp,
+                           double chargeScale, float ped_mean, float preamp_sat, short* __restrict__ adc) const
+{
+  SBND_INSTR_SCOPE("SimWireSBND::Digitize");
+
+  // plain contiguous arrays and select-only clamps, so that the loop vectorizes;
+  // both inputs hold fNTicks >= fNTimeSamples samples (checked in beginJob)
+  double const* __restrict__ charge = chargeWork.data();
+  float const* __restrict__ noise = noisetmp.data();
+  int const adcmax = (int) adcsaturation;
+
+  for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+
+    // a scale of 1 leaves the charge exactly as it is
+    float chargecontrib = (float) (charge[i] * chargeScale);
+    chargecontrib = chargecontrib > preamp_sat ? preamp_sat : chargecontrib;
+
+    // rounding before the clamps gives the same counts as clamping the
+    // float value, and keeps the clamps in integer arithmetic
+    int adcval = (int)(noise[i] + chargecontrib + ped_mean + 0.5f);
+
+    //allow for ADC saturation
+    adcval = adcval > adcmax ? adcmax : adcval;
+    //don't allow for "negative" saturation
+    adcval = adcval < 0 ? 0 : adcval;
+
+    adc[i] = (short) adcval;
+
+  }// end loop over signal size
+}
+
+//-------------------------------------------------
+void SimWireSBND::CompressDigit(raw::ChannelID_t chan, float ped_mean, std::vector<short>& adcvec) const
+{
+  SBND_INSTR_SCOPE("SimWireSBND::CompressDigit");
+
+  if (fCompression == raw::kZeroSuppression || fCompression == raw::kZeroHuffman) {
+    // per-plane thresholds relative to this channel's pedestal, which
+    // raw::Uncompress puts back in the suppressed samples
+    size_t const plane = fChannelTable[chan].plane;
+    sbnd::ZeroSuppress(adcvec, std::lround(ped_mean),
+                       fZSThreshold[plane], fZSPrePad[plane], fZSPostPad[plane]);
+    if (fCompression == raw::kZeroHuffman) raw::CompressHuffman(adcvec);
+  }
+  else {
+    raw::Compress(adcvec, fCompression);
+  }
+}
+
+//-------------------------------------------------
+void SimWireSBND::FillNoiseDist(std::vector<float> const& noisetmp)
+{
+  //Add Noise to NoiseDist Histogram, one tick every fNoiseDistSampling;
+  // the fills go to per-thread bins, so the channel workers and the
+  // other replicas can call this
+  sbnd::diag::DiagnosticHist& fills = fShared->noiseDistFills;
+  if ( !fills.Enabled() ) return;
+  for (unsigned int i = 0; i < fNTimeSamples; i += fNoiseDistSampling)
+    fills.Fill(noisetmp[i]);
+}
 
 
 
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////
+//
+// ZeroSuppressionSBND.h
+//
+// Zero suppression of simulated TPC waveforms with a threshold relative
+// to the channel pedestal and asymmetric padding around the kept samples.
+// The output uses the raw::kZeroSuppression layout, so it is read back
+// by raw::Uncompress (with the pedestal filling the suppressed samples):
+//
+//   [ number of samples, number of blocks,
+//     first tick of each block..., size of each block...,
+//     samples of all blocks... ]
+//
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_DETECTORSIM_ZEROSUPPRESSIONSBND_H
+#define SBNDCODE_DETECTORSIM_ZEROSUPPRESSIONSBND_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace sbnd {
+
+  // Keep the samples with |adc - pedestal| > threshold, plus prePad samples
+  // before and postPad samples after each of them. adc is replaced by the
+  // zero-suppressed vector.
+  inline void ZeroSuppress(std::vector<short>& adc, int pedestal, unsigned int threshold,
+                           unsigned int prePad, unsigned int postPad)
+  {
+    size_t const nSamples = adc.size();
+
+    // blocks as [begin, end) tick ranges; overlapping or touching ranges are merged
+    std::vector<std::pair<size_t, size_t>> blocks;
+    size_t nKept = 0;
+    for (size_t tick = 0; tick < nSamples; ++tick) {
+      if (std::abs(adc[tick] - pedestal) <= (int) threshold) continue;
+
+      size_t const begin = tick > prePad ? tick - prePad : 0;
+      size_t const end = std::min(nSamples, tick + postPad + 1);
+      if (!blocks.empty() && begin <= blocks.back().second) {
+        nKept += end - std::max(begin, blocks.back().second);
+        blocks.back().second = std::max(blocks.back().second, end);
+      }
+      else {
+        blocks.emplace_back(begin, end);
+        nKept += end - begin;
+      }
+    }
+
+    std::vector<short> suppressed;
+    suppressed.reserve(2 + 2*blocks.size() + nKept);
+    suppressed.push_back(nSamples);
+    suppressed.push_back(blocks.size());
+    for (auto const& block : blocks) suppressed.push_back(block.first);
+    for (auto const& block : blocks) suppressed.push_back(block.second - block.first);
+    for (auto const& block : blocks)
+      suppressed.insert(suppressed.end(), adc.begin() + block.first, adc.begin() + block.second);
+
+    adc.swap(suppressed);
+  }
+
+}
+
+#endif // SBNDCODE_DETECTORSIM_ZEROSUPPRESSIONSBND_H
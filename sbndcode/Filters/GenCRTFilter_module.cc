@@ -1,5 +1,7 @@
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <string>
 
 #include "TGeoManager.h"
 
@@ -7,6 +9,7 @@
 #include "art/Framework/Core/ModuleMacros.h" 
 #include "art/Framework/Principal/Event.h" 
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "cetlib_except/exception.h"
 #include "larcore/Geometry/Geometry.h"
 #include "larcore/CoreUtils/ServiceUtil.h" // lar::providerFrom()
 #include "larcorealg/Geometry/GeometryCore.h"
@@ -14,6 +17,8 @@
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 
+#include "sbndcode/CRT/CRTUtils/CRTModuleBoxes.h"
+
 namespace filt{
 
   class GenFilter : public art::EDFilter {
@@ -22,16 +27,23 @@ namespace filt{
       virtual bool filter(art::Event& e) override;
       void reconfigure(fhicl::ParameterSet const& pset);
       virtual void beginJob() override;
+      virtual void endJob() override;
 
     private:
 
-      std::vector<unsigned int> fTopHighCRTAuxDetIDs; 
-      std::vector<unsigned int> fTopLowCRTAuxDetIDs; 
-      std::vector<unsigned int> fBottomCRTAuxDetIDs; 
-      std::vector<unsigned int> fFrontCRTAuxDetIDs; 
-      std::vector<unsigned int> fBackCRTAuxDetIDs; 
-      std::vector<unsigned int> fLeftCRTAuxDetIDs; 
-      std::vector<unsigned int> fRightCRTAuxDetIDs; 
+      // A CRT tagger the particle has to cross
+      struct RequiredTagger {
+        std::string name;
+        sbnd::crt::CRTModuleBoxes const* boxes;
+      };
+
+      sbnd::crt::CRTModuleBoxes fTopHighCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fTopLowCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fBottomCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fFrontCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fBackCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fLeftCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fRightCRTBoxes;
 
       bool fUseTopHighCRTs; 
       bool fUseTopLowCRTs; 
@@ -46,6 +58,11 @@ namespace filt{
       double fCRTDimensionScaling;
       bool fUseReadoutWindow;
       bool fUseTightReadoutWindow;
+      std::vector<std::string> fTaggerOrder;
+
+      std::vector<RequiredTagger> fRequiredTaggers; // in the order of the exact checks
+      std::vector<geo::AuxDetGeo const*> fAuxDets;  // by AuxDet ID
+      std::array<unsigned long, 5> fRejected{};     // particles rejected at each step of the cascade
     
       geo::GeometryCore const* fGeometryService;
       double readoutWindow;
@@ -53,8 +70,9 @@ namespace filt{
 
       bool IsInterestingParticle(const simb::MCParticle &particle);
       void LoadCRTAuxDetIDs();
-      bool UsesCRTAuxDets(const simb::MCParticle &particle, const std::vector<unsigned int> &crt_auxdet_vector);
-      bool UsesCRTAuxDet(const simb::MCParticle &particle, geo::AuxDetGeo const& crt);
+      void OrderRequiredTaggers();
+      bool UsesCRTAuxDets(const geo::Point_t &position, const geo::Vector_t &direction, const sbnd::crt::CRTModuleBoxes &crt_boxes);
+      bool UsesCRTAuxDet(const geo::Point_t &position, const geo::Vector_t &direction, geo::AuxDetGeo const& crt);
       bool RayIntersectsBox(TVector3 ray_origin, TVector3 ray_direction, TVector3 box_min_extent, TVector3 box_max_extent);
       std::pair<double, double> XLimitsTPC(const simb::MCParticle &particle);
       std::pair<TVector3, TVector3> CubeIntersection(TVector3 min, TVector3 max, TVector3 start, TVector3 end);
@@ -94,6 +112,7 @@ namespace filt{
     fCRTDimensionScaling = pset.get<double>("CRTDimensionScaling");
     fUseReadoutWindow = pset.get<bool>("UseReadoutWindow");
     fUseTightReadoutWindow = pset.get<bool>("UseTightReadoutWindow");
+    fTaggerOrder = pset.get<std::vector<std::string> >("TaggerOrder", {});
   }
 
 
@@ -102,18 +121,36 @@ namespace filt{
 
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e);
 
+    // The checks run from the cheapest to the most expensive, and the event
+    // is accepted by the first particle passing all of them:
+    //  1. PDG and momentum
+    //  2. time of the particle against the readout window
+    //  3. the ray against the box around each required tagger
+    //  4. the TPC crossing times against the readout window
+    //  5. the ray against the modules of each required tagger, exactly
     for (unsigned int i = 0; i < mclists.size() ; i++){
       for (simb::MCTruth const& mc_truth : *mclists[i]) {
         // std::cout << " MCtruth particles " << mc_truth.NParticles() << std::endl;
         for (int part = 0; part < mc_truth.NParticles(); part++){
-          const simb::MCParticle particle = mc_truth.GetParticle(part);
+          const simb::MCParticle& particle = mc_truth.GetParticle(part);
 
-          if (!IsInterestingParticle(particle)) continue;
+          if (!IsInterestingParticle(particle)) { ++fRejected[0]; continue; }
 
           double time = particle.T() * 1e-3; //[us]
 
+          if (fUseReadoutWindow && (time < -driftTime || time > readoutWindow)) { ++fRejected[1]; continue; }
+          if (fUseTightReadoutWindow && (time<0 || time>(readoutWindow-driftTime))) { ++fRejected[1]; continue; }
+
+          auto const position = geo::vect::toPoint(particle.Position(0).Vect());
+          auto const direction = geo::vect::toVector(particle.Momentum(0).Vect().Unit());
+
+          bool crossesTaggers = true;
+          for (RequiredTagger const& tagger : fRequiredTaggers){
+            if (!tagger.boxes->RayMayCross(position, direction)) { crossesTaggers = false; break; }
+          }
+          if (!crossesTaggers) { ++fRejected[2]; continue; }
+
           if (fUseReadoutWindow){
-            if (time < -driftTime || time > readoutWindow) continue;
             // Get the minimum and maximum |x| position in the TPC
             std::pair<double, double> xLimits = XLimitsTPC(particle);
             // std::cout << xLimits.first << " " << xLimits.second << std::endl;
@@ -121,48 +158,13 @@ namespace filt{
             double minTime = time + (2.0 * fGeometryService->DetHalfWidth() - xLimits.second)/detProp.DriftVelocity();
             double maxTime = time + (2.0 * fGeometryService->DetHalfWidth() - xLimits.first)/detProp.DriftVelocity();
             // If both times are below or above the readout window time then skip
-            if((minTime < 0 && maxTime < 0) || (minTime > readoutWindow && maxTime > readoutWindow)) continue;
-          }
-          if (fUseTightReadoutWindow) {
-            if (time<0 || time>(readoutWindow-driftTime)) continue;
+            if((minTime < 0 && maxTime < 0) || (minTime > readoutWindow && maxTime > readoutWindow)) { ++fRejected[3]; continue; }
           }
 
-          if (fUseTopHighCRTs){
-            bool OK = UsesCRTAuxDets(particle, fTopHighCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"TopHighCRTs: " << OK << std::endl;
-          }
-          if (fUseTopLowCRTs){
-            bool OK = UsesCRTAuxDets(particle, fTopLowCRTAuxDetIDs);
-            if (!OK) continue;
-
-            //std::cout<<"TopLowCRTs: " << OK << std::endl;
-          }
-          if (fUseBottomCRTs){
-            bool OK = UsesCRTAuxDets(particle, fBottomCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"BottomCRTs: " << OK << std::endl;
-          }
-          if (fUseFrontCRTs){
-            bool OK = UsesCRTAuxDets(particle, fFrontCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"FrontCRTs: " << OK << std::endl;
-          }
-          if (fUseBackCRTs){
-            bool OK = UsesCRTAuxDets(particle, fBackCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"BackCRTs: " << OK << std::endl;
-          }
-          if (fUseLeftCRTs){
-            bool OK = UsesCRTAuxDets(particle, fLeftCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"LeftCRTs: " << OK << std::endl;
-          }
-          if (fUseRightCRTs){
-            bool OK = UsesCRTAuxDets(particle, fRightCRTAuxDetIDs);
-            if (!OK) continue;
-            //std::cout<<"RightCRTs: " << OK << std::endl;
+          for (RequiredTagger const& tagger : fRequiredTaggers){
+            if (!UsesCRTAuxDets(position, direction, *tagger.boxes)) { crossesTaggers = false; break; }
           }
+          if (!crossesTaggers) { ++fRejected[4]; continue; }
 
           return true;
         }
@@ -175,6 +177,45 @@ namespace filt{
 
   void GenFilter::beginJob() {
     LoadCRTAuxDetIDs();
+    OrderRequiredTaggers();
+  }
+
+
+  void GenFilter::endJob() {
+    std::cout << "GenCRTFilter particles rejected by PDG/momentum: " << fRejected[0]
+              << ", time: " << fRejected[1]
+              << ", tagger boxes: " << fRejected[2]
+              << ", TPC crossing time: " << fRejected[3]
+              << ", tagger modules: " << fRejected[4] << std::endl;
+  }
+
+
+  void GenFilter::OrderRequiredTaggers(){
+    std::vector<RequiredTagger> taggers;
+    if (fUseTopHighCRTs) taggers.push_back({"TopHigh", &fTopHighCRTBoxes});
+    if (fUseTopLowCRTs)  taggers.push_back({"TopLow", &fTopLowCRTBoxes});
+    if (fUseBottomCRTs)  taggers.push_back({"Bottom", &fBottomCRTBoxes});
+    if (fUseFrontCRTs)   taggers.push_back({"Front", &fFrontCRTBoxes});
+    if (fUseBackCRTs)    taggers.push_back({"Back", &fBackCRTBoxes});
+    if (fUseLeftCRTs)    taggers.push_back({"Left", &fLeftCRTBoxes});
+    if (fUseRightCRTs)   taggers.push_back({"Right", &fRightCRTBoxes});
+
+    // By default the taggers with fewer modules, cheaper to check, go first;
+    // TaggerOrder puts the listed ones first, in its order
+    auto rank = [this](RequiredTagger const& tagger){
+      auto const it = std::find(fTaggerOrder.begin(), fTaggerOrder.end(), tagger.name);
+      return std::size_t(it - fTaggerOrder.begin());
+    };
+    for (std::string const& name : fTaggerOrder){
+      if (std::none_of(taggers.begin(), taggers.end(), [&name](RequiredTagger const& tagger){ return tagger.name == name; })){
+        throw cet::exception("GenCRTFilter") << "TaggerOrder: " << name << " is not one of the required taggers\n";
+      }
+    }
+    std::stable_sort(taggers.begin(), taggers.end(), [&rank](RequiredTagger const& a, RequiredTagger const& b){
+      if (rank(a) != rank(b)) return rank(a) < rank(b);
+      return a.boxes->NBoxes() < b.boxes->NBoxes();
+    });
+    fRequiredTaggers = std::move(taggers);
   }
 
 
@@ -199,8 +240,10 @@ namespace filt{
   void GenFilter::LoadCRTAuxDetIDs(){
     art::ServiceHandle<geo::Geometry> geom;
 
+    fAuxDets.resize(geom->NAuxDets());
     for (unsigned int auxdet_i = 0; auxdet_i < geom->NAuxDets(); auxdet_i++){
       geo::AuxDetGeo const& crt = geom->AuxDet(auxdet_i);
+      fAuxDets[auxdet_i] = &crt;
       const TGeoVolume* volModule = crt.TotalVolume();
       std::set<std::string> volNames = { volModule->GetName() };
       std::vector<std::vector<TGeoNode const*> > paths = geom->FindAllVolumePaths(volNames);
@@ -225,25 +268,25 @@ namespace filt{
       //Now a bunch of if statements so that we can fill our CRT AuxDet ID vectors
       //BLEH
       if (taggerName.find("TopHigh")!=std::string::npos){
-        fTopHighCRTAuxDetIDs.push_back(auxdet_i);
+        fTopHighCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("TopLow")!=std::string::npos){
-        fTopLowCRTAuxDetIDs.push_back(auxdet_i);
+        fTopLowCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("Bot")!=std::string::npos){
-        fBottomCRTAuxDetIDs.push_back(auxdet_i);
+        fBottomCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("South")!=std::string::npos){
-        fFrontCRTAuxDetIDs.push_back(auxdet_i);
+        fFrontCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("North")!=std::string::npos){
-        fBackCRTAuxDetIDs.push_back(auxdet_i);
+        fBackCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("West")!=std::string::npos){
-        fLeftCRTAuxDetIDs.push_back(auxdet_i);
+        fLeftCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else if (taggerName.find("East")!=std::string::npos){
-        fRightCRTAuxDetIDs.push_back(auxdet_i);
+        fRightCRTBoxes.AddAuxDet(crt, auxdet_i, fCRTDimensionScaling);
       }
       else {
         std::cout << "Tagger with name: " << taggerName
@@ -251,25 +294,22 @@ namespace filt{
       }
     }
 
-    std::cout<< "No. top high CRT AuxDets found: " << fTopHighCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. top low CRT AuxDets found: " << fTopLowCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. bottom CRT AuxDets found: " << fBottomCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. front CRT AuxDets found: " << fFrontCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. back CRT AuxDets found: " << fBackCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. left CRT AuxDets found: " << fLeftCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. right CRT AuxDets found: " << fRightCRTAuxDetIDs.size() << std::endl;
+    std::cout<< "No. top high CRT AuxDets found: " << fTopHighCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. top low CRT AuxDets found: " << fTopLowCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. bottom CRT AuxDets found: " << fBottomCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. front CRT AuxDets found: " << fFrontCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. back CRT AuxDets found: " << fBackCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. left CRT AuxDets found: " << fLeftCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. right CRT AuxDets found: " << fRightCRTBoxes.NBoxes() << std::endl;
     return;
   }
 
 
-  bool GenFilter::UsesCRTAuxDets(const simb::MCParticle &particle, const std::vector<unsigned int> &crt_auxdet_vector){
-    //Loop over the aux dets, extract each one and then perform the test
-    art::ServiceHandle<geo::Geometry> geom;
-
-    for (unsigned int i = 0; i < crt_auxdet_vector.size(); i++){
-      unsigned int auxdet_index = crt_auxdet_vector[i];
-      geo::AuxDetGeo const& crt = geom->AuxDet(auxdet_index);
-      if (UsesCRTAuxDet(particle,crt)){
+  bool GenFilter::UsesCRTAuxDets(const geo::Point_t &position, const geo::Vector_t &direction, const sbnd::crt::CRTModuleBoxes &crt_boxes){
+    //Only run the exact test on the aux dets whose world bounding boxes are crossed by the particle's ray
+    for (unsigned int auxdet_index : crt_boxes.RayCandidates(position, direction)){
+      geo::AuxDetGeo const& crt = *fAuxDets[auxdet_index];
+      if (UsesCRTAuxDet(position,direction,crt)){
         return true;
       }
     }
@@ -277,13 +317,11 @@ namespace filt{
     return false;
   }
 
-  bool GenFilter::UsesCRTAuxDet(const simb::MCParticle &particle, geo::AuxDetGeo const& crt){
+  bool GenFilter::UsesCRTAuxDet(const geo::Point_t &position, const geo::Vector_t &direction, geo::AuxDetGeo const& crt){
     //We need to prepare the particle's position and direction and construct a bounding box from the CRT for the ray-box collision algorithm
     //Start with the particle
-    auto const position = particle.Position(0).Vect();
-    auto const momentum_dir = particle.Momentum(0).Vect().Unit();
-    auto const particle_local_position_array = crt.toLocalCoords(geo::vect::toPoint(position));
-    auto const particle_local_direction_array = crt.toLocalCoords(geo::vect::toVector(momentum_dir));
+    auto const particle_local_position_array = crt.toLocalCoords(position);
+    auto const particle_local_direction_array = crt.toLocalCoords(direction);
     TVector3 particle_local_position(particle_local_position_array.X(),
                                      particle_local_position_array.Y(),
                                      particle_local_position_array.Z());
@@ -16,6 +16,8 @@
 #include "larcore/Geometry/AuxDetGeometry.h"
 #include "nusimdata/SimulationBase/MCTruth.h"
 
+#include "sbndcode/CRT/CRTUtils/CRTModuleBoxes.h"
+
 namespace filt{
 
   class LArG4CRTFilter : public art::EDFilter {
@@ -27,13 +29,13 @@ namespace filt{
 
     private:
 
-      std::vector<unsigned int> fTopHighCRTAuxDetIDs; 
-      std::vector<unsigned int> fTopLowCRTAuxDetIDs; 
-      std::vector<unsigned int> fBottomCRTAuxDetIDs; 
-      std::vector<unsigned int> fFrontCRTAuxDetIDs; 
-      std::vector<unsigned int> fBackCRTAuxDetIDs; 
-      std::vector<unsigned int> fLeftCRTAuxDetIDs; 
-      std::vector<unsigned int> fRightCRTAuxDetIDs; 
+      sbnd::crt::CRTModuleBoxes fTopHighCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fTopLowCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fBottomCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fFrontCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fBackCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fLeftCRTBoxes;
+      sbnd::crt::CRTModuleBoxes fRightCRTBoxes;
 
       bool fUseTopHighCRTs; 
       bool fUseTopLowCRTs; 
@@ -56,7 +58,7 @@ namespace filt{
       
       bool IsInterestingParticle(const simb::MCParticle& particle);
       void LoadCRTAuxDetIDs();
-      bool UsesCRTAuxDets(const simb::MCParticle& particle, const std::vector<unsigned int> &crt_auxdet_vector);
+      bool UsesCRTAuxDets(const simb::MCParticle& particle, const sbnd::crt::CRTModuleBoxes &crt_boxes);
       bool EntersTPC(const simb::MCParticle& particle);
       std::pair<double, double> XLimitsTPC(const simb::MCParticle& particle);
   };
@@ -126,37 +128,37 @@ namespace filt{
       }
       if (fUseTPC && !EntersTPC(particle)) continue;
       if (fUseTopHighCRTs){
-        bool OK = UsesCRTAuxDets(particle,fTopHighCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fTopHighCRTBoxes);
         if (!OK) continue;
         //std::cout<<"TopHighCRTs: " << OK << std::endl;
       }
       if (fUseTopLowCRTs){
-        bool OK = UsesCRTAuxDets(particle,fTopLowCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fTopLowCRTBoxes);
         if (!OK) continue;
         //std::cout<<"TopLowCRTs: " << OK << std::endl;
       }
       if (fUseBottomCRTs){
-        bool OK = UsesCRTAuxDets(particle,fBottomCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fBottomCRTBoxes);
         if (!OK) continue;
         //std::cout<<"BottomCRTs: " << OK << std::endl;
       }
       if (fUseFrontCRTs){
-        bool OK = UsesCRTAuxDets(particle,fFrontCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fFrontCRTBoxes);
         if (!OK) continue;
         //std::cout<<"FrontCRTs: " << OK << std::endl;
       }
       if (fUseBackCRTs){
-        bool OK = UsesCRTAuxDets(particle,fBackCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fBackCRTBoxes);
         if (!OK) continue;
         //std::cout<<"BackCRTs: " << OK << std::endl;
       }
       if (fUseLeftCRTs){
-        bool OK = UsesCRTAuxDets(particle,fLeftCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fLeftCRTBoxes);
         if (!OK) continue;
         //std::cout<<"LeftCRTs: " << OK << std::endl;
       }
       if (fUseRightCRTs){
-        bool OK = UsesCRTAuxDets(particle,fRightCRTAuxDetIDs);
+        bool OK = UsesCRTAuxDets(particle,fRightCRTBoxes);
         if (!OK) continue;
         //std::cout<<"RightCRTs: " << OK << std::endl;
       }
@@ -220,25 +222,25 @@ namespace filt{
       //Now a bunch of if statements so that we can fill our CRT AuxDet ID vectors
       //BLEH
       if (taggerName.find("TopHigh")!=std::string::npos){
-        fTopHighCRTAuxDetIDs.push_back(auxdet_i);
+        fTopHighCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("TopLow")!=std::string::npos){
-        fTopLowCRTAuxDetIDs.push_back(auxdet_i);
+        fTopLowCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("Bot")!=std::string::npos){
-        fBottomCRTAuxDetIDs.push_back(auxdet_i);
+        fBottomCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("South")!=std::string::npos){
-        fFrontCRTAuxDetIDs.push_back(auxdet_i);
+        fFrontCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("North")!=std::string::npos){
-        fBackCRTAuxDetIDs.push_back(auxdet_i);
+        fBackCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("West")!=std::string::npos){
-        fLeftCRTAuxDetIDs.push_back(auxdet_i);
+        fLeftCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else if (taggerName.find("East")!=std::string::npos){
-        fRightCRTAuxDetIDs.push_back(auxdet_i);
+        fRightCRTBoxes.AddAuxDet(crt, auxdet_i);
       }
       else {
         std::cout << "Tagger with name: " << taggerName
@@ -246,18 +248,18 @@ namespace filt{
       }
     }
 
-    std::cout<< "No. top high CRT AuxDets found: " << fTopHighCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. top low CRT AuxDets found: " << fTopLowCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. bottom CRT AuxDets found: " << fBottomCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. front CRT AuxDets found: " << fFrontCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. back CRT AuxDets found: " << fBackCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. left CRT AuxDets found: " << fLeftCRTAuxDetIDs.size() << std::endl;
-    std::cout<< "No. right CRT AuxDets found: " << fRightCRTAuxDetIDs.size() << std::endl;
+    std::cout<< "No. top high CRT AuxDets found: " << fTopHighCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. top low CRT AuxDets found: " << fTopLowCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. bottom CRT AuxDets found: " << fBottomCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. front CRT AuxDets found: " << fFrontCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. back CRT AuxDets found: " << fBackCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. left CRT AuxDets found: " << fLeftCRTBoxes.NBoxes() << std::endl;
+    std::cout<< "No. right CRT AuxDets found: " << fRightCRTBoxes.NBoxes() << std::endl;
     return;
   }
 
 
-  bool LArG4CRTFilter::UsesCRTAuxDets(const simb::MCParticle& particle, const std::vector<unsigned int> &crt_auxdet_vector){
+  bool LArG4CRTFilter::UsesCRTAuxDets(const simb::MCParticle& particle, const sbnd::crt::CRTModuleBoxes &crt_boxes){
     //Loop over the aux dets, extract each one and then perform the test
     art::ServiceHandle<geo::Geometry> geom;
     //art:: ServiceHandle <geo:: AuxDetGeometry > adGeoService;
@@ -272,25 +274,18 @@ namespace filt{
       geo::Point_t const position{position_lvector.X(),
                                   position_lvector.Y(),
                                   position_lvector.Z()};
+      //Points outside the bounding boxes of the CRTs we are interested in cannot be in one of them, so skip the geometry lookup
+      if (!crt_boxes.MayContain(position)) continue;
       //The find the auxdet function throws a wobbler (an exception) if it can't find an auxdet.  Wrap what we want to do in a try catch statement pair
       try{
         unsigned int crt_id = geom->FindAuxDetAtPosition(position);
         //size_t adID , svID;
         //adGeoCore ->PositionToAuxDetChannel(position , adID , svID);
         //So we got an ID.  Lets compare it to all of the CRT IDs we are interested in
-        for (unsigned int crt_i = 0; crt_i < crt_auxdet_vector.size(); crt_i++){
-          if (crt_id == crt_auxdet_vector[crt_i]){
-          //if (adID == crt_auxdet_vector[crt_i]){
-            /*
-            std::cout<<"Hit a CRT we wanted: DUMPING" <<std::endl;
-            for (unsigned int i = 0; i < particle.NumberTrajectoryPoints(); i++){
-              particle.Position(i).Print();
-            }
-            */
-            //We found a CRT that we are interested in at this poisition!!!
-            //We can leave now
-            return true;
-          }
+        if (crt_boxes.HasAuxDet(crt_id)){
+          //We found a CRT that we are interested in at this poisition!!!
+          //We can leave now
+          return true;
         }
       }
       catch(...){}; //no CRT here, move along
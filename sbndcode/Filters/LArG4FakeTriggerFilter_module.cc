@@ -29,6 +29,9 @@ namespace filt{
 
       geo::GeometryCore const* fGeometryService;
 
+      // TPC volume the energy is counted in [cm], from the geometry at beginJob
+      double fXMin, fXMax, fYMin, fYMax, fZMin, fZMax;
+
       bool IsInterestingParticle(const simb::MCParticle& particle);
       double EnergyInTPC(const simb::MCParticle& particle);
   };
@@ -59,6 +62,7 @@ namespace filt{
     auto const& particles = e.getProduct<std::vector<simb::MCParticle>>(fLArG4ModuleName);
 
     double e_dep = 0;
+    double const threshold = fEnergyDeposit/1000.; // [GeV]
 
     for (simb::MCParticle const& particle : particles) {
 
@@ -71,15 +75,24 @@ namespace filt{
       
       // Add up the energy deposit inside the TPC
       e_dep += EnergyInTPC(particle); // [GeV]
+
+      // If the energy deposit within the beam time is greater than some limit then trigger the event;
+      // the particles left only lose energy, so they cannot bring the sum back down
+      if (e_dep > threshold) return true;
     }
 
-    // If the energy deposit within the beam time is greater than some limit then trigger the event
-    return e_dep > fEnergyDeposit/1000.;
+    return false;
 
   }
 
 
   void LArG4FakeTriggerFilter::beginJob() {
+    fXMin = -2.0 * fGeometryService->DetHalfWidth();
+    fXMax = 2.0 * fGeometryService->DetHalfWidth();
+    fYMin = -fGeometryService->DetHalfHeight();
+    fYMax = fGeometryService->DetHalfHeight();
+    fZMin = 0.;
+    fZMax = fGeometryService->DetLength();
   }
 
 
@@ -100,21 +113,16 @@ namespace filt{
   // Add up energy deposit in TPC
   double LArG4FakeTriggerFilter::EnergyInTPC(const simb::MCParticle& particle){
 
-    double xmin = -2.0 * fGeometryService->DetHalfWidth();
-    double xmax = 2.0 * fGeometryService->DetHalfWidth();
-    double ymin = -fGeometryService->DetHalfHeight();
-    double ymax = fGeometryService->DetHalfHeight();
-    double zmin = 0.;
-    double zmax = fGeometryService->DetLength();
-
     double e_dep = 0;
 
+    // the trajectory is read in place, point by point, with no copies
+    simb::MCTrajectory const& traj = particle.Trajectory();
     int npts = particle.NumberTrajectoryPoints();
     for (int i = 1; i < npts; i++){
-      TVector3 pos(particle.Vx(i), particle.Vy(i), particle.Vz(i));
+      TLorentzVector const& pos = traj.Position(i);
       // Check if point is within the TPC
-      if (pos[0] >= xmin && pos[0] <= xmax && pos[1] >= ymin && pos[1] <= ymax && pos[2] >= zmin && pos[2] <= zmax){
-        e_dep += particle.E(i-1) - particle.E(i);
+      if (pos.X() >= fXMin && pos.X() <= fXMax && pos.Y() >= fYMin && pos.Y() <= fYMax && pos.Z() >= fZMin && pos.Z() <= fZMax){
+        e_dep += traj.E(i-1) - traj.E(i);
       }
     }
 
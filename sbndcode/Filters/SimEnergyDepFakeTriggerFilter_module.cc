@@ -43,10 +43,14 @@ bool SimEnergyDepFakeTriggerFilter::filter(art::Event& e)
 
     // Add up the energy deposit inside the TPC
     energy += energyDep.Energy(); // [MeV]
+
+    // If the energy deposit within the beam time is greater than some limit then trigger the event;
+    // deposits are never negative, so the rest of them cannot change the decision
+    if (energy > fEnergyDeposit)
+      return true;
   }
 
-  // If the energy deposit within the beam time is greater than some limit then trigger the event
-  return energy > fEnergyDeposit;
+  return false;
 }
 
 DEFINE_ART_MODULE(SimEnergyDepFakeTriggerFilter)
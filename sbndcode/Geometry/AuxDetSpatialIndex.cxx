@@ -0,0 +1,255 @@
+/**
+ * @file   AuxDetSpatialIndex.cxx
+ * @brief  Spatial index over the auxiliary detectors and their sensitive volumes.
+ * @see    AuxDetSpatialIndex.h
+ */
+
+#include "sbndcode/Geometry/AuxDetSpatialIndex.h"
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+  /// Extra padding of the boxes, covering the rounding of the frame transformations [cm]
+  constexpr double kMargin = 1e-3;
+
+  /// Largest number of grid cells along each axis
+  constexpr size_t kMaxCellsPerAxis = 64;
+
+  template <typename Point>
+  double Coord(Point const& p, unsigned int axis)
+    { return (axis == 0)? p.X(): (axis == 1)? p.Y(): p.Z(); }
+
+  /// World coordinates of the corners of the trapezoid of a volume, padded by pad
+  template <typename Geo>
+  std::array<geo::Point_t, 8> PaddedCorners(Geo const& geo, double pad)
+  {
+    double const halfLength = geo.Length()/2 + pad;
+    double const halfHeight = geo.HalfHeight() + pad;
+    double const HalfCenterWidth = 0.5 * (geo.HalfWidth1() + geo.HalfWidth2());
+    double const slope = (HalfCenterWidth - geo.HalfWidth2())/(0.5 * geo.Length());
+
+    std::array<geo::Point_t, 8> corners;
+    size_t i = 0;
+    for (double z: { -halfLength, halfLength }) {
+      // the padded x bounds follow the slanted sides, as the containment test does
+      double const halfWidth = HalfCenterWidth - z*slope + pad;
+      for (double y: { -halfHeight, halfHeight }) {
+        for (double x: { -halfWidth, halfWidth })
+          corners[i++] = geo.toWorldCoords(typename Geo::LocalPoint_t{ x, y, z });
+      }
+    }
+    return corners;
+  }
+
+} // local namespace
+
+
+namespace geo {
+
+  //----------------------------------------------------------------------------
+  void AuxDetSpatialIndex::Clear()
+  {
+    fIndexed = nullptr;
+    fMaxTolerance = 0.;
+    fBoxes.clear();
+    fNCells = {};
+    fCellSize = {};
+    fCells.clear();
+    fStrips.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  void AuxDetSpatialIndex::Build(std::vector<geo::AuxDetGeo> const& auxDets, double maxTolerance)
+  {
+    Clear();
+
+    if (auxDets.empty()) return;
+
+    fIndexed = auxDets.data();
+    fMaxTolerance = maxTolerance;
+
+    double const pad = maxTolerance + kMargin;
+    double const inf = std::numeric_limits<double>::infinity();
+
+    // world bounding boxes of the detectors, and their union
+    fBounds.lo.fill(inf);
+    fBounds.hi.fill(-inf);
+    std::array<double, 3> sumExtent{};
+
+    fBoxes.reserve(auxDets.size());
+    for (auto const& adg: auxDets) {
+      Box_t box;
+      box.lo.fill(inf);
+      box.hi.fill(-inf);
+      for (auto const& corner: PaddedCorners(adg, pad)) {
+        for (unsigned int k = 0; k < 3; ++k) {
+          box.lo[k] = std::min(box.lo[k], Coord(corner, k));
+          box.hi[k] = std::max(box.hi[k], Coord(corner, k));
+        }
+      }
+      for (unsigned int k = 0; k < 3; ++k) {
+        fBounds.lo[k] = std::min(fBounds.lo[k], box.lo[k]);
+        fBounds.hi[k] = std::max(fBounds.hi[k], box.hi[k]);
+        sumExtent[k] += box.hi[k] - box.lo[k];
+      }
+      fBoxes.push_back(box);
+    }
+
+    // cells about the size of an average detector box
+    for (unsigned int k = 0; k < 3; ++k) {
+      double const extent = fBounds.hi[k] - fBounds.lo[k];
+      double const meanExtent = sumExtent[k] / auxDets.size();
+      size_t const n = (meanExtent > 0.)? size_t(std::ceil(extent / meanExtent)): 1;
+      fNCells[k] = std::clamp<size_t>(n, 1, kMaxCellsPerAxis);
+      fCellSize[k] = extent / fNCells[k];
+    }
+
+    auto cellOf = [this](double x, unsigned int k) -> size_t {
+      if (!(fCellSize[k] > 0.)) return 0;
+      double const c = std::floor((x - fBounds.lo[k]) / fCellSize[k]);
+      return std::min(size_t(std::max(c, 0.)), fNCells[k] - 1);
+    };
+
+    // detectors are added in index order, so each cell list stays sorted
+    fCells.assign(fNCells[0]*fNCells[1]*fNCells[2], {});
+    for (size_t a = 0; a < fBoxes.size(); ++a) {
+      Box_t const& box = fBoxes[a];
+      for (size_t i = cellOf(box.lo[0], 0); i <= cellOf(box.hi[0], 0); ++i)
+        for (size_t j = cellOf(box.lo[1], 1); j <= cellOf(box.hi[1], 1); ++j)
+          for (size_t l = cellOf(box.lo[2], 2); l <= cellOf(box.hi[2], 2); ++l)
+            fCells[(i*fNCells[1] + j)*fNCells[2] + l].push_back(a);
+    }
+
+    // sensitive volumes of each detector, along the axis their centres spread the most
+    fStrips.resize(auxDets.size());
+    for (size_t a = 0; a < auxDets.size(); ++a) {
+      geo::AuxDetGeo const& adg = auxDets[a];
+      StripIndex_t& strips = fStrips[a];
+
+      std::vector<Box_t> svBoxes(adg.NSensitiveVolume());
+      std::array<double, 3> centreLo, centreHi;
+      centreLo.fill(inf);
+      centreHi.fill(-inf);
+      for (size_t sv = 0; sv < svBoxes.size(); ++sv) {
+        Box_t& box = svBoxes[sv];
+        box.lo.fill(inf);
+        box.hi.fill(-inf);
+        for (auto const& corner: PaddedCorners(adg.SensitiveVolume(sv), pad)) {
+          auto const local = adg.toLocalCoords(corner);
+          for (unsigned int k = 0; k < 3; ++k) {
+            box.lo[k] = std::min(box.lo[k], Coord(local, k));
+            box.hi[k] = std::max(box.hi[k], Coord(local, k));
+          }
+        }
+        for (unsigned int k = 0; k < 3; ++k) {
+          double const centre = 0.5 * (box.lo[k] + box.hi[k]);
+          centreLo[k] = std::min(centreLo[k], centre);
+          centreHi[k] = std::max(centreHi[k], centre);
+        }
+      }
+      if (svBoxes.empty()) continue;
+
+      for (unsigned int k = 1; k < 3; ++k) {
+        if (centreHi[k] - centreLo[k] > centreHi[strips.axis] - centreLo[strips.axis])
+          strips.axis = k;
+      }
+
+      std::vector<size_t> order(svBoxes.size());
+      for (size_t sv = 0; sv < order.size(); ++sv) order[sv] = sv;
+      unsigned int const axis = strips.axis;
+      std::stable_sort(order.begin(), order.end(),
+        [&svBoxes, axis](size_t i, size_t j){ return svBoxes[i].lo[axis] < svBoxes[j].lo[axis]; });
+
+      for (size_t sv: order) {
+        strips.lo.push_back(svBoxes[sv].lo[axis]);
+        strips.hi.push_back(svBoxes[sv].hi[axis]);
+        strips.sv.push_back(sv);
+        strips.maxWidth = std::max(strips.maxWidth, svBoxes[sv].hi[axis] - svBoxes[sv].lo[axis]);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  size_t AuxDetSpatialIndex::FindAuxDet
+    (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const
+  {
+    if (!Indexes(auxDets) || tolerance > fMaxTolerance)
+      return ScanAuxDets(point, auxDets, tolerance);
+
+    std::array<size_t, 3> cell;
+    for (unsigned int k = 0; k < 3; ++k) {
+      double const x = Coord(point, k);
+      // outside of all the boxes (or not a number): no detector holds the point
+      if (!(x >= fBounds.lo[k] && x <= fBounds.hi[k])) return UINT_MAX;
+      cell[k] = (fCellSize[k] > 0.)
+        ? std::min(size_t((x - fBounds.lo[k]) / fCellSize[k]), fNCells[k] - 1): 0;
+    }
+
+    for (size_t a: fCells[(cell[0]*fNCells[1] + cell[1])*fNCells[2] + cell[2]]) {
+      Box_t const& box = fBoxes[a];
+      bool inBox = true;
+      for (unsigned int k = 0; k < 3 && inBox; ++k)
+        inBox = Coord(point, k) >= box.lo[k] && Coord(point, k) <= box.hi[k];
+
+      if (inBox && Contains(auxDets[a], point, tolerance)) return a;
+    }
+
+    return UINT_MAX;
+  }
+
+  //----------------------------------------------------------------------------
+  size_t AuxDetSpatialIndex::FindSensitiveVolume
+    (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, size_t ad, double tolerance) const
+  {
+    geo::AuxDetGeo const& adg = auxDets[ad];
+
+    if (!Indexes(auxDets) || tolerance > fMaxTolerance)
+      return ScanSensitiveVolumes(point, adg, tolerance);
+
+    StripIndex_t const& strips = fStrips[ad];
+    double const x = Coord(adg.toLocalCoords(point), strips.axis);
+
+    // strips whose extent holds x, tested in sensitive volume order
+    std::vector<size_t> candidates;
+    auto const end = std::upper_bound(strips.lo.begin(), strips.lo.end(), x);
+    for (auto it = end; it != strips.lo.begin(); ) {
+      --it;
+      if (*it < x - strips.maxWidth) break;
+      size_t const i = it - strips.lo.begin();
+      if (strips.hi[i] >= x) candidates.push_back(strips.sv[i]);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (size_t sv: candidates) {
+      if (Contains(adg.SensitiveVolume(sv), point, tolerance)) return sv;
+    }
+
+    return UINT_MAX;
+  }
+
+  //----------------------------------------------------------------------------
+  size_t AuxDetSpatialIndex::ScanAuxDets
+    (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const
+  {
+    for (size_t a = 0; a < auxDets.size(); ++a) {
+      if (Contains(auxDets[a], point, tolerance)) return a;
+    }
+    return UINT_MAX;
+  }
+
+  //----------------------------------------------------------------------------
+  size_t AuxDetSpatialIndex::ScanSensitiveVolumes
+    (Point_t const& point, geo::AuxDetGeo const& adg, double tolerance) const
+  {
+    for (size_t a = 0; a < adg.NSensitiveVolume(); ++a) {
+      if (Contains(adg.SensitiveVolume(a), point, tolerance)) return a;
+    }
+    return UINT_MAX;
+  }
+
+} // namespace geo
@@ -0,0 +1,119 @@
+/**
+ * @file   AuxDetSpatialIndex.h
+ * @brief  Spatial index over the auxiliary detectors and their sensitive volumes.
+ *
+ * Used by the SBND channel mapping algorithms to find the auxiliary detector
+ * and the sensitive volume holding a point without testing all of them.
+ */
+
+#ifndef SBNDCODE_GEOMETRY_AUXDETSPATIALINDEX_H
+#define SBNDCODE_GEOMETRY_AUXDETSPATIALINDEX_H
+
+// LArSoft libraries
+#include "larcorealg/Geometry/AuxDetGeo.h"
+#include "larcorealg/Geometry/AuxDetSensitiveGeo.h"
+
+// C/C++ standard libraries
+#include <array>
+#include <cstddef>
+#include <vector>
+
+
+namespace geo {
+
+  /**
+   * @brief Grid of auxiliary detector bounding boxes, with a strip index per detector.
+   *
+   * The space around the auxiliary detectors is split into a uniform grid of
+   * cells, each listing the detectors whose bounding box, padded by
+   * `MaxTolerance()`, overlaps it. The sensitive volumes of each detector are
+   * sorted along the axis of the detector frame they are stacked on.
+   *
+   * A lookup tests only the candidates found this way, with the same
+   * containment test as the linear scans, in increasing index order: the
+   * answer is the one of the scan. Tolerances larger than `MaxTolerance()`
+   * and detector lists other than the indexed one fall back to the scan.
+   */
+  class AuxDetSpatialIndex {
+
+      public:
+
+    static constexpr double kDefaultMaxTolerance = 1.0; ///< [cm]
+
+    /// Indexes the detectors; the vector must outlive the index unchanged.
+    void Build
+      (std::vector<geo::AuxDetGeo> const& auxDets, double maxTolerance = kDefaultMaxTolerance);
+
+    void Clear();
+
+    double MaxTolerance() const { return fMaxTolerance; }
+
+    /// Index of the first auxiliary detector holding the point, `UINT_MAX` if none.
+    size_t FindAuxDet
+      (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const;
+
+    /// Index of the first sensitive volume of `auxDets[ad]` holding the point, `UINT_MAX` if none.
+    size_t FindSensitiveVolume
+      (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, size_t ad, double tolerance) const;
+
+    /// Trapezoid containment test of the channel maps.
+    template <typename Geo>
+    static bool Contains(Geo const& geo, Point_t const& point, double tolerance);
+
+      private:
+
+    struct Box_t {
+      std::array<double, 3> lo, hi;
+    };
+
+    /// Sensitive volumes of one detector, sorted along their stacking axis.
+    struct StripIndex_t {
+      unsigned int axis = 0;  ///< Axis of the detector frame the strips are stacked on.
+      double maxWidth = 0.;   ///< Largest extent of a strip along that axis.
+      std::vector<double> lo; ///< Lower edges along the axis, sorted.
+      std::vector<double> hi; ///< Upper edges, in the same order.
+      std::vector<size_t> sv; ///< Sensitive volume of each entry.
+    };
+
+    /// Whether the index was built from this detector list.
+    bool Indexes(std::vector<geo::AuxDetGeo> const& auxDets) const
+      { return !fBoxes.empty() && auxDets.data() == fIndexed && auxDets.size() == fBoxes.size(); }
+
+    size_t ScanAuxDets
+      (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const;
+    size_t ScanSensitiveVolumes
+      (Point_t const& point, geo::AuxDetGeo const& adg, double tolerance) const;
+
+    geo::AuxDetGeo const* fIndexed = nullptr;
+    double fMaxTolerance = 0.;
+
+    std::vector<Box_t> fBoxes; ///< Padded world bounding box of each detector.
+    Box_t fBounds;             ///< Union of all the boxes.
+    std::array<size_t, 3> fNCells{};
+    std::array<double, 3> fCellSize{};
+    std::vector<std::vector<size_t>> fCells; ///< Detectors overlapping each cell, in index order.
+
+    std::vector<StripIndex_t> fStrips; ///< One per detector.
+
+  }; // class AuxDetSpatialIndex
+
+  //----------------------------------------------------------------------------
+  template <typename Geo>
+  bool AuxDetSpatialIndex::Contains(Geo const& geo, Point_t const& point, double tolerance)
+  {
+    auto const localPoint = geo.toLocalCoords(point);
+
+    double HalfCenterWidth = 0.5 * (geo.HalfWidth1() + geo.HalfWidth2());
+
+    return localPoint.Z() >= - (geo.Length()/2 + tolerance) &&
+           localPoint.Z() <=   (geo.Length()/2 + tolerance) &&
+           localPoint.Y() >= - geo.HalfHeight() - tolerance &&
+           localPoint.Y() <=   geo.HalfHeight() + tolerance &&
+           // if the volume is a box, then HalfSmallWidth = HalfWidth
+           localPoint.X() >= - HalfCenterWidth + localPoint.Z()*(HalfCenterWidth - geo.HalfWidth2())/(0.5 * geo.Length()) - tolerance &&
+           localPoint.X() <=   HalfCenterWidth - localPoint.Z()*(HalfCenterWidth - geo.HalfWidth2())/(0.5 * geo.Length()) + tolerance;
+  }
+
+} // namespace geo
+
+#endif // SBNDCODE_GEOMETRY_AUXDETSPATIALINDEX_H
@@ -5,31 +5,57 @@
  */
 
 #include "sbndcode/Geometry/ChannelMapSBNDAlg.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 namespace geo {
   
-  size_t ChannelMapSBNDAlg::NearestAuxDet(Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const
+  void ChannelMapSBNDAlg::Initialize(GeometryData_t const& geodata)
   {
-    double HalfCenterWidth = 0.;
-
+    sbnd::startup::Span span("ChannelMapSBNDAlg::Initialize");
+    ChannelMapStandardAlg::Initialize(geodata);
+    fAuxDetIndex.Build(geodata.auxDets);
+
+    fChannelWireOffsets.clear();
+    fChannelWires.clear();
+    unsigned int const nChannels = Nchannels();
+    fChannelWireOffsets.reserve(nChannels + 1);
+    fChannelWires.reserve(nChannels);
+    for (raw::ChannelID_t channel = 0; channel < nChannels; ++channel) {
+      fChannelWireOffsets.push_back(fChannelWires.size());
+      for (geo::WireID const& wireID: ChannelMapStandardAlg::ChannelToWire(channel))
+        fChannelWires.push_back(wireID);
+    }
+    fChannelWireOffsets.push_back(fChannelWires.size());
+  }
 
-    for(size_t a = 0; a < auxDets.size(); ++a) {
+  //----------------------------------------------------------------------------
+  void ChannelMapSBNDAlg::Uninitialize()
+  {
+    ChannelMapStandardAlg::Uninitialize();
+    fAuxDetIndex.Clear();
+    fChannelWireOffsets.clear();
+    fChannelWires.clear();
+  }
 
-      auto const localPoint = auxDets[a].toLocalCoords(point);
+  //----------------------------------------------------------------------------
+  std::vector<geo::WireID> ChannelMapSBNDAlg::ChannelToWire(raw::ChannelID_t channel) const
+  {
+    // channels out of the table get the answer (or the exception) of the
+    // standard mapping
+    if (fChannelWireOffsets.empty() || channel >= fChannelWireOffsets.size() - 1)
+      return ChannelMapStandardAlg::ChannelToWire(channel);
+    return { fChannelWires.begin() + fChannelWireOffsets[channel],
+             fChannelWires.begin() + fChannelWireOffsets[channel + 1] };
+  }
 
-      HalfCenterWidth = 0.5 * (auxDets[a].HalfWidth1() + auxDets[a].HalfWidth2());
-      
-      if( localPoint.Z() >= - (auxDets[a].Length()/2 + tolerance) &&
-          localPoint.Z() <=   (auxDets[a].Length()/2 + tolerance) &&
-          localPoint.Y() >= - auxDets[a].HalfHeight() - tolerance &&
-          localPoint.Y() <=   auxDets[a].HalfHeight() + tolerance &&
-          // if AuxDet a is a box, then HalfSmallWidth = HalfWidth
-          localPoint.X() >= - HalfCenterWidth + localPoint.Z()*(HalfCenterWidth - auxDets[a].HalfWidth2())/(0.5 * auxDets[a].Length()) - tolerance &&
-          localPoint.X() <=   HalfCenterWidth - localPoint.Z()*(HalfCenterWidth - auxDets[a].HalfWidth2())/(0.5 * auxDets[a].Length()) + tolerance
-          ) return a;
+  //----------------------------------------------------------------------------
+  size_t ChannelMapSBNDAlg::NearestAuxDet(Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const
+  {
+    size_t const auxDetIdx = fAuxDetIndex.FindAuxDet(point, auxDets, tolerance);
 
-    }// for loop over AudDet a
+    if(auxDetIdx != UINT_MAX)
+      return auxDetIdx;
 
     // log a message because we couldn't find the aux det volume, exception in base class
     mf::LogDebug("ChannelMapSBND") << "Can't find AuxDet for position ("
@@ -44,31 +70,15 @@ namespace geo {
   //----------------------------------------------------------------------------
   size_t ChannelMapSBNDAlg::NearestSensitiveAuxDet(Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance) const
   {
-    double HalfCenterWidth = 0.;
-
     size_t auxDetIdx = this->NearestAuxDet(point, auxDets, tolerance);
 
     if(auxDetIdx == UINT_MAX)
       return UINT_MAX;
 
-    geo::AuxDetGeo const& adg = auxDets[auxDetIdx];
-
-    for(size_t a = 0; a < adg.NSensitiveVolume(); ++a) {
-
-      geo::AuxDetSensitiveGeo const& adsg = adg.SensitiveVolume(a);
-      auto const localPoint = adsg.toLocalCoords(point);
-
-      HalfCenterWidth = 0.5 * (adsg.HalfWidth1() + adsg.HalfWidth2());
+    size_t const svIdx = fAuxDetIndex.FindSensitiveVolume(point, auxDets, auxDetIdx, tolerance);
 
-      if( localPoint.Z() >= - (adsg.Length()/2 + tolerance) &&
-          localPoint.Z() <=   (adsg.Length()/2 + tolerance) &&
-          localPoint.Y() >= - adsg.HalfHeight() - tolerance &&
-          localPoint.Y() <=   adsg.HalfHeight() + tolerance &&
-          // if AuxDet a is a box, then HalfSmallWidth = HalfWidth
-          localPoint.X() >= - HalfCenterWidth + localPoint.Z()*(HalfCenterWidth - adsg.HalfWidth2())/(0.5 * adsg.Length()) - tolerance &&
-          localPoint.X() <=   HalfCenterWidth - localPoint.Z()*(HalfCenterWidth - adsg.HalfWidth2())/(0.5 * adsg.Length()) + tolerance
-          ) return a;
-    }// for loop over AuxDetSensitive a
+    if(svIdx != UINT_MAX)
+      return svIdx;
 
     // log a message because we couldn't find the sensitive aux det volume, exception in base class
     mf::LogDebug("ChannelMapSBND") << "Can't find AuxDetSensitive for position ("
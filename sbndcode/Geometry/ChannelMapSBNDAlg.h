@@ -14,10 +14,14 @@
 
 // SBND libraries
 #include "sbndcode/Geometry/GeoObjectSorterSBND.h"
+#include "sbndcode/Geometry/AuxDetSpatialIndex.h"
 
 // LArSoft libraries
 #include "larcorealg/Geometry/ChannelMapStandardAlg.h"
 
+// C/C++ standard libraries
+#include <vector>
+
 
 namespace geo {
   
@@ -27,11 +31,21 @@ namespace geo {
    * This uses the standard channel mapping, and the custom sorter
    * `GeoObjectSortersbnd`.
    *
-   * 
+   * The auxiliary detector lookups go through a spatial index built at
+   * initialization (see `geo::AuxDetSpatialIndex`).
+   *
+   * The wires of each channel are also tabulated at initialization, so that
+   * `ChannelToWire()`, and `geo::GeometryCore::View()` which relies on it,
+   * do not search the planes on each call; the table holds the answers of
+   * the standard mapping.
    */
   class ChannelMapSBNDAlg : public ChannelMapStandardAlg {
     
     geo::GeoObjectSorterSBND fSBNDsorter; ///< Sorts geo::XXXGeo objects.
+    geo::AuxDetSpatialIndex fAuxDetIndex; ///< Finds the AuxDets holding a point.
+    
+    std::vector<unsigned int> fChannelWireOffsets; ///< First wire of each channel in fChannelWires, and end.
+    std::vector<geo::WireID> fChannelWires; ///< Wires of all the channels, channel after channel.
     
       public:
     
@@ -44,6 +58,15 @@ namespace geo {
     virtual geo::GeoObjectSorter const& Sorter() const override 
       { return fSBNDsorter; }
     
+    /// Builds the standard channel map and indexes the auxiliary detectors
+    virtual void Initialize(GeometryData_t const& geodata) override;
+
+    virtual void Uninitialize() override;
+
+    /// Returns the wires of the channel, from the table
+    virtual std::vector<geo::WireID> ChannelToWire
+      (raw::ChannelID_t channel) const override;
+
     /// Returns the auxiliary detector closest to the specified point
     virtual size_t NearestAuxDet
       (Point_t const& point, std::vector<geo::AuxDetGeo> const& auxDets, double tolerance = 0) const override;
@@ -6,6 +6,7 @@
  */
 
 #include "sbndcode/Geometry/GeoObjectSorterSBND.h"
+#include "sbndcode/Geometry/SortByKey.h"
 
 // LArSoft libraries
 #include "larcorealg/Geometry/CryostatGeo.h"
@@ -34,6 +35,13 @@ inline bool equal(double a, double b)
   { return std::abs(a - b) <= tol; }
 
 
+/// What the wire sorter needs of a wire, computed once per wire.
+struct WireSortKey {
+  geo::Point_t center;
+  geo::Point_t end;
+};
+
+
 //----------------------------------------------------------------------------
 bool CryostatSorter(geo::CryostatGeo const& c1, geo::CryostatGeo const& c2) {
   //
@@ -45,11 +53,9 @@ bool CryostatSorter(geo::CryostatGeo const& c1, geo::CryostatGeo const& c2) {
 } // CryostatSorter()
 
 //----------------------------------------------------------------------------
-static bool OpDetsSorter(geo::OpDetGeo const& t1, geo::OpDetGeo const& t2)
+// the sorters below compare the keys of the objects (see SortByKey.h)
+static bool OpDetsSorter(geo::Point_t const& xyz1, geo::Point_t const& xyz2)
 {
-  auto const xyz1 = t1.GetCenter();
-  auto const xyz2 = t2.GetCenter();
-
   if(xyz1.Z() != xyz2.Z())
     return xyz1.Z() < xyz2.Z();
   else if(xyz1.Y() != xyz2.Y())
@@ -59,7 +65,7 @@ static bool OpDetsSorter(geo::OpDetGeo const& t1, geo::OpDetGeo const& t2)
 } // OpDetsSorter
 
 //----------------------------------------------------------------------------
-bool TPCSorter(geo::TPCGeo const& t1, geo::TPCGeo const& t2) {
+bool TPCSorter(geo::Point_t const& t1, geo::Point_t const& t2) {
   //
   // Define sort order for TPCs (in SBND case, by x).
   //
@@ -69,18 +75,18 @@ bool TPCSorter(geo::TPCGeo const& t1, geo::TPCGeo const& t2) {
   // then numbering will go in y then in z direction.
 
   // First sort all TPCs belonging to different "z groups"
-  if (!equal(t1.CenterZ(), t2.CenterZ()))
-    return t1.CenterZ() < t2.CenterZ();
+  if (!equal(t1.Z(), t2.Z()))
+    return t1.Z() < t2.Z();
 
   // Within the same-z groups, sort TPCs belonging to different "y groups"
-  if (!equal(t1.CenterY(), t2.CenterY()))
-    return t1.CenterY() < t2.CenterY();
+  if (!equal(t1.Y(), t2.Y()))
+    return t1.Y() < t2.Y();
 
   // Within the same z and y groups, sort TPCs belonging to different
   // "x groups";
   // if the x is also the same, then t1 and t2 are the same TPC and strict
   // ordering requires us to return false.
-  return t1.CenterX() < t2.CenterX();
+  return t1.X() < t2.X();
 
 } // TPCSorter()
 
@@ -88,7 +94,7 @@ bool TPCSorter(geo::TPCGeo const& t1, geo::TPCGeo const& t2) {
 //----------------------------------------------------------------------------
 // Define sort order for planes in APA configuration
 //   same as standard, but implemented differently
-bool PlaneSorter(geo::PlaneGeo const& p1, geo::PlaneGeo const& p2) {
+bool PlaneSorter(geo::Point_t const& p1c, geo::Point_t const& p2c) {
 
   /*
    * Sort the wire planes so that the first faces the center of the TPC.
@@ -101,9 +107,6 @@ bool PlaneSorter(geo::PlaneGeo const& p1, geo::PlaneGeo const& p2) {
    * and we sort after |x| of the wire planes.
    *
    */
-  decltype(auto) p1c = p1.GetBoxCenter();
-  decltype(auto) p2c = p2.GetBoxCenter();
-
   /*
    *   #2  #1  #0                   cathode                   #0  #1  #2
    *   |   |   |                       |                       |   |   |
@@ -118,7 +121,7 @@ bool PlaneSorter(geo::PlaneGeo const& p1, geo::PlaneGeo const& p2) {
 
 
 //----------------------------------------------------------------------------
-bool WireSorter(geo::WireGeo const& w1, geo::WireGeo const& w2) {
+bool WireSorter(WireSortKey const& w1, WireSortKey const& w2) {
 
   /*
    * Wire comparison algorithm: compare wire centers:
@@ -179,7 +182,8 @@ bool WireSorter(geo::WireGeo const& w1, geo::WireGeo const& w2) {
    * This is stubbornly pretending there is no discontinuity in the wire plane
    * (that is, it is ignoring the junction half way along z.
    */
-  decltype(auto) c1 = w1.GetCenter(), c2 = w2.GetCenter();
+  geo::Point_t const& c1 = w1.center;
+  geo::Point_t const& c2 = w2.center;
 
   //
   // we do z first, which easily resolves the vertical wires:
@@ -191,7 +195,7 @@ bool WireSorter(geo::WireGeo const& w1, geo::WireGeo const& w2) {
   //
   if (!equal(c1.Y(), c2.Y())) {
     // need to figure out the angle of the wires (we assume both share the same)
-    decltype(auto) e1 = w1.GetEnd();
+    geo::Point_t const& e1 = w1.end;
 
     //
     // We work with end - center (e1 - c1):
@@ -239,12 +243,19 @@ void geo::GeoObjectSorterSBND::SortCryostats
 void geo::GeoObjectSorterSBND::SortOpDets
   (std::vector<geo::OpDetGeo> & opdet) const
   {
-    std::sort(opdet.begin(), opdet.end(), OpDetsSorter);
+    geo::details::SortByKey(opdet,
+      [](geo::OpDetGeo const& o){ return geo::Point_t(o.GetCenter()); },
+      OpDetsSorter);
   }
 
 //----------------------------------------------------------------------------
 void geo::GeoObjectSorterSBND::SortTPCs(std::vector<geo::TPCGeo>& tgeo) const
-  { std::sort(tgeo.begin(), tgeo.end(), TPCSorter); }
+{
+  geo::details::SortByKey(tgeo,
+    [](geo::TPCGeo const& t)
+      { return geo::Point_t{ t.CenterX(), t.CenterY(), t.CenterZ() }; },
+    TPCSorter);
+}
 
 //----------------------------------------------------------------------------
 void geo::GeoObjectSorterSBND::SortPlanes
@@ -254,7 +265,9 @@ void geo::GeoObjectSorterSBND::SortPlanes
   // The drift direction has to be set before this method is called.
   // Using the drift direction would render the trick of the sorter unnecessary.
 
-  std::sort(pgeo.begin(), pgeo.end(), PlaneSorter);
+  geo::details::SortByKey(pgeo,
+    [](geo::PlaneGeo const& p){ return geo::Point_t(p.GetBoxCenter()); },
+    PlaneSorter);
 
   /*
   switch (driftDir) {
@@ -275,7 +288,12 @@ void geo::GeoObjectSorterSBND::SortPlanes
 //----------------------------------------------------------------------------
 void geo::GeoObjectSorterSBND::SortWires
   (std::vector<geo::WireGeo>& wgeo) const
-  { std::sort(wgeo.begin(), wgeo.end(), WireSorter); }
+{
+  geo::details::SortByKey(wgeo,
+    [](geo::WireGeo const& w)
+      { return WireSortKey{ geo::Point_t(w.GetCenter()), geo::Point_t(w.GetEnd()) }; },
+    WireSorter);
+}
 
 
 
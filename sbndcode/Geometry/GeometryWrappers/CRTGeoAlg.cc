@@ -1,4 +1,8 @@
 #include "CRTGeoAlg.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
+
+#include <mutex>
+#include <tuple>
 
 namespace sbnd::crt {
 
@@ -17,6 +21,7 @@ namespace sbnd::crt {
     , fSiPMGainsVector(p.get<std::vector<std::pair<unsigned, double>>>("SiPMGains", std::vector<std::pair<unsigned, double>>()))
     , fChannelInversionVector(p.get<std::vector<std::pair<unsigned, bool>>>("InvertedChannelOrder", std::vector<std::pair<unsigned, bool>>()))
   {
+    sbnd::startup::Span span("CRTGeoAlg");
     fGeometryService = geometry;
     fAuxDetGeoCore   = auxdet_geometry;
     TGeoManager* manager = fGeometryService->ROOTGeoManager();
@@ -32,10 +37,11 @@ namespace sbnd::crt {
     fChannelInversion         = std::map<unsigned, bool>(fChannelInversionVector.begin(),
                                                          fChannelInversionVector.end());
 
-    // Record used objects
-    std::vector<std::string> usedTaggers;
-    std::vector<std::string> usedModules;
-    std::vector<std::string> usedStrips;
+    // Collect by name first, the flat tables are filled in name order below
+    std::map<std::string, CRTTaggerGeo> taggers;
+    std::map<std::string, CRTModuleGeo> modules;
+    std::map<std::string, CRTStripGeo>  strips;
+    std::map<uint16_t, CRTSiPMGeo>      sipms;
 
     // Loop through aux dets
     const std::vector<geo::AuxDetGeo> &auxDets = fAuxDetGeoCore->AuxDetGeoVec();
@@ -73,17 +79,16 @@ namespace sbnd::crt {
 
             // Fill the tagger information
             const std::string taggerName = nodeTagger->GetName();
-            if(std::find(usedTaggers.begin(), usedTaggers.end(), taggerName) == usedTaggers.end())
+            if(taggers.find(taggerName) == taggers.end())
               {
-                usedTaggers.push_back(taggerName);
                 CRTTaggerGeo tagger  = CRTTaggerGeo(nodeTagger, nodeDet);
-                fTaggers.insert(std::pair<std::string, CRTTaggerGeo>(taggerName, tagger));
+                taggers.insert(std::pair<std::string, CRTTaggerGeo>(taggerName, tagger));
               }
 
             // Fill the module information
             const std::string moduleName = nodeModule->GetName();
             const bool invert = fChannelInversion.size() ? fChannelInversion.at(ad_i) : false;
-            if(std::find(usedModules.begin(), usedModules.end(), moduleName) == usedModules.end())
+            if(modules.find(moduleName) == modules.end())
               {
                 const int32_t t0CableDelayCorrection = fT0CableLengthCorrections.size() ?
                   fT0CableLengthCorrections.at(ad_i) : 0;
@@ -93,11 +98,10 @@ namespace sbnd::crt {
                 const std::string stripName = nodeStrip->GetVolume()->GetName();
                 const bool minos = stripName.find("MINOS") != std::string::npos ? true : false;
 
-                usedModules.push_back(moduleName);
                 CRTModuleGeo module  = CRTModuleGeo(nodeModule, auxDet, ad_i, taggerName,
                                                     t0CableDelayCorrection, t1CableDelayCorrection,
                                                     invert, minos);
-                fModules.insert(std::pair<std::string, CRTModuleGeo>(moduleName, module));
+                modules.insert(std::pair<std::string, CRTModuleGeo>(moduleName, module));
               }
 
             // Fill the strip information
@@ -105,12 +109,11 @@ namespace sbnd::crt {
             // Some modules need their channel numbers counted in reverse as they're inverted relative to the geometry
             const uint32_t channel0 = invert ? 32 * ad_i + (31 - 2 * ads_i) : 32 * ad_i + 2 * ads_i;
             const uint32_t channel1 = invert ? 32 * ad_i + (31 - 2 * ads_i -1) : 32 * ad_i + 2 * ads_i + 1;
-            if(std::find(usedStrips.begin(), usedStrips.end(), stripName) == usedStrips.end())
+            if(strips.find(stripName) == strips.end())
               {
-                usedStrips.push_back(stripName);
                 CRTStripGeo strip  = CRTStripGeo(nodeStrip, auxDetSensitive, ads_i, moduleName,
                                                  channel0, channel1);
-                fStrips.insert(std::pair<std::string, CRTStripGeo>(stripName, strip));
+                strips.insert(std::pair<std::string, CRTStripGeo>(stripName, strip));
               }
 
             double halfWidth  = auxDetSensitive.HalfWidth1();
@@ -120,7 +123,7 @@ namespace sbnd::crt {
             // SiPM0 is on the left in local coordinates
             const double sipm0Y = -halfHeight;
             const double sipm1Y = halfHeight;
-            const double sipmX  = fModules.at(moduleName).top ? halfWidth : -halfWidth;
+            const double sipmX  = modules.at(moduleName).top ? halfWidth : -halfWidth;
 
             // Find world coordinates
             geo::AuxDetSensitiveGeo::LocalPoint_t const sipm0XYZ{sipmX, sipm0Y, 0};
@@ -138,39 +141,103 @@ namespace sbnd::crt {
             // Fill SiPM information
             CRTSiPMGeo sipm0 = CRTSiPMGeo(stripName, channel0, sipm0XYZWorld, pedestal0, gain0);
             CRTSiPMGeo sipm1 = CRTSiPMGeo(stripName, channel1, sipm1XYZWorld, pedestal1, gain1);
-            fSiPMs.insert(std::pair<uint16_t, CRTSiPMGeo>(channel0, sipm0));
-            fSiPMs.insert(std::pair<uint16_t, CRTSiPMGeo>(channel1, sipm1));
+            sipms.insert(std::pair<uint16_t, CRTSiPMGeo>(channel0, sipm0));
+            sipms.insert(std::pair<uint16_t, CRTSiPMGeo>(channel1, sipm1));
+          }
+      }
+
+    // Flatten into the integer indexed tables
+    for(auto const& [name, tagger] : taggers)
+      {
+        fTaggerIndex[name] = fTaggers.size();
+        fTaggers.push_back(tagger);
+        fTaggerEnums.push_back(CRTCommonUtils::GetTaggerEnum(name));
+      }
+
+    fModuleByAdID.assign(auxDets.size(), kInvalidIndex);
+    for(auto const& [name, module] : modules)
+      {
+        fModuleIndex[name] = fModules.size();
+        if(module.adID < fModuleByAdID.size() && fModuleByAdID[module.adID] == kInvalidIndex)
+          fModuleByAdID[module.adID] = fModules.size();
+        fModuleTagger.push_back(fTaggerIndex.at(module.taggerName));
+        fModules.push_back(module);
+      }
+
+    for(auto const& [name, strip] : strips)
+      {
+        fStripIndex[name] = fStrips.size();
+        fStripModule.push_back(fModuleIndex.at(strip.moduleName));
+        fStrips.push_back(strip);
+      }
+
+    const CRTChannelIndex unused = {kInvalidIndex, kInvalidIndex, kInvalidIndex, kInvalidIndex, kUndefinedTagger};
+    const size_t nChannels = sipms.empty() ? 0 : sipms.rbegin()->first + 1;
+    fChannelIndex.assign(nChannels, unused);
+    fChannelGain.assign(nChannels, 0.);
+    fChannelPedestal.assign(nChannels, 0);
+    fChannelT0CableDelay.assign(nChannels, 0);
+    fChannelT1CableDelay.assign(nChannels, 0);
+    fChannelInverted.assign(nChannels, false);
+    for(auto const& [channel, sipm] : sipms)
+      {
+        const uint32_t strip  = fStripIndex.at(sipm.stripName);
+        const uint32_t module = fStripModule[strip];
+        const uint32_t tagger = fModuleTagger[module];
+
+        fChannelIndex[channel] = {static_cast<uint32_t>(fSiPMs.size()), strip, module, tagger, fTaggerEnums[tagger]};
+        fSiPMs.push_back(sipm);
+
+        fChannelGain[channel]         = sipm.gain;
+        fChannelPedestal[channel]     = sipm.pedestal;
+        fChannelT0CableDelay[channel] = fModules[module].t0CableDelayCorrection;
+        fChannelT1CableDelay[channel] = fModules[module].t1CableDelayCorrection;
+        fChannelInverted[channel]     = fModules[module].invertedOrdering;
+      }
+
+    // The limits are asked for every point tested against the CRT
+    if(!fTaggers.empty())
+      {
+        fCRTLimits = {fTaggers[0].minX, fTaggers[0].minY, fTaggers[0].minZ,
+                      fTaggers[0].maxX, fTaggers[0].maxY, fTaggers[0].maxZ};
+        for(auto const& tagger : fTaggers)
+          {
+            fCRTLimits[0] = std::min(fCRTLimits[0], tagger.minX);
+            fCRTLimits[1] = std::min(fCRTLimits[1], tagger.minY);
+            fCRTLimits[2] = std::min(fCRTLimits[2], tagger.minZ);
+            fCRTLimits[3] = std::max(fCRTLimits[3], tagger.maxX);
+            fCRTLimits[4] = std::max(fCRTLimits[4], tagger.maxY);
+            fCRTLimits[5] = std::max(fCRTLimits[5], tagger.maxZ);
           }
       }
   }
 
   CRTGeoAlg::~CRTGeoAlg() {}
 
-  std::vector<double> CRTGeoAlg::CRTLimits() const {
-    std::vector<double> limits;
-
-    std::vector<double> minXs;
-    std::vector<double> minYs;
-    std::vector<double> minZs;
-    std::vector<double> maxXs;
-    std::vector<double> maxYs;
-    std::vector<double> maxZs;
-    for(auto const& tagger : fTaggers){
-      minXs.push_back(tagger.second.minX);
-      minYs.push_back(tagger.second.minY);
-      minZs.push_back(tagger.second.minZ);
-      maxXs.push_back(tagger.second.maxX);
-      maxYs.push_back(tagger.second.maxY);
-      maxZs.push_back(tagger.second.maxZ);
-    }
-    limits.push_back(*std::min_element(minXs.begin(), minXs.end()));
-    limits.push_back(*std::min_element(minYs.begin(), minYs.end()));
-    limits.push_back(*std::min_element(minZs.begin(), minZs.end()));
-    limits.push_back(*std::max_element(maxXs.begin(), maxXs.end()));
-    limits.push_back(*std::max_element(maxYs.begin(), maxYs.end()));
-    limits.push_back(*std::max_element(maxZs.begin(), maxZs.end()));
+  std::shared_ptr<const CRTGeoAlg> CRTGeoAlg::Shared(fhicl::ParameterSet const &p)
+  {
+    geo::GeometryCore const *geometry = lar::providerFrom<geo::Geometry>();
+    geo::AuxDetGeometryCore const *auxdet_geometry =
+      ((const geo::AuxDetGeometry*)&(*art::ServiceHandle<geo::AuxDetGeometry>()))->GetProviderPtr();
 
-    return limits;
+    using Key = std::tuple<fhicl::ParameterSetID, geo::GeometryCore const*, geo::AuxDetGeometryCore const*>;
+
+    static std::mutex mutex;
+    static std::map<Key, std::weak_ptr<const CRTGeoAlg>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<const CRTGeoAlg> &cached = cache[Key(p.id(), geometry, auxdet_geometry)];
+    std::shared_ptr<const CRTGeoAlg> geoAlg = cached.lock();
+    if(!geoAlg)
+      {
+        geoAlg = std::make_shared<const CRTGeoAlg>(p, geometry, auxdet_geometry);
+        cached = geoAlg;
+      }
+    return geoAlg;
+  }
+
+  std::vector<double> CRTGeoAlg::CRTLimits() const {
+    return fCRTLimits;
   }
 
   size_t CRTGeoAlg::NumTaggers() const
@@ -195,112 +262,139 @@ namespace sbnd::crt {
 
   std::map<std::string, CRTTaggerGeo> CRTGeoAlg::GetTaggers() const
   {
-    return fTaggers;
+    std::map<std::string, CRTTaggerGeo> taggers;
+    for(auto const& tagger : fTaggers)
+      taggers.emplace_hint(taggers.end(), tagger.name, tagger);
+    return taggers;
   }
 
   std::map<std::string, CRTModuleGeo> CRTGeoAlg::GetModules() const
   {
-    return fModules;
+    std::map<std::string, CRTModuleGeo> modules;
+    for(auto const& module : fModules)
+      modules.emplace_hint(modules.end(), module.name, module);
+    return modules;
   }
 
   std::map<std::string, CRTStripGeo> CRTGeoAlg::GetStrips() const
   {
-    return fStrips;
+    std::map<std::string, CRTStripGeo> strips;
+    for(auto const& strip : fStrips)
+      strips.emplace_hint(strips.end(), strip.name, strip);
+    return strips;
   }
 
   std::map<uint16_t, CRTSiPMGeo> CRTGeoAlg::GetSiPMs() const
   {
-    return fSiPMs;
+    std::map<uint16_t, CRTSiPMGeo> sipms;
+    for(auto const& sipm : fSiPMs)
+      sipms.emplace_hint(sipms.end(), sipm.channel, sipm);
+    return sipms;
   }
 
-  CRTTaggerGeo CRTGeoAlg::GetTagger(const std::string taggerName) const
+  const CRTChannelIndex &CRTGeoAlg::GetChannelIndex(const uint16_t channel) const
   {
-    return fTaggers.at(taggerName);
-  }
+    CheckChannel(channel);
 
-  CRTModuleGeo CRTGeoAlg::GetModule(const std::string moduleName) const
-  {
-    return fModules.at(moduleName);
+    return fChannelIndex[channel];
   }
 
-  CRTModuleGeo CRTGeoAlg::GetModule(const uint16_t channel) const
+  const CRTTaggerGeo &CRTGeoAlg::GetTagger(const std::string taggerName) const
   {
-    return fModules.at(fStrips.at(fSiPMs.at(channel).stripName).moduleName);
+    return fTaggers[fTaggerIndex.at(taggerName)];
   }
 
-  CRTModuleGeo CRTGeoAlg::GetModuleByAuxDetIndex(const unsigned ad_i) const
+  const CRTTaggerGeo &CRTGeoAlg::GetTagger(const CRTTagger tagger) const
   {
-    for(auto const &[name, module] : fModules)
+    for(size_t i = 0; i < fTaggerEnums.size(); ++i)
       {
-        if(module.adID == ad_i)
-          return module;
+        if(fTaggerEnums[i] == tagger)
+          return fTaggers[i];
       }
 
-    CRTModuleGeo void_return;
-    return void_return;
+    throw std::out_of_range("CRTGeoAlg: no tagger " + CRTCommonUtils::GetTaggerName(tagger));
+  }
+
+  const CRTModuleGeo &CRTGeoAlg::GetModule(const std::string moduleName) const
+  {
+    return fModules[fModuleIndex.at(moduleName)];
+  }
+
+  const CRTModuleGeo &CRTGeoAlg::GetModule(const uint16_t channel) const
+  {
+    return fModules[GetChannelIndex(channel).module];
+  }
+
+  const CRTModuleGeo &CRTGeoAlg::GetModuleByAuxDetIndex(const unsigned ad_i) const
+  {
+    if(ad_i < fModuleByAdID.size() && fModuleByAdID[ad_i] != kInvalidIndex)
+      return fModules[fModuleByAdID[ad_i]];
+
+    return fVoidModule;
   }
 
-  CRTStripGeo CRTGeoAlg::GetStrip(const std::string stripName) const
+  const CRTStripGeo &CRTGeoAlg::GetStrip(const std::string stripName) const
   {
-    return fStrips.at(stripName);
+    return fStrips[fStripIndex.at(stripName)];
   }
 
-  CRTStripGeo CRTGeoAlg::GetStrip(const uint16_t channel) const
+  const CRTStripGeo &CRTGeoAlg::GetStrip(const uint16_t channel) const
   {
-    return fStrips.at(fSiPMs.at(channel).stripName);
+    return fStrips[GetChannelIndex(channel).strip];
   }
 
-  CRTStripGeo CRTGeoAlg::GetStripByAuxDetIndices(const unsigned ad_i, const unsigned ads_i) const
+  const CRTStripGeo &CRTGeoAlg::GetStripByAuxDetIndices(const unsigned ad_i, const unsigned ads_i) const
   {
-    const CRTModuleGeo module = GetModule(ad_i);
+    const CRTModuleGeo &module = GetModule(ad_i);
     const uint16_t channel =
       module.invertedOrdering ? 32 * ad_i + (31 -2 *ads_i) : 32 * ad_i + 2 * ads_i;
 
     return GetStrip(channel);
   }
 
-  CRTSiPMGeo CRTGeoAlg::GetSiPM(const uint16_t channel) const
+  const CRTSiPMGeo &CRTGeoAlg::GetSiPM(const uint16_t channel) const
   {
-    return fSiPMs.at(channel);
+    return fSiPMs[GetChannelIndex(channel).sipm];
   }
 
   std::string CRTGeoAlg::GetTaggerName(const std::string name) const
   {
-    if(fStrips.find(name) != fStrips.end())
-      return fModules.at(fStrips.at(name).moduleName).taggerName;
-    else if(fModules.find(name) != fModules.end())
-      return fModules.at(name).taggerName;
-    
+    if(fStripIndex.find(name) != fStripIndex.end())
+      return GetModule(GetStrip(name).moduleName).taggerName;
+    else if(fModuleIndex.find(name) != fModuleIndex.end())
+      return GetModule(name).taggerName;
+
     return "";
   }
 
   std::string CRTGeoAlg::ChannelToStripName(const uint16_t channel) const
   {
-    return fSiPMs.at(channel).stripName;
+    return GetStrip(channel).name;
   }
 
   std::string CRTGeoAlg::ChannelToTaggerName(const uint16_t channel) const
   {
-    return fModules.at(fStrips.at(fSiPMs.at(channel).stripName).moduleName).taggerName;
+    return fTaggers[GetChannelIndex(channel).tagger].name;
   }
 
   enum CRTTagger CRTGeoAlg::ChannelToTaggerEnum(const uint16_t channel) const
   {
-    return CRTCommonUtils::GetTaggerEnum(ChannelToTaggerName(channel));
+    return GetChannelIndex(channel).taggerEnum;
   }
 
   size_t CRTGeoAlg::ChannelToOrientation(const uint16_t channel) const
   {
-    return fModules.at(fStrips.at(fSiPMs.at(channel).stripName).moduleName).orientation;
+    return fModules[GetChannelIndex(channel).module].orientation;
   }
 
   std::array<double, 6> CRTGeoAlg::StripHit3DPos(const uint16_t channel, const double x,
-                                                 const double ex)
+                                                 const double ex) const
   {
-    const CRTStripGeo &strip = GetStrip(channel);
+    const CRTChannelIndex &index = GetChannelIndex(channel);
+    const CRTStripGeo &strip     = fStrips[index.strip];
 
     const uint16_t adsID = strip.adsID;
-    const uint16_t adID  = fModules.at(strip.moduleName).adID;
+    const uint16_t adID  = fModules[index.module].adID;
 
     const geo::AuxDetSensitiveGeo &auxDetSensitive = fAuxDetGeoCore->AuxDetGeoVec()[adID].SensitiveVolume(adsID);
 
@@ -321,10 +415,10 @@ namespace sbnd::crt {
   }
 
   std::vector<double> CRTGeoAlg::StripWorldToLocalPos(const CRTStripGeo &strip, const double x, 
-                                                      const double y, const double z)
+                                                      const double y, const double z) const
   {
     const uint16_t adsID = strip.adsID;
-    const uint16_t adID  = fModules.at(strip.moduleName).adID;
+    const uint16_t adID  = GetModule(strip.moduleName).adID;
 
     const geo::AuxDetSensitiveGeo &auxDetSensitive = fAuxDetGeoCore->AuxDetGeoVec()[adID].SensitiveVolume(adsID);
 
@@ -336,13 +430,12 @@ namespace sbnd::crt {
   }
 
   std::vector<double> CRTGeoAlg::StripWorldToLocalPos(const uint16_t channel, const double x,
-                                                      const double y, const double z)
+                                                      const double y, const double z) const
   {
-    const CRTStripGeo strip = GetStrip(channel);
-    return StripWorldToLocalPos(strip, x, y, z);
+    return StripWorldToLocalPos(GetStrip(channel), x, y, z);
   }
 
-  std::array<double, 6> CRTGeoAlg::FEBWorldPos(const CRTModuleGeo &module)
+  std::array<double, 6> CRTGeoAlg::FEBWorldPos(const CRTModuleGeo &module) const
   {
     const geo::AuxDetGeo &auxDet = fAuxDetGeoCore->AuxDetGeoVec()[module.adID];
 
@@ -371,7 +464,7 @@ namespace sbnd::crt {
     return {minX, maxX, minY, maxY, minZ, maxZ};
   }
 
-  std::array<double, 6> CRTGeoAlg::FEBChannel0WorldPos(const CRTModuleGeo &module)
+  std::array<double, 6> CRTGeoAlg::FEBChannel0WorldPos(const CRTModuleGeo &module) const
   {
     const geo::AuxDetGeo &auxDet = fAuxDetGeoCore->AuxDetGeoVec()[module.adID];
 
@@ -408,24 +501,33 @@ namespace sbnd::crt {
 
   geo::Point_t CRTGeoAlg::ChannelToSipmPosition(const uint16_t channel) const
   {
-    const CRTSiPMGeo &sipm = fSiPMs.at(channel);
+    const CRTSiPMGeo &sipm = GetSiPM(channel);
     return {sipm.x, sipm.y, sipm.z};
   }
 
   std::pair<int, int> CRTGeoAlg::GetStripSipmChannels(const std::string stripName) const
   {
-    const CRTStripGeo &strip = fStrips.at(stripName);
+    const CRTStripGeo &strip = GetStrip(stripName);
     return std::make_pair(strip.channel0, strip.channel1);
   }
 
   double CRTGeoAlg::DistanceDownStrip(const geo::Point_t position, const std::string stripName) const
+  {
+    return DistanceDownStrip(position, GetStrip(stripName));
+  }
+
+  double CRTGeoAlg::DistanceDownStrip(const geo::Point_t position, const uint16_t channel) const
+  {
+    return DistanceDownStrip(position, GetStrip(channel));
+  }
+
+  double CRTGeoAlg::DistanceDownStrip(const geo::Point_t position, const CRTStripGeo &strip) const
   {
     // === TO-DO ===
     // This assumes that the CRT is arranged such that its three axes map onto the
     // three world axes. This would potentially not always be the case... e.g. using
     // an A-frame. We would need to amend this in that scenario.
 
-    const CRTStripGeo &strip = fStrips.at(stripName);
     double distance = std::numeric_limits<double>::max();
 
     const geo::Point_t pos = ChannelToSipmPosition(strip.channel0);
@@ -441,17 +543,10 @@ namespace sbnd::crt {
     return std::abs(distance);
   }
 
-  double CRTGeoAlg::DistanceDownStrip(const geo::Point_t position, const uint16_t channel) const
-  {
-    const CRTSiPMGeo sipm = fSiPMs.at(channel);
-
-    return DistanceDownStrip(position, sipm.stripName);
-  }
-
-  bool CRTGeoAlg::CheckOverlap(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer)
+  bool CRTGeoAlg::CheckOverlap(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer) const
   {
-    const CRTTagger tagger1 = CRTCommonUtils::GetTaggerEnum(ChannelToTaggerName(strip1.channel0));
-    const CRTTagger tagger2 = CRTCommonUtils::GetTaggerEnum(ChannelToTaggerName(strip2.channel0));
+    const CRTTagger tagger1 = ChannelToTaggerEnum(strip1.channel0);
+    const CRTTagger tagger2 = ChannelToTaggerEnum(strip2.channel0);
 
     if(tagger1 != tagger2)
       return false;
@@ -478,20 +573,17 @@ namespace sbnd::crt {
       }
   }
 
-  bool CRTGeoAlg::CheckOverlap(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer)
+  bool CRTGeoAlg::CheckOverlap(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer) const
   {
-    CRTStripGeo strip1 = GetStrip(channel1);
-    CRTStripGeo strip2 = GetStrip(channel2);
-
-    return CheckOverlap(strip1, strip2, overlap_buffer);
+    return CheckOverlap(GetStrip(channel1), GetStrip(channel2), overlap_buffer);
   }
 
-  bool CRTGeoAlg::AdjacentStrips(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer)
+  bool CRTGeoAlg::AdjacentStrips(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer) const
   {
-    CRTModuleGeo module1 = GetModule(strip1.channel0);
-    CRTModuleGeo module2 = GetModule(strip2.channel0);
+    const CRTChannelIndex &index1 = GetChannelIndex(strip1.channel0);
+    const CRTChannelIndex &index2 = GetChannelIndex(strip2.channel0);
 
-    if(module1.taggerName != module2.taggerName || module1.orientation != module2.orientation)
+    if(index1.tagger != index2.tagger || fModules[index1.module].orientation != fModules[index2.module].orientation)
       return false;
 
     const double minX = std::max(strip1.minX, strip2.minX);
@@ -514,42 +606,38 @@ namespace sbnd::crt {
       return false;
   }
 
-  bool CRTGeoAlg::AdjacentStrips(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer)
+  bool CRTGeoAlg::AdjacentStrips(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer) const
   {
-    CRTStripGeo strip1 = GetStrip(channel1);
-    CRTStripGeo strip2 = GetStrip(channel2);
-
-    return AdjacentStrips(strip1, strip2, overlap_buffer);
+    return AdjacentStrips(GetStrip(channel1), GetStrip(channel2), overlap_buffer);
   }
 
-  bool CRTGeoAlg::DifferentOrientations(const CRTStripGeo &strip1, const CRTStripGeo &strip2)
+  bool CRTGeoAlg::DifferentOrientations(const CRTStripGeo &strip1, const CRTStripGeo &strip2) const
   {
-    const CRTModuleGeo module1 = GetModule(strip1.moduleName);
-    const CRTModuleGeo module2 = GetModule(strip2.moduleName);
-
-    return module1.orientation != module2.orientation;
+    return GetModule(strip1.moduleName).orientation != GetModule(strip2.moduleName).orientation;
   }
 
-  enum CRTTagger CRTGeoAlg::WhichTagger(const double &x, const double &y, const double &z, const double &buffer)
+  enum CRTTagger CRTGeoAlg::WhichTagger(const double &x, const double &y, const double &z, const double &buffer) const
   {
-    for(auto const& [name, tagger] : fTaggers)
+    for(size_t i = 0; i < fTaggers.size(); ++i)
       {
+        const CRTTaggerGeo &tagger = fTaggers[i];
+
         if(x > tagger.minX - buffer &&
            x < tagger.maxX + buffer &&
            y > tagger.minY - buffer &&
            y < tagger.maxY + buffer &&
            z > tagger.minZ - buffer &&
            z < tagger.maxZ + buffer)
-          return CRTCommonUtils::GetTaggerEnum(name);
+          return fTaggerEnums[i];
       }
     return kUndefinedTagger;
   }
 
-  enum CoordSet CRTGeoAlg::GlobalConstrainedCoordinates(const uint16_t channel)
+  enum CoordSet CRTGeoAlg::GlobalConstrainedCoordinates(const uint16_t channel) const
   {
-    const std::string taggerName = ChannelToTaggerName(channel);
-    const CRTTagger tagger       = CRTCommonUtils::GetTaggerEnum(taggerName);
-    const uint16_t orientation   = GetModule(channel).orientation;
+    const CRTChannelIndex &index = GetChannelIndex(channel);
+    const CRTTagger tagger       = index.taggerEnum;
+    const uint16_t orientation   = fModules[index.module].orientation;
 
     const CoordSet widthdir    = CRTCommonUtils::GetStripWidthGlobalCoordinate(tagger, orientation);
     const CoordSet taggercoord = CRTCommonUtils::GetTaggerDefinedCoordinate(tagger);
@@ -557,9 +645,9 @@ namespace sbnd::crt {
     return widthdir | taggercoord;
   }
 
-  bool CRTGeoAlg::IsPointInsideCRTLimits(const geo::Point_t &point)
+  bool CRTGeoAlg::IsPointInsideCRTLimits(const geo::Point_t &point) const
   {
-    const std::vector<double> lims = CRTLimits();
+    const std::vector<double> &lims = fCRTLimits;
 
     return point.X() > lims[0] &&
            point.X() < lims[3] &&
@@ -29,6 +29,11 @@
 #include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
 
 // c++
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 // ROOT
@@ -254,6 +259,15 @@ namespace sbnd::crt {
     bool        null;
   };
 
+  // Positions in the CRTGeoAlg tables of the objects a channel belongs to
+  struct CRTChannelIndex{
+    uint32_t  sipm;
+    uint32_t  strip;
+    uint32_t  module;
+    uint32_t  tagger;
+    CRTTagger taggerEnum;
+  };
+
 
   class CRTGeoAlg {
   public:
@@ -265,6 +279,10 @@ namespace sbnd::crt {
 
     ~CRTGeoAlg();
 
+    // The CRT geometry built for this configuration and the current geometry services,
+    // shared by all the modules and algorithms of the job asking for the same one
+    static std::shared_ptr<const CRTGeoAlg> Shared(fhicl::ParameterSet const &p = fhicl::ParameterSet());
+
     std::vector<double> CRTLimits() const;
 
     size_t NumTaggers() const;
@@ -275,6 +293,8 @@ namespace sbnd::crt {
 
     size_t NumSiPMs() const;
 
+    // Copies keyed by name (channel for the SiPMs), intended for the event display
+    // and the analysis trees. Reconstruction should use the references below.
     std::map<std::string, CRTTaggerGeo> GetTaggers() const;
 
     std::map<std::string, CRTModuleGeo> GetModules() const;
@@ -283,21 +303,56 @@ namespace sbnd::crt {
 
     std::map<uint16_t, CRTSiPMGeo> GetSiPMs() const;
 
-    CRTTaggerGeo GetTagger(const std::string taggerName) const;
+    // Flat tables, taggers, modules and strips in name order and SiPMs in channel order
+    const std::vector<CRTTaggerGeo> &GetTaggerTable() const { return fTaggers; }
+
+    const std::vector<CRTModuleGeo> &GetModuleTable() const { return fModules; }
+
+    const std::vector<CRTStripGeo> &GetStripTable() const { return fStrips; }
+
+    const std::vector<CRTSiPMGeo> &GetSiPMTable() const { return fSiPMs; }
+
+    const CRTChannelIndex &GetChannelIndex(const uint16_t channel) const;
+
+    const CRTTaggerGeo &GetTaggerByIndex(const size_t i) const { return fTaggers.at(i); }
+
+    const CRTModuleGeo &GetModuleByIndex(const size_t i) const { return fModules.at(i); }
+
+    const CRTStripGeo &GetStripByIndex(const size_t i) const { return fStrips.at(i); }
+
+    size_t GetModuleIndexOfStrip(const size_t i) const { return fStripModule.at(i); }
+
+    size_t GetTaggerIndexOfModule(const size_t i) const { return fModuleTagger.at(i); }
 
-    CRTModuleGeo GetModule(const std::string moduleName) const;
+    const CRTTaggerGeo &GetTagger(const std::string taggerName) const;
 
-    CRTModuleGeo GetModule(const uint16_t channel) const;
+    const CRTTaggerGeo &GetTagger(const CRTTagger tagger) const;
 
-    CRTModuleGeo GetModuleByAuxDetIndex(const unsigned ad_i) const;
+    const CRTModuleGeo &GetModule(const std::string moduleName) const;
 
-    CRTStripGeo GetStrip(const std::string stripName) const;
+    const CRTModuleGeo &GetModule(const uint16_t channel) const;
 
-    CRTStripGeo GetStrip(const uint16_t channel) const;
+    const CRTModuleGeo &GetModuleByAuxDetIndex(const unsigned ad_i) const;
 
-    CRTStripGeo GetStripByAuxDetIndices(const unsigned ad_i, const unsigned ads_i) const;
+    const CRTStripGeo &GetStrip(const std::string stripName) const;
 
-    CRTSiPMGeo GetSiPM(const uint16_t channel) const;
+    const CRTStripGeo &GetStrip(const uint16_t channel) const;
+
+    const CRTStripGeo &GetStripByAuxDetIndices(const unsigned ad_i, const unsigned ads_i) const;
+
+    const CRTSiPMGeo &GetSiPM(const uint16_t channel) const;
+
+    // Calibration of a channel, read from dense per-channel arrays for the per-hit loops.
+    // The cable delay corrections and the inversion are those of the channel's module.
+    double SiPMGain(const uint16_t channel) const { CheckChannel(channel); return fChannelGain[channel]; }
+
+    uint32_t SiPMPedestal(const uint16_t channel) const { CheckChannel(channel); return fChannelPedestal[channel]; }
+
+    int32_t T0CableDelayCorrection(const uint16_t channel) const { CheckChannel(channel); return fChannelT0CableDelay[channel]; }
+
+    int32_t T1CableDelayCorrection(const uint16_t channel) const { CheckChannel(channel); return fChannelT1CableDelay[channel]; }
+
+    bool InvertedOrdering(const uint16_t channel) const { CheckChannel(channel); return fChannelInverted[channel]; }
 
     std::string GetTaggerName(const std::string name) const;
 
@@ -309,17 +364,17 @@ namespace sbnd::crt {
 
     size_t ChannelToOrientation(const uint16_t channel) const;
 
-    std::array<double, 6> StripHit3DPos(const uint16_t channel, const double x, const double ex);
+    std::array<double, 6> StripHit3DPos(const uint16_t channel, const double x, const double ex) const;
 
     std::vector<double> StripWorldToLocalPos(const CRTStripGeo &strip, const double x,
-                                             const double y, const double z);
+                                             const double y, const double z) const;
 
     std::vector<double> StripWorldToLocalPos(const uint16_t channel, const double x,
-                                             const double y, const double z);
+                                             const double y, const double z) const;
 
-    std::array<double, 6> FEBWorldPos(const CRTModuleGeo &module);
+    std::array<double, 6> FEBWorldPos(const CRTModuleGeo &module) const;
 
-    std::array<double, 6> FEBChannel0WorldPos(const CRTModuleGeo &module);
+    std::array<double, 6> FEBChannel0WorldPos(const CRTModuleGeo &module) const;
 
     geo::Point_t ChannelToSipmPosition(const uint16_t channel) const;
 
@@ -329,28 +384,58 @@ namespace sbnd::crt {
 
     double DistanceDownStrip(const geo::Point_t position, const uint16_t channel) const;
 
-    bool CheckOverlap(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer = 0.);
+    double DistanceDownStrip(const geo::Point_t position, const CRTStripGeo &strip) const;
+
+    bool CheckOverlap(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer = 0.) const;
 
-    bool CheckOverlap(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer = 0.);
+    bool CheckOverlap(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer = 0.) const;
 
-    bool AdjacentStrips(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer = 0.1);
+    bool AdjacentStrips(const CRTStripGeo &strip1, const CRTStripGeo &strip2, const double overlap_buffer = 0.1) const;
 
-    bool AdjacentStrips(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer = 0.1);
+    bool AdjacentStrips(const uint16_t channel1, const uint16_t channel2, const double overlap_buffer = 0.1) const;
 
-    bool DifferentOrientations(const CRTStripGeo &strip1, const CRTStripGeo &strip2);
+    bool DifferentOrientations(const CRTStripGeo &strip1, const CRTStripGeo &strip2) const;
 
-    enum CRTTagger WhichTagger(const double &x, const double &y, const double &z, const double &buffer = 1);
+    enum CRTTagger WhichTagger(const double &x, const double &y, const double &z, const double &buffer = 1) const;
 
-    enum CoordSet GlobalConstrainedCoordinates(const uint16_t channel);
+    enum CoordSet GlobalConstrainedCoordinates(const uint16_t channel) const;
 
-    bool IsPointInsideCRTLimits(const geo::Point_t &point);
+    bool IsPointInsideCRTLimits(const geo::Point_t &point) const;
 
   private:
 
-    std::map<std::string, CRTTaggerGeo> fTaggers;
-    std::map<std::string, CRTModuleGeo> fModules;
-    std::map<std::string, CRTStripGeo>  fStrips;
-    std::map<uint16_t, CRTSiPMGeo>      fSiPMs;
+    static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    void CheckChannel(const uint16_t channel) const
+    {
+      if(channel >= fChannelIndex.size() || fChannelIndex[channel].sipm == kInvalidIndex)
+        throw std::out_of_range("CRTGeoAlg: no SiPM on channel " + std::to_string(channel));
+    }
+
+    std::vector<CRTTaggerGeo> fTaggers;
+    std::vector<CRTModuleGeo> fModules;
+    std::vector<CRTStripGeo>  fStrips;
+    std::vector<CRTSiPMGeo>   fSiPMs;
+
+    std::vector<CRTTagger>       fTaggerEnums;   // per tagger
+    std::vector<uint32_t>        fModuleTagger;  // per module
+    std::vector<uint32_t>        fStripModule;   // per strip
+    std::vector<uint32_t>        fModuleByAdID;  // per aux det
+    std::vector<CRTChannelIndex> fChannelIndex;  // per channel, sipm is kInvalidIndex for unused channels
+
+    // Per channel calibration, zero for unused channels
+    std::vector<double>   fChannelGain;
+    std::vector<uint32_t> fChannelPedestal;
+    std::vector<int32_t>  fChannelT0CableDelay;
+    std::vector<int32_t>  fChannelT1CableDelay;
+    std::vector<char>     fChannelInverted;
+
+    std::map<std::string, uint32_t> fTaggerIndex;
+    std::map<std::string, uint32_t> fModuleIndex;
+    std::map<std::string, uint32_t> fStripIndex;
+
+    std::vector<double> fCRTLimits;
+    CRTModuleGeo        fVoidModule;
 
     geo::GeometryCore const       *fGeometryService;
     const geo::AuxDetGeometryCore *fAuxDetGeoCore;
@@ -1,5 +1,9 @@
 #include "TPCGeoAlg.h"
 
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+
 namespace sbnd{
 
 // Constructor - get values from the geometry service
@@ -23,6 +27,10 @@ TPCGeoAlg::TPCGeoAlg(){
       if (tpcg.MinZ() < fMinZ) fMinZ = tpcg.MinZ();
       if (tpcg.MaxZ() > fMaxZ) fMaxZ = tpcg.MaxZ();
       fCpaWidth = std::min(std::abs(tpcg.MinX()), std::abs(tpcg.MaxX()));
+
+      double driftDirection = tpcg.DetectDriftDirection();
+      if(std::abs(driftDirection) != 1) driftDirection = 0;
+      fTPCs.push_back({tpcg.ID(), tpcg.MinX(), tpcg.MaxX(), (int)driftDirection});
     }
   }
 
@@ -31,6 +39,14 @@ TPCGeoAlg::~TPCGeoAlg(){
 
 }
 
+// Look up the stored values of a TPC
+const TPCGeoAlg::TPCEntry& TPCGeoAlg::GetTPCEntry(const geo::TPCID& tpcID) const{
+  for(const auto& entry : fTPCs){
+    if(entry.id == tpcID) return entry;
+  }
+  throw cet::exception("TPCGeoAlg") << "No TPC with ID " << tpcID << " in the geometry\n";
+}
+
 // ----------------------------------------------------------------------------------
 // Getters
 double TPCGeoAlg::MinX() const{
@@ -91,7 +107,7 @@ bool TPCGeoAlg::InFiducial(geo::Point_t point, double minXCut, double minYCut, d
 
 // ----------------------------------------------------------------------------------
 // Determine which TPC a collection of hits is detected in (-1 if multiple) 
-int TPCGeoAlg::DetectedInTPC(std::vector<art::Ptr<recob::Hit>> hits){
+int TPCGeoAlg::DetectedInTPC(const std::vector<art::Ptr<recob::Hit>>& hits){
   // Return tpc of hit collection or -1 if in multiple
   if(hits.size() == 0) return -1;
   int tpc = hits[0]->WireID().TPC;
@@ -102,7 +118,7 @@ int TPCGeoAlg::DetectedInTPC(std::vector<art::Ptr<recob::Hit>> hits){
 }
 
 // Determine the drift direction for a collection of hits (-1, 0 or 1 assuming drift in X)
-int TPCGeoAlg::DriftDirectionFromHits(std::vector<art::Ptr<recob::Hit>> hits){
+int TPCGeoAlg::DriftDirectionFromHits(const std::vector<art::Ptr<recob::Hit>>& hits){
   // If there are no hits then return 0
   if(hits.size() == 0) return 0;
   
@@ -111,14 +127,11 @@ int TPCGeoAlg::DriftDirectionFromHits(std::vector<art::Ptr<recob::Hit>> hits){
 
   // Work out the drift direction
   geo::TPCID tpcID = hits[0]->WireID().asTPCID();
-  const geo::TPCGeo& tpcGeo = fGeometryService->GetElement(tpcID);
-  double driftDirection = tpcGeo.DetectDriftDirection();
-  if(std::abs(driftDirection) != 1) driftDirection = 0;
-  return driftDirection;
+  return GetTPCEntry(tpcID).driftDirection;
 }
 
 // Work out the drift limits for a collection of hits
-std::pair<double, double> TPCGeoAlg::XLimitsFromHits(std::vector<art::Ptr<recob::Hit>> hits){
+std::pair<double, double> TPCGeoAlg::XLimitsFromHits(const std::vector<art::Ptr<recob::Hit>>& hits){
   // If there are no hits then return 0
   if(hits.size() == 0) return std::make_pair(0, 0);
   
@@ -127,8 +140,8 @@ std::pair<double, double> TPCGeoAlg::XLimitsFromHits(std::vector<art::Ptr<recob:
 
   // Work out the drift direction
   geo::TPCID tpcID = hits[0]->WireID().asTPCID();
-  const geo::TPCGeo& tpcGeo = fGeometryService->GetElement(tpcID);
-  return std::make_pair(tpcGeo.MinX(), tpcGeo.MaxX());
+  const TPCEntry& tpc = GetTPCEntry(tpcID);
+  return std::make_pair(tpc.minX, tpc.maxX);
 }
 
 // Is point inside given TPC
@@ -142,18 +155,9 @@ bool TPCGeoAlg::InsideTPC(geo::Point_t point, const geo::TPCGeo& tpc, double buf
 // Minimum distance to a TPC wall
 double TPCGeoAlg::MinDistToWall(geo::Point_t point){
 
-  std::vector<double> dists;
-  
-  dists.push_back(std::abs(point.X() - fMinX));
-  dists.push_back(std::abs(point.X() - fMaxX));
-  dists.push_back(std::abs(point.Y() - fMinY));
-  dists.push_back(std::abs(point.Y() - fMaxY));
-  dists.push_back(std::abs(point.Z() - fMinZ));
-  dists.push_back(std::abs(point.Z() - fMaxZ));
-
-  std::sort(dists.begin(), dists.end());
-
-  return dists[0];
+  return std::min({std::abs(point.X() - fMinX), std::abs(point.X() - fMaxX),
+                   std::abs(point.Y() - fMinY), std::abs(point.Y() - fMaxY),
+                   std::abs(point.Z() - fMinZ), std::abs(point.Z() - fMaxZ)});
 
 }
 
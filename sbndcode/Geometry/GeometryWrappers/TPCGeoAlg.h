@@ -58,11 +58,11 @@ namespace sbnd{
     bool InsideTPC(geo::Point_t point, const geo::TPCGeo& tpc, double buffer=0.);
 
     // Determine which TPC a collection of hits is detected in (-1 if multiple)
-    int DetectedInTPC(std::vector<art::Ptr<recob::Hit>> hits);
+    int DetectedInTPC(const std::vector<art::Ptr<recob::Hit>>& hits);
     // Determine the drift direction for a collection of hits (-1, 0 or 1 assuming drift in X)
-    int DriftDirectionFromHits(std::vector<art::Ptr<recob::Hit>> hits);
+    int DriftDirectionFromHits(const std::vector<art::Ptr<recob::Hit>>& hits);
     // Work out the drift limits for a collection of hits
-    std::pair<double, double> XLimitsFromHits(std::vector<art::Ptr<recob::Hit>> hits);
+    std::pair<double, double> XLimitsFromHits(const std::vector<art::Ptr<recob::Hit>>& hits);
 
     double MinDistToWall(geo::Point_t point);
 
@@ -90,6 +90,17 @@ namespace sbnd{
     double fMaxZ;
     double fCpaWidth;
 
+    // Per-TPC values the hit queries need, filled once in the constructor
+    struct TPCEntry {
+      geo::TPCID id;
+      double minX;
+      double maxX;
+      int driftDirection; // -1, 0 or 1
+    };
+    std::vector<TPCEntry> fTPCs;
+
+    const TPCEntry& GetTPCEntry(const geo::TPCID& tpcID) const;
+
     geo::GeometryCore const* fGeometryService;
 
   };
@@ -0,0 +1,54 @@
+/**
+ * @file   SortByKey.h
+ * @brief  Sorting of geo::XXXGeo objects through precomputed sort keys.
+ *
+ * The geometry objects are heavy (a plane holds all its wires, a TPC all its
+ * planes) and their sorters query centres and ends on every comparison.
+ * `geo::details::SortByKey()` computes the key of each object once, sorts
+ * their indices and then moves each object into place a single time.
+ *
+ * `std::sort()` rearranges its range depending only on the outcome of the
+ * comparisons, so sorting the indices with a comparison of the keys that
+ * agrees with the one of the objects gives exactly the order that sorting
+ * the objects themselves would give, ties included.
+ */
+
+#ifndef SBNDCODE_GEOMETRY_SORTBYKEY_H
+#define SBNDCODE_GEOMETRY_SORTBYKEY_H
+
+// C/C++ standard libraries
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace geo::details {
+
+  /// Sorts `objs` as `std::sort(objs, cmp)` would, with `cmp` acting on `key(obj)`.
+  template <typename T, typename KeyFn, typename Cmp>
+  void SortByKey(std::vector<T>& objs, KeyFn key, Cmp cmp)
+  {
+    using Key_t = std::decay_t<decltype(key(objs.front()))>;
+
+    std::vector<Key_t> keys;
+    keys.reserve(objs.size());
+    for (T const& obj: objs) keys.push_back(key(obj));
+
+    std::vector<std::size_t> order(objs.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+
+    std::sort(order.begin(), order.end(),
+      [&keys, &cmp](std::size_t a, std::size_t b){ return cmp(keys[a], keys[b]); });
+
+    std::vector<T> sorted;
+    sorted.reserve(objs.size());
+    for (std::size_t i: order) sorted.push_back(std::move(objs[i]));
+    objs = std::move(sorted);
+
+  } // SortByKey()
+
+} // namespace geo::details
+
+#endif // SBNDCODE_GEOMETRY_SORTBYKEY_H
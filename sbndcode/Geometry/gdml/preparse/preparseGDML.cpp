@@ -34,6 +34,30 @@ struct aSetup{
 
 typedef std::map<std::string, double> Variables_t;
 
+// Values of the formulas evaluated so far: after the variable substitution
+// many lines share the same formulas, and compiling
+// a TFormula is by far the slowest step of the preparsing
+typedef std::map<std::string, double> FormulaCache_t;
+FormulaCache_t formulaCache;
+
+// Additional setups to write from the same preparsed files
+struct anExtraSetup{
+	TString setup;
+	TString outName;
+};
+std::vector<anExtraSetup> extraSetups;
+
+double evalFormula(TString const& text){
+
+	FormulaCache_t::const_iterator it = formulaCache.find(text.Data());
+	if(it != formulaCache.end()) return it->second;
+
+	TFormula formula("",text);
+	double value = formula.Eval(0);
+	formulaCache[text.Data()] = value;
+	return value;
+}
+
 bool isComment(TString key) {
 
 	int pos1 = key.Index("<!--");
@@ -60,10 +84,11 @@ void replaceVariable(TString &key, Variables_t const& variables ){
 	int i;
 	TString temp;
 	stream.precision(prec);
+	if (!key.Contains("=")) return;
 	for (it=variables.begin(); it!=variables.end(); ++it) { 
 		TString const& varName = it->first;
 		double value = it->second;
-		if (!key.Contains("=") || !key.Contains(varName) ) continue;
+		if (!key.Contains(varName) ) continue;
 		if (debug >= 3) {
 			std::cout.precision(prec);
 			std::cout << "REPLACING\t'" << varName << "'\t";
@@ -124,9 +149,8 @@ void getVariable(TString key, Variables_t& variables){
 	TString varValue = key;
 	varValue.Remove(pos);
 
-	TFormula formula("formula",varValue);
 	name = varName;
-	double value = formula.Eval(0);
+	double value = evalFormula(varValue);
 
 	if (debug >= 2) {
 		std::cout.precision(prec);
@@ -159,8 +183,7 @@ void evalFormulas(TString &key){
 		pos2 = key.First("\"");
 		TString varFormula = key;
 		varFormula.Remove(pos2);
-		TFormula formula("",varFormula);
-		double value = formula.Eval(0);
+		double value = evalFormula(varFormula);
 		if (debug >= 2) {
 			std::cout.precision(prec);
 			std::cout << "FML " << lookFor[i] << "='" << varFormula << "' => " << value << std::endl;
@@ -259,6 +282,66 @@ void getSetup(TString key, aSetup &theSetup){
 
 }
 
+// Finds the setup "name[:version]" among the ones of the file
+bool findSetup(std::vector<aSetup> const& stpList, TString setupName, aSetup &theSetup){
+
+	bool goAhead = true;
+
+	TString ver="1.0";
+	int pos=setupName.Index(":");
+	if(pos>=0){
+		ver=setupName;
+		ver.Replace(0,pos+1,"");
+		setupName.Replace(pos,setupName.Length()-pos,"");
+	}
+
+	// is the indicated setup among the ones available?
+	for (std::vector<aSetup>::const_iterator itx = stpList.begin() ; itx != stpList.end(); ++itx){
+
+		theSetup=(*itx);
+		if( theSetup.stpName==setupName && theSetup.stpVersion==ver ){ goAhead = true; break; }
+		else {goAhead = false;}
+	}
+
+	if (!goAhead) cout << "ERROR: Setup " << setupName << " or its version not found." << endl;
+	return goAhead;
+}
+
+// Writes a preparsed file with the world volume of the setup
+void applySetup(TString inName, TString outName, aSetup const& theSetup){
+
+	TString key;
+	ofstream output(outName);
+	ifstream input(inName);
+
+	bool inSetup=0;
+	do{
+		key.ReadLine(input,0);
+		if((!key.Contains("<setup") && !inSetup) ){
+			if (theSetup.stpWorldVolume != "volWorld") {
+				replaceKeyword(key,"volWorld","volIgnoredOnThisSetup");
+			}
+			if(!key.Contains("volumeref")) replaceKeyword(key,theSetup.stpWorldVolume,"volWorld");
+			output << key << endl;
+		}else {inSetup=1;}
+	}while(!input.eof());
+
+	output << "\t<setup name=\"Default\" version=\"1.0\">" << endl;
+	output << "\t\t<world ref=\"volWorld\" />" << endl;
+	output << "\t</setup>" << endl;
+	output << "</gdml_simple_extension>" << endl;
+	output.close();
+	input.close();
+}
+
+// Name of the file without wires that goes with a file name
+TString noWiresName(TString outName){
+	int pos = outName.Index(".gdml");
+	if(pos>=0) outName.Replace(pos,5,"_nowires.gdml");
+	else outName += "_nowires";
+	return outName;
+}
+
 int preparse(TString inName="sbnd_base.gdml", TString outName1="sbnd.gdml", TString outName2=""){
 	
 	std::cout << "Preparsing '" << inName << "'"
@@ -358,36 +441,24 @@ int preparse(TString inName="sbnd_base.gdml", TString outName1="sbnd.gdml", TStr
 	if(!noWiresFiles) output2.close();
 	input.close();
 
-	bool goAhead = true;
-	if (!setupChoice) mySetup = "Default";
+	TString setupName = setupChoice? mySetup: TString("Default");
 
-	TString ver="1.0";
-	int pos=mySetup.Index(":");
-	if(pos>=0){
-		ver=mySetup;
-		ver.Replace(0,pos+1,"");
-		mySetup.Replace(pos,mySetup.Length()-pos,"");
-	}
+	TString outNameVec[]={outName1,outName2};
+	const int kmax = 1+(!noWiresFiles);
 
-	// is the indicated setup among the ones available?
-	for (std::vector<aSetup>::iterator itx = stpList.begin() ; itx != stpList.end(); ++itx){
-
-		theSetup=(*itx);
-		if( theSetup.stpName==mySetup && theSetup.stpVersion==ver ){ goAhead = true; break; }
-		else {goAhead = false;}
+	// the additional setups are written from the same preparsed files
+	for (anExtraSetup const& extra: extraSetups){
+		if (!findSetup(stpList,extra.setup,theSetup)) continue;
+		TString extraNameVec[]={extra.outName,noWiresName(extra.outName)};
+		for(int k=0; k<kmax; k++){
+			std::cout << "Writing '" << extraNameVec[k] << "' (setup " << extra.setup << ")" << std::endl;
+			applySetup(outNameVec[k], extraNameVec[k], theSetup);
+		}
 	}
 
-	if (!goAhead) {
-		cout << "ERROR: Setup " << mySetup << " or its version not found." << endl;
-	} else {
-
-		TString inName1, inName2, comm;
-		inName1 = outName1+"~";
-		inName2 = outName2+"~";
-		TString inNameVec[]={inName1,inName2};
-		TString outNameVec[]={outName1,outName2};
+	if (findSetup(stpList,setupName,theSetup)) {
 
-		const int kmax = 1+(!noWiresFiles);
+		TString inNameVec[]={outName1+"~",outName2+"~"};
 
 		for(int k=0; k<kmax; k++){
 			errno = 0;
@@ -397,27 +468,7 @@ int preparse(TString inName="sbnd_base.gdml", TString outName1="sbnd.gdml", TStr
 			    << strerror(errno) << std::endl;
         return errno;
 			}
-			output1.open(outNameVec[k]);
-			ifstream input1(inNameVec[k]);
-
-			inSetup=0;
-			do{
-				key.ReadLine(input1,0);
-				if((!key.Contains("<setup") && !inSetup) ){
-					if (theSetup.stpWorldVolume != "volWorld") {
-						replaceKeyword(key,"volWorld","volIgnoredOnThisSetup");
-					}
-					if(!key.Contains("volumeref")) replaceKeyword(key,theSetup.stpWorldVolume,"volWorld");
-					output1 << key << endl;
-				}else {inSetup=1;}
-			}while(!input1.eof());
-
-			output1 << "\t<setup name=\"Default\" version=\"1.0\">" << endl;
-			output1 << "\t\t<world ref=\"volWorld\" />" << endl;
-			output1 << "\t</setup>" << endl;
-			output1 << "</gdml_simple_extension>" << endl;
-			output1.close();
-			input1.close();
+			applySetup(inNameVec[k], outNameVec[k], theSetup);
 			remove(inNameVec[k]);
 		}
 	}
@@ -439,6 +490,7 @@ void parseArguments(unsigned int argc, char** argv) {
     { "sci",       optional_argument, NULL, 's' },
     { "prec",      required_argument, NULL, 'p' },
     { "setup",     required_argument, NULL, 'S' },
+    { "also",      required_argument, NULL, 'a' },
     { "debug",     optional_argument, NULL, 'd' },
     { "help",      no_argument,       NULL, 'h' },
     { NULL,        0,                 NULL,  0  }
@@ -473,6 +525,20 @@ void parseArguments(unsigned int argc, char** argv) {
         setupChoice = true;
         mySetup = optarg;
         continue;
+      case 'a': // -a, --also
+        {
+          TString par = optarg;
+          int pos = par.Last(',');
+          if (pos <= 0 || pos == par.Length() - 1)
+            throw std::runtime_error("Invalid setup,outputname in -a option.");
+          anExtraSetup extra;
+          extra.setup = par;
+          extra.setup.Remove(pos);
+          extra.outName = par;
+          extra.outName.Replace(0, pos + 1, "");
+          extraSetups.push_back(extra);
+        }
+        continue;
       case 's': // -s, --sci
         sci = true;
         if (optarg) {
@@ -546,6 +612,9 @@ int main(int argc, char **argv)
 		  "\n    Uses this file name as main output name"
 		  "\n-S , --setup=setupname"
 		  "\n    Uses the specified setup name instead of default one"
+		  "\n-a , --also=setupname,outputname"
+		  "\n    Also writes outputname (and its _nowires version) with the specified setup,"
+		  "\n    from the same preparsing pass; can be repeated"
 		  "\n-d , --debug"
 		  "\n    Enable debugging messages"
 		  "\n"
@@ -557,6 +626,9 @@ int main(int argc, char **argv)
 		  "\n  " << programName << " geometry_base.gdml -setup Cryostat:1.0"
 		  "\n    Outputs geometry.gdml making setup Cryostat (version 1.0) the volWorld required by LArSoft."
 		  "\n"
+		  "\n  " << programName << " geometry_base.gdml -w --also DefaultWithShielding,geometry_withshielding.gdml"
+		  "\n    Outputs geometry.gdml, geometry_nowires.gdml and their versions with setup DefaultWithShielding."
+		  "\n"
 		  << endl;
 		return 0;
 	}
@@ -93,7 +93,14 @@ mrbslp
 
 cd $_CONDOR_SCRATCH_DIR
 
+# with NWORKERS set, the job takes that many cores of the node through
+# run_lar_multi.sh (one lar process with NWORKERS threads; add
+# "-m processes" for that many lar processes on disjoint event ranges)
+if [ -n "$NWORKERS" ]; then
+bash ${CONDOR_DIR_INPUT:-.}/run_lar_multi.sh -c prodsingle_sbnd.fcl -n 5 -j ${NWORKERS} -o test.root -T test_hist.root &> output_${CLUSTER}.${PROCESS}.log
+else
 lar -c prodsingle_sbnd.fcl -n 5 -o test.root -T test_hist.root &> output_${CLUSTER}.${PROCESS}.log
+fi
 
 
 
@@ -0,0 +1,115 @@
+#!/bin/bash
+#
+# run_lar_multi.sh: runs one lar job on all the cores of a node.
+#
+# The geometry, the signal shaping, the photon visibility and the channel
+# maps are loaded once per lar process. Two ways of running N workers:
+#
+#  threads   (default) one lar process with N schedules and N threads: the
+#            services are made once and shared by all the events in flight,
+#            and there is one output file. The modules that are not yet
+#            thread safe run one event at a time (art serializes legacy and
+#            "one" modules), so the speed up depends on the configuration.
+#  processes N lar processes, each with its own disjoint range of events and
+#            its own output files (<name>_<worker>.root), as N grid jobs would.
+#
+# Usage:
+#   run_lar_multi.sh -c <fcl> -n <events> [-j <workers>] [-s <skip>]
+#                    [-o <output.root>] [-T <hist.root>] [-m threads|processes]
+#                    [-- <more lar options>]
+#
+# -j defaults to the number of cores. In processes mode the events
+# [skip, skip + events) are split into N consecutive ranges, and each
+# worker runs in its own directory worker_<n>, with its log in lar.log.
+# Generation jobs get different events in each worker as long as the
+# seeds are not fixed in the configuration (the default "random" policy
+# of NuRandomService, see seedservice_sbnd.fcl).
+#
+
+usage() {
+  sed -n '3,27p' "$0" | sed 's/^# \{0,1\}//'
+  exit 1
+}
+
+config=""
+nevents=""
+nworkers=$(nproc)
+nskip=0
+output=""
+histos=""
+mode="threads"
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -c) config="$2"; shift 2 ;;
+    -n) nevents="$2"; shift 2 ;;
+    -j) nworkers="$2"; shift 2 ;;
+    -s) nskip="$2"; shift 2 ;;
+    -o) output="$2"; shift 2 ;;
+    -T) histos="$2"; shift 2 ;;
+    -m) mode="$2"; shift 2 ;;
+    --) shift; break ;;
+    -h|--help) usage ;;
+    *) echo "Unknown option $1"; usage ;;
+  esac
+done
+extra=("$@")
+
+if [ -z "$config" ] || [ -z "$nevents" ]; then
+  usage
+fi
+
+if [ "$mode" = "threads" ]; then
+
+  args=(-c "$config" -n "$nevents" --nskip "$nskip" --nschedules "$nworkers" --nthreads "$nworkers")
+  [ -n "$output" ] && args+=(-o "$output")
+  [ -n "$histos" ] && args+=(-T "$histos")
+  echo "lar ${args[*]} ${extra[*]}"
+  exec lar "${args[@]}" "${extra[@]}"
+
+elif [ "$mode" = "processes" ]; then
+
+  # absolute paths, since each worker runs in its own directory
+  workdir=$(pwd)
+  if [ -f "$config" ] && [ "${config#/}" = "$config" ]; then
+    config="$workdir/$config"
+  fi
+
+  # <dir>/<name>.root -> <dir>/<name>_<worker>.root, next to the original
+  worker_file() {
+    local file="$1" worker="$2"
+    case "$file" in /*) ;; *) file="$workdir/$file" ;; esac
+    echo "${file%.root}_${worker}.root"
+  }
+
+  pids=()
+  first=$nskip
+  for (( worker = 0; worker < nworkers; ++worker )); do
+    # consecutive ranges, the first ones one event longer when not even
+    count=$(( nevents / nworkers + (worker < nevents % nworkers ? 1 : 0) ))
+    [ "$count" -eq 0 ] && break
+
+    args=(-c "$config" -n "$count" --nskip "$first")
+    [ -n "$output" ] && args+=(-o "$(worker_file "$output" "$worker")")
+    [ -n "$histos" ] && args+=(-T "$(worker_file "$histos" "$worker")")
+
+    mkdir -p "worker_${worker}"
+    echo "worker ${worker}: lar ${args[*]} ${extra[*]}"
+    ( cd "worker_${worker}" && exec lar "${args[@]}" "${extra[@]}" &> lar.log ) &
+    pids+=($!)
+    first=$(( first + count ))
+  done
+
+  status=0
+  for (( worker = 0; worker < ${#pids[@]}; ++worker )); do
+    if ! wait "${pids[$worker]}"; then
+      echo "worker ${worker} failed, see worker_${worker}/lar.log"
+      status=1
+    fi
+  done
+  exit $status
+
+else
+  echo "Unknown mode ${mode}"
+  usage
+fi
@@ -34,6 +34,7 @@
 
 // c++ includes
 #include <vector>
+#include <memory>
 #include <math.h>
 #include <iomanip>
 #include <iostream>
@@ -41,6 +42,7 @@
 
 // LArSoft includes
 #include "sbndcode/MCTruthExtractor/alg/NuAnaAlg.h"
+#include "sbndcode/MCTruthExtractor/NuTruthTree.h"
 
 
 
@@ -60,6 +62,9 @@ namespace sbnd{
 
   private:
 
+    // Copy the variables of the event tree into the flat truth record
+    void fillTruthRecord(const art::Event& evt, NuTruthRecord& record) const;
+
     // This alg does all of the computing, while this module interfaces with
     // art and packs all of the variables into the ttree
     NuAnaAlg fNuAnaAlg;
@@ -86,6 +91,9 @@ namespace sbnd{
 
     unsigned int FinalRandSeed;
 
+    bool fVectorTruthTree;  // write the EventsTot tree of vectors
+    bool fFlatTruthTree;    // write the flat TruthFlat tree
+
     std::vector< std::vector<float> > reweightingSigmas;
 
     // #---------------------------------------------------------------
@@ -93,6 +101,7 @@ namespace sbnd{
     // #---------------------------------------------------------------
     // These are the ttrees themselves:
     TTree* fTreeTot;    //This tree stores all the important information from an event
+    std::unique_ptr<NuTruthTreeWriter> fFlatTree; // Same summary in flat columns
     // TTree* PoTTree;     //This tree only stores the POT of the file, nothing else.
 
     std::vector<std::vector<float> > eventWeights;
@@ -189,6 +198,9 @@ namespace sbnd{
     , fWeights          (pset.get< std::vector<std::string> > ("Weights"))
     , fRandSeed         (pset.get< unsigned int >             ("RandSeed"))
     , fNWeights         (pset.get< int >                      ("NWeights"))
+    , fVectorTruthTree  (pset.get< bool >                     ("VectorTruthTree", true))
+    , fFlatTruthTree    (pset.get< bool >                     ("FlatTruthTree", false))
+    , fTreeTot(nullptr)
   {
 
     // This function sets up the ttrees
@@ -197,6 +209,14 @@ namespace sbnd{
 
     // PoTTree  = tfs->make<TTree>("POT", "POT");
 
+    if (fFlatTruthTree){
+      fFlatTree = std::make_unique<NuTruthTreeWriter>(
+        tfs->make<TTree>("TruthFlat", "Flat truth summary of each event"));
+    }
+
+    // The flat tree needs no dictionary, the vector tree does
+    if (!fVectorTruthTree) return;
+
     std::ofstream libraryFile;
     libraryFile.open("loadLibs.C");
     libraryFile << "#include <vector>\n";
@@ -313,8 +333,9 @@ namespace sbnd{
 
     // This method takes ANYTHING that goes into the ntuple and sets it to default.
 
-    // Start by making sure the appropriate vectors are cleared and emptied:
-    eventWeights.clear();
+    // Start by making sure the appropriate vectors are cleared and emptied.
+    // eventWeights keeps its shape from event to event: the flux and xsec
+    // weights overwrite every entry, so its columns are only allocated once.
     leptonPos.clear();
     leptonMom.clear();
     p1PhotonConversionPos.clear();
@@ -516,12 +537,83 @@ namespace sbnd{
     }
 
     // Fill the ttree:
-    fTreeTot->Fill();
+    if (fTreeTot) fTreeTot->Fill();
+
+    if (fFlatTree){
+      fillTruthRecord(evt, fFlatTree->Record());
+      fFlatTree->Fill();
+    }
 
 
     return;
   }
 
+  void NuAna::fillTruthRecord(const art::Event& evt, NuTruthRecord& r) const{
+
+    r.clear();
+
+    r.run    = evt.run();
+    r.subRun = evt.subRun();
+    r.event  = evt.event();
+    r.POT    = POT;
+
+    r.iflux  = iflux;
+    r.nuchan = nuchan;
+    r.inno   = inno;
+    r.isCC   = isCC;
+    r.mode   = mode;
+    r.enugen = enugen;
+    r.nuleng = nuleng;
+    NuTruthRecord::copy(r.neutMom, neutMom);
+    NuTruthRecord::copy(r.vertex, vertex);
+
+    r.Elep     = Elep;
+    r.thetaLep = thetaLep;
+    r.phiLep   = phiLep;
+    r.nLeptonPoints = leptonPos.size();
+    bool const hasLepton = !leptonPos.empty();
+    NuTruthRecord::copy4(r.leptonStartPos, hasLepton ? &leptonPos.front() : nullptr);
+    NuTruthRecord::copy4(r.leptonStartMom, hasLepton ? &leptonMom.front() : nullptr);
+    NuTruthRecord::copy4(r.leptonEndPos,   hasLepton ? &leptonPos.back()  : nullptr);
+    NuTruthRecord::copy4(r.leptonEndMom,   hasLepton ? &leptonMom.back()  : nullptr);
+
+    r.ptype  = ptype;
+    r.tptype = tptype;
+    r.ndecay = ndecay;
+    NuTruthRecord::copy(r.neutVertexInWindow,    neutVertexInWindow);
+    NuTruthRecord::copy(r.ParentVertex,          ParentVertex);
+    NuTruthRecord::copy(r.nuParentMomAtDecay,    nuParentMomAtDecay);
+    NuTruthRecord::copy(r.nuParentMomAtProd,     nuParentMomAtProd);
+    NuTruthRecord::copy(r.nuParentMomTargetExit, nuParentMomTargetExit);
+
+    r.NPi0FinalState  = NPi0FinalState;
+    r.NGamma          = NGamma;
+    r.NChargedPions   = NChargedPions;
+    r.foundAllPhotons = foundAllPhotons;
+
+    r.GeniePDG.assign(GeniePDG.begin(), GeniePDG.end());
+    NuTruthRecord::append4(r.GenieMomentum, GenieMomentum);
+
+    if (!fFullOscTrue){
+      NuTruthRecord::append4(r.p1PhotonConversionPos,   p1PhotonConversionPos);
+      NuTruthRecord::append4(r.p1PhotonConversionMom,   p1PhotonConversionMom);
+      NuTruthRecord::append4(r.p2PhotonConversionPos,   p2PhotonConversionPos);
+      NuTruthRecord::append4(r.p2PhotonConversionMom,   p2PhotonConversionMom);
+      NuTruthRecord::append4(r.miscPhotonConversionPos, miscPhotonConversionPos);
+      NuTruthRecord::append4(r.miscPhotonConversionMom, miscPhotonConversionMom);
+      NuTruthRecord::append4(r.pionPos,                 pionPos);
+      NuTruthRecord::append4(r.pionMom,                 pionMom);
+      r.chargedPionSign.assign(chargedPionSign.begin(), chargedPionSign.end());
+    }
+
+    if (fFluxReweight || fXSecReweight){
+      r.nWeightSets = eventWeights.size();
+      for (auto const& set : eventWeights) r.weights.insert(r.weights.end(), set.begin(), set.end());
+    }
+
+    return;
+  }
+
   DEFINE_ART_MODULE(NuAna)
 
 
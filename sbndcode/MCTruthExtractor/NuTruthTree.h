@@ -0,0 +1,236 @@
+#ifndef SBND_NUTRUTHTREE_H
+#define SBND_NUTRUTHTREE_H
+
+// Flat truth summary of a NuAna event and the tree it is written to.
+//
+// NuTruthRecord holds the same neutrino, flux, GENIE and larg4 summary as
+// the EventsTot tree, but as plain 32-bit numbers: fixed-size arrays for
+// the event quantities, and for the lists (GENIE final state particles,
+// photon conversions, pion decays, weights) one column per quantity with
+// a counter. 4-vectors are stored as (x, y, z, t) and (px, py, pz, E), in
+// the order pack4Vector writes them. The tree only has leaf-list branches
+// of float and int, so it needs no dictionary to be written or read and
+// loads straight into arrays, e.g. with RDataFrame or uproot.
+//
+// The lepton trajectory is summarised by its first and last points, and
+// the charged pions by their number and signs; the full trajectories stay
+// in EventsTot.
+
+#include "TTree.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sbnd{
+
+  struct NuTruthRecord {
+
+    // Event
+    int32_t run, subRun, event;
+    float   POT;
+
+    // Neutrino
+    int32_t iflux, nuchan, inno, isCC, mode;
+    float   enugen, nuleng;
+    float   neutMom[4];
+    float   vertex[3];
+
+    // Lepton
+    float   Elep, thetaLep, phiLep;
+    int32_t nLeptonPoints;
+    float   leptonStartPos[4], leptonStartMom[4];
+    float   leptonEndPos[4], leptonEndMom[4];
+
+    // Flux
+    int32_t ptype, tptype, ndecay;
+    float   neutVertexInWindow[3];
+    float   ParentVertex[3];
+    float   nuParentMomAtDecay[3];
+    float   nuParentMomAtProd[3];
+    float   nuParentMomTargetExit[3];
+
+    // Final state counts
+    int32_t NPi0FinalState, NGamma, NChargedPions;
+    int32_t foundAllPhotons;
+
+    // GENIE final state particles
+    std::vector<int32_t> GeniePDG;
+    std::vector<float>   GenieMomentum;         // 4 per particle
+
+    // larg4 photon conversions and neutral pion decays, 4 per entry
+    std::vector<float>   p1PhotonConversionPos, p1PhotonConversionMom;
+    std::vector<float>   p2PhotonConversionPos, p2PhotonConversionMom;
+    std::vector<float>   miscPhotonConversionPos, miscPhotonConversionMom;
+    std::vector<float>   pionPos, pionMom;
+    std::vector<int32_t> chargedPionSign;
+
+    // Weights, nWeightSets sets of the same length one after the other
+    int32_t nWeightSets;
+    std::vector<float>   weights;
+
+    // Appends a list of 4-vectors to a column
+    static void append4(std::vector<float>& column, const std::vector<std::vector<float>>& vectors)
+    {
+      for (auto const& v : vectors){
+        for (size_t i = 0; i < 4; i++) column.push_back(i < v.size() ? v[i] : 0.f);
+      }
+    }
+
+    // Copies the first 4 values of a vector into an array, -999 if missing
+    static void copy4(float (&out)[4], const std::vector<float>* v)
+    {
+      for (size_t i = 0; i < 4; i++) out[i] = (v && i < v->size()) ? (*v)[i] : -999.f;
+    }
+
+    template <size_t N>
+    static void copy(float (&out)[N], const std::vector<float>& v)
+    {
+      for (size_t i = 0; i < N; i++) out[i] = i < v.size() ? v[i] : -999.f;
+    }
+
+    void clear()
+    {
+      GeniePDG.clear();
+      GenieMomentum.clear();
+      p1PhotonConversionPos.clear();
+      p1PhotonConversionMom.clear();
+      p2PhotonConversionPos.clear();
+      p2PhotonConversionMom.clear();
+      miscPhotonConversionPos.clear();
+      miscPhotonConversionMom.clear();
+      pionPos.clear();
+      pionMom.clear();
+      chargedPionSign.clear();
+      weights.clear();
+      nWeightSets = 0;
+    }
+  };
+
+
+  // Writes NuTruthRecords to a TTree of leaf-list branches
+  class NuTruthTreeWriter {
+  public:
+
+    explicit NuTruthTreeWriter(TTree* tree) : fTree(tree)
+    {
+      NuTruthRecord& r = fRecord;
+      fTree->Branch("run",    &r.run,    "run/I");
+      fTree->Branch("subRun", &r.subRun, "subRun/I");
+      fTree->Branch("event",  &r.event,  "event/I");
+      fTree->Branch("POT",    &r.POT,    "POT/F");
+
+      fTree->Branch("iflux",   &r.iflux,   "iflux/I");
+      fTree->Branch("nuchan",  &r.nuchan,  "nuchan/I");
+      fTree->Branch("inno",    &r.inno,    "inno/I");
+      fTree->Branch("isCC",    &r.isCC,    "isCC/I");
+      fTree->Branch("mode",    &r.mode,    "mode/I");
+      fTree->Branch("enugen",  &r.enugen,  "enugen/F");
+      fTree->Branch("nuleng",  &r.nuleng,  "nuleng/F");
+      fTree->Branch("neutMom", r.neutMom,  "neutMom[4]/F");
+      fTree->Branch("vertex",  r.vertex,   "vertex[3]/F");
+
+      fTree->Branch("Elep",           &r.Elep,          "Elep/F");
+      fTree->Branch("ThetaLep",       &r.thetaLep,      "ThetaLep/F");
+      fTree->Branch("PhiLep",         &r.phiLep,        "PhiLep/F");
+      fTree->Branch("nLeptonPoints",  &r.nLeptonPoints, "nLeptonPoints/I");
+      fTree->Branch("leptonStartPos", r.leptonStartPos, "leptonStartPos[4]/F");
+      fTree->Branch("leptonStartMom", r.leptonStartMom, "leptonStartMom[4]/F");
+      fTree->Branch("leptonEndPos",   r.leptonEndPos,   "leptonEndPos[4]/F");
+      fTree->Branch("leptonEndMom",   r.leptonEndMom,   "leptonEndMom[4]/F");
+
+      fTree->Branch("ptype",  &r.ptype,  "ptype/I");
+      fTree->Branch("tptype", &r.tptype, "tptype/I");
+      fTree->Branch("ndecay", &r.ndecay, "ndecay/I");
+      fTree->Branch("neutVertexInWindow",    r.neutVertexInWindow,    "neutVertexInWindow[3]/F");
+      fTree->Branch("ParentVertex",          r.ParentVertex,          "ParentVertex[3]/F");
+      fTree->Branch("nuParentMomAtDecay",    r.nuParentMomAtDecay,    "nuParentMomAtDecay[3]/F");
+      fTree->Branch("nuParentMomAtProd",     r.nuParentMomAtProd,     "nuParentMomAtProd[3]/F");
+      fTree->Branch("nuParentMomTargetExit", r.nuParentMomTargetExit, "nuParentMomTargetExit[3]/F");
+
+      fTree->Branch("NPi0FinalState", &r.NPi0FinalState,  "NPi0FinalState/I");
+      fTree->Branch("NGamma",         &r.NGamma,          "NGamma/I");
+      fTree->Branch("NChargedPions",  &r.NChargedPions,   "NChargedPions/I");
+      fTree->Branch("FoundAllPhotons",&r.foundAllPhotons, "FoundAllPhotons/I");
+
+      // Counters of the list columns, set from the column sizes on Fill()
+      fTree->Branch("nGenie",          &fNGenie,          "nGenie/I");
+      fTree->Branch("nP1Photon",       &fNP1Photon,       "nP1Photon/I");
+      fTree->Branch("nP2Photon",       &fNP2Photon,       "nP2Photon/I");
+      fTree->Branch("nMiscPhoton",     &fNMiscPhoton,     "nMiscPhoton/I");
+      fTree->Branch("nPion",           &fNPion,           "nPion/I");
+      fTree->Branch("nChargedPion",    &fNChargedPion,    "nChargedPion/I");
+      fTree->Branch("nWeightSets",     &r.nWeightSets,    "nWeightSets/I");
+      fTree->Branch("nWeights",        &fNWeights,        "nWeights/I");
+
+      ListBranch("GeniePDG",                "nGenie",       "/I");
+      ListBranch("GenieMomentum",           "nGenie",       "[4]/F");
+      ListBranch("p1PhotonConversionPos",   "nP1Photon",    "[4]/F");
+      ListBranch("p1PhotonConversionMom",   "nP1Photon",    "[4]/F");
+      ListBranch("p2PhotonConversionPos",   "nP2Photon",    "[4]/F");
+      ListBranch("p2PhotonConversionMom",   "nP2Photon",    "[4]/F");
+      ListBranch("miscPhotonConversionPos", "nMiscPhoton",  "[4]/F");
+      ListBranch("miscPhotonConversionMom", "nMiscPhoton",  "[4]/F");
+      ListBranch("PionPos",                 "nPion",        "[4]/F");
+      ListBranch("PionMom",                 "nPion",        "[4]/F");
+      ListBranch("ChargedPionSign",         "nChargedPion", "/I");
+      ListBranch("Weights",                 "nWeights",     "/F");
+    }
+
+    // The record to fill before each Fill()
+    NuTruthRecord& Record() { return fRecord; }
+
+    void Fill()
+    {
+      NuTruthRecord& r = fRecord;
+      fNGenie       = r.GeniePDG.size();
+      fNP1Photon    = r.p1PhotonConversionPos.size()/4;
+      fNP2Photon    = r.p2PhotonConversionPos.size()/4;
+      fNMiscPhoton  = r.miscPhotonConversionPos.size()/4;
+      fNPion        = r.pionPos.size()/4;
+      fNChargedPion = r.chargedPionSign.size();
+      fNWeights     = r.weights.size();
+
+      // The columns may have moved since the last event
+      SetAddress("GeniePDG",                r.GeniePDG);
+      SetAddress("GenieMomentum",           r.GenieMomentum);
+      SetAddress("p1PhotonConversionPos",   r.p1PhotonConversionPos);
+      SetAddress("p1PhotonConversionMom",   r.p1PhotonConversionMom);
+      SetAddress("p2PhotonConversionPos",   r.p2PhotonConversionPos);
+      SetAddress("p2PhotonConversionMom",   r.p2PhotonConversionMom);
+      SetAddress("miscPhotonConversionPos", r.miscPhotonConversionPos);
+      SetAddress("miscPhotonConversionMom", r.miscPhotonConversionMom);
+      SetAddress("PionPos",                 r.pionPos);
+      SetAddress("PionMom",                 r.pionMom);
+      SetAddress("ChargedPionSign",         r.chargedPionSign);
+      SetAddress("Weights",                 r.weights);
+
+      fTree->Fill();
+    }
+
+  private:
+
+    // Variable length branch of a column; the address is set on Fill()
+    void ListBranch(const std::string& name, const std::string& counter, const std::string& type)
+    {
+      fTree->Branch(name.c_str(), &fDummy, (name + "[" + counter + "]" + type).c_str());
+    }
+
+    template <typename T>
+    void SetAddress(const char* name, std::vector<T>& column)
+    {
+      // an empty column still needs a valid address
+      if (column.capacity() == 0) column.reserve(4);
+      fTree->SetBranchAddress(name, column.data());
+    }
+
+    TTree* fTree;
+    NuTruthRecord fRecord{};
+    int32_t fNGenie = 0, fNP1Photon = 0, fNP2Photon = 0, fNMiscPhoton = 0;
+    int32_t fNPion = 0, fNChargedPion = 0, fNWeights = 0;
+    float fDummy[4] = {};
+  };
+
+}
+
+#endif
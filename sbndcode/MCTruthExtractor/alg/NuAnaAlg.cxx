@@ -265,6 +265,15 @@ namespace sbnd{
     if (weights.size() != reweightVector.size())
       weights.resize(reweightVector.size());
 
+    // The conversion to a GENIE event record does not depend on the knobs,
+    // so do it once for the event rather than once per reweight object
+    // (all the rows hold the same number of weight points, so none may be empty here)
+    if (reweightVector.empty() || reweightVector.back().empty()){
+      for (auto & row : weights) row.clear();
+      return;
+    }
+    genie::EventRecord evr = reweightVector.back().front() -> RetrieveGHEP(mctruth,gtruth);
+
     for (unsigned int i_weight = 0; i_weight < reweightVector.size(); i_weight ++){
       if (weights[i_weight].size() != reweightVector[i_weight].size()){
         weights[i_weight].resize(reweightVector[i_weight].size());
@@ -275,7 +284,7 @@ namespace sbnd{
       {
         weights[i_weight][i_reweightingKnob]
           = reweightVector[i_weight][i_reweightingKnob]
-            -> CalcWeight(mctruth,gtruth);
+            -> CalculateWeight(evr);
       }
     }
 
@@ -378,6 +387,9 @@ namespace sbnd{
     int i = 0;
     std::vector<float> tempMomentum;
     tempMomentum.resize(4);
+    GeniePDG.reserve(GeniePDG.size() + truth.NParticles());
+    GenieMomentum.reserve(GenieMomentum.size() + truth.NParticles());
+    GenieProc.reserve(GenieProc.size() + truth.NParticles());
     while( i < truth.NParticles()){
       auto part = truth.GetParticle(i);
       if (part.StatusCode() == 1){
@@ -686,7 +698,6 @@ namespace sbnd{
       // This is getting the flux weights from the flux object.
       // It's a total hack, it's hardcoded, and requires a custom version of
       // the nutools software.
-      eventReweight.clear();
       eventReweight.resize(7);
       for (int i = 0; i < 7; i ++)
       {
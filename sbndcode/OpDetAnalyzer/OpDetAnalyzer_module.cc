@@ -88,6 +88,8 @@ private:
 
   int fVerbosity; // debugging
 
+  bool fSaveAllPhotons; // one AllPhotons entry per photon; large for full events
+
   /// Value used when a typical ultraviolet light wavelength is needed.
   static constexpr double kVUVWavelength = 128.0; // nm
 
@@ -103,6 +105,7 @@ opdet::OpDetAnalyzer::OpDetAnalyzer(fhicl::ParameterSet const& pset)
 {
   
   fVerbosity = pset.get<int>("Verbosity");
+  fSaveAllPhotons = pset.get<bool>("SaveAllPhotons", true);
   
   try
   {
@@ -120,11 +123,14 @@ void opdet::OpDetAnalyzer::beginJob()
   art::ServiceHandle<art::TFileService> tfs;
   
   // all photons tree
-  fAllPhotonsTree = tfs->make<TTree>("AllPhotons", "AllPhotons");
-  fAllPhotonsTree->Branch("EventID", &fEventID, "EventID/I");
-  fAllPhotonsTree->Branch("Wavelength", &fWavelength, "Wavelength/F");
-  fAllPhotonsTree->Branch("OpChannel", &fOpChannel, "OpChannel/I");
-  fAllPhotonsTree->Branch("Time", &fTime, "Time/F");
+  fAllPhotonsTree = nullptr;
+  if (fSaveAllPhotons) {
+    fAllPhotonsTree = tfs->make<TTree>("AllPhotons", "AllPhotons");
+    fAllPhotonsTree->Branch("EventID", &fEventID, "EventID/I");
+    fAllPhotonsTree->Branch("Wavelength", &fWavelength, "Wavelength/F");
+    fAllPhotonsTree->Branch("OpChannel", &fOpChannel, "OpChannel/I");
+    fAllPhotonsTree->Branch("Time", &fTime, "Time/F");
+  }
   
   // photons per opdet tree
   fTheOpDetTree = tfs->make<TTree>("PhotonsPerOpDet","PhotonsPerOpDet");
@@ -198,7 +204,7 @@ void opdet::OpDetAnalyzer::analyze(art::Event const& evt)
         {
           //Get data from HitCollection entry
           fOpChannel=photon.OpChannel;
-          std::map<int, int> PhotonsMap = photon.DetectedPhotons;
+          std::map<int, int> const& PhotonsMap = photon.DetectedPhotons;
 
           // do not save if PD is not sensitive to this light
           std::string pd_type=fPDSMapPtr->pdType(fOpChannel);
@@ -215,6 +221,15 @@ void opdet::OpDetAnalyzer::analyze(art::Event const& evt)
             // Get arrival time from phot
             fTime= it->first;
 
+            // without the per photon tree, count the photons of this time at once
+            if (!fAllPhotonsTree) {
+              fCountOpDetAll += it->second;
+              fNOpDetAll[fOpChannel] += it->second;
+              if (!Reflected) fNOpDetDirect[fOpChannel] += it->second;
+              else fNOpDetReflected[fOpChannel] += it->second;
+              continue;
+            }
+
             for(int i = 0; i < it->second ; i++)
             {
               // Increment per OpDet counters and fill all photon tree
@@ -13,10 +13,15 @@
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <utility>
 
 #include "lardataobj/RawData/OpDetWaveform.h"
-#include "lardata/Utilities/LArFFT.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+#include "sbndcode/Utilities/EventScratch.h"
 #include "TFile.h"
 
 #include <cmath>
@@ -45,6 +50,7 @@ public:
 private:
   bool fDebug;
   int fMaxFFTSizePow;
+  bool fMixedRadixFFT;
   std::vector<double> fSinglePEWave;
   bool fPositivePolarity;
   bool fUseSaturated;
@@ -67,6 +73,8 @@ private:
   bool fScaleHypoSignal;
   bool fUseParamFilter;
   std::vector<double> fFilterParams;
+  double fROIThreshold;
+  size_t fROIPad;
 
   double fNormUnAvSmooth;
   double fSamplingFreq;
@@ -78,21 +86,34 @@ private:
   std::vector<double> fSignalHypothesis;
   std::vector<double> fNoiseHypothesis;
 
+  // FFT plan and the parts of the kernel that only depend on the FFT size
+  struct FFTCache_t {
+    std::unique_ptr<util::SBNDFFTWorker> fft;
+    std::vector<TComplex> serfft;    // detector response R
+    std::vector<double> serPower;    // |R|^2
+    std::vector<TComplex> serConj;   // Conj(R), Wiener filters only
+    std::vector<double> invHypoPower; // 1/|L|^2, Wiener filters only
+    std::vector<TComplex> kernel;    // last kernel made for this size
+    double kernelNoisePower = -1.;   // noise power of that kernel, not used by parametrized filters
+  };
+  std::map<size_t, FFTCache_t> fFFTCache;
+
   // Declare member data here.
 
   // Declare member functions
-  void ApplyExpoAvSmoothing(std::vector<double>& wf);
-  void ApplyUnAvSmoothing(std::vector<double>& wf);
+  using ROIs_t = std::pmr::vector<std::pair<size_t, size_t>>;
+  void FindROIs(std::vector<double> const& wf, ROIs_t& rois);
+  void ApplyExpoAvSmoothing(std::vector<double>& wf, size_t begin, size_t end);
+  void ApplyUnAvSmoothing(std::vector<double>& wf, size_t begin, size_t end);
   size_t WfSizeFFT(size_t n);
   std::vector<double> ScintArrivalTimesShape(size_t n, detinfo::LArProperties const& lar_prop);
   void SubtractBaseline(std::vector<double> &wf, double baseline);
   void EstimateBaselineStdDev(std::vector<double> &wf, double &_mean, double &_stddev);
-  std::vector<TComplex> DeconvolutionKernel(size_t size, double baseline_stddev, double snr_scaling);
+  FFTCache_t& GetFFTCache(size_t size);
+  std::vector<TComplex> const& DeconvolutionKernel(size_t size, double baseline_stddev, double snr_scaling);
 
   //Load TFileService serrvice
   art::ServiceHandle<art::TFileService> tfs;
-  //Load FFT serrvice
-  art::ServiceHandle<util::LArFFT> fft_service;
 };
 
 
@@ -101,6 +122,7 @@ opdet::OpDeconvolutionAlgWiener::OpDeconvolutionAlgWiener(fhicl::ParameterSet co
   //read fhicl paramters
   fDebug = p.get< bool >("Debug");
   fMaxFFTSizePow = p.get< int >("MaxFFTSizePow", 15);
+  fMixedRadixFFT = p.get< bool >("MixedRadixFFT", false);
   fPositivePolarity = p.get< bool >("PositivePolarity");
   fUseSaturated = p.get< bool >("UseSaturated");
   fADCSaturationValue = p.get< int >("ADCSaturationValue");
@@ -125,6 +147,8 @@ opdet::OpDeconvolutionAlgWiener::OpDeconvolutionAlgWiener(fhicl::ParameterSet co
   fScaleHypoSignal = p.get< bool >("ScaleHypoSignal");
   fUseParamFilter = p.get< bool >("UseParamFilter");
   fFilterParams = p.get< std::vector<double> >("FilterParams");
+  fROIThreshold = p.get< double >("ROIThreshold", 0.);
+  fROIPad = p.get< size_t >("ROIPad", 50);
 
   fNormUnAvSmooth=1./(2*fUnAvNeighbours+1);
   NDecoWf=0;
@@ -170,6 +194,9 @@ opdet::OpDeconvolutionAlgWiener::OpDeconvolutionAlgWiener(fhicl::ParameterSet co
 
 std::vector<raw::OpDetWaveform> opdet::OpDeconvolutionAlgWiener::RunDeconvolution(std::vector<raw::OpDetWaveform> const& wfVector)
 {
+  // the smoothing copies come from the scratch memory of the thread
+  sbnd::mem::EventScope scratch;
+
   std::vector<raw::OpDetWaveform> wfDeco;
   wfDeco.reserve(wfVector.size());
 
@@ -204,11 +231,26 @@ std::vector<raw::OpDetWaveform> opdet::OpDeconvolutionAlgWiener::RunDeconvolutio
       continue;
     }
 
+    //Find the pulses; a waveform without any deconvolves to a flat baseline
+    ROIs_t rois(sbnd::mem::EventResource());
+    if(fROIThreshold>0){
+      FindROIs(wave, rois);
+      if(rois.empty()){
+        wfDeco.emplace_back( wf.TimeStamp(), wf.ChannelNumber(), std::vector<short unsigned int> (wfsize, 0) );
+        NDecoWf++;
+        continue;
+      }
+    }
+    else
+      rois.emplace_back(0, wfsize);
+
     //Apply waveform smoothing
-    if(fApplyExpoAvSmooth)
-      ApplyExpoAvSmoothing(wave);
-    if(fApplyUnAvSmooth)
-      ApplyUnAvSmoothing(wave);
+    for(auto const& [begin, end] : rois){
+      if(fApplyExpoAvSmooth)
+        ApplyExpoAvSmoothing(wave, begin, end);
+      if(fApplyUnAvSmooth)
+        ApplyUnAvSmoothing(wave, begin, end);
+    }
 
     //Estimate baseline standard deviation
     double baseline_mean=0., baseline_stddev=1.;
@@ -220,11 +262,10 @@ std::vector<raw::OpDetWaveform> opdet::OpDeconvolutionAlgWiener::RunDeconvolutio
 
     //Create deconvolution kernel
     wave.resize(wfsizefft, 0);
-    std::vector<TComplex> fDeconvolutionKernel=DeconvolutionKernel(wfsize, baseline_stddev, wfPeakPE);
+    std::vector<TComplex> const& fDeconvolutionKernel=DeconvolutionKernel(wfsize, baseline_stddev, wfPeakPE);
 
-    //Deconvolve raw signal (covolve with kernel)
-    fft_service->ReinitializeFFT(wfsizefft, "", 20);
-    fft_service->Convolute(wave, fDeconvolutionKernel);
+    //Deconvolve raw signal (covolve with kernel), with the plan kept for this size
+    GetFFTCache(wfsizefft).fft->Convolute(wave, fDeconvolutionKernel);
     wave.resize(wfsize);
 
     //Set deconvlved waveform precision and restore baseline before saving
@@ -258,24 +299,56 @@ std::vector<raw::OpDetWaveform> opdet::OpDeconvolutionAlgWiener::RunDeconvolutio
 }
 
 
-void opdet::OpDeconvolutionAlgWiener::ApplyExpoAvSmoothing(std::vector<double>& wf){
-  std::transform (std::next(wf.begin(), 1), wf.end(), wf.begin(), std::next(wf.begin(), 1),
-    [&](double _x, double _y) { return  fExpoAvSmoothPar*_x+ (1. - fExpoAvSmoothPar)*_y; }  );
+void opdet::OpDeconvolutionAlgWiener::FindROIs(std::vector<double> const& wf, ROIs_t& rois){
+  if(wf.empty()) return;
+
+  //Rough baseline: the median, most of a PMT waveform being baseline
+  std::pmr::vector<double> sorted(wf.begin(), wf.end(), sbnd::mem::EventResource());
+  auto const middle = std::next(sorted.begin(), sorted.size()/2);
+  std::nth_element(sorted.begin(), middle, sorted.end());
+  double const baseline = *middle;
+
+  //Samples further than the threshold from it in the polarity of the pulses,
+  //padded on both sides; overlapping regions are merged
+  for(size_t k=0; k<wf.size(); k++){
+    double const amplitude = fPositivePolarity ? wf[k]-baseline : baseline-wf[k];
+    if(amplitude<=fROIThreshold) continue;
+    size_t const begin = k>fROIPad ? k-fROIPad : 0;
+    size_t const end = std::min(wf.size(), k+fROIPad+1);
+    if(!rois.empty() && begin<=rois.back().second)
+      rois.back().second = end;
+    else
+      rois.emplace_back(begin, end);
+  }
+}
+
+
+void opdet::OpDeconvolutionAlgWiener::ApplyExpoAvSmoothing(std::vector<double>& wf, size_t begin, size_t end){
+  for(size_t bin=begin+1; bin<end; bin++)
+    wf[bin] = fExpoAvSmoothPar*wf[bin] + (1. - fExpoAvSmoothPar)*wf[bin-1];
 }
 
 
-void opdet::OpDeconvolutionAlgWiener::ApplyUnAvSmoothing(std::vector<double>& wf){
-  std::vector<double> wf_aux(wf.begin(), wf.end());
-  for(size_t bin=fUnAvNeighbours; bin<wf.size()-fUnAvNeighbours; bin++){
+void opdet::OpDeconvolutionAlgWiener::ApplyUnAvSmoothing(std::vector<double>& wf, size_t begin, size_t end){
+  //The bins closer than UnAvNeighbours to the ends of the waveform are left as they are
+  size_t const first = std::max<size_t>(begin, fUnAvNeighbours);
+  size_t const last = std::min<size_t>(end, wf.size()-fUnAvNeighbours);
+  if(first>=last) return;
+  std::pmr::vector<double> wf_aux(std::next(wf.begin(), first-fUnAvNeighbours), std::next(wf.begin(), last+fUnAvNeighbours),
+    sbnd::mem::EventResource());
+  for(size_t bin=first; bin<last; bin++){
     double sum=0.;
     for(size_t nbin=bin-fUnAvNeighbours; nbin<=bin+fUnAvNeighbours; nbin++)
-      sum+=wf_aux[nbin];
+      sum+=wf_aux[nbin-(first-fUnAvNeighbours)];
     wf[bin]=sum*fNormUnAvSmooth;
   }
 }
 
 
 size_t opdet::OpDeconvolutionAlgWiener::WfSizeFFT(size_t n){
+  //Never above the power of two, so it stays within MaxBinsFFT
+  if(fMixedRadixFFT)
+    return util::SBNDFastFFTSize(n);
   if (n && !(n & (n - 1)))
        return n;
   size_t cont=0;
@@ -370,36 +443,59 @@ void opdet::OpDeconvolutionAlgWiener::EstimateBaselineStdDev(std::vector<double>
 }
 
 
-std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_t wfsize, double baseline_stddev, double snr_scaling){
-  //Initizalize kernel
-  size_t size=WfSizeFFT(wfsize);
-  TComplex kerinit(0,0,false);
-  std::vector<TComplex> kernel(size, kerinit);
-  fft_service->ReinitializeFFT (size, "", 20);
+opdet::OpDeconvolutionAlgWiener::FFTCache_t& opdet::OpDeconvolutionAlgWiener::GetFFTCache(size_t size){
+  auto it = fFFTCache.find(size);
+  if(it != fFFTCache.end()) return it->second;
+
+  FFTCache_t& cache = fFFTCache[size];
+  cache.fft = std::make_unique<util::SBNDFFTWorker>(size);
 
   //Prepare detector response FFT
   std::vector<double> ser( fSinglePEWave.begin(), std::next(fSinglePEWave.begin(), size) );
-  std::vector<TComplex> serfft;
-  serfft.resize(size);
-  fft_service->DoFFT(ser, serfft);
+  cache.fft->DoFFT(ser, cache.serfft);
+  cache.serPower.resize(cache.serfft.size());
+  for(size_t k=0; k<cache.serfft.size(); k++)
+    cache.serPower[k] = pow(TComplex::Abs(cache.serfft[k]), 2);
 
+  TComplex kerinit(0,0,false);
+  cache.kernel.assign(cache.serfft.size(), kerinit);
   if(fUseParamFilter){
+    //the parametrized filter does not depend on the waveform
     double freq_step=fSamplingFreq/size;
     for(size_t k=0; k<size/2; k++){
-      kernel[k]= fFilterTF1->Eval(k*freq_step) / serfft[k] ;
+      cache.kernel[k]= fFilterTF1->Eval(k*freq_step) / cache.serfft[k] ;
     }
   }
   else{
+    //Prepare L
+    std::vector<double> hypo( fSignalHypothesis.begin(), std::next(fSignalHypothesis.begin(), size) );
+    std::vector<TComplex> hypofft;
+    cache.fft->DoFFT(hypo, hypofft);
+    cache.invHypoPower.resize(hypofft.size());
+    for(size_t k=0; k<hypofft.size(); k++)
+      cache.invHypoPower[k] = 1./pow(TComplex::Abs(hypofft[k]), 2);
+    cache.serConj.resize(cache.serfft.size());
+    for(size_t k=0; k<cache.serfft.size(); k++)
+      cache.serConj[k] = TComplex::Conjugate(cache.serfft[k]);
+  }
+  return cache;
+}
+
+
+std::vector<TComplex> const& opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_t wfsize, double baseline_stddev, double snr_scaling){
+  //Initizalize kernel
+  size_t size=WfSizeFFT(wfsize);
+  FFTCache_t& cache = GetFFTCache(size);
+  std::vector<TComplex>& kernel = cache.kernel;
+
+  if(!fUseParamFilter){
     //Build Wiener filter kernel: G = Conj(R) / ( |R|^2 + |N|^2/|L|^2)
     //R=Detector resopnse FFT
     //N=Noise mean spectral power
     //L=True signal mean spectral power
-
-    //Prepare L
-    std::vector<double> hypo( fSignalHypothesis.begin(), std::next(fSignalHypothesis.begin(), size) );
-    std::vector<TComplex> hypofft;
-    hypofft.resize(size);
-    fft_service->DoFFT(hypo, hypofft);
+    //Only N changes from a waveform to the other, and the noise is white:
+    //with Conj(R), |R|^2 and 1/|L|^2 kept for each size, a new N costs
+    //one real division per frequency
 
     //Prepare Noise Spectral Power
     double noise_power=wfsize*baseline_stddev*baseline_stddev;
@@ -407,9 +503,12 @@ std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_
       noise_power/=pow(snr_scaling, 2);
     }
 
-    for(size_t k=0; k<size/2; k++){
-      double den = pow(TComplex::Abs(serfft[k]), 2) + noise_power / pow(TComplex::Abs(hypofft[k]), 2) ;
-      kernel[k]= TComplex::Conjugate( serfft[k] ) / den;
+    if(noise_power != cache.kernelNoisePower){
+      for(size_t k=0; k<size/2; k++){
+        double den = cache.serPower[k] + noise_power * cache.invHypoPower[k] ;
+        kernel[k]= cache.serConj[k] * (1./den);
+      }
+      cache.kernelNoisePower = noise_power;
     }
   }
 
@@ -419,7 +518,7 @@ std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_
     TH1F * hs_wiener = tfs->make< TH1F >
       (name.c_str(),"Wiener Filter;Frequency Bin;Magnitude",size/2, 0, size/2);
     for(size_t k=0; k<size/2; k++)
-      hs_wiener->SetBinContent(k, TComplex::Abs( kernel[k]*serfft[k] ) );
+      hs_wiener->SetBinContent(k, TComplex::Abs( kernel[k]*cache.serfft[k] ) );
   }
 
   return kernel;
@@ -23,6 +23,7 @@
 #include "lardataobj/RawData/OpDetWaveform.h"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetSim/CompactWaveform/CompactOpDetWaveforms.h"
 #include "sbndcode/OpDetReco/OpDeconvolution/Alg/OpDeconvolutionAlg.hh"
 
 namespace opdet {
@@ -48,8 +49,12 @@ public:
 
 private:
 
+  // Whether the waveforms of channel are to be deconvolved
+  bool UseChannel(raw::Channel_t channel) const;
+
   // Declare member data here.
   std::string fInputLabel;
+  bool fInputCompact;
   std::vector<std::string> fPDTypes;
   std::vector<std::string> fElectronics;
   //OpDecoAlg tool
@@ -66,6 +71,7 @@ opdet::SBNDOpDeconvolution::SBNDOpDeconvolution(fhicl::ParameterSet const& p)
   // Call appropriate produces<>() functions here.
   // Call appropriate consumes<>() for any products to be retrieved by this module.
   fInputLabel = p.get< std::string >("InputLabel");
+  fInputCompact = p.get< bool >("InputCompact", false);
   fPDTypes = p.get< std::vector<std::string> >("PDTypes");
   fElectronics = p.get< std::vector<std::string> >("Electronics");
   fOpDecoAlgPtr = art::make_tool<opdet::OpDeconvolutionAlg>( p.get< fhicl::ParameterSet >("OpDecoAlg") );
@@ -73,23 +79,41 @@ opdet::SBNDOpDeconvolution::SBNDOpDeconvolution(fhicl::ParameterSet const& p)
   produces< std::vector< raw::OpDetWaveform > >();
 }
 
-void opdet::SBNDOpDeconvolution::produce(art::Event& e)
+bool opdet::SBNDOpDeconvolution::UseChannel(raw::Channel_t channel) const
 {
-  //Load the waveforms
-  art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
-  e.getByLabel(fInputLabel, wfHandle);
-  if (!wfHandle.isValid()) {
-   mf::LogError("SBNDOpDeconvolution")<<"Input waveforms with input label "<<fInputLabel<<" couldn't be loaded..."<<std::endl;
-   throw cet::exception("SBNDOpDeconvolution") << "Input waveforms with input label " << fInputLabel << " not found\n";
-  }
+  return (std::find(fPDTypes.begin(), fPDTypes.end(), pdsmap.pdType(channel) ) != fPDTypes.end() ) &&
+         (std::find(fElectronics.begin(), fElectronics.end(), pdsmap.electronicsType(channel) ) != fElectronics.end());
+}
 
+void opdet::SBNDOpDeconvolution::produce(art::Event& e)
+{
   std::vector< raw::OpDetWaveform > RawWfVector;
-  RawWfVector.reserve(wfHandle->size());
 
-  for(auto const& wf : *wfHandle){
-    if((std::find(fPDTypes.begin(), fPDTypes.end(), pdsmap.pdType(wf.ChannelNumber()) ) != fPDTypes.end() ) &&
-       (std::find(fElectronics.begin(), fElectronics.end(), pdsmap.electronicsType(wf.ChannelNumber()) ) != fElectronics.end()) ){
-      RawWfVector.push_back(wf);
+  //Load the waveforms
+  if (fInputCompact) {
+    // the selected segments are unpacked straight into the input of the
+    // deconvolution, which takes a copy of the waveforms anyway
+    art::Handle< sbnd::CompactOpDetWaveforms > compactHandle;
+    e.getByLabel(fInputLabel, compactHandle);
+    if (!compactHandle.isValid()) {
+     mf::LogError("SBNDOpDeconvolution")<<"Input waveforms with input label "<<fInputLabel<<" couldn't be loaded..."<<std::endl;
+     throw cet::exception("SBNDOpDeconvolution") << "Input waveforms with input label " << fInputLabel << " not found\n";
+    }
+    RawWfVector.reserve(compactHandle->size());
+    for(std::size_t i = 0; i < compactHandle->size(); ++i){
+      if(UseChannel(compactHandle->Channel(i))) RawWfVector.push_back(compactHandle->MakeWaveform(i));
+    }
+  }
+  else {
+    art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
+    e.getByLabel(fInputLabel, wfHandle);
+    if (!wfHandle.isValid()) {
+     mf::LogError("SBNDOpDeconvolution")<<"Input waveforms with input label "<<fInputLabel<<" couldn't be loaded..."<<std::endl;
+     throw cet::exception("SBNDOpDeconvolution") << "Input waveforms with input label " << fInputLabel << " not found\n";
+    }
+    RawWfVector.reserve(wfHandle->size());
+    for(auto const& wf : *wfHandle){
+      if(UseChannel(wf.ChannelNumber())) RawWfVector.push_back(wf);
     }
   }
 
@@ -15,7 +15,7 @@ namespace lightana
     const std::string& Name() const { return _name; }
     virtual ~FlashAlgoBase();
     virtual void Configure(const Config_t &p) = 0;
-    virtual LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t ophits) = 0;
+    virtual LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t& ophits) const = 0;
     virtual void Reset();
 
   private:
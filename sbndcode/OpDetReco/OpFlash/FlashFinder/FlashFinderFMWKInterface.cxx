@@ -103,6 +103,16 @@ namespace lightana {
 
   }
 
+  size_t MaxOpChannel() {
+    ::art::ServiceHandle<geo::Geometry> geo;
+    return geo->MaxOpChannel();
+  }
+
+  bool IsValidOpChannel(size_t opch) {
+    ::art::ServiceHandle<geo::Geometry> geo;
+    return geo->IsValidOpChannel(opch);
+  }
+
   size_t OpDetFromOpChannel(size_t opch) {
     ::art::ServiceHandle<geo::Geometry> geo;
     return geo->OpDetFromOpChannel(opch);
@@ -22,6 +22,10 @@ namespace lightana {
 
   std::vector<int> PDNamesToList(std::vector<std::string> pd_names);
 
+  size_t MaxOpChannel();
+
+  bool IsValidOpChannel(size_t opch);
+
   size_t OpDetFromOpChannel(size_t opch);
 
   void OpDetCenterFromOpChannel(size_t opch, double *xyz);
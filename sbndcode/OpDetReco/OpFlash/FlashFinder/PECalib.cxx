@@ -6,42 +6,84 @@
 namespace lightana {
 
   PECalib::PECalib()
+    : _nopdets(0)
   {}
 
   void PECalib::Configure(const Config_t &pset)
   {
 
+    _nopdets = NOpDets();
+
+    // PMT and X-ARAPUCA values can be given at once by PD type,
+    // e.g. SPEAreaGainByPDType: { pmt_coated: 200 xarapuca_vuv: 500 }
+    auto const gain_by_type = pset.get<Config_t>("SPEAreaGainByPDType", Config_t());
+    auto const qe_by_type = pset.get<Config_t>("RelativeQEByPDType", Config_t());
+
+    std::vector<size_t> opch_v;
+    std::vector<size_t> opdet_v;
+    std::vector<std::string> type_v;
+    opdet::sbndPDMapAlg pds_map;
+    for(size_t opch=0; opch<MaxOpChannel(); ++opch) {
+      if(!IsValidOpChannel(opch)) continue;
+      opch_v.push_back(opch);
+      opdet_v.push_back(OpDetFromOpChannel(opch));
+      type_v.push_back(pds_map.pdType(opch));
+    }
+
     _spe_area_gain_v.clear();
     _spe_area_gain_v = pset.get<std::vector<double> >("SPEAreaGainList",_spe_area_gain_v);
 
     if(_spe_area_gain_v.empty()) {
-      double spe_area_gain = pset.get<double>("SPEAreaGain");
-      _spe_area_gain_v.resize(NOpDets(),spe_area_gain);
+      bool by_type = true;
+      for(auto const& type : type_v) by_type = by_type && gain_by_type.has_key(type);
+      double spe_area_gain = by_type ? 0. : pset.get<double>("SPEAreaGain");
+      _spe_area_gain_v.resize(_nopdets,spe_area_gain);
+      for(size_t i=0; i<opdet_v.size(); ++i) {
+        if(gain_by_type.has_key(type_v[i]) && opdet_v[i] < _nopdets)
+          _spe_area_gain_v[opdet_v[i]] = gain_by_type.get<double>(type_v[i]);
+      }
     }
 
-    if(_spe_area_gain_v.size() != NOpDets()) {
+    if(_spe_area_gain_v.size() != _nopdets) {
       std::cerr << "SPEAreaGain array size (" << _spe_area_gain_v.size()
-                << ") != NOpDets (" << NOpDets() << ")..." << std::endl;
+                << ") != NOpDets (" << _nopdets << ")..." << std::endl;
       throw std::exception();
     }
 
     _relative_qe_v.clear();
     _relative_qe_v = pset.get<std::vector<double> >("RelativeQEList",_relative_qe_v);
 
-    if(_relative_qe_v.empty())
-      _relative_qe_v.resize(NOpDets(),1.0);
+    if(_relative_qe_v.empty()) {
+      _relative_qe_v.resize(_nopdets,1.0);
+      for(size_t i=0; i<opdet_v.size(); ++i) {
+        if(qe_by_type.has_key(type_v[i]) && opdet_v[i] < _nopdets)
+          _relative_qe_v[opdet_v[i]] = qe_by_type.get<double>(type_v[i]);
+      }
+    }
 
-    if(_relative_qe_v.size() != NOpDets()) {
+    if(_relative_qe_v.size() != _nopdets) {
       std::cerr << "RelativeQE array size (" << _relative_qe_v.size()
-                << ") != NOpDets (" << NOpDets() << ")..." << std::endl;
+                << ") != NOpDets (" << _nopdets << ")..." << std::endl;
       throw std::exception();
     }
+
+    // Dense per-channel copies for the hit loop
+    size_t const nopch = opch_v.empty() ? 0 : opch_v.back()+1;
+    _opch_spe_area_gain_v.assign(nopch,0.);
+    _opch_relative_qe_v.assign(nopch,0.);
+    _opch_valid_v.assign(nopch,false);
+    for(size_t i=0; i<opch_v.size(); ++i) {
+      if(opdet_v[i] >= _nopdets) continue;
+      _opch_valid_v[opch_v[i]] = true;
+      _opch_spe_area_gain_v[opch_v[i]] = _spe_area_gain_v[opdet_v[i]];
+      _opch_relative_qe_v[opch_v[i]] = _relative_qe_v[opdet_v[i]];
+    }
   }
 
   double PECalib::Calibrate(const size_t opdet, const double area) const
   {
-    if( opdet > NOpDets() ) {
-      std::cerr << "OpDet ID " << opdet << " exceeding max # of OpDet (" << NOpDets() << ")" << std::endl;
+    if( opdet > _nopdets ) {
+      std::cerr << "OpDet ID " << opdet << " exceeding max # of OpDet (" << _nopdets << ")" << std::endl;
       throw std::exception();
     }
 
@@ -50,6 +92,21 @@ namespace lightana {
     return area_pe;
   }
 
+  void PECalib::Calibrate(const std::vector<double> &area_v, LiteOpHitArray_t &hits) const
+  {
+    size_t const nopch = _opch_valid_v.size();
+    for(auto const& hit : hits) {
+      if( hit.channel >= nopch || !_opch_valid_v[hit.channel] ) {
+        std::cerr << "OpChannel " << hit.channel << " has no OpDet calibration" << std::endl;
+        throw std::exception();
+      }
+    }
+
+    double const* gain = _opch_spe_area_gain_v.data();
+    double const* qe = _opch_relative_qe_v.data();
+    for(size_t i=0; i<hits.size(); ++i)
+      hits[i].pe = area_v[i] / gain[hits[i].channel] * qe[hits[i].channel];
+  }
+
 }
 #endif
-
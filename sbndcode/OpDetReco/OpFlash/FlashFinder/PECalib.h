@@ -20,6 +20,8 @@
 #include <numeric>
 #include <functional>
 #include <algorithm>
+#include <string>
+#include <vector>
 
 namespace lightana{
 /**
@@ -42,11 +44,22 @@ namespace lightana{
 
     double Calibrate(const size_t opdet, const double area) const;
 
+    /// Sets the pe of each hit from the area of the same index, using the
+    /// gain and relative QE of the OpDet of the hit channel
+    void Calibrate(const std::vector<double> &area_v, LiteOpHitArray_t &hits) const;
+
     protected:
 
     std::vector<double> _spe_area_gain_v;
     std::vector<double> _relative_qe_v;
 
+    // The same, by OpChannel (filled at Configure)
+    std::vector<double> _opch_spe_area_gain_v;
+    std::vector<double> _opch_relative_qe_v;
+    std::vector<bool> _opch_valid_v;
+
+    size_t _nopdets;
+
   };
 
 } 
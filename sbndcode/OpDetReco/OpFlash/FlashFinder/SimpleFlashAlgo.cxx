@@ -2,8 +2,10 @@
 #define SIMPLEFLASHALGO_CXX
 
 #include "SimpleFlashAlgo.h"
+#include "sbndcode/Utilities/EventScratch.h"
 #include <set>
 #include <algorithm>
+#include <iterator>
 
 namespace lightana{
 
@@ -13,8 +15,6 @@ namespace lightana{
     : FlashAlgoBase(name)
     {}
 
-    size_t SimpleFlashAlgo::_nopdet_maxsize = 0;
-
     void SimpleFlashAlgo::Configure(const Config_t &p)
     {
         Reset();
@@ -116,8 +116,6 @@ namespace lightana{
         }
         */
 
-        if(_index_to_opch_v.size()>_nopdet_maxsize) _nopdet_maxsize = _index_to_opch_v.size();
-
     }
 
     bool SimpleFlashAlgo::Veto(double t) const
@@ -130,16 +128,28 @@ namespace lightana{
     SimpleFlashAlgo::~SimpleFlashAlgo()
     {}
 
-    LiteOpFlashArray_t SimpleFlashAlgo::RecoFlash(const LiteOpHitArray_t ophits) {
+    double SimpleFlashAlgo::PESum(const std::pmr::vector<PEBin_t>& bin_v, size_t start, size_t end)
+    {
+        auto iter = std::lower_bound(bin_v.begin(), bin_v.end(), start,
+                                     [](PEBin_t const& bin, size_t index) { return bin.index < index; });
+        double pesum = 0;
+        for(; iter != bin_v.end() && iter->index < end; ++iter) pesum += iter->pesum;
+        return pesum;
+    }
+
+    LiteOpFlashArray_t SimpleFlashAlgo::RecoFlash(const LiteOpHitArray_t& ophits) const {
+
+        // working space of this call only, so that events can be processed concurrently;
+        // it is taken from the scratch memory of the thread, reset when the call ends
+        sbnd::mem::EventScope scratch;
+        std::pmr::memory_resource* const mem = sbnd::mem::EventResource();
+        std::pmr::vector<std::pair<size_t,unsigned int> > bin_hit_v(mem); // (time bin, hit index), sorted
+        std::pmr::vector<PEBin_t> bin_v(mem);                             // occupied bins, by time
+        std::pmr::vector<size_t> candidate_v(mem);                        // heap of candidate bins
+        std::pmr::vector<double> bin_pe_v(mem);                           // per opch pe of one bin
 
-        Reset();
         size_t max_ch = _opch_to_index_v.size() - 1;
-        size_t NOpDet = _index_to_opch_v.size();
 
-        //static std::vector<double> pesum_v;
-        static std::vector<double> mult_v;  //< this is not strictly a multiplicity of PMTs, but multiplicity of hits
-        static std::vector<std::vector<double> > pespec_v;
-        static std::vector<std::vector<unsigned int> > hitidx_v;
         double min_time=1.1e20;
         double max_time=1.1e20;
         for(auto const& oph : ophits) {
@@ -152,22 +162,10 @@ namespace lightana{
             std::cout << "T span: " << min_time << " => " << max_time << " ... " << (size_t)((max_time - min_time) / _time_res) << std::endl;
 
         size_t nbins_pesum_v = (size_t)((max_time - min_time) / _time_res) + 1;
-        if(_pesum_v.size() < nbins_pesum_v) _pesum_v.resize(nbins_pesum_v,0);
-        if(mult_v.size()   < nbins_pesum_v) mult_v.resize(nbins_pesum_v,0);
-        if(pespec_v.size() < nbins_pesum_v) pespec_v.resize(nbins_pesum_v,std::vector<double>(_nopdet_maxsize));
-        if(hitidx_v.size() < nbins_pesum_v) hitidx_v.resize(nbins_pesum_v,std::vector<unsigned int>());
-        // reset pe_sum_v
-        for(size_t i=0; i<_pesum_v.size(); ++i) {
-            _pesum_v[i] = 0;
-        }
-        // reset static vectors
-        for(size_t i=0; i<mult_v.size(); ++i) {
-            mult_v[i]  = 0;
-            hitidx_v[i].clear();
-            for(auto& v : pespec_v[i]) v=0;
-        }
 
-        // Fill _pesum_v
+        // Time bin of each hit used
+        bin_hit_v.clear();
+        bin_hit_v.reserve(ophits.size());
         for(size_t hitidx = 0; hitidx < ophits.size(); ++hitidx) {
             auto const& oph = ophits[hitidx];
             if(oph.channel > max_ch || _opch_to_index_v[oph.channel] < 0) {
@@ -180,38 +178,55 @@ namespace lightana{
             }
             size_t index = (size_t)((oph.peak_time - min_time) / _time_res);
             // std::cout << "Ophit from ch " << oph.channel << " at time " << oph.peak_time << " with PE " << oph.pe << ", index " << index << std::endl;
-            _pesum_v[index] += oph.pe;
-            mult_v[index] += 1;
-            pespec_v[index][_opch_to_index_v[oph.channel]] += oph.pe;
-            hitidx_v[index].push_back(hitidx);
+            bin_hit_v.emplace_back(index, hitidx);
+        }
+        // by time bin, then in the order of the hits
+        std::sort(bin_hit_v.begin(), bin_hit_v.end());
+
+        // Fill the pe sum of the occupied bins
+        bin_v.clear();
+        for(size_t i = 0; i < bin_hit_v.size(); ++i) {
+            size_t const index = bin_hit_v[i].first;
+            if(bin_v.empty() || bin_v.back().index != index)
+                bin_v.push_back(PEBin_t{index, 0., 0., i, i});
+            PEBin_t& bin = bin_v.back();
+            bin.pesum += ophits[bin_hit_v[i].second].pe;
+            bin.mult  += 1;
+            bin.last   = i + 1;
         }
 
-        // Order by pe (above threshold)
-        std::map<double,size_t> pesum_idx_map;
-        for(size_t idx=0; idx<nbins_pesum_v; ++idx) {
-            // std::cout <<  "    _pesum_v at " << idx << " is " << _pesum_v[idx] << ", _min_pe_coinc is " << _min_pe_coinc << std::endl;
-            if(_pesum_v[idx] < _min_pe_coinc   ) continue;
-            // std::cout <<  "    mult_v at " << idx << " is " << mult_v[idx] << ", _min_mult_coinc is " << _min_mult_coinc << std::endl;
-            if(mult_v[idx]  < _min_mult_coinc ) continue;
-            pesum_idx_map[1./(_pesum_v[idx])] = idx;
+        // Order by pe (above threshold), the earlier bin first if equal
+        auto lower_pe = [&bin_v](size_t a, size_t b) {
+            if(bin_v[a].pesum != bin_v[b].pesum) return bin_v[a].pesum < bin_v[b].pesum;
+            return bin_v[a].index > bin_v[b].index;
+        };
+        candidate_v.clear();
+        for(size_t ibin=0; ibin<bin_v.size(); ++ibin) {
+            // std::cout <<  "    pesum at " << bin_v[ibin].index << " is " << bin_v[ibin].pesum << ", _min_pe_coinc is " << _min_pe_coinc << std::endl;
+            if(bin_v[ibin].pesum < _min_pe_coinc   ) continue;
+            // std::cout <<  "    mult at " << bin_v[ibin].index << " is " << bin_v[ibin].mult << ", _min_mult_coinc is " << _min_mult_coinc << std::endl;
+            if(bin_v[ibin].mult  < _min_mult_coinc ) continue;
+            candidate_v.push_back(ibin);
         }
+        std::make_heap(candidate_v.begin(), candidate_v.end(), lower_pe);
 
         // Get candidate flash times
-        std::vector<std::pair<size_t,size_t> > flash_period_v;
-        std::vector<size_t> flash_time_v;
+        std::pmr::vector<std::pair<size_t,size_t> > flash_period_v(mem);
+        std::pmr::vector<size_t> flash_time_v(mem);
         size_t veto_ctr = (size_t)(_veto_time / _time_res);
         size_t default_integral_ctr = (size_t)(_integral_time / _time_res);
         size_t precount = (size_t)(_pre_sample / _time_res);
-        flash_period_v.reserve(pesum_idx_map.size());
-        flash_time_v.reserve(pesum_idx_map.size());
+        flash_period_v.reserve(candidate_v.size());
+        flash_time_v.reserve(candidate_v.size());
 
         double sum_baseline = 0;
         //for(auto const& v : _pe_baseline_v) sum_baseline += v;
 
-        for(auto const& pe_idx : pesum_idx_map) {
+        while(!candidate_v.empty()) {
 
-          //auto const& pe  = 1./(pe_idx.first);
-            auto const& idx = pe_idx.second;
+            std::pop_heap(candidate_v.begin(), candidate_v.end(), lower_pe);
+            size_t const idx = bin_v[candidate_v.back()].index;
+            candidate_v.pop_back();
 
             size_t start_time = idx;
             if(start_time < precount) start_time = 0;
@@ -250,10 +265,7 @@ namespace lightana{
             }
 
             // See if this flash is declarable
-            double pesum = 0;
-            for(size_t i=start_time; i<std::min(nbins_pesum_v,(start_time+integral_ctr)); ++i)
-
-                pesum += _pesum_v[i];
+            double pesum = PESum(bin_v, start_time, std::min(nbins_pesum_v,(start_time+integral_ctr)));
 
             if(pesum < (_min_pe_flash + sum_baseline)) {
                 if(_debug) std::cout << "Skipping a candidate @ " << start_time  << " => " << start_time + integral_ctr
@@ -274,13 +286,25 @@ namespace lightana{
             auto const& period = flash_period_v[flash_idx].second;
             auto const& time   = flash_time_v[flash_idx];
 
-            std::vector<double> pe_v(max_ch+1,0);
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
-
-                for(size_t pmt_index=0; pmt_index<NOpDet; ++pmt_index)
-
-                    pe_v[_index_to_opch_v[pmt_index]] += pespec_v[index][pmt_index];
+            // occupied bins of the flash
+            auto const bin_begin = std::lower_bound(bin_v.begin(), bin_v.end(), start,
+                                                    [](PEBin_t const& bin, size_t index) { return bin.index < index; });
+            auto bin_end = bin_begin;
+            while(bin_end != bin_v.end() && bin_end->index < start+period) ++bin_end;
 
+            // pe of each opch, summed bin by bin
+            std::vector<double> pe_v(max_ch+1,0);
+            bin_pe_v.assign(max_ch+1,0);
+            for(auto bin = bin_begin; bin != bin_end; ++bin) {
+                for(size_t i=bin->first; i<bin->last; ++i) {
+                    auto const& oph = ophits[bin_hit_v[i].second];
+                    bin_pe_v[oph.channel] += oph.pe;
+                }
+                for(size_t i=bin->first; i<bin->last; ++i) {
+                    size_t const opch = ophits[bin_hit_v[i].second].channel;
+                    pe_v[opch] += bin_pe_v[opch];
+                    bin_pe_v[opch] = 0;
+                }
             }
 
             for(size_t opch=0; opch<max_ch; ++opch) {
@@ -294,9 +318,10 @@ namespace lightana{
             }
 
             std::vector<unsigned int> asshit_v;
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
-                for(auto const& idx : hitidx_v[index])
-                    asshit_v.push_back(idx);
+            if(bin_begin != bin_end) {
+                asshit_v.reserve(std::prev(bin_end)->last - bin_begin->first);
+                for(size_t i=bin_begin->first; i<std::prev(bin_end)->last; ++i)
+                    asshit_v.push_back(bin_hit_v[i].second);
             }
 
             if(_debug) {
@@ -4,6 +4,7 @@
 #include "FlashAlgoBase.h"
 #include "FlashAlgoFactory.h"
 #include <map>
+#include <memory_resource>
 
 namespace lightana
 {
@@ -18,12 +19,10 @@ namespace lightana
 
     virtual ~SimpleFlashAlgo();
 
-    LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t ophits);
+    LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t& ophits) const;
 
     bool Veto(double t) const;
 
-    const std::vector<double>& PESumArray() const { return _pesum_v; }
-
     const double TimeRes() const { return _time_res; }
 
   private:
@@ -38,9 +37,18 @@ namespace lightana
     double _pre_sample;     // time pre-sample
     int    _tpc;            // tpc
 
-    std::vector<double> _pesum_v;        // pw aum array
     std::vector<double> _pe_baseline_v;  // calibration: PEs to be subtracted from each opdet
 
+    // pe sum over the time bins that have hits
+    struct PEBin_t {
+      size_t index;       // time bin
+      double pesum;       // pe sum
+      double mult;        // number of hits
+      size_t first, last; // range of the bin hits in the sorted (time bin, hit index) list
+    };
+    // PE sum of the occupied bins in [start, end)
+    static double PESum(const std::pmr::vector<PEBin_t>& bin_v, size_t start, size_t end);
+
     std::map<double,double> _flash_veto_range_m;  // veto window start
 
     bool _debug;            // debug mode flag
@@ -49,8 +57,6 @@ namespace lightana
     std::vector<int> _opch_to_index_v;
     std::vector<int> _index_to_opch_v;
 
-    static size_t _nopdet_maxsize;
-
   };
 
   /**
@@ -10,6 +10,8 @@
 #ifndef SBND_DRIFTESTIMATORBASE_H
 #define SBND_DRIFTESTIMATORBASE_H
 
+#include <vector>
+
 namespace lightana
 {
   class DriftEstimatorBase{
@@ -19,10 +21,10 @@ namespace lightana
     virtual ~DriftEstimatorBase() noexcept = default;
 
     // Method giving the estimated drift coordinate
-    virtual double GetDriftPosition(std::vector<double> PE_v) = 0;
+    virtual double GetDriftPosition(std::vector<double> const& PE_v) const = 0;
 
     // Method giving the photon propagation
-    virtual double GetPropagationTime(double drift) = 0;
+    virtual double GetPropagationTime(double drift) const = 0;
 
 
   };
@@ -8,7 +8,10 @@
 /// uncoated/coated PMTs. It requires a calibration curve
 /// (speficied in the CalibrationFile fhicl parameter).
 /// Once the drift has been estimated, the photon propagation
-/// time is calculated using the VUV and VIS light group velocities
+/// time is calculated using the VUV and VIS light group velocities.
+/// The calibration curve is sampled once on a uniform grid of PMT
+/// ratios, so each flash takes one pass over its channels and
+/// a direct table lookup.
 ///
 /// Created by Fran Nicolas, June 2022
 ////////////////////////////////////////////////////////////////////////
@@ -23,7 +26,9 @@
 
 #include <vector>
 #include <string>
-#include <map>
+#include <set>
+#include <algorithm>
+#include <cmath>
 
 #include "DriftEstimatorBase.hh"
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
@@ -62,16 +67,23 @@ namespace lightana
     explicit DriftEstimatorPMTRatio(art::ToolConfigTable<Config> const& config);
 
     // Method giving the estimated drift coordinate
-    double GetDriftPosition(std::vector<double> PE_v) override;
+    double GetDriftPosition(std::vector<double> const& PE_v) const override;
 
     // Method giving the photon propagation
-    double GetPropagationTime(double drift) override;
+    double GetPropagationTime(double drift) const override;
 
     // Method giving the photon propagation from PE vector
-    double PEToPropagationTime(std::vector<double> PE_v);
+    double PEToPropagationTime(std::vector<double> const& PE_v) const;
 
   private:
-    double Interpolate(double val);
+    // Linear interpolation of the calibration curve at val
+    double Interpolate(double val) const;
+
+    // Drift coordinate from the lookup table
+    double DriftFromRatio(double pmtratio) const;
+
+    // Sample the calibration curve on a uniform grid
+    void BuildLookupTable();
 
     // Input filepah with calibration curve
     std::string fCalibrationFile;
@@ -93,11 +105,20 @@ namespace lightana
     double fPMTRatio_MinVal;
     double fPMTRatio_MaxVal;
 
+    // Drift at fPMTRatio_MinVal + i/fLUTScale
+    std::vector<double> fDriftLUT;
+    double fLUTScale;
+
     // PDS mapping
     opdet::sbndPDMapAlg fPDSMap;
 
     std::set<int> fPDSBoxIDs;
 
+    // Slot of each channel in the PE sums: 2*box for coated PMTs,
+    // 2*box+1 for uncoated PMTs and fOtherSlot for the rest
+    std::vector<size_t> fChannelSlot;
+    size_t fOtherSlot;
+
   };
 
   DriftEstimatorPMTRatio::DriftEstimatorPMTRatio(art::ToolConfigTable<Config> const& config)
@@ -114,7 +135,12 @@ namespace lightana
           fCalibrationFile << " not found in FW_SEARCH_PATH\n";
 
     TFile* input_file = TFile::Open(file_name.c_str(), "READ");
+    if (!input_file || input_file->IsZombie())
+      throw cet::exception("DriftEstimatorPMTRatio") << "Cannot open calibration file " << file_name << "\n";
     TProfile * hProf_Calibration = (TProfile*)input_file->Get("PMTRatioCalibrationProfile");
+    if (!hProf_Calibration || hProf_Calibration->GetNbinsX() < 2)
+      throw cet::exception("DriftEstimatorPMTRatio") << "No PMTRatioCalibrationProfile with at least two bins in "
+                                                      << file_name << "\n";
 
     //Fill calibration variables
     fNCalBins = hProf_Calibration->GetNbinsX();
@@ -127,6 +153,8 @@ namespace lightana
 
     input_file->Close();
 
+    BuildLookupTable();
+
     geo::GeometryCore const& geom = *(lar::providerFrom<geo::Geometry>());
 
     fDriftDistance = geom.TPC().DriftDistance();
@@ -138,66 +166,85 @@ namespace lightana
     for(size_t oc=0; oc<fPDSMap.size(); oc++){
       fPDSBoxIDs.insert( fPDSMap.pdBox(oc) );
     }
-  }
-
-  double DriftEstimatorPMTRatio::GetDriftPosition(std::vector<double> PE_v){
 
-    std::map<int, double> BoxMap_PECoated;
-    std::map<int, double> BoxMap_PEUncoated;
-    std::map<int, int> BoxMap_NCoatedCh;
-    std::map<int, int> BoxMap_NUncoatedCh;
+    // boxes are numbered from 0; keep room for all the listed ones
+    size_t nBoxes = fPDSBoxIDs.size();
+    if(!fPDSBoxIDs.empty() && *fPDSBoxIDs.rbegin() >= 0)
+      nBoxes = std::max(nBoxes, size_t(*fPDSBoxIDs.rbegin()) + 1);
+    fOtherSlot = 2*nBoxes;
+    fChannelSlot.assign(fPDSMap.size(), fOtherSlot);
+    for(size_t oc=0; oc<fPDSMap.size(); oc++){
+      int const box_id = fPDSMap.pdBox(oc);
+      if(box_id < 0) continue;
+      // exclude xarapucas by now
+      auto const pd_type = fPDSMap.pdTypeID(oc);
+      if(pd_type == opdet::sbndPDMapAlg::PDType_t::kPMTCoated)
+        fChannelSlot[oc] = 2*box_id;
+      else if(pd_type == opdet::sbndPDMapAlg::PDType_t::kPMTUncoated)
+        fChannelSlot[oc] = 2*box_id + 1;
+    }
+  }
 
-    for(size_t oc=0; oc<PE_v.size(); oc++){
-      // skip 0 PE channels
-      if(PE_v[oc]==0) continue;
+  void DriftEstimatorPMTRatio::BuildLookupTable(){
 
-      std::string pd_type=fPDSMap.pdType(oc);
-      // exclude xarapucas by now
-      if(pd_type=="xarapuca_vuv" || pd_type=="xarapuca_vis") continue;
+    // TProfile bin centers are normally equally spaced already,
+    // otherwise resample the curve finely enough to follow it
+    double const step = (fPMTRatio_MaxVal - fPMTRatio_MinVal)/(fNCalBins - 1);
+    bool uniform = true;
+    for(int ix=1; ix<fNCalBins && uniform; ix++)
+      uniform = std::abs(fPMTRatioCal[ix] - fPMTRatioCal[ix-1] - step) <= 1e-6*step;
 
-      // get PDS box
-      int box_id = fPDSMap.pdBox(oc);
+    size_t const nPoints = uniform ? fNCalBins : 10*(fNCalBins - 1) + 1;
+    fLUTScale = (nPoints - 1)/(fPMTRatio_MaxVal - fPMTRatio_MinVal);
+    if(uniform) {
+      fDriftLUT = fDriftCal;
+      return;
+    }
+    fDriftLUT.resize(nPoints);
+    for(size_t i=0; i<nPoints; i++)
+      fDriftLUT[i] = Interpolate(fPMTRatio_MinVal + i/fLUTScale);
+  }
 
-      // we store the pe in each box per PMT flavour
-      // and the number of "triggered" PMTs
-      if(pd_type=="pmt_coated") {
-        BoxMap_PECoated[box_id]+=PE_v[oc];
-        BoxMap_NCoatedCh[box_id]+=1;
-      }
-      else if(pd_type=="pmt_uncoated") {
-        BoxMap_PEUncoated[box_id]+=PE_v[oc];
-        BoxMap_NUncoatedCh[box_id]+=1;
-      }
+  double DriftEstimatorPMTRatio::GetDriftPosition(std::vector<double> const& PE_v) const{
+
+    // we store the pe in each box per PMT flavour
+    // and the number of "triggered" PMTs
+    std::vector<double> slotPE(fOtherSlot + 1, 0.);
+    std::vector<int> slotNCh(fOtherSlot + 1, 0);
+    size_t const nCh = std::min(PE_v.size(), fChannelSlot.size());
+    for(size_t oc=0; oc<nCh; oc++){
+      size_t const slot = fChannelSlot[oc];
+      slotPE[slot] += PE_v[oc];
+      slotNCh[slot] += (PE_v[oc] != 0);
     }
 
     // compute PMTRatio metric
     double PECoated=0, PEUncoated=0;
     for(size_t boxID=0; boxID<fPDSBoxIDs.size(); boxID++){
       //we need the uncoated PMT in each window and at least one coated
-      if( BoxMap_NUncoatedCh[boxID]==1 && BoxMap_NCoatedCh[boxID]>=1){
-        double CoWeight = 1./BoxMap_NCoatedCh[boxID];
-        PECoated+=CoWeight * BoxMap_PECoated[boxID];
-        PEUncoated+=BoxMap_PEUncoated[boxID];
+      if( slotNCh[2*boxID+1]==1 && slotNCh[2*boxID]>=1){
+        double CoWeight = 1./slotNCh[2*boxID];
+        PECoated+=CoWeight * slotPE[2*boxID];
+        PEUncoated+=slotPE[2*boxID+1];
       }
     }
 
-    if(PECoated!=0){
-      double pmtratio = PEUncoated/PECoated;
+    if(PECoated!=0)
+      return DriftFromRatio(PEUncoated/PECoated);
+    else return fDriftCal[fNCalBins-1];
+  }
+
+  double DriftEstimatorPMTRatio::DriftFromRatio(double pmtratio) const{
 
-      double drift_distance;
-      if(pmtratio<=fPMTRatioCal[0])
-        drift_distance=fDriftCal[0];
-      else if(pmtratio>=fPMTRatioCal[fNCalBins-1])
-        drift_distance=fDriftCal[fNCalBins-1];
-      else
-        drift_distance=Interpolate(pmtratio);
+    if(pmtratio<=fPMTRatio_MinVal) return fDriftLUT.front();
+    if(pmtratio>=fPMTRatio_MaxVal) return fDriftLUT.back();
 
-      return drift_distance;
-    }
-    else return fDriftCal[fNCalBins-1]; 
+    double const x = (pmtratio - fPMTRatio_MinVal)*fLUTScale;
+    size_t const ix = std::min(size_t(x), fDriftLUT.size()-2);
+    return fDriftLUT[ix] + (x - ix)*(fDriftLUT[ix+1] - fDriftLUT[ix]);
   }
 
-  double DriftEstimatorPMTRatio::GetPropagationTime(double drift){
+  double DriftEstimatorPMTRatio::GetPropagationTime(double drift) const{
 
     // drift is here the X coordinate
     // cathode: x=0 cm, PDS: x=200 cm
@@ -207,18 +254,20 @@ namespace lightana
       return std::abs(drift) * fVGroupVUV_I + fVISLightPropTime;
   }
 
-  double DriftEstimatorPMTRatio::PEToPropagationTime(std::vector<double> PE_v){
+  double DriftEstimatorPMTRatio::PEToPropagationTime(std::vector<double> const& PE_v) const{
 
     double _drift = GetDriftPosition(PE_v);
 
     return GetPropagationTime(_drift);
   }
 
-  double DriftEstimatorPMTRatio::Interpolate(double val){
+  double DriftEstimatorPMTRatio::Interpolate(double val) const{
 
     size_t upix = std::upper_bound(fPMTRatioCal.begin(), fPMTRatioCal.end(), val)-fPMTRatioCal.begin();
+    if(upix==0) return fDriftCal.front();
+    if(upix>=fPMTRatioCal.size()) return fDriftCal.back();
 
-    double slope = ( fDriftCal[upix]-fDriftCal[upix] ) / ( fPMTRatioCal[upix]-fPMTRatioCal[upix-1] );
+    double slope = ( fDriftCal[upix]-fDriftCal[upix-1] ) / ( fPMTRatioCal[upix]-fPMTRatioCal[upix-1] );
 
     return fDriftCal[upix-1] + slope * ( val - fPMTRatioCal[upix-1] );
   }
@@ -14,6 +14,10 @@
 #include "art/Utilities/ToolConfigTable.h"
 
 #include "FlashGeoBase.hh"
+#include "OpChannelPositionTable.hh"
+
+#include <algorithm>
+#include <cmath>
 
 namespace lightana{
 
@@ -37,14 +41,17 @@ namespace lightana{
     explicit FlashGeoBarycenter(art::ToolConfigTable<Config> const& config);
 
     // Method to calculate the OpFlash t0
-    void GetFlashLocation(std::vector<double> pePerOpChannel,
+    void GetFlashLocation(std::vector<double> const& pePerOpChannel,
                             double& Ycenter, double& Zcenter,
-                            double& Ywidth, double& Zwidth) override;
+                            double& Ywidth, double& Zwidth) const override;
 
   private:
 
     unsigned int fWeightExp;
 
+    // PD centres by channel
+    OpChannelPositionTable fPositions;
+
     static constexpr double fDefCenterValue = -999.;
 
   };
@@ -53,12 +60,13 @@ namespace lightana{
   FlashGeoBarycenter::FlashGeoBarycenter(art::ToolConfigTable<Config> const& config)
     : fWeightExp{ config().WeightExp() }
   {
+    fPositions.Reserve(::lightana::NOpDets());
   }
 
 
-  void FlashGeoBarycenter::GetFlashLocation(std::vector<double> pePerOpChannel,
+  void FlashGeoBarycenter::GetFlashLocation(std::vector<double> const& pePerOpChannel,
                                             double& Ycenter, double& Zcenter,
-                                            double& Ywidth, double& Zwidth)
+                                            double& Ywidth, double& Zwidth) const
   {
 
     // Reset variables
@@ -67,21 +75,24 @@ namespace lightana{
     double totalPE = 0.;
     double sumy = 0., sumz = 0., sumy2 = 0., sumz2 = 0.;
     double weight =1.;
-    for (unsigned int opch = 0; opch < pePerOpChannel.size(); opch++) {
-      // Get physical detector location for this opChannel
-      double PMTxyz[3];
-      ::lightana::OpDetCenterFromOpChannel(opch, PMTxyz);
 
+    // Get physical detector locations for these opChannels
+    size_t const nopch = std::min(pePerOpChannel.size(), fPositions.size());
+    double const* PMTy = fPositions.Y();
+    double const* PMTz = fPositions.Z();
+    double const* pe = pePerOpChannel.data();
+
+    for (unsigned int opch = 0; opch < nopch; opch++) {
       // Get weight for this channel
-      if(fWeightExp==1) weight = pePerOpChannel[opch];
-      else if(fWeightExp==2) weight = pePerOpChannel[opch]*pePerOpChannel[opch];
-      else weight = std::pow(pePerOpChannel[opch], fWeightExp);
+      if(fWeightExp==1) weight = pe[opch];
+      else if(fWeightExp==2) weight = pe[opch]*pe[opch];
+      else weight = std::pow(pe[opch], fWeightExp);
 
       // Add up the position, weighting with PEs
-      sumy    += weight*PMTxyz[1];
-      sumy2   += weight*PMTxyz[1]*PMTxyz[1];
-      sumz    += weight*PMTxyz[2];
-      sumz2   += weight*PMTxyz[2]*PMTxyz[2];
+      sumy    += weight*PMTy[opch];
+      sumy2   += weight*PMTy[opch]*PMTy[opch];
+      sumz    += weight*PMTz[opch];
+      sumz2   += weight*PMTz[opch]*PMTz[opch];
       totalPE += weight;
     }
 
@@ -21,9 +21,9 @@ namespace lightana
     virtual ~FlashGeoBase() noexcept = default;
 
     // Method to calculate flash geometric properties
-    virtual void GetFlashLocation(std::vector<double> pePerOpChannel,
+    virtual void GetFlashLocation(std::vector<double> const& pePerOpChannel,
                                   double& Ycenter, double& Zcenter,
-                                  double& Ywidth, double& Zwidth) = 0 ;
+                                  double& Ywidth, double& Zwidth) const = 0 ;
 
   private:
 
@@ -15,11 +15,14 @@
 #include "art/Utilities/ToolConfigTable.h"
 
 #include "FlashGeoBase.hh"
+#include "OpChannelPositionTable.hh"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
-#include <map>
+#include <vector>
 
 namespace lightana{
 
@@ -58,14 +61,24 @@ namespace lightana{
     explicit FlashGeoThreshold(art::ToolConfigTable<Config> const& config);
 
     // Method to calculate the OpFlash t0
-    void GetFlashLocation(std::vector<double> pePerOpChannel,
+    void GetFlashLocation(std::vector<double> const& pePerOpChannel,
                             double& Ycenter, double& Zcenter,
-                            double& Ywidth, double& Zwidth) override;
+                            double& Ywidth, double& Zwidth) const override;
 
   private:
 
-    void ResetVars();
-    void GetCenter(std::map<int, double> PEAcc, double& center, double& width);
+    // Y (or Z) positions of the selected PDs, where the #PE are accumulated
+    struct PEAccumulator {
+      std::vector<int> pos;          ///< positions, increasing
+      std::vector<size_t> pdType;    ///< PD type at each position (index in fPDTypes)
+      std::vector<int> chIndex;      ///< position index of each channel (-1 if not selected)
+    };
+
+    void BuildAccumulator(PEAccumulator& acc, std::vector<int> const& chPos,
+                          std::vector<size_t> const& chType);
+    void Normalize(PEAccumulator const& acc, std::vector<double>& pe) const;
+    void GetCenter(PEAccumulator const& acc, std::vector<double> const& pe,
+                   double& center, double& width) const;
 
     // Fhicl configuration parameters
     std::vector<std::string> fPDTypes;
@@ -73,23 +86,15 @@ namespace lightana{
     bool fNormalizeByPDType;
     unsigned int fWeightExp;
 
-    // Store #PE at each YZ position
-    std::map<int, double> fYPEAccumulator;
-    std::map<int, double> fZPEAccumulator;
-
-    // Store PD type ar each YZ position
-    std::map<int, std::string> fPDTypeByY;
-    std::map<int, std::string> fPDTypeByZ;
+    // PD centres by channel
+    OpChannelPositionTable fPositions;
 
-    // Store normalization factor for each PD type
-    std::map<std::string, double> fNormFactorsY;
-    std::map<std::string, double> fNormFactorsZ;
+    // YZ positions
+    PEAccumulator fYPEAccumulator;
+    PEAccumulator fZPEAccumulator;
 
     // PDS mapping
     opdet::sbndPDMapAlg fPDSMap;
-    
-    // Array to store PD xyz position
-    double fPDxyz[3];
 
     static constexpr double fDefCenterValue = -999.;
 
@@ -104,107 +109,104 @@ namespace lightana{
   {
 
     // Initialize YZ map
-    for(size_t opch=0; opch<::lightana::NOpDets(); opch++){
-      
-      if( std::find(fPDTypes.begin(), fPDTypes.end(), fPDSMap.pdType(opch)) == fPDTypes.end() ) continue;
-      
-      ::lightana::OpDetCenterFromOpChannel(opch, fPDxyz);
-      
-      fYPEAccumulator[ (int) fPDxyz[1] ] = 0;
-      fZPEAccumulator[ (int) fPDxyz[2] ] = 0;
-      
-      if(fNormalizeByPDType){
-        fPDTypeByY[ (int) fPDxyz[1] ] = fPDSMap.pdType(opch);
-        fPDTypeByZ[ (int) fPDxyz[2] ] = fPDSMap.pdType(opch);
-      }
-
+    size_t const nopch = ::lightana::NOpDets();
+    fPositions.Reserve(nopch);
+
+    std::vector<int> chY(nopch), chZ(nopch);
+    std::vector<size_t> chType(nopch, fPDTypes.size());
+    for(size_t opch=0; opch<nopch; opch++){
+      auto const it = std::find(fPDTypes.begin(), fPDTypes.end(), fPDSMap.pdType(opch));
+      if( it == fPDTypes.end() ) continue;
+      chType[opch] = it - fPDTypes.begin();
+      chY[opch] = (int) fPositions.Y()[opch];
+      chZ[opch] = (int) fPositions.Z()[opch];
     }
 
-    // Initialize normalixation factors by PD type
-    if(fNormalizeByPDType){
-      for(auto & pd:fPDTypes) {
-        fNormFactorsY[pd]=0.;
-        fNormFactorsZ[pd]=0.;
-      }
+    BuildAccumulator(fYPEAccumulator, chY, chType);
+    BuildAccumulator(fZPEAccumulator, chZ, chType);
+
+  }
+
+
+  void FlashGeoThreshold::BuildAccumulator(PEAccumulator& acc, std::vector<int> const& chPos,
+                                           std::vector<size_t> const& chType)
+  {
+    size_t const nopch = chPos.size();
+
+    for(size_t opch=0; opch<nopch; opch++)
+      if(chType[opch] < fPDTypes.size()) acc.pos.push_back(chPos[opch]);
+    std::sort(acc.pos.begin(), acc.pos.end());
+    acc.pos.erase(std::unique(acc.pos.begin(), acc.pos.end()), acc.pos.end());
+
+    acc.pdType.assign(acc.pos.size(), 0);
+    acc.chIndex.assign(nopch, -1);
+
+    // the PD type of a position is the one of its last channel
+    for(size_t opch=0; opch<nopch; opch++){
+      if(chType[opch] >= fPDTypes.size()) continue;
+      size_t const ix = std::lower_bound(acc.pos.begin(), acc.pos.end(), chPos[opch]) - acc.pos.begin();
+      acc.chIndex[opch] = ix;
+      acc.pdType[ix] = chType[opch];
     }
-  
   }
 
 
-  void FlashGeoThreshold::GetFlashLocation(std::vector<double> pePerOpChannel,
+  void FlashGeoThreshold::GetFlashLocation(std::vector<double> const& pePerOpChannel,
                                             double& Ycenter, double& Zcenter,
-                                            double& Ywidth, double& Zwidth)
+                                            double& Ywidth, double& Zwidth) const
   {
 
     // Reset variables
-    ResetVars();
+    std::vector<double> yPE(fYPEAccumulator.pos.size(), 0.);
+    std::vector<double> zPE(fZPEAccumulator.pos.size(), 0.);
     Ycenter = Zcenter = fDefCenterValue;
     Ywidth  = Zwidth  = fDefCenterValue;
-    
+
     // Fill PE accumulators
-    for (unsigned int opch = 0; opch < pePerOpChannel.size(); opch++) {
-      if( std::find(fPDTypes.begin(), fPDTypes.end(), fPDSMap.pdType(opch)) == fPDTypes.end() ) continue;
-      // Get physical detector location for this opChannel
-      ::lightana::OpDetCenterFromOpChannel(opch, fPDxyz);
-      fYPEAccumulator[(int) fPDxyz[1] ]+=pePerOpChannel[opch];
-      fZPEAccumulator[(int) fPDxyz[2] ]+=pePerOpChannel[opch];
+    size_t const nopch = std::min(pePerOpChannel.size(), fYPEAccumulator.chIndex.size());
+    for (unsigned int opch = 0; opch < nopch; opch++) {
+      if( fYPEAccumulator.chIndex[opch] < 0 ) continue;
+      yPE[ fYPEAccumulator.chIndex[opch] ]+=pePerOpChannel[opch];
+      zPE[ fZPEAccumulator.chIndex[opch] ]+=pePerOpChannel[opch];
     }
 
     // Normalize PE accumulators
+    Normalize(fYPEAccumulator, yPE);
+    Normalize(fZPEAccumulator, zPE);
+
+    // Get YZ position of selected channels (above threshold)
+    GetCenter(fYPEAccumulator, yPE, Ycenter, Ywidth);
+    GetCenter(fZPEAccumulator, zPE, Zcenter, Zwidth);
+
+  }
+
+  void FlashGeoThreshold::Normalize(PEAccumulator const& acc, std::vector<double>& pe) const{
+
+    if(pe.empty()) return;
+
     if(fNormalizeByPDType){
-      
-      // Get normalization values for each PD type (Z)
-      for(auto & z: fZPEAccumulator){
-        if(z.second>fNormFactorsZ[ fPDTypeByZ[z.first] ]) 
-          fNormFactorsZ[ fPDTypeByZ[z.first] ] = z.second;
-      }
 
-      // Get normalization values for each PD type (Y)
-      for(auto & y: fYPEAccumulator){
-        if(y.second>fNormFactorsY[ fPDTypeByY[y.first] ]) 
-          fNormFactorsY[ fPDTypeByY[y.first] ] = y.second;
+      // Get normalization values for each PD type
+      std::vector<double> norm(fPDTypes.size(), 0.);
+      for(size_t ix=0; ix<pe.size(); ix++){
+        if(pe[ix]>norm[ acc.pdType[ix] ])
+          norm[ acc.pdType[ix] ] = pe[ix];
       }
 
-      for(auto & y: fYPEAccumulator)
-        fYPEAccumulator[y.first] = y.second/ fNormFactorsY[ fPDTypeByY[y.first] ]; 
-      
-      for(auto & z: fZPEAccumulator)
-        fZPEAccumulator[z.first] = z.second/ fNormFactorsZ[ fPDTypeByZ[z.first] ]; 
+      for(size_t ix=0; ix<pe.size(); ix++)
+        pe[ix] = pe[ix] / norm[ acc.pdType[ix] ];
 
     }
     else{
 
-      double normY = std::max_element(fYPEAccumulator.begin(), fYPEAccumulator.end(), 
-                      [](const std::pair<int, double> &pe1, const std::pair<int, double> &pe2) 
-                      {return pe1.second < pe2.second;})->second;
-      
-      double normZ =  std::max_element(fZPEAccumulator.begin(), fZPEAccumulator.end(), 
-                      [](const std::pair<int, double> &pe1, const std::pair<int, double> &pe2) 
-                      {return pe1.second < pe2.second;})->second;
-
-      for(auto & y: fYPEAccumulator) fYPEAccumulator[y.first] = y.second / normY; 
-      for(auto & z: fZPEAccumulator) fZPEAccumulator[z.first] = z.second / normZ;
- 
-    }
+      double const norm = *std::max_element(pe.begin(), pe.end());
+      for(auto & v: pe) v = v / norm;
 
-    // Get YZ position of selected channels (above threshold)
-    GetCenter(fYPEAccumulator, Ycenter, Ywidth);
-    GetCenter(fZPEAccumulator, Zcenter, Zwidth);
-
-  }
-
-  void FlashGeoThreshold::ResetVars(){
-    // Reset PE accumulators
-    for(auto & y: fYPEAccumulator) fYPEAccumulator[y.first]=0;
-    for(auto & z: fZPEAccumulator) fZPEAccumulator[z.first]=0;
-    // Reset normalization
-    for(auto & pd:fPDTypes) {
-      fNormFactorsY[pd]=0.;
-      fNormFactorsZ[pd]=0.;
     }
   }
 
-  void FlashGeoThreshold::GetCenter(std::map<int, double> PEAcc, double& center, double& width){
+  void FlashGeoThreshold::GetCenter(PEAccumulator const& acc, std::vector<double> const& peAcc,
+                                    double& center, double& width) const{
 
     // set variables
     center = 0.;
@@ -214,21 +216,24 @@ namespace lightana{
     double sum=0;
     double sum2=0;
 
-    for(auto & pe: PEAcc){
+    for(size_t ix=0; ix<peAcc.size(); ix++){
+
+      double const pe = peAcc[ix];
+      int const pos = acc.pos[ix];
 
       // Get weight for this channel
-      if(fWeightExp==1) weight = pe.second;
-      else if(fWeightExp==2) weight = pe.second*pe.second;
-      else weight = std::pow(pe.second, fWeightExp);
-      
+      if(fWeightExp==1) weight = pe;
+      else if(fWeightExp==2) weight = pe*pe;
+      else weight = std::pow(pe, fWeightExp);
+
       // For OpFlash width consider all channels
       weightNormWidth+=weight;
-      sum+=weight*pe.first;
-      sum2+=weight*pe.first*pe.first;
+      sum+=weight*pos;
+      sum2+=weight*pos*pos;
 
       // For OpFlash center consider only channels above ceertain threshold
-      if(pe.second>fThreshold){  
-        center+=weight*pe.first;
+      if(pe>fThreshold){
+        center+=weight*pos;
         weightNormCenter+=weight;
       }
 
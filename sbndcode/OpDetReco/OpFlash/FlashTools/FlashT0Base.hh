@@ -21,7 +21,7 @@ namespace lightana
     virtual ~FlashT0Base() noexcept = default;
 
     // Method to calculate the OpFlash t0
-    virtual double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) = 0;
+    virtual double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) const = 0;
 
   private:
 
@@ -38,7 +38,7 @@ namespace lightana{
     explicit FlashT0FirstHit(art::ToolConfigTable<Config> const& config);
 
     // Method to calculate the OpFlash t0
-    double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) override;
+    double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) const override;
 
   private:
 
@@ -51,7 +51,7 @@ namespace lightana{
   {
   }
 
-  double FlashT0FirstHit::GetFlashT0(double flash_time, LiteOpHitArray_t ophit_list){
+  double FlashT0FirstHit::GetFlashT0(double flash_time, LiteOpHitArray_t ophit_list) const{
 
     double start_time = flash_time;
 
@@ -19,6 +19,10 @@
 
 #include "FlashT0Base.hh"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 namespace lightana{
 
   class FlashT0SelectedChannels : FlashT0Base
@@ -55,7 +59,7 @@ namespace lightana{
     explicit FlashT0SelectedChannels(art::ToolConfigTable<Config> const& config);
 
     // Method to calculate the OpFlash t0
-    double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) override;
+    double GetFlashT0(double flash_peaktime, LiteOpHitArray_t ophit_list) const override;
 
   private:
 
@@ -74,7 +78,7 @@ namespace lightana{
   {
   }
 
-  double FlashT0SelectedChannels::GetFlashT0(double flash_time, LiteOpHitArray_t ophit_list){
+  double FlashT0SelectedChannels::GetFlashT0(double flash_time, LiteOpHitArray_t ophit_list) const{
 
     std::vector< std::pair<double, double> > selected_hits;
     double pe_sum = 0;
@@ -88,16 +92,18 @@ namespace lightana{
     }
 
     if(pe_sum>0){
-      // sort vector by number of #PE (ascending order)
-      std::sort( selected_hits.begin(), selected_hits.end(), std::greater< std::pair<double, double> >() );
+      // take the ophits by number of #PE (descending order) from a heap:
+      // usually only the first few are needed to reach PDFraction
+      std::make_heap( selected_hits.begin(), selected_hits.end() );
 
       double flasht0_mean=0, pe_count=0;
       int nophits=0;
 
       // loop over selected ophits
-      for (size_t ix=0; ix<selected_hits.size(); ix++) {
-        pe_count += selected_hits[ix].first;
-        flasht0_mean += selected_hits[ix].second;
+      for (auto end=selected_hits.end(); end!=selected_hits.begin(); --end) {
+        std::pop_heap( selected_hits.begin(), end );
+        pe_count += (end-1)->first;
+        flasht0_mean += (end-1)->second;
         nophits++;
         if( pe_count/pe_sum>fPDFraction ) break;
       }
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////
+/// File: OpChannelPositionTable.hh
+///
+/// Centre of the photon detector of each optical channel, kept as
+/// separate x, y and z arrays so that the flash geometry tools run
+/// their weighted sums over plain arrays instead of asking the
+/// geometry service about every channel of every flash
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPCHANNELPOSITIONTABLE_H
+#define SBND_OPCHANNELPOSITIONTABLE_H
+
+#include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderFMWKInterface.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace lightana
+{
+  class OpChannelPositionTable{
+
+  public:
+
+    // Makes sure the first nch channels are in the table
+    void Reserve(std::size_t nch){
+      double xyz[3];
+      for(std::size_t opch=fX.size(); opch<nch; opch++){
+        ::lightana::OpDetCenterFromOpChannel(opch, xyz);
+        fX.push_back(xyz[0]);
+        fY.push_back(xyz[1]);
+        fZ.push_back(xyz[2]);
+      }
+    }
+
+    std::size_t size() const { return fX.size(); }
+
+    double const* X() const { return fX.data(); }
+    double const* Y() const { return fY.data(); }
+    double const* Z() const { return fZ.data(); }
+
+  private:
+
+    std::vector<double> fX;
+    std::vector<double> fY;
+    std::vector<double> fZ;
+
+  };
+}
+
+#endif
@@ -6,7 +6,7 @@
 //// Adapted form ICARUSFlashFinder by Kazuhiro Terao
 //////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -16,13 +16,15 @@
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art/Utilities/make_tool.h"
+#include "art/Persistency/Common/PtrMaker.h"
 
 #include "lardataobj/RecoBase/OpHit.h"
 #include "lardataobj/RecoBase/OpFlash.h"
-#include "lardata/Utilities/AssociationUtil.h"
+#include "canvas/Persistency/Common/Assns.h"
 
 #include <memory>
 #include <string>
+#include "tbb/parallel_for.h"
 #include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderManager.h"
 #include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderFMWKInterface.h"
 #include "sbndcode/OpDetReco/OpFlash/FlashFinder/PECalib.h"
@@ -34,9 +36,9 @@ namespace opdet{
 
   class SBNDFlashFinder;
 
-  class SBNDFlashFinder : public art::EDProducer {
+  class SBNDFlashFinder : public art::SharedProducer {
   public:
-    explicit SBNDFlashFinder(fhicl::ParameterSet const & p);
+    explicit SBNDFlashFinder(fhicl::ParameterSet const & p, art::ProcessingFrame const &);
     // The destructor generated by the compiler is fine for classes
     // without bare pointers or other resource use.
 
@@ -46,12 +48,15 @@ namespace opdet{
     SBNDFlashFinder & operator = (SBNDFlashFinder const &) = delete;
     SBNDFlashFinder & operator = (SBNDFlashFinder &&) = delete;
 
-    // Required functions.
-    void produce(art::Event & e) override;
+    // Required functions. The flash algorithms and tools only read their
+    // configuration, so several events can be processed at the same time.
+    void produce(art::Event & e, art::ProcessingFrame const &) override;
 
   private:
 
-    ::lightana::FlashFinderManager _mgr;
+    // one flash algorithm per TPC/PD subset, all run on the same hits
+    std::vector<::lightana::FlashFinderManager> _mgr_v;
+    bool _use_tpc_workers;
     ::lightana::PECalib _pecalib;
     std::vector<std::string> _hit_producers;
     std::string _ophit_input_time;
@@ -68,22 +73,32 @@ namespace opdet{
     // Tool for light propagation correction
     std::unique_ptr<lightana::DriftEstimatorBase> _driftestimator;
 
-    ::lightana::LiteOpHitArray_t GetAssociatedLiteHits(::lightana::LiteOpFlash_t lite_flash,
-                                                       ::lightana::LiteOpHitArray_t lite_hits_v);
+    ::lightana::LiteOpHitArray_t GetAssociatedLiteHits(::lightana::LiteOpFlash_t const& lite_flash,
+                                                       ::lightana::LiteOpHitArray_t const& lite_hits_v) const;
 
   };
 
-  SBNDFlashFinder::SBNDFlashFinder(lightana::Config_t const & p)
-  : EDProducer{p}
+  SBNDFlashFinder::SBNDFlashFinder(lightana::Config_t const & p, art::ProcessingFrame const &)
+  : SharedProducer{p}
   // Initialize member data here.
   {
     _hit_producers = p.get<std::vector<std::string>>("OpHitProducers");
 
     auto const flash_algo  = p.get<std::string>("FlashFinderAlgo");
-    auto const flash_pset = p.get<lightana::Config_t>("AlgoConfig");
-    auto algo_ptr = ::lightana::FlashAlgoFactory::get().create(flash_algo,flash_algo);
-    algo_ptr->Configure(flash_pset);
-    _mgr.SetFlashAlgo(algo_ptr);
+    // AlgoConfigs lists one configuration per TPC/PD subset,
+    // flashes are stored in that order
+    std::vector<lightana::Config_t> flash_pset_v;
+    if(p.has_key("AlgoConfigs"))
+      flash_pset_v = p.get<std::vector<lightana::Config_t>>("AlgoConfigs");
+    else
+      flash_pset_v.push_back(p.get<lightana::Config_t>("AlgoConfig"));
+    _mgr_v.resize(flash_pset_v.size());
+    for(size_t i=0; i<flash_pset_v.size(); ++i) {
+      auto algo_ptr = ::lightana::FlashAlgoFactory::get().create(flash_algo,flash_algo);
+      algo_ptr->Configure(flash_pset_v[i]);
+      _mgr_v[i].SetFlashAlgo(algo_ptr);
+    }
+    _use_tpc_workers = p.get<bool>("UseTPCWorkers", false);
     _pecalib.Configure(p.get<lightana::Config_t>("PECalib"));
     _ophit_input_time = p.get<std::string>("OpHitInputTime", "PeakTime");
     _use_t0tool = p.get<bool>("UseT0Tool", false);
@@ -105,9 +120,10 @@ namespace opdet{
 
     produces< std::vector<recob::OpFlash>   >();
     produces< art::Assns <recob::OpHit, recob::OpFlash> >();
+    async<art::InEvent>();
   }
 
-  void SBNDFlashFinder::produce(art::Event & e)
+  void SBNDFlashFinder::produce(art::Event & e, art::ProcessingFrame const &)
   {
 
     // produce OpFlash data-product to be filled within module
@@ -137,7 +153,10 @@ namespace opdet{
       ophit_v.insert(ophit_v.end(), temp_v.begin(), temp_v.end());
     }
 
-    for(auto const oph : ophit_v) {
+    ophits.reserve(ophit_v.size());
+    std::vector<double> area_v;
+    area_v.reserve(ophit_v.size());
+    for(auto const& oph : ophit_v) {
       ::lightana::LiteOpHit_t loph;
       if(trigger_time > 1.e20) trigger_time = oph->PeakTimeAbs() - oph->PeakTime();
 
@@ -145,59 +164,68 @@ namespace opdet{
       else if(_ophit_input_time=="StartTime") loph.peak_time = oph->StartTime();
       else loph.peak_time = oph->PeakTime();
 
-      size_t opdet = ::lightana::OpDetFromOpChannel(oph->OpChannel());
-      loph.pe = _pecalib.Calibrate(opdet,oph->Area());
+      area_v.push_back(oph->Area());
       loph.channel = oph->OpChannel();
       ophits.emplace_back(std::move(loph));
     }
+    _pecalib.Calibrate(area_v, ophits);
 
-    auto const flash_v = _mgr.RecoFlash(ophits);
-
-    for(const auto& lflash :  flash_v) {
-
-      // Get Flash Barycenter
-      double Ycenter, Zcenter, Ywidth, Zwidth;
-      _flashgeo->GetFlashLocation(lflash.channel_pe, Ycenter, Zcenter, Ywidth, Zwidth);
-
-      // Get flasht0
-      double flasht0 = lflash.time;
+    // the algorithms only share the (read only) hits, so they can run concurrently
+    std::vector<::lightana::LiteOpFlashArray_t> flash_vv(_mgr_v.size());
+    auto recoFlash = [&](std::size_t i) { flash_vv[i] = _mgr_v[i].RecoFlash(ophits); };
+    if(_use_tpc_workers && _mgr_v.size() > 1)
+      tbb::parallel_for(std::size_t(0), _mgr_v.size(), recoFlash);
+    else
+      for(std::size_t i=0; i<_mgr_v.size(); ++i) recoFlash(i);
 
-      // Refine t0 calculation
-      if(_use_t0tool)
-        flasht0 = _flasht0calculator->GetFlashT0(lflash.time, GetAssociatedLiteHits(lflash, ophits));
+    art::PtrMaker<recob::OpFlash> makeFlashPtr(e);
 
-      // Subtract readout ReadoutDelay
-      flasht0 = flasht0 -  _readout_delay;
+    for(auto const& flash_v : flash_vv) {
+      for(const auto& lflash :  flash_v) {
 
-      // Estimate drift location of the interaction and
-      // make t0 unbias (lght propagation time correction)
-      if(_correct_light_propagation){
-        
-        double drift_distance = _driftestimator->GetDriftPosition( lflash.channel_pe );
-        double propagation_time = _driftestimator->GetPropagationTime( drift_distance );
-        flasht0 = flasht0-propagation_time * 1e-3;
+        // Get Flash Barycenter
+        double Ycenter, Zcenter, Ywidth, Zwidth;
+        _flashgeo->GetFlashLocation(lflash.channel_pe, Ycenter, Zcenter, Ywidth, Zwidth);
 
-        drift_distance = (lflash.tpc==0 ? -drift_distance : drift_distance);
+        // Get flasht0
+        double flasht0 = lflash.time;
 
-        recob::OpFlash flash(flasht0, lflash.time_err, trigger_time + flasht0,
-                           (trigger_time + flasht0) / 1600., lflash.channel_pe,
-                           0, 0, 1, // this are just default values
-                           drift_distance, -1, Ycenter, Ywidth, Zcenter, Zwidth);
-        opflashes->emplace_back(std::move(flash));
+        // Refine t0 calculation
+        if(_use_t0tool)
+          flasht0 = _flasht0calculator->GetFlashT0(lflash.time, GetAssociatedLiteHits(lflash, ophits));
 
-      }
-      else{
-        recob::OpFlash flash(flasht0, lflash.time_err, trigger_time + flasht0,
-                           (trigger_time + flasht0) / 1600., lflash.channel_pe,
-                           0, 0, 1, // this are just default values
-                           100., -1., Ycenter, Ywidth, Zcenter, Zwidth);
-        opflashes->emplace_back(std::move(flash));
-      }
+        // Subtract readout ReadoutDelay
+        flasht0 = flasht0 -  _readout_delay;
 
-      // Create OpHit association
-      for(auto const& hitidx : lflash.asshit_idx) {
-        const art::Ptr<recob::OpHit> hit_ptr(ophit_v.at(hitidx));
-        util::CreateAssn(*this, e, *opflashes, hit_ptr, *flash2hit_assn_v);
+        // Estimate drift location of the interaction and
+        // make t0 unbias (lght propagation time correction)
+        if(_correct_light_propagation){
+        
+          double drift_distance = _driftestimator->GetDriftPosition( lflash.channel_pe );
+          double propagation_time = _driftestimator->GetPropagationTime( drift_distance );
+          flasht0 = flasht0-propagation_time * 1e-3;
+
+          drift_distance = (lflash.tpc==0 ? -drift_distance : drift_distance);
+
+          recob::OpFlash flash(flasht0, lflash.time_err, trigger_time + flasht0,
+                             (trigger_time + flasht0) / 1600., lflash.channel_pe,
+                             0, 0, 1, // this are just default values
+                             drift_distance, -1, Ycenter, Ywidth, Zcenter, Zwidth);
+          opflashes->emplace_back(std::move(flash));
+
+        }
+        else{
+          recob::OpFlash flash(flasht0, lflash.time_err, trigger_time + flasht0,
+                             (trigger_time + flasht0) / 1600., lflash.channel_pe,
+                             0, 0, 1, // this are just default values
+                             100., -1., Ycenter, Ywidth, Zcenter, Zwidth);
+          opflashes->emplace_back(std::move(flash));
+        }
+
+        // Create OpHit association, the flash hits index ophit_v
+        art::Ptr<recob::OpFlash> const flash_ptr = makeFlashPtr(opflashes->size()-1);
+        for(auto const& hitidx : lflash.asshit_idx)
+          flash2hit_assn_v->addSingle(ophit_v.at(hitidx), flash_ptr);
       }
     }
 
@@ -205,14 +233,15 @@ namespace opdet{
     e.put(std::move(flash2hit_assn_v));
   }
 
-  ::lightana::LiteOpHitArray_t SBNDFlashFinder::GetAssociatedLiteHits(::lightana::LiteOpFlash_t lite_flash,
-                                                                      ::lightana::LiteOpHitArray_t lite_hits_v)
+  ::lightana::LiteOpHitArray_t SBNDFlashFinder::GetAssociatedLiteHits(::lightana::LiteOpFlash_t const& lite_flash,
+                                                                      ::lightana::LiteOpHitArray_t const& lite_hits_v) const
   {
 
     ::lightana::LiteOpHitArray_t flash_hits_v;
+    flash_hits_v.reserve(lite_flash.asshit_idx.size());
 
     for(auto const& hitidx : lite_flash.asshit_idx) {
-      flash_hits_v.emplace_back(std::move(lite_hits_v.at(hitidx)));
+      flash_hits_v.push_back(lite_hits_v.at(hitidx));
     }
 
     return flash_hits_v;
@@ -38,6 +38,9 @@
 #include "TH1D.h"
 // #include "TRandom3.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <memory>
 
 class SBNDMCFlash;
@@ -84,7 +87,12 @@ private:
   std::vector<int> _scintillation_pmt_v;
   TTree* _tree1;
 
-  void GetFlashLocation(std::vector<double>, double&, double&, double&, double&);
+  // per opchannel, filled once: whether it is in the PDs and TPC to use,
+  // and the centre of its optical detector
+  std::vector<char> _opch_selected;
+  std::vector<double> _opch_y, _opch_z;
+
+  void GetFlashLocation(std::vector<double> const&, double&, double&, double&, double&);
 
 };
 
@@ -118,6 +126,22 @@ SBNDMCFlash::SBNDMCFlash(fhicl::ParameterSet const& p)
   _tree1->Branch("scintillation_time_v", "std::vector<double>", &_scintillation_time_v);
   _tree1->Branch("scintillation_pmt_v",  "std::vector<int>",    &_scintillation_pmt_v);
 
+  ::art::ServiceHandle<geo::Geometry> geo;
+  std::vector<int> opch_to_use = lightana::PDNamesToList(_pd_to_use);
+  size_t const nOpChannels = geo->NOpDets();
+  _opch_selected.assign(nOpChannels, 0);
+  _opch_y.resize(nOpChannels);
+  _opch_z.resize(nOpChannels);
+  for (size_t opch = 0; opch < nOpChannels; opch++) {
+    auto const& pt = geo->OpDetGeoFromOpChannel(opch).GetCenter();
+    _opch_y[opch] = pt.Y();
+    _opch_z[opch] = pt.Z();
+    if (std::find(opch_to_use.begin(), opch_to_use.end(), int(opch)) == opch_to_use.end()) continue;
+    if (pt.X() < 0 && _tpc == 1) continue;
+    if (pt.X() > 0 && _tpc == 0) continue;
+    _opch_selected[opch] = 1;
+  }
+
   produces< std::vector<recob::OpFlash> >();
 }
 
@@ -197,15 +221,6 @@ void SBNDMCFlash::produce(art::Event& e)
   }
 
 
-  // opdet=>opchannel mapping
-  std::vector<size_t> opdet2opch(geo->NOpDets(),0);
-  for(size_t opch=0; opch<opdet2opch.size(); ++opch){
-    opdet2opch[geo->OpDetFromOpChannel(opch)] = opch;
-  }
-
-  // Get the OpChannel of the PD to use
-  std::vector<int> opch_to_use = lightana::PDNamesToList(_pd_to_use);
-
   // auto const & evt_trigger = (*evt_trigger_h)[0];
   // auto const trig_time = evt_trigger.TriggerTime();
   auto const trig_time = clock_data.TriggerOffsetTPC();
@@ -274,6 +289,12 @@ void SBNDMCFlash::produce(art::Event& e)
 
   float nuTime_elec = clock_data.G4ToElecTime(nuTime) - trig_time;
 
+  // First photon time (ns) that can be in the window, from the inverse of
+  // G4ToElecTime (linear, ns to us), with a margin for the rounding of
+  // the float times; the entries are still all checked against the window
+  double const first_time = (nuTime_elec - _pre_window + trig_time - clock_data.G4ToElecTime(0)) * 1000. + start_window;
+  int const first_key = (int) std::max(std::floor(first_time) - 2., double(std::numeric_limits<int>::lowest()));
+
   for (const art::Handle<std::vector<sim::SimPhotonsLite>> &evt_simphot_h: evt_simphot_hs) {
 
     bool reflected = (evt_simphot_h.provenance()->productInstanceName() == "Reflected");
@@ -285,8 +306,14 @@ void SBNDMCFlash::produce(art::Event& e)
 
       int opch = photons.OpChannel;
 
+      if (!_debug && (opch < 0 || opch >= (int) _opch_selected.size() || !_opch_selected[opch])) continue;
+
+      auto const& detected = photons.DetectedPhotons;
+      auto first = _debug ? detected.begin() : detected.lower_bound(first_key);
+
+      for(auto it = first; it != detected.end(); ++it) {
 
-      for(auto const& pair: photons.DetectedPhotons) {
+        auto const& pair = *it;
 
         float photon_time = pair.first - start_window;
 
@@ -298,16 +325,14 @@ void SBNDMCFlash::produce(art::Event& e)
         }
 
 
-        if (photon_time_elec > nuTime_elec + _window_length) continue;
+        // the times only grow along the map
+        if (photon_time_elec > nuTime_elec + _window_length) {
+          if (_debug) continue;
+          break;
+        }
         if (photon_time_elec > nuTime_elec - _pre_window){
 
-          auto iter = std::find(opch_to_use.begin(), opch_to_use.end(), opch);
-          if (iter == opch_to_use.end()) continue;
-
-          auto const& pt = geo->OpDetGeoFromOpChannel(opch).GetCenter();
-
-          if(pt.X() < 0 && _tpc == 1) continue;
-          if(pt.X() > 0 && _tpc == 0) continue;
+          if (opch < 0 || opch >= (int) _opch_selected.size() || !_opch_selected[opch]) continue;
 
           pmt_v[0][opch] += pair.second;
           _pe_total++;
@@ -348,7 +373,7 @@ void SBNDMCFlash::produce(art::Event& e)
   _tree1->Fill();
 }
 
-void SBNDMCFlash::GetFlashLocation(std::vector<double> pePerOpChannel,
+void SBNDMCFlash::GetFlashLocation(std::vector<double> const& pePerOpChannel,
                                        double& Ycenter,
                                        double& Zcenter,
                                        double& Ywidth,
@@ -363,15 +388,15 @@ void SBNDMCFlash::GetFlashLocation(std::vector<double> pePerOpChannel,
 
   for (unsigned int opch = 0; opch < pePerOpChannel.size(); opch++) {
 
-    // Get physical detector location for this opChannel
-    ::art::ServiceHandle<geo::Geometry> geo;
-    auto const PMTxyz = geo->OpDetGeoFromOpChannel(opch).GetCenter();
+    // Physical detector location for this opChannel
+    double const y = _opch_y[opch];
+    double const z = _opch_z[opch];
 
     // Add up the position, weighting with PEs
-    sumy    += pePerOpChannel[opch]*PMTxyz.Y();
-    sumy2   += pePerOpChannel[opch]*PMTxyz.Y()*PMTxyz.Y();
-    sumz    += pePerOpChannel[opch]*PMTxyz.Z();
-    sumz2   += pePerOpChannel[opch]*PMTxyz.Z()*PMTxyz.Z();
+    sumy    += pePerOpChannel[opch]*y;
+    sumy2   += pePerOpChannel[opch]*y*y;
+    sumz    += pePerOpChannel[opch]*z;
+    sumz2   += pePerOpChannel[opch]*z*z;
 
     totalPE += pePerOpChannel[opch];
   }
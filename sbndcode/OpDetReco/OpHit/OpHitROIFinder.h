@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////
+//
+// OpHitROIFinder.h
+//
+// Regions of interest of an optical waveform for the pulse reconstruction,
+// mostly for the deconvolved waveforms, which are baseline but for short
+// bursts of light.
+//
+// The baseline and the noise are estimated from the median and the median
+// absolute deviation of the samples, which the pulses hardly move. Each
+// sample further than NSigma times the noise (and MinThreshold) from the
+// baseline, in the direction of the pulses, opens a region extended by
+// Padding samples on both sides; overlapping regions are merged. The
+// samples outside of all the regions give the pedestal (mean and RMS) the
+// pulse reconstruction of the regions uses.
+//
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_OPDETRECO_OPHIT_OPHITROIFINDER_H
+#define SBNDCODE_OPDETRECO_OPHIT_OPHITROIFINDER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  class OpHitROIFinder {
+  public:
+
+    /// Samples [begin, end) of the waveform.
+    struct ROI_t {
+      std::size_t begin;
+      std::size_t end;
+    };
+
+    struct Pedestal_t {
+      double mean = 0.;
+      double sigma = 0.;
+    };
+
+    OpHitROIFinder() = default;
+    OpHitROIFinder(double nSigma, double minThreshold, std::size_t padding, bool positivePolarity)
+      : fNSigma(nSigma), fMinThreshold(minThreshold), fPadding(padding)
+      , fPolarity(positivePolarity ? 1 : -1) {}
+
+    /// Finds the regions of interest of the samples and the pedestal of the
+    /// samples outside of them; false if no sample is left outside (or the
+    /// waveform is empty), in which case the whole waveform should be
+    /// reconstructed. buffer is scratch space, kept to avoid allocations.
+    template <typename Sample>
+    bool Find(std::vector<Sample> const& samples, std::vector<ROI_t>& rois,
+              Pedestal_t& pedestal, std::vector<double>& buffer) const;
+
+  private:
+
+    double fNSigma = 5.;
+    double fMinThreshold = 0.;
+    std::size_t fPadding = 50;
+    int fPolarity = 1;
+  };
+
+} // namespace opdet
+
+//----------------------------------------------------------------------
+
+template <typename Sample>
+bool opdet::OpHitROIFinder::Find(std::vector<Sample> const& samples, std::vector<ROI_t>& rois,
+                                 Pedestal_t& pedestal, std::vector<double>& buffer) const
+{
+  rois.clear();
+  std::size_t const n = samples.size();
+  if (n == 0) return false;
+
+  // median and median absolute deviation
+  buffer.assign(samples.begin(), samples.end());
+  auto const mid = buffer.begin() + n/2;
+  std::nth_element(buffer.begin(), mid, buffer.end());
+  double const median = *mid;
+  for (double& x : buffer) x = std::abs(x - median);
+  std::nth_element(buffer.begin(), mid, buffer.end());
+  double const noise = 1.4826 * *mid; // sigma of a gaussian noise
+  double const threshold = std::max(fNSigma*noise, fMinThreshold);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (fPolarity*(samples[i] - median) <= threshold) continue;
+    std::size_t const begin = i > fPadding ? i - fPadding : 0;
+    std::size_t const end = std::min(n, i + fPadding + 1);
+    if (!rois.empty() && begin <= rois.back().end) rois.back().end = end;
+    else rois.push_back({ begin, end });
+  }
+
+  // pedestal of the samples outside of the regions
+  double sum = 0., sum2 = 0.;
+  std::size_t nOutside = 0;
+  std::size_t from = 0;
+  for (std::size_t i_roi = 0; i_roi <= rois.size(); ++i_roi) {
+    std::size_t const to = i_roi < rois.size() ? rois[i_roi].begin : n;
+    for (std::size_t i = from; i < to; ++i) {
+      sum += samples[i];
+      sum2 += double(samples[i])*samples[i];
+    }
+    nOutside += to - from;
+    if (i_roi < rois.size()) from = rois[i_roi].end;
+  }
+  if (nOutside == 0) return false;
+
+  pedestal.mean = sum/nOutside;
+  pedestal.sigma = std::sqrt(std::max(0., sum2/nOutside - pedestal.mean*pedestal.mean));
+  return true;
+}
+
+#endif // SBNDCODE_OPDETRECO_OPHIT_OPHITROIFINDER_H
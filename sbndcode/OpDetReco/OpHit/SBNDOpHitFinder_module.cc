@@ -32,7 +32,7 @@
 #include "larreco/Calibrator/PhotonCalibratorStandard.h"
 
 // Framework includes
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/SharedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Utilities/make_tool.h"
@@ -41,6 +41,10 @@
 #include "canvas/Utilities/Exception.h"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetReco/OpHit/OpHitROIFinder.h"
+#include "sbndcode/OpDetSim/CompactWaveform/CompactOpDetWaveforms.h"
+#include "sbndcode/Utilities/EventPerformance.h"
+#include "sbndcode/Utilities/ThreadPool.h"
 // #include "sbndcode/OpDetReco/OpFlash/FlashFinder/FlashFinderFMWKInterface.h"
 
 
@@ -51,6 +55,13 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "tbb/parallel_for.h"
+#include "tbb/task_arena.h"
 
 namespace {
   template <typename T>
@@ -62,19 +73,53 @@ namespace {
     else
       return new T(hit_alg_pset, nullptr);
   }
+
+  pmtana::PMTPulseRecoBase* makeThresholdAlgorithm(fhicl::ParameterSet const& hit_alg_pset,
+                                                   std::optional<fhicl::ParameterSet> const& rise_alg_pset)
+  {
+    std::string threshAlgName = hit_alg_pset.get<std::string>("Name");
+    if (threshAlgName == "Threshold")
+      return thresholdAlgorithm<pmtana::AlgoThreshold>(hit_alg_pset, rise_alg_pset);
+    else if (threshAlgName == "SiPM")
+      return thresholdAlgorithm<pmtana::AlgoSiPM>(hit_alg_pset, rise_alg_pset);
+    else if (threshAlgName == "SlidingWindow")
+      return thresholdAlgorithm<pmtana::AlgoSlidingWindow>(hit_alg_pset, rise_alg_pset);
+    else if (threshAlgName == "FixedWindow")
+      return thresholdAlgorithm<pmtana::AlgoFixedWindow>(hit_alg_pset, rise_alg_pset);
+    else if (threshAlgName == "CFD")
+      return thresholdAlgorithm<pmtana::AlgoCFD>(hit_alg_pset, rise_alg_pset);
+    else
+      throw art::Exception(art::errors::UnimplementedFeature)
+        << "Cannot find implementation for " << threshAlgName << " algorithm.\n";
+  }
+
+  pmtana::PMTPedestalBase* makePedestalAlgorithm(fhicl::ParameterSet const& ped_alg_pset)
+  {
+    std::string pedAlgName = ped_alg_pset.get< std::string >("Name");
+    if      (pedAlgName == "Edges")
+      return new pmtana::PedAlgoEdges(ped_alg_pset);
+    else if (pedAlgName == "RollingMean")
+      return new pmtana::PedAlgoRollingMean(ped_alg_pset);
+    else if (pedAlgName == "UB"   )
+      return new pmtana::PedAlgoUB(ped_alg_pset);
+    else throw art::Exception(art::errors::UnimplementedFeature)
+      << "Cannot find implementation for "
+    << pedAlgName << " algorithm.\n";
+  }
 }
 
 namespace opdet {
 
-  class SBNDOpHitFinder : public art::EDProducer{
+  class SBNDOpHitFinder : public art::SharedProducer{
   public:
 
     // Standard constructor and destructor for an ART module.
-    explicit SBNDOpHitFinder(const fhicl::ParameterSet&);
+    SBNDOpHitFinder(const fhicl::ParameterSet&, art::ProcessingFrame const&);
     virtual ~SBNDOpHitFinder();
 
-    // The producer routine, called once per event.
-    void produce(art::Event&);
+    // The producer routine, called once per event; events may be
+    // processed at the same time, each with its own pulse reconstruction
+    void produce(art::Event&, art::ProcessingFrame const&) override;
 
   private:
     std::map< int, int >  GetChannelMap();
@@ -82,19 +127,84 @@ namespace opdet {
     std::vector< double > GetSPEShifts();
     std::vector<int> PDNamesToList(std::vector<std::string>);
 
+    // Pulse reconstruction algorithms; the manager and the algorithms
+    // keep the state of the last waveform, so each task needs its own
+    struct PulseReco_t {
+      pmtana::PulseRecoManager mgr;
+      std::unique_ptr<pmtana::PMTPulseRecoBase> threshAlg;
+      std::unique_ptr<pmtana::PMTPedestalBase> pedAlg;
+      // scratch space of the regions of interest, reused waveform after waveform
+      mutable std::vector<OpHitROIFinder::ROI_t> rois;
+      mutable std::vector<double> roiBuffer;
+      mutable pmtana::Waveform_t roiSamples;
+      mutable pmtana::PedestalMean_t roiPedMean;
+      mutable pmtana::PedestalSigma_t roiPedSigma;
+    };
+    /// One set of algorithms for each parallel task; the first is used serially
+    using PulseRecoSet_t = std::vector< std::unique_ptr<PulseReco_t> >;
+
+    // Takes a set of algorithms out of the pool, making a new one if all
+    // are in use by other events, and puts it back when done
+    std::unique_ptr<PulseRecoSet_t> AcquirePulseReco();
+    void ReleasePulseReco(std::unique_ptr<PulseRecoSet_t> recoSet);
+    std::unique_ptr<PulseRecoSet_t> MakePulseReco() const;
+
+    // Hits of the waveforms [begin, end), in the order of the waveforms
+    void FindHits(std::vector< raw::OpDetWaveform const* >::const_iterator begin,
+                  std::vector< raw::OpDetWaveform const* >::const_iterator end,
+                  PulseReco_t const& reco,
+                  geo::GeometryCore const& geometry,
+                  detinfo::DetectorClocksData const& clockData,
+                  calib::IPhotonCalibrator const& calibrator,
+                  std::vector< recob::OpHit >& hits) const;
+
+    // A segment of a packed waveform product
+    using CompactSegment_t = std::pair< sbnd::CompactOpDetWaveforms const*, std::size_t >;
+
+    // Same, for segments of packed waveforms, unpacked one at a time
+    void FindHits(std::vector< CompactSegment_t >::const_iterator begin,
+                  std::vector< CompactSegment_t >::const_iterator end,
+                  PulseReco_t const& reco,
+                  geo::GeometryCore const& geometry,
+                  detinfo::DetectorClocksData const& clockData,
+                  calib::IPhotonCalibrator const& calibrator,
+                  std::vector< recob::OpHit >& hits) const;
+
+    // Hits of one waveform, reconstructed in its regions of interest
+    // only (with the pedestal of the rest of the waveform) if fUseROI
+    void FindWaveformHits(raw::OpDetWaveform const& waveform,
+                          PulseReco_t const& reco,
+                          geo::GeometryCore const& geometry,
+                          detinfo::DetectorClocksData const& clockData,
+                          calib::IPhotonCalibrator const& calibrator,
+                          std::vector< recob::OpHit >& hits) const;
+
+    // The segments of the packed waveforms to reconstruct
+    std::vector< CompactSegment_t > GetCompactSegments(art::Event const& evt) const;
+
 
     // The parameters we'll read from the .fcl file.
     std::string fInputModule; // Input tag for OpDetWaveform collection
     std::string fGenModule;
     std::vector< std::string > fInputLabels;
+    bool fInputCompact; ///< Input is sbnd::CompactOpDetWaveforms
     std::set< unsigned int > fChannelMasks;
     std::vector<std::string> _pd_to_use; ///< PDS to use (ex: "pmt", "barepmt")
     std::string fElectronics; ///< PDS readouts to use (ex: "CAEN", "Daphne")
     std::vector<int> _opch_to_use; ///< List of of opch (will be infered from _pd_to_use)
+    std::vector<bool> fUseChannel; ///< Whether each opch is in _opch_to_use and not masked
 
-    pmtana::PulseRecoManager  fPulseRecoMgr;
-    pmtana::PMTPulseRecoBase* fThreshAlg;
-    pmtana::PMTPedestalBase*  fPedAlg;
+    fhicl::ParameterSet fHitAlgPset;
+    fhicl::ParameterSet fPedAlgPset;
+    std::optional<fhicl::ParameterSet> fRiseAlgPset;
+    unsigned int fNReco; ///< Parallel tasks of each event
+
+    std::vector< std::unique_ptr<PulseRecoSet_t> > fPulseRecoPool; ///< Sets not in use
+    std::mutex fPulseRecoMutex;
+    bool fUseChannelWorkers; ///< Reconstruct the waveforms in parallel
+    unsigned int fNThreads;  ///< Threads of the channel workers (0: all available to the job)
+    bool fUseROI;            ///< Reconstruct only the regions of interest of each waveform
+    OpHitROIFinder fROIFinder;
 
     Float_t  fHitThreshold,fDaphne_Freq;
     unsigned int fMaxOpChannel;
@@ -114,14 +224,14 @@ namespace opdet {
 
   //----------------------------------------------------------------------------
   // Constructor
-  SBNDOpHitFinder::SBNDOpHitFinder(const fhicl::ParameterSet & pset):
-  EDProducer{pset},
-  fPulseRecoMgr()
+  SBNDOpHitFinder::SBNDOpHitFinder(const fhicl::ParameterSet & pset, art::ProcessingFrame const&):
+  SharedProducer{pset}
   {
     // Indicate that the Input Module comes from .fcl
     fInputModule   = pset.get< std::string >("InputModule");
     fGenModule     = pset.get< std::string >("GenModule");
     fInputLabels   = pset.get< std::vector< std::string > >("InputLabels");
+    fInputCompact  = pset.get< bool >("InputCompact", false);
 
     for (auto const& ch : pset.get< std::vector< unsigned int > >
       ("ChannelMasks", std::vector< unsigned int >()))
@@ -131,6 +241,17 @@ namespace opdet {
     fElectronics = pset.get< std::string >("Electronics");
     _opch_to_use = this->PDNamesToList(_pd_to_use);
 
+    fUseChannelWorkers = pset.get< bool >("UseChannelWorkers", false);
+    fNThreads          = pset.get< unsigned int >("NThreads", 0);
+
+    fUseROI = pset.get< bool >("UseROI", false);
+    if (fUseROI) {
+      fROIFinder = OpHitROIFinder(pset.get< double >("ROINSigma", 5.),
+                                  pset.get< double >("ROIMinThreshold", 0.),
+                                  pset.get< std::size_t >("ROIPadding", 50),
+                                  pset.get< bool >("ROIPositivePolarity", true));
+    }
+
     fDaphne_Freq  = pset.get< float >("DaphneFreq");
     fHitThreshold = pset.get< float >("HitThreshold");
     bool useCalibrator = pset.get< bool > ("UseCalibrator", false);
@@ -138,6 +259,15 @@ namespace opdet {
     auto const& geometry(*lar::providerFrom< geo::Geometry >());
     fMaxOpChannel = geometry.MaxOpChannel();
 
+    // channel filter: in the list of PDS to use and not masked
+    int maxUsedChannel = -1;
+    for (int ch : _opch_to_use) maxUsedChannel = std::max(maxUsedChannel, ch);
+    fUseChannel.assign(maxUsedChannel + 1, false);
+    for (int ch : _opch_to_use)
+      if (ch >= 0) fUseChannel[ch] = true;
+    for (unsigned int ch : fChannelMasks)
+      if (ch < fUseChannel.size()) fUseChannel[ch] = false;
+
     if (useCalibrator) {
       // If useCalibrator, get it from ART
       fCalib = lar::providerFrom<calib::IPhotonCalibratorService>();
@@ -160,43 +290,21 @@ namespace opdet {
       fCalib = new calib::PhotonCalibratorStandard(SPEArea, SPEShift, areaToPE);
     }
 
-    // Initialize the rise time calculator tool
-    auto const rise_alg_pset = pset.get_if_present<fhicl::ParameterSet>("RiseTimeCalculator");
-
-    // Initialize the hit finder algorithm
-    auto const hit_alg_pset = pset.get<fhicl::ParameterSet>("HitAlgoPset");
-    std::string threshAlgName = hit_alg_pset.get<std::string>("Name");
-    if (threshAlgName == "Threshold")
-      fThreshAlg = thresholdAlgorithm<pmtana::AlgoThreshold>(hit_alg_pset, rise_alg_pset);
-    else if (threshAlgName == "SiPM")
-      fThreshAlg = thresholdAlgorithm<pmtana::AlgoSiPM>(hit_alg_pset, rise_alg_pset);
-    else if (threshAlgName == "SlidingWindow")
-      fThreshAlg = thresholdAlgorithm<pmtana::AlgoSlidingWindow>(hit_alg_pset, rise_alg_pset);
-    else if (threshAlgName == "FixedWindow")
-      fThreshAlg = thresholdAlgorithm<pmtana::AlgoFixedWindow>(hit_alg_pset, rise_alg_pset);
-    else if (threshAlgName == "CFD")
-      fThreshAlg = thresholdAlgorithm<pmtana::AlgoCFD>(hit_alg_pset, rise_alg_pset);
-    else
-      throw art::Exception(art::errors::UnimplementedFeature)
-        << "Cannot find implementation for " << threshAlgName << " algorithm.\n";
+    // Configuration of the rise time calculator tool
+    fRiseAlgPset = pset.get_if_present<fhicl::ParameterSet>("RiseTimeCalculator");
 
-    // Initialize the pedestal estimation algorithm
-    auto const ped_alg_pset = pset.get< fhicl::ParameterSet >("PedAlgoPset");
-    std::string pedAlgName = ped_alg_pset.get< std::string >("Name");
-    if      (pedAlgName == "Edges")
-      fPedAlg = new pmtana::PedAlgoEdges(ped_alg_pset);
-    else if (pedAlgName == "RollingMean")
-      fPedAlg = new pmtana::PedAlgoRollingMean(ped_alg_pset);
-    else if (pedAlgName == "UB"   )
-      fPedAlg = new pmtana::PedAlgoUB(ped_alg_pset);
-    else throw art::Exception(art::errors::UnimplementedFeature)
-      << "Cannot find implementation for "
-    << pedAlgName << " algorithm.\n";
+    // Configuration of the hit finder and pedestal estimation algorithms,
+    // instantiated once for each task of each event in flight
+    fHitAlgPset = pset.get<fhicl::ParameterSet>("HitAlgoPset");
+    fPedAlgPset = pset.get< fhicl::ParameterSet >("PedAlgoPset");
+    fNReco = 1;
+    if (fUseChannelWorkers)
+      fNReco = fNThreads ? fNThreads : (unsigned int) tbb::this_task_arena::max_concurrency();
+    // the first set is made here, so that configuration errors show up early
+    fPulseRecoPool.push_back(MakePulseReco());
 
     produces< std::vector< recob::OpHit > >();
-
-    fPulseRecoMgr.AddRecoAlgo(fThreshAlg);
-    fPulseRecoMgr.SetDefaultPedAlgo(fPedAlg);
+    async<art::InEvent>();
 
   }
 
@@ -204,14 +312,46 @@ namespace opdet {
   // Destructor
   SBNDOpHitFinder::~SBNDOpHitFinder()
   {
+  }
 
-    delete fThreshAlg;
-    delete fPedAlg;
+  //----------------------------------------------------------------------------
+  std::unique_ptr<SBNDOpHitFinder::PulseRecoSet_t> SBNDOpHitFinder::MakePulseReco() const
+  {
+    auto recoSet = std::make_unique<PulseRecoSet_t>();
+    for (unsigned int i = 0; i < fNReco; ++i) {
+      auto reco = std::make_unique<PulseReco_t>();
+      reco->threshAlg.reset(makeThresholdAlgorithm(fHitAlgPset, fRiseAlgPset));
+      reco->pedAlg.reset(makePedestalAlgorithm(fPedAlgPset));
+      reco->mgr.AddRecoAlgo(reco->threshAlg.get());
+      reco->mgr.SetDefaultPedAlgo(reco->pedAlg.get());
+      recoSet->push_back(std::move(reco));
+    }
+    return recoSet;
+  }
+
+  //----------------------------------------------------------------------------
+  std::unique_ptr<SBNDOpHitFinder::PulseRecoSet_t> SBNDOpHitFinder::AcquirePulseReco()
+  {
+    {
+      std::lock_guard<std::mutex> lock(fPulseRecoMutex);
+      if (!fPulseRecoPool.empty()) {
+        auto recoSet = std::move(fPulseRecoPool.back());
+        fPulseRecoPool.pop_back();
+        return recoSet;
+      }
+    }
+    return MakePulseReco();
+  }
 
+  //----------------------------------------------------------------------------
+  void SBNDOpHitFinder::ReleasePulseReco(std::unique_ptr<PulseRecoSet_t> recoSet)
+  {
+    std::lock_guard<std::mutex> lock(fPulseRecoMutex);
+    fPulseRecoPool.push_back(std::move(recoSet));
   }
 
   //----------------------------------------------------------------------------
-  void SBNDOpHitFinder::produce(art::Event& evt)
+  void SBNDOpHitFinder::produce(art::Event& evt, art::ProcessingFrame const&)
   {
 
     // These is the storage pointer we will put in the event
@@ -252,22 +392,20 @@ namespace opdet {
     // Get the pulses from the event
     //
 
-    // Load pulses into WaveformVector
-    if(fChannelMasks.empty() && _opch_to_use.empty() && fInputLabels.size()<2) {
+    // Load pulses into WaveformVector, or the packed ones into CompactVector
+    std::vector< raw::OpDetWaveform const* > WaveformVector;
+    std::vector< CompactSegment_t > CompactVector;
+    if(fInputCompact) {
+      CompactVector = GetCompactSegments(evt);
+    } else if(fChannelMasks.empty() && _opch_to_use.empty() && fInputLabels.size()<2) {
       art::Handle< std::vector< raw::OpDetWaveform > > wfHandle;
       if(fInputLabels.empty())
         evt.getByLabel(fInputModule, wfHandle);
       else
         evt.getByLabel(fInputModule, fInputLabels.front(), wfHandle);
       assert(wfHandle.isValid());
-      RunHitFinder(*wfHandle,
-                   *HitPtr,
-                   fPulseRecoMgr,
-                   *fThreshAlg,
-                   geometry,
-                   fHitThreshold,
-                   clockData,
-                   calibrator);
+      WaveformVector.reserve(wfHandle->size());
+      for(auto const& wf : *wfHandle) WaveformVector.push_back(&wf);
     } else {
 
       // Reserve a large enough array
@@ -280,7 +418,6 @@ namespace opdet {
         totalsize += wfHandle->size();
       }
 
-      std::vector< raw::OpDetWaveform > WaveformVector;
       WaveformVector.reserve(totalsize);
 
       for (auto label : fInputLabels)
@@ -291,33 +428,65 @@ namespace opdet {
 
         for(auto const& wf : *wfHandle)
         {
-          // If this channel is in the channel mask, ingore it
-          if ( fChannelMasks.find(wf.ChannelNumber()) != fChannelMasks.end() ) continue;
-          // If this PDS in not in the list of PDS to use, ingore it
-          if ( std::find(_opch_to_use.begin(), _opch_to_use.end(), wf.ChannelNumber()) == _opch_to_use.end() ) continue;
+          // If this channel is masked or its PDS is not in the list of PDS to use, ignore it
+          if ( wf.ChannelNumber() >= fUseChannel.size() || !fUseChannel[wf.ChannelNumber()] ) continue;
 
-          WaveformVector.push_back(wf);
+          WaveformVector.push_back(&wf);
         }
       }
+    }
+
+    // a set of algorithms not used by any other event, returned to the pool
+    // at the end of the event (or when an exception is thrown)
+    struct PulseRecoLease {
+      SBNDOpHitFinder& module;
+      std::unique_ptr<PulseRecoSet_t> recoSet;
+      ~PulseRecoLease() { module.ReleasePulseReco(std::move(recoSet)); }
+    } lease{*this, AcquirePulseReco()};
+    PulseRecoSet_t const& pulseReco = *lease.recoSet;
+
+    // hits of the block i of nBlocks of the waveforms
+    size_t const nWaveforms = fInputCompact ? CompactVector.size() : WaveformVector.size();
+    auto findBlockHits = [&](size_t i, size_t nBlocks, PulseReco_t const& reco,
+                             std::vector< recob::OpHit >& hits) {
+      size_t const begin = i*nWaveforms/nBlocks, end = (i + 1)*nWaveforms/nBlocks;
+      if (fInputCompact)
+        FindHits(CompactVector.begin() + begin, CompactVector.begin() + end,
+                 reco, geometry, clockData, calibrator, hits);
+      else
+        FindHits(WaveformVector.begin() + begin, WaveformVector.begin() + end,
+                 reco, geometry, clockData, calibrator, hits);
+    };
 
-      RunHitFinder(WaveformVector,
-                   *HitPtr,
-                   fPulseRecoMgr,
-                   *fThreshAlg,
-                   geometry,
-                   fHitThreshold,
-                   clockData,
-                   calibrator);
-      // for (auto h : *HitPtr)
-      //   std::cout << "> ophit time " << h.PeakTime()
-      //             << ", corrected " << h.PeakTime() - clockData.TriggerTime()
-      //             << ", area " << h.Area()
-      //             << ", pe " << h.PE() << std::endl;
+    if (pulseReco.size() < 2) {
+      findBlockHits(0, 1, *pulseReco.front(), *HitPtr);
+    }
+    else {
+      // each task takes a contiguous block of waveforms with its own algorithms;
+      // the blocks are joined in order, so the hits are the same as in serial
+      size_t const nTasks = pulseReco.size();
+      std::vector< std::vector< recob::OpHit > > taskHits(nTasks);
+      sbnd::ThreadPool pool(nTasks);
+      pool.Execute([&] {
+        tbb::parallel_for(std::size_t(0), nTasks, [&](std::size_t i) {
+          findBlockHits(i, nTasks, *pulseReco[i], taskHits[i]);
+        });
+      });
+      size_t nHits = 0;
+      for (auto const& hits : taskHits) nHits += hits.size();
+      HitPtr->reserve(nHits);
+      for (auto const& hits : taskHits) HitPtr->insert(HitPtr->end(), hits.begin(), hits.end());
     }
+    // for (auto h : *HitPtr)
+    //   std::cout << "> ophit time " << h.PeakTime()
+    //             << ", corrected " << h.PeakTime() - clockData.TriggerTime()
+    //             << ", area " << h.Area()
+    //             << ", pe " << h.PE() << std::endl;
 
     // Now correct the time. Unfortunately, there are no setter methods for OpHits,
     // so we have to make a new OpHit vector.
-    for (auto h : *HitPtr) {
+    HitPtrFinal->reserve(HitPtr->size());
+    for (auto const& h : *HitPtr) {
       (*HitPtrFinal).emplace_back(h.OpChannel(),
                                   h.PeakTime() + clockData.TriggerTime(),
                                   h.PeakTimeAbs(),
@@ -331,10 +500,112 @@ namespace opdet {
                                   0.0);
     }
     // Store results into the event
+    sbnd::perf::Count("OpHits", HitPtrFinal->size());
     evt.put(std::move(HitPtrFinal));
 
   }
 
+  //----------------------------------------------------------------------------
+  // Same as RunHitFinder() from OpHitAlg, over a list of waveforms
+  void SBNDOpHitFinder::FindHits(std::vector< raw::OpDetWaveform const* >::const_iterator begin,
+                                 std::vector< raw::OpDetWaveform const* >::const_iterator end,
+                                 PulseReco_t const& reco,
+                                 geo::GeometryCore const& geometry,
+                                 detinfo::DetectorClocksData const& clockData,
+                                 calib::IPhotonCalibrator const& calibrator,
+                                 std::vector< recob::OpHit >& hits) const
+  {
+    for (auto it = begin; it != end; ++it)
+      FindWaveformHits(**it, reco, geometry, clockData, calibrator, hits);
+  }
+
+  //----------------------------------------------------------------------------
+  void SBNDOpHitFinder::FindHits(std::vector< CompactSegment_t >::const_iterator begin,
+                                 std::vector< CompactSegment_t >::const_iterator end,
+                                 PulseReco_t const& reco,
+                                 geo::GeometryCore const& geometry,
+                                 detinfo::DetectorClocksData const& clockData,
+                                 calib::IPhotonCalibrator const& calibrator,
+                                 std::vector< recob::OpHit >& hits) const
+  {
+    // the pulse reconstruction takes a whole waveform: each segment is
+    // unpacked into the same buffer, which stops allocating after the longest
+    raw::OpDetWaveform waveform;
+    for (auto it = begin; it != end; ++it) {
+      it->first->Decode(it->second, waveform);
+      FindWaveformHits(waveform, reco, geometry, clockData, calibrator, hits);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SBNDOpHitFinder::FindWaveformHits(raw::OpDetWaveform const& waveform,
+                                         PulseReco_t const& reco,
+                                         geo::GeometryCore const& geometry,
+                                         detinfo::DetectorClocksData const& clockData,
+                                         calib::IPhotonCalibrator const& calibrator,
+                                         std::vector< recob::OpHit >& hits) const
+  {
+    const int channel = static_cast< int >(waveform.ChannelNumber());
+
+    if (!geometry.IsValidOpChannel(channel)) {
+      mf::LogError("OpHitFinder") << "Error! unrecognized channel number " << channel
+                                  << ". Ignoring pulse";
+      return;
+    }
+
+    OpHitROIFinder::Pedestal_t pedestal;
+    if (!fUseROI || !fROIFinder.Find(waveform, reco.rois, pedestal, reco.roiBuffer)) {
+      reco.mgr.Reconstruct(waveform);
+
+      for (auto const& pulse : reco.threshAlg->GetPulses())
+        ConstructHit(fHitThreshold, channel, waveform.TimeStamp(), pulse, hits, clockData, calibrator);
+      return;
+    }
+
+    // each region is reconstructed as a waveform of its own starting at
+    // its first sample, with the pedestal of the samples outside the regions
+    double const tickPeriod = clockData.OpticalClock().TickPeriod();
+    for (auto const& roi : reco.rois) {
+      std::size_t const nSamples = roi.end - roi.begin;
+      reco.roiSamples.assign(waveform.begin() + roi.begin, waveform.begin() + roi.end);
+      reco.roiPedMean.assign(nSamples, pedestal.mean);
+      reco.roiPedSigma.assign(nSamples, pedestal.sigma);
+      reco.threshAlg->Reconstruct(reco.roiSamples, reco.roiPedMean, reco.roiPedSigma);
+
+      double const timeStamp = waveform.TimeStamp() + roi.begin*tickPeriod;
+      for (auto const& pulse : reco.threshAlg->GetPulses())
+        ConstructHit(fHitThreshold, channel, timeStamp, pulse, hits, clockData, calibrator);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  std::vector< SBNDOpHitFinder::CompactSegment_t >
+  SBNDOpHitFinder::GetCompactSegments(art::Event const& evt) const
+  {
+    // the channels are selected as for the waveforms, reading only the
+    // channel of each segment; the samples stay packed until reconstructed
+    bool const filter = !(fChannelMasks.empty() && _opch_to_use.empty());
+    std::vector< std::string > const labels = fInputLabels.empty()
+      ? std::vector< std::string >{ "" } : fInputLabels;
+
+    std::vector< CompactSegment_t > segments;
+    for (auto const& label : labels)
+    {
+      art::Handle< sbnd::CompactOpDetWaveforms > wfHandle;
+      evt.getByLabel(fInputModule, label, wfHandle);
+      if (!wfHandle.isValid()) continue; // Skip non-existent collections
+
+      segments.reserve(segments.size() + wfHandle->size());
+      for (std::size_t i = 0; i < wfHandle->size(); ++i)
+      {
+        raw::Channel_t const channel = wfHandle->Channel(i);
+        if ( filter && (channel >= fUseChannel.size() || !fUseChannel[channel]) ) continue;
+        segments.emplace_back(wfHandle.product(), i);
+      }
+    }
+    return segments;
+  }
+
   std::vector<int> SBNDOpHitFinder::PDNamesToList(std::vector<std::string> pd_names) {
 
     std::vector<int> out_ch_v;
@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   CompactOpDetWaveforms.h
+///
+/// \brief  All the optical detector waveforms of an event in one product,
+///         with the samples packed into a single delta-encoded pool.
+///
+/// A collection of raw::OpDetWaveform keeps each readout segment in a
+/// vector of its own, next to its channel and time stamp. This product
+/// keeps the same segments in four flat arrays: the channel and time stamp
+/// of each segment, the offset of each segment in the sample pool, and the
+/// pool, where the segments follow each other. The first sample of a
+/// segment is stored as it is, each of the others as the difference from
+/// the sample before it (modulo 2^16, so that any waveform comes back
+/// exact). Along a baseline the differences are a few counts, and ROOT
+/// compresses the pool much better than the raw samples.
+///
+/// The segments are written one after the other and read by index:
+///
+///   sbnd::CompactOpDetWaveforms compact;
+///   compact.Add(wf.ChannelNumber(), wf.TimeStamp(), wf.data(), wf.size());
+///
+///   raw::OpDetWaveform buffer;
+///   for (std::size_t i = 0; i < compact.size(); ++i) {
+///     compact.Decode(i, buffer);  // reuses the buffer capacity
+///     ...
+///   }
+///
+/// Segment() gives the channel, time stamp and packed samples of a segment
+/// as a view into the pool, without copying anything.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_OPDETSIM_COMPACTWAVEFORM_COMPACTOPDETWAVEFORMS_H
+#define SBNDCODE_OPDETSIM_COMPACTWAVEFORM_COMPACTOPDETWAVEFORMS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+namespace sbnd {
+
+  class CompactOpDetWaveforms {
+  public:
+
+    /// One segment, pointing into the pool of the product.
+    struct SegmentView {
+      raw::Channel_t   channel;
+      raw::TimeStamp_t timeStamp;
+      short const*     packed;  ///< first sample, then the differences
+      std::size_t      size;
+    };
+
+    /// Number of segments.
+    std::size_t size() const { return fChannels.size(); }
+    bool empty() const { return fChannels.empty(); }
+
+    /// Total number of samples of all the segments.
+    std::size_t NSamples() const { return fPool.size(); }
+
+    raw::Channel_t   Channel(std::size_t i) const { return fChannels[i]; }
+    raw::TimeStamp_t TimeStamp(std::size_t i) const { return fTimeStamps[i]; }
+    std::size_t      NSamples(std::size_t i) const { return End(i) - fOffsets[i]; }
+
+    SegmentView Segment(std::size_t i) const
+      { return { fChannels[i], fTimeStamps[i], fPool.data() + fOffsets[i], NSamples(i) }; }
+
+    /// Makes room for nSegments segments with nSamples samples in all.
+    void reserve(std::size_t nSegments, std::size_t nSamples)
+    {
+      fChannels.reserve(nSegments);
+      fTimeStamps.reserve(nSegments);
+      fOffsets.reserve(nSegments);
+      fPool.reserve(nSamples);
+    }
+
+    /// Appends a segment of n samples.
+    void Add(raw::Channel_t channel, raw::TimeStamp_t timeStamp, short const* samples, std::size_t n)
+    {
+      fChannels.push_back(channel);
+      fTimeStamps.push_back(timeStamp);
+      fOffsets.push_back(fPool.size());
+      std::uint16_t previous = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        std::uint16_t const sample = samples[i];
+        fPool.push_back(static_cast<short>(std::uint16_t(sample - previous)));
+        previous = sample;
+      }
+    }
+
+    void Add(raw::OpDetWaveform const& waveform)
+      { Add(waveform.ChannelNumber(), waveform.TimeStamp(), waveform.data(), waveform.size()); }
+
+    /// Writes the samples of segment i into out, which is resized to fit.
+    void DecodeSamples(std::size_t i, std::vector<short>& out) const
+    {
+      SegmentView const segment = Segment(i);
+      out.resize(segment.size);
+      std::uint16_t sample = 0;
+      for (std::size_t j = 0; j < segment.size; ++j) {
+        sample += static_cast<std::uint16_t>(segment.packed[j]);
+        out[j] = static_cast<short>(sample);
+      }
+    }
+
+    /// Sets waveform to segment i, reusing its capacity.
+    void Decode(std::size_t i, raw::OpDetWaveform& waveform) const
+    {
+      waveform.SetChannelNumber(fChannels[i]);
+      waveform.SetTimeStamp(fTimeStamps[i]);
+      DecodeSamples(i, waveform);
+    }
+
+    /// Segment i as a new waveform.
+    raw::OpDetWaveform MakeWaveform(std::size_t i) const
+    {
+      raw::OpDetWaveform waveform(fTimeStamps[i], fChannels[i], NSamples(i));
+      Decode(i, waveform);
+      return waveform;
+    }
+
+    void clear()
+    {
+      fChannels.clear();
+      fTimeStamps.clear();
+      fOffsets.clear();
+      fPool.clear();
+    }
+
+  private:
+
+    std::size_t End(std::size_t i) const
+      { return i + 1 < fOffsets.size() ? fOffsets[i + 1] : fPool.size(); }
+
+    std::vector<raw::Channel_t>   fChannels;   ///< channel of each segment
+    std::vector<raw::TimeStamp_t> fTimeStamps; ///< time stamp of each segment
+    std::vector<std::uint64_t>    fOffsets;    ///< start of each segment in the pool
+    std::vector<short>            fPool;       ///< packed samples, segment after segment
+  };
+
+} // namespace sbnd
+
+#endif // SBNDCODE_OPDETSIM_COMPACTWAVEFORM_COMPACTOPDETWAVEFORMS_H
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       OpDetWaveformPacker
+// Plugin Type: producer
+// File:        OpDetWaveformPacker_module.cc
+//
+// Packs collections of raw::OpDetWaveform into one
+// sbnd::CompactOpDetWaveforms, to be stored in place of them.
+// OpDetWaveformUnpacker turns it back into the original collection.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <memory>
+#include <vector>
+
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+#include "sbndcode/OpDetSim/CompactWaveform/CompactOpDetWaveforms.h"
+
+namespace opdet {
+  class OpDetWaveformPacker;
+}
+
+
+class opdet::OpDetWaveformPacker : public art::EDProducer {
+public:
+  explicit OpDetWaveformPacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  OpDetWaveformPacker(OpDetWaveformPacker const&) = delete;
+  OpDetWaveformPacker(OpDetWaveformPacker&&) = delete;
+  OpDetWaveformPacker& operator=(OpDetWaveformPacker const&) = delete;
+  OpDetWaveformPacker& operator=(OpDetWaveformPacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  std::vector<art::InputTag> fInputTags; ///< waveforms to pack, in this order
+};
+
+
+opdet::OpDetWaveformPacker::OpDetWaveformPacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTags = p.get< std::vector<art::InputTag> >("InputTags");
+  for (art::InputTag const& tag : fInputTags)
+    consumes< std::vector< raw::OpDetWaveform > >(tag);
+
+  produces< sbnd::CompactOpDetWaveforms >();
+}
+
+void opdet::OpDetWaveformPacker::produce(art::Event& e)
+{
+  std::vector< std::vector< raw::OpDetWaveform > const* > inputs;
+  std::size_t nSegments = 0, nSamples = 0;
+  for (art::InputTag const& tag : fInputTags) {
+    auto const& waveforms = e.getProduct< std::vector< raw::OpDetWaveform > >(tag);
+    inputs.push_back(&waveforms);
+    nSegments += waveforms.size();
+    for (raw::OpDetWaveform const& wf : waveforms) nSamples += wf.size();
+  }
+
+  auto compact = std::make_unique< sbnd::CompactOpDetWaveforms >();
+  compact->reserve(nSegments, nSamples);
+  for (auto const* waveforms : inputs)
+    for (raw::OpDetWaveform const& wf : *waveforms) compact->Add(wf);
+
+  e.put(std::move(compact));
+}
+
+DEFINE_ART_MODULE(opdet::OpDetWaveformPacker)
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       OpDetWaveformUnpacker
+// Plugin Type: producer
+// File:        OpDetWaveformUnpacker_module.cc
+//
+// Turns a sbnd::CompactOpDetWaveforms back into a collection of
+// raw::OpDetWaveform, for the modules that only read the latter.
+// The waveforms are the same, and in the same order, as those packed.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <memory>
+#include <vector>
+
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+#include "sbndcode/OpDetSim/CompactWaveform/CompactOpDetWaveforms.h"
+
+namespace opdet {
+  class OpDetWaveformUnpacker;
+}
+
+
+class opdet::OpDetWaveformUnpacker : public art::EDProducer {
+public:
+  explicit OpDetWaveformUnpacker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  OpDetWaveformUnpacker(OpDetWaveformUnpacker const&) = delete;
+  OpDetWaveformUnpacker(OpDetWaveformUnpacker&&) = delete;
+  OpDetWaveformUnpacker& operator=(OpDetWaveformUnpacker const&) = delete;
+  OpDetWaveformUnpacker& operator=(OpDetWaveformUnpacker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  art::InputTag fInputTag; ///< packed waveforms
+};
+
+
+opdet::OpDetWaveformUnpacker::OpDetWaveformUnpacker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fInputTag = p.get< art::InputTag >("InputTag");
+  consumes< sbnd::CompactOpDetWaveforms >(fInputTag);
+
+  produces< std::vector< raw::OpDetWaveform > >();
+}
+
+void opdet::OpDetWaveformUnpacker::produce(art::Event& e)
+{
+  auto const& compact = e.getProduct< sbnd::CompactOpDetWaveforms >(fInputTag);
+
+  auto waveforms = std::make_unique< std::vector< raw::OpDetWaveform > >();
+  waveforms->reserve(compact.size());
+  for (std::size_t i = 0; i < compact.size(); ++i)
+    waveforms->push_back(compact.MakeWaveform(i));
+
+  e.put(std::move(waveforms));
+}
+
+DEFINE_ART_MODULE(opdet::OpDetWaveformUnpacker)
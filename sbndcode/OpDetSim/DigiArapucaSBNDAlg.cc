@@ -20,6 +20,7 @@ namespace opdet {
     , fPoissonQGen(*fEngine)
     , fGaussQGen(*fEngine)
     , fExponentialGen(*fEngine)
+    , fNoiseGen(*fEngine)
   {
 
     if(fXArapucaVUVEffVUV > 1.0001 || fXArapucaVUVEffVis > 1.0001 || fXArapucaVISEff > 1.0001)
@@ -66,10 +67,12 @@ namespace opdet {
       fWaveformSP = *SinglePEVec_40ftCable_Apsaia;
       fWaveformSP_Daphne = *SinglePEVec_40ftCable_Daphne;
 
-      // Prepare HD waveforms
+      // Prepare HD waveforms, unless the maker already did
       fPMTHDOpticalWaveformsPtr = art::make_tool<opdet::HDOpticalWaveform>(fParams.HDOpticalWaveformParams);
-      fPMTHDOpticalWaveformsPtr->produceSER_HD(fWaveformSP_Daphne_HD,fWaveformSP_Daphne);
-      mf::LogDebug("DigiArapucaSBNDAlg")<<"HD wvfs size: "<<fWaveformSP_Daphne_HD[0].size();
+      fWaveformSP_Daphne_HD = fParams.WaveformSP_Daphne_HD;
+      if(!fWaveformSP_Daphne_HD)
+        fWaveformSP_Daphne_HD = std::make_shared<opdet::HDTemplateTable const>(*fPMTHDOpticalWaveformsPtr, fWaveformSP_Daphne);
+      mf::LogDebug("DigiArapucaSBNDAlg")<<"HD wvfs size: "<<fWaveformSP_Daphne_HD->PulseSize();
     }
     else{
       mf::LogDebug("DigiArapucaSBNDAlg") << " using ideal pe response";
@@ -77,115 +80,123 @@ namespace opdet {
       Pulse1PE(fWaveformSP_Daphne,fSampling_Daphne);
     }
     file->Close();
+
+    // sampling and single pe pulse of each electronics, picked once per
+    // channel instead of for each photon
+    fApsaia.sampling = fSampling;
+    fApsaia.pulse = &fWaveformSP;
+    fDaphne.sampling = fSampling_Daphne;
+    fDaphne.pulse = &fWaveformSP_Daphne;
+    if(fWaveformSP_Daphne_HD && fPMTHDOpticalWaveformsPtr) fDaphne.hdTemplates = fWaveformSP_Daphne_HD.get();
   } // end constructor
 
   DigiArapucaSBNDAlg::~DigiArapucaSBNDAlg() {}
 
 
+  double DigiArapucaSBNDAlg::DetectionEfficiency(std::string const& pdtype, bool reflected) const
+  {
+    if(pdtype == "xarapuca_vuv") return reflected ? fXArapucaVUVEffVis : fXArapucaVUVEffVUV;
+    if(pdtype == "xarapuca_vis") return reflected ? fXArapucaVISEff : 0.;
+    return 0.;
+  }
+
+
+  double DigiArapucaSBNDAlg::SinglePEHeight(bool is_daphne) const
+  {
+    std::vector<double> const& pulse = is_daphne ? fWaveformSP_Daphne : fWaveformSP;
+    if(pulse.empty()) return 0.;
+    auto const extremes = std::minmax_element(pulse.begin(), pulse.end());
+    return std::abs(*extremes.second) > std::abs(*extremes.first) ? *extremes.second : *extremes.first;
+  }
+
+
   void DigiArapucaSBNDAlg::ConstructWaveform(
     int ch,
-    sim::SimPhotons const& simphotons,
+    opdet::SimPhotonSpan simphotons,
     std::vector<short unsigned int>& waveform,
     std::string pdtype,
     bool is_daphne,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
-    CreatePDWaveform(simphotons, start_time, waves, pdtype,is_daphne);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_samples, fParams.Baseline);
+    CreatePDWaveform(simphotons, start_time, fWave, pdtype, ElectronicsFor(is_daphne));
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiArapucaSBNDAlg::ConstructWaveformVUVXA(
     int ch,
     std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+    opdet::SimPhotonSpan DirectPhotons,
+    opdet::SimPhotonSpan ReflectedPhotons,
     double start_time,
     unsigned n_samples)
   {
-    sim::SimPhotons auxphotons;
-    bool is_daphne = true; // for now ~rodrigoa
+    Electronics_t const& elec = fDaphne; // for now ~rodrigoa
     int nCT = 1;
-    std::vector<double> wave(n_samples, fParams.Baseline);
+    std::vector<float>& wave = fWave;
+    wave.assign(n_samples, fParams.Baseline);
+    ClearSPEs(wave.size());
         //direct light
-    if(auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) //auxphotons is direct light
+    for(size_t j = 0; j < DirectPhotons.size(); j++)
     {
       if(fFlatGen.fire(1.0) < fXArapucaVUVEffVUV) {
-          double tphoton = (fTimeXArapucaVUV->fire()) + auxphotons[j].Time - start_time;
+          double tphoton = (fTimeXArapucaVUV->fire()) + DirectPhotons[j].Time - start_time;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
         }
     }
         //Reflected light
-    if(auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) //auxphotons is direct light
+    for(size_t j = 0; j < ReflectedPhotons.size(); j++)
     {
       if(fFlatGen.fire(1.0) < fXArapucaVUVEffVis){
-          double tphoton = auxphotons[j].Time + fTimeTPB->fire() - start_time;
+          double tphoton = ReflectedPhotons[j].Time + fTimeTPB->fire() - start_time;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
         }
     }
+    FlushSPEs(wave);
 
-    if (!is_daphne) AddDarkNoise(wave,fWaveformSP);
-    else            AddDarkNoise(wave,fWaveformSP_Daphne_HD[0]);
+    AddDarkNoise(elec, wave);
     CreateSaturation(wave);
 
-    waveform = std::vector<short unsigned int> (wave.begin(), wave.end());
+    waveform.assign(wave.begin(), wave.end());
   }
 
 
   void DigiArapucaSBNDAlg::ConstructWaveformLite(
     int ch,
-    sim::SimPhotonsLite const& litesimphotons,
+    opdet::PhotonLiteSpan litesimphotons,
     std::vector<short unsigned int>& waveform,
     std::string pdtype,
     bool is_daphne,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
-    std::map<int, int> const& photonMap = litesimphotons.DetectedPhotons;
-    CreatePDWaveformLite(photonMap, start_time, waves, pdtype,is_daphne);
+    fWave.assign(n_samples, fParams.Baseline);
+    CreatePDWaveformLite(litesimphotons, start_time, fWave, pdtype, ElectronicsFor(is_daphne));
     // std::ofstream ofs("True_PE.log",std::ofstream::out | std::ofstream::app);
     // ofs<<ch<<"\t"<<P_truth<<std::endl;
     // ofs.close();
     // P_truth=0;
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveform(
-    sim::SimPhotons const& simphotons,
+    opdet::SimPhotonSpan simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype,
-    bool is_daphne)
+    Electronics_t const& elec)
   {
     int nCT = 1;
+    ClearSPEs(wave.size());
     if(pdtype == "xarapuca_vuv") {
       for(size_t i = 0; i < simphotons.size(); i++) {
         if(fFlatGen.fire(1.0) < fXArapucaVUVEffVUV) {
@@ -193,14 +204,7 @@ namespace opdet {
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
         }
       }
     }
@@ -211,54 +215,47 @@ namespace opdet {
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);
-            }
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
         }
       }
     }
     else{
       throw cet::exception("DigiARAPUCASBNDAlg") << "Wrong pdtype: " << pdtype << std::endl;
     }
+    FlushSPEs(wave);
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0)
     {
-      if (!is_daphne) AddDarkNoise(wave,fWaveformSP);
-      else            AddDarkNoise(wave,fWaveformSP_Daphne_HD[0]);
+      AddDarkNoise(elec, wave);
     } 
     CreateSaturation(wave);
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveformLite(
-    std::map<int, int> const& photonMap,
+    opdet::PhotonLiteSpan photonMap,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype,
-    bool is_daphne)
+    Electronics_t const& elec)
   {
+    ClearSPEs(wave.size());
     if(pdtype == "xarapuca_vuv"){
-      SinglePDWaveformCreatorLite(fXArapucaVUVEffVUV, fTimeXArapucaVUV, wave, photonMap, t_min,is_daphne);
+      SinglePDWaveformCreatorLite(fXArapucaVUVEffVUV, fTimeXArapucaVUV, wave, photonMap, t_min, elec);
     }
     else if(pdtype == "xarapuca_vis"){
       // creating the waveforms for xarapuca_vis is different than the rest
       // so there's an overload for that which lacks the timeHisto
-      SinglePDWaveformCreatorLite(fXArapucaVISEff, wave, photonMap, t_min,is_daphne);
+      SinglePDWaveformCreatorLite(fXArapucaVISEff, wave, photonMap, t_min, elec);
     }
     else{
       throw cet::exception("DigiARAPUCASBNDAlg") << "Wrong pdtype: " << pdtype << std::endl;
     }
+    FlushSPEs(wave);
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0)
     {
-      if (!is_daphne) AddDarkNoise(wave,fWaveformSP);
-      else            AddDarkNoise(wave,fWaveformSP_Daphne_HD[0]);
+      AddDarkNoise(elec, wave);
     } 
 
     CreateSaturation(wave);
@@ -267,84 +264,66 @@ namespace opdet {
   void DigiArapucaSBNDAlg::ConstructWaveformLiteVUVXA(
     int ch,
     std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+    opdet::PhotonLiteSpan DirectPhotons,
+    opdet::PhotonLiteSpan ReflectedPhotons,
     double start_time,
     unsigned n_samples
     )
   {
-    std::vector<double> wave(n_samples, fParams.Baseline);
+    std::vector<float>& wave = fWave;
+    wave.assign(n_samples, fParams.Baseline);
     double meanPhotons;
     size_t acceptedPhotons;
     double tphoton;
-    bool is_daphne = true; //quick fix
+    Electronics_t const& elec = fDaphne; //quick fix
+    ClearSPEs(wave.size());
 
     // direct light
-    if ( auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) ){
-      for (auto& directPhotons : (it->second).DetectedPhotons) {
-        // (1-accepted_photons) doesn't introduce some bias
-        meanPhotons = directPhotons.second*fXArapucaVUVEffVUV;
-        acceptedPhotons = fPoissonQGen.fire(meanPhotons);
-        for(size_t i = 0; i < acceptedPhotons; i++) {
-          tphoton = fTimeXArapucaVUV->fire();
-          tphoton += directPhotons.first - start_time;
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          int nCT=1;
-          if(fParams.CrossTalk > 0.0 &&
-              fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
-            size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-            double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-            size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-            if(timeBin < wave.size()) {
-              // P_truth=P_truth+nCT;
-              if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-              }
-              else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-            }
-          }
+    for (auto& directPhotons : DirectPhotons) {
+      // (1-accepted_photons) doesn't introduce some bias
+      meanPhotons = directPhotons.second*fXArapucaVUVEffVUV;
+      acceptedPhotons = fPoissonQGen.fire(meanPhotons);
+      for(size_t i = 0; i < acceptedPhotons; i++) {
+        tphoton = fTimeXArapucaVUV->fire();
+        tphoton += directPhotons.first - start_time;
+        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
+        int nCT=1;
+        if(fParams.CrossTalk > 0.0 &&
+            fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
+          AddPhoton(elec, tphoton, wave, nCT);
         }
-    }
+      }
 
     // reflected light
-    if ( auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) ){
-      for (auto& reflectedPhotons : (it->second).DetectedPhotons) {
-        meanPhotons = reflectedPhotons.second*fXArapucaVUVEffVis;
-        acceptedPhotons = fPoissonQGen.fire(meanPhotons);
-        for(size_t i = 0; i < acceptedPhotons; i++) {
-          tphoton = fExponentialGen.fire(fParams.DecayTXArapucaVIS);
-          tphoton += reflectedPhotons.first - start_time + fTimeTPB->fire();
-          if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-          int nCT=1;
-          if(fParams.CrossTalk > 0.0 &&
-              fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
-            size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-            double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-            size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-            if(timeBin < wave.size()) {
-              // P_truth=P_truth+nCT;
-              if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-              }
-              else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-            }
-          }
-      }
+    for (auto& reflectedPhotons : ReflectedPhotons) {
+      meanPhotons = reflectedPhotons.second*fXArapucaVUVEffVis;
+      acceptedPhotons = fPoissonQGen.fire(meanPhotons);
+      for(size_t i = 0; i < acceptedPhotons; i++) {
+        tphoton = fExponentialGen.fire(fParams.DecayTXArapucaVIS);
+        tphoton += reflectedPhotons.first - start_time + fTimeTPB->fire();
+        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
+        int nCT=1;
+        if(fParams.CrossTalk > 0.0 &&
+            fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
+          AddPhoton(elec, tphoton, wave, nCT);
+        }
     }
-    
+    FlushSPEs(wave);
 
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
-    if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(wave,fWaveformSP_Daphne_HD[0]);
+    if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(elec, wave);
     CreateSaturation(wave);
-    waveform = std::vector<short unsigned int> (wave.begin(), wave.end());
+    waveform.assign(wave.begin(), wave.end());
 
   }
 
   void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
     double effT,
     std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-    std::vector<double>& wave,
-    std::map<int, int> const& photonMap,
+    std::vector<float>& wave,
+    opdet::PhotonLiteSpan photonMap,
     double const& t_min,
-    bool is_daphne
+    Electronics_t const& elec
     )
   {
     // TODO: check that this new approach of not using the last
@@ -364,15 +343,7 @@ namespace opdet {
         int nCT=1;
         if(fParams.CrossTalk > 0.0 &&
            fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            // P_truth=P_truth+nCT;
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
       }
     }
   }
@@ -380,10 +351,10 @@ namespace opdet {
 
   void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
     double effT,
-    std::vector<double>& wave,
-    std::map<int, int> const& photonMap,
+    std::vector<float>& wave,
+    opdet::PhotonLiteSpan photonMap,
     double const& t_min,
-    bool is_daphne
+    Electronics_t const& elec
     )
   {
     double meanPhotons;
@@ -401,19 +372,25 @@ namespace opdet {
         if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
         if(fParams.CrossTalk > 0.0 && fFlatGen.fire(1.0) < fParams.CrossTalk) nCT = 2;
         else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          double timeBin_HD = (is_daphne) ? ( tphoton * fSampling_Daphne) : (tphoton * fSampling);//get decimals info
-          size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD);
-          if(timeBin < wave.size()) {
-            // P_truth=P_truth+nCT;
-            if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-            }
-            else{ AddSPE(timeBin, wave, (std::vector<double>) (fWaveformSP_Daphne_HD[wvf_shift]), nCT);}
-          }
+          AddPhoton(elec, tphoton, wave, nCT);
       }
     }
   }
 
+  void DigiArapucaSBNDAlg::AddPhoton(
+    Electronics_t const& elec,
+    double tphoton,
+    std::vector<float>& wave,
+    int nCT)
+  {
+    double const timeBin_HD = tphoton * elec.sampling; //get decimals info
+    size_t const timeBin = std::floor(timeBin_HD);
+    if(timeBin >= wave.size()) return;
+    if(elec.hdTemplates) AddHDSPE(timeBin, wave, fPMTHDOpticalWaveformsPtr->TimeBinShift(timeBin_HD), nCT);
+    else                 AddSPE(timeBin, wave, *elec.pulse, nCT);
+  }
+
+
   //Ideal single pulse waveform, same shape for both electronics (not realistic: different capacitances, ...) 
   void DigiArapucaSBNDAlg::Pulse1PE(std::vector<double>& fWaveformSP, const double sampling)//TODO: use only one Pulse1PE functions for both electronics ~rodrigoa
   {
@@ -427,7 +404,7 @@ namespace opdet {
   
   void DigiArapucaSBNDAlg::AddSPE(
     const size_t time_bin,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     const std::vector<double>& fWaveformSP,
     const int nphotons) //adding single pulse //TODO: use only one function, use pulsize and fWaveformSP as arguments instead ~rodrigoa
   {
@@ -445,7 +422,130 @@ namespace opdet {
                      return w + ws*nphotons_aux  ; });
   }
 
-  void DigiArapucaSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiArapucaSBNDAlg::AddSPE(
+    const size_t time_bin,
+    std::vector<float>& wave,
+    opdet::HDTemplateTable::Span_t WaveformSP,
+    const int nphotons)
+  {
+    size_t max = time_bin + WaveformSP.size() < wave.size() ? time_bin + WaveformSP.size() : wave.size();
+
+    double nphotons_aux= nphotons;
+    if(fParams.MakeAmpFluctuations) nphotons_aux = fGaussQGen.fire(nphotons, std::sqrt(nphotons) * fParams.AmpFluctuation);
+
+    if(time_bin >= max) return;
+    float const* pulse = WaveformSP.data();
+    float* w = wave.data() + time_bin;
+    float const a = nphotons_aux;
+    for(size_t i = 0, n = max - time_bin; i < n; ++i) w[i] += a*pulse[i];
+  }
+
+  void DigiArapucaSBNDAlg::AddHDSPE(
+    const size_t time_bin,
+    std::vector<float>& wave,
+    const size_t shift,
+    const int nphotons)
+  {
+    if(!BinnedSPEs()) {
+      AddSPE(time_bin, wave, fWaveformSP_Daphne_HD->Template(shift), nphotons);
+      return;
+    }
+
+    // same random numbers as AddSPE, drawn pulse by pulse
+    double nphotons_aux= nphotons;
+    if(fParams.MakeAmpFluctuations) nphotons_aux = fGaussQGen.fire(nphotons, std::sqrt(nphotons) * fParams.AmpFluctuation);
+
+    size_t const nSamples = fPhaseAmplitudes.size()/fWaveformSP_Daphne_HD->NShifts();
+    if(time_bin >= nSamples) return;
+    fPhaseAmplitudes[shift*nSamples + time_bin] += nphotons_aux;
+    ++fNStagedSPEs;
+  }
+
+
+  void DigiArapucaSBNDAlg::ClearSPEs(size_t nSamples)
+  {
+    fNStagedSPEs = 0;
+    if(!BinnedSPEs()) return;
+    fPhaseAmplitudes.assign(fWaveformSP_Daphne_HD->NShifts()*nSamples, 0.);
+  }
+
+
+  void DigiArapucaSBNDAlg::FlushSPEs(std::vector<float>& wave)
+  {
+    if(fNStagedSPEs == 0) return;
+    size_t const nSamples = wave.size();
+    size_t const nPhases = fWaveformSP_Daphne_HD->NShifts();
+    size_t const pulseSize = fWaveformSP_Daphne_HD->PulseSize();
+
+    // direct sum over the pulses, or one FFT per phase plus one inverse FFT,
+    // whichever takes fewer operations
+    size_t const fftSize = SPEFFTSize(nSamples);
+    double const directCost = double(fNStagedSPEs)*pulseSize;
+    double const fftCost = (nPhases + 1)*fftSize*std::log2(double(fftSize));
+    if(directCost <= fftCost) {
+      for(size_t shift = 0; shift < nPhases; ++shift) {
+        float const* pulse = fWaveformSP_Daphne_HD->Template(shift).data();
+        double const* amplitudes = fPhaseAmplitudes.data() + shift*nSamples;
+        for(size_t time_bin = 0; time_bin < nSamples; ++time_bin) {
+          if(amplitudes[time_bin] == 0.) continue;
+          float const a = amplitudes[time_bin];
+          size_t const n = std::min(pulseSize, nSamples - time_bin);
+          float* w = wave.data() + time_bin;
+          for(size_t i = 0; i < n; ++i) w[i] += a*pulse[i];
+        }
+      }
+    }
+    else {
+      ConvolveSPEs(wave);
+    }
+    fNStagedSPEs = 0;
+  }
+
+
+  size_t DigiArapucaSBNDAlg::SPEFFTSize(size_t nSamples) const
+  {
+    // long enough for the pulses of the last samples not to wrap around
+    size_t fftSize = 1;
+    while(fftSize < nSamples + fWaveformSP_Daphne_HD->PulseSize()) fftSize *= 2;
+    return fftSize;
+  }
+
+
+  void DigiArapucaSBNDAlg::ConvolveSPEs(std::vector<float>& wave)
+  {
+    size_t const nSamples = wave.size();
+    size_t const nPhases = fWaveformSP_Daphne_HD->NShifts();
+    size_t const fftSize = SPEFFTSize(nSamples);
+
+    // spectra of the HD pulses, made once for each FFT size
+    if(!fSPEFFT || (size_t) fSPEFFT->FFTSize() != fftSize) {
+      fSPEFFT = std::make_unique<util::SBNDFFTWorker>(fftSize);
+      fSPESpectra.resize(nPhases);
+      std::vector<double> pulse(fftSize);
+      for(size_t shift = 0; shift < nPhases; ++shift) {
+        auto const ser = fWaveformSP_Daphne_HD->Template(shift);
+        std::fill(pulse.begin(), pulse.end(), 0.);
+        std::copy(ser.begin(), ser.end(), pulse.begin());
+        fSPEFFT->DoFFT(pulse, fSPESpectra[shift]);
+      }
+    }
+
+    std::vector<double> buffer(fftSize, 0.);
+    std::vector<TComplex> spectrum, sum(fSPEFFT->FreqSize(), TComplex(0., 0.));
+    for(size_t shift = 0; shift < nPhases; ++shift) {
+      double const* amplitudes = fPhaseAmplitudes.data() + shift*nSamples;
+      if(std::all_of(amplitudes, amplitudes + nSamples, [](double a){ return a == 0.; })) continue;
+      std::copy_n(amplitudes, nSamples, buffer.begin());
+      fSPEFFT->DoFFT(buffer, spectrum);
+      for(size_t i = 0; i < sum.size(); ++i) sum[i] += spectrum[i]*fSPESpectra[shift][i];
+    }
+    fSPEFFT->DoInvFFT(sum, buffer);
+
+    for(size_t i = 0; i < nSamples; ++i) wave[i] += buffer[i];
+  }
+
+
+  void DigiArapucaSBNDAlg::CreateSaturation(std::vector<float>& wave)
   {
     std::replace_if(wave.begin(), wave.end(),
                     [&](auto w){return w > fADCSaturationHigh;}, fADCSaturationHigh);
@@ -455,28 +555,21 @@ namespace opdet {
   }
 
 
-  void DigiArapucaSBNDAlg::AddLineNoise(std::vector< double >& wave)
+  void DigiArapucaSBNDAlg::AddLineNoise(std::vector<float>& wave)
+  {
+    fNoiseGen.AddNoise(wave, fParams.BaselineRMS);
+  }
+
+
+  void DigiArapucaSBNDAlg::AddDarkNoise(Electronics_t const& elec, std::vector<float>& wave)
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.BaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + fGaussQGen.fire(0., fParams.BaselineRMS) ; });
+    if(elec.hdTemplates) AddDarkNoise(wave, elec.hdTemplates->Template(0));
+    else                 AddDarkNoise(wave, *elec.pulse);
   }
 
 
-  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<double>& wave,std::vector<double>& WaveformSP)
+  template <class Pulse>
+  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<float>& wave, Pulse const& WaveformSP)
   {
     int nCT;
     // Multiply by 10^9 since fDarkNoiseRate is in Hz (conversion from s to ns)
@@ -536,10 +629,24 @@ namespace opdet {
     fBaseConfig.DecayTXArapucaVIS     = config.decayTXArapucaVIS();
     fBaseConfig.ArapucaDataFile       = config.arapucaDataFile();
     fBaseConfig.ArapucaSinglePEmodel  = config.ArapucasinglePEmodel();
+    fBaseConfig.ArapucaBinnedSPE      = config.arapucaBinnedSPE();
     fBaseConfig.frequency_Daphne      = config.DaphneFrequency();
     fBaseConfig.MakeAmpFluctuations   = config.makeAmpFluctuations();
     fBaseConfig.AmpFluctuation        = config.ampFluctuation();
     config.hdOpticalWaveformParams.get_if_present(fBaseConfig.HDOpticalWaveformParams);
+
+    // the HD single pe templates are made here once, and shared by all the digitizers
+    if(fBaseConfig.ArapucaSinglePEmodel) {
+      std::string fname;
+      cet::search_path sp("FW_SEARCH_PATH");
+      sp.find_file(fBaseConfig.ArapucaDataFile, fname);
+      TFile* file = TFile::Open(fname.c_str(), "READ");
+      std::vector<double>* SinglePEVec_40ftCable_Daphne;
+      file->GetObject("SinglePEVec_40ftCable_Daphne_HD", SinglePEVec_40ftCable_Daphne);
+      auto HDOpticalWaveformsPtr = art::make_tool<opdet::HDOpticalWaveform>(fBaseConfig.HDOpticalWaveformParams);
+      fBaseConfig.WaveformSP_Daphne_HD = std::make_shared<opdet::HDTemplateTable const>(*HDOpticalWaveformsPtr, *SinglePEVec_40ftCable_Daphne);
+      file->Close();
+    }
   }
 
   std::unique_ptr<DigiArapucaSBNDAlg> DigiArapucaSBNDAlgMaker::operator()(
@@ -39,6 +39,10 @@
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
 
 #include "sbndcode/OpDetSim/HDWvf/HDOpticalWaveforms.hh"
+#include "sbndcode/OpDetSim/HDWvf/HDTemplateTable.hh"
+#include "sbndcode/OpDetSim/GaussianNoiseGenerator.hh"
+#include "sbndcode/OpDetSim/PhotonTable.hh"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
 
 #include "TFile.h"
 
@@ -67,6 +71,7 @@ namespace opdet {
       double DecayTXArapucaVIS;// Decay time of EJ280 in ns
       std::string ArapucaDataFile; //File containing timing structure for arapucas
       bool ArapucaSinglePEmodel; //Model for single pe response, false for ideal, true for test bench meas
+      bool ArapucaBinnedSPE; //Add the HD single pe pulses of a channel all at once
       bool MakeAmpFluctuations;  //Add amplitude fluctuations to the simulation
       double AmpFluctuation; //Model for single pe response, false for ideal, true for test bench meas
 
@@ -76,6 +81,7 @@ namespace opdet {
 
       CLHEP::HepRandomEngine* engine = nullptr;
       fhicl::ParameterSet HDOpticalWaveformParams;
+      std::shared_ptr<opdet::HDTemplateTable const> WaveformSP_Daphne_HD; //HD single pe templates, shared by all the digitizers
     };// ConfigurationParameters_t
 
     //Default constructor
@@ -88,8 +94,12 @@ namespace opdet {
         return fParams.Baseline;
       }
 
+    // mean response, for a quick estimate of the waveform from the photons alone
+    double DetectionEfficiency(std::string const& pdtype, bool reflected) const; // fraction of the photons giving a pe
+    double SinglePEHeight(bool is_daphne) const; // peak of the single pe pulse from the baseline (ADC)
+
     void ConstructWaveform(int ch,
-                           sim::SimPhotons const& simphotons,
+                           opdet::SimPhotonSpan simphotons,
                            std::vector<short unsigned int>& waveform,
                            std::string pdtype,
                            bool is_daphne,
@@ -97,12 +107,12 @@ namespace opdet {
                            unsigned n_samples);
     void ConstructWaveformVUVXA(int ch,
                                     std::vector<short unsigned int>& waveform,
-                                    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-                                    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+                                    opdet::SimPhotonSpan DirectPhotons,
+                                    opdet::SimPhotonSpan ReflectedPhotons,
                                     double start_time,
                                     unsigned n_samples);
     void ConstructWaveformLite(int ch,
-                               sim::SimPhotonsLite const& litesimphotons,
+                               opdet::PhotonLiteSpan litesimphotons,
                                std::vector<short unsigned int>& waveform,
                                std::string pdtype,
                                bool is_daphne,
@@ -110,8 +120,8 @@ namespace opdet {
                                unsigned n_samples);
     void ConstructWaveformLiteVUVXA(int ch,
                                     std::vector<short unsigned int>& waveform,
-                                    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-                                    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+                                    opdet::PhotonLiteSpan DirectPhotons,
+                                    opdet::PhotonLiteSpan ReflectedPhotons,
                                     double start_time,
                                     unsigned n_samples);
 
@@ -133,48 +143,77 @@ namespace opdet {
     CLHEP::RandPoissonQ fPoissonQGen;
     CLHEP::RandGaussQ fGaussQGen;
     CLHEP::RandExponential fExponentialGen;
+    opdet::GaussianNoiseGenerator fNoiseGen;
     std::unique_ptr<CLHEP::RandGeneral> fTimeXArapucaVUV;// histogram for getting the photon time distribution inside the XArapuca VUV box (considering the optical window)
     std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for visible (x)arapucas
 
     std::vector<double> fWaveformSP; //single photon pulse vector
     std::vector<double> fWaveformSP_Daphne; //single photon pulse vector
-    std::vector<std::vector<double>> fWaveformSP_Daphne_HD; //single photon pulse vector
+    std::shared_ptr<opdet::HDTemplateTable const> fWaveformSP_Daphne_HD; //single photon pulses for each HD shift
+
+    // Sampling and single pe pulse of one readout electronics, set in the
+    // constructor; the waveform of a channel is made with one of them
+    struct Electronics_t {
+      double sampling = 0.;                                // GHz
+      std::vector<double> const* pulse = nullptr;          // single pe pulse at this sampling
+      opdet::HDTemplateTable const* hdTemplates = nullptr; // HD pulses used instead, if set
+    };
+    Electronics_t fApsaia;
+    Electronics_t fDaphne;
+    Electronics_t const& ElectronicsFor(bool is_daphne) const { return is_daphne ? fDaphne : fApsaia; }
+    void AddPhoton(Electronics_t const& elec, double tphoton, std::vector<float>& wave, int nCT); // add the pulse of a photon at time tphoton (ns)
     
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
+    std::vector<float> fWave; // working waveform in ADC counts, reused across channels and events
 
     //HDWaveforms
     std::unique_ptr<opdet::HDOpticalWaveform> fPMTHDOpticalWaveformsPtr;
 
-
-    void CreatePDWaveform(sim::SimPhotons const& SimPhotons,
+    // HD single pe pulses of the current channel, as amplitudes at each
+    // (HD shift, sample); added to the waveform all at once by FlushSPEs
+    std::vector<double> fPhaseAmplitudes;
+    size_t fNStagedSPEs = 0;
+    std::unique_ptr<util::SBNDFFTWorker> fSPEFFT;
+    std::vector<std::vector<TComplex>> fSPESpectra;
+    bool BinnedSPEs() const { return fParams.ArapucaBinnedSPE && fWaveformSP_Daphne_HD && fWaveformSP_Daphne_HD->NShifts() > 0; }
+    void ClearSPEs(size_t nSamples);
+    void AddHDSPE(size_t time_bin, std::vector<float>& wave, size_t shift, int nphotons); // add or queue a HD pulse
+    void FlushSPEs(std::vector<float>& wave); // add the queued pulses to wave
+    size_t SPEFFTSize(size_t nSamples) const;
+    void ConvolveSPEs(std::vector<float>& wave);
+
+
+    void CreatePDWaveform(opdet::SimPhotonSpan SimPhotons,
                           double t_min,
-                          std::vector<double>& wave,
+                          std::vector<float>& wave,
                           std::string pdtype,
-                          bool is_daphne);
-    void CreatePDWaveformLite(std::map<int, int> const& photonMap,
+                          Electronics_t const& elec);
+    void CreatePDWaveformLite(opdet::PhotonLiteSpan photonMap,
                               double t_min,
-                              std::vector<double>& wave,
+                              std::vector<float>& wave,
                               std::string pdtype,
-                              bool is_daphne);
+                              Electronics_t const& elec);
     void SinglePDWaveformCreatorLite(double effT,
                                      std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-                                     std::vector<double>& wave,
-                                     std::map<int, int> const& photonMap,
+                                     std::vector<float>& wave,
+                                     opdet::PhotonLiteSpan photonMap,
                                      double const& t_min,
-                                     bool is_daphne);
+                                     Electronics_t const& elec);
     void SinglePDWaveformCreatorLite(double effT,
-                                     std::vector<double>& wave,
-                                     std::map<int, int> const& photonMap,
+                                     std::vector<float>& wave,
+                                     opdet::PhotonLiteSpan photonMap,
                                      double const& t_min,
-                                     bool is_daphne);
-    void AddSPE(size_t time_bin, std::vector<double>& wave, const std::vector<double>& fWaveformSP, int nphotons); // add single pulse to auxiliary waveform
+                                     Electronics_t const& elec);
+    void AddSPE(size_t time_bin, std::vector<float>& wave, const std::vector<double>& fWaveformSP, int nphotons); // add single pulse to auxiliary waveform
+    void AddSPE(size_t time_bin, std::vector<float>& wave, opdet::HDTemplateTable::Span_t WaveformSP, int nphotons);
     void Pulse1PE(std::vector<double>& wave,const double sampling);
     // void produceSER_HD(std::vector<double> *SER_HD, std::vector<double>& SER);
-    void AddLineNoise(std::vector<double>& wave);
-    void AddDarkNoise(std::vector<double>& wave , std::vector<double>& WaveformSP);
+    void AddLineNoise(std::vector<float>& wave);
+    template <class Pulse> void AddDarkNoise(std::vector<float>& wave, Pulse const& WaveformSP);
+    void AddDarkNoise(Electronics_t const& elec, std::vector<float>& wave);
     double FindMinimumTime(sim::SimPhotons const& simphotons);
     double FindMinimumTimeLite(std::map< int, int > const& photonMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects
+    void CreateSaturation(std::vector<float>& wave);//Including saturation effects
   };//class DigiArapucaSBNDAlg
 
   class DigiArapucaSBNDAlgMaker {
@@ -269,6 +308,12 @@ namespace opdet {
         Comment("Model used for single PE response of PMT. =0 is ideal, =1 is from X-TDBoard data (with overshoot)")
       };
 
+      fhicl::Atom<bool> arapucaBinnedSPE {
+        Name("ArapucaBinnedSPE"),
+        Comment("Add the HD single pe pulses of a channel at once, by FFT convolution for busy channels"),
+        true
+      };
+
       fhicl::Atom<double> DaphneFrequency {
         Name("DaphneFrequency"),
         Comment("Sampling Frequency of the XArapucas with Daphne readouts (SBND Light detection system has 2 readout frequencies). Apsaia readouts read the frec value from LArSoft.")
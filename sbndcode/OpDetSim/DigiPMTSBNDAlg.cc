@@ -1,4 +1,5 @@
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
+#include "sbndcode/Utilities/StartupTimeline.h"
 
 //------------------------------------------------------------------------------
 //--- opdet::simpmtsbndAlg implementation
@@ -19,7 +20,9 @@ namespace opdet {
     , fPoissonQGen(*fEngine)
     , fGaussQGen(*fEngine)
     , fExponentialGen(*fEngine)
+    , fNoiseGen(*fEngine)
   {
+    sbnd::startup::Span span("DigiPMTSBNDAlg");
 
     mf::LogInfo("DigiPMTSBNDAlg") << "PMT corrected efficiencies = "
                                   << fPMTCoatedVUVEff << " " << fPMTCoatedVISEff << " " << fPMTUncoatedEff <<"\n";
@@ -56,11 +59,13 @@ namespace opdet {
       file->GetObject("SinglePEVec_HD", SinglePEVec_p);
       fSinglePEWave = *SinglePEVec_p;
 
-      // Prepare HD waveforms
+      // Prepare HD waveforms, unless the maker already did
       fPMTHDOpticalWaveformsPtr = art::make_tool<opdet::HDOpticalWaveform>(fParams.HDOpticalWaveformParams);
-      fPMTHDOpticalWaveformsPtr->produceSER_HD(fSinglePEWave_HD,fSinglePEWave);
+      fSinglePEWave_HD = fParams.SinglePEWave_HD;
+      if(!fSinglePEWave_HD)
+        fSinglePEWave_HD = std::make_shared<opdet::HDTemplateTable const>(*fPMTHDOpticalWaveformsPtr, fSinglePEWave);
 
-      pulsesize = fSinglePEWave_HD[0].size();
+      pulsesize = fSinglePEWave_HD->PulseSize();
       mf::LogDebug("DigiPMTSBNDAlg")<<"HD wvfs size: "<<pulsesize;
     }
     else {
@@ -85,6 +90,7 @@ namespace opdet {
     double minADC_SinglePE = *min_element(fSinglePEWave.begin(), fSinglePEWave.end());
     double maxADC_SinglePE = *max_element(fSinglePEWave.begin(), fSinglePEWave.end());
     fPositivePolarity = std::abs(maxADC_SinglePE) > std::abs(minADC_SinglePE); 
+    fSinglePEHeight = fPositivePolarity ? maxADC_SinglePE : minADC_SinglePE;
     
     // get ADC saturation value
     // currently assumes all dynamic range for PE (no overshoot)
@@ -98,66 +104,73 @@ namespace opdet {
   DigiPMTSBNDAlg::~DigiPMTSBNDAlg(){}
 
 
+  double DigiPMTSBNDAlg::DetectionEfficiency(std::string const& pdtype, bool reflected) const
+  {
+    if(pdtype == "pmt_uncoated") return reflected ? fPMTUncoatedEff : 0.;
+    return reflected ? fPMTCoatedVISEff : fPMTCoatedVUVEff;
+  }
+
+
   void DigiPMTSBNDAlg::ConstructWaveformUncoatedPMT(
     int ch,
-    sim::SimPhotons const& simphotons,
+    opdet::SimPhotonSpan simphotons,
     std::vector<short unsigned int>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformUncoatedPMT(simphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformUncoatedPMT(simphotons, start_time, fWave, ch, pdtype);
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformCoatedPMT(
     int ch,
     std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+    opdet::SimPhotonSpan DirectPhotons,
+    opdet::SimPhotonSpan ReflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformCoatedPMT(ch, start_time, fWave, DirectPhotons, ReflectedPhotons);
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLiteUncoatedPMT(
     int ch,
-    sim::SimPhotonsLite const& litesimphotons,
+    opdet::PhotonLiteSpan litesimphotons,
     std::vector<short unsigned int>& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLiteUncoatedPMT(litesimphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLiteUncoatedPMT(litesimphotons, start_time, fWave, ch, pdtype);
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLiteCoatedPMT(
     int ch,
     std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+    opdet::PhotonLiteSpan DirectPhotons,
+    opdet::PhotonLiteSpan ReflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLiteCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLiteCoatedPMT(ch, start_time, fWave, DirectPhotons, ReflectedPhotons);
+    waveform.assign(fWave.begin(), fWave.end());
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformUncoatedPMT(
-    sim::SimPhotons const& simphotons,
+    opdet::SimPhotonSpan simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
@@ -183,16 +196,7 @@ namespace opdet {
       }
     }
 
-    for(size_t t=0; t<nPE_v.size(); t++){
-      if(nPE_v[t] > 0) {
-        if(fParams.SimulateNonLinearity){
-          AddSPE(t, wave, fPMTNonLinearityPtr->NObservedPE(t, nPE_v) );
-        }
-        else{
-          AddSPE(t, wave, nPE_v[t]);
-        }
-      }
-    }
+    AddSPEs(nPE_v, wave);
 
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
@@ -203,15 +207,14 @@ namespace opdet {
   void DigiPMTSBNDAlg::CreatePDWaveformCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    opdet::SimPhotonSpan DirectPhotons,
+    opdet::SimPhotonSpan ReflectedPhotons)
   {
 
     double ttsTime = 0;
     double tphoton;
     double ttpb=0;
-    sim::SimPhotons auxphotons;
 
     // we want to keep the 1 ns SimPhotonLite resolution
     // digitizer sampling period is 2 ns
@@ -219,15 +222,13 @@ namespace opdet {
     std::vector<unsigned int> nPE_v( (size_t) fSamplingPeriod*wave.size(), 0);
 
     //direct light
-    if(auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is direct light
+    for(size_t j = 0; j < DirectPhotons.size(); j++) {
       if(fFlatGen.fire(1.0) < fPMTCoatedVUVEff) {
         if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
         ttpb = fTimeTPB->fire(); //for including TPB emission time
 
         //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
+        tphoton = ttsTime + DirectPhotons[j].Time - t_min + ttpb + fParams.CableTime;
 
         // store the pgoton time if it's within the readout window
         if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++; 
@@ -235,31 +236,20 @@ namespace opdet {
     }
 
     // reflected light
-    if(auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is now reflected light
+    for(size_t j = 0; j < ReflectedPhotons.size(); j++) {
       if(fFlatGen.fire(1.0) < fPMTCoatedVISEff) {
         if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
         ttpb = fTimeTPB->fire(); //for including TPB emission time
 
         //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
+        tphoton = ttsTime + ReflectedPhotons[j].Time - t_min + ttpb + fParams.CableTime;
         
         // store the pgoton time if it's within the readout window
         if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++;
       }
     }
 
-    for(size_t t=0; t<nPE_v.size(); t++){
-      if(nPE_v[t] > 0) {
-        if(fParams.SimulateNonLinearity){
-          AddSPE(t, wave, fPMTNonLinearityPtr->NObservedPE(t, nPE_v) );
-        }
-        else{
-          AddSPE(t, wave, nPE_v[t]);
-        }
-      }
-    }
+    AddSPEs(nPE_v, wave);
 
     //Adding noise and saturation
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
@@ -269,9 +259,9 @@ namespace opdet {
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformLiteUncoatedPMT(
-    sim::SimPhotonsLite const& litesimphotons,
+    opdet::PhotonLiteSpan litesimphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
@@ -287,8 +277,7 @@ namespace opdet {
     std::vector<unsigned int> nPE_v( (size_t) fSamplingPeriod*wave.size(), 0);
 
     // here litesimphotons corresponds only to reflected light
-    std::map<int, int> const& photonMap = litesimphotons.DetectedPhotons;
-    for (auto const& reflectedPhotons : photonMap) {
+    for (auto const& reflectedPhotons : litesimphotons) {
       // TODO: check that this new approach of not using the last
       // (1-accepted_photons) doesn't introduce some bias. ~icaza
       mean_photons = reflectedPhotons.second*fPMTUncoatedEff;
@@ -305,16 +294,7 @@ namespace opdet {
       }
     }
 
-    for(size_t t=0; t<nPE_v.size(); t++){
-      if(nPE_v[t] > 0) {
-        if(fParams.SimulateNonLinearity){
-          AddSPE(t, wave, fPMTNonLinearityPtr->NObservedPE(t, nPE_v) );
-        }
-        else{
-          AddSPE(t, wave, nPE_v[t]);
-        }
-      }
-    }
+    AddSPEs(nPE_v, wave);
     
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
@@ -325,9 +305,9 @@ namespace opdet {
   void DigiPMTSBNDAlg::CreatePDWaveformLiteCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    opdet::PhotonLiteSpan DirectPhotons,
+    opdet::PhotonLiteSpan ReflectedPhotons)
   {
 
     double mean_photons;
@@ -342,55 +322,42 @@ namespace opdet {
     std::vector<unsigned int> nPE_v( (size_t) fSamplingPeriod*wave.size(), 0);
 
     // direct light
-    if ( auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) ){
-      for (auto& directPhotons : (it->second).DetectedPhotons) {
-        // TODO: check that this new approach of not using the last
-        // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = directPhotons.second*fPMTCoatedVUVEff;
-        accepted_photons = fPoissonQGen.fire(mean_photons);
-        for(size_t i = 0; i < accepted_photons; i++) {
-          if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-          ttpb = fTimeTPB->fire(); // TPB emission time (PMT coating)
-
-          //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
-          tphoton = ttsTime + directPhotons.first - t_min + ttpb + fParams.CableTime;
-
-          // store the pgoton time if it's within the readout window
-          if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++;
-        }
+    for (auto& directPhotons : DirectPhotons) {
+      // TODO: check that this new approach of not using the last
+      // (1-accepted_photons) doesn't introduce some bias. ~icaza
+      mean_photons = directPhotons.second*fPMTCoatedVUVEff;
+      accepted_photons = fPoissonQGen.fire(mean_photons);
+      for(size_t i = 0; i < accepted_photons; i++) {
+        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
+        ttpb = fTimeTPB->fire(); // TPB emission time (PMT coating)
+
+        //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
+        tphoton = ttsTime + directPhotons.first - t_min + ttpb + fParams.CableTime;
+
+        // store the pgoton time if it's within the readout window
+        if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++;
       }
     }
 
     // reflected light
-    if ( auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) ){
-      for (auto& reflectedPhotons : (it->second).DetectedPhotons) {
-        // TODO: check that this new approach of not using the last
-        // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = reflectedPhotons.second*fPMTCoatedVISEff;
-        accepted_photons = fPoissonQGen.fire(mean_photons);
-        for(size_t i = 0; i < accepted_photons; i++) {
-          if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
-          ttpb = fTimeTPB->fire(); // TPB emission time (in the cathode foils)
-          
-          //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
-          tphoton = ttsTime + reflectedPhotons.first - t_min + ttpb + fParams.CableTime;
-
-          // store the pgoton time if it's within the readout window
-          if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++;
-        }
+    for (auto& reflectedPhotons : ReflectedPhotons) {
+      // TODO: check that this new approach of not using the last
+      // (1-accepted_photons) doesn't introduce some bias. ~icaza
+      mean_photons = reflectedPhotons.second*fPMTCoatedVISEff;
+      accepted_photons = fPoissonQGen.fire(mean_photons);
+      for(size_t i = 0; i < accepted_photons; i++) {
+        if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
+        ttpb = fTimeTPB->fire(); // TPB emission time (in the cathode foils)
+        
+        //photon time in ns (w.r.t. the waveform start time a.k.a t_min)
+        tphoton = ttsTime + reflectedPhotons.first - t_min + ttpb + fParams.CableTime;
+
+        // store the pgoton time if it's within the readout window
+        if(tphoton > 0 && tphoton < nPE_v.size()) nPE_v[(size_t)tphoton]++;
       }
     }
     
-    for(size_t t=0; t<nPE_v.size(); t++){
-      if(nPE_v[t] > 0) {
-        if(fParams.SimulateNonLinearity){
-          AddSPE(t, wave, fPMTNonLinearityPtr->NObservedPE(t, nPE_v) );
-        }
-        else{
-          AddSPE(t, wave, nPE_v[t]);
-        }
-      }
-    }
+    AddSPEs(nPE_v, wave);
 
     //Adding noise and saturation
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
@@ -424,32 +391,172 @@ namespace opdet {
   }
 
 
-  void DigiPMTSBNDAlg::AddSPE(size_t time, std::vector<double>& wave, double npe)
+  void DigiPMTSBNDAlg::AddSPE(size_t time, std::vector<float>& wave, double npe)
+  {
+    // simulate gain fluctuations
+    double npe_anode = npe;
+    if(fParams.MakeGainFluctuations)
+      npe_anode=fPMTGainFluctuationsPtr->GainFluctuation(npe, fEngine);
+
+    AddAnodeSPE(time, wave, npe_anode);
+  }
+
+
+  void DigiPMTSBNDAlg::AddAnodeSPE(size_t time, std::vector<float>& wave, double npe_anode)
   {
     // time bin HD (double precision)
     // used to gert the time-shifted SER
     double time_bin_hd = fSampling*time;
     size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(time_bin_hd);
-    
+
     // get actual time bin and waveform min/max iterators
     size_t time_bin=std::floor(time_bin_hd);
     size_t max = time_bin + pulsesize < wave.size() ? time_bin + pulsesize : wave.size();
-    auto min_it = std::next(wave.begin(), time_bin);
-    auto max_it = std::next(wave.begin(), max);
-    
-    // simulate gain fluctuations
+
+    // add SER to the waveform
+    if(time_bin >= max) return;
+    float const* pulse = fSinglePEWave_HD->Template(wvf_shift).data();
+    float* w = wave.data() + time_bin;
+    float const a = npe_anode;
+    for(size_t i = 0, n = max - time_bin; i < n; ++i) w[i] += a*pulse[i];
+  }
+
+
+  void DigiPMTSBNDAlg::AddSPEs(std::vector<unsigned int>& nPE_v, std::vector<float>& wave)
+  {
+    // observed pe of each pulse, then the gain fluctuations of all of them
+    // in one call of the tool, in time order as pulse by pulse
+    fSPETimes.clear();
+    fSPENPE.clear();
+    for(size_t t=0; t<nPE_v.size(); t++){
+      if(nPE_v[t] == 0) continue;
+      fSPETimes.push_back(t);
+      fSPENPE.push_back(fParams.SimulateNonLinearity ? fPMTNonLinearityPtr->NObservedPE(t, nPE_v) : nPE_v[t]);
+    }
+    if(fParams.MakeGainFluctuations)
+      fPMTGainFluctuationsPtr->GainFluctuations(fSPENPE, fSPEAnodeNPE, fEngine);
+    else
+      fSPEAnodeNPE = fSPENPE;
+
+    if(!BinnedSPEs()) {
+      for(size_t i=0; i<fSPETimes.size(); i++)
+        AddAnodeSPE(fSPETimes[i], wave, fSPEAnodeNPE[i]);
+      return;
+    }
+
+    ClearSPEs(wave.size());
+    for(size_t i=0; i<fSPETimes.size(); i++)
+      StageAnodeSPE(fSPETimes[i], fSPEAnodeNPE[i]);
+    FlushSPEs(wave);
+  }
+
+
+  void DigiPMTSBNDAlg::ClearSPEs(size_t nSamples)
+  {
+    fPhaseAmplitudes.assign(fSinglePEWave_HD->NShifts()*nSamples, 0.);
+    fNStagedSPEs = 0;
+  }
+
+
+  void DigiPMTSBNDAlg::StageSPE(size_t time, double npe)
+  {
     double npe_anode = npe;
     if(fParams.MakeGainFluctuations)
       npe_anode=fPMTGainFluctuationsPtr->GainFluctuation(npe, fEngine);
 
-    // add SER to the waveform
-    std::transform(min_it, max_it,
-                     fSinglePEWave_HD[wvf_shift].begin(), min_it,
-                     [npe_anode](auto a, auto b) { return a+npe_anode*b; });
+    StageAnodeSPE(time, npe_anode);
+  }
+
+
+  void DigiPMTSBNDAlg::StageAnodeSPE(size_t time, double npe_anode)
+  {
+    // amplitudes of the pulses starting at each sample, for each HD phase
+    size_t const nSamples = fPhaseAmplitudes.size()/fSinglePEWave_HD->NShifts();
+    double time_bin_hd = fSampling*time;
+    size_t wvf_shift  = fPMTHDOpticalWaveformsPtr->TimeBinShift(time_bin_hd);
+    size_t time_bin=std::floor(time_bin_hd);
+
+    if(time_bin >= nSamples) return;
+    fPhaseAmplitudes[wvf_shift*nSamples + time_bin] += npe_anode;
+    ++fNStagedSPEs;
+  }
+
+
+  void DigiPMTSBNDAlg::FlushSPEs(std::vector<float>& wave)
+  {
+    if(fNStagedSPEs == 0) return;
+    size_t const nSamples = wave.size();
+    size_t const nPhases = fSinglePEWave_HD->NShifts();
+
+    // direct sum over the pulses, or one FFT per phase plus one inverse FFT,
+    // whichever takes fewer operations
+    size_t const fftSize = SPEFFTSize(nSamples);
+    double const directCost = double(fNStagedSPEs)*pulsesize;
+    double const fftCost = (nPhases + 1)*fftSize*std::log2(double(fftSize));
+    if(directCost <= fftCost) {
+      for(size_t shift = 0; shift < nPhases; ++shift) {
+        float const* pulse = fSinglePEWave_HD->Template(shift).data();
+        double const* amplitudes = fPhaseAmplitudes.data() + shift*nSamples;
+        for(size_t time_bin = 0; time_bin < nSamples; ++time_bin) {
+          if(amplitudes[time_bin] == 0.) continue;
+          float const npe_anode = amplitudes[time_bin];
+          size_t const n = std::min<size_t>(pulsesize, nSamples - time_bin);
+          float* w = wave.data() + time_bin;
+          for(size_t i = 0; i < n; ++i) w[i] += npe_anode*pulse[i];
+        }
+      }
+    }
+    else {
+      ConvolveSPEs(wave);
+    }
+    fNStagedSPEs = 0;
+  }
+
+
+  size_t DigiPMTSBNDAlg::SPEFFTSize(size_t nSamples) const
+  {
+    // long enough for the pulses of the last samples not to wrap around
+    size_t fftSize = 1;
+    while(fftSize < nSamples + pulsesize) fftSize *= 2;
+    return fftSize;
   }
 
 
-  void DigiPMTSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::ConvolveSPEs(std::vector<float>& wave)
+  {
+    size_t const nSamples = wave.size();
+    size_t const nPhases = fSinglePEWave_HD->NShifts();
+    size_t const fftSize = SPEFFTSize(nSamples);
+
+    // spectra of the HD pulses, made once for each FFT size
+    if(!fSPEFFT || (size_t) fSPEFFT->FFTSize() != fftSize) {
+      fSPEFFT = std::make_unique<util::SBNDFFTWorker>(fftSize);
+      fSPESpectra.resize(nPhases);
+      std::vector<double> pulse(fftSize);
+      for(size_t shift = 0; shift < nPhases; ++shift) {
+        auto const ser = fSinglePEWave_HD->Template(shift);
+        std::fill(pulse.begin(), pulse.end(), 0.);
+        std::copy(ser.begin(), ser.end(), pulse.begin());
+        fSPEFFT->DoFFT(pulse, fSPESpectra[shift]);
+      }
+    }
+
+    std::vector<double> buffer(fftSize, 0.);
+    std::vector<TComplex> spectrum, sum(fSPEFFT->FreqSize(), TComplex(0., 0.));
+    for(size_t shift = 0; shift < nPhases; ++shift) {
+      double const* amplitudes = fPhaseAmplitudes.data() + shift*nSamples;
+      if(std::all_of(amplitudes, amplitudes + nSamples, [](double a){ return a == 0.; })) continue;
+      std::copy_n(amplitudes, nSamples, buffer.begin());
+      fSPEFFT->DoFFT(buffer, spectrum);
+      for(size_t i = 0; i < sum.size(); ++i) sum[i] += spectrum[i]*fSPESpectra[shift][i];
+    }
+    fSPEFFT->DoInvFFT(sum, buffer);
+
+    for(size_t i = 0; i < nSamples; ++i) wave[i] += buffer[i];
+  }
+
+
+  void DigiPMTSBNDAlg::CreateSaturation(std::vector<float>& wave)
   {
     if(fPositivePolarity)
       std::replace_if(wave.begin(), wave.end(),
@@ -460,39 +567,30 @@ namespace opdet {
   }
 
 
-  void DigiPMTSBNDAlg::AddLineNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddLineNoise(std::vector<float>& wave)
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.PMTBaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + fGaussQGen.fire(0., fParams.PMTBaselineRMS) ; });
+    fNoiseGen.AddNoise(wave, fParams.PMTBaselineRMS);
   }
 
 
-  void DigiPMTSBNDAlg::AddDarkNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddDarkNoise(std::vector<float>& wave)
   {
     double timeBin;
     // Multiply by 10^9 since fParams.DarkNoiseRate is in Hz (conversion from s to ns)
     double mean =  1000000000.0 / fParams.PMTDarkNoiseRate;
     double darkNoiseTime = fExponentialGen.fire(mean);
+    bool const binned = BinnedSPEs();
+    if(binned) ClearSPEs(wave.size());
     while(darkNoiseTime < wave.size()) {
       timeBin = std::round(darkNoiseTime);
-      if(timeBin < wave.size()) {AddSPE(fSamplingPeriod*timeBin, wave);}
+      if(timeBin < wave.size()) {
+        if(binned) StageSPE(fSamplingPeriod*timeBin);
+        else AddSPE(fSamplingPeriod*timeBin, wave);
+      }
       // Find next time to add dark noise
       darkNoiseTime += fExponentialGen.fire(mean);
     }
+    if(binned) FlushSPEs(wave);
   }
 
 
@@ -588,9 +686,24 @@ namespace opdet {
     fBaseConfig.TTS                      = config.tts();
     fBaseConfig.CableTime                = config.cableTime();
     fBaseConfig.PMTDataFile              = config.pmtDataFile();
+    fBaseConfig.PMTBinnedSPE             = config.pmtBinnedSPE();
     fBaseConfig.MakeGainFluctuations = config.gainFluctuationsParams.get_if_present(fBaseConfig.GainFluctuationsParams);
     fBaseConfig.SimulateNonLinearity = config.nonLinearityParams.get_if_present(fBaseConfig.NonLinearityParams);
     config.hdOpticalWaveformParams.get_if_present(fBaseConfig.HDOpticalWaveformParams);
+
+    // the HD single pe templates are made here once, and shared by all the digitizers
+    if(fBaseConfig.PMTSinglePEmodel) {
+      sbnd::startup::Span span("DigiPMTSBNDAlgMaker::HDTemplates");
+      std::string fname;
+      cet::search_path sp("FW_SEARCH_PATH");
+      sp.find_file(fBaseConfig.PMTDataFile, fname);
+      TFile* file = TFile::Open(fname.c_str(), "READ");
+      std::vector<double>* SinglePEVec_p;
+      file->GetObject("SinglePEVec_HD", SinglePEVec_p);
+      auto HDOpticalWaveformsPtr = art::make_tool<opdet::HDOpticalWaveform>(fBaseConfig.HDOpticalWaveformParams);
+      fBaseConfig.SinglePEWave_HD = std::make_shared<opdet::HDTemplateTable const>(*HDOpticalWaveformsPtr, *SinglePEVec_p);
+      file->Close();
+    }
   }
 
   std::unique_ptr<DigiPMTSBNDAlg>
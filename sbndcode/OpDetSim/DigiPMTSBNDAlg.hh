@@ -41,6 +41,10 @@
 #include "sbndcode/OpDetSim/PMTAlg/PMTGainFluctuations.hh"
 #include "sbndcode/OpDetSim/PMTAlg/PMTNonLinearity.hh"
 #include "sbndcode/OpDetSim/HDWvf/HDOpticalWaveforms.hh"
+#include "sbndcode/OpDetSim/HDWvf/HDTemplateTable.hh"
+#include "sbndcode/OpDetSim/GaussianNoiseGenerator.hh"
+#include "sbndcode/OpDetSim/PhotonTable.hh"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
 
 #include "TFile.h"
 
@@ -67,12 +71,14 @@ namespace opdet {
       double PMTUncoatedEff; //PMT (uncoated) efficiency
       std::string PMTDataFile; //File containing timing emission structure for TPB, and single PE profile from data
       bool PMTSinglePEmodel; //Model for single pe response, false for ideal, true for test bench meas
+      bool PMTBinnedSPE; //Add the single pe pulses of a channel all at once
       bool MakeGainFluctuations; //Fluctuate PMT gain
       fhicl::ParameterSet GainFluctuationsParams;
       bool SimulateNonLinearity; //Fluctuate PMT gain
       fhicl::ParameterSet NonLinearityParams;
       
       fhicl::ParameterSet HDOpticalWaveformParams;
+      std::shared_ptr<opdet::HDTemplateTable const> SinglePEWave_HD; //HD single pe templates, shared by all the digitizers
 
       detinfo::LArProperties const* larProp = nullptr; //< LarProperties service provider.
       double frequency;       //wave sampling frequency (GHz)
@@ -86,7 +92,7 @@ namespace opdet {
 
     void ConstructWaveformUncoatedPMT(
       int ch,
-      sim::SimPhotons const& simphotons,
+      opdet::SimPhotonSpan simphotons,
       std::vector<short unsigned int>& waveform,
       std::string pdtype,
       double start_time,
@@ -95,14 +101,14 @@ namespace opdet {
     void ConstructWaveformCoatedPMT(
       int ch,
       std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+      opdet::SimPhotonSpan DirectPhotons,
+      opdet::SimPhotonSpan ReflectedPhotons,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformLiteUncoatedPMT(
       int ch,
-      sim::SimPhotonsLite const& litesimphotons,
+      opdet::PhotonLiteSpan litesimphotons,
       std::vector<short unsigned int>& waveform,
       std::string pdtype,
       double start_time,
@@ -111,8 +117,8 @@ namespace opdet {
     void ConstructWaveformLiteCoatedPMT(
       int ch,
       std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+      opdet::PhotonLiteSpan DirectPhotons,
+      opdet::PhotonLiteSpan ReflectedPhotons,
       double start_time,
       unsigned n_sample);
 
@@ -121,6 +127,11 @@ namespace opdet {
         return fParams.PMTBaseline;
       }
 
+    // mean response, for a quick estimate of the waveform from the photons alone
+    double DetectionEfficiency(std::string const& pdtype, bool reflected) const; // fraction of the photons giving a pe
+    double SinglePEHeight() const { return fSinglePEHeight; } // peak of the single pe pulse from the baseline (ADC)
+    double PhotonDelay() const { return fParams.CableTime; } // ns
+
   private:
 
     ConfigurationParameters_t fParams;
@@ -131,6 +142,7 @@ namespace opdet {
     double fPMTCoatedVISEff;
     double fPMTUncoatedEff;
     bool fPositivePolarity;
+    double fSinglePEHeight;
     int fADCSaturation;
 
     double sigma1;
@@ -143,6 +155,7 @@ namespace opdet {
     CLHEP::RandPoissonQ fPoissonQGen;
     CLHEP::RandGaussQ fGaussQGen;
     CLHEP::RandExponential fExponentialGen;
+    opdet::GaussianNoiseGenerator fNoiseGen;
     std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for coated PMTs
 
     //PMTFluctuationsAlg
@@ -153,42 +166,63 @@ namespace opdet {
     //PMTNonLinearity
     std::unique_ptr<opdet::PMTNonLinearity> fPMTNonLinearityPtr;
 
-    void AddSPE(size_t time, std::vector<double>& wave, double npe = 1); // add single pulse to auxiliary waveform
+    void AddSPE(size_t time, std::vector<float>& wave, double npe = 1); // add single pulse to auxiliary waveform
+    void AddAnodeSPE(size_t time, std::vector<float>& wave, double npe_anode); // same, gain already fluctuated
     void Pulse1PE(std::vector<double>& wave);
     double Transittimespread(double fwhm);
 
     std::vector<double> fSinglePEWave; // single photon pulse vector
-    std::vector<std::vector<double>> fSinglePEWave_HD; // single photon pulse vector
+    std::shared_ptr<opdet::HDTemplateTable const> fSinglePEWave_HD; // single photon pulses for each HD shift
     int pulsesize; //size of 1PE waveform
+
+    // binned single pe response: pulse amplitudes by HD phase and sample,
+    // and the spectra of the HD pulses for the FFT convolution
+    std::vector<double> fPhaseAmplitudes;
+    size_t fNStagedSPEs = 0;
+    std::unique_ptr<util::SBNDFFTWorker> fSPEFFT;
+    std::vector<std::vector<TComplex>> fSPESpectra;
+
+    void AddSPEs(std::vector<unsigned int>& nPE_v, std::vector<float>& wave); // add the pulses of all the pe in nPE_v
+    std::vector<size_t> fSPETimes;      // pulses of AddSPEs: time (ns),
+    std::vector<double> fSPENPE;        // observed pe
+    std::vector<double> fSPEAnodeNPE;   // and pe after gain fluctuations
+    bool BinnedSPEs() const { return fParams.PMTBinnedSPE && fSinglePEWave_HD && fSinglePEWave_HD->NShifts() > 0; }
+    void ClearSPEs(size_t nSamples);
+    void StageSPE(size_t time, double npe = 1); // queue the pulse of npe at time (ns)
+    void StageAnodeSPE(size_t time, double npe_anode); // same, gain already fluctuated
+    void FlushSPEs(std::vector<float>& wave); // add the queued pulses to wave
+    size_t SPEFFTSize(size_t nSamples) const;
+    void ConvolveSPEs(std::vector<float>& wave);
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
+    std::vector<float> fWave; // working waveform in ADC counts, reused across channels and events
 
     void CreatePDWaveformUncoatedPMT(
       sim::SimPhotons const& SimPhotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap);
+      std::vector<float>& wave,
+      opdet::SimPhotonSpan DirectPhotons,
+      opdet::SimPhotonSpan ReflectedPhotons);
     void CreatePDWaveformLiteUncoatedPMT(
-      sim::SimPhotonsLite const& litesimphotons,
+      opdet::PhotonLiteSpan litesimphotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformLiteCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects (dynamic range)
-    void AddLineNoise(std::vector<double>& wave); //add noise to baseline
-    void AddDarkNoise(std::vector<double>& wave); //add dark noise
+      std::vector<float>& wave,
+      opdet::PhotonLiteSpan DirectPhotons,
+      opdet::PhotonLiteSpan ReflectedPhotons);
+    void CreateSaturation(std::vector<float>& wave);//Including saturation effects (dynamic range)
+    void AddLineNoise(std::vector<float>& wave); //add noise to baseline
+    void AddDarkNoise(std::vector<float>& wave); //add dark noise
     double FindMinimumTime(
       sim::SimPhotons const&,
       int ch,
@@ -283,6 +317,12 @@ namespace opdet {
         Comment("Model used for single PE response of PMT. =0 is ideal, =1 is testbench")
       };
 
+      fhicl::Atom<bool> pmtBinnedSPE {
+        Name("PMTBinnedSPE"),
+        Comment("Add the single pe pulses of a channel at once, by FFT convolution for busy channels"),
+        true
+      };
+
       fhicl::Atom<std::string> pmtDataFile {
         Name("PMTDataFile"),
         Comment("File containing timing emission distribution for TPB and single pe pulse from data")
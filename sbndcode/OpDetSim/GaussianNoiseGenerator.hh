@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+// File:        GaussianNoiseGenerator.hh
+//
+// Gaussian baseline noise for the optical detector digitizers.
+// The uniform numbers of a whole waveform are drawn from the engine in one
+// block into a reusable buffer and turned into Gaussian pairs with the
+// Box-Muller transform, in a plain loop the compiler can vectorize.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_GAUSSIANNOISEGENERATOR_HH
+#define SBND_OPDETSIM_GAUSSIANNOISEGENERATOR_HH
+
+#include "CLHEP/Random/RandomEngine.h"
+
+#include <cmath>
+#include <vector>
+
+namespace opdet {
+
+  class GaussianNoiseGenerator {
+
+  public:
+    explicit GaussianNoiseGenerator(CLHEP::HepRandomEngine& engine)
+      : fEngine(engine) {}
+
+    // add Gaussian noise of mean 0 and standard deviation sigma to each sample
+    template <class T> void AddNoise(std::vector<T>& wave, double sigma);
+
+  private:
+    CLHEP::HepRandomEngine& fEngine;
+    std::vector<double> fUniform; // first half radii, second half angles
+  };
+
+} // namespace opdet
+
+template <class T>
+inline void opdet::GaussianNoiseGenerator::AddNoise(std::vector<T>& wave, double sigma)
+{
+  size_t const n = wave.size();
+  size_t const nPairs = (n + 1)/2;
+  if(nPairs == 0) return;
+
+  // the engine flat numbers are in (0, 1), so the logarithm is finite
+  fUniform.resize(2*nPairs);
+  fEngine.flatArray(int(2*nPairs), fUniform.data());
+
+  double const twoPi = 2.*M_PI;
+  double const* u1 = fUniform.data();
+  double const* u2 = fUniform.data() + nPairs;
+  T* first = wave.data();
+  T* second = wave.data() + nPairs;
+  size_t const nFull = n - nPairs; // pairs with both samples in the waveform
+  for(size_t i = 0; i < nFull; ++i) {
+    double const r = sigma*std::sqrt(-2.*std::log(u1[i]));
+    double const phi = twoPi*u2[i];
+    first[i] += r*std::cos(phi);
+    second[i] += r*std::sin(phi);
+  }
+  if(nFull < nPairs) first[nFull] += sigma*std::sqrt(-2.*std::log(u1[nFull]))*std::cos(twoPi*u2[nFull]);
+}
+
+#endif // SBND_OPDETSIM_GAUSSIANNOISEGENERATOR_HH
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////
+// File:        HDTemplateTable.hh
+//
+// All the sub-tick shifted single electron response templates of one
+// channel type, as produced by HDOpticalWaveform::produceSER_HD(), in one
+// fixed block of memory. Each template starts on a cache line and is
+// zero-padded to the same length, so adding a pulse to a waveform is a
+// plain loop over PulseSize() samples. The table is made once and then
+// only read, so it can be shared by all the digitizers of a job.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_HDTEMPLATETABLE_HH
+#define SBND_OPDETSIM_HDTEMPLATETABLE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sbndcode/OpDetSim/HDWvf/HDOpticalWaveforms.hh"
+
+namespace opdet {
+
+  class HDTemplateTable {
+
+  public:
+    static constexpr std::size_t kAlignment = 64; // bytes, one cache line
+
+    // Template of one shift
+    class Span_t {
+    public:
+      Span_t(float const* data, std::size_t size): fData(data), fSize(size) {}
+
+      float const* data() const { return fData; }
+      float const* begin() const { return fData; }
+      float const* end() const { return fData + fSize; }
+      std::size_t size() const { return fSize; }
+      float operator[](std::size_t i) const { return fData[i]; }
+
+    private:
+      float const* fData;
+      std::size_t fSize;
+    };
+
+    // templates of each shift
+    explicit HDTemplateTable(std::vector<std::vector<double>> const& serHD);
+    // shifted templates of the response ser, made by the tool
+    HDTemplateTable(opdet::HDOpticalWaveform& tool, std::vector<double> ser);
+
+    // the rows point into fStorage
+    HDTemplateTable(HDTemplateTable const&) = delete;
+    HDTemplateTable& operator=(HDTemplateTable const&) = delete;
+
+    std::size_t NShifts() const { return fNShifts; }
+    std::size_t PulseSize() const { return fPulseSize; }
+    Span_t Template(std::size_t shift) const { return { fFirst + shift*fStride, fPulseSize }; }
+
+  private:
+    std::size_t fNShifts = 0;
+    std::size_t fPulseSize = 0;
+    std::size_t fStride = 0; // floats from a template to the next
+    std::vector<float> fStorage;
+    float const* fFirst = nullptr;
+
+    void Fill(std::vector<std::vector<double>> const& serHD);
+    static std::vector<std::vector<double>> MakeSERHD(opdet::HDOpticalWaveform& tool, std::vector<double>& ser);
+  };
+
+} // namespace opdet
+
+
+inline opdet::HDTemplateTable::HDTemplateTable(std::vector<std::vector<double>> const& serHD)
+{
+  Fill(serHD);
+}
+
+inline opdet::HDTemplateTable::HDTemplateTable(opdet::HDOpticalWaveform& tool, std::vector<double> ser)
+{
+  Fill(MakeSERHD(tool, ser));
+}
+
+inline std::vector<std::vector<double>>
+opdet::HDTemplateTable::MakeSERHD(opdet::HDOpticalWaveform& tool, std::vector<double>& ser)
+{
+  std::vector<std::vector<double>> serHD;
+  tool.produceSER_HD(serHD, ser);
+  return serHD;
+}
+
+inline void opdet::HDTemplateTable::Fill(std::vector<std::vector<double>> const& serHD)
+{
+  std::size_t constexpr lineFloats = kAlignment/sizeof(float);
+
+  fNShifts = serHD.size();
+  fPulseSize = 0;
+  for(auto const& ser : serHD) fPulseSize = std::max(fPulseSize, ser.size());
+  fStride = (fPulseSize + lineFloats - 1)/lineFloats*lineFloats;
+
+  // room to move the first template to the start of a cache line
+  fStorage.assign(fNShifts*fStride + lineFloats, 0.f);
+  std::uintptr_t const address = reinterpret_cast<std::uintptr_t>(fStorage.data());
+  std::size_t const skip = (kAlignment - address%kAlignment)%kAlignment/sizeof(float);
+  float* first = fStorage.data() + skip;
+  for(std::size_t shift = 0; shift < fNShifts; ++shift)
+    std::copy(serHD[shift].begin(), serHD[shift].end(), first + shift*fStride);
+  fFirst = first;
+}
+
+#endif // SBND_OPDETSIM_HDTEMPLATETABLE_HH
@@ -7,7 +7,11 @@
 #ifndef SBND_PMTGainFluctuations_H
 #define SBND_PMTGainFluctuations_H
 
+#include <vector>
 
+namespace CLHEP {
+  class HepRandomEngine;
+}
 
 namespace opdet {
   class PMTGainFluctuations;
@@ -21,6 +25,14 @@ public:
 
   //Returns fluctuated factor for SPR
   virtual double GainFluctuation(unsigned int npe, CLHEP::HepRandomEngine* eng) = 0;
+
+  //Fills npe_anode with the fluctuated factors of all the pulses in npe,
+  //drawn in order; tools can override it to sample the whole array at once
+  virtual void GainFluctuations(std::vector<double> const& npe, std::vector<double>& npe_anode,
+                                CLHEP::HepRandomEngine* eng) {
+    npe_anode.resize(npe.size());
+    for(size_t i=0; i<npe.size(); i++) npe_anode[i] = GainFluctuation(npe[i], eng);
+  }
 };
 
 #endif
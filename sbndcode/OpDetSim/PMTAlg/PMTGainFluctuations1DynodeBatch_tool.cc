@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////
+// Specific class tool for PMTGainFluctuations
+// File: PMTGainFluctuations1DynodeBatch_tool.cc
+// Base class:        PMTGainFluctuations.hh
+// Same model as PMTGainFluctuations1Dynode (Poisson fluctuations at the
+// first dynode), with the Poisson cumulative distributions for the
+// smaller #PE tabulated at construction: the pulses of a waveform take
+// their uniform deviates from a single flatArray call and are sampled by
+// bisection of the tables
+////////////////////////////////////////////////////////////////////////
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Utilities/ToolMacros.h"
+#include "art/Utilities/ToolConfigTable.h"
+#include "CLHEP/Random/RandomEngine.h"
+#include "CLHEP/Random/RandPoissonQ.h"
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Sequence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sbndcode/OpDetSim/PMTAlg/PMTGainFluctuations.hh"
+
+
+namespace opdet {
+  class PMTGainFluctuations1DynodeBatch;
+}
+
+
+class opdet::PMTGainFluctuations1DynodeBatch : public opdet::PMTGainFluctuations {
+public:
+
+  //Configuration parameters
+  struct Config {
+    using Name = fhicl::Name;
+    using Comment = fhicl::Comment;
+
+    fhicl::Atom<double> dynodeK {
+      Name("DynodeK"),
+      Comment("Gain at each stage is proportional to pow(Voltage,DynodeK)")
+    };
+
+    fhicl::Atom<double> gain {
+      Name("Gain"),
+      Comment("PMT total gain")
+    };
+
+    fhicl::Sequence<double> voltageDistribution {
+      Name("VoltageDistribution"),
+      Comment("PMT voltage distribution ratio at each dynode")
+    };
+
+    fhicl::Atom<unsigned int> tabulatedMaxPE {
+      Name("TabulatedMaxPE"),
+      Comment("Largest #PE with a tabulated distribution; larger ones are drawn with RandPoissonQ"),
+      10
+    };
+
+  };
+
+  explicit PMTGainFluctuations1DynodeBatch(art::ToolConfigTable<Config> const& config);
+
+  //Returns fluctuated factor for SPR
+  double GainFluctuation(unsigned int npe, CLHEP::HepRandomEngine* eng) override;
+
+  //Fluctuated factors of all the pulses, with one flatArray call
+  void GainFluctuations(std::vector<double> const& npe, std::vector<double>& npe_anode,
+                        CLHEP::HepRandomEngine* eng) override;
+
+private:
+  //Configuration parameters
+  double fDynodeK;
+  double fGain;
+  std::vector<double> fVoltageDistribution;
+
+  double fDynodeGain;
+
+  // Cumulative Poisson distribution of mean npe*fDynodeGain for each npe
+  // up to the tabulated maximum (index 0 unused)
+  std::vector<std::vector<double>> fCDF;
+
+  std::vector<double> fUniforms;
+
+  double DynodeGain(unsigned int dynstage);
+
+  // Fluctuated factor for the uniform deviate u
+  double Sample(unsigned int npe, double u, CLHEP::HepRandomEngine* eng) const;
+};
+
+
+opdet::PMTGainFluctuations1DynodeBatch::PMTGainFluctuations1DynodeBatch(art::ToolConfigTable<Config> const& config)
+  : fDynodeK { config().dynodeK() }
+  , fGain { config().gain() }
+  , fVoltageDistribution { config().voltageDistribution() }
+  , fDynodeGain { DynodeGain(1) }
+{
+  fCDF.resize(config().tabulatedMaxPE() + 1);
+  for(size_t npe=1; npe<fCDF.size(); npe++){
+    double const mean = npe*fDynodeGain;
+    std::vector<double>& cdf = fCDF[npe];
+    double p = std::exp(-mean);
+    double sum = p;
+    cdf.push_back(sum);
+    for(unsigned int k=1; k<=mean || p>1e-16*sum; k++){
+      p *= mean/k;
+      sum += p;
+      cdf.push_back(sum);
+    }
+    cdf.back() = 1.;
+  }
+}
+
+
+double opdet::PMTGainFluctuations1DynodeBatch::DynodeGain(unsigned int dynstage){
+  double prodRho = 1.0;
+  for(double rho: fVoltageDistribution) prodRho *= rho;
+  double const aVk = std::pow(fGain / std::pow(prodRho, fDynodeK), 1.0/static_cast<double>(fVoltageDistribution.size()));
+  return aVk * std::pow(fVoltageDistribution.at(dynstage - 1), fDynodeK);
+}
+
+
+double opdet::PMTGainFluctuations1DynodeBatch::Sample(unsigned int npe, double u, CLHEP::HepRandomEngine* eng) const {
+  if(npe == 0) return 0.;
+  if(npe >= fCDF.size()) return CLHEP::RandPoissonQ::shoot(eng, npe*fDynodeGain)/fDynodeGain;
+  std::vector<double> const& cdf = fCDF[npe];
+  size_t const k = std::upper_bound(cdf.begin(), cdf.end() - 1, u) - cdf.begin();
+  return k/fDynodeGain;
+}
+
+
+double opdet::PMTGainFluctuations1DynodeBatch::GainFluctuation(unsigned int npe, CLHEP::HepRandomEngine* eng){
+  return Sample(npe, eng->flat(), eng);
+}
+
+
+void opdet::PMTGainFluctuations1DynodeBatch::GainFluctuations(std::vector<double> const& npe, std::vector<double>& npe_anode,
+                                                              CLHEP::HepRandomEngine* eng){
+  npe_anode.resize(npe.size());
+  if(npe.empty()) return;
+  fUniforms.resize(npe.size());
+  eng->flatArray(int(fUniforms.size()), fUniforms.data());
+  for(size_t i=0; i<npe.size(); i++) npe_anode[i] = Sample(npe[i], fUniforms[i], eng);
+}
+
+
+DEFINE_ART_CLASS_TOOL(opdet::PMTGainFluctuations1DynodeBatch)
@@ -7,7 +7,7 @@
 #ifndef SBND_PMTNonLinearity_H
 #define SBND_PMTNonLinearity_H
 
-
+#include <vector>
 
 namespace opdet {
   class PMTNonLinearity;
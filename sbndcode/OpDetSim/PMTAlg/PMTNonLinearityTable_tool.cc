@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////
+// Specific class tool for PMTNonLinearity
+// File: PMTNonLinearityTable_tool.cc
+// Base class:        PMTNonLinearity.hh
+// Non linearity given as a table of observed vs true #PE, linearly
+// interpolated at each integer #PE when the tool is constructed
+////////////////////////////////////////////////////////////////////////
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Utilities/ToolMacros.h"
+#include "art/Utilities/ToolConfigTable.h"
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Sequence.h"
+#include "cetlib_except/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "sbndcode/OpDetSim/PMTAlg/PMTNonLinearity.hh"
+
+
+namespace opdet {
+  class PMTNonLinearityTable;
+}
+
+
+class opdet::PMTNonLinearityTable : public opdet::PMTNonLinearity {
+public:
+
+  //Configuration parameters
+  struct Config {
+    using Name = fhicl::Name;
+    using Comment = fhicl::Comment;
+
+    fhicl::Sequence<double> tablePE {
+      Name("TablePE"),
+      Comment("Accumulated #PE of the table points, increasing. Linear response below the first one, saturated above the last one.")
+    };
+
+    fhicl::Sequence<double> tableObservedPE {
+      Name("TableObservedPE"),
+      Comment("Observed #PE at each of the table points")
+    };
+
+    fhicl::Atom<unsigned int> attenuationPreTime {
+      Name("AttenuationPreTime"),
+      Comment("For the non-linear attenuation, consider photons arriving given by this time window. In nanoseconds.")
+    };
+
+  };
+
+  explicit PMTNonLinearityTable(art::ToolConfigTable<Config> const& config);
+
+  //Returns rescaled #pe after non linearity
+  double NObservedPE(size_t bin, std::vector<unsigned int> & pe_vector) override;
+
+private:
+  //Configuration parameters
+  unsigned int fAttenuationPreTime;
+
+  // Attenuation at each accumulated #PE below saturation
+  std::vector<double> fPEAttenuation_V;
+  double fPESaturationValue;
+};
+
+
+opdet::PMTNonLinearityTable::PMTNonLinearityTable(art::ToolConfigTable<Config> const& config)
+  : fAttenuationPreTime { config().attenuationPreTime() }
+{
+  std::vector<double> const tablePE = config().tablePE();
+  std::vector<double> const tableObservedPE = config().tableObservedPE();
+
+  if(tablePE.size() < 2 || tablePE.size() != tableObservedPE.size())
+    throw cet::exception("PMTNonLinearityTable") << "TablePE and TableObservedPE must have the same size, at least 2\n";
+  if(tablePE.front() <= 0. || !std::is_sorted(tablePE.begin(), tablePE.end(), std::less_equal<double>()))
+    throw cet::exception("PMTNonLinearityTable") << "TablePE must be positive and strictly increasing\n";
+
+  // Tabulate the attenuation at each integer #PE up to the last point
+  size_t const nPE = std::ceil(tablePE.back());
+  fPEAttenuation_V.assign(nPE, 1.);
+  size_t k = 0;
+  for(size_t pe=std::ceil(tablePE.front()); pe<nPE; pe++){
+    while(tablePE[k+1] < pe) k++;
+    double const w = (pe - tablePE[k])/(tablePE[k+1] - tablePE[k]);
+    fPEAttenuation_V[pe] = ((1. - w)*tableObservedPE[k] + w*tableObservedPE[k+1])/pe;
+  }
+  fPESaturationValue = tableObservedPE.back();
+}
+
+double opdet::PMTNonLinearityTable::NObservedPE(size_t bin, std::vector<unsigned int> & pe_vector){
+
+  // get first bin
+  size_t start_bin = (bin > fAttenuationPreTime) ? bin-fAttenuationPreTime : 0;
+  unsigned int npe_acc = std::accumulate(pe_vector.begin()+start_bin, pe_vector.begin()+bin+1, 0u);
+
+  if(npe_acc<fPEAttenuation_V.size()) return pe_vector[bin]*fPEAttenuation_V[npe_acc];
+  else return fPESaturationValue;
+}
+
+
+DEFINE_ART_CLASS_TOOL(opdet::PMTNonLinearityTable)
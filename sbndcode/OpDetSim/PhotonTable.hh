@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////
+// File:        PhotonTable.hh
+//
+// Photons of all the optical channels of an event, separately for direct
+// and reflected light. The entries of each light type are kept in one
+// contiguous array, channel after channel, with the offset of each
+// channel in it (compressed sparse rows). The table is filled once per
+// event and then only read, by all the digitizer threads at once.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_PHOTONTABLE_HH
+#define SBND_OPDETSIM_PHOTONTABLE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "lardataobj/Simulation/SimPhotons.h"
+
+namespace opdet {
+
+  // Contiguous photons of one channel
+  template <typename Entry>
+  class PhotonSpan {
+  public:
+    PhotonSpan() = default;
+    PhotonSpan(Entry const* begin, Entry const* end): fBegin(begin), fEnd(end) {}
+
+    Entry const* begin() const { return fBegin; }
+    Entry const* end() const { return fEnd; }
+    std::size_t size() const { return fEnd - fBegin; }
+    bool empty() const { return fBegin == fEnd; }
+    Entry const& operator[](std::size_t i) const { return fBegin[i]; }
+
+  private:
+    Entry const* fBegin = nullptr;
+    Entry const* fEnd = nullptr;
+  };
+
+  template <typename Entry>
+  class PhotonTable {
+  public:
+    using Span_t = PhotonSpan<Entry>;
+
+    Span_t Direct(unsigned ch) const { return fDirect.Row(ch); }
+    Span_t Reflected(unsigned ch) const { return fReflected.Row(ch); }
+    bool Empty(unsigned ch) const { return Direct(ch).empty() && Reflected(ch).empty(); }
+
+    // drop the entries, keeping the memory for the next event
+    void clear() { Reset(0); }
+
+    // Filling: Reset(), Count() the entries of each channel, Allocate(),
+    // then Insert() them in the same order
+    void Reset(unsigned nChannels) { fDirect.Reset(nChannels); fReflected.Reset(nChannels); }
+    void Count(bool reflected, unsigned ch, std::size_t n) { Rows(reflected).offsets[ch + 1] += n; }
+    void Allocate() { fDirect.Allocate(); fReflected.Allocate(); }
+    template <typename It>
+    void Insert(bool reflected, unsigned ch, It begin, It end)
+      {
+        auto& rows = Rows(reflected);
+        rows.fill[ch] = std::copy(begin, end, rows.entries.begin() + rows.fill[ch]) - rows.entries.begin();
+      }
+
+    // Replace the entries of each channel with [begin, f(begin, end)),
+    // where f rearranges them in place
+    template <typename F>
+    void CompactRows(F f) { fDirect.Compact(f); fReflected.Compact(f); }
+
+    unsigned NChannels() const { return fDirect.offsets.empty() ? 0 : fDirect.offsets.size() - 1; }
+
+  private:
+    struct RowSet {
+      std::vector<std::size_t> offsets; // first entry of each channel, and the end of the last one
+      std::vector<std::size_t> fill;    // next entry to be inserted for each channel
+      std::vector<Entry> entries;
+
+      void Reset(unsigned nChannels)
+        {
+          offsets.assign(nChannels + 1, 0);
+          fill.clear();
+          entries.clear();
+        }
+
+      void Allocate()
+        {
+          for (std::size_t ch = 1; ch < offsets.size(); ++ch) offsets[ch] += offsets[ch - 1];
+          fill.assign(offsets.begin(), offsets.end() - 1);
+          entries.resize(offsets.back());
+        }
+
+      template <typename F>
+      void Compact(F f)
+        {
+          std::size_t end = 0;
+          for (std::size_t ch = 0; ch + 1 < offsets.size(); ++ch) {
+            Entry* const first = entries.data() + offsets[ch];
+            Entry* const last = f(first, entries.data() + offsets[ch + 1]);
+            offsets[ch] = end;
+            end = std::move(first, last, entries.begin() + end) - entries.begin();
+          }
+          if (!offsets.empty()) offsets.back() = end;
+          entries.resize(end);
+        }
+
+      Span_t Row(unsigned ch) const
+        {
+          if (std::size_t(ch) + 1 >= offsets.size()) return {};
+          return { entries.data() + offsets[ch], entries.data() + offsets[ch + 1] };
+        }
+    };
+
+    RowSet& Rows(bool reflected) { return reflected ? fReflected : fDirect; }
+
+    RowSet fDirect;
+    RowSet fReflected;
+  };
+
+  // SimPhotonsLite entries: (time in ns, number of photons), sorted by time
+  using PhotonLiteEntry_t = std::pair<int, int>;
+  using PhotonLiteSpan = PhotonSpan<PhotonLiteEntry_t>;
+  using PhotonLiteTable = PhotonTable<PhotonLiteEntry_t>;
+
+  using SimPhotonSpan = PhotonSpan<sim::OnePhoton>;
+  using SimPhotonTable = PhotonTable<sim::OnePhoton>;
+
+  // Number of photons in the table, over all the channels and both light types
+  inline std::size_t CountPhotons(PhotonLiteTable const& table)
+  {
+    std::size_t n = 0;
+    for (unsigned ch = 0; ch < table.NChannels(); ++ch) {
+      for (auto const& entry : table.Direct(ch)) n += entry.second;
+      for (auto const& entry : table.Reflected(ch)) n += entry.second;
+    }
+    return n;
+  }
+
+  inline std::size_t CountPhotons(SimPhotonTable const& table)
+  {
+    std::size_t n = 0;
+    for (unsigned ch = 0; ch < table.NChannels(); ++ch)
+      n += table.Direct(ch).size() + table.Reflected(ch).size();
+    return n;
+  }
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_PHOTONTABLE_HH
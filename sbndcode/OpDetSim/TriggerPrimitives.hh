@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////
+// File:        TriggerPrimitives.hh
+//
+// Building blocks of the PMT trigger emulation, shared by the
+// opDetSBNDTriggerAlg of the digitizer and by the pmtTriggerProducer
+// and pmtSoftwareTriggerProducer, so that all of them apply the same
+// threshold and majority logic to the waveforms.
+//
+// The thresholds are integer cuts on the integer ADC samples: a sample
+// is below a real valued threshold t exactly when it is below ceil(t),
+// so the waveform loops never convert the samples to floating point.
+// TickMask keeps one bit per trigger input (e.g. PMT pair) and tick;
+// the number of inputs on at a tick is the popcount of its words.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_TRIGGERPRIMITIVES_HH
+#define SBND_OPDETSIM_TRIGGERPRIMITIVES_HH
+
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace opdet {
+namespace trigger {
+
+  // Integer cut equivalent to "sample < threshold" for integer samples
+  inline int BelowThresholdCut(double threshold) {
+    double const cut = std::ceil(threshold);
+    if (!(cut > INT_MIN)) return INT_MIN;
+    if (cut > INT_MAX) return INT_MAX;
+    return int(cut);
+  }
+
+  // Baseline subtracted sample, positive for a pulse of the given polarity
+  inline int PulseHeight(int adc, int baseline, int polarity) {
+    return polarity * (adc - baseline);
+  }
+
+  // Whether the pulse, of the given polarity, is over threshold at this sample
+  inline bool OverThreshold(int adc, int baseline, int polarity, int threshold) {
+    return PulseHeight(adc, baseline, polarity) > threshold;
+  }
+
+  // bits[i] |= (adcs[i] < cut) for the n samples
+  template <typename ADC>
+  inline void OrBelowThreshold(ADC const* adcs, std::size_t n, int cut, char* bits) {
+    for (std::size_t i = 0; i < n; ++i) bits[i] |= (int(adcs[i]) < cut);
+  }
+
+  // Number of samples in [first, last) below the cut
+  template <typename ADC>
+  inline int CountBelowThreshold(ADC const* first, ADC const* last, int cut) {
+    int n = 0;
+    for (ADC const* it = first; it != last; ++it) n += (int(*it) < cut);
+    return n;
+  }
+
+  // Majority logic: enough inputs are on
+  inline bool Majority(std::size_t nOn, std::size_t required) { return nOn >= required; }
+
+  // Trigger inputs over threshold, one bit per input and tick
+  class TickMask {
+  public:
+
+    // Clears the mask for nInputs inputs; ticks are added as the inputs are set
+    void Reset(std::size_t nInputs) {
+      fNWords = std::max<std::size_t>(1, (nInputs + 63) / 64);
+      fNInputs = nInputs;
+      fWords.clear();
+    }
+
+    std::size_t NInputs() const { return fNInputs; }
+    std::size_t NTicks() const { return fWords.size() / fNWords; }
+
+    // Sets the bit of the input at every tick i < n where on[i] is not zero
+    void OrInput(std::size_t input, char const* on, std::size_t n) {
+      if (n > NTicks()) fWords.resize(n * fNWords, 0);
+      std::uint64_t* words = fWords.data() + input / 64;
+      unsigned const shift = input % 64;
+      if (fNWords == 1) {
+        for (std::size_t i = 0; i < n; ++i) words[i] |= std::uint64_t(on[i] != 0) << shift;
+      }
+      else {
+        for (std::size_t i = 0; i < n; ++i) words[i * fNWords] |= std::uint64_t(on[i] != 0) << shift;
+      }
+    }
+
+    // Number of inputs on at the tick
+    std::size_t Count(std::size_t tick) const {
+      std::uint64_t const* words = fWords.data() + tick * fNWords;
+      std::size_t n = 0;
+      for (std::size_t w = 0; w < fNWords; ++w) n += std::bitset<64>(words[w]).count();
+      return n;
+    }
+
+    // counts[i] += Count(i) for the first n ticks (at most NTicks())
+    template <typename Count_t>
+    void AddCounts(Count_t* counts, std::size_t n) const {
+      n = std::min(n, NTicks());
+      for (std::size_t i = 0; i < n; ++i) counts[i] += Count(i);
+    }
+
+  private:
+    std::size_t fNWords = 1;
+    std::size_t fNInputs = 0;
+    std::vector<std::uint64_t> fWords;
+  };
+
+} // namespace trigger
+} // namespace opdet
+
+#endif
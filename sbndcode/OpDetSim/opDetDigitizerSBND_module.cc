@@ -7,7 +7,7 @@
 // Created by L. Paulucci, F. Marinho, and I.L. de Icaza
 ////////////////////////////////////////////////////////////////////////
 
-#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ReplicatedProducer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
@@ -20,6 +20,12 @@
 
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "CLHEP/Random/JamesRandom.h"
+#include "CLHEP/Random/RandFlat.h"
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/partitioner.h"
+#include "tbb/task_arena.h"
+#include <optional>
 
 #include <memory>
 #include <vector>
@@ -53,6 +59,11 @@
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
+#include "sbndcode/Utilities/ThreadPool.h"
+#include "sbndcode/OpDetSim/CompactWaveform/CompactOpDetWaveforms.h"
+#include "sbndcode/Utilities/Instrumentation.h"
+#include "sbndcode/Utilities/EventPerformance.h"
+#include "sbndcode/Utilities/ReplicaSharedState.h"
 
 namespace opdet {
 
@@ -70,6 +81,9 @@ namespace opdet {
   * Output
   * =======
   * A collection of optical detector waveforms (`std::vector<raw::OpDetWaveform>`) is produced.
+  * With `CompactOutput`, the same waveforms are written instead as a single
+  * `sbnd::CompactOpDetWaveforms`, with the samples of all of them in one
+  * delta-encoded pool, which takes much less space in the file.
   *
   * Requirements
   * =============
@@ -77,11 +91,41 @@ namespace opdet {
   * * `DetectorClocksService` for timing conversions and settings
   * * `LArPropertiesService` for the scintillation yield(s)
   *
+  * Multithreading
+  * ===============
+  * art makes one replica of the module for each schedule, with its own
+  * workers, engines and trigger algorithm. The digitization settings,
+  * including the single photon templates, are made once and shared by
+  * all the replicas.
+  *
+  * With `RunOnJobThreads`, the workers run as tasks on the thread pool of
+  * the job instead of on threads of their own. The TPC, photon detector
+  * and CRT simulations of the concurrent schedules then share the threads
+  * set by `services.scheduler.num_threads`, and `NThreads: 0` makes as many
+  * workers as that pool has threads; more than that are not run at once.
+  * With `PinNUMA` as well, the workers of each replica run on the cores of
+  * one NUMA node, the schedules taking the nodes in turn, so the waveforms
+  * and photon tables of a replica stay in the memory of its node.
+  *
+  * Trigger first
+  * ==============
+  * With `TriggerFirst` (and `ApplyTriggers`), the triggers are found on an
+  * estimate of the waveforms made from the photon arrival times alone: the
+  * expected photoelectrons within `TriggerFirstPileUpTime` times the height
+  * of the single photoelectron pulse, with no fluctuation or noise. Each
+  * channel with triggers is then digitized only from `TriggerFirstMargin`
+  * before its first readout window to as much after its last one, and
+  * cropped to the windows as usual. The full window is never synthesized.
+  * The readout windows are those of the estimate, so triggers that only the
+  * noise, the dark counts or the gain fluctuations would make are not
+  * simulated, and the random numbers differ from the full digitization:
+  * the waveforms are a different sample of the same response.
+  *
   */
 
   class opDetDigitizerSBND;
 
-  class opDetDigitizerSBND : public art::EDProducer {
+  class opDetDigitizerSBND : public art::ReplicatedProducer {
   public:
     struct Config {
       using Comment = fhicl::Comment;
@@ -114,14 +158,58 @@ namespace opdet {
         1
       };
 
+      fhicl::Atom<bool> DropInputProducts {
+        Name("DropInputProducts"),
+        Comment("Remove the simulated photons from the event once they are in the photon table.\
+                     Only for photons read from the input file: downstream modules read them again from it."),
+        false
+      };
+
+      fhicl::Atom<bool> TriggerFirst {
+        Name("TriggerFirst"),
+        Comment("Find the triggers on an estimate of the waveforms from the photons, and digitize only around the readout windows"),
+        false
+      };
+
+      fhicl::Atom<double> TriggerFirstPileUpTime {
+        Name("TriggerFirstPileUpTime"),
+        Comment("Photons within this time are summed into one pulse by the trigger first estimate [ns]"),
+        10.
+      };
+
+      fhicl::Atom<double> TriggerFirstMargin {
+        Name("TriggerFirstMargin"),
+        Comment("Time digitized before and after the readout windows of a channel in trigger first mode;\
+                     it must cover the length of a pulse [us]"),
+        1.
+      };
+
+      fhicl::Atom<bool> CompactOutput {
+        Name("CompactOutput"),
+        Comment("Write the waveforms as one sbnd::CompactOpDetWaveforms instead of std::vector<raw::OpDetWaveform>"),
+        false
+      };
+
+      fhicl::Atom<bool> RunOnJobThreads {
+        Name("RunOnJobThreads"),
+        Comment("Run the workers as tasks on the thread pool of the job instead of on threads of their own"),
+        false
+      };
+
+      fhicl::Atom<bool> PinNUMA {
+        Name("PinNUMA"),
+        Comment("With RunOnJobThreads, run the workers of each schedule on the cores of one NUMA node"),
+        false
+      };
+
       fhicl::TableFragment<opdet::DigiPMTSBNDAlgMaker::Config> pmtAlgoConfig;
       fhicl::TableFragment<opdet::DigiArapucaSBNDAlgMaker::Config> araAlgoConfig;
       fhicl::TableFragment<opdet::opDetSBNDTriggerAlg::Config> trigAlgoConfig;
     }; // struct Config
 
-    using Parameters = art::EDProducer::Table<Config>;
+    using Parameters = art::ReplicatedProducer::Table<Config>;
 
-    explicit opDetDigitizerSBND(Parameters const& config);
+    opDetDigitizerSBND(Parameters const& config, art::ProcessingFrame const& frame);
     // The destructor generated by the compiler is fine for classes
     // without bare pointers or other resource use.
     // Add a destructor to deal with random number generator pointer
@@ -134,7 +222,7 @@ namespace opdet {
     opDetDigitizerSBND & operator = (opDetDigitizerSBND &&) = delete;
 
     // Required functions.
-    void produce(art::Event & e) override;
+    void produce(art::Event & e, art::ProcessingFrame const&) override;
 
     opdet::sbndPDMapAlg map; //map for photon detector types
     unsigned int nChannels = map.size();
@@ -142,20 +230,43 @@ namespace opdet {
 
   private:
     bool fApplyTriggers;
+    bool fTriggerFirst;
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
 
     bool fUseSimPhotonsLite;
+    bool fDropInputProducts;
     unsigned fPMTBaseline;
     unsigned fArapucaBaseline;
     unsigned fNThreads;
-    // digitizer workers
+    bool fRunOnJobThreads;
+    bool fCompactOutput;
+    // digitizer workers, with the settings shared by all the replicas
+    std::shared_ptr<opdet::opDetDigitizerWorker::Config const> fWorkerConfig;
     std::vector<opdet::opDetDigitizerWorker> fWorkers;
-    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms;
+    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms; // per channel
     std::vector<std::thread> fWorkerThreads;
+    // job threads the workers run on, with RunOnJobThreads
+    std::optional<sbnd::ThreadPool> fPool;
+    // digitizers of each worker, when they run on the job threads
+    std::vector<std::unique_ptr<opdet::DigiPMTSBNDAlg>> fPMTDigitizers;
+    std::vector<std::unique_ptr<opdet::DigiArapucaSBNDAlg>> fArapucaDigitizers;
+    detinfo::DetectorClocksData fJobClockData;
 
-    // product containers
-    std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> fPhotonLiteHandles;
-    std::vector<art::Handle<std::vector<sim::SimPhotons>>> fPhotonHandles;
+    // put the waveforms in the event, packed if CompactOutput
+    void PutWaveforms(art::Event& e, std::unique_ptr<std::vector<raw::OpDetWaveform>> waveforms) const;
+
+    // one pass of all the workers over the channels
+    void RunWorkers(opdet::opDetDigitizerWorker::Pass pass);
+    // find the trigger locations on the waveforms, each channel on its own
+    void FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                              detinfo::DetectorPropertiesData const& detProp);
+
+    // photons of all the input collections, by channel
+    opdet::PhotonLiteTable fPhotonLiteTable;
+    opdet::SimPhotonTable fPhotonTable;
+
+    // channels handed out to the workers
+    opdet::opDetDigitizerWorker::ChannelQueue fChannelQueue;
 
     // sync stuff
     opdet::opDetDigitizerWorker::Semaphore fSemStart;
@@ -166,17 +277,26 @@ namespace opdet {
     opdet::opDetSBNDTriggerAlg fTriggerAlg;
   };
 
-  opDetDigitizerSBND::opDetDigitizerSBND(Parameters const& config)
-    : EDProducer{config}
+  opDetDigitizerSBND::opDetDigitizerSBND(Parameters const& config, art::ProcessingFrame const& frame)
+    : ReplicatedProducer{config, frame}
     , fApplyTriggers(config().ApplyTriggers())
+    , fTriggerFirst(config().TriggerFirst() && config().ApplyTriggers())
     , fUseSimPhotonsLite(config().UseSimPhotonsLite())
+    , fDropInputProducts(config().DropInputProducts())
     , fPMTBaseline(config().pmtAlgoConfig().pmtbaseline())
     , fArapucaBaseline(config().araAlgoConfig().baseline())
+    , fJobClockData(art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob())
     , fTriggerAlg(config().trigAlgoConfig())
   {
-    opDetDigitizerWorker::Config wConfig( config().pmtAlgoConfig(), config().araAlgoConfig());
-
     fNThreads = config().NThreads();
+    fRunOnJobThreads = config().RunOnJobThreads();
+    fCompactOutput = config().CompactOutput();
+    if (fRunOnJobThreads) {
+      int const numaNode = config().PinNUMA() ?
+        sbnd::ThreadPool::NUMANode(frame.scheduleID().id()) : sbnd::ThreadPool::kNoNUMANode;
+      fPool.emplace(fNThreads, numaNode);
+      if (fNThreads == 0) fNThreads = fPool->Concurrency(); // as many as the job threads
+    }
     if (fNThreads == 0) { // autodetect -- first check env var
       const char *env = std::getenv("SBNDCODE_OPDETSIM_NTHREADS");
       // try to parse into positive integer
@@ -205,37 +325,55 @@ namespace opdet {
     }
     mf::LogInfo("OpDetDigitizer") << "Digitizing on n threads: " << fNThreads << std::endl;
 
-    wConfig.nThreads = fNThreads;
-
-    wConfig.UseSimPhotonsLite = config().UseSimPhotonsLite();
-    wConfig.InputModuleName = config().InputModuleName();
-
-    auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
+    auto const& clockData = fJobClockData;
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataForJob(clockData);
-    wConfig.Sampling = (clockData.OpticalClock().Frequency()) / 1000.0; //in GHz
-    wConfig.Sampling_Daphne =  config().araAlgoConfig().DaphneFrequency() / 1000.0; //in GHz
-    wConfig.EnableWindow = fTriggerAlg.TriggerEnableWindow(clockData, detProp); // us
-    wConfig.Nsamples = (wConfig.EnableWindow[1] - wConfig.EnableWindow[0]) * 1000. /*us -> ns*/ * wConfig.Sampling /* GHz */;
-    wConfig.Nsamples_Daphne = (wConfig.EnableWindow[1] - wConfig.EnableWindow[0]) * 1000. /*us -> ns*/ * wConfig.Sampling_Daphne /* GHz */;
+
+    // the settings (and the single photon templates read by the makers)
+    // are the same for all the replicas: the first one makes them
+    using WorkerConfig = opDetDigitizerWorker::Config;
+    fWorkerConfig = sbnd::ReplicaSharedState<WorkerConfig const>(
+      config.get_PSet().get<std::string>("module_label"), [&] {
+        auto wConfig = std::make_shared<WorkerConfig>(config().pmtAlgoConfig(), config().araAlgoConfig());
+
+        wConfig->nThreads = fNThreads;
+
+        wConfig->UseSimPhotonsLite = config().UseSimPhotonsLite();
+        wConfig->InputModuleName = config().InputModuleName();
+
+        wConfig->Sampling = (clockData.OpticalClock().Frequency()) / 1000.0; //in GHz
+        wConfig->Sampling_Daphne =  config().araAlgoConfig().DaphneFrequency() / 1000.0; //in GHz
+        wConfig->EnableWindow = fTriggerAlg.TriggerEnableWindow(clockData, detProp); // us
+        wConfig->Nsamples = (wConfig->EnableWindow[1] - wConfig->EnableWindow[0]) * 1000. /*us -> ns*/ * wConfig->Sampling /* GHz */;
+        wConfig->Nsamples_Daphne = (wConfig->EnableWindow[1] - wConfig->EnableWindow[0]) * 1000. /*us -> ns*/ * wConfig->Sampling_Daphne /* GHz */;
+        wConfig->PileUpTime = config().TriggerFirstPileUpTime();
+        wConfig->ReadoutMargin = config().TriggerFirstMargin();
+        return std::shared_ptr<WorkerConfig const>(std::move(wConfig));
+      });
+    WorkerConfig const& wConfig = *fWorkerConfig;
+
+    // engines of the replicas other than the first are told apart by the schedule
+    unsigned int const schedule = frame.scheduleID().id();
+    std::string const engineName = "opDetDigitizerSBND" + (schedule ? std::to_string(schedule) + "_" : std::string());
 
     fFinished = false;
 
     fWorkers.reserve(fNThreads);
-    fTriggeredWaveforms.reserve(fNThreads);
+    fTriggeredWaveforms.resize(nChannels);
     for (unsigned i = 0; i < fNThreads; i++) {
       // Set random number gen seed from the NuRandomService
       art::ServiceHandle<rndm::NuRandomService> seedSvc;
       CLHEP::HepJamesRandom *engine = new CLHEP::HepJamesRandom;
-      seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(engine), "opDetDigitizerSBND" + std::to_string(i));
-
-      fTriggeredWaveforms.emplace_back();
+      seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(engine), engineName + std::to_string(i));
 
       // setup worker
       fWorkers.emplace_back(i, wConfig, engine, fTriggerAlg);
-      fWorkers[i].SetPhotonLiteHandles(&fPhotonLiteHandles);
-      fWorkers[i].SetPhotonHandles(&fPhotonHandles);
+      fWorkers[i].SetPhotonLiteTable(&fPhotonLiteTable);
+      fWorkers[i].SetPhotonTable(&fPhotonTable);
       fWorkers[i].SetWaveformHandle(&fWaveforms);
-      fWorkers[i].SetTriggeredWaveformHandle(&fTriggeredWaveforms[i]);
+      fWorkers[i].SetTriggeredWaveformHandle(&fTriggeredWaveforms);
+      fWorkers[i].SetChannelQueue(&fChannelQueue);
+
+      if (fRunOnJobThreads) continue;
 
       // start worker thread
       fWorkerThreads.emplace_back(opdet::opDetDigitizerWorkerThread,
@@ -243,17 +381,22 @@ namespace opdet {
                                   clockData,
                                   std::ref(fSemStart),
                                   std::ref(fSemFinish),
-                                  fApplyTriggers,
                                   &fFinished);
     }
+    fPMTDigitizers.resize(fRunOnJobThreads ? fNThreads : 0);
+    fArapucaDigitizers.resize(fRunOnJobThreads ? fNThreads : 0);
 
     // Call appropriate produces<>() functions here.
-    produces< std::vector< raw::OpDetWaveform > >();
+    if (fCompactOutput)
+      produces< sbnd::CompactOpDetWaveforms >();
+    else
+      produces< std::vector< raw::OpDetWaveform > >();
   }
 
   opDetDigitizerSBND::~opDetDigitizerSBND()
   {
     // cleanup all of the workers
+    if (fWorkerThreads.empty()) return;
     fFinished = true;
     opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
 
@@ -262,8 +405,67 @@ namespace opdet {
 
   }
 
-  void opDetDigitizerSBND::produce(art::Event & e)
+  void opDetDigitizerSBND::RunWorkers(opdet::opDetDigitizerWorker::Pass pass)
+  {
+    fChannelQueue.pass = pass;
+    fChannelQueue.reset();
+
+    if (!fRunOnJobThreads) {
+      opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
+      opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+      return;
+    }
+
+    // one task for each worker; they take the channels from the same queue,
+    // so the pass is not held back when the pool gives it fewer threads
+    fPool->Execute([&] {
+      tbb::parallel_for(tbb::blocked_range<unsigned>(0, fNThreads, 1), [&](tbb::blocked_range<unsigned> const& range) {
+        for (unsigned i = range.begin(); i != range.end(); ++i) {
+          // the digitizers (and the files they load) are made on the first event, and kept
+          if (!fPMTDigitizers[i]) {
+            fArapucaDigitizers[i] = fWorkers[i].MakeArapucaDigitizer(fJobClockData);
+            fPMTDigitizers[i] = fWorkers[i].MakePMTDigitizer(fJobClockData);
+          }
+          fWorkers[i].Run(fPMTDigitizers[i].get(), fArapucaDigitizers[i].get(), fJobClockData);
+        }
+      }, tbb::simple_partitioner());
+    });
+  }
+
+  void opDetDigitizerSBND::FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                                                detinfo::DetectorPropertiesData const& detProp)
   {
+    tbb::parallel_for(std::size_t(0), fWaveforms.size(), [&](std::size_t i) {
+      const raw::OpDetWaveform &waveform = fWaveforms[i];
+      raw::Channel_t ch = waveform.ChannelNumber();
+      // skip light channels which don't correspond to readout channels
+      if (ch == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
+        return;
+      }
+      raw::ADC_Count_t baseline = (map.isPDType(ch, "pmt_uncoated") || map.isPDType(ch, "pmt_coated")) ?
+                                  fPMTBaseline : fArapucaBaseline;
+      fTriggerAlg.FindTriggerLocations(clockData, detProp, waveform, baseline);
+    });
+  }
+
+  void opDetDigitizerSBND::PutWaveforms(art::Event& e, std::unique_ptr<std::vector<raw::OpDetWaveform>> waveforms) const
+  {
+    if (!fCompactOutput) {
+      e.put(std::move(waveforms));
+      return;
+    }
+    size_t nSamples = 0;
+    for (raw::OpDetWaveform const& waveform : *waveforms) nSamples += waveform.size();
+    auto compact = std::make_unique<sbnd::CompactOpDetWaveforms>();
+    compact->reserve(waveforms->size(), nSamples);
+    for (raw::OpDetWaveform const& waveform : *waveforms) compact->Add(waveform);
+    e.put(std::move(compact));
+  }
+
+  void opDetDigitizerSBND::produce(art::Event & e, art::ProcessingFrame const&)
+  {
+    SBND_INSTR_SCOPE("opDetDigitizerSBND::produce");
+
     std::unique_ptr< std::vector< raw::OpDetWaveform > > pulseVecPtr(std::make_unique< std::vector< raw::OpDetWaveform > > ());
     // Implementation of required member function here.
     mf::LogInfo("opDetDigitizer") << "Event: " << e.id().event() << std::endl;
@@ -275,73 +477,100 @@ namespace opdet {
     auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e, clockData);
 
     if (fUseSimPhotonsLite) {
-      fPhotonLiteHandles.clear();
       //Get *ALL* SimPhotonsCollectionLite from Event
-      fPhotonLiteHandles = e.getMany<std::vector<sim::SimPhotonsLite>>();
-      if (fPhotonLiteHandles.size() == 0)
+      auto photonLiteHandles = e.getMany<std::vector<sim::SimPhotonsLite>>();
+      if (photonLiteHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotonsLite not found -> No Optical Detector Simulation!\n";
+      opdet::FillPhotonTable(photonLiteHandles, nChannels, fPhotonLiteTable);
+      sbnd::perf::Count("Photons", CountPhotons(fPhotonLiteTable));
+      // the workers only read the table from here on
+      if (fDropInputProducts)
+        for (auto &handle : photonLiteHandles) handle.removeProduct();
     }
     else {
-      fPhotonHandles.clear();
       //Get *ALL* SimPhotonsCollection from Event
-      fPhotonHandles = e.getMany<std::vector<sim::SimPhotons>>();
-      if (fPhotonHandles.size() == 0)
+      auto photonHandles = e.getMany<std::vector<sim::SimPhotons>>();
+      if (photonHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotons not found -> No Optical Detector Simulation!\n";
+      opdet::FillPhotonTable(photonHandles, nChannels, fPhotonTable);
+      sbnd::perf::Count("Photons", CountPhotons(fPhotonTable));
+      if (fDropInputProducts)
+        for (auto &handle : photonHandles) handle.removeProduct();
     }
-    // Start the workers!
-    // Run the digitizer over the full readout window
-    opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
-    opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+    // the random numbers of each channel are seeded from this, so they do not
+    // depend on the number of threads or on which one digitizes the channel
+    fChannelQueue.EventSeed = CLHEP::RandFlat::shootInt(&fWorkers[0].Engine(), 900000000L);
 
-    if (fApplyTriggers) {
-      // find the trigger locations for the waveforms
-      for (const raw::OpDetWaveform &waveform : fWaveforms) {
-        raw::Channel_t ch = waveform.ChannelNumber();
-        // skip light channels which don't correspond to readout channels
-        if (ch == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
-          continue;
-        }
-        raw::ADC_Count_t baseline = (map.isPDType(ch, "pmt_uncoated") || map.isPDType(ch, "pmt_coated")) ?
-                                    fPMTBaseline : fArapucaBaseline;
-        fTriggerAlg.FindTriggerLocations(clockData, detProp, waveform, baseline);
-      }
+    using Pass = opdet::opDetDigitizerWorker::Pass;
+
+    if (fTriggerFirst) {
+      SBND_INSTR_SCOPE("opDetDigitizerSBND::TriggerFirst");
 
-      // combine the triggers
+      // estimate the waveforms from the photons, and trigger on them
+      RunWorkers(Pass::Estimate);
+      FindTriggerLocations(clockData, detProp);
       fTriggerAlg.MergeTriggerLocations();
+
+      // digitize around the readout windows only, and crop to them
+      RunWorkers(Pass::DigitizeReadout);
+    }
+    else {
       // Start the workers!
-      // Apply the trigger locations
-      opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
-      opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+      // Run the digitizer over the full readout window
+      {
+        SBND_INSTR_SCOPE("opDetDigitizerSBND::Digitize");
+        RunWorkers(Pass::Digitize);
+      }
 
+      if (fApplyTriggers) {
+        SBND_INSTR_SCOPE("opDetDigitizerSBND::ApplyTriggers");
+
+        // find the trigger locations for the waveforms, each channel on its own
+        FindTriggerLocations(clockData, detProp);
+
+        // combine the triggers
+        fTriggerAlg.MergeTriggerLocations();
+        // Start the workers!
+        // Apply the trigger locations
+        RunWorkers(Pass::ApplyTriggerLocations);
+      }
+    }
+
+    if (fApplyTriggers) {
+
+      // move these waveforms into the pulseVecPtr, in channel order
+      size_t nTriggered = 0;
+      for (std::vector<raw::OpDetWaveform> const& waveforms : fTriggeredWaveforms) nTriggered += waveforms.size();
+      pulseVecPtr->reserve(nTriggered);
+      SBND_INSTR_COUNT("opDetDigitizerSBND::Waveforms", nTriggered);
+      sbnd::perf::Count("Waveforms", nTriggered);
       for (std::vector<raw::OpDetWaveform> &waveforms : fTriggeredWaveforms) {
-        // move these waveforms into the pulseVecPtr
-        pulseVecPtr->reserve(pulseVecPtr->size() + waveforms.size());
         std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*pulseVecPtr));
-      }
-      // clean up the vector
-      for (unsigned i = 0; i < fTriggeredWaveforms.size(); i++) {
-        fTriggeredWaveforms[i] = std::vector<raw::OpDetWaveform>();
+        // clean up the vector, keeping its capacity for the next event
+        waveforms.clear();
       }
 
       // put the waveforms in the event
-      e.put(std::move(pulseVecPtr));
+      PutWaveforms(e, std::move(pulseVecPtr));
       // clear out the triggers
       fTriggerAlg.ClearTriggerLocations();
 
     }
     else {
       // put the full waveforms in the event
-      for (const raw::OpDetWaveform &waveform : fWaveforms) {
+      for (raw::OpDetWaveform &waveform : fWaveforms) {
         if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
           continue;
         }
-        pulseVecPtr->push_back(waveform);
+        pulseVecPtr->push_back(std::move(waveform));
       }
-      e.put(std::move(pulseVecPtr));
+      PutWaveforms(e, std::move(pulseVecPtr));
     }
 
     // clear out the full waveforms
     fWaveforms.clear();
+    fPhotonLiteTable.clear();
+    fPhotonTable.clear();
 
   }//produce end
 
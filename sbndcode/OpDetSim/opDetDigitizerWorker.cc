@@ -1,5 +1,9 @@
 // TODO: plenty of refactoring potential in here! ~icaza
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
 #include "larcore/CoreUtils/ServiceUtil.h"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
 
@@ -22,24 +26,22 @@ void opdet::opDetDigitizerWorkerThread(const opdet::opDetDigitizerWorker &worker
                                        detinfo::DetectorClocksData const& clockData,
                                        opdet::opDetDigitizerWorker::Semaphore &sem_start,
                                        opdet::opDetDigitizerWorker::Semaphore &sem_finish,
-                                       bool ApplyTriggerLocations,
                                        bool *finished)
 {
+  // the digitizers (and the files they load) are made on the first event, and kept
+  std::unique_ptr<opdet::DigiPMTSBNDAlg> pmtDigitizer;
+  std::unique_ptr<opdet::DigiArapucaSBNDAlg> arapucaDigitizer;
 
-  bool do_apply_trigger_locations = false;
   while (1) {
     sem_start.decrement();
 
     if (*finished) break;
 
-    if (do_apply_trigger_locations) {
-      worker.ApplyTriggerLocations(clockData);
-      do_apply_trigger_locations = false;
-    }
-    else {
-      worker.Start(clockData);
-      do_apply_trigger_locations = ApplyTriggerLocations;
+    if (!pmtDigitizer) {
+      arapucaDigitizer = worker.MakeArapucaDigitizer(clockData);
+      pmtDigitizer = worker.MakePMTDigitizer(clockData);
     }
+    worker.Run(pmtDigitizer.get(), arapucaDigitizer.get(), clockData);
 
     sem_finish.increment();
   }
@@ -75,33 +77,111 @@ void opdet::opDetDigitizerWorker::Semaphore::decrement(unsigned n)
   count -= n;
 }
 
-unsigned opdet::opDetDigitizerWorker::NChannelsToProcess(unsigned n) const
+unsigned opdet::opDetDigitizerWorker::NextChannel() const
 {
-  return (n + fConfig.nThreads - fThreadNo - 1) / fConfig.nThreads;
+  return std::min(fQueue->next.fetch_add(1, std::memory_order_relaxed), fConfig.nChannels);
 }
 
-unsigned opdet::opDetDigitizerWorker::StartChannelToProcess(unsigned n) const
+void opdet::opDetDigitizerWorker::SeedChannel(unsigned ch) const
 {
-  unsigned n_per_job = n / fConfig.nThreads;
-  unsigned leftover = std::min(fThreadNo, n % fConfig.nThreads);
-  return n_per_job * fThreadNo + leftover;
+  // splitmix64 of the event seed and the channel, in the range accepted by HepJamesRandom
+  std::uint64_t z = (std::uint64_t(fQueue->EventSeed) << 32) + ch + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  fEngine->setSeed(long(z % 900000000ULL), 0);
 }
 
-void opdet::opDetDigitizerWorker::Start(detinfo::DetectorClocksData const& clockData) const
+std::unique_ptr<opdet::DigiPMTSBNDAlg>
+opdet::opDetDigitizerWorker::MakePMTDigitizer(detinfo::DetectorClocksData const& clockData) const
 {
-  auto arapucaDigitizer = fConfig.makeArapucaDigi(
+  return fConfig.makePMTDigi(
+                        *(lar::providerFrom<detinfo::LArPropertiesService>()),
+                        clockData,
+                        fEngine
+                      );
+}
+
+std::unique_ptr<opdet::DigiArapucaSBNDAlg>
+opdet::opDetDigitizerWorker::MakeArapucaDigitizer(detinfo::DetectorClocksData const& clockData) const
+{
+  return fConfig.makeArapucaDigi(
                             *(lar::providerFrom<detinfo::LArPropertiesService>()),
                             clockData,
                             fEngine
                           );
+}
 
-  auto pmtDigitizer = fConfig.makePMTDigi(
-                        *(lar::providerFrom<detinfo::LArPropertiesService>()),
-                        clockData,
-                        fEngine
-                      );
-  MakeWaveforms(pmtDigitizer.get(), arapucaDigitizer.get());
+void opdet::opDetDigitizerWorker::Run(opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                      opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+                                      detinfo::DetectorClocksData const& clockData) const
+{
+  switch (fQueue->pass) {
+    case Pass::Digitize:              Start(pmtDigitizer, arapucaDigitizer); break;
+    case Pass::ApplyTriggerLocations: ApplyTriggerLocations(clockData); break;
+    case Pass::Estimate:              Estimate(pmtDigitizer, arapucaDigitizer); break;
+    case Pass::DigitizeReadout:       DigitizeReadout(pmtDigitizer, arapucaDigitizer, clockData); break;
+  }
+}
 
+void opdet::opDetDigitizerWorker::Start(opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                        opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
+{
+  for (unsigned ch = NextChannel(); ch < fConfig.nChannels; ch = NextChannel()) {
+    SeedChannel(ch);
+    if (fConfig.UseSimPhotonsLite)
+      MakeWaveformLite(ch, pmtDigitizer, arapucaDigitizer, fConfig.EnableWindow);
+    else
+      MakeWaveform(ch, pmtDigitizer, arapucaDigitizer, fConfig.EnableWindow);
+  }
+}
+
+void opdet::opDetDigitizerWorker::Estimate(opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                           opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
+{
+  for (unsigned ch = NextChannel(); ch < fConfig.nChannels; ch = NextChannel()) {
+    MakeEstimate(ch, pmtDigitizer, arapucaDigitizer);
+  }
+}
+
+void opdet::opDetDigitizerWorker::DigitizeReadout(opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                                  opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+                                                  detinfo::DetectorClocksData const& clockData) const
+{
+  for (unsigned ch = NextChannel(); ch < fConfig.nChannels; ch = NextChannel()) {
+    raw::OpDetWaveform &waveform = (*fWaveforms)[ch];
+    // the estimate is not needed any more
+    waveform = raw::OpDetWaveform();
+
+    std::array<double, 2> readout;
+    if (!fTriggerAlg.ReadoutRange(ch, readout)) continue;
+
+    // digitize from a little before the first window to a little after the last one,
+    // on the same samples as the full window; photons before the start are lost,
+    // so the margin has to cover the length of their pulses
+    const double period = 1. / ((DaphneSampled(ch) ? fConfig.Sampling_Daphne : fConfig.Sampling) * 1000.); // us
+    const double start = std::max(readout[0] - fConfig.ReadoutMargin, fConfig.EnableWindow[0]);
+    const double end = std::min(readout[1] + fConfig.ReadoutMargin, fConfig.EnableWindow[1]);
+    if (end <= start) continue;
+    const std::array<double, 2> window{{
+      fConfig.EnableWindow[0] + std::floor((start - fConfig.EnableWindow[0]) / period) * period,
+      end
+    }};
+
+    SeedChannel(ch);
+    if (fConfig.UseSimPhotonsLite)
+      MakeWaveformLite(ch, pmtDigitizer, arapucaDigitizer, window);
+    else
+      MakeWaveform(ch, pmtDigitizer, arapucaDigitizer, window);
+    if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
+      continue;
+    }
+
+    std::vector<raw::OpDetWaveform> &triggered = (*fTriggeredWaveforms)[ch];
+    triggered.clear();
+    fTriggerAlg.ApplyTriggerLocations(clockData, waveform, triggered);
+    waveform = raw::OpDetWaveform();
+  }
 }
 
 opdet::opDetDigitizerWorker::~opDetDigitizerWorker()
@@ -111,309 +191,277 @@ opdet::opDetDigitizerWorker::~opDetDigitizerWorker()
 
 void opdet::opDetDigitizerWorker::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const
 {
-  unsigned start = StartChannelToProcess(fConfig.nChannels);
-  unsigned n = NChannelsToProcess(fConfig.nChannels);
-
-  fTriggeredWaveforms->clear();
-
   // apply the triggers and save the output
-  for (const raw::OpDetWaveform &waveform : *fWaveforms){
+  for (unsigned ch = NextChannel(); ch < fConfig.nChannels; ch = NextChannel()) {
+    raw::OpDetWaveform &waveform = (*fWaveforms)[ch];
     if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
       continue;
     }
-    // only work on the prescribed channels
-    if (waveform.ChannelNumber() < start || waveform.ChannelNumber() >= start + n) continue;
-
-    std::vector<raw::OpDetWaveform> waveforms = fTriggerAlg.ApplyTriggerLocations(clockData, waveform);
 
-    std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*fTriggeredWaveforms));
+    std::vector<raw::OpDetWaveform> &triggered = (*fTriggeredWaveforms)[ch];
+    triggered.clear();
+    fTriggerAlg.ApplyTriggerLocations(clockData, waveform, triggered);
+    // the full waveform is not needed any more
+    waveform = raw::OpDetWaveform();
   }
 }
 
-void opdet::opDetDigitizerWorker::MakeWaveforms(opdet::DigiPMTSBNDAlg *pmtDigitizer,
-                                                opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
+void opdet::FillPhotonTable(const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> &photon_handles,
+                            unsigned nChannels,
+                            opdet::PhotonLiteTable &table)
 {
-  if(fConfig.UseSimPhotonsLite) {
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> &photon_handles = *fPhotonLiteHandles;
-
-    // TODO: Instead of looping and evaluating if/else through all the photon_handles
-    // we should get smaller containers with only the relevant handles for each case
-    // ~icaza
-    // std::vector<art::Handle<std::vector<sim::SimPhotonsLite>> const*> ptr_photon_handles(photon_handles.size());
-    // std::transform(photon_handles.begin(), photon_handles.end(), ptr_photon_handles.begin(),
-    //                [](auto& p) {return std::addressof(p);});
-
-    // to temporarily store channel and combine PMT (direct and converted) time profiles
-
-
-    //need to combine direct and reflected photons
-    std::unordered_map<std::string, std::unordered_map<int, sim::SimPhotonsLite> > AllPhotonsMap;
-    AllPhotonsMap["Direct"] = std::unordered_map<int, sim::SimPhotonsLite>();
-    AllPhotonsMap["Reflected"] = std::unordered_map<int, sim::SimPhotonsLite>();
-    for (const art::Handle<std::vector<sim::SimPhotonsLite>> &opdetHandle : photon_handles) {
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& litesimphotons : (*opdetHandle)){
-
-        if(Reflected){
-          auto it = AllPhotonsMap["Reflected"].find(litesimphotons.OpChannel);
-          if(it==AllPhotonsMap["Reflected"].end())
-            AllPhotonsMap["Reflected"][litesimphotons.OpChannel] = litesimphotons;
-          else
-            AllPhotonsMap["Reflected"][litesimphotons.OpChannel] += litesimphotons;
-        }
-
-        else{ //Direct
-          auto it = AllPhotonsMap["Direct"].find(litesimphotons.OpChannel);
-          if(it==AllPhotonsMap["Direct"].end())
-            AllPhotonsMap["Direct"][litesimphotons.OpChannel] = litesimphotons;
-          else
-            AllPhotonsMap["Direct"][litesimphotons.OpChannel] += litesimphotons;
-        }
-      }
+  table.Reset(nChannels);
+  for (const art::Handle<std::vector<sim::SimPhotonsLite>> &opdetHandle : photon_handles) {
+    const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+    for (auto const& litesimphotons : (*opdetHandle)){
+      if ((unsigned) litesimphotons.OpChannel >= nChannels) continue;
+      table.Count(Reflected, litesimphotons.OpChannel, litesimphotons.DetectedPhotons.size());
+    }
+  }
+  table.Allocate();
+  for (const art::Handle<std::vector<sim::SimPhotonsLite>> &opdetHandle : photon_handles) {
+    const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+    for (auto const& litesimphotons : (*opdetHandle)){
+      if ((unsigned) litesimphotons.OpChannel >= nChannels) continue;
+      table.Insert(Reflected, litesimphotons.OpChannel,
+                   litesimphotons.DetectedPhotons.begin(), litesimphotons.DetectedPhotons.end());
     }
+  }
 
-    const double startTime = fConfig.EnableWindow[0] * 1000. /*ns for digitizer*/;
-
-    std::unordered_map<int, sim::SimPhotonsLite> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotonsLite> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
-    // XARAPUCAs
-    std::unordered_map<int, sim::SimPhotonsLite> XADirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotonsLite> XAReflectedPhotonsMap;
-    std::unordered_set<short unsigned int>   vuvxarapucas_todigitize; //sensible to both VUV and visible light
-
-
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (auto const& simphotons_cols : AllPhotonsMap){
-      // this now tells you if light collection is reflected
-      const bool Reflected = (simphotons_cols.first=="Reflected");
-      for (auto const& simphotons_map : simphotons_cols.second) {
-
-        auto const& litesimphotons = simphotons_map.second;
-
-        std::vector<short unsigned int> waveform;
-        waveform.reserve(fConfig.Nsamples);
-        const unsigned ch = litesimphotons.OpChannel;
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-
-
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-
-          coatedpmts_todigitize.insert(ch);
-        }
-        else if( pdtype == "xarapuca_vuv" ){
-          if(Reflected)
-            XAReflectedPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-          else
-            XADirectPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-
-          vuvxarapucas_todigitize.insert(ch);
-        }
-        else if( (Reflected) && (pdtype == "pmt_uncoated") ) { //Uncoated PMT channels
-          pmtDigitizer->ConstructWaveformLiteUncoatedPMT(ch,
-                                              litesimphotons,
-                                              waveform,
-                                              pdtype,
-                                              startTime,
-                                              fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-      	}
-        // getting only xarapuca channels with appropriate type of light
-        else if( (pdtype == "xarapuca_vis" && Reflected) ) {
-          const bool is_daphne= fConfig.pdsMap.isElectronics(ch,"daphne");
-          if(is_daphne){
-            arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
-                                                  waveform,
-                                                  pdtype,
-                                                  is_daphne,
-                                                  startTime,
-                                                  fConfig.Nsamples_Daphne);
-            // including pre trigger window and transit time
-            fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-            }
-            else{
-            arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
-                                                  waveform,
-                                                  pdtype,
-                                                  is_daphne,
-                                                  startTime,
-                                                  fConfig.Nsamples);
-            // including pre trigger window and transit time
-            fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-          }
-        }
-      }
-    }  //end loop on simphoton lite collections
-
-    //Constructing Waveforms for hybrid OpChannels (coated pmts)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformLiteCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
+  // a channel in more than one collection is summed by time, as SimPhotonsLite::operator+= does
+  auto const earlier = [](opdet::PhotonLiteEntry_t const& a, opdet::PhotonLiteEntry_t const& b)
+                       { return a.first < b.first; };
+  table.CompactRows([&earlier](opdet::PhotonLiteEntry_t *first, opdet::PhotonLiteEntry_t *last) {
+    if (!std::is_sorted(first, last, earlier)) std::stable_sort(first, last, earlier);
+    opdet::PhotonLiteEntry_t *out = first;
+    for (opdet::PhotonLiteEntry_t *it = first; it != last; ++it) {
+      if (out != first && (out - 1)->first == it->first) (out - 1)->second += it->second;
+      else *out++ = *it;
     }
-    //VUV XAs, sensible to VUV and visible light
-    for(auto ch : vuvxarapucas_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples_Daphne);
-      arapucaDigitizer->ConstructWaveformLiteVUVXA(ch, waveform, XADirectPhotonsMap, XAReflectedPhotonsMap, startTime, fConfig.Nsamples_Daphne);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
+    return out;
+  });
+}
+
+void opdet::FillPhotonTable(const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles,
+                            unsigned nChannels,
+                            opdet::SimPhotonTable &table)
+{
+  // a channel in more than one collection gets the photons of all of them, in collection order
+  table.Reset(nChannels);
+  for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
+    const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+    for (auto const& simphotons : (*opdetHandle)){
+      if ((unsigned) simphotons.OpChannel() >= nChannels) continue;
+      table.Count(Reflected, simphotons.OpChannel(), simphotons.size());
     }
   }
-  else { // for SimPhotons
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles = *fPhotonHandles;
-
-    //need to combine direct and reflected photons
-    std::unordered_map<std::string, std::unordered_map<int, sim::SimPhotons> > AllPhotonsMap;
-    AllPhotonsMap["Direct"] = std::unordered_map<int, sim::SimPhotons>();
-    AllPhotonsMap["Reflected"] = std::unordered_map<int, sim::SimPhotons>();
-    for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& simphotons : (*opdetHandle)){
-
-        if(Reflected){
-          auto it = AllPhotonsMap["Reflected"].find(simphotons.OpChannel());
-          if(it==AllPhotonsMap["Reflected"].end())
-            AllPhotonsMap["Reflected"][simphotons.OpChannel()] = simphotons;
-          else
-            AllPhotonsMap["Reflected"][simphotons.OpChannel()] += simphotons;
-        }
-
-        else{ //Direct
-          auto it = AllPhotonsMap["Direct"].find(simphotons.OpChannel());
-          if(it==AllPhotonsMap["Direct"].end())
-            AllPhotonsMap["Direct"][simphotons.OpChannel()] = simphotons;
-          else
-            AllPhotonsMap["Direct"][simphotons.OpChannel()] += simphotons;
-        }
-      }
+  table.Allocate();
+  for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
+    const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
+    for (auto const& simphotons : (*opdetHandle)){
+      if ((unsigned) simphotons.OpChannel() >= nChannels) continue;
+      table.Insert(Reflected, simphotons.OpChannel(), simphotons.begin(), simphotons.end());
     }
+  }
+}
+
+void opdet::opDetDigitizerWorker::MakeWaveformLite(unsigned ch,
+                                                   opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                                   opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+                                                   std::array<double, 2> const& window) const
+{
+  // shared by all the workers, read only
+  const opdet::PhotonLiteSpan direct = fPhotonLiteTable->Direct(ch);
+  const opdet::PhotonLiteSpan reflected = fPhotonLiteTable->Reflected(ch);
+  const bool hasReflected = !reflected.empty();
+  if (direct.empty() && !hasReflected) return;
+
+  const double startTime = window[0] * 1000. /*ns for digitizer*/;
+  const unsigned nSamples = NSamples(ch, window);
+  const std::string pdtype = fConfig.pdsMap.pdType(ch);
+
+  std::vector<short unsigned int> waveform;
+  //Constructing Waveforms for hybrid OpChannels (coated pmts)
+  if( pdtype == "pmt_coated" ){
+    waveform.reserve(nSamples);
+    pmtDigitizer->ConstructWaveformLiteCoatedPMT(ch, waveform, direct, reflected, startTime, nSamples);
+  }
+  //VUV XAs, sensible to VUV and visible light
+  else if( pdtype == "xarapuca_vuv" ){
+    waveform.reserve(nSamples);
+    arapucaDigitizer->ConstructWaveformLiteVUVXA(ch, waveform, direct, reflected, startTime, nSamples);
+  }
+  else if( hasReflected && (pdtype == "pmt_uncoated") ) { //Uncoated PMT channels
+    waveform.reserve(nSamples);
+    pmtDigitizer->ConstructWaveformLiteUncoatedPMT(ch,
+                                          reflected,
+                                          waveform,
+                                          pdtype,
+                                          startTime,
+                                          nSamples);
+  }
+  // getting only xarapuca channels with appropriate type of light
+  else if( hasReflected && (pdtype == "xarapuca_vis") ) {
+    const bool is_daphne= fConfig.pdsMap.isElectronics(ch,"daphne");
+    waveform.reserve(nSamples);
+    arapucaDigitizer->ConstructWaveformLite(ch,
+                                          reflected,
+                                          waveform,
+                                          pdtype,
+                                          is_daphne,
+                                          startTime,
+                                          nSamples);
+  }
+  else return;
 
+  // including pre trigger window and transit time
+  fWaveforms->at(ch) = raw::OpDetWaveform(window[0],
+                                          (unsigned int)ch,
+                                          waveform);
+}
 
-    // to temporarily store channel and direct light distribution
-    std::unordered_map<int, sim::SimPhotons> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotons> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
-    // XARAPUCAs
-    std::unordered_map<int, sim::SimPhotons> XADirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotons> XAReflectedPhotonsMap;
-    std::unordered_set<short unsigned int>   vuvxarapucas_todigitize; //sensible to both VUV and visible light
-
-    const double startTime = fConfig.EnableWindow[0] * 1000. /*ns for digitizer*/;
-
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (auto const& simphotons_cols : AllPhotonsMap){
-      // this now tells you if light collection is reflected
-      const bool Reflected = (simphotons_cols.first=="Reflected");
-      for (auto const& simphotons_map : simphotons_cols.second) {
-
-        auto const& simphotons = simphotons_map.second;
-
-        std::vector<short unsigned int> waveform;
-        const unsigned ch = simphotons.OpChannel();
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-        const bool is_daphne = fConfig.pdsMap.isElectronics(ch,"daphne");
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-        //coated PMTs
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, simphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, simphotons));
-
-          coatedpmts_todigitize.insert(ch);
-        }
-        // uncoated PMTs
-        else if(Reflected && pdtype == "pmt_uncoated") {
-          pmtDigitizer->ConstructWaveformUncoatedPMT(ch,
-                                          simphotons,
+void opdet::opDetDigitizerWorker::MakeWaveform(unsigned ch,
+                                               opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                               opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+                                               std::array<double, 2> const& window) const
+{
+  // shared by all the workers, read only
+  const opdet::SimPhotonSpan direct = fPhotonTable->Direct(ch);
+  const opdet::SimPhotonSpan reflected = fPhotonTable->Reflected(ch);
+  const bool hasReflected = !reflected.empty();
+  if (direct.empty() && !hasReflected) return;
+
+  const double startTime = window[0] * 1000. /*ns for digitizer*/;
+  const unsigned nSamples = NSamples(ch, window);
+  const std::string pdtype = fConfig.pdsMap.pdType(ch);
+
+  std::vector<short unsigned int> waveform;
+  //Constructing Waveforms for hybrid OpChannels (coated pmts and VUV XAs)
+  if( pdtype == "pmt_coated" ){
+    waveform.reserve(nSamples);
+    pmtDigitizer->ConstructWaveformCoatedPMT(ch, waveform, direct, reflected, startTime, nSamples);
+  }
+  else if( pdtype == "xarapuca_vuv" ){
+    waveform.reserve(nSamples);
+    arapucaDigitizer->ConstructWaveformVUVXA(ch, waveform, direct, reflected, startTime, nSamples);
+  }
+  // uncoated PMTs
+  else if( hasReflected && pdtype == "pmt_uncoated" ) {
+    pmtDigitizer->ConstructWaveformUncoatedPMT(ch,
+                                          reflected,
                                           waveform,
                                           pdtype,
                                           startTime,
-                                          fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-        if( pdtype == "xarapuca_vuv" ){
-          if(Reflected)
-            XAReflectedPhotonsMap.insert(std::make_pair(ch, simphotons));
-          else
-            XADirectPhotonsMap.insert(std::make_pair(ch, simphotons));
-
-          vuvxarapucas_todigitize.insert(ch);
-        }
-        // getting only xarapuca channels with appropriate type of light
-        if((pdtype == "xarapuca_vis" && Reflected)) {
-          if(is_daphne){
-          arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
-                                              waveform,
-                                              pdtype,
-                                              is_daphne,
-                                              startTime,
-                                              fConfig.Nsamples_Daphne);
-            // including pre trigger window and transit time
-            fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                    (unsigned int)ch,
-                                                  waveform);
-            }
-            else{
-              arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
-                                              waveform,
-                                              pdtype,
-                                              is_daphne,
-                                              startTime,
-                                              fConfig.Nsamples);
-              // including pre trigger window and transit time
-              fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-          }
-        }
-      }//optical channel loop
-    }//type of light loop
-    //Constructing Waveforms for hybrid OpChannels (coated pmts and VUV XAs)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
-    }
-    for(auto ch : vuvxarapucas_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples_Daphne);
-      arapucaDigitizer->ConstructWaveformVUVXA(ch, waveform, XADirectPhotonsMap, XAReflectedPhotonsMap, startTime, fConfig.Nsamples_Daphne);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
+                                          nSamples);
+  }
+  // getting only xarapuca channels with appropriate type of light
+  else if( hasReflected && pdtype == "xarapuca_vis" ) {
+    const bool is_daphne = fConfig.pdsMap.isElectronics(ch,"daphne");
+    arapucaDigitizer->ConstructWaveform(ch,
+                                        reflected,
+                                        waveform,
+                                        pdtype,
+                                        is_daphne,
+                                        startTime,
+                                        nSamples);
+  }
+  else return;
+
+  // including pre trigger window and transit time
+  fWaveforms->at(ch) = raw::OpDetWaveform(window[0],
+                                          (unsigned int)ch,
+                                          waveform);
+}
+
+bool opdet::opDetDigitizerWorker::DaphneSampled(unsigned ch) const
+{
+  const std::string pdtype = fConfig.pdsMap.pdType(ch);
+  if (pdtype == "xarapuca_vuv") return true;
+  return pdtype == "xarapuca_vis" && fConfig.pdsMap.isElectronics(ch, "daphne");
+}
+
+unsigned opdet::opDetDigitizerWorker::NSamples(unsigned ch, std::array<double, 2> const& window) const
+{
+  const bool daphne = DaphneSampled(ch);
+  if (window == fConfig.EnableWindow) return daphne ? fConfig.Nsamples_Daphne : fConfig.Nsamples;
+  return (window[1] - window[0]) * 1000. /*us -> ns*/ * (daphne ? fConfig.Sampling_Daphne : fConfig.Sampling) /* GHz */;
+}
+
+namespace {
+
+  // expected pe of the photons, by sample of the waveform starting at startTime (ns)
+  template <class Span, class Time, class Count>
+  void AddExpectedPE(std::vector<float> &pe, Span photons, double efficiency,
+                     double startTime, double period, Time time, Count count)
+  {
+    if (efficiency <= 0.) return;
+    for (auto const& photon : photons) {
+      const double sample = (time(photon) - startTime) / period;
+      if (sample < 0. || sample >= pe.size()) continue;
+      pe[(size_t)sample] += efficiency * count(photon);
     }
-  }//simphotons end
+  }
+
+} // local namespace
+
+void opdet::opDetDigitizerWorker::MakeEstimate(unsigned ch,
+                                               opdet::DigiPMTSBNDAlg *pmtDigitizer,
+                                               opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
+{
+  // the same channels as MakeWaveform(Lite): direct light only counts on the hybrid ones
+  const std::string pdtype = fConfig.pdsMap.pdType(ch);
+  const bool isPMT = (pdtype == "pmt_coated" || pdtype == "pmt_uncoated");
+  if (!isPMT && pdtype != "xarapuca_vuv" && pdtype != "xarapuca_vis") return;
+
+  bool hasPhotons = false;
+  if (fConfig.UseSimPhotonsLite) {
+    hasPhotons = !fPhotonLiteTable->Reflected(ch).empty()
+      || ((pdtype == "pmt_coated" || pdtype == "xarapuca_vuv") && !fPhotonLiteTable->Direct(ch).empty());
+  }
+  else {
+    hasPhotons = !fPhotonTable->Reflected(ch).empty()
+      || ((pdtype == "pmt_coated" || pdtype == "xarapuca_vuv") && !fPhotonTable->Direct(ch).empty());
+  }
+  if (!hasPhotons) return;
+
+  // mean response of the detector: no fluctuation, noise or single pe shape,
+  // just the expected pe in a pile up time times the single pe height
+  const bool daphne = DaphneSampled(ch);
+  const double period = 1. / (daphne ? fConfig.Sampling_Daphne : fConfig.Sampling); // ns
+  const double startTime = fConfig.EnableWindow[0] * 1000. - (isPMT ? pmtDigitizer->PhotonDelay() : 0.);
+  const double directEff = isPMT ? pmtDigitizer->DetectionEfficiency(pdtype, false)
+                                 : arapucaDigitizer->DetectionEfficiency(pdtype, false);
+  const double reflectedEff = isPMT ? pmtDigitizer->DetectionEfficiency(pdtype, true)
+                                    : arapucaDigitizer->DetectionEfficiency(pdtype, true);
+  const double height = isPMT ? pmtDigitizer->SinglePEHeight() : arapucaDigitizer->SinglePEHeight(daphne);
+  const double baseline = isPMT ? pmtDigitizer->Baseline() : arapucaDigitizer->Baseline();
+
+  std::vector<float> pe(NSamples(ch, fConfig.EnableWindow), 0.);
+  if (fConfig.UseSimPhotonsLite) {
+    auto const time = [](opdet::PhotonLiteEntry_t const& p) { return double(p.first); };
+    auto const count = [](opdet::PhotonLiteEntry_t const& p) { return double(p.second); };
+    AddExpectedPE(pe, fPhotonLiteTable->Direct(ch), directEff, startTime, period, time, count);
+    AddExpectedPE(pe, fPhotonLiteTable->Reflected(ch), reflectedEff, startTime, period, time, count);
+  }
+  else {
+    auto const time = [](sim::OnePhoton const& p) { return p.Time; };
+    auto const count = [](sim::OnePhoton const&) { return 1.; };
+    AddExpectedPE(pe, fPhotonTable->Direct(ch), directEff, startTime, period, time, count);
+    AddExpectedPE(pe, fPhotonTable->Reflected(ch), reflectedEff, startTime, period, time, count);
+  }
+
+  // running sum over the pile up time, to the ADC counts
+  const size_t nPileUp = std::max<size_t>(1, std::lround(fConfig.PileUpTime / period));
+  std::vector<short unsigned int> waveform(pe.size());
+  double sum = 0.;
+  for (size_t i = 0; i < pe.size(); i++) {
+    sum += pe[i];
+    if (i >= nPileUp) sum -= pe[i - nPileUp];
+    const double adc = baseline + height * std::max(sum, 0.);
+    waveform[i] = (short unsigned int) std::clamp(std::lround(adc), 0L, 65535L);
+  }
+
+  fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
+                                          (unsigned int)ch,
+                                          waveform);
 }
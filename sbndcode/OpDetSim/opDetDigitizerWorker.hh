@@ -8,16 +8,19 @@
 #ifndef SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 #define SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 
+#include <array>
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
-// #include <memory>
+#include <memory>
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
 #include "sbndcode/OpDetSim/DigiArapucaSBNDAlg.hh"
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
+#include "sbndcode/OpDetSim/PhotonTable.hh"
 namespace detinfo {
   class DetectorClocksData;
 }
@@ -46,6 +49,10 @@ namespace opdet {
       unsigned int Nsamples; //Samples per waveform
       unsigned int Nsamples_Daphne; //Samples per waveform
 
+      // trigger first mode
+      double PileUpTime;    // photons summed into the estimated pulse height (ns)
+      double ReadoutMargin; // digitized on each side of the readout windows (us)
+
       Config(const opdet::DigiPMTSBNDAlgMaker::Config &pmt_config, const opdet::DigiArapucaSBNDAlgMaker::Config &arapuca_config);
     };
 
@@ -61,39 +68,92 @@ namespace opdet {
       unsigned count;
     };
 
+    // What the workers do with each channel in a pass
+    enum class Pass {
+      Digitize,              // digitize the full window
+      ApplyTriggerLocations, // crop the digitized waveform to the readout windows
+      Estimate,              // estimate the waveform from the photon arrival times alone
+      DigitizeReadout        // digitize only around the readout windows, and crop
+    };
+
+    // Channels still to be processed in the current pass. Workers take them
+    // one at a time, so the ones with many photons do not hold back the
+    // others. The random numbers of a channel depend only on EventSeed and
+    // on the channel, whichever worker processes it.
+    struct ChannelQueue {
+      std::atomic<unsigned> next{0};
+      long EventSeed = 0;
+      Pass pass = Pass::Digitize;
+
+      void reset() { next.store(0, std::memory_order_relaxed); }
+    };
+
     opDetDigitizerWorker(unsigned no, const Config &config, CLHEP::HepRandomEngine *Engine, const opDetSBNDTriggerAlg &trigger_alg);
     ~opDetDigitizerWorker();
 
-    void SetPhotonLiteHandles(const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *PhotonLiteHandles)
+    void SetPhotonLiteTable(PhotonLiteTable *Table)
     {
-      fPhotonLiteHandles = PhotonLiteHandles;
+      fPhotonLiteTable = Table;
     }
-    void SetPhotonHandles(const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *PhotonHandles)
+    void SetPhotonTable(SimPhotonTable *Table)
     {
-      fPhotonHandles = PhotonHandles;
+      fPhotonTable = Table;
     }
     void SetWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
     {
       fWaveforms = Waveforms;
     }
-    void SetTriggeredWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
+    // triggered waveforms, one vector per channel
+    void SetTriggeredWaveformHandle(std::vector<std::vector<raw::OpDetWaveform>> *Waveforms)
     {
       fTriggeredWaveforms = Waveforms;
     }
+    void SetChannelQueue(ChannelQueue *Queue)
+    {
+      fQueue = Queue;
+    }
+
+    CLHEP::HepRandomEngine& Engine() const { return *fEngine; }
+
+    // Digitizers of this worker; built once, and used for all the events
+    std::unique_ptr<opdet::DigiPMTSBNDAlg> MakePMTDigitizer(detinfo::DetectorClocksData const& clockData) const;
+    std::unique_ptr<opdet::DigiArapucaSBNDAlg> MakeArapucaDigitizer(detinfo::DetectorClocksData const& clockData) const;
 
-    void Start(detinfo::DetectorClocksData const& clockData) const;
+    // runs the pass set in the channel queue
+    void Run(opdet::DigiPMTSBNDAlg *pmtDigitizer, opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+             detinfo::DetectorClocksData const& clockData) const;
+    void Start(opdet::DigiPMTSBNDAlg *pmtDigitizer, opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const;
     void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const;
+    void Estimate(opdet::DigiPMTSBNDAlg *pmtDigitizer, opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const;
+    void DigitizeReadout(opdet::DigiPMTSBNDAlg *pmtDigitizer, opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+                         detinfo::DetectorClocksData const& clockData) const;
 
   private:
-    unsigned NChannelsToProcess(unsigned n) const;
-    unsigned StartChannelToProcess(unsigned n) const;
+    // next channel of the queue, or nChannels when there are none left
+    unsigned NextChannel() const;
+    void SeedChannel(unsigned ch) const;
     void CreateDirectPhotonMap(
       std::unordered_map<int, sim::SimPhotons>& directPhotonsOnPMTS,
       std::vector<art::Handle<std::vector<sim::SimPhotons>>> photon_handles) const;
     void CreateDirectPhotonMapLite(
       std::unordered_map<int, sim::SimPhotonsLite>& directPhotonsOnPMTS,
       std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> photon_handles) const;
-    void MakeWaveforms(
+    // channel read out at the DAPHNE sampling
+    bool DaphneSampled(unsigned ch) const;
+    // samples of the channel in the time range [us]
+    unsigned NSamples(unsigned ch, std::array<double, 2> const& window) const;
+    void MakeWaveformLite(
+      unsigned ch,
+      opdet::DigiPMTSBNDAlg *pmtDigitizer,
+      opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+      std::array<double, 2> const& window) const;
+    void MakeWaveform(
+      unsigned ch,
+      opdet::DigiPMTSBNDAlg *pmtDigitizer,
+      opdet::DigiArapucaSBNDAlg *arapucaDigitizer,
+      std::array<double, 2> const& window) const;
+    void MakeEstimate(
+      unsigned ch,
       opdet::DigiPMTSBNDAlg *pmtDigitizer,
       opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const;
 
@@ -102,19 +162,29 @@ namespace opdet {
     CLHEP::HepRandomEngine *fEngine;
     const opDetSBNDTriggerAlg &fTriggerAlg;
 
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *fPhotonLiteHandles;
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *fPhotonHandles;
-    std::vector<raw::OpDetWaveform> *fWaveforms;
-    std::vector<raw::OpDetWaveform> *fTriggeredWaveforms;
+    PhotonLiteTable *fPhotonLiteTable = nullptr;
+    SimPhotonTable *fPhotonTable = nullptr;
+    std::vector<raw::OpDetWaveform> *fWaveforms = nullptr;
+    std::vector<std::vector<raw::OpDetWaveform>> *fTriggeredWaveforms = nullptr;
+    ChannelQueue *fQueue = nullptr;
   };
 
+  // Sum the photons of all the collections, separately for direct and reflected light,
+  // into one table shared by all the workers; channels from nChannels on are dropped
+  void FillPhotonTable(const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> &photon_handles,
+                       unsigned nChannels,
+                       PhotonLiteTable &table);
+  void FillPhotonTable(const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles,
+                       unsigned nChannels,
+                       SimPhotonTable &table);
+
   void StartopDetDigitizerWorkers(unsigned n_workers, opDetDigitizerWorker::Semaphore &sem_start);
   void WaitopDetDigitizerWorkers(unsigned n_workers, opDetDigitizerWorker::Semaphore &sem_finish);
   void opDetDigitizerWorkerThread(const opDetDigitizerWorker &worker,
                                   detinfo::DetectorClocksData const& clockData,
                                   opDetDigitizerWorker::Semaphore &sem_start,
                                   opDetDigitizerWorker::Semaphore &sem_finish,
-                                  bool ApplyTriggerLocations, bool *finished);
+                                  bool *finished);
 
 } // end namespace opdet
 
@@ -1,5 +1,9 @@
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
+#include "sbndcode/OpDetSim/TriggerPrimitives.hh"
 #include "lardataalg/DetectorInfo/DetectorClocksData.h"
+#include "cetlib_except/exception.h"
+
+#include "tbb/parallel_for.h"
 
 namespace {
   double optical_period(detinfo::DetectorClocksData const& clockData,bool is_daphne)
@@ -35,13 +39,9 @@ void AddTriggerLocation(std::vector<std::array<raw::TimeStamp_t, 2>> &triggers,
   triggers.insert(insert, range);
 }
 
-void AddTriggerPrimitive(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
-  typedef std::vector<TriggerPrimitive> TimeStamps;
-
-  TimeStamps::iterator insert = std::lower_bound(triggers.begin(), triggers.end(), trigger,
-    [](auto const &lhs, auto const &rhs) { return lhs.start < rhs.start; });
-
-  triggers.insert(insert, trigger);
+// Order of the merged primitives: by start time, and the higher channels first
+bool EarlierTriggerPrimitive(TriggerPrimitive const &lhs, TriggerPrimitive const &rhs) {
+  return lhs.start < rhs.start || (lhs.start == rhs.start && lhs.channel > rhs.channel);
 }
 
 void AddTriggerPrimitiveFinish(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
@@ -58,6 +58,10 @@ opDetSBNDTriggerAlg::opDetSBNDTriggerAlg(const Config &config):
 {
   // setup the masked channels
   fConfig.MaskedChannels(fMaskedChannels);
+
+  // one slot per channel, so that channels can be filled concurrently
+  fTriggerRangesPerChannel.resize(fOpDetMap.size());
+  fTriggerLocationsPerChannel.resize(fOpDetMap.size());
 }
 
 void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
@@ -68,9 +72,8 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
   raw::Channel_t channel = waveform.ChannelNumber();
   // if (channel > (unsigned)fOpDetMap.size()) return;
 
-  // initialize the channel in the map no matter what
-  if (fTriggerRangesPerChannel.count(channel) == 0) {
-    fTriggerRangesPerChannel[channel] = std::vector<std::array<raw::TimeStamp_t,2>>();
+  if (channel >= fTriggerRangesPerChannel.size()) {
+    throw cet::exception("opDetSBNDTriggerAlg") << "Channel " << channel << " is not in the optical detector map\n";
   }
   
   // get the threshold -- first check if channel is Arapuca or PMT
@@ -128,7 +131,7 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
     raw::TimeStamp_t time = tick_to_timestamp(clockData, waveform.TimeStamp(),i,is_daphne);
     t_since_last_trigger += optical_period(clockData,is_daphne);
     bool isLive = (t_since_last_trigger > t_deadtime);
-    raw::ADC_Count_t val = polarity * (adcs.at(i) - baseline);
+    raw::ADC_Count_t val = trigger::PulseHeight(adcs.at(i), baseline, polarity);
     // only open new trigger if enough deadtime has passed
     if (isLive && !above_threshold && val > threshold) {
       // new trigger! -- get the time
@@ -157,13 +160,14 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
   //
   // Small speed optimization: if this is the first time we are setting the 
   // trigger times for the channel, just move the vector we already built
-  if (fTriggerRangesPerChannel[channel].size() == 0) {
-    fTriggerRangesPerChannel[channel] = std::move(this_trigger_locations);
+  std::vector<std::array<raw::TimeStamp_t, 2>> &channel_ranges = fTriggerRangesPerChannel[channel];
+  if (channel_ranges.size() == 0) {
+    channel_ranges = std::move(this_trigger_locations);
   }
   // Otherwise, merge them in and keep things sorted in time
   else {
-    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_ranges) {
-      AddTriggerLocation(fTriggerRangesPerChannel[channel], trigger_range);
+    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_locations) {
+      AddTriggerLocation(channel_ranges, trigger_range);
     }
   }
 
@@ -191,8 +195,8 @@ bool opDetSBNDTriggerAlg::IsChannelMasked(raw::Channel_t channel) const {
 }
 
 void opDetSBNDTriggerAlg::ClearTriggerLocations() {
-  fTriggerLocationsPerChannel.clear();
-  fTriggerRangesPerChannel.clear();
+  for (auto &locations: fTriggerLocationsPerChannel) locations.clear();
+  for (auto &ranges: fTriggerRangesPerChannel) ranges.clear();
   fTriggerLocations.clear();
 }
 
@@ -200,12 +204,13 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
   // If each channel is self triggered, there is no "master" set of triggers, and 
   // we don't need to do anything here
   if (fConfig.SelfTriggerPerChannel()) {
-    for (const auto &trigger_ranges: fTriggerRangesPerChannel) {
-      fTriggerLocationsPerChannel[trigger_ranges.first] = std::vector<raw::TimeStamp_t>();
-      for (const std::array<raw::TimeStamp_t, 2> &range: trigger_ranges.second) {
-        fTriggerLocationsPerChannel[trigger_ranges.first].push_back(range[0]);
+    tbb::parallel_for(std::size_t(0), fTriggerRangesPerChannel.size(), [this](std::size_t channel) {
+      std::vector<raw::TimeStamp_t> &locations = fTriggerLocationsPerChannel[channel];
+      locations.clear();
+      for (const std::array<raw::TimeStamp_t, 2> &range: fTriggerRangesPerChannel[channel]) {
+        locations.push_back(range[0]);
       }
-    }
+    });
     return;
   }
 
@@ -217,23 +222,49 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
   // so we implement a small generic algorithm here. This may likely have
   // to be changed later.
 
-  // First re-sort the trigger times to be a sorted global list of (channel, time) values
-  std::vector<TriggerPrimitive> all_trigger_locations;
-  for (const auto &trigger_locations_pair: fTriggerRangesPerChannel) {
-    raw::Channel_t this_channel = trigger_locations_pair.first;
+  // First re-sort the trigger times to be a sorted global list of (channel, time) values.
+  // Each channel is already sorted in time; equal times are taken last first, as
+  // inserting them one by one in front of the equal ones used to do
+  std::vector<std::vector<TriggerPrimitive>> channel_triggers;
+  for (raw::Channel_t this_channel = 0; this_channel < fTriggerRangesPerChannel.size(); this_channel++) {
+    const std::vector<std::array<raw::TimeStamp_t, 2>> &ranges = fTriggerRangesPerChannel[this_channel];
     // check if this channel contributes to the trigger
-    if (!IsChannelMasked(this_channel)) {
-      // then add in the locations
-      for (std::array<raw::TimeStamp_t,2> trigger_range: trigger_locations_pair.second) {
-        TriggerPrimitive trigger;
-        trigger.start = trigger_range[0];
-        trigger.finish = trigger_range[1];
-        trigger.channel = this_channel;
-        AddTriggerPrimitive(all_trigger_locations, trigger);
-      }
+    if (ranges.empty() || IsChannelMasked(this_channel)) continue;
+    std::vector<TriggerPrimitive> triggers;
+    triggers.reserve(ranges.size());
+    for (std::array<raw::TimeStamp_t,2> trigger_range: ranges) {
+      TriggerPrimitive trigger;
+      trigger.start = trigger_range[0];
+      trigger.finish = trigger_range[1];
+      trigger.channel = this_channel;
+      triggers.push_back(trigger);
     }
+    for (auto first = triggers.begin(); first != triggers.end(); ) {
+      auto last = std::find_if(first, triggers.end(), [first](auto const &t) { return t.start != first->start; });
+      std::reverse(first, last);
+      first = last;
+    }
+    channel_triggers.push_back(std::move(triggers));
   }
 
+  // then merge the channels pairwise, in a tree
+  while (channel_triggers.size() > 1) {
+    std::vector<std::vector<TriggerPrimitive>> merged((channel_triggers.size() + 1) / 2);
+    tbb::parallel_for(std::size_t(0), merged.size(), [&channel_triggers, &merged](std::size_t i) {
+      std::vector<TriggerPrimitive> &first = channel_triggers[2*i];
+      if (2*i + 1 == channel_triggers.size()) {
+        merged[i] = std::move(first);
+        return;
+      }
+      std::vector<TriggerPrimitive> &second = channel_triggers[2*i + 1];
+      merged[i].resize(first.size() + second.size());
+      std::merge(first.begin(), first.end(), second.begin(), second.end(), merged[i].begin(), EarlierTriggerPrimitive);
+    });
+    channel_triggers = std::move(merged);
+  }
+  std::vector<TriggerPrimitive> all_trigger_locations;
+  if (!channel_triggers.empty()) all_trigger_locations = std::move(channel_triggers.front());
+
   // Now merge the trigger locations we have 
   //
   // What is the merging algorithm? This will probably come from the PTB.
@@ -255,7 +286,7 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
       primitives.resize(primitives.size() - 1);
     }
 
-    bool is_triggering = primitives.size() >= fConfig.TriggerChannelCount();
+    bool is_triggering = trigger::Majority(primitives.size(), fConfig.TriggerChannelCount());
     if (is_triggering && !was_triggering) {
       raw::TimeStamp_t this_trigger_time = primitive.start;
       fTriggerLocations.push_back(this_trigger_time);
@@ -302,6 +333,18 @@ const std::vector<raw::TimeStamp_t> &opDetSBNDTriggerAlg::GetTriggerTimes(raw::C
 
 }
 
+bool opDetSBNDTriggerAlg::ReadoutRange(raw::Channel_t channel, std::array<double, 2> &range) const {
+  const std::vector<raw::TimeStamp_t> &trigger_times = GetTriggerTimes(channel);
+  if (trigger_times.empty()) return false;
+
+  // the beam trigger may have windows of its own; take the widest
+  auto const first_last = std::minmax_element(trigger_times.begin(), trigger_times.end());
+  double pre = std::max(ReadoutWindowPreTrigger(channel), ReadoutWindowPreTriggerBeam(channel));
+  double post = std::max(ReadoutWindowPostTrigger(channel), ReadoutWindowPostTriggerBeam(channel));
+  range = {{*first_last.first - pre, *first_last.second + post}};
+  return true;
+}
+
 double opDetSBNDTriggerAlg::ReadoutWindowPreTrigger(raw::Channel_t channel) const {
   // Allow for different channels to have different readout window lengths
   // For now, we don't use this
@@ -334,11 +377,17 @@ std::vector<raw::OpDetWaveform> opDetSBNDTriggerAlg::ApplyTriggerLocations(detin
                                                                            const raw::OpDetWaveform &waveform) const {
   // Vector of "triggered" OpDetWaveforms
   std::vector<raw::OpDetWaveform> ret;
+  ApplyTriggerLocations(clockData, waveform, ret);
+  return ret;
+}
 
+void opDetSBNDTriggerAlg::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                                                const raw::OpDetWaveform &waveform,
+                                                std::vector<raw::OpDetWaveform> &ret) const {
   // Get the trigger times we found earlier for this channel
   raw::Channel_t channel = waveform.ChannelNumber();
   const std::vector<raw::TimeStamp_t> &trigger_times = GetTriggerTimes(channel);
-  if( trigger_times.size() == 0 ) return ret;
+  if( trigger_times.size() == 0 ) return;
   bool is_daphne = false;
   std::string sampling_type = fOpDetMap.electronicsType(channel);
   if (sampling_type == "daphne") is_daphne = true;
@@ -430,18 +479,17 @@ std::vector<raw::OpDetWaveform> opDetSBNDTriggerAlg::ApplyTriggerLocations(detin
     // start new readout
     if( !isReadingOut && isTriggering ) {
       this_waveform = raw::OpDetWaveform(time, channel); 
-      this_waveform.push_back(adcs[i]);
       isReadingOut = true;
       min_ro_samples = ro_samples;
       if( isBeamTrigger ) min_ro_samples = ro_samples_beam;
+      this_waveform.reserve(min_ro_samples);
+      this_waveform.push_back(adcs[i]);
     }
 
   }//endloop over ADCs
 
 //  std::cout<<"We saved a total of "<<ret.size()<<" opdetwaveforms\n";
 //  for(size_t i=0; i<ret.size(); i++) std::cout<<"   - timestamp "<<ret.at(i).TimeStamp()<<"   size "<<ret.at(i).Waveform().size()<<"\n";
-  
-  return ret;
 }
 
 } // namespace opdet
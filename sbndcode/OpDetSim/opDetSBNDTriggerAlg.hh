@@ -248,7 +248,8 @@ namespace opdet {
     // Clear out at the end of an event
     void ClearTriggerLocations();
 
-    // Add in a waveform to define trigger locations
+    // Add in a waveform to define trigger locations; waveforms of different
+    // channels can be added concurrently
     void FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
                               detinfo::DetectorPropertiesData const& detProp,
                               const raw::OpDetWaveform &waveform,
@@ -259,6 +260,14 @@ namespace opdet {
 
     // Apply trigger locations to an input OpDetWaveform
     std::vector<raw::OpDetWaveform> ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData, const raw::OpDetWaveform &waveform) const;
+    // Same, appending the triggered waveforms to triggered
+    void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData,
+                               const raw::OpDetWaveform &waveform,
+                               std::vector<raw::OpDetWaveform> &triggered) const;
+
+    // Time range [us] covered by the readout windows of the triggers of a channel;
+    // false if the channel has no trigger
+    bool ReadoutRange(raw::Channel_t channel, std::array<double, 2> &range) const;
 
     // Returns the time range over which triggers are enabled over a range [start, end]
     std::array<double, 2> TriggerEnableWindow(detinfo::DetectorClocksData const& clockData,
@@ -285,9 +294,9 @@ namespace opdet {
     // OpDet channel map
     opdet::sbndPDMapAlg fOpDetMap;
 
-    // keeping track of triggers
-    std::map<raw::Channel_t, std::vector<std::array<raw::TimeStamp_t, 2>>> fTriggerRangesPerChannel;
-    std::map<raw::Channel_t, std::vector<raw::TimeStamp_t>> fTriggerLocationsPerChannel;
+    // keeping track of triggers, indexed by channel
+    std::vector<std::vector<std::array<raw::TimeStamp_t, 2>>> fTriggerRangesPerChannel;
+    std::vector<std::vector<raw::TimeStamp_t>> fTriggerLocationsPerChannel;
     std::vector<raw::TimeStamp_t> fTriggerLocations;
 
     std::vector<unsigned> fMaskedChannels;
@@ -39,7 +39,10 @@
 
 #include <memory>
 #include <algorithm>
+#include <numeric>
 #include <vector>
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
 #include "TMath.h"
 #include "TH1D.h"
 #include "TRandom3.h"
@@ -84,23 +87,33 @@ namespace opdet {
     int fThresholdPMT; //in ADC
     int fThresholdArapuca; //in ADC
     int fEvNumber;
-    int fChNumber;
-    std::string opdetType;
-    std::string electronicsType;
-    int threshold;
     //int fSize;
     //int fTimePMT;         //Start time of PMT signal
     //int fTimeMax;         //Time of maximum (minimum) PMT signal
-    void subtractBaseline(std::vector<double>& waveform, std::string pdtype, std::string electronicsType, double& rms);
-    bool findAndSuppressPeak(std::vector<double>& waveform, size_t& timebin,
-                             double& Area, double& amplitude,
-                             const int& threshold, const std::string& opdetType, const std::string& electronicsType);
-    void denoise(std::vector<double>& waveform, std::vector<double>& outwaveform);
+
+    struct Peak_t {
+      size_t timebin;   // first sample at the peak maximum
+      double amplitude;
+      double area;      // in ADC*ns
+    };
+    // per thread working space, kept across waveforms and events
+    struct Scratch_t {
+      std::vector<double> waveform;
+      std::vector<double> outwaveform;
+      std::vector<Peak_t> peaks;
+    };
+    tbb::enumerable_thread_specific<Scratch_t> fScratch;
+
+    void findHits(raw::OpDetWaveform const& wvf, Scratch_t& scratch, std::vector<recob::OpHit>& hits) const;
+    void subtractBaseline(std::vector<double>& waveform, std::string pdtype, std::string electronicsType, double& rms) const;
+    void findPeaks(std::vector<double> const& waveform, const int threshold,
+                   const std::string& electronicsType, std::vector<Peak_t>& peaks) const;
+    void denoise(std::vector<double>& waveform, std::vector<double>& outwaveform) const;
     bool TV1D_denoise(std::vector<double>& waveform,
                       std::vector<double>& outwaveform,
-                      const double lambda);
+                      const double lambda) const;
     void TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                         unsigned int width, const double lambda);
+                         unsigned int width, const double lambda) const;
     //std::stringstream histname;
   };
 
@@ -134,10 +147,6 @@ namespace opdet {
     mf::LogInfo("opHitFinder") << "Event #" << fEvNumber;
 
     std::unique_ptr< std::vector< recob::OpHit > > pulseVecPtr(std::make_unique< std::vector< recob::OpHit > > ());
-    std::vector<double> fwaveform;
-    std::vector<double> outwvform;
-    fwaveform.reserve(30000); // TODO: no hardcoded value
-    outwvform.reserve(30000); // TODO: no hardcoded value
 
     art::ServiceHandle<art::TFileService> tfs;
     art::Handle< std::vector< raw::OpDetWaveform > > wvfHandle;
@@ -148,79 +157,90 @@ namespace opdet {
       return;
     }
 
-    size_t timebin = 0;
-    double FWHM = 1, Area = 0, phelec, fasttotal = 3./4., rms = 0, amplitude = 0, time = 0;
+    // the waveforms are independent: find their hits in parallel,
+    // then store them in the order of the waveforms
+    std::vector<raw::OpDetWaveform> const& wvfs = *wvfH;
+    std::vector<std::vector<recob::OpHit>> wvfHits(wvfs.size());
+    tbb::parallel_for(std::size_t(0), wvfs.size(), [&](std::size_t i) {
+      findHits(wvfs[i], fScratch.local(), wvfHits[i]);
+    });
+
+    size_t nHits = 0;
+    for(auto const& hits : wvfHits) nHits += hits.size();
+    pulseVecPtr->reserve(nHits);
+    for(auto& hits : wvfHits) {
+      std::move(hits.begin(), hits.end(), std::back_inserter(*pulseVecPtr));
+    }
+    e.put(std::move(pulseVecPtr));
+  } // void opHitFinderSBND::produce(art::Event & e)
+
+  void opHitFinderSBND::findHits(raw::OpDetWaveform const& wvf, Scratch_t& scratch,
+                                 std::vector<recob::OpHit>& hits) const
+  {
+    double FWHM = 1, phelec, fasttotal = 3./4., rms = 0, time = 0;
     unsigned short frame = 1;
-    //int histogram_number = 0;
-    for(auto const& wvf : *wvfH) {
-      if (wvf.size() == 0 ) {
-        mf::LogInfo("opHitFinder") << "Empty waveform, continue.";
-        continue;
-      }
+    int threshold;
 
-      fChNumber = wvf.ChannelNumber();
-      opdetType = map.pdType(fChNumber);
-      electronicsType = map.electronicsType(fChNumber);
-      if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
-        threshold = fThresholdPMT;
+    if (wvf.size() == 0 ) {
+      mf::LogInfo("opHitFinder") << "Empty waveform, continue.";
+      return;
+    }
+
+    int const chNumber = wvf.ChannelNumber();
+    std::string const opdetType = map.pdType(chNumber);
+    std::string const electronicsType = map.electronicsType(chNumber);
+    if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
+      threshold = fThresholdPMT;
+    }
+    else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
+      threshold = fThresholdArapuca;
+    }
+    else {
+      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
+      return;
+    }
+
+    std::vector<double>& fwaveform = scratch.waveform;
+    fwaveform.assign(wvf.begin(), wvf.end());
+
+    subtractBaseline(fwaveform, opdetType, electronicsType, rms);
+
+    if(fUseDenoising) {
+      if((opdetType == "pmt_coated") || (opdetType == "pmt_uncoated")) {
       }
       else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-        threshold = fThresholdArapuca;
+        denoise(fwaveform, scratch.outwaveform);
       }
       else {
-        mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
-        continue;
-      }
-
-      fwaveform.resize(wvf.size());
-      for(unsigned int i = 0; i < wvf.size(); i++) {
-        fwaveform[i] = wvf[i];
+        mf::LogInfo("opHitFinder") << "Unexpected OpChannel: " << opdetType
+                  << ", continue." << std::endl;
+        std::terminate();
       }
+    }
 
-      subtractBaseline(fwaveform, opdetType, electronicsType, rms);
+    // TODO: pass rms to this function once that's sorted. ~icaza
+    findPeaks(fwaveform, threshold, electronicsType, scratch.peaks);
+    hits.reserve(scratch.peaks.size());
+    for(Peak_t const& peak : scratch.peaks) {
+      if(electronicsType == "daphne") time = wvf.TimeStamp() + (double)peak.timebin / fSampling_Daphne;
+      else time = wvf.TimeStamp() + (double)peak.timebin / fSampling;
 
-      if(fUseDenoising) {
-        if((opdetType == "pmt_coated") || (opdetType == "pmt_uncoated")) {
-        }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-          denoise(fwaveform, outwvform);
-        }
-        else {
-          mf::LogInfo("opHitFinder") << "Unexpected OpChannel: " << opdetType
-                    << ", continue." << std::endl;
-          std::terminate();
-        }
+      if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
+        phelec = peak.area / fArea1pePMT;
+      }
+      else {
+        phelec = peak.area / fArea1peSiPM;
       }
 
-      // TODO: pass rms to this function once that's sorted. ~icaza
-      while(findAndSuppressPeak(fwaveform, timebin, Area, amplitude, threshold, opdetType, electronicsType)){
-        if(electronicsType == "daphne") time = wvf.TimeStamp() + (double)timebin / fSampling_Daphne;
-        else time = wvf.TimeStamp() + (double)timebin / fSampling;
-
-        if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
-          phelec = Area / fArea1pePMT;
-        }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-          phelec = Area / fArea1peSiPM;
-        }
-        else {
-          mf::LogWarning("opHitFinder")  << "Unexpected OpChannel: " << opdetType
-                                         << ", continue.";
-          continue;
-        }
-
-        //including hit info: OpChannel, PeakTime, PeakTimeAbs, Frame, Width, Area, PeakHeight, PE, FastToTotal
-        recob::OpHit opHit(fChNumber, time, time, frame, FWHM, Area, amplitude, phelec, fasttotal);
-        pulseVecPtr->emplace_back(opHit);
-      } // while findAndSuppressPeak()
+      //including hit info: OpChannel, PeakTime, PeakTimeAbs, Frame, Width, Area, PeakHeight, PE, FastToTotal
+      hits.emplace_back(chNumber, time, time, frame, FWHM, peak.area, peak.amplitude, phelec, fasttotal);
     }
-    e.put(std::move(pulseVecPtr));
-  } // void opHitFinderSBND::produce(art::Event & e)
+  } // void opHitFinderSBND::findHits()
 
   DEFINE_ART_MODULE(opHitFinderSBND)
 
   void opHitFinderSBND::subtractBaseline(std::vector<double>& waveform,
-                                         std::string pdtype, std::string electronicsType, double& rms)
+                                         std::string pdtype, std::string electronicsType, double& rms) const
   {
     double baseline = 0.0;
     rms = 0.0;
@@ -243,60 +263,48 @@ namespace opdet {
     if(pdtype == "pmt_coated" || pdtype == "pmt_uncoated") {
       for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityPMT * (waveform[i] - baseline);
     }
-    else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
+    else if((pdtype == "xarapuca_vuv") || (pdtype == "xarapuca_vis")) {
       for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityArapuca * (waveform[i] - baseline);
     }
     else {
-      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
+      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << pdtype;
       return;
     }
   }
 
 
   // TODO: pass rms to this function once that's sorted. ~icaza
-  bool opHitFinderSBND::findAndSuppressPeak(std::vector<double>& waveform,
-                                            size_t& timebin, double& Area,
-                                            double& amplitude, const int& threshold,
-                                            const std::string& opdetType,
-                                            const std::string& electronicsType)
+  void opHitFinderSBND::findPeaks(std::vector<double> const& waveform,
+                                  const int threshold,
+                                  const std::string& electronicsType,
+                                  std::vector<Peak_t>& peaks) const
   {
-
-    std::vector<double>::iterator max_element_it = std::max_element(waveform.begin(), waveform.end());
-    amplitude = *max_element_it;
-    if(amplitude < threshold) return false; // stop if there's no more peaks
-    timebin = std::distance(waveform.begin(), max_element_it);
-
-    // it_e contains the iterator to the last element in the peak
-    // where waveform is above threshold
-    auto it_e = std::find_if(max_element_it,
-                            waveform.end(),
-                            [threshold](const double& x)->bool
-                              {return x < threshold;} );
-    // it_s contains the iterator to the first element in the peak
-    // where waveform is above threshold
-    auto it_s = std::find_if(std::make_reverse_iterator(max_element_it),
-                            std::make_reverse_iterator(waveform.begin()),
-                            [threshold](const double& x)->bool
-                              {return x < threshold;} ).base();
-
-    // integrate the area below the peak
+    // a peak is each run of samples above threshold, with its maximum
+    // as amplitude and its sum as area; they are found in one pass and
+    // then listed from the highest down, earlier ones first on ties
+    peaks.clear();
     // note that fSampling is in MHz and
     // we convert it to GHz here so as to
     // have an area in ADC*ns.
-    Area = std::accumulate(it_s, it_e, 0.0);
-    if (electronicsType == "daphne"){
-    Area = Area / (fSampling_Daphne / 1000.);}
-    else{
-    Area = Area / (fSampling / 1000.);};
-
-    // TODO: try to just remove this
-    // TODO: better even, return iterator to last position
-    std::fill(it_s, it_e, 0.0); // zeroes out that peak
-    return true;
-  } // bool opHitFinderSBND::findAndSuppressPeak()
+    double const sampling = (electronicsType == "daphne") ? fSampling_Daphne : fSampling;
+    size_t const n = waveform.size();
+    size_t i = 0;
+    while(i < n) {
+      if(waveform[i] < threshold) { ++i; continue; }
+      size_t timebin = i;
+      double area = 0.0;
+      for(; i < n && !(waveform[i] < threshold); ++i) {
+        area += waveform[i];
+        if(waveform[i] > waveform[timebin]) timebin = i;
+      }
+      peaks.push_back({timebin, waveform[timebin], area / (sampling / 1000.)});
+    }
+    std::stable_sort(peaks.begin(), peaks.end(),
+                     [](Peak_t const& a, Peak_t const& b){ return a.amplitude > b.amplitude; });
+  } // void opHitFinderSBND::findPeaks()
 
 
-  void opHitFinderSBND::denoise(std::vector<double>& waveform, std::vector<double>& outwaveform)
+  void opHitFinderSBND::denoise(std::vector<double>& waveform, std::vector<double>& outwaveform) const
   {
 
     int wavelength = waveform.size();
@@ -326,7 +334,7 @@ namespace opdet {
   // TODO: this function is not robust, check if the expected input is given and put exceptions
   bool opHitFinderSBND::TV1D_denoise(std::vector<double>& waveform,
                                      std::vector<double>& outwaveform,
-                                     const double lambda)
+                                     const double lambda) const
   {
     int width = waveform.size();
     int k = 0, k0 = 0; // k: current sample location, k0: beginning of current segment
@@ -380,7 +388,7 @@ namespace opdet {
 
 
   void opHitFinderSBND::TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                                        unsigned int width, const double lambda)
+                                        unsigned int width, const double lambda) const
   {
     // unsigned int* indstart_low = malloc(sizeof *indstart_low * width);
     // unsigned int* indstart_up = malloc(sizeof *indstart_up * width);
@@ -18,6 +18,11 @@
 // sensible_to_vuv: true or false
 // tpc: 0, 1
 // sampling: apsaia, daphne
+//
+// The attributes used per channel in the reconstruction (pd_type,
+// electronics, pds_box, tpc) are also cached at construction in a
+// contiguous table, together with the channel lists of each type, so
+// those queries do not go through the json object.
 ////////////////////////////////////////////////////////////////////////
 
 #ifndef SBND_OPDETSIM_SBNDPDMAPALG_HH
@@ -31,6 +36,8 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "art_root_io/TFileService.h"
 
@@ -41,6 +48,9 @@ namespace opdet {
   class sbndPDMapAlg : PDMapAlg{
 
   public:
+    enum class PDType_t { kPMTCoated, kPMTUncoated, kXArapucaVUV, kXArapucaVIS, kOther };
+    enum class Electronics_t { kNone, kApsaia, kDaphne, kOther };
+
     //Default constructor
     explicit sbndPDMapAlg(const fhicl::ParameterSet& pset);
     sbndPDMapAlg() : sbndPDMapAlg(fhicl::ParameterSet()) {}
@@ -68,8 +78,33 @@ namespace opdet {
     size_t size() const;
     auto getChannelEntry(size_t ch) const;
 
+    // typed versions of the accessors above
+    PDType_t pdTypeID(size_t ch) const { return fChannels.at(ch).pdType; }
+    Electronics_t electronicsID(size_t ch) const { return fChannels.at(ch).electronics; }
+    std::vector<int> const& channelsOfType(PDType_t pdtype) const;
+
+    static PDType_t toPDType(std::string const& pdname);
+    static Electronics_t toElectronics(std::string const& elname);
+
   private:
+    struct ChannelInfo_t {
+      PDType_t pdType;
+      Electronics_t electronics;
+      int pdsBox;
+      int tpc;
+      std::string pdTypeName;
+      std::string electronicsName;
+    };
+
     nlohmann::json PDmap;
+    std::vector<ChannelInfo_t> fChannels;
+    std::map<std::string, std::vector<int>> fChannelsOfType;
+    std::map<std::pair<std::string, std::string>, std::vector<int>> fChannelsOfTypeAndElectronics;
+    std::vector<std::vector<int>> fChannelsOfTypeID; // indexed by PDType_t
+
+    static std::vector<int> const fNoChannels;
+
+    void buildChannelTable();
 
   }; // class sbndPDMapAlg
 
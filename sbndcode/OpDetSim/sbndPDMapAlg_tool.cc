@@ -1,4 +1,5 @@
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/Utilities/StartupTimeline.h"
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
@@ -11,66 +12,115 @@ namespace opdet {
 
   sbndPDMapAlg::sbndPDMapAlg(const fhicl::ParameterSet&)
   {
+    sbnd::startup::Span span("sbndPDMapAlg::ReadMap");
     std::string fname;
     cet::search_path sp("FW_SEARCH_PATH");
     sp.find_file("sbnd_pds_mapping.json", fname);
     std::ifstream i(fname, std::ifstream::in);
     i >> PDmap;
     i.close();
+    buildChannelTable();
   }
 
   sbndPDMapAlg::~sbndPDMapAlg()
   { }
 
+  std::vector<int> const sbndPDMapAlg::fNoChannels;
+
+  void sbndPDMapAlg::buildChannelTable()
+  {
+    fChannels.clear();
+    fChannels.reserve(PDmap.size());
+    fChannelsOfType.clear();
+    fChannelsOfTypeAndElectronics.clear();
+    fChannelsOfTypeID.assign(size_t(PDType_t::kOther) + 1, {});
+    for (size_t ch = 0; ch < PDmap.size(); ch++) {
+      auto const& e = PDmap.at(ch);
+      ChannelInfo_t info;
+      info.pdTypeName = e.value("pd_type", std::string());
+      info.electronicsName = e.value("electronics", std::string());
+      info.pdType = toPDType(info.pdTypeName);
+      info.electronics = toElectronics(info.electronicsName);
+      info.pdsBox = e.value("pds_box", -1);
+      info.tpc = e.value("tpc", -1);
+      fChannelsOfType[info.pdTypeName].push_back(ch);
+      fChannelsOfTypeAndElectronics[{info.pdTypeName, info.electronicsName}].push_back(ch);
+      fChannelsOfTypeID[size_t(info.pdType)].push_back(ch);
+      fChannels.push_back(std::move(info));
+    }
+  }
+
+  sbndPDMapAlg::PDType_t sbndPDMapAlg::toPDType(std::string const& pdname)
+  {
+    if (pdname == "pmt_coated") return PDType_t::kPMTCoated;
+    if (pdname == "pmt_uncoated") return PDType_t::kPMTUncoated;
+    if (pdname == "xarapuca_vuv") return PDType_t::kXArapucaVUV;
+    if (pdname == "xarapuca_vis") return PDType_t::kXArapucaVIS;
+    return PDType_t::kOther;
+  }
+
+  sbndPDMapAlg::Electronics_t sbndPDMapAlg::toElectronics(std::string const& elname)
+  {
+    if (elname.empty()) return Electronics_t::kNone;
+    if (elname == "apsaia") return Electronics_t::kApsaia;
+    if (elname == "daphne") return Electronics_t::kDaphne;
+    return Electronics_t::kOther;
+  }
+
   bool sbndPDMapAlg::isPDType(size_t ch, std::string pdname) const
   {
-    if(PDmap.at(ch)["pd_type"] == std::string(pdname)) return true;
-    return false;
+    ChannelInfo_t const& info = fChannels.at(ch);
+    PDType_t const pdtype = toPDType(pdname);
+    if (pdtype != PDType_t::kOther) return info.pdType == pdtype;
+    return info.pdTypeName == pdname;
   }
 
   bool sbndPDMapAlg::isElectronics(size_t ch, std::string pdname) const
   {
-    if(PDmap.at(ch)["electronics"] == std::string(pdname)) return true; // TODO: add number of electronics, daphne01, daphne02, .... ~rodrigoa
-    return false;
+    // TODO: add number of electronics, daphne01, daphne02, .... ~rodrigoa
+    ChannelInfo_t const& info = fChannels.at(ch);
+    Electronics_t const electronics = toElectronics(pdname);
+    if (electronics != Electronics_t::kOther) return info.electronics == electronics;
+    return info.electronicsName == pdname;
   }
 
   std::string sbndPDMapAlg::pdType(size_t ch) const
   {
-    return PDmap.at(ch)["pd_type"];
+    return fChannels.at(ch).pdTypeName;
   }
 
   std::string sbndPDMapAlg::electronicsType(size_t ch) const
   {
-    return PDmap.at(ch)["electronics"]; 
+    return fChannels.at(ch).electronicsName;
   }
 
   int sbndPDMapAlg::pdBox(size_t ch) const
   {
-    return PDmap.at(ch)["pds_box"];
+    return fChannels.at(ch).pdsBox;
   }
 
 
   int sbndPDMapAlg::pdTPC(size_t ch) const
   {
-    return PDmap.at(ch)["tpc"];
+    return fChannels.at(ch).tpc;
   }
 
   std::vector<int> sbndPDMapAlg::getChannelsOfType(std::string pdname) const
   {
-    std::vector<int> out_ch_v;
-    for (size_t ch = 0; ch < PDmap.size(); ch++) {
-      if (PDmap.at(ch)["pd_type"] == pdname) out_ch_v.push_back(ch);
-    }
-    return out_ch_v;
+    auto const it = fChannelsOfType.find(pdname);
+    return (it == fChannelsOfType.end()) ? std::vector<int>() : it->second;
   }
 
   std::vector<int> sbndPDMapAlg::getChannelsOfType(std::string pdname,std::string elname) const
   {//overload to select channels by pdtype AND electronics type ~rodrigoa
-    std::vector<int> out_ch_v;
-    for (size_t ch = 0; ch < PDmap.size(); ch++) {
-      if ((PDmap.at(ch)["pd_type"] == pdname) && (PDmap.at(ch)["electronics"] == elname))out_ch_v.push_back(ch);
-    }
-    return out_ch_v;
+    auto const it = fChannelsOfTypeAndElectronics.find({pdname, elname});
+    return (it == fChannelsOfTypeAndElectronics.end()) ? std::vector<int>() : it->second;
+  }
+
+  std::vector<int> const& sbndPDMapAlg::channelsOfType(PDType_t pdtype) const
+  {
+    size_t const i = size_t(pdtype);
+    return (i < fChannelsOfTypeID.size()) ? fChannelsOfTypeID[i] : fNoChannels;
   }
 
   size_t sbndPDMapAlg::size() const
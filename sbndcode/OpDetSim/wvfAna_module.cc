@@ -13,6 +13,7 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
@@ -72,6 +73,24 @@ namespace opdet {
 
   private:
 
+    // Statistics of a waveform, accumulated in one pass over its samples
+    struct WaveformStats {
+      double baseline = 0.;    // mean of the first fBaselineSamples samples
+      double baselineRMS = 0.;
+      double integral = 0.;    // sum of the baseline subtracted samples
+      int    minADC = 0;
+      int    maxADC = 0;
+      size_t minTick = 0;
+      size_t maxTick = 0;
+    };
+
+    WaveformStats computeStats(raw::OpDetWaveform const& wvf) const;
+
+    // Window [first, last) of the samples to write out: the whole waveform,
+    // or the samples beyond fROIThreshold from the baseline with fROIPadding
+    // samples on each side; empty if no sample crosses the threshold
+    std::pair<size_t, size_t> dumpWindow(raw::OpDetWaveform const& wvf, WaveformStats const& stats) const;
+
     size_t fEvNumber;
     size_t fChNumber;
     double fSampling;
@@ -86,6 +105,18 @@ namespace opdet {
     std::stringstream histname;
     std::string opdetType;
     std::string opdetElectronics;
+
+    bool   fSaveWaveforms;
+    bool   fSaveStats;
+    size_t fDownsample;
+    size_t fBaselineSamples;
+    double fROIThreshold;
+    size_t fROIPadding;
+
+    TTree *fStatsTree = nullptr;
+    double fTimeStamp;
+    size_t fNSamples;
+    WaveformStats fStats;
   };
 
 
@@ -100,11 +131,77 @@ namespace opdet {
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     fSampling = clockData.OpticalClock().Frequency(); // MHz
     fSampling_Daphne = p.get<double>("DaphneFrequency" );
+
+    fSaveWaveforms   = p.get<bool>("SaveWaveforms", true);
+    fSaveStats       = p.get<bool>("SaveStats", false);
+    fDownsample      = std::max(p.get<size_t>("Downsample", 1), size_t(1));
+    fBaselineSamples = p.get<size_t>("BaselineSamples", 50);
+    fROIThreshold    = p.get<double>("ROIThreshold", 0.);
+    fROIPadding      = p.get<size_t>("ROIPadding", 20);
   }
 
   void wvfAna::beginJob()
   {
+    if(!fSaveStats) return;
+
+    art::ServiceHandle<art::TFileService> tfs;
+    fStatsTree = tfs->make<TTree>("WaveformStats", "WaveformStats");
+    fStatsTree->Branch("event", &fEvNumber);
+    fStatsTree->Branch("opchannel", &fChNumber);
+    fStatsTree->Branch("opdetType", &opdetType);
+    fStatsTree->Branch("timestamp", &fTimeStamp);
+    fStatsTree->Branch("nsamples", &fNSamples);
+    fStatsTree->Branch("baseline", &fStats.baseline);
+    fStatsTree->Branch("baselineRMS", &fStats.baselineRMS);
+    fStatsTree->Branch("integral", &fStats.integral);
+    fStatsTree->Branch("minADC", &fStats.minADC);
+    fStatsTree->Branch("maxADC", &fStats.maxADC);
+    fStatsTree->Branch("minTick", &fStats.minTick);
+    fStatsTree->Branch("maxTick", &fStats.maxTick);
+  }
+
+  wvfAna::WaveformStats wvfAna::computeStats(raw::OpDetWaveform const& wvf) const
+  {
+    WaveformStats stats;
+    if(wvf.empty()) return stats;
+
+    size_t const nBaseline = std::min(fBaselineSamples, wvf.size());
+    double sum = 0., baseSum = 0., baseSum2 = 0.;
+    int minADC = wvf[0], maxADC = wvf[0];
+    size_t minTick = 0, maxTick = 0;
+    for(size_t i = 0; i < wvf.size(); i++) {
+      double const adc = wvf[i];
+      sum += adc;
+      if(i < nBaseline) {
+        baseSum += adc;
+        baseSum2 += adc*adc;
+      }
+      if(wvf[i] < minADC) { minADC = wvf[i]; minTick = i; }
+      if(wvf[i] > maxADC) { maxADC = wvf[i]; maxTick = i; }
+    }
+
+    stats.baseline = (nBaseline > 0) ? baseSum/nBaseline : 0.;
+    stats.baselineRMS = (nBaseline > 0) ? std::sqrt(std::max(baseSum2/nBaseline - stats.baseline*stats.baseline, 0.)) : 0.;
+    stats.integral = sum - stats.baseline*wvf.size();
+    stats.minADC = minADC;
+    stats.maxADC = maxADC;
+    stats.minTick = minTick;
+    stats.maxTick = maxTick;
+    return stats;
+  }
+
+  std::pair<size_t, size_t> wvfAna::dumpWindow(raw::OpDetWaveform const& wvf, WaveformStats const& stats) const
+  {
+    if(fROIThreshold <= 0.) return {0, wvf.size()};
+
+    auto const overThreshold = [&](short adc){ return std::abs(adc - stats.baseline) > fROIThreshold; };
+    auto const first = std::find_if(wvf.begin(), wvf.end(), overThreshold);
+    if(first == wvf.end()) return {0, 0};
+    auto const last = std::find_if(wvf.rbegin(), wvf.rend(), overThreshold).base();
 
+    size_t const start = std::distance(wvf.begin(), first);
+    size_t const end = std::distance(wvf.begin(), last);
+    return {(start > fROIPadding) ? start - fROIPadding : 0, std::min(end + fROIPadding, wvf.size())};
   }
 
   void wvfAna::analyze(art::Event const & e)
@@ -157,24 +254,35 @@ namespace opdet {
       opdetType = pdMap.pdType(fChNumber);
       opdetElectronics = pdMap.electronicsType(fChNumber);
       if (std::find(fOpDetsToPlot.begin(), fOpDetsToPlot.end(), opdetType) == fOpDetsToPlot.end()) {continue;}
+      fTimeStamp = wvf.TimeStamp();
+      fNSamples = wvf.size();
+      fStats = computeStats(wvf);
+      if(fStatsTree) fStatsTree->Fill();
+
+      if(!fSaveWaveforms) continue;
+
+      auto const [first, last] = dumpWindow(wvf, fStats);
+      if(first >= last) continue;
+
       histname.str(std::string());
       histname << "event_" << fEvNumber
                << "_opchannel_" << fChNumber
                << "_" << opdetType
                << "_" << hist_id;
 
-      fStartTime = wvf.TimeStamp(); //in us
-      if (opdetElectronics == "daphne"){
-				fEndTime = double(wvf.size()) / fSampling_Daphne + fStartTime;
-			} //in us
-			else{
-        fEndTime = double(wvf.size()) / fSampling + fStartTime;
-      } //in us
-
-      //Create a new histogram
-      TH1D *wvfHist = tfs->make< TH1D >(histname.str().c_str(), TString::Format(";t - %f (#mus);", fStartTime), wvf.size(), fStartTime, fEndTime);
-      for(unsigned int i = 0; i < wvf.size(); i++) {
-        wvfHist->SetBinContent(i + 1, (double)wvf[i]);
+      double const sampling = (opdetElectronics == "daphne") ? fSampling_Daphne : fSampling; // MHz
+      fStartTime = wvf.TimeStamp() + double(first) / sampling; //in us
+      size_t const nBins = (last - first + fDownsample - 1) / fDownsample;
+      fEndTime = double(nBins*fDownsample) / sampling + fStartTime; //in us
+
+      //Create a new histogram, each bin the average of fDownsample samples
+      TH1D *wvfHist = tfs->make< TH1D >(histname.str().c_str(), TString::Format(";t - %f (#mus);", fStartTime), nBins, fStartTime, fEndTime);
+      for(size_t bin = 0; bin < nBins; bin++) {
+        size_t const begin = first + bin*fDownsample;
+        size_t const end = std::min(begin + fDownsample, last);
+        double sum = 0.;
+        for(size_t i = begin; i < end; i++) sum += wvf[i];
+        wvfHist->SetBinContent(bin + 1, sum / (end - begin));
       }
       hist_id++;
     }
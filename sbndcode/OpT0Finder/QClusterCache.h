@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   QClusterCache.h
+///
+/// \brief  Service sharing the charge clusters built by the
+///         SBNDOpT0Finder instances of a job.
+///
+/// Jobs running the flash matching with several configurations (e.g. the
+/// same slices matched to the flashes of different producers or with
+/// different matching algorithms) build the same light clusters from the
+/// same slices, tracks, showers and hits in each instance. An instance
+/// stores what it built under a key describing its inputs and charge
+/// settings (producer labels, which carry the SCE choice, TPC, conversion
+/// constants...); the next instance with the same key for the same event
+/// takes it from here instead.
+///
+/// FCL parameters:
+///
+/// MaxEvents    - Number of most recent events whose entries are kept
+///                (default: 4, enough for the events in flight of a
+///                multithreaded job).
+/// PrintSummary - Print the numbers of reused and built entries at the end
+///                of the job (default: true).
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_OPT0FINDER_QCLUSTERCACHE_H
+#define SBNDCODE_OPT0FINDER_QCLUSTERCACHE_H
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+
+namespace sbnd {
+  class QClusterCache {
+  public:
+
+    QClusterCache(const fhicl::ParameterSet& pset,
+                  art::ActivityRegistry& reg);
+
+    /// The entry of key for event, made with make() (returning a
+    /// std::shared_ptr<T const>) if no instance stored one yet. Two
+    /// instances missing at the same time both make it, and the first one
+    /// stored is kept.
+    template <typename T, typename Make>
+    std::shared_ptr<T const> Get(art::EventID const& event, std::string const& key, Make make);
+
+  private:
+
+    using Entries_t = std::map<std::string, std::shared_ptr<void const>>;
+
+    std::shared_ptr<void const> Find(art::EventID const& event, std::string const& key);
+    std::shared_ptr<void const> Insert(art::EventID const& event, std::string const& key,
+                                       std::shared_ptr<void const> entry);
+
+    void postEndJob();
+
+    std::size_t fMaxEvents;
+    bool        fPrintSummary;
+
+    std::mutex fMutex;
+    std::deque<std::pair<art::EventID, Entries_t>> fEvents; ///< most recent last
+    std::size_t fNReused = 0;
+    std::size_t fNBuilt = 0;
+  };
+} // namespace sbnd
+
+//----------------------------------------------------------------------
+template <typename T, typename Make>
+std::shared_ptr<T const> sbnd::QClusterCache::Get(art::EventID const& event, std::string const& key, Make make)
+{
+  // the type is part of the key, so that an entry is never read as another type
+  std::string const fullKey = std::string(typeid(T).name()) + "|" + key;
+  if (auto entry = Find(event, fullKey)) return std::static_pointer_cast<T const>(entry);
+  std::shared_ptr<T const> made = make();
+  return std::static_pointer_cast<T const>(Insert(event, fullKey, std::move(made)));
+}
+
+DECLARE_ART_SERVICE(sbnd::QClusterCache, SHARED)
+
+#endif // SBNDCODE_OPT0FINDER_QCLUSTERCACHE_H
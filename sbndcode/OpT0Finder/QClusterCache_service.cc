@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   QClusterCache_service.cc
+///
+/// \brief  Shares the charge clusters of the SBNDOpT0Finder instances.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/OpT0Finder/QClusterCache.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+#include <iterator>
+
+//----------------------------------------------------------------------
+sbnd::QClusterCache::QClusterCache(const fhicl::ParameterSet& pset,
+                                   art::ActivityRegistry& reg)
+  : fMaxEvents(std::max<std::size_t>(1, pset.get<std::size_t>("MaxEvents", 4)))
+  , fPrintSummary(pset.get<bool>("PrintSummary", true))
+{
+  reg.sPostEndJob.watch(this, &QClusterCache::postEndJob);
+}
+
+//----------------------------------------------------------------------
+std::shared_ptr<void const> sbnd::QClusterCache::Find(art::EventID const& event, std::string const& key)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  for (auto const& [id, entries] : fEvents) {
+    if (id != event) continue;
+    auto const it = entries.find(key);
+    if (it == entries.end()) break;
+    ++fNReused;
+    return it->second;
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------
+std::shared_ptr<void const> sbnd::QClusterCache::Insert(art::EventID const& event, std::string const& key,
+                                                        std::shared_ptr<void const> entry)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto it = std::find_if(fEvents.begin(), fEvents.end(),
+                         [&event](auto const& events) { return events.first == event; });
+  if (it == fEvents.end()) {
+    if (fEvents.size() >= fMaxEvents) fEvents.pop_front();
+    fEvents.emplace_back(event, Entries_t{});
+    it = std::prev(fEvents.end());
+  }
+  auto const [stored, inserted] = it->second.emplace(key, std::move(entry));
+  if (inserted) ++fNBuilt;
+  else          ++fNReused;
+  return stored->second;
+}
+
+//----------------------------------------------------------------------
+void sbnd::QClusterCache::postEndJob()
+{
+  if (!fPrintSummary) return;
+  mf::LogInfo("QClusterCache")
+    << "Charge clusters built: " << fNBuilt << ", reused: " << fNReused;
+}
+
+DEFINE_ART_SERVICE(sbnd::QClusterCache)
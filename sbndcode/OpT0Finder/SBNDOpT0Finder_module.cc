@@ -48,6 +48,8 @@
 #include "sbncode/OpT0Finder/flashmatch/Algorithms/PhotonLibHypothesis.h"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpT0Finder/QClusterCache.h"
+#include "sbndcode/OpT0Finder/VisibilityCache.h"
 #include "sbnobj/Common/Reco/OpT0FinderResult.h"
 
 #include "TFile.h"
@@ -56,6 +58,11 @@
 #include <memory>
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "tbb/parallel_for.h"
 
 
 
@@ -100,6 +107,36 @@ private:
   /// Returns a list of uncoated PMTs that are a subset of those in ch_to_use
   std::vector<int> GetUncoatedPMTList(std::vector<int> ch_to_use);
 
+  /// Returns a per opch mask with the channels in ch_v set
+  std::vector<bool> ChannelMask(std::vector<int> const& ch_v, size_t nopdets) const;
+
+  /// Removes the flashes and clusters that cannot be paired with any of the others
+  void PruneCandidates(std::vector<::flashmatch::Flash_t>& flash_v, double drift_velocity);
+
+  /// Returns the visibility cache, building (or loading) it on first use
+  sbnd::VisibilityCache const& GetVisibilityCache();
+
+  /// Fills the PE hypotheses of all the light clusters from the visibility cache,
+  /// one row of NOpDets values per cluster
+  void VisibilityHypotheses(std::vector<flashmatch::QCluster_t> const& cluster_v, std::vector<double>& hypo_m);
+
+  /// Charge deposits of one slice, for its light cluster and the deposition tree
+  struct SliceDeposits_t {
+    flashmatch::QCluster_t light_cluster;
+    std::vector<int> exit_opch; ///< opch near the exit point for uncontained tracks
+    std::vector<float> dep_x, dep_y, dep_z, dep_E, dep_charge, dep_photons, dep_pitch;
+    std::vector<int> dep_pfpid;
+    std::vector<int> dep_trk;
+  };
+
+  /// Collects the charge deposits of the slices to match in a TPC
+  std::vector<SliceDeposits_t> SliceDeposits(art::Event& e, unsigned int tpc,
+    ::art::Handle<std::vector<recob::Slice>> const& slice_h,
+    ::art::Handle<std::vector<recob::PFParticle>> const& pfp_h,
+    ::art::Handle<std::vector<recob::SpacePoint>> const& spacepoint_h,
+    ::art::Handle<std::vector<recob::Track>> const& trk_h,
+    ::art::Handle<std::vector<recob::Shower>> const& shw_h);
+
   std::unique_ptr<phot::SemiAnalyticalModel> _semi_model;
   fhicl::ParameterSet _vuv_params;
   fhicl::ParameterSet _vis_params;
@@ -123,6 +160,23 @@ private:
   bool _collection_only;
   std::vector<float> _cal_area_const; 
   std::vector<int>   _opch_to_skip;
+  std::vector<bool>  _opch_skip_mask; ///< true for the opch in _opch_to_skip
+  std::vector<bool>  _xara_opch_mask; ///< true for the xARAPUCA opch
+  bool  _use_slice_workers;
+  bool  _share_qclusters; ///< shares the slice deposits with the other instances through QClusterCache
+  std::string _qcluster_key; ///< inputs and charge settings the slice deposits depend on
+
+  bool   _prune_pairs;      ///< drop flashes and slices that cannot be matched before the matching
+  double _prune_x_tolerance; ///< slack on the drift range of a slice shifted to the flash time [cm]
+  double _prune_min_pe_ratio; ///< range of flash PE over slice photons of a possible match
+  double _prune_max_pe_ratio;
+
+  bool _use_vis_cache; ///< prune on flash PE over the cached visibility hypothesis instead of slice photons
+  double _vis_voxel_size; ///< voxel size of the visibility cache [cm]
+  std::string _vis_cache_dir; ///< shared area for the visibility cache files, empty to keep it in memory
+  std::vector<double> _vuv_eff_v; ///< opdet efficiencies for direct light
+  std::vector<double> _vis_eff_v; ///< opdet efficiencies for reflected light
+  std::unique_ptr<sbnd::VisibilityCache> _vis_cache;
   float _dQdx_limit;
   float _pitch_limit;
 
@@ -198,6 +252,25 @@ SBNDOpT0Finder::SBNDOpT0Finder(fhicl::ParameterSet const& p)
   _collection_only   = p.get<bool>("CollectionPlaneOnly");
   _cal_area_const    = p.get<std::vector<float>>("CalAreaConstants");
   _opch_to_skip      = p.get<std::vector<int>>("OpChannelsToSkip");
+  _opch_skip_mask    = this->ChannelMask(_opch_to_skip, geo->NOpDets());
+  _xara_opch_mask    = this->ChannelMask(this->PDNamesToList({"xarapuca_vis","xarapuca_vuv"}), geo->NOpDets());
+  _use_slice_workers = p.get<bool>("UseSliceWorkers", false);
+  _share_qclusters   = p.get<bool>("ShareQClusters", false);
+
+  _prune_pairs        = p.get<bool>("PruneIncompatiblePairs", false);
+  _prune_x_tolerance  = p.get<double>("PruneXTolerance", 10.);
+  _prune_min_pe_ratio = p.get<double>("PruneMinPERatio", 0.);
+  _prune_max_pe_ratio = p.get<double>("PruneMaxPERatio", std::numeric_limits<double>::max());
+
+  _use_vis_cache  = p.get<bool>("UseVisibilityCache", false);
+  _vis_voxel_size = p.get<double>("VisibilityVoxelSize", 10.);
+  _vis_cache_dir  = p.get<std::string>("VisibilityCacheDir", "");
+  // same efficiencies as the hypothesis of the matching, when given there
+  auto const hypo_pset = p.get<fhicl::ParameterSet>("FlashMatchConfig").get<fhicl::ParameterSet>("PhotonLibHypothesis", {});
+  _vuv_eff_v = hypo_pset.get<std::vector<double>>("VUVEfficiency", std::vector<double>(geo->NOpDets(), 1.));
+  _vis_eff_v = hypo_pset.get<std::vector<double>>("VISEfficiency", std::vector<double>(geo->NOpDets(), 1.));
+  _vuv_eff_v.resize(geo->NOpDets(), 0.);
+  _vis_eff_v.resize(geo->NOpDets(), 0.);
   _dQdx_limit        = p.get<float>("dQdxLimit");
   _pitch_limit       = p.get<float>("PitchLimit");
 
@@ -208,6 +281,17 @@ SBNDOpT0Finder::SBNDOpT0Finder(fhicl::ParameterSet const& p)
   _track_to_photons  = p.get<float>("ChargeToNPhotonsTrack");
   _shower_to_photons = p.get<float>("ChargeToNPhotonsShower");
 
+  // everything the slice deposits depend on besides the event; the labels
+  // tell the SCE corrected inputs from the uncorrected ones
+  if (_share_qclusters) {
+    std::ostringstream key;
+    key << std::hexfloat << _slice_producer << '|' << _trk_producer << '|' << _shw_producer << '|' << _calo_producer
+        << '|' << _select_nus << _collection_only << _exclude_exiting << _use_arapucas
+        << _track_const_conv << _shower_const_conv
+        << '|' << _dQdx_limit << '|' << _pitch_limit << '|' << _track_to_photons << '|' << _shower_to_photons;
+    for (float c : _cal_area_const) key << '|' << c;
+    _qcluster_key = key.str();
+  }
 
   if (_tpc_v.size() != _opflash_producer_v.size()) {
     throw cet::exception("SBNDOpT0Finder")
@@ -398,7 +482,6 @@ void SBNDOpT0Finder::DoMatch(art::Event& e,
     }
   }
   int nflashes_tot = (_use_arapucas)? flash_comb_v.size():flash_pmt_v.size(); 
-  auto xara_opch = PDNamesToList({"xarapuca_vis","xarapuca_vuv"}); 
 
   for (int n = 0; n < nflashes_tot; n++) {
 
@@ -422,9 +505,9 @@ void SBNDOpT0Finder::DoMatch(art::Event& e,
     f.pds_mask_v.resize(geo->NOpDets(), 0);
 
     for (unsigned int op_ch = 0; op_ch < f.pe_v.size(); op_ch++) {
-      bool skip = std::find(_opch_to_skip.begin(), _opch_to_skip.end(), op_ch) != _opch_to_skip.end(); 
-      bool skip_ara = ((_use_arapucas == false) && (std::find(xara_opch.begin(), xara_opch.end(), op_ch) != xara_opch.end()));
-      bool skip_combine = ((_use_arapucas) && (combine_v.at(n) == false) && (std::find(xara_opch.begin(), xara_opch.end(), op_ch) != xara_opch.end())); 
+      bool skip = _opch_skip_mask[op_ch];
+      bool skip_ara = ((_use_arapucas == false) && _xara_opch_mask[op_ch]);
+      bool skip_combine = ((_use_arapucas) && (combine_v.at(n) == false) && _xara_opch_mask[op_ch]);
       if (skip || skip_ara || skip_combine ){
         f.pds_mask_v.at(op_ch) = 1;
         f.pe_v[op_ch] = 0.;
@@ -476,6 +559,19 @@ void SBNDOpT0Finder::DoMatch(art::Event& e,
     return;
   }
 
+  // Drop the candidates that cannot be part of any match
+  if (_prune_pairs) {
+    auto const clock_data = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
+    auto const det_prop = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e, clock_data);
+    PruneCandidates(all_flashes, det_prop.DriftVelocity());
+    if (all_flashes.empty() || _light_cluster_v.empty()) {
+      mf::LogInfo("SBNDOpT0Finder") << "No compatible flash-slice pairs in TPC " << tpc << "." << std::endl;
+      _matchid = -4;
+      _tree2->Fill();
+      return;
+    }
+  }
+
   // Emplace flashes to Flash Matching Manager
   for (auto f : all_flashes) {
     _mgr.Emplace(std::move(f));
@@ -489,6 +585,16 @@ void SBNDOpT0Finder::DoMatch(art::Event& e,
   // Run the matching
   _result_v = _mgr.Match();
 
+  ::art::Handle<std::vector<recob::Slice>> slice_h;
+  e.getByLabel(_slice_producer, slice_h);
+  if(!slice_h.isValid() || slice_h->empty()) {
+    mf::LogWarning("SBNDOpT0Finder") << "Don't have good Slices." << std::endl;
+  }
+  // Construct the vector of Slices
+  std::vector<art::Ptr<recob::Slice>> slice_v;
+  art::fill_ptr_vector(slice_v, slice_h);
+  art::FindManyP<recob::PFParticle> slice_to_pfps (slice_h, e, _slice_producer);
+
   // Loop over the matching results
   for(_matchid = 0; _matchid < (int)(_result_v.size()); ++_matchid) {
 
@@ -546,15 +652,6 @@ void SBNDOpT0Finder::DoMatch(art::Event& e,
     int slice_id = ptr_slice->ID();
     _sliceid = slice_id;
 
-    ::art::Handle<std::vector<recob::Slice>> slice_h;
-    e.getByLabel(_slice_producer, slice_h);
-    if(!slice_h.isValid() || slice_h->empty()) {
-      mf::LogWarning("SBNDOpT0Finder") << "Don't have good Slices." << std::endl;
-          }
-    // Construct the vector of Slices
-    std::vector<art::Ptr<recob::Slice>> slice_v;
-    art::fill_ptr_vector(slice_v, slice_h);
-    art::FindManyP<recob::PFParticle> slice_to_pfps (slice_h, e, _slice_producer);
     for (size_t n_slice = 0; n_slice < slice_h->size(); n_slice++) {
       auto slice = slice_v[n_slice];
       if (slice->ID() != _sliceid) continue;
@@ -580,11 +677,6 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
 
   _light_cluster_v.clear();
 
-  auto const clock_data = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
-  auto const det_prop = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e, clock_data);
-  art::ServiceHandle<sim::LArG4Parameters const> g4param;
-  ::art::ServiceHandle<geo::Geometry> geo;
-
   ::art::Handle<std::vector<recob::Slice>> slice_h;
   e.getByLabel(_slice_producer, slice_h);
   if(!slice_h.isValid() || slice_h->empty()) {
@@ -616,6 +708,69 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
   std::vector<art::Ptr<recob::Slice>> slice_v;
   art::fill_ptr_vector(slice_v, slice_h);
 
+  // The deposits only depend on the input products and on the charge
+  // settings, so instances with the same ones share them through QClusterCache
+  auto const build = [&]() {
+    return std::make_shared<std::vector<SliceDeposits_t> const>(
+      SliceDeposits(e, tpc, slice_h, pfp_h, spacepoint_h, trk_h, shw_h));
+  };
+  std::shared_ptr<std::vector<SliceDeposits_t> const> const deps_v = _share_qclusters
+    ? art::ServiceHandle<sbnd::QClusterCache>()->Get<std::vector<SliceDeposits_t>>(
+        e.id(), _qcluster_key + "|tpc " + std::to_string(tpc), build)
+    : build();
+  size_t const n_slices = deps_v->size();
+
+  // Loop over the Slices
+  for (size_t n_slice = 0; n_slice < n_slices; n_slice++) {
+    auto const& deps = (*deps_v)[n_slice];
+    auto const& light_cluster = deps.light_cluster;
+
+    _dep_slice.assign(deps.dep_x.size(), n_slice);
+    _dep_pfpid   = deps.dep_pfpid;
+    _dep_x       = deps.dep_x;
+    _dep_y       = deps.dep_y;
+    _dep_z       = deps.dep_z;
+    _dep_E       = deps.dep_E;
+    _dep_charge  = deps.dep_charge;
+    _dep_photons = deps.dep_photons;
+    _dep_pitch   = deps.dep_pitch;
+    _dep_trk     = deps.dep_trk;
+
+    _tree1->Fill();
+
+    // Don't include clusters with zero points
+    if (!light_cluster.size()) {
+      continue;
+    }
+
+    // Save the light cluster, and remember the correspondance from index to slice
+    _clusterid_to_slice[_light_cluster_v.size()] = slice_v.at(n_slice);
+
+    _light_cluster_v.push_back(light_cluster);
+
+    if (!deps.exit_opch.empty()){
+      std::cout << "Not evaluating the following OpDets due to exiting particle: { ";
+      for (auto opch : deps.exit_opch)
+          std::cout << opch << ' ';
+      std::cout << "}\n";
+    }
+  } // End loop over Slices
+
+  return true;
+}
+
+std::vector<SBNDOpT0Finder::SliceDeposits_t> SBNDOpT0Finder::SliceDeposits(art::Event& e, unsigned int tpc,
+  ::art::Handle<std::vector<recob::Slice>> const& slice_h,
+  ::art::Handle<std::vector<recob::PFParticle>> const& pfp_h,
+  ::art::Handle<std::vector<recob::SpacePoint>> const& spacepoint_h,
+  ::art::Handle<std::vector<recob::Track>> const& trk_h,
+  ::art::Handle<std::vector<recob::Shower>> const& shw_h) {
+
+  auto const clock_data = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(e);
+  auto const det_prop = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(e, clock_data);
+  art::ServiceHandle<sim::LArG4Parameters const> g4param;
+  ::art::ServiceHandle<geo::Geometry> geo;
+
   // Get the associations between slice->pfp->spacepoint->hit
   art::FindManyP<recob::PFParticle> slice_to_pfps (slice_h, e, _slice_producer);
   // For using track calorimetry objects, get slice->pfp->track->calo 
@@ -628,38 +783,32 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
   art::FindManyP<recob::SpacePoint> shw_to_spacepoints(shw_h, e, _shw_producer);
   art::FindManyP<recob::Hit> spacepoint_to_hits (spacepoint_h, e, _slice_producer);
 
-  // Loop over the Slices
-  for (size_t n_slice = 0; n_slice < slice_h->size(); n_slice++) {
-    flashmatch::QCluster_t light_cluster;
-    light_cluster.tpc_mask_v.resize(geo->NOpDets(), 0);
-
-    _dep_slice.clear();
-    _dep_pfpid.clear();
-    _dep_x.clear();
-    _dep_y.clear();
-    _dep_z.clear();
-    _dep_E.clear();
-    _dep_charge.clear();
-    _dep_photons.clear();
-    _dep_pitch.clear();
-    _dep_trk.clear();
-
-    std::vector<int> exit_opch; // mask of opch near the exit point for uncontained tracks
-
-    // Get the associated PFParticles
-    std::vector<art::Ptr<recob::PFParticle>> pfp_v = slice_to_pfps.at(n_slice);
-
-    if (_select_nus){
+  // When selecting neutrinos, use the slices before the first one without a neutrino PFParticle
+  size_t n_slices = slice_h->size();
+  if (_select_nus){
+    for (size_t n_slice = 0; n_slice < slice_h->size(); n_slice++) {
       bool nu_pfp = false;
-      for (size_t n_pfp = 0; n_pfp < pfp_v.size(); n_pfp++) {
-        auto pfp = pfp_v[n_pfp];
+      for (auto const& pfp : slice_to_pfps.at(n_slice)) {
         unsigned pfpPDGC = std::abs(pfp->PdgCode());
         if ((pfpPDGC == 12) || (pfpPDGC == 14) || (pfpPDGC == 16))
           nu_pfp = true;
       }
-      if (nu_pfp == false)
+      if (nu_pfp == false) {
+        n_slices = n_slice;
         break;
+      }
     }
+  }
+
+  // Collect the deposits of one slice; slices do not share anything but the event data
+  auto fillSliceDeposits = [&](size_t n_slice, SliceDeposits_t& deps) {
+    flashmatch::QCluster_t& light_cluster = deps.light_cluster;
+    light_cluster.tpc_mask_v.resize(geo->NOpDets(), 0);
+
+    std::vector<int>& exit_opch = deps.exit_opch; // mask of opch near the exit point for uncontained tracks
+
+    // Get the associated PFParticles
+    std::vector<art::Ptr<recob::PFParticle>> pfp_v = slice_to_pfps.at(n_slice);
 
     for (size_t n_pfp = 0; n_pfp < pfp_v.size(); n_pfp++) {
 
@@ -769,16 +918,15 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
                 trk_val = 0;
               }
               // Fill tree variables 
-              _dep_slice.push_back(n_slice);
-              _dep_pfpid.push_back(pfp->Self());
-              _dep_x.push_back(position.X());
-              _dep_y.push_back(position.Y());
-              _dep_z.push_back(position.Z());
-              _dep_E.push_back(dE);
-              _dep_charge.push_back(dQ);
-              _dep_photons.push_back(nphotons);
-              _dep_pitch.push_back(pitch);
-              _dep_trk.push_back(trk_val);
+              deps.dep_pfpid.push_back(pfp->Self());
+              deps.dep_x.push_back(position.X());
+              deps.dep_y.push_back(position.Y());
+              deps.dep_z.push_back(position.Z());
+              deps.dep_E.push_back(dE);
+              deps.dep_charge.push_back(dQ);
+              deps.dep_photons.push_back(nphotons);
+              deps.dep_pitch.push_back(pitch);
+              deps.dep_trk.push_back(trk_val);
 
               // emplace this point into the light cluster 
               light_cluster.emplace_back(position.X(),
@@ -824,16 +972,15 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
                                           nphotons);
 
                 // Also save the quantites for the output tree
-                _dep_slice.push_back(n_slice);
-                _dep_pfpid.push_back(pfp->Self());
-                _dep_x.push_back(position[0]);
-                _dep_y.push_back(position[1]);
-                _dep_z.push_back(position[2]);
-                _dep_E.push_back(-1.);
-                _dep_charge.push_back(charge);
-                _dep_photons.push_back(nphotons);
-                _dep_pitch.push_back(-1.);
-                _dep_trk.push_back(0);
+                deps.dep_pfpid.push_back(pfp->Self());
+                deps.dep_x.push_back(position[0]);
+                deps.dep_y.push_back(position[1]);
+                deps.dep_z.push_back(position[2]);
+                deps.dep_E.push_back(-1.);
+                deps.dep_charge.push_back(charge);
+                deps.dep_photons.push_back(nphotons);
+                deps.dep_pitch.push_back(-1.);
+                deps.dep_trk.push_back(0);
               }
             }  // End loop over Spacepoints
           } // end trk const conversion 
@@ -890,43 +1037,29 @@ bool SBNDOpT0Finder::ConstructLightClusters(art::Event& e, unsigned int tpc) {
                                         nphotons);
 
               // Also save the quantites for the output tree
-              _dep_slice.push_back(n_slice);
-              _dep_pfpid.push_back(pfp->Self());
-              _dep_x.push_back(position[0]);
-              _dep_y.push_back(position[1]);
-              _dep_z.push_back(position[2]);
-              _dep_E.push_back(-1.);
-              _dep_charge.push_back(charge);
-              _dep_photons.push_back(nphotons);
-              _dep_pitch.push_back(-1.);
-              _dep_trk.push_back(2);
+              deps.dep_pfpid.push_back(pfp->Self());
+              deps.dep_x.push_back(position[0]);
+              deps.dep_y.push_back(position[1]);
+              deps.dep_z.push_back(position[2]);
+              deps.dep_E.push_back(-1.);
+              deps.dep_charge.push_back(charge);
+              deps.dep_photons.push_back(nphotons);
+              deps.dep_pitch.push_back(-1.);
+              deps.dep_trk.push_back(2);
             }
           } // End loop over Spacepoints
         } // end shower loop
       } // end if pfpisshower
     } // End loop over PFParticle
+  }; // End of the slice deposits
 
-    _tree1->Fill();
-
-    // Don't include clusters with zero points
-    if (!light_cluster.size()) {
-      continue;
-    }
-
-    // Save the light cluster, and remember the correspondance from index to slice
-    _clusterid_to_slice[_light_cluster_v.size()] = slice_v.at(n_slice);
-
-    _light_cluster_v.emplace_back(light_cluster);
+  std::vector<SliceDeposits_t> deps_v(n_slices);
+  if (_use_slice_workers)
+    tbb::parallel_for(std::size_t(0), n_slices, [&](std::size_t n_slice) { fillSliceDeposits(n_slice, deps_v[n_slice]); });
+  else
+    for (size_t n_slice = 0; n_slice < n_slices; n_slice++) fillSliceDeposits(n_slice, deps_v[n_slice]);
 
-    if (!exit_opch.empty()){
-      std::cout << "Not evaluating the following OpDets due to exiting particle: { ";
-      for (auto opch : exit_opch)
-          std::cout << opch << ' ';
-      std::cout << "}\n";
-    }
-  } // End loop over Slices
-
-  return true;
+  return deps_v;
 }
 
 std::vector<int> SBNDOpT0Finder::PDNamesToList(std::vector<std::string> pd_names) {
@@ -979,6 +1112,174 @@ std::vector<int> SBNDOpT0Finder::GetUncoatedPMTList(std::vector<int> ch_to_use)
   return out_v;
 }
 
+std::vector<bool> SBNDOpT0Finder::ChannelMask(std::vector<int> const& ch_v, size_t nopdets) const {
+  std::vector<bool> mask(nopdets, false);
+  for (auto ch : ch_v) {
+    if (ch >= 0 && size_t(ch) < nopdets) mask[ch] = true;
+  }
+  return mask;
+}
+
+void SBNDOpT0Finder::PruneCandidates(std::vector<::flashmatch::Flash_t>& flash_v, double drift_velocity) {
+
+  ::art::ServiceHandle<geo::Geometry> geo;
+  double const anode_x = 2.0*geo->DetHalfWidth();
+
+  // Drift range and light of each slice, total PE of each flash
+  std::vector<double> min_x_v(_light_cluster_v.size(), std::numeric_limits<double>::max());
+  std::vector<double> max_x_v(_light_cluster_v.size(), std::numeric_limits<double>::lowest());
+  std::vector<double> photons_v(_light_cluster_v.size(), 0.);
+  for (size_t ic = 0; ic < _light_cluster_v.size(); ic++) {
+    for (auto const& pt : _light_cluster_v[ic]) {
+      min_x_v[ic] = std::min(min_x_v[ic], std::abs(pt.x));
+      max_x_v[ic] = std::max(max_x_v[ic], std::abs(pt.x));
+      photons_v[ic] += pt.q;
+    }
+  }
+  // with the cache, compare to the PE expected on the channels in use instead,
+  // from the hypotheses of all the slices made at once
+  if (_use_vis_cache) {
+    std::vector<double> hypo_m;
+    VisibilityHypotheses(_light_cluster_v, hypo_m);
+    size_t const nopdets = _light_cluster_v.empty() ? 0 : hypo_m.size()/_light_cluster_v.size();
+    for (size_t ic = 0; ic < _light_cluster_v.size(); ic++) {
+      double const* hypo_v = hypo_m.data() + ic*nopdets;
+      photons_v[ic] = 0.;
+      for (auto opch : _opch_to_use) {
+        if (opch < 0 || size_t(opch) >= nopdets) continue;
+        if (_opch_skip_mask[opch] || _light_cluster_v[ic].tpc_mask_v.at(opch)) continue;
+        photons_v[ic] += hypo_v[opch];
+      }
+    }
+  }
+  std::vector<double> flash_pe_v(flash_v.size(), 0.);
+  for (size_t iflash = 0; iflash < flash_v.size(); iflash++) {
+    for (auto const& pe : flash_v[iflash].pe_v) flash_pe_v[iflash] += pe;
+  }
+
+  // A slice made at the flash time sits further from the anode by the drift in that time;
+  // it has to fit in the TPC, and the flash light has to be in range for the slice charge
+  auto compatible = [&](size_t iflash, size_t ic) {
+    double const shift = drift_velocity*flash_v[iflash].time;
+    if (min_x_v[ic] + shift < -_prune_x_tolerance) return false;
+    if (max_x_v[ic] + shift > anode_x + _prune_x_tolerance) return false;
+    if (photons_v[ic] <= 0.) return true;
+    double const pe_ratio = flash_pe_v[iflash]/photons_v[ic];
+    return _prune_min_pe_ratio <= pe_ratio && pe_ratio <= _prune_max_pe_ratio;
+  };
+
+  // Keep each candidate that has at least one possible partner
+  std::vector<bool> keep_flash(flash_v.size(), false);
+  std::vector<bool> keep_cluster(_light_cluster_v.size(), false);
+  for (size_t iflash = 0; iflash < flash_v.size(); iflash++) {
+    for (size_t ic = 0; ic < _light_cluster_v.size(); ic++) {
+      if (keep_flash[iflash] && keep_cluster[ic]) continue;
+      if (!compatible(iflash, ic)) continue;
+      keep_flash[iflash] = true;
+      keep_cluster[ic] = true;
+    }
+  }
+
+  // Compact both lists and their maps to the art objects, the indices are the match ids
+  std::vector<::flashmatch::Flash_t> pruned_flash_v;
+  std::map<int, art::Ptr<recob::OpFlash>> flashid_to_opflash;
+  for (size_t iflash = 0; iflash < flash_v.size(); iflash++) {
+    if (!keep_flash[iflash]) continue;
+    flashid_to_opflash[pruned_flash_v.size()] = _flashid_to_opflash[iflash];
+    pruned_flash_v.push_back(std::move(flash_v[iflash]));
+    pruned_flash_v.back().idx = pruned_flash_v.size()-1;
+  }
+  std::vector<flashmatch::QCluster_t> pruned_cluster_v;
+  std::map<int, art::Ptr<recob::Slice>> clusterid_to_slice;
+  for (size_t ic = 0; ic < _light_cluster_v.size(); ic++) {
+    if (!keep_cluster[ic]) continue;
+    clusterid_to_slice[pruned_cluster_v.size()] = _clusterid_to_slice[ic];
+    pruned_cluster_v.push_back(std::move(_light_cluster_v[ic]));
+  }
+
+  mf::LogInfo("SBNDOpT0Finder") << "Pruned " << flash_v.size() - pruned_flash_v.size() << " of " << flash_v.size()
+                                << " flashes and " << _light_cluster_v.size() - pruned_cluster_v.size() << " of "
+                                << _light_cluster_v.size() << " slices without a compatible partner" << std::endl;
+
+  flash_v = std::move(pruned_flash_v);
+  _flashid_to_opflash = std::move(flashid_to_opflash);
+  _light_cluster_v = std::move(pruned_cluster_v);
+  _clusterid_to_slice = std::move(clusterid_to_slice);
+}
+
+sbnd::VisibilityCache const& SBNDOpT0Finder::GetVisibilityCache() {
+
+  if (_vis_cache) return *_vis_cache;
+
+  ::art::ServiceHandle<geo::Geometry> geo;
+
+  sbnd::VisibilityCache::Grid_t grid;
+  grid.Min = { -2.0*geo->DetHalfWidth(), -geo->DetHalfHeight(), 0. };
+  grid.Max = { +2.0*geo->DetHalfWidth(), +geo->DetHalfHeight(), geo->DetLength() };
+  grid.Step = _vis_voxel_size;
+  grid.NOpDets = geo->NOpDets();
+
+  // the file is only valid for the same detector, grid and model
+  std::uint64_t fingerprint = sbnd::VisibilityCache::Checksum(geo->DetectorName());
+  fingerprint = sbnd::VisibilityCache::Checksum(_vuv_params.to_string(), fingerprint);
+  fingerprint = sbnd::VisibilityCache::Checksum(_vis_params.to_string(), fingerprint);
+  fingerprint = sbnd::VisibilityCache::Checksum("reflected:1 anode:0 step:" + std::to_string(grid.Step)
+                                                + " opdets:" + std::to_string(grid.NOpDets), fingerprint);
+
+  // the model moved to the manager is not ours to use, this one only builds the table
+  // and is only read while doing so
+  phot::SemiAnalyticalModel const model(_vuv_params, _vis_params, true, false);
+  auto compute = [&model](double x, double y, double z,
+                          std::vector<double>& direct, std::vector<double>& reflected) {
+    geo::Point_t const point{ x, y, z };
+    model.detectedDirectVisibilities(direct, point);
+    model.detectedReflectedVisibilities(reflected, point, false);
+  };
+
+  _vis_cache = std::make_unique<sbnd::VisibilityCache>(grid, fingerprint, _vis_cache_dir, "opt0_visibility",
+                                                       compute, true);
+  mf::LogInfo("SBNDOpT0Finder") << "Visibility cache of " << _vis_cache->NVoxels() << " voxels "
+                                << (_vis_cache->FromFile() ? "read from " : "computed ")
+                                << _vis_cache->Path() << std::endl;
+  return *_vis_cache;
+}
+
+void SBNDOpT0Finder::VisibilityHypotheses(std::vector<flashmatch::QCluster_t> const& cluster_v, std::vector<double>& hypo_m) {
+
+  auto const& cache = GetVisibilityCache();
+  size_t const nopdets = cache.NOpDets();
+  hypo_m.assign(cluster_v.size()*nopdets, 0.);
+
+  // The charge of a cluster is summed by voxel first, so that each voxel row of the
+  // table is read once per cluster; the efficiencies are applied once per channel
+  std::vector<std::pair<size_t, double>> voxel_q;
+  std::vector<double> direct_sum(nopdets), reflected_sum(nopdets);
+  for (size_t ic = 0; ic < cluster_v.size(); ic++) {
+    voxel_q.clear();
+    for (auto const& pt : cluster_v[ic]) voxel_q.emplace_back(cache.Voxel(pt.x, pt.y, pt.z), pt.q);
+    std::sort(voxel_q.begin(), voxel_q.end(),
+              [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    std::fill(direct_sum.begin(), direct_sum.end(), 0.);
+    std::fill(reflected_sum.begin(), reflected_sum.end(), 0.);
+    for (size_t i = 0; i < voxel_q.size();) {
+      size_t const voxel = voxel_q[i].first;
+      double q = 0.;
+      for (; i < voxel_q.size() && voxel_q[i].first == voxel; i++) q += voxel_q[i].second;
+      float const* direct = cache.Direct(voxel);
+      float const* reflected = cache.Reflected(voxel);
+      for (size_t opch = 0; opch < nopdets; opch++) {
+        direct_sum[opch] += q * direct[opch];
+        reflected_sum[opch] += q * reflected[opch];
+      }
+    }
+
+    double* hypo_v = hypo_m.data() + ic*nopdets;
+    for (size_t opch = 0; opch < nopdets; opch++)
+      hypo_v[opch] = _vuv_eff_v[opch]*direct_sum[opch] + _vis_eff_v[opch]*reflected_sum[opch];
+  }
+}
+
 
 
 DEFINE_ART_MODULE(SBNDOpT0Finder)
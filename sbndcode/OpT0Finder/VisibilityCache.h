@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////
+// File:        VisibilityCache.h
+//
+// Voxelized table of the direct (VUV) and reflected (VIS) photon
+// visibilities of every optical detector, as given by the
+// semi-analytical model at the voxel centers.
+//
+// The table is identified by a fingerprint of the geometry, the grid and
+// the model configuration. It is read from <dir>/<prefix>_<fingerprint>.bin
+// and memory-mapped when that file is there, otherwise it is computed once
+// and written there (through a temporary file, so concurrent jobs sharing
+// the area never see a partial table). With no directory it is only kept
+// in memory. A damaged or mismatched file is recomputed.
+//
+// Layout (native byte order):
+//   "SBNDVISC", uint32 version, uint32 number of opdets,
+//   uint32 voxels along x, y, z, uint32 spare, double grid start x, y, z,
+//   double voxel size, uint64 fingerprint, uint64 payload checksum, payload.
+// The payload has, for each voxel (x fastest, then y, then z), the direct
+// visibilities of all the opdets and then the reflected ones, as float.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPT0FINDER_VISIBILITYCACHE_H
+#define SBND_OPT0FINDER_VISIBILITYCACHE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+
+namespace sbnd {
+
+  class VisibilityCache {
+
+  public:
+    // Voxels of size Step from Min up to (at least) Max
+    struct Grid_t {
+      std::array<double, 3> Min;
+      std::array<double, 3> Max;
+      double Step;
+      std::size_t NOpDets;
+    };
+
+    // Direct and reflected visibilities of all the opdets at a point
+    using Compute_t = std::function<void(double x, double y, double z,
+                                         std::vector<double>& direct,
+                                         std::vector<double>& reflected)>;
+
+    static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'V', 'I', 'S', 'C' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kHeaderSize = sizeof(kMagic) + 6*sizeof(std::uint32_t)
+                                             + 4*sizeof(double) + 2*sizeof(std::uint64_t);
+
+    // compute must be callable concurrently when parallel is set
+    VisibilityCache(Grid_t const& grid, std::uint64_t fingerprint,
+                    std::string const& dir, std::string const& prefix,
+                    Compute_t const& compute, bool parallel);
+    ~VisibilityCache();
+
+    VisibilityCache(VisibilityCache const&) = delete;
+    VisibilityCache& operator=(VisibilityCache const&) = delete;
+
+    // 64-bit FNV-1a hash, for the fingerprint and the payload
+    static std::uint64_t Checksum(char const* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ULL);
+    static std::uint64_t Checksum(std::string const& s, std::uint64_t hash = 0xcbf29ce484222325ULL)
+      { return Checksum(s.data(), s.size(), hash); }
+
+    std::size_t NOpDets() const { return fNOpDets; }
+    std::size_t NVoxels() const { return fN[0]*fN[1]*fN[2]; }
+    bool FromFile() const { return fMapped != nullptr; }
+    std::string const& Path() const { return fPath; }
+
+    // Voxel containing the point, the closest one if outside the grid
+    std::size_t Voxel(double x, double y, double z) const;
+    float const* Direct(std::size_t voxel) const { return fTable + 2*voxel*fNOpDets; }
+    float const* Reflected(std::size_t voxel) const { return fTable + (2*voxel + 1)*fNOpDets; }
+
+  private:
+    std::array<double, 3> fMin;
+    std::array<std::size_t, 3> fN;
+    double fStep;
+    std::size_t fNOpDets;
+    std::uint64_t fFingerprint;
+    std::string fPath;
+
+    float const* fTable = nullptr; // either the mapped payload or fBuilt
+    std::vector<float> fBuilt;
+    void* fMapped = nullptr;
+    std::size_t fMappedSize = 0;
+
+    std::size_t PayloadFloats() const { return 2*NVoxels()*fNOpDets; }
+    bool Map();
+    void Build(Compute_t const& compute, bool parallel);
+    bool Write() const;
+  };
+
+} // namespace sbnd
+
+
+inline sbnd::VisibilityCache::VisibilityCache(Grid_t const& grid, std::uint64_t fingerprint,
+                                              std::string const& dir, std::string const& prefix,
+                                              Compute_t const& compute, bool parallel)
+  : fMin(grid.Min)
+  , fStep(grid.Step)
+  , fNOpDets(grid.NOpDets)
+  , fFingerprint(fingerprint)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+    fN[i] = std::max<std::size_t>(1, std::ceil((grid.Max[i] - grid.Min[i])/fStep));
+
+  if (!dir.empty()) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%016llx.bin", (unsigned long long) fFingerprint);
+    fPath = dir + "/" + prefix + name;
+    if (Map()) return;
+  }
+  Build(compute, parallel);
+  if (!fPath.empty()) Write();
+}
+
+inline sbnd::VisibilityCache::~VisibilityCache()
+{
+  if (fMapped) ::munmap(fMapped, fMappedSize);
+}
+
+inline std::uint64_t sbnd::VisibilityCache::Checksum(char const* data, std::size_t size, std::uint64_t hash)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline std::size_t sbnd::VisibilityCache::Voxel(double x, double y, double z) const
+{
+  std::array<double, 3> const pos { x, y, z };
+  std::size_t voxel = 0;
+  for (std::size_t i = 3; i-- > 0; ) {
+    double const bin = std::floor((pos[i] - fMin[i])/fStep);
+    std::size_t const ibin = bin < 0. ? 0 : std::min<std::size_t>(bin, fN[i] - 1);
+    voxel = voxel*fN[i] + ibin;
+  }
+  return voxel;
+}
+
+inline bool sbnd::VisibilityCache::Map()
+{
+  int const fd = ::open(fPath.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  std::size_t const size = kHeaderSize + PayloadFloats()*sizeof(float);
+  if (::fstat(fd, &st) != 0 || (std::size_t) st.st_size != size) {
+    ::close(fd);
+    return false;
+  }
+  void* const mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) return false;
+
+  char const* const data = static_cast<char const*>(mapped);
+  char const* pos = data + sizeof(kMagic);
+  std::uint32_t header[6];
+  double start[3], step;
+  std::uint64_t fingerprint, payloadChecksum;
+  std::memcpy(header, pos, sizeof(header));                     pos += sizeof(header);
+  std::memcpy(start, pos, sizeof(start));                       pos += sizeof(start);
+  std::memcpy(&step, pos, sizeof(step));                        pos += sizeof(step);
+  std::memcpy(&fingerprint, pos, sizeof(fingerprint));          pos += sizeof(fingerprint);
+  std::memcpy(&payloadChecksum, pos, sizeof(payloadChecksum));  pos += sizeof(payloadChecksum);
+
+  bool const ok = std::memcmp(data, kMagic, sizeof(kMagic)) == 0
+    && header[0] == kVersion && header[1] == fNOpDets
+    && header[2] == fN[0] && header[3] == fN[1] && header[4] == fN[2]
+    && start[0] == fMin[0] && start[1] == fMin[1] && start[2] == fMin[2] && step == fStep
+    && fingerprint == fFingerprint
+    && Checksum(pos, data + size - pos) == payloadChecksum;
+  if (!ok) {
+    ::munmap(mapped, size);
+    return false;
+  }
+  fMapped = mapped;
+  fMappedSize = size;
+  fTable = reinterpret_cast<float const*>(pos);
+  return true;
+}
+
+inline void sbnd::VisibilityCache::Build(Compute_t const& compute, bool parallel)
+{
+  fBuilt.assign(PayloadFloats(), 0.f);
+
+  struct Buffers_t { std::vector<double> direct, reflected; };
+  tbb::enumerable_thread_specific<Buffers_t> buffers;
+  auto fillVoxel = [&](std::size_t voxel) {
+    Buffers_t& buf = buffers.local();
+    std::size_t const ix = voxel%fN[0];
+    std::size_t const iy = voxel/fN[0]%fN[1];
+    std::size_t const iz = voxel/(fN[0]*fN[1]);
+    buf.direct.assign(fNOpDets, 0.);
+    buf.reflected.assign(fNOpDets, 0.);
+    compute(fMin[0] + (ix + 0.5)*fStep, fMin[1] + (iy + 0.5)*fStep, fMin[2] + (iz + 0.5)*fStep,
+            buf.direct, buf.reflected);
+    float* const out = fBuilt.data() + 2*voxel*fNOpDets;
+    std::size_t const nDirect = std::min(fNOpDets, buf.direct.size());
+    std::size_t const nReflected = std::min(fNOpDets, buf.reflected.size());
+    std::copy(buf.direct.begin(), buf.direct.begin() + nDirect, out);
+    std::copy(buf.reflected.begin(), buf.reflected.begin() + nReflected, out + fNOpDets);
+  };
+  if (parallel)
+    tbb::parallel_for(std::size_t(0), NVoxels(), fillVoxel);
+  else
+    for (std::size_t voxel = 0; voxel < NVoxels(); ++voxel) fillVoxel(voxel);
+
+  fTable = fBuilt.data();
+}
+
+inline bool sbnd::VisibilityCache::Write() const
+{
+  char const* const payload = reinterpret_cast<char const*>(fBuilt.data());
+  std::size_t const payloadSize = fBuilt.size()*sizeof(float);
+  std::uint32_t const header[6] = { kVersion, (std::uint32_t) fNOpDets,
+                                    (std::uint32_t) fN[0], (std::uint32_t) fN[1], (std::uint32_t) fN[2], 0 };
+  std::uint64_t const payloadChecksum = Checksum(payload, payloadSize);
+
+  std::string const tmpPath = fPath + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(header), sizeof(header));
+    out.write(reinterpret_cast<char const*>(fMin.data()), 3*sizeof(double));
+    out.write(reinterpret_cast<char const*>(&fStep), sizeof(fStep));
+    out.write(reinterpret_cast<char const*>(&fFingerprint), sizeof(fFingerprint));
+    out.write(reinterpret_cast<char const*>(&payloadChecksum), sizeof(payloadChecksum));
+    out.write(payload, payloadSize);
+    if (!out) {
+      out.close();
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), fPath.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+#endif // SBND_OPT0FINDER_VISIBILITYCACHE_H
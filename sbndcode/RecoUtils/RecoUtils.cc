@@ -1,38 +1,97 @@
 #include "RecoUtils.h"
 
+#include "tbb/parallel_for.h"
+
+namespace {
+  // Geant4 ID which deposits the most true energy in a hit
+  int LargestEnergyContributor(const std::vector<sim::TrackIDE>& track_ides, bool rollup_unsaved_ids) {
+    std::map<int,double> id_to_energy_map;
+    for (unsigned int idIt = 0; idIt < track_ides.size(); ++idIt) {
+      int id = track_ides.at(idIt).trackID;
+      if (rollup_unsaved_ids) id = std::abs(id);
+      double energy = track_ides.at(idIt).energy;
+      id_to_energy_map[id]+=energy;
+    }
+    //Now loop over the map to find the maximum contributor
+    double likely_particle_contrib_energy = -99999;
+    int likely_track_id = 0;
+    for (std::map<int,double>::iterator mapIt = id_to_energy_map.begin(); mapIt != id_to_energy_map.end(); mapIt++){
+      double particle_contrib_energy = mapIt->second;
+      if (particle_contrib_energy > likely_particle_contrib_energy){
+        likely_particle_contrib_energy = particle_contrib_energy;
+        likely_track_id = mapIt->first;
+      }
+    }
+    return likely_track_id;
+  }
+
+  // True energy deposits of a hit, from the cache if it holds them and from the BackTracker otherwise
+  const std::vector<sim::TrackIDE>& HitTrackIDEs(detinfo::DetectorClocksData const& clockData, const RecoUtils::HitTruthCache& cache,
+                                                 const art::Ptr<recob::Hit>& hit, std::vector<sim::TrackIDE>& scratch) {
+    if (const std::vector<sim::TrackIDE>* ides = cache.TrackIDEs(hit)) return *ides;
+    art::ServiceHandle<cheat::BackTrackerService> bt_serv;
+    scratch = bt_serv->HitToTrackIDEs(clockData, hit);
+    return scratch;
+  }
+}
+
+
+
+void RecoUtils::HitTruthCache::Add(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool useWorkers) {
+  // Reserve a slot for every hit not cached yet
+  std::vector<std::pair<art::Ptr<recob::Hit>, HitIDEs*> > newHits;
+  for (auto const& hit : hits) {
+    std::vector<HitIDEs>& collection = fHitIDEs[hit.id()];
+    if (collection.size() <= hit.key()) collection.resize(hit.key()+1);
+    HitIDEs& slot = collection[hit.key()];
+    if (slot.filled) continue;
+    slot.filled = true;
+    newHits.emplace_back(hit, nullptr);
+  }
+  // The slots only move while the collections grow, so point at them once they are all in place
+  for (auto& newHit : newHits) newHit.second = &fHitIDEs[newHit.first.id()][newHit.first.key()];
+  fNHits += newHits.size();
+
+  // Each hit is backtracked into its own slot, the BackTracker itself is only read
+  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
+  auto backtrack = [&](size_t i) { newHits[i].second->ides = bt_serv->HitToTrackIDEs(clockData, newHits[i].first); };
+  if (useWorkers) tbb::parallel_for(size_t(0), newHits.size(), backtrack);
+  else {
+    for (size_t i = 0; i < newHits.size(); ++i) backtrack(i);
+  }
+}
+
+
+
+const std::vector<sim::TrackIDE>* RecoUtils::HitTruthCache::TrackIDEs(const art::Ptr<recob::Hit>& hit) const {
+  auto collectionIt = fHitIDEs.find(hit.id());
+  if (collectionIt == fHitIDEs.end() || collectionIt->second.size() <= hit.key()) return nullptr;
+  const HitIDEs& slot = collectionIt->second[hit.key()];
+  return slot.filled ? &slot.ides : nullptr;
+}
+
+
 
 int RecoUtils::TrueParticleID(detinfo::DetectorClocksData const& clockData,
                               const art::Ptr<recob::Hit> hit, bool rollup_unsaved_ids) {
-  std::map<int,double> id_to_energy_map;
   art::ServiceHandle<cheat::BackTrackerService> bt_serv;
   std::vector<sim::TrackIDE> track_ides = bt_serv->HitToTrackIDEs(clockData, hit);
-  for (unsigned int idIt = 0; idIt < track_ides.size(); ++idIt) {
-    int id = track_ides.at(idIt).trackID;
-    if (rollup_unsaved_ids) id = std::abs(id);
-    double energy = track_ides.at(idIt).energy;
-    id_to_energy_map[id]+=energy;
-  }
-  //Now loop over the map to find the maximum contributor
-  double likely_particle_contrib_energy = -99999;
-  int likely_track_id = 0;
-  for (std::map<int,double>::iterator mapIt = id_to_energy_map.begin(); mapIt != id_to_energy_map.end(); mapIt++){
-    double particle_contrib_energy = mapIt->second;
-    if (particle_contrib_energy > likely_particle_contrib_energy){
-      likely_particle_contrib_energy = particle_contrib_energy;
-      likely_track_id = mapIt->first;
-    }
-  }
-  return likely_track_id;
+  return LargestEnergyContributor(track_ides, rollup_unsaved_ids);
 }
 
 
 
 int RecoUtils::TrueParticleIDFromTotalTrueEnergy(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
-  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
+  return TrueParticleIDFromTotalTrueEnergy(clockData, HitTruthCache(), hits, rollup_unsaved_ids);
+}
+
+
+
+int RecoUtils::TrueParticleIDFromTotalTrueEnergy(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
   std::map<int,double> trackIDToEDepMap;
+  std::vector<sim::TrackIDE> scratch;
   for (std::vector<art::Ptr<recob::Hit> >::const_iterator hitIt = hits.begin(); hitIt != hits.end(); ++hitIt) {
-    art::Ptr<recob::Hit> hit = *hitIt;
-    std::vector<sim::TrackIDE> trackIDs = bt_serv->HitToTrackIDEs(clockData, hit);
+    const std::vector<sim::TrackIDE>& trackIDs = HitTrackIDEs(clockData, cache, *hitIt, scratch);
     for (unsigned int idIt = 0; idIt < trackIDs.size(); ++idIt) {
       int id = trackIDs[idIt].trackID;
       if (rollup_unsaved_ids) id = std::abs(id);
@@ -58,11 +117,18 @@ int RecoUtils::TrueParticleIDFromTotalTrueEnergy(detinfo::DetectorClocksData con
 
 
 int RecoUtils::TrueParticleIDFromTotalRecoCharge(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
+  return TrueParticleIDFromTotalRecoCharge(clockData, HitTruthCache(), hits, rollup_unsaved_ids);
+}
+
+
+
+int RecoUtils::TrueParticleIDFromTotalRecoCharge(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
   // Make a map of the tracks which are associated with this object and the charge each contributes
   std::map<int,double> trackMap;
+  std::vector<sim::TrackIDE> scratch;
   for (std::vector<art::Ptr<recob::Hit> >::const_iterator hitIt = hits.begin(); hitIt != hits.end(); ++hitIt) {
     art::Ptr<recob::Hit> hit = *hitIt;
-    int trackID = TrueParticleID(clockData, hit, rollup_unsaved_ids);
+    int trackID = LargestEnergyContributor(HitTrackIDEs(clockData, cache, hit, scratch), rollup_unsaved_ids);
     trackMap[trackID] += hit->Integral();
   }
 
@@ -81,11 +147,17 @@ int RecoUtils::TrueParticleIDFromTotalRecoCharge(detinfo::DetectorClocksData con
 
 
 int RecoUtils::TrueParticleIDFromTotalRecoHits(detinfo::DetectorClocksData const& clockData,const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
+  return TrueParticleIDFromTotalRecoHits(clockData, HitTruthCache(), hits, rollup_unsaved_ids);
+}
+
+
+
+int RecoUtils::TrueParticleIDFromTotalRecoHits(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids) {
   // Make a map of the tracks which are associated with this object and the number of hits they are the primary contributor to
   std::map<int,int> trackMap;
+  std::vector<sim::TrackIDE> scratch;
   for (std::vector<art::Ptr<recob::Hit> >::const_iterator hitIt = hits.begin(); hitIt != hits.end(); ++hitIt) {
-    art::Ptr<recob::Hit> hit = *hitIt;
-    int trackID = TrueParticleID(clockData, hit, rollup_unsaved_ids);
+    int trackID = LargestEnergyContributor(HitTrackIDEs(clockData, cache, *hitIt, scratch), rollup_unsaved_ids);
     trackMap[trackID]++;
   }
 
@@ -105,7 +177,7 @@ int RecoUtils::TrueParticleIDFromTotalRecoHits(detinfo::DetectorClocksData const
   }
   if (NHighestCounts > 1){
     std::cout<<"RecoUtils::TrueParticleIDFromTotalRecoHits - There are " << NHighestCounts << " particles which tie for highest number of contributing hits (" << highestCount<<" hits).  Using RecoUtils::TrueParticleIDFromTotalTrueEnergy instead."<<std::endl;
-    objectTrack = RecoUtils::TrueParticleIDFromTotalTrueEnergy(clockData, hits,rollup_unsaved_ids);
+    objectTrack = RecoUtils::TrueParticleIDFromTotalTrueEnergy(clockData, cache, hits,rollup_unsaved_ids);
   }
   return objectTrack;
 }
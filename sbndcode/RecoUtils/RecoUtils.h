@@ -44,10 +44,34 @@ namespace detinfo { class DetectorClocksData; }
 
 
 namespace RecoUtils{
+  // Backtracked true energy deposits of reco hits, computed once per hit and shared by all the
+  // truth matching calls of an event. Clear it at the start of each event and Add the hits of the
+  // event before matching. Hits that were never added are backtracked on the fly.
+  class HitTruthCache {
+  public:
+    void Clear() { fHitIDEs.clear(); fNHits = 0; }
+    // Backtracks the hits not cached yet, concurrently if useWorkers is set
+    void Add(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool useWorkers=false);
+    // Returns the cached true energy deposits of the hit, or nullptr if it was never added
+    const std::vector<sim::TrackIDE>* TrackIDEs(const art::Ptr<recob::Hit>& hit) const;
+    size_t NHits() const { return fNHits; }
+  private:
+    struct HitIDEs {
+      bool filled = false;
+      std::vector<sim::TrackIDE> ides;
+    };
+    std::map<art::ProductID, std::vector<HitIDEs> > fHitIDEs; // indexed by hit key within each hit collection
+    size_t fNHits = 0;
+  };
+
   int TrueParticleID(detinfo::DetectorClocksData const& clockData, const art::Ptr<recob::Hit> hit, bool rollup_unsaved_ids=1); //Returns the geant4 ID which contributes the most to a single reco hit.  The matching method looks for true particle which deposits the most true energy in the reco hit.  If rollup_unsaved_ids is set to true, any unsaved daughter than contributed energy to the hit has its energy included in its closest ancestor that was saved.
   int TrueParticleIDFromTotalTrueEnergy(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1); //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle deposits the most true energy in the reco hits
   int TrueParticleIDFromTotalRecoCharge(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);  //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle contributes the most reconstructed charge to the hit selection (the reco charge of each hit is correlated with each maximally contributing true particle and summed)
   int TrueParticleIDFromTotalRecoHits(detinfo::DetectorClocksData const& clockData, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);  //Returns the geant4 ID which contributes the most to the vector of hits.  The matching method looks for which true particle maximally contributes to the most reco hits
+  // Same as above, reading the true energy deposits of the hits from the cache
+  int TrueParticleIDFromTotalTrueEnergy(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);
+  int TrueParticleIDFromTotalRecoCharge(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);
+  int TrueParticleIDFromTotalRecoHits(detinfo::DetectorClocksData const& clockData, const HitTruthCache& cache, const std::vector<art::Ptr<recob::Hit> >& hits, bool rollup_unsaved_ids=1);
   bool IsInsideTPC(TVector3 position, double distance_buffer); //Checks if a position is within any of the TPCs in the geometry (user can define some distance buffer from the TPC walls)
   double CalculateTrackLength(const art::Ptr<recob::Track> track); //Calculates the total length of a recob::track by summing up the distances between adjacent traj. points
 }
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   TruthIndex.h
+///
+/// \brief  The truth bookkeeping of an event, done once for all the
+///         analyzers of a job.
+///
+/// Many analyzers start each event by mapping the track IDs of the
+/// simb::MCParticle collection to the particles, walking the mothers up
+/// to the primary, and backtracking every hit to the particle depositing
+/// the most energy in it. This product holds the result of all of that as
+/// flat arrays, written by TruthIndexMaker:
+///
+///  * the particles, sorted by track ID: the key of each one in the
+///    MCParticle collection, and the index of its mother and of its primary
+///    ancestor among the particles of the index;
+///  * for each hit of one hit collection, in the order of its keys, the
+///    track ID contributing the most energy and the fraction of the energy
+///    of the hit it deposited (RecoUtils::TrueParticleID);
+///  * for each sim::AuxDetSimChannel, in the order of the collection, the
+///    track IDs of its AuxDetIDEs, in the order of the IDEs.
+///
+/// The particle, hit and auxiliary detector collections are the ones
+/// configured in TruthIndexMaker; a reader reads the same ones:
+///
+///   auto const& index = e.getProduct<sbnd::TruthIndex>(fTruthIndexLabel);
+///   auto const& particles = e.getProduct<std::vector<simb::MCParticle>>(fSimLabel);
+///   simb::MCParticle const* particle = index.Particle(trackID, particles);
+///   std::size_t const primary = index.Primary(index.Index(trackID));
+///   int const hitTrackID = index.HitTrackID(hit.key());
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_RECOUTILS_TRUTHINDEX_TRUTHINDEX_H
+#define SBNDCODE_RECOUTILS_TRUTHINDEX_TRUTHINDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace sbnd {
+
+  class TruthIndex {
+  public:
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Track ID of a hit with no true energy deposit.
+    static constexpr int NoTrackID = 0;
+
+    /// Track IDs of the IDEs of one auxiliary detector channel.
+    struct TrackIDRange {
+      int const* b;
+      int const* e;
+      int const* begin() const { return b; }
+      int const* end() const { return e; }
+      std::size_t size() const { return e - b; }
+      bool empty() const { return b == e; }
+    };
+
+    // --- particles, by index in track ID order ---
+
+    std::size_t NParticles() const { return fTrackIDs.size(); }
+    int TrackID(std::size_t i) const { return fTrackIDs[i]; }
+
+    /// Key of particle i in the MCParticle collection.
+    std::size_t ParticleKey(std::size_t i) const { return fParticleKeys[i]; }
+
+    /// Index of the particle with trackID, or npos if there is none.
+    std::size_t Index(int trackID) const
+    {
+      auto const it = std::lower_bound(fTrackIDs.begin(), fTrackIDs.end(), trackID);
+      return (it == fTrackIDs.end() || *it != trackID) ? npos : std::size_t(it - fTrackIDs.begin());
+    }
+
+    /// Index of the mother of particle i, or npos if it was not saved.
+    std::size_t Mother(std::size_t i) const
+      { return fMotherIndex[i] < 0 ? npos : std::size_t(fMotherIndex[i]); }
+
+    /// Index of the first ancestor of particle i with no saved mother
+    /// (the particle itself when it has none).
+    std::size_t Primary(std::size_t i) const { return fPrimaryIndex[i]; }
+
+    /// The particle with trackID in particles (the collection the index was
+    /// made from), or nullptr if there is none.
+    template <typename Particles>
+    auto const* Particle(int trackID, Particles const& particles) const
+    {
+      std::size_t const i = Index(trackID);
+      return i == npos ? nullptr : &particles[fParticleKeys[i]];
+    }
+
+    // --- hits, by key ---
+
+    std::size_t NHits() const { return fHitTrackIDs.size(); }
+
+    /// Track ID depositing the most energy in the hit, NoTrackID if none.
+    int HitTrackID(std::size_t hitKey) const { return fHitTrackIDs[hitKey]; }
+
+    /// Fraction of the energy in the hit deposited by HitTrackID().
+    float HitEnergyFraction(std::size_t hitKey) const { return fHitEnergyFractions[hitKey]; }
+
+    // --- auxiliary detector channels, by key ---
+
+    std::size_t NAuxDetChannels() const
+      { return fAuxDetOffsets.empty() ? 0 : fAuxDetOffsets.size() - 1; }
+
+    /// Track IDs of the AuxDetIDEs of channel channelKey, in their order.
+    TrackIDRange AuxDetTrackIDs(std::size_t channelKey) const
+    {
+      return { fAuxDetTrackIDs.data() + fAuxDetOffsets[channelKey],
+               fAuxDetTrackIDs.data() + fAuxDetOffsets[channelKey + 1] };
+    }
+
+    // --- filling ---
+
+    /// Indexes particles, a collection of objects with TrackId() and Mother().
+    template <typename Particles>
+    void SetParticles(Particles const& particles);
+
+    void ReserveHits(std::size_t nHits)
+    {
+      fHitTrackIDs.reserve(nHits);
+      fHitEnergyFractions.reserve(nHits);
+    }
+
+    /// Appends the truth of the next hit.
+    void AddHit(int trackID, float energyFraction)
+    {
+      fHitTrackIDs.push_back(trackID);
+      fHitEnergyFractions.push_back(energyFraction);
+    }
+
+    /// Appends the next channel, given its IDEs (objects with a trackID).
+    template <typename IDEs>
+    void AddAuxDetChannel(IDEs const& ides)
+    {
+      if (fAuxDetOffsets.empty()) fAuxDetOffsets.push_back(0);
+      for (auto const& ide: ides) fAuxDetTrackIDs.push_back(ide.trackID);
+      fAuxDetOffsets.push_back(fAuxDetTrackIDs.size());
+    }
+
+  private:
+
+    std::vector<int>          fTrackIDs;           ///< track ID of each particle, increasing
+    std::vector<unsigned int> fParticleKeys;       ///< key of each particle in the MCParticle collection
+    std::vector<int>          fMotherIndex;        ///< index of the mother of each particle, -1 if not saved
+    std::vector<unsigned int> fPrimaryIndex;       ///< index of the primary ancestor of each particle
+
+    std::vector<int>          fHitTrackIDs;        ///< dominant track ID of each hit
+    std::vector<float>        fHitEnergyFractions; ///< energy fraction of the dominant track ID of each hit
+
+    std::vector<unsigned int> fAuxDetOffsets;      ///< start of the IDEs of each channel, and end of the last
+    std::vector<int>          fAuxDetTrackIDs;     ///< track ID of each AuxDetIDE, channel after channel
+  };
+
+
+  template <typename Particles>
+  void TruthIndex::SetParticles(Particles const& particles)
+  {
+    std::size_t const n = particles.size();
+
+    // sort the keys by track ID
+    fParticleKeys.resize(n);
+    std::iota(fParticleKeys.begin(), fParticleKeys.end(), 0u);
+    std::stable_sort(fParticleKeys.begin(), fParticleKeys.end(),
+      [&particles](unsigned int a, unsigned int b)
+        { return particles[a].TrackId() < particles[b].TrackId(); });
+    fTrackIDs.resize(n);
+    for (std::size_t i = 0; i < n; ++i) fTrackIDs[i] = particles[fParticleKeys[i]].TrackId();
+
+    fMotherIndex.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      std::size_t const mother = Index(particles[fParticleKeys[i]].Mother());
+      fMotherIndex[i] = (mother == npos || mother == i) ? -1 : int(mother);
+    }
+
+    // walk each chain up to the first particle with a known primary, or
+    // to the top, then write the primary on the way back
+    int const unknown = -1;
+    std::vector<int> primary(n, unknown);
+    for (std::size_t i = 0; i < n; ++i) {
+      std::size_t top = i;
+      std::size_t steps = 0;
+      while (primary[top] == unknown && fMotherIndex[top] >= 0 && steps++ < n) top = fMotherIndex[top];
+      int const p = primary[top] == unknown ? int(top) : primary[top];
+      for (std::size_t j = i; j != top; j = fMotherIndex[j]) primary[j] = p;
+      primary[top] = p;
+    }
+    fPrimaryIndex.assign(primary.begin(), primary.end());
+  }
+
+} // namespace sbnd
+
+#endif // SBNDCODE_RECOUTILS_TRUTHINDEX_TRUTHINDEX_H
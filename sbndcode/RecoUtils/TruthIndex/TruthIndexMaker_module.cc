@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////
+// Class:       TruthIndexMaker
+// Plugin Type: producer
+// File:        TruthIndexMaker_module.cc
+//
+// Writes one sbnd::TruthIndex per event: the MCParticle collection
+// sorted by track ID with the mother and primary of each particle, the
+// track ID depositing the most energy in each hit of a hit collection,
+// and the track IDs of the AuxDetIDEs of each sim::AuxDetSimChannel.
+// Analyzers of the same job read it instead of building their own maps
+// and backtracking the hits again.
+////////////////////////////////////////////////////////////////////////
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "canvas/Persistency/Common/Ptr.h"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardataobj/RecoBase/Hit.h"
+#include "lardataobj/Simulation/AuxDetSimChannel.h"
+#include "lardataobj/Simulation/SimChannel.h"
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "sbndcode/RecoUtils/RecoUtils.h"
+#include "sbndcode/RecoUtils/TruthIndex/TruthIndex.h"
+
+namespace sbnd {
+  class TruthIndexMaker;
+}
+
+
+class sbnd::TruthIndexMaker : public art::EDProducer {
+public:
+  explicit TruthIndexMaker(fhicl::ParameterSet const& p);
+
+  // Plugins should not be copied or assigned.
+  TruthIndexMaker(TruthIndexMaker const&) = delete;
+  TruthIndexMaker(TruthIndexMaker&&) = delete;
+  TruthIndexMaker& operator=(TruthIndexMaker const&) = delete;
+  TruthIndexMaker& operator=(TruthIndexMaker&&) = delete;
+
+  void produce(art::Event& e) override;
+
+private:
+
+  art::InputTag fSimLabel;           ///< MCParticle collection
+  art::InputTag fHitLabel;           ///< hits to backtrack, none if empty
+  art::InputTag fAuxDetSimChanLabel; ///< AuxDetSimChannels, none if empty
+  bool          fRollupUnsavedIDs;   ///< counts the energy of unsaved daughters to their ancestor
+  bool          fUseWorkers;         ///< backtracks the hits concurrently
+
+  RecoUtils::HitTruthCache fHitTruth; ///< true deposits of the hits, cleared every event
+};
+
+
+sbnd::TruthIndexMaker::TruthIndexMaker(fhicl::ParameterSet const& p)
+  : EDProducer{p}
+{
+  fSimLabel           = p.get< art::InputTag >("SimLabel");
+  fHitLabel           = p.get< art::InputTag >("HitLabel", "");
+  fAuxDetSimChanLabel = p.get< art::InputTag >("AuxDetSimChannelLabel", "");
+  fRollupUnsavedIDs   = p.get< bool >("RollupUnsavedIDs", true);
+  fUseWorkers         = p.get< bool >("UseWorkers", false);
+
+  consumes< std::vector< simb::MCParticle > >(fSimLabel);
+  if (!fHitLabel.empty()) consumes< std::vector< recob::Hit > >(fHitLabel);
+  if (!fAuxDetSimChanLabel.empty()) consumes< std::vector< sim::AuxDetSimChannel > >(fAuxDetSimChanLabel);
+
+  produces< sbnd::TruthIndex >();
+}
+
+void sbnd::TruthIndexMaker::produce(art::Event& e)
+{
+  auto index = std::make_unique< sbnd::TruthIndex >();
+
+  index->SetParticles(e.getProduct< std::vector< simb::MCParticle > >(fSimLabel));
+
+  if (!fHitLabel.empty()) {
+    auto const hitHandle = e.getValidHandle< std::vector< recob::Hit > >(fHitLabel);
+    std::vector< art::Ptr< recob::Hit > > hits;
+    hits.reserve(hitHandle->size());
+    for (std::size_t key = 0; key < hitHandle->size(); ++key) hits.emplace_back(hitHandle, key);
+
+    auto const clockData = art::ServiceHandle< detinfo::DetectorClocksService const >()->DataFor(e);
+    fHitTruth.Clear();
+    fHitTruth.Add(clockData, hits, fUseWorkers);
+
+    // same choice as RecoUtils::TrueParticleID: the largest deposit, the
+    // lowest track ID on a tie
+    std::map< int, double > energies;
+    index->ReserveHits(hits.size());
+    for (auto const& hit : hits) {
+      energies.clear();
+      double total = 0.;
+      for (sim::TrackIDE const& ide : *fHitTruth.TrackIDEs(hit)) {
+        int const id = fRollupUnsavedIDs ? std::abs(ide.trackID) : ide.trackID;
+        energies[id] += ide.energy;
+        total += ide.energy;
+      }
+      int trackID = sbnd::TruthIndex::NoTrackID;
+      double maxEnergy = -1.;
+      for (auto const& [id, energy] : energies) {
+        if (energy > maxEnergy) { maxEnergy = energy; trackID = id; }
+      }
+      index->AddHit(trackID, total > 0. ? float(maxEnergy / total) : 0.f);
+    }
+    fHitTruth.Clear();
+  }
+
+  if (!fAuxDetSimChanLabel.empty()) {
+    for (sim::AuxDetSimChannel const& channel
+           : e.getProduct< std::vector< sim::AuxDetSimChannel > >(fAuxDetSimChanLabel))
+      index->AddAuxDetChannel(channel.AuxDetIDEs());
+  }
+
+  e.put(std::move(index));
+}
+
+DEFINE_ART_MODULE(sbnd::TruthIndexMaker)
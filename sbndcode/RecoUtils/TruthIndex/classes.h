@@ -0,0 +1,8 @@
+//File: classes.h
+//Brief: Include directives needed to generate the dictionary of sbnd::TruthIndex.
+
+//ART includes
+#include "canvas/Persistency/Common/Wrapper.h"
+
+//local includes
+#include "sbndcode/RecoUtils/TruthIndex/TruthIndex.h"
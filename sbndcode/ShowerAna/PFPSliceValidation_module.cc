@@ -37,6 +37,7 @@
 
 // Root Includes
 #include "TTree.h"
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -61,10 +62,11 @@ public:
   void beginJob() override;
 
   // Function to get a map of MCTruth to number of hits from that truth
+  // Also caches the truth index of every hit for the slice matching
   std::map<art::Ptr<simb::MCTruth>, int>
   GetTruthHitMap(const detinfo::DetectorClocksData &clockData,
-                 const sim::ParticleList &trueParticlesMap,
                  const std::map<int, art::Ptr<simb::MCTruth>> &particleTruthMap,
+                 const art::Handle<std::vector<recob::Hit>> &hitHandle,
                  const std::vector<art::Ptr<recob::Hit>> &allHits);
 
   // Function to match a slice, really any selection of hits, back to MCTruth
@@ -72,10 +74,15 @@ public:
   art::Ptr<simb::MCTruth>
   GetSliceTruthMatchHits(const detinfo::DetectorClocksData &clockData,
                          const std::vector<art::Ptr<recob::Hit>> &sliceHits,
-                         const std::map<int, art::Ptr<simb::MCTruth>> &particleTruthMap,
                          const std::map<art::Ptr<simb::MCTruth>, int> &truthHitMap,
                          float &completeness, float &purity);
 
+  // Function to get the true particle that contributed the most energy to a hit
+  int GetHitTrackID(const detinfo::DetectorClocksData &clockData, const art::Ptr<recob::Hit> &hit);
+
+  // Function to get the index in fTruths of the truth a hit belongs to, -1 if none
+  int GetHitTruthIndex(const detinfo::DetectorClocksData &clockData, const art::Ptr<recob::Hit> &hit);
+
   // Functions to reset tree variables
   void ClearTrueTree();
   void ClearEventTree();
@@ -131,6 +138,13 @@ private:
   TTree *eventTree;
   TTree *trueTree;
 
+  // Event wide truth matching of the hits, filled by GetTruthHitMap
+  std::vector<art::Ptr<simb::MCTruth>> fTruths; // truths of the true particles, in map order
+  std::map<int, int> fParticleTruthIndex;       // true particle ID -> index in fTruths
+  art::ProductID fHitProductID;
+  std::vector<int> fHitTruthIndex;              // hit key -> index in fTruths, -1 if none
+  std::vector<int> fSliceTruthHits;             // per slice number of hits from each truth
+
   // Event wide metrics
   int eventTrueNeutrinos;
   std::map<std::string, int> eventPFPSlices, eventPFPNeutrinos;
@@ -258,7 +272,7 @@ void ana::PFPSliceValidation::analyze(art::Event const &evt) {
   // Get map of true primary particle to number of reco hits / energy in reco hits
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   std::map<art::Ptr<simb::MCTruth>, int> truthHitMap =
-      GetTruthHitMap(clockData, trueParticlesMap, particleTruthMap, allHits);
+      GetTruthHitMap(clockData, particleTruthMap, hitHandle, allHits);
 
   // Create maps to store the best matched slice to each truth
   std::map<std::string, std::map<art::Ptr<simb::MCTruth>, unsigned int>> pfpTruthNuCounterMap;
@@ -346,8 +360,8 @@ void ana::PFPSliceValidation::analyze(art::Event const &evt) {
 
     for (const auto &pfpSlice : pfpSliceVec) {
 
-      std::vector<art::Ptr<recob::Hit>> sliceHits        = fmSliceHits.at(pfpSlice.key());
-      std::vector<art::Ptr<recob::PFParticle>> slicePFPs = fmSlicePFPs.at(pfpSlice.key());
+      const std::vector<art::Ptr<recob::Hit>> &sliceHits        = fmSliceHits.at(pfpSlice.key());
+      const std::vector<art::Ptr<recob::PFParticle>> &slicePFPs = fmSlicePFPs.at(pfpSlice.key());
 
       bool isNeutrinoSlice(false);
       float nuScore(-999);
@@ -364,8 +378,8 @@ void ana::PFPSliceValidation::analyze(art::Event const &evt) {
 
       // Find the MCTruth that contains most of the hits from the slice
       float purity(-999), completeness(-999);
-      art::Ptr<simb::MCTruth> trueMatch = GetSliceTruthMatchHits(
-          clockData, sliceHits, particleTruthMap, truthHitMap, completeness, purity);
+      art::Ptr<simb::MCTruth> trueMatch =
+          GetSliceTruthMatchHits(clockData, sliceHits, truthHitMap, completeness, purity);
 
       // Check if it matched to anything
       if (trueMatch.isNull())
@@ -514,32 +528,42 @@ void ana::PFPSliceValidation::analyze(art::Event const &evt) {
 } // analyze
 
 std::map<art::Ptr<simb::MCTruth>, int> ana::PFPSliceValidation::GetTruthHitMap(
-    const detinfo::DetectorClocksData &clockData, const sim::ParticleList &trueParticlesMap,
+    const detinfo::DetectorClocksData &clockData,
     const std::map<int, art::Ptr<simb::MCTruth>> &particleTruthMap,
+    const art::Handle<std::vector<recob::Hit>> &hitHandle,
     const std::vector<art::Ptr<recob::Hit>> &allHits) {
 
-  // Create a map of true particles to number of hits
-  std::map<int, int> trueParticleHits;
+  // Index the truths in the order a map keyed by them iterates, so ties resolve as they always did
+  fTruths.clear();
+  for (const auto &[trueParticle, truth] : particleTruthMap) {
+    fTruths.push_back(truth);
+  } // [trueParticle, truth]: particleTruthMap
+  std::sort(fTruths.begin(), fTruths.end());
+  fTruths.erase(std::unique(fTruths.begin(), fTruths.end()), fTruths.end());
+
+  fParticleTruthIndex.clear();
+  for (const auto &[trueParticle, truth] : particleTruthMap) {
+    fParticleTruthIndex[trueParticle] =
+        std::lower_bound(fTruths.begin(), fTruths.end(), truth) - fTruths.begin();
+  } // [trueParticle, truth]: particleTruthMap
+
+  // Backtrack every hit once, the slices then only look up their hits
+  fHitProductID = hitHandle.isValid() ? hitHandle.id() : art::ProductID();
+  fHitTruthIndex.assign(allHits.size(), -1);
+  std::vector<int> truthHits(fTruths.size(), 0);
   for (const auto &hit : allHits) {
-    int trackID     = 0;
-    float hitEnergy = 0;
-
-    // For each hit, chose the particle that contributed the most energy
-    std::vector<sim::TrackIDE> trackIDEs = bt_serv->HitToTrackIDEs(clockData, hit);
-    for (const auto &ide : trackIDEs) {
-      if (ide.energy > hitEnergy) {
-        hitEnergy = ide.energy;
-        trackID   = std::abs(ide.trackID);
-      } // ide.energy > hitEnergy
-    } // ide: trackIDEs
-    ++trueParticleHits[trackID];
+    auto const particleIt = fParticleTruthIndex.find(GetHitTrackID(clockData, hit));
+    if (particleIt == fParticleTruthIndex.end())
+      continue;
+    fHitTruthIndex[hit.key()] = particleIt->second;
+    ++truthHits[particleIt->second];
   } // hit: allHits
 
-  // Roll up the particles in their slices
+  // Number of hits from each truth
   std::map<art::Ptr<simb::MCTruth>, int> truthHitMap;
-  for (const auto &[trueParticle, truth] : particleTruthMap) {
-    truthHitMap[truth] += trueParticleHits[trueParticle];
-  } // [trueParticle, truth]: particleTruthMap
+  for (size_t truthIndex = 0; truthIndex < fTruths.size(); ++truthIndex) {
+    truthHitMap[fTruths[truthIndex]] = truthHits[truthIndex];
+  } // truthIndex
 
   return truthHitMap;
 } // GetTruthHitMap
@@ -547,41 +571,25 @@ std::map<art::Ptr<simb::MCTruth>, int> ana::PFPSliceValidation::GetTruthHitMap(
 art::Ptr<simb::MCTruth> ana::PFPSliceValidation::GetSliceTruthMatchHits(
     const detinfo::DetectorClocksData &clockData,
     const std::vector<art::Ptr<recob::Hit>> &sliceHits,
-    const std::map<int, art::Ptr<simb::MCTruth>> &particleTruthMap,
     const std::map<art::Ptr<simb::MCTruth>, int> &truthHitMap, float &completeness, float &purity) {
 
-  // Create a map of true particles to number of hits
-  std::map<int, int> trueParticleHits;
+  // Count the slice hits from each truth
+  fSliceTruthHits.assign(fTruths.size(), 0);
   for (const auto &hit : sliceHits) {
-    int trackID     = 0;
-    float hitEnergy = 0;
-
-    // For each hit, chose the particle that contributed the most energy
-    std::vector<sim::TrackIDE> trackIDEs = bt_serv->HitToTrackIDEs(clockData, hit);
-    for (const auto &ide : trackIDEs) {
-      if (ide.energy > hitEnergy) {
-        hitEnergy = ide.energy;
-        trackID   = std::abs(ide.trackID);
-      } // ide.energy > hitEnergy
-    } // ide: trackIDEs
-    ++trueParticleHits[trackID];
+    int truthIndex = GetHitTruthIndex(clockData, hit);
+    if (truthIndex >= 0)
+      ++fSliceTruthHits[truthIndex];
   } // hit: sliceHits
 
-  // Roll up the particles in their slices
-  std::map<art::Ptr<simb::MCTruth>, int> sliceTruthHitMap;
-  for (const auto &[trueParticle, truth] : particleTruthMap) {
-    sliceTruthHitMap[truth] += trueParticleHits[trueParticle];
-  } // [trueParticle, truth]: particleTruthMap
-
   // Choose the truth that contributed the most hits
   int maxHits = 0;
   art::Ptr<simb::MCTruth> bestTruthMatch;
-  for (const auto &[truth, truthHits] : sliceTruthHitMap) {
-    if (truthHits > maxHits) {
-      maxHits        = truthHits;
-      bestTruthMatch = truth;
+  for (size_t truthIndex = 0; truthIndex < fTruths.size(); ++truthIndex) {
+    if (fSliceTruthHits[truthIndex] > maxHits) {
+      maxHits        = fSliceTruthHits[truthIndex];
+      bestTruthMatch = fTruths[truthIndex];
     } // truthHits > maxHuts
-  } // [truth, truthHits]: sliceTruthHitMap
+  } // truthIndex
 
   // If we have truth matched the slice, calculate purtity and completeness
   // Note these are passed by referecne
@@ -593,6 +601,32 @@ art::Ptr<simb::MCTruth> ana::PFPSliceValidation::GetSliceTruthMatchHits(
   return bestTruthMatch;
 } // GetSliceTruthMatchHits
 
+int ana::PFPSliceValidation::GetHitTrackID(const detinfo::DetectorClocksData &clockData,
+                                           const art::Ptr<recob::Hit> &hit) {
+  int trackID     = 0;
+  float hitEnergy = 0;
+
+  // For each hit, chose the particle that contributed the most energy
+  std::vector<sim::TrackIDE> trackIDEs = bt_serv->HitToTrackIDEs(clockData, hit);
+  for (const auto &ide : trackIDEs) {
+    if (ide.energy > hitEnergy) {
+      hitEnergy = ide.energy;
+      trackID   = std::abs(ide.trackID);
+    } // ide.energy > hitEnergy
+  } // ide: trackIDEs
+  return trackID;
+} // GetHitTrackID
+
+int ana::PFPSliceValidation::GetHitTruthIndex(const detinfo::DetectorClocksData &clockData,
+                                              const art::Ptr<recob::Hit> &hit) {
+  // Hits from the event hit collection were backtracked by GetTruthHitMap
+  if (hit.id() == fHitProductID && hit.key() < fHitTruthIndex.size())
+    return fHitTruthIndex[hit.key()];
+
+  auto const particleIt = fParticleTruthIndex.find(GetHitTrackID(clockData, hit));
+  return particleIt == fParticleTruthIndex.end() ? -1 : particleIt->second;
+} // GetHitTruthIndex
+
 void ana::PFPSliceValidation::ClearTrueTree() {
 
   intType     = -999;
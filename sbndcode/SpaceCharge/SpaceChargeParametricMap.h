@@ -0,0 +1,133 @@
+#ifndef SPACECHARGE_SPACECHARGEPARAMETRICMAP_H
+#define SPACECHARGE_SPACECHARGEPARAMETRICMAP_H
+
+// Three-component parametric space charge map.
+//
+// Each component is a polynomial in b (x for the X and Z components, y for
+// the Y one) whose coefficients are polynomials in a (y, respectively x),
+// whose coefficients in turn are TGraphs of z. The graphs are sampled at
+// Configure time on the union of their abscissae, where their linear
+// interpolation (TGraph::Eval) is exact, into one table of coefficients per
+// node. An evaluation then does one node search and a single pass over the
+// coefficients of the three components, in fixed-size arrays.
+
+// Framework libraries
+#include "cetlib_except/exception.h"
+
+// Others
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <TGraph.h>
+
+namespace spacecharge
+{
+    class SpaceChargeParametricMap
+    {
+
+    public:
+	// Highest number of terms of the polynomials (pol7)
+	static constexpr int kMaxTerms = 8;
+
+	// Graphs of each component: [component][initial fit term][intermediate fit term]
+	using Graphs_t = std::array<std::vector<std::vector<TGraph const*>>, 3>;
+
+	SpaceChargeParametricMap() = default;
+
+	// Sample the coefficient graphs of the three components.
+	explicit SpaceChargeParametricMap(Graphs_t const& graphs);
+
+	bool Empty() const { return fNodes.empty(); }
+
+	// Components at (x, y, z), in map coordinates.
+	std::array<double, 3> Evaluate(double x, double y, double z) const;
+
+    private:
+	static constexpr int kNLanes = 3 * kMaxTerms;  // (component, initial term) pairs
+	static constexpr int kNodeSize = kMaxTerms * kNLanes;
+
+	// Index in a node table of the coefficient of intermediate term j.
+	static std::size_t Index(int component, int i, int j)
+	    { return std::size_t(j) * kNLanes + component * kMaxTerms + i; }
+
+	std::vector<double> fNodes;         // sorted graph abscissae
+	std::vector<double> fCoefficients;  // kNodeSize coefficients per node
+    }; // class SpaceChargeParametricMap
+} //namespace spacecharge
+
+//----------------------------------------------------------------------
+inline spacecharge::SpaceChargeParametricMap::SpaceChargeParametricMap(Graphs_t const& graphs)
+{
+    for (auto const& component: graphs) {
+	if (component.size() > std::size_t(kMaxTerms))
+	    throw cet::exception("SpaceChargeParametricMap") << "Initial fit has " << component.size()
+							     << " terms, at most " << kMaxTerms << " supported\n";
+	for (auto const& terms: component) {
+	    if (terms.size() > std::size_t(kMaxTerms))
+		throw cet::exception("SpaceChargeParametricMap") << "Intermediate fit has " << terms.size()
+								 << " terms, at most " << kMaxTerms << " supported\n";
+	    for (TGraph const* graph: terms) {
+		if (!graph || graph->GetN() == 0)
+		    throw cet::exception("SpaceChargeParametricMap") << "Missing or empty coefficient graph\n";
+		fNodes.insert(fNodes.end(), graph->GetX(), graph->GetX() + graph->GetN());
+	    }
+	}
+    }
+    std::sort(fNodes.begin(), fNodes.end());
+    fNodes.erase(std::unique(fNodes.begin(), fNodes.end()), fNodes.end());
+
+    // unused terms stay 0 and do not change the polynomials
+    fCoefficients.assign(fNodes.size() * kNodeSize, 0.);
+    for (std::size_t node = 0; node < fNodes.size(); ++node) {
+	double* const coefficients = fCoefficients.data() + node * kNodeSize;
+	for (int c = 0; c < 3; ++c)
+	    for (std::size_t i = 0; i < graphs[c].size(); ++i)
+		for (std::size_t j = 0; j < graphs[c][i].size(); ++j)
+		    coefficients[Index(c, i, j)] = graphs[c][i][j]->Eval(fNodes[node]);
+    }
+}
+
+//----------------------------------------------------------------------
+inline std::array<double, 3> spacecharge::SpaceChargeParametricMap::Evaluate(double x, double y, double z) const
+{
+    if (fNodes.empty()) return { 0., 0., 0. };
+
+    // z segment, extrapolating from the first or last one as TGraph::Eval does
+    std::size_t low = 0;
+    double frac = 0.;
+    if (fNodes.size() > 1) {
+	low = std::upper_bound(fNodes.begin(), fNodes.end(), z) - fNodes.begin();
+	low = std::min(std::max(low, std::size_t(1)), fNodes.size() - 1) - 1;
+	frac = (z - fNodes[low]) / (fNodes[low + 1] - fNodes[low]);
+    }
+    double const* const lo = fCoefficients.data() + low * kNodeSize;
+    double const* const hi = fNodes.size() > 1 ? lo + kNodeSize : lo;
+
+    // the Y component is a polynomial in y of polynomials in x, the others the other way round
+    std::array<double, 3> const a = { y, x, y };
+    std::array<double, 3> const b = { x, y, x };
+    double aLane[kNLanes];
+    for (int c = 0; c < 3; ++c)
+	for (int i = 0; i < kMaxTerms; ++i) aLane[c * kMaxTerms + i] = a[c];
+
+    // intermediate polynomials in a of all components at once (Horner)
+    double parB[kNLanes] = {};
+    for (int j = kMaxTerms - 1; j >= 0; --j) {
+	double const* const loJ = lo + j * kNLanes;
+	double const* const hiJ = hi + j * kNLanes;
+	for (int l = 0; l < kNLanes; ++l)
+	    parB[l] = parB[l] * aLane[l] + (loJ[l] + frac * (hiJ[l] - loJ[l]));
+    }
+
+    // initial polynomials in b
+    std::array<double, 3> result;
+    for (int c = 0; c < 3; ++c) {
+	double value = 0.;
+	for (int i = kMaxTerms - 1; i >= 0; --i) value = value * b[c] + parB[c * kMaxTerms + i];
+	result[c] = value;
+    }
+    return result;
+}
+
+#endif // SPACECHARGE_SPACECHARGEPARAMETRICMAP_H
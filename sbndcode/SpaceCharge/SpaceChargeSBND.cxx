@@ -6,6 +6,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <math.h>
 #include <stdio.h>
@@ -16,6 +19,28 @@
 // Framework includes
 #include "cetlib_except/exception.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+namespace {
+
+    // batches smaller than this are not split among threads
+    constexpr std::size_t kMinParallelBatch = 4096;
+
+    // Calls fill(begin, end) on ranges of points covering [0, n)
+    template <typename Fill>
+    void ForEachPointRange(std::size_t n, Fill const& fill)
+    {
+        if(n < kMinParallelBatch){
+            fill(std::size_t(0), n);
+            return;
+        }
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n, kMinParallelBatch / 4),
+                          [&fill](tbb::blocked_range<std::size_t> const& range){ fill(range.begin(), range.end()); });
+    }
+
+} // local namespace
+
 spacecharge::SpaceChargeSBND::SpaceChargeSBND(fhicl::ParameterSet const& pset)
 {
     Configure(pset);
@@ -44,106 +69,64 @@ bool spacecharge::SpaceChargeSBND::Configure(fhicl::ParameterSet const& pset)
                     throw cet::exception("SpaceChargeSBND") << "Could not find the space charge effect file '" << fname << "'!\n";
                 }
 
-            if(fRepresentationType == "Voxelized_TH3"){
-      	      std::cout << "begin loading voxelized TH3s..." << std::endl;
-
-      	      //Load in histograms
-      	      TH3F* hTrueFwdX = (TH3F*) infile->Get("TrueFwd_Displacement_X");
-      	      TH3F* hTrueFwdY = (TH3F*) infile->Get("TrueFwd_Displacement_Y");
-      	      TH3F* hTrueFwdZ = (TH3F*) infile->Get("TrueFwd_Displacement_Z");
-      	      TH3F* hTrueBkwdX = (TH3F*) infile->Get("TrueBkwd_Displacement_X");
-      	      TH3F* hTrueBkwdY = (TH3F*) infile->Get("TrueBkwd_Displacement_Y");
-      	      TH3F* hTrueBkwdZ = (TH3F*) infile->Get("TrueBkwd_Displacement_Z");
-      	      TH3F* hTrueEFieldX = (TH3F*) infile->Get("True_ElecField_X");
-      	      TH3F* hTrueEFieldY = (TH3F*) infile->Get("True_ElecField_Y");
-      	      TH3F* hTrueEFieldZ = (TH3F*) infile->Get("True_ElecField_Z");
-
-      	      //https://root.cern.ch/doc/master/classTH1.html#a0367fe04ae8709fd4b82795d0a5462c3
-      	      //Set hist directories so they can be referenced elsewhere
-      	      //This needs to be done because they were read in from ext file
-      	      //Note this is not a property of the TH3F, so does't survive copying
-      	      hTrueFwdX->SetDirectory(0);
-      	      hTrueFwdY->SetDirectory(0);
-      	      hTrueFwdZ->SetDirectory(0);
-      	      hTrueBkwdX->SetDirectory(0);
-      	      hTrueBkwdY->SetDirectory(0);
-      	      hTrueBkwdZ->SetDirectory(0);
-      	      hTrueEFieldX->SetDirectory(0);
-      	      hTrueEFieldY->SetDirectory(0);
-      	      hTrueEFieldZ->SetDirectory(0);
-
-      	      //SCEhistograms can be accessed globally in this script
-      	      SCEhistograms = {hTrueFwdX, hTrueFwdY, hTrueFwdZ,
-      			       hTrueBkwdX, hTrueBkwdY, hTrueBkwdZ,
-      			       hTrueEFieldX, hTrueEFieldY, hTrueEFieldZ};
-
+            if(fRepresentationType == "Voxelized_TH3") fRepresentation = RepresentationType_t::kVoxelizedTH3;
+            else if(fRepresentationType == "Parametric") fRepresentation = RepresentationType_t::kParametric;
+            else fRepresentation = RepresentationType_t::kUnknown;
 
+            if(fRepresentation == RepresentationType_t::kVoxelizedTH3){
+      	      std::cout << "begin loading voxelized TH3s..." << std::endl;
+      	      fDefaultMaps = LoadVoxelMaps(*infile, fname);
       	      std::cout << "...finished loading TH3s" << std::endl;
-      	    }else if(fRepresentationType == "Parametric")
-                {
-                    for(int i = 0; i < initialSpatialFitPolN[0] + 1; i++)
-                        {
-                            for(int j = 0; j < intermediateSpatialFitPolN[0] + 1; j++)
-                                {
-                                    gSpatialGraphX[i][j] = (TGraph*)infile->Get(Form("deltaX/g%i_%i", i, j));
-
-                                }
-                            intermediateSpatialFitFunctionX[i] = new TF1(Form("intermediateSpatialFitFunctionX_%i", i), Form("pol%i", intermediateSpatialFitPolN[0]));
-                        }
-                    for(int i = 0; i < initialSpatialFitPolN[1] + 1; i++)
-                        {
-                            for(int j = 0; j < intermediateSpatialFitPolN[1] + 1; j++)
-                                {
-                                    gSpatialGraphY[i][j] = (TGraph*)infile->Get(Form("deltaY/g%i_%i", i, j));
-
-                                }
-                            intermediateSpatialFitFunctionY[i] = new TF1(Form("intermediateSpatialFitFunctionY_%i", i), Form("pol%i", intermediateSpatialFitPolN[1]));
-                        }
-                    for(int i = 0; i < initialSpatialFitPolN[2] + 1; i++)
-                        {
-                            for(int j = 0; j < intermediateSpatialFitPolN[2] + 1; j++)
-                                {
-                                    gSpatialGraphZ[i][j] = (TGraph*)infile->Get(Form("deltaZ/g%i_%i", i, j));
-
-                                }
-                            intermediateSpatialFitFunctionZ[i] = new TF1(Form("intermediateSpatialFitFunctionZ_%i", i), Form("pol%i", intermediateSpatialFitPolN[2]));
-                        }
 
-                    initialSpatialFitFunctionX =  new TF1("initialSpatialFitFunctionX", Form("pol%i", initialSpatialFitPolN[0]));
-                    initialSpatialFitFunctionY =  new TF1("initialSpatialFitFunctionY", Form("pol%i", initialSpatialFitPolN[1]));
-                    initialSpatialFitFunctionZ =  new TF1("initialSpatialFitFunctionZ", Form("pol%i", initialSpatialFitPolN[2]));
-
-                    for(int i = 0; i < initialEFieldFitPolN[0] + 1; i++)
-                        {
-                            for(int j = 0; j < intermediateEFieldFitPolN[0] + 1; j++)
-                                {
-                                    gEFieldGraphX[i][j] = (TGraph*)infile->Get(Form("deltaEx/g%i_%i", i, j));
-
-                                }
-                            intermediateEFieldFitFunctionX[i] = new TF1(Form("intermediateEFieldFitFunctionX_%i", i), Form("pol%i", intermediateEFieldFitPolN[0]));
-                        }
-                    for(int i = 0; i < initialEFieldFitPolN[1] + 1; i++)
-                        {
-                            for(int j = 0; j < intermediateEFieldFitPolN[1] + 1; j++)
-                                {
-                                    gEFieldGraphY[i][j] = (TGraph*)infile->Get(Form("deltaEy/g%i_%i", i, j));
-
-                                }
-                            intermediateEFieldFitFunctionY[i] = new TF1(Form("intermediateEFieldFitFunctionY_%i", i), Form("pol%i", intermediateEFieldFitPolN[1]));
-                        }
-                    for(int i = 0; i < initialEFieldFitPolN[2] + 1; i++)
+      	      //maps replacing the default ones for ranges of Update() keys (run numbers from
+      	      //SpaceChargeServiceSBND); the first ones are preloaded, the others read on demand
+      	      fMapIntervals.clear();
+      	      for(auto const& interval: pset.get<std::vector<fhicl::ParameterSet>>("TimeDependentMaps", {})){
+      	        fMapIntervals.push_back({ interval.get<std::uint64_t>("ValidFrom"), interval.get<std::uint64_t>("ValidTo"),
+      	                                  interval.get<std::string>("InputFilename") });
+      	      }
+      	      std::sort(fMapIntervals.begin(), fMapIntervals.end(),
+      	                [](MapInterval const& a, MapInterval const& b){ return a.begin < b.begin; });
+      	      for(std::size_t i = 0; i < fMapIntervals.size(); ++i){
+      	        if(fMapIntervals[i].end < fMapIntervals[i].begin || (i > 0 && fMapIntervals[i].begin <= fMapIntervals[i-1].end)){
+      	          throw cet::exception("SpaceChargeSBND") << "Space charge map '" << fMapIntervals[i].filename
+      	                                                  << "' has an empty validity interval or overlaps another one\n";
+      	        }
+      	      }
+      	      fMapCacheSize = std::max(pset.get<std::size_t>("MapCacheSize", 4), std::size_t(1));
+      	      fMapCache.clear();
+      	      for(std::size_t i = 0; i < std::min(fMapIntervals.size(), fMapCacheSize); ++i) CachedVoxelMaps(i);
+
+      	      fRetiredMaps.reset();
+      	      fActiveMaps.reset();
+      	      fActiveInterval = kNoInterval;
+      	      SetActiveMaps(fDefaultMaps);
+      	    }else if(fRepresentation == RepresentationType_t::kParametric)
+                {
+                    //the coefficient graphs are sampled into the maps, and not needed after
+                    std::vector<std::unique_ptr<TGraph>> graphs;
+                    auto loadGraphs = [&](char const* dir, int const* initialPolN, int const* intermediatePolN, int axis)
                         {
-                            for(int j = 0; j < intermediateEFieldFitPolN[2] + 1; j++)
+                            std::vector<std::vector<TGraph const*>> axisGraphs(initialPolN[axis] + 1);
+                            for(int i = 0; i < initialPolN[axis] + 1; i++)
                                 {
-                                    gEFieldGraphZ[i][j] = (TGraph*)infile->Get(Form("deltaEz/g%i_%i", i, j));
-
+                                    for(int j = 0; j < intermediatePolN[axis] + 1; j++)
+                                        {
+                                            graphs.emplace_back((TGraph*)infile->Get(Form("%s/g%i_%i", dir, i, j)));
+                                            axisGraphs[i].push_back(graphs.back().get());
+                                        }
                                 }
-                            intermediateEFieldFitFunctionZ[i] = new TF1(Form("intermediateEFieldFitFunctionZ_%i", i), Form("pol%i", intermediateEFieldFitPolN[2]));
-                        }
-
-                    initialEFieldFitFunctionX =  new TF1("initialEFieldFitFunctionX", Form("pol%i", initialEFieldFitPolN[0]));
-                    initialEFieldFitFunctionY =  new TF1("initialEFieldFitFunctionY", Form("pol%i", initialEFieldFitPolN[1]));
-                    initialEFieldFitFunctionZ =  new TF1("initialEFieldFitFunctionZ", Form("pol%i", initialEFieldFitPolN[2]));
+                            return axisGraphs;
+                        };
+
+                    fSpatialMap = SpaceChargeParametricMap({
+                        loadGraphs("deltaX", initialSpatialFitPolN, intermediateSpatialFitPolN, 0),
+                        loadGraphs("deltaY", initialSpatialFitPolN, intermediateSpatialFitPolN, 1),
+                        loadGraphs("deltaZ", initialSpatialFitPolN, intermediateSpatialFitPolN, 2)});
+                    fEFieldMap = SpaceChargeParametricMap({
+                        loadGraphs("deltaEx", initialEFieldFitPolN, intermediateEFieldFitPolN, 0),
+                        loadGraphs("deltaEy", initialEFieldFitPolN, intermediateEFieldFitPolN, 1),
+                        loadGraphs("deltaEz", initialEFieldFitPolN, intermediateEFieldFitPolN, 2)});
                 }else{
                   std::cout << "fRepresentationType not known!!!" << std::endl;
                 }
@@ -164,9 +147,89 @@ bool spacecharge::SpaceChargeSBND::Update(uint64_t ts)
             return false;
         }
 
+    if (fRepresentation == RepresentationType_t::kVoxelizedTH3 && !fMapIntervals.empty())
+        {
+            //the last interval starting not after ts, if it contains ts
+            auto it = std::upper_bound(fMapIntervals.begin(), fMapIntervals.end(), ts,
+                                       [](uint64_t key, MapInterval const& interval){ return key < interval.begin; });
+            std::size_t interval = kNoInterval;
+            if (it != fMapIntervals.begin() && ts <= std::prev(it)->end) interval = std::prev(it) - fMapIntervals.begin();
+
+            if (interval != fActiveInterval)
+                {
+                    SetActiveMaps(interval == kNoInterval? fDefaultMaps: CachedVoxelMaps(interval));
+                    fActiveInterval = interval;
+                }
+        }
+
     return true;
 }
 
+// Reads the forward, backward and E field voxelized maps from an open file
+std::shared_ptr<spacecharge::SpaceChargeSBND::VoxelMaps const>
+spacecharge::SpaceChargeSBND::LoadVoxelMaps(TFile& infile, std::string const& fname)
+{
+    //Load in histograms
+    TH3F* hTrueFwdX = (TH3F*) infile.Get("TrueFwd_Displacement_X");
+    TH3F* hTrueFwdY = (TH3F*) infile.Get("TrueFwd_Displacement_Y");
+    TH3F* hTrueFwdZ = (TH3F*) infile.Get("TrueFwd_Displacement_Z");
+    TH3F* hTrueBkwdX = (TH3F*) infile.Get("TrueBkwd_Displacement_X");
+    TH3F* hTrueBkwdY = (TH3F*) infile.Get("TrueBkwd_Displacement_Y");
+    TH3F* hTrueBkwdZ = (TH3F*) infile.Get("TrueBkwd_Displacement_Z");
+    TH3F* hTrueEFieldX = (TH3F*) infile.Get("True_ElecField_X");
+    TH3F* hTrueEFieldY = (TH3F*) infile.Get("True_ElecField_Y");
+    TH3F* hTrueEFieldZ = (TH3F*) infile.Get("True_ElecField_Z");
+
+    for(TH3F const* h: {hTrueFwdX, hTrueFwdY, hTrueFwdZ, hTrueBkwdX, hTrueBkwdY, hTrueBkwdZ,
+                        hTrueEFieldX, hTrueEFieldY, hTrueEFieldZ}){
+      if(!h) throw cet::exception("SpaceChargeSBND") << "Missing map in the space charge effect file '" << fname << "'!\n";
+    }
+
+    //copy the maps into voxel grids, one per quantity with all three components
+    //together; the histograms are owned by the file and go away with it
+    auto maps = std::make_shared<VoxelMaps>();
+    maps->fwdDisplacement = SpaceChargeVoxelGrid(*hTrueFwdX, *hTrueFwdY, *hTrueFwdZ);
+    maps->bkwdDisplacement = SpaceChargeVoxelGrid(*hTrueBkwdX, *hTrueBkwdY, *hTrueBkwdZ);
+    maps->eField = SpaceChargeVoxelGrid(*hTrueEFieldX, *hTrueEFieldY, *hTrueEFieldZ);
+    return maps;
+}
+
+// Maps of a validity interval, from the cache or else from their file
+std::shared_ptr<spacecharge::SpaceChargeSBND::VoxelMaps const> spacecharge::SpaceChargeSBND::CachedVoxelMaps(std::size_t interval)
+{
+    auto cached = std::find_if(fMapCache.begin(), fMapCache.end(),
+                               [interval](auto const& entry){ return entry.first == interval; });
+    if (cached != fMapCache.end())
+        {
+            fMapCache.splice(fMapCache.begin(), fMapCache, cached);  //now the most recently used
+            return fMapCache.front().second;
+        }
+
+    std::string fname;
+    cet::search_path sp("FW_SEARCH_PATH");
+    sp.find_file(fMapIntervals[interval].filename, fname);
+    std::unique_ptr<TFile> infile(new TFile(fname.c_str(), "READ"));
+    if(!infile->IsOpen())
+        {
+            throw cet::exception("SpaceChargeSBND") << "Could not find the space charge effect file '" << fname << "'!\n";
+        }
+    std::cout << "loading voxelized TH3s from " << fname << std::endl;
+    fMapCache.emplace_front(interval, LoadVoxelMaps(*infile, fname));
+    infile->Close();
+
+    if (fMapCache.size() > fMapCacheSize) fMapCache.pop_back();
+    return fMapCache.front().second;
+}
+
+// Makes maps the ones used by the offset methods; the ones they replace are
+// kept until the next swap, for lookups that were already using them
+void spacecharge::SpaceChargeSBND::SetActiveMaps(std::shared_ptr<VoxelMaps const> maps)
+{
+    fRetiredMaps = std::move(fActiveMaps);
+    fActiveMaps = std::move(maps);
+    fMaps.store(fActiveMaps.get(), std::memory_order_release);
+}
+
 // Whether or not to turn simulation of SCE on for spatial distortions
 bool spacecharge::SpaceChargeSBND::EnableSimSpatialSCE() const
 {
@@ -200,334 +263,165 @@ bool spacecharge::SpaceChargeSBND::EnableCalEfieldSCE() const
 // Primary working method of service that provides position offsets
 geo::Vector_t spacecharge::SpaceChargeSBND::GetPosOffsets(geo::Point_t const& point) const
 {
-    std::vector<double> thePosOffsets;
-    double xx=point.X(), yy=point.Y(), zz=point.Z();
+    return PosOffsets(point.X(), point.Y(), point.Z());
+}
+
+void spacecharge::SpaceChargeSBND::GetPosOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets) const
+{
+    ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) offsets[i] = PosOffsets(points[i].X(), points[i].Y(), points[i].Z());
+      });
+}
 
-    if(fRepresentationType == "Voxelized_TH3"){
+void spacecharge::SpaceChargeSBND::GetPosOffsets(std::size_t n, double const* x, double const* y, double const* z,
+                                                 geo::Vector_t* offsets) const
+{
+    ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) offsets[i] = PosOffsets(x[i], y[i], z[i]);
+      });
+}
+
+geo::Vector_t spacecharge::SpaceChargeSBND::PosOffsets(double xx, double yy, double zz) const
+{
+    double const pointX=xx, pointY=yy, pointZ=zz;
+
+    if(fRepresentation == RepresentationType_t::kVoxelizedTH3){
       //handle OOAV by projecting edge cases
-      if(xx<-199.999){xx=-199.999;}
-      else if(xx>199.999){xx=199.999;}
-      if(yy<-199.999){yy=-199.999;}
-      else if(yy>199.999){yy=199.999;}
-      if(zz<0.001){zz=0.001;}
-      else if(zz>499.999){zz=499.999;}
+      ClampToVoxelMap(xx, yy, zz);
       //larsim requires negative sign in TPC 0
       int corr = 1;
       if (xx < 0) { corr = -1; }
-      double offset_x=0., offset_y=0., offset_z=0.;
-      offset_x = corr*SCEhistograms.at(0)->Interpolate(xx,yy,zz);
-      offset_y = SCEhistograms.at(1)->Interpolate(xx,yy,zz);
-      offset_z = SCEhistograms.at(2)->Interpolate(xx,yy,zz);
-      thePosOffsets = {offset_x, offset_y, offset_z};
-
-    }else if(fRepresentationType == "Parametric"){
-      if(IsInsideBoundaries(point.X(), point.Y(), point.Z()) == false){
-        thePosOffsets.resize(3, 0.0);
-      }else{
+      auto const offset = ActiveMaps().fwdDisplacement.Interpolate(xx,yy,zz);
+      return { corr*offset[0], offset[1], offset[2] };
+
+    }else if(fRepresentation == RepresentationType_t::kParametric){
+      if(IsInsideBoundaries(pointX, pointY, pointZ) == true){
         // GetPosOffsetsParametric returns m; the PosOffsets should be in cm
-        thePosOffsets = GetPosOffsetsParametric(xx, yy, zz);
-        for(int i=0; i<3; i++){thePosOffsets[i]=100.*thePosOffsets[i];}
+        auto const offset = GetPosOffsetsParametric(xx, yy, zz);
+        return { 100.*offset[0], 100.*offset[1], 100.*offset[2] };
       }
     }
-    else{
-      thePosOffsets.resize(3, 0.0);
-    }
 
-    return { thePosOffsets[0], thePosOffsets[1], thePosOffsets[2] };
+    return { 0., 0., 0. };
+}
+
+// Projects points out of the active volume onto the edges of the voxelized maps
+void spacecharge::SpaceChargeSBND::ClampToVoxelMap(double& xx, double& yy, double& zz)
+{
+  if(xx<-199.999){xx=-199.999;}
+  else if(xx>199.999){xx=199.999;}
+  if(yy<-199.999){yy=-199.999;}
+  else if(yy>199.999){yy=199.999;}
+  if(zz<0.001){zz=0.001;}
+  else if(zz>499.999){zz=499.999;}
 }
 
 // Provides backward position offset for analyzers (TH3)
 geo::Vector_t spacecharge::SpaceChargeSBND::GetCalPosOffsets(geo::Point_t const& point, int const& TPCid ) const
 {
-  std::vector<double> theCalPosOffsets;
-  double xx=point.X(), yy=point.Y(), zz=point.Z();
+  if(fRepresentation == RepresentationType_t::kParametric){
+    //this is not supported for parametric
+    std::cout << "Change Representation Type to Voxelized TH3 if you want to use the backward offset function" << std::endl;
+  }
+  return CalPosOffsets(point.X(), point.Y(), point.Z(), TPCid);
+}
+
+void spacecharge::SpaceChargeSBND::GetCalPosOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets,
+                                                    int TPCid) const
+{
+  if(fRepresentation == RepresentationType_t::kParametric){
+    std::cout << "Change Representation Type to Voxelized TH3 if you want to use the backward offset function" << std::endl;
+  }
+  ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+      for(std::size_t i = begin; i < end; ++i) offsets[i] = CalPosOffsets(points[i].X(), points[i].Y(), points[i].Z(), TPCid);
+    });
+}
 
-  if(fRepresentationType == "Voxelized_TH3"){
+void spacecharge::SpaceChargeSBND::GetCalPosOffsets(std::size_t n, double const* x, double const* y, double const* z,
+                                                    geo::Vector_t* offsets, int TPCid) const
+{
+  if(fRepresentation == RepresentationType_t::kParametric){
+    std::cout << "Change Representation Type to Voxelized TH3 if you want to use the backward offset function" << std::endl;
+  }
+  ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+      for(std::size_t i = begin; i < end; ++i) offsets[i] = CalPosOffsets(x[i], y[i], z[i], TPCid);
+    });
+}
+
+geo::Vector_t spacecharge::SpaceChargeSBND::CalPosOffsets(double xx, double yy, double zz, int TPCid) const
+{
+  if(fRepresentation == RepresentationType_t::kVoxelizedTH3){
     //handle OOAV by projecting edge cases
-    if(xx<-199.999){xx=-199.999;}
-    else if(xx>199.999){xx=199.999;}
-    if(yy<-199.999){yy=-199.999;}
-    else if(yy>199.999){yy=199.999;}
-    if(zz<0.001){zz=0.001;}
-    else if(zz>499.999){zz=499.999;}
+    ClampToVoxelMap(xx, yy, zz);
     //correct for charge drifted across cathode
     if ((TPCid == 0) and (xx > -2.5)) { xx = -2.5; }
     if ((TPCid == 1) and (xx < 2.5)) { xx = 2.5; }
-    double offset_x=0., offset_y=0., offset_z=0.;
-    offset_x = SCEhistograms.at(3)->Interpolate(xx,yy,zz);
-    offset_y = SCEhistograms.at(4)->Interpolate(xx,yy,zz);
-    offset_z = SCEhistograms.at(5)->Interpolate(xx,yy,zz);
-    theCalPosOffsets = {offset_x, offset_y, offset_z};
-    
-  }else if(fRepresentationType == "Parametric"){     
-    //this is not supported for parametric
-    std::cout << "Change Representation Type to Voxelized TH3 if you want to use the backward offset function" << std::endl;
-    theCalPosOffsets.resize(3, 0.0);
+    auto const offset = ActiveMaps().bkwdDisplacement.Interpolate(xx,yy,zz);
+    return { offset[0], offset[1], offset[2] };
   }
   
-  return { theCalPosOffsets[0], theCalPosOffsets[1], theCalPosOffsets[2] };
+  return { 0., 0., 0. };
 }
 
 
 
 // Provides position offsets using a parametric representation
-std::vector<double> spacecharge::SpaceChargeSBND::GetPosOffsetsParametric(double xVal, double yVal, double zVal) const
+std::array<double, 3> spacecharge::SpaceChargeSBND::GetPosOffsetsParametric(double xVal, double yVal, double zVal) const
 {
-    std::vector<double> thePosOffsetsParametric;
-
-    double xValNew = TransformX(xVal);
-    double yValNew = TransformY(yVal);
-    double zValNew = TransformZ(zVal);
-
-    thePosOffsetsParametric.push_back(GetOnePosOffsetParametric(xValNew, yValNew, zValNew, "X"));
-    thePosOffsetsParametric.push_back(GetOnePosOffsetParametric(xValNew, yValNew, zValNew, "Y"));
-    thePosOffsetsParametric.push_back(GetOnePosOffsetParametric(xValNew, yValNew, zValNew, "Z"));
-
-    return thePosOffsetsParametric;
+    return fSpatialMap.Evaluate(TransformX(xVal), TransformY(yVal), TransformZ(zVal));
 }
 
-// Provides one position offset using a parametric representation, for a given axis
-double spacecharge::SpaceChargeSBND::GetOnePosOffsetParametric(double xValNew, double yValNew, double zValNew, std::string axis) const
+// Primary working method of service that provides E field offsets
+geo::Vector_t spacecharge::SpaceChargeSBND::GetEfieldOffsets(geo::Point_t const& point) const
 {
-    double parA[99][99];
-    double parB[99];
-
-    for(int i = 0; i < 99; i++)
-        {
-            for(int j = 0; j < 99; j++)
-                {
-                    parA[i][j] = 0.0;
-                }
-            parB[i] = 0.0;
-        }
-    if(axis == "X")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[0] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateSpatialFitPolN[0] + 1; j++)
-                        {
-                            parA[i][j] = gSpatialGraphX[i][j]->Eval(zValNew);
-                        }
-                    intermediateSpatialFitFunctionX[i]->SetParameters(parA[i]);
-                }
-        }
-    else if(axis == "Y")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[1] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateSpatialFitPolN[1] + 1; j++)
-                        {
-                            parA[i][j] = gSpatialGraphY[i][j]->Eval(zValNew);
-                        }
-                    intermediateSpatialFitFunctionY[i]->SetParameters(parA[i]);
-                }
-        }
-    else if(axis == "Z")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[2] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateSpatialFitPolN[2] + 1; j++)
-                        {
-                            parA[i][j] = gSpatialGraphZ[i][j]->Eval(zValNew);
-                        }
-                    intermediateSpatialFitFunctionZ[i]->SetParameters(parA[i]);
-                }
-        }
-
-    double aValNew;
-    double bValNew;
+    return EfieldOffsets(point.X(), point.Y(), point.Z());
+}
 
-    if(axis == "Y")
-        {
-            aValNew = xValNew;
-            bValNew = yValNew;
-        }
-    else
-        {
-            aValNew = yValNew;
-            bValNew = xValNew;
-        }
-    double offsetValNew = 0.0;
-    if(axis == "X")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[0] + 1; i++)
-                {
-                    parB[i] = intermediateSpatialFitFunctionX[i]->Eval(aValNew);
-                }
-            initialSpatialFitFunctionX->SetParameters(parB);
-            offsetValNew = initialSpatialFitFunctionX->Eval(bValNew);
-        }
-    else if(axis == "Y")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[1] + 1; i++)
-                {
-                    parB[i] = intermediateSpatialFitFunctionY[i]->Eval(aValNew);
-                }
-            initialSpatialFitFunctionY->SetParameters(parB);
-            offsetValNew = initialSpatialFitFunctionY->Eval(bValNew);
-        }
-    else if(axis == "Z")
-        {
-            for(int i = 0; i < initialSpatialFitPolN[2] + 1; i++)
-                {
-                    parB[i] = intermediateSpatialFitFunctionZ[i]->Eval(aValNew);
-                }
-            initialSpatialFitFunctionZ->SetParameters(parB);
-            offsetValNew = initialSpatialFitFunctionZ->Eval(bValNew);
-        }
+void spacecharge::SpaceChargeSBND::GetEfieldOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets) const
+{
+    ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) offsets[i] = EfieldOffsets(points[i].X(), points[i].Y(), points[i].Z());
+      });
+}
 
-    return offsetValNew;
+void spacecharge::SpaceChargeSBND::GetEfieldOffsets(std::size_t n, double const* x, double const* y, double const* z,
+                                                    geo::Vector_t* offsets) const
+{
+    ForEachPointRange(n, [&](std::size_t begin, std::size_t end){
+        for(std::size_t i = begin; i < end; ++i) offsets[i] = EfieldOffsets(x[i], y[i], z[i]);
+      });
 }
 
-// Primary working method of service that provides E field offsets
-geo::Vector_t spacecharge::SpaceChargeSBND::GetEfieldOffsets(geo::Point_t const& point) const
+geo::Vector_t spacecharge::SpaceChargeSBND::EfieldOffsets(double xx, double yy, double zz) const
 {
-    std::vector<double> theEfieldOffsets;
-    double xx=point.X(), yy=point.Y(), zz=point.Z();
-    double offset_x=0., offset_y=0., offset_z=0.;
+    double const pointX=xx, pointY=yy, pointZ=zz;
 
-    if(fRepresentationType == "Voxelized_TH3"){
+    if(fRepresentation == RepresentationType_t::kVoxelizedTH3){
       //handle OOAV by projecting edge cases
-      if(xx<-199.999){xx=-199.999;}
-      else if(xx>199.999){xx=199.999;}
-      if(yy<-199.999){yy=-199.999;}
-      else if(yy>199.999){yy=199.999;}
-      if(zz<0.001){zz=0.001;}
-      else if(zz>499.999){zz=499.999;}
-      offset_x = SCEhistograms.at(6)->Interpolate(xx, yy, zz);
-      offset_y = SCEhistograms.at(7)->Interpolate(xx, yy, zz);
-      offset_z = SCEhistograms.at(8)->Interpolate(xx, yy, zz);
-
-      theEfieldOffsets = {offset_x, offset_y, offset_z};
+      ClampToVoxelMap(xx, yy, zz);
+      auto const offset = ActiveMaps().eField.Interpolate(xx, yy, zz);
+      return { offset[0], offset[1], offset[2] };
       
-    }else if(fRepresentationType == "Parametric"){
+    }else if(fRepresentation == RepresentationType_t::kParametric){
 
-      if(IsInsideBoundaries(point.X(), point.Y(), point.Z()) == false){
-	theEfieldOffsets.resize(3, 0.0);
-      }
-      else
+      if(IsInsideBoundaries(pointX, pointY, pointZ) == true)
         {
-	  theEfieldOffsets = GetEfieldOffsetsParametric(point.X(), point.Y(), point.Z());
+	  auto const offset = GetEfieldOffsetsParametric(pointX, pointY, pointZ);
 
-	  // GetOneEfieldOffsetParametric returns V/m
+	  // GetEfieldOffsetsParametric returns V/m
 	  // The E-field offsets are returned as -dEx/|E_nominal|, -dEy/|E_nominal|, and -dEz/|E_nominal| where |E_nominal| is DriftField
-	  theEfieldOffsets[0] = -1.0 * theEfieldOffsets[0] / (100.0 * DriftField);
-	  theEfieldOffsets[1] = -1.0 * theEfieldOffsets[1] / (100.0 * DriftField);
-	  theEfieldOffsets[2] = -1.0 * theEfieldOffsets[2] / (100.0 * DriftField);
+	  double const scale = -1.0 / (100.0 * DriftField);
+	  return { scale * offset[0], scale * offset[1], scale * offset[2] };
 	}
     }
 
-    return { theEfieldOffsets[0], theEfieldOffsets[1], theEfieldOffsets[2] };
+    return { 0., 0., 0. };
 }
 
 // Provides E-field offsets using a parametric representation
-std::vector<double> spacecharge::SpaceChargeSBND::GetEfieldOffsetsParametric(double xVal, double yVal, double zVal) const
+std::array<double, 3> spacecharge::SpaceChargeSBND::GetEfieldOffsetsParametric(double xVal, double yVal, double zVal) const
 {
-    std::vector<double> theEfieldOffsetsParametric;
-
-    double xValNew = TransformX(xVal);
-    double yValNew = TransformY(yVal);
-    double zValNew = TransformZ(zVal);
-
-    theEfieldOffsetsParametric.push_back(GetOneEfieldOffsetParametric(xValNew, yValNew, zValNew, "X"));
-    theEfieldOffsetsParametric.push_back(GetOneEfieldOffsetParametric(xValNew, yValNew, zValNew, "Y"));
-    theEfieldOffsetsParametric.push_back(GetOneEfieldOffsetParametric(xValNew, yValNew, zValNew, "Z"));
-
-    return theEfieldOffsetsParametric;
-}
-
-// Provides one E-field offset using a parametric representation, for a given axis
-double spacecharge::SpaceChargeSBND::GetOneEfieldOffsetParametric(double xValNew, double yValNew, double zValNew, std::string axis) const
-{
-    double parA[99][99];
-    double parB[99];
-
-    for(int i = 0; i < 99; i++)
-        {
-            for(int j = 0; j < 99; j++)
-                {
-                    parA[i][j] = 0.0;
-                }
-            parB[i] = 0.0;
-        }
-    if(axis == "X")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[0] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateEFieldFitPolN[0] + 1; j++)
-                        {
-                            parA[i][j] = gEFieldGraphX[i][j]->Eval(zValNew);
-                        }
-                    intermediateEFieldFitFunctionX[i]->SetParameters(parA[i]);
-                }
-        }
-    else if(axis == "Y")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[1] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateEFieldFitPolN[1] + 1; j++)
-                        {
-                            parA[i][j] = gEFieldGraphY[i][j]->Eval(zValNew);
-                        }
-                    intermediateEFieldFitFunctionY[i]->SetParameters(parA[i]);
-                }
-        }
-    else if(axis == "Z")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[2] + 1; i++)
-                {
-                    for(int j = 0; j < intermediateEFieldFitPolN[2] + 1; j++)
-                        {
-                            parA[i][j] = gEFieldGraphZ[i][j]->Eval(zValNew);
-                        }
-                    intermediateEFieldFitFunctionZ[i]->SetParameters(parA[i]);
-                }
-        }
-
-    double aValNew;
-    double bValNew;
-
-    if(axis == "Y")
-        {
-            aValNew = xValNew;
-            bValNew = yValNew;
-        }
-    else
-        {
-            aValNew = yValNew;
-            bValNew = xValNew;
-        }
-
-    double offsetValNew = 0.0;
-    if(axis == "X")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[0] + 1; i++)
-                {
-                    parB[i] = intermediateEFieldFitFunctionX[i]->Eval(aValNew);
-                }
-            initialEFieldFitFunctionX->SetParameters(parB);
-            offsetValNew = initialEFieldFitFunctionX->Eval(bValNew);
-        }
-    else if(axis == "Y")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[1] + 1; i++)
-                {
-                    parB[i] = intermediateEFieldFitFunctionY[i]->Eval(aValNew);
-                }
-            initialEFieldFitFunctionY->SetParameters(parB);
-            offsetValNew = initialEFieldFitFunctionY->Eval(bValNew);
-        }
-    else if(axis == "Z")
-        {
-            for(int i = 0; i < initialEFieldFitPolN[2] + 1; i++)
-                {
-                    parB[i] = intermediateEFieldFitFunctionZ[i]->Eval(aValNew);
-                }
-            initialEFieldFitFunctionZ->SetParameters(parB);
-            offsetValNew = initialEFieldFitFunctionZ->Eval(bValNew);
-        }
-
-    return offsetValNew;
+    return fEFieldMap.Evaluate(TransformX(xVal), TransformY(yVal), TransformZ(zVal));
 }
 
 // Transform LarSoft-X (cm) to SCE-X (m) coordinate
@@ -8,13 +8,23 @@
 #include "fhiclcpp/ParameterSet.h"
 
 // Others
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <TGraph.h>
-#include <TF1.h>
 #include <TH3.h>
 #include <TFile.h>
 
+#include "sbndcode/SpaceCharge/SpaceChargeParametricMap.h"
+#include "sbndcode/SpaceCharge/SpaceChargeVoxelGrid.h"
+
 namespace spacecharge
 {
     class SpaceChargeSBND : public SpaceCharge
@@ -40,6 +50,17 @@ namespace spacecharge
 	geo::Vector_t GetCalPosOffsets(geo::Point_t const& point, int const& TPCid = 1) const override;
 	geo::Vector_t GetCalEfieldOffsets(geo::Point_t const& point, int const& TPCid = 1) const override { return {0.,0.,0.}; }
 
+	// Batch versions of the offset methods, for n points given either as
+	// positions or as separate coordinate arrays: the offset of point i is
+	// written in offsets[i]. Large batches are shared among threads.
+	void GetPosOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets) const;
+	void GetPosOffsets(std::size_t n, double const* x, double const* y, double const* z, geo::Vector_t* offsets) const;
+	void GetEfieldOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets) const;
+	void GetEfieldOffsets(std::size_t n, double const* x, double const* y, double const* z, geo::Vector_t* offsets) const;
+	void GetCalPosOffsets(std::size_t n, geo::Point_t const* points, geo::Vector_t* offsets, int TPCid = 1) const;
+	void GetCalPosOffsets(std::size_t n, double const* x, double const* y, double const* z, geo::Vector_t* offsets,
+			      int TPCid = 1) const;
+
     private:
     protected:
 
@@ -55,40 +76,61 @@ namespace spacecharge
 	bool fEnableCalEfieldSCE;
 	bool fEnableCorrSCE;
 
+	enum class RepresentationType_t { kUnknown, kVoxelizedTH3, kParametric };
+
 	std::string fRepresentationType;
+	RepresentationType_t fRepresentation = RepresentationType_t::kUnknown;
 	std::string fInputFilename;
 
-	std::vector<double> GetPosOffsetsParametric(double xVal, double yVal, double zVal) const;
-	double GetOnePosOffsetParametric(double xVal, double yVal, double zVal, std::string axis) const;
-	std::vector<double> GetEfieldOffsetsParametric(double xVal, double yVal, double zVal) const;
-	double GetOneEfieldOffsetParametric(double xVal, double yVal, double zVal, std::string axis) const;
+	std::array<double, 3> GetPosOffsetsParametric(double xVal, double yVal, double zVal) const;
+	std::array<double, 3> GetEfieldOffsetsParametric(double xVal, double yVal, double zVal) const;
+	// Offsets of a single point, shared by the single point and batch methods
+	geo::Vector_t PosOffsets(double xx, double yy, double zz) const;
+	geo::Vector_t CalPosOffsets(double xx, double yy, double zz, int TPCid) const;
+	geo::Vector_t EfieldOffsets(double xx, double yy, double zz) const;
+
 	double TransformX(double xVal) const;
 	double TransformY(double yVal) const;
 	double TransformZ(double zVal) const;
 	bool IsInsideBoundaries(double xVal, double yVal, double zVal) const;
 
-	//to store Voxelized_TH3 histograms
-	std::vector<TH3F*> SCEhistograms = std::vector<TH3F*>(9);
-
-	TGraph *gSpatialGraphX[99][99];
-	TF1 *intermediateSpatialFitFunctionX[99];
-	TF1 *initialSpatialFitFunctionX;
-	TGraph *gSpatialGraphY[99][99];
-	TF1 *intermediateSpatialFitFunctionY[99];
-	TF1 *initialSpatialFitFunctionY;
-	TGraph *gSpatialGraphZ[99][99];
-	TF1 *intermediateSpatialFitFunctionZ[99];
-	TF1 *initialSpatialFitFunctionZ;
-
-	TGraph *gEFieldGraphX[99][99];
-	TF1 *intermediateEFieldFitFunctionX[99];
-	TF1 *initialEFieldFitFunctionX;
-	TGraph *gEFieldGraphY[99][99];
-	TF1 *intermediateEFieldFitFunctionY[99];
-	TF1 *initialEFieldFitFunctionY;
-	TGraph *gEFieldGraphZ[99][99];
-	TF1 *intermediateEFieldFitFunctionZ[99];
-	TF1 *initialEFieldFitFunctionZ;
+	// Voxelized_TH3 maps: forward and backward displacements, and E field
+	struct VoxelMaps {
+	    SpaceChargeVoxelGrid fwdDisplacement;
+	    SpaceChargeVoxelGrid bkwdDisplacement;
+	    SpaceChargeVoxelGrid eField;
+	};
+
+	// Maps replacing the default ones for Update() keys in [begin, end]
+	struct MapInterval {
+	    uint64_t begin;
+	    uint64_t end;
+	    std::string filename;
+	};
+	static constexpr std::size_t kNoInterval = std::numeric_limits<std::size_t>::max();
+
+	std::shared_ptr<VoxelMaps const> fDefaultMaps;  // from InputFilename
+	std::vector<MapInterval> fMapIntervals;         // sorted, not overlapping
+	std::size_t fMapCacheSize = 4;
+	std::list<std::pair<std::size_t, std::shared_ptr<VoxelMaps const>>> fMapCache;  // most recently used first
+
+	// The maps in use, swapped by Update(): the previous ones stay alive until the next swap
+	std::shared_ptr<VoxelMaps const> fActiveMaps;
+	std::shared_ptr<VoxelMaps const> fRetiredMaps;
+	std::atomic<VoxelMaps const*> fMaps{ nullptr };
+	std::size_t fActiveInterval = kNoInterval;
+
+	VoxelMaps const& ActiveMaps() const { return *fMaps.load(std::memory_order_acquire); }
+	static std::shared_ptr<VoxelMaps const> LoadVoxelMaps(TFile& infile, std::string const& fname);
+	std::shared_ptr<VoxelMaps const> CachedVoxelMaps(std::size_t interval);
+	void SetActiveMaps(std::shared_ptr<VoxelMaps const> maps);
+
+	// Voxelized_TH3 OOAV handling: the point is projected on the map edges
+	static void ClampToVoxelMap(double& xx, double& yy, double& zz);
+
+	// Parametric maps: displacements and E field
+	SpaceChargeParametricMap fSpatialMap;
+	SpaceChargeParametricMap fEFieldMap;
 }; // class SpaceChargeSBND
 } //namespace spacecharge
 #endif // SPACECHARGE_SPACECHARGESBND_H
@@ -0,0 +1,131 @@
+#ifndef SPACECHARGE_SPACECHARGEVOXELGRID_H
+#define SPACECHARGE_SPACECHARGEVOXELGRID_H
+
+// Three-component space charge map on a regular voxel grid.
+//
+// The three TH3 maps of one quantity (x, y and z components) are copied
+// into a single contiguous array of float triplets, so that a lookup does
+// one bin search and one trilinear interpolation for all the components.
+// The interpolation reproduces TH3::Interpolate: it uses the bin centres
+// as nodes, and points beyond the outermost bin centres get 0.
+
+// Framework libraries
+#include "cetlib_except/exception.h"
+
+// Others
+#include <array>
+#include <string>
+#include <vector>
+#include <TH3.h>
+
+namespace spacecharge
+{
+    class SpaceChargeVoxelGrid
+    {
+
+    public:
+	using Value_t = std::array<float, 3>;
+
+	SpaceChargeVoxelGrid() = default;
+
+	// Copy the bin contents of the three component maps, which must have the same fixed binning.
+	SpaceChargeVoxelGrid(TH3 const& hX, TH3 const& hY, TH3 const& hZ);
+
+	bool Empty() const { return fValues.empty(); }
+
+	// Components at (x, y, z), as TH3::Interpolate of each component map.
+	std::array<double, 3> Interpolate(double x, double y, double z) const;
+
+    private:
+	struct Axis {
+	    int nBins = 0;
+	    double min = 0.;
+	    double max = 0.;
+
+	    Axis() = default;
+	    explicit Axis(TAxis const& axis)
+		: nBins(axis.GetNbins()), min(axis.GetXmin()), max(axis.GetXmax()) {}
+
+	    bool operator==(Axis const& other) const
+		{ return nBins == other.nBins && min == other.min && max == other.max; }
+
+	    // TAxis::FindFixBin
+	    int FindBin(double v) const {
+		if (v < min) return 0;
+		if (!(v < max)) return nBins + 1;
+		return 1 + int(nBins * (v - min) / (max - min));
+	    }
+
+	    // TAxis::GetBinCenter
+	    double BinCenter(int bin) const {
+		double const binWidth = (max - min) / double(nBins);
+		return min + (bin - 1) * binWidth + 0.5 * binWidth;
+	    }
+
+	    // Lower interpolation node of v and its weight, false outside the nodes.
+	    bool Node(double v, int& lower, double& frac) const {
+		lower = FindBin(v);
+		if (v < BinCenter(lower)) lower -= 1;
+		if (lower <= 0 || lower + 1 > nBins) return false;
+		double const lowCenter = BinCenter(lower);
+		frac = (v - lowCenter) / (BinCenter(lower + 1) - lowCenter);
+		return true;
+	    }
+	};
+
+	// Index of bin (1..nBins on each axis) in fValues.
+	std::size_t Index(int ix, int iy, int iz) const
+	    { return (std::size_t(ix - 1) * fY.nBins + (iy - 1)) * fZ.nBins + (iz - 1); }
+
+	Axis fX, fY, fZ;
+	std::vector<Value_t> fValues;
+    }; // class SpaceChargeVoxelGrid
+} //namespace spacecharge
+
+//----------------------------------------------------------------------
+inline spacecharge::SpaceChargeVoxelGrid::SpaceChargeVoxelGrid(TH3 const& hX, TH3 const& hY, TH3 const& hZ)
+    : fX(*hX.GetXaxis()), fY(*hX.GetYaxis()), fZ(*hX.GetZaxis())
+{
+    for (TH3 const* h: { &hX, &hY, &hZ }) {
+	if (h->GetXaxis()->IsVariableBinSize() || h->GetYaxis()->IsVariableBinSize() || h->GetZaxis()->IsVariableBinSize())
+	    throw cet::exception("SpaceChargeVoxelGrid") << "Map '" << h->GetName() << "' has variable size bins\n";
+	if (!(Axis(*h->GetXaxis()) == fX && Axis(*h->GetYaxis()) == fY && Axis(*h->GetZaxis()) == fZ))
+	    throw cet::exception("SpaceChargeVoxelGrid") << "Map '" << h->GetName() << "' has a binning different from '"
+							 << hX.GetName() << "'\n";
+    }
+
+    fValues.resize(std::size_t(fX.nBins) * fY.nBins * fZ.nBins);
+    for (int ix = 1; ix <= fX.nBins; ++ix)
+	for (int iy = 1; iy <= fY.nBins; ++iy)
+	    for (int iz = 1; iz <= fZ.nBins; ++iz)
+		fValues[Index(ix, iy, iz)] = { float(hX.GetBinContent(ix, iy, iz)),
+					       float(hY.GetBinContent(ix, iy, iz)),
+					       float(hZ.GetBinContent(ix, iy, iz)) };
+}
+
+//----------------------------------------------------------------------
+inline std::array<double, 3> spacecharge::SpaceChargeVoxelGrid::Interpolate(double x, double y, double z) const
+{
+    int ubx = 0, uby = 0, ubz = 0;
+    double xd = 0., yd = 0., zd = 0.;
+    if (!fX.Node(x, ubx, xd) || !fY.Node(y, uby, yd) || !fZ.Node(z, ubz, zd)) return { 0., 0., 0. };
+
+    Value_t const* v[8] = { &fValues[Index(ubx, uby, ubz)],     &fValues[Index(ubx, uby, ubz + 1)],
+			    &fValues[Index(ubx, uby + 1, ubz)], &fValues[Index(ubx, uby + 1, ubz + 1)],
+			    &fValues[Index(ubx + 1, uby, ubz)], &fValues[Index(ubx + 1, uby, ubz + 1)],
+			    &fValues[Index(ubx + 1, uby + 1, ubz)], &fValues[Index(ubx + 1, uby + 1, ubz + 1)] };
+
+    std::array<double, 3> result;
+    for (int c = 0; c < 3; ++c) {
+	double const i1 = (*v[0])[c] * (1 - zd) + (*v[1])[c] * zd;
+	double const i2 = (*v[2])[c] * (1 - zd) + (*v[3])[c] * zd;
+	double const j1 = (*v[4])[c] * (1 - zd) + (*v[5])[c] * zd;
+	double const j2 = (*v[6])[c] * (1 - zd) + (*v[7])[c] * zd;
+	double const w1 = i1 * (1 - yd) + i2 * yd;
+	double const w2 = j1 * (1 - yd) + j2 * yd;
+	result[c] = w1 * (1 - xd) + w2 * xd;
+    }
+    return result;
+}
+
+#endif // SPACECHARGE_SPACECHARGEVOXELGRID_H
@@ -10,14 +10,31 @@
 #include "art/Framework/Principal/SubRun.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art_root_io/TFileService.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 // Root includes
+#include <TError.h>
+#include <TFile.h>
 #include <TH1.h>
+#include <TH3.h>
+#include <TTree.h>
 
 // Larsoft includes
 #include "larcore/CoreUtils/ServiceUtil.h"
 #include "larevt/SpaceChargeServices/SpaceChargeService.h"
+#include "sbndcode/SpaceCharge/SpaceChargeSBND.h"
+
+// C++ includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
 using namespace std;
 
@@ -26,6 +43,15 @@ namespace SpaceChargeTools
     class SpaceChargeTest;
 }
 
+// Besides the grid scan of the configured service, with Benchmark the module
+// measures the rate of the offset queries of SpaceChargeSBND, once at the
+// beginning of the job. Each configuration in BenchmarkConfigs (a full
+// space charge service configuration, e.g. one per representation) is
+// queried on the same random points, one point at a time and with the batch
+// methods. The batch offsets must be the same as the single point ones, and
+// for Voxelized_TH3 the offsets must match TH3::Interpolate of the maps in
+// the file within BenchmarkTolerance; a mismatch fails the job. The rates
+// are in the tree "benchmark".
 class SpaceChargeTools::SpaceChargeTest : public art::EDAnalyzer
 {
 public:
@@ -41,6 +67,26 @@ public:
 
 private:
 
+    void RunBenchmark(fhicl::ParameterSet const& config, std::vector<geo::Point_t> const& points);
+    void ReferenceCheck(fhicl::ParameterSet const& config, std::vector<geo::Point_t> const& points,
+                        std::vector<geo::Vector_t> const& posOffsets, std::vector<geo::Vector_t> const& efieldOffsets);
+    void Record(std::string const& method, std::size_t n, double seconds, double maxDiff);
+
+    bool fRunGridScan;
+    bool fBenchmark;
+    std::size_t fBenchmarkPoints;
+    unsigned fBenchmarkSeed;
+    double fBenchmarkTolerance;
+    std::vector<fhicl::ParameterSet> fBenchmarkConfigs;
+
+    TTree *fBenchmarkTree = nullptr;
+    std::string fRepresentation;
+    std::string fMethod;
+    unsigned fNPoints = 0;
+    double fSeconds = 0.;
+    double fRate = 0.;
+    double fMaxDiff = 0.;
+
     TH1D *hDx;
     TH1D *hDy;
     TH1D *hDz;
@@ -51,6 +97,12 @@ private:
 
 SpaceChargeTools::SpaceChargeTest::SpaceChargeTest(fhicl::ParameterSet const & p) : EDAnalyzer(p)
 {
+    fRunGridScan = p.get<bool>("RunGridScan", true);
+    fBenchmark = p.get<bool>("Benchmark", false);
+    fBenchmarkPoints = p.get<std::size_t>("BenchmarkPoints", 1000000);
+    fBenchmarkSeed = p.get<unsigned>("BenchmarkSeed", 12345);
+    fBenchmarkTolerance = p.get<double>("BenchmarkTolerance", 1e-5);
+    fBenchmarkConfigs = p.get<std::vector<fhicl::ParameterSet>>("BenchmarkConfigs", {});
 }
 
 SpaceChargeTools::SpaceChargeTest::~SpaceChargeTest() {}
@@ -66,12 +118,142 @@ void SpaceChargeTools::SpaceChargeTest::beginJob()
     hEx = fileServiceHandle->make<TH1D>("hEx", "", 100, -0.06, 0.06);
     hEy = fileServiceHandle->make<TH1D>("hEy", "", 100, -0.04, 0.04);
     hEz = fileServiceHandle->make<TH1D>("hEz", "", 100, -0.04, 0.04);
+
+    if(!fBenchmark) return;
+
+    fBenchmarkTree = fileServiceHandle->make<TTree>("benchmark", "Space charge offset query rates");
+    fBenchmarkTree->Branch("representation", &fRepresentation);
+    fBenchmarkTree->Branch("method", &fMethod);
+    fBenchmarkTree->Branch("nPoints", &fNPoints, "nPoints/i");
+    fBenchmarkTree->Branch("seconds", &fSeconds, "seconds/D");
+    fBenchmarkTree->Branch("rate", &fRate, "rate/D");      // queries per second
+    fBenchmarkTree->Branch("maxDiff", &fMaxDiff, "maxDiff/D"); // from the reference
+
+    // the same points for all the configurations: the active volume, and a little around it
+    std::mt19937_64 engine(fBenchmarkSeed);
+    std::uniform_real_distribution<double> xDist(-210., 210.), yDist(-210., 210.), zDist(-10., 510.);
+    std::vector<geo::Point_t> points(fBenchmarkPoints);
+    for(geo::Point_t& point: points) point = { xDist(engine), yDist(engine), zDist(engine) };
+
+    for(fhicl::ParameterSet const& config: fBenchmarkConfigs) RunBenchmark(config, points);
 }
 
 void SpaceChargeTools::SpaceChargeTest::endJob() {}
 
+void SpaceChargeTools::SpaceChargeTest::Record(std::string const& method, std::size_t n, double seconds, double maxDiff)
+{
+    fMethod = method;
+    fNPoints = n;
+    fSeconds = seconds;
+    fRate = seconds > 0. ? n / seconds : 0.;
+    fMaxDiff = maxDiff;
+    fBenchmarkTree->Fill();
+    mf::LogInfo("SpaceChargeTest") << fRepresentation << " " << method << ": " << n << " points in "
+                                   << seconds << " s, " << fRate << " queries/s"
+                                   << (maxDiff >= 0. ? ", max difference " + std::to_string(maxDiff) : std::string());
+}
+
+void SpaceChargeTools::SpaceChargeTest::RunBenchmark(fhicl::ParameterSet const& config,
+                                                     std::vector<geo::Point_t> const& points)
+{
+    using Clock_t = std::chrono::steady_clock;
+    auto seconds = [](Clock_t::time_point start){ return std::chrono::duration<double>(Clock_t::now() - start).count(); };
+    auto maxDiff = [](std::vector<geo::Vector_t> const& a, std::vector<geo::Vector_t> const& b){
+        double diff = 0.;
+        for(std::size_t i = 0; i < a.size(); ++i) diff = std::max(diff, (a[i] - b[i]).R());
+        return diff;
+    };
+
+    spacecharge::SpaceChargeSBND const sce(config);
+    fRepresentation = config.get<std::string>("RepresentationType");
+    std::size_t const n = points.size();
+
+    std::vector<geo::Vector_t> posOffsets(n), efieldOffsets(n), batchOffsets(n);
+
+    Clock_t::time_point start = Clock_t::now();
+    for(std::size_t i = 0; i < n; ++i) posOffsets[i] = sce.GetPosOffsets(points[i]);
+    Record("GetPosOffsets", n, seconds(start), -1.);
+
+    start = Clock_t::now();
+    for(std::size_t i = 0; i < n; ++i) efieldOffsets[i] = sce.GetEfieldOffsets(points[i]);
+    Record("GetEfieldOffsets", n, seconds(start), -1.);
+
+    start = Clock_t::now();
+    sce.GetPosOffsets(n, points.data(), batchOffsets.data());
+    double const posBatchDiff = maxDiff(batchOffsets, posOffsets);
+    Record("GetPosOffsetsBatch", n, seconds(start), posBatchDiff);
+
+    start = Clock_t::now();
+    sce.GetEfieldOffsets(n, points.data(), batchOffsets.data());
+    double const efieldBatchDiff = maxDiff(batchOffsets, efieldOffsets);
+    Record("GetEfieldOffsetsBatch", n, seconds(start), efieldBatchDiff);
+
+    if(posBatchDiff != 0. || efieldBatchDiff != 0.){
+        throw cet::exception("SpaceChargeTest") << fRepresentation << ": the batch offsets differ from the single point ones\n";
+    }
+
+    if(fRepresentation == "Voxelized_TH3") ReferenceCheck(config, points, posOffsets, efieldOffsets);
+}
+
+// TH3::Interpolate of the maps in the file, as SpaceChargeSBND did before the voxel grid
+void SpaceChargeTools::SpaceChargeTest::ReferenceCheck(fhicl::ParameterSet const& config,
+                                                       std::vector<geo::Point_t> const& points,
+                                                       std::vector<geo::Vector_t> const& posOffsets,
+                                                       std::vector<geo::Vector_t> const& efieldOffsets)
+{
+    std::string fname;
+    cet::search_path sp("FW_SEARCH_PATH");
+    sp.find_file(config.get<std::string>("InputFilename"), fname);
+    std::unique_ptr<TFile> infile(TFile::Open(fname.c_str(), "READ"));
+    if(!infile || !infile->IsOpen()){
+        throw cet::exception("SpaceChargeTest") << "Could not open the space charge effect file '" << fname << "'\n";
+    }
+    auto getMap = [&](char const* name){
+        TH3* h = infile->Get<TH3>(name);
+        if(!h) throw cet::exception("SpaceChargeTest") << "Missing map " << name << " in '" << fname << "'\n";
+        return h;
+    };
+    TH3* fwd[3] = { getMap("TrueFwd_Displacement_X"), getMap("TrueFwd_Displacement_Y"), getMap("TrueFwd_Displacement_Z") };
+    TH3* efield[3] = { getMap("True_ElecField_X"), getMap("True_ElecField_Y"), getMap("True_ElecField_Z") };
+
+    // TH3::Interpolate complains about the points beyond the outermost bin centres
+    Int_t const errorLevel = gErrorIgnoreLevel;
+    gErrorIgnoreLevel = kFatal;
+
+    std::size_t const n = points.size();
+    double posDiff = 0., efieldDiff = 0.;
+    auto const start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < n; ++i){
+        // the same projection of the points out of the active volume as SpaceChargeSBND
+        double const x = std::clamp(points[i].X(), -199.999, 199.999);
+        double const y = std::clamp(points[i].Y(), -199.999, 199.999);
+        double const z = std::clamp(points[i].Z(), 0.001, 499.999);
+        double const corr = x < 0 ? -1. : 1.;
+        geo::Vector_t const pos{ corr*fwd[0]->Interpolate(x, y, z),
+                                 fwd[1]->Interpolate(x, y, z),
+                                 fwd[2]->Interpolate(x, y, z) };
+        geo::Vector_t const field{ efield[0]->Interpolate(x, y, z),
+                                   efield[1]->Interpolate(x, y, z),
+                                   efield[2]->Interpolate(x, y, z) };
+        posDiff = std::max(posDiff, (pos - posOffsets[i]).R());
+        efieldDiff = std::max(efieldDiff, (field - efieldOffsets[i]).R());
+    }
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    gErrorIgnoreLevel = errorLevel;
+
+    // both offsets of a point per reference query
+    Record("TH3InterpolateReference", n, elapsed, std::max(posDiff, efieldDiff));
+
+    if(posDiff > fBenchmarkTolerance || efieldDiff > fBenchmarkTolerance){
+        throw cet::exception("SpaceChargeTest") << fRepresentation << ": the offsets differ from TH3::Interpolate by up to "
+                                                << posDiff << " (position) and " << efieldDiff << " (E field)\n";
+    }
+}
+
 void SpaceChargeTools::SpaceChargeTest::analyze(art::Event const & evt)
 {
+    if(!fRunGridScan) return;
+
     int xMin = -206;
     int xMax = 206;
     int yMin = -210;
@@ -62,6 +62,7 @@
 #include "lardataobj/AnalysisBase/T0.h"
 
 #include "sbndcode/RecoUtils/RecoUtils.h"
+#include "sbndcode/RecoUtils/TruthIndex/TruthIndex.h"
 #include "lardataobj/MCBase/MCShower.h"
 
 // sbndcode includes
@@ -69,6 +70,7 @@
 #include "sbnobj/SBND/CRT/CRTTrack.hh"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
 #include "sbndcode/CRT/CRTBackTracker/CRTBackTrackerAlg.h"
+#include "sbndcode/ToFStudies/ToFMatching.h"
 
 #include "lardataobj/RecoBase/OpHit.h"
 
@@ -119,7 +121,6 @@ public:
 
   void beginJob() override;
   void analyze(art::Event const& evt) override;
-  bool SpacePointCompare(const art::Ptr<CRTSpacePoint>& sp1, const art::Ptr<CRTSpacePoint>& sp2);
   void ClearVecs();
   double length(const simb::MCParticle& part, TVector3& start, TVector3& end);
 
@@ -128,6 +129,7 @@ private:
   
   art::InputTag fGenLabel;
   art::InputTag fSimLabel;
+  art::InputTag fTruthIndexLabel; // sbnd::TruthIndex to look the particles up in, or empty
   art::InputTag fOpHitModuleLabel;
   art::InputTag fOpFlashModuleLabel0;
   art::InputTag fOpFlashModuleLabel1;
@@ -332,6 +334,7 @@ ToFAnalyzer::ToFAnalyzer(fhicl::ParameterSet const& pset):
 EDAnalyzer{pset},
 fGenLabel(pset.get<art::InputTag>("GenLabel")),
 fSimLabel(pset.get<art::InputTag>("SimLabel")),
+fTruthIndexLabel(pset.get<art::InputTag>("TruthIndexLabel", "")),
 fOpHitModuleLabel(pset.get<art::InputTag>("OpHitModuleLabel")),				
 fOpFlashModuleLabel0(pset.get<art::InputTag>("OpFlashModuleLabel0")),
 fOpFlashModuleLabel1(pset.get<art::InputTag>("OpFlashModuleLabel1")),
@@ -679,6 +682,81 @@ void ToFAnalyzer::analyze(art::Event const& evt)
  
  //==================================================================
  
+ // Index the track space points so each CRT space point finds its track without a loop over all of them
+ sbnd::tof::TrackSpacePointIndex trackSPIndex;
+ for(size_t itrk=0; itrk<tracksps.size(); itrk++){
+     for(auto const& sp : tracksps[itrk]) trackSPIndex.Add(itrk, sp);
+ }
+ trackSPIndex.Sort();
+ 
+ //==================================================================
+ 
+ // Optical hits and flashes are read once for the event and indexed in time
+ art::Handle< std::vector<recob::OpHit> > opHitListHandle;
+ std::vector< art::Ptr<recob::OpHit> >    opHitList;
+ if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
+     art::fill_ptr_vector(opHitList, opHitListHandle);
+ 
+ std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
+ std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
+ for(int i=0; i<2; i++) {
+     if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
+         art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
+ }
+ 
+ sbnd::tof::PmtTimeIndex hitIndex, flashIndex, flashAbsIndex;
+ for(auto const& hit : opHitList){
+     if(hit->PE()<fHitPeThresh) continue;
+     hitIndex.Add(hit->PeakTime()*1e3-fOpDelay, hit->PE(), -1, hit.key());
+ }
+ for(auto const& flashList : opFlashLists){
+     for(auto const& flash : flashList.second){
+	 if(flash->TotalPE()<fFlashPeThresh) continue;
+	 flashIndex.Add(flash->Time()*1e3-fOpDelay, flash->TotalPE(), flashList.first, flash.key());
+	 flashAbsIndex.Add(flash->AbsTime()*1e3-fOpDelay, flash->TotalPE(), flashList.first, flash.key());
+     }
+ }
+ hitIndex.Sort();
+ flashIndex.Sort();
+ flashAbsIndex.Sort();
+ 
+ // Key of the earliest optical hit of a flash, -1 if it has none
+ std::map<int, art::FindManyP<recob::OpHit>> findManyOpHits;
+ if(fLFlash_hit || fCFlash_hit){
+    for(auto const& flashList : opFlashLists)
+	findManyOpHits.emplace(flashList.first, art::FindManyP<recob::OpHit>(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]));
+ }
+ auto earliestHit = [&](int tpc, size_t flashKey){
+     int ophit_index = -1;
+     double flashMinHitT = DBL_MAX;
+     for(auto const& hit : findManyOpHits.at(tpc).at(flashKey)){
+	 double tPmt = hit->PeakTime()*1e3-fOpDelay; 
+	 if(tPmt < flashMinHitT){
+	    flashMinHitT = tPmt;
+	    ophit_index =  hit.key();    
+	 } // getting the earliest hit
+     } // loop over associated ophits of the flash
+     return ophit_index;
+ };
+ 
+ // Truth matched particles are looked up by track ID, in the truth index
+ // of the job when there is one
+ map<int,const simb::MCParticle*> particleMap;
+ const vector<simb::MCParticle>* simparticles = nullptr;
+ const sbnd::TruthIndex* truthIndex = nullptr;
+ if(fSaveTrueToFInfo){
+    simparticles = evt.getValidHandle<vector<simb::MCParticle>>(fSimLabel).product();
+    if(!fTruthIndexLabel.empty()) truthIndex = evt.getValidHandle<sbnd::TruthIndex>(fTruthIndexLabel).product();
+    else for(auto const& particle : *simparticles) particleMap[particle.TrackId()] = &particle;
+ }
+ auto findParticle = [&](int trackID) -> const simb::MCParticle* {
+     if(truthIndex) return truthIndex->Particle(trackID, *simparticles);
+     auto const it = particleMap.find(trackID);
+     return it == particleMap.end() ? nullptr : it->second;
+ };
+ 
+ //==================================================================
+ 
  art::Handle< std::vector<CRTSpacePoint> > crtSPListHandle;
  std::vector< art::Ptr<CRTSpacePoint> >    crtSPList;
  if( evt.getByLabel(fCrtSpacePointModuleLabel,crtSPListHandle))
@@ -720,19 +798,8 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      if(!(crt->Time() >= fBeamLow &&  crt->Time()<= fBeamUp)) continue;
      if(crt->PE() < fCRTSpacePointThresh) continue;
      
-     bool frm_trk=false;
-     int index=0;
-     
-     for(auto const& trksps: tracksps){
-	 for(size_t isp=0; isp<trksps.size(); isp++){
-	     if(SpacePointCompare(trksps[isp],crt)){
-		frm_trk=true;
-		break;
-	     }
-	  }
-	  if(frm_trk) break;
-	  index++;
-     }
+     int index = trackSPIndex.TrackIndex(*crt);
+     bool frm_trk = index >= 0;
      
      //======================== Doing a truth level study of ToF======================================
      
@@ -740,18 +807,14 @@ void ToFAnalyzer::analyze(art::Event const& evt)
 	const cheat::ParticleInventory *inventory_service=lar::providerFrom<cheat::ParticleInventoryService>();
 	sbnd::crt::CRTBackTrackerAlg::TruthMatchMetrics truthMatch=bt->TruthMatching(evt, cluster);
 	int trackID = truthMatch.trackid;
-
-	auto const& simparticles = *evt.getValidHandle<vector<simb::MCParticle>>(fSimLabel);
-        map<int,const simb::MCParticle*> particleMap;
-	for(auto const& particle : simparticles) particleMap[particle.TrackId()] = &particle;
 	
-	if(particleMap.find(abs(trackID))!=particleMap.end()){
+	const simb::MCParticle* particle = findParticle(abs(trackID));
+	if(particle){
 	   if(frm_trk){
 	      True_tof_crt_sps[index].push_back(crt);
-	      True_tof_sim_particles[index].push_back(particleMap[abs(trackID)]);
+	      True_tof_sim_particles[index].push_back(particle);
 	   }
 	   else{
-	       auto const& particle=particleMap[abs(trackID)];
 	       bool found_tpc_traj_point=false;
 	       for(size_t i=0; i<particle->NumberTrajectoryPoints(); i++){
 	           const TLorentzVector& pos = particle->Position(i);
@@ -814,25 +877,9 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //============================== Calculating ToF using largest optical hit ======================
      
      if(fLhit){
-        double pehit_max=0;
-	bool found_tof = false;
-	int ophit_index = -1;
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& hit : opHitList){
-	    if(hit->PE()<fHitPeThresh) continue;
-	    double thit = hit->PeakTime()*1e3-fOpDelay;
-	    
-	    if(abs(crt->Time()-thit)<fCoinWindow && hit->PE()>pehit_max){
-	       pehit_max = hit->PE();
-	       ophit_index = hit.key();
-	       found_tof = true;
-	    }
-	} // loop over optical hit list
+	const sbnd::tof::PmtCandidate* match = hitIndex.Largest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int ophit_index = found_tof ? match->key : -1;
 	
 	if(found_tof){
 	   if(frm_trk){
@@ -870,25 +917,9 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //============================== Calculating ToF using closest optical hit ======================
      
      if(fChit){
-        double ophit_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int ophit_index = -1;
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& hit : opHitList){
-	    if(hit->PE()<fHitPeThresh) continue;
-	    double thit = hit->PeakTime()*1e3-fOpDelay;
-	    
-	    if(abs(crt->Time()-thit)<fCoinWindow && abs(crt->Time()-thit)<ophit_minTOF){
-	       ophit_minTOF = abs(crt->Time()-thit);
-	       ophit_index = hit.key();
-	       found_tof = true;
-	    }
-	} // loop over optical hit list
+	const sbnd::tof::PmtCandidate* match = hitIndex.Closest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int ophit_index = found_tof ? match->key : -1;
 	
 	if(found_tof){
 	   if(frm_trk){
@@ -925,32 +956,10 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //============================== Calculating ToF using largest flash ============================
      
      if(fLFlash){
-        double peflash_max=0;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	for(auto const& flashList : opFlashLists){
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->AbsTime()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && flash->TotalPE()>peflash_max){
-		   peflash_max=flash->TotalPE();
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		} 
-	    } 
-	}
+	const sbnd::tof::PmtCandidate* match = flashAbsIndex.Largest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int opflash_index = found_tof ? match->key : -1;
+	int flash_tpc = found_tof ? match->tpc : -1;
 	
 	if(found_tof){
 	   if(frm_trk){
@@ -986,32 +995,10 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //============================== Calculating ToF using closest flash ============================
      
      if(fCFlash){
-        double flash_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	for(auto const& flashList : opFlashLists){
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->Time()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && abs(crt->Time()-tflash)<flash_minTOF){
-		   flash_minTOF= abs(crt->Time()-tflash);
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		} 
-	    } 
-	}
+	const sbnd::tof::PmtCandidate* match = flashIndex.Closest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int opflash_index = found_tof ? match->key : -1;
+	int flash_tpc = found_tof ? match->tpc : -1;
 	
 	if(found_tof){
 	   if(frm_trk){
@@ -1047,48 +1034,11 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //================ Calculating ToF using earliest hit of the largest flash ======================
      
      if(fLFlash_hit){
-        double peflash_max=0;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	int ophit_index = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& flashList : opFlashLists){	
-	    art::FindManyP<recob::OpHit> findManyOpHits(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]);	
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->AbsTime()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && flash->TotalPE()>peflash_max){
-		   peflash_max=flash->TotalPE();
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		   vector<art::Ptr<recob::OpHit>> hits = findManyOpHits.at(flash.key());
-		   double flashMinHitT = DBL_MAX;
-		   for(auto const& hit : hits){
-		       double tPmt = hit->PeakTime()*1e3-fOpDelay; 
-		       if(tPmt < flashMinHitT){
-			  flashMinHitT = tPmt;
-			  ophit_index =  hit.key();    
-		       } // getting the earliest hit
-		   } // loop over associated ophits of the flash
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
+	const sbnd::tof::PmtCandidate* match = flashAbsIndex.Largest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int opflash_index = found_tof ? match->key : -1;
+	int flash_tpc = found_tof ? match->tpc : -1;
+	int ophit_index = found_tof ? earliestHit(flash_tpc, opflash_index) : -1;
 	
 	if(found_tof){
 	   if(frm_trk){	    
@@ -1129,48 +1079,11 @@ void ToFAnalyzer::analyze(art::Event const& evt)
      //================ Calculating ToF using earliest hit of the closest flash ======================
      
      if(fCFlash_hit){
-        double flash_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	int ophit_index = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& flashList : opFlashLists){	
-	    art::FindManyP<recob::OpHit> findManyOpHits(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]);	
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->AbsTime()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && abs(crt->Time()-tflash)<flash_minTOF){
-		   flash_minTOF= abs(crt->Time()-tflash);
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		   vector<art::Ptr<recob::OpHit>> hits = findManyOpHits.at(flash.key());
-		   double flashMinHitT = DBL_MAX;
-		   for(auto const& hit : hits){
-		       double tPmt = hit->PeakTime()*1e3-fOpDelay; 
-		       if(tPmt < flashMinHitT){
-			  flashMinHitT = tPmt;
-			  ophit_index =  hit.key();    
-		       } // getting the earliest hit
-		   } // loop over associated ophits of the flash
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
+	const sbnd::tof::PmtCandidate* match = flashAbsIndex.Closest(crt->Time(), fCoinWindow);
+	bool found_tof = match != nullptr;
+	int opflash_index = found_tof ? match->key : -1;
+	int flash_tpc = found_tof ? match->tpc : -1;
+	int ophit_index = found_tof ? earliestHit(flash_tpc, opflash_index) : -1;
 	
 	if(found_tof){
 	   if(frm_trk){	    
@@ -1543,17 +1456,6 @@ void ToFAnalyzer::analyze(art::Event const& evt)
 } // End of Analyze function
 
 //==========================================================================================
-bool ToFAnalyzer::SpacePointCompare(const art::Ptr<CRTSpacePoint>& sp1, const art::Ptr<CRTSpacePoint>& sp2) {
-     if(sp1->Time()     != sp2->Time())     return false;
-     if(sp1->Pos()      != sp2->Pos())      return false;
-     if(sp1->Err()      != sp2->Err())      return false;
-     if(sp1->PE()       != sp2->PE())       return false;
-     if(sp1->TimeErr()  != sp2->TimeErr())  return false;
-     if(sp1->Complete() != sp2->Complete()) return false;
-
-     return true;
-}
-//===========================================================================================
 
 //===========================================================================================
 double ToFAnalyzer::length(const simb::MCParticle& part, TVector3& start, TVector3& end)
@@ -93,6 +93,7 @@
 #include "TAxis.h"
 #include "TTimeStamp.h"
 
+#include <array>
 #include <vector>
 #include <fstream>
 #include "TPaveStats.h"
@@ -121,235 +122,61 @@ public:
   bool filter(art::Event& evt) override;
 
 private:
-  art::InputTag ftofLhitLabel;
-  art::InputTag ftofChitLabel;
-  art::InputTag ftofLflashLabel;
-  art::InputTag ftofCflashLabel;
-  art::InputTag ftofLflashhitLabel;
-  art::InputTag ftofCflashhitLabel;
-  bool fuse_Lhit;
-  bool fuse_Chit;
-  bool fuse_Lflsh;
-  bool fuse_Cflsh;
-  bool fuse_Lflsh_hit;
-  bool fuse_Cflsh_hit;
-  float ftof_Lhit_cut;
-  float ftof_Chit_cut;
-  float ftof_Lflsh_cut;
-  float ftof_Cflsh_cut;
-  float ftof_Lflshhit_cut;
-  float ftof_Cflshhit_cut;
+  // The ToF collections, one per way of calculating the ToF
+  enum ToFCategory { kLhit, kChit, kLflsh, kCflsh, kLflshHit, kCflshHit, kNToFCategories };
+
+  // An event is cosmic like in a category when all its ToF values are below the cut
+  struct ToFSelection {
+    bool          use;
+    art::InputTag label;
+    float         cut;
+  };
+
+  // Whether the category has ToF values, all of them below the cut
+  bool IsCosmicLike(art::Event const& evt, ToFSelection const& sel) const;
+
+  std::array<ToFSelection, kNToFCategories> fSelections;
+  // Categories in use, in the order they are checked
+  std::vector<ToFCategory> fUsedCategories;
 };
 
 
 ToFFilter::ToFFilter(fhicl::ParameterSet const& pset): 
-EDFilter{pset},
-ftofLhitLabel(pset.get<art::InputTag>("tofLhitLabel")),
-ftofChitLabel(pset.get<art::InputTag>("tofChitLabel")),
-ftofLflashLabel(pset.get<art::InputTag>("tofLflashLabel")),
-ftofCflashLabel(pset.get<art::InputTag>("tofCflashLabel")),
-ftofLflashhitLabel(pset.get<art::InputTag>("tofLflashhitLabel")),
-ftofCflashhitLabel(pset.get<art::InputTag>("tofCflashhitLabel")),
-fuse_Lhit(pset.get<bool>("use_Lhit")),
-fuse_Chit(pset.get<bool>("use_Chit")),
-fuse_Lflsh(pset.get<bool>("use_Lflsh")),
-fuse_Cflsh(pset.get<bool>("use_Cflsh")),
-fuse_Lflsh_hit(pset.get<bool>("use_Lflsh_hit")),
-fuse_Cflsh_hit(pset.get<bool>("use_Cflsh_hit")),		
-ftof_Lhit_cut(pset.get<float>("tof_Lhit_cut")),
-ftof_Chit_cut(pset.get<float>("tof_Chit_cut")),
-ftof_Lflsh_cut(pset.get<float>("tof_Lflsh_cut")),
-ftof_Cflsh_cut(pset.get<float>("tof_Cflsh_cut")),
-ftof_Lflshhit_cut(pset.get<float>("tof_Lflshhit_cut")),
-ftof_Cflshhit_cut(pset.get<float>("tof_Cflshhit_cut"))
+EDFilter{pset}
 {
+  fSelections[kLhit]     = {pset.get<bool>("use_Lhit"),      pset.get<art::InputTag>("tofLhitLabel"),      pset.get<float>("tof_Lhit_cut")};
+  fSelections[kChit]     = {pset.get<bool>("use_Chit"),      pset.get<art::InputTag>("tofChitLabel"),      pset.get<float>("tof_Chit_cut")};
+  fSelections[kLflsh]    = {pset.get<bool>("use_Lflsh"),     pset.get<art::InputTag>("tofLflashLabel"),    pset.get<float>("tof_Lflsh_cut")};
+  fSelections[kCflsh]    = {pset.get<bool>("use_Cflsh"),     pset.get<art::InputTag>("tofCflashLabel"),    pset.get<float>("tof_Cflsh_cut")};
+  fSelections[kLflshHit] = {pset.get<bool>("use_Lflsh_hit"), pset.get<art::InputTag>("tofLflashhitLabel"), pset.get<float>("tof_Lflshhit_cut")};
+  fSelections[kCflshHit] = {pset.get<bool>("use_Cflsh_hit"), pset.get<art::InputTag>("tofCflashhitLabel"), pset.get<float>("tof_Cflshhit_cut")};
+
+  for(int cat = 0; cat < kNToFCategories; cat++){
+    if(fSelections[cat].use) fUsedCategories.push_back(static_cast<ToFCategory>(cat));
+  }
+}
+
+bool ToFFilter::IsCosmicLike(art::Event const& evt, ToFSelection const& sel) const
+{
+  art::Handle< std::vector<sbnd::ToF::ToF> > tofListHandle;
+  if(!evt.getByLabel(sel.label, tofListHandle) || tofListHandle->empty()) return false;
+
+  // One neutrino like ToF is enough
+  for(auto const& tf : *tofListHandle){
+    if(tf.tof >= sel.cut) return false;
+  }
+  return true;
 }
 
 bool ToFFilter::filter(art::Event& evt)
 {
-  bool keep_event = true;
-  
-  // ================================== Calculatin ToF values using Largest optical hit method =========================
-  	
-  if(fuse_Lhit){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofLhitListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofLhitList;
-     if( evt.getByLabel(ftofLhitLabel,tofLhitListHandle))
-         art::fill_ptr_vector(tofLhitList, tofLhitListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_lhit : tofLhitList){
-         if(tf_lhit->tof >= ftof_Lhit_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using largest optical hit to calculate tof
-  
-  //======================================================================================================================
-  
-  // ================================== Calculatin ToF values using Closest optical hit method ===========================
-  
-  if(fuse_Chit){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofChitListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofChitList;
-     if( evt.getByLabel(ftofChitLabel,tofChitListHandle))
-         art::fill_ptr_vector(tofChitList, tofChitListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_chit : tofChitList){
-         if(tf_chit->tof >= ftof_Chit_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using closest optical hit to calculate tof
-  
-  //======================================================================================================================
-  
-  //==================================== Calculation ToF values using Largest optical flash ==============================
-  
-  if(fuse_Lflsh){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofLflashListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofLflashList;
-     if( evt.getByLabel(ftofLflashLabel,tofLflashListHandle))
-         art::fill_ptr_vector(tofLflashList, tofLflashListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_lflash : tofLflashList){
-         if(tf_lflash->tof >= ftof_Lflsh_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using largest optical flash to calculate tof
-  
-  //======================================================================================================================
-  
-  //==================================== Calculation ToF values using Largest optical flash ==============================
-  
-  if(fuse_Cflsh){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofCflashListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofCflashList;
-     if( evt.getByLabel(ftofCflashLabel,tofCflashListHandle))
-         art::fill_ptr_vector(tofCflashList, tofCflashListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_cflash : tofCflashList){
-         if(tf_cflash->tof >= ftof_Cflsh_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using closest optical flash to calculate tof
-  
-  //======================================================================================================================
-  
-  //=========================Calculation ToF values using Earliest hit of the Largest flash ==============================
-  
-  if(fuse_Lflsh_hit){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofLflashhitListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofLflashhitList;
-     if( evt.getByLabel(ftofLflashhitLabel,tofLflashhitListHandle))
-         art::fill_ptr_vector(tofLflashhitList, tofLflashhitListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_lflashhit : tofLflashhitList){
-         if(tf_lflashhit->tof >= ftof_Lflshhit_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using earliest hit of the largest optical flash to calculate tof
-  
-  //======================================================================================================================
-  
-  //=========================Calculation ToF values using Earliest hit of the Closest flash ==============================
-  
-  if(fuse_Cflsh_hit){
-     art::Handle< std::vector<sbnd::ToF::ToF> > tofCflashhitListHandle;
-     std::vector< art::Ptr<sbnd::ToF::ToF> >    tofCflashhitList;
-     if( evt.getByLabel(ftofCflashhitLabel,tofCflashhitListHandle))
-         art::fill_ptr_vector(tofCflashhitList, tofCflashhitListHandle);
-     
-     std::vector<bool> is_cos_like;
-     
-     for(auto const& tf_cflashhit : tofCflashhitList){
-         if(tf_cflashhit->tof >= ftof_Cflshhit_cut) is_cos_like.push_back(false);
-	 else is_cos_like.push_back(true);
-     }
-     
-     if(is_cos_like.size()){
-	bool found_nu=false;
-        for(auto itr: is_cos_like){
-	    if(!itr){ 
-	       found_nu=true; 
-	       break;
-	    } 
-	}
-	
-	if(!found_nu) keep_event=false;
-     }
-  } // Using earliest hit of the closest optical flash to calculate tof
-  
-  //======================================================================================================================
-  
-  return keep_event;
+  // The event is rejected as soon as one of the categories in use finds it
+  // cosmic like, without reading the remaining ToF collections
+  for(ToFCategory cat : fUsedCategories){
+    if(IsCosmicLike(evt, fSelections[cat])) return false;
+  }
+
+  return true;
 }
 
 DEFINE_ART_MODULE(ToFFilter)
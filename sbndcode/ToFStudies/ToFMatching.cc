@@ -0,0 +1,114 @@
+#include "sbndcode/ToFStudies/ToFMatching.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sbnd::tof {
+
+  void PmtTimeIndex::Add(const double time, const double pe, const int tpc, const size_t key)
+  {
+    fCandidates.push_back({time, pe, tpc, key, fCandidates.size()});
+  }
+
+  void PmtTimeIndex::Sort()
+  {
+    std::sort(fCandidates.begin(), fCandidates.end(),
+              [](const PmtCandidate &a, const PmtCandidate &b) {
+                return a.time < b.time || (a.time == b.time && a.order < b.order);
+              });
+  }
+
+  std::pair<std::vector<PmtCandidate>::const_iterator, std::vector<PmtCandidate>::const_iterator>
+  PmtTimeIndex::Window(const double crtTime, const double window) const
+  {
+    // Widened a little so rounding in |crtTime - time| can never leave out a candidate
+    const double halfWidth = window + 1e-9 * (std::abs(crtTime) + window) + 1e-9;
+
+    auto first = std::lower_bound(fCandidates.begin(), fCandidates.end(), crtTime - halfWidth,
+                                  [](const PmtCandidate &c, const double t) { return c.time < t; });
+    auto last  = std::upper_bound(first, fCandidates.end(), crtTime + halfWidth,
+                                  [](const double t, const PmtCandidate &c) { return t < c.time; });
+
+    return {first, last};
+  }
+
+  const PmtCandidate* PmtTimeIndex::Largest(const double crtTime, const double window) const
+  {
+    const PmtCandidate* best = nullptr;
+    const auto [first, last] = Window(crtTime, window);
+
+    for(auto it = first; it != last; ++it)
+      {
+        if(!(std::abs(crtTime - it->time) < window) || !(it->pe > 0))
+          continue;
+
+        if(!best || it->pe > best->pe || (it->pe == best->pe && it->order < best->order))
+          best = &*it;
+      }
+
+    return best;
+  }
+
+  const PmtCandidate* PmtTimeIndex::Closest(const double crtTime, const double window) const
+  {
+    const PmtCandidate* best = nullptr;
+    double bestDiff = window;
+    const auto [first, last] = Window(crtTime, window);
+
+    for(auto it = first; it != last; ++it)
+      {
+        const double diff = std::abs(crtTime - it->time);
+
+        if(!(diff < window))
+          continue;
+
+        if(!best || diff < bestDiff || (diff == bestDiff && it->order < best->order))
+          {
+            best     = &*it;
+            bestDiff = diff;
+          }
+      }
+
+    return best;
+  }
+
+  bool SameSpacePoint(const sbnd::crt::CRTSpacePoint &sp1, const sbnd::crt::CRTSpacePoint &sp2)
+  {
+    if(sp1.Time()     != sp2.Time())     return false;
+    if(sp1.Pos()      != sp2.Pos())      return false;
+    if(sp1.Err()      != sp2.Err())      return false;
+    if(sp1.PE()       != sp2.PE())       return false;
+    if(sp1.TimeErr()  != sp2.TimeErr())  return false;
+    if(sp1.Complete() != sp2.Complete()) return false;
+
+    return true;
+  }
+
+  void TrackSpacePointIndex::Add(const size_t trackIndex, const art::Ptr<sbnd::crt::CRTSpacePoint> &sp)
+  {
+    fEntries.push_back({sp->Time(), trackIndex, sp});
+  }
+
+  void TrackSpacePointIndex::Sort()
+  {
+    std::sort(fEntries.begin(), fEntries.end(),
+              [](const Entry &a, const Entry &b) {
+                return a.time < b.time || (a.time == b.time && a.trackIndex < b.trackIndex);
+              });
+  }
+
+  int TrackSpacePointIndex::TrackIndex(const sbnd::crt::CRTSpacePoint &sp) const
+  {
+    // Equal space points have equal times, and the entries of a time are in track order
+    auto it = std::lower_bound(fEntries.begin(), fEntries.end(), sp.Time(),
+                               [](const Entry &e, const double t) { return e.time < t; });
+
+    for(; it != fEntries.end() && it->time == sp.Time(); ++it)
+      {
+        if(SameSpacePoint(*it->sp, sp))
+          return it->trackIndex;
+      }
+
+    return -1;
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef SBND_TOFSTUDIES_TOFMATCHING_H
+#define SBND_TOFSTUDIES_TOFMATCHING_H
+
+////////////////////////////////////////////////////////////////////////
+// ToFMatching.h
+//
+// Time indexed lookups shared by the ToFProducer and ToFAnalyzer:
+//  - PmtTimeIndex holds the optical hits or flashes of an event sorted
+//    in time, so the candidates in the coincidence window of a CRT
+//    space point are found with a binary search instead of a loop
+//    over the whole list.
+//  - TrackSpacePointIndex finds the CRT track a space point belongs to.
+//
+// Both reproduce the choices of the original loops, ties included:
+// among equally good candidates the first one in the original
+// iteration order wins.
+////////////////////////////////////////////////////////////////////////
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "sbnobj/SBND/CRT/CRTSpacePoint.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace sbnd::tof {
+
+  // An optical hit or flash reduced to what the ToF matching needs
+  struct PmtCandidate {
+    double time;  // [ns], with the optical delay removed
+    double pe;
+    int    tpc;   // flash TPC, -1 for optical hits
+    size_t key;   // key in its collection
+    size_t order; // position in the original iteration order
+  };
+
+  class PmtTimeIndex {
+  public:
+    // Candidates must be added in the order the original loops visited them
+    void Add(const double time, const double pe, const int tpc, const size_t key);
+
+    // Call once all the candidates have been added
+    void Sort();
+
+    void Clear() { fCandidates.clear(); }
+    bool Empty() const { return fCandidates.empty(); }
+
+    // Candidate with the largest PE within the window of crtTime, nullptr if none
+    const PmtCandidate* Largest(const double crtTime, const double window) const;
+
+    // Candidate with the smallest time difference within the window of crtTime, nullptr if none
+    const PmtCandidate* Closest(const double crtTime, const double window) const;
+
+  private:
+    // Range of candidates that may lie within the window; the exact test is left to the caller
+    std::pair<std::vector<PmtCandidate>::const_iterator, std::vector<PmtCandidate>::const_iterator>
+      Window(const double crtTime, const double window) const;
+
+    std::vector<PmtCandidate> fCandidates;
+  };
+
+  // Whether two CRT space points hold the same values
+  bool SameSpacePoint(const sbnd::crt::CRTSpacePoint &sp1, const sbnd::crt::CRTSpacePoint &sp2);
+
+  class TrackSpacePointIndex {
+  public:
+    void Add(const size_t trackIndex, const art::Ptr<sbnd::crt::CRTSpacePoint> &sp);
+
+    // Call once all the track space points have been added
+    void Sort();
+
+    // Index of the first track holding a space point equal to sp, -1 if none
+    int TrackIndex(const sbnd::crt::CRTSpacePoint &sp) const;
+
+  private:
+    struct Entry {
+      double time;
+      size_t trackIndex;
+      art::Ptr<sbnd::crt::CRTSpacePoint> sp;
+    };
+
+    std::vector<Entry> fEntries;
+  };
+}
+
+#endif
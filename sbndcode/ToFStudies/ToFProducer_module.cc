@@ -72,6 +72,7 @@
 #include "lardataobj/RecoBase/OpHit.h"
 
 #include "sbnobj/SBND/ToF/ToF.hh"
+#include "sbndcode/ToFStudies/ToFMatching.h"
 
 #include "TFile.h"
 #include "TTree.h"
@@ -121,7 +122,6 @@ public:
 
   void beginJob() override;
   void produce(art::Event& evt) override;
-  bool SpacePointCompare(const art::Ptr<CRTSpacePoint>& sp1, const art::Ptr<CRTSpacePoint>& sp2);
   
 
 private:
@@ -206,6 +206,65 @@ void ToFProducer::produce(art::Event& evt)
  
  //==================================================================
  
+ // Index the track space points so each CRT space point finds its track without a loop over all of them
+ sbnd::tof::TrackSpacePointIndex trackSPIndex;
+ for(size_t itrk=0; itrk<tracksps.size(); itrk++){
+     for(auto const& sp : tracksps[itrk]) trackSPIndex.Add(itrk, sp);
+ }
+ trackSPIndex.Sort();
+ 
+ //==================================================================
+ 
+ // Optical hits and flashes are read once for the event and indexed in time
+ art::Handle< std::vector<recob::OpHit> > opHitListHandle;
+ std::vector< art::Ptr<recob::OpHit> >    opHitList;
+ if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
+     art::fill_ptr_vector(opHitList, opHitListHandle);
+ 
+ std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
+ std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
+ for(int i=0; i<2; i++) {
+     if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
+         art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
+ }
+ 
+ sbnd::tof::PmtTimeIndex hitIndex, flashIndex, flashAbsIndex;
+ for(auto const& hit : opHitList){
+     if(hit->PE()<fHitPeThresh) continue;
+     hitIndex.Add(hit->PeakTime()*1e3-fOpDelay, hit->PE(), -1, hit.key());
+ }
+ for(auto const& flashList : opFlashLists){
+     for(auto const& flash : flashList.second){
+	 if(flash->TotalPE()<fFlashPeThresh) continue;
+	 flashIndex.Add(flash->Time()*1e3-fOpDelay, flash->TotalPE(), flashList.first, flash.key());
+	 flashAbsIndex.Add(flash->AbsTime()*1e3-fOpDelay, flash->TotalPE(), flashList.first, flash.key());
+     }
+ }
+ hitIndex.Sort();
+ flashIndex.Sort();
+ flashAbsIndex.Sort();
+ 
+ // Key of the earliest optical hit of a flash, -1 if it has none
+ std::map<int, art::FindManyP<recob::OpHit>> findManyOpHits;
+ if(fLFlash_hit || fCFlash_hit){
+    for(auto const& flashList : opFlashLists)
+	findManyOpHits.emplace(flashList.first, art::FindManyP<recob::OpHit>(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]));
+ }
+ auto earliestHit = [&](int tpc, size_t flashKey){
+     int ophit_index = -1;
+     double flashMinHitT = DBL_MAX;
+     for(auto const& hit : findManyOpHits.at(tpc).at(flashKey)){
+	 double tPmt = hit->PeakTime()*1e3-fOpDelay; 
+	 if(tPmt < flashMinHitT){
+	    flashMinHitT = tPmt;
+	    ophit_index =  hit.key();    
+	 } // getting the earliest hit
+     } // loop over associated ophits of the flash
+     return ophit_index;
+ };
+ 
+ //==================================================================
+ 
  art::Handle< std::vector<CRTSpacePoint> > crtSPListHandle;
  std::vector< art::Ptr<CRTSpacePoint> >    crtSPList;
  if( evt.getByLabel(fCrtSpacePointModuleLabel,crtSPListHandle))
@@ -220,365 +279,106 @@ void ToFProducer::produce(art::Event& evt)
      if(!(crt->Time() >= fBeamLow &&  crt->Time()<= fBeamUp)) continue;
      if(crt->PE() < fCRTSpacePointThresh) continue;
      
-     bool frm_trk=false;
-     int index=0;
-     
-     for(auto const& trksps: tracksps){
-	 for(size_t isp=0; isp<trksps.size(); isp++){
-	   if(SpacePointCompare(trksps[isp],crt)){
-		frm_trk=true;
-		break;
-	     }
-	  }
-	  if(frm_trk) break;
-	  index++;
-     }
-     
-     // ================================== Calculatin ToF values using Largest optical hit method =========================
-     
-     if(fLhit){
-        double pehit_max=0;
-	bool found_tof = false;
-	int ophit_index = -1;
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& hit : opHitList){
-	    if(hit->PE()<fHitPeThresh) continue;
-	    double thit = hit->PeakTime()*1e3-fOpDelay;
-	    
-	    if(abs(crt->Time()-thit)<fCoinWindow && hit->PE()>pehit_max){
-	       pehit_max = hit->PE();
-	       ophit_index = hit.key();
-	       found_tof = true;
-	    }
-	} // loop over optical hit list
-	
-	if(found_tof){	
-	    if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_hits[index].push_back(opHitList[ophit_index]);
-	    } // crt hit is coming from crt track
-	    
-	    else{
-		 sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.pmt_hit_id = ophit_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
-	
-     } // use Lhit method
-     
-     // =====================================================================================================================
+     int index = trackSPIndex.TrackIndex(*crt);
+     bool frm_trk = index >= 0;
      
-     // ================================== Calculatin ToF values using Closest optical hit method ===========================
+     // ============== Calculatin ToF values using Largest and Closest optical hit methods ==================================
      
-     if(fChit){
-        double ophit_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int ophit_index = -1;
+     for(bool largest : {true, false}){
+	if(largest ? !fLhit : !fChit) continue;
 	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
+	const sbnd::tof::PmtCandidate* match = largest ? hitIndex.Largest(crt->Time(), fCoinWindow)
+	                                               : hitIndex.Closest(crt->Time(), fCoinWindow);
+	if(!match) continue;
+	int ophit_index = match->key;
 	
-	for(auto const& hit : opHitList){
-	    if(hit->PE()<fHitPeThresh) continue;
-	    double thit = hit->PeakTime()*1e3-fOpDelay;
-	    
-	    if(abs(crt->Time()-thit)<fCoinWindow && abs(crt->Time()-thit)<ophit_minTOF){
-	       ophit_minTOF = abs(crt->Time()-thit);
-	       ophit_index = hit.key();
-	       found_tof = true;
-	    }
-	} // loop over optical hit list
-	
-	if(found_tof){	
-	    if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_hits[index].push_back(opHitList[ophit_index]);
-	    } // crt hit is coming from crt track
-	    
-	    else{
-		 sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.pmt_hit_id = ophit_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
+	if(frm_trk){	    
+	   tof_crt_sps[index].push_back(crt);
+	   tof_op_hits[index].push_back(opHitList[ophit_index]);
+	} // crt hit is coming from crt track
 	
-     } // use Chit method
+	else{
+	     sbnd::ToF::ToF new_tof;
+	     new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
+	     new_tof.frm_hit = true;
+	     new_tof.crt_time = crt->Time();
+	     new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
+	     //		 new_tof.crt_tagger = crt->tagger;
+	     new_tof.crt_sp_id = crt.key();
+	     new_tof.pmt_hit_id = ophit_index;
+	     ToF_vec->push_back(new_tof);
+	} // lonely crt hit
+     } // use Lhit/Chit method
      
      // =====================================================================================================================
      
-     //==================================== Calculation ToF values using Largest optical flash ==============================
+     //============== Calculation ToF values using Largest and Closest optical flash methods ================================
      
-     if(fLFlash){
-        double peflash_max=0;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
+     for(bool largest : {true, false}){
+	if(largest ? !fLFlash : !fCFlash) continue;
 	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
+	const sbnd::tof::PmtCandidate* match = largest ? flashIndex.Largest(crt->Time(), fCoinWindow)
+	                                               : flashIndex.Closest(crt->Time(), fCoinWindow);
+	if(!match) continue;
+	int opflash_index = match->key;
+	int flash_tpc = match->tpc;
 	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
+	if(frm_trk){	    
+	   tof_crt_sps[index].push_back(crt);
+	   tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
+	   tof_op_tpc[index].push_back(flash_tpc);
+	} // crt hit is coming from crt track 
 	
-	for(auto const& flashList : opFlashLists){
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->Time()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && flash->TotalPE()>peflash_max){
-		   peflash_max=flash->TotalPE();
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
-	
-	if(found_tof){
-	   if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
-	       tof_op_tpc[index].push_back(flash_tpc);
-	    } // crt hit is coming from crt track 
-	    
-	    else{
-	         sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.flash_tpc_id = flash_tpc;
-		 new_tof.pmt_flash_id = opflash_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
-	
-     } // use LFlash method
-     
-     //======================================================================================================================
-     
-     //==================================== Calculation ToF values using Closest optical flash ==============================
-     
-     if(fCFlash){
-        double flash_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	for(auto const& flashList : opFlashLists){
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->Time()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && abs(crt->Time()-tflash)<flash_minTOF){
-		   flash_minTOF= abs(crt->Time()-tflash);
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
-	
-	if(found_tof){
-	   if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
-	       tof_op_tpc[index].push_back(flash_tpc);
-	    } // crt hit is coming from crt track 
-	    
-	    else{
-	         sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.flash_tpc_id = flash_tpc;
-		 new_tof.pmt_flash_id = opflash_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
-	
-     } // use CFlash method
-     
-     //======================================================================================================================
-     
-     //=========================Calculation ToF values using Earliest hit of the Largest flash ==============================
-     
-     if(fLFlash_hit){
-        double peflash_max=0;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	int ophit_index = -1;
-	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
-	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
-	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& flashList : opFlashLists){	
-	    art::FindManyP<recob::OpHit> findManyOpHits(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]);	
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->AbsTime()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && flash->TotalPE()>peflash_max){
-		   peflash_max=flash->TotalPE();
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		   vector<art::Ptr<recob::OpHit>> hits = findManyOpHits.at(flash.key());
-		   double flashMinHitT = DBL_MAX;
-		   for(auto const& hit : hits){
-		       double tPmt = hit->PeakTime()*1e3-fOpDelay; 
-		       if(tPmt < flashMinHitT){
-			  flashMinHitT = tPmt;
-			  ophit_index =  hit.key();    
-		       } // getting the earliest hit
-		   } // loop over associated ophits of the flash
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
-	
-	if(found_tof){
-	   if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
-	       tof_op_tpc[index].push_back(flash_tpc);
-	       tof_op_hits[index].push_back(opHitList[ophit_index]);
-	    } // crt hit is coming from crt track 
-	    
-	    else{
-	         sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.flash_tpc_id = flash_tpc;
-		 new_tof.pmt_flash_id = opflash_index;
-		 new_tof.pmt_hit_id = ophit_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
-	
-     } // use earliest optical hit of the largest flash
+	else{
+	     sbnd::ToF::ToF new_tof;
+	     new_tof.tof = crt->Time() - (opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay);
+	     new_tof.frm_hit = true;
+	     new_tof.crt_time = crt->Time();
+	     new_tof.pmt_time = opFlashLists[flash_tpc][opflash_index]->Time()*1e3-fOpDelay;
+	     //		 new_tof.crt_tagger = crt->tagger;
+	     new_tof.crt_sp_id = crt.key();
+	     new_tof.flash_tpc_id = flash_tpc;
+	     new_tof.pmt_flash_id = opflash_index;
+	     ToF_vec->push_back(new_tof);
+	} // lonely crt hit
+     } // use LFlash/CFlash method
      
      //======================================================================================================================
      
-     //=========================Calculation ToF values using Earliest hit of the Closest flash ==============================
+     //========= Calculation ToF values using Earliest hit of the Largest and of the Closest flash ===========================
      
-     if(fCFlash_hit){
-        double flash_minTOF = DBL_MAX;
-	bool found_tof = false;
-	int opflash_index = -1;
-	int flash_tpc = -1;
-	int ophit_index = -1;
+     for(bool largest : {true, false}){
+	if(largest ? !fLFlash_hit : !fCFlash_hit) continue;
 	
-	std::map<int, art::Handle< std::vector<recob::OpFlash> > > flashHandles;
-        std::map<int,std::vector< art::Ptr<recob::OpFlash> >> opFlashLists;
+	// the largest flash is searched in flash absolute time, the closest one in flash time
+	const sbnd::tof::PmtCandidate* match = largest ? flashAbsIndex.Largest(crt->Time(), fCoinWindow)
+	                                               : flashIndex.Closest(crt->Time(), fCoinWindow);
+	if(!match) continue;
+	int opflash_index = match->key;
+	int flash_tpc = match->tpc;
+	int ophit_index = earliestHit(flash_tpc, opflash_index);
 	
-	for(int i=0; i<2; i++) {
-            if( evt.getByLabel(fFlashLabels[i],flashHandles[i]) )
-                art::fill_ptr_vector(opFlashLists[i], flashHandles[i]);
-        }
+	if(frm_trk){	    
+	   tof_crt_sps[index].push_back(crt);
+	   tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
+	   tof_op_tpc[index].push_back(flash_tpc);
+	   tof_op_hits[index].push_back(opHitList[ophit_index]);
+	} // crt hit is coming from crt track 
 	
-	art::Handle< std::vector<recob::OpHit> > opHitListHandle;
-        std::vector< art::Ptr<recob::OpHit> >    opHitList;
-        if( evt.getByLabel(fOpHitModuleLabel,opHitListHandle) )
-            art::fill_ptr_vector(opHitList, opHitListHandle);
-	
-	for(auto const& flashList : opFlashLists){	
-	    art::FindManyP<recob::OpHit> findManyOpHits(flashHandles[flashList.first], evt, fFlashLabels[flashList.first]);	
-	    for(size_t iflash=0; iflash<flashList.second.size(); iflash++){
-	        auto const& flash = flashList.second[iflash];
-		if(flash->TotalPE()<fFlashPeThresh) continue;
-		double tflash = flash->Time()*1e3-fOpDelay;
-		if(abs(crt->Time()-tflash)<fCoinWindow && abs(crt->Time()-tflash)<flash_minTOF){
-		   flash_minTOF= abs(crt->Time()-tflash);
-		   opflash_index = flash.key();	
-		   found_tof = true;
-		   flash_tpc = flashList.first;
-		   vector<art::Ptr<recob::OpHit>> hits = findManyOpHits.at(flash.key());
-		   double flashMinHitT = DBL_MAX;
-		   for(auto const& hit : hits){
-		       double tPmt = hit->PeakTime()*1e3-fOpDelay; 
-		       if(tPmt < flashMinHitT){
-			  flashMinHitT = tPmt;
-			  ophit_index =  hit.key();    
-		       } // getting the earliest hit
-		   } // loop over associated ophits of the flash
-		} // with in conincidence window and getting the largest flash
-	    } // loop over flash list
-	} // loop over flash list map
-	
-	if(found_tof){
-	   if(frm_trk){	    
-	       tof_crt_sps[index].push_back(crt);
-	       tof_op_flashes[index].push_back(opFlashLists[flash_tpc][opflash_index]);
-	       tof_op_tpc[index].push_back(flash_tpc);
-	       tof_op_hits[index].push_back(opHitList[ophit_index]);
-	    } // crt hit is coming from crt track 
-	    
-	    else{
-	         sbnd::ToF::ToF new_tof;
-		 new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
-		 new_tof.frm_hit = true;
-		 new_tof.crt_time = crt->Time();
-		 new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
-		 //		 new_tof.crt_tagger = crt->tagger;
-		 new_tof.crt_sp_id = crt.key();
-		 new_tof.flash_tpc_id = flash_tpc;
-		 new_tof.pmt_flash_id = opflash_index;
-		 new_tof.pmt_hit_id = ophit_index;
-		 ToF_vec->push_back(new_tof);
-	    } // lonely crt hit
-	} // found a tof match
-	
-     } // use earliest optical hit of the closest flash
+	else{
+	     sbnd::ToF::ToF new_tof;
+	     new_tof.tof = crt->Time() - (opHitList[ophit_index]->PeakTime()*1e3-fOpDelay);
+	     new_tof.frm_hit = true;
+	     new_tof.crt_time = crt->Time();
+	     new_tof.pmt_time = opHitList[ophit_index]->PeakTime()*1e3-fOpDelay;
+	     //		 new_tof.crt_tagger = crt->tagger;
+	     new_tof.crt_sp_id = crt.key();
+	     new_tof.flash_tpc_id = flash_tpc;
+	     new_tof.pmt_flash_id = opflash_index;
+	     new_tof.pmt_hit_id = ophit_index;
+	     ToF_vec->push_back(new_tof);
+	} // lonely crt hit
+     } // use earliest optical hit of the largest/closest flash
      
      //======================================================================================================================
      
@@ -778,17 +578,5 @@ void ToFProducer::produce(art::Event& evt)
  evt.put(std::move(ToF_vec));
 }
 
-bool ToFProducer::SpacePointCompare(const art::Ptr<CRTSpacePoint>& sp1, const art::Ptr<CRTSpacePoint>& sp2) {
-
-  if(sp1->Time()     != sp2->Time())     return false;
-  if(sp1->Pos()      != sp2->Pos())      return false;
-  if(sp1->Err()      != sp2->Err())      return false;
-  if(sp1->PE()       != sp2->PE())       return false;
-  if(sp1->TimeErr()  != sp2->TimeErr())  return false;
-  if(sp1->Complete() != sp2->Complete()) return false;
-
-  return true;
-}
-
 DEFINE_ART_MODULE(ToFProducer)
 }
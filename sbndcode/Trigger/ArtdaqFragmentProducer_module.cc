@@ -38,6 +38,7 @@
 #include "sbndaq-artdaq-core/Overlays/Common/CAENV1730Fragment.hh"
 #include "sbndaq-artdaq-core/Overlays/FragmentType.hh"
 #include "artdaq-core/Data/Fragment.hh"
+#include "sbndcode/Trigger/FragmentWriters.h"
 
 // Framework includes
 #include "art/Framework/Core/EDProducer.h"
@@ -128,7 +129,7 @@ private:
 
   // Other variables shared between different methods.
   geo::GeometryCore const* fGeometryService;
-  sbnd::crt::CRTGeoAlg fCrtGeo;
+  std::shared_ptr<const sbnd::crt::CRTGeoAlg> fCrtGeo = sbnd::crt::CRTGeoAlg::Shared();
 
   //PMT
 
@@ -220,7 +221,7 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
 
     for(int i=0; i<num_febs; i++){empty_fragment[i]=true;}
 
-    int num_module = fCrtGeo.NumModules();
+    int num_module = fCrtGeo->NumModules();
 
     //----------------------------------------------------------------------------------------------------------
     //                                          GETTING PRODUCTS
@@ -280,8 +281,8 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
         empty_fragment[feb_data->Mac5()] = false;
 
         int channel = feb_data->Mac5() * 32;
-        std::string stripName = fCrtGeo.ChannelToStripName(channel);
-        std::string tagger = fCrtGeo.GetTaggerName(stripName);
+        std::string stripName = fCrtGeo->ChannelToStripName(channel);
+        std::string tagger = fCrtGeo->GetTaggerName(stripName);
         taggers[feb_data->Mac5()] = tagger;
 
         T0s[feb_data->Mac5()][feb_hits_in_fragments[feb_data->Mac5()]] = feb_data->Ts0();
@@ -310,8 +311,8 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
           //if no hits for a module, make a simulated "T1 reset" event to avoid missing fragments
           feb_hits_in_fragments[feb_i] = 1;
           int channel = feb_i * 32;
-          std::string stripName = fCrtGeo.ChannelToStripName(channel);
-          std::string tagger = fCrtGeo.GetTaggerName(stripName);
+          std::string stripName = fCrtGeo->ChannelToStripName(channel);
+          std::string tagger = fCrtGeo->GetTaggerName(stripName);
           taggers[feb_i] = tagger;
 
           T0s[feb_i][0] = 0;
@@ -351,10 +352,10 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
             timestamp
           ); // unique pointer
 
-        // populate fragment
-        std::vector<sbndaq::BernCRTHitV2> data_vec;
+        // populate fragment, writing the hits straight into its payload
+        writer::BernCRTHitWriter hits(*fragment_uptr);
         for (int i_frag = 0; i_frag<feb_hits_in_fragments[feb_i]; i_frag++){
-          sbndaq::BernCRTHitV2 hit;
+          sbndaq::BernCRTHitV2& hit = hits.Next();
 
           uint8_t flags = 3;
           uint32_t ts0 = T0s[feb_i][i_frag];
@@ -380,15 +381,10 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
           hit.timestamp = (uint64_t)timestamp;
           hit.last_accepted_timestamp = (uint64_t)last_accepted_timestamp;
           hit.lost_hits = (uint16_t)lost_hits;
-
-          data_vec.emplace_back(hit);
         }//bern crt hit vector
 
-        //copy data vector of hits into the fragment we made
-        std::memcpy(fragment_uptr->dataBeginBytes(), data_vec.data(), sizeof(sbndaq::BernCRTHitV2)*metadata.hits_in_fragment());
-
         // add fragment to vector
-        vecFrag->push_back(*fragment_uptr);
+        vecFrag->push_back(std::move(*fragment_uptr));
 
     }//module (mac5) loop
 
@@ -453,43 +449,15 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
 
     num_pmt_wvf++;
 
-    double fStartTime = wvf.TimeStamp(); // in us
-    double fEndTime = double(wvf.size()) / fSampling + fStartTime; // in us
-
-    // create full waveform
-    std::vector<short> wvf_full; wvf_full.reserve((short)(3020*1e6/2));
-
-    if (fStartTime > fMinStartTime){
-      for (double i = fStartTime-fMinStartTime; i>0.; i-=(1./fSampling)){
-        wvf_full.push_back(fBaseline);
-      }
-    }
-
-    for(unsigned int i = 0; i < wvf.size(); i++) {
-      wvf_full.push_back(wvf[i]);
-    }
-
-    if (fEndTime < fMaxEndTime){
-      for (double i = fMaxEndTime-fEndTime; i>0.; i-=(1./fSampling)){
-        wvf_full.push_back(fBaseline);
-      }
-    }
-
     // combine waveform with any other waveforms from same channel
     int i_ch = -1.;
     auto ich = std::find(channelList.begin(), channelList.end(), fChNumber);
     if (ich != channelList.end()){
       i_ch = ich - channelList.begin();
     }
-    if (wvf_channel.at(i_ch).size() < wvf_full.size()){
-      if (fVerbose) std::cout<<"Full waveform -- Previous Channel" << fChNumber <<" Size: "<<wvf_channel.at(i_ch).size()<<"New Channel" << fChNumber <<" Size: "<<wvf_full.size()<<std::endl;
-      for(unsigned int i = wvf_channel.at(i_ch).size(); i < wvf_full.size(); i++) {
-        wvf_channel.at(i_ch).push_back(fBaseline);
-      }
-    }
-    for(unsigned int i = 0; i < wvf_full.size(); i++) {
-       wvf_channel.at(i_ch)[i] += (wvf_full[i] - fBaseline);
-    }
+    size_t prevSize = wvf_channel.at(i_ch).size();
+    size_t fullSize = writer::AddToChannel(wvf, fMinStartTime, fMaxEndTime, fSampling, fBaseline, wvf_channel.at(i_ch));
+    if (fVerbose && prevSize < fullSize) std::cout<<"Full waveform -- Previous Channel" << fChNumber <<" Size: "<<prevSize<<"New Channel" << fChNumber <<" Size: "<<fullSize<<std::endl;
 
     hist_id++;
 
@@ -557,47 +525,36 @@ void sbnd::trigger::ArtdaqFragmentProducer::produce(art::Event& e)
       fragment_uptr->setTimestamp(timestampVal);
 
       // populate fragment header
-      auto header_ptr = reinterpret_cast<sbndaq::CAENV1730EventHeader*>(fragment_uptr->dataBeginBytes());
+      writer::V1730Writer v1730(*fragment_uptr, wfm_length);
+      auto& header = v1730.Header();
 
-      header_ptr->eventCounter = eventCounterVal;
-      header_ptr->boardID = boardIDVal;
-      header_ptr->triggerTimeTag = triggerTimeTagVal;  // ns // set timetag as random value for event
-      header_ptr->eventSize = eventSizeVal;
+      header.eventCounter = eventCounterVal;
+      header.boardID = boardIDVal;
+      header.triggerTimeTag = triggerTimeTagVal;  // ns // set timetag as random value for event
+      header.eventSize = eventSizeVal;
 
-      // populate waveforms
       // populate fragment with waveform
-      uint16_t* data_begin = reinterpret_cast<uint16_t*>(fragment_uptr->dataBeginBytes() + sizeof(sbndaq::CAENV1730EventHeader));
-      uint16_t* value_ptr = data_begin;
-      uint16_t value = 0;
-      size_t ch_offset = 0;
-
       // loop over channels
       for (size_t i_ch = 0; i_ch < nChannelsFrag; i_ch++) {
-        ch_offset = (size_t)(i_ch*wfm_length);
+        const short* wvf_in = wvf_channel[counter*nChannelsFrag + i_ch].data() + startIdx;
+        uint16_t* value_ptr = v1730.Channel(i_ch);
         // loop over waveform
         for (size_t i_t = 0; i_t < wfm_length; i_t++) {
-          // set value
-          value = wvf_channel[counter*nChannelsFrag + i_ch][startIdx+i_t];
-          value_ptr = data_begin + ch_offset + i_t;
-          *value_ptr = value;
+          value_ptr[i_t] = wvf_in[i_t];
         }
       }
 
       // create add beam window trigger waveform
-      ch_offset = (size_t)(nChannelsFrag*wfm_length);
       size_t beamStartIdx = abs(fMinStartTime)*1000/2;
       size_t beamEndIdx = beamStartIdx + fBeamWindowLength*1000/2;
+      uint16_t* value_ptr = v1730.Channel(nChannelsFrag);
       // loop over waveform
       for (size_t i_t = 0; i_t < wfm_length; i_t++) {
-        // set value
-        if (startIdx + i_t >= beamStartIdx && startIdx + i_t <= beamEndIdx) value = 1;
-        else value = 0;
-        value_ptr = data_begin + ch_offset + i_t;
-        *value_ptr = value;
+        value_ptr[i_t] = (startIdx + i_t >= beamStartIdx && startIdx + i_t <= beamEndIdx) ? 1 : 0;
       }
 
       // add fragment to vector
-      vecFrag->push_back(*fragment_uptr);
+      vecFrag->push_back(std::move(*fragment_uptr));
     }
   }
 
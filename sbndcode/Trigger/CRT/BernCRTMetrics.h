@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////
+// File:        BernCRTMetrics.h
+//
+// CRT trigger metrics computed straight from the BernCRTV2 fragments,
+// used by the MetricProducer.
+//
+// The CRT artdaq fragment producers put the tagger plane of a FEB in
+// bits 8-10 of the fragment ID, so the plane is decoded once per
+// fragment rather than for every hit. DecodeFragment() then copies the
+// ts1 of the valid data hits into flat (plane, time) arrays in one pass
+// over the payload, and CountHitsPerPlane() counts the beam window hits
+// of the whole event in a single loop over those arrays.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_TRIGGER_CRT_BERNCRTMETRICS_H
+#define SBND_TRIGGER_CRT_BERNCRTMETRICS_H
+
+#include "sbndaq-artdaq-core/Overlays/Common/BernCRTFragmentV2.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace sbnd {
+  namespace trigger {
+    namespace berncrt {
+
+      constexpr unsigned int kNPlanes = 7;
+
+      // Plane and ts1 of the valid data hits of an event, one entry per hit
+      struct HitArrays {
+        std::vector<uint8_t> plane;
+        std::vector<uint32_t> ts1;
+
+        void clear() { plane.clear(); ts1.clear(); }
+        size_t size() const { return ts1.size(); }
+      };
+
+      // Plane encoded in the fragment ID; out of range values go to plane 0
+      inline unsigned int FragmentPlane(const artdaq::Fragment &frag) {
+        unsigned int plane = (frag.fragmentID() & 0x0700) >> 8;
+        if (plane >= kNPlanes) {std::cout << "bad plane value " << plane << std::endl; plane=0;}
+        return plane;
+      }
+
+      // Appends the data hits of the fragment (not clock resets, 0xC, and with a valid ts1, 0x2)
+      inline void DecodeFragment(const artdaq::Fragment &frag, HitArrays &hits) {
+        sbndaq::BernCRTFragmentV2 bern_fragment(frag);
+        unsigned int const nHits = bern_fragment.metadata()->hits_in_fragment();
+        uint8_t const plane = FragmentPlane(frag);
+
+        hits.plane.reserve(hits.size() + nHits);
+        hits.ts1.reserve(hits.size() + nHits);
+        for(unsigned int iHit = 0; iHit < nHits; iHit++) {
+          sbndaq::BernCRTHitV2 const* bevt = bern_fragment.eventdata(iHit);
+          auto const flags = bevt->flags;
+          if (!(flags & 0x2) || (flags & 0xC)) continue;
+          hits.plane.push_back(plane);
+          hits.ts1.push_back(bevt->ts1);
+        }
+      }
+
+      // Adds to hitsPerPlane the hits with windowStart < ts1 < windowEnd
+      inline void CountHitsPerPlane(const HitArrays &hits, int windowStart, int windowEnd, int *hitsPerPlane) {
+        uint8_t const* plane = hits.plane.data();
+        uint32_t const* ts1 = hits.ts1.data();
+        for (size_t i = 0; i < hits.size(); ++i) {
+          int const time = (int)ts1[i];
+          hitsPerPlane[plane[i]] += (time > windowStart && time < windowEnd);
+        }
+      }
+
+    } // namespace berncrt
+  } // namespace trigger
+} // namespace sbnd
+
+#endif
@@ -18,6 +18,7 @@
 #include "sbnobj/Common/CRT/CRTHit.hh"
 #include "sbnobj/Common/CRT/CRTTrack.hh"
 #include "sbndcode/CRT/CRTUtils/CRTCommonUtils.h"
+#include "sbndcode/CRT/CompactFEBData/CompactFEBData.h"
 
 
 // LArSoft includes
@@ -34,6 +35,7 @@
 #include "sbndaq-artdaq-core/Overlays/Common/BernCRTFragmentV2.hh"
 #include "sbndaq-artdaq-core/Overlays/FragmentType.hh"
 #include "artdaq-core/Data/Fragment.hh"
+#include "sbndcode/Trigger/FragmentWriters.h"
 
 // Framework includes
 #include "art/Framework/Core/EDProducer.h"
@@ -61,6 +63,7 @@
 #include "TString.h"
 
 // C++ includes
+#include <algorithm>
 #include <bitset>
 #include <map>
 #include <vector>
@@ -97,30 +100,32 @@ private:
   art::InputTag fSimModuleLabel;      ///< name of detsim producer
   art::InputTag fCRTSimLabel;         ///< name of CRT producer
   std::string   fFEBDataLabel;        ///< name of FEBData producer
+  std::string   fCompactFEBDataLabel; ///< name of CompactFEBData producer, read instead if set
   bool          fVerbose;             ///< print information about what's going on
   double        fClockSpeedCRT;
   size_t           fFirstFEBMac5;        ///< lowest mac5 address for CRT FEBs
 
   // Other variables shared between different methods.
   geo::GeometryCore const* fGeometryService;
-  sbnd::crt::CRTGeoAlg fCrtGeo;
+  std::shared_ptr<const sbnd::crt::CRTGeoAlg> fCrtGeo = sbnd::crt::CRTGeoAlg::Shared();
 
   //limits for array sizes
   enum LIMITS{
-    max_hits_in_fragment = 50,
-    num_febs = 255,
+    num_febs = 256,  // mac5 is 8 bits
     num_channels = 32
   };
 
-  //arrays to store FEBinfo by module (want one fragment per module per event)
-  std::string taggers[num_febs];
-  uint16_t feb_hits_in_fragments[num_febs];
-  uint16_t ADCs[num_febs][max_hits_in_fragment][num_channels];
-  uint32_t T0s[num_febs][max_hits_in_fragment];
-  uint32_t T1s[num_febs][max_hits_in_fragment];
-  bool empty_fragment[num_febs];
-
+  // one FEB hit as it goes into the fragment
+  struct FEBHit {
+    uint32_t ts0;
+    uint32_t ts1;
+    uint16_t adc[num_channels];
+  };
 
+  // FEB hits of the event sorted by mac5 (want one fragment per module per
+  // event): the hits of mac5 m are [first_hit[m], first_hit[m+1]) of febHits
+  std::vector<FEBHit> febHits;
+  std::vector<uint32_t> first_hit;
 
 
 }; // class CRTArtdaqFragmentProducer
@@ -131,6 +136,7 @@ sbnd::trigger::CRTArtdaqFragmentProducer::CRTArtdaqFragmentProducer(fhicl::Param
   fSimModuleLabel(p.get<std::string>("SimModuleLabel", "largeant")),
   fCRTSimLabel(p.get<std::string>("CRTSimLabel", "crt")),
   fFEBDataLabel(p.get<std::string>("FEBDataLabel", "crtsim")),
+  fCompactFEBDataLabel(p.get<std::string>("CompactFEBDataLabel", "")),
   fVerbose(p.get<bool>("Verbose", false)),
   fClockSpeedCRT(p.get<double>("ClockSpeedCRT")),
   fFirstFEBMac5(p.get<size_t>("FirstFEBMac5", 0))
@@ -160,30 +166,35 @@ void sbnd::trigger::CRTArtdaqFragmentProducer::produce(art::Event& e)
     }
 
 
-    for(int i=0; i<num_febs; i++){empty_fragment[i]=true;}
-
-    int num_module = fCrtGeo.NumModules();
+    size_t num_module = fCrtGeo->NumModules();
 
     //----------------------------------------------------------------------------------------------------------
     //                                          GETTING PRODUCTS
     //----------------------------------------------------------------------------------------------------------
 
-    // Get FEB data from the event
-    art::Handle<std::vector<sbnd::crt::FEBData>> feb_data_h;
-    e.getByLabel(fFEBDataLabel, feb_data_h);
-
-    // make sure hits look good
-    if (!feb_data_h.isValid()) {
-      throw art::Exception(art::errors::Configuration) << "could not locate FEBData." << std::endl;;
+    // Get FEB data from the event, expanding the compact one
+    std::vector<sbnd::crt::FEBData const*> feb_data_v;
+    std::vector<sbnd::crt::FEBData> expanded_feb_data;
+    if (!fCompactFEBDataLabel.empty()) {
+      art::Handle<sbnd::crt::CompactFEBData> compact_h;
+      e.getByLabel(fCompactFEBDataLabel, compact_h);
+      if (!compact_h.isValid()) {
+        throw art::Exception(art::errors::Configuration) << "could not locate CompactFEBData." << std::endl;
+      }
+      expanded_feb_data.reserve(compact_h->size());
+      for (size_t i = 0; i < compact_h->size(); i++) expanded_feb_data.push_back(compact_h->MakeFEBData(i));
+      for (auto const& feb_data : expanded_feb_data) feb_data_v.push_back(&feb_data);
+    }
+    else {
+      art::Handle<std::vector<sbnd::crt::FEBData>> feb_data_h;
+      e.getByLabel(fFEBDataLabel, feb_data_h);
+
+      // make sure hits look good
+      if (!feb_data_h.isValid()) {
+        throw art::Exception(art::errors::Configuration) << "could not locate FEBData." << std::endl;;
+      }
+      for (auto const& feb_data : *feb_data_h) feb_data_v.push_back(&feb_data);
     }
-
-    std::vector<art::Ptr<sbnd::crt::FEBData>> feb_data_v;
-    art::fill_ptr_vector(feb_data_v, feb_data_h);
-
-    art::FindManyP<sim::AuxDetIDE, sbnd::crt::FEBTruthInfo> febdata_to_ides (feb_data_h, e, fFEBDataLabel);
-
-    //Fill arrays with default values
-    std::fill(feb_hits_in_fragments, feb_hits_in_fragments + sizeof(feb_hits_in_fragments), 0);
 
     // fragments vector
     std::unique_ptr<std::vector<artdaq::Fragment>> vecFrag = std::make_unique<std::vector<artdaq::Fragment>>();
@@ -213,69 +224,79 @@ void sbnd::trigger::CRTArtdaqFragmentProducer::produce(art::Event& e)
     std::normal_distribution<double> distribution(175.0,23.0);
 
     //list all fragment ids - uncomment if needed for daq running
-  /*if (fVerbose){std::cout<<"Num Modules: "<<fCrtGeo.NumModules()<<std::endl;}
-    for (size_t mod_i = 0; mod_i<fCrtGeo.NumModules(); mod_i++){
-      int plane = sbnd::CRTCommonUtils::GetPlaneIndex(fCrtGeo.GetTaggerName(fCrtGeo.ChannelToStripName(mod_i * 32)));
+  /*if (fVerbose){std::cout<<"Num Modules: "<<fCrtGeo->NumModules()<<std::endl;}
+    for (size_t mod_i = 0; mod_i<fCrtGeo->NumModules(); mod_i++){
+      int plane = sbnd::CRTCommonUtils::GetPlaneIndex(fCrtGeo->GetTaggerName(fCrtGeo->ChannelToStripName(mod_i * 32)));
       if (fVerbose){std::cout << std::hex << (32768 + 12288 + (plane * 256) + (int)mod_i) << std::endl;}
     } */
 
-    //loop through FEBData product and sort by module/mac5
-    for (size_t feb_i = 0; feb_i < feb_data_v.size(); feb_i++) {
+    //sort the FEBData product by module/mac5: count the hits of each mac5,
+    //then place each hit straight into its slot of the sorted hit array
+    first_hit.assign(num_febs + 1, 0);
+    for (auto const& feb_data : feb_data_v) {
+        if (feb_data->Mac5() >= num_febs) {
+          throw art::Exception(art::errors::DataCorruption) << "FEBData with mac5 " << feb_data->Mac5() << " above " << num_febs - 1 << std::endl;
+        }
+        first_hit[feb_data->Mac5() + 1]++;
+    }
+    for (size_t mac5 = 0; mac5 < num_febs; mac5++) first_hit[mac5 + 1] += first_hit[mac5];
 
-        auto const feb_data = feb_data_v[feb_i];
+    febHits.resize(feb_data_v.size());
+    std::vector<uint32_t> next_hit(first_hit.begin(), first_hit.end() - 1);
 
-        if(fVerbose){std::cout << "FEB " << feb_i << " with mac " << feb_data->Mac5() << std::endl;}
+    //the pedestals are drawn in the order of the FEBData product, as before sorting
+    for (size_t feb_i = 0; feb_i < feb_data_v.size(); feb_i++) {
 
-        empty_fragment[feb_data->Mac5()] = false;
+        auto const& feb_data = feb_data_v[feb_i];
 
-        int channel = feb_data->Mac5() * 32;
-        std::string stripName = fCrtGeo.ChannelToStripName(channel);
-        std::string tagger = fCrtGeo.GetTaggerName(stripName);
-        taggers[feb_data->Mac5()] = tagger;
+        if(fVerbose){std::cout << "FEB " << feb_i << " with mac " << feb_data->Mac5() << std::endl;}
 
-        T0s[feb_data->Mac5()][feb_hits_in_fragments[feb_data->Mac5()]] = feb_data->Ts0();
-        T1s[feb_data->Mac5()][feb_hits_in_fragments[feb_data->Mac5()]] = feb_data->Ts1();
-        for (int i_adc = 0; i_adc<32; i_adc++){
+        FEBHit& febHit = febHits[next_hit[feb_data->Mac5()]++];
+        febHit.ts0 = feb_data->Ts0();
+        febHit.ts1 = feb_data->Ts1();
+        auto const& feb_adcs = feb_data->ADC();
+        for (int i_adc = 0; i_adc<num_channels; i_adc++){
           uint16_t adc = 0;
-          if (feb_data->ADC()[i_adc] > 4089){
+          if (feb_adcs[i_adc] > 4089){
             adc = 4089;
-          }else if (feb_data->ADC()[i_adc] == 0){
+          }else if (feb_adcs[i_adc] == 0){
             //pull from a normal distribution to simulate pedestal
             adc = distribution(generator);
           }else{
-            adc = feb_data->ADC()[i_adc];
+            adc = feb_adcs[i_adc];
           }
-          ADCs[feb_data->Mac5()][feb_hits_in_fragments[feb_data->Mac5()]][i_adc] = adc;
+          febHit.adc[i_adc] = adc;
         }
 
-        feb_hits_in_fragments[feb_data->Mac5()]++;
-
     }//FEBData loop
 
     //make one fragment for every module
     for (size_t feb_i = fFirstFEBMac5; feb_i < num_module+fFirstFEBMac5; feb_i++){
         //quantities in fragment
-        if (empty_fragment[feb_i]){
+        FEBHit const* feb_hits = nullptr;
+        uint16_t feb_hits_in_fragment = 0;
+        FEBHit reset_hit;
+        if (feb_i < num_febs && first_hit[feb_i + 1] > first_hit[feb_i]){
+          feb_hits = febHits.data() + first_hit[feb_i];
+          feb_hits_in_fragment = first_hit[feb_i + 1] - first_hit[feb_i];
+        }else{
           //if no hits for a module, make a simulated "T1 reset" event to avoid missing fragments
-          feb_hits_in_fragments[feb_i] = 1;
-          int channel = feb_i * 32;
-          std::string stripName = fCrtGeo.ChannelToStripName(channel);
-          std::string tagger = fCrtGeo.GetTaggerName(stripName);
-          taggers[feb_i] = tagger;
-
-          T0s[feb_i][0] = 0;
-          T1s[feb_i][0] = 0;
-          for (int i_adc = 0; i_adc<32; i_adc++){
+          reset_hit.ts0 = 0;
+          reset_hit.ts1 = 0;
+          for (int i_adc = 0; i_adc<num_channels; i_adc++){
             uint16_t adc = distribution(generator);
-            ADCs[feb_i][0][i_adc] = adc;
+            reset_hit.adc[i_adc] = adc;
           }
+          feb_hits = &reset_hit;
+          feb_hits_in_fragment = 1;
         }
 
-        if (feb_hits_in_fragments[feb_i]==0) continue;
+        int channel = feb_i * 32;
+        std::string stripName = fCrtGeo->ChannelToStripName(channel);
+        std::string tagger = fCrtGeo->GetTaggerName(stripName);
 
       //metadata
         uint8_t  mac5 = (uint8_t)feb_i; //last 8 bits of FEB mac5 address
-        uint16_t feb_hits_in_fragment = feb_hits_in_fragments[feb_i];
 
         sbndaq::BernCRTFragmentMetadataV2 metadata;
 
@@ -286,10 +307,10 @@ void sbnd::trigger::CRTArtdaqFragmentProducer::produce(art::Event& e)
         metadata.set_run_start_time(run_start_time);
         metadata.update_poll_time(this_poll_start, this_poll_end);
 
-        uint64_t  timestamp = (uint64_t)(T0s[feb_i][feb_hits_in_fragments[feb_i]]/fClockSpeedCRT); //absolute timestamp
+        uint64_t  timestamp = (uint64_t)(feb_hits[0].ts0/fClockSpeedCRT); //absolute timestamp
 
         // create fragment
-        sbnd::crt::CRTTagger tagger_num = sbnd::crt::CRTCommonUtils::GetTaggerEnum(taggers[feb_i]);
+        sbnd::crt::CRTTagger tagger_num = sbnd::crt::CRTCommonUtils::GetTaggerEnum(tagger);
         uint16_t fragmentIDVal = 32768 + 12288 + (tagger_num * 256) + (uint16_t)mac5;
         if(fVerbose){std::cout<<"fragmentID: "<<std::bitset<16>{fragmentIDVal}<<std::endl;}
         auto fragment_uptr = artdaq::Fragment::FragmentBytes(sizeof(sbndaq::BernCRTHitV2)*metadata.hits_in_fragment(), //payload_size
@@ -300,18 +321,19 @@ void sbnd::trigger::CRTArtdaqFragmentProducer::produce(art::Event& e)
             timestamp
           ); // unique pointer
 
-        // populate fragment
-        std::vector<sbndaq::BernCRTHitV2> data_vec;
-        for (int i_frag = 0; i_frag<feb_hits_in_fragments[feb_i]; i_frag++){
-          sbndaq::BernCRTHitV2 hit;
+        // populate fragment, writing the hits straight into its payload
+        writer::BernCRTHitWriter hits(*fragment_uptr);
+        for (int i_frag = 0; i_frag<feb_hits_in_fragment; i_frag++){
+          sbndaq::BernCRTHitV2& hit = hits.Next();
+          FEBHit const& febHit = feb_hits[i_frag];
 
           uint8_t flags = 3;
-          uint32_t ts0 = T0s[feb_i][i_frag];
-          uint32_t ts1 = T1s[feb_i][i_frag];
+          uint32_t ts0 = febHit.ts0;
+          uint32_t ts1 = febHit.ts1;
 
           if (ts1==0){flags=11;}else if (ts0==0){flags=7;}
 
-          uint64_t  feb_hit_number = feb_hits_in_fragments[feb_i]; //hit counter for individual FEB, including hits lost in FEB or fragment generator
+          uint64_t  feb_hit_number = feb_hits_in_fragment; //hit counter for individual FEB, including hits lost in FEB or fragment generator
           timestamp = (uint64_t)ts0/fClockSpeedCRT; //absolute timestamp
           uint64_t  last_accepted_timestamp = temp_last_time; //timestamp of previous accepted hit
           temp_last_time = timestamp;
@@ -321,23 +343,16 @@ void sbnd::trigger::CRTArtdaqFragmentProducer::produce(art::Event& e)
           hit.lostfpga = (uint16_t)lostfpga;
           hit.ts0 = (uint32_t)ts0;
           hit.ts1 = (uint32_t)ts1;
-          for (int i_adc = 0; i_adc<32; i_adc++){
-            hit.adc[i_adc] = ADCs[feb_i][i_frag][i_adc];
-          }
+          std::copy_n(febHit.adc, num_channels, hit.adc);
           hit.coinc = (uint32_t)coinc;
           hit.feb_hit_number = (uint64_t)feb_hit_number;
           hit.timestamp = (uint64_t)timestamp;
           hit.last_accepted_timestamp = (uint64_t)last_accepted_timestamp;
           hit.lost_hits = (uint16_t)lost_hits;
-
-          data_vec.emplace_back(hit);
         }//bern crt hit vector
 
-        //copy data vector of hits into the fragment we made
-        std::memcpy(fragment_uptr->dataBeginBytes(), data_vec.data(), sizeof(sbndaq::BernCRTHitV2)*metadata.hits_in_fragment());
-
         // add fragment to vector
-        vecFrag->push_back(*fragment_uptr);
+        vecFrag->push_back(std::move(*fragment_uptr));
 
     }//module (mac5) loop
 
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////
+// File:        FragmentWriters.h
+//
+// Writers used by the ArtdaqFragmentProducer, pmtArtdaqFragmentProducer
+// and CRTArtdaqFragmentProducer to fill emulated DAQ fragments.
+//
+// A fragment is created at its final payload size first and the
+// writers then encode straight into its payload, so no temporary
+// buffer is filled and copied in afterwards. The PMT waveforms are
+// likewise added to their channel without building a padded copy.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_TRIGGER_FRAGMENTWRITERS_H
+#define SBND_TRIGGER_FRAGMENTWRITERS_H
+
+#include "sbndaq-artdaq-core/Overlays/Common/BernCRTFragmentV2.hh"
+#include "sbndaq-artdaq-core/Overlays/Common/CAENV1730Fragment.hh"
+#include "artdaq-core/Data/Fragment.hh"
+#include "lardataobj/RawData/OpDetWaveform.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace sbnd {
+  namespace trigger {
+    namespace writer {
+
+      // Hands out the BernCRTHitV2 slots of a CRT fragment payload in order
+      class BernCRTHitWriter {
+      public:
+        explicit BernCRTHitWriter(artdaq::Fragment &frag)
+          : fNext(reinterpret_cast<sbndaq::BernCRTHitV2*>(frag.dataBeginBytes())) {}
+
+        // the slot starts out as a default constructed hit
+        sbndaq::BernCRTHitV2& Next() { *fNext = sbndaq::BernCRTHitV2(); return *fNext++; }
+
+      private:
+        sbndaq::BernCRTHitV2* fNext;
+      };
+
+      // Header and per-channel sample blocks of a CAEN V1730 fragment payload
+      class V1730Writer {
+      public:
+        V1730Writer(artdaq::Fragment &frag, size_t wfmLength)
+          : fHeader(reinterpret_cast<sbndaq::CAENV1730EventHeader*>(frag.dataBeginBytes()))
+          , fSamples(reinterpret_cast<uint16_t*>(frag.dataBeginBytes() + sizeof(sbndaq::CAENV1730EventHeader)))
+          , fWfmLength(wfmLength) {}
+
+        sbndaq::CAENV1730EventHeader& Header() { return *fHeader; }
+        uint16_t* Channel(size_t i_ch) { return fSamples + i_ch*fWfmLength; }
+
+      private:
+        sbndaq::CAENV1730EventHeader* fHeader;
+        uint16_t* fSamples;
+        size_t fWfmLength;
+      };
+
+      // Number of baseline samples the producers pad over a time span [us],
+      // counted with the same floating point steps they always used
+      inline size_t PaddingSamples(double span, double sampling) {
+        size_t n = 0;
+        for (double i = span; i > 0.; i -= (1./sampling)) n++;
+        return n;
+      }
+
+      // Adds a waveform to the full-length waveform of its channel, as if it had
+      // been padded with the baseline to [minStartTime, maxEndTime] first; the
+      // channel is extended with the baseline when it is shorter than that.
+      // Returns the length of the padded waveform.
+      inline size_t AddToChannel(const raw::OpDetWaveform &wvf, double minStartTime, double maxEndTime,
+                               double sampling, int baseline, std::vector<short> &channel) {
+        double startTime = wvf.TimeStamp(); // in us
+        double endTime = double(wvf.size()) / sampling + startTime; // in us
+
+        size_t nBefore = (startTime > minStartTime) ? PaddingSamples(startTime - minStartTime, sampling) : 0;
+        size_t nAfter = (endTime < maxEndTime) ? PaddingSamples(maxEndTime - endTime, sampling) : 0;
+        size_t fullSize = nBefore + wvf.size() + nAfter;
+
+        if (channel.size() < fullSize) channel.resize(fullSize, baseline);
+
+        // the padding holds the baseline and adds nothing
+        for (size_t i = 0; i < wvf.size(); i++) {
+          channel[nBefore + i] += (wvf[i] - baseline);
+        }
+
+        return fullSize;
+      }
+
+    } // namespace writer
+  } // namespace trigger
+} // namespace sbnd
+
+#endif
@@ -25,6 +25,8 @@
 #include "artdaq-core/Data/ContainerFragment.hh"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/Trigger/CRT/BernCRTMetrics.h"
+#include "sbndcode/Trigger/PMT/V1730Metrics.h"
 #include "sbnobj/SBND/Trigger/pmtSoftwareTrigger.hh"
 //#include "sbndaq-artdaq-core/Obj/SBND/pmtSoftwareTrigger.hh"
 //#include "sbndaq-artdaq-core/Obj/SBND/CRTmetric.hh"
@@ -71,6 +73,7 @@ private:
 
   //metric variables
   int hitsperplane[7];
+  sbnd::trigger::berncrt::HitArrays fCRTHits; // valid hits of all the CRT fragments of the event
 
   //PMT Metric variables
 
@@ -84,6 +87,7 @@ private:
   bool fCountPMTs;
   bool fCalculatePEMetrics;
   bool fFindPulses;
+  bool fUseChannelWorkers;
 
   std::vector<double> fInputBaseline;
   int fADCThreshold;
@@ -102,20 +106,19 @@ private:
   // waveforms
   uint32_t fTriggerTime;
   bool fWvfmsFound;
-  std::vector<std::vector<uint16_t>> fWvfmsVec;
+  std::vector<sbnd::trigger::v1730::ChannelSpan> fWvfmSpans; // views into the beam fragments
 
   // pmt information
   std::vector<sbnd::trigger::pmtInfo> fpmtInfoVec;
+  std::vector<sbnd::trigger::v1730::ChannelMetrics> fChannelMetrics;
 
   //both info
   int num_crt_frags;
   int num_pmt_frags;
 
 
-  void analyze_crt_fragment(artdaq::Fragment & frag);
+  void analyze_crt_fragment(const artdaq::Fragment & frag);
   void checkCAEN1730FragmentTimeStamp(const artdaq::Fragment &frag);
-  void analyzeCAEN1730Fragment(const artdaq::Fragment &frag);
-  void estimateBaseline(int i_ch);
   void SimpleThreshAlgo(int i_ch);
 
   // variables to create an output root tree
@@ -149,6 +152,7 @@ sbndaq::MetricProducer::MetricProducer(fhicl::ParameterSet const& p)
   fCountPMTs(p.get<bool>("CountPMTs",true)),
   fCalculatePEMetrics(p.get<bool>("CalculatePEMetrics",false)),
   fFindPulses(p.get<bool>("FindPulses", false)),
+  fUseChannelWorkers(p.get<bool>("UseChannelWorkers", false)),
   fADCThreshold(p.get<double>("ADCThreshold", 7960)),
   fPEArea(p.get<double>("PEArea", 66.33))
   {
@@ -200,10 +204,11 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
   // clear variables at the beginning of the event
   // move this to constructor??
   for (int ip=0;ip<7;++ip)  { crt_metrics.hitsperplane[ip]=0; hitsperplane[ip]=0;}
+  fCRTHits.clear();
   foundBeamTrigger = false;
   fWvfmsFound = false;
-  fWvfmsVec.clear(); fWvfmsVec.resize(15*8); // 15 pmt channels per fragment, 8 fragments per trigger
-  fpmtInfoVec.clear(); fpmtInfoVec.resize(15*8);
+  fWvfmSpans.assign(sbnd::trigger::v1730::kNChannels, sbnd::trigger::v1730::ChannelSpan()); // 15 pmt channels per fragment, 8 fragments per trigger
+  fpmtInfoVec.clear(); fpmtInfoVec.resize(sbnd::trigger::v1730::kNChannels);
 
   _pmt_beam_trig = false;
   _pmt_time_trig = -9999;
@@ -218,12 +223,12 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
   num_crt_frags = 0;
   num_pmt_frags = 0;
   // loop over fragment handles
-  for (auto handle : fragmentHandles) {
+  for (auto const& handle : fragmentHandles) {
     if (!handle.isValid() || handle->size() == 0) continue;
 
     if (handle->front().type() == artdaq::Fragment::ContainerFragmentType) {
       // container fragment
-      for (auto cont : *handle) {
+      for (auto const& cont : *handle) {
         artdaq::ContainerFragment contf(cont);
         if (contf.fragment_type() == sbndaq::detail::FragmentType::BERNCRTV2){
           if (fVerbose)     std::cout << "    Found " << contf.block_count() << " CRT Fragments in container " << std::endl;
@@ -236,7 +241,7 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
     else {
       // normal fragment
       size_t beamFragmentIdx = -1;
-      for (auto frag : *handle){
+      for (auto const& frag : *handle){
         beamFragmentIdx++;
         if (frag.type()==sbndaq::detail::FragmentType::BERNCRTV2) {
           num_crt_frags++;
@@ -255,7 +260,7 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
               // if set of fragment in time with beam found, process waveforms
               if (foundBeamTrigger && beamFragmentIdx != 9999) {
                 for (size_t fragmentIdx = beamFragmentIdx; fragmentIdx < beamFragmentIdx+8; fragmentIdx++) {
-                  analyzeCAEN1730Fragment(handle->at(fragmentIdx));
+                  sbnd::trigger::v1730::DecodeFragment(handle->at(fragmentIdx), fWvfmLength, fWvfmSpans);
                 }
                 fWvfmsFound = true;
               }
@@ -271,6 +276,8 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
 
   if (fCalcCRTMetrics){
 
+    sbnd::trigger::berncrt::CountHitsPerPlane(fCRTHits, fBeamWindowStart, fBeamWindowEnd, hitsperplane);
+
     for (int i=0;i<7;++i) {
       crt_metrics.hitsperplane[i] = hitsperplane[i];
       _crt_hitsperplane[i] = hitsperplane[i];
@@ -307,35 +314,40 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
       int beamStartBin = (triggerTimeStamp >= 1000)? 0 : int(500 - abs((triggerTimeStamp-1000)/2));
       int beamEndBin   = (triggerTimeStamp >= 1000)? int(500 + (fBeamWindowLength*1e3 - triggerTimeStamp)/2) : (beamStartBin + (fBeamWindowLength*1e3)/2);
 
+      // per-channel baseline, threshold and minimum ADC metrics, independent between channels
+      sbnd::trigger::v1730::MetricConfig metricConfig;
+      metricConfig.calculateBaseline = fCalculateBaseline;
+      if (!fCalculateBaseline) { metricConfig.inputBaseline = fInputBaseline.at(0); metricConfig.inputBaselineSigma = fInputBaseline.at(1); }
+      metricConfig.countPMTs = fCountPMTs;
+      metricConfig.calculatePEMinima = fCalculatePEMetrics && !fFindPulses;
+      metricConfig.adcThreshold = fADCThreshold;
+      metricConfig.beamStartBin = beamStartBin;
+      metricConfig.beamEndBin = beamEndBin;
+      sbnd::trigger::v1730::ComputeMetrics(fWvfmSpans, metricConfig, fChannelMetrics, fUseChannelWorkers);
+
       // wvfm loop to calculate metrics
       for (int i_ch = 0; i_ch < 120; ++i_ch){
         auto &pmtInfo = fpmtInfoVec.at(i_ch);
-        auto wvfm = fWvfmsVec[i_ch];
+        auto const& metrics = fChannelMetrics[i_ch];
 
         // assign channel
         pmtInfo.channel = channelList.at(i_ch);
 
-        // calculate baseline
-        if (fCalculateBaseline) estimateBaseline(i_ch);
-        else { pmtInfo.baseline=fInputBaseline.at(0); pmtInfo.baselineSigma = fInputBaseline.at(1); }
+        pmtInfo.baseline = metrics.baseline;
+        pmtInfo.baselineSigma = metrics.baselineSigma;
 
         // count number of PMTs above threshold
         if (fCountPMTs){
-          for (int bin = beamStartBin; bin < beamEndBin; ++bin){
-            auto adc = wvfm[bin];
-            if (adc < fADCThreshold){ nAboveThreshold++; break; } 
-          }
+          if (metrics.nBelowThreshold > 0) nAboveThreshold++;
         }
         else nAboveThreshold=-9999;
 
         // quick estimate prompt and preliminary light, assuming sampling rate of 500 MHz (2 ns per bin)
         if (fCalculatePEMetrics){
           double baseline = pmtInfo.baseline;
-          auto prompt_window = std::vector<uint16_t>(wvfm.begin()+500, wvfm.begin()+1000);
-          auto prelim_window = std::vector<uint16_t>(wvfm.begin()+beamStartBin, wvfm.begin()+500);
           if (fFindPulses == false){
-            double ch_promptPE = (baseline-(*std::min_element(prompt_window.begin(), prompt_window.end())))/8;
-            double ch_prelimPE = (baseline-(*std::min_element(prelim_window.begin(), prelim_window.end())))/8;
+            double ch_promptPE = (baseline-metrics.promptMin)/8;
+            double ch_prelimPE = (baseline-metrics.prelimMin)/8;
             promptPE += ch_promptPE;
             prelimPE += ch_prelimPE;
           }
@@ -390,31 +402,10 @@ void sbndaq::MetricProducer::produce(art::Event& evt)
 
 
 
-void sbndaq::MetricProducer::analyze_crt_fragment(artdaq::Fragment & frag)
+void sbndaq::MetricProducer::analyze_crt_fragment(const artdaq::Fragment & frag)
 {
-
-  sbndaq::BernCRTFragmentV2 bern_fragment(frag);
-
-  // use  fragment ID to get plane information
-  const sbndaq::BernCRTFragmentMetadataV2* md = bern_fragment.metadata();
-  //frag.sequenceID()
-  auto thisone = frag.fragmentID();  uint plane = (thisone & 0x0700) >> 8;
-  if (plane>7) {std::cout << "bad plane value " << plane << std::endl; plane=0;}
-
-  for(unsigned int iHit = 0; iHit < md->hits_in_fragment(); iHit++) {
-    sbndaq::BernCRTHitV2 const* bevt = bern_fragment.eventdata(iHit);
-    // require that this is data and not clock reset (0xC), and that the ts1 time is valid (0x2)
-    auto thisflag = bevt->flags;
-    if (thisflag & 0x2 && !(thisflag & 0xC) ) {
-      // check ts1 for beam window
-      auto thistime=bevt->ts1;
-      if ((int)thistime>fBeamWindowStart && (int)thistime<fBeamWindowEnd) hitsperplane[plane]++;
-      //crt_metrics.hitsperplane[plane]++;
-    }
-  }
-
-
-
+  // the beam window hits are counted once all the fragments are decoded
+  sbnd::trigger::berncrt::DecodeFragment(frag, fCRTHits);
 }//analyze crt fragments
 
 
@@ -429,8 +420,7 @@ void sbndaq::MetricProducer::checkCAEN1730FragmentTimeStamp(const artdaq::Fragme
 
   // access beam signal, in ch15 of first PMT of each fragment set
   // check entry 500 (0us), at trigger time
-  const uint16_t* data_begin = reinterpret_cast<const uint16_t*>(frag.dataBeginBytes()
-                 + sizeof(sbndaq::CAENV1730EventHeader));
+  const uint16_t* data_begin = sbnd::trigger::v1730::FragmentSamples(frag);
   const uint16_t* value_ptr =  data_begin;
   uint16_t value = 0;
 
@@ -446,58 +436,8 @@ void sbndaq::MetricProducer::checkCAEN1730FragmentTimeStamp(const artdaq::Fragme
   }
 }//check caen 1730 timestamp
 
-void sbndaq::MetricProducer::analyzeCAEN1730Fragment(const artdaq::Fragment &frag) {
-
-  // access fragment ID; index of fragment out of set of 8 fragments
-  int fragId = static_cast<int>(frag.fragmentID());
-
-  // access waveforms in fragment and save
-  const uint16_t* data_begin = reinterpret_cast<const uint16_t*>(frag.dataBeginBytes()
-                 + sizeof(sbndaq::CAENV1730EventHeader));
-  const uint16_t* value_ptr =  data_begin;
-  uint16_t value = 0;
-
-  // channel offset
-  size_t nChannels = 15; // 15 pmts per fragment
-  size_t ch_offset = 0;
-
-  // loop over channels
-  for (size_t i_ch = 0; i_ch < nChannels; ++i_ch){
-    fWvfmsVec[i_ch + nChannels*fragId].resize(fWvfmLength);
-    ch_offset = (size_t)(i_ch * fWvfmLength);
-    //--loop over waveform samples
-    for(size_t i_t = 0; i_t < fWvfmLength; ++i_t){
-      value_ptr = data_begin + ch_offset + i_t; // pointer arithmetic
-      value = *(value_ptr);
-      fWvfmsVec[i_ch + nChannels*fragId][i_t] = value;
-    } //--end loop samples
-  } //--end loop channels
-}//analyze caen 1730 fragment
-
-void sbndaq::MetricProducer::estimateBaseline(int i_ch){
-  auto wvfm = fWvfmsVec[i_ch];
-  auto &pmtInfo = fpmtInfoVec[i_ch];
-  // assuming that the first 500 ns doesn't include peaks, find the mean of the ADC count as the baseline
-  std::vector<uint16_t> subset = std::vector<uint16_t>(wvfm.begin(), wvfm.begin()+250);
-  double subset_mean = (std::accumulate(subset.begin(), subset.end(), 0))/(subset.size());
-  double val = 0;
-  for (size_t i=0; i<subset.size();i++){ val += (subset[i] - subset_mean)*(subset[i] - subset_mean);}
-  double subset_stddev = sqrt(val/subset.size());
-
-  // if the first 500 ns seem to be messy, use the last 500
-  if (subset_stddev > 3){ // make this fcl parameter?
-    val = 0; subset.clear(); subset_stddev = 0;
-    subset = std::vector<uint16_t>(wvfm.end()-500, wvfm.end());
-    subset_mean = (std::accumulate(subset.begin(), subset.end(), 0))/(subset.size());
-    for (size_t i=0; i<subset.size();i++){ val += (subset[i] - subset_mean)*(subset[i] - subset_mean);}
-    subset_stddev = sqrt(val/subset.size());
-  }
-  pmtInfo.baseline = subset_mean;
-  pmtInfo.baselineSigma = subset_stddev;
-}//estimateBaseline
-
 void sbndaq::MetricProducer::SimpleThreshAlgo(int i_ch){
-  auto wvfm = fWvfmsVec[i_ch];
+  auto const& wvfm = fWvfmSpans[i_ch];
   auto &pmtInfo = fpmtInfoVec[i_ch];
   double baseline = pmtInfo.baseline;
   double baseline_sigma = pmtInfo.baselineSigma;
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////
+// File:        V1730Metrics.h
+//
+// Per-channel PMT trigger metrics computed straight from the CAEN V1730
+// fragments, shared by the pmtSoftwareTriggerProducer and MetricProducer.
+//
+// The waveforms are not copied out of the fragments: each channel is a
+// span pointing into the fragment payload, which stays valid for the
+// whole event. The channels are independent, so their metrics can be
+// computed concurrently; the module then sums them in channel order,
+// which keeps the totals identical to a serial run.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_TRIGGER_PMT_V1730METRICS_H
+#define SBND_TRIGGER_PMT_V1730METRICS_H
+
+#include "sbndaq-artdaq-core/Overlays/Common/CAENV1730Fragment.hh"
+#include "artdaq-core/Data/Fragment.hh"
+#include "sbndcode/OpDetSim/TriggerPrimitives.hh"
+
+#include "tbb/parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace sbnd {
+  namespace trigger {
+    namespace v1730 {
+
+      constexpr size_t kChannelsPerFragment = 15; // pmts per fragment
+      constexpr size_t kFragmentsPerTrigger = 8;
+      constexpr size_t kNChannels = kChannelsPerFragment*kFragmentsPerTrigger;
+
+      // Read-only view of the samples of one channel inside a fragment
+      struct ChannelSpan {
+        const uint16_t* data = nullptr;
+        size_t size = 0;
+
+        const uint16_t* begin() const { return data; }
+        const uint16_t* end() const { return data + size; }
+        uint16_t operator[](size_t i) const { return data[i]; }
+        bool empty() const { return size == 0; }
+      };
+
+      // Metrics of one channel; the beam window is [beamStartBin, beamEndBin)
+      struct ChannelMetrics {
+        double baseline = 0;
+        double baselineSigma = 0;
+        int nBelowThreshold = 0;         // beam window bins under the ADC threshold
+        bool lastBelowThreshold = false; // whether the last beam window bin is under it
+        uint16_t promptMin = 0;          // minimum ADC in [500, 1000)
+        uint16_t prelimMin = 0;          // minimum ADC in [beamStartBin, 500)
+      };
+
+      struct MetricConfig {
+        bool calculateBaseline = true;
+        double inputBaseline = 0;
+        double inputBaselineSigma = 0;
+        bool countPMTs = true;
+        bool calculatePEMinima = false;
+        int adcThreshold = 0;
+        int beamStartBin = 0;
+        int beamEndBin = 0;
+      };
+
+      // First sample of the fragment payload, after the V1730 event header
+      inline const uint16_t* FragmentSamples(const artdaq::Fragment &frag) {
+        return reinterpret_cast<const uint16_t*>(frag.dataBeginBytes() + sizeof(sbndaq::CAENV1730EventHeader));
+      }
+
+      // Points the spans of the 15 channels of the fragment into its payload
+      inline void DecodeFragment(const artdaq::Fragment &frag, uint32_t wvfmLength, std::vector<ChannelSpan> &spans) {
+        // access fragment ID; index of fragment out of set of 8 fragments
+        size_t fragId = static_cast<size_t>(frag.fragmentID());
+        const uint16_t* data_begin = FragmentSamples(frag);
+        for (size_t i_ch = 0; i_ch < kChannelsPerFragment; ++i_ch){
+          auto &span = spans[i_ch + kChannelsPerFragment*fragId];
+          span.data = data_begin + i_ch*wvfmLength;
+          span.size = wvfmLength;
+        }
+      }
+
+      // Mean and spread of the first 500 ns, or of the last 1 us if the start looks busy.
+      // The mean is truncated to an integer ADC count, as the metrics always did.
+      // The sums of the samples and of their squares are exact in integers, so
+      // one pass gives the same spread around the truncated mean as two would.
+      inline void EstimateBaseline(const ChannelSpan &wvfm, double &baseline, double &baselineSigma) {
+        auto meanAndSigma = [](const uint16_t* first, const uint16_t* last, double &mean, double &sigma) {
+          int64_t const n = last - first;
+          int64_t sum = 0, sum2 = 0;
+          for (auto it = first; it != last; ++it){ sum += *it; sum2 += int64_t(*it)*(*it); }
+          int64_t const m = sum/n;
+          mean = m;
+          sigma = sqrt(double(sum2 - 2*m*sum + n*m*m)/n);
+        };
+        meanAndSigma(wvfm.begin(), wvfm.begin()+250, baseline, baselineSigma);
+        if (baselineSigma > 3) meanAndSigma(wvfm.end()-500, wvfm.end(), baseline, baselineSigma);
+      }
+
+      inline ChannelMetrics ComputeChannelMetrics(const ChannelSpan &wvfm, const MetricConfig &config) {
+        ChannelMetrics metrics;
+
+        if (config.calculateBaseline) EstimateBaseline(wvfm, metrics.baseline, metrics.baselineSigma);
+        else { metrics.baseline = config.inputBaseline; metrics.baselineSigma = config.inputBaselineSigma; }
+
+        if (config.countPMTs && config.beamStartBin < config.beamEndBin){
+          metrics.nBelowThreshold = opdet::trigger::CountBelowThreshold(wvfm.begin()+config.beamStartBin, wvfm.begin()+config.beamEndBin, config.adcThreshold);
+          metrics.lastBelowThreshold = wvfm[config.beamEndBin-1] < config.adcThreshold;
+        }
+
+        if (config.calculatePEMinima){
+          metrics.promptMin = *std::min_element(wvfm.begin()+500, wvfm.begin()+1000);
+          metrics.prelimMin = *std::min_element(wvfm.begin()+config.beamStartBin, wvfm.begin()+500);
+        }
+
+        return metrics;
+      }
+
+      // Fills metrics[i] from spans[i] for every channel, concurrently if useWorkers is set
+      inline void ComputeMetrics(const std::vector<ChannelSpan> &spans, const MetricConfig &config,
+                                 std::vector<ChannelMetrics> &metrics, bool useWorkers) {
+        metrics.resize(spans.size());
+        auto computeChannel = [&](size_t i_ch) { metrics[i_ch] = ComputeChannelMetrics(spans[i_ch], config); };
+
+        if (useWorkers) tbb::parallel_for(size_t(0), spans.size(), computeChannel);
+        else {
+          for (size_t i_ch = 0; i_ch < spans.size(); ++i_ch) computeChannel(i_ch);
+        }
+      }
+
+    } // namespace v1730
+  } // namespace trigger
+} // namespace sbnd
+
+#endif
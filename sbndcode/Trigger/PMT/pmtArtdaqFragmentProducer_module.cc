@@ -30,6 +30,7 @@
 #include "sbndaq-artdaq-core/Overlays/Common/CAENV1730Fragment.hh"
 #include "sbndaq-artdaq-core/Overlays/FragmentType.hh"
 #include "artdaq-core/Data/Fragment.hh"
+#include "sbndcode/Trigger/FragmentWriters.h"
 
 // LArSoft includes
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
@@ -208,43 +209,15 @@ void sbnd::trigger::pmtArtdaqFragmentProducer::produce(art::Event& e)
     
     num_pmt_wvf++;
 
-    double fStartTime = wvf.TimeStamp(); // in us
-    double fEndTime = double(wvf.size()) / fSampling + fStartTime; // in us
-
-    // create full waveform
-    std::vector<short> wvf_full; wvf_full.reserve((short)(3020*1e6/2));
-
-    if (fStartTime > fMinStartTime){
-      for (double i = fStartTime-fMinStartTime; i>0.; i-=(1./fSampling)){
-        wvf_full.push_back(fBaseline);
-      }
-    }
-
-    for(unsigned int i = 0; i < wvf.size(); i++) {
-      wvf_full.push_back(wvf[i]);
-    }
-
-    if (fEndTime < fMaxEndTime){
-      for (double i = fMaxEndTime-fEndTime; i>0.; i-=(1./fSampling)){
-        wvf_full.push_back(fBaseline);
-      }
-    }
-
     // combine waveform with any other waveforms from same channel
     int i_ch = -1.;
     auto ich = std::find(channelList.begin(), channelList.end(), fChNumber);
     if (ich != channelList.end()){
       i_ch = ich - channelList.begin();
     }
-    if (wvf_channel.at(i_ch).size() < wvf_full.size()){
-      if (fVerbose) std::cout<<"Full waveform -- Previous Channel" << fChNumber <<" Size: "<<wvf_channel.at(i_ch).size()<<"New Channel" << fChNumber <<" Size: "<<wvf_full.size()<<std::endl;
-      for(unsigned int i = wvf_channel.at(i_ch).size(); i < wvf_full.size(); i++) {
-        wvf_channel.at(i_ch).push_back(fBaseline);
-      }
-    }
-    for(unsigned int i = 0; i < wvf_full.size(); i++) {
-       wvf_channel.at(i_ch)[i] += (wvf_full[i] - fBaseline);
-    } 
+    size_t prevSize = wvf_channel.at(i_ch).size();
+    size_t fullSize = writer::AddToChannel(wvf, fMinStartTime, fMaxEndTime, fSampling, fBaseline, wvf_channel.at(i_ch));
+    if (fVerbose && prevSize < fullSize) std::cout<<"Full waveform -- Previous Channel" << fChNumber <<" Size: "<<prevSize<<"New Channel" << fChNumber <<" Size: "<<fullSize<<std::endl;
 
     hist_id++;
 
@@ -315,47 +288,36 @@ void sbnd::trigger::pmtArtdaqFragmentProducer::produce(art::Event& e)
       fragment_uptr->setTimestamp(timestampVal);
 
       // populate fragment header
-      auto header_ptr = reinterpret_cast<sbndaq::CAENV1730EventHeader*>(fragment_uptr->dataBeginBytes());
-        
-      header_ptr->eventCounter = eventCounterVal;
-      header_ptr->boardID = boardIDVal;
-      header_ptr->triggerTimeTag = triggerTimeTagVal;  // ns // set timetag as random value for event
-      header_ptr->eventSize = eventSizeVal;
-        
-      // populate waveforms  
-      // populate fragment with waveform
-      uint16_t* data_begin = reinterpret_cast<uint16_t*>(fragment_uptr->dataBeginBytes() + sizeof(sbndaq::CAENV1730EventHeader));
-      uint16_t* value_ptr = data_begin;
-      uint16_t value = 0;
-      size_t ch_offset = 0;
+      writer::V1730Writer v1730(*fragment_uptr, wfm_length);
+      auto& header = v1730.Header();
+
+      header.eventCounter = eventCounterVal;
+      header.boardID = boardIDVal;
+      header.triggerTimeTag = triggerTimeTagVal;  // ns // set timetag as random value for event
+      header.eventSize = eventSizeVal;
 
+      // populate fragment with waveform
       // loop over channels
       for (size_t i_ch = 0; i_ch < nChannelsFrag; i_ch++) {
-        ch_offset = (size_t)(i_ch*wfm_length);
+        const short* wvf_in = wvf_channel[counter*nChannelsFrag + i_ch].data() + startIdx;
+        uint16_t* value_ptr = v1730.Channel(i_ch);
         // loop over waveform
         for (size_t i_t = 0; i_t < wfm_length; i_t++) {
-          // set value
-          value = wvf_channel[counter*nChannelsFrag + i_ch][startIdx+i_t];
-          value_ptr = data_begin + ch_offset + i_t;
-          *value_ptr = value;
+          value_ptr[i_t] = wvf_in[i_t];
         }
       }
 
       // create add beam window trigger waveform
-      ch_offset = (size_t)(nChannelsFrag*wfm_length);
       size_t beamStartIdx = abs(fMinStartTime)*1000/2;
       size_t beamEndIdx = beamStartIdx + fBeamWindowLength*1000/2;
+      uint16_t* value_ptr = v1730.Channel(nChannelsFrag);
       // loop over waveform
       for (size_t i_t = 0; i_t < wfm_length; i_t++) {
-        // set value
-        if (startIdx + i_t >= beamStartIdx && startIdx + i_t <= beamEndIdx) value = 1;
-        else value = 0;
-        value_ptr = data_begin + ch_offset + i_t;
-        *value_ptr = value;
+        value_ptr[i_t] = (startIdx + i_t >= beamStartIdx && startIdx + i_t <= beamEndIdx) ? 1 : 0;
       }
 
       // add fragment to vector
-      vecFrag->push_back(*fragment_uptr);  
+      vecFrag->push_back(std::move(*fragment_uptr));
     }
   }
 
@@ -32,6 +32,7 @@
 #include "artdaq-core/Data/ContainerFragment.hh"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/Trigger/PMT/V1730Metrics.h"
 #include "sbnobj/SBND/Trigger/pmtSoftwareTrigger.hh"
 
 // ROOT includes
@@ -81,6 +82,7 @@ private:
   bool fCountPMTs;
   bool fCalculatePEMetrics;
   bool fFindPulses;
+  bool fUseChannelWorkers;
 
   std::vector<double> fInputBaseline;
   int fADCThreshold;
@@ -107,14 +109,13 @@ private:
   // waveforms
   uint32_t fTriggerTime;
   bool fWvfmsFound;
-  std::vector<std::vector<uint16_t>> fWvfmsVec;
+  std::vector<v1730::ChannelSpan> fWvfmSpans; // views into the beam fragments
 
   // pmt information 
   std::vector<sbnd::trigger::pmtInfo> fpmtInfoVec;
+  std::vector<v1730::ChannelMetrics> fChannelMetrics;
 
   void checkCAEN1730FragmentTimeStamp(const artdaq::Fragment &frag);
-  void analyzeCAEN1730Fragment(const artdaq::Fragment &frag);
-  void estimateBaseline(int i_ch);
   void SimpleThreshAlgo(int i_ch);
 
   TTree* _tree; 
@@ -152,6 +153,7 @@ sbnd::trigger::pmtSoftwareTriggerProducer::pmtSoftwareTriggerProducer(fhicl::Par
   fCountPMTs(p.get<bool>("CountPMTs",true)),
   fCalculatePEMetrics(p.get<bool>("CalculatePEMetrics",false)),
   fFindPulses(p.get<bool>("FindPulses", false)),
+  fUseChannelWorkers(p.get<bool>("UseChannelWorkers", false)),
   fInputBaseline(p.get<std::vector<double>>("InputBaseline")),
   fADCThreshold(p.get<double>("ADCThreshold", 7960)),
   fPEArea(p.get<double>("PEArea", 66.33))
@@ -217,8 +219,8 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::produce(art::Event& e)
   // reset for this event
   foundBeamTrigger = false;
   fWvfmsFound = false;
-  fWvfmsVec.clear(); fWvfmsVec.resize(15*8); // 15 pmt channels per fragment, 8 fragments per trigger
-  fpmtInfoVec.clear(); fpmtInfoVec.resize(15*8); 
+  fWvfmSpans.assign(v1730::kNChannels, v1730::ChannelSpan()); // 15 pmt channels per fragment, 8 fragments per trigger
+  fpmtInfoVec.clear(); fpmtInfoVec.resize(v1730::kNChannels); 
 
   _beam_trig = false;
   _time_trig = -9999;
@@ -252,7 +254,7 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::produce(art::Event& e)
       // if set of fragment in time with beam found, process waveforms
       if (foundBeamTrigger && beamFragmentIdx != 9999) {
         for (size_t fragmentIdx = beamFragmentIdx; fragmentIdx < beamFragmentIdx+8; fragmentIdx++) {
-          analyzeCAEN1730Fragment(handle->at(fragmentIdx));
+          v1730::DecodeFragment(handle->at(fragmentIdx), fWvfmLength, fWvfmSpans);
         }
         fWvfmsFound = true;
       }
@@ -296,43 +298,41 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::produce(art::Event& e)
     _pulse_t_start.reserve(1000); _pulse_t_end.reserve(1000); _pulse_t_peak.reserve(1000);
     _pulse_peak.reserve(1000); _pulse_area.reserve(1000);
 
+    // per-channel baseline, threshold and minimum ADC metrics, independent between channels
+    v1730::MetricConfig metricConfig;
+    metricConfig.calculateBaseline = fCalculateBaseline;
+    if (!fCalculateBaseline) { metricConfig.inputBaseline = fInputBaseline.at(0); metricConfig.inputBaselineSigma = fInputBaseline.at(1); }
+    metricConfig.countPMTs = fCountPMTs;
+    metricConfig.calculatePEMinima = fCalculatePEMetrics && !fFindPulses;
+    metricConfig.adcThreshold = fADCThreshold;
+    metricConfig.beamStartBin = beamStartBin;
+    metricConfig.beamEndBin = beamEndBin;
+    v1730::ComputeMetrics(fWvfmSpans, metricConfig, fChannelMetrics, fUseChannelWorkers);
+
     for (int i_ch = 0; i_ch < 120; ++i_ch){
       ch_ID[i_ch] = channelList.at(i_ch);
       auto &pmtInfo = fpmtInfoVec.at(i_ch);
-      auto wvfm = fWvfmsVec[i_ch];
+      auto const& metrics = fChannelMetrics[i_ch];
 
       // assign channel 
       pmtInfo.channel = channelList.at(i_ch);
 
-         // calculate baseline 
-      if (fCalculateBaseline) estimateBaseline(i_ch);
-      else { pmtInfo.baseline=fInputBaseline.at(0); pmtInfo.baselineSigma = fInputBaseline.at(1); }
+      pmtInfo.baseline = metrics.baseline;
+      pmtInfo.baselineSigma = metrics.baselineSigma;
 
       // count number of PMTs above threshold within the beam window
       if (fCountPMTs){
-        for (int bin = beamStartBin; bin < beamEndBin; ++bin){
-          auto adc = wvfm[bin];
-          if (adc < fADCThreshold){ 
-            ch_AboveThreshold[i_ch] = 1;
-            nAboveThreshold++; 
-            continue; 
-          } 
-          else{
-              ch_AboveThreshold[i_ch] = 0;
-            continue;
-          }
-        }
+        if (beamStartBin < beamEndBin) ch_AboveThreshold[i_ch] = metrics.lastBelowThreshold ? 1 : 0;
+        nAboveThreshold += metrics.nBelowThreshold;
       }
       else {nAboveThreshold=-9999;ch_AboveThreshold[i_ch] = -9999;}
 
       // quick estimate prompt and preliminary light, assuming sampling rate of 500 MHz (2 ns per bin)
       if (fCalculatePEMetrics){
         double baseline = pmtInfo.baseline;
-        auto prompt_window = std::vector<uint16_t>(wvfm.begin()+500, wvfm.begin()+1000);
-        auto prelim_window = std::vector<uint16_t>(wvfm.begin()+beamStartBin, wvfm.begin()+500);
         if (fFindPulses == false){
-          double ch_promptPE_ = (baseline-(*std::min_element(prompt_window.begin(), prompt_window.end())))/8;
-          double ch_prelimPE_ = (baseline-(*std::min_element(prelim_window.begin(), prelim_window.end())))/8;
+          double ch_promptPE_ = (baseline-metrics.promptMin)/8;
+          double ch_prelimPE_ = (baseline-metrics.prelimMin)/8;
           ch_prelimPE[i_ch] = ch_prelimPE_;
           ch_promptPE[i_ch] = ch_promptPE_;
           promptPE += ch_promptPE_;
@@ -405,8 +405,8 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::produce(art::Event& e)
     // start histo 
     if (fSaveHists == true){
       int hist_id = -1; 
-      for (size_t i_wvfm = 0; i_wvfm < fWvfmsVec.size(); ++i_wvfm){
-        std::vector<uint16_t> wvfm = fWvfmsVec[i_wvfm];
+      for (size_t i_wvfm = 0; i_wvfm < fWvfmSpans.size(); ++i_wvfm){
+        auto const& wvfm = fWvfmSpans[i_wvfm];
         hist_id++;
         //if (fEvent<4){
             histname.str(std::string());
@@ -463,8 +463,7 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::checkCAEN1730FragmentTimeStamp(c
 
   // access beam signal, in ch15 of first PMT of each fragment set
   // check entry 500 (0us), at trigger time
-  const uint16_t* data_begin = reinterpret_cast<const uint16_t*>(frag.dataBeginBytes() 
-                 + sizeof(sbndaq::CAENV1730EventHeader));
+  const uint16_t* data_begin = v1730::FragmentSamples(frag);
   const uint16_t* value_ptr =  data_begin;
   uint16_t value = 0;
 
@@ -480,61 +479,11 @@ void sbnd::trigger::pmtSoftwareTriggerProducer::checkCAEN1730FragmentTimeStamp(c
   }
 }
 
-void sbnd::trigger::pmtSoftwareTriggerProducer::analyzeCAEN1730Fragment(const artdaq::Fragment &frag) {
-  
-  // access fragment ID; index of fragment out of set of 8 fragments
-  int fragId = static_cast<int>(frag.fragmentID()); 
-
-  // access waveforms in fragment and save
-  const uint16_t* data_begin = reinterpret_cast<const uint16_t*>(frag.dataBeginBytes() 
-                 + sizeof(sbndaq::CAENV1730EventHeader));
-  const uint16_t* value_ptr =  data_begin;
-  uint16_t value = 0;
-
-  // channel offset
-  size_t nChannels = 15; // 15 pmts per fragment
-  size_t ch_offset = 0;
-
-  // loop over channels
-  for (size_t i_ch = 0; i_ch < nChannels; ++i_ch){
-    fWvfmsVec[i_ch + nChannels*fragId].resize(fWvfmLength);
-    ch_offset = (size_t)(i_ch * fWvfmLength);
-    //--loop over waveform samples
-    for(size_t i_t = 0; i_t < fWvfmLength; ++i_t){ 
-      value_ptr = data_begin + ch_offset + i_t; // pointer arithmetic
-      value = *(value_ptr);
-      fWvfmsVec[i_ch + nChannels*fragId][i_t] = value;
-    } //--end loop samples
-  } //--end loop channels
-}
-
-void sbnd::trigger::pmtSoftwareTriggerProducer::estimateBaseline(int i_ch){
-  auto wvfm = fWvfmsVec[i_ch];
-  auto &pmtInfo = fpmtInfoVec[i_ch]; 
-  // assuming that the first 500 ns doesn't include peaks, find the mean of the ADC count as the baseline 
-  std::vector<uint16_t> subset = std::vector<uint16_t>(wvfm.begin(), wvfm.begin()+250);
-  double subset_mean = (std::accumulate(subset.begin(), subset.end(), 0))/(subset.size()); 
-  double val = 0;
-  for (size_t i=0; i<subset.size();i++){ val += (subset[i] - subset_mean)*(subset[i] - subset_mean);}
-  double subset_stddev = sqrt(val/subset.size()); 
-
-  // if the first 500 ns seem to be messy, use the last 500 
-  if (subset_stddev > 3){ // make this fcl parameter? 
-    val = 0; subset.clear(); subset_stddev = 0;
-    subset = std::vector<uint16_t>(wvfm.end()-500, wvfm.end());
-    subset_mean = (std::accumulate(subset.begin(), subset.end(), 0))/(subset.size());
-    for (size_t i=0; i<subset.size();i++){ val += (subset[i] - subset_mean)*(subset[i] - subset_mean);}
-    subset_stddev = sqrt(val/subset.size()); 
-  }
-  pmtInfo.baseline = subset_mean;
-  pmtInfo.baselineSigma = subset_stddev;
-}
-
 /*
 PE threshold algorithm
 */
 void sbnd::trigger::pmtSoftwareTriggerProducer::SimpleThreshAlgo(int i_ch){
-  auto wvfm = fWvfmsVec[i_ch];
+  auto const& wvfm = fWvfmSpans[i_ch];
   auto &pmtInfo = fpmtInfoVec[i_ch]; 
   double baseline = pmtInfo.baseline;
   // double baseline_sigma = pmtInfo.baselineSigma;
@@ -71,6 +71,7 @@
 // SBN/SBND includes
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetSim/TriggerPrimitives.hh"
 #include "sbnobj/SBND/Trigger/pmtTrigger.hh"
 
 // ROOT includes
@@ -84,6 +85,8 @@
 #include <cmath>
 #include <memory>
 #include <string>
+#include <sstream>
+#include <utility>
 
 class pmtTriggerProducer: public art::EDProducer {
 public:
@@ -105,6 +108,20 @@ public:
 private:
    // Define producer-specific functions
 
+   // Trigger emulation core, kept apart from the optional histogramming.
+   // Binary waveforms hold 0/1 per tick and are written with simple loops over contiguous buffers.
+   static size_t CountSteps(double start, double end, double step); //number of iterations of for (double i = start; i < end; i += step)
+   static size_t CountDownSteps(double span, double step); //number of iterations of for (double i = span; i > 0.; i -= step)
+   const std::string& PDType(size_t ch); //cached pdMap.pdType()
+   bool IsTriggerPMT(size_t ch); //whether the channel is one of fOpDetsToPlot
+   void Downsample(const std::vector<char>& wvf, std::vector<char>& wvf_down) const; //keep every 4th tick
+   void CombinePair(const std::vector<char>& wvf1, const std::vector<char>& wvf2, std::vector<char>& wvf_combine) const; //OR or AND of a PMT pair
+   void ApplyOverThresholdWidth(std::vector<char>& wvf) const; //extend every rising edge by fOVTHRWidth ticks, in one pass
+   void AddToPassedTrigger(const std::vector<char>& wvf); //mark the pair on during the trigger window in fPairsOn
+
+   // Optional histogramming
+   template<typename T>
+   void SaveHist(const std::string& name, const char* title, const std::vector<T>& content, double start, double end);
 
    // Define global variables
    int run;
@@ -127,10 +144,21 @@ private:
      84,85,86,87,88,89,90,91,92,93,94,95,114,115,116,117,118,119,138,139,140,141,142,143,144,145,146,147,148,149,
      162,163,164,165,166,167,168,169,170,171,172,173,192,193,194,195,196,197,216,217,218,219,220,221,222,223,224,225,226,227,
      240,241,242,243,244,245,246,247,248,249,250,251,270,271,272,273,274,275,294,295,296,297,298,299,300,301,302,303,304,305};
+   // binary waveform buffers, kept between events to reuse their memory
    std::vector<std::vector<char>> channel_bin_wvfs;
-   std::vector<char> wvf_bin_0;
    std::vector<char> paired;
    std::vector<std::vector<char>> unpaired_wvfs;
+   std::vector<char> wvf_bin_down;
+   std::vector<char> wvf_combine;
+   opdet::trigger::TickMask fPairsOn; //one bit per combined pair and trigger window tick, counted into passed_trigger
+   size_t fNCombined; //number of combined waveforms added to fPairsOn in this event
+
+   // lookups built once from the configuration
+   enum PairRole { kNotUsed, kUnpaired, kPaired };
+   std::vector<std::pair<PairRole, size_t>> fChannelRoles; //role and pair index, by index in channel_numbers
+   std::vector<size_t> fChannelIndex; //index in channel_numbers, by channel number
+   std::vector<std::string> fChannelTypes; //pdMap.pdType(), by channel number
+   std::vector<char> fChannelIsTriggerPMT; //whether pdType is in fOpDetsToPlot, by channel number
 
    // List parameters for the fcl file
    std::vector<double> fThreshold = {7960.0,7976.0}; //individual pmt threshold in ADC (set in fcl, passes if ADC is LESS THAN threshold), [coated, uncoated]
@@ -140,6 +168,7 @@ private:
    std::vector<int> fPair2 = {7,9,11,13,15,17,37,39,41,85,87,89,91,93,95,115,117,119,139,141,143,145,147,149,163,165,167,169,171,173,193,195,197,217,219,221,223,225,227,241,243,245,247,249,251,271,273,275,295,297}; //channel numbers for second set of paired pmts (set in fcl)
    std::vector<int> fUnpaired = {298,299,300,301,302,303,304,305};//channel numbers for unpired pmts (set in fcl)
    std::string fPairLogic;
+   bool fPairAND; //true for "AND" pair logic, false for "OR"
    double fWindowStart; //start time (in us) of trigger window (set in fcl, 0 for beam spill)
    double fWindowEnd; //end time (in us) of trigger window (set in fcl, 1.6 for beam spill)
    std::string fInputModuleName; //opdet waveform module name (set in fcl)
@@ -182,6 +211,140 @@ void pmtTriggerProducer::reconfigure(fhicl::ParameterSet const & p)
    fEvHists    = p.get<std::vector<int> >("EvHists");
    fVerbose = p.get<bool>("Verbose", true);
 
+   if (fPairLogic!="OR" && fPairLogic!="AND"){
+     throw art::Exception(art::errors::Configuration)
+       << "PairLogic must be \"OR\" or \"AND\", not \"" << fPairLogic << "\"\n";
+   }
+   fPairAND = (fPairLogic=="AND");
+
+   if (fPair2.size()!=fPair1.size()){std::cout<<"Pair lists mismatched sizes!"<<std::endl;}
+
+   // an unpaired channel takes precedence over Pair1, which takes precedence over Pair2;
+   // within a list the first occurrence of the channel is used
+   fChannelRoles.assign(channel_numbers.size(), {kNotUsed, 0});
+   for (size_t i_ch = 0; i_ch < channel_numbers.size(); i_ch++){
+     const int ch = channel_numbers[i_ch];
+     auto& role = fChannelRoles[i_ch];
+     if (std::find(fUnpaired.begin(), fUnpaired.end(), ch) != fUnpaired.end()){role = {kUnpaired, 0}; continue;}
+     auto ip1 = std::find(fPair1.begin(), fPair1.end(), ch);
+     if (ip1 != fPair1.end()){role = {kPaired, size_t(ip1 - fPair1.begin())}; continue;}
+     auto ip2 = std::find(fPair2.begin(), fPair2.end(), ch);
+     if (ip2 != fPair2.end() && size_t(ip2 - fPair2.begin()) < fPair1.size()){role = {kPaired, size_t(ip2 - fPair2.begin())};}
+   }
+
+   fChannelIndex.clear();
+   for (size_t i_ch = 0; i_ch < channel_numbers.size(); i_ch++){
+     const size_t ch = channel_numbers[i_ch];
+     if (ch >= fChannelIndex.size()){fChannelIndex.resize(ch+1, size_t(-1));}
+     if (fChannelIndex[ch] == size_t(-1)){fChannelIndex[ch] = i_ch;}
+   }
+
+   fChannelTypes.clear();
+   fChannelIsTriggerPMT.clear();
+
+   // each pair and each unpaired channel is combined at most once per event
+   size_t nUnpaired = 0;
+   for (auto const& role : fChannelRoles){if (role.first == kUnpaired){nUnpaired++;}}
+   fPairsOn.Reset(fPair1.size() + nUnpaired);
+
+   channel_bin_wvfs.resize(channel_numbers.size());
+   unpaired_wvfs.resize(fPair1.size());
+}
+
+size_t pmtTriggerProducer::CountSteps(double start, double end, double step)
+{
+   // the number of bins is defined by this floating point loop, so it is replicated exactly
+   size_t n = 0;
+   for (double i = start; i<end; i+=step){n++;}
+   return n;
+}
+
+size_t pmtTriggerProducer::CountDownSteps(double span, double step)
+{
+   size_t n = 0;
+   for (double i = span; i>0.; i-=step){n++;}
+   return n;
+}
+
+const std::string& pmtTriggerProducer::PDType(size_t ch)
+{
+   if (ch >= fChannelTypes.size()){
+     const size_t first = fChannelTypes.size();
+     fChannelTypes.resize(ch+1);
+     fChannelIsTriggerPMT.resize(ch+1);
+     for (size_t i = first; i <= ch; i++){
+       fChannelTypes[i] = (i < pdMap.size()) ? pdMap.pdType(i) : std::string();
+       fChannelIsTriggerPMT[i] = std::find(fOpDetsToPlot.begin(), fOpDetsToPlot.end(), fChannelTypes[i]) != fOpDetsToPlot.end();
+     }
+   }
+   return fChannelTypes[ch];
+}
+
+bool pmtTriggerProducer::IsTriggerPMT(size_t ch)
+{
+   PDType(ch);
+   return fChannelIsTriggerPMT[ch];
+}
+
+void pmtTriggerProducer::Downsample(const std::vector<char>& wvf, std::vector<char>& wvf_down) const
+{
+   //downscale binary waveform by 4
+   wvf_down.resize((wvf.size()+3)/4);
+   const char* in = wvf.data();
+   char* out = wvf_down.data();
+   for (size_t i = 0; i < wvf_down.size(); i++){out[i] = in[4*i];}
+}
+
+void pmtTriggerProducer::CombinePair(const std::vector<char>& wvf1, const std::vector<char>& wvf2, std::vector<char>& wvf_combine) const
+{
+   wvf_combine.resize(wvf2.size());
+   const size_t n = std::min(wvf1.size(), wvf2.size());
+   const char* in1 = wvf1.data();
+   const char* in2 = wvf2.data();
+   char* out = wvf_combine.data();
+   if (fPairAND){
+     for (size_t i = 0; i < n; i++){out[i] = in1[i] & in2[i];}
+     for (size_t i = n; i < wvf2.size(); i++){out[i] = 0;}
+   }else{
+     for (size_t i = 0; i < n; i++){out[i] = in1[i] | in2[i];}
+     for (size_t i = n; i < wvf2.size(); i++){out[i] = in2[i];}
+   }
+}
+
+void pmtTriggerProducer::ApplyOverThresholdWidth(std::vector<char>& wvf) const
+{
+   //implement over threshold trigger signal width
+   //(Every time the combined waveform transitions from 0 to 1, change the next fOVTHRWidth values to 1 (ex: fOVTHRWidth=11 -> 12 high -> 12*8=96 ns true) )
+   //Rising edges inside an extended region are not edges any more, and only edges at least fOVTHRWidth ticks before the end are extended.
+   const size_t width = fOVTHRWidth;
+   int remaining = 0; //ticks still to be set high by the last rising edge
+   for (size_t i = 1; i < wvf.size(); i++){
+     if (remaining > 0){wvf[i] = 1; remaining--;}
+     else if (i+width < wvf.size() && wvf[i]==1 && wvf[i-1]==0){remaining = fOVTHRWidth;}
+   }
+}
+
+void pmtTriggerProducer::AddToPassedTrigger(const std::vector<char>& wvf)
+{
+   //Combine the waveforms to get a 1D array of integers where the value corresponds to the number of pairs ON and the
+   //index corresponds to the tick in the waveform
+   double binspermus = wvf.size()/(fEndTime-fStartTime);
+   unsigned int startbin = std::floor(binspermus*(fWindowStart - fStartTime));
+   unsigned int endbin = std::ceil(binspermus*(fWindowEnd - fStartTime));
+   if (endbin > wvf.size() - 1){endbin = wvf.size() - 1;}
+   if (passed_trigger.size() < endbin-startbin){passed_trigger.resize(std::max<size_t>(passed_trigger.size(), endbin), 0);}
+   if (endbin <= startbin){return;}
+   fPairsOn.OrInput(fNCombined++, wvf.data() + startbin, endbin-startbin);
+}
+
+template<typename T>
+void pmtTriggerProducer::SaveHist(const std::string& name, const char* title, const std::vector<T>& content, double start, double end)
+{
+   TH1D *hist = tfs->make< TH1D >(name.c_str(), title, content.size(), start, end);
+   hist->GetXaxis()->SetTitle("t (#mus)");
+   for(unsigned int i = 0; i < content.size(); i++) {
+      hist->SetBinContent(i + 1, content[i]);
+   }
 }
 
 void pmtTriggerProducer::produce(art::Event & e)
@@ -204,35 +367,13 @@ void pmtTriggerProducer::produce(art::Event & e)
       std::cout << Form("Did not find any G4 photons from a producer: %s", "largeant") << std::endl;
    }
 
-  //  // example of usage for pdMap.getCollectionWithProperty()
-  //  //
-  //  // define a container
-  //  auto inBoxTwo = pdMap.getCollectionWithProperty("pds_box", 2);
-  //  // you can cout the whole json object
-  //  std::cout << "inBoxTwo:\t" << inBoxTwo << "\n";
-  //  // traverse its components in a loop
-  //  for (auto const &e: inBoxTwo) {
-  //    std::cout << e["pd_type"] << " " << e["channel"] << ' ' << "\n";
-  //  }
-
-   // // example of usage for pdMap.getCollectionFromCondition()
-   // // define a lambda function with the conditions
-   // auto subsetCondition = [](auto const& e)->bool
-   //   // modify conditions as you want in the curly braces below
-   //   {return e["pd_type"] == "pmt_uncoated" && e["tpc"] == 0;};
-   // // get the container that satisfies the conditions
-   // auto uncoatedsInTPC0 = pdMap.getCollectionFromCondition(subsetCondition);
-   // std::cout << "uncoatedsInTPC0.size():\t" << uncoatedsInTPC0.size() << "\n";
-   // for(auto const& e:uncoatedsInTPC0){
-   //   std::cout << "e:\t" << e << "\n";
-   // }
-
   // determine whether to this event should be plotted
    int i_ev = -1;
    auto iev = std::find(fEvHists.begin(), fEvHists.end(), fEvNumber);
    if (iev != fEvHists.end() && fSaveHists){
       i_ev = iev - fEvHists.begin();
    }
+   const bool saveHists = (i_ev!=-1 && i_ev<3);
 
    if (i_ev!=-1 && i_ev<4){if (fVerbose){std::cout << "Outputting Hists" << std::endl;}}
 
@@ -252,51 +393,31 @@ void pmtTriggerProducer::produce(art::Event & e)
    double fMaxEndTime = 1510.0;//in us
 
    for(auto const& wvf : (*waveHandle)) {
-     fChNumber = wvf.ChannelNumber();
-     opdetType = pdMap.pdType(fChNumber);
-     if (std::find(fOpDetsToPlot.begin(), fOpDetsToPlot.end(), opdetType) == fOpDetsToPlot.end()) {continue;}
+     if (!IsTriggerPMT(wvf.ChannelNumber())) {continue;}
      if (wvf.TimeStamp() < fMinStartTime){ fMinStartTime = wvf.TimeStamp(); }
      if ((double(wvf.size()) / fSampling + wvf.TimeStamp()) > fMaxEndTime){ fMaxEndTime = double(wvf.size()) / fSampling + wvf.TimeStamp();}
   }
   if (fVerbose){std::cout<<"MinStartTime: "<<fMinStartTime<<" MaxEndTime: "<<fMaxEndTime<<std::endl;}
 
-   wvf_bin_0.reserve(int((fMaxEndTime-fMinStartTime)/(1./fSampling)));
-   channel_bin_wvfs.reserve(120);
-   paired.reserve(fPair1.size());
-   unpaired_wvfs.reserve(fPair1.size());
-   passed_trigger.reserve(int((fWindowEnd-fWindowStart)/(4./fSampling)));
-
   // create a vector w/ the number of entries necessary for the sampling rate
   // e.g. if sampling rate is 500 MHz, each bin has width of 0.002 us or 2 ns, vector length of ~75000
-   for (double i = fMinStartTime; i<fMaxEndTime+(1./fSampling); i+=(1./fSampling)){
-      wvf_bin_0.push_back(0);
-   }
-   for (size_t i = 0; i<120; i++){
-      channel_bin_wvfs.push_back(wvf_bin_0);
-   }
-   for (size_t i = 0; i<fPair1.size(); i++){
-      paired.push_back(0);
-   }
-   for (size_t i = 0; i<fPair1.size(); i++){
-      unpaired_wvfs.push_back(wvf_bin_0);
+   const size_t wvf_bin_size = CountSteps(fMinStartTime, fMaxEndTime+(1./fSampling), (1./fSampling));
+   for (auto& channel_wvf : channel_bin_wvfs){
+      channel_wvf.assign(wvf_bin_size, 0);
    }
+   paired.assign(fPair1.size(), 0);
+   fPairsOn.Reset(fPairsOn.NInputs());
+   fNCombined = 0;
   // window of the beam spill, 0.0 to 1.6 us
   // e.g. if sampling rate is 500 MHz, each bin has width of 0.008 us or 8 ns
-   for (double i = fWindowStart; i<fWindowEnd+(4./fSampling); i+=(4./fSampling)){
-      passed_trigger.push_back(0);
-   }
+   passed_trigger.assign(CountSteps(fWindowStart, fWindowEnd+(4./fSampling), (4./fSampling)), 0);
 
-
-   if (fPair2.size()!=paired.size()){std::cout<<"Pair lists mismatched sizes!"<<std::endl;}
-
-   size_t wvf_id = -1;
    int hist_id = -1;
    for(auto const& wvf : (*waveHandle)) {
-      wvf_id++;
       hist_id++;
       fChNumber = wvf.ChannelNumber();
-      opdetType = pdMap.pdType(fChNumber);
-      if (std::find(fOpDetsToPlot.begin(), fOpDetsToPlot.end(), opdetType) == fOpDetsToPlot.end()) {continue;}
+      if (!IsTriggerPMT(fChNumber)) {continue;}
+      opdetType = PDType(fChNumber);
       num_pmt_wvf++;
 
       fStartTime = wvf.TimeStamp(); //in us
@@ -318,151 +439,78 @@ void pmtTriggerProducer::produce(art::Event & e)
     }
     // if(fVerbose){std::cout<<"Channel "<<fChNumber<<" is "<<opdetType<<" and is using theshold "<<adc_threshold<<" ADC."<<std::endl;}
 
-      //create binary waveform
-      std::vector<char> wvf_bin;
-      wvf_bin.reserve(wvf.size());
       // start histo
-      if (i_ev!=-1 && i_ev<3){
+      if (saveHists){
          histname.str(std::string());
          histname << "event_" << fEvNumber
                  << "_opchannel_" << fChNumber
                  << "_" << opdetType
                  << "_" << hist_id
                  << "_raw";
-         //Create a new histogram for binary waveform
-         TH1D *wvfHist = tfs->make< TH1D >(histname.str().c_str(), "Raw Waveform", wvf.size(), fStartTime, fEndTime);
-         wvfHist->GetXaxis()->SetTitle("t (#mus)");
-         for(unsigned int i = 0; i < wvf.size(); i++) {
-            wvfHist->SetBinContent(i + 1, (double)wvf[i]);
-         }
+         SaveHist(histname.str(), "Raw Waveform", wvf, fStartTime, fEndTime);
       } // end histo
 
-      if (fStartTime > fMinStartTime){
-         for (double i = fStartTime-fMinStartTime; i>0.; i-=(1./fSampling)){
-            wvf_bin.push_back(0);
-         }
-      }
-
-      for(unsigned int i = 0; i < wvf.size(); i++) {
-         if((double)wvf[i]<adc_threshold){wvf_bin.push_back(1);}else{wvf_bin.push_back(0);}
-      }
-
-      if (fEndTime < fMaxEndTime){
-         for (double i = fMaxEndTime-fEndTime; i>0.; i-=(1./fSampling)){
-            wvf_bin.push_back(0);
-         }
-      }
+      //place the binary waveform (1 = below threshold) on the common time axis
+      const size_t pad_front = (fStartTime > fMinStartTime) ? CountDownSteps(fStartTime-fMinStartTime, (1./fSampling)) : 0;
+      const size_t pad_back = (fEndTime < fMaxEndTime) ? CountDownSteps(fMaxEndTime-fEndTime, (1./fSampling)) : 0;
+      const size_t bin_size = pad_front + wvf.size() + pad_back;
 
        //combine wavform with any other waveforms from same channel
-      int i_ch = -1.;
-      auto ich = std::find(channel_numbers.begin(), channel_numbers.end(), fChNumber);
-      if (ich != channel_numbers.end()){
-         i_ch = ich - channel_numbers.begin(); // the index for the channel of interest
-      }
+      const size_t i_ch = (fChNumber < fChannelIndex.size()) ? fChannelIndex[fChNumber] : size_t(-1);
+      std::vector<char>& channel_wvf = channel_bin_wvfs.at(i_ch);
       // if the number of bins is mismatched
-      if (channel_bin_wvfs.at(i_ch).size() < wvf_bin.size()){
-	       std::cout<<"Previous Channel" << fChNumber <<" Size: "<<channel_bin_wvfs.at(i_ch).size()<<"New Channel" << fChNumber <<" Size: "<<wvf_bin.size()<<std::endl;
-         for(unsigned int i = channel_bin_wvfs.at(i_ch).size(); i < wvf_bin.size(); i++) {
-            channel_bin_wvfs.at(i_ch).push_back(0);
-         }
-      }
-      for(unsigned int i = 0; i < wvf_bin.size(); i++) {
-         if(channel_bin_wvfs.at(i_ch).at(i)==1 || wvf_bin[i]==1){channel_bin_wvfs.at(i_ch)[i]=1;}else{channel_bin_wvfs.at(i_ch)[i]=0;}
+      if (channel_wvf.size() < bin_size){
+	       std::cout<<"Previous Channel" << fChNumber <<" Size: "<<channel_wvf.size()<<"New Channel" << fChNumber <<" Size: "<<bin_size<<std::endl;
+         channel_wvf.resize(bin_size, 0);
       }
-      wvf_bin.clear();
-      wvf_bin.shrink_to_fit();
-      waveHandle.clear();
+      opdet::trigger::OrBelowThreshold(wvf.data(), wvf.size(), opdet::trigger::BelowThresholdCut(adc_threshold), channel_wvf.data() + pad_front);
 
    }//wave handle loop
 
-     int wvf_num = -1;
-
-     for (auto wvf_bin : channel_bin_wvfs){ // wvf_bin is a vector with entries making up the wvf, one for every channel
-       wvf_num++;
+     for (size_t wvf_num = 0; wvf_num < channel_bin_wvfs.size(); wvf_num++){ // entries making up the wvf, one for every channel
+       const std::vector<char>& wvf_bin = channel_bin_wvfs[wvf_num];
        fChNumber = channel_numbers.at(wvf_num);
        fStartTime = fMinStartTime;
        fEndTime = fMaxEndTime;
 
-       //downscale binary waveform by 4
-       std::vector<char> wvf_bin_down;
-       wvf_bin_down.reserve(int(wvf_bin.size()/4));
-       for(unsigned int i = 0; i < wvf_bin.size(); i++) {
-         if(i%4==0){wvf_bin_down.push_back(wvf_bin[i]);}
-       }
+       Downsample(wvf_bin, wvf_bin_down);
 
        num_pmt_ch++;
 
-      if (i_ev!=-1 && i_ev<3){
+      if (saveHists){
        histname2.str(std::string());
        histname2 << "event_" << fEvNumber
                 << "_opchannel_" << fChNumber
                 << "_binary";
-       TH1D *wvfbHist = tfs->make< TH1D >(histname2.str().c_str(), "Binary Waveform", wvf_bin.size(), fStartTime, fEndTime);
-       wvfbHist->GetXaxis()->SetTitle("t (#mus)");
-       for(unsigned int i = 0; i < wvf_bin.size(); i++) {
-         wvfbHist->SetBinContent(i + 1, wvf_bin[i]);
-       }
-     }
+       SaveHist(histname2.str(), "Binary Waveform", wvf_bin, fStartTime, fEndTime);
 
-     if (i_ev!=-1 && i_ev<3){
        histname2.str(std::string());
        histname2 << "event_" << fEvNumber
                 << "_opchannel_" << fChNumber
                 << "_binary_down";
-
-       TH1D *wvfbdHist = tfs->make< TH1D >(histname2.str().c_str(), "Downsampled Binary Waveform", wvf_bin_down.size(), fStartTime, fEndTime);
-       wvfbdHist->GetXaxis()->SetTitle("t (#mus)");
-       for(unsigned int i = 0; i < wvf_bin_down.size(); i++) {
-         wvfbdHist->SetBinContent(i + 1, wvf_bin_down[i]);
-       }
+       SaveHist(histname2.str(), "Downsampled Binary Waveform", wvf_bin_down, fStartTime, fEndTime);
      }
 
+       const auto [role, pair_num] = fChannelRoles[wvf_num];
+       const bool unpaired = (role == kUnpaired);
        bool combine = false;
-       bool found = false;
-       bool unpaired = false;
-       size_t pair_num = -1;
-
-       for (size_t i = 0; i < fUnpaired.size(); i++){
-         if (fUnpaired.at(i) == (int)fChNumber){found=true; unpaired=true;}
-       }
 
-       if (!found){
-         // if a pmt is found in pair1 vector and has passed threshold (for some reason)
-         // set found == true, set pair_num = index of location in Pair1
-         for (size_t i = 0; i < fPair1.size(); i++){
-           if (fPair1.at(i) == (int)fChNumber && paired.at(i)==1){found=true; pair_num=i; combine=true; break;}
-            // else if pmt is found in pair1 vector and has not yet passed threshold,
-            // set found == true, set the corresponding channel's wvf equal to downscaled wvf in the unpaired vector
-            // should be paired now
-           else if (fPair1.at(i) == (int)fChNumber && paired.at(i)==0){found=true; unpaired_wvfs.at(i)=wvf_bin_down; paired.at(i)=1; break;}
-         }
-         if (!found){
-         // if still not found in pair1, check pair2 channels
-           for (size_t i = 0; i < fPair2.size(); i++){
-             if (fPair2.at(i) == (int)fChNumber && paired.at(i)==1){found=true; pair_num=i; combine=true; break;}
-             else if (fPair2.at(i) == (int)fChNumber && paired.at(i)==0){found=true; unpaired_wvfs.at(i)=wvf_bin_down; paired.at(i)=1; break;}
-           }
-         }
+       if (role == kPaired){
+         // the first pmt of a pair waits for the second one
+         if (paired[pair_num]==1){combine=true;}
+         else {unpaired_wvfs[pair_num] = wvf_bin_down; paired[pair_num]=1;}
        }
 
        //pair waveforms
        if (combine || unpaired){
-         std::vector<char> wvf_combine;
-         wvf_combine.reserve(wvf_bin_down.size());
          if (combine){
-           if (unpaired_wvfs.at(pair_num).size()!=wvf_bin_down.size()){std::cout<<"Mismatched paired waveform size"<<std::endl;}
-           for(unsigned int i = 0; i < wvf_bin_down.size(); i++) {
-            if (fPairLogic=="OR"){
-              if(unpaired_wvfs.at(pair_num)[i]==1 || wvf_bin_down[i]==1){wvf_combine.push_back(1);}else{wvf_combine.push_back(0);}
-            }else if (fPairLogic=="AND"){
-              if(unpaired_wvfs.at(pair_num)[i]==1 && wvf_bin_down[i]==1){wvf_combine.push_back(1);}else{wvf_combine.push_back(0);}
-            }
-           }
-         }else if(unpaired){
+           if (unpaired_wvfs[pair_num].size()!=wvf_bin_down.size()){std::cout<<"Mismatched paired waveform size"<<std::endl;}
+           CombinePair(unpaired_wvfs[pair_num], wvf_bin_down, wvf_combine);
+         }else{
            wvf_combine = wvf_bin_down;
          }
 
-      if (i_ev!=-1 && i_ev<3){
+      if (saveHists){
        histname2.str(std::string());
        if (unpaired){
          histname2 << "event_" << fEvNumber
@@ -475,25 +523,12 @@ void pmtTriggerProducer::produce(art::Event & e)
                   << "_" << fPair2.at(pair_num)
                   << "_combined";
        }
-
-       TH1D *wvfcHist = tfs->make< TH1D >(histname2.str().c_str(), "Paired Waveform", wvf_combine.size(), fStartTime, fEndTime);
-       wvfcHist->GetXaxis()->SetTitle("t (#mus)");
-       for(unsigned int i = 0; i < wvf_combine.size(); i++) {
-         wvfcHist->SetBinContent(i + 1, wvf_combine[i]);
-       }
+       SaveHist(histname2.str(), "Paired Waveform", wvf_combine, fStartTime, fEndTime);
      }
 
-       //implement over threshold trigger signal width
-       //(Every time the combined waveform transitions from 0 to 1, change the next fOVTHRWidth values to 1 (ex: fOVTHRWidth=11 -> 12 high -> 12*8=96 ns true) )
-       for(unsigned int i = 1; i < wvf_combine.size()-fOVTHRWidth; i++) {
-         if(wvf_combine[i]==1 && wvf_combine[i-1]==0){
-           for(unsigned int j = i+1; j < i+fOVTHRWidth+1; j++){
-             wvf_combine[j] = 1;
-           }
-           }
-       }
+       ApplyOverThresholdWidth(wvf_combine);
 
-      if (i_ev!=-1 && i_ev<3){
+      if (saveHists){
        histname2.str(std::string());
        if (unpaired){
          histname2 << "event_" << fEvNumber
@@ -506,52 +541,23 @@ void pmtTriggerProducer::produce(art::Event & e)
                   << "_" << fPair2.at(pair_num)
                   << "_combined_width";
        }
-
-       TH1D *wvfcwHist = tfs->make< TH1D >(histname2.str().c_str(), "Over Threshold Paired Waveform", wvf_combine.size(), fStartTime, fEndTime);
-       wvfcwHist->GetXaxis()->SetTitle("t (#mus)");
-       for(unsigned int i = 0; i < wvf_combine.size(); i++) {
-         wvfcwHist->SetBinContent(i + 1, wvf_combine[i]);
-       }
+       SaveHist(histname2.str(), "Over Threshold Paired Waveform", wvf_combine, fStartTime, fEndTime);
      }
 
-       //Combine the waveforms to get a 1D array of integers where the value corresponds to the number of pairs ON and the
-       //index corresponds to the tick in the waveform
-       double binspermus = wvf_combine.size()/(fEndTime-fStartTime);
-       unsigned int startbin = std::floor(binspermus*(fWindowStart - fStartTime));
-       unsigned int endbin = std::ceil(binspermus*(fWindowEnd - fStartTime));
-       if (startbin<0.){startbin=0;}
-       if (endbin > wvf_combine.size() - 1){endbin = wvf_combine.size() - 1;}
-       if (passed_trigger.size() < endbin-startbin){
-         for (unsigned int i = passed_trigger.size(); i<endbin; i++){
-           passed_trigger.push_back(0);
-         }
-       }
-       unsigned int i_p = 0;
-       for(unsigned int i = startbin; i<endbin; i++){
-         if (wvf_combine.at(i)==1){passed_trigger.at(i_p)++;}
-         i_p++;
-       }
-
-       wvf_bin_down.clear();
-       wvf_bin_down.shrink_to_fit();
-       wvf_combine.clear();
-       wvf_combine.shrink_to_fit();
-
+       AddToPassedTrigger(wvf_combine);
      }
 
    }
 
 
-  if (i_ev!=-1 && i_ev<3){
+  // number of pairs on at each tick of the trigger window
+  fPairsOn.AddCounts(passed_trigger.data(), passed_trigger.size());
+
+  if (saveHists){
    histname.str(std::string());
    histname << "event_" << fEvNumber
             << "_passed_trigger";
-
-   TH1D *passedHist = tfs->make< TH1D >(histname.str().c_str(), "Number of PMTs Passing Trigger During Beam", passed_trigger.size(), fWindowStart, fWindowEnd+(4./fSampling));
-   passedHist->GetXaxis()->SetTitle("t (#mus)");
-   for(unsigned int i = 0; i < passed_trigger.size(); i++) {
-     passedHist->SetBinContent(i + 1, passed_trigger[i]);
-   }
+   SaveHist(histname.str(), "Number of PMTs Passing Trigger During Beam", passed_trigger, fWindowStart, fWindowEnd+(4./fSampling));
  }
 
   sbnd::comm::pmtTrigger pmt_time;
@@ -566,31 +572,14 @@ void pmtTriggerProducer::produce(art::Event & e)
    if (fVerbose){std::cout << "Length of passed trigger: "  << pmt_time.numPassed.size() << std::endl;}
    if (fVerbose){std::cout << "Max number of PMTs passed: " << pmt_time.maxPMTs << std::endl;}
 
-   // the following lines "push" the relevant products you want to produce
-   // EXAMPLE:
-   // evt.put(std::move(muon_tracks));
-   // evt.put(std::move(muon_tracks_assn));
-
    e.put(std::move(pmts_passed));
 
-   //clear variables
-   passed_trigger.clear();
-   passed_trigger.shrink_to_fit();
+   //clear variables, the buffers keep their memory for the next event
    max_passed = 0;
 
    if (fVerbose){std::cout << "Number of PMT waveforms: " << num_pmt_wvf << std::endl;}
    if (fVerbose){std::cout << "Number of PMT channels: " << num_pmt_ch << std::endl;}
 
-   channel_bin_wvfs.clear();
-   channel_bin_wvfs.shrink_to_fit();
-   paired.clear();
-   paired.shrink_to_fit();
-   unpaired_wvfs.clear();
-   unpaired_wvfs.shrink_to_fit();
-
-   wvf_bin_0.clear();
-   wvf_bin_0.shrink_to_fit();
-
 } // pmtTriggerProducer::produce()
 
 // A macro required for a JobControl module.
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   AsyncTreeWriter.h
+///
+/// \brief  Fills a TTree on a background thread, so that compressing and
+///         writing its baskets overlaps the processing of the next event.
+///
+/// An analyzer fills its branch variables for an event and then hands the
+/// row to the writer. The writer waits for the previous row to be written,
+/// takes the new one over, and returns; the tree is filled on the writer
+/// thread while the analyzer goes on to the next event. There are thus two
+/// rows in flight: the one being built and the one being written.
+///
+/// Rows can be handed over in two ways:
+///
+///  * branch by branch: the branches are made through Branch() instead of
+///    TTree::Branch(), with the addresses of the analyzer variables. When
+///    asynchronous, each branch is given a second copy of its variable,
+///    which Fill() assigns from the analyzer one (a std::vector keeps its
+///    capacity, so this allocates nothing after the first events) before
+///    filling the tree from the copies;
+///  * as a whole: Submit() runs a job, usually pointing the branches to one
+///    of two data structures swapped by the analyzer, then TTree::Fill().
+///
+/// Submit() alone needs no tree: Setup(nullptr, async) gives a writer
+/// thread for other output (see ColumnarWriter).
+///
+/// When not asynchronous, Branch() makes a plain branch on the analyzer
+/// variable and Fill() and Submit() run on the calling thread: the tree is
+/// the same either way.
+///
+/// The writer thread writes into the file of the tree, so nothing else may
+/// write into that file while a row is being written: call Wait() before
+/// filling another tree of the same file, and Finish() in endJob(), before
+/// TFileService closes it. Other modules writing trees into the same
+/// TFileService file during the event loop make the asynchronous mode unsafe.
+///
+/// EnableImplicitMT() also lets ROOT compress the baskets of the tree with
+/// its implicit multithreading, which this enables for the whole process.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_ASYNCTREEWRITER_H
+#define SBNDCODE_UTILITIES_ASYNCTREEWRITER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "TROOT.h"
+#include "TTree.h"
+
+namespace sbnd {
+
+  class AsyncTreeWriter {
+  public:
+
+    AsyncTreeWriter() = default;
+    AsyncTreeWriter(AsyncTreeWriter const&) = delete;
+    AsyncTreeWriter& operator=(AsyncTreeWriter const&) = delete;
+    ~AsyncTreeWriter() { try { Finish(); } catch (...) {} }
+
+    /// Writes the rows of tree, on a background thread if async.
+    void Setup(TTree* tree, bool async)
+    {
+      fTree = tree;
+      if (async && !fThread.joinable()) fThread = std::thread([this] { Loop(); });
+    }
+
+    bool Async() const { return fThread.joinable(); }
+    TTree* Tree() const { return fTree; }
+
+    /// Compresses the baskets of the tree with ROOT implicit multithreading
+    /// on nThreads threads (0: ROOT default), unless it is already enabled.
+    void EnableImplicitMT(unsigned int nThreads)
+    {
+      if (!ROOT::IsImplicitMTEnabled()) ROOT::EnableImplicitMT(nThreads);
+      fTree->SetImplicitMT(true);
+    }
+
+    /// Branch on the variable at address, or on its copy when asynchronous.
+    template <typename T>
+    TBranch* Branch(char const* name, T* address, char const* leaflist)
+      { return fTree->Branch(name, RowAddress(address), leaflist); }
+    template <typename T>
+    TBranch* Branch(char const* name, T* address)
+      { return fTree->Branch(name, RowAddress(address)); }
+
+    /// Writes the current values of the Branch() variables as a row.
+    void Fill()
+    {
+      if (!Async()) { fTree->Fill(); return; }
+      Wait();
+      for (auto const& row: fRows) row->Copy();
+      Submit([this] { fTree->Fill(); });
+    }
+
+    /// Runs job on the writer thread once the previous one is done.
+    void Submit(std::function<void()> job)
+    {
+      if (!Async()) { job(); return; }
+      Wait();
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fJob = std::move(job);
+      }
+      fCondition.notify_all();
+    }
+
+    /// Waits until the last row is written; rethrows its exception, if any.
+    void Wait()
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCondition.wait(lock, [this] { return !fJob; });
+      if (fError) std::rethrow_exception(std::exchange(fError, nullptr));
+    }
+
+    /// Writes the last row and stops the writer thread.
+    void Finish()
+    {
+      if (!fThread.joinable()) return;
+      {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fCondition.wait(lock, [this] { return !fJob; });
+        fStop = true;
+      }
+      fCondition.notify_all();
+      fThread.join();
+      if (fError) std::rethrow_exception(std::exchange(fError, nullptr));
+    }
+
+  private:
+
+    /// A branch variable of the analyzer and the copy the tree is filled from.
+    struct RowBase {
+      virtual ~RowBase() = default;
+      virtual void Copy() = 0;
+    };
+    template <typename T>
+    struct Row: RowBase {
+      explicit Row(T const* source): source(source) {}
+      void Copy() override { copy = *source; }
+      T const* source;
+      T copy{};
+    };
+    template <typename T, std::size_t N>
+    struct Row<T[N]>: RowBase {
+      explicit Row(T const (*source)[N]): source(source) {}
+      void Copy() override { std::copy(*source, *source + N, copy); }
+      T const (*source)[N];
+      T copy[N]{};
+    };
+
+    template <typename T>
+    T* RowAddress(T* address)
+    {
+      if (!Async()) return address;
+      auto row = std::make_unique<Row<T>>(address);
+      T* copy = &row->copy;
+      fRows.push_back(std::move(row));
+      return copy;
+    }
+
+    void Loop()
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (true) {
+        fCondition.wait(lock, [this] { return fJob || fStop; });
+        if (!fJob) return;
+        lock.unlock();
+        try { fJob(); }
+        catch (...) { lock.lock(); fError = std::current_exception(); lock.unlock(); }
+        lock.lock();
+        fJob = nullptr;
+        fCondition.notify_all();
+      }
+    }
+
+    TTree* fTree = nullptr;
+    std::vector<std::unique_ptr<RowBase>> fRows;
+
+    std::thread             fThread;
+    std::mutex              fMutex;
+    std::condition_variable fCondition;
+    std::function<void()>   fJob;   ///< row being written, empty when idle
+    bool                    fStop = false;
+    std::exception_ptr      fError;
+  };
+
+} // namespace sbnd
+
+#endif // SBNDCODE_UTILITIES_ASYNCTREEWRITER_H
@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////////////////////
+// BinnedModelFile.h
+//
+// Named one-dimensional binned arrays (filters, field responses, noise
+// spectra) in a flat binary file, memory-mapped read-only when read so
+// that all the jobs on a node share its pages, instead of each job
+// opening a ROOT file and copying the histograms.
+//
+// A service reads the arrays from the flat file when it is there and was
+// made from the same input; otherwise it reads its ROOT histograms as
+// before, adds them here with add() and writes the file for the next jobs
+// (through a temporary file, so a concurrent reader never sees a partial
+// one). The file holds a checksum of the input it was made from; a
+// missing, stale or damaged file is reported as not read.
+//
+// Layout (native byte order):
+//   "SBNDBMDL", uint32 version, uint32 number of arrays,
+//   uint64 input checksum, uint64 payload checksum, then for each array
+//   a 64-byte name (NUL padded), uint64 number of bins, double low edge,
+//   double high edge; then the payload: the nbins + 2 bin contents of each
+//   array (underflow, bins, overflow, as TH1), array after array.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_BINNEDMODELFILE_H
+#define SBNDCODE_UTILITIES_BINNEDMODELFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sbnd {
+
+  class BinnedModelFile {
+
+  public:
+
+    // One array, with the binning and bin numbering of a TH1
+    struct Binned {
+      std::string   name;
+      int           nbins = 0;
+      double        low = 0.;
+      double        high = 0.;
+      double const* contents = nullptr; ///< nbins + 2 values, underflow first
+
+      int GetNbinsX() const { return nbins; }
+      // out of range bins are the underflow and overflow, as in TH1
+      double GetBinContent(int bin) const
+        { return contents[bin < 0 ? 0 : bin > nbins + 1 ? nbins + 1 : bin]; }
+      double GetBinLowEdge(int bin) const { return low + (bin - 1)*(high - low)/nbins; }
+    };
+
+    BinnedModelFile() = default;
+    BinnedModelFile(BinnedModelFile const&) = delete;
+    BinnedModelFile& operator=(BinnedModelFile const&) = delete;
+    ~BinnedModelFile() { clear(); }
+
+    bool empty() const { return fArrays.empty(); }
+
+    // Drops all the arrays
+    void clear() {
+      if (fMapped) ::munmap(fMapped, fMappedSize);
+      fMapped = nullptr;
+      fMappedSize = 0;
+      fArrays.clear();
+      fOwned.clear();
+    }
+
+    // The array called name, or nullptr
+    Binned const* find(std::string const& name) const {
+      for (Binned const& array: fArrays) if (array.name == name) return &array;
+      return nullptr;
+    }
+
+    // Adds a copy of the nbins + 2 contents of an array (e.g. from a TH1)
+    void add(std::string const& name, int nbins, double low, double high, double const* contents) {
+      fOwned.push_back(std::make_unique<std::vector<double>>(contents, contents + nbins + 2));
+      fArrays.push_back({name, nbins, low, high, fOwned.back()->data()});
+    }
+
+    // Checksum of the strings describing the input (file names, histogram
+    // names, modification times...)
+    static std::uint64_t checksum(std::initializer_list<std::string> values) {
+      std::uint64_t hash = 0xcbf29ce484222325ULL;
+      for (std::string const& value: values) {
+        hash = fnv1a(value.data(), value.size() + 1, hash); // with the NUL, as a separator
+      }
+      return hash;
+    }
+
+    // Size and modification time of a file, for the input checksum
+    static std::string fileStamp(std::string const& path) {
+      struct stat st;
+      if (::stat(path.c_str(), &st) != 0) return path;
+      return path + ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime);
+    }
+
+    // Maps the file at path; false if it is not there, not readable, made
+    // from another input or damaged.
+    bool read(std::string const& path, std::uint64_t inputChecksum);
+
+    // Writes the arrays to path; false on failure.
+    bool write(std::string const& path, std::uint64_t inputChecksum) const;
+
+  private:
+
+    static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'B', 'M', 'D', 'L' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kNameSize = 64;
+    static constexpr std::size_t kHeaderSize = sizeof(kMagic) + 2*sizeof(std::uint32_t) + 2*sizeof(std::uint64_t);
+    static constexpr std::size_t kEntrySize = kNameSize + sizeof(std::uint64_t) + 2*sizeof(double);
+
+    // 64-bit FNV-1a hash
+    static std::uint64_t fnv1a(char const* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ULL) {
+      for (std::size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    std::vector<Binned>                               fArrays;
+    std::vector<std::unique_ptr<std::vector<double>>> fOwned;       ///< storage of the added arrays
+    void*                                             fMapped = nullptr; ///< mapping of a file read
+    std::size_t                                       fMappedSize = 0;
+
+  };
+
+} // namespace sbnd
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::BinnedModelFile::read(std::string const& path, std::uint64_t inputChecksum) {
+
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || (std::size_t) st.st_size < kHeaderSize) {
+    ::close(fd);
+    return false;
+  }
+  std::size_t const fileSize = st.st_size;
+  void* const mapped = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) return false;
+
+  char const* const data = static_cast<char const*>(mapped);
+  std::uint32_t version = 0, nArrays = 0;
+  std::uint64_t cachedInput = 0, cachedPayload = 0;
+  char const* pos = data + sizeof(kMagic);
+  std::memcpy(&version, pos, sizeof(version));             pos += sizeof(version);
+  std::memcpy(&nArrays, pos, sizeof(nArrays));             pos += sizeof(nArrays);
+  std::memcpy(&cachedInput, pos, sizeof(cachedInput));     pos += sizeof(cachedInput);
+  std::memcpy(&cachedPayload, pos, sizeof(cachedPayload)); pos += sizeof(cachedPayload);
+
+  bool ok = std::memcmp(data, kMagic, sizeof(kMagic)) == 0
+    && version == kVersion
+    && cachedInput == inputChecksum
+    && fileSize >= kHeaderSize + nArrays*kEntrySize;
+
+  // the entries, then the contents, 8-byte aligned since the header and the
+  // entries are multiples of 8 bytes
+  std::vector<Binned> arrays;
+  std::size_t offset = kHeaderSize + nArrays*kEntrySize;
+  std::size_t const payloadStart = offset;
+  for (std::uint32_t i = 0; ok && i < nArrays; ++i) {
+    char const* entry = data + kHeaderSize + i*kEntrySize;
+    Binned array;
+    array.name.assign(entry, strnlen(entry, kNameSize));
+    std::uint64_t nbins = 0;
+    std::memcpy(&nbins, entry + kNameSize, sizeof(nbins));
+    std::memcpy(&array.low, entry + kNameSize + sizeof(nbins), sizeof(double));
+    std::memcpy(&array.high, entry + kNameSize + sizeof(nbins) + sizeof(double), sizeof(double));
+    std::size_t const size = (nbins + 2)*sizeof(double);
+    if (nbins == 0 || nbins > (std::uint64_t) fileSize || offset + size > fileSize) { ok = false; break; }
+    array.nbins = nbins;
+    array.contents = reinterpret_cast<double const*>(data + offset);
+    offset += size;
+    arrays.push_back(std::move(array));
+  }
+  ok = ok && offset == fileSize
+    && fnv1a(data + payloadStart, fileSize - payloadStart) == cachedPayload;
+
+  if (!ok) {
+    ::munmap(mapped, fileSize);
+    return false;
+  }
+
+  clear();
+  fMapped = mapped;
+  fMappedSize = fileSize;
+  fArrays = std::move(arrays);
+  return true;
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::BinnedModelFile::write(std::string const& path, std::uint64_t inputChecksum) const {
+
+  std::uint32_t const nArrays = fArrays.size();
+  std::uint64_t payloadChecksum = 0xcbf29ce484222325ULL;
+  for (Binned const& array: fArrays) {
+    payloadChecksum = fnv1a(reinterpret_cast<char const*>(array.contents), (array.nbins + 2)*sizeof(double), payloadChecksum);
+  }
+
+  std::string const tmpPath = path + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<char const*>(&nArrays), sizeof(nArrays));
+    out.write(reinterpret_cast<char const*>(&inputChecksum), sizeof(inputChecksum));
+    out.write(reinterpret_cast<char const*>(&payloadChecksum), sizeof(payloadChecksum));
+    for (Binned const& array: fArrays) {
+      char name[kNameSize] = {};
+      std::strncpy(name, array.name.c_str(), kNameSize - 1);
+      std::uint64_t const nbins = array.nbins;
+      out.write(name, kNameSize);
+      out.write(reinterpret_cast<char const*>(&nbins), sizeof(nbins));
+      out.write(reinterpret_cast<char const*>(&array.low), sizeof(array.low));
+      out.write(reinterpret_cast<char const*>(&array.high), sizeof(array.high));
+    }
+    for (Binned const& array: fArrays) {
+      out.write(reinterpret_cast<char const*>(array.contents), (array.nbins + 2)*sizeof(double));
+    }
+    if (!out) {
+      out.close();
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+#endif // SBNDCODE_UTILITIES_BINNEDMODELFILE_H
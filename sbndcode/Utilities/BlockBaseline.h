@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   BlockBaseline.h
+///
+/// \brief  Baseline of a waveform from the statistics of blocks of ticks.
+///
+/// The waveform is cut into blocks of a fixed number of ticks. A block
+/// whose variance is below a cut is taken as quiet, and its mean as the
+/// baseline at its centre. When more than half of the blocks are quiet,
+/// the baseline of the others is interpolated (or, at the two ends,
+/// extrapolated) from the quiet ones. The baseline of each tick is then
+/// the straight line through the centres of its block and of the one
+/// before it.
+///
+/// The block sums are accumulated in double precision over contiguous
+/// ticks, a loop the compiler vectorizes, and every index is a size_t,
+/// so waveforms of any length are fine. Ticks past the last full block
+/// follow the line of the last block.
+///
+/// The same estimator serves the baseline subtraction after the
+/// deconvolution (CalWireSBND) and the pedestal of the raw digits
+/// (SBNDTPCDecoder):
+///
+///   util::BlockBaseline baseline(blockSize, varianceCut);
+///   baseline.Subtract(holder);                     // float waveform
+///   baseline.Pedestal(adc, ped, rms);              // any arithmetic type
+///
+/// An instance keeps its buffers between calls and is meant to be owned
+/// by a single thread.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_BLOCKBASELINE_H
+#define SBNDCODE_UTILITIES_BLOCKBASELINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+  class BlockBaseline {
+  public:
+
+    BlockBaseline(std::size_t blockSize, double varianceCut)
+      : fBlockSize(blockSize), fVarianceCut(varianceCut) {}
+
+    std::size_t BlockSize() const { return fBlockSize; }
+    double VarianceCut() const { return fVarianceCut; }
+
+    /// Baseline at the centre of each block of data, as described above.
+    /// Returns the number of quiet blocks.
+    template <typename T>
+    std::size_t Estimate(std::vector<T> const& data);
+
+    /// Estimated baseline of each block (after Estimate()).
+    std::vector<float> const& Blocks() const { return fBase; }
+
+    /// Subtracts the interpolated baseline from every tick of data.
+    void Subtract(std::vector<float>& data);
+
+    /// Mean and RMS of the quiet blocks of data, left unchanged if there
+    /// is none. Returns the number of quiet blocks.
+    template <typename T>
+    std::size_t Pedestal(std::vector<T> const& data, float& mean, float& rms) const;
+
+  private:
+
+    std::size_t fBlockSize;
+    double      fVarianceCut;
+
+    std::vector<float>  fBase;  ///< baseline of each block
+    std::vector<char>   fQuiet; ///< whether the block passed the variance cut
+    std::vector<std::size_t> fNext; ///< next quiet block of each block
+
+    /// Mean and variance of the n ticks from block.
+    template <typename T>
+    static std::pair<double, double> BlockStats(T const* block, std::size_t n);
+
+    void FillGaps();
+  };
+
+} // namespace util
+
+//------------------------------------------------------------------------------
+template <typename T>
+std::pair<double, double> util::BlockBaseline::BlockStats(T const* block, std::size_t n)
+{
+  double sum = 0., sum2 = 0.;
+  for (std::size_t i = 0; i < n; ++i) {
+    double const x = block[i];
+    sum += x;
+    sum2 += x*x;
+  }
+  double const mean = sum / n;
+  return { mean, n > 1 ? (sum2 - n*mean*mean) / (n - 1.) : 0. };
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+std::size_t util::BlockBaseline::Estimate(std::vector<T> const& data)
+{
+  std::size_t const nBlocks = fBlockSize ? data.size() / fBlockSize : 0;
+  fBase.assign(nBlocks, 0.f);
+  fQuiet.assign(nBlocks, 0);
+
+  std::size_t nQuiet = 0;
+  for (std::size_t b = 0; b < nBlocks; ++b) {
+    auto const [mean, var] = BlockStats(data.data() + b*fBlockSize, fBlockSize);
+    if ( var < fVarianceCut ) {
+      fBase[b] = mean;
+      fQuiet[b] = 1;
+      ++nQuiet;
+    }
+  }
+
+  // the noisy blocks are filled in only if there are not too many
+  if ( nQuiet < nBlocks && nQuiet > nBlocks / 2 ) FillGaps();
+  return nQuiet;
+}
+
+//------------------------------------------------------------------------------
+inline void util::BlockBaseline::FillGaps()
+{
+  std::size_t const nBlocks = fBase.size();
+  std::size_t const last = nBlocks - 1;
+
+  // first block: extrapolated from the first two quiet ones
+  bool baseOK = true;
+  if ( !fQuiet[0] ) {
+    std::size_t b1 = 1;
+    while ( b1 < nBlocks && !fQuiet[b1] ) ++b1;
+    std::size_t b2 = b1 + 1;
+    while ( b2 < nBlocks && !fQuiet[b2] ) ++b2;
+    if ( b2 < nBlocks ) {
+      float const slp = (fBase[b2] - fBase[b1]) / (float)(b2 - b1);
+      fBase[0] = fBase[b1] - slp * b1;
+      fQuiet[0] = 1;
+    }
+    else baseOK = false;
+  }
+
+  // last block: extrapolated from the last two quiet ones after the first
+  if ( baseOK && !fQuiet[last] ) {
+    std::size_t b2 = last;
+    while ( b2 > 0 && !fQuiet[b2] ) --b2;
+    std::size_t b1 = b2 > 0 ? b2 - 1 : 0;
+    while ( b1 > 0 && !fQuiet[b1] ) --b1;
+    if ( b1 > 0 ) {
+      float const slp = (fBase[b2] - fBase[b1]) / (float)(b2 - b1);
+      fBase[last] = fBase[b2] + slp * (last - b2);
+      fQuiet[last] = 1;
+    }
+  }
+
+  // next quiet block of each block, nBlocks if none, in one backward pass
+  fNext.resize(nBlocks + 1);
+  fNext[nBlocks] = nBlocks;
+  for (std::size_t b = nBlocks; b-- > 0; )
+    fNext[b] = fQuiet[b] ? b : fNext[b + 1];
+
+  // the others: one step along the line from the block before to the next quiet one
+  for (std::size_t b = 1; b < last; ++b) {
+    if ( fQuiet[b] || fNext[b] == nBlocks ) continue;
+    std::size_t const next = fNext[b];
+    float const slp = (fBase[next] - fBase[b - 1]) / (next - b + 1);
+    fBase[b] = fBase[b - 1] + slp;
+  }
+}
+
+//------------------------------------------------------------------------------
+inline void util::BlockBaseline::Subtract(std::vector<float>& data)
+{
+  Estimate(data);
+  std::size_t const nBase = fBase.size();
+  if ( nBase == 0 ) return;
+
+  float const width = fBlockSize;
+  std::size_t const half = fBlockSize / 2;
+  std::size_t const size = data.size();
+  for (std::size_t b = 0; b < nBase; ++b) {
+    // the first block takes the line to the second one, and the
+    // ticks past the last full block the line of the last one
+    std::size_t const from = b == 0 ? 0 : b - 1;
+    std::size_t const to = b == 0 ? std::min<std::size_t>(1, nBase - 1) : b;
+    float const slp = (fBase[to] - fBase[from]) / width;
+    float const base = fBase[b];
+    double const centre = b * fBlockSize + half;
+    std::size_t const end = b + 1 == nBase ? size : (b + 1) * fBlockSize;
+    for (std::size_t tick = b * fBlockSize; tick < end; ++tick)
+      data[tick] -= base + float(tick - centre) * slp;
+  }
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+std::size_t util::BlockBaseline::Pedestal(std::vector<T> const& data, float& mean, float& rms) const
+{
+  std::size_t const nBlocks = fBlockSize ? data.size() / fBlockSize : 0;
+  double sumMean = 0., sumVar = 0.;
+  std::size_t nQuiet = 0;
+  for (std::size_t b = 0; b < nBlocks; ++b) {
+    auto const [blockMean, var] = BlockStats(data.data() + b*fBlockSize, fBlockSize);
+    if ( var >= fVarianceCut ) continue;
+    sumMean += blockMean;
+    sumVar += var;
+    ++nQuiet;
+  }
+  if ( nQuiet == 0 ) return 0;
+  mean = sumMean / nQuiet;
+  rms = std::sqrt(sumVar / nQuiet);
+  return nQuiet;
+}
+
+#endif // SBNDCODE_UTILITIES_BLOCKBASELINE_H
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   ChannelDescriptorTable.h
+///
+/// \brief  Per-run table of what the TPC modules need to know about
+///         each readout channel.
+///
+/// Build() asks the channel status provider and the geometry about every
+/// channel once, typically in beginRun(); the channel loops then read the
+/// table instead of calling the services for each channel. The pedestal
+/// and saturation levels are those of the signal type of the channel, as
+/// set by SetLevels() (zero otherwise).
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_CHANNELDESCRIPTORTABLE_H
+#define SBNDCODE_UTILITIES_CHANNELDESCRIPTORTABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcoreobj/SimpleTypesAndConstants/RawTypes.h"
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "larevt/CalibrationDBI/Interface/ChannelStatusProvider.h"
+
+namespace sbnd {
+
+  class ChannelDescriptorTable {
+  public:
+
+    struct Descriptor {
+      geo::SigType_t sigType = geo::kMysteryType;
+      geo::View_t    view = geo::kUnknown;
+      std::size_t    plane = 0;          ///< index of the view in per-plane tables (U, V, Z)
+      float          pedestal = 0.;      ///< nominal pedestal [ADC]
+      float          saturation = 0.;    ///< pre-amplifier saturation [ADC]
+    };
+
+    /// Refills the table for all the channels of the geometry.
+    void Build(geo::GeometryCore const& geom, lariov::ChannelStatusProvider const& status)
+    {
+      unsigned int const nchan = geom.Nchannels();
+      fDescriptors.assign(nchan, Descriptor{});
+      fGood.assign(nchan, false);
+      fGoodChannels.clear();
+      for (raw::ChannelID_t chan = 0; chan < nchan; ++chan) {
+        Descriptor& desc = fDescriptors[chan];
+        desc.sigType = geom.SignalType(chan);
+        geo::View_t const view = geom.View(chan);
+        desc.view = view;
+        desc.plane = (view == geo::kU) ? 0 : (view == geo::kV) ? 1 : 2;
+        if (status.IsBad(chan)) continue;
+        fGood[chan] = true;
+        fGoodChannels.push_back(chan);
+      }
+      ApplyLevels();
+    }
+
+    /// Pedestal and saturation of the collection and induction channels.
+    void SetLevels(float collectionPed, float collectionSat, float inductionPed, float inductionSat)
+    {
+      fCollectionPed = collectionPed;
+      fCollectionSat = collectionSat;
+      fInductionPed = inductionPed;
+      fInductionSat = inductionSat;
+      ApplyLevels();
+    }
+
+    std::size_t size() const { return fDescriptors.size(); }
+    bool IsGood(raw::ChannelID_t chan) const { return chan < fGood.size() && fGood[chan]; }
+    Descriptor const& operator[](raw::ChannelID_t chan) const { return fDescriptors[chan]; }
+
+    /// The channels that are not bad, in increasing order.
+    std::vector<raw::ChannelID_t> const& GoodChannels() const { return fGoodChannels; }
+
+  private:
+
+    void ApplyLevels()
+    {
+      for (Descriptor& desc : fDescriptors) {
+        bool const induction = (desc.sigType == geo::kInduction);
+        desc.pedestal = induction ? fInductionPed : fCollectionPed;
+        desc.saturation = induction ? fInductionSat : fCollectionSat;
+      }
+    }
+
+    std::vector<Descriptor>       fDescriptors;
+    std::vector<bool>             fGood;          ///< status bit of each channel
+    std::vector<raw::ChannelID_t> fGoodChannels;
+    float fCollectionPed = 0.;
+    float fCollectionSat = 0.;
+    float fInductionPed = 0.;
+    float fInductionSat = 0.;
+  };
+
+} // namespace sbnd
+
+#endif // SBNDCODE_UTILITIES_CHANNELDESCRIPTORTABLE_H
@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   ColumnarWriter.h
+///
+/// \brief  Writes typed columns of numbers in compressed chunks to a flat
+///         file, on a background thread.
+///
+/// The columns are declared with AddColumn() before Open(). The caller
+/// appends values to them and calls Flush() at a boundary that keeps the
+/// rows of different columns together (e.g. at the end of an event) when
+/// BufferedBytes() reaches the chunk size it wants. Flush() hands the
+/// buffered columns over to an AsyncTreeWriter job (without a tree), which
+/// compresses and writes them while the caller fills the next chunk. Close()
+/// writes the last chunk and closes the file; call it in endJob().
+///
+/// The format is meant to be read with plain numpy (np.frombuffer on the
+/// columns of each chunk), without ROOT or an HDF5/Arrow dependency.
+/// Layout (native byte order):
+///   header: "SBNDCOLS", uint32 version, uint32 number of columns, then for
+///           each column uint32 type (Type), uint32 name length, the name;
+///   chunks, until the end of the file: "SBNDCHNK", then for each column
+///           uint64 bytes of values, uint32 compression (0: raw, 1: ROOT
+///           zip blocks), uint64 stored bytes, the stored bytes.
+/// Compressed columns are a sequence of ROOT zip blocks of at most 16 MB
+/// each; with the ZLIB algorithm used here each block is a 9-byte header
+/// (bytes 3-5: compressed size, 6-8: original size, little endian) followed
+/// by a zlib stream, so `zlib.decompress(block[9:])` reads it.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_COLUMNARWRITER_H
+#define SBNDCODE_UTILITIES_COLUMNARWRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cetlib_except/exception.h"
+
+#include "Compression.h"
+#include "RZip.h"
+
+#include "sbndcode/Utilities/AsyncTreeWriter.h"
+
+namespace sbnd {
+
+  class ColumnarWriter {
+  public:
+
+    enum Type : std::uint32_t { kInt16 = 1, kInt32 = 2, kFloat32 = 3, kFloat64 = 4 };
+
+    ColumnarWriter() = default;
+    ColumnarWriter(ColumnarWriter const&) = delete;
+    ColumnarWriter& operator=(ColumnarWriter const&) = delete;
+    ~ColumnarWriter() { try { Close(); } catch (...) {} }
+
+    /// Declares a column, before Open(); returns its index for Append().
+    std::size_t AddColumn(std::string const& name, Type type)
+    {
+      fColumns.push_back({ name, type, {} });
+      return fColumns.size() - 1;
+    }
+
+    /// Creates the file and writes its header; compressionLevel 0 stores the
+    /// columns uncompressed; with async, the chunks are written on a
+    /// background thread.
+    void Open(std::string const& path, int compressionLevel, bool async);
+
+    bool IsOpen() const { return fOut != nullptr; }
+
+    /// Appends n values to column; their type must be the one of the column.
+    template <typename T>
+    void Append(std::size_t column, T const* values, std::size_t n)
+    {
+      Column& col = fColumns[column];
+      if (col.type != TypeOf<T>()) {
+        throw cet::exception("ColumnarWriter")
+          << "column '" << col.name << "' does not hold values of this type\n";
+      }
+      char const* const bytes = reinterpret_cast<char const*>(values);
+      col.data.insert(col.data.end(), bytes, bytes + n*sizeof(T));
+    }
+    template <typename T>
+    void Append(std::size_t column, T value) { Append(column, &value, 1); }
+
+    /// Bytes appended since the last chunk was handed over.
+    std::size_t BufferedBytes() const
+    {
+      std::size_t bytes = 0;
+      for (Column const& col: fColumns) bytes += col.data.size();
+      return bytes;
+    }
+
+    /// Writes the appended values as a chunk (nothing if there are none).
+    void Flush();
+
+    /// Writes the last chunk, waits for it and closes the file.
+    void Close()
+    {
+      if (!fOut) return;
+      Flush();
+      fWriter.Finish();
+      fOut->close();
+      bool const failed = fOut->fail();
+      fOut.reset();
+      if (failed) throw cet::exception("ColumnarWriter") << "failed writing the columns\n";
+    }
+
+  private:
+
+    struct Column {
+      std::string       name;
+      Type              type;
+      std::vector<char> data;
+    };
+
+    template <typename T>
+    static constexpr Type TypeOf()
+    {
+      if constexpr (std::is_same_v<T, std::int16_t>) return kInt16;
+      else if constexpr (std::is_same_v<T, std::int32_t>) return kInt32;
+      else if constexpr (std::is_same_v<T, float>) return kFloat32;
+      else {
+        static_assert(std::is_same_v<T, double>, "ColumnarWriter columns hold int16, int32, float or double");
+        return kFloat64;
+      }
+    }
+
+    static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'C', 'O', 'L', 'S' };
+    static constexpr char kChunkMagic[8] = { 'S', 'B', 'N', 'D', 'C', 'H', 'N', 'K' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kMaxBlock = 0xffffff; ///< largest input of a ROOT zip block
+    static constexpr std::size_t kBlockHeader = 9;     ///< ROOT zip block header size
+
+    /// Compresses data into ROOT zip blocks; false if it does not shrink.
+    static bool Compress(std::vector<char>& data, int level, std::vector<char>& zipped);
+
+    /// Writes one chunk; runs on the writer thread.
+    static void WriteChunk(std::ofstream& out, std::vector<std::vector<char>>& columns, int level);
+
+    std::vector<Column>            fColumns;
+    std::unique_ptr<std::ofstream> fOut;
+    int                            fLevel = 0;
+    AsyncTreeWriter                fWriter; ///< background thread, without a tree
+  };
+
+} // namespace sbnd
+
+//----------------------------------------------------------------------
+
+inline void sbnd::ColumnarWriter::Open(std::string const& path, int compressionLevel, bool async) {
+
+  fOut = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+  if (!*fOut) {
+    fOut.reset();
+    throw cet::exception("ColumnarWriter") << "cannot create '" << path << "'\n";
+  }
+  fLevel = std::clamp(compressionLevel, 0, 9);
+
+  std::uint32_t const nColumns = fColumns.size();
+  fOut->write(kMagic, sizeof(kMagic));
+  fOut->write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+  fOut->write(reinterpret_cast<char const*>(&nColumns), sizeof(nColumns));
+  for (Column const& col: fColumns) {
+    std::uint32_t const type = col.type, nameSize = col.name.size();
+    fOut->write(reinterpret_cast<char const*>(&type), sizeof(type));
+    fOut->write(reinterpret_cast<char const*>(&nameSize), sizeof(nameSize));
+    fOut->write(col.name.data(), nameSize);
+  }
+  fWriter.Setup(nullptr, async);
+}
+
+//----------------------------------------------------------------------
+
+inline void sbnd::ColumnarWriter::Flush() {
+
+  if (!fOut || BufferedBytes() == 0) return;
+
+  // the job takes the buffers over; the next chunk starts from empty ones
+  auto columns = std::make_shared<std::vector<std::vector<char>>>();
+  columns->reserve(fColumns.size());
+  for (Column& col: fColumns) columns->push_back(std::exchange(col.data, {}));
+  std::ofstream* const out = fOut.get();
+  int const level = fLevel;
+  fWriter.Submit([out, columns, level] { WriteChunk(*out, *columns, level); });
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::ColumnarWriter::Compress(std::vector<char>& data, int level, std::vector<char>& zipped) {
+
+  zipped.resize(data.size() + data.size()/kMaxBlock*kBlockHeader);
+  std::size_t stored = 0;
+  for (std::size_t start = 0; start < data.size(); start += kMaxBlock) {
+    int srcSize = std::min(kMaxBlock, data.size() - start);
+    int tgtSize = std::min<std::size_t>(zipped.size() - stored, kMaxBlock);
+    int written = 0;
+    if (tgtSize <= int(kBlockHeader)) return false;
+    R__zipMultipleAlgorithm(level, &srcSize, data.data() + start, &tgtSize, zipped.data() + stored,
+                            &written, ROOT::RCompressionSetting::EAlgorithm::kZLIB);
+    if (written == 0) return false; // did not fit, i.e. it does not compress
+    stored += written;
+  }
+  zipped.resize(stored);
+  return true;
+}
+
+inline void sbnd::ColumnarWriter::WriteChunk(std::ofstream& out, std::vector<std::vector<char>>& columns, int level) {
+
+  std::vector<char> zipped;
+  out.write(kChunkMagic, sizeof(kChunkMagic));
+  for (std::vector<char>& data: columns) {
+    std::uint64_t const nBytes = data.size();
+    bool const compressed = level > 0 && !data.empty() && Compress(data, level, zipped);
+    std::uint32_t const method = compressed ? 1 : 0;
+    std::vector<char> const& stored = compressed ? zipped : data;
+    std::uint64_t const storedBytes = stored.size();
+    out.write(reinterpret_cast<char const*>(&nBytes), sizeof(nBytes));
+    out.write(reinterpret_cast<char const*>(&method), sizeof(method));
+    out.write(reinterpret_cast<char const*>(&storedBytes), sizeof(storedBytes));
+    out.write(stored.data(), storedBytes);
+  }
+  if (!out) throw cet::exception("ColumnarWriter") << "failed writing a chunk\n";
+}
+
+#endif // SBNDCODE_UTILITIES_COLUMNARWRITER_H
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   DiagnosticHist.h
+///
+/// \brief  Monitoring histogram filled from many threads without locks.
+///
+/// Each thread fills its own copy of the bins; MergeInto() adds them all
+/// to a ROOT histogram of the same binning, typically once at the end of
+/// the job. A default constructed histogram is disabled and Fill() returns
+/// straight away, so that the diagnostics of a module can be switched off
+/// from FHiCL without touching its loops.
+///
+/// The bins follow the TAxis convention for fixed bins (0 is the
+/// underflow, nbins+1 the overflow). The merged histogram has the same
+/// contents and entries as direct unit-weight fills; its mean and RMS are
+/// computed from the bin contents.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_DIAGNOSTICHIST_H
+#define SBNDCODE_UTILITIES_DIAGNOSTICHIST_H
+
+#include <cstdint>
+#include <vector>
+
+#include "tbb/enumerable_thread_specific.h"
+
+#include "TH1.h"
+
+namespace sbnd::diag {
+
+  class DiagnosticHist {
+  public:
+
+    DiagnosticHist() = default;
+    DiagnosticHist(unsigned int nbins, double low, double high) { Reset(nbins, low, high); }
+
+    /// Sets the binning and drops the contents; `nbins` 0 disables the histogram.
+    void Reset(unsigned int nbins, double low, double high)
+    {
+      fNBins = nbins;
+      fLow = low;
+      fHigh = high;
+      fBins.clear();
+    }
+
+    bool Enabled() const { return fNBins > 0; }
+
+    void Fill(double x)
+    {
+      if (!Enabled()) return;
+      std::vector<std::uint64_t>& bins = fBins.local();
+      if (bins.empty()) bins.assign(fNBins + 2, 0);
+      ++bins[FindBin(x)];
+    }
+
+    /// Adds the contents of all the threads to `hist` and clears them.
+    void MergeInto(TH1& hist)
+    {
+      if (!Enabled()) return;
+      std::uint64_t entries = 0;
+      for (std::vector<std::uint64_t>& bins : fBins) {
+        for (unsigned int i = 0; i < bins.size(); ++i) {
+          if (bins[i] == 0) continue;
+          hist.SetBinContent(i, hist.GetBinContent(i) + bins[i]);
+          entries += bins[i];
+          bins[i] = 0;
+        }
+      }
+      hist.SetEntries(hist.GetEntries() + entries);
+    }
+
+  private:
+
+    unsigned int FindBin(double x) const
+    {
+      if (x < fLow) return 0;
+      if (!(x < fHigh)) return fNBins + 1;
+      return 1 + (unsigned int) (fNBins * (x - fLow) / (fHigh - fLow));
+    }
+
+    unsigned int fNBins = 0;
+    double       fLow = 0.;
+    double       fHigh = 0.;
+    tbb::enumerable_thread_specific<std::vector<std::uint64_t>> fBins; ///< per thread, with under/overflow
+  };
+
+} // namespace sbnd::diag
+
+#endif // SBNDCODE_UTILITIES_DIAGNOSTICHIST_H
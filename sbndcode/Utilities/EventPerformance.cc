@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   EventPerformance.cc
+///
+/// \brief  Occupancy counters of the module being run.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/EventPerformance.h"
+
+#include <algorithm>
+
+namespace sbnd::perf {
+
+  void Occupancy::Add(std::string const& name, std::uint64_t n)
+  {
+    auto it = std::find_if(fCounters.begin(), fCounters.end(),
+                           [&name](auto const& counter) { return counter.first == name; });
+    if (it == fCounters.end()) fCounters.emplace_back(name, n);
+    else it->second += n;
+  }
+
+  Occupancy*& CurrentOccupancy()
+  {
+    thread_local Occupancy* current = nullptr;
+    return current;
+  }
+
+} // namespace sbnd::perf
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   EventPerformance.h
+///
+/// \brief  Occupancy counters of the module being run, for the
+///         per-event performance record of EventPerformanceRecorder.
+///
+/// The EventPerformanceRecorder service records the wall time, CPU time
+/// and memory of each module on each event. Modules add the occupancy
+/// that explains them (channels with signal, photons, hits...) with
+///
+///   sbnd::perf::Count("ChannelsWithSignal", nChannels);
+///
+/// called from their produce() or filter(), on the thread art runs them
+/// on. The counter goes to the record of that module and event. Without
+/// the service in the job there is no record, and Count() does nothing.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_EVENTPERFORMANCE_H
+#define SBNDCODE_UTILITIES_EVENTPERFORMANCE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sbnd::perf {
+
+  /// Occupancy counters of one module on one event, in the order they were first added.
+  class Occupancy {
+  public:
+    void Add(std::string const& name, std::uint64_t n);
+    void Clear() { fCounters.clear(); }
+
+    std::vector<std::pair<std::string, std::uint64_t>> const& Counters() const { return fCounters; }
+
+  private:
+    std::vector<std::pair<std::string, std::uint64_t>> fCounters;
+  };
+
+  /// The counters of the module art is running on this thread; nullptr if it is not recorded.
+  Occupancy*& CurrentOccupancy();
+
+  /// Adds n to the counter `name` of the module running on this thread, if it is recorded.
+  inline void Count(std::string const& name, std::uint64_t n)
+  {
+    if (Occupancy* occupancy = CurrentOccupancy()) occupancy->Add(name, n);
+  }
+
+} // namespace sbnd::perf
+
+#endif // SBNDCODE_UTILITIES_EVENTPERFORMANCE_H
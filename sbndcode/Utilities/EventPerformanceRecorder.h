@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   EventPerformanceRecorder.h
+///
+/// \brief  Service recording, for each event and module, the time and
+///         memory the module took and the occupancy it worked on.
+///
+/// One entry of the tree "eventperformance" in the TFileService file is
+/// written per module and event, with:
+///
+///  run, subRun, event  - the event
+///  module, moduleType  - label and plugin type of the module
+///  wallTime            - wall time of the module on the event [ns]
+///  cpuTime             - CPU time of the process meanwhile [ns]
+///  rssDelta            - change of the resident memory [kB]
+///  peakRSSDelta        - rise of the peak resident memory [kB]
+///  counterNames,       - occupancy counters added by the module through
+///  counterValues         sbnd::perf::Count() (EventPerformance.h)
+///
+/// The CPU time and the memory are those of the whole process; they
+/// belong to the module only when one event is processed at a time, but
+/// they do include the threads the module hands work to.
+///
+/// FCL parameters:
+///
+/// ModuleLabels - Record only these modules; all of them if empty
+///                (default: empty).
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_EVENTPERFORMANCERECORDER_H
+#define SBNDCODE_UTILITIES_EVENTPERFORMANCERECORDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "art/Utilities/ScheduleID.h"
+#include "canvas/Persistency/Provenance/EventID.h"
+#include "sbndcode/Utilities/EventPerformance.h"
+
+#include "RtypesCore.h"
+
+class TTree;
+
+namespace art {
+  class Event;
+  class ModuleContext;
+  class ScheduleContext;
+}
+
+namespace sbnd {
+  class EventPerformanceRecorder {
+  public:
+
+    EventPerformanceRecorder(const fhicl::ParameterSet& pset,
+                             art::ActivityRegistry& reg);
+
+  private:
+
+    /// Module being run on an event, from preModule to postModule.
+    struct RunningModule {
+      std::chrono::steady_clock::time_point wallStart;
+      std::int64_t     cpuStart = 0;  ///< [ns]
+      std::int64_t     rssStart = 0;  ///< [kB]
+      std::int64_t     peakStart = 0; ///< [kB]
+      perf::Occupancy  occupancy;
+      perf::Occupancy* previous = nullptr; ///< counters of the thread before this module
+    };
+
+    using ModuleKey_t = std::pair<art::ScheduleID, std::string>;
+
+    void postBeginJob();
+    void preProcessEvent(art::Event const& e, art::ScheduleContext);
+    void postProcessEvent(art::Event const& e, art::ScheduleContext);
+    void preModule(art::ModuleContext const& mc);
+    void postModule(art::ModuleContext const& mc);
+
+    bool isRecorded(std::string const& label) const;
+
+    std::set<std::string> fModuleLabels;
+
+    TTree* fTree = nullptr;
+
+    mutable std::mutex fMutex; ///< guards all below, and the tree
+    std::map<art::ScheduleID, art::EventID> fEvents;
+    std::map<ModuleKey_t, RunningModule>    fRunning; ///< map nodes never move
+
+    // tree branches
+    UInt_t                   fRun = 0;
+    UInt_t                   fSubRun = 0;
+    UInt_t                   fEvent = 0;
+    std::string              fModule;
+    std::string              fModuleType;
+    Long64_t                 fWallTime = 0;
+    Long64_t                 fCPUTime = 0;
+    Long64_t                 fRSSDelta = 0;
+    Long64_t                 fPeakRSSDelta = 0;
+    std::vector<std::string> fCounterNames;
+    std::vector<ULong64_t>   fCounterValues;
+  };
+} // namespace sbnd
+
+DECLARE_ART_SERVICE(sbnd::EventPerformanceRecorder, SHARED)
+
+#endif // SBNDCODE_UTILITIES_EVENTPERFORMANCERECORDER_H
@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   EventPerformanceRecorder_service.cc
+///
+/// \brief  Records the time, memory and occupancy of each module on each event.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/EventPerformanceRecorder.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "art/Persistency/Provenance/ModuleContext.h"
+#include "art/Persistency/Provenance/ScheduleContext.h"
+#include "art_root_io/TFileService.h"
+
+#include "TTree.h"
+
+#include <fstream>
+
+extern "C" {
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+namespace {
+
+  // CPU time of the whole process [ns]
+  std::int64_t ProcessCPUTime()
+  {
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+    return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // current resident memory [kB]
+  std::int64_t ResidentMemory()
+  {
+    static long const pageKB = sysconf(_SC_PAGESIZE) / 1024;
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return std::int64_t(resident) * pageKB;
+  }
+
+  // peak resident memory so far [kB]
+  std::int64_t PeakResidentMemory()
+  {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+  }
+
+} // local namespace
+
+//----------------------------------------------------------------------
+sbnd::EventPerformanceRecorder::EventPerformanceRecorder(const fhicl::ParameterSet& pset,
+                                                         art::ActivityRegistry& reg)
+{
+  for (std::string const& label : pset.get<std::vector<std::string>>("ModuleLabels", {}))
+    fModuleLabels.insert(label);
+
+  reg.sPostBeginJob.watch(this, &EventPerformanceRecorder::postBeginJob);
+  reg.sPreProcessEvent.watch(this, &EventPerformanceRecorder::preProcessEvent);
+  reg.sPostProcessEvent.watch(this, &EventPerformanceRecorder::postProcessEvent);
+  reg.sPreModule.watch(this, &EventPerformanceRecorder::preModule);
+  reg.sPostModule.watch(this, &EventPerformanceRecorder::postModule);
+}
+
+//----------------------------------------------------------------------
+void sbnd::EventPerformanceRecorder::postBeginJob()
+{
+  art::ServiceHandle<art::TFileService> tfs;
+  fTree = tfs->make<TTree>("eventperformance", "Time, memory and occupancy of each module on each event");
+
+  fTree->Branch("run", &fRun, "run/i");
+  fTree->Branch("subRun", &fSubRun, "subRun/i");
+  fTree->Branch("event", &fEvent, "event/i");
+  fTree->Branch("module", &fModule);
+  fTree->Branch("moduleType", &fModuleType);
+  fTree->Branch("wallTime", &fWallTime, "wallTime/L");
+  fTree->Branch("cpuTime", &fCPUTime, "cpuTime/L");
+  fTree->Branch("rssDelta", &fRSSDelta, "rssDelta/L");
+  fTree->Branch("peakRSSDelta", &fPeakRSSDelta, "peakRSSDelta/L");
+  fTree->Branch("counterNames", &fCounterNames);
+  fTree->Branch("counterValues", &fCounterValues);
+}
+
+//----------------------------------------------------------------------
+void sbnd::EventPerformanceRecorder::preProcessEvent(art::Event const& e, art::ScheduleContext sc)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEvents[sc.id()] = e.id();
+}
+
+//----------------------------------------------------------------------
+void sbnd::EventPerformanceRecorder::postProcessEvent(art::Event const&, art::ScheduleContext sc)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEvents.erase(sc.id());
+}
+
+//----------------------------------------------------------------------
+bool sbnd::EventPerformanceRecorder::isRecorded(std::string const& label) const
+{
+  return fModuleLabels.empty() || fModuleLabels.count(label);
+}
+
+//----------------------------------------------------------------------
+void sbnd::EventPerformanceRecorder::preModule(art::ModuleContext const& mc)
+{
+  if (!isRecorded(mc.moduleLabel())) return;
+
+  RunningModule* running = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    running = &fRunning[ModuleKey_t(mc.scheduleID(), mc.moduleLabel())];
+  }
+
+  running->occupancy.Clear();
+  running->previous = perf::CurrentOccupancy();
+  perf::CurrentOccupancy() = &running->occupancy;
+
+  running->rssStart = ResidentMemory();
+  running->peakStart = PeakResidentMemory();
+  running->cpuStart = ProcessCPUTime();
+  running->wallStart = std::chrono::steady_clock::now();
+}
+
+//----------------------------------------------------------------------
+void sbnd::EventPerformanceRecorder::postModule(art::ModuleContext const& mc)
+{
+  if (!isRecorded(mc.moduleLabel())) return;
+
+  auto const wallEnd = std::chrono::steady_clock::now();
+  std::int64_t const cpuEnd = ProcessCPUTime();
+  std::int64_t const peakEnd = PeakResidentMemory();
+  std::int64_t const rssEnd = ResidentMemory();
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  auto it = fRunning.find(ModuleKey_t(mc.scheduleID(), mc.moduleLabel()));
+  if (it == fRunning.end()) return;
+  RunningModule& running = it->second;
+
+  perf::CurrentOccupancy() = running.previous;
+
+  if (!fTree) return;
+
+  art::EventID const& id = fEvents[mc.scheduleID()];
+  fRun = id.run();
+  fSubRun = id.subRun();
+  fEvent = id.event();
+  fModule = mc.moduleLabel();
+  fModuleType = mc.moduleName();
+  fWallTime = std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - running.wallStart).count();
+  fCPUTime = cpuEnd - running.cpuStart;
+  fRSSDelta = rssEnd - running.rssStart;
+  fPeakRSSDelta = peakEnd - running.peakStart;
+
+  fCounterNames.clear();
+  fCounterValues.clear();
+  for (auto const& [name, value] : running.occupancy.Counters()) {
+    fCounterNames.push_back(name);
+    fCounterValues.push_back(value);
+  }
+
+  fTree->Fill();
+}
+
+DEFINE_ART_SERVICE(sbnd::EventPerformanceRecorder)
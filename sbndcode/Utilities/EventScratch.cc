@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   EventScratch.cc
+///
+/// \brief  Per-thread arena for the temporaries of one event.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/EventScratch.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace {
+
+  /// Heap memory taken when the arena buffer is full, counted to size the next buffer.
+  class OverflowResource : public std::pmr::memory_resource {
+  public:
+    std::size_t Bytes() const { return fBytes; }
+    void ClearBytes() { fBytes = 0; }
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      fBytes += bytes;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+    {
+      return this == &other;
+    }
+
+    std::size_t fBytes = 0;
+  };
+
+  class Arena {
+  public:
+    Arena() { Rebuild(kInitialSize); }
+
+    std::pmr::memory_resource* Resource() { return fPool.get(); }
+
+    /// Drops everything allocated, keeping the buffer; grows it if it was too small.
+    void Reset()
+    {
+      fPool->release();
+      fMonotonic->release();
+      if (fOverflow.Bytes()) Rebuild(fSize + fOverflow.Bytes());
+      fOverflow.ClearBytes();
+    }
+
+    unsigned depth = 0; ///< open EventScopes
+
+  private:
+    static constexpr std::size_t kInitialSize = 1 << 20;
+
+    void Rebuild(std::size_t size)
+    {
+      fPool.reset();
+      fMonotonic.reset();
+      fBuffer = std::make_unique<std::byte[]>(size);
+      fSize = size;
+      fMonotonic = std::make_unique<std::pmr::monotonic_buffer_resource>(fBuffer.get(), fSize, &fOverflow);
+      // blocks up to a few MB (a waveform, a channel) are pooled and reused within the event;
+      // larger ones come straight from the buffer
+      std::pmr::pool_options options;
+      options.largest_required_pool_block = 1 << 22;
+      fPool = std::make_unique<std::pmr::unsynchronized_pool_resource>(options, fMonotonic.get());
+    }
+
+    OverflowResource fOverflow;
+    std::unique_ptr<std::byte[]> fBuffer;
+    std::size_t fSize = 0;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> fMonotonic;
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> fPool;
+  };
+
+  Arena& LocalArena()
+  {
+    thread_local Arena arena;
+    return arena;
+  }
+
+} // local namespace
+
+namespace sbnd::mem {
+
+  std::pmr::memory_resource* EventResource()
+  {
+    return LocalArena().Resource();
+  }
+
+  EventScope::EventScope()
+  {
+    ++LocalArena().depth;
+  }
+
+  EventScope::~EventScope()
+  {
+    Arena& arena = LocalArena();
+    if (--arena.depth == 0) arena.Reset();
+  }
+
+} // namespace sbnd::mem
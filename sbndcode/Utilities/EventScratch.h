@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   EventScratch.h
+///
+/// \brief  Per-thread arena for the temporaries a module makes while
+///         processing one event.
+///
+/// Each thread has one arena, a pool of reusable blocks carved out of a
+/// single buffer that is kept from one event to the next. Memory freed
+/// during the event goes back to the pool. When the event is done the
+/// whole arena is reset at once, and nothing is returned to the heap.
+/// The buffer grows to the largest event seen on the thread, so after
+/// the first few events the temporaries cost no heap allocation at all.
+///
+/// The arena is used through the std::pmr containers:
+///
+///   sbnd::mem::EventScope scratch;   // at the top of produce()
+///   std::pmr::vector<double> work(n, 0., sbnd::mem::EventResource());
+///
+/// The arena is reset when the outermost EventScope of the thread ends,
+/// so every container using it must be destroyed by then; nothing made
+/// from it may go into the event. Scopes can be nested, for example an
+/// algorithm opening its own scope when called from a module that has
+/// one already. Out of any scope, EventResource() still works but the
+/// memory is only reset when a scope next ends on the thread.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_EVENTSCRATCH_H
+#define SBNDCODE_UTILITIES_EVENTSCRATCH_H
+
+#include <memory_resource>
+
+namespace sbnd::mem {
+
+  /// The scratch memory of this thread.
+  std::pmr::memory_resource* EventResource();
+
+  /// Resets the scratch memory of this thread when the outermost scope ends.
+  class EventScope {
+  public:
+    EventScope();
+    ~EventScope();
+
+    EventScope(EventScope const&) = delete;
+    EventScope& operator=(EventScope const&) = delete;
+  };
+
+} // namespace sbnd::mem
+
+#endif // SBNDCODE_UTILITIES_EVENTSCRATCH_H
@@ -0,0 +1,364 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   HistAccumulator.h
+///
+/// \brief  Histogram contents as flat sums that add up across jobs.
+///
+/// A calibration campaign runs thousands of jobs filling the same
+/// histograms; adding them up with hadd opens and walks every ROOT file
+/// object by object. This class keeps the fixed binning of each histogram
+/// and, for every bin (underflow and overflow included, TH1 global bin
+/// numbering), the sums of the weights and of the squared weights, plus,
+/// for profiles, the sums of w*y and w*y^2, together with the entries and
+/// the TH1 statistics. All of these are plain sums, so adding accumulators
+/// is associative and the files of a campaign can be added in any grouping
+/// (merge_hist_accumulators adds them in parallel).
+///
+/// Capture() takes the contents of a TH1F/D, TH2F/D, TProfile or
+/// TProfile2D; MakeROOT() writes them back as TH1D, TH2D, TProfile or
+/// TProfile2D with the same name, title, contents, errors and statistics.
+///
+/// File layout (native byte order):
+///   "SBNDHACC", uint32 version, uint32 number of histograms,
+///   uint64 payload checksum (64-bit FNV-1a), then the payload: for each
+///   histogram uint32 kind, uint32 nbins x, uint32 nbins y, uint32 name
+///   length, uint32 title length, the name and the title, 6 doubles (x, y
+///   and profile value ranges), the entries and the 13 TH1 statistics,
+///   then the per-bin sums, array after array.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_HISTACCUMULATOR_H
+#define SBNDCODE_UTILITIES_HISTACCUMULATOR_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cetlib_except/exception.h"
+
+#include "TDirectory.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TProfile.h"
+#include "TProfile2D.h"
+
+namespace sbnd::diag {
+
+  class HistAccumulator {
+  public:
+
+    enum Kind : std::uint32_t { kHist1D = 0, kHist2D = 1, kProfile = 2, kProfile2D = 3 };
+
+    static constexpr unsigned int kNStats = 13; ///< TH1::kNstat
+
+    struct Entry {
+      std::string   name;        ///< path of the histogram, e.g. "dir/name"
+      std::string   title;       ///< title with the axis titles, "title;x;y"
+      std::uint32_t kind = kHist1D;
+      std::uint32_t nx = 0, ny = 0;
+      std::array<double, 6> ranges {}; ///< x low/high, y low/high, profile value low/high
+      double        entries = 0.;
+      std::array<double, kNStats> stats {};
+      std::vector<double> sumw;   ///< per bin: sum of weights (bin entries of profiles)
+      std::vector<double> sumw2;  ///< per bin: sum of squared weights
+      std::vector<double> sumwy;  ///< profiles only: sum of w*y per bin
+      std::vector<double> sumwy2; ///< profiles only: sum of w*y^2 per bin
+
+      bool IsProfile() const { return kind == kProfile || kind == kProfile2D; }
+      std::size_t NCells() const { return std::size_t(nx + 2) * (ny > 0 ? std::size_t(ny) + 2 : 1); }
+      bool SameBinning(Entry const& other) const
+        { return kind == other.kind && nx == other.nx && ny == other.ny && ranges == other.ranges; }
+    };
+
+    bool empty() const { return fEntries.empty(); }
+    std::size_t size() const { return fEntries.size(); }
+    std::vector<Entry> const& Entries() const { return fEntries; }
+
+    /// Adds the contents of `hist` to the histogram called `name`.
+    void Capture(TH1 const& hist, std::string const& name);
+
+    /// Adds all the histograms of `other`; throws if a binning differs.
+    void Add(HistAccumulator const& other);
+
+    /// Adds the contents of the file at path; false if it is not there or damaged.
+    bool Read(std::string const& path);
+
+    /// Writes the histograms to path; false on failure.
+    bool Write(std::string const& path) const;
+
+    /// Makes the ROOT histograms in `dir`, in subdirectories as in their names.
+    void MakeROOT(TDirectory& dir) const;
+
+  private:
+
+    static constexpr char kMagic[8] = { 'S', 'B', 'N', 'D', 'H', 'A', 'C', 'C' };
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kHeaderSize = sizeof(kMagic) + 2*sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+    // 64-bit FNV-1a hash
+    static std::uint64_t fnv1a(char const* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ULL) {
+      for (std::size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    /// Adds `entry` to the one with its name, or appends it.
+    void Add(Entry const& entry);
+
+    std::vector<Entry>                 fEntries;
+    std::map<std::string, std::size_t> fIndex; ///< position of each name in fEntries
+  };
+
+} // namespace sbnd::diag
+
+//----------------------------------------------------------------------
+
+inline void sbnd::diag::HistAccumulator::Capture(TH1 const& hist, std::string const& name) {
+
+  Entry entry;
+  entry.name = name;
+  entry.title = std::string(hist.GetTitle()) + ";" + hist.GetXaxis()->GetTitle()
+    + ";" + hist.GetYaxis()->GetTitle();
+  TProfile const* const profile = dynamic_cast<TProfile const*>(&hist);
+  TProfile2D const* const profile2D = dynamic_cast<TProfile2D const*>(&hist);
+  entry.kind = profile ? kProfile : profile2D ? kProfile2D : hist.GetDimension() == 2 ? kHist2D : kHist1D;
+  if (hist.GetDimension() > 2 || hist.GetXaxis()->IsVariableBinSize()
+    || (hist.GetDimension() == 2 && hist.GetYaxis()->IsVariableBinSize()))
+  {
+    throw cet::exception("HistAccumulator")
+      << "histogram '" << name << "' does not have fixed one or two dimensional binning\n";
+  }
+  entry.nx = hist.GetNbinsX();
+  entry.ny = hist.GetDimension() == 2 ? hist.GetNbinsY() : 0;
+  entry.ranges = { hist.GetXaxis()->GetXmin(), hist.GetXaxis()->GetXmax(),
+                   entry.ny ? hist.GetYaxis()->GetXmin() : 0., entry.ny ? hist.GetYaxis()->GetXmax() : 0.,
+                   profile ? profile->GetYmin() : profile2D ? profile2D->GetZmin() : 0.,
+                   profile ? profile->GetYmax() : profile2D ? profile2D->GetZmax() : 0. };
+  entry.entries = hist.GetEntries();
+  hist.GetStats(entry.stats.data());
+
+  std::size_t const nCells = entry.NCells();
+  entry.sumw.resize(nCells);
+  entry.sumw2.resize(nCells);
+  TArrayD const* const sumw2 = hist.GetSumw2();
+  if (entry.IsProfile()) {
+    // the TArrayD of a profile holds the sums of w*y, its Sumw2 the sums of
+    // w*y^2, and its bin entries and bin Sumw2 the sums of w and w^2
+    TArrayD const& sumwy = dynamic_cast<TArrayD const&>(hist);
+    TArrayD const* const binSumw2 = profile ? profile->GetBinSumw2() : profile2D->GetBinSumw2();
+    entry.sumwy.resize(nCells);
+    entry.sumwy2.resize(nCells);
+    for (std::size_t i = 0; i < nCells; ++i) {
+      entry.sumw[i] = profile ? profile->GetBinEntries(i) : profile2D->GetBinEntries(i);
+      entry.sumw2[i] = binSumw2->fN ? binSumw2->At(i) : entry.sumw[i];
+      entry.sumwy[i] = sumwy.At(i);
+      entry.sumwy2[i] = sumw2->At(i);
+    }
+  }
+  else {
+    for (std::size_t i = 0; i < nCells; ++i) {
+      entry.sumw[i] = hist.GetBinContent(i);
+      entry.sumw2[i] = sumw2->fN ? sumw2->At(i) : entry.sumw[i];
+    }
+  }
+
+  Add(entry);
+}
+
+//----------------------------------------------------------------------
+
+inline void sbnd::diag::HistAccumulator::Add(Entry const& entry) {
+
+  auto const [it, inserted] = fIndex.emplace(entry.name, fEntries.size());
+  if (inserted) {
+    fEntries.push_back(entry);
+    return;
+  }
+  Entry& sum = fEntries[it->second];
+  if (!sum.SameBinning(entry)) {
+    throw cet::exception("HistAccumulator")
+      << "histogram '" << entry.name << "' has a different kind or binning in the inputs\n";
+  }
+  sum.entries += entry.entries;
+  for (unsigned int i = 0; i < kNStats; ++i) sum.stats[i] += entry.stats[i];
+  for (std::size_t i = 0; i < sum.sumw.size(); ++i) sum.sumw[i] += entry.sumw[i];
+  for (std::size_t i = 0; i < sum.sumw2.size(); ++i) sum.sumw2[i] += entry.sumw2[i];
+  for (std::size_t i = 0; i < sum.sumwy.size(); ++i) sum.sumwy[i] += entry.sumwy[i];
+  for (std::size_t i = 0; i < sum.sumwy2.size(); ++i) sum.sumwy2[i] += entry.sumwy2[i];
+}
+
+inline void sbnd::diag::HistAccumulator::Add(HistAccumulator const& other) {
+  for (Entry const& entry: other.fEntries) Add(entry);
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::diag::HistAccumulator::Read(std::string const& path) {
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  std::vector<char> const data{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+  if (data.size() < kHeaderSize || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) return false;
+
+  std::uint32_t version = 0, nHists = 0;
+  std::uint64_t payloadChecksum = 0;
+  char const* pos = data.data() + sizeof(kMagic);
+  std::memcpy(&version, pos, sizeof(version));                 pos += sizeof(version);
+  std::memcpy(&nHists, pos, sizeof(nHists));                   pos += sizeof(nHists);
+  std::memcpy(&payloadChecksum, pos, sizeof(payloadChecksum)); pos += sizeof(payloadChecksum);
+  char const* const end = data.data() + data.size();
+  if (version != kVersion || fnv1a(pos, end - pos) != payloadChecksum) return false;
+
+  // reads size bytes into dest, false past the end of the file
+  auto const get = [&pos, end](void* dest, std::size_t size) {
+    if (size > std::size_t(end - pos)) return false;
+    std::memcpy(dest, pos, size);
+    pos += size;
+    return true;
+  };
+  auto const getArray = [&get](std::vector<double>& array, std::size_t n) {
+    array.resize(n);
+    return get(array.data(), n*sizeof(double));
+  };
+
+  HistAccumulator read;
+  for (std::uint32_t iHist = 0; iHist < nHists; ++iHist) {
+    Entry entry;
+    std::uint32_t nameSize = 0, titleSize = 0;
+    if (!get(&entry.kind, sizeof(entry.kind)) || !get(&entry.nx, sizeof(entry.nx))
+      || !get(&entry.ny, sizeof(entry.ny)) || !get(&nameSize, sizeof(nameSize))
+      || !get(&titleSize, sizeof(titleSize)) || entry.kind > kProfile2D
+      || nameSize > std::size_t(end - pos) || titleSize > std::size_t(end - pos)
+      || entry.NCells() > std::size_t(end - pos))
+      return false;
+    entry.name.resize(nameSize);
+    entry.title.resize(titleSize);
+    std::size_t const nCells = entry.NCells();
+    if (!get(entry.name.data(), nameSize) || !get(entry.title.data(), titleSize)
+      || !get(entry.ranges.data(), sizeof(entry.ranges)) || !get(&entry.entries, sizeof(entry.entries))
+      || !get(entry.stats.data(), sizeof(entry.stats))
+      || !getArray(entry.sumw, nCells) || !getArray(entry.sumw2, nCells)
+      || (entry.IsProfile() && (!getArray(entry.sumwy, nCells) || !getArray(entry.sumwy2, nCells))))
+      return false;
+    read.Add(entry);
+  }
+  if (pos != end) return false;
+
+  Add(read);
+  return true;
+}
+
+//----------------------------------------------------------------------
+
+inline bool sbnd::diag::HistAccumulator::Write(std::string const& path) const {
+
+  std::vector<char> payload;
+  auto const put = [&payload](void const* src, std::size_t size) {
+    char const* const bytes = static_cast<char const*>(src);
+    payload.insert(payload.end(), bytes, bytes + size);
+  };
+  for (Entry const& entry: fEntries) {
+    std::uint32_t const nameSize = entry.name.size(), titleSize = entry.title.size();
+    put(&entry.kind, sizeof(entry.kind));
+    put(&entry.nx, sizeof(entry.nx));
+    put(&entry.ny, sizeof(entry.ny));
+    put(&nameSize, sizeof(nameSize));
+    put(&titleSize, sizeof(titleSize));
+    put(entry.name.data(), nameSize);
+    put(entry.title.data(), titleSize);
+    put(entry.ranges.data(), sizeof(entry.ranges));
+    put(&entry.entries, sizeof(entry.entries));
+    put(entry.stats.data(), sizeof(entry.stats));
+    for (std::vector<double> const* array: { &entry.sumw, &entry.sumw2, &entry.sumwy, &entry.sumwy2 })
+      put(array->data(), array->size()*sizeof(double));
+  }
+  std::uint32_t const nHists = fEntries.size();
+  std::uint64_t const payloadChecksum = fnv1a(payload.data(), payload.size());
+
+  // through a temporary file, so that a reader never sees a partial one
+  std::string const tmpPath = path + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<char const*>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<char const*>(&nHists), sizeof(nHists));
+    out.write(reinterpret_cast<char const*>(&payloadChecksum), sizeof(payloadChecksum));
+    out.write(payload.data(), payload.size());
+    if (!out) {
+      out.close();
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------
+
+inline void sbnd::diag::HistAccumulator::MakeROOT(TDirectory& dir) const {
+
+  for (Entry const& entry: fEntries) {
+    TDirectory* subdir = &dir;
+    std::string name = entry.name;
+    for (std::size_t slash; (slash = name.find('/')) != std::string::npos; name.erase(0, slash + 1)) {
+      std::string const dirName = name.substr(0, slash);
+      TDirectory* const next = subdir->GetDirectory(dirName.c_str());
+      subdir = next ? next : subdir->mkdir(dirName.c_str());
+    }
+    subdir->cd();
+
+    auto const& r = entry.ranges;
+    TH1* hist = nullptr;
+    switch (entry.kind) {
+      case kHist1D:    hist = new TH1D(name.c_str(), entry.title.c_str(), entry.nx, r[0], r[1]); break;
+      case kHist2D:    hist = new TH2D(name.c_str(), entry.title.c_str(), entry.nx, r[0], r[1], entry.ny, r[2], r[3]); break;
+      case kProfile:   hist = new TProfile(name.c_str(), entry.title.c_str(), entry.nx, r[0], r[1], r[4], r[5]); break;
+      case kProfile2D: hist = new TProfile2D(name.c_str(), entry.title.c_str(), entry.nx, r[0], r[1], entry.ny, r[2], r[3], r[4], r[5]); break;
+    }
+    hist->Sumw2(); // for profiles, also the bin sums of w^2
+
+    std::size_t const nCells = entry.NCells();
+    if (entry.IsProfile()) {
+      TArrayD& sumwy = dynamic_cast<TArrayD&>(*hist);
+      TProfile* const profile = dynamic_cast<TProfile*>(hist);
+      TProfile2D* const profile2D = dynamic_cast<TProfile2D*>(hist);
+      TArrayD* const binSumw2 = profile ? profile->GetBinSumw2() : profile2D->GetBinSumw2();
+      for (std::size_t i = 0; i < nCells; ++i) {
+        if (profile) profile->SetBinEntries(i, entry.sumw[i]);
+        else         profile2D->SetBinEntries(i, entry.sumw[i]);
+        binSumw2->SetAt(entry.sumw2[i], i);
+        sumwy.SetAt(entry.sumwy[i], i);
+        hist->GetSumw2()->SetAt(entry.sumwy2[i], i);
+      }
+    }
+    else {
+      for (std::size_t i = 0; i < nCells; ++i) {
+        hist->SetBinContent(i, entry.sumw[i]);
+        hist->GetSumw2()->SetAt(entry.sumw2[i], i);
+      }
+    }
+    std::array<double, kNStats> stats = entry.stats;
+    hist->PutStats(stats.data());
+    hist->SetEntries(entry.entries);
+    hist->SetDirectory(subdir);
+    hist->Write();
+  }
+  dir.cd();
+}
+
+#endif // SBNDCODE_UTILITIES_HISTACCUMULATOR_H
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   Instrumentation.cc
+///
+/// \brief  Registry of the hot-path timers and counters.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/Instrumentation.h"
+
+#include <tuple>
+
+namespace sbnd::instr {
+
+  Registry& Registry::Instance()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  Stat& Registry::Get(std::string const& name)
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fStats.emplace(std::piecewise_construct, std::forward_as_tuple(name), std::tuple<>{}).first->second;
+  }
+
+  std::vector<Summary> Registry::Snapshot() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    std::vector<Summary> summaries;
+    summaries.reserve(fStats.size());
+    for (auto const& [name, stat] : fStats) {
+      summaries.push_back({name, stat.calls.load(), stat.nanoseconds.load(), stat.count.load()});
+    }
+    return summaries;
+  }
+
+  void Registry::Reset()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    for (auto& entry : fStats) {
+      entry.second.calls = 0;
+      entry.second.nanoseconds = 0;
+      entry.second.count = 0;
+    }
+  }
+
+} // namespace sbnd::instr
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   Instrumentation.h
+///
+/// \brief  Scoped timers and counters for the hot paths of the SBND
+///         simulation and reconstruction modules.
+///
+/// The macros below record into a process-wide registry of named
+/// entries, each with the number of calls, the wall time spent in the
+/// timed scopes and a free counter (samples, channels, bytes...). The
+/// InstrumentationSummary service writes the registry out at the end of
+/// the job.
+///
+/// The macros compile to nothing unless SBND_INSTRUMENTATION is defined
+/// (configure with -DSBND_INSTRUMENTATION=ON); the count argument is not
+/// even evaluated then. Entry names must be string literals, as each
+/// macro looks its entry up once and keeps it.
+///
+///   SBND_INSTR_SCOPE("SimWireSBND::Digitize");         // times the enclosing scope
+///   SBND_INSTR_COUNT("SimWireSBND::Samples", n);       // adds n to the counter
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_INSTRUMENTATION_H
+#define SBNDCODE_UTILITIES_INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sbnd::instr {
+
+  /// Totals of one named entry; updated from any thread.
+  struct Stat {
+    std::atomic<std::uint64_t> calls{0};       ///< timed scopes entered
+    std::atomic<std::uint64_t> nanoseconds{0}; ///< wall time spent in them
+    std::atomic<std::uint64_t> count{0};       ///< sum of the counter increments
+  };
+
+  /// Copy of the totals of an entry.
+  struct Summary {
+    std::string   name;
+    std::uint64_t calls = 0;
+    std::uint64_t nanoseconds = 0;
+    std::uint64_t count = 0;
+  };
+
+  class Registry {
+  public:
+    static Registry& Instance();
+
+    /// The entry called `name`, created empty the first time; the reference stays valid.
+    Stat& Get(std::string const& name);
+
+    /// Totals of all the entries, sorted by name.
+    std::vector<Summary> Snapshot() const;
+
+    /// Zeroes all the totals, keeping the entries.
+    void Reset();
+
+  private:
+    Registry() = default;
+
+    mutable std::mutex fMutex;
+    std::map<std::string, Stat> fStats; ///< map nodes never move
+  };
+
+  /// Adds the time from its construction to its destruction to an entry.
+  class ScopedTimer {
+  public:
+    using Clock_t = std::chrono::steady_clock;
+
+    explicit ScopedTimer(Stat& stat) : fStat(stat), fStart(Clock_t::now()) {}
+    ~ScopedTimer()
+    {
+      auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - fStart);
+      fStat.nanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+      fStat.calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ScopedTimer(ScopedTimer const&) = delete;
+    ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+  private:
+    Stat& fStat;
+    Clock_t::time_point fStart;
+  };
+
+} // namespace sbnd::instr
+
+#ifdef SBND_INSTRUMENTATION
+
+#define SBND_INSTR_CONCAT_IMPL(a, b) a##b
+#define SBND_INSTR_CONCAT(a, b) SBND_INSTR_CONCAT_IMPL(a, b)
+
+#define SBND_INSTR_SCOPE(name)                                             \
+  static ::sbnd::instr::Stat& SBND_INSTR_CONCAT(sbndInstrStat_, __LINE__)   \
+    = ::sbnd::instr::Registry::Instance().Get(name);                        \
+  ::sbnd::instr::ScopedTimer SBND_INSTR_CONCAT(sbndInstrTimer_, __LINE__)   \
+    (SBND_INSTR_CONCAT(sbndInstrStat_, __LINE__))
+
+#define SBND_INSTR_COUNT(name, n)                                          \
+  do {                                                                      \
+    static ::sbnd::instr::Stat& sbndInstrStat_                              \
+      = ::sbnd::instr::Registry::Instance().Get(name);                      \
+    sbndInstrStat_.count.fetch_add((n), std::memory_order_relaxed);         \
+  } while (0)
+
+#else
+
+#define SBND_INSTR_SCOPE(name) do {} while (0)
+// sizeof keeps the count referenced, without evaluating it
+#define SBND_INSTR_COUNT(name, n) do { static_cast<void>(sizeof(n)); } while (0)
+
+#endif // SBND_INSTRUMENTATION
+
+#endif // SBNDCODE_UTILITIES_INSTRUMENTATION_H
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   InstrumentationSummary.h
+///
+/// \brief  Service writing out the hot-path timers and counters of
+///         sbndcode/Utilities/Instrumentation.h at the end of the job.
+///
+/// FCL parameters:
+///
+/// WriteTree    - Fill a tree "instrumentation" in the TFileService file,
+///                one entry per timer or counter (default: true).
+/// JSONFileName - Also write the totals to this JSON file; none if empty
+///                (default: empty).
+/// PrintSummary - Print the totals to the message logger (default: true).
+///
+/// Without SBND_INSTRUMENTATION defined at build time the registry
+/// stays empty and the service writes nothing.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_INSTRUMENTATIONSUMMARY_H
+#define SBNDCODE_UTILITIES_INSTRUMENTATIONSUMMARY_H
+
+#include <string>
+#include <vector>
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "sbndcode/Utilities/Instrumentation.h"
+
+namespace sbnd {
+  class InstrumentationSummary {
+  public:
+
+    InstrumentationSummary(const fhicl::ParameterSet& pset,
+                           art::ActivityRegistry& reg);
+
+  private:
+
+    void postEndJob();
+
+    void writeTree(std::vector<instr::Summary> const& summaries) const;
+    void writeJSON(std::vector<instr::Summary> const& summaries) const;
+    void print(std::vector<instr::Summary> const& summaries) const;
+
+    bool        fWriteTree;
+    std::string fJSONFileName;
+    bool        fPrintSummary;
+  };
+} // namespace sbnd
+
+DECLARE_ART_SERVICE(sbnd::InstrumentationSummary, LEGACY)
+
+#endif // SBNDCODE_UTILITIES_INSTRUMENTATIONSUMMARY_H
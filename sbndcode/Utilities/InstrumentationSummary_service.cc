@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   InstrumentationSummary_service.cc
+///
+/// \brief  Writes out the hot-path timers and counters at the end of the job.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/InstrumentationSummary.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "art_root_io/TFileService.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "cetlib_except/exception.h"
+
+#include "TTree.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+  // entry names are literals from the code, but keep the file valid anyway
+  std::string JSONEscape(std::string const& s)
+  {
+    std::string escaped;
+    escaped.reserve(s.size());
+    for (char c : s) {
+      if (c == '"' || c == '\\') escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+} // local namespace
+
+//----------------------------------------------------------------------
+sbnd::InstrumentationSummary::InstrumentationSummary(const fhicl::ParameterSet& pset,
+                                                     art::ActivityRegistry& reg)
+  : fWriteTree(pset.get<bool>("WriteTree", true))
+  , fJSONFileName(pset.get<std::string>("JSONFileName", ""))
+  , fPrintSummary(pset.get<bool>("PrintSummary", true))
+{
+  reg.sPostEndJob.watch(this, &InstrumentationSummary::postEndJob);
+}
+
+//----------------------------------------------------------------------
+void sbnd::InstrumentationSummary::postEndJob()
+{
+  std::vector<instr::Summary> const summaries = instr::Registry::Instance().Snapshot();
+
+  if (summaries.empty()) {
+    mf::LogInfo("InstrumentationSummary")
+      << "No instrumentation recorded (sbndcode built without SBND_INSTRUMENTATION?)";
+    return;
+  }
+
+  if (fWriteTree) writeTree(summaries);
+  if (!fJSONFileName.empty()) writeJSON(summaries);
+  if (fPrintSummary) print(summaries);
+}
+
+//----------------------------------------------------------------------
+void sbnd::InstrumentationSummary::writeTree(std::vector<instr::Summary> const& summaries) const
+{
+  art::ServiceHandle<art::TFileService> tfs;
+  TTree* tree = tfs->make<TTree>("instrumentation", "Hot-path timers and counters");
+
+  std::string name;
+  ULong64_t calls, nanoseconds, count;
+  tree->Branch("name", &name);
+  tree->Branch("calls", &calls, "calls/l");
+  tree->Branch("nanoseconds", &nanoseconds, "nanoseconds/l");
+  tree->Branch("count", &count, "count/l");
+
+  for (instr::Summary const& s : summaries) {
+    name = s.name;
+    calls = s.calls;
+    nanoseconds = s.nanoseconds;
+    count = s.count;
+    tree->Fill();
+  }
+}
+
+//----------------------------------------------------------------------
+void sbnd::InstrumentationSummary::writeJSON(std::vector<instr::Summary> const& summaries) const
+{
+  std::ofstream out(fJSONFileName);
+  if (!out) {
+    throw cet::exception("InstrumentationSummary")
+      << "Cannot open '" << fJSONFileName << "' for writing\n";
+  }
+
+  out << "{\n  \"entries\": [";
+  for (size_t i = 0; i < summaries.size(); ++i) {
+    instr::Summary const& s = summaries[i];
+    out << (i ? ",\n" : "\n")
+        << "    { \"name\": \"" << JSONEscape(s.name) << "\""
+        << ", \"calls\": " << s.calls
+        << ", \"nanoseconds\": " << s.nanoseconds
+        << ", \"count\": " << s.count << " }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+//----------------------------------------------------------------------
+void sbnd::InstrumentationSummary::print(std::vector<instr::Summary> const& summaries) const
+{
+  mf::LogInfo log("InstrumentationSummary");
+  log << "Hot-path instrumentation:\n"
+      << std::left << std::setw(40) << "name"
+      << std::right << std::setw(12) << "calls" << std::setw(14) << "time [ms]"
+      << std::setw(14) << "ms/call" << std::setw(16) << "count" << "\n";
+  for (instr::Summary const& s : summaries) {
+    double const ms = s.nanoseconds * 1e-6;
+    log << std::left << std::setw(40) << s.name
+        << std::right << std::setw(12) << s.calls
+        << std::setw(14) << std::fixed << std::setprecision(3) << ms
+        << std::setw(14) << (s.calls ? ms / s.calls : 0.)
+        << std::setw(16) << s.count << "\n";
+  }
+}
+
+DEFINE_ART_SERVICE(sbnd::InstrumentationSummary)
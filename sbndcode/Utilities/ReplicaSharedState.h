@@ -0,0 +1,43 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   ReplicaSharedState.h
+///
+/// \brief  State shared by the replicas of an art::ReplicatedProducer.
+///
+/// art constructs one replica of a replicated module for each schedule.
+/// What does not change from event to event (response tables, single
+/// photon templates, monitoring histograms and the locks guarding them)
+/// only needs to exist once: the first replica asking for the state of a
+/// module label makes it with `make`, the others get the same object. The
+/// state is destroyed with the last replica holding it.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_REPLICASHAREDSTATE_H
+#define SBNDCODE_UTILITIES_REPLICASHAREDSTATE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace sbnd {
+
+  template <class State, class Make>
+  std::shared_ptr<State> ReplicaSharedState(std::string const& moduleLabel, Make make)
+  {
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<State>> states;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<State> state = states[moduleLabel].lock();
+    if (!state) {
+      state = make();
+      states[moduleLabel] = state;
+    }
+    return state;
+  }
+
+} // namespace sbnd
+
+#endif // SBNDCODE_UTILITIES_REPLICASHAREDSTATE_H
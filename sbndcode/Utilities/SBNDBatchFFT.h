@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   SBNDBatchFFT.h
+///
+/// \brief  Batched (de)convolution of many channels with one FFT plan.
+///
+/// A SBNDBatchFFT applies a frequency-domain kernel to every row of a
+/// contiguous channel-by-tick matrix of floats. The plans are made once
+/// and reused for all the rows, and the matrix and spectrum buffers are
+/// kept between calls, so a batch allocates nothing once the arena has
+/// grown to the largest batch seen. Like SBNDFFTWorker, an instance is
+/// meant to be owned by a single thread.
+///
+/// Normalisation follows util::LArFFT: the kernels of util::SignalShaping
+/// (converted to std::complex<float>) give the same result as
+/// SignalShaping::Convolute on each row.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_SBNDBATCHFFT_H
+#define SBNDCODE_UTILITIES_SBNDBATCHFFT_H
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cetlib_except/exception.h"
+
+#include "TFFTRealComplex.h"
+#include "TFFTComplexReal.h"
+
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+
+namespace util {
+
+  class SBNDBatchFFT {
+  public:
+
+    using Complex = std::complex<float>;
+
+    explicit SBNDBatchFFT(int size, std::string const& option = "ES");
+
+    SBNDBatchFFT(SBNDBatchFFT const&) = delete;
+    SBNDBatchFFT& operator=(SBNDBatchFFT const&) = delete;
+
+    int FFTSize() const { return fSize; }
+    int FreqSize() const { return fFreqSize; }
+
+    /// Reusable nRows x FFTSize() matrix, contents unspecified.
+    float* Rows(std::size_t nRows);
+
+    /// Multiply the spectrum of each of the nRows rows of data
+    /// (FFTSize() consecutive values per row) by kern, in place.
+    void Convolute(float* data, std::size_t nRows, std::vector<Complex> const& kern);
+
+  private:
+
+    int fSize;
+    int fFreqSize;
+    std::unique_ptr<TFFTRealComplex> fFFT;
+    std::unique_ptr<TFFTComplexReal> fInverseFFT;
+
+    // Arena.
+    std::vector<float> fRows;
+    std::vector<double> fReal;
+    std::vector<double> fRe;
+    std::vector<double> fIm;
+  };
+
+} // namespace util
+
+//----------------------------------------------------------------------
+inline util::SBNDBatchFFT::SBNDBatchFFT(int size, std::string const& option)
+  : fSize(size)
+  , fFreqSize(size/2 + 1)
+  , fReal(size)
+  , fRe(size/2 + 1)
+  , fIm(size/2 + 1)
+{
+  if (fSize <= 0)
+    throw cet::exception("SBNDBatchFFT") << "Invalid FFT size " << fSize << "\n";
+
+  std::lock_guard<std::mutex> lock(SBNDFFTPlannerMutex());
+  int dummy[1] = {0};
+  fFFT = std::make_unique<TFFTRealComplex>(fSize, false);
+  fFFT->Init(option.c_str(), -1, dummy);
+  fInverseFFT = std::make_unique<TFFTComplexReal>(fSize, false);
+  fInverseFFT->Init(option.c_str(), 1, dummy);
+}
+
+//----------------------------------------------------------------------
+inline float* util::SBNDBatchFFT::Rows(std::size_t nRows)
+{
+  if (fRows.size() < nRows*fSize) fRows.resize(nRows*fSize);
+  return fRows.data();
+}
+
+//----------------------------------------------------------------------
+inline void util::SBNDBatchFFT::Convolute(float* data, std::size_t nRows, std::vector<Complex> const& kern)
+{
+  if ((int)kern.size() < fFreqSize)
+    throw cet::exception("SBNDBatchFFT") << "Kernel size " << kern.size()
+                                         << " smaller than spectrum size " << fFreqSize << "\n";
+
+  double const norm = 1.0/(double)fSize;
+
+  for (std::size_t row = 0; row < nRows; ++row) {
+    float* func = data + row*fSize;
+
+    std::copy(func, func + fSize, fReal.begin());
+    fFFT->SetPoints(fReal.data());
+    fFFT->Transform();
+    fFFT->GetPointsComplex(fRe.data(), fIm.data());
+
+    for (int i = 0; i < fFreqSize; ++i) {
+      double const kr = kern[i].real();
+      double const ki = kern[i].imag();
+      double const re = fRe[i]*kr - fIm[i]*ki;
+      fIm[i] = fRe[i]*ki + fIm[i]*kr;
+      fRe[i] = re;
+    }
+
+    fInverseFFT->SetPointsComplex(fRe.data(), fIm.data());
+    fInverseFFT->Transform();
+    fInverseFFT->GetPoints(fReal.data());
+
+    for (int i = 0; i < fSize; ++i) func[i] = norm*fReal[i];
+  }
+}
+
+#endif // SBNDCODE_UTILITIES_SBNDBATCHFFT_H
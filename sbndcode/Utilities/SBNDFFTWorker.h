@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   SBNDFFTWorker.h
+///
+/// \brief  Thread-private FFT plans for the SBND TPC signal processing.
+///
+/// util::LArFFT holds a single pair of FFTW plans and one scratch
+/// spectrum, so it can only be used by one thread at a time. A
+/// SBNDFFTWorker owns its own plans and buffers; each worker thread of
+/// a parallel channel loop is meant to hold one. Transforms follow the
+/// LArFFT conventions (unnormalised forward transform, inverse transform
+/// divided by the FFT size), so kernels from util::SignalShaping can be
+/// applied unchanged.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_SBNDFFTWORKER_H
+#define SBNDCODE_UTILITIES_SBNDFFTWORKER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cetlib_except/exception.h"
+
+#include "TComplex.h"
+#include "TFFTRealComplex.h"
+#include "TFFTComplexReal.h"
+
+namespace util {
+
+  /// The FFTW planner is not thread-safe: every plan made by the SBND FFT
+  /// helpers is created under this lock.
+  inline std::mutex& SBNDFFTPlannerMutex() {
+    static std::mutex plannerMutex;
+    return plannerMutex;
+  }
+
+  /// Smallest even size of the form 2^a 3^b 5^c not below n. FFTW
+  /// transforms such sizes about as fast as powers of two, and they pad
+  /// a waveform far less than rounding it up to the next power of two.
+  inline int SBNDFastFFTSize(int n) {
+    if (n <= 2) return 2;
+    long long best = 2;
+    while (best < n) best *= 2;
+    for (long long p5 = 2; p5 < best; p5 *= 5) {
+      for (long long p35 = p5; p35 < best; p35 *= 3) {
+        long long size = p35;
+        while (size < n) size *= 2;
+        if (size < best) best = size;
+      }
+    }
+    return (int)best;
+  }
+
+  class SBNDFFTWorker {
+  public:
+
+    /// Plans are always made with FFTW_ESTIMATE unless another option is
+    /// requested: estimated plans are the same for every instance, which
+    /// keeps results independent of which worker did the transform.
+    explicit SBNDFFTWorker(int size, std::string const& option = "ES");
+
+    SBNDFFTWorker(SBNDFFTWorker const&) = delete;
+    SBNDFFTWorker& operator=(SBNDFFTWorker const&) = delete;
+
+    int FFTSize() const { return fSize; }
+    int FreqSize() const { return fFreqSize; }
+
+    template <class T> void DoFFT(std::vector<T> const& input, std::vector<TComplex>& output);
+    template <class T> void DoInvFFT(std::vector<TComplex> const& input, std::vector<T>& output);
+
+    /// Multiply the spectrum of func by kern, in place.
+    template <class T> void Convolute(std::vector<T>& func, std::vector<TComplex> const& kern);
+
+  private:
+
+    int fSize;
+    int fFreqSize;
+    std::unique_ptr<TFFTRealComplex> fFFT;
+    std::unique_ptr<TFFTComplexReal> fInverseFFT;
+    std::vector<TComplex> fCompTemp;
+  };
+
+} // namespace util
+
+//----------------------------------------------------------------------
+inline util::SBNDFFTWorker::SBNDFFTWorker(int size, std::string const& option)
+  : fSize(size)
+  , fFreqSize(size/2 + 1)
+  , fCompTemp(size/2 + 1)
+{
+  if (fSize <= 0)
+    throw cet::exception("SBNDFFTWorker") << "Invalid FFT size " << fSize << "\n";
+
+  std::lock_guard<std::mutex> lock(SBNDFFTPlannerMutex());
+  int dummy[1] = {0};
+  fFFT = std::make_unique<TFFTRealComplex>(fSize, false);
+  fFFT->Init(option.c_str(), -1, dummy);
+  fInverseFFT = std::make_unique<TFFTComplexReal>(fSize, false);
+  fInverseFFT->Init(option.c_str(), 1, dummy);
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::SBNDFFTWorker::DoFFT(std::vector<T> const& input, std::vector<TComplex>& output)
+{
+  if ((int)input.size() != fSize)
+    throw cet::exception("SBNDFFTWorker") << "Input size " << input.size()
+                                          << " does not match FFT size " << fSize << "\n";
+  output.resize(fFreqSize);
+
+  for (int i = 0; i < fSize; ++i) fFFT->SetPoint(i, input[i]);
+  fFFT->Transform();
+
+  double re = 0., im = 0.;
+  for (int i = 0; i < fFreqSize; ++i) {
+    fFFT->GetPointComplex(i, re, im);
+    output[i] = TComplex(re, im);
+  }
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::SBNDFFTWorker::DoInvFFT(std::vector<TComplex> const& input, std::vector<T>& output)
+{
+  output.resize(fSize);
+
+  for (int i = 0; i < fFreqSize; ++i) fInverseFFT->SetPoint(i, input[i].Re(), input[i].Im());
+  fInverseFFT->Transform();
+
+  double const factor = 1.0/(double)fSize;
+  for (int i = 0; i < fSize; ++i) output[i] = factor*fInverseFFT->GetPointReal(i, false);
+}
+
+//----------------------------------------------------------------------
+template <class T>
+inline void util::SBNDFFTWorker::Convolute(std::vector<T>& func, std::vector<TComplex> const& kern)
+{
+  DoFFT(func, fCompTemp);
+  for (size_t i = 0; i < kern.size() && i < fCompTemp.size(); ++i) fCompTemp[i] *= kern[i];
+  DoInvFFT(fCompTemp, func);
+}
+
+#endif // SBNDCODE_UTILITIES_SBNDFFTWORKER_H
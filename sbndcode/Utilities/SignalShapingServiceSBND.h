@@ -23,12 +23,28 @@
 /// ColFilterParams - Collection filter function parameters.
 /// IndFilter       - Root parameterized induction plane filter function.
 /// IndFilterParams - Induction filter function parameters.
+/// InitInBeginJob  - Compute the kernels at the end of beginJob instead of
+///                   on the first channel (default: false).
+/// DirectConvolutionTolerance - Convolute channels with few ticks of charge
+///                   in the time domain, with the response truncated where
+///                   it falls below this fraction of its peak (default: 0,
+///                   always use the FFT).
+/// DirectConvolutionCostFactor - Time domain convolution is used when
+///                   (ticks with charge) x (response ticks) is below this
+///                   factor times N log2(N) of the FFT (default: 1).
 ///
 ////////////////////////////////////////////////////////////////////////
 
 #ifndef SIGNALSHAPINGSERVICELARIAT_H
 #define SIGNALSHAPINGSERVICELARIAT_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 #include "fhiclcpp/ParameterSet.h"
@@ -38,6 +54,9 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/TPCGeo.h"
 #include "larcorealg/Geometry/PlaneGeo.h"
+#include "sbndcode/Utilities/SBNDFFTWorker.h"
+#include "sbndcode/Utilities/SBNDBatchFFT.h"
+#include "sbndcode/Utilities/BinnedModelFile.h"
 namespace detinfo { class DetectorClocksData; }
 
 #include "TF1.h"
@@ -60,7 +79,23 @@ namespace util {
 
     void reconfigure(const fhicl::ParameterSet& pset);
 
+    // Per-channel constants, tabulated in init() so that the per-channel
+    // accessors below need no Geometry lookup.
+    struct ChannelInfo {
+      geo::View_t                view = geo::kUnknown; ///< view used to pick the response
+      std::size_t                plane = 0;            ///< index of the view in per-plane tables (U, V, Z)
+      double                     asicGain = 0.;        ///< ASIC gain [mV/fC]
+      double                     rawNoise = 0.;        ///< see GetRawNoise()
+      double                     deconNoise = 0.;      ///< see GetDeconNoise()
+      DoubleVec const*           noiseFact = nullptr;  ///< NoiseFactVec entry of the view
+      util::SignalShaping const* shaping = nullptr;    ///< response and kernels of the view
+    };
+
+    ChannelInfo const& GetChannelInfo(unsigned int const channel) const;
+
     std::vector<DoubleVec> GetNoiseFactVec()   {return fNoiseFactVec;};
+    // NoiseFactVec entry of the channel view for shaping time index shapingIndex, scaled to the ASIC gain.
+    double GetNoiseFactor(unsigned int const channel, std::size_t shapingIndex) const;
     double GetASICGain(unsigned int const channel) const;
     //double GetShapingTime(unsigned int const channel) const;
     
@@ -71,6 +106,10 @@ namespace util {
 
     const util::SignalShaping& SignalShaping(unsigned int channel) const;
 
+    // Compute the kernels now instead of on the first channel.
+    // Safe to call from several threads; the first one does the work.
+    void InitKernels() const { if(!fInit.load(std::memory_order_acquire)) init(); }
+
     int FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
                              unsigned int const channel) const;
 
@@ -79,28 +118,73 @@ namespace util {
     template <class T> void Convolute(detinfo::DetectorClocksData const& clockData,
                                       unsigned int channel, std::vector<T>& func) const;
 
+    // Same, with the caller's FFT plans instead of the shared LArFFT service
+    // (thread-safe once InitKernels() has been called).
+
+    template <class T> void Convolute(detinfo::DetectorClocksData const& clockData,
+                                      unsigned int channel, std::vector<T>& func,
+                                      util::SBNDFFTWorker& fft) const;
+
     // Do deconvolution calcution (for reconstruction).
 
     template <class T> void Deconvolute(detinfo::DetectorClocksData const& clockData,
                                         unsigned int channel, std::vector<T>& func) const;
 
+    template <class T> void Deconvolute(detinfo::DetectorClocksData const& clockData,
+                                        unsigned int channel, std::vector<T>& func,
+                                        util::SBNDFFTWorker& fft) const;
+
+    // Same, with DeconNorm folded into the kernel: the output is already
+    // divided by GetDeconNorm().
+
+    template <class T> void DeconvoluteNormalized(detinfo::DetectorClocksData const& clockData,
+                                                  unsigned int channel, std::vector<T>& func,
+                                                  util::SBNDFFTWorker& fft) const;
+
+    // Convolution in the time domain with the truncated response, done
+    // only when the channel has few enough ticks with charge for it to be
+    // cheaper than the FFT; returns whether func was convoluted.
+    // Thread-safe once InitKernels() has been called.
+
+    template <class T> bool ConvoluteDirect(detinfo::DetectorClocksData const& clockData,
+                                            unsigned int channel, std::vector<T>& func) const;
+
+    // Batch (de)convolution of nChannels channels of the same view, stored
+    // row by row in data with fft.FFTSize() ticks per channel.
+    // Thread-safe once InitKernels() has been called.
+
+    void Convolute(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                   float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const;
+    void Deconvolute(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                     float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const;
+    void DeconvoluteNormalized(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                               float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const;
+
+    // View used to pick the response of a channel.
+    geo::View_t ChannelView(unsigned int chan) const { return GetChannelInfo(chan).view; }
+
     double GetDeconNorm(){return fDeconNorm;};
 
   private:
 
     // Private configuration methods.
 
+    // Read the filter and field response histograms, from the ModelFlatFile
+    // when it is there and made from the same input.
+    void LoadModelHistograms(const fhicl::ParameterSet& pset);
+
     // Post-constructor initialization.
 
     void init() const{const_cast<SignalShapingServiceSBND*>(this)->init();}
     void init();
+    void postBeginJob();
 
 
     // Calculate response functions.
     // Copied from SimWireSBND.
 
     void SetFieldResponse();
-    void SetElectResponse(double shapingtime, double gain);
+    std::vector<double> ElectResponse(double shapingtime, double gain, int nticks) const;
 
     // Calculate filter functions.
 
@@ -110,13 +194,48 @@ namespace util {
     // Calculate view corresponding to channel
     geo::View_t GetView(unsigned int chan) const;
 
+    // Index of the U, V and Z responses in per-view tables.
+    static std::size_t ViewIndex(geo::View_t view);
+
+    // Fill fChannelInfo, at the end of init().
+    void SetChannelInfo();
+    double ComputeRawNoise(std::size_t plane) const;
+    double ComputeDeconNoise(std::size_t plane) const;
+    int ViewTOffset(detinfo::DetectorClocksData const& clockData, geo::View_t view) const;
+
     // Attributes.
 
-    bool fInit;               ///< Initialization flag.
+    std::atomic<bool> fInit;  ///< Initialization flag, set once the kernels are complete.
+    std::mutex fInitMutex;    ///< Held while the kernels are computed.
 
     void SetResponseSampling();
 
+    // Undo the field response time offset after (de)convolution.
+    template <class T> void ShiftConvoluted(detinfo::DetectorClocksData const& clockData,
+                                            unsigned int channel, std::vector<T>& func) const;
+    template <class T> void ShiftDeconvoluted(detinfo::DetectorClocksData const& clockData,
+                                              unsigned int channel, std::vector<T>& func) const;
+
+    // Impulse response of a view, without the ticks below
+    // fDirectTolerance of its peak; tap k is at tick first + k (modulo the
+    // FFT size) of a unit charge at tick 0.
+    struct DirectKernel {
+      int                 first = 0;
+      std::vector<double> taps;
+    };
+
+    // Batch deconvolution with kernel, and the time offset shift.
+    void DeconvoluteRows(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                         float* data, std::size_t nChannels, util::SBNDBatchFFT& fft,
+                         std::vector<std::complex<float>> const& kernel) const;
+
+    // Fill fDirectKernel, at the end of init().
+    void SetDirectKernels(int nticks);
+
     // Fcl parameters.
+    bool fInitInBeginJob;   ///< Compute the kernels in postBeginJob.
+    double fDirectTolerance;   ///< Response truncation for direct convolution, 0 to disable it.
+    double fDirectCostFactor;  ///< Direct/FFT cost ratio below which direct convolution is used.
     double fDeconNorm;
     double fADCPerPCAtLowestASICGain;    ///Pulse amplitude gain for a 1 pc charge impulse after convoluting it with field and electronics response with the lowest ASIC gain setting of 4.7 mV/fC
 
@@ -148,8 +267,9 @@ namespace util {
     TF1* fIndUFieldFunc;      			///< Parameterized induction field shape function for U plane.
     TF1* fIndVFieldFunc;      			///< Parameterized induction field shape function for V plane.
     
-    TH1 const* fFieldResponseHist[3];           ///< Histogram used to hold the field response, hardcoded for the time being 
-    TH1 const* fFilterHist[3];    		///< Histogram used to hold the collection filter, hardcoded for the time being
+    sbnd::BinnedModelFile fModelFile;           ///< Filter and field response histograms, owned or mapped
+    sbnd::BinnedModelFile::Binned const* fFieldResponseHist[3] = {}; ///< Histogram used to hold the field response, hardcoded for the time being 
+    sbnd::BinnedModelFile::Binned const* fFilterHist[3] = {};        ///< Histogram used to hold the collection filter, hardcoded for the time being
     
     // Following attributes hold the convolution and deconvolution kernels
 
@@ -163,15 +283,28 @@ namespace util {
     std::vector<double> fIndVFieldResponse;
     std::vector<double> fColFieldResponse;
 
-    // Electronics response.
-
-    std::vector<double> fElectResponse;
-
     // Filters.
 
     std::vector<TComplex> fIndUFilter;
     std::vector<TComplex> fIndVFilter;
     std::vector<TComplex> fColFilter;
+
+    // Per-channel lookup table.
+    std::vector<ChannelInfo> fChannelInfo;
+
+    // Single precision kernels for the batch interface, per view (U, V, Z).
+    std::array<std::vector<std::complex<float>>, 3> fConvKernelF;
+    std::array<std::vector<std::complex<float>>, 3> fDeconvKernelF;
+
+    // Deconvolution kernels divided by fDeconNorm, per view (U, V, Z).
+    std::array<std::vector<TComplex>, 3> fDeconvNormKernel;
+    std::array<std::vector<std::complex<float>>, 3> fDeconvNormKernelF;
+
+    // Truncated responses for direct convolution, per view (U, V, Z),
+    // and the largest number of multiply-adds worth doing instead of an FFT.
+    std::array<DirectKernel, 3> fDirectKernel;
+    int fDirectSize = 0;
+    double fDirectMaxOps = 0.;
   };
 }
 //----------------------------------------------------------------------
@@ -179,8 +312,55 @@ namespace util {
 template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo::DetectorClocksData const& clockData,
                                                                          unsigned int channel, std::vector<T>& func) const
 {
+  if(ConvoluteDirect(clockData, channel, func)) return;
   SignalShaping(channel).Convolute(func);
+  ShiftConvoluted(clockData, channel, func);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo::DetectorClocksData const& clockData,
+                                                                         unsigned int channel, std::vector<T>& func,
+                                                                         util::SBNDFFTWorker& fft) const
+{
+  if(ConvoluteDirect(clockData, channel, func)) return;
+  fft.Convolute(func, SignalShaping(channel).ConvKernel());
+  ShiftConvoluted(clockData, channel, func);
+}
+
+template <class T> inline bool util::SignalShapingServiceSBND::ConvoluteDirect(detinfo::DetectorClocksData const& clockData,
+                                                                               unsigned int channel, std::vector<T>& func) const
+{
+  if(fDirectTolerance <= 0.) return false;
+  DirectKernel const& kernel = fDirectKernel[ViewIndex(GetChannelInfo(channel).view)];
+  int const nticks = func.size();
+  if(kernel.taps.empty() || nticks != fDirectSize) return false;
+
+  // ticks with charge, given up on as soon as the FFT is cheaper
+  std::size_t const maxCharged = static_cast<std::size_t>(fDirectMaxOps / kernel.taps.size());
+  std::vector<std::pair<int, T>> charged;
+  for(int t = 0; t < nticks; ++t) {
+    if(func[t] == T(0)) continue;
+    if(charged.size() >= maxCharged) return false;
+    charged.emplace_back(t, func[t]);
+  }
+
+  // circular convolution, as the FFT does
+  std::fill(func.begin(), func.end(), T(0));
+  int const ntaps = kernel.taps.size();
+  for(auto const& [tick, charge] : charged) {
+    int start = (tick + kernel.first) % nticks;
+    if(start < 0) start += nticks;
+    int const head = std::min(ntaps, nticks - start);
+    for(int k = 0; k < head; ++k) func[start + k] += charge*kernel.taps[k];
+    for(int k = head; k < ntaps; ++k) func[k - head] += charge*kernel.taps[k];
+  }
+
+  ShiftConvoluted(clockData, channel, func);
+  return true;
+}
 
+template <class T> inline void util::SignalShapingServiceSBND::ShiftConvoluted(detinfo::DetectorClocksData const& clockData,
+                                                                               unsigned int channel, std::vector<T>& func) const
+{
   //negative number;
   int time_offset = FieldResponseTOffset(clockData, channel);
   
@@ -203,7 +383,28 @@ template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detin
                                                                            unsigned int channel, std::vector<T>& func) const
 {
   SignalShaping(channel).Deconvolute(func);
-  
+  ShiftDeconvoluted(clockData, channel, func);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detinfo::DetectorClocksData const& clockData,
+                                                                           unsigned int channel, std::vector<T>& func,
+                                                                           util::SBNDFFTWorker& fft) const
+{
+  fft.Convolute(func, SignalShaping(channel).DeconvKernel());
+  ShiftDeconvoluted(clockData, channel, func);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::DeconvoluteNormalized(detinfo::DetectorClocksData const& clockData,
+                                                                                     unsigned int channel, std::vector<T>& func,
+                                                                                     util::SBNDFFTWorker& fft) const
+{
+  fft.Convolute(func, fDeconvNormKernel[ViewIndex(GetChannelInfo(channel).view)]);
+  ShiftDeconvoluted(clockData, channel, func);
+}
+
+template <class T> inline void util::SignalShapingServiceSBND::ShiftDeconvoluted(detinfo::DetectorClocksData const& clockData,
+                                                                                 unsigned int channel, std::vector<T>& func) const
+{
   //negative number;
   int time_offset = FieldResponseTOffset(clockData, channel);
   
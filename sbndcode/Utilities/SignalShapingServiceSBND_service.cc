@@ -4,6 +4,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
@@ -15,14 +16,23 @@
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "lardata/Utilities/LArFFT.h"
 #include "TFile.h"
+#include "TH1.h"
+
+#include "tbb/parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
 //----------------------------------------------------------------------
 // Constructor.
 util::SignalShapingServiceSBND::SignalShapingServiceSBND(const fhicl::ParameterSet& pset,
-								    art::ActivityRegistry& /* reg */) 
+								    art::ActivityRegistry& reg) 
   : fInit(false)
 {
   reconfigure(pset);
+  if(fInitInBeginJob)
+    reg.sPostBeginJob.watch(this, &SignalShapingServiceSBND::postBeginJob);
 }
 
 
@@ -48,6 +58,9 @@ void util::SignalShapingServiceSBND::reconfigure(const fhicl::ParameterSet& pset
 
   // Fetch fcl parameters.
 
+  fInitInBeginJob = pset.get<bool>("InitInBeginJob", false);
+  fDirectTolerance = pset.get<double>("DirectConvolutionTolerance", 0.);
+  fDirectCostFactor = pset.get<double>("DirectConvolutionCostFactor", 1.);
   fDeconNorm = pset.get<double>("DeconNorm");
   fADCPerPCAtLowestASICGain = pset.get<double>("ADCPerPCAtLowestASICGain");
   fASICGainInMVPerFC = pset.get<std::vector<double> >("ASICGainInMVPerFC");
@@ -96,41 +109,6 @@ void util::SignalShapingServiceSBND::reconfigure(const fhicl::ParameterSet& pset
     fIndVFilterFunc = new TF1("indVFilter", indVFilt.c_str());
     for(unsigned int i=0; i<indVFiltParams.size(); ++i)
       fIndVFilterFunc->SetParameter(i, indVFiltParams[i]);
-  } else {
-    constexpr unsigned int NPlanes = 3;
-    
-    std::string histoname = pset.get<std::string>("FilterHistoName");
-    mf::LogInfo("SignalShapingServiceSBND") << " using filter from .root file " ;
-   
-    // constructor decides if initialized value is a path or an environment variable
-    std::string fname;
-    cet::search_path sp("FW_SEARCH_PATH");
-    auto requestedFilterFunctionPath = pset.get<std::string>("FilterFunctionFname");
-    if (!sp.find_file(requestedFilterFunctionPath, fname)) {
-      throw art::Exception(art::errors::Configuration)
-        << "Filter function file '" << requestedFilterFunctionPath
-        << "' not found in FW_SEARCH_PATH";
-    }
-    
-    TFile in(fname.c_str(), "READ");
-    if (!in.IsOpen()) {
-      throw cet::exception("SignalShapingServiceSBND")
-        << "Can't open filter function file '" << fname << "'!\n";
-    }
-    mf::LogInfo("SignalShapingServiceSBND")
-      << "Reading filter histograms from '" << fname << "'";
-    for(unsigned int i = 0; i < NPlanes; ++i) {
-      auto pHist = dynamic_cast<TH1*>(in.Get(Form(histoname.c_str(),i)));
-      if (!pHist) {
-        // this happens also if there is an object but it's not a TH1
-        throw cet::exception("SignalShapingServiceSBND")
-          << "Can't find filter histogram '" << histoname << "' for plane #" << i
-          << " in '" << fname << "'!\n";
-      }
-      pHist->SetDirectory(nullptr); // detach the histogram from its source file
-      fFilterHist[i] = pHist;
-    }
-    in.Close();
   }
  
   /////////////////////////////////////
@@ -158,58 +136,137 @@ void util::SignalShapingServiceSBND::reconfigure(const fhicl::ParameterSet& pset
       fIndVFieldFunc->SetParameter(i, indVFieldParams[i]);
     // Warning, last parameter needs to be multiplied by the FFTSize, in current version of the code,
 
-  } else if (fUseHistogramFieldShape){
-    constexpr unsigned int NPlanes = 3;
+  }
+
+  if(fGetFilterFromHisto || fUseHistogramFieldShape) LoadModelHistograms(pset);
+
+}
 
-    //constructor decides if initialized value is a path or an environment variable
-    std::string fname;
-    cet::search_path sp("FW_SEARCH_PATH");
+
+//----------------------------------------------------------------------
+// Read the filter and field response histograms, from the flat model file
+// when it was made from the same input, from the ROOT files otherwise.
+void util::SignalShapingServiceSBND::LoadModelHistograms(const fhicl::ParameterSet& pset)
+{
+  constexpr unsigned int NPlanes = 3;
+  const std::string iPlane[3] = {"U", "V", "Y"};
+  cet::search_path sp("FW_SEARCH_PATH");
+  fModelFile.clear();
+
+  // constructor decides if initialized value is a path or an environment variable
+  std::string filterFname, filterHistoName;
+  if(fGetFilterFromHisto) {
+    filterHistoName = pset.get<std::string>("FilterHistoName");
+    auto requestedFilterFunctionPath = pset.get<std::string>("FilterFunctionFname");
+    if (!sp.find_file(requestedFilterFunctionPath, filterFname)) {
+      throw art::Exception(art::errors::Configuration)
+        << "Filter function file '" << requestedFilterFunctionPath
+        << "' not found in FW_SEARCH_PATH";
+    }
+  }
+  std::string fieldFname, fieldHistoName;
+  if(fUseHistogramFieldShape) {
+    fieldHistoName = pset.get<std::string>("FieldResponseHistoName");
     auto requestedFieldResponsePath = pset.get<std::string>("FieldResponseFname");
-    if (!sp.find_file(requestedFieldResponsePath, fname)) {
+    if (!sp.find_file(requestedFieldResponsePath, fieldFname)) {
       throw art::Exception(art::errors::Configuration)
         << "Field response file '" << requestedFieldResponsePath
         << "' not found in FW_SEARCH_PATH";
     }
-    std::string histoname = pset.get<std::string>("FieldResponseHistoName");
-    
+  }
+
+  std::string const modelFile = pset.get<std::string>("ModelFlatFile", "");
+  std::uint64_t const input = sbnd::BinnedModelFile::checksum({
+    fGetFilterFromHisto ? sbnd::BinnedModelFile::fileStamp(filterFname) : "", filterHistoName,
+    fUseHistogramFieldShape ? sbnd::BinnedModelFile::fileStamp(fieldFname) : "", fieldHistoName });
+
+  if(!modelFile.empty() && fModelFile.read(modelFile, input)) {
     mf::LogInfo("SignalShapingServiceSBND")
-      << "Using the field response provided from '" << fname
-      << "' (histograms '" << histoname << "_*')";
+      << "Reading the filter and field response histograms from '" << modelFile << "'";
+  }
+  else {
+    // copies a histogram into the model file, with its under- and overflow
+    auto addHist = [this](std::string const& name, TH1 const& hist) {
+      std::vector<double> contents(hist.GetNbinsX() + 2);
+      for(int ibin = 0; ibin < hist.GetNbinsX() + 2; ++ibin) contents[ibin] = hist.GetBinContent(ibin);
+      fModelFile.add(name, hist.GetNbinsX(), hist.GetXaxis()->GetXmin(), hist.GetXaxis()->GetXmax(), contents.data());
+    };
 
-    TFile fin(fname.c_str(), "READ");
-    if ( !fin.IsOpen() ) {
-      throw cet::exception("SignalShapingServiceSBND")
-        << "Could not find the field response file '" << fname << "'!\n";
+    if(fGetFilterFromHisto) {
+      mf::LogInfo("SignalShapingServiceSBND") << " using filter from .root file " ;
+
+      TFile in(filterFname.c_str(), "READ");
+      if (!in.IsOpen()) {
+        throw cet::exception("SignalShapingServiceSBND")
+          << "Can't open filter function file '" << filterFname << "'!\n";
+      }
+      mf::LogInfo("SignalShapingServiceSBND")
+        << "Reading filter histograms from '" << filterFname << "'";
+      for(unsigned int i = 0; i < NPlanes; ++i) {
+        std::unique_ptr<TH1> pHist(dynamic_cast<TH1*>(in.Get(Form(filterHistoName.c_str(),i))));
+        if (!pHist) {
+          // this happens also if there is an object but it's not a TH1
+          throw cet::exception("SignalShapingServiceSBND")
+            << "Can't find filter histogram '" << filterHistoName << "' for plane #" << i
+            << " in '" << filterFname << "'!\n";
+        }
+        pHist->SetDirectory(nullptr); // detach the histogram from its source file
+        addHist("filter_" + std::to_string(i), *pHist);
+      }
+      in.Close();
     }
 
-    const std::string iPlane[3] = {"U", "V", "Y"};
+    if(fUseHistogramFieldShape) {
+      mf::LogInfo("SignalShapingServiceSBND")
+        << "Using the field response provided from '" << fieldFname
+        << "' (histograms '" << fieldHistoName << "_*')";
 
-    for(unsigned int i = 0; i < NPlanes; ++i) {
-      std::string PlaneHistoName = histoname + "_" + iPlane[i];
-      MF_LOG_DEBUG("SignalShapingServiceSBND")
-        << "Field Response " << i << ": " << PlaneHistoName;
-      
-      auto pHist = dynamic_cast<TH1*>(fin.Get(PlaneHistoName.c_str()));
-      if (!pHist) {
+      TFile fin(fieldFname.c_str(), "READ");
+      if ( !fin.IsOpen() ) {
         throw cet::exception("SignalShapingServiceSBND")
-          << "Could not find the field response histogram '" << PlaneHistoName
-          << "' in file '" << fname << "'\n";
-      } 
-      if (pHist->GetNbinsX() > fNFieldBins) {
+          << "Could not find the field response file '" << fieldFname << "'!\n";
+      }
+
+      for(unsigned int i = 0; i < NPlanes; ++i) {
+        std::string PlaneHistoName = fieldHistoName + "_" + iPlane[i];
+        MF_LOG_DEBUG("SignalShapingServiceSBND")
+          << "Field Response " << i << ": " << PlaneHistoName;
+
+        std::unique_ptr<TH1> pHist(dynamic_cast<TH1*>(fin.Get(PlaneHistoName.c_str())));
+        if (!pHist) {
+          throw cet::exception("SignalShapingServiceSBND")
+            << "Could not find the field response histogram '" << PlaneHistoName
+            << "' in file '" << fieldFname << "'\n";
+        }
+        pHist->SetDirectory(nullptr); // detach the histogram from his source file
+        addHist("field_" + iPlane[i], *pHist);
+      }
+
+      fin.Close();
+    }
+
+    if(!modelFile.empty() && !fModelFile.write(modelFile, input)) {
+      mf::LogWarning("SignalShapingServiceSBND")
+        << "Could not write the filter and field response histograms to '" << modelFile << "'";
+    }
+  }
+
+  for(unsigned int i = 0; i < NPlanes; ++i) {
+    if(fGetFilterFromHisto) fFilterHist[i] = fModelFile.find("filter_" + std::to_string(i));
+    if(fUseHistogramFieldShape) {
+      sbnd::BinnedModelFile::Binned const* pHist = fModelFile.find("field_" + iPlane[i]);
+      if (pHist && pHist->GetNbinsX() > fNFieldBins) {
         throw art::Exception( art::errors::Configuration ) << "FieldBins (" << fNFieldBins
           << ") should always be larger than or equal to the number of the bins in the input histogram ("
-          << pHist->GetNbinsX() << " in '" << PlaneHistoName << "')!\n";
+          << pHist->GetNbinsX() << " in '" << fieldHistoName << "_" << iPlane[i] << "')!\n";
       }
-      pHist->SetDirectory(nullptr); // detach the histogram from his source file
-      
       fFieldResponseHist[i] = pHist;
-      MF_LOG_DEBUG("SignalShapingServiceSBND")
-        << "RESPONSE HISTOGRAM " << iPlane[i] << ": " << pHist->GetEntries() << " entries in "
-        << pHist->GetNbinsX() << " bins (" << pHist->GetBinLowEdge(1)
-        << " to " << pHist->GetBinLowEdge(pHist->GetNbinsX() + 1);
+      if (pHist) {
+        MF_LOG_DEBUG("SignalShapingServiceSBND")
+          << "RESPONSE HISTOGRAM " << iPlane[i] << ": " << pHist->GetNbinsX() << " bins ("
+          << pHist->GetBinLowEdge(1) << " to " << pHist->GetBinLowEdge(pHist->GetNbinsX() + 1);
+      }
     }
-
-    fin.Close();
   }
 
 }
@@ -219,52 +276,37 @@ void util::SignalShapingServiceSBND::reconfigure(const fhicl::ParameterSet& pset
 // Accessor for single-plane signal shaper.
 const util::SignalShaping&
 util::SignalShapingServiceSBND::SignalShaping(unsigned int channel) const
+{
+  return *GetChannelInfo(channel).shaping;
+}
+
+//----------------------------------------------------------------------
+// Per-channel lookup.
+util::SignalShapingServiceSBND::ChannelInfo const&
+util::SignalShapingServiceSBND::GetChannelInfo(unsigned int const channel) const
 {
   if(!fInit)
     init();
 
-  //  art::ServiceHandle<geo::Geometry> geom;
-
-  // Figure out plane type.
-  // we need to distiguish the U and V planes
-  geo::View_t view = GetView(channel);
+  if(channel >= fChannelInfo.size())
+    throw cet::exception("SignalShapingServiceSBND") << "Invalid channel " << channel << "\n";
 
-  // Return appropriate shaper.
-  //geo::SigType_t sigtype = geom->SignalType(channel);
-
-  if (view == geo::kU)
-    return fIndUSignalShaping;
-  else if (view == geo::kV)
-    return fIndVSignalShaping;
-  else if (view == geo::kZ)
-    return fColSignalShaping;
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "1 can't determine"
-                                                          << " SignalType\n";  
-  
-
-  return fColSignalShaping;
+  return fChannelInfo[channel];
 }
 
 //---Give Gain Settings to SimWire ---//
 double util::SignalShapingServiceSBND::GetASICGain(unsigned int const channel) const
 {
-  // we need to distiguish the U and V planes
-  geo::View_t view = GetView(channel);
-
-  double gain = 0.0;
-  if(view == geo::kU)
-    gain = fASICGainInMVPerFC.at(0);
-  else if(view == geo::kV)
-     gain = fASICGainInMVPerFC.at(1);
-  else if(view == geo::kZ)
-    gain = fASICGainInMVPerFC.at(2);
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "2 can't determine"
-                                                    << " SignalType\n";
-  return gain;
+  return GetChannelInfo(channel).asicGain;
 } 
 
+//---Noise factor used by the noise services ---//
+double util::SignalShapingServiceSBND::GetNoiseFactor(unsigned int const channel, std::size_t shapingIndex) const
+{
+  ChannelInfo const& info = GetChannelInfo(channel);
+  return info.noiseFact->at(shapingIndex)*info.asicGain/4.7;
+}
+
 // //---Give Shaping time Settings to SimWire ---//
 // double util::SignalShapingServiceSBND::GetShapingTime(unsigned int const channel) const
 // {
@@ -286,23 +328,18 @@ double util::SignalShapingServiceSBND::GetASICGain(unsigned int const channel) c
 
 double util::SignalShapingServiceSBND::GetRawNoise(unsigned int const channel) const
 {
-  unsigned int plane;
-//  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
-
-  // we need to distiguish the U and V planes
-  geo::View_t view = GetView(channel);
+  return GetChannelInfo(channel).rawNoise;
+}
 
-  if(view == geo::kU)
-    plane = 0;
-  else if(view == geo::kV)
-    plane = 1;
-  else if(view == geo::kZ)
-    plane = 2;
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "4 can't determine"
-                                                    << " SignalType\n";
+double util::SignalShapingServiceSBND::GetDeconNoise(unsigned int const channel) const
+{
+  return GetChannelInfo(channel).deconNoise;
+}
 
+//----------------------------------------------------------------------
+// Noise of the U (0), V (1) and Z (2) planes.
+double util::SignalShapingServiceSBND::ComputeRawNoise(std::size_t plane) const
+{
   double shapingtime = fShapeTimeConst.at(plane);
   double gain = fASICGainInMVPerFC.at(plane);
   int temp;
@@ -324,25 +361,8 @@ double util::SignalShapingServiceSBND::GetRawNoise(unsigned int const channel) c
   return rawNoise;
 }
 
-double util::SignalShapingServiceSBND::GetDeconNoise(unsigned int const channel) const
+double util::SignalShapingServiceSBND::ComputeDeconNoise(std::size_t plane) const
 {
-  unsigned int plane;
-//  art::ServiceHandle<geo::Geometry> geom;
-  //geo::SigType_t sigtype = geom->SignalType(channel);
-
-  // we need to distiguish the U and V planes
-  geo::View_t view = GetView(channel);
-
-  if(view == geo::kU)
-    plane = 0;
-  else if(view == geo::kV)
-    plane = 1;
-  else if(view == geo::kZ)
-    plane = 2;
-  else
-    throw cet::exception("SignalShapingServiceSBND")<< "5 can't determine"
-                                                    << " SignalType\n";
-
   double shapingtime = fShapeTimeConst.at(plane);
   int temp;
   if (shapingtime == 0.5){
@@ -364,7 +384,42 @@ double util::SignalShapingServiceSBND::GetDeconNoise(unsigned int const channel)
   return deconNoise;
 }
 
+//----------------------------------------------------------------------
+// Fill the per-channel lookup table.
+void util::SignalShapingServiceSBND::SetChannelInfo()
+{
+  art::ServiceHandle<geo::Geometry> geo;
+
+  util::SignalShaping const* shapers[3] = { &fIndUSignalShaping, &fIndVSignalShaping, &fColSignalShaping };
+
+  ChannelInfo planeInfo[3];
+  for(size_t plane = 0; plane < 3; ++plane) {
+    planeInfo[plane].plane = plane;
+    planeInfo[plane].asicGain = fASICGainInMVPerFC.at(plane);
+    planeInfo[plane].rawNoise = ComputeRawNoise(plane);
+    planeInfo[plane].deconNoise = ComputeDeconNoise(plane);
+    planeInfo[plane].noiseFact = &fNoiseFactVec.at(plane);
+    planeInfo[plane].shaping = shapers[plane];
+  }
+  planeInfo[0].view = geo::kU;
+  planeInfo[1].view = geo::kV;
+  planeInfo[2].view = geo::kZ;
+
+  fChannelInfo.resize(geo->Nchannels());
+  for(unsigned int chan = 0; chan < geo->Nchannels(); ++chan) {
+    geo::View_t view = GetView(chan);
+    if(view != geo::kU && view != geo::kV && view != geo::kZ)
+      throw cet::exception("SignalShapingServiceSBND") << "can't determine view of channel " << chan << "\n";
+    fChannelInfo[chan] = planeInfo[ViewIndex(view)];
+  }
+}
 
+//----------------------------------------------------------------------
+// With InitInBeginJob, the kernels are ready before the first event.
+void util::SignalShapingServiceSBND::postBeginJob()
+{
+  init();
+}
 
 //----------------------------------------------------------------------
 // Initialization method.
@@ -372,8 +427,10 @@ double util::SignalShapingServiceSBND::GetDeconNoise(unsigned int const channel)
 // All public methods should ensure that this method is called as necessary.
 void util::SignalShapingServiceSBND::init()
 {
+  // the first caller computes the kernels, the others wait for them
+  std::lock_guard<std::mutex> lock(fInitMutex);
   if(!fInit) {
-    fInit = true;
+    sbnd::startup::Span span("SignalShapingServiceSBND::init");
 
     // Do microboone-specific configuration of SignalShaping by providing
     // microboone response and filter functions.
@@ -381,28 +438,33 @@ void util::SignalShapingServiceSBND::init()
     // Calculate field and electronics response functions.
 
     SetFieldResponse();
-    SetElectResponse(fShapeTimeConst.at(2),fASICGainInMVPerFC.at(2));
+
+    // the electronics response of each plane depends only on its own
+    // shaping time and gain, so the three are computed concurrently
+    int const nticks = art::ServiceHandle<util::LArFFT>()->FFTSize();
+    std::array<std::vector<double>, 3> electResponse;
+    tbb::parallel_for(std::size_t(0), std::size_t(3), [&](std::size_t plane) {
+      electResponse[plane] = ElectResponse(fShapeTimeConst.at(plane), fASICGainInMVPerFC.at(plane), nticks);
+    });
 
     // Configure convolution kernels.
+    // util::SignalShaping does its FFTs with the shared LArFFT service,
+    // so the planes are set up one after the other.
 
     fColSignalShaping.AddResponseFunction(fColFieldResponse);
-    fColSignalShaping.AddResponseFunction(fElectResponse);
+    fColSignalShaping.AddResponseFunction(electResponse[2]);
     fColSignalShaping.save_response();
     fColSignalShaping.set_normflag(false);
     //fColSignalShaping.SetPeakResponseTime(0.);
 
-    SetElectResponse(fShapeTimeConst.at(0),fASICGainInMVPerFC.at(0));
-
     fIndUSignalShaping.AddResponseFunction(fIndUFieldResponse);
-    fIndUSignalShaping.AddResponseFunction(fElectResponse);
+    fIndUSignalShaping.AddResponseFunction(electResponse[0]);
     fIndUSignalShaping.save_response();
     fIndUSignalShaping.set_normflag(false);
     //fIndUSignalShaping.SetPeakResponseTime(0.);
 
-    SetElectResponse(fShapeTimeConst.at(1),fASICGainInMVPerFC.at(1));
-
     fIndVSignalShaping.AddResponseFunction(fIndVFieldResponse);
-    fIndVSignalShaping.AddResponseFunction(fElectResponse);
+    fIndVSignalShaping.AddResponseFunction(electResponse[1]);
     fIndVSignalShaping.save_response();
     fIndVSignalShaping.set_normflag(false);
     //fIndVSignalShaping.SetPeakResponseTime(0.);
@@ -423,10 +485,84 @@ void util::SignalShapingServiceSBND::init()
 
     fIndVSignalShaping.AddFilterFunction(fIndVFilter);
     fIndVSignalShaping.CalculateDeconvKernel();
+
+    // Single precision copies of the kernels for batch (de)convolution.
+
+    util::SignalShaping const* shapers[3] = { &fIndUSignalShaping, &fIndVSignalShaping, &fColSignalShaping };
+    for(size_t iview = 0; iview < 3; ++iview) {
+      std::vector<TComplex> const& conv = shapers[iview]->ConvKernel();
+      std::vector<TComplex> const& deconv = shapers[iview]->DeconvKernel();
+      fConvKernelF[iview].resize(conv.size());
+      for(size_t i = 0; i < conv.size(); ++i)
+        fConvKernelF[iview][i] = std::complex<float>(conv[i].Re(), conv[i].Im());
+      fDeconvKernelF[iview].resize(deconv.size());
+      for(size_t i = 0; i < deconv.size(); ++i)
+        fDeconvKernelF[iview][i] = std::complex<float>(deconv[i].Re(), deconv[i].Im());
+
+      // deconvolution kernels with DeconNorm folded in
+      fDeconvNormKernel[iview].resize(deconv.size());
+      fDeconvNormKernelF[iview].resize(deconv.size());
+      for(size_t i = 0; i < deconv.size(); ++i) {
+        fDeconvNormKernel[iview][i] = deconv[i] / fDeconNorm;
+        fDeconvNormKernelF[iview][i] = std::complex<float>(fDeconvNormKernel[iview][i].Re(), fDeconvNormKernel[iview][i].Im());
+      }
+    }
+
+    SetDirectKernels(nticks);
+
+    SetChannelInfo();
+
+    fInit.store(true, std::memory_order_release);
   }
 }
 
 
+//----------------------------------------------------------------------
+// Truncated impulse responses for the direct convolution of sparse channels.
+void util::SignalShapingServiceSBND::SetDirectKernels(int nticks)
+{
+  fDirectSize = nticks;
+  // the FFT convolution costs about two transforms of N log2(N)
+  fDirectMaxOps = fDirectCostFactor * nticks * std::log2(std::max(nticks, 2));
+  if(fDirectTolerance <= 0.) return;
+
+  util::SBNDFFTWorker fft(nticks);
+  util::SignalShaping const* shapers[3] = { &fIndUSignalShaping, &fIndVSignalShaping, &fColSignalShaping };
+  for(size_t iview = 0; iview < 3; ++iview) {
+    DirectKernel& kernel = fDirectKernel[iview];
+    kernel.first = 0;
+    kernel.taps.clear();
+
+    // response to a unit charge at tick 0, with the FFT kernel itself
+    std::vector<double> response(nticks, 0.);
+    response[0] = 1.;
+    fft.Convolute(response, shapers[iview]->ConvKernel());
+
+    double peak = 0.;
+    for(double value : response) peak = std::max(peak, std::abs(value));
+    if(peak <= 0.) continue;
+    double const cut = fDirectTolerance * peak;
+
+    // keep the shortest circular window with all the ticks above the cut:
+    // the complement of the longest run of ticks below it
+    int gapStart = 0, gapLength = 0, runStart = 0, runLength = 0;
+    for(int i = 0; i < 2*nticks && gapLength < nticks; ++i) {
+      if(std::abs(response[i % nticks]) > cut) { runLength = 0; continue; }
+      if(runLength++ == 0) runStart = i;
+      if(runLength > gapLength) { gapLength = std::min(runLength, nticks); gapStart = runStart; }
+    }
+    int const start = (gapStart + gapLength) % nticks;
+    kernel.taps.resize(nticks - gapLength);
+    for(size_t k = 0; k < kernel.taps.size(); ++k)
+      kernel.taps[k] = response[(start + k) % nticks];
+    kernel.first = (start > nticks/2) ? start - nticks : start;
+
+    mf::LogInfo("SignalShapingServiceSBND") << "Direct convolution response of view " << iview
+                                            << ": " << kernel.taps.size() << " ticks from tick "
+                                            << kernel.first;
+  }
+}
+
 //----------------------------------------------------------------------
 // Calculate microboone field response.
 void util::SignalShapingServiceSBND::SetFieldResponse()
@@ -646,18 +782,12 @@ void util::SignalShapingServiceSBND::SetFieldResponse()
 
 
 //----------------------------------------------------------------------
-// Calculate microboone field response.
-void util::SignalShapingServiceSBND::SetElectResponse(double shapingtime, double gain)
+// Calculate microboone electronics response, over nticks ticks.
+std::vector<double> util::SignalShapingServiceSBND::ElectResponse(double shapingtime, double gain, int nticks) const
 {
-  // Get services.
-
-  art::ServiceHandle<geo::Geometry> geo;
-  art::ServiceHandle<util::LArFFT> fft;
-
   MF_LOG_DEBUG("SignalShapingSBND") << "Setting SBND electronics response function...";
 
-  int nticks = fft->FFTSize();
-  fElectResponse.resize(nticks, 0.);
+  std::vector<double> electResponse(nticks, 0.);
   std::vector<double> time(nticks,0.);
 
   //Gain and shaping time variables from fcl file:    
@@ -680,11 +810,11 @@ void util::SignalShapingServiceSBND::SetElectResponse(double shapingtime, double
   // actual electronics response. Default params are Ao=1.4, To=0.5us. 
   double max=0.;
   
-  for(size_t i = 0; i < fElectResponse.size(); ++i){
+  for(size_t i = 0; i < electResponse.size(); ++i){
 
-    //convert time to microseconds, to match fElectResponse[i] definition
+    //convert time to microseconds, to match electResponse[i] definition
     time[i] = (1.*i)*fInputFieldRespSamplingPeriod*1e-3; 
-    fElectResponse[i] = 
+    electResponse[i] = 
       4.31054*exp(-2.94809*time[i]/To)*Ao - 2.6202*exp(-2.82833*time[i]/To)*cos(1.19361*time[i]/To)*Ao
       -2.6202*exp(-2.82833*time[i]/To)*cos(1.19361*time[i]/To)*cos(2.38722*time[i]/To)*Ao
       +0.464924*exp(-2.40318*time[i]/To)*cos(2.5928*time[i]/To)*Ao
@@ -698,24 +828,24 @@ void util::SignalShapingServiceSBND::SetElectResponse(double shapingtime, double
       -0.327684*exp(-2.40318*time[i]/To)*cos(2.5928*time[i]/To)*sin(5.18561*time[i]/To)*Ao
       +0.464924*exp(-2.40318*time[i]/To)*sin(2.5928*time[i]/To)*sin(5.18561*time[i]/To)*Ao;
 
-      if(fElectResponse[i] > max) max = fElectResponse[i];
+      if(electResponse[i] > max) max = electResponse[i];
   }// end loop over time buckets
     
   MF_LOG_DEBUG("SignalShapingSBND") << " Done.";
 
-  // normalize fElectResponse[i], before the convolution
+  // normalize electResponse[i], before the convolution
   // Put in overall normalization in a pedantic way:
   // first put in the pulse area per eleectron at the lowest gain setting,
   // then normalize by the actual ASIC gain setting used.
   // This code is executed only during initialization of service,
   // so don't worry about code inefficiencies here.
-  for(auto& element : fElectResponse){
+  for(auto& element : electResponse){
      element /= max;
      element *= fADCPerPCAtLowestASICGain*1.60217657e-7;
      element *= gain/4.7;
    }
    
-  return;
+  return electResponse;
 
 }
 
@@ -831,25 +961,21 @@ void util::SignalShapingServiceSBND::SetResponseSampling()
     Much more sophisticated approach using a linear (trapezoidal) interpolation
     current deafult!
   */
+  // both time axes increase, so the first input time not before the
+  // sampling time only moves forward: one pass over the input
   int SamplingCount = 0;
+  int jtime = 0;
   for(int itime = 0; itime < nticks; itime++) {
-    int low = -1, up = -1;
-    for(int jtime = 0; jtime < nticks; jtime++) {
-      if(InputTime[jtime] == SamplingTime[itime]) {
-	SamplingResp[itime] = (*pResp)[jtime];
-	SamplingCount++;
-	break;
-      } else if(InputTime[jtime] > SamplingTime[itime]) {
-	low = jtime - 1;
-	up = jtime;
-	SamplingResp[itime] = (*pResp)[low] + (SamplingTime[itime] - InputTime[low]) * ( (*pResp)[up] - (*pResp)[low]) / (InputTime[up] - InputTime[low] );
-	SamplingCount++;
-	break;
-      } else {
-	SamplingResp[itime] = 0;
-      }
-    }// for(int jtime = 0; jtime < nticks; jtime++)
-    
+    while(jtime < nticks && InputTime[jtime] < SamplingTime[itime]) ++jtime;
+    if(jtime == nticks) break;
+    if(InputTime[jtime] == SamplingTime[itime]) {
+      SamplingResp[itime] = (*pResp)[jtime];
+    } else {
+      int low = jtime - 1;
+      int up = jtime;
+      SamplingResp[itime] = (*pResp)[low] + (SamplingTime[itime] - InputTime[low]) * ( (*pResp)[up] - (*pResp)[low]) / (InputTime[up] - InputTime[low] );
+    }
+    SamplingCount++;
   }// for(int itime = 0; itime < nticks; itime++)
 
   SamplingResp.resize(SamplingCount, 0.);
@@ -868,23 +994,85 @@ void util::SignalShapingServiceSBND::SetResponseSampling()
 int util::SignalShapingServiceSBND::FieldResponseTOffset(detinfo::DetectorClocksData const& clockData,
                                                          unsigned int const channel) const
 {
-  //art::ServiceHandle<geo::Geometry> geom;
-  geo::View_t view = GetView(channel);
+  return ViewTOffset(clockData, GetChannelInfo(channel).view);
+}
+
+int util::SignalShapingServiceSBND::ViewTOffset(detinfo::DetectorClocksData const& clockData,
+                                                geo::View_t view) const
+{
+  double time_offset = fFieldResponseTOffset.at(ViewIndex(view));
+// std::cout << "TIME OFFSET" << 	time_offset << " " << view << std::endl;
+
+  auto tpc_clock = clockData.TPCClock();
+  return tpc_clock.Ticks(time_offset/1.e3);
+}
 
-  double time_offset = 0;
+std::size_t util::SignalShapingServiceSBND::ViewIndex(geo::View_t view)
+{
   if(view == geo::kU)
-    time_offset = fFieldResponseTOffset.at(0);
+    return 0;
   else if(view == geo::kV)
-    time_offset = fFieldResponseTOffset.at(1);
+    return 1;
   else if(view == geo::kZ)
-    time_offset = fFieldResponseTOffset.at(2);
+    return 2;
   else
     throw cet::exception("SignalShapingServiceSBND")<< "6 can't determine"
                                                     << " SignalType\n";
-// std::cout << "TIME OFFSET" << 	time_offset << " " << view << std::endl;
+}
 
-  auto tpc_clock = clockData.TPCClock();
-  return tpc_clock.Ticks(time_offset/1.e3);
+//----------------------------------------------------------------------
+// Batch convolution: rows of one view share the kernel and the time offset.
+void util::SignalShapingServiceSBND::Convolute(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                                               float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const
+{
+  if(!fInit)
+    init();
+
+  std::size_t const iview = ViewIndex(view);
+  fft.Convolute(data, nChannels, fConvKernelF[iview]);
+
+  // same rotation as ShiftConvoluted
+  int time_offset = ViewTOffset(clockData, view);
+  std::size_t const nticks = fft.FFTSize();
+  for(std::size_t row = 0; row < nChannels; ++row) {
+    float* func = data + row*nticks;
+    if (time_offset <= 0) std::rotate(func, func - time_offset, func + nticks);
+    else                  std::rotate(func, func + nticks - time_offset, func + nticks);
+  }
+}
+
+//----------------------------------------------------------------------
+// Batch deconvolution.
+void util::SignalShapingServiceSBND::Deconvolute(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                                                 float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const
+{
+  if(!fInit)
+    init();
+  DeconvoluteRows(clockData, view, data, nChannels, fft, fDeconvKernelF[ViewIndex(view)]);
+}
+
+void util::SignalShapingServiceSBND::DeconvoluteNormalized(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                                                           float* data, std::size_t nChannels, util::SBNDBatchFFT& fft) const
+{
+  if(!fInit)
+    init();
+  DeconvoluteRows(clockData, view, data, nChannels, fft, fDeconvNormKernelF[ViewIndex(view)]);
+}
+
+void util::SignalShapingServiceSBND::DeconvoluteRows(detinfo::DetectorClocksData const& clockData, geo::View_t view,
+                                                     float* data, std::size_t nChannels, util::SBNDBatchFFT& fft,
+                                                     std::vector<std::complex<float>> const& kernel) const
+{
+  fft.Convolute(data, nChannels, kernel);
+
+  // same rotation as ShiftDeconvoluted
+  int time_offset = ViewTOffset(clockData, view);
+  std::size_t const nticks = fft.FFTSize();
+  for(std::size_t row = 0; row < nChannels; ++row) {
+    float* func = data + row*nticks;
+    if (time_offset <= 0) std::rotate(func, func + nticks + time_offset, func + nticks);
+    else                  std::rotate(func, func + time_offset, func + nticks);
+  }
 }
 
 geo::View_t util::SignalShapingServiceSBND::GetView(unsigned int chan) const {
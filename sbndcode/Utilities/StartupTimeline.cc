@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   StartupTimeline.cc
+///
+/// \brief  Registry of the spans of the job initialisation.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/StartupTimeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+  std::int64_t SteadyNow()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // age of the process from /proc [ns]; negative if it cannot be read
+  std::int64_t ProcessAge()
+  {
+    std::ifstream statFile("/proc/self/stat");
+    std::string const stat{ std::istreambuf_iterator<char>(statFile), std::istreambuf_iterator<char>() };
+    // the command name may hold spaces; the fields after it are plain
+    std::size_t const nameEnd = stat.rfind(')');
+    if (nameEnd == std::string::npos) return -1;
+    std::istringstream fields(stat.substr(nameEnd + 1));
+    std::string field;
+    for (int i = 3; i < 22; ++i) fields >> field; // state ... itrealvalue
+    unsigned long long startTicks = 0;            // field 22: start time since boot
+    double uptime = 0.;
+    std::ifstream uptimeFile("/proc/uptime");
+    if (!(fields >> startTicks) || !(uptimeFile >> uptime)) return -1;
+    double const age = uptime - double(startTicks) / sysconf(_SC_CLK_TCK);
+    return age < 0. ? 0 : std::int64_t(age * 1e9);
+  }
+
+  // steady clock value at the start of the process [ns], to 10 ms
+  std::int64_t SteadyAtProcessStart()
+  {
+    std::int64_t const now = SteadyNow();
+    std::int64_t const age = ProcessAge();
+    return age < 0 ? now : now - age;
+  }
+
+  // CPU time used by the process [ns]
+  std::int64_t ProcessCPUTime()
+  {
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+    return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // current resident memory [kB]
+  std::int64_t ResidentMemory()
+  {
+    static long const pageKB = sysconf(_SC_PAGESIZE) / 1024;
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return std::int64_t(resident) * pageKB;
+  }
+
+  // peak resident memory so far [kB]
+  std::int64_t PeakResidentMemory()
+  {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+  }
+
+  // spans opened on this thread and not closed yet, innermost last
+  std::vector<std::size_t>& OpenSpans()
+  {
+    thread_local std::vector<std::size_t> open;
+    return open;
+  }
+
+} // local namespace
+
+namespace sbnd::startup {
+
+  Probe Probe::Now()
+  {
+    static std::int64_t const processStart = SteadyAtProcessStart();
+    Probe probe;
+    probe.rss = ResidentMemory();
+    probe.peakRSS = PeakResidentMemory();
+    probe.cpuTime = ProcessCPUTime();
+    probe.sinceStart = SteadyNow() - processStart;
+    return probe;
+  }
+
+  Registry& Registry::Instance()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  std::size_t Registry::Open(std::string const& name, std::string const& kind)
+  {
+    Probe const now = Probe::Now();
+    std::vector<std::size_t>& open = OpenSpans();
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fRecords.size() >= MaxSpans()) {
+      ++fDropped;
+      return kNoSpan;
+    }
+    Record& record = fRecords.emplace_back();
+    record.name = name;
+    record.kind = kind;
+    record.depth = open.size();
+    record.start = now.sinceStart;
+    record.cpuTime = now.cpuTime;
+    record.rssBefore = now.rss;
+    std::size_t const span = fRecords.size() - 1;
+    open.push_back(span);
+    return span;
+  }
+
+  void Registry::Close(std::size_t span)
+  {
+    if (span == kNoSpan) return;
+    Probe const now = Probe::Now();
+    std::vector<std::size_t>& open = OpenSpans();
+
+    auto finish = [&now](Record& record) {
+      record.wallTime = now.sinceStart - record.start;
+      record.cpuTime = now.cpuTime - record.cpuTime;
+      record.rssAfter = now.rss;
+      record.peakRSSAfter = now.peakRSS;
+    };
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto const it = std::find(open.begin(), open.end(), span);
+    if (it == open.end()) {
+      // opened on another thread
+      if (!fRecords[span].Closed()) finish(fRecords[span]);
+      return;
+    }
+    // spans left open inside this one (e.g. a module whose construction threw) end with it
+    for (auto inner = it; inner != open.end(); ++inner) finish(fRecords[*inner]);
+    open.erase(it, open.end());
+  }
+
+  std::vector<Record> Registry::Snapshot(std::size_t first) const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (first >= fRecords.size()) return {};
+    return std::vector<Record>(fRecords.begin() + first, fRecords.end());
+  }
+
+  std::size_t Registry::Size() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fRecords.size();
+  }
+
+  std::size_t Registry::Dropped() const
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fDropped;
+  }
+
+} // namespace sbnd::startup
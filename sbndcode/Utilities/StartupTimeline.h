@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   StartupTimeline.h
+///
+/// \brief  Timeline of the job initialisation: construction and
+///         beginJob of the modules, and the expensive set-up steps of
+///         the SBND services, tools and algorithms.
+///
+/// Each span of the timeline records when it started, its wall and CPU
+/// time and the resident memory before and after it. The
+/// StartupTimelineReport service adds a span for the construction and
+/// the beginJob of each module, and writes the timeline out at the first
+/// event; the code adds spans for its own set-up steps with
+///
+///   sbnd::startup::Span span("TPCChannelMapService::ReadMap");
+///
+/// which covers the enclosing scope. Spans opened inside another span
+/// on the same thread are nested under it. The spans are always
+/// recorded: a set-up step runs once or a few times per job, and costs
+/// far more than the three clock and /proc reads of its span. Spans
+/// still opened after the first event (initialisation done on first
+/// use) are reported at the end of the job.
+///
+/// The CPU time and the memory are those of the whole process.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_STARTUPTIMELINE_H
+#define SBNDCODE_UTILITIES_STARTUPTIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sbnd::startup {
+
+  /// One step of the initialisation.
+  struct Record {
+    std::string   name;
+    std::string   kind;             ///< "code", or the module transition
+    unsigned int  depth = 0;        ///< number of spans it is nested in
+    std::int64_t  start = 0;        ///< since the process started [ns]
+    std::int64_t  wallTime = -1;    ///< [ns]; negative while still open
+    std::int64_t  cpuTime = 0;      ///< CPU time of the process [ns]
+    std::int64_t  rssBefore = 0;    ///< resident memory [kB]
+    std::int64_t  rssAfter = 0;     ///< [kB]
+    std::int64_t  peakRSSAfter = 0; ///< peak resident memory [kB]
+
+    bool Closed() const { return wallTime >= 0; }
+  };
+
+  /// Time and memory of the process at one moment.
+  struct Probe {
+    std::int64_t sinceStart = 0; ///< since the process started [ns]
+    std::int64_t cpuTime = 0;    ///< [ns]
+    std::int64_t rss = 0;        ///< [kB]
+    std::int64_t peakRSS = 0;    ///< [kB]
+
+    static Probe Now();
+  };
+
+  class Registry {
+  public:
+    static constexpr std::size_t kNoSpan = static_cast<std::size_t>(-1);
+
+    static Registry& Instance();
+
+    /// Opens a span on this thread; returns its number, or kNoSpan past MaxSpans().
+    std::size_t Open(std::string const& name, std::string const& kind = "code");
+
+    /// Closes the span number `span`, and the spans still open inside it on this thread.
+    void Close(std::size_t span);
+
+    /// Copy of the spans numbered from `first` on, in the order they were opened.
+    std::vector<Record> Snapshot(std::size_t first = 0) const;
+
+    /// Number of spans opened so far.
+    std::size_t Size() const;
+
+    /// Spans not recorded because there were already MaxSpans().
+    std::size_t Dropped() const;
+
+    /// Spans opened past this number are not recorded.
+    static constexpr std::size_t MaxSpans() { return 100000; }
+
+  private:
+    Registry() = default;
+
+    mutable std::mutex      fMutex;
+    std::deque<Record>      fRecords;  ///< deque elements never move
+    std::size_t             fDropped = 0;
+  };
+
+  /// Records the enclosing scope as a span of the timeline.
+  class Span {
+  public:
+    explicit Span(std::string const& name)
+      : fSpan(Registry::Instance().Open(name)) {}
+    ~Span() { Registry::Instance().Close(fSpan); }
+
+    Span(Span const&) = delete;
+    Span& operator=(Span const&) = delete;
+
+  private:
+    std::size_t fSpan;
+  };
+
+} // namespace sbnd::startup
+
+#endif // SBNDCODE_UTILITIES_STARTUPTIMELINE_H
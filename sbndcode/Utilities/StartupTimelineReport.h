@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   StartupTimelineReport.h
+///
+/// \brief  Service reporting, at the first event, where the time and
+///         memory of the job initialisation went.
+///
+/// The timeline (StartupTimeline.h) gets a span for the construction
+/// and the beginJob of the source and of each module, to which the SBND
+/// code adds nested spans for its expensive set-up steps (channel maps,
+/// signal shaping kernels, photon detector map, CRT geometry, template
+/// and noise files...). Each span has its start since the process
+/// started, its wall time, the CPU time of the process meanwhile and the
+/// resident memory before and after it.
+///
+/// At the first event the service writes out all the spans so far, with
+/// the time and memory from the start of the process to the first event
+/// and the part of it no span accounts for (library loading, the
+/// geometry and its GDML, the services constructed before this one...).
+/// Spans opened after the first event, for set-ups done on first use,
+/// are written out at the end of the job.
+///
+/// Put it first in the services table, so that it is constructed before
+/// the other services and sees all their spans.
+///
+/// FCL parameters:
+///
+/// WriteTree    - Fill a tree "startuptimeline" in the TFileService file,
+///                one entry per span, afterFirstEvent telling the spans
+///                opened after the first event (default: true).
+/// JSONFileName - Also write the timeline to this JSON file; none if
+///                empty (default: empty).
+/// PrintSummary - Print the timeline to the message logger (default: true).
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_STARTUPTIMELINEREPORT_H
+#define SBNDCODE_UTILITIES_STARTUPTIMELINEREPORT_H
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "sbndcode/Utilities/StartupTimeline.h"
+
+#include "RtypesCore.h"
+
+class TTree;
+
+namespace art {
+  class Event;
+  class ModuleDescription;
+  class ScheduleContext;
+}
+
+namespace sbnd {
+  class StartupTimelineReport {
+  public:
+
+    StartupTimelineReport(const fhicl::ParameterSet& pset,
+                          art::ActivityRegistry& reg);
+
+  private:
+
+    void preSourceConstruction(art::ModuleDescription const& md);
+    void postSourceConstruction(art::ModuleDescription const& md);
+    void preModuleConstruction(art::ModuleDescription const& md);
+    void postModuleConstruction(art::ModuleDescription const& md);
+    void preModuleBeginJob(art::ModuleDescription const& md);
+    void postModuleBeginJob(art::ModuleDescription const& md);
+    void preProcessEvent(art::Event const& e, art::ScheduleContext);
+    void postEndJob();
+
+    void open(std::string const& transition, art::ModuleDescription const& md);
+    void close(std::string const& transition, art::ModuleDescription const& md);
+
+    void report(startup::Probe const& firstEvent);
+    void reportLate();
+
+    void fillTree(std::vector<startup::Record> const& records, bool afterFirstEvent);
+    void writeJSON(startup::Probe const& firstEvent, std::vector<startup::Record> const& records,
+                   std::vector<startup::Record> const& late) const;
+
+    bool        fWriteTree;
+    std::string fJSONFileName;
+    bool        fPrintSummary;
+
+    std::mutex                         fMutex;   ///< guards the open module spans
+    std::map<std::string, std::size_t> fModuleSpans;
+
+    std::once_flag        fReported;
+    startup::Probe        fFirstEvent;
+    std::size_t           fNReported = 0;  ///< spans opened before the first event
+    std::set<std::size_t> fOpenAtReport;   ///< of those, the ones still open then
+
+    // tree and its branches
+    TTree*          fTree = nullptr;
+    startup::Record fTreeRecord;
+    Bool_t          fTreeAfterFirstEvent = false;
+  };
+} // namespace sbnd
+
+DECLARE_ART_SERVICE(sbnd::StartupTimelineReport, SHARED)
+
+#endif // SBNDCODE_UTILITIES_STARTUPTIMELINEREPORT_H
@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   StartupTimelineReport_service.cc
+///
+/// \brief  Reports the timeline of the job initialisation at the first event.
+///
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/StartupTimelineReport.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "art_root_io/TFileService.h"
+#include "canvas/Persistency/Provenance/ModuleDescription.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "cetlib_except/exception.h"
+
+#include "TTree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+  // module labels and types are plain, but keep the file valid anyway
+  std::string JSONEscape(std::string const& s)
+  {
+    std::string escaped;
+    escaped.reserve(s.size());
+    for (char c : s) {
+      if (c == '"' || c == '\\') escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+  void PrintRecords(mf::LogInfo& log, std::vector<sbnd::startup::Record> const& records)
+  {
+    log << std::left << std::setw(60) << "span" << std::setw(14) << "kind"
+        << std::right << std::setw(11) << "start [s]" << std::setw(12) << "wall [ms]"
+        << std::setw(12) << "CPU [ms]" << std::setw(12) << "dRSS [MB]"
+        << std::setw(11) << "RSS [MB]" << "\n";
+    for (sbnd::startup::Record const& r : records) {
+      log << std::left << std::setw(60) << (std::string(2 * r.depth, ' ') + r.name)
+          << std::setw(14) << r.kind << std::right << std::fixed
+          << std::setw(11) << std::setprecision(3) << r.start * 1e-9;
+      if (r.Closed()) {
+        log << std::setw(12) << std::setprecision(1) << r.wallTime * 1e-6
+            << std::setw(12) << r.cpuTime * 1e-6
+            << std::setw(12) << (r.rssAfter - r.rssBefore) / 1024.
+            << std::setw(11) << r.rssAfter / 1024. << "\n";
+      }
+      else {
+        log << std::setw(12) << "open" << "\n";
+      }
+    }
+  }
+
+  void WriteJSONRecords(std::ofstream& out, std::vector<sbnd::startup::Record> const& records)
+  {
+    out << "[";
+    for (size_t i = 0; i < records.size(); ++i) {
+      sbnd::startup::Record const& r = records[i];
+      out << (i ? ",\n" : "\n")
+          << "    { \"name\": \"" << JSONEscape(r.name) << "\""
+          << ", \"kind\": \"" << JSONEscape(r.kind) << "\""
+          << ", \"depth\": " << r.depth
+          << ", \"start_ns\": " << r.start
+          << ", \"wall_ns\": " << r.wallTime
+          << ", \"cpu_ns\": " << (r.Closed() ? r.cpuTime : 0)
+          << ", \"rss_before_kB\": " << r.rssBefore
+          << ", \"rss_after_kB\": " << r.rssAfter
+          << ", \"peak_rss_after_kB\": " << r.peakRSSAfter << " }";
+    }
+    out << (records.empty() ? "]" : "\n  ]");
+  }
+
+} // local namespace
+
+//----------------------------------------------------------------------
+sbnd::StartupTimelineReport::StartupTimelineReport(const fhicl::ParameterSet& pset,
+                                                   art::ActivityRegistry& reg)
+  : fWriteTree(pset.get<bool>("WriteTree", true))
+  , fJSONFileName(pset.get<std::string>("JSONFileName", ""))
+  , fPrintSummary(pset.get<bool>("PrintSummary", true))
+{
+  reg.sPreSourceConstruction.watch(this, &StartupTimelineReport::preSourceConstruction);
+  reg.sPostSourceConstruction.watch(this, &StartupTimelineReport::postSourceConstruction);
+  reg.sPreModuleConstruction.watch(this, &StartupTimelineReport::preModuleConstruction);
+  reg.sPostModuleConstruction.watch(this, &StartupTimelineReport::postModuleConstruction);
+  reg.sPreModuleBeginJob.watch(this, &StartupTimelineReport::preModuleBeginJob);
+  reg.sPostModuleBeginJob.watch(this, &StartupTimelineReport::postModuleBeginJob);
+  reg.sPreProcessEvent.watch(this, &StartupTimelineReport::preProcessEvent);
+  reg.sPostEndJob.watch(this, &StartupTimelineReport::postEndJob);
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::preSourceConstruction(art::ModuleDescription const& md)
+{
+  open("source", md);
+}
+
+void sbnd::StartupTimelineReport::postSourceConstruction(art::ModuleDescription const& md)
+{
+  close("source", md);
+}
+
+void sbnd::StartupTimelineReport::preModuleConstruction(art::ModuleDescription const& md)
+{
+  open("construction", md);
+}
+
+void sbnd::StartupTimelineReport::postModuleConstruction(art::ModuleDescription const& md)
+{
+  close("construction", md);
+}
+
+void sbnd::StartupTimelineReport::preModuleBeginJob(art::ModuleDescription const& md)
+{
+  open("beginJob", md);
+}
+
+void sbnd::StartupTimelineReport::postModuleBeginJob(art::ModuleDescription const& md)
+{
+  close("beginJob", md);
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::open(std::string const& transition, art::ModuleDescription const& md)
+{
+  std::string const name = md.moduleLabel() + " (" + md.moduleName() + ")";
+  std::size_t const span = startup::Registry::Instance().Open(name, transition);
+  std::lock_guard<std::mutex> lock(fMutex);
+  fModuleSpans[transition + ':' + md.moduleLabel()] = span;
+}
+
+void sbnd::StartupTimelineReport::close(std::string const& transition, art::ModuleDescription const& md)
+{
+  std::size_t span = startup::Registry::kNoSpan;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto it = fModuleSpans.find(transition + ':' + md.moduleLabel());
+    if (it == fModuleSpans.end()) return;
+    span = it->second;
+    fModuleSpans.erase(it);
+  }
+  startup::Registry::Instance().Close(span);
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::preProcessEvent(art::Event const&, art::ScheduleContext)
+{
+  std::call_once(fReported, [this]() { report(startup::Probe::Now()); });
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::postEndJob()
+{
+  // a job without events has no report yet
+  std::call_once(fReported, [this]() { report(startup::Probe::Now()); });
+  reportLate();
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::report(startup::Probe const& firstEvent)
+{
+  startup::Registry const& registry = startup::Registry::Instance();
+  std::vector<startup::Record> const records = registry.Snapshot();
+
+  fFirstEvent = firstEvent;
+  fNReported = records.size();
+  std::int64_t topLevelTime = 0;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (!records[i].Closed()) fOpenAtReport.insert(i);
+    else if (records[i].depth == 0) topLevelTime += records[i].wallTime;
+  }
+  std::int64_t const unaccounted = std::max<std::int64_t>(0, firstEvent.sinceStart - topLevelTime);
+
+  if (fWriteTree) fillTree(records, false);
+  if (!fJSONFileName.empty()) writeJSON(firstEvent, records, {});
+  if (!fPrintSummary) return;
+
+  mf::LogInfo log("StartupTimelineReport");
+  log << std::fixed << std::setprecision(3)
+      << "Job startup: first event " << firstEvent.sinceStart * 1e-9 << " s after the start of the process, "
+      << firstEvent.cpuTime * 1e-9 << " s of CPU, resident memory "
+      << std::setprecision(1) << firstEvent.rss / 1024. << " MB (peak " << firstEvent.peakRSS / 1024. << " MB)\n"
+      << std::setprecision(3) << "Not in any span (libraries, geometry, services constructed earlier): "
+      << unaccounted * 1e-9 << " s\n";
+  PrintRecords(log, records);
+  if (registry.Dropped() > 0) log << registry.Dropped() << " spans not recorded\n";
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::reportLate()
+{
+  std::vector<startup::Record> const all = startup::Registry::Instance().Snapshot();
+  std::vector<startup::Record> late;
+  for (std::size_t i : fOpenAtReport) late.push_back(all[i]);
+  late.insert(late.end(), all.begin() + std::min(fNReported, all.size()), all.end());
+  if (late.empty()) return;
+
+  if (fWriteTree) fillTree(late, true);
+  if (!fJSONFileName.empty()) {
+    std::vector<startup::Record> before;
+    for (std::size_t i = 0; i < std::min(fNReported, all.size()); ++i) {
+      if (!fOpenAtReport.count(i)) before.push_back(all[i]);
+    }
+    writeJSON(fFirstEvent, before, late);
+  }
+  if (!fPrintSummary) return;
+
+  mf::LogInfo log("StartupTimelineReport");
+  log << "Initialisation after the first event:\n";
+  PrintRecords(log, late);
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::fillTree(std::vector<startup::Record> const& records, bool afterFirstEvent)
+{
+  if (!fTree) {
+    art::ServiceHandle<art::TFileService> tfs;
+    fTree = tfs->make<TTree>("startuptimeline", "Timeline of the job initialisation");
+    startup::Record& r = fTreeRecord;
+    fTree->Branch("name", &r.name);
+    fTree->Branch("kind", &r.kind);
+    fTree->Branch("depth", &r.depth, "depth/i");
+    fTree->Branch("start", &r.start, "start/L");
+    fTree->Branch("wallTime", &r.wallTime, "wallTime/L");
+    fTree->Branch("cpuTime", &r.cpuTime, "cpuTime/L");
+    fTree->Branch("rssBefore", &r.rssBefore, "rssBefore/L");
+    fTree->Branch("rssAfter", &r.rssAfter, "rssAfter/L");
+    fTree->Branch("peakRSSAfter", &r.peakRSSAfter, "peakRSSAfter/L");
+    fTree->Branch("afterFirstEvent", &fTreeAfterFirstEvent, "afterFirstEvent/O");
+  }
+
+  fTreeAfterFirstEvent = afterFirstEvent;
+  for (startup::Record const& r : records) {
+    if (!r.Closed()) continue; // filled when it closes, with the late ones
+    fTreeRecord = r;
+    fTree->Fill();
+  }
+}
+
+//----------------------------------------------------------------------
+void sbnd::StartupTimelineReport::writeJSON(startup::Probe const& firstEvent,
+                                            std::vector<startup::Record> const& records,
+                                            std::vector<startup::Record> const& late) const
+{
+  std::ofstream out(fJSONFileName);
+  if (!out) {
+    throw cet::exception("StartupTimelineReport")
+      << "Cannot open '" << fJSONFileName << "' for writing\n";
+  }
+
+  out << "{\n  \"first_event\": { \"since_start_ns\": " << firstEvent.sinceStart
+      << ", \"cpu_ns\": " << firstEvent.cpuTime
+      << ", \"rss_kB\": " << firstEvent.rss
+      << ", \"peak_rss_kB\": " << firstEvent.peakRSS << " },\n"
+      << "  \"spans\": ";
+  WriteJSONRecords(out, records);
+  out << ",\n  \"after_first_event\": ";
+  WriteJSONRecords(out, late);
+  out << "\n}\n";
+}
+
+DEFINE_ART_SERVICE(sbnd::StartupTimelineReport)
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   ThreadPool.h
+///
+/// \brief  The share of the job threads a module runs its parallel loops
+///         on: a TBB task arena inside the thread pool art schedules on.
+///
+/// art sets the number of threads of the job (services.scheduler.num_threads)
+/// as the TBB parallelism limit, and every arena draws its workers from that
+/// same pool, so a module running its loops through a ThreadPool neither
+/// starts threads of its own nor takes more than the job allows:
+///
+///   sbnd::ThreadPool pool(nThreads);    // 0: all the threads of the job
+///   pool.Execute([&] { tbb::parallel_for(...); });
+///
+/// A request for more threads than the job has is reduced to what it has.
+///
+/// With a NUMA node (see NUMANode()), the arena only runs on the cores of
+/// that node, so the memory a replica of a module fills stays local to the
+/// threads that use it. This needs TBB's hwloc binding library at run time;
+/// without it, or on a machine with a single node, TBB reports no nodes and
+/// the arena is not pinned.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_THREADPOOL_H
+#define SBNDCODE_UTILITIES_THREADPOOL_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "tbb/global_control.h"
+#include "tbb/info.h"
+#include "tbb/task_arena.h"
+
+namespace sbnd {
+
+  class ThreadPool {
+  public:
+
+    static constexpr int kNoNUMANode = -1;
+
+    /// Up to nThreads threads of the job (0: all of them), on the cores of
+    /// numaNode if it is not kNoNUMANode.
+    explicit ThreadPool(unsigned nThreads = 0, int numaNode = kNoNUMANode)
+      : fArena(MakeConstraints(nThreads, numaNode))
+    {}
+
+    /// Threads the loops run on at most.
+    unsigned Concurrency() const { return fArena.max_concurrency(); }
+
+    /// Runs f in the arena, waiting for it, and returns what it returns.
+    template <typename F>
+    decltype(auto) Execute(F&& f) { return fArena.execute(std::forward<F>(f)); }
+
+    /// Threads of the job.
+    static unsigned JobThreads()
+    {
+      return tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism);
+    }
+
+    /// NUMA node for the index-th user (e.g. the schedule of a replica),
+    /// taking the nodes in turn; kNoNUMANode if there are not several.
+    static int NUMANode(unsigned index)
+    {
+      std::vector<tbb::numa_node_id> const nodes = tbb::info::numa_nodes();
+      if (nodes.size() < 2) return kNoNUMANode;
+      return nodes[index % nodes.size()];
+    }
+
+  private:
+
+    static tbb::task_arena::constraints MakeConstraints(unsigned nThreads, int numaNode)
+    {
+      int const jobThreads = JobThreads();
+      tbb::task_arena::constraints constraints;
+      constraints.numa_id = numaNode == kNoNUMANode ? tbb::task_arena::automatic : numaNode;
+      constraints.max_concurrency = nThreads == 0 ? jobThreads : std::min((int) nThreads, jobThreads);
+      if (numaNode != kNoNUMANode) {
+        // not more than the cores of the node
+        constraints.max_concurrency = std::min(constraints.max_concurrency,
+                                               tbb::info::default_concurrency(numaNode));
+      }
+      return constraints;
+    }
+
+    tbb::task_arena fArena;
+  };
+
+} // namespace sbnd
+
+#endif // SBNDCODE_UTILITIES_THREADPOOL_H
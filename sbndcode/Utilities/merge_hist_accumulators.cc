@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////
+// merge_hist_accumulators.cc
+//
+// Adds the histogram accumulator files (sbnd::diag::HistAccumulator)
+// written by the jobs of a campaign, and writes the sum as another
+// accumulator file, which can be added again later, and/or as a ROOT file.
+//
+// Usage:
+//   merge_hist_accumulators [-o merged.hacc] [-r merged.root] [-l list] [inputs...]
+//
+// The input files are the arguments and the lines of the list file. They
+// are read and added in parallel: each worker adds the files of a range of
+// the inputs, then the partial sums are added, which gives the same result
+// as adding the files one after the other since the sums are associative.
+// Exits with 1 when a file cannot be read or the binning of a histogram
+// differs between files.
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/HistAccumulator.h"
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_reduce.h"
+
+#include "TFile.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+  void usage(char const* program) {
+    std::cerr << "Usage: " << program
+              << " [-o merged.hacc] [-r merged.root] [-l list] [inputs...]\n";
+  }
+
+} // local namespace
+
+int main(int argc, char** argv) {
+
+  std::string outPath, rootPath;
+  std::vector<std::string> inputs;
+  int option;
+  while ((option = getopt(argc, argv, "o:r:l:h")) != -1) {
+    switch (option) {
+      case 'o': outPath = optarg; break;
+      case 'r': rootPath = optarg; break;
+      case 'l': {
+        std::ifstream list(optarg);
+        if (!list) {
+          std::cerr << "Cannot read the list file '" << optarg << "'\n";
+          return 1;
+        }
+        for (std::string line; std::getline(list, line);) if (!line.empty()) inputs.push_back(line);
+        break;
+      }
+      default: usage(argv[0]); return option == 'h' ? 0 : 1;
+    }
+  }
+  for (int i = optind; i < argc; ++i) inputs.push_back(argv[i]);
+  if (inputs.empty() || (outPath.empty() && rootPath.empty())) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  sbnd::diag::HistAccumulator merged;
+  try {
+    merged = tbb::parallel_reduce(
+      tbb::blocked_range<std::size_t>(0, inputs.size()),
+      sbnd::diag::HistAccumulator(),
+      [&inputs](tbb::blocked_range<std::size_t> const& range, sbnd::diag::HistAccumulator sum) {
+        for (std::size_t i = range.begin(); i != range.end(); ++i) {
+          if (!sum.Read(inputs[i]))
+            throw std::runtime_error("cannot read '" + inputs[i] + "' or it is damaged");
+        }
+        return sum;
+      },
+      [](sbnd::diag::HistAccumulator left, sbnd::diag::HistAccumulator const& right) {
+        left.Add(right);
+        return left;
+      });
+  }
+  catch (std::exception const& e) {
+    std::cerr << "Merging failed: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (!outPath.empty() && !merged.Write(outPath)) {
+    std::cerr << "Cannot write '" << outPath << "'\n";
+    return 1;
+  }
+  if (!rootPath.empty()) {
+    TFile file(rootPath.c_str(), "RECREATE");
+    if (file.IsZombie()) {
+      std::cerr << "Cannot write '" << rootPath << "'\n";
+      return 1;
+    }
+    merged.MakeROOT(file);
+    file.Close();
+  }
+
+  std::cout << "Added " << merged.size() << " histograms from " << inputs.size() << " files\n";
+  return 0;
+}
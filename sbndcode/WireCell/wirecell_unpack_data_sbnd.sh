@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+# File:    wirecell_unpack_data_sbnd.sh
+# Purpose: make uncompressed copies of the Wire-Cell SBND data files
+#
+# Usage:
+#     wirecell_unpack_data_sbnd.sh <target directory>
+#
+# The wires, field response and noise spectra files are looked up in
+# WIRECELL_PATH and decompressed into the target directory. Wire-Cell jobs
+# then skip the bzip2 decompression of these files at startup when the
+# target directory comes first in WIRECELL_PATH and the job uses
+#     params.data_suffix: ".json"
+# (the sbnd_wcls_sp configuration in wirecellmodules_sbnd.fcl).
+#
+
+declare -ra DataFiles=(
+  'sbnd-wires-geometry-v0200'
+  'garfield-sbnd-v1'
+  'sbnd-noise-spectra-v1'
+)
+
+function FindInWireCellPath() {
+  local -r FileName="$1"
+  local Dir
+  local -a Dirs
+  IFS=':' read -r -a Dirs <<< "$WIRECELL_PATH"
+  for Dir in "${Dirs[@]}" ; do
+    [[ -r "${Dir}/${FileName}" ]] && { echo "${Dir}/${FileName}" ; return 0 ; }
+  done
+  return 1
+}
+
+if [[ $# -ne 1 ]]; then
+  echo "Usage: $(basename "$0") <target directory>" >&2
+  exit 1
+fi
+
+declare -r TargetDir="$1"
+mkdir -p "$TargetDir" || exit $?
+
+for DataFile in "${DataFiles[@]}" ; do
+  Source="$(FindInWireCellPath "${DataFile}.json.bz2")"
+  if [[ -z "$Source" ]]; then
+    echo "'${DataFile}.json.bz2' not found in WIRECELL_PATH" >&2
+    exit 2
+  fi
+  Target="${TargetDir}/${DataFile}.json"
+  if [[ "$Target" -nt "$Source" ]]; then
+    echo "'${Target}' is up to date"
+    continue
+  fi
+  echo "'${Source}' => '${Target}'"
+  bunzip2 -c "$Source" > "${Target}.tmp" && mv "${Target}.tmp" "$Target" || exit 3
+done
+
+echo "Use with: export WIRECELL_PATH=\"$(cd "$TargetDir" && pwd):\${WIRECELL_PATH}\""
@@ -0,0 +1,113 @@
+/**
+ * @file    AssociationIndex.h
+ * @brief   Compact index of the objects associated to each object of a collection
+ * @date    October 15, 2026
+ * @see     MCAssociations.cpp
+ *
+ */
+
+#ifndef AssociationIndex_H
+#define AssociationIndex_H
+
+// C/C++ standard libraries
+#include <algorithm> // std::sort(), std::unique()
+#include <cstddef>   // std::size_t
+#include <limits>
+#include <vector>
+
+
+/**
+ * @brief Keys of the objects associated to each object of a collection.
+ *
+ * The index is built from an association (`art::Assns`) in a couple of linear
+ * passes and stored as compressed rows: one offset per object of the "from"
+ * collection, into a single array with the keys of the associated objects.
+ * Each row is sorted and without duplicates, like the `std::set` it replaces,
+ * and costs no allocation once the index has grown to the largest event.
+ *
+ * Which side of the association is "from" is chosen by the two functions
+ * given to `build()`, which extract the key of each side from an element of
+ * the association; a key `npos` skips the element (e.g. when its pointer
+ * belongs to another data product):
+ *
+ *     AssociationIndex hitsPerTrack;
+ *     hitsPerTrack.build(tracks.size(), trackHitAssns,
+ *       [](auto const& assn){ return assn.first.key(); },
+ *       [](auto const& assn){ return assn.second.key(); });
+ *     for (std::size_t hitKey: hitsPerTrack[trackKey]) ...
+ *
+ */
+class AssociationIndex
+{
+public:
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Keys associated to one object, as a range.
+    struct Row
+    {
+        std::size_t const* b;
+        std::size_t const* e;
+        std::size_t const* begin() const { return b; }
+        std::size_t const* end() const { return e; }
+        std::size_t size() const { return e - b; }
+        bool empty() const { return b == e; }
+    };
+
+    /// Replaces the content with the association assns of nFrom objects.
+    template <typename Assns, typename FromKey, typename ToKey>
+    void build(std::size_t nFrom, Assns const& assns, FromKey fromKey, ToKey toKey);
+
+    /// Number of objects of the "from" collection.
+    std::size_t size() const { return fOffsets.empty()? 0: fOffsets.size() - 1; }
+
+    /// Keys associated to the object with key from.
+    Row operator[](std::size_t from) const
+      { return { fKeys.data() + fOffsets[from], fKeys.data() + fOffsets[from + 1] }; }
+
+private:
+    std::vector<std::size_t> fOffsets; ///< start of the row of each object, and end of the last
+    std::vector<std::size_t> fKeys;    ///< associated keys, row after row
+};
+
+
+template <typename Assns, typename FromKey, typename ToKey>
+void AssociationIndex::build(std::size_t nFrom, Assns const& assns, FromKey fromKey, ToKey toKey)
+{
+    // count the elements of each row, then turn the counts into offsets
+    fOffsets.assign(nFrom + 1, 0);
+    for(std::size_t i = 0; i < assns.size(); i++)
+    {
+        std::size_t const from = fromKey(assns[i]);
+        if (from < nFrom && toKey(assns[i]) != npos) fOffsets[from + 1]++;
+    }
+    for(std::size_t from = 0; from < nFrom; from++) fOffsets[from + 1] += fOffsets[from];
+
+    // fill the rows; fOffsets[from] is used as the fill position of row from - 1
+    fKeys.resize(fOffsets[nFrom]);
+    for(std::size_t i = 0; i < assns.size(); i++)
+    {
+        std::size_t const from = fromKey(assns[i]);
+        std::size_t const to   = toKey(assns[i]);
+        if (from < nFrom && to != npos) fKeys[fOffsets[from]++] = to;
+    }
+    // the fill moved each offset to the start of the next row: shift them back
+    for(std::size_t from = nFrom; from > 0; from--) fOffsets[from] = fOffsets[from - 1];
+    fOffsets[0] = 0;
+
+    // sort the rows and drop repeated associations, compacting in place
+    std::size_t out = 0;
+    for(std::size_t from = 0; from < nFrom; from++)
+    {
+        auto const b = fKeys.begin() + fOffsets[from];
+        auto const e = fKeys.begin() + fOffsets[from + 1];
+        std::sort(b, e);
+        auto const last = std::unique(b, e);
+        fOffsets[from] = out;
+        out = std::copy(b, last, fKeys.begin() + out) - fKeys.begin();
+    }
+    fOffsets[nFrom] = out;
+    fKeys.resize(out);
+}
+
+#endif // AssociationIndex_H
@@ -15,7 +15,7 @@
 #include "lardataobj/RecoBase/Hit.h"
 
 // canvas libraries
-#include "canvas/Persistency/Common/FindMany.h"
+#include "canvas/Persistency/Common/Assns.h"
 
 // ROOT libraries
 #include "TVector3.h"
@@ -24,6 +24,22 @@
 #include <algorithm> // std::count_if()
 
 
+namespace {
+    
+    /// Indices of the association assns from its left side to its right side, and back.
+    template <typename Assns>
+    void indexBothWays(Assns const& assns, std::size_t nLeft, std::size_t nRight,
+                       AssociationIndex& leftToRight, AssociationIndex& rightToLeft)
+    {
+        auto leftKey  = [](auto const& assn){ return assn.first.key(); };
+        auto rightKey = [](auto const& assn){ return assn.second.key(); };
+        leftToRight.build(nLeft, assns, leftKey, rightKey);
+        rightToLeft.build(nRight, assns, rightKey, leftKey);
+    }
+    
+} // local namespace
+
+
 MCAssociations::MCAssociations(fhicl::ParameterSet const& config)
     : fHitProducerLabel(config.get<art::InputTag>("HitProducerLabel", "")),
       fMCTruthProducerLabel(config.get<art::InputTag>("MCTruthProducerLabel", "")),
@@ -122,80 +138,32 @@ void MCAssociations::doTrackHitMCAssociations(gallery::Event& event)
     // We also need to recover the hit producer info
     const auto& hitHandle = event.getValidHandle<std::vector<recob::Hit>>(fHitProducerLabel);
     
-    // Now see how many reco hits might be associated to this particle
-    art::FindMany<recob::Hit, anab::BackTrackerHitMatchingData> hitsPerMCParticle(mcParticleHandle, event, fAssnsProducerLabel);
+    // The hit <--> MCParticle associations, in either direction, are indexed both ways;
+    // the hits of the tracks are matched by key, so they must come from the same product
+    art::ProductID hitProductID;
     
-    // Make maps, we really like to make maps
-    using HitToPartVecMap = std::map<const recob::Hit*,std::set<const simb::MCParticle*>>;
-    using PartToHitVecMap = std::map<const simb::MCParticle*, std::set<const recob::Hit*>>;
+    gallery::Handle<art::Assns<recob::Hit, simb::MCParticle, anab::BackTrackerHitMatchingData>> hitPartAssnsHandle;
     
-    HitToPartVecMap hitToPartVecMap;
-    PartToHitVecMap partToHitVecMap;
-
-    // Loop through the particles
-    for(int mcIdx = 0; mcIdx < mcParticleHandle->size(); mcIdx++)
+    if (event.getByLabel(fAssnsProducerLabel, hitPartAssnsHandle))
     {
-        try
-        {
-            const simb::MCParticle& mcParticle = mcParticleHandle->at(mcIdx);
-            
-            std::vector<const recob::Hit*> hitsVec = hitsPerMCParticle.at(mcIdx);
-            
-            for(const auto& hit : hitsVec)
-            {
-                hitToPartVecMap[hit].insert(&mcParticle);
-                partToHitVecMap[&mcParticle].insert(hit);
-            }
-        }
-        catch(...) {break;}
+        indexBothWays(*hitPartAssnsHandle, hitHandle->size(), mcParticleHandle->size(), fParticlesPerHit, fHitsPerParticle);
+        if (!hitPartAssnsHandle->empty()) hitProductID = hitPartAssnsHandle->at(0).first.id();
+    }
+    else
+    {
+        const auto& partHitAssns = *event.getValidHandle<art::Assns<simb::MCParticle, recob::Hit, anab::BackTrackerHitMatchingData>>(fAssnsProducerLabel);
+        indexBothWays(partHitAssns, mcParticleHandle->size(), hitHandle->size(), fHitsPerParticle, fParticlesPerHit);
+        if (!partHitAssns.empty()) hitProductID = partHitAssns.at(0).second.id();
     }
     
     // In this section try looking at tracking. Eventually we want to move this out of here...
     // First step is to recover the MCTruth object vector...
     const auto& trackHandle = event.getValidHandle<std::vector<recob::Track>>(fTrackProducerLabel);
+    const auto& trackHitAssns = *event.getValidHandle<art::Assns<recob::Track, recob::Hit>>(fTrackProducerLabel);
     
-    // Now see how many reco hits might be associated to this particle
-    art::FindMany<recob::Hit> hitsPerTrack(trackHandle, event, fTrackProducerLabel);
-    
-    // Define a mapping between tracks and associated MCParticles
-    using TrackToParticleSetMap  = std::map<const recob::Track*, std::set<const simb::MCParticle*>>;
-    using ParticleToTrackSetMap  = std::map<const simb::MCParticle*, std::set<const recob::Track*>>;
-    using ParticleToHitSetMap    = std::map<const simb::MCParticle*, std::set<const recob::Hit*>>;
-    using TrackToPartHitSetMap   = std::map<const recob::Track*, ParticleToHitSetMap>;
-    using TrackToHitsVecMap      = std::map<const recob::Track*, std::vector<const recob::Hit*>>;
-    
-    TrackToParticleSetMap  trackToParticleSetMap;
-    ParticleToTrackSetMap  particleToTrackSetMap;
-    
-    TrackToPartHitSetMap   trackToPartHitSetMap;
-    TrackToHitsVecMap      trackToHitsVecMap;
-
-    // Loop through the tracks and associate via the hits to MCParticles
-    for(int trkIdx = 0; trkIdx < trackHandle->size(); trkIdx++)
-    {
-        const recob::Track& track = trackHandle->at(trkIdx);
-        
-        std::vector<const recob::Hit*> hitsVec = hitsPerTrack.at(trkIdx);
-        
-        trackToHitsVecMap[&track] = hitsVec;
-        
-        ParticleToHitSetMap& particleToHitSetMap = trackToPartHitSetMap[&track];
-        
-        for(const auto& hit : hitsVec)
-        {
-            HitToPartVecMap::iterator partItr = hitToPartVecMap.find(hit);
-            
-            if (partItr != hitToPartVecMap.end())
-            {
-                for(const auto& particle : partItr->second)
-                {
-                    particleToHitSetMap[particle].insert(hit);
-                    trackToParticleSetMap[&track].insert(particle);
-                    particleToTrackSetMap[particle].insert(&track);
-                }
-            }
-        }
-    }
+    fHitsPerTrack.build(trackHandle->size(), trackHitAssns,
+                        [](auto const& assn){ return assn.first.key(); },
+                        [&hitProductID](auto const& assn){ return assn.second.id() == hitProductID? assn.second.key(): AssociationIndex::npos; });
     
     // *****************************************************************************************
     // The bits below here should eventually be moved into their own analyzer algorithm
@@ -204,10 +172,8 @@ void MCAssociations::doTrackHitMCAssociations(gallery::Event& event)
     // Let's start by just looking at the primary particle
     const simb::MCParticle& primaryParticle = mcParticleHandle->at(0);
     
-    ParticleToTrackSetMap::iterator partTrackItr = particleToTrackSetMap.find(&primaryParticle);
-    
     // Define the parameters we want...
-    int   numPrimaryHitsTotal = partToHitVecMap[&primaryParticle].size();
+    int   numPrimaryHitsTotal = fHitsPerParticle[0].size();
     
     // If there are NO reconstructed hits associated to this particle then we don't count
     // But this should really be a check on fiducial volume I think...
@@ -221,29 +187,38 @@ void MCAssociations::doTrackHitMCAssociations(gallery::Event& event)
         
         // Here we find the best matched track to the MCParticle.
         // Nothing exciting, most hits wins sort of thing...
-        if (partTrackItr != particleToTrackSetMap.end())
-        {
-            // Recover the longest track...
-            for(const auto& track : partTrackItr->second)
+        // (the particles of each hit are sorted, so the primary comes first)
+        auto isPrimaryHit = [this](std::size_t hitKey)
             {
-                if (trackToPartHitSetMap[track][partTrackItr->first].size() > numTrackHits)
-                {
-                    bestTrack    = track;
-                    numTrackHits = trackToPartHitSetMap[track][partTrackItr->first].size();
-                }
-            }
+                if (hitKey >= fParticlesPerHit.size()) return false;
+                const auto& particles = fParticlesPerHit[hitKey];
+                return !particles.empty() && *particles.begin() == 0;
+            };
+        std::size_t bestTrackIdx(0);
         
-            if (bestTrack)
+        for(std::size_t trkIdx = 0; trkIdx < trackHandle->size(); trkIdx++)
+        {
+            const auto& trackHits = fHitsPerTrack[trkIdx];
+            int numMatched = std::count_if(trackHits.begin(), trackHits.end(), isPrimaryHit);
+            
+            if (numMatched > numTrackHits)
             {
-                int numPrimaryHitsMatch = numTrackHits;
-                int numTrackHitsTotal   = trackToHitsVecMap[bestTrack].size();
-        
-                completeness = float(numPrimaryHitsMatch) / float(numPrimaryHitsTotal);
-                purity       = float(numPrimaryHitsMatch) / float(numTrackHitsTotal);
-                
-                if (completeness > 0.2) efficiency = 1.;
+                bestTrack    = &trackHandle->at(trkIdx);
+                bestTrackIdx = trkIdx;
+                numTrackHits = numMatched;
             }
         }
+        
+        if (bestTrack)
+        {
+            int numPrimaryHitsMatch = numTrackHits;
+            int numTrackHitsTotal   = fHitsPerTrack[bestTrackIdx].size();
+            
+            completeness = float(numPrimaryHitsMatch) / float(numPrimaryHitsTotal);
+            purity       = float(numPrimaryHitsMatch) / float(numTrackHitsTotal);
+            
+            if (completeness > 0.2) efficiency = 1.;
+        }
     
         // Calculate the length of this mc particle inside the fiducial volume.
         TVector3 mcstart;
@@ -258,35 +233,36 @@ void MCAssociations::doTrackHitMCAssociations(gallery::Event& event)
         
         if (bestTrack) trackLen = length(bestTrack);
     
-        fNTracks->Fill(partToHitVecMap.size(), 1.);
-        fNHitsPerPrimary->Fill(std::log10(double(partToHitVecMap[&primaryParticle].size())), 1.);
+        std::size_t numParticlesWithHits = 0;
+        for(std::size_t mcIdx = 0; mcIdx < mcParticleHandle->size(); mcIdx++)
+            if (!fHitsPerParticle[mcIdx].empty()) numParticlesWithHits++;
+        
+        fNTracks->Fill(numParticlesWithHits, 1.);
+        fNHitsPerPrimary->Fill(std::log10(double(numPrimaryHitsTotal)), 1.);
         fPrimaryLength->Fill(mcTrackLen, 1.);
-        fPrimaryLenVsHits->Fill(mcTrackLen, partToHitVecMap[&primaryParticle].size(), 1.);
+        fPrimaryLenVsHits->Fill(mcTrackLen, numPrimaryHitsTotal, 1.);
         
         fPrimaryRecoLength->Fill(trackLen, 1.);
         fDeltaTrackLen->Fill(trackLen-mcTrackLen, 1.);
         
         fNHitsPerReco->Fill(std::log10(numTrackHits), 1.);
-        fDeltaNHits->Fill(numTrackHits - int(partToHitVecMap[&primaryParticle].size()), 1.);
+        fDeltaNHits->Fill(numTrackHits - numPrimaryHitsTotal, 1.);
 
         // Loop through the particles again to histogram some secondary info...
-        for(int mcIdx = 0; mcIdx < mcParticleHandle->size(); mcIdx++)
+        for(std::size_t mcIdx = 0; mcIdx < mcParticleHandle->size(); mcIdx++)
         {
-            try
-            {
-                const simb::MCParticle& mcParticle = mcParticleHandle->at(mcIdx);
+            const simb::MCParticle& mcParticle = mcParticleHandle->at(mcIdx);
+            const auto&             particleHits = fHitsPerParticle[mcIdx];
             
-                if (!partToHitVecMap[&mcParticle].empty())
-                {
-                    // Calculate the length of this mc particle inside the fiducial volume.
-                    double secTrackLen = length(mcParticle, xOffset, mcstart, mcend, mcstartmom, mcendmom);
+            if (!particleHits.empty())
+            {
+                // Calculate the length of this mc particle inside the fiducial volume.
+                double secTrackLen = length(mcParticle, xOffset, mcstart, mcend, mcstartmom, mcendmom);
                 
-                    fNHitsPerTrack->Fill(partToHitVecMap[&mcParticle].size(), 1.);
-                    fTrackLength->Fill(secTrackLen, 1.);
-                    fTrackLenVsHits->Fill(secTrackLen, partToHitVecMap[&mcParticle].size(), 1.);
-                }
+                fNHitsPerTrack->Fill(particleHits.size(), 1.);
+                fTrackLength->Fill(secTrackLen, 1.);
+                fTrackLenVsHits->Fill(secTrackLen, particleHits.size(), 1.);
             }
-            catch(...) {break;}
         }
     
         // Final sets of plots
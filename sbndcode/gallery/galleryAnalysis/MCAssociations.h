@@ -17,6 +17,8 @@
 #include "nusimdata/SimulationBase/MCParticle.h"
 #include "lardataobj/RecoBase/Track.h"
 
+#include "AssociationIndex.h"
+
 // canvas libraries
 #include "fhiclcpp/ParameterSet.h"
 
@@ -73,6 +75,11 @@ private:
     const detinfo::DetectorPropertiesData* fDetectorProperties = nullptr;
     TDirectory*                        fDir                = nullptr;
     
+    // association indices, rebuilt on each event (by key of the hits, particles and tracks)
+    AssociationIndex          fHitsPerParticle;
+    AssociationIndex          fParticlesPerHit;
+    AssociationIndex          fHitsPerTrack;
+    
     std::unique_ptr<TH1>      fNTracks;
     std::unique_ptr<TH1>      fNHitsPerTrack;
     std::unique_ptr<TH1>      fTrackLength;
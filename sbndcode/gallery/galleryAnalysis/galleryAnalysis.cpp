@@ -14,6 +14,18 @@
  * An higher level one is to use `testing::TesterEnvironment` as in some service
  * provider unit tests (e.g., `geo::GeometryCore` and `detinfo::LArProperties`).
  * 
+ * Large samples can be split among several processes running in parallel:
+ *     
+ *     galleryAnalysis --worker=K/N configFile inputFile ...
+ *     
+ * makes this process analyse only its share (`K`-th of `N`, starting from 0)
+ * of the expanded input file list, and write its histograms into a file with
+ * `_workerK` appended to the configured name. Each process has its own
+ * `gallery::Event` and service providers; the per-worker histogram files are
+ * then merged histogram by histogram with `hadd`.
+ * Note that gallery reads a data product only when the analysis asks for it,
+ * so each worker reads only the products the algorithms use.
+ * 
  */
 
 // our additional code
@@ -64,15 +76,26 @@
 #include <algorithm> // std::copy()
 #include <iterator> // std::back_inserter()
 #include <iostream> // std::cerr
+#include <cstdio> // std::sscanf()
+#include <cstring> // std::strncmp()
 #endif // !__CLING__
 
 /**
  * @brief Runs the analysis macro.
  * @param configFile path to the FHiCL configuration to be used for the services
  * @param inputFiles vector of path of file names
+ * @param workerIndex index of this worker, from `0` to `nWorkers - 1`
+ * @param nWorkers number of workers the input file list is split among
  * @return an integer as exit code (0 means success)
+ * 
+ * With more than one worker, only the share of the input files assigned to
+ * `workerIndex` is processed (see `selectWorkerFiles()`), and `_worker<index>`
+ * is appended to the name of the histogram file.
  */
-int galleryAnalysis(std::string const& configFile, std::vector<std::string> const& inputFiles)
+int galleryAnalysis(
+  std::string const& configFile, std::vector<std::string> const& inputFiles,
+  unsigned int workerIndex = 0, unsigned int nWorkers = 1
+)
 {
     /*
      * the "test" environment configuration
@@ -114,7 +137,13 @@ int galleryAnalysis(std::string const& configFile, std::vector<std::string> cons
     /*
      * the preparation of input file list
      */
-    std::vector<std::string> const allInputFiles = expandInputFiles(inputFiles);
+    std::vector<std::string> const allInputFiles
+      = selectWorkerFiles(expandInputFiles(inputFiles), workerIndex, nWorkers);
+    if (nWorkers > 1) {
+        std::cout << "Worker " << workerIndex << "/" << nWorkers << ": "
+          << allInputFiles.size() << " input files" << std::endl;
+    }
+    if (allInputFiles.empty()) return 0; // nothing assigned to this worker
   
     /*
      * other parameters
@@ -129,6 +158,12 @@ int galleryAnalysis(std::string const& configFile, std::vector<std::string> cons
     if (analysisConfig.has_key("histogramFile"))
     {
         std::string fileName = analysisConfig.get<std::string>("histogramFile");
+        if (nWorkers > 1) {
+            std::string const tag = "_worker" + std::to_string(workerIndex);
+            std::size_t const iExt = fileName.rfind(".root");
+            if (iExt == std::string::npos) fileName += tag;
+            else fileName.insert(iExt, tag);
+        }
         std::cout << "Creating output file: '" << fileName << "'" << std::endl;
         pHistFile = std::make_unique<TFile>(fileName.c_str(), "RECREATE");
     }
@@ -195,16 +230,29 @@ int galleryAnalysis(std::string const& configFile, std::string filename)
 int main(int argc, char** argv) {
   
   char **pParam = argv + 1, **pend = argv + argc;
+  
+  unsigned int workerIndex = 0, nWorkers = 1;
+  if ((pParam != pend) && (std::strncmp(*pParam, "--worker=", 9) == 0)) {
+    if ((std::sscanf(*pParam + 9, "%u/%u", &workerIndex, &nWorkers) != 2)
+      || (nWorkers == 0) || (workerIndex >= nWorkers))
+    {
+      std::cerr << "Invalid worker specification: '" << *pParam
+        << "' (should be --worker=K/N with 0 <= K < N)" << std::endl;
+      return 1;
+    }
+    ++pParam;
+  }
+  
   if (pParam == pend) {
-    std::cerr << "Usage: " << argv[0] << "  configFile [inputFile ...]"
-      << std::endl;
+    std::cerr << "Usage: " << argv[0]
+      << "  [--worker=K/N] configFile [inputFile ...]" << std::endl;
     return 1;
   }
   std::string const configFile = *(pParam++);
   std::vector<std::string> fileNames;
   std::copy(pParam, pend, std::back_inserter(fileNames));
   
-  return galleryAnalysis(configFile, fileNames);
+  return galleryAnalysis(configFile, fileNames, workerIndex, nWorkers);
 } // main()
 
 #endif // !__CLING__
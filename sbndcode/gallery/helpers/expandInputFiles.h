@@ -168,4 +168,30 @@ inline std::vector<std::string> expandInputFiles
 } // expandInputFiles()
 
 
+/**
+ * @brief Returns the share of `files` assigned to one of `nWorkers` workers.
+ * @param files the complete (expanded) list of input files
+ * @param workerIndex index of the worker, from `0` to `nWorkers - 1`
+ * @param nWorkers total number of workers the list is split among
+ * @return the files assigned to worker `workerIndex`, in their original order
+ * 
+ * Files are assigned round-robin, so that worker `k` gets files `k`,
+ * `k + nWorkers`, `k + 2 nWorkers` and so on. This keeps the shares balanced
+ * even when the input list is sorted by run or by file size.
+ */
+inline std::vector<std::string> selectWorkerFiles(
+  std::vector<std::string> const& files,
+  unsigned int workerIndex, unsigned int nWorkers
+) {
+  if ((nWorkers == 0) || (workerIndex >= nWorkers)) {
+    throw std::runtime_error("Invalid worker " + std::to_string(workerIndex)
+      + " out of " + std::to_string(nWorkers));
+  }
+  std::vector<std::string> selected;
+  for (std::size_t i = workerIndex; i < files.size(); i += nWorkers)
+    selected.push_back(files[i]);
+  return selected;
+} // selectWorkerFiles()
+
+
 #endif // EXPANDINPUTFILES_H
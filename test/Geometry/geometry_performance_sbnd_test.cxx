@@ -0,0 +1,201 @@
+/**
+ * @file   geometry_performance_sbnd_test.cxx
+ * @brief  Timing of geometry iterations and queries on SBND detector
+ *
+ * Usage:
+ *   `geometry_performance_sbnd_test [ConfigurationFile [GeometryTestParameterSet]]`
+ *
+ * Times full loops over the TPCs, planes, wires and auxiliary detectors, and
+ * the queries the simulation and reconstruction modules do for each channel
+ * or wire: `ChannelToWire()`, `View()`, `SignalType()`, `NearestWireID()` and
+ * `FindAuxDetAtPosition()`. The times are printed; the test fails only if
+ * the tabulated `ChannelToWire()` of `geo::ChannelMapSBNDAlg` differs from
+ * the one of the standard channel mapping.
+ *
+ */
+
+
+// SBND libraries
+#include "sbndcode/Geometry/ChannelMapSBNDAlg.h"
+
+// LArSoft libraries
+#include "test/Geometry/geometry_unit_test_sbnd.h"
+#include "larcorealg/Geometry/GeometryCore.h"
+#include "larcorealg/Geometry/AuxDetGeo.h"
+#include "larcorealg/Geometry/PlaneGeo.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+#include "larcorealg/Geometry/WireGeo.h"
+
+// utility libraries
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// C/C++ standard libraries
+#include <chrono>
+#include <string>
+
+
+//------------------------------------------------------------------------------
+//---  The test environment
+//---
+
+using SBNDGeometryConfiguration
+  = sbnd::testing::SBNDGeometryEnvironmentConfiguration
+    <geo::ChannelMapSBNDAlg>;
+
+using SBNDGeometryTestEnvironment
+  = testing::GeometryTesterEnvironment<SBNDGeometryConfiguration>;
+
+
+//------------------------------------------------------------------------------
+//---  The tests
+//---
+
+namespace {
+
+  /// Runs `loop` (which returns a count) and prints its time per count.
+  template <typename Loop>
+  void TimeLoop(std::string const& name, Loop loop) {
+    auto const start = std::chrono::steady_clock::now();
+    unsigned long long const count = loop();
+    std::chrono::duration<double, std::micro> const elapsed
+      = std::chrono::steady_clock::now() - start;
+    mf::LogInfo("geometry_performance_test_SBND")
+      << name << ": " << count << " calls in " << elapsed.count() << " us ("
+      << (count? elapsed.count() / count * 1000.: 0.) << " ns each)";
+  } // TimeLoop()
+
+} // local namespace
+
+
+/** ****************************************************************************
+ * @brief Runs the test
+ * @param argc number of arguments in argv
+ * @param argv arguments to the function
+ * @return number of detected errors (0 on success)
+ * @throw cet::exception most of error situations throw
+ *
+ * The arguments in argv are:
+ * 0. name of the executable ("geometry_performance_sbnd_test")
+ * 1. path to the FHiCL configuration file
+ * 2. FHiCL path to the configuration of the geometry test
+ *    (default: physics.analysers.geotest)
+ * 3. FHiCL path to the configuration of the geometry
+ *    (default: services.Geometry)
+ *
+ */
+//------------------------------------------------------------------------------
+int main(int argc, char const** argv) {
+
+  SBNDGeometryConfiguration config
+    ("geometry_performance_test_SBND");
+  config.SetMainTesterParameterSetName("geotest");
+
+  //
+  // parameter parsing (as in geometry_iterator_loop_sbnd_test)
+  //
+  int iParam = 0;
+  if (++iParam < argc) config.SetConfigurationPath(argv[iParam]);
+  if (++iParam < argc) config.SetMainTesterParameterSetPath(argv[iParam]);
+  else                 config.AddDefaultTesterConfiguration("");
+  if (++iParam < argc) config.SetGeometryParameterSetPath(argv[iParam]);
+
+  //
+  // testing environment setup
+  //
+  SBNDGeometryTestEnvironment TestEnvironment(config);
+  geo::GeometryCore const& geom = *(TestEnvironment.Geometry());
+  unsigned int const nChannels = geom.Nchannels();
+
+  //
+  // the channel table against the standard mapping
+  //
+  unsigned int nErrors = 0;
+  auto const* pChannelMap
+    = dynamic_cast<geo::ChannelMapSBNDAlg const*>(geom.GetChannelMapAlg());
+  if (!pChannelMap) {
+    mf::LogError("geometry_performance_test_SBND")
+      << "the geometry does not use ChannelMapSBNDAlg";
+    return 1;
+  }
+  for (raw::ChannelID_t channel = 0; channel < nChannels; ++channel) {
+    if (pChannelMap->ChannelToWire(channel)
+      != pChannelMap->geo::ChannelMapStandardAlg::ChannelToWire(channel))
+    {
+      mf::LogError("geometry_performance_test_SBND")
+        << "wires of channel " << channel << " differ from the standard mapping";
+      ++nErrors;
+    }
+  } // for channels
+
+  //
+  // iterations
+  //
+  TimeLoop("TPC iteration", [&geom]() {
+    unsigned long long n = 0;
+    for (geo::TPCGeo const& tpc: geom.Iterate<geo::TPCGeo>()) n += tpc.Nplanes() > 0;
+    return n;
+  });
+  TimeLoop("plane iteration", [&geom]() {
+    unsigned long long n = 0;
+    for (geo::PlaneGeo const& plane: geom.Iterate<geo::PlaneGeo>()) n += plane.Nwires() > 0;
+    return n;
+  });
+  TimeLoop("wire iteration", [&geom]() {
+    unsigned long long n = 0;
+    for (geo::WireGeo const& wire: geom.Iterate<geo::WireGeo>()) n += wire.Length() > 0.;
+    return n;
+  });
+  TimeLoop("AuxDet iteration", [&geom]() {
+    unsigned long long n = 0;
+    for (unsigned int ad = 0; ad < geom.NAuxDets(); ++ad)
+      n += geom.AuxDet(ad).NSensitiveVolume() > 0;
+    return n;
+  });
+
+  //
+  // per-channel queries
+  //
+  TimeLoop("ChannelToWire", [&geom, nChannels]() {
+    unsigned long long n = 0;
+    for (raw::ChannelID_t channel = 0; channel < nChannels; ++channel)
+      n += geom.ChannelToWire(channel).size();
+    return n;
+  });
+  TimeLoop("View", [&geom, nChannels]() {
+    unsigned long long n = 0;
+    for (raw::ChannelID_t channel = 0; channel < nChannels; ++channel)
+      n += geom.View(channel) != geo::kUnknown;
+    return n;
+  });
+  TimeLoop("SignalType", [&geom, nChannels]() {
+    unsigned long long n = 0;
+    for (raw::ChannelID_t channel = 0; channel < nChannels; ++channel)
+      n += geom.SignalType(channel) != geo::kMysteryType;
+    return n;
+  });
+
+  //
+  // per-position queries, at the centre of each wire and auxiliary detector
+  //
+  TimeLoop("NearestWireID", [&geom]() {
+    unsigned long long n = 0;
+    for (geo::WireID const& wireID: geom.Iterate<geo::WireID>()) {
+      geo::Point_t const center = geom.Wire(wireID).GetCenter();
+      n += geom.NearestWireID(center, wireID.asPlaneID()) == wireID;
+    }
+    return n;
+  });
+  TimeLoop("FindAuxDetAtPosition", [&geom]() {
+    unsigned long long n = 0;
+    for (unsigned int ad = 0; ad < geom.NAuxDets(); ++ad)
+      n += geom.FindAuxDetAtPosition(geom.AuxDet(ad).GetCenter()) == ad;
+    return n;
+  });
+
+  if (nErrors > 0) {
+    mf::LogError("geometry_performance_test_SBND")
+      << nErrors << " errors detected!";
+  }
+
+  return nErrors;
+} // main()
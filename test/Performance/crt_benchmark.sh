@@ -0,0 +1,157 @@
+#!/usr/bin/env bash
+#
+# Benchmarks the SBND CRT simulation and reconstruction against occupancy.
+#
+# Cosmic ray events are generated with CORSIKA over sampling times scaled by
+# each of the requested occupancy factors, so that the CRT taggers see
+# proportionally more particles, and run through g4_sce, detsim, reco1 and
+# reco2. For each factor the script reports the average number of CRT strip
+# hits per event and the time per event of each CRT module: the CRT
+# simulation, strip hit, cluster, space point and track producers and the
+# CRT-TPC space point and track matching.
+#
+# Settings (environment variables):
+#   NEvents            number of events per occupancy factor (default: 3)
+#   OccupancyFactors   factors scaling the CORSIKA sampling time
+#                      (default: "0.5 1 2 4")
+#   FAKE               if set (and not 0), only print the commands
+#
+
+: ${NEvents:=3}
+: ${OccupancyFactors:="0.5 1 2 4"}
+
+# CORSIKA sampling of the standard configuration (cosmic_common_sbnd.fcl)
+declare -r SampleTime='3.2e-3'
+declare -r TimeOffset='-1.7e-3'
+
+declare -ar CRTModules=(
+    'crtsim'
+    'crtstrips'
+    'crtclustering'
+    'crtspacepoints'
+    'crttracks'
+    'crtspacepointmatching'
+    'crttrackmatching'
+)
+
+
+function Exec() {
+	local LogFile="$1"
+	shift
+	local -a Cmd=( "$@" )
+	
+	echo "\$ ${Cmd[@]}${LogFile:+ >& ${LogFile}}"
+	[[ -n "${FAKE//0}" ]] && return 0
+	
+	local -i res=0
+	if [[ -n "$LogFile" ]]; then
+		"${Cmd[@]}" >& "$LogFile"
+		res=$?
+		[[ $res != 0 ]] && cat "$LogFile"
+	else
+		"${Cmd[@]}"
+		res=$?
+	fi
+	return $res
+} # Exec()
+
+
+# Runs a lar job in its own directory: RunJob <dir> <config> [<input file>]
+function RunJob() {
+	local WorkDir="$1"
+	local ConfigFile="$2"
+	local InputFile="$3"
+	
+	# the benchmark configurations are copied next to the script
+	[[ -r "${BaseDir}/${ConfigFile}" ]] && ConfigFile="${BaseDir}/${ConfigFile}"
+	
+	[[ -d "$WorkDir" ]] && rm -r "${WorkDir%/}/"
+	mkdir -p "$WorkDir" || return $?
+	
+	local -a Cmd=( 'lar' '--rethrow-all' '--config' "$ConfigFile" )
+	if [[ -n "$InputFile" ]]; then
+		Cmd=( "${Cmd[@]}" '--source' "${BaseDir}/${InputFile}" )
+	else
+		Cmd=( "${Cmd[@]}" '--nevts' "$NEvents" )
+	fi
+	Cmd=( "${Cmd[@]}" '--output' 'out-art.root' '--TFileName' 'out-hist.root' )
+	
+	( cd "$WorkDir" && Exec "job.out" "${Cmd[@]}" )
+	local -i res=$?
+	[[ $res != 0 ]] && echo "***  Job '${WorkDir}' FAILED!!! (exit code: ${res})" >&2
+	return $res
+} # RunJob()
+
+
+# Average time per event [s] of a module: ModuleTime <dir> <label>
+function ModuleTime() {
+	sqlite3 "${1}/cputime.db" "SELECT AVG(Time) FROM TimeModule WHERE ModuleLabel = '${2}';"
+} # ModuleTime()
+
+
+# Average number of CRT strip hits per event in an art file: StripHits <file>
+function StripHits() {
+	lar -c eventdump.fcl -s "$1" 2> /dev/null | awk -F '|' '
+	  /Begin processing the/ { ++nEvents }
+	  { gsub(/ /, "", $2) }
+	  $2 == "crtstrips" { n += $NF }
+	  END { printf "%.0f", (nEvents > 0)? n / nEvents: 0 }'
+} # StripHits()
+
+
+BaseDir="$(pwd)"
+
+for Factor in $OccupancyFactors ; do
+	
+	cat <<-EOH
+	=====================================================================
+	   Occupancy factor: ${Factor} (${NEvents} events)
+	=====================================================================
+	EOH
+	
+	WorkDir="occupancy_${Factor}"
+	mkdir -p "$WorkDir"
+	ConfigFile="${BaseDir}/${WorkDir}/prodcorsika_cosmics_proton_occupancy.fcl"
+	SampleTimeScaled="$(awk -v t="$SampleTime" -v f="$Factor" 'BEGIN { printf "%g", t * f }')"
+	TimeOffsetScaled="$(awk -v t="$TimeOffset" -v f="$Factor" 'BEGIN { printf "%g", t * f }')"
+	cat <<-EOF > "$ConfigFile"
+	#include "prodcorsika_cosmics_proton.fcl"
+	physics.producers.generator.SampleTime: ${SampleTimeScaled}
+	physics.producers.generator.TimeOffset: ${TimeOffsetScaled}
+	EOF
+	
+	RunJob "${WorkDir}/gen" "$ConfigFile" || exit $?
+	RunJob "${WorkDir}/g4" 'g4_sce.fcl' "${WorkDir}/gen/out-art.root" || exit $?
+	RunJob "${WorkDir}/detsim" 'benchmark_detsim_sbnd.fcl' "${WorkDir}/g4/out-art.root" || exit $?
+	RunJob "${WorkDir}/reco1" 'benchmark_reco1_sbnd.fcl' "${WorkDir}/detsim/out-art.root" || exit $?
+	RunJob "${WorkDir}/reco2" 'benchmark_reco2_sbnd.fcl' "${WorkDir}/reco1/out-art.root" || exit $?
+	
+done
+
+[[ -n "${FAKE//0}" ]] && exit 0
+
+cat <<-EOH
+=====================================================================
+   CRT module time per event [ms] against occupancy
+=====================================================================
+EOH
+
+printf '%-8s %12s' 'factor' 'strip hits'
+for Module in "${CRTModules[@]}" ; do printf ' %22s' "$Module" ; done
+printf '\n'
+
+for Factor in $OccupancyFactors ; do
+	WorkDir="occupancy_${Factor}"
+	printf '%-8s %12s' "$Factor" "$(StripHits "${WorkDir}/reco1/out-art.root")"
+	for Module in "${CRTModules[@]}" ; do
+		Time=''
+		for Stage in detsim reco1 reco2 ; do
+			[[ -n "$Time" ]] && break
+			Time="$(ModuleTime "${WorkDir}/${Stage}" "$Module")"
+		done
+		awk -v t="$Time" 'BEGIN { if (t == "") printf " %22s", "-"; else printf " %22.2f", t * 1000.; }'
+	done
+	printf '\n'
+done
+
+exit 0
@@ -0,0 +1,157 @@
+#!/usr/bin/env bash
+#
+# Benchmarks the SBND optical simulation and reconstruction.
+#
+# For each generator sample (photon multiplicities from a single muon up to
+# full cosmic activity) events are generated and tracked through g4_sce once;
+# the optical digitization (opDetDigitizerSBND: PMT and X-ARAPUCA waveforms
+# and trigger) is then run with each of the requested worker thread counts,
+# and the optical reco1 (deconvolution, hit finding and flashes) on the
+# digitized events. The time per event and resident memory growth of each
+# module are read from the TimeTracker and MemoryTracker databases, and the
+# digitization speedup is reported for each thread count.
+#
+# Settings (environment variables):
+#   NEvents        number of events per sample (default: 3)
+#   Samples        generator configurations
+#                  (default: "prodsingle_mu_bnblike prodcorsika_cosmics_proton")
+#   ThreadCounts   opDetDigitizerSBND thread counts (default: "1 2 4 8")
+#   FAKE           if set (and not 0), only print the commands
+#
+
+: ${NEvents:=3}
+: ${Samples:="prodsingle_mu_bnblike prodcorsika_cosmics_proton"}
+: ${ThreadCounts:="1 2 4 8"}
+
+
+function Exec() {
+	local LogFile="$1"
+	shift
+	local -a Cmd=( "$@" )
+	
+	echo "\$ ${Cmd[@]}${LogFile:+ >& ${LogFile}}"
+	[[ -n "${FAKE//0}" ]] && return 0
+	
+	local -i res=0
+	if [[ -n "$LogFile" ]]; then
+		"${Cmd[@]}" >& "$LogFile"
+		res=$?
+		[[ $res != 0 ]] && cat "$LogFile"
+	else
+		"${Cmd[@]}"
+		res=$?
+	fi
+	return $res
+} # Exec()
+
+
+# Runs a lar job in its own directory: RunJob <dir> <config> [<input file>]
+function RunJob() {
+	local WorkDir="$1"
+	local ConfigFile="$2"
+	local InputFile="$3"
+	
+	# the benchmark configurations are copied next to the script
+	[[ -r "${BaseDir}/${ConfigFile}" ]] && ConfigFile="${BaseDir}/${ConfigFile}"
+	
+	[[ -d "$WorkDir" ]] && rm -r "${WorkDir%/}/"
+	mkdir -p "$WorkDir" || return $?
+	
+	local -a Cmd=( 'lar' '--rethrow-all' '--config' "$ConfigFile" )
+	if [[ -n "$InputFile" ]]; then
+		Cmd=( "${Cmd[@]}" '--source' "${BaseDir}/${InputFile}" )
+	else
+		Cmd=( "${Cmd[@]}" '--nevts' "$NEvents" )
+	fi
+	Cmd=( "${Cmd[@]}" '--output' 'out-art.root' '--TFileName' 'out-hist.root' )
+	
+	( cd "$WorkDir" && Exec "job.out" "${Cmd[@]}" )
+	local -i res=$?
+	[[ $res != 0 ]] && echo "***  Job '${WorkDir}' FAILED!!! (exit code: ${res})" >&2
+	return $res
+} # RunJob()
+
+
+# Average time per event [s] of a module: ModuleTime <dir> <label>
+function ModuleTime() {
+	sqlite3 "${1}/cputime.db" "SELECT AVG(Time) FROM TimeModule WHERE ModuleLabel = '${2}';"
+} # ModuleTime()
+
+
+# Prints the time and memory of each module of a job: Report <dir>
+function Report() {
+	local WorkDir="$1"
+	
+	echo "--- ${WorkDir}"
+	printf '  %-24s %-32s %12s %14s\n' 'module' 'type' 'ms/event' 'RSS MB/event'
+	sqlite3 -separator ' ' "${WorkDir}/cputime.db" \
+	  'SELECT ModuleLabel, ModuleType, AVG(Time) FROM TimeModule GROUP BY ModuleLabel, ModuleType ORDER BY AVG(Time) DESC;' \
+	  > "${WorkDir}/time.txt" || return $?
+	sqlite3 -separator ' ' "${WorkDir}/memory.db" \
+	  'SELECT ModuleLabel, AVG(DeltaRSS) FROM ModuleInfo WHERE Event > 0 GROUP BY ModuleLabel;' \
+	  > "${WorkDir}/memory.txt" || return $?
+	
+	local Label Type Time DeltaRSS
+	while read Label Type Time ; do
+		DeltaRSS="$(awk -v label="$Label" '$1 == label { print $2 }' "${WorkDir}/memory.txt")"
+		awk -v label="$Label" -v type="$Type" -v t="$Time" -v rss="${DeltaRSS:-0}" \
+		  'BEGIN { printf "  %-24s %-32s %12.2f %14.3f\n", label, type, t * 1000., rss; }'
+	done < "${WorkDir}/time.txt"
+} # Report()
+
+
+BaseDir="$(pwd)"
+
+for Sample in $Samples ; do
+	
+	cat <<-EOH
+	=====================================================================
+	   Sample: ${Sample} (${NEvents} events)
+	=====================================================================
+	EOH
+	
+	RunJob "${Sample}/gen" "${Sample}.fcl" || exit $?
+	RunJob "${Sample}/g4" 'g4_sce.fcl' "${Sample}/gen/out-art.root" || exit $?
+	
+	BaseConfig='benchmark_opdetsim_sbnd.fcl'
+	[[ -r "${BaseDir}/${BaseConfig}" ]] && BaseConfig="${BaseDir}/${BaseConfig}"
+	for NThreads in $ThreadCounts ; do
+		ConfigFile="${BaseDir}/${Sample}/benchmark_opdetsim_sbnd_${NThreads}threads.fcl"
+		cat <<-EOF > "$ConfigFile"
+		#include "${BaseConfig}"
+		physics.producers.opdaq.NThreads: ${NThreads}
+		EOF
+		RunJob "${Sample}/opdetsim_${NThreads}threads" "$ConfigFile" "${Sample}/g4/out-art.root" || exit $?
+	done
+	
+	# the reconstruction input does not depend on the number of threads
+	FirstThreads="${ThreadCounts%% *}"
+	RunJob "${Sample}/opreco" 'benchmark_opreco_sbnd.fcl' "${Sample}/opdetsim_${FirstThreads}threads/out-art.root" || exit $?
+	
+done
+
+[[ -n "${FAKE//0}" ]] && exit 0
+
+for Sample in $Samples ; do
+	
+	cat <<-EOH
+	=====================================================================
+	   Results for ${Sample}
+	=====================================================================
+	EOH
+	
+	FirstThreads="${ThreadCounts%% *}"
+	BaseTime="$(ModuleTime "${Sample}/opdetsim_${FirstThreads}threads" 'opdaq')"
+	printf '  %-10s %12s %10s\n' 'threads' 'opdaq ms' 'speedup'
+	for NThreads in $ThreadCounts ; do
+		Time="$(ModuleTime "${Sample}/opdetsim_${NThreads}threads" 'opdaq')"
+		awk -v n="$NThreads" -v t="$Time" -v t0="$BaseTime" \
+		  'BEGIN { printf "  %-10s %12.2f %10.2f\n", n, t * 1000., (t > 0)? t0 / t: 0; }'
+	done
+	
+	Report "${Sample}/opdetsim_${FirstThreads}threads" || exit $?
+	Report "${Sample}/opreco" || exit $?
+	
+done
+
+exit 0
@@ -0,0 +1,159 @@
+#!/usr/bin/env bash
+#
+# Benchmarks the TPC signal processing of SBND.
+#
+# A short single muon chain is simulated and reconstructed; the detsim and
+# reco1 jobs record the time and memory of each module with the TimeTracker
+# and MemoryTracker services, and for each of their modules this script
+# reports the time per event, the TPC channels processed per second and the
+# resident memory growth per channel.
+#
+# Settings (environment variables):
+#   NEvents                number of events to simulate (default: 5)
+#   NChannels              number of TPC channels (default: 11264, SBND)
+#   MinChannelsPerSecond   if set, fail when the slowest reported module
+#                          processes fewer channels per second than this
+#   FAKE                   if set (and not 0), only print the commands
+#
+
+#############################################################################
+###  Jobs to be executed in chain:
+###
+declare -ar TestNames=(
+    'prodsingle_mu_bnblike'
+    'g4_sce'
+    'benchmark_detsim_sbnd'
+    'benchmark_reco1_sbnd'
+)
+
+###  Jobs whose modules are reported:
+declare -ar BenchmarkNames=(
+    'benchmark_detsim_sbnd'
+    'benchmark_reco1_sbnd'
+)
+
+#############################################################################
+
+: ${NEvents:=5}
+: ${NChannels:=11264}
+
+
+function Exec() {
+	local LogFile="$1"
+	shift
+	local -a Cmd=( "$@" )
+	
+	echo "\$ ${Cmd[@]}${LogFile:+ >& ${LogFile}}"
+	[[ -n "${FAKE//0}" ]] && return 0
+	
+	local -i res=0
+	if [[ -n "$LogFile" ]]; then
+		"${Cmd[@]}" >& "$LogFile"
+		res=$?
+		[[ $res != 0 ]] && cat "$LogFile"
+	else
+		"${Cmd[@]}"
+		res=$?
+	fi
+	return $res
+} # Exec()
+
+
+function Report() {
+	local TestName="$1"
+	
+	cat <<-EOH
+	---------------------------------------------------------------------
+	   ${TestName}: ${NChannels} TPC channels per event
+	---------------------------------------------------------------------
+	EOH
+	printf '%-24s %-32s %12s %14s %16s\n' 'module' 'type' 'ms/event' 'channels/s' 'RSS kB/channel'
+	
+	# average time per event [s] of each module
+	sqlite3 -separator ' ' "${TestName}/cputime.db" \
+	  'SELECT ModuleLabel, ModuleType, AVG(Time) FROM TimeModule GROUP BY ModuleLabel, ModuleType ORDER BY AVG(Time) DESC;' \
+	  > "${TestName}/time.txt" || return $?
+	
+	# average resident memory growth per event [MB] of each module
+	sqlite3 -separator ' ' "${TestName}/memory.db" \
+	  'SELECT ModuleLabel, AVG(DeltaRSS) FROM ModuleInfo WHERE Event > 0 GROUP BY ModuleLabel;' \
+	  > "${TestName}/memory.txt" || return $?
+	
+	local Label Type Time DeltaRSS
+	while read Label Type Time ; do
+		DeltaRSS="$(awk -v label="$Label" '$1 == label { print $2 }' "${TestName}/memory.txt")"
+		awk -v label="$Label" -v type="$Type" -v t="$Time" -v rss="${DeltaRSS:-0}" -v n="$NChannels" '
+		  BEGIN {
+		    rate = (t > 0)? n / t: 0;
+		    printf "%-24s %-32s %12.2f %14.0f %16.4f\n", label, type, t * 1000., rate, rss * 1024. / n;
+		  }'
+	done < "${TestName}/time.txt"
+} # Report()
+
+
+function CheckRates() {
+	[[ -z "$MinChannelsPerSecond" ]] && return 0
+	local TestName Label Type Time
+	local -i nSlow=0
+	for TestName in "${BenchmarkNames[@]}" ; do
+		while read Label Type Time ; do
+			if awk -v t="$Time" -v n="$NChannels" -v min="$MinChannelsPerSecond" 'BEGIN { exit !(t > 0 && n / t < min) }' ; then
+				echo "Module '${Label}' (${TestName}) processes fewer than ${MinChannelsPerSecond} channels per second." >&2
+				let ++nSlow
+			fi
+		done < "${TestName}/time.txt"
+	done
+	return $nSlow
+} # CheckRates()
+
+
+BaseDir="$(pwd)"
+OutputTreeFile=''
+declare -i iTest=0
+declare -ir NTests="${#TestNames[@]}"
+for TestName in "${TestNames[@]}" ; do
+	
+	let ++iTest
+	
+	cat <<-EOH
+	=====================================================================
+	   [${iTest}/${NTests}]  Starting job:  ${TestName}
+	=====================================================================
+	EOH
+	
+	[[ -d "$TestName" ]] && rm -r "${TestName%/}/"
+	mkdir "$TestName" && cd "$TestName" || exit $?
+	
+	# the benchmark configurations are copied next to the script
+	ConfigFile="${TestName}.fcl"
+	[[ -r "${BaseDir}/${ConfigFile}" ]] && ConfigFile="${BaseDir}/${ConfigFile}"
+	
+	declare -a Cmd=( 'lar' '--rethrow-all' '--config' "$ConfigFile" )
+	if [[ -n "$OutputTreeFile" ]]; then
+		Cmd=( "${Cmd[@]}" '--source' "../${OutputTreeFile}" )
+	else
+		Cmd=( "${Cmd[@]}" '--nevts' "$NEvents" )
+	fi
+	
+	OutputTreeFile="${TestName}/${TestName}-art.root"
+	Cmd=( "${Cmd[@]}" '--output' "${TestName}-art.root" '--TFileName' "${TestName}-hist.root" )
+	
+	Exec "${TestName}.out" "${Cmd[@]}"
+	res=$?
+	if [[ $res != 0 ]]; then
+		echo "***  [${iTest}/${NTests}]  Job '${TestName}' FAILED!!! (exit code: ${res})" >&2
+		exit $res
+	fi
+	
+	cd "$BaseDir"
+	
+done
+
+[[ -n "${FAKE//0}" ]] && exit 0
+
+for TestName in "${BenchmarkNames[@]}" ; do
+	Report "$TestName" || exit $?
+done
+
+CheckRates
+exit $?